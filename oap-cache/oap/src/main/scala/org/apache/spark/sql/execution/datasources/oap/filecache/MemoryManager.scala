@@ -55,7 +55,8 @@ case class MemoryBlockHolder(
                               baseOffset: Long,
                               length: Long,
                               occupiedSize: Long,
-                              source: SourceEnum.SourceEnum)
+                              source: SourceEnum.SourceEnum,
+                              numaNode: Int = -1)
 
 private[sql] abstract class MemoryManager {
   /**
@@ -289,6 +290,14 @@ private[filecache] class TmpDramMemoryManager(sparkEnv: SparkEnv)
 private[filecache] class PersistentMemoryManager(sparkEnv: SparkEnv)
   extends MemoryManager with Logging {
 
+  private val slabEnabled = sparkEnv.conf.getBoolean(
+    OapConf.OAP_FIBERCACHE_PERSISTENT_MEMORY_SLAB_ENABLED.key,
+    OapConf.OAP_FIBERCACHE_PERSISTENT_MEMORY_SLAB_ENABLED.defaultValue.get)
+
+  private val numaLocal = sparkEnv.conf.getBoolean(
+    OapConf.OAP_FIBERCACHE_PERSISTENT_MEMORY_NUMA_LOCAL_ENABLED.key,
+    OapConf.OAP_FIBERCACHE_PERSISTENT_MEMORY_NUMA_LOCAL_ENABLED.defaultValue.get)
+
   private val _memorySize = init()
 
   private val _memoryUsed = new AtomicLong(0)
@@ -328,6 +337,19 @@ private[filecache] class PersistentMemoryManager(sparkEnv: SparkEnv)
 
     logInfo(s"Current Memkind pattern: ${memkindPattern}")
 
+    if (numaLocal) {
+      map.foreach { case (node, path) =>
+        val nodePath = Utils.createTempDir(path + File.separator + executorId)
+        PersistentMemoryPlatform.initializeOnNode(nodePath.getCanonicalPath, initialSize,
+          memkindPattern, node)
+        logInfo(s"Initialize Intel Optane DC persistent memory of numaId: ${node}, " +
+          s"initial path: ${nodePath.getCanonicalPath}, initial size: ${initialSize}")
+      }
+      require(reservedSize >= 0 && reservedSize < initialSize, s"Reserved size(${reservedSize}) " +
+        s"should be larger than zero and smaller than initial size(${initialSize})")
+      return (initialSize - reservedSize) * map.size
+    }
+
     val fullPath = Utils.createTempDir(initialPath + File.separator + executorId)
     PersistentMemoryPlatform.initialize(fullPath.getCanonicalPath, initialSize, memkindPattern)
     logInfo(s"Initialize Intel Optane DC persistent memory successfully, numaId: ${numaId}, " +
@@ -344,8 +366,25 @@ private[filecache] class PersistentMemoryManager(sparkEnv: SparkEnv)
 
   override private[filecache] def allocate(size: Long): MemoryBlockHolder = {
     try {
-      val address = PersistentMemoryPlatform.allocateVolatileMemory(size)
-      val occupiedSize = PersistentMemoryPlatform.getOccupiedSize(address)
+      if (numaLocal) {
+        // the nodes without persistent memory allocate from the first node configured
+        val nodes = PersistentMemoryConfigUtils.parseConfig(sparkEnv.conf)
+        val currentNode = PersistentMemoryPlatform.getCurrentNode()
+        val node = if (nodes.contains(currentNode)) currentNode else nodes.keys.min
+        val address = PersistentMemoryPlatform.allocateVolatileMemoryOnNode(size, node)
+        val occupiedSize = PersistentMemoryPlatform.getOccupiedSizeOnNode(address, node)
+        _memoryUsed.getAndAdd(occupiedSize)
+        logDebug(s"request allocate $size memory on numa node $node, actual occupied size: " +
+          s"${occupiedSize}, used: $memoryUsed")
+        return MemoryBlockHolder(null, address, size, occupiedSize, SourceEnum.PM, node)
+      }
+      val (address, occupiedSize) = if (slabEnabled) {
+        val address = PersistentMemoryPlatform.allocateSlabMemory(size)
+        (address, PersistentMemoryPlatform.getSlabOccupiedSize(address))
+      } else {
+        val address = PersistentMemoryPlatform.allocateVolatileMemory(size)
+        (address, PersistentMemoryPlatform.getOccupiedSize(address))
+      }
       _memoryUsed.getAndAdd(occupiedSize)
       logDebug(s"request allocate $size memory, actual occupied size: " +
         s"${occupiedSize}, used: $memoryUsed")
@@ -359,12 +398,22 @@ private[filecache] class PersistentMemoryManager(sparkEnv: SparkEnv)
 
   override private[filecache] def free(block: MemoryBlockHolder): Unit = {
     assert(block.baseObject == null)
-    PersistentMemoryPlatform.freeMemory(block.baseOffset)
+    if (block.numaNode >= 0) {
+      PersistentMemoryPlatform.freeMemoryOnNode(block.baseOffset, block.numaNode)
+    } else if (slabEnabled) {
+      PersistentMemoryPlatform.freeSlabMemory(block.baseOffset)
+    } else {
+      PersistentMemoryPlatform.freeMemory(block.baseOffset)
+    }
     _memoryUsed.getAndAdd(-block.occupiedSize)
     logDebug(s"freed ${block.occupiedSize} memory, used: $memoryUsed")
   }
 
   override def isDcpmmUsed(): Boolean = {true}
+
+  override def stop(): Unit = {
+    logInfo(s"Persistent memory usage: ${PersistentMemoryPlatform.getStats()}")
+  }
 }
 
 private[filecache] class DaxKmemMemoryManager(sparkEnv: SparkEnv)
@@ -506,6 +506,23 @@ object OapConf {
       .booleanConf
       .createWithDefault(true)
 
+  val OAP_FIBERCACHE_PERSISTENT_MEMORY_SLAB_ENABLED =
+    SqlConfAdapter.buildConf("spark.sql.oap.fiberCache.persistent.memory.slab.enable")
+      .internal()
+      .doc("To allocate fiber caches from a slab allocator of size classes on top of " +
+        "memkind, instead of calling memkind for each fiber cache")
+      .booleanConf
+      .createWithDefault(false)
+
+  val OAP_FIBERCACHE_PERSISTENT_MEMORY_NUMA_LOCAL_ENABLED =
+    SqlConfAdapter.buildConf("spark.sql.oap.fiberCache.persistent.memory.numa.local.enable")
+      .internal()
+      .doc("To initialize the persistent memory of every numa node in the configuration " +
+        "file, each with the initial size, and allocate fiber caches from the node of the " +
+        "allocating thread, instead of from the node the executor is bound to")
+      .booleanConf
+      .createWithDefault(false)
+
   val OAP_PARQUET_BINARY_DATA_CACHE_ENABLED =
     SqlConfAdapter.buildConf("spark.sql.oap.parquet.binary.cache.enabled")
       .internal()
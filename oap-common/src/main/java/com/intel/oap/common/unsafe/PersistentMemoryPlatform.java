@@ -77,8 +77,34 @@ public class PersistentMemoryPlatform {
     }
   }
 
+  /**
+   * Initialize the persistent memory of a numa node, allocated from by the *OnNode methods.
+   * Each node is initialized once, from a path on the persistent memory of that node.
+   * @param path The initial path which should be a directory.
+   * @param size The initial size
+   * @param node The numa node
+   */
+  public static void initializeOnNode(String path, long size, int pattern, int node) {
+    Preconditions.checkNotNull(path, "Persistent memory initial path can't be null");
+    File dir = new File(path);
+    Preconditions.checkArgument(dir.exists() && dir.isDirectory(), "Persistent memory " +
+      "initial path should be a directory");
+    Preconditions.checkArgument(size > 0,
+      "Persistent memory initial size must be a positive number");
+    try {
+      initializeNativeOnNode(path, size, pattern, node);
+    } catch (Exception e) {
+      throw new ExceptionInInitializerError("Persistent memory initialize (path: " + path +
+        ", size: " + size + ", node: " + node + ") failed. Please check the path permission " +
+        "and initial size.");
+    }
+  }
+
   private static native void initializeKmem();
 
+  private static native void initializeNativeOnNode(String path, long size, int pattern,
+      int node);
+
   private static native void initializeNative(String path, long size, int pattern);
 
   /**
@@ -139,4 +165,93 @@ public class PersistentMemoryPlatform {
    * Free the memory by address.
    */
   public static native void freeMemory(long address);
+
+  /**
+   * Get the numa node of the cpu running the caller.
+   */
+  public static native int getCurrentNode();
+
+  /**
+   * Allocate volatile memory from the persistent memory of a numa node.
+   * @param size the requested size
+   * @param node the numa node, or -1 for the node of the caller
+   * @return the address, it can only be freed by freeMemoryOnNode of the same node.
+   */
+  public static native long allocateVolatileMemoryOnNode(long size, int node);
+
+  /**
+   * Get the actual occupied size of the given address allocated on a numa node.
+   */
+  public static native long getOccupiedSizeOnNode(long address, int node);
+
+  /**
+   * Free the memory allocated on a numa node by address.
+   */
+  public static native void freeMemoryOnNode(long address, int node);
+
+  /**
+   * Allocate volatile memory from the slab allocator on persistent memory. The request
+   * is rounded up to a size class and carved from slabs reused across frees, instead of
+   * reaching memkind on each call.
+   * @param size the requested size
+   * @return the address, it can only be freed by freeSlabMemory or freeSlabMemoryBatch.
+   */
+  public static native long allocateSlabMemory(long size);
+
+  /**
+   * Get the size class of the given address allocated by allocateSlabMemory.
+   * @param address the memory block address.
+   * @return actual occupied size.
+   */
+  public static native long getSlabOccupiedSize(long address);
+
+  /**
+   * Free the memory allocated by allocateSlabMemory by address.
+   */
+  public static native void freeSlabMemory(long address);
+
+  /**
+   * Free the memory allocated by allocateSlabMemory by addresses at once.
+   */
+  public static native void freeSlabMemoryBatch(long[] addresses);
+
+  /**
+   * Copy off-heap memory, e.g. into persistent memory, with non-temporal stores, which
+   * don't pollute the cpu cache with the copied data.
+   */
+  public static native void copyMemoryNonTemporal(long destination, long source, long size);
+
+  /**
+   * Start the background copy threads with the given number of threads. It only takes
+   * effect before the first asynchronous copy, which otherwise starts 2 threads.
+   */
+  public static native void initializeCopyThreads(int threadNum);
+
+  /**
+   * Copy off-heap memory with non-temporal stores on the background copy threads.
+   * The source must stay valid until the copy completes.
+   * @return the handle of the copy, it must be released by waitCopy.
+   */
+  public static native long copyMemoryAsync(long destination, long source, long size);
+
+  /**
+   * Whether the copy of the given handle completed.
+   */
+  public static native boolean isCopyDone(long handle);
+
+  /**
+   * Wait for the copy of the given handle to complete, then release the handle.
+   */
+  public static native void waitCopy(long handle);
+
+  /**
+   * Get the usage of all the allocations on persistent memory since initialization.
+   */
+  public static PersistentMemoryStats getStats() {
+    return new PersistentMemoryStats(getStatsNative(), getSlabClassStatsNative());
+  }
+
+  private static native long[] getStatsNative();
+
+  private static native long[] getSlabClassStatsNative();
 }
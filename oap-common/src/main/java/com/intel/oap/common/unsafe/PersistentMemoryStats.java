@@ -0,0 +1,99 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.oap.common.unsafe;
+
+/**
+ * Usage of the persistent memory allocated by PersistentMemoryPlatform. The occupied
+ * size is the size actually given to the allocations, the resident size the one taken
+ * from persistent memory for them, including the free space of the slabs, so that the
+ * difference of the two is the fragmentation.
+ */
+public class PersistentMemoryStats {
+  private final long occupiedSize;
+  private final long residentSize;
+  private final long allocations;
+  private final long frees;
+  private final long failedAllocations;
+  private final long[] slabClassSizes;
+  private final long[] slabClassInUse;
+
+  PersistentMemoryStats(long[] stats, long[] slabClassStats) {
+    this.occupiedSize = stats[0];
+    this.residentSize = stats[1];
+    this.allocations = stats[2];
+    this.frees = stats[3];
+    this.failedAllocations = stats[4];
+    int classNum = slabClassStats.length / 2;
+    this.slabClassSizes = new long[classNum];
+    this.slabClassInUse = new long[classNum];
+    for (int i = 0; i < classNum; i++) {
+      slabClassSizes[i] = slabClassStats[i * 2];
+      slabClassInUse[i] = slabClassStats[i * 2 + 1];
+    }
+  }
+
+  public long getOccupiedSize() {
+    return occupiedSize;
+  }
+
+  public long getResidentSize() {
+    return residentSize;
+  }
+
+  /**
+   * The fraction of the resident size not occupied by any allocation.
+   */
+  public double getFragmentation() {
+    return residentSize == 0 ? 0.0 : 1.0 - (double) occupiedSize / residentSize;
+  }
+
+  public long getAllocations() {
+    return allocations;
+  }
+
+  public long getFrees() {
+    return frees;
+  }
+
+  public long getFailedAllocations() {
+    return failedAllocations;
+  }
+
+  /**
+   * The sizes of the slab size classes, in ascending order.
+   */
+  public long[] getSlabClassSizes() {
+    return slabClassSizes.clone();
+  }
+
+  /**
+   * The allocations in use of each slab size class.
+   */
+  public long[] getSlabClassInUse() {
+    return slabClassInUse.clone();
+  }
+
+  @Override
+  public String toString() {
+    return String.format(
+      "PersistentMemoryStats(occupied=%d, resident=%d, fragmentation=%.3f, " +
+        "allocations=%d, frees=%d, failedAllocations=%d)",
+      occupiedSize, residentSize, getFragmentation(), allocations, frees,
+      failedAllocations);
+  }
+}
@@ -0,0 +1,148 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AsyncCopier.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+// copies smaller than that are left to memcpy
+const size_t NON_TEMPORAL_THRESHOLD = 4096;
+const size_t STORE_ALIGN = 64;
+
+#if defined(__x86_64__)
+__attribute__((target("avx512f")))
+void streamCopyAvx512(char* dest, const char* src, size_t size) {
+  for (size_t off = 0; off < size; off += 64) {
+    __m512i v = _mm512_loadu_si512((const void*)(src + off));
+    _mm512_stream_si512((__m512i*)(dest + off), v);
+  }
+}
+
+void streamCopySse2(char* dest, const char* src, size_t size) {
+  for (size_t off = 0; off < size; off += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + off));
+    _mm_stream_si128((__m128i*)(dest + off), v);
+  }
+}
+
+bool hasAvx512() {
+  static const bool supported = __builtin_cpu_supports("avx512f");
+  return supported;
+}
+#endif
+}  // namespace
+
+const size_t AsyncCopier::CHUNK_SIZE;
+
+void nonTemporalCopy(void* dest, const void* src, size_t size) {
+#if defined(__x86_64__)
+  if (size < NON_TEMPORAL_THRESHOLD) {
+    std::memcpy(dest, src, size);
+    return;
+  }
+  char* d = (char*)dest;
+  const char* s = (const char*)src;
+  // the streaming stores need aligned destinations
+  size_t head = (STORE_ALIGN - ((uintptr_t)d & (STORE_ALIGN - 1))) & (STORE_ALIGN - 1);
+  std::memcpy(d, s, head);
+  size_t body = (size - head) & ~(STORE_ALIGN - 1);
+  if (hasAvx512()) {
+    streamCopyAvx512(d + head, s + head, body);
+  } else {
+    streamCopySse2(d + head, s + head, body);
+  }
+  std::memcpy(d + head + body, s + head + body, size - head - body);
+  _mm_sfence();
+#else
+  std::memcpy(dest, src, size);
+#endif
+}
+
+AsyncCopier::AsyncCopier(int threadNum) {
+  for (int i = 0; i < threadNum; i++) {
+    threads_.emplace_back(&AsyncCopier::run, this);
+  }
+}
+
+AsyncCopier::~AsyncCopier() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stopped_ = true;
+  }
+  cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+AsyncCopier::Handle* AsyncCopier::submit(void* dest, const void* src, size_t size) {
+  Handle* handle = new Handle();
+  size_t chunkNum = size == 0 ? 0 : (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  handle->pending = chunkNum;
+  if (chunkNum == 0) {
+    return handle;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (size_t i = 0; i < chunkNum; i++) {
+      size_t off = i * CHUNK_SIZE;
+      size_t len = size - off < CHUNK_SIZE ? size - off : CHUNK_SIZE;
+      chunks_.push_back({(char*)dest + off, (const char*)src + off, len, handle});
+    }
+  }
+  cv_.notify_all();
+  return handle;
+}
+
+bool AsyncCopier::isDone(Handle* handle) {
+  return handle->pending == 0;
+}
+
+void AsyncCopier::wait(Handle* handle) {
+  {
+    std::unique_lock<std::mutex> lock(handle->mtx);
+    handle->cv.wait(lock, [handle] { return handle->pending == 0; });
+  }
+  delete handle;
+}
+
+void AsyncCopier::run() {
+  while (true) {
+    Chunk chunk;
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      cv_.wait(lock, [this] { return stopped_ || !chunks_.empty(); });
+      if (chunks_.empty()) {
+        return;
+      }
+      chunk = chunks_.front();
+      chunks_.pop_front();
+    }
+    nonTemporalCopy(chunk.dest, chunk.src, chunk.size);
+    Handle* handle = chunk.handle;
+    std::lock_guard<std::mutex> lock(handle->mtx);
+    if (--handle->pending == 0) {
+      handle->cv.notify_all();
+    }
+  }
+}
@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OAP_ASYNC_COPIER_H
+#define OAP_ASYNC_COPIER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Copy size bytes with non-temporal stores, AVX-512 ones when the cpu supports them,
+ * so that filling the persistent memory cache doesn't evict the cpu cache. The stores
+ * are fenced before returning.
+ */
+void nonTemporalCopy(void* dest, const void* src, size_t size);
+
+/**
+ * Background threads copying off-heap memory into the persistent memory cache with
+ * non-temporal stores. A copy is cut in CHUNK_SIZE chunks spread on the threads, and
+ * its handle completes once all of them are copied.
+ */
+class AsyncCopier {
+public:
+  static const size_t CHUNK_SIZE = 4UL << 20;
+
+  struct Handle {
+    std::atomic<size_t> pending;
+    std::mutex mtx;
+    std::condition_variable cv;
+  };
+
+  explicit AsyncCopier(int threadNum);
+  ~AsyncCopier();
+
+  // the source must stay valid until the handle completes
+  Handle* submit(void* dest, const void* src, size_t size);
+  bool isDone(Handle* handle);
+  // wait for the copy to complete, then release its handle
+  void wait(Handle* handle);
+
+private:
+  struct Chunk {
+    char* dest;
+    const char* src;
+    size_t size;
+    Handle* handle;
+  };
+
+  void run();
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<Chunk> chunks_;
+  std::vector<std::thread> threads_;
+  bool stopped_ = false;
+};
+
+#endif  // OAP_ASYNC_COPIER_H
@@ -0,0 +1,194 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SlabAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+const uint64_t SLAB_MAGIC = 0x534c414241524e41ULL;
+}
+
+const size_t SlabAllocator::SLAB_SIZE;
+const size_t SlabAllocator::HEADER_SIZE;
+const size_t SlabAllocator::MIN_CLASS_SIZE;
+const int SlabAllocator::CLASSES_PER_DOUBLING;
+const int SlabAllocator::NUM_CLASSES;
+const size_t SlabAllocator::MAX_CLASS_SIZE;
+const size_t SlabAllocator::THREAD_CACHE_BYTES;
+
+SlabAllocator::SlabAllocator(memkind_t kind) : kind_(kind) {}
+
+SlabAllocator::ThreadCache::~ThreadCache() {
+  if (allocator == nullptr) {
+    return;
+  }
+  for (int i = 0; i < NUM_CLASSES; i++) {
+    allocator->giveFree(i, objects[i].data(), objects[i].size());
+  }
+}
+
+size_t SlabAllocator::classSize(int sizeClass) {
+  int step = sizeClass % CLASSES_PER_DOUBLING;
+  return (MIN_CLASS_SIZE << (sizeClass / CLASSES_PER_DOUBLING)) *
+    (CLASSES_PER_DOUBLING + step) / CLASSES_PER_DOUBLING;
+}
+
+int SlabAllocator::sizeClassOf(size_t size) {
+  for (int i = 0; i < NUM_CLASSES; i++) {
+    if (size <= classSize(i)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+SlabAllocator::SlabHeader* SlabAllocator::headerOf(void* p) {
+  return (SlabHeader*)((uintptr_t)p & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+size_t SlabAllocator::threadCacheCapacity(int sizeClass) {
+  return THREAD_CACHE_BYTES / classSize(sizeClass);
+}
+
+SlabAllocator::ThreadCache& SlabAllocator::threadCache() {
+  static thread_local ThreadCache cache;
+  cache.allocator = this;
+  return cache;
+}
+
+bool SlabAllocator::newSlab(int sizeClass) {
+  void* slab = nullptr;
+  if (memkind_posix_memalign(kind_, &slab, SLAB_SIZE, SLAB_SIZE) != 0 || slab == nullptr) {
+    return false;
+  }
+  SlabHeader* header = (SlabHeader*)slab;
+  header->magic = SLAB_MAGIC;
+  header->sizeClass = sizeClass;
+  header->size = classSize(sizeClass);
+  slabs_++;
+  std::vector<void*>& freeList = classes_[sizeClass].freeList;
+  for (size_t off = HEADER_SIZE; off + header->size <= SLAB_SIZE; off += header->size) {
+    freeList.push_back((char*)slab + off);
+  }
+  return true;
+}
+
+bool SlabAllocator::takeFree(int sizeClass, size_t n, std::vector<void*>* out) {
+  SizeClass& sc = classes_[sizeClass];
+  std::lock_guard<std::mutex> lock(sc.mtx);
+  if (sc.freeList.empty() && !newSlab(sizeClass)) {
+    return false;
+  }
+  size_t taken = std::min(n, sc.freeList.size());
+  out->insert(out->end(), sc.freeList.end() - taken, sc.freeList.end());
+  sc.freeList.resize(sc.freeList.size() - taken);
+  return true;
+}
+
+void SlabAllocator::giveFree(int sizeClass, void** ps, size_t n) {
+  if (n == 0) {
+    return;
+  }
+  SizeClass& sc = classes_[sizeClass];
+  std::lock_guard<std::mutex> lock(sc.mtx);
+  sc.freeList.insert(sc.freeList.end(), ps, ps + n);
+}
+
+void* SlabAllocator::allocate(size_t size) {
+  int sizeClass = sizeClassOf(size);
+  if (sizeClass == -1) {
+    void* p = nullptr;
+    if (memkind_posix_memalign(kind_, &p, SLAB_SIZE, HEADER_SIZE + size) != 0 || p == nullptr) {
+      return nullptr;
+    }
+    SlabHeader* header = (SlabHeader*)p;
+    header->magic = SLAB_MAGIC;
+    header->sizeClass = -1;
+    header->size = size;
+    largeBytes_ += HEADER_SIZE + size;
+    return (char*)p + HEADER_SIZE;
+  }
+  std::vector<void*>& cached = threadCache().objects[sizeClass];
+  if (cached.empty()) {
+    // refill half of the thread cache at once
+    size_t n = std::max<size_t>(1, threadCacheCapacity(sizeClass) / 2);
+    if (!takeFree(sizeClass, n, &cached)) {
+      return nullptr;
+    }
+  }
+  void* p = cached.back();
+  cached.pop_back();
+  classes_[sizeClass].inUse++;
+  return p;
+}
+
+void SlabAllocator::free(void* p) {
+  if (p == nullptr) {
+    return;
+  }
+  SlabHeader* header = headerOf(p);
+  assert(header->magic == SLAB_MAGIC);
+  if (header->sizeClass == -1) {
+    largeBytes_ -= HEADER_SIZE + header->size;
+    memkind_free(kind_, header);
+    return;
+  }
+  classes_[header->sizeClass].inUse--;
+  std::vector<void*>& cached = threadCache().objects[header->sizeClass];
+  cached.push_back(p);
+  size_t capacity = threadCacheCapacity(header->sizeClass);
+  if (cached.size() > capacity) {
+    // give back the older half of the thread cache at once
+    size_t n = cached.size() - capacity / 2;
+    giveFree(header->sizeClass, cached.data(), n);
+    cached.erase(cached.begin(), cached.begin() + n);
+  }
+}
+
+void SlabAllocator::freeBatch(void** ps, size_t n) {
+  std::vector<void*> byClass[NUM_CLASSES];
+  for (size_t i = 0; i < n; i++) {
+    if (ps[i] == nullptr) {
+      continue;
+    }
+    SlabHeader* header = headerOf(ps[i]);
+    if (header->sizeClass == -1) {
+      largeBytes_ -= HEADER_SIZE + header->size;
+      memkind_free(kind_, header);
+    } else {
+      byClass[header->sizeClass].push_back(ps[i]);
+    }
+  }
+  for (int i = 0; i < NUM_CLASSES; i++) {
+    classes_[i].inUse -= byClass[i].size();
+    giveFree(i, byClass[i].data(), byClass[i].size());
+  }
+}
+
+size_t SlabAllocator::usableSize(void* p) {
+  return headerOf(p)->size;
+}
+
+size_t SlabAllocator::inUse(int sizeClass) {
+  return classes_[sizeClass].inUse;
+}
+
+size_t SlabAllocator::residentBytes() {
+  return slabs_ * SLAB_SIZE + largeBytes_;
+}
@@ -0,0 +1,99 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OAP_SLAB_ALLOCATOR_H
+#define OAP_SLAB_ALLOCATOR_H
+
+#include <memkind.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Slab allocator of volatile memory on top of a memkind kind, for the cache fibers.
+ *
+ * Requests up to MAX_CLASS_SIZE are rounded up to one of NUM_CLASSES size classes, four
+ * per power of two from MIN_CLASS_SIZE, and carved from slabs of SLAB_SIZE taken from
+ * memkind, so the cache churn doesn't reach memkind. Slabs are aligned to SLAB_SIZE and
+ * start with a header giving their size class, so freeing an address finds its class by
+ * masking it. Larger requests get their own aligned memkind allocation with the same
+ * header. Each thread caches freed objects of each class up to THREAD_CACHE_BYTES, and
+ * exchanges them with the shared free lists in batches. Slabs are kept for reuse and
+ * never given back to memkind, and the allocator must outlive the threads using it.
+ */
+class SlabAllocator {
+public:
+  static const size_t SLAB_SIZE = 32UL << 20;
+  static const size_t HEADER_SIZE = 4096;
+  static const size_t MIN_CLASS_SIZE = 4096;
+  static const int CLASSES_PER_DOUBLING = 4;
+  static const int NUM_CLASSES = 45;
+  static const size_t MAX_CLASS_SIZE = MIN_CLASS_SIZE << 11;
+  static const size_t THREAD_CACHE_BYTES = 8UL << 20;
+
+  explicit SlabAllocator(memkind_t kind);
+
+  void* allocate(size_t size);
+  void free(void* p);
+  // free n addresses, taking the lock of each size class once
+  void freeBatch(void** ps, size_t n);
+  size_t usableSize(void* p);
+
+  static size_t classSize(int sizeClass);
+  // objects of the class allocated and not freed yet
+  size_t inUse(int sizeClass);
+  // bytes taken from memkind, by the slabs and the larger allocations
+  size_t residentBytes();
+
+private:
+  struct SlabHeader {
+    uint64_t magic;
+    // -1 for the allocations larger than MAX_CLASS_SIZE
+    int sizeClass;
+    size_t size;
+  };
+
+  struct SizeClass {
+    std::mutex mtx;
+    std::vector<void*> freeList;
+    std::atomic<size_t> inUse{0};
+  };
+
+  struct ThreadCache {
+    SlabAllocator* allocator = nullptr;
+    std::vector<void*> objects[NUM_CLASSES];
+    ~ThreadCache();
+  };
+
+  static int sizeClassOf(size_t size);
+  static SlabHeader* headerOf(void* p);
+  static size_t threadCacheCapacity(int sizeClass);
+  ThreadCache& threadCache();
+  // move up to n free objects of the class to out, carving a new slab if needed
+  bool takeFree(int sizeClass, size_t n, std::vector<void*>* out);
+  void giveFree(int sizeClass, void** ps, size_t n);
+  bool newSlab(int sizeClass);
+
+  memkind_t kind_;
+  SizeClass classes_[NUM_CLASSES];
+  std::atomic<size_t> slabs_{0};
+  std::atomic<size_t> largeBytes_{0};
+};
+
+#endif  // OAP_SLAB_ALLOCATOR_H
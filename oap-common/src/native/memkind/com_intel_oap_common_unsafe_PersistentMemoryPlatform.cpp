@@ -22,11 +22,52 @@
 #include <cstdlib>
 #include <cassert>
 #include <stdexcept>
+#include <atomic>
+#include <mutex>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <vector>
 #include "com_intel_oap_common_unsafe_PersistentMemoryPlatform.h"
+#include "AsyncCopier.h"
+#include "SlabAllocator.h"
 
 using memkind = struct memkind;
 memkind *pmemkind = NULL;
-struct memkind_config *pmemkind_config;
+// created with the kind, never deleted as threads may still hold slab memory
+SlabAllocator *slabAllocator = NULL;
+// started on the first asynchronous copy, never stopped
+AsyncCopier *asyncCopier = NULL;
+std::once_flag asyncCopierOnce;
+int asyncCopierThreads = 2;
+
+// one kind per numa node, for the executors allocating socket-local memory
+const int MAX_NUMA_NODES = 64;
+memkind *nodeKinds[MAX_NUMA_NODES] = {NULL};
+std::mutex nodeKindsMutex;
+
+// counters of the allocations of all the kinds
+struct PlatformStats {
+  // usable bytes allocated directly from memkind and not freed yet
+  std::atomic<int64_t> memkindBytes{0};
+  std::atomic<int64_t> allocations{0};
+  std::atomic<int64_t> frees{0};
+  std::atomic<int64_t> failedAllocations{0};
+};
+PlatformStats platformStats;
+
+inline void countAllocation(void *p, size_t occupiedSize) {
+  if (p == NULL) {
+    platformStats.failedAllocations++;
+  } else {
+    platformStats.allocations++;
+    platformStats.memkindBytes += occupiedSize;
+  }
+}
+
+inline void countFree(size_t occupiedSize) {
+  platformStats.frees++;
+  platformStats.memkindBytes -= occupiedSize;
+}
 
 // copied form openjdk: http://hg.openjdk.java.net/jdk8/jdk8/hotspot/file/87ee5ee27509/src/share/vm/prims/unsafe.cpp
 inline void* addr_from_java(jlong addr) {
@@ -50,13 +91,7 @@ inline void check(JNIEnv *env) {
   }
 }
 
-JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_initializeKmem
-  (JNIEnv *, jclass) {
-  pmemkind = MEMKIND_DAX_KMEM;
-}
-
-JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_initializeNative
-  (JNIEnv *env, jclass clazz, jstring path, jlong size, jint pattern) {
+int createPmemKind(JNIEnv *env, jstring path, jlong size, jint pattern, memkind **kind) {
   // str should not be null, we should checked in java code
   const char* str = env->GetStringUTFChars(path, NULL);
   size_t sz = (size_t)size;
@@ -65,22 +100,61 @@ JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform
   int error;
 
   if (pattern_c == 0) {
-    error = memkind_create_pmem(str, sz, &pmemkind);
+    error = memkind_create_pmem(str, sz, kind);
   } else {
-    pmemkind_config = memkind_config_new();
-    memkind_config_set_path(pmemkind_config, str);
-    memkind_config_set_size(pmemkind_config, sz);
-    memkind_config_set_memory_usage_policy(pmemkind_config, MEMKIND_MEM_USAGE_POLICY_CONSERVATIVE);
-    error = memkind_create_pmem_with_config(pmemkind_config, &pmemkind);
+    struct memkind_config *config = memkind_config_new();
+    memkind_config_set_path(config, str);
+    memkind_config_set_size(config, sz);
+    memkind_config_set_memory_usage_policy(config, MEMKIND_MEM_USAGE_POLICY_CONSERVATIVE);
+    error = memkind_create_pmem_with_config(config, kind);
+    memkind_config_delete(config);
+  }
+
+  env->ReleaseStringUTFChars(path, str);
+  return error;
+}
+
+inline int currentNode() {
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+    return 0;
+  }
+  return (int)node;
+}
+
+// the kind of node, of the caller's node if node is negative
+inline memkind *checkNode(JNIEnv *env, jint node) {
+  int n = node < 0 ? currentNode() : (int)node;
+  memkind *kind = n < MAX_NUMA_NODES ? nodeKinds[n] : NULL;
+  if (NULL == kind) {
+    jclass exceptionCls = env->FindClass("java/lang/RuntimeException");
+    std::string errorMsg;
+    errorMsg.append("Persistent memory of numa node ");
+    errorMsg.append(std::to_string(n));
+    errorMsg.append(" should be initialized first!");
+    env->ThrowNew(exceptionCls, errorMsg.c_str());
   }
+  return kind;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_initializeKmem
+  (JNIEnv *, jclass) {
+  pmemkind = MEMKIND_DAX_KMEM;
+  slabAllocator = new SlabAllocator(pmemkind);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_initializeNative
+  (JNIEnv *env, jclass clazz, jstring path, jlong size, jint pattern) {
+  int error = createPmemKind(env, path, size, pattern, &pmemkind);
 
   if (error) {
     jclass exceptionCls = env->FindClass("java/lang/Exception");
     env->ThrowNew(exceptionCls,
       "Persistent initialize failed! Please check the path permission.");
+  } else {
+    slabAllocator = new SlabAllocator(pmemkind);
   }
-
-  env->ReleaseStringUTFChars(path, str);
 }
 
 JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_setNUMANode
@@ -100,6 +174,7 @@ JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatfor
 
   size_t sz = (size_t)size;
   void *p = memkind_malloc(pmemkind, sz);
+  countAllocation(p, p == NULL ? 0 : memkind_malloc_usable_size(pmemkind, p));
   if (p == NULL) {
     jclass errorCls = env->FindClass("java/lang/OutOfMemoryError");
     std::string errorMsg;
@@ -112,6 +187,52 @@ JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatfor
   return addr_to_java(p);
 }
 
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_allocateSlabMemory
+  (JNIEnv *env, jclass clazz, jlong size) {
+  check(env);
+
+  size_t sz = (size_t)size;
+  void *p = slabAllocator->allocate(sz);
+  countAllocation(p, 0);
+  if (p == NULL) {
+    jclass errorCls = env->FindClass("java/lang/OutOfMemoryError");
+    std::string errorMsg;
+    errorMsg.append("Don't have enough memory for a new slab, please consider decrease the ");
+    errorMsg.append("persistent memory usable ratio. The requested size: ");
+    errorMsg.append(std::to_string(sz));
+    env->ThrowNew(errorCls, errorMsg.c_str());
+  }
+
+  return addr_to_java(p);
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getSlabOccupiedSize
+  (JNIEnv *env, jclass clazz, jlong address) {
+  check(env);
+  return slabAllocator->usableSize(addr_from_java(address));
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_freeSlabMemory
+  (JNIEnv *env, jclass clazz, jlong address) {
+  check(env);
+  countFree(0);
+  slabAllocator->free(addr_from_java(address));
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_freeSlabMemoryBatch
+  (JNIEnv *env, jclass clazz, jlongArray addresses) {
+  check(env);
+  jsize length = env->GetArrayLength(addresses);
+  jlong *elements = env->GetLongArrayElements(addresses, NULL);
+  std::vector<void*> ps(length);
+  for (jsize i = 0; i < length; i++) {
+    ps[i] = addr_from_java(elements[i]);
+  }
+  env->ReleaseLongArrayElements(addresses, elements, JNI_ABORT);
+  platformStats.frees += length;
+  slabAllocator->freeBatch(ps.data(), ps.size());
+}
+
 JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getOccupiedSize
   (JNIEnv *env, jclass clazz, jlong address) {
   check(env);
@@ -122,7 +243,9 @@ JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatfor
 JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_freeMemory
   (JNIEnv *env, jclass clazz, jlong address) {
   check(env);
-  memkind_free(pmemkind, addr_from_java(address));
+  void *p = addr_from_java(address);
+  countFree(memkind_malloc_usable_size(pmemkind, p));
+  memkind_free(pmemkind, p);
 }
 
 JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_copyMemory
@@ -132,3 +255,140 @@ JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform
   void *src = addr_from_java(source);
   std::memcpy(dest, src, sz);
 }
+
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_copyMemoryNonTemporal
+  (JNIEnv *env, jclass clazz, jlong destination, jlong source, jlong size) {
+  nonTemporalCopy(addr_from_java(destination), addr_from_java(source), (size_t)size);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_initializeCopyThreads
+  (JNIEnv *env, jclass clazz, jint threadNum) {
+  std::call_once(asyncCopierOnce, [threadNum] {
+    asyncCopier = new AsyncCopier(threadNum > 0 ? threadNum : asyncCopierThreads);
+  });
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_copyMemoryAsync
+  (JNIEnv *env, jclass clazz, jlong destination, jlong source, jlong size) {
+  std::call_once(asyncCopierOnce, [] {
+    asyncCopier = new AsyncCopier(asyncCopierThreads);
+  });
+  return addr_to_java(asyncCopier->submit(addr_from_java(destination),
+    addr_from_java(source), (size_t)size));
+}
+
+JNIEXPORT jboolean JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_isCopyDone
+  (JNIEnv *env, jclass clazz, jlong handle) {
+  return asyncCopier->isDone((AsyncCopier::Handle*)addr_from_java(handle)) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_waitCopy
+  (JNIEnv *env, jclass clazz, jlong handle) {
+  asyncCopier->wait((AsyncCopier::Handle*)addr_from_java(handle));
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_initializeNativeOnNode
+  (JNIEnv *env, jclass clazz, jstring path, jlong size, jint pattern, jint node) {
+  if (node < 0 || node >= MAX_NUMA_NODES) {
+    jclass exceptionCls = env->FindClass("java/lang/IllegalArgumentException");
+    env->ThrowNew(exceptionCls, "Invalid numa node of persistent memory.");
+    return;
+  }
+  std::lock_guard<std::mutex> lock(nodeKindsMutex);
+  if (NULL != nodeKinds[node]) {
+    return;
+  }
+  memkind *kind = NULL;
+  if (createPmemKind(env, path, size, pattern, &kind)) {
+    jclass exceptionCls = env->FindClass("java/lang/Exception");
+    env->ThrowNew(exceptionCls,
+      "Persistent initialize failed! Please check the path permission.");
+    return;
+  }
+  nodeKinds[node] = kind;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getCurrentNode
+  (JNIEnv *env, jclass clazz) {
+  return currentNode();
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_allocateVolatileMemoryOnNode
+  (JNIEnv *env, jclass clazz, jlong size, jint node) {
+  memkind *kind = checkNode(env, node);
+  if (NULL == kind) {
+    return 0;
+  }
+
+  size_t sz = (size_t)size;
+  void *p = memkind_malloc(kind, sz);
+  countAllocation(p, p == NULL ? 0 : memkind_malloc_usable_size(kind, p));
+  if (p == NULL) {
+    jclass errorCls = env->FindClass("java/lang/OutOfMemoryError");
+    std::string errorMsg;
+    errorMsg.append("Don't have enough memory, please consider decrease the persistent ");
+    errorMsg.append("memory usable ratio. The requested size: ");
+    errorMsg.append(std::to_string(sz));
+    env->ThrowNew(errorCls, errorMsg.c_str());
+  }
+
+  return addr_to_java(p);
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getOccupiedSizeOnNode
+  (JNIEnv *env, jclass clazz, jlong address, jint node) {
+  memkind *kind = checkNode(env, node);
+  if (NULL == kind) {
+    return 0;
+  }
+  return memkind_malloc_usable_size(kind, addr_from_java(address));
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_freeMemoryOnNode
+  (JNIEnv *env, jclass clazz, jlong address, jint node) {
+  memkind *kind = checkNode(env, node);
+  if (NULL == kind) {
+    return;
+  }
+  void *p = addr_from_java(address);
+  countFree(memkind_malloc_usable_size(kind, p));
+  memkind_free(kind, p);
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getStatsNative
+  (JNIEnv *env, jclass clazz) {
+  // the layout is the one of PersistentMemoryStats
+  int64_t slabOccupied = 0;
+  int64_t slabResident = 0;
+  if (NULL != slabAllocator) {
+    for (int i = 0; i < SlabAllocator::NUM_CLASSES; i++) {
+      slabOccupied += slabAllocator->inUse(i) * SlabAllocator::classSize(i);
+    }
+    slabResident = slabAllocator->residentBytes();
+  }
+  int64_t memkindBytes = platformStats.memkindBytes;
+  jlong stats[] = {
+    memkindBytes + slabOccupied,
+    memkindBytes + slabResident,
+    platformStats.allocations,
+    platformStats.frees,
+    platformStats.failedAllocations
+  };
+  jsize length = sizeof(stats) / sizeof(stats[0]);
+  jlongArray res = env->NewLongArray(length);
+  env->SetLongArrayRegion(res, 0, length, stats);
+  return res;
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getSlabClassStatsNative
+  (JNIEnv *env, jclass clazz) {
+  // size and objects in use of each size class
+  std::vector<jlong> stats(SlabAllocator::NUM_CLASSES * 2, 0);
+  for (int i = 0; i < SlabAllocator::NUM_CLASSES; i++) {
+    stats[i * 2] = SlabAllocator::classSize(i);
+    stats[i * 2 + 1] = NULL == slabAllocator ? 0 : slabAllocator->inUse(i);
+  }
+  jlongArray res = env->NewLongArray(stats.size());
+  env->SetLongArrayRegion(res, 0, stats.size(), stats.data());
+  return res;
+}
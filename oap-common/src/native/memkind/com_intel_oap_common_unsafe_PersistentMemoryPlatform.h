@@ -81,6 +81,134 @@ JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform
 JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_copyMemory
   (JNIEnv *, jclass, jlong, jlong, jlong);
 
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    allocateSlabMemory
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_allocateSlabMemory
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    getSlabOccupiedSize
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getSlabOccupiedSize
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    freeSlabMemory
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_freeSlabMemory
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    freeSlabMemoryBatch
+ * Signature: ([J)V
+ */
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_freeSlabMemoryBatch
+  (JNIEnv *, jclass, jlongArray);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    copyMemoryNonTemporal
+ * Signature: (JJJ)V
+ */
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_copyMemoryNonTemporal
+  (JNIEnv *, jclass, jlong, jlong, jlong);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    initializeCopyThreads
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_initializeCopyThreads
+  (JNIEnv *, jclass, jint);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    copyMemoryAsync
+ * Signature: (JJJ)J
+ */
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_copyMemoryAsync
+  (JNIEnv *, jclass, jlong, jlong, jlong);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    isCopyDone
+ * Signature: (J)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_isCopyDone
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    waitCopy
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_waitCopy
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    initializeNativeOnNode
+ * Signature: (Ljava/lang/String;JII)V
+ */
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_initializeNativeOnNode
+  (JNIEnv *, jclass, jstring, jlong, jint, jint);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    getCurrentNode
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getCurrentNode
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    allocateVolatileMemoryOnNode
+ * Signature: (JI)J
+ */
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_allocateVolatileMemoryOnNode
+  (JNIEnv *, jclass, jlong, jint);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    getOccupiedSizeOnNode
+ * Signature: (JI)J
+ */
+JNIEXPORT jlong JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getOccupiedSizeOnNode
+  (JNIEnv *, jclass, jlong, jint);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    freeMemoryOnNode
+ * Signature: (JI)V
+ */
+JNIEXPORT void JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_freeMemoryOnNode
+  (JNIEnv *, jclass, jlong, jint);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    getStatsNative
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getStatsNative
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_intel_oap_common_unsafe_PersistentMemoryPlatform
+ * Method:    getSlabClassStatsNative
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_intel_oap_common_unsafe_PersistentMemoryPlatform_getSlabClassStatsNative
+  (JNIEnv *, jclass);
+
 #ifdef __cplusplus
 }
 #endif
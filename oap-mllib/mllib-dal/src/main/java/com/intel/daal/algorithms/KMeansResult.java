@@ -16,7 +16,14 @@
 
 package com.intel.daal.algorithms;
 
-public class KMeansResult {
+import java.io.Serializable;
+
+public class KMeansResult implements Serializable {
     public long cNumericTable;
     public double totalCost;
+    public int iterationNum;
+    // Microseconds spent in each iteration
+    public long[] computeTimes;
+    public long[] communicationTimes;
+    public long[] serializationTimes;
 }
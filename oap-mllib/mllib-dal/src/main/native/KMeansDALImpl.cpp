@@ -21,6 +21,10 @@
 #include "org_apache_spark_ml_clustering_KMeansDALImpl.h"
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
 
 using namespace std;
 using namespace daal;
@@ -28,39 +32,129 @@ using namespace daal::algorithms;
 
 const int ccl_root = 0;
 
-typedef double algorithmFPType; /* Algorithm floating-point type */
+/* Candidates of the initialization by rank, as a multiple of the clusters */
+const size_t init_oversampling = 10;
 
-static NumericTablePtr kmeans_compute(int rankId, const NumericTablePtr & pData, const NumericTablePtr & initialCentroids,
-    size_t nClusters, size_t nBlocks, algorithmFPType &ret_cost)
+typedef double algorithmFPType; /* Algorithm floating-point type, ccl_dtype_double */
+
+/* Times of one iteration in microseconds */
+struct IterationTimes
 {
-    const bool isRoot          = (rankId == ccl_root);
-    size_t CentroidsArchLength = 0;
+    jlong compute       = 0;
+    jlong communication = 0;
+    jlong serialization = 0;
+};
+
+/* Adds the microseconds elapsed since the previous lap to a counter */
+class Stopwatch
+{
+public:
+    Stopwatch() : last(std::chrono::high_resolution_clock::now()) {}
+
+    void lap(jlong &counter)
+    {
+        auto now = std::chrono::high_resolution_clock::now();
+        counter += std::chrono::duration_cast<std::chrono::microseconds>(now - last).count();
+        last = now;
+    }
+
+private:
+    std::chrono::high_resolution_clock::time_point last;
+};
+
+/* Broadcast with the centroids, the shift of the centroids in the last iteration */
+struct CentroidsHeader
+{
+    size_t archLength;
+    algorithmFPType shift;
+};
+
+/*
+ * Broadcast the centroids of the root and how far they moved in the last iteration, return
+ * the centroids on all the ranks. Once the shift is within tolerance, the centroids are not
+ * sent and an empty table is returned.
+ */
+static NumericTablePtr bcast_centroids(int rankId, const NumericTablePtr & rootCentroids,
+    algorithmFPType tolerance, algorithmFPType &shift, IterationTimes &times)
+{
+    const bool isRoot = (rankId == ccl_root);
+    Stopwatch stopwatch;
+    CentroidsHeader header = {0, shift};
     InputDataArchive inputArch;
     if (isRoot)
     {
         /*Retrieve the algorithm results and serialize them */
-        initialCentroids->serialize(inputArch);
-        CentroidsArchLength = inputArch.getSizeOfArchive();
+        rootCentroids->serialize(inputArch);
+        header.archLength = inputArch.getSizeOfArchive();
     }
+    stopwatch.lap(times.serialization);
 
     ccl_request_t request;
 
     /* Get partial results from the root node */
-    ccl_bcast(&CentroidsArchLength, sizeof(size_t), ccl_dtype_char, ccl_root, NULL, NULL, NULL, &request);
+    ccl_bcast(&header, sizeof(header), ccl_dtype_char, ccl_root, NULL, NULL, NULL, &request);
     ccl_wait(request);
+    stopwatch.lap(times.communication);
 
-    ByteBuffer nodeCentroids(CentroidsArchLength);
-    if (isRoot) inputArch.copyArchiveToArray(&nodeCentroids[0], CentroidsArchLength);
+    shift = header.shift;
+    if (shift <= tolerance) return NumericTablePtr();
 
-    ccl_bcast(&nodeCentroids[0], CentroidsArchLength, ccl_dtype_char, ccl_root, NULL, NULL, NULL, &request);
+    ByteBuffer nodeCentroids(header.archLength);
+    if (isRoot) inputArch.copyArchiveToArray(&nodeCentroids[0], header.archLength);
+    stopwatch.lap(times.serialization);
+
+    ccl_bcast(&nodeCentroids[0], header.archLength, ccl_dtype_char, ccl_root, NULL, NULL, NULL, &request);
     ccl_wait(request);
+    stopwatch.lap(times.communication);
 
     /* Deserialize centroids data */
-    OutputDataArchive outArch(nodeCentroids.size() ? &nodeCentroids[0] : NULL, CentroidsArchLength);
+    OutputDataArchive outArch(nodeCentroids.size() ? &nodeCentroids[0] : NULL, header.archLength);
 
     NumericTablePtr centroids(new HomogenNumericTable<algorithmFPType>());
 
     centroids->deserialize(outArch);
+    stopwatch.lap(times.serialization);
+
+    return centroids;
+}
+
+/* The largest euclidean distance a centroid moved by */
+static algorithmFPType max_shift(const NumericTablePtr & oldCentroids, const NumericTablePtr & newCentroids)
+{
+    size_t nClusters = oldCentroids->getNumberOfRows();
+    size_t nFeatures = oldCentroids->getNumberOfColumns();
+
+    BlockDescriptor<algorithmFPType> oldBlock;
+    BlockDescriptor<algorithmFPType> newBlock;
+    oldCentroids->getBlockOfRows(0, nClusters, readOnly, oldBlock);
+    newCentroids->getBlockOfRows(0, nClusters, readOnly, newBlock);
+    algorithmFPType *oldPtr = oldBlock.getBlockPtr();
+    algorithmFPType *newPtr = newBlock.getBlockPtr();
+
+    algorithmFPType maxSquared = 0;
+    for (size_t k = 0; k < nClusters; k++)
+    {
+        algorithmFPType squared = 0;
+        for (size_t j = 0; j < nFeatures; j++)
+        {
+            algorithmFPType d = newPtr[k * nFeatures + j] - oldPtr[k * nFeatures + j];
+            squared += d * d;
+        }
+        maxSquared = std::max(maxSquared, squared);
+    }
+    newCentroids->releaseBlockOfRows(newBlock);
+    oldCentroids->releaseBlockOfRows(oldBlock);
+
+    return std::sqrt(maxSquared);
+}
+
+static NumericTablePtr kmeans_compute(int rankId, const NumericTablePtr & pData, const NumericTablePtr & centroids,
+    size_t nClusters, size_t nBlocks, algorithmFPType &ret_cost, IterationTimes &times)
+{
+    const bool isRoot          = (rankId == ccl_root);
+    Stopwatch stopwatch;
+
+    ccl_request_t request;
 
     /* Create an algorithm to compute k-means on local nodes */
     kmeans::Distributed<step1Local, algorithmFPType> localAlgorithm(nClusters);
@@ -71,6 +165,7 @@ static NumericTablePtr kmeans_compute(int rankId, const NumericTablePtr & pData,
 
     /* Compute k-means */
     localAlgorithm.compute();
+    stopwatch.lap(times.compute);
 
     /* Serialize partial results required by step 2 */
     InputDataArchive dataArch;
@@ -88,10 +183,12 @@ static NumericTablePtr kmeans_compute(int rankId, const NumericTablePtr & pData,
 
     ByteBuffer nodeResults(perNodeArchLength);
     dataArch.copyArchiveToArray(&nodeResults[0], perNodeArchLength);
+    stopwatch.lap(times.serialization);
 
     /* Transfer partial results to step 2 on the root node */
     ccl_allgatherv(&nodeResults[0], perNodeArchLength, &serializedData[0], recvCounts, ccl_dtype_char, NULL, NULL, NULL, &request);
     ccl_wait(request);
+    stopwatch.lap(times.communication);
 
     delete [] recvCounts;
 
@@ -111,10 +208,12 @@ static NumericTablePtr kmeans_compute(int rankId, const NumericTablePtr & pData,
             /* Set local partial results as input for the master-node algorithm */
             masterAlgorithm.input.add(kmeans::partialResults, dataForStep2FromStep1);
         }
+        stopwatch.lap(times.serialization);
 
         /* Merge and finalizeCompute k-means on the master node */
         masterAlgorithm.compute();
         masterAlgorithm.finalizeCompute();
+        stopwatch.lap(times.compute);
 
         ret_cost = masterAlgorithm.getResult()->get(kmeans::objectiveFunction)->getValue<algorithmFPType>(0, 0);
 
@@ -124,16 +223,233 @@ static NumericTablePtr kmeans_compute(int rankId, const NumericTablePtr & pData,
     return NumericTablePtr();
 }
 
+/*
+ * Same iteration as kmeans_compute, except that the partial sums, the counts and the cost
+ * of all the ranks are summed by one allreduce, from which every rank computes the new
+ * centroids by itself. There is no serialization and no broadcast, and the root doesn't
+ * merge the partial results of all the ranks. The centroids of the empty clusters are left
+ * where they are.
+ *
+ * With clusterCounts, pData is a mini-batch and each centroid moves toward the mean of its
+ * points in the batch with the rate 1 / points seen so far, counted in clusterCounts.
+ */
+static NumericTablePtr kmeans_compute_allreduce(const NumericTablePtr & pData, const NumericTablePtr & centroids,
+    size_t nClusters, algorithmFPType &ret_cost, IterationTimes &times,
+    std::vector<algorithmFPType> *clusterCounts = NULL)
+{
+    Stopwatch stopwatch;
+
+    /* Create an algorithm to compute k-means on local nodes */
+    kmeans::Distributed<step1Local, algorithmFPType> localAlgorithm(nClusters);
+
+    /* Set the input data set to the algorithm */
+    localAlgorithm.input.set(kmeans::data, pData);
+    localAlgorithm.input.set(kmeans::inputCentroids, centroids);
+
+    /* Compute k-means */
+    localAlgorithm.compute();
+
+    kmeans::PartialResultPtr partialResult = localAlgorithm.getPartialResult();
+    NumericTablePtr partialSums = partialResult->get(kmeans::partialSums);
+    NumericTablePtr nObservations = partialResult->get(kmeans::nObservations);
+    NumericTablePtr partialObjective = partialResult->get(kmeans::partialObjectiveFunction);
+
+    size_t nFeatures = centroids->getNumberOfColumns();
+
+    /* The sums, the counts and the cost in one buffer, reduced at once */
+    size_t sumsLength = nClusters * nFeatures;
+    std::vector<algorithmFPType> partials(sumsLength + nClusters + 1);
+    std::vector<algorithmFPType> totals(partials.size());
+
+    BlockDescriptor<algorithmFPType> block;
+    partialSums->getBlockOfRows(0, nClusters, readOnly, block);
+    std::copy(block.getBlockPtr(), block.getBlockPtr() + sumsLength, partials.begin());
+    partialSums->releaseBlockOfRows(block);
+
+    nObservations->getBlockOfRows(0, nClusters, readOnly, block);
+    std::copy(block.getBlockPtr(), block.getBlockPtr() + nClusters, partials.begin() + sumsLength);
+    nObservations->releaseBlockOfRows(block);
+
+    partials[sumsLength + nClusters] = partialObjective->getValue<algorithmFPType>(0, 0);
+    stopwatch.lap(times.compute);
+
+    ccl_request_t request;
+
+    ccl_allreduce(&partials[0], &totals[0], partials.size(), ccl_dtype_double, ccl_reduction_sum,
+                  NULL, NULL, NULL, &request);
+    ccl_wait(request);
+    stopwatch.lap(times.communication);
+
+    NumericTablePtr newCentroids(new HomogenNumericTable<algorithmFPType>(nFeatures, nClusters, NumericTable::doAllocate));
+
+    BlockDescriptor<algorithmFPType> oldBlock;
+    centroids->getBlockOfRows(0, nClusters, readOnly, oldBlock);
+    newCentroids->getBlockOfRows(0, nClusters, writeOnly, block);
+    algorithmFPType *oldPtr = oldBlock.getBlockPtr();
+    algorithmFPType *newPtr = block.getBlockPtr();
+    for (size_t k = 0; k < nClusters; k++)
+    {
+        algorithmFPType count = totals[sumsLength + k];
+        algorithmFPType seen  = count;
+        if (clusterCounts)
+        {
+            (*clusterCounts)[k] += count;
+            seen = (*clusterCounts)[k];
+        }
+        for (size_t j = 0; j < nFeatures; j++)
+        {
+            algorithmFPType old = oldPtr[k * nFeatures + j];
+            newPtr[k * nFeatures + j] = seen > 0 ? old + (totals[k * nFeatures + j] - count * old) / seen : old;
+        }
+    }
+    newCentroids->releaseBlockOfRows(block);
+    centroids->releaseBlockOfRows(oldBlock);
+
+    ret_cost = totals[sumsLength + nClusters];
+    stopwatch.lap(times.compute);
+
+    return newCentroids;
+}
+
+/* Rows of pData each picked with probability fraction, at least one, as a new table */
+static NumericTablePtr sample_rows(const NumericTablePtr & pData, double fraction, std::mt19937_64 &rng)
+{
+    size_t nRows     = pData->getNumberOfRows();
+    size_t nFeatures = pData->getNumberOfColumns();
+
+    std::bernoulli_distribution pick(std::min(fraction, 1.0));
+    std::vector<size_t> rows;
+    for (size_t i = 0; i < nRows; i++)
+    {
+        if (pick(rng)) rows.push_back(i);
+    }
+    if (rows.empty()) rows.push_back(std::uniform_int_distribution<size_t>(0, nRows - 1)(rng));
+
+    NumericTablePtr sample(new HomogenNumericTable<algorithmFPType>(nFeatures, rows.size(), NumericTable::doAllocate));
+
+    BlockDescriptor<algorithmFPType> dataBlock;
+    BlockDescriptor<algorithmFPType> sampleBlock;
+    pData->getBlockOfRows(0, nRows, readOnly, dataBlock);
+    sample->getBlockOfRows(0, rows.size(), writeOnly, sampleBlock);
+    algorithmFPType *dataPtr   = dataBlock.getBlockPtr();
+    algorithmFPType *samplePtr = sampleBlock.getBlockPtr();
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        std::copy(dataPtr + rows[i] * nFeatures, dataPtr + (rows[i] + 1) * nFeatures, samplePtr + i * nFeatures);
+    }
+    sample->releaseBlockOfRows(sampleBlock);
+    pData->releaseBlockOfRows(dataBlock);
+
+    return sample;
+}
+
+/*
+ * Initial centroids, returned on all the ranks. Each rank samples its rows so that all the
+ * ranks together get about init_oversampling * nClusters candidates, then the root picks
+ * the initial centroids among all the candidates by k-means++.
+ */
+static NumericTablePtr kmeans_init(int rankId, const NumericTablePtr & pData, size_t nClusters, size_t nBlocks,
+    std::mt19937_64 &rng)
+{
+    const bool isRoot = (rankId == ccl_root);
+    size_t nFeatures  = pData->getNumberOfColumns();
+
+    ccl_request_t request;
+
+    algorithmFPType localRows = pData->getNumberOfRows();
+    algorithmFPType totalRows;
+    ccl_allreduce(&localRows, &totalRows, 1, ccl_dtype_double, ccl_reduction_sum, NULL, NULL, NULL, &request);
+    ccl_wait(request);
+
+    NumericTablePtr candidates = sample_rows(pData, init_oversampling * nClusters / totalRows, rng);
+
+    /* The candidates of the ranks are of different sizes, gather their sizes first */
+    size_t localLength = candidates->getNumberOfRows() * nFeatures * sizeof(algorithmFPType);
+    std::vector<size_t> lengths(nBlocks);
+    std::vector<size_t> lengthCounts(nBlocks, sizeof(size_t));
+    ccl_allgatherv(&localLength, sizeof(size_t), &lengths[0], &lengthCounts[0], ccl_dtype_char, NULL, NULL, NULL, &request);
+    ccl_wait(request);
+
+    size_t totalLength = 0;
+    for (size_t i = 0; i < nBlocks; i++)
+    {
+        totalLength += lengths[i];
+    }
+    ByteBuffer allCandidates(totalLength);
+
+    BlockDescriptor<algorithmFPType> block;
+    candidates->getBlockOfRows(0, candidates->getNumberOfRows(), readOnly, block);
+    ccl_allgatherv(block.getBlockPtr(), localLength, &allCandidates[0], &lengths[0], ccl_dtype_char, NULL, NULL, NULL, &request);
+    ccl_wait(request);
+    candidates->releaseBlockOfRows(block);
+
+    NumericTablePtr centroids;
+    if (isRoot)
+    {
+        size_t nCandidates = totalLength / sizeof(algorithmFPType) / nFeatures;
+        NumericTablePtr candidateTable(new HomogenNumericTable<algorithmFPType>(nFeatures, nCandidates, NumericTable::doAllocate));
+        candidateTable->getBlockOfRows(0, nCandidates, writeOnly, block);
+        memcpy(block.getBlockPtr(), &allCandidates[0], totalLength);
+        candidateTable->releaseBlockOfRows(block);
+
+        /* Create an algorithm to pick the initial centroids among the candidates */
+        kmeans::init::Batch<algorithmFPType, kmeans::init::plusPlusDense> initAlgorithm(nClusters);
+
+        initAlgorithm.input.set(kmeans::init::data, candidateTable);
+
+        initAlgorithm.compute();
+
+        centroids = initAlgorithm.getResult()->get(kmeans::init::centroids);
+    }
+
+    /* All the ranks start from the same centroids */
+    IterationTimes times;
+    algorithmFPType shift = std::numeric_limits<algorithmFPType>::max();
+    return bcast_centroids(rankId, centroids, -1, shift, times);
+}
+
+/*
+ * Class:     org_apache_spark_ml_clustering_KMeansDALImpl
+ * Method:    cKMeansDALInit
+ * Signature: (JIJII)J
+ */
+JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_clustering_KMeansDALImpl_cKMeansDALInit
+  (JNIEnv *env, jobject obj,
+  jlong pNumTabData, jint cluster_num, jlong seed, jint executor_num, jint executor_cores) {
+
+  size_t rankId;
+  ccl_get_comm_rank(NULL, &rankId);
+
+  NumericTablePtr pData = *((NumericTablePtr *)pNumTabData);
+
+  // Set number of threads for oneDAL to use for each rank
+  services::Environment::getInstance()->setNumberOfThreads(executor_cores);
+
+  std::mt19937_64 rng(seed + rankId);
+
+  NumericTablePtr *ret = new NumericTablePtr(kmeans_init(rankId, pData, cluster_num, executor_num, rng));
+  return (jlong)ret;
+}
+
+/* Set the long array field of name of obj to values */
+static void set_long_array_field(JNIEnv *env, jobject obj, jclass clazz, const char *name,
+    const std::vector<jlong> &values)
+{
+    jlongArray array = env->NewLongArray(values.size());
+    env->SetLongArrayRegion(array, 0, values.size(), values.data());
+    env->SetObjectField(obj, env->GetFieldID(clazz, name, "[J"), array);
+}
+
 /*
  * Class:     org_apache_spark_ml_clustering_KMeansDALImpl
  * Method:    cKMeansDALComputeWithInitCenters
- * Signature: (JJIIIILcom/intel/daal/algorithms/KMeansResult;)J
+ * Signature: (JJIIDIIZDJLcom/intel/daal/algorithms/KMeansResult;)J
  */
 JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_clustering_KMeansDALImpl_cKMeansDALComputeWithInitCenters
   (JNIEnv *env, jobject obj,
   jlong pNumTabData, jlong pNumTabCenters, jint cluster_num, jint iteration_num,
-  jint executor_num, jint executor_cores,
-  jobject resultObj) {
+  jdouble tolerance, jint executor_num, jint executor_cores, jboolean use_allreduce,
+  jdouble mini_batch_fraction, jlong seed, jobject resultObj) {
 
   size_t rankId;
   ccl_get_comm_rank(NULL, &rankId);
@@ -148,13 +464,37 @@ JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_clustering_KMeansDALImpl_cKMean
   cout << "oneDAL (native): Number of threads used: " << nThreadsNew << endl;
 
   algorithmFPType totalCost;
+  // Shift of the centroids in the last iteration, known by the root or, with allreduce, by all the ranks
+  algorithmFPType shift = std::numeric_limits<algorithmFPType>::max();
+  std::vector<IterationTimes> iterationTimes;
+
+  // A mini-batch iteration is reduced as with allreduce, so all the ranks hold the centroids
+  bool miniBatch = mini_batch_fraction < 1.0;
+  std::vector<algorithmFPType> clusterCounts(cluster_num, 0);
+  std::mt19937_64 rng(seed + rankId);
 
   for (size_t it = 0; it < (size_t)iteration_num; it++) {
-    auto t1 = std::chrono::high_resolution_clock::now();
-    centroids = kmeans_compute(rankId, pData, centroids, cluster_num, executor_num, totalCost);
-    auto t2 = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::seconds>( t2 - t1 ).count();
-    std::cout << "KMeans (native): iteration " << it << " took " << duration << " secs" << std::endl;
+    IterationTimes times;
+    NumericTablePtr newCentroids;
+    if (miniBatch) {
+      if (shift <= tolerance) break;
+      Stopwatch stopwatch;
+      NumericTablePtr batch = sample_rows(pData, mini_batch_fraction, rng);
+      stopwatch.lap(times.compute);
+      newCentroids = kmeans_compute_allreduce(batch, centroids, cluster_num, totalCost, times, &clusterCounts);
+      shift = max_shift(centroids, newCentroids);
+    } else if (use_allreduce) {
+      if (shift <= tolerance) break;
+      newCentroids = kmeans_compute_allreduce(pData, centroids, cluster_num, totalCost, times);
+      shift = max_shift(centroids, newCentroids);
+    } else {
+      NumericTablePtr nodeCentroids = bcast_centroids(rankId, centroids, tolerance, shift, times);
+      if (shift <= tolerance) break;
+      newCentroids = kmeans_compute(rankId, pData, nodeCentroids, cluster_num, executor_num, totalCost, times);
+      if (rankId == ccl_root) shift = max_shift(nodeCentroids, newCentroids);
+    }
+    centroids = newCentroids;
+    iterationTimes.push_back(times);
   }
 
   if (rankId == ccl_root) {
@@ -162,12 +502,24 @@ JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_clustering_KMeansDALImpl_cKMean
     jclass clazz = env->GetObjectClass(resultObj);
     // Get Field references
     jfieldID totalCostField = env->GetFieldID(clazz, "totalCost", "D");
+    jfieldID iterationNumField = env->GetFieldID(clazz, "iterationNum", "I");
 
-    // Set cost for result
-    env->SetDoubleField(resultObj, totalCostField, totalCost);   
+    // Set cost and iterations for result
+    env->SetDoubleField(resultObj, totalCostField, totalCost);
+    env->SetIntField(resultObj, iterationNumField, iterationTimes.size());
+
+    std::vector<jlong> computeTimes, communicationTimes, serializationTimes;
+    for (auto &times : iterationTimes) {
+      computeTimes.push_back(times.compute);
+      communicationTimes.push_back(times.communication);
+      serializationTimes.push_back(times.serialization);
+    }
+    set_long_array_field(env, resultObj, clazz, "computeTimes", computeTimes);
+    set_long_array_field(env, resultObj, clazz, "communicationTimes", communicationTimes);
+    set_long_array_field(env, resultObj, clazz, "serializationTimes", serializationTimes);
 
     NumericTablePtr *ret = new NumericTablePtr(centroids);
     return (jlong)ret;
   } else
     return (jlong)0;
-}
\ No newline at end of file
+}
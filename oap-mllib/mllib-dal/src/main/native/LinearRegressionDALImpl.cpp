@@ -0,0 +1,140 @@
+/*******************************************************************************
+* Copyright 2020 Intel Corporation
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <ccl.h>
+#include <daal.h>
+
+#include "service.h"
+#include "org_apache_spark_ml_regression_LinearRegressionDALImpl.h"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+using namespace daal;
+using namespace daal::algorithms;
+using namespace daal::algorithms::linear_regression;
+
+const int ccl_root = 0;
+
+typedef double algorithmFPType; /* Algorithm floating-point type, ccl_dtype_double */
+
+/* Copy the values of table into dest, return the number of values */
+static size_t copy_table(const NumericTablePtr & table, algorithmFPType *dest)
+{
+    size_t nRows = table->getNumberOfRows();
+    size_t nCols = table->getNumberOfColumns();
+    BlockDescriptor<algorithmFPType> block;
+    table->getBlockOfRows(0, nRows, readOnly, block);
+    std::copy(block.getBlockPtr(), block.getBlockPtr() + nRows * nCols, dest);
+    table->releaseBlockOfRows(block);
+    return nRows * nCols;
+}
+
+/* Copy the values of src into table, return the number of values */
+static size_t copy_to_table(const algorithmFPType *src, const NumericTablePtr & table)
+{
+    size_t nRows = table->getNumberOfRows();
+    size_t nCols = table->getNumberOfColumns();
+    BlockDescriptor<algorithmFPType> block;
+    table->getBlockOfRows(0, nRows, writeOnly, block);
+    std::copy(src, src + nRows * nCols, block.getBlockPtr());
+    table->releaseBlockOfRows(block);
+    return nRows * nCols;
+}
+
+/*
+ * Class:     org_apache_spark_ml_regression_LinearRegressionDALImpl
+ * Method:    cLinearRegressionDALCompute
+ * Signature: (JJIIZ)J
+ */
+JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_regression_LinearRegressionDALImpl_cLinearRegressionDALCompute
+  (JNIEnv *env, jobject obj,
+  jlong pNumTabData, jlong pNumTabLabel, jint executor_num, jint executor_cores,
+  jboolean fit_intercept) {
+
+  size_t rankId;
+  ccl_get_comm_rank(NULL, &rankId);
+
+  NumericTablePtr pData = *((NumericTablePtr *)pNumTabData);
+  NumericTablePtr pLabel = *((NumericTablePtr *)pNumTabLabel);
+
+  // Set number of threads for oneDAL to use for each rank
+  services::Environment::getInstance()->setNumberOfThreads(executor_cores);
+
+  int nThreadsNew = services::Environment::getInstance()->getNumberOfThreads();
+  cout << "oneDAL (native): Number of threads used: " << nThreadsNew << endl;
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+
+  /* Create an algorithm to compute the normal equations on local nodes */
+  training::Distributed<step1Local, algorithmFPType, training::normEqDense> localAlgorithm;
+  localAlgorithm.parameter.interceptFlag = fit_intercept;
+
+  /* Set the input data set to the algorithm */
+  localAlgorithm.input.set(training::data, pData);
+  localAlgorithm.input.set(training::dependentVariables, pLabel);
+
+  /* Compute X^T * X and X^T * y of the local data */
+  localAlgorithm.compute();
+
+  training::PartialResultPtr partialResult = localAlgorithm.getPartialResult();
+  ModelNormEqPtr partialModel = services::staticPointerCast<ModelNormEq, Model>(
+      partialResult->get(training::partialModel));
+  NumericTablePtr xtx = partialModel->getXTXTable();
+  NumericTablePtr xty = partialModel->getXTYTable();
+
+  /* Both are plain sums over the rows, reduce them at once */
+  std::vector<algorithmFPType> partials(
+      xtx->getNumberOfRows() * xtx->getNumberOfColumns() +
+      xty->getNumberOfRows() * xty->getNumberOfColumns());
+  std::vector<algorithmFPType> totals(partials.size());
+
+  size_t xtxLength = copy_table(xtx, &partials[0]);
+  copy_table(xty, &partials[xtxLength]);
+
+  ccl_request_t request;
+
+  ccl_allreduce(&partials[0], &totals[0], partials.size(), ccl_dtype_double, ccl_reduction_sum,
+                NULL, NULL, NULL, &request);
+  ccl_wait(request);
+
+  auto t2 = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::seconds>( t2 - t1 ).count();
+  std::cout << "LinearRegression (native): training took " << duration << " secs" << std::endl;
+
+  if (rankId == ccl_root) {
+    /* The partial model of the root now holds the sums of all the ranks */
+    copy_to_table(&totals[0], xtx);
+    copy_to_table(&totals[xtxLength], xty);
+
+    /* Create an algorithm to solve the normal equations on the master node */
+    training::Distributed<step2Master, algorithmFPType, training::normEqDense> masterAlgorithm;
+    masterAlgorithm.parameter.interceptFlag = fit_intercept;
+
+    masterAlgorithm.input.add(training::partialModels, partialResult);
+
+    /* Merge and finalizeCompute linear regression on the master node */
+    masterAlgorithm.compute();
+    masterAlgorithm.finalizeCompute();
+
+    /* Retrieve the coefficients, the intercept first */
+    NumericTablePtr beta = masterAlgorithm.getResult()->get(training::model)->getBeta();
+
+    NumericTablePtr *ret = new NumericTablePtr(beta);
+    return (jlong)ret;
+  } else
+    return (jlong)0;
+}
@@ -1,26 +1,71 @@
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <stdlib.h>
 #include <ccl.h>
 #include "org_apache_spark_ml_util_OneCCL__.h"
 
+/*
+ * The CCL environment of the executor, initialized by the first c_init and kept
+ * across the training calls until c_cleanup, so that the next calls with the same
+ * KVS address and world size skip the rendezvous of the ranks.
+ */
+struct CCLContext {
+  bool initialized = false;
+  std::string kvs_ip_port;
+  std::string world_size;
+  size_t comm_size = 0;
+  size_t rank_id = 0;
+};
+
+static CCLContext ccl_context;
+static std::mutex ccl_mutex;
+
+static std::string get_env(const char *name) {
+  const char *value = getenv(name);
+  return value == NULL ? "" : value;
+}
+
 JNIEXPORT jint JNICALL Java_org_apache_spark_ml_util_OneCCL_00024_c_1init
   (JNIEnv *env, jobject obj, jobject param) {
-  
-  std::cout << "oneCCL (native): init" << std::endl;
 
-  ccl_init();
+  std::lock_guard<std::mutex> lock(ccl_mutex);
+
+  std::string kvs_ip_port = get_env("CCL_KVS_IP_PORT");
+  std::string world_size = get_env("CCL_WORLD_SIZE");
+
+  if (ccl_context.initialized && ccl_context.kvs_ip_port == kvs_ip_port &&
+      ccl_context.world_size == world_size) {
+    std::cout << "oneCCL (native): reuse rank " << ccl_context.rank_id << " of "
+              << ccl_context.comm_size << std::endl;
+  } else {
+    // another job with other ranks, the environment of the last one is released first
+    if (ccl_context.initialized) {
+      std::cout << "oneCCL (native): cleanup for KVS " << kvs_ip_port << std::endl;
+      ccl_finalize();
+      ccl_context.initialized = false;
+    }
+
+    std::cout << "oneCCL (native): init" << std::endl;
+
+    if (ccl_init() != ccl_status_success) {
+      std::cerr << "oneCCL (native): init failed" << std::endl;
+      return 0;
+    }
+
+    ccl_get_comm_size(NULL, &ccl_context.comm_size);
+    ccl_get_comm_rank(NULL, &ccl_context.rank_id);
+    ccl_context.kvs_ip_port = kvs_ip_port;
+    ccl_context.world_size = world_size;
+    ccl_context.initialized = true;
+  }
 
   jclass cls = env->GetObjectClass(param);
   jfieldID fid_comm_size = env->GetFieldID(cls, "commSize", "J");
   jfieldID fid_rank_id = env->GetFieldID(cls, "rankId", "J");
 
-  size_t comm_size;
-  size_t rank_id;
-
-  ccl_get_comm_size(NULL, &comm_size);
-  ccl_get_comm_rank(NULL, &rank_id);
-
-  env->SetLongField(param, fid_comm_size, comm_size);
-  env->SetLongField(param, fid_rank_id, rank_id);    
+  env->SetLongField(param, fid_comm_size, ccl_context.comm_size);
+  env->SetLongField(param, fid_rank_id, ccl_context.rank_id);
 
   return 1;
 }
@@ -33,9 +78,16 @@ JNIEXPORT jint JNICALL Java_org_apache_spark_ml_util_OneCCL_00024_c_1init
 JNIEXPORT void JNICALL Java_org_apache_spark_ml_util_OneCCL_00024_c_1cleanup
   (JNIEnv *env, jobject obj) {
 
+  std::lock_guard<std::mutex> lock(ccl_mutex);
+
+  if (!ccl_context.initialized) {
+    return;
+  }
+
   std::cout << "oneCCL (native): cleanup" << std::endl;
 
   ccl_finalize();
+  ccl_context.initialized = false;
 }
 
 /*
@@ -33,3 +33,54 @@ JNIEXPORT void JNICALL Java_org_apache_spark_ml_util_OneDAL_00024_setNumericTabl
 
 }
 
+/*
+ * Class:     org_apache_spark_ml_util_OneDAL__
+ * Method:    cSetNumericTableRows
+ * Signature: (JJ[DI)V
+ */
+JNIEXPORT void JNICALL Java_org_apache_spark_ml_util_OneDAL_00024_cSetNumericTableRows
+  (JNIEnv *env, jobject, jlong numTableAddr, jlong rowOffset, jdoubleArray values, jint numRows) {
+
+  HomogenNumericTable<double> * nt = static_cast<HomogenNumericTable<double> *>(((SerializationIfacePtr *)numTableAddr)->get());
+  size_t numCols = nt->getNumberOfColumns();
+
+  // The rows are laid out row major as in the table, copy them at once
+  env->GetDoubleArrayRegion(values, 0, numRows * numCols, nt->getArray() + rowOffset * numCols);
+
+}
+
+/*
+ * Class:     org_apache_spark_ml_util_OneDAL__
+ * Method:    cNewSOANumericTable
+ * Signature: ([JJ)J
+ */
+JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_util_OneDAL_00024_cNewSOANumericTable
+  (JNIEnv *env, jobject, jlongArray columnAddrs, jlong numRows) {
+
+  size_t numCols = env->GetArrayLength(columnAddrs);
+  jlong *addrs = env->GetLongArrayElements(columnAddrs, NULL);
+
+  // Each column is a buffer of numRows doubles owned by the caller, e.g. the values buffer
+  // of an Arrow column without nulls, used in place without copy
+  SOANumericTablePtr nt = SOANumericTable::create(numCols, numRows, DictionaryIface::equal);
+  for (size_t i = 0; i < numCols; i++) {
+    nt->setArray<double>(services::SharedPtr<double>((double *)addrs[i], services::EmptyDeleter()), i);
+  }
+
+  env->ReleaseLongArrayElements(columnAddrs, addrs, JNI_ABORT);
+
+  NumericTablePtr *ret = new NumericTablePtr(nt);
+  return (jlong)ret;
+}
+
+/*
+ * Class:     org_apache_spark_ml_util_OneDAL__
+ * Method:    cFreeNumericTable
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_org_apache_spark_ml_util_OneDAL_00024_cFreeNumericTable
+  (JNIEnv *, jobject, jlong numTableAddr) {
+
+  delete (NumericTablePtr *)numTableAddr;
+
+}
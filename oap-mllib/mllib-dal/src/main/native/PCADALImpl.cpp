@@ -0,0 +1,134 @@
+/*******************************************************************************
+* Copyright 2020 Intel Corporation
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <ccl.h>
+#include <daal.h>
+
+#include "service.h"
+#include "org_apache_spark_ml_feature_PCADALImpl.h"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+using namespace daal;
+using namespace daal::algorithms;
+
+const int ccl_root = 0;
+
+typedef double algorithmFPType; /* Algorithm floating-point type, ccl_dtype_double */
+
+/*
+ * Class:     org_apache_spark_ml_feature_PCADALImpl
+ * Method:    cPCADALComputeCovariance
+ * Signature: (JII)J
+ */
+JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_feature_PCADALImpl_cPCADALComputeCovariance
+  (JNIEnv *env, jobject obj,
+  jlong pNumTabData, jint executor_num, jint executor_cores) {
+
+  size_t rankId;
+  ccl_get_comm_rank(NULL, &rankId);
+
+  NumericTablePtr pData = *((NumericTablePtr *)pNumTabData);
+
+  // Set number of threads for oneDAL to use for each rank
+  services::Environment::getInstance()->setNumberOfThreads(executor_cores);
+
+  int nThreadsNew = services::Environment::getInstance()->getNumberOfThreads();
+  cout << "oneDAL (native): Number of threads used: " << nThreadsNew << endl;
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+
+  /* Create an algorithm to compute the cross-product on local nodes */
+  covariance::Distributed<step1Local, algorithmFPType> localAlgorithm;
+
+  /* Set the input data set to the algorithm */
+  localAlgorithm.input.set(covariance::data, pData);
+
+  /* Compute the partial cross-product */
+  localAlgorithm.compute();
+
+  covariance::PartialResultPtr partialResult = localAlgorithm.getPartialResult();
+  NumericTablePtr nObservations = partialResult->get(covariance::nObservations);
+  NumericTablePtr crossProduct = partialResult->get(covariance::crossProduct);
+  NumericTablePtr sum = partialResult->get(covariance::sum);
+
+  size_t nFeatures = pData->getNumberOfColumns();
+
+  /*
+   * The local cross-product is centered on the local mean, which differs from rank to
+   * rank. Turn it back to the raw one, sum(x * x^T) = crossProduct + sum * sum^T / n,
+   * which sums over ranks, then reduce the count, the sums and the raw cross-product at once.
+   */
+  size_t sumsOffset = 1;
+  size_t rawOffset = sumsOffset + nFeatures;
+  std::vector<algorithmFPType> partials(rawOffset + nFeatures * nFeatures);
+  std::vector<algorithmFPType> totals(partials.size());
+
+  algorithmFPType n = nObservations->getValue<algorithmFPType>(0, 0);
+  partials[0] = n;
+
+  BlockDescriptor<algorithmFPType> sumBlock;
+  sum->getBlockOfRows(0, 1, readOnly, sumBlock);
+  algorithmFPType *s = sumBlock.getBlockPtr();
+  std::copy(s, s + nFeatures, partials.begin() + sumsOffset);
+
+  BlockDescriptor<algorithmFPType> crossProductBlock;
+  crossProduct->getBlockOfRows(0, nFeatures, readOnly, crossProductBlock);
+  algorithmFPType *cp = crossProductBlock.getBlockPtr();
+  for (size_t i = 0; i < nFeatures; i++)
+  {
+      for (size_t j = 0; j < nFeatures; j++)
+      {
+          partials[rawOffset + i * nFeatures + j] = cp[i * nFeatures + j] + (n > 0 ? s[i] * s[j] / n : 0);
+      }
+  }
+  crossProduct->releaseBlockOfRows(crossProductBlock);
+  sum->releaseBlockOfRows(sumBlock);
+
+  ccl_request_t request;
+
+  ccl_allreduce(&partials[0], &totals[0], partials.size(), ccl_dtype_double, ccl_reduction_sum,
+                NULL, NULL, NULL, &request);
+  ccl_wait(request);
+
+  auto t2 = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::seconds>( t2 - t1 ).count();
+  std::cout << "PCA (native): covariance took " << duration << " secs" << std::endl;
+
+  if (rankId == ccl_root) {
+    /* The sample covariance, as the one of Spark */
+    algorithmFPType total = totals[0];
+    algorithmFPType *totalSums = &totals[sumsOffset];
+
+    NumericTablePtr covariance(new HomogenNumericTable<algorithmFPType>(nFeatures, nFeatures, NumericTable::doAllocate));
+    BlockDescriptor<algorithmFPType> block;
+    covariance->getBlockOfRows(0, nFeatures, writeOnly, block);
+    algorithmFPType *cov = block.getBlockPtr();
+    for (size_t i = 0; i < nFeatures; i++)
+    {
+        for (size_t j = 0; j < nFeatures; j++)
+        {
+            cov[i * nFeatures + j] = (totals[rawOffset + i * nFeatures + j] - totalSums[i] * totalSums[j] / total) / (total - 1);
+        }
+    }
+    covariance->releaseBlockOfRows(block);
+
+    NumericTablePtr *ret = new NumericTablePtr(covariance);
+    return (jlong)ret;
+  } else
+    return (jlong)0;
+}
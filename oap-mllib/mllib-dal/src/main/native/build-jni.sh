@@ -17,4 +17,6 @@ fi
 javah -d $WORK_DIR/javah -classpath "$WORK_DIR/../../../target/classes:$DAAL_JAR:$SPARK_HOME/jars/*" -force \
     org.apache.spark.ml.util.OneCCL$ \
     org.apache.spark.ml.util.OneDAL$ \
-    org.apache.spark.ml.clustering.KMeansDALImpl
+    org.apache.spark.ml.clustering.KMeansDALImpl \
+    org.apache.spark.ml.feature.PCADALImpl \
+    org.apache.spark.ml.regression.LinearRegressionDALImpl
@@ -10,10 +10,18 @@ extern "C" {
 /*
  * Class:     org_apache_spark_ml_clustering_KMeansDALImpl
  * Method:    cKMeansDALComputeWithInitCenters
- * Signature: (JJIIIILcom/intel/daal/algorithms/KMeansResult;)J
+ * Signature: (JJIIDIIZDJLcom/intel/daal/algorithms/KMeansResult;)J
  */
 JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_clustering_KMeansDALImpl_cKMeansDALComputeWithInitCenters
-  (JNIEnv *, jobject, jlong, jlong, jint, jint, jint, jint, jobject);
+  (JNIEnv *, jobject, jlong, jlong, jint, jint, jdouble, jint, jint, jboolean, jdouble, jlong, jobject);
+
+/*
+ * Class:     org_apache_spark_ml_clustering_KMeansDALImpl
+ * Method:    cKMeansDALInit
+ * Signature: (JIJII)J
+ */
+JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_clustering_KMeansDALImpl_cKMeansDALInit
+  (JNIEnv *, jobject, jlong, jint, jlong, jint, jint);
 
 #ifdef __cplusplus
 }
@@ -15,6 +15,30 @@ extern "C" {
 JNIEXPORT void JNICALL Java_org_apache_spark_ml_util_OneDAL_00024_setNumericTableValue
   (JNIEnv *, jobject, jlong, jint, jint, jdouble);
 
+/*
+ * Class:     org_apache_spark_ml_util_OneDAL__
+ * Method:    cSetNumericTableRows
+ * Signature: (JJ[DI)V
+ */
+JNIEXPORT void JNICALL Java_org_apache_spark_ml_util_OneDAL_00024_cSetNumericTableRows
+  (JNIEnv *, jobject, jlong, jlong, jdoubleArray, jint);
+
+/*
+ * Class:     org_apache_spark_ml_util_OneDAL__
+ * Method:    cNewSOANumericTable
+ * Signature: ([JJ)J
+ */
+JNIEXPORT jlong JNICALL Java_org_apache_spark_ml_util_OneDAL_00024_cNewSOANumericTable
+  (JNIEnv *, jobject, jlongArray, jlong);
+
+/*
+ * Class:     org_apache_spark_ml_util_OneDAL__
+ * Method:    cFreeNumericTable
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_org_apache_spark_ml_util_OneDAL_00024_cFreeNumericTable
+  (JNIEnv *, jobject, jlong);
+
 #ifdef __cplusplus
 }
 #endif
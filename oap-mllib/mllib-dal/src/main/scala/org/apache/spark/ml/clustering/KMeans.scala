@@ -364,7 +364,15 @@ class KMeans @Since("1.5.0") (
 
     val model = if (useKMeansDAL) {
       instances.setName("instancesRDD").cache()
-      trainWithDAL(instances)
+      // The same plan of the same features is the same data, e.g. across the fits of a
+      // hyperparameter search on one dataset
+      val dataKey = if (Utils.sparkReuseNumericTable()) {
+        s"${dataset.queryExecution.analyzed.semanticHash()}_${$(featuresCol)}_" +
+          s"${Utils.sparkExecutorNum()}"
+      } else {
+        null
+      }
+      trainWithDAL(instances, dataKey)
     } else {
       trainWithML(instances)
     }
@@ -385,7 +393,8 @@ class KMeans @Since("1.5.0") (
     model
   }
 
-  private def trainWithDAL(instances: RDD[(Vector, Double)]): KMeansModel = instrumented { instr =>
+  private def trainWithDAL(instances: RDD[(Vector, Double)],
+                           dataKey: String): KMeansModel = instrumented { instr =>
 
     val executor_num = Utils.sparkExecutorNum()
     val executor_cores = Utils.sparkExecutorCores()
@@ -408,21 +417,26 @@ class KMeans @Since("1.5.0") (
       .setEpsilon($(tol))
       .setDistanceMeasure($(distanceMeasure))
 
-    val dataWithNorm = instances.map {
-      case (point: Vector, weight: Double) => new VectorWithNorm(point)
-    }
-    val centersWithNorm = if ($(initMode) == "random") {
-      mllibKMeans.initRandom(dataWithNorm)
+    // With native initialization, the centers are initialized by oneDAL with the iterations
+    val centers = if (Utils.sparkKMeansNativeInit()) {
+      null
     } else {
-      mllibKMeans.initKMeansParallel(dataWithNorm, distanceMeasureInstance)
-    }
+      val dataWithNorm = instances.map {
+        case (point: Vector, weight: Double) => new VectorWithNorm(point)
+      }
+      val centersWithNorm = if ($(initMode) == "random") {
+        mllibKMeans.initRandom(dataWithNorm)
+      } else {
+        mllibKMeans.initKMeansParallel(dataWithNorm, distanceMeasureInstance)
+      }
 
-    val centers = centersWithNorm.map(_.vector)
+      val initTimeInSeconds = (System.nanoTime() - initStartTime) / 1e9
 
-    val initTimeInSeconds = (System.nanoTime() - initStartTime) / 1e9
+      val strInitMode = $(initMode)
+      logInfo(f"Initialization with $strInitMode took $initTimeInSeconds%.3f seconds.")
 
-    val strInitMode = $(initMode)
-    logInfo(f"Initialization with $strInitMode took $initTimeInSeconds%.3f seconds.")
+      centersWithNorm.map(_.vector)
+    }
 
     // Repartition and convert to RDD[HomogenNumericTable]
     val repartitioned = instances.map {
@@ -430,7 +444,8 @@ class KMeans @Since("1.5.0") (
     }.repartition(executor_num).setName("Repartitioned for conversion").cache()
 
     val kmeansDAL = new KMeansDALImpl(getK, getMaxIter, getTol,
-      DistanceMeasure.EUCLIDEAN, centers, executor_num, executor_cores)
+      DistanceMeasure.EUCLIDEAN, centers, executor_num, executor_cores,
+      Utils.sparkKMeansAllreduce(), Utils.sparkKMeansMiniBatchFraction(), $(seed), dataKey)
 
     val parentModel = kmeansDAL.runWithRDDVector(repartitioned, Option(instr))
 
@@ -27,6 +27,9 @@ import org.apache.spark.ml.util.OneDAL._
 import org.apache.spark.mllib.linalg.{Vector => OldVector, Vectors => OldVectors}
 import org.apache.spark.rdd.RDD
 
+// Without centers, they are initialized natively by k-means++ over a sample of the data.
+// With dataKey, the numeric tables of the data are kept on the executors for the next fits
+// on the dataset of the same key, see OneDAL.cachedNumericTable
 class KMeansDALImpl (
   var nClusters : Int = 4,
   var maxIterations : Int = 10,
@@ -34,7 +37,11 @@ class KMeansDALImpl (
   val distanceMeasure: String = DistanceMeasure.EUCLIDEAN,
   val centers: Array[OldVector] = null,
   val executorNum: Int,
-  val executorCores: Int
+  val executorCores: Int,
+  val useAllreduce: Boolean = false,
+  val miniBatchFraction: Double = 1.0,
+  val seed: Long = 0L,
+  val dataKey: String = null
 ) extends Serializable {
 
   def runWithRDDVector(data: RDD[Vector], instr: Option[Instrumentation]) : MLlibKMeansModel = {
@@ -51,24 +58,22 @@ class KMeansDALImpl (
 
     println(s"KMeansDALImpl: Partition index: $index, numCols: $numCols, numRows: $numRows")
 
-    // Build DALMatrix, this will load libJavaAPI, libtbb, libtbbmalloc
-    val context = new DaalContext()
-    val localData = new DALMatrix(context, classOf[java.lang.Double],
-      numCols.toLong, numRows.toLong, NumericTable.AllocationFlag.DoAllocate)
+    val start = System.nanoTime
+    val localData = OneDAL.cachedNumericTable(dataKey, index, numRows, numCols) {
+      // Build DALMatrix, this will load libJavaAPI, libtbb, libtbbmalloc
+      val context = new DaalContext()
+      val matrix = new DALMatrix(context, classOf[java.lang.Double],
+        numCols.toLong, numRows.toLong, NumericTable.AllocationFlag.DoAllocate)
 
-    println("KMeansDALImpl: Loading libMLlibDAL.so" )
-    // oneDAL libs should be loaded by now, extract libMLlibDAL.so to temp file and load
-    LibLoader.loadLibrary()
+      println("KMeansDALImpl: Loading libMLlibDAL.so" )
+      // oneDAL libs should be loaded by now, extract libMLlibDAL.so to temp file and load
+      LibLoader.loadLibrary()
 
-    println(s"KMeansDALImpl: Start data conversion")
+      println(s"KMeansDALImpl: Start data conversion")
 
-    val start = System.nanoTime
-    it.zipWithIndex.foreach {
-      case (v, rowIndex) =>
-        for (colIndex <- 0 until numCols)
-          // TODO: Add matrix.set API in DAL to replace this
-          // matrix.set(rowIndex, colIndex, row.getString(colIndex).toDouble)
-          OneDAL.setNumericTableValue(localData.getCNumericTable, rowIndex, colIndex, v(colIndex))
+      OneDAL.copyRowsToNumericTable(it.map(_.toArray), matrix.getCNumericTable, numCols)
+
+      matrix
     }
 
     val duration = (System.nanoTime - start) / 1E9
@@ -77,23 +82,34 @@ class KMeansDALImpl (
 
     OneCCL.init(executorNum, executorIPAddress, OneCCL.KVS_PORT)
 
-    val initCentroids = OneDAL.makeNumericTable(centers)
+    val cInitCentroids = if (centers == null) {
+      cKMeansDALInit(localData.getCNumericTable, nClusters, seed, executorNum, executorCores)
+    } else {
+      OneDAL.makeNumericTable(centers).getCNumericTable
+    }
     var result = new KMeansResult()
     val cCentroids = cKMeansDALComputeWithInitCenters(
       localData.getCNumericTable,
-      initCentroids.getCNumericTable,
+      cInitCentroids,
       nClusters,
       maxIterations,
+      tolerance,
       executorNum,
       executorCores,
+      useAllreduce,
+      miniBatchFraction,
+      seed,
       result
     )
+    if (centers == null) {
+      OneDAL.cFreeNumericTable(cInitCentroids)
+    }
 
     val ret = if (OneCCL.isRoot()) {
         assert(cCentroids != 0)
 
         val centerVectors = OneDAL.numericTableToVectors(OneDAL.makeNumericTable(cCentroids))
-        Iterator((centerVectors, result.totalCost))
+        Iterator((centerVectors, result))
       } else {
         Iterator.empty
       }
@@ -108,12 +124,18 @@ class KMeansDALImpl (
     assert(results.length == 1)
 
     val centerVectors = results(0)._1
-    val totalCost = results(0)._2
+    val result = results(0)._2
+    val totalCost = result.totalCost
+    val iteration = result.iterationNum
 
     instr.foreach(_.logInfo(s"OneDAL output centroids:\n${centerVectors.mkString("\n")}"))
 
-    // TODO: tolerance support in DAL
-    val iteration = maxIterations
+    instr.foreach(_.logInfo(s"OneDAL ran $iteration iterations, compute / communication / " +
+      s"serialization microseconds of each iteration:\n" +
+      (0 until iteration).map { i =>
+        s"${result.computeTimes(i)} / ${result.communicationTimes(i)} / " +
+          s"${result.serializationTimes(i)}"
+      }.mkString("\n")))
 
     val parentModel = new MLlibKMeansModel(
       centerVectors.map(OldVectors.fromML(_)),
@@ -125,8 +147,17 @@ class KMeansDALImpl (
   // Single entry to call KMeans DAL backend with initial centers, output centers
   @native private def cKMeansDALComputeWithInitCenters(data: Long, centers: Long,
                                                        cluster_num: Int, iteration_num: Int,
+                                                       tolerance: Double,
                                                        executor_num: Int,
                                                        executor_cores: Int,
+                                                       use_allreduce: Boolean,
+                                                       mini_batch_fraction: Double,
+                                                       seed: Long,
                                                        result: KMeansResult): Long
 
+  // Initial centers sampled from the data of all the ranks, returned on all the ranks
+  @native private def cKMeansDALInit(data: Long, cluster_num: Int, seed: Long,
+                                     executor_num: Int,
+                                     executor_cores: Int): Long
+
 }
@@ -0,0 +1,110 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package org.apache.spark.ml.feature
+
+import java.util.Arrays
+
+import breeze.linalg.{svd => brzSvd, DenseMatrix => BDM}
+import com.intel.daal.data_management.data.{NumericTable, Matrix => DALMatrix}
+import com.intel.daal.services.DaalContext
+import org.apache.spark.ml.linalg.{DenseMatrix, DenseVector, Matrices, Vector, Vectors}
+import org.apache.spark.ml.util._
+import org.apache.spark.ml.util.OneDAL._
+import org.apache.spark.rdd.RDD
+
+class PCADALImpl (
+  val k: Int,
+  val executorNum: Int,
+  val executorCores: Int
+) extends Serializable {
+
+  // Principal components and explained variance, as the ones of Spark PCA
+  def fitWithDAL(data: RDD[Vector]) : (DenseMatrix, DenseVector) = {
+
+    val partitionDims = Utils.getPartitionDims(data)
+    val executorIPAddress = Utils.sparkFirstExecutorIP(data.sparkContext)
+
+    val results = data.mapPartitionsWithIndex { (index: Int, it: Iterator[Vector]) =>
+
+      val numRows = partitionDims(index)._1
+      val numCols = partitionDims(index)._2
+
+      println(s"PCADALImpl: Partition index: $index, numCols: $numCols, numRows: $numRows")
+
+      // Build DALMatrix, this will load libJavaAPI, libtbb, libtbbmalloc
+      val context = new DaalContext()
+      val localData = new DALMatrix(context, classOf[java.lang.Double],
+        numCols.toLong, numRows.toLong, NumericTable.AllocationFlag.DoAllocate)
+
+      println("PCADALImpl: Loading libMLlibDAL.so" )
+      // oneDAL libs should be loaded by now, extract libMLlibDAL.so to temp file and load
+      LibLoader.loadLibrary()
+
+      OneDAL.copyRowsToNumericTable(it.map(_.toArray), localData.getCNumericTable, numCols)
+
+      OneCCL.init(executorNum, executorIPAddress, OneCCL.KVS_PORT)
+
+      val cCovariance = cPCADALComputeCovariance(
+        localData.getCNumericTable,
+        executorNum,
+        executorCores
+      )
+
+      val ret = if (OneCCL.isRoot()) {
+        assert(cCovariance != 0)
+
+        val covariance = OneDAL.numericTableToVectors(OneDAL.makeNumericTable(cCovariance))
+        Iterator(covariance)
+      } else {
+        Iterator.empty
+      }
+
+      OneCCL.cleanup()
+
+      ret
+
+    }.collect()
+
+    // Make sure there is only one result from rank 0
+    assert(results.length == 1)
+
+    val rows = results(0)
+    val n = rows.length
+    require(k <= n, s"k = $k out of range (0, n = $n]")
+
+    // Same as RowMatrix.computePrincipalComponentsAndExplainedVariance
+    val cov = new BDM[Double](n, n, rows.flatMap(_.toArray))
+    val brzSvd.SVD(u: BDM[Double], s, _) = brzSvd(cov)
+
+    val eigenSum = s.data.sum
+    val explainedVariance = s.data.map(_ / eigenSum)
+
+    val pc = if (k == n) {
+      new DenseMatrix(n, n, u.data)
+    } else {
+      new DenseMatrix(n, k, Arrays.copyOfRange(u.data, 0, n * k))
+    }
+    (pc, Vectors.dense(Arrays.copyOfRange(explainedVariance, 0, k)).toDense)
+  }
+
+  // Sample covariance of the data of all the ranks, returned on rank 0
+  @native private def cPCADALComputeCovariance(data: Long,
+                                               executor_num: Int,
+                                               executor_cores: Int): Long
+
+}
@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package org.apache.spark.ml.regression
+
+import com.intel.daal.data_management.data.{NumericTable, Matrix => DALMatrix}
+import com.intel.daal.services.DaalContext
+import org.apache.spark.ml.linalg.{Vector, Vectors}
+import org.apache.spark.ml.util._
+import org.apache.spark.ml.util.OneDAL._
+import org.apache.spark.rdd.RDD
+
+class LinearRegressionDALImpl (
+  val fitIntercept: Boolean,
+  val executorNum: Int,
+  val executorCores: Int
+) extends Serializable {
+
+  // Ordinary least squares by the normal equations, no regularization nor standardization
+  def trainWithDAL(data: RDD[(Vector, Double)], uid: String) : LinearRegressionModel = {
+
+    val partitionDims = Utils.getPartitionDims(data.map(_._1))
+    val executorIPAddress = Utils.sparkFirstExecutorIP(data.sparkContext)
+
+    val results = data.mapPartitionsWithIndex {
+      (index: Int, it: Iterator[(Vector, Double)]) =>
+
+      val numRows = partitionDims(index)._1
+      val numCols = partitionDims(index)._2
+
+      println(s"LinearRegressionDALImpl: Partition index: $index, numCols: $numCols, " +
+        s"numRows: $numRows")
+
+      // Build DALMatrix, this will load libJavaAPI, libtbb, libtbbmalloc
+      val context = new DaalContext()
+      val localData = new DALMatrix(context, classOf[java.lang.Double],
+        numCols.toLong, numRows.toLong, NumericTable.AllocationFlag.DoAllocate)
+      val localLabel = new DALMatrix(context, classOf[java.lang.Double],
+        1, numRows.toLong, NumericTable.AllocationFlag.DoAllocate)
+
+      println("LinearRegressionDALImpl: Loading libMLlibDAL.so" )
+      // oneDAL libs should be loaded by now, extract libMLlibDAL.so to temp file and load
+      LibLoader.loadLibrary()
+
+      val labels = new Array[Double](numRows)
+      var rowIndex = 0
+      OneDAL.copyRowsToNumericTable(it.map { case (features, label) =>
+        labels(rowIndex) = label
+        rowIndex += 1
+        features.toArray
+      }, localData.getCNumericTable, numCols)
+      OneDAL.cSetNumericTableRows(localLabel.getCNumericTable, 0, labels, numRows)
+
+      OneCCL.init(executorNum, executorIPAddress, OneCCL.KVS_PORT)
+
+      val cBeta = cLinearRegressionDALCompute(
+        localData.getCNumericTable,
+        localLabel.getCNumericTable,
+        executorNum,
+        executorCores,
+        fitIntercept
+      )
+
+      val ret = if (OneCCL.isRoot()) {
+        assert(cBeta != 0)
+
+        val beta = OneDAL.numericTableToVectors(OneDAL.makeNumericTable(cBeta))
+        Iterator(beta(0))
+      } else {
+        Iterator.empty
+      }
+
+      OneCCL.cleanup()
+
+      ret
+
+    }.collect()
+
+    // Make sure there is only one result from rank 0
+    assert(results.length == 1)
+
+    // The intercept first, 0 without intercept
+    val beta = results(0).toArray
+    val coefficients = Vectors.dense(beta.slice(1, beta.length))
+
+    new LinearRegressionModel(uid, coefficients, beta(0))
+  }
+
+  // Beta of the data of all the ranks, returned on rank 0
+  @native private def cLinearRegressionDALCompute(data: Long, label: Long,
+                                                  executor_num: Int,
+                                                  executor_cores: Int,
+                                                  fit_intercept: Boolean): Long
+
+}
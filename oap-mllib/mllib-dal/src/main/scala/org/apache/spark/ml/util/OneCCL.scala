@@ -17,7 +17,7 @@
 
 package org.apache.spark.ml.util
 
-import org.apache.spark.SparkConf
+import org.apache.spark.{SparkConf, SparkEnv}
 
 object OneCCL {
 
@@ -28,6 +28,9 @@ object OneCCL {
 
   val KVS_PORT = 51234
 
+  // Whether the finalization of the communicator on shutdown is registered
+  private var shutdownHookAdded = false
+
   private def checkEnv() {
     val altTransport = sys.env.getOrElse("CCL_ATL_TRANSPORT", "")
     val pmType = sys.env.getOrElse("CCL_PM_TYPE", "")
@@ -58,9 +61,12 @@ object OneCCL {
 
     setExecutorEnv(executor_num, ip, port)
 
-    // cclParam is output from native code
+    // cclParam is output from native code, the communicator of the last call is reused
+    // if it has the same KVS address and world size
     c_init(cclParam)
 
+    addShutdownHook()
+
     // executor number should equal to oneCCL world size
     assert(executor_num == cclParam.commSize, "executor number should equal to oneCCL world size")
 
@@ -69,8 +75,27 @@ object OneCCL {
   }
 
   // Run on Executor
+  // With spark.oap.mllib.oneccl.persistent, the communicator is kept for the next training
+  // calls of the executor instead, and released when it exits. An executor lost and
+  // replaced meanwhile doesn't join the communicator kept by the others, so it should be
+  // turned off if executors may be replaced while the application runs.
   def cleanup(): Unit = {
-    c_cleanup()
+    if (!persistent) {
+      c_cleanup()
+    }
+  }
+
+  private def persistent: Boolean = {
+    val conf = Option(SparkEnv.get).map(_.conf).getOrElse(new SparkConf(true))
+
+    conf.getBoolean("spark.oap.mllib.oneccl.persistent", true)
+  }
+
+  private def addShutdownHook(): Unit = synchronized {
+    if (!shutdownHookAdded) {
+      sys.addShutdownHook(c_cleanup())
+      shutdownHookAdded = true
+    }
   }
 
   @native private def c_init(param: CCLParam) : Int
@@ -17,6 +17,8 @@
 
 package org.apache.spark.ml.util
 
+import scala.collection.mutable
+
 import com.intel.daal.data_management.data.{HomogenNumericTable, NumericTable, Matrix => DALMatrix}
 import com.intel.daal.services.DaalContext
 import org.apache.spark.ml.linalg.{Vector, Vectors}
@@ -24,6 +26,15 @@ import org.apache.spark.mllib.linalg.{Vector => OldVector}
 
 object OneDAL {
 
+  // Rows copied to a numeric table by each native call
+  val ROWS_PER_COPY = 4096
+
+  // Run on Executor
+  // Tables of the partitions of the last dataset converted on this executor, by partition
+  // index, and the key of the dataset
+  private val cachedTables = new mutable.HashMap[Int, DALMatrix]
+  private var cachedDataKey: String = null
+
   // Convert DAL numeric table to array of vectors
   def numericTableToVectors(table: NumericTable): Array[Vector] = {
     val numRows = table.getNumberOfRows.toInt
@@ -59,15 +70,67 @@ object OneDAL {
     val matrix = new DALMatrix(context, classOf[java.lang.Double],
       numCols.toLong, numRows.toLong, NumericTable.AllocationFlag.DoAllocate)
 
-    arrayVectors.zipWithIndex.foreach {
-      case (v, rowIndex) =>
-        for (colIndex <- 0 until numCols)
-        // matrix.set(rowIndex, colIndex, row.getString(colIndex).toDouble)
-          setNumericTableValue(matrix.getCNumericTable, rowIndex, colIndex, v(colIndex))
-    }
+    copyRowsToNumericTable(arrayVectors.iterator.map(_.toArray), matrix.getCNumericTable, numCols)
 
     matrix
   }
 
+  // Copy rows of numCols values to the numeric table, in batches of ROWS_PER_COPY rows
+  def copyRowsToNumericTable(rows: Iterator[Array[Double]], cTable: Long, numCols: Int): Unit = {
+    val batch = new Array[Double](ROWS_PER_COPY * numCols)
+    var rowOffset = 0L
+    var batchRows = 0
+    rows.foreach { row =>
+      System.arraycopy(row, 0, batch, batchRows * numCols, numCols)
+      batchRows += 1
+      if (batchRows == ROWS_PER_COPY) {
+        cSetNumericTableRows(cTable, rowOffset, batch, batchRows)
+        rowOffset += batchRows
+        batchRows = 0
+      }
+    }
+    if (batchRows > 0) {
+      cSetNumericTableRows(cTable, rowOffset, batch, batchRows)
+    }
+  }
+
+  // Run on Executor
+  // The table of partition index of the dataset of dataKey, built by build once and reused
+  // by the next fits on the same dataset, e.g. those of a hyperparameter search. Only the
+  // tables of one dataset are kept, those of another one released when it is converted.
+  // Without dataKey, the table is built each time and not kept.
+  def cachedNumericTable(dataKey: String, index: Int, numRows: Int, numCols: Int)
+                        (build: => DALMatrix): DALMatrix = synchronized {
+    if (dataKey == null) {
+      return build
+    }
+    if (dataKey != cachedDataKey) {
+      cachedTables.values.foreach(_.dispose())
+      cachedTables.clear()
+      cachedDataKey = dataKey
+    }
+    cachedTables.get(index) match {
+      case Some(table) if table.getNumberOfRows == numRows &&
+        table.getNumberOfColumns == numCols =>
+        table
+      case cached =>
+        cached.foreach(_.dispose())
+        val table = build
+        cachedTables(index) = table
+        table
+    }
+  }
+
+  // Wrap column buffers of numRows doubles, e.g. the value buffers of Arrow columns
+  // without nulls, as a numeric table without copying them. The buffers must stay valid
+  // until the table is freed by cFreeNumericTable.
+  def columnBuffersToNumericTable(columnAddrs: Array[Long], numRows: Long): Long = {
+    cNewSOANumericTable(columnAddrs, numRows)
+  }
+
   @native def setNumericTableValue(numTableAddr: Long, rowIndex: Int, colIndex: Int, value: Double)
+  @native def cSetNumericTableRows(numTableAddr: Long, rowOffset: Long, values: Array[Double],
+                                   numRows: Int)
+  @native def cNewSOANumericTable(columnAddrs: Array[Long], numRows: Long): Long
+  @native def cFreeNumericTable(numTableAddr: Long)
 }
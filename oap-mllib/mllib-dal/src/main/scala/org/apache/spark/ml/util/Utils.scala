@@ -56,6 +56,36 @@ object Utils {
     executorCores
   }
 
+  // Sum the partial results of each KMeans iteration by allreduce instead of
+  // merging them on the root
+  def sparkKMeansAllreduce(): Boolean = {
+    val conf = new SparkConf(true)
+
+    conf.getBoolean("spark.oap.mllib.kmeans.allreduce", false)
+  }
+
+  // Initialize the KMeans centers natively together with the iterations
+  def sparkKMeansNativeInit(): Boolean = {
+    val conf = new SparkConf(true)
+
+    conf.getBoolean("spark.oap.mllib.kmeans.nativeInit", false)
+  }
+
+  // Fraction of the rows sampled as the mini-batch of each KMeans iteration, 1.0 for all
+  def sparkKMeansMiniBatchFraction(): Double = {
+    val conf = new SparkConf(true)
+
+    conf.getDouble("spark.oap.mllib.kmeans.miniBatchFraction", 1.0)
+  }
+
+  // Keep the numeric tables converted from the data on the executors for the next fits
+  // on the same dataset
+  def sparkReuseNumericTable(): Boolean = {
+    val conf = new SparkConf(true)
+
+    conf.getBoolean("spark.oap.mllib.reuseNumericTable", false)
+  }
+
   def sparkFirstExecutorIP(sc: SparkContext): String = {
     val info = sc.statusTracker.getExecutorInfos
     // get first executor, info(0) is driver
@@ -26,6 +26,7 @@ import java.util.stream.Collectors;
 
 import org.apache.spark.sql.execution.datasources.parquet.VectorizedParquetRecordReader;
 import com.intel.oap.datasource.parquet.ParquetReader;
+import org.apache.arrow.gandiva.expression.Condition;
 import org.apache.arrow.vector.VectorSchemaRoot;
 import org.apache.arrow.vector.ipc.message.ArrowRecordBatch;
 import org.apache.arrow.vector.types.pojo.Schema;
@@ -68,8 +69,20 @@ public class VectorizedParquetArrowReader extends VectorizedParquetRecordReader
 
   private Schema schema = null;
 
+  // filters pushed down to the scan, pruning the row groups by their statistics
+  private Condition filter;
+  // filters the rows returned satisfy, decoding their columns first
+  private Condition rowFilter;
+
   public VectorizedParquetArrowReader(String path, ZoneId convertTz, boolean useOffHeap,
       int capacity, StructType sourceSchema, StructType readDataSchema, String tmp_dir) {
+    this(path, convertTz, useOffHeap, capacity, sourceSchema, readDataSchema, tmp_dir,
+        null, null);
+  }
+
+  public VectorizedParquetArrowReader(String path, ZoneId convertTz, boolean useOffHeap,
+      int capacity, StructType sourceSchema, StructType readDataSchema, String tmp_dir,
+      Condition filter, Condition rowFilter) {
     super(convertTz, "", useOffHeap, capacity);
     this.capacity = capacity;
     this.path = path;
@@ -77,6 +90,8 @@ public class VectorizedParquetArrowReader extends VectorizedParquetRecordReader
 
     this.sourceSchema = sourceSchema;
     this.readDataSchema = readDataSchema;
+    this.filter = filter;
+    this.rowFilter = rowFilter;
   }
 
   @Override
@@ -116,7 +131,8 @@ public class VectorizedParquetArrowReader extends VectorizedParquetRecordReader
         + Arrays.toString(rowGroupIndices) + ", column_indices is "
         + Arrays.toString(column_indices));
     this.reader = new ParquetReader(uriPath, split.getStart(), split.getEnd(),
-        column_indices, capacity, ArrowWritableColumnVector.getNewAllocator(), tmp_dir);
+        column_indices, capacity, ArrowWritableColumnVector.getNewAllocator(), tmp_dir,
+        null, -1, filter, rowFilter);
   }
 
   @Override
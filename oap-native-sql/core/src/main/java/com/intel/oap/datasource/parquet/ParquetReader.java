@@ -20,8 +20,12 @@ package com.intel.oap.datasource.parquet;
 import java.io.IOException;
 import java.util.List;
 
+import com.intel.oap.ColumnarPluginConfig;
 import com.intel.oap.vectorized.ArrowRecordBatchBuilder;
 import com.intel.oap.vectorized.ArrowRecordBatchBuilderImpl;
+import com.intel.oap.vectorized.RuntimeFilter;
+import org.apache.arrow.gandiva.exceptions.GandivaException;
+import org.apache.arrow.gandiva.expression.Condition;
 import org.apache.arrow.memory.BufferAllocator;
 import org.apache.arrow.vector.FieldVector;
 import org.apache.arrow.vector.VectorLoader;
@@ -59,7 +63,9 @@ public class ParquetReader implements AutoCloseable {
       long batchSize, BufferAllocator allocator, String tmp_dir) throws IOException {
     this.jniWrapper = new ParquetReaderJniWrapper(tmp_dir);
     this.allocator = allocator;
-    this.nativeInstanceId = jniWrapper.nativeOpenParquetReader(path, batchSize);
+    this.nativeInstanceId = jniWrapper.nativeOpenParquetReader(
+        path, batchSize, ColumnarPluginConfig.getParquetDecodeThreads());
+    setPrefetch();
     jniWrapper.nativeInitParquetReader(nativeInstanceId, columnIndices, rowGroupIndices);
   }
 
@@ -76,13 +82,87 @@ public class ParquetReader implements AutoCloseable {
    */
   public ParquetReader(String path, long startPos, long endPos, int[] columnIndices,
       long batchSize, BufferAllocator allocator, String tmp_dir) throws IOException {
+    this(path, startPos, endPos, columnIndices, batchSize, allocator, tmp_dir, null, -1);
+  }
+
+  /**
+   * Create an instance for ParquetReader skipping the row groups which can't match a
+   * join build side.
+   *
+   * @param path Parquet Reader File Path.
+   * @param startPos A start pos to indicate which rowGroup to read.
+   * @param endPos An end pos indicate which rowGroup to read.
+   * @param columnIndices An array to indicate which columns to read.
+   * @param batchSize number of rows expected to be read in one batch.
+   * @param allocator A BufferAllocator reference.
+   * @param runtimeFilter filter of the build side keys, or null.
+   * @param filterColumn index of the file column holding the probe side key.
+   * @throws IOException throws io exception in case of native failure.
+   */
+  public ParquetReader(String path, long startPos, long endPos, int[] columnIndices,
+      long batchSize, BufferAllocator allocator, String tmp_dir,
+      RuntimeFilter runtimeFilter, int filterColumn) throws IOException {
+    this(path, startPos, endPos, columnIndices, batchSize, allocator, tmp_dir,
+        runtimeFilter, filterColumn, null, null);
+  }
+
+  /**
+   * Create an instance for ParquetReader skipping the row groups which can't match a
+   * join build side, or whose statistics don't satisfy a pushed down filter.
+   *
+   * @param path Parquet Reader File Path.
+   * @param startPos A start pos to indicate which rowGroup to read.
+   * @param endPos An end pos indicate which rowGroup to read.
+   * @param columnIndices An array to indicate which columns to read.
+   * @param batchSize number of rows expected to be read in one batch.
+   * @param allocator A BufferAllocator reference.
+   * @param runtimeFilter filter of the build side keys, or null.
+   * @param filterColumn index of the file column holding the probe side key.
+   * @param filter condition of the file columns pushed down to the scan, or null.
+   * @param rowFilter condition of the columns read the rows returned satisfy, or null.
+   * @throws IOException throws io exception in case of native failure.
+   */
+  public ParquetReader(String path, long startPos, long endPos, int[] columnIndices,
+      long batchSize, BufferAllocator allocator, String tmp_dir,
+      RuntimeFilter runtimeFilter, int filterColumn, Condition filter,
+      Condition rowFilter) throws IOException {
     this.jniWrapper = new ParquetReaderJniWrapper(tmp_dir);
     this.allocator = allocator;
-    this.nativeInstanceId = jniWrapper.nativeOpenParquetReader(path, batchSize);
+    this.nativeInstanceId = jniWrapper.nativeOpenParquetReader(
+        path, batchSize, ColumnarPluginConfig.getParquetDecodeThreads());
+    if (runtimeFilter != null) {
+      jniWrapper.nativeSetRuntimeFilter(
+          nativeInstanceId, filterColumn, runtimeFilter.toBytes());
+    }
+    try {
+      if (filter != null) {
+        jniWrapper.nativeSetFilter(nativeInstanceId, filter.toProtobuf().toByteArray());
+      }
+      if (rowFilter != null) {
+        jniWrapper.nativeSetRowFilter(
+            nativeInstanceId, rowFilter.toProtobuf().toByteArray());
+      }
+    } catch (GandivaException e) {
+      throw new IOException(e);
+    }
+    setPrefetch();
     jniWrapper.nativeInitParquetReader2(
         nativeInstanceId, columnIndices, startPos, endPos);
   }
 
+  private void setPrefetch() throws IOException {
+    int ioThreads = ColumnarPluginConfig.getParquetCoalescedReadThreads();
+    if (ioThreads > 0) {
+      jniWrapper.nativeSetCoalescedReads(nativeInstanceId,
+          ColumnarPluginConfig.getParquetCoalescedReadHoleSizeLimit(),
+          ColumnarPluginConfig.getParquetCoalescedReadRangeSizeLimit(), ioThreads);
+    }
+    int rowGroups = ColumnarPluginConfig.getParquetPrefetchRowGroups();
+    if (rowGroups > 0) {
+      jniWrapper.nativeSetPrefetch(nativeInstanceId, rowGroups);
+    }
+  }
+
   /**
    * Get Arrow Schema from ParquetReader.
    *
@@ -149,6 +229,13 @@ public class ParquetReader implements AutoCloseable {
     return lastReadLength;
   }
 
+  /**
+   * Stop reading ahead once no more batch is needed, readNext returns null afterwards.
+   */
+  public void stop() {
+    jniWrapper.nativeStop(nativeInstanceId);
+  }
+
   @Override
   public void close() {
     jniWrapper.nativeCloseParquetReader(nativeInstanceId);
@@ -34,10 +34,12 @@ public class ParquetReaderJniWrapper {
    *
    * @param path absolute file path of target file
    * @param batchSize number of rows of one readed batch
+   * @param decodeThreads threads of the executor decoding the columns of a row group in
+   *     parallel, shared by the readers of all its tasks, 0 decodes them serially
    * @return long id of the parquet reader instance
    * @throws IOException throws exception in case of any io exception in native codes
    */
-  public native long nativeOpenParquetReader(String path, long batchSize)
+  public native long nativeOpenParquetReader(String path, long batchSize, int decodeThreads)
       throws IOException;
 
   /**
@@ -63,6 +65,63 @@ public class ParquetReaderJniWrapper {
   public native void nativeInitParquetReader2(
       long id, int[] columnIndices, long startPos, long endPos) throws IOException;
 
+  /**
+   * Skip the row groups whose statistics of an integer column don't overlap the keys of a
+   * join build side. Must be called before nativeInitParquetReader.
+   *
+   * @param id parquet reader instance number
+   * @param columnIndex index of the column in the file
+   * @param filter serialized {@link com.intel.oap.vectorized.RuntimeFilter}
+   * @throws IOException throws exception in case of any io exception in native codes
+   */
+  public native void nativeSetRuntimeFilter(long id, int columnIndex, byte[] filter)
+      throws IOException;
+
+  /**
+   * Skip the row groups whose column chunk statistics show none of their rows satisfies
+   * a condition pushed down to the scan. Must be called before nativeInitParquetReader.
+   *
+   * @param id parquet reader instance number
+   * @param condition serialized gandiva Condition of the file columns by name
+   * @throws IOException throws exception in case of any io exception in native codes
+   */
+  public native void nativeSetFilter(long id, byte[] condition) throws IOException;
+
+  /**
+   * Return only the rows satisfying a condition. Its columns are decoded first, the
+   * others only for the row groups with a matching row. Must be called before
+   * nativeInitParquetReader, the row groups aren't prefetched then.
+   *
+   * @param id parquet reader instance number
+   * @param condition serialized gandiva Condition of the columns read by name
+   * @throws IOException throws exception in case of any io exception in native codes
+   */
+  public native void nativeSetRowFilter(long id, byte[] condition) throws IOException;
+
+  /**
+   * Read ahead row groups on background threads, overlapping the I/O and decoding with
+   * the consumer of the batches. Must be called before nativeInitParquetReader.
+   *
+   * @param id parquet reader instance number
+   * @param rowGroups number of row groups fetched ahead, 0 to read synchronously
+   * @throws IOException throws exception in case of any io exception in native codes
+   */
+  public native void nativeSetPrefetch(long id, int rowGroups) throws IOException;
+
+  /**
+   * Fetch the column chunks of the columns read in a row group at once, merging the chunks
+   * close in the file into one request and issuing the requests in parallel. Must be called
+   * before nativeInitParquetReader.
+   *
+   * @param id parquet reader instance number
+   * @param holeSizeLimit chunks at most this many bytes apart are merged
+   * @param rangeSizeLimit a request fetches at most this many bytes, unless a chunk is larger
+   * @param ioThreads requests of a row group in flight at once
+   * @throws IOException throws exception in case of any io exception in native codes
+   */
+  public native void nativeSetCoalescedReads(
+      long id, long holeSizeLimit, long rangeSizeLimit, int ioThreads) throws IOException;
+
   /**
    * Close a parquet file reader.
    *
@@ -70,6 +129,14 @@ public class ParquetReaderJniWrapper {
    */
   public native void nativeCloseParquetReader(long id);
 
+  /**
+   * Stop reading once the consumer is done, e.g. when a LIMIT above the scan is satisfied.
+   * The prefetch threads are stopped and nativeReadNext returns null afterwards.
+   *
+   * @param id parquet reader instance number
+   */
+  public native void nativeStop(long id);
+
   /**
    * Read next record batch from parquet file reader.
    *
@@ -54,6 +54,18 @@ public class ParquetWriter implements AutoCloseable {
     this.nativeInstanceId = jniWrapper.nativeOpenParquetWriter(path, schemaBytes);
   }
 
+  /**
+   * Encode the column chunks of a row group in parallel, buffering rowGroupRows rows
+   * per row group. Must be called before the first writeNext.
+   *
+   * @param numThreads number of threads encoding the columns of a row group.
+   * @param rowGroupRows rows of a row group, 0 writes all the batches at close.
+   * @throws IOException throws exception in case of native failure.
+   */
+  public void setParallelWrite(int numThreads, long rowGroupRows) throws IOException {
+    jniWrapper.nativeSetParallelWrite(nativeInstanceId, numThreads, rowGroupRows);
+  }
+
   /**
    * Write Next ArrowRecordBatch to ParquetWriter.
    *
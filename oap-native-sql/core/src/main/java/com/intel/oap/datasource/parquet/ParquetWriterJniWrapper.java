@@ -38,6 +38,18 @@ public class ParquetWriterJniWrapper {
    */
   public native long nativeOpenParquetWriter(String path, byte[] schemaBytes);
 
+  /**
+   * Encode the column chunks of a row group on threads, and write a row group once
+   * enough rows are buffered. Must be called before the first batch is written.
+   *
+   * @param id parquet writer instance number
+   * @param numThreads number of threads encoding the columns of a row group
+   * @param rowGroupRows rows of a row group, 0 writes all the batches at close
+   * @throws IOException throws exception in case of any io exception in native codes
+   */
+  public native void nativeSetParallelWrite(long id, int numThreads, long rowGroupRows)
+      throws IOException;
+
   /**
    * Close a parquet file writer.
    *
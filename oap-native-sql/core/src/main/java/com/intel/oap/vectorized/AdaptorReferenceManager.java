@@ -40,14 +40,14 @@ public class AdaptorReferenceManager implements ReferenceManager {
   private long nativeMemoryHolder;
   private int size = 0;
 
-  // Required by netty dependencies, but is never used.
-  private BaseAllocator allocator;
+  // Required by netty dependencies, but is never used. Shared not to make an allocator
+  // for each native buffer.
+  private static final BaseAllocator allocator = new RootAllocator(0);
 
   AdaptorReferenceManager(long nativeMemoryHolder, int size) throws IOException {
     JniUtils.getInstance();
     this.nativeMemoryHolder = nativeMemoryHolder;
     this.size = size;
-    this.allocator = new RootAllocator(0);
   }
 
   @Override
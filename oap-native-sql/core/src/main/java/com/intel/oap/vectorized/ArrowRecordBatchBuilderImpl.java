@@ -64,4 +64,44 @@ public class ArrowRecordBatchBuilderImpl {
     }
     return new ArrowRecordBatch(recordBatchBuilder.length, nodes, buffers);
   }
+
+  /**
+   * Build ArrowRecordBatch from the batch info returned by native, which needs no Java
+   * object per field or buffer: the number of rows and of fields, the length and null count
+   * of each field, then the number of buffers and the native holder, address, size and
+   * capacity of each buffer.
+   *
+   * @param batchInfo the batch info.
+   * @throws IOException throws exception
+   */
+  public static ArrowRecordBatch build(long[] batchInfo) throws IOException {
+    int pos = 0;
+    int length = (int) batchInfo[pos++];
+    int numFields = (int) batchInfo[pos++];
+    List<ArrowFieldNode> nodes = new ArrayList<ArrowFieldNode>(numFields);
+    for (int i = 0; i < numFields; i++) {
+      nodes.add(new ArrowFieldNode(batchInfo[pos], batchInfo[pos + 1]));
+      pos += 2;
+    }
+    int numBuffers = (int) batchInfo[pos++];
+    List<ArrowBuf> buffers = new ArrayList<ArrowBuf>(numBuffers);
+    for (int i = 0; i < numBuffers; i++) {
+      long nativeInstanceId = batchInfo[pos];
+      long memoryAddress = batchInfo[pos + 1];
+      int size = (int) batchInfo[pos + 2];
+      pos += 4;
+      AdaptorReferenceManager referenceManager =
+          new AdaptorReferenceManager(nativeInstanceId, size);
+      buffers.add(new ArrowBuf(referenceManager, null, size, memoryAddress, false));
+    }
+    if (length == 0) {
+      // no batch holds the buffers of an empty batch, their native holders are released
+      for (ArrowBuf buffer : buffers) {
+        buffer.getReferenceManager().retain();
+        buffer.getReferenceManager().release();
+      }
+      return null;
+    }
+    return new ArrowRecordBatch(length, nodes, buffers);
+  }
 }
@@ -30,14 +30,18 @@ import org.apache.arrow.vector.ipc.message.ArrowBuffer;
 import org.apache.arrow.vector.ipc.message.MessageSerializer;
 
 public class BatchIterator {
-  private native ArrowRecordBatchBuilder nativeNext(long nativeHandler);
+  private native long[] nativeNextBatch(long nativeHandler);
   private native ArrowRecordBatchBuilder nativeProcess(long nativeHandler, byte[] schemaBuf, int numRows, long[] bufAddrs, long[] bufSizes);
+  private native ArrowRecordBatchBuilder[] nativeProcessBatches(long nativeHandler, byte[] schemaBuf, int[] numRows, long[][] bufAddrs, long[][] bufSizes);
+  private native ArrowRecordBatchBuilder nativeProcessRemaining(long nativeHandler);
   private native void nativeProcessAndCacheOne(long nativeHandler, byte[] schemaBuf, int numRows, long[] bufAddrs, long[] bufSizes);
   private native ArrowRecordBatchBuilder nativeProcessWithSelection(long nativeHandler, byte[] schemaBuf, int numRows, long[] bufAddrs, long[] bufSizes,
       int selectionVectorRecordCount, long selectionVectorAddr, long selectionVectorSize);
   private native void nativeProcessAndCacheOneWithSelection(long nativeHandler, byte[] schemaBuf, int numRows, long[] bufAddrs, long[] bufSizes,
       int selectionVectorRecordCount, long selectionVectorAddr, long selectionVectorSize);
 
+  private native byte[] nativeGetRuntimeFilter(long nativeHandler);
+  private native void nativeSetLimit(long nativeHandler, long limit);
   private native void nativeClose(long nativeHandler);
 
   private long nativeHandler = 0;
@@ -55,13 +59,11 @@ public class BatchIterator {
     if (nativeHandler == 0) {
       return null;
     }
-    ArrowRecordBatchBuilder resRecordBatchBuilder = nativeNext(nativeHandler);
-    if (resRecordBatchBuilder == null) {
+    long[] batchInfo = nativeNextBatch(nativeHandler);
+    if (batchInfo == null) {
       return null;
     }
-    ArrowRecordBatchBuilderImpl resRecordBatchBuilderImpl =
-        new ArrowRecordBatchBuilderImpl(resRecordBatchBuilder);
-    return resRecordBatchBuilderImpl.build();
+    return ArrowRecordBatchBuilderImpl.build(batchInfo);
   }
 
   public ArrowRecordBatch process(Schema schema, ArrowRecordBatch recordBatch) throws IOException {
@@ -109,6 +111,60 @@ public class BatchIterator {
     return resRecordBatchBuilderImpl.build();
   }
 
+  /**
+   * Process several batches in one native call, e.g. small ones, returning the result of
+   * each of them as {@link #process(Schema, ArrowRecordBatch)} does. Only for iterators whose
+   * results never leave remaining rows, as they can't be fetched between the batches.
+   */
+  public ArrowRecordBatch[] process(Schema schema, List<ArrowRecordBatch> recordBatches)
+      throws IOException {
+    if (nativeHandler == 0) {
+      return null;
+    }
+    int[] numRows = new int[recordBatches.size()];
+    long[][] bufAddrs = new long[recordBatches.size()][];
+    long[][] bufSizes = new long[recordBatches.size()][];
+    for (int i = 0; i < recordBatches.size(); i++) {
+      ArrowRecordBatch recordBatch = recordBatches.get(i);
+      List<ArrowBuf> buffers = recordBatch.getBuffers();
+      List<ArrowBuffer> buffersLayout = recordBatch.getBuffersLayout();
+      numRows[i] = recordBatch.getLength();
+      bufAddrs[i] = new long[buffers.size()];
+      bufSizes[i] = new long[buffers.size()];
+      for (int j = 0; j < buffers.size(); j++) {
+        bufAddrs[i][j] = buffers.get(j).memoryAddress();
+        bufSizes[i][j] = buffersLayout.get(j).getSize();
+      }
+    }
+
+    ArrowRecordBatchBuilder[] resRecordBatchBuilders = nativeProcessBatches(
+        nativeHandler, getSchemaBytesBuf(schema), numRows, bufAddrs, bufSizes);
+    ArrowRecordBatch[] recordBatchList = new ArrowRecordBatch[resRecordBatchBuilders.length];
+    for (int i = 0; i < resRecordBatchBuilders.length; i++) {
+      recordBatchList[i] = new ArrowRecordBatchBuilderImpl(resRecordBatchBuilders[i]).build();
+    }
+    return recordBatchList;
+  }
+
+  /**
+   * Return the next batch of the output rows of the last processed batch that did not fit
+   * its result, e.g. the matches of a join key with more build rows than a batch. Call it
+   * until it returns null, before processing the next batch and while the last processed
+   * one is still valid.
+   */
+  public ArrowRecordBatch processRemaining() throws IOException {
+    if (nativeHandler == 0) {
+      return null;
+    }
+    ArrowRecordBatchBuilder resRecordBatchBuilder = nativeProcessRemaining(nativeHandler);
+    if (resRecordBatchBuilder == null) {
+      return null;
+    }
+    ArrowRecordBatchBuilderImpl resRecordBatchBuilderImpl =
+        new ArrowRecordBatchBuilderImpl(resRecordBatchBuilder);
+    return resRecordBatchBuilderImpl.build();
+  }
+
   public void processAndCacheOne(Schema schema, ArrowRecordBatch recordBatch) throws IOException {
     processAndCacheOne(schema, recordBatch, null);
   }
@@ -147,6 +203,35 @@ public class BatchIterator {
     }
   }
 
+  /**
+   * Filter of the build side keys of the join this iterator probes, for the probe side
+   * scan.
+   *
+   * @return the filter, or null if this is not a join, or if its keys are not single
+   *     integer columns
+   */
+  public RuntimeFilter getRuntimeFilter() throws IOException {
+    if (nativeHandler == 0) {
+      return null;
+    }
+    byte[] serialized = nativeGetRuntimeFilter(nativeHandler);
+    if (serialized == null) {
+      return null;
+    }
+    return new RuntimeFilter(serialized);
+  }
+
+  /**
+   * Signal that no more than limit further rows will be read, 0 once done, e.g. when a
+   * LIMIT downstream is satisfied. The native iterators may then stop producing, release
+   * the batches they cache and stop their background threads.
+   */
+  public void setLimit(long limit) {
+    if (nativeHandler != 0 && !closed) {
+      nativeSetLimit(nativeHandler, limit);
+    }
+  }
+
   public void close() {
     if (!closed) {
       nativeClose(nativeHandler);
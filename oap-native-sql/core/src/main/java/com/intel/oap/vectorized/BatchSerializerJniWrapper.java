@@ -0,0 +1,43 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.oap.vectorized;
+
+import java.io.IOException;
+
+public class BatchSerializerJniWrapper {
+
+  public BatchSerializerJniWrapper() throws IOException {
+    JniUtils.getInstance();
+  }
+
+  /**
+   * Serialize record batches as one Arrow IPC stream, e.g. the build side of a broadcast join,
+   * which {@link ExpressionEvaluator#evaluateSerialized} evaluates as is. The streams of several
+   * tasks may be concatenated.
+   *
+   * @param schemaBuf serialized arrow schema of the batches
+   * @param codec compression codec of the stream bodies, "lz4" or "zstd", or null not to compress
+   * @param numRows rows of each batch
+   * @param bufAddrs addresses of the buffers of all the batches, batch after batch
+   * @param bufSizes sizes of the buffers of all the batches
+   * @return the serialized stream
+   * @throws RuntimeException
+   */
+  public native byte[] serialize(byte[] schemaBuf, String codec, int[] numRows, long[] bufAddrs,
+      long[] bufSizes) throws RuntimeException;
+}
@@ -23,6 +23,8 @@ import java.io.ByteArrayOutputStream;
 import java.io.IOException;
 import java.nio.channels.Channels;
 import java.util.List;
+import java.util.Set;
+import java.util.concurrent.ConcurrentHashMap;
 import org.apache.arrow.gandiva.evaluator.SelectionVectorInt16;
 import org.apache.arrow.gandiva.exceptions.GandivaException;
 import org.apache.arrow.gandiva.expression.ExpressionTree;
@@ -32,9 +34,12 @@ import org.apache.arrow.vector.ipc.message.ArrowBuffer;
 import org.apache.arrow.vector.ipc.message.ArrowRecordBatch;
 import org.apache.arrow.vector.ipc.message.MessageSerializer;
 import org.apache.arrow.vector.types.pojo.Schema;
+import org.apache.spark.TaskContext;
+import org.apache.spark.util.TaskCompletionListener;
 
 public class ExpressionEvaluator implements AutoCloseable {
   private long nativeHandler = 0;
+  private long memoryPoolId = 0;
   private ExpressionEvaluatorJniWrapper jniWrapper;
 
   /** Wrapper for native API. */
@@ -46,34 +51,91 @@ public class ExpressionEvaluator implements AutoCloseable {
     jniWrapper = new ExpressionEvaluatorJniWrapper(tmp_dir);
     jniWrapper.nativeSetJavaTmpDir(tmp_dir);
     jniWrapper.nativeSetBatchSize(ColumnarPluginConfig.getBatchSize());
+    String kernelStore = ColumnarPluginConfig.getKernelStore();
+    if (kernelStore != null) {
+      jniWrapper.nativeSetKernelStore(kernelStore);
+    }
+    jniWrapper.nativeSetJoinMemoryBudget(ColumnarPluginConfig.getJoinMemoryBudget());
+    jniWrapper.nativeSetJoinBuildThreads(ColumnarPluginConfig.getJoinBuildThreads());
+    jniWrapper.nativeSetSortThreads(ColumnarPluginConfig.getSortThreads());
+    jniWrapper.nativeSetAggregateThreads(ColumnarPluginConfig.getAggregateThreads());
+    jniWrapper.nativeSetExecutorThreads(
+        ColumnarPluginConfig.getExecutorThreads(), ColumnarPluginConfig.getTaskParallelism());
+    jniWrapper.nativeSetLargePages(ColumnarPluginConfig.getLargePageThreshold(),
+        ColumnarPluginConfig.getLargePageExplicit(),
+        ColumnarPluginConfig.getLargePageNumaBind());
+    jniWrapper.nativeSetPrecompiledKernels(ColumnarPluginConfig.getPrecompiledKernels());
+    warmUpKernels(jniWrapper);
+    dumpTraceOnTaskCompletion(jniWrapper);
+    if (ColumnarPluginConfig.getEnableTaskMemoryPool()) {
+      memoryPoolId = NativeMemoryPool.getForCurrentTask(jniWrapper);
+    }
+  }
+
+  private static boolean kernelsWarmedUp = false;
+
+  /** Load the known kernels once per executor, before its first kernel is built. */
+  private static synchronized void warmUpKernels(
+      ExpressionEvaluatorJniWrapper jniWrapper) {
+    if (!kernelsWarmedUp) {
+      kernelsWarmedUp = true;
+      String[] signatures = ColumnarPluginConfig.getWarmUpSignatures();
+      if (signatures.length > 0) {
+        jniWrapper.nativeWarmUpKernels(signatures);
+      }
+    }
+  }
+
+  // task attempt ids of the tasks dumping the native trace once they complete
+  private static final Set<Long> tracedTasks = ConcurrentHashMap.newKeySet();
+
+  /** Dump the native trace of the current task when it completes, if tracing is on. */
+  private static void dumpTraceOnTaskCompletion(
+      ExpressionEvaluatorJniWrapper jniWrapper) {
+    TaskContext context = TaskContext.get();
+    if (System.getenv("NATIVESQL_TRACE_DIR") == null || context == null) {
+      return;
+    }
+    long taskAttemptId = context.taskAttemptId();
+    if (!tracedTasks.add(taskAttemptId)) {
+      return;
+    }
+    context.addTaskCompletionListener(new TaskCompletionListener() {
+      @Override
+      public void onTaskCompletion(TaskContext completed) {
+        tracedTasks.remove(taskAttemptId);
+        jniWrapper.nativeDumpTrace("trace-task-" + taskAttemptId + ".json");
+      }
+    });
   }
 
   /** Convert ExpressionTree into native function. */
   public void build(Schema schema, List<ExpressionTree> exprs)
       throws RuntimeException, IOException, GandivaException {
-    nativeHandler = jniWrapper.nativeBuild(
-        getSchemaBytesBuf(schema), getExprListBytesBuf(exprs), null, false);
+    nativeHandler = jniWrapper.nativeBuild(getSchemaBytesBuf(schema),
+        getExprListBytesBuf(exprs), null, false, memoryPoolId);
   }
 
   /** Convert ExpressionTree into native function. */
   public void build(Schema schema, List<ExpressionTree> exprs, boolean finishReturn)
       throws RuntimeException, IOException, GandivaException {
-    nativeHandler = jniWrapper.nativeBuild(
-        getSchemaBytesBuf(schema), getExprListBytesBuf(exprs), null, finishReturn);
+    nativeHandler = jniWrapper.nativeBuild(getSchemaBytesBuf(schema),
+        getExprListBytesBuf(exprs), null, finishReturn, memoryPoolId);
   }
 
   /** Convert ExpressionTree into native function. */
   public void build(Schema schema, List<ExpressionTree> exprs, Schema resSchema)
       throws RuntimeException, IOException, GandivaException {
     nativeHandler = jniWrapper.nativeBuild(getSchemaBytesBuf(schema),
-        getExprListBytesBuf(exprs), getSchemaBytesBuf(resSchema), false);
+        getExprListBytesBuf(exprs), getSchemaBytesBuf(resSchema), false, memoryPoolId);
   }
 
   /** Convert ExpressionTree into native function. */
   public void build(Schema schema, List<ExpressionTree> exprs, Schema resSchema,
       boolean finishReturn) throws RuntimeException, IOException, GandivaException {
     nativeHandler = jniWrapper.nativeBuild(getSchemaBytesBuf(schema),
-        getExprListBytesBuf(exprs), getSchemaBytesBuf(resSchema), finishReturn);
+        getExprListBytesBuf(exprs), getSchemaBytesBuf(resSchema), finishReturn,
+        memoryPoolId);
   }
 
   /** Convert ExpressionTree into native function. */
@@ -81,7 +143,7 @@ public class ExpressionEvaluator implements AutoCloseable {
       Schema schema, List<ExpressionTree> exprs, List<ExpressionTree> finish_exprs)
       throws RuntimeException, IOException, GandivaException {
     nativeHandler = jniWrapper.nativeBuildWithFinish(getSchemaBytesBuf(schema),
-        getExprListBytesBuf(exprs), getExprListBytesBuf(finish_exprs));
+        getExprListBytesBuf(exprs), getExprListBytesBuf(finish_exprs), memoryPoolId);
   }
 
   /** Set result Schema in some special cases */
@@ -143,6 +205,54 @@ public class ExpressionEvaluator implements AutoCloseable {
     return recordBatchList;
   }
 
+  /**
+   * Evaluate several input batches in one native call, e.g. small ones, and output the
+   * recordBatches of each of them as {@link #evaluate(ArrowRecordBatch)} does.
+   */
+  public ArrowRecordBatch[][] evaluate(List<ArrowRecordBatch> recordBatches)
+      throws RuntimeException, IOException {
+    int[] numRows = new int[recordBatches.size()];
+    long[][] bufAddrs = new long[recordBatches.size()][];
+    long[][] bufSizes = new long[recordBatches.size()][];
+    for (int i = 0; i < recordBatches.size(); i++) {
+      ArrowRecordBatch recordBatch = recordBatches.get(i);
+      List<ArrowBuf> buffers = recordBatch.getBuffers();
+      List<ArrowBuffer> buffersLayout = recordBatch.getBuffersLayout();
+      numRows[i] = recordBatch.getLength();
+      bufAddrs[i] = new long[buffers.size()];
+      bufSizes[i] = new long[buffers.size()];
+      for (int j = 0; j < buffers.size(); j++) {
+        bufAddrs[i][j] = buffers.get(j).memoryAddress();
+        bufSizes[i][j] = buffersLayout.get(j).getSize();
+      }
+    }
+
+    ArrowRecordBatchBuilder[][] resRecordBatchBuilderLists =
+        jniWrapper.nativeEvaluateBatches(nativeHandler, numRows, bufAddrs, bufSizes);
+    ArrowRecordBatch[][] recordBatchLists =
+        new ArrowRecordBatch[resRecordBatchBuilderLists.length][];
+    for (int i = 0; i < resRecordBatchBuilderLists.length; i++) {
+      ArrowRecordBatchBuilder[] resRecordBatchBuilderList = resRecordBatchBuilderLists[i];
+      recordBatchLists[i] = new ArrowRecordBatch[resRecordBatchBuilderList.length];
+      for (int j = 0; j < resRecordBatchBuilderList.length; j++) {
+        if (resRecordBatchBuilderList[j] == null) {
+          break;
+        }
+        recordBatchLists[i][j] =
+            new ArrowRecordBatchBuilderImpl(resRecordBatchBuilderList[j]).build();
+      }
+    }
+    return recordBatchLists;
+  }
+
+  /**
+   * Evaluate the batches serialized by {@link BatchSerializerJniWrapper#serialize}, e.g. the
+   * build side of a broadcast join, with no conversion of them to Java record batches.
+   */
+  public void evaluateSerialized(byte[] serialized) throws RuntimeException {
+    jniWrapper.nativeEvaluateSerialized(nativeHandler, serialized);
+  }
+
   /**
    * Evaluate input data using builded native function, and output as recordBatch.
    */
@@ -188,6 +298,40 @@ public class ExpressionEvaluator implements AutoCloseable {
     return new BatchIterator(batchIteratorInstance);
   }
 
+  /**
+   * Runtime counters of the kernels of this expression so far, e.g. for SQL metrics. The
+   * counters of the iterator returned by {@link #finishByIterator()} are included.
+   */
+  public KernelMetrics[] getMetrics() throws RuntimeException {
+    return jniWrapper.nativeGetMetrics(nativeHandler);
+  }
+
+  /**
+   * Share the hash table this join built from a broadcast relation with the other tasks
+   * of the executor, see {@link #attachSharedBuild(long)}.
+   */
+  public void shareBuild(long broadcastId) throws RuntimeException {
+    jniWrapper.nativeShareBuild(nativeHandler, broadcastId);
+  }
+
+  /**
+   * Probe the hash table a task of the executor shared for a broadcast relation instead
+   * of building one, null if none was shared yet.
+   */
+  public BatchIterator attachSharedBuild(long broadcastId)
+      throws RuntimeException, IOException {
+    long batchIteratorInstance = jniWrapper.nativeAttachSharedBuild(broadcastId);
+    if (batchIteratorInstance == 0) {
+      return null;
+    }
+    return new BatchIterator(batchIteratorInstance);
+  }
+
+  /** Drop the hash table shared for a broadcast relation once it is unpersisted. */
+  public void releaseSharedBuild(long broadcastId) {
+    jniWrapper.nativeReleaseSharedBuild(broadcastId);
+  }
+
   public void setDependency(BatchIterator child) throws RuntimeException, IOException {
     jniWrapper.nativeSetDependency(nativeHandler, child.getInstanceId(), -1);
   }
@@ -45,6 +45,88 @@ public class ExpressionEvaluatorJniWrapper {
    */
   native void nativeSetBatchSize(int batch_size);
 
+  /**
+   * Set native env variables NATIVESQL_KERNEL_STORE
+   *
+   * @param uri  file system uri where the compiled kernels are shared, use
+   *     spark.sql.columnar.codegen.kernelStore
+   */
+  native void nativeSetKernelStore(String uri);
+
+  /**
+   * Set native env variables NATIVESQL_JOIN_MEMORY_BUDGET
+   *
+   * @param budget  bytes of build side a hash join keeps in memory before spilling both
+   *     sides by hash partition, 0 to never spill, use
+   *     spark.sql.columnar.join.memoryBudget
+   */
+  native void nativeSetJoinMemoryBudget(long budget);
+
+  /**
+   * Set native env variables NATIVESQL_JOIN_BUILD_THREADS
+   *
+   * @param num_threads  threads building the hash table of a join, use
+   *     spark.sql.columnar.join.buildThreads
+   */
+  native void nativeSetJoinBuildThreads(int num_threads);
+
+  /**
+   * Set native env variables NATIVESQL_SORT_THREADS
+   *
+   * @param num_threads  threads sorting the rows of a sort, use
+   *     spark.sql.columnar.sort.threads
+   */
+  native void nativeSetSortThreads(int num_threads);
+
+  /**
+   * Set native env variables NATIVESQL_AGGREGATE_THREADS
+   *
+   * @param num_threads  threads aggregating the hash partitions of a hash aggregation,
+   *     use spark.sql.columnar.aggregate.threads
+   */
+  native void nativeSetAggregateThreads(int num_threads);
+
+  /**
+   * Set native env variables NATIVESQL_EXECUTOR_THREADS and NATIVESQL_TASK_PARALLELISM,
+   * read once when the first native kernel runs in parallel
+   *
+   * @param num_threads  threads of the task scheduler shared by the native kernels of
+   *     all the tasks of the executor, 0 for a thread per core, use
+   *     spark.sql.columnar.executor.threads
+   * @param task_parallelism  threads of the scheduler a single kernel runs on at most,
+   *     0 for all of them, use spark.sql.columnar.task.parallelism
+   */
+  native void nativeSetExecutorThreads(int num_threads, int task_parallelism);
+
+  /**
+   * Set native env variables NATIVESQL_LARGE_PAGE_THRESHOLD, NATIVESQL_LARGE_PAGE_EXPLICIT
+   * and NATIVESQL_LARGE_PAGE_NUMA, read once when the first native memory pool is made
+   *
+   * @param threshold  bytes from which an allocation of a kernel is backed by 2MB pages,
+   *     0 to never, use spark.sql.columnar.largePages.threshold
+   * @param explicitPages  whether to take reserved huge pages before transparent ones,
+   *     use spark.sql.columnar.largePages.explicit
+   * @param bindNuma  whether to prefer the NUMA node of the allocating thread, use
+   *     spark.sql.columnar.largePages.numaBind
+   */
+  native void nativeSetLargePages(long threshold, boolean explicitPages, boolean bindNuma);
+
+  /**
+   * Set native env variable NATIVESQL_PRECOMPILED_KERNELS
+   *
+   * @param enabled  whether kernels of a shape compiled into the library are used
+   *     instead of generated ones, use spark.sql.columnar.codegen.precompiledKernels
+   */
+  native void nativeSetPrecompiledKernels(boolean enabled);
+
+  /**
+   * Load the compiled kernels of signatures from this node or the kernel store.
+   *
+   * @param signatures  kernel signatures, use
+   *     spark.sql.columnar.codegen.warmUpSignatures
+   */
+  native void nativeWarmUpKernels(String[] signatures) throws RuntimeException;
+
   /**
    * Generates the projector module to evaluate the expressions with custom
    * configuration.
@@ -57,11 +139,12 @@ public class ExpressionEvaluatorJniWrapper {
    *                     see the protobuf specification
    * @param finishReturn This parameter is used to indicate that this expression
    *                     should return when calling finish
+   * @param memoryPoolId The native memory pool of the task, 0 for the default pool
    * @return A nativeHandler that is passed to the evaluateProjector() and
    *         closeProjector() methods
    */
   native long nativeBuild(byte[] schemaBuf, byte[] exprListBuf, byte[] resSchemaBuf,
-      boolean finishReturn) throws RuntimeException;
+      boolean finishReturn, long memoryPoolId) throws RuntimeException;
 
   /**
    * Generates the projector module to evaluate the expressions with custom
@@ -75,11 +158,37 @@ public class ExpressionEvaluatorJniWrapper {
    * @param finishExprListBuf The serialized protobuf of the expression vector.
    *                          Each expression is created using
    *                          TreeBuilder::MakeExpression.
+   * @param memoryPoolId      The native memory pool of the task, 0 for the
+   *                          default pool
    * @return A nativeHandler that is passed to the evaluateProjector() and
    *         closeProjector() methods
    */
   native long nativeBuildWithFinish(byte[] schemaBuf, byte[] exprListBuf,
-      byte[] finishExprListBuf) throws RuntimeException;
+      byte[] finishExprListBuf, long memoryPoolId) throws RuntimeException;
+
+  /**
+   * Create a native memory pool whose allocations are reserved from a listener.
+   *
+   * @param listener reserves the memory of the pool, by chunks
+   * @return The id of the pool, passed to the build methods
+   */
+  native long nativeCreateMemoryPool(ReservationListener listener);
+
+  /**
+   * Ask the kernels allocating from a native memory pool to free memory.
+   *
+   * @param memoryPoolId id of the pool
+   * @param size bytes to free
+   * @return The bytes freed now, kernels may spill later at a safe point instead
+   */
+  native long nativeSpillMemoryPool(long memoryPoolId, long size);
+
+  /**
+   * Release a native memory pool, it is freed once all of its memory is.
+   *
+   * @param memoryPoolId id of the pool
+   */
+  native void nativeReleaseMemoryPool(long memoryPoolId);
 
   /**
    * Set return schema for this expressionTree.
@@ -110,6 +219,22 @@ public class ExpressionEvaluatorJniWrapper {
   native ArrowRecordBatchBuilder[] nativeEvaluate(long nativeHandler, int numRows,
       long[] bufAddrs, long[] bufSizes) throws RuntimeException;
 
+  /**
+   * Evaluate the expressions represented by the nativeHandler on several record
+   * batches in one call, as {@link #nativeEvaluate} does each of them, so that the
+   * cost of the call is shared by the batches when they are small
+   *
+   * @param nativeHandler nativeHandler representing expressions. Created using a
+   *                      call to buildNativeCode
+   * @param numRows       Number of rows in each record batch
+   * @param bufAddrs      The memory addresses of the buffers of each record batch
+   * @param bufSizes      The sizes of the buffers of each record batch
+   * @return For each record batch, the list of ArrowRecordBatchBuilder
+   *         nativeEvaluate returns for it
+   */
+  native ArrowRecordBatchBuilder[][] nativeEvaluateBatches(long nativeHandler,
+      int[] numRows, long[][] bufAddrs, long[][] bufSizes) throws RuntimeException;
+
   /**
    * Evaluate the expressions represented by the nativeHandler on a record batch
    * and store the output in ValueVectors. Throws an exception in case of errors
@@ -133,6 +258,17 @@ public class ExpressionEvaluatorJniWrapper {
       int numRows, long[] bufAddrs, long[] bufSizes, int selectionVectorRecordCount,
       long selectionVectorAddr, long selectionVectorSize) throws RuntimeException;
 
+  /**
+   * Evaluate the record batches of an Arrow IPC stream, e.g. of a broadcast build side
+   * serialized by {@link BatchSerializerJniWrapper#serialize}, without returning output.
+   *
+   * @param nativeHandler nativeHandler representing expressions. Created using a
+   *                      call to buildNativeCode
+   * @param serialized    one or more concatenated IPC streams of the input schema
+   */
+  native void nativeEvaluateSerialized(long nativeHandler, byte[] serialized)
+      throws RuntimeException;
+
   native void nativeSetMember(
       long nativeHandler, int numRows, long[] bufAddrs, long[] bufSizes);
 
@@ -156,6 +292,64 @@ public class ExpressionEvaluatorJniWrapper {
    */
   native long nativeFinishByIterator(long nativeHandler) throws RuntimeException;
 
+  /**
+   * Get the runtime counters of the kernels of this expression.
+   *
+   * @param nativeHandler nativeHandler of this expression
+   * @return metrics of each kernel, those of its dependencies first
+   */
+  native KernelMetrics[] nativeGetMetrics(long nativeHandler) throws RuntimeException;
+
+  /**
+   * Write the trace events recorded by the threads of this process since the last dump
+   * into fileName under NATIVESQL_TRACE_DIR, as a Chrome trace. Does nothing unless
+   * NATIVESQL_TRACE_DIR is set.
+   *
+   * @param fileName name of the trace file
+   */
+  native void nativeDumpTrace(String fileName) throws RuntimeException;
+
+  /**
+   * Share the hash table built by this join with the tasks of this process probing the
+   * same broadcast relation. Ignored if another task already shared one.
+   *
+   * @param nativeHandler nativeHandler of a join whose build side was evaluated
+   * @param broadcastId   id of the broadcast relation of the build side
+   */
+  native void nativeShareBuild(long nativeHandler, long broadcastId)
+      throws RuntimeException;
+
+  /**
+   * Probe the hash table shared for a broadcast relation.
+   *
+   * @param broadcastId id of the broadcast relation of the build side
+   * @return iterator instance id, or 0 if no table is shared for broadcastId
+   */
+  native long nativeAttachSharedBuild(long broadcastId) throws RuntimeException;
+
+  /**
+   * Drop the hash table shared for a broadcast relation, e.g. once it is unpersisted.
+   * The iterators attached to it keep it until they are closed.
+   *
+   * @param broadcastId id of the broadcast relation of the build side
+   */
+  native void nativeReleaseSharedBuild(long broadcastId);
+
+  /**
+   * Join a fact side with the hash tables shared for several broadcast relations in
+   * one pass, instead of through a join per dimension. Only inner (0) and outer (1)
+   * joins without a condition are supported.
+   *
+   * @param factSchema   schema of the fact batches passed to the iterator
+   * @param broadcastIds ids of the broadcast relations of the dimensions
+   * @param joinTypes    join type of each dimension
+   * @param keyIndices   fact columns of the keys of each dimension
+   * @param memoryPoolId memory pool of the output batches
+   * @return iterator instance id, or 0 if some dimension has no shared table
+   */
+  native long nativeAttachStarJoin(byte[] factSchema, long[] broadcastIds,
+      int[] joinTypes, int[][] keyIndices, long memoryPoolId) throws RuntimeException;
+
   /**
    * Set another evaluator's iterator as this one's dependency.
    *
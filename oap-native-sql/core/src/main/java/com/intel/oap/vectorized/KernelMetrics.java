@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.oap.vectorized;
+
+/** Runtime counters of a native kernel, see {@link ExpressionEvaluator#getMetrics()}. */
+public class KernelMetrics {
+  private String name;
+  private long evaluateNanos;
+  private long numInputRows;
+  private long numOutputRows;
+  private long hashTableSize;
+  private long probeChainLength;
+  private long spillBytes;
+  private long codegenNanos;
+
+  public KernelMetrics(String name, long evaluateNanos, long numInputRows,
+      long numOutputRows, long hashTableSize, long probeChainLength, long spillBytes,
+      long codegenNanos) {
+    this.name = name;
+    this.evaluateNanos = evaluateNanos;
+    this.numInputRows = numInputRows;
+    this.numOutputRows = numOutputRows;
+    this.hashTableSize = hashTableSize;
+    this.probeChainLength = probeChainLength;
+    this.spillBytes = spillBytes;
+    this.codegenNanos = codegenNanos;
+  }
+
+  public String getName() {
+    return name;
+  }
+
+  /** Time in the kernel, waiting for its compilation excluded. */
+  public long getEvaluateNanos() {
+    return evaluateNanos;
+  }
+
+  public long getNumInputRows() {
+    return numInputRows;
+  }
+
+  public long getNumOutputRows() {
+    return numOutputRows;
+  }
+
+  /** Keys of the hash table of a join, or groups of an aggregation. */
+  public long getHashTableSize() {
+    return hashTableSize;
+  }
+
+  /** Slots probed to find each key of the hash table, summed over the keys. */
+  public long getProbeChainLength() {
+    return probeChainLength;
+  }
+
+  public long getSpillBytes() {
+    return spillBytes;
+  }
+
+  /** Time waiting for the generated codes of the kernel to be compiled or loaded. */
+  public long getCodegenNanos() {
+    return codegenNanos;
+  }
+}
@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.oap.vectorized;
+
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import org.apache.spark.TaskContext;
+import org.apache.spark.memory.MemoryConsumer;
+import org.apache.spark.memory.TaskMemoryManager;
+import org.apache.spark.util.TaskCompletionListener;
+
+/**
+ * Native memory pool of a Spark task, whose allocations are reserved from the task memory
+ * manager. A reservation the manager can't grant, even after spilling other consumers,
+ * fails the native allocation with an OutOfMemory error instead of exceeding the memory
+ * of the executor.
+ */
+public class NativeMemoryPool extends MemoryConsumer implements ReservationListener {
+  // by task attempt id
+  private static final Map<Long, NativeMemoryPool> pools = new ConcurrentHashMap<>();
+
+  private final ExpressionEvaluatorJniWrapper jniWrapper;
+  private final long poolId;
+  // set once the task completed, the memory manager has released its memory then
+  private volatile boolean released = false;
+
+  private NativeMemoryPool(
+      TaskMemoryManager taskMemoryManager, ExpressionEvaluatorJniWrapper jniWrapper) {
+    super(taskMemoryManager, taskMemoryManager.pageSizeBytes(),
+        taskMemoryManager.getTungstenMemoryMode());
+    this.jniWrapper = jniWrapper;
+    this.poolId = jniWrapper.nativeCreateMemoryPool(this);
+  }
+
+  /**
+   * The native memory pool of the current task, made on first use and released when the
+   * task completes.
+   *
+   * @return The id of the pool, 0 if not run in a task
+   */
+  public static long getForCurrentTask(ExpressionEvaluatorJniWrapper jniWrapper) {
+    TaskContext context = TaskContext.get();
+    if (context == null) {
+      return 0;
+    }
+    return pools.computeIfAbsent(context.taskAttemptId(), id -> {
+      NativeMemoryPool pool =
+          new NativeMemoryPool(context.taskMemoryManager(), jniWrapper);
+      context.addTaskCompletionListener(new TaskCompletionListener() {
+        @Override
+        public void onTaskCompletion(TaskContext completed) {
+          pools.remove(id);
+          pool.release();
+        }
+      });
+      return pool;
+    }).poolId;
+  }
+
+  private void release() {
+    released = true;
+    jniWrapper.nativeReleaseMemoryPool(poolId);
+  }
+
+  @Override
+  public boolean reserve(long size) {
+    // kernels shared with other tasks, as a broadcast build, outlive the task
+    if (released) {
+      return true;
+    }
+    long granted = acquireMemory(size);
+    if (granted < size) {
+      freeMemory(granted);
+      return false;
+    }
+    return true;
+  }
+
+  @Override
+  public void unreserve(long size) {
+    if (!released) {
+      freeMemory(Math.min(size, getUsed()));
+    }
+  }
+
+  @Override
+  public long spill(long size, MemoryConsumer trigger) {
+    // a reservation of this pool spills its kernels itself when it is denied
+    if (released || trigger == this) {
+      return 0;
+    }
+    return jniWrapper.nativeSpillMemoryPool(poolId, size);
+  }
+}
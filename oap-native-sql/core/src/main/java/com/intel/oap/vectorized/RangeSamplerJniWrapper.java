@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.oap.vectorized;
+
+import java.io.IOException;
+
+public class RangeSamplerJniWrapper {
+
+  public RangeSamplerJniWrapper() throws IOException {
+    JniUtils.getInstance();
+  }
+
+  /**
+   * Make a uniform reservoir sample of the key rows of record batches, to compute the bounds of
+   * "range" partitioning natively.
+   *
+   * @param schemaBuf serialized arrow schema of the batches
+   * @param keyIndices indices of the key columns in the schema
+   * @param keyAscending sort direction of each key column, all ascending if empty
+   * @param keyNullsFirst null ordering of each key column, all nulls first if empty
+   * @param sampleSize maximum number of rows kept
+   * @param seed seed of the sampling
+   * @return native sampler instance id if created successfully.
+   * @throws RuntimeException
+   */
+  public native long make(byte[] schemaBuf, int[] keyIndices, boolean[] keyAscending,
+      boolean[] keyNullsFirst, int sampleSize, long seed) throws RuntimeException;
+
+  /**
+   * Offer the rows of one record batch represented by bufAddrs and bufSizes to the sample.
+   *
+   * @param samplerId
+   * @param numRows Rows per batch
+   * @param bufAddrs Addresses of buffers
+   * @param bufSizes Sizes of buffers
+   * @throws RuntimeException
+   */
+  public native void sample(long samplerId, int numRows, long[] bufAddrs, long[] bufSizes)
+      throws RuntimeException;
+
+  /**
+   * @return number of rows offered to the sample so far
+   */
+  public native long getNumRows(long samplerId);
+
+  /**
+   * Compute the range bounds from the sample, as Spark RangePartitioner does, to pass to
+   * {@link ShuffleSplitterJniWrapper#makeWithPartitioning}.
+   *
+   * @param samplerId
+   * @param numPartitions number of partitions
+   * @return the key columns of at most numPartitions - 1 bounds in the key order
+   * @throws RuntimeException
+   */
+  public native ArrowRecordBatchBuilder computeBounds(long samplerId, int numPartitions)
+      throws RuntimeException;
+
+  /**
+   * Release the native sampler.
+   *
+   * @param samplerId
+   */
+  public native void close(long samplerId);
+}
@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.oap.vectorized;
+
+import java.io.IOException;
+
+public class RowConverterJniWrapper {
+
+  public RowConverterJniWrapper() throws IOException {
+    JniUtils.getInstance();
+  }
+
+  /**
+   * Make a converter of record batches from and to UnsafeRows natively.
+   *
+   * @param schemaBuf serialized arrow schema of the batches, of boolean, integer,
+   *     floating point, date, timestamp, string, binary or decimal of up to 18 digits fields
+   * @param memoryPoolId native memory pool the batches and the rows are allocated from, 0
+   *     for the default one
+   * @return native converter instance id if created successfully.
+   * @throws RuntimeException
+   */
+  public native long make(byte[] schemaBuf, long memoryPoolId) throws RuntimeException;
+
+  /**
+   * Convert off-heap UnsafeRows into a record batch. The rows may be released once it
+   * returns.
+   *
+   * @param converterId
+   * @param rowAddrs Addresses of the rows
+   * @param rowSizes Sizes of the rows
+   * @return the record batch of the rows
+   * @throws RuntimeException
+   */
+  public native ArrowRecordBatchBuilder rowToColumnar(long converterId, long[] rowAddrs,
+      int[] rowSizes) throws RuntimeException;
+
+  /**
+   * Convert the rows of one record batch represented by bufAddrs and bufSizes into
+   * UnsafeRows, written one after the other into a native buffer.
+   *
+   * @param converterId
+   * @param numRows Rows per batch
+   * @param bufAddrs Addresses of buffers
+   * @param bufSizes Sizes of buffers
+   * @return the id of the rows buffer to pass to {@link #releaseRows}, its address, then the
+   *     offset of each row in it and the end of the last one
+   * @throws RuntimeException
+   */
+  public native long[] columnarToRow(long converterId, int numRows, long[] bufAddrs,
+      long[] bufSizes) throws RuntimeException;
+
+  /**
+   * Release the rows buffer of {@link #columnarToRow}.
+   *
+   * @param rowsId
+   */
+  public native void releaseRows(long rowsId);
+
+  /**
+   * Release the native converter.
+   *
+   * @param converterId
+   */
+  public native void close(long converterId);
+}
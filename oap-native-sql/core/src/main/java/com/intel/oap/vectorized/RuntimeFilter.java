@@ -0,0 +1,89 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.oap.vectorized;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * Filter of the keys of a join build side, built natively by {@link
+ * BatchIterator#getRuntimeFilter()}. The probe side scan uses it to skip the rows, or the
+ * row groups by their statistics, whose key can't match. Same layout and hashing as
+ * codegen/common/runtime_filter.h: a blocked Bloom filter of 256 bit blocks plus the
+ * range of the keys.
+ */
+public class RuntimeFilter {
+  private static final int WORDS_PER_BLOCK = 8;
+  private static final int[] SALTS = {
+    0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+    0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31
+  };
+
+  private final byte[] serialized;
+  private final long min;
+  private final long max;
+  private final long numBlocks;
+  private final int[] blocks;
+
+  public RuntimeFilter(byte[] serialized) {
+    this.serialized = serialized;
+    ByteBuffer buf = ByteBuffer.wrap(serialized).order(ByteOrder.LITTLE_ENDIAN);
+    min = buf.getLong();
+    max = buf.getLong();
+    numBlocks = buf.getLong();
+    blocks = new int[(int) numBlocks * WORDS_PER_BLOCK];
+    buf.asIntBuffer().get(blocks);
+  }
+
+  /** False if no build key equals key. */
+  public boolean mightContain(long key) {
+    if (key < min || key > max) {
+      return false;
+    }
+    long hash = hash(key);
+    int block = (int) (((hash >>> 32) * numBlocks) >>> 32) * WORDS_PER_BLOCK;
+    for (int i = 0; i < WORDS_PER_BLOCK; i++) {
+      int mask = 1 << ((((int) hash) * SALTS[i]) >>> 27);
+      if ((blocks[block + i] & mask) != mask) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** False if no build key lies in [min, max], e.g. the statistics of a row group. */
+  public boolean mightOverlap(long min, long max) {
+    return min <= this.max && max >= this.min;
+  }
+
+  /** Serialized form, as passed to the native parquet reader. */
+  public byte[] toBytes() {
+    return serialized;
+  }
+
+  private static long hash(long key) {
+    // murmur3 finalizer
+    long h = key;
+    h ^= h >>> 33;
+    h *= 0xff51afd7ed558ccdL;
+    h ^= h >>> 33;
+    h *= 0xc4ceb9fe1a85ec53L;
+    h ^= h >>> 33;
+    return h;
+  }
+}
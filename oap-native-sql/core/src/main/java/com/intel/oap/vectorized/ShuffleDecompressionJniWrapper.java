@@ -34,6 +34,16 @@ public class ShuffleDecompressionJniWrapper {
    */
   public native long make(byte[] schemaBuf) throws RuntimeException;
 
+  /**
+   * Decompress the buffers of each batch in parallel. Default is decompressing on the calling
+   * thread only.
+   *
+   * @param schemaHolderId
+   * @param numThreads number of threads decompressing one batch, the calling thread included
+   * @throws RuntimeException
+   */
+  public native void setNumThreads(long schemaHolderId, int numThreads) throws RuntimeException;
+
   public native ArrowRecordBatchBuilder decompress(
       long schemaHolderId,
       String compressionCodec,
@@ -0,0 +1,42 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.oap.vectorized;
+
+import java.io.IOException;
+
+public class ShuffleReaderJniWrapper {
+
+  public ShuffleReaderJniWrapper() throws IOException {
+    JniUtils.getInstance();
+  }
+
+  /**
+   * Construct native reader parsing and decompressing the IPC streams of fetched shuffle blocks.
+   * The blocks must stay valid until the iterator is closed and the batches it returned are
+   * released.
+   *
+   * @param schemaBuf serialized arrow schema of the streams, or null to take the schema of the
+   *     first stream
+   * @param blockAddrs addresses of the fetched blocks, in reading order
+   * @param blockSizes sizes of the fetched blocks
+   * @return native iterator id, to be wrapped in a {@link BatchIterator}
+   * @throws RuntimeException
+   */
+  public native long make(byte[] schemaBuf, long[] blockAddrs, long[] blockSizes)
+      throws RuntimeException;
+}
@@ -29,12 +29,40 @@ public class ShuffleSplitterJniWrapper {
    * Construct native splitter for shuffled RecordBatch over
    *
    * @param schemaBuf serialized arrow schema
+   * @param numPartitions number of partitions, partition ids must be in [0, numPartitions)
    * @param bufferSize size of native buffers hold by each partition writer
    * @return native splitter instance id if created successfully.
    * @throws RuntimeException
    */
-  public native long make(byte[] schemaBuf, long bufferSize, String localDirs)
-      throws RuntimeException;
+  public native long make(byte[] schemaBuf, int numPartitions, long bufferSize,
+      String localDirs) throws RuntimeException;
+
+  /**
+   * Construct native splitter assigning the rows to partitions by itself, so the split record
+   * batches do not carry a partition id column.
+   *
+   * @param schemaBuf serialized arrow schema, without partition id field
+   * @param numPartitions number of partitions
+   * @param partitioning "hash" for Spark HashPartitioning, "range" for RangePartitioning,
+   *     "round_robin" to send contiguous slices of each batch to consecutive partitions,
+   *     "single" to write each batch to partition 0 as is
+   * @param keyIndices "hash" and "range" only, indices of the key columns in the schema
+   * @param startPartition "round_robin" only, partition the first slice goes to
+   * @param numBoundRows "range" only, number of range bounds
+   * @param boundBufAddrs "range" only, addresses of the buffers of the range bounds, one column
+   *     per key column
+   * @param boundBufSizes "range" only, sizes of the buffers of the range bounds
+   * @param keyAscending "range" only, sort direction of each key column, all ascending if empty
+   * @param keyNullsFirst "range" only, null ordering of each key column, all nulls first if
+   *     empty
+   * @param bufferSize size of native buffers hold by each partition writer
+   * @return native splitter instance id if created successfully.
+   * @throws RuntimeException
+   */
+  public native long makeWithPartitioning(byte[] schemaBuf, int numPartitions,
+      String partitioning, int[] keyIndices, int startPartition, int numBoundRows,
+      long[] boundBufAddrs, long[] boundBufSizes, boolean[] keyAscending,
+      boolean[] keyNullsFirst, long bufferSize, String localDirs) throws RuntimeException;
 
   /**
    * Split one record batch represented by bufAddrs and bufSizes into several batches. The batch is
@@ -50,6 +78,20 @@ public class ShuffleSplitterJniWrapper {
   public native void split(long splitterId, int numRows, long[] bufAddrs, long[] bufSizes)
       throws RuntimeException;
 
+  /**
+   * Split several record batches in one call, as {@link #split} does each of them, so that the
+   * cost of the call is shared by the batches when they are small.
+   *
+   * @param splitterId
+   * @param numRows Rows of each batch
+   * @param bufAddrs Addresses of the buffers of each batch
+   * @param bufSizes Sizes of the buffers of each batch
+   * @throws RuntimeException
+   */
+  public native void splitBatches(
+      long splitterId, int[] numRows, long[][] bufAddrs, long[][] bufSizes)
+      throws RuntimeException;
+
   /**
    * Write the data remained in the buffers hold by native splitter to each partition's temporary
    * file. And stop processing splitting
@@ -77,6 +119,82 @@ public class ShuffleSplitterJniWrapper {
    */
   public native void setCompressionCodec(long splitterId, String codec);
 
+  /**
+   * Limit the memory buffered by the native splitter. When a split leaves more bytes buffered,
+   * the partitions holding the most memory are spilled first. Default is unlimited.
+   *
+   * @param splitterId
+   * @param memoryLimit in bytes, 0 means unlimited
+   */
+  public native void setMemoryLimit(long splitterId, long memoryLimit);
+
+  /**
+   * Compress and write spilled batches on native background threads while splitting continues.
+   * Must be called before the first split. Default is writing synchronously.
+   *
+   * @param splitterId
+   * @param numThreads number of writer threads, 0 to write synchronously
+   * @param maxInflightBytes split blocks once the batches waiting to be written hold more bytes
+   */
+  public native void setWriterThreads(long splitterId, int numThreads, long maxInflightBytes);
+
+  /**
+   * Spill the partitions holding the most memory first until at least size bytes are released.
+   * Called on request of the task memory manager.
+   *
+   * @param splitterId
+   * @param size bytes to release
+   * @return bytes actually released
+   * @throws RuntimeException
+   */
+  public native long spill(long splitterId, long size) throws RuntimeException;
+
+  /**
+   * Get the bytes of memory currently buffered by the native splitter.
+   *
+   * @param splitterId
+   * @return buffered bytes
+   */
+  public native long getBufferedBytes(long splitterId);
+
+  /**
+   * Write all partitions into one data file in partition id order instead of one temporary file
+   * per partition. Must be called before the first split.
+   *
+   * @param splitterId
+   * @param dataFile path of the data file, written when the splitter is stopped
+   */
+  public native void setDataFile(long splitterId, String dataFile);
+
+  /**
+   * Push the partitions to an RPMP server as they spill instead of writing them locally, each
+   * merged with the same partition of the other map tasks. Requires a native library built with
+   * RPMP. Must be called before the first split.
+   *
+   * @param splitterId
+   * @param address address of the RPMP server
+   * @param port port of the RPMP server
+   * @param app application the shuffle belongs to
+   * @param shuffleId shuffle id
+   * @param numConnections connections to the server
+   */
+  public native void setRpmpOutput(
+      long splitterId, String address, String port, String app, long shuffleId, int numConnections);
+
+  /**
+   * Put the partitions into a local pmemkv pool of RPMem-shuffle as they spill instead of writing
+   * them to files, each under the name of its ShuffleBlockId, shuffle_[shuffleId]_[mapId]_[pid].
+   * Requires a native library built with PMEMKV. Must be called before the first split.
+   *
+   * @param splitterId
+   * @param devicePath path of the pmemkv pool, created if it doesn't exist, not opened by a
+   *     PersistentMemoryPool of the same process
+   * @param shuffleId shuffle id
+   * @param mapId map id
+   */
+  public native void setPmemkvOutput(
+      long splitterId, String devicePath, long shuffleId, long mapId);
+
   /**
    * Get all files information created by the splitter. Used by the {@link
    * org.apache.spark.shuffle.ColumnarShuffleWriter} These files are temporarily existed and will be
@@ -87,6 +205,15 @@ public class ShuffleSplitterJniWrapper {
    */
   public native PartitionFileInfo[] getPartitionFileInfo(long splitterId);
 
+  /**
+   * Get the bytes of each partition in the data file set by {@link #setDataFile}, indexed by
+   * partition id. Only available after the splitter is stopped.
+   *
+   * @param splitterId
+   * @return length of each partition
+   */
+  public native long[] getPartitionLengths(long splitterId);
+
   /**
    * Get the total bytes written to disk.
    *
@@ -95,6 +222,57 @@ public class ShuffleSplitterJniWrapper {
    */
   public native long getTotalBytesWritten(long splitterId);
 
+  /**
+   * Get the nanoseconds spent in native split, including the spills written synchronously.
+   *
+   * @param splitterId
+   * @return split time in nanoseconds
+   */
+  public native long getTotalSplitTime(long splitterId);
+
+  /**
+   * Get the nanoseconds spent serializing and compressing batches, summed over the writer
+   * threads if any. Complete after the splitter is stopped.
+   *
+   * @param splitterId
+   * @return compress time in nanoseconds
+   */
+  public native long getTotalCompressTime(long splitterId);
+
+  /**
+   * Get the nanoseconds spent writing to disk, summed over the writer threads if any. Complete
+   * after the splitter is stopped.
+   *
+   * @param splitterId
+   * @return write time in nanoseconds
+   */
+  public native long getTotalWriteTime(long splitterId);
+
+  /**
+   * Get the number of partition buffer spills.
+   *
+   * @param splitterId
+   * @return number of spills
+   */
+  public native long getTotalSpills(long splitterId);
+
+  /**
+   * Get the bytes written for each partition, indexed by partition id.
+   *
+   * @param splitterId
+   * @return bytes of each partition
+   */
+  public native long[] getPartitionBytesWritten(long splitterId);
+
+  /**
+   * Get the rows written for each partition, indexed by partition id. Complete after the splitter
+   * is stopped.
+   *
+   * @param splitterId
+   * @return rows of each partition
+   */
+  public native long[] getPartitionRowsWritten(long splitterId);
+
   /**
    * Release resources associated with designated splitter instance.
    *
@@ -31,6 +31,61 @@ class ColumnarPluginConfig(conf: SparkConf) {
     conf.getInt("spark.sql.execution.arrow.maxRecordsPerBatch", defaultValue = 10000)
   val tmpFile: String =
     conf.getOption("spark.sql.columnar.tmp_dir").getOrElse(null)
+  val kernelStore: String =
+    conf.getOption("spark.sql.columnar.codegen.kernelStore").getOrElse(null)
+  val warmUpSignatures: Array[String] = conf
+    .get("spark.sql.columnar.codegen.warmUpSignatures", "")
+    .split(",")
+    .map(_.trim)
+    .filter(_.nonEmpty)
+  val joinMemoryBudget: Long =
+    conf.getSizeAsBytes("spark.sql.columnar.join.memoryBudget", "0")
+  val joinBuildThreads: Int =
+    conf.getInt("spark.sql.columnar.join.buildThreads", defaultValue = 1)
+  val sortThreads: Int =
+    conf.getInt("spark.sql.columnar.sort.threads", defaultValue = 1)
+  val aggregateThreads: Int =
+    conf.getInt("spark.sql.columnar.aggregate.threads", defaultValue = 1)
+  // threads of the native task scheduler shared by the kernels of all the tasks of the
+  // executor, and the threads of it a single kernel runs on at most, 0 for all of them
+  val executorThreads: Int = conf.getInt(
+    "spark.sql.columnar.executor.threads",
+    defaultValue = conf.getInt("spark.executor.cores", defaultValue = 0))
+  val taskParallelism: Int =
+    conf.getInt("spark.sql.columnar.task.parallelism", defaultValue = 0)
+  // bytes from which the allocations of the native kernels, e.g. their hash tables and
+  // sort indices, are backed by 2MB pages, reserved ones first if explicit, on the NUMA
+  // node of the allocating thread if numaBind, 0 to never
+  val largePageThreshold: Long =
+    conf.getSizeAsBytes("spark.sql.columnar.largePages.threshold", "0")
+  val largePageExplicit: Boolean =
+    conf.getBoolean("spark.sql.columnar.largePages.explicit", defaultValue = false)
+  val largePageNumaBind: Boolean =
+    conf.getBoolean("spark.sql.columnar.largePages.numaBind", defaultValue = true)
+  // sorts of common key shapes run a sorter compiled into the library, without codegen
+  val precompiledKernels: Boolean =
+    conf.getBoolean("spark.sql.columnar.codegen.precompiledKernels", defaultValue = true)
+  // row groups a parquet reader fetches ahead in the background, 0 to read synchronously
+  val parquetPrefetchRowGroups: Int =
+    conf.getInt("spark.sql.columnar.parquet.prefetchRowGroups", defaultValue = 0)
+  // requests a parquet reader fetching the column chunks of a row group at once keeps
+  // in flight, merging the chunks at most holeSizeLimit apart up to rangeSizeLimit, 0
+  // reads each chunk on its own
+  val parquetCoalescedReadThreads: Int =
+    conf.getInt("spark.sql.columnar.parquet.coalescedReads.ioThreads", defaultValue = 0)
+  val parquetCoalescedReadHoleSizeLimit: Long = conf.getSizeAsBytes(
+    "spark.sql.columnar.parquet.coalescedReads.holeSizeLimit", "1m")
+  val parquetCoalescedReadRangeSizeLimit: Long = conf.getSizeAsBytes(
+    "spark.sql.columnar.parquet.coalescedReads.rangeSizeLimit", "64m")
+  // threads of the executor decoding the columns of the parquet row groups, 0 is serial
+  val parquetDecodeThreads: Int =
+    conf.getInt("spark.sql.columnar.parquet.decodeThreads", defaultValue = 0)
+  // the parquet scan decodes the pushed filter columns first, then the matching rows
+  val enableParquetLateMaterialization: Boolean =
+    conf.getBoolean("spark.sql.columnar.parquet.lateMaterialization", defaultValue = false)
+  // native kernels reserve their memory from the task memory manager
+  val enableTaskMemoryPool: Boolean =
+    conf.getBoolean("spark.sql.columnar.taskMemoryPool", defaultValue = true)
 }
 
 object ColumnarPluginConfig {
@@ -57,6 +112,139 @@ object ColumnarPluginConfig {
       ins.batchSize
     }
   }
+  def getKernelStore: String = synchronized {
+    if (ins == null) {
+      null
+    } else {
+      ins.kernelStore
+    }
+  }
+  def getJoinMemoryBudget: Long = synchronized {
+    if (ins == null) {
+      0
+    } else {
+      ins.joinMemoryBudget
+    }
+  }
+  def getJoinBuildThreads: Int = synchronized {
+    if (ins == null) {
+      1
+    } else {
+      ins.joinBuildThreads
+    }
+  }
+  def getSortThreads: Int = synchronized {
+    if (ins == null) {
+      1
+    } else {
+      ins.sortThreads
+    }
+  }
+  def getAggregateThreads: Int = synchronized {
+    if (ins == null) {
+      1
+    } else {
+      ins.aggregateThreads
+    }
+  }
+  def getExecutorThreads: Int = synchronized {
+    if (ins == null) {
+      0
+    } else {
+      ins.executorThreads
+    }
+  }
+  def getTaskParallelism: Int = synchronized {
+    if (ins == null) {
+      0
+    } else {
+      ins.taskParallelism
+    }
+  }
+  def getLargePageThreshold: Long = synchronized {
+    if (ins == null) {
+      0
+    } else {
+      ins.largePageThreshold
+    }
+  }
+  def getLargePageExplicit: Boolean = synchronized {
+    if (ins == null) {
+      false
+    } else {
+      ins.largePageExplicit
+    }
+  }
+  def getLargePageNumaBind: Boolean = synchronized {
+    if (ins == null) {
+      true
+    } else {
+      ins.largePageNumaBind
+    }
+  }
+  def getPrecompiledKernels: Boolean = synchronized {
+    if (ins == null) {
+      true
+    } else {
+      ins.precompiledKernels
+    }
+  }
+  def getParquetPrefetchRowGroups: Int = synchronized {
+    if (ins == null) {
+      0
+    } else {
+      ins.parquetPrefetchRowGroups
+    }
+  }
+  def getParquetCoalescedReadThreads: Int = synchronized {
+    if (ins == null) {
+      0
+    } else {
+      ins.parquetCoalescedReadThreads
+    }
+  }
+  def getParquetCoalescedReadHoleSizeLimit: Long = synchronized {
+    if (ins == null) {
+      1L << 20
+    } else {
+      ins.parquetCoalescedReadHoleSizeLimit
+    }
+  }
+  def getParquetCoalescedReadRangeSizeLimit: Long = synchronized {
+    if (ins == null) {
+      64L << 20
+    } else {
+      ins.parquetCoalescedReadRangeSizeLimit
+    }
+  }
+  def getParquetDecodeThreads: Int = synchronized {
+    if (ins == null) {
+      0
+    } else {
+      ins.parquetDecodeThreads
+    }
+  }
+  def getEnableParquetLateMaterialization: Boolean = synchronized {
+    if (ins == null) {
+      false
+    } else {
+      ins.enableParquetLateMaterialization
+    }
+  }
+  def getEnableTaskMemoryPool: Boolean = synchronized {
+    if (ins == null) {
+      false
+    } else {
+      ins.enableTaskMemoryPool
+    }
+  }
+  def getWarmUpSignatures: Array[String] = synchronized {
+    if (ins == null) {
+      Array.empty[String]
+    } else {
+      ins.warmUpSignatures
+    }
+  }
   def getTempFile: String = synchronized {
     if (ins != null) {
       ins.tmpFile
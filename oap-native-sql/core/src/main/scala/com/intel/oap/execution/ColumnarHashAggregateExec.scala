@@ -80,7 +80,8 @@ class ColumnarHashAggregateExec(
     "numInputBatches" -> SQLMetrics.createMetric(sparkContext, "number of Input batches"),
     "aggTime" -> SQLMetrics.createTimingMetric(sparkContext, "time in aggregation process"),
     "elapseTime" -> SQLMetrics
-      .createTimingMetric(sparkContext, "elapse time from very begin to this process"))
+      .createTimingMetric(sparkContext, "elapse time from very begin to this process")) ++
+    ColumnarKernelMetrics.create(sparkContext)
 
   override def doExecuteColumnar(): RDD[ColumnarBatch] = {
     val numOutputRows = longMetric("numOutputRows")
@@ -88,6 +89,7 @@ class ColumnarHashAggregateExec(
     val numInputBatches = longMetric("numInputBatches")
     val aggTime = longMetric("aggTime")
     val elapseTime = longMetric("elapseTime")
+    val kernelMetrics = new ColumnarKernelMetrics(metrics)
     numOutputRows.set(0)
     numOutputBatches.set(0)
     numInputBatches.set(0)
@@ -116,6 +118,7 @@ class ColumnarHashAggregateExec(
               numOutputRows,
               aggTime,
               elapseTime,
+              kernelMetrics,
               sparkConf)
           TaskContext
             .get()
@@ -68,7 +68,8 @@ class ColumnarShuffledHashJoinExec(
   override lazy val metrics = Map(
     "numOutputRows" -> SQLMetrics.createMetric(sparkContext, "number of output rows"),
     "joinTime" -> SQLMetrics.createTimingMetric(sparkContext, "join time"),
-    "buildTime" -> SQLMetrics.createTimingMetric(sparkContext, "time to build hash map"))
+    "buildTime" -> SQLMetrics.createTimingMetric(sparkContext, "time to build hash map")) ++
+    ColumnarKernelMetrics.create(sparkContext)
 
   override def supportsColumnar = true
 
@@ -79,6 +80,7 @@ class ColumnarShuffledHashJoinExec(
     val numOutputRows = longMetric("numOutputRows")
     val joinTime = longMetric("joinTime")
     val buildTime = longMetric("buildTime")
+    val kernelMetrics = new ColumnarKernelMetrics(metrics)
     val resultSchema = this.schema
     streamedPlan.executeColumnar().zipPartitions(buildPlan.executeColumnar()) {
       (streamIter, buildIter) =>
@@ -96,6 +98,7 @@ class ColumnarShuffledHashJoinExec(
           buildTime,
           joinTime,
           numOutputRows,
+          kernelMetrics,
           sparkConf)
         val vjoinResult = vjoin.columnarInnerJoin(streamIter, buildIter)
         TaskContext
@@ -71,6 +71,7 @@ class ColumnarGroupbyHashAggregation(
     numOutputRows: SQLMetric,
     aggrTime: SQLMetric,
     elapseTime: SQLMetric,
+    kernelMetrics: ColumnarKernelMetrics,
     sparkConf: SparkConf)
     extends Logging {
   // build gandiva projection here.
@@ -145,8 +146,14 @@ class ColumnarGroupbyHashAggregation(
       })
       .asJava,
     resultType /*dummy ret type, won't be used*/ )
+  // the groups of a partial aggregation are merged again after the shuffle, which lets
+  // it pass through the rows of keys that are nearly all distinct
+  val nativeAggrFuncName = mode match {
+    case Partial | PartialMerge => "hashAggregateArraysPartial"
+    case _ => "hashAggregateArrays"
+  }
   val nativeAggrNode = TreeBuilder.makeFunction(
-    "hashAggregateArrays",
+    nativeAggrFuncName,
     nativeFuncNodes.asJava,
     resultType /*dummy ret type, won't be used*/ )
   val nativeCodeGenNode = TreeBuilder.makeFunction(
@@ -192,6 +199,15 @@ class ColumnarGroupbyHashAggregation(
     node
   }
 
+  // the decimal result of an action has the precision and scale of Spark's, the
+  // result type of the other actions is not used
+  def getActionResultType(aggregateFunc: AggregateFunction): ArrowType = {
+    aggregateFunc.dataType match {
+      case d: DecimalType => CodeGeneration.getResultType(d)
+      case _ => resultType
+    }
+  }
+
   def getColumnarFuncNode(aggregateExpression: AggregateExpression): TreeNode = {
     val aggregateFunc = aggregateExpression.aggregateFunction
     val mode = aggregateExpression.mode
@@ -212,7 +228,7 @@ class ColumnarGroupbyHashAggregation(
             TreeBuilder.makeFunction(
               "action_avgByCount",
               childrenColumnarFuncNodeList.asJava,
-              resultType)
+              getActionResultType(aggregateFunc))
         }
       case Sum(_) =>
         val childrenColumnarFuncNodeList =
@@ -222,7 +238,10 @@ class ColumnarGroupbyHashAggregation(
             case Final =>
               List(inputAttrQueue.dequeue).map(attr => getColumnarFuncNode(attr))
           }
-        TreeBuilder.makeFunction("action_sum", childrenColumnarFuncNodeList.asJava, resultType)
+        TreeBuilder.makeFunction(
+          "action_sum",
+          childrenColumnarFuncNodeList.asJava,
+          getActionResultType(aggregateFunc))
       case Count(_) =>
         mode match {
           case Partial | PartialMerge =>
@@ -313,6 +332,7 @@ class ColumnarGroupbyHashAggregation(
 
   def close(): Unit = {
     if (aggregator != null) {
+      kernelMetrics.update(aggregator)
       aggregator.close()
       aggregator = null
     }
@@ -455,6 +475,7 @@ object ColumnarGroupbyHashAggregation {
       numOutputRows: SQLMetric,
       aggrTime: SQLMetric,
       elapseTime: SQLMetric,
+      kernelMetrics: ColumnarKernelMetrics,
       sparkConf: SparkConf): ColumnarGroupbyHashAggregation = synchronized {
     columnarAggregation = new ColumnarGroupbyHashAggregation(
       partIndex,
@@ -469,6 +490,7 @@ object ColumnarGroupbyHashAggregation {
       numOutputRows,
       aggrTime,
       elapseTime,
+      kernelMetrics,
       sparkConf)
     columnarAggregation
   }
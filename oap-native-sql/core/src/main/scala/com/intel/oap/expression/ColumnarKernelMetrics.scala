@@ -0,0 +1,61 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.oap.expression
+
+import java.util.concurrent.TimeUnit._
+
+import com.intel.oap.vectorized.ExpressionEvaluator
+
+import org.apache.spark.SparkContext
+import org.apache.spark.sql.execution.metric.{SQLMetric, SQLMetrics}
+
+/**
+ * SQL metrics of the native kernels of an operator, set from
+ * [[ExpressionEvaluator.getMetrics]] once the task is done with the evaluator.
+ */
+class ColumnarKernelMetrics(metrics: Map[String, SQLMetric]) extends Serializable {
+  private val codegenTime = metrics("codegenTime")
+  private val hashTableSize = metrics("hashTableSize")
+  private val avgHashProbe = metrics("avgHashProbe")
+  private val spillSize = metrics("spillSize")
+
+  def update(evaluator: ExpressionEvaluator): Unit = {
+    var keys = 0L
+    var probes = 0L
+    evaluator.getMetrics.foreach { kernel =>
+      codegenTime += NANOSECONDS.toMillis(kernel.getCodegenNanos)
+      spillSize += kernel.getSpillBytes
+      keys += kernel.getHashTableSize
+      probes += kernel.getProbeChainLength
+    }
+    hashTableSize += keys
+    if (keys > 0 && probes > 0) {
+      avgHashProbe.set(probes.toDouble / keys)
+    }
+  }
+}
+
+object ColumnarKernelMetrics {
+  def create(sparkContext: SparkContext): Map[String, SQLMetric] = Map(
+    "codegenTime" -> SQLMetrics
+      .createTimingMetric(sparkContext, "time to compile or load native kernels"),
+    "hashTableSize" -> SQLMetrics.createMetric(sparkContext, "number of hash table keys"),
+    "avgHashProbe" -> SQLMetrics
+      .createAverageMetric(sparkContext, "avg hash probes per key"),
+    "spillSize" -> SQLMetrics.createSizeMetric(sparkContext, "spill size"))
+}
@@ -69,6 +69,7 @@ class ColumnarShuffledHashJoin(
     buildTime: SQLMetric,
     joinTime: SQLMetric,
     totalOutputNumRows: SQLMetric,
+    kernelMetrics: ColumnarKernelMetrics,
     sparkConf: SparkConf)
     extends Logging {
   ColumnarPluginConfig.getConf(sparkConf)
@@ -315,8 +316,31 @@ class ColumnarShuffledHashJoin(
     buildTime += NANOSECONDS.toMillis(System.nanoTime() - beforeBuild)
 
     new Iterator[ColumnarBatch] {
+      // batch of the remaining matches of the last stream batch, or of the partitions a
+      // grace hash join spilled, joined once the stream is over
+      var spilled_rb: ArrowRecordBatch = null
+      // last stream batch, kept until the prober returned all of its matches
+      var pending_stream_rb: ArrowRecordBatch = null
+
       override def hasNext: Boolean = {
-        if (streamIter.hasNext) {
+        if (pending_stream_rb != null && spilled_rb == null) {
+          val beforeJoin = System.nanoTime()
+          spilled_rb = probe_iterator.processRemaining()
+          joinTime += NANOSECONDS.toMillis(System.nanoTime() - beforeJoin)
+          if (spilled_rb == null) {
+            ConverterUtils.releaseArrowRecordBatch(pending_stream_rb)
+            pending_stream_rb = null
+          }
+        }
+        if (spilled_rb != null || streamIter.hasNext) {
+          return true
+        }
+        if (spilled_rb == null) {
+          val beforeJoin = System.nanoTime()
+          spilled_rb = probe_iterator.next()
+          joinTime += NANOSECONDS.toMillis(System.nanoTime() - beforeJoin)
+        }
+        if (spilled_rb != null) {
           true
         } else {
           inputBatchHolder.foreach(cb => cb.close())
@@ -325,14 +349,21 @@ class ColumnarShuffledHashJoin(
       }
 
       override def next(): ColumnarBatch = {
-        val cb = streamIter.next()
-        last_cb = cb
-        val beforeJoin = System.nanoTime()
-        val stream_rb: ArrowRecordBatch = ConverterUtils.createArrowRecordBatch(cb)
-        val output_rb = probe_iterator.process(stream_input_arrow_schema, stream_rb)
-
-        ConverterUtils.releaseArrowRecordBatch(stream_rb)
-        joinTime += NANOSECONDS.toMillis(System.nanoTime() - beforeJoin)
+        val output_rb = if (spilled_rb != null) {
+          val rb = spilled_rb
+          spilled_rb = null
+          rb
+        } else {
+          val cb = streamIter.next()
+          last_cb = cb
+          val beforeJoin = System.nanoTime()
+          val stream_rb: ArrowRecordBatch = ConverterUtils.createArrowRecordBatch(cb)
+          val rb = probe_iterator.process(stream_input_arrow_schema, stream_rb)
+          // matches of hot keys are returned by processRemaining from the stream batch
+          pending_stream_rb = stream_rb
+          joinTime += NANOSECONDS.toMillis(System.nanoTime() - beforeJoin)
+          rb
+        }
         if (output_rb == null) {
           val resultColumnVectors =
             ArrowWritableColumnVector.allocateColumns(0, resultSchema).toArray
@@ -350,6 +381,7 @@ class ColumnarShuffledHashJoin(
 
   def close(): Unit = {
     if (prober != null) {
+      kernelMetrics.update(prober)
       prober.close()
       prober = null
     }
@@ -374,6 +406,7 @@ object ColumnarShuffledHashJoin {
       buildTime: SQLMetric,
       joinTime: SQLMetric,
       numOutputRows: SQLMetric,
+      kernelMetrics: ColumnarKernelMetrics,
       sparkConf: SparkConf): ColumnarShuffledHashJoin = synchronized {
     columnarShuffedHahsJoin = new ColumnarShuffledHashJoin(
       leftKeys,
@@ -387,6 +420,7 @@ object ColumnarShuffledHashJoin {
       buildTime,
       joinTime,
       numOutputRows,
+      kernelMetrics,
       sparkConf)
     columnarShuffedHahsJoin
   }
@@ -62,6 +62,8 @@ private class ArrowColumnarBatchSerializerInstance(readBatchNumRows: SQLMetric)
       private val compressionEnabled =
         SparkEnv.get.conf.getBoolean("spark.shuffle.compress", true)
       private val compressionCodec = SparkEnv.get.conf.get("spark.io.compression.codec", "lz4")
+      private val decompressThreads =
+        SQLConf.get.getConfString("spark.sql.columnar.shuffle.decompressThreads", "1").toInt
       private val allocator: BufferAllocator = ArrowUtils.rootAllocator
         .newChildAllocator("ArrowColumnarBatch deserialize", 0, Long.MaxValue)
 
@@ -165,6 +167,9 @@ private class ArrowColumnarBatchSerializerInstance(readBatchNumRows: SQLMetric)
         if (jniWrapper == null) {
           jniWrapper = new ShuffleDecompressionJniWrapper
           schemaHolderId = jniWrapper.make(SchemaUtils.get.serialize(root.getSchema))
+          if (decompressThreads > 1) {
+            jniWrapper.setNumThreads(schemaHolderId, decompressThreads)
+          }
         }
         if (vectorLoader == null) {
           vectorLoader = new VectorLoader(root)
@@ -40,6 +40,13 @@ import scala.reflect.ClassTag
  * @param shuffleWriterProcessor the processor to control the write behavior in ShuffleMapTask
  * @param serializedSchema serialized [[org.apache.arrow.vector.types.pojo.Schema]] for ColumnarBatch
  * @param dataSize for shuffle data size tracking
+ * @param splitTime for native split time tracking
+ * @param compressTime for native compression time tracking
+ * @param numSpills for native partition buffer spills tracking
+ * @param nativePartitioning "hash", "round_robin" or "single" if the native splitter assigns
+ *                           the rows to partitions, in which case serializedSchema has no
+ *                           partition id field. Empty if the first column is the partition id.
+ * @param nativeHashKeys indices of the key columns for "hash" native partitioning
  */
 class ColumnarShuffleDependency[K: ClassTag, V: ClassTag, C: ClassTag](
     @transient private val _rdd: RDD[_ <: Product2[K, V]],
@@ -51,7 +58,11 @@ class ColumnarShuffleDependency[K: ClassTag, V: ClassTag, C: ClassTag](
     override val shuffleWriterProcessor: ShuffleWriteProcessor = new ShuffleWriteProcessor,
     val serializedSchema: Array[Byte],
     val dataSize: SQLMetric,
-    val splitTime: SQLMetric)
+    val splitTime: SQLMetric,
+    val compressTime: SQLMetric,
+    val numSpills: SQLMetric,
+    val nativePartitioning: String = "",
+    val nativeHashKeys: Array[Int] = Array.empty[Int])
     extends ShuffleDependency[K, V, C](
       _rdd,
       partitioner,
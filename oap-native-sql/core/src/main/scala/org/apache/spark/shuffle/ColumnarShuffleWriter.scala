@@ -19,6 +19,7 @@ package org.apache.spark.shuffle
 
 import java.io.{File, FileInputStream, FileOutputStream, IOException}
 import java.nio.ByteBuffer
+import java.util.Random
 
 import com.google.common.annotations.VisibleForTesting
 import com.google.common.io.Closeables
@@ -30,6 +31,7 @@ import org.apache.arrow.util.SchemaUtils
 import org.apache.arrow.vector.types.pojo.Schema
 import org.apache.spark._
 import org.apache.spark.internal.Logging
+import org.apache.spark.memory.{MemoryConsumer, TaskMemoryManager}
 import org.apache.spark.scheduler.MapStatus
 import org.apache.spark.sql.vectorized.ColumnarBatch
 import org.apache.spark.util.Utils
@@ -62,6 +64,13 @@ class ColumnarShuffleWriter[K, V](
   private val compressionCodec = conf.get("spark.io.compression.codec", "lz4")
   private val nativeBufferSize =
     conf.getLong("spark.sql.execution.arrow.maxRecordsPerBatch", 4096)
+  private val consolidateOutput =
+    conf.getBoolean("spark.sql.columnar.shuffle.consolidateOutput", false)
+  private val nativeMemoryLimit =
+    conf.getSizeAsBytes("spark.sql.columnar.shuffle.memoryLimit", "0")
+  private val nativeWriterThreads = conf.getInt("spark.sql.columnar.shuffle.writerThreads", 0)
+  private val nativeMaxInflightBytes =
+    conf.getSizeAsBytes("spark.sql.columnar.shuffle.maxInflightBytes", "64m")
 
   private val jniWrapper = new ShuffleSplitterJniWrapper()
 
@@ -69,8 +78,50 @@ class ColumnarShuffleWriter[K, V](
 
   private var partitionLengths: Array[Long] = _
 
+  // tracks the native buffers in task memory manager, absent if not run in a task
+  private val memoryConsumer = Option(TaskContext.get()).map { context =>
+    new SplitterMemoryConsumer(context.taskMemoryManager())
+  }
+
+  private class SplitterMemoryConsumer(taskMemoryManager: TaskMemoryManager)
+      extends MemoryConsumer(
+        taskMemoryManager,
+        taskMemoryManager.pageSizeBytes(),
+        taskMemoryManager.getTungstenMemoryMode) {
+
+    override def spill(size: Long, trigger: MemoryConsumer): Long = {
+      if (nativeSplitter == 0) {
+        return 0L
+      }
+      val released = jniWrapper.spill(nativeSplitter, size)
+      freeMemory(math.min(released, getUsed))
+      released
+    }
+
+    // acquire the memory newly buffered by native splitter, spill it if not granted
+    def acquireBuffered(): Unit = {
+      val buffered = jniWrapper.getBufferedBytes(nativeSplitter)
+      if (buffered > getUsed) {
+        val required = buffered - getUsed
+        val granted = acquireMemory(required)
+        if (granted < required) {
+          jniWrapper.spill(nativeSplitter, required - granted)
+        }
+      }
+      val held = jniWrapper.getBufferedBytes(nativeSplitter)
+      if (held < getUsed) {
+        freeMemory(getUsed - held)
+      }
+    }
+
+    def freeAll(): Unit = freeMemory(getUsed)
+  }
+
   @throws[IOException]
   override def write(records: Iterator[Product2[K, V]]): Unit = {
+    val output = shuffleBlockResolver.getDataFile(dep.shuffleId, mapId)
+    val tmp = Utils.tempFileWith(output)
+
     if (!records.hasNext) {
       partitionLengths = new Array[Long](dep.partitioner.numPartitions)
       shuffleBlockResolver.writeIndexFileAndCommit(dep.shuffleId, mapId, partitionLengths, null)
@@ -81,11 +132,44 @@ class ColumnarShuffleWriter[K, V](
     if (nativeSplitter == 0) {
       val schema: Schema = Schema.deserialize(ByteBuffer.wrap(dep.serializedSchema))
       val localDirs = Utils.getConfiguredLocalDirs(conf).mkString(",")
-      nativeSplitter =
-        jniWrapper.make(SchemaUtils.get.serialize(schema), nativeBufferSize, localDirs)
+      nativeSplitter = if (dep.nativePartitioning.nonEmpty) {
+        // same start as Spark round robin, which also begins after a random partition
+        val numPartitions = dep.partitioner.numPartitions
+        val startPartition =
+          (new Random(TaskContext.get().partitionId()).nextInt(numPartitions) + 1) %
+            numPartitions
+        jniWrapper.makeWithPartitioning(
+          SchemaUtils.get.serialize(schema),
+          numPartitions,
+          dep.nativePartitioning,
+          dep.nativeHashKeys,
+          startPartition,
+          0,
+          Array.empty[Long],
+          Array.empty[Long],
+          Array.empty[Boolean],
+          Array.empty[Boolean],
+          nativeBufferSize,
+          localDirs)
+      } else {
+        jniWrapper.make(
+          SchemaUtils.get.serialize(schema),
+          dep.partitioner.numPartitions,
+          nativeBufferSize,
+          localDirs)
+      }
       if (compressionEnabled) {
         jniWrapper.setCompressionCodec(nativeSplitter, compressionCodec)
       }
+      if (consolidateOutput) {
+        jniWrapper.setDataFile(nativeSplitter, tmp.getAbsolutePath)
+      }
+      if (nativeMemoryLimit > 0) {
+        jniWrapper.setMemoryLimit(nativeSplitter, nativeMemoryLimit)
+      }
+      if (nativeWriterThreads > 0) {
+        jniWrapper.setWriterThreads(nativeSplitter, nativeWriterThreads, nativeMaxInflightBytes)
+      }
     }
 
     while (records.hasNext) {
@@ -108,6 +192,7 @@ class ColumnarShuffleWriter[K, V](
 
         val startTime = System.nanoTime()
         jniWrapper.split(nativeSplitter, cb.numRows, bufAddrs.toArray, bufSizes.toArray)
+        memoryConsumer.foreach(_.acquireBuffered())
         dep.splitTime.add(System.nanoTime() - startTime)
         writeMetrics.incRecordsWritten(1)
       }
@@ -117,11 +202,20 @@ class ColumnarShuffleWriter[K, V](
     jniWrapper.stop(nativeSplitter)
     dep.splitTime.add(System.nanoTime() - startTime)
     writeMetrics.incBytesWritten(jniWrapper.getTotalBytesWritten(nativeSplitter))
+    writeMetrics.incWriteTime(jniWrapper.getTotalWriteTime(nativeSplitter))
+    dep.compressTime.add(jniWrapper.getTotalCompressTime(nativeSplitter))
+    dep.numSpills.add(jniWrapper.getTotalSpills(nativeSplitter))
 
-    val output = shuffleBlockResolver.getDataFile(dep.shuffleId, mapId)
-    val tmp = Utils.tempFileWith(output)
     try {
-      partitionLengths = writePartitionedFile(tmp)
+      partitionLengths = if (consolidateOutput) {
+        // native splitter has written all partitions to tmp in partition id order
+        val lengths = new Array[Long](dep.partitioner.numPartitions)
+        val nativeLengths = jniWrapper.getPartitionLengths(nativeSplitter)
+        System.arraycopy(nativeLengths, 0, lengths, 0, nativeLengths.length)
+        lengths
+      } else {
+        writePartitionedFile(tmp)
+      }
       shuffleBlockResolver.writeIndexFileAndCommit(dep.shuffleId, mapId, partitionLengths, tmp)
     } finally {
       if (tmp.exists() && !tmp.delete()) {
@@ -159,6 +253,7 @@ class ColumnarShuffleWriter[K, V](
             }
           }
         } finally {
+          memoryConsumer.foreach(_.freeAll())
           jniWrapper.close(nativeSplitter)
           nativeSplitter = 0
         }
@@ -37,6 +37,7 @@ import org.apache.spark.sql.catalyst.expressions.{
   Attribute,
   AttributeReference,
   BoundReference,
+  Expression,
   UnsafeProjection
 }
 import org.apache.spark.sql.catalyst.plans.physical._
@@ -49,7 +50,7 @@ import org.apache.spark.sql.execution.metric.{
   SQLShuffleWriteMetricsReporter
 }
 import org.apache.spark.sql.internal.SQLConf
-import org.apache.spark.sql.types.{IntegerType, StructField, StructType}
+import org.apache.spark.sql.types._
 import org.apache.spark.sql.vectorized.ColumnarBatch
 import org.apache.spark.util.MutablePair
 
@@ -68,6 +69,8 @@ class ColumnarShuffleExchangeExec(
   override lazy val metrics: Map[String, SQLMetric] = Map(
     "dataSize" -> SQLMetrics.createSizeMetric(sparkContext, "data size"),
     "splitTime" -> SQLMetrics.createNanoTimingMetric(sparkContext, "split time"),
+    "compressTime" -> SQLMetrics.createNanoTimingMetric(sparkContext, "compress time"),
+    "numSpills" -> SQLMetrics.createMetric(sparkContext, "number of spills"),
     "avgReadBatchNumRows" -> SQLMetrics
       .createAverageMetric(sparkContext, "avg read batch num rows")) ++ readMetrics ++ writeMetrics
 
@@ -89,7 +92,9 @@ class ColumnarShuffleExchangeExec(
       serializer,
       writeMetrics,
       longMetric("dataSize"),
-      longMetric("splitTime"))
+      longMetric("splitTime"),
+      longMetric("compressTime"),
+      longMetric("numSpills"))
   }
 
   def createColumnarShuffledRDD(
@@ -116,11 +121,39 @@ object ColumnarShuffleExchangeExec extends Logging {
       serializer: Serializer,
       writeMetrics: Map[String, SQLMetric],
       dataSize: SQLMetric,
-      splitTime: SQLMetric): ShuffleDependency[Int, ColumnarBatch, ColumnarBatch] = {
+      splitTime: SQLMetric,
+      compressTime: SQLMetric,
+      numSpills: SQLMetric): ShuffleDependency[Int, ColumnarBatch, ColumnarBatch] = {
+
+    // Key column indices if the native splitter computes the partition ids of
+    // HashPartitioning itself, which saves the row-wise projection and the pid column
+    val nativeHashKeys: Array[Int] = newPartitioning match {
+      case h: HashPartitioning
+          if SQLConf.get.getConfString(
+            "spark.sql.columnar.shuffle.nativeHashPartitioning", "false").toBoolean =>
+        nativeHashKeyIndices(h.expressions, outputAttributes)
+      case _ => Array.empty[Int]
+    }
+
+    // Partitioning done by the native splitter, empty if the pid column is pushed front
+    val nativePartitioning: String = newPartitioning match {
+      case _: HashPartitioning if nativeHashKeys.nonEmpty => "hash"
+      // slices instead of single rows go round robin, the distribution differs from Spark
+      case _: RoundRobinPartitioning
+          if SQLConf.get.getConfString(
+            "spark.sql.columnar.shuffle.nativeRoundRobinPartitioning", "false").toBoolean =>
+        "round_robin"
+      case SinglePartition => "single"
+      case _ => ""
+    }
 
     val arrowSchema: Schema =
-      ConverterUtils.toArrowSchema(
-        AttributeReference("pid", IntegerType, nullable = false)() +: outputAttributes)
+      if (nativePartitioning.nonEmpty) {
+        ConverterUtils.toArrowSchema(outputAttributes)
+      } else {
+        ConverterUtils.toArrowSchema(
+          AttributeReference("pid", IntegerType, nullable = false)() +: outputAttributes)
+      }
 
     val part: Partitioner = newPartitioning match {
       case RoundRobinPartitioning(numPartitions) => new HashPartitioner(numPartitions)
@@ -178,6 +211,11 @@ object ColumnarShuffleExchangeExec extends Logging {
       rdd.mapPartitionsWithIndexInternal(
         (_, cbIterator) => {
           newPartitioning match {
+            case _ if nativePartitioning.nonEmpty =>
+              // no partition id vector is appended, so there is nothing to close
+              cbIterator
+                .filter(cb => cb.numRows != 0 && cb.numCols != 0)
+                .map(cb => (0, cb))
             case SinglePartition =>
               CloseablePairedColumnarBatchIterator(
                 cbIterator
@@ -237,11 +275,37 @@ object ColumnarShuffleExchangeExec extends Logging {
         shuffleWriterProcessor = createShuffleWriteProcessor(writeMetrics),
         serializedSchema = arrowSchema.toByteArray,
         dataSize = dataSize,
-        splitTime = splitTime)
+        splitTime = splitTime,
+        compressTime = compressTime,
+        numSpills = numSpills,
+        nativePartitioning = nativePartitioning,
+        nativeHashKeys = nativeHashKeys)
 
     dependency
   }
 
+  /**
+   * Indices of the hash partitioning keys in outputAttributes, or empty if any key is not a
+   * plain column of a type the native Murmur3 hash supports.
+   */
+  def nativeHashKeyIndices(
+      expressions: Seq[Expression],
+      outputAttributes: Seq[Attribute]): Array[Int] = {
+    val indices = expressions.map {
+      case a: AttributeReference if isNativeHashable(a.dataType) =>
+        outputAttributes.indexWhere(_.exprId == a.exprId)
+      case _ => -1
+    }
+    if (indices.isEmpty || indices.contains(-1)) Array.empty[Int] else indices.toArray
+  }
+
+  private def isNativeHashable(dataType: DataType): Boolean = dataType match {
+    case BooleanType | ByteType | ShortType | IntegerType | LongType | FloatType | DoubleType |
+        DateType | TimestampType | StringType | BinaryType =>
+      true
+    case _ => false
+  }
+
   def pushFrontPartitionIds(partitionIds: Seq[Int], cb: ColumnarBatch): ColumnarBatch = {
     val length = partitionIds.length
 
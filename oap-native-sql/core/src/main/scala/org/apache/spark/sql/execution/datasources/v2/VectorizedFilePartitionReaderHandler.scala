@@ -17,11 +17,18 @@
 
 package org.apache.spark.sql.execution.datasources.v2
 
+import com.intel.oap.ColumnarPluginConfig
 import com.intel.oap.datasource.VectorizedParquetArrowReader
 
 import java.net.URI
 import java.time.ZoneId
 
+import scala.collection.JavaConverters._
+
+import com.google.common.collect.Lists
+import org.apache.arrow.gandiva.expression.{Condition, TreeBuilder, TreeNode}
+import org.apache.arrow.vector.types.pojo.ArrowType
+
 import org.apache.hadoop.mapreduce._
 import org.apache.hadoop.mapreduce.task.TaskAttemptContextImpl
 import org.apache.hadoop.fs.Path
@@ -35,6 +42,9 @@ import org.apache.spark.sql.execution.datasources.{FilePartition, PartitionedFil
 import org.apache.spark.sql.execution.datasources.v2.PartitionedFileReader
 import org.apache.spark.sql.execution.datasources.v2.parquet.ParquetPartitionReaderFactory
 import org.apache.spark.sql.execution.datasources.v2.FilePartitionReader
+import org.apache.spark.sql.sources
+import org.apache.spark.sql.types._
+import org.apache.spark.sql.util.ArrowUtils
 import org.apache.spark.sql.vectorized.{ColumnarBatch, ColumnVector}
 
 object VectorizedFilePartitionReaderHandler {
@@ -64,6 +74,12 @@ object VectorizedFilePartitionReaderHandler {
         //partitionReaderFactory.createColumnarReader(inputPartition)
         val dataSchema = parquetReaderFactory.dataSchema
         val readDataSchema = parquetReaderFactory.readDataSchema
+        val filter = toCondition(parquetReaderFactory.filters, dataSchema)
+        val rowFilter = if (ColumnarPluginConfig.getEnableParquetLateMaterialization) {
+          toCondition(parquetReaderFactory.filters, readDataSchema, exact = true)
+        } else {
+          null
+        }
 
         val conf = parquetReaderFactory.broadcastedConf.value.value
         val attemptId = new TaskAttemptID(new TaskID(new JobID(), TaskType.MAP, 0), 0)
@@ -76,7 +92,9 @@ object VectorizedFilePartitionReaderHandler {
           capacity,
           dataSchema,
           readDataSchema,
-          tmpDir)
+          tmpDir,
+          filter,
+          rowFilter)
         vectorizedReader.initialize(split, hadoopAttemptContext)
         val partitionReader = new PartitionReader[ColumnarBatch] {
           override def next(): Boolean = vectorizedReader.nextKeyValue()
@@ -89,4 +107,86 @@ object VectorizedFilePartitionReaderHandler {
       }
     new FilePartitionReader[ColumnarBatch](iter)
   }
+
+  /**
+   * The filters pushed down to the scan as one gandiva condition of the file columns, for
+   * the native reader to skip the row groups whose statistics satisfy none of their rows.
+   * Null if no filter compares a numeric column to a literal or checks its nulls.
+   *
+   * An exact condition drops no row Spark's evaluation of the filters keeps, so that the
+   * scan can drop the rows failing it. It leaves out the comparisons of bytes, shorts,
+   * which gandiva doesn't compare to int literals, and of floating points, as Spark
+   * orders NaN above every number.
+   */
+  def toCondition(
+      filters: Seq[sources.Filter],
+      dataSchema: StructType,
+      exact: Boolean = false): Condition = {
+    filters.flatMap(toTreeNode(_, dataSchema, exact)) match {
+      case Seq() => null
+      case Seq(node) => TreeBuilder.makeCondition(node)
+      case nodes => TreeBuilder.makeCondition(TreeBuilder.makeAnd(nodes.asJava))
+    }
+  }
+
+  private def toTreeNode(
+      filter: sources.Filter,
+      dataSchema: StructType,
+      exact: Boolean): Option[TreeNode] = {
+    def field(name: String): Option[TreeNode] =
+      dataSchema.find(_.name == name).collect {
+        case f @ StructField(_, IntegerType | LongType, _, _) =>
+          TreeBuilder.makeField(ArrowUtils.toArrowField(f.name, f.dataType, f.nullable, null))
+        case f @ StructField(_, ByteType | ShortType | FloatType | DoubleType, _, _)
+            if !exact =>
+          TreeBuilder.makeField(ArrowUtils.toArrowField(f.name, f.dataType, f.nullable, null))
+      }
+    def literal(value: Any): Option[TreeNode] = value match {
+      case v: Byte => Some(TreeBuilder.makeLiteral(v.toInt: Integer))
+      case v: Short => Some(TreeBuilder.makeLiteral(v.toInt: Integer))
+      case v: Int => Some(TreeBuilder.makeLiteral(v: Integer))
+      case v: Long => Some(TreeBuilder.makeLiteral(v: java.lang.Long))
+      case v: Float => Some(TreeBuilder.makeLiteral(v: java.lang.Float))
+      case v: Double => Some(TreeBuilder.makeLiteral(v: java.lang.Double))
+      case _ => None
+    }
+    def function(name: String, children: TreeNode*): TreeNode =
+      TreeBuilder.makeFunction(name, Lists.newArrayList(children: _*), new ArrowType.Bool())
+    def compare(name: String, attribute: String, value: Any): Option[TreeNode] =
+      for (f <- field(attribute); v <- literal(value)) yield function(name, f, v)
+    def child(filter: sources.Filter): Option[TreeNode] =
+      toTreeNode(filter, dataSchema, exact)
+
+    filter match {
+      case sources.And(left, right) =>
+        // either side alone still bounds the rows of the conjunction
+        (child(left) ++ child(right)).toList match {
+          case Nil => None
+          case node :: Nil => Some(node)
+          case nodes => Some(TreeBuilder.makeAnd(nodes.asJava))
+        }
+      case sources.Or(left, right) =>
+        for (l <- child(left); r <- child(right))
+          yield TreeBuilder.makeOr(Lists.newArrayList(l, r))
+      case sources.EqualTo(attribute, value) => compare("equal", attribute, value)
+      case sources.Not(sources.EqualTo(attribute, value)) =>
+        compare("not_equal", attribute, value)
+      case sources.LessThan(attribute, value) => compare("less_than", attribute, value)
+      case sources.LessThanOrEqual(attribute, value) =>
+        compare("less_than_or_equal_to", attribute, value)
+      case sources.GreaterThan(attribute, value) => compare("greater_than", attribute, value)
+      case sources.GreaterThanOrEqual(attribute, value) =>
+        compare("greater_than_or_equal_to", attribute, value)
+      case sources.In(attribute, values) if values.nonEmpty =>
+        val equals = values.map(compare("equal", attribute, _))
+        if (equals.forall(_.isDefined)) {
+          Some(TreeBuilder.makeOr(Lists.newArrayList(equals.map(_.get): _*)))
+        } else {
+          None
+        }
+      case sources.IsNull(attribute) => field(attribute).map(function("isnull", _))
+      case sources.IsNotNull(attribute) => field(attribute).map(function("isnotnull", _))
+      case _ => None
+    }
+  }
 }
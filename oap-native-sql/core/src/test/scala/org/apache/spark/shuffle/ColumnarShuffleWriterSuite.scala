@@ -87,6 +87,12 @@ class ColumnarShuffleWriterSuite extends SharedSparkSession {
       .thenReturn(SQLMetrics.createSizeMetric(spark.sparkContext, "data size"))
     when(dependency.splitTime)
       .thenReturn(SQLMetrics.createNanoTimingMetric(spark.sparkContext, "split time"))
+    when(dependency.compressTime)
+      .thenReturn(SQLMetrics.createNanoTimingMetric(spark.sparkContext, "compress time"))
+    when(dependency.numSpills)
+      .thenReturn(SQLMetrics.createMetric(spark.sparkContext, "number of spills"))
+    when(dependency.nativePartitioning).thenReturn("")
+    when(dependency.nativeHashKeys).thenReturn(Array.empty[Int])
     when(taskContext.taskMetrics()).thenReturn(taskMetrics)
     when(blockResolver.getDataFile(0, 0)).thenReturn(outputFile)
 
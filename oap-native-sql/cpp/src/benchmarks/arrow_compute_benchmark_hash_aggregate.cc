@@ -30,6 +30,7 @@
 
 #include <chrono>
 
+#include "benchmarks/kernel_benchmark.h"
 #include "codegen/code_generator.h"
 #include "codegen/code_generator_factory.h"
 #include "codegen/common/result_iterator.h"
@@ -38,9 +39,10 @@
 namespace sparkcolumnarplugin {
 namespace codegen {
 
-class BenchmarkArrowComputeHashAggregate : public ::testing::Test {
+class BenchmarkArrowComputeHashAggregate : public KernelBenchmark {
  public:
   void SetUp() override {
+    KernelBenchmark::SetUp();
     // read input from parquet file
 #ifdef BENCHMARK_FILE_PATH
     std::string dir_path = BENCHMARK_FILE_PATH;
@@ -71,41 +73,28 @@ class BenchmarkArrowComputeHashAggregate : public ::testing::Test {
     field_list = record_batch_reader->schema()->fields();
   }
 
-  void StartWithIterator(std::shared_ptr<CodeGenerator> aggr_expr) {
-    std::vector<std::shared_ptr<arrow::RecordBatch>> input_batch_list;
-    std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
-    std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
-
-    std::shared_ptr<arrow::RecordBatch> record_batch;
-
-    do {
-      TIME_MICRO_OR_THROW(elapse_read, record_batch_reader->ReadNext(&record_batch));
-      if (record_batch) {
-        TIME_MICRO_OR_THROW(elapse_eval,
-                            aggr_expr->evaluate(record_batch, &dummy_result_batches));
-        num_batches += 1;
+  // Benchmark the code generator made by make on the input batches
+  void StartWithIterator(
+      const std::function<arrow::Status(std::shared_ptr<CodeGenerator>*)>& make) {
+    auto input_batches = ReadAll(record_batch_reader.get());
+    std::cout << "Readed " << input_batches.size() << " batches." << std::endl;
+    Measure([&](PassSize* size) {
+      std::shared_ptr<CodeGenerator> aggr_expr;
+      RETURN_NOT_OK(make(&aggr_expr));
+      std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+      for (const auto& record_batch : input_batches) {
+        RETURN_NOT_OK(aggr_expr->evaluate(record_batch, &dummy_result_batches));
+        size->num_batches++;
+        size->num_rows += record_batch->num_rows();
+      }
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+      RETURN_NOT_OK(aggr_expr->finish(&aggr_result_iterator));
+      std::shared_ptr<arrow::RecordBatch> result_batch;
+      while (aggr_result_iterator->HasNext()) {
+        RETURN_NOT_OK(aggr_result_iterator->Next(&result_batch));
       }
-    } while (record_batch);
-    std::cout << "Readed " << num_batches << " batches." << std::endl;
-    TIME_MICRO_OR_THROW(elapse_aggr, aggr_expr->finish(&aggr_result_iterator));
-    std::shared_ptr<arrow::RecordBatch> result_batch;
-
-    uint64_t num_output_batches = 0;
-    while (aggr_result_iterator->HasNext()) {
-      TIME_MICRO_OR_THROW(elapse_shuffle, aggr_result_iterator->Next(&result_batch));
-      num_output_batches++;
-    }
-    // arrow::PrettyPrint(*result_batch.get(), 2, &std::cout);
-
-    std::cout << "==================== Summary ====================\n"
-              << "BenchmarkArrowComputeHashAggregate processed " << num_batches
-              << " batches\nthen output " << num_output_batches
-              << " batches\nCodeGen took " << TIME_TO_STRING(elapse_gen)
-              << "\nBatch read took " << TIME_TO_STRING(elapse_read)
-              << "\nEvaluation took " << TIME_TO_STRING(elapse_eval)
-              << "\nAggregate took " << TIME_TO_STRING(elapse_aggr) << "\nShuffle took "
-              << TIME_TO_STRING(elapse_shuffle)
-              << ".\n================================================" << std::endl;
+      return arrow::Status::OK();
+    });
   }
 
  protected:
@@ -118,22 +107,9 @@ class BenchmarkArrowComputeHashAggregate : public ::testing::Test {
 
   int primary_key_index = 0;
   std::shared_ptr<arrow::Field> f_res;
-
-  uint64_t elapse_gen = 0;
-  uint64_t elapse_read = 0;
-  uint64_t elapse_eval = 0;
-  uint64_t elapse_aggr = 0;
-  uint64_t elapse_shuffle = 0;
-  uint64_t num_batches = 0;
 };
 
 TEST_F(BenchmarkArrowComputeHashAggregate, GroupbyAggregateBenchmark) {
-  elapse_gen = 0;
-  elapse_read = 0;
-  elapse_eval = 0;
-  elapse_aggr = 0;
-  elapse_shuffle = 0;
-  num_batches = 0;
   ////////////////////// prepare expr_vector ///////////////////////
   f_res = field("res", arrow::uint64());
 
@@ -167,21 +143,14 @@ TEST_F(BenchmarkArrowComputeHashAggregate, GroupbyAggregateBenchmark) {
   auto f0_type = field_list[0]->type();
   ret_field_list = {field(f0_name, f0_type), field(f1_name + "_sum", int64()),
                     field(f2_name + "_sum", int64())};
-  std::shared_ptr<CodeGenerator> aggr_expr;
-  TIME_MICRO_OR_THROW(elapse_gen, CreateCodeGenerator(schema, {aggrArrays_expr},
-                                                      ret_field_list, &aggr_expr, true));
-
   ///////////////////// Calculation //////////////////
-  StartWithIterator(aggr_expr);
+  StartWithIterator([&](std::shared_ptr<CodeGenerator>* aggr_expr) {
+    return CreateCodeGenerator(schema, {aggrArrays_expr}, ret_field_list, aggr_expr,
+                               true);
+  });
 }
 
 TEST_F(BenchmarkArrowComputeHashAggregate, GroupbyAggregateWithAvgBenchmark) {
-  elapse_gen = 0;
-  elapse_read = 0;
-  elapse_eval = 0;
-  elapse_aggr = 0;
-  elapse_shuffle = 0;
-  num_batches = 0;
   ////////////////////// prepare expr_vector ///////////////////////
   f_res = field("res", arrow::uint64());
 
@@ -225,12 +194,11 @@ TEST_F(BenchmarkArrowComputeHashAggregate, GroupbyAggregateWithAvgBenchmark) {
                     field(f1_name + "_avg", float64()),
                     field(f2_name + "_avg", float64()),
                     field("count_all", int64())};
-  std::shared_ptr<CodeGenerator> aggr_expr;
-  TIME_MICRO_OR_THROW(elapse_gen, CreateCodeGenerator(schema, {aggrArrays_expr},
-                                                      ret_field_list, &aggr_expr, true));
-
   ///////////////////// Calculation //////////////////
-  StartWithIterator(aggr_expr);
+  StartWithIterator([&](std::shared_ptr<CodeGenerator>* aggr_expr) {
+    return CreateCodeGenerator(schema, {aggrArrays_expr}, ret_field_list, aggr_expr,
+                               true);
+  });
 }
 
 }  // namespace codegen
@@ -30,6 +30,7 @@
 
 #include <chrono>
 
+#include "benchmarks/kernel_benchmark.h"
 #include "codegen/code_generator.h"
 #include "codegen/code_generator_factory.h"
 #include "codegen/common/result_iterator.h"
@@ -38,9 +39,10 @@
 namespace sparkcolumnarplugin {
 namespace codegen {
 
-class BenchmarkArrowComputeSort : public ::testing::Test {
+class BenchmarkArrowComputeSort : public KernelBenchmark {
  public:
   void SetUp() override {
+    KernelBenchmark::SetUp();
     // read input from parquet file
 #ifdef BENCHMARK_FILE_PATH
     std::string dir_path = BENCHMARK_FILE_PATH;
@@ -72,41 +74,28 @@ class BenchmarkArrowComputeSort : public ::testing::Test {
     ret_field_list = record_batch_reader->schema()->fields();
   }
 
-  void StartWithIterator(std::shared_ptr<CodeGenerator> sort_expr) {
-    std::vector<std::shared_ptr<arrow::RecordBatch>> input_batch_list;
-    std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
-    std::shared_ptr<ResultIterator<arrow::RecordBatch>> sort_result_iterator;
-
-    std::shared_ptr<arrow::RecordBatch> record_batch;
-
-    do {
-      TIME_MICRO_OR_THROW(elapse_read, record_batch_reader->ReadNext(&record_batch));
-      if (record_batch) {
-        TIME_MICRO_OR_THROW(elapse_eval,
-                            sort_expr->evaluate(record_batch, &dummy_result_batches));
-        num_batches += 1;
+  // Benchmark the code generator made by make on the input batches
+  void StartWithIterator(
+      const std::function<arrow::Status(std::shared_ptr<CodeGenerator>*)>& make) {
+    auto input_batches = ReadAll(record_batch_reader.get());
+    std::cout << "Readed " << input_batches.size() << " batches." << std::endl;
+    Measure([&](PassSize* size) {
+      std::shared_ptr<CodeGenerator> sort_expr;
+      RETURN_NOT_OK(make(&sort_expr));
+      std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+      for (const auto& record_batch : input_batches) {
+        RETURN_NOT_OK(sort_expr->evaluate(record_batch, &dummy_result_batches));
+        size->num_batches++;
+        size->num_rows += record_batch->num_rows();
+      }
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>> sort_result_iterator;
+      RETURN_NOT_OK(sort_expr->finish(&sort_result_iterator));
+      std::shared_ptr<arrow::RecordBatch> result_batch;
+      while (sort_result_iterator->HasNext()) {
+        RETURN_NOT_OK(sort_result_iterator->Next(&result_batch));
       }
-    } while (record_batch);
-    std::cout << "Readed " << num_batches << " batches." << std::endl;
-    TIME_MICRO_OR_THROW(elapse_sort, sort_expr->finish(&sort_result_iterator));
-    std::shared_ptr<arrow::RecordBatch> result_batch;
-
-    uint64_t num_output_batches = 0;
-    while (sort_result_iterator->HasNext()) {
-      TIME_MICRO_OR_THROW(elapse_shuffle, sort_result_iterator->Next(&result_batch));
-      num_output_batches++;
-    }
-    arrow::PrettyPrint(*result_batch.get(), 2, &std::cout);
-
-    std::cout << "==================== Summary ====================\n"
-              << "BenchmarkArrowComputeJoin processed " << num_batches
-              << " batches\nthen output " << num_output_batches
-              << " batches\nCodeGen took " << TIME_TO_STRING(elapse_gen)
-              << "\nBatch read took " << TIME_TO_STRING(elapse_read)
-              << "\nEvaluation took " << TIME_TO_STRING(elapse_eval) << "\nSort took "
-              << TIME_TO_STRING(elapse_sort) << "\nShuffle took "
-              << TIME_TO_STRING(elapse_shuffle)
-              << ".\n================================================" << std::endl;
+      return arrow::Status::OK();
+    });
   }
 
  protected:
@@ -119,22 +108,9 @@ class BenchmarkArrowComputeSort : public ::testing::Test {
 
   int primary_key_index = 0;
   std::shared_ptr<arrow::Field> f_res;
-
-  uint64_t elapse_gen = 0;
-  uint64_t elapse_read = 0;
-  uint64_t elapse_eval = 0;
-  uint64_t elapse_sort = 0;
-  uint64_t elapse_shuffle = 0;
-  uint64_t num_batches = 0;
 };
 
 TEST_F(BenchmarkArrowComputeSort, SortBenchmark) {
-  elapse_gen = 0;
-  elapse_read = 0;
-  elapse_eval = 0;
-  elapse_sort = 0;
-  elapse_shuffle = 0;
-  num_batches = 0;
   ////////////////////// prepare expr_vector ///////////////////////
   auto indices_type = std::make_shared<FixedSizeBinaryType>(16);
   f_res = field("res", arrow::uint64());
@@ -153,21 +129,14 @@ TEST_F(BenchmarkArrowComputeSort, SortBenchmark) {
   ::gandiva::ExpressionPtr sortArrays_expr;
   sortArrays_expr = TreeExprBuilder::MakeExpression(n_sort_to_indices, f_res);
 
-  std::shared_ptr<CodeGenerator> sort_expr;
-  TIME_MICRO_OR_THROW(elapse_gen, CreateCodeGenerator(schema, {sortArrays_expr},
-                                                      ret_field_list, &sort_expr, true));
-
   ///////////////////// Calculation //////////////////
-  StartWithIterator(sort_expr);
+  StartWithIterator([&](std::shared_ptr<CodeGenerator>* sort_expr) {
+    return CreateCodeGenerator(schema, {sortArrays_expr}, ret_field_list, sort_expr,
+                               true);
+  });
 }
 
 TEST_F(BenchmarkArrowComputeSort, SortBenchmarkWOPayLoad) {
-  elapse_gen = 0;
-  elapse_read = 0;
-  elapse_eval = 0;
-  elapse_sort = 0;
-  elapse_shuffle = 0;
-  num_batches = 0;
   ////////////////////// prepare expr_vector ///////////////////////
   auto indices_type = std::make_shared<FixedSizeBinaryType>(16);
   f_res = field("res", arrow::uint64());
@@ -184,13 +153,11 @@ TEST_F(BenchmarkArrowComputeSort, SortBenchmarkWOPayLoad) {
   ::gandiva::ExpressionPtr sortArrays_expr;
   sortArrays_expr = TreeExprBuilder::MakeExpression(n_sort_to_indices, f_res);
 
-  std::shared_ptr<CodeGenerator> sort_expr;
-  TIME_MICRO_OR_THROW(elapse_gen, CreateCodeGenerator(schema, {sortArrays_expr},
-                                                      {ret_field_list[primary_key_index]},
-                                                      &sort_expr, true));
-
   ///////////////////// Calculation //////////////////
-  StartWithIterator(sort_expr);
+  StartWithIterator([&](std::shared_ptr<CodeGenerator>* sort_expr) {
+    return CreateCodeGenerator(schema, {sortArrays_expr},
+                               {ret_field_list[primary_key_index]}, sort_expr, true);
+  });
 }
 
 }  // namespace codegen
@@ -0,0 +1,319 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/array.h>
+#include <arrow/builder.h>
+#include <arrow/memory_pool.h>
+#include <arrow/util/string_view.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "codegen/arrow_compute/ext/array_item_index.h"
+#include "codegen/arrow_compute/ext/join_hash_table.h"
+#include "codegen/arrow_compute/ext/memo_table_instances.h"
+#include "tests/test_utils.h"
+#include "third_party/sparsehash/sparse_hash_map.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+using arrowcompute::extra::ArrayItemIndex;
+using arrowcompute::extra::JoinHashTable;
+
+/// Keys of a run, distinct for distinct i and never 0, the empty key of SparseHashMap
+template <typename Key>
+struct KeyTraits;
+
+template <>
+struct KeyTraits<int32_t> {
+  static constexpr const char* kName = "int32";
+  using ArrayType = arrow::Int32Array;
+  using BuilderType = arrow::Int32Builder;
+  using MemoTable = arrow::internal::ScalarMemoTable<int32_t>;
+  static int32_t Make(uint64_t i) {
+    return static_cast<int32_t>(((i + 1) * 2654435761ULL) & 0x7fffffff);
+  }
+  static int32_t MemoKey(int32_t key) { return key; }
+};
+
+template <>
+struct KeyTraits<int64_t> {
+  static constexpr const char* kName = "int64";
+  using ArrayType = arrow::Int64Array;
+  using BuilderType = arrow::Int64Builder;
+  using MemoTable = arrow::internal::ScalarMemoTable<int64_t>;
+  static int64_t Make(uint64_t i) {
+    return static_cast<int64_t>((i + 1) * 0x9e3779b97f4a7c15ULL);
+  }
+  static int64_t MemoKey(int64_t key) { return key; }
+};
+
+template <>
+struct KeyTraits<std::string> {
+  static constexpr const char* kName = "string";
+  using ArrayType = arrow::StringArray;
+  using BuilderType = arrow::StringBuilder;
+  using MemoTable = arrow::internal::BinaryMemoTable<arrow::BinaryBuilder>;
+  static std::string Make(uint64_t i) {
+    return "key-" + std::to_string(KeyTraits<int64_t>::Make(i));
+  }
+  static arrow::util::string_view MemoKey(const std::string& key) {
+    return arrow::util::string_view(key);
+  }
+};
+
+/// Build side and probe side of one run
+struct HashTableCase {
+  // the cache level the distinct keys are sized to fit in the join hash table
+  std::string level;
+  int64_t num_keys;
+  // build rows per key
+  int duplicates;
+};
+
+std::ostream& operator<<(std::ostream& os, const HashTableCase& c) {
+  return os << c.level << ", " << c.num_keys << " keys, " << c.duplicates
+            << " rows per key";
+}
+
+/// \brief Inserts a build side into each hash table, then looks up a probe side
+///
+/// The tables are those a join build side can be kept in: JoinHashTable, and the
+/// ScalarMemoTable and SparseHashMap once used by the probe kernels. The memo tables
+/// only map a key to an id, so the rows of each key are kept in a vector per id as the
+/// probe kernels did. A lookup finds the key and visits all its rows. Half of the
+/// probe keys are in the build side.
+///
+/// The cases sweep the key type, the number of distinct keys, sized so that the slots
+/// of JoinHashTable fit L2, L3 or only DRAM, and the rows per key. The rates are
+/// printed and recorded as test properties.
+class BenchmarkHashTable : public ::testing::Test {
+ protected:
+  template <typename Key>
+  void Run() {
+    for (const auto& size : kSizes) {
+      for (int duplicates : {1, 4, 16}) {
+        HashTableCase c{size.first, size.second, duplicates};
+        if (c.num_keys * c.duplicates > kMaxBuildRows) {
+          continue;
+        }
+        Run<Key>(c);
+      }
+    }
+  }
+
+  template <typename Key>
+  void Run(const HashTableCase& c) {
+    using Traits = KeyTraits<Key>;
+    std::mt19937_64 gen(42);
+    std::vector<Key> build_keys;
+    for (int64_t i = 0; i < c.num_keys * c.duplicates; ++i) {
+      build_keys.push_back(Traits::Make(i % c.num_keys));
+    }
+    std::shuffle(build_keys.begin(), build_keys.end(), gen);
+    std::uniform_int_distribution<int64_t> probe_index(0, 2 * c.num_keys - 1);
+    std::vector<Key> probe_keys;
+    int64_t expected_matches = 0;
+    for (int64_t i = 0; i < kProbeRows; ++i) {
+      auto index = probe_index(gen);
+      if (index < c.num_keys) {
+        expected_matches += c.duplicates;
+      }
+      probe_keys.push_back(Traits::Make(index));
+    }
+
+    std::cout << "==================== " << Traits::kName << " keys, " << c
+              << " ====================" << std::endl;
+    RunJoinHashTable(c, build_keys, probe_keys, expected_matches);
+    RunMemoTable<typename Traits::MemoTable>(c, "ScalarMemoTable", build_keys,
+                                             probe_keys, expected_matches);
+    RunSparseHashMap(c, build_keys, probe_keys, expected_matches);
+  }
+
+  template <typename Key>
+  void RunJoinHashTable(const HashTableCase& c, const std::vector<Key>& build_keys,
+                        const std::vector<Key>& probe_keys, int64_t expected_matches) {
+    JoinHashTable<Key, ArrayItemIndex> table(arrow::default_memory_pool());
+    auto insert_micros = Time([&] {
+      for (size_t i = 0; i < build_keys.size(); ++i) {
+        table.Insert(build_keys[i], MakeItem(i));
+      }
+    });
+    int64_t matches = 0;
+    auto lookup_micros = Time([&] {
+      for (const auto& key : probe_keys) {
+        auto key_id = table.Get(key);
+        if (key_id != JoinHashTable<Key, ArrayItemIndex>::kNotFound) {
+          for (const auto& item : table.Items(key_id)) {
+            ++matches;
+            sink_ += item.id;
+          }
+        }
+      }
+    });
+    ASSERT_EQ(matches, expected_matches);
+    Report<Key>(c, "JoinHashTable", build_keys.size(), insert_micros, lookup_micros);
+    RunJoinHashTableBatch(c, build_keys, probe_keys, expected_matches);
+  }
+
+  // InsertBatch and GetBatch, the paths of the probe kernels, which partition the rows
+  // of large tables and prefetch
+  template <typename Key>
+  void RunJoinHashTableBatch(const HashTableCase& c, const std::vector<Key>& build_keys,
+                             const std::vector<Key>& probe_keys,
+                             int64_t expected_matches) {
+    using ArrayType = typename KeyTraits<Key>::ArrayType;
+    auto build = MakeArray(build_keys);
+    auto probe = MakeArray(probe_keys);
+    JoinHashTable<Key, ArrayItemIndex> table(arrow::default_memory_pool());
+    auto insert_micros = Time([&] {
+      table.InsertBatch(static_cast<const ArrayType&>(*build),
+                        [](int64_t i) { return MakeItem(i); });
+    });
+    std::vector<int32_t> key_ids(probe->length());
+    int64_t matches = 0;
+    auto lookup_micros = Time([&] {
+      table.GetBatch(static_cast<const ArrayType&>(*probe), 0, probe->length(),
+                     key_ids.data());
+      for (auto key_id : key_ids) {
+        if (key_id != JoinHashTable<Key, ArrayItemIndex>::kNotFound) {
+          for (const auto& item : table.Items(key_id)) {
+            ++matches;
+            sink_ += item.id;
+          }
+        }
+      }
+    });
+    ASSERT_EQ(matches, expected_matches);
+    Report<Key>(c, "JoinHashTable batched", build_keys.size(), insert_micros,
+                lookup_micros);
+  }
+
+  template <typename MemoTable, typename Key>
+  void RunMemoTable(const HashTableCase& c, const std::string& name,
+                    const std::vector<Key>& build_keys,
+                    const std::vector<Key>& probe_keys, int64_t expected_matches) {
+    using Traits = KeyTraits<Key>;
+    MemoTable table(arrow::default_memory_pool());
+    std::vector<std::vector<ArrayItemIndex>> items;
+    auto insert_micros = Time([&] {
+      for (size_t i = 0; i < build_keys.size(); ++i) {
+        int32_t memo_index;
+        THROW_NOT_OK(table.GetOrInsert(
+            Traits::MemoKey(build_keys[i]), [](int32_t) {},
+            [&items](int32_t) { items.emplace_back(); }, &memo_index));
+        items[memo_index].push_back(MakeItem(i));
+      }
+    });
+    int64_t matches = 0;
+    auto lookup_micros = Time([&] {
+      for (const auto& key : probe_keys) {
+        auto memo_index = table.Get(Traits::MemoKey(key));
+        if (memo_index != arrow::internal::kKeyNotFound) {
+          for (const auto& item : items[memo_index]) {
+            ++matches;
+            sink_ += item.id;
+          }
+        }
+      }
+    });
+    ASSERT_EQ(matches, expected_matches);
+    Report<Key>(c, name, build_keys.size(), insert_micros, lookup_micros);
+  }
+
+  template <typename Key>
+  void RunSparseHashMap(const HashTableCase& c, const std::vector<Key>& build_keys,
+                        const std::vector<Key>& probe_keys, int64_t expected_matches) {
+    RunMemoTable<SparseHashMap<Key>>(c, "SparseHashMap", build_keys, probe_keys,
+                                     expected_matches);
+  }
+
+  // the empty key 0 of SparseHashMap is no string
+  void RunSparseHashMap(const HashTableCase& c,
+                        const std::vector<std::string>& build_keys,
+                        const std::vector<std::string>& probe_keys,
+                        int64_t expected_matches) {}
+
+  template <typename Key>
+  static std::shared_ptr<arrow::Array> MakeArray(const std::vector<Key>& keys) {
+    typename KeyTraits<Key>::BuilderType builder;
+    for (const auto& key : keys) {
+      THROW_NOT_OK(builder.Append(key));
+    }
+    std::shared_ptr<arrow::Array> array;
+    THROW_NOT_OK(builder.Finish(&array));
+    return array;
+  }
+
+  static ArrayItemIndex MakeItem(int64_t row) {
+    return ArrayItemIndex(static_cast<uint16_t>(row >> 16),
+                          static_cast<uint16_t>(row & 0xffff));
+  }
+
+  template <typename Func>
+  static int64_t Time(Func&& func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  template <typename Key>
+  void Report(const HashTableCase& c, const std::string& name, int64_t build_rows,
+              int64_t insert_micros, int64_t lookup_micros) {
+    auto insert_rate = Rate(build_rows, insert_micros);
+    auto lookup_rate = Rate(kProbeRows, lookup_micros);
+    std::cout << name << ": insert " << insert_rate << " Mrows/s, lookup "
+              << lookup_rate << " Mrows/s" << std::endl;
+    auto key = name + "/" + KeyTraits<Key>::kName + "/" + c.level + "/x" +
+               std::to_string(c.duplicates);
+    RecordProperty(key + "/insert_mrows_per_sec", std::to_string(insert_rate));
+    RecordProperty(key + "/lookup_mrows_per_sec", std::to_string(lookup_rate));
+  }
+
+  static double Rate(int64_t rows, int64_t micros) {
+    return static_cast<double>(rows) / std::max<int64_t>(micros, 1);
+  }
+
+  // distinct keys by cache level, for JoinHashTable slots of about 24 bytes at most
+  // half used: about 100KB, 3MB and 200MB
+  const std::vector<std::pair<std::string, int64_t>> kSizes = {
+      {"L2", 1 << 11}, {"L3", 1 << 16}, {"DRAM", 1 << 22}};
+  static constexpr int64_t kMaxBuildRows = 1 << 24;
+  static constexpr int64_t kProbeRows = 1 << 22;
+
+  // the ids of the rows found, so that their reads are not optimized out
+  int64_t sink_ = 0;
+};
+
+TEST_F(BenchmarkHashTable, Int32KeysBenchmark) { Run<int32_t>(); }
+
+TEST_F(BenchmarkHashTable, Int64KeysBenchmark) { Run<int64_t>(); }
+
+TEST_F(BenchmarkHashTable, StringKeysBenchmark) { Run<std::string>(); }
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
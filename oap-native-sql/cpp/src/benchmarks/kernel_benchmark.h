@@ -0,0 +1,167 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/record_batch.h>
+#include <arrow/status.h>
+#include <arrow/util/io_util.h>
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "codegen/arrow_compute/ext/codegen_common.h"
+#include "tests/test_utils.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+/// Batches and rows evaluated by a benchmark pass
+struct PassSize {
+  int64_t num_batches = 0;
+  int64_t num_rows = 0;
+};
+
+/// \brief Fixture timing apart the compilation, the load and the execution of kernels
+///
+/// A pass makes the code generators of a benchmark and evaluates its input, read in
+/// memory beforehand so that no pass reads files. Measure runs the pass three times:
+///
+/// - cold, on a kernel directory of the fixture, so that every kernel is compiled
+/// - warm, after the kernels are dropped from the process, loading their libraries
+/// - steady, with the kernels loaded, timing the execution only
+///
+/// The results are printed and recorded as test properties, written by
+/// --gtest_output=json:<file> for CI to compare with the results of a previous build.
+class KernelBenchmark : public ::testing::Test {
+ public:
+  using Pass = std::function<arrow::Status(PassSize*)>;
+
+  void SetUp() override {
+    // the kernel directory links the headers and libraries of the one configured, but
+    // not its kernels
+    auto source = arrowcompute::extra::GetTempPath();
+    ARROW_ASSIGN_OR_THROW(kernel_dir_,
+                          arrow::internal::TemporaryDir::Make("kernel-benchmark"));
+    auto dir = kernel_dir_->path().ToString();
+    auto entries = opendir(source.c_str());
+    ASSERT_NE(entries, nullptr);
+    while (auto entry = readdir(entries)) {
+      std::string name = entry->d_name;
+      if (name == "." || name == ".." || name == "tmp") {
+        continue;
+      }
+      ASSERT_EQ(symlink((source + "/" + name).c_str(), (dir + name).c_str()), 0);
+    }
+    closedir(entries);
+    const char* env_tmp_dir = std::getenv("NATIVESQL_TMP_DIR");
+    saved_tmp_dir_ = env_tmp_dir == nullptr ? "" : env_tmp_dir;
+    setenv("NATIVESQL_TMP_DIR", dir.c_str(), 1);
+    arrowcompute::extra::ClearKernelCache();
+  }
+
+  void TearDown() override {
+    arrowcompute::extra::ClearKernelCache();
+    if (saved_tmp_dir_.empty()) {
+      unsetenv("NATIVESQL_TMP_DIR");
+    } else {
+      setenv("NATIVESQL_TMP_DIR", saved_tmp_dir_.c_str(), 1);
+    }
+  }
+
+  void Measure(const Pass& pass) {
+    auto cold = TimePass(pass);
+    arrowcompute::extra::ClearKernelCache();
+    auto warm = TimePass(pass);
+    auto steady = TimePass(pass);
+    auto batch_micros = steady.micros / std::max<int64_t>(steady.size.num_batches, 1);
+    auto rows_per_second =
+        steady.size.num_rows * 1000000 / std::max<int64_t>(steady.micros, 1);
+
+    std::cout << "==================== Summary ====================\n"
+              << "Compiled " << cold.num_compiled << " kernels in "
+              << TIME_TO_STRING(cold.compile_micros) << ", cold pass took "
+              << TIME_TO_STRING(cold.micros) << "\nLoaded " << warm.num_loaded
+              << " kernels in " << TIME_TO_STRING(warm.load_micros)
+              << ", warm pass took " << TIME_TO_STRING(warm.micros)
+              << "\nSteady pass took " << TIME_TO_STRING(steady.micros) << " for "
+              << steady.size.num_batches << " batches, " << batch_micros
+              << " us per batch, " << rows_per_second << " rows/s"
+              << "\n================================================" << std::endl;
+    RecordProperty("compile_us", std::to_string(cold.compile_micros));
+    RecordProperty("num_compiled", std::to_string(cold.num_compiled));
+    RecordProperty("load_us", std::to_string(warm.load_micros));
+    RecordProperty("num_loaded", std::to_string(warm.num_loaded));
+    RecordProperty("steady_us", std::to_string(steady.micros));
+    RecordProperty("batch_us", std::to_string(batch_micros));
+    RecordProperty("rows_per_second", std::to_string(rows_per_second));
+  }
+
+  static std::vector<std::shared_ptr<arrow::RecordBatch>> ReadAll(
+      arrow::RecordBatchReader* reader) {
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    std::shared_ptr<arrow::RecordBatch> batch;
+    while (true) {
+      THROW_NOT_OK(reader->ReadNext(&batch));
+      if (batch == nullptr) {
+        return batches;
+      }
+      batches.push_back(batch);
+    }
+  }
+
+ private:
+  struct PassTime {
+    PassSize size;
+    int64_t micros = 0;
+    int64_t num_compiled = 0;
+    int64_t compile_micros = 0;
+    int64_t num_loaded = 0;
+    int64_t load_micros = 0;
+  };
+
+  static PassTime TimePass(const Pass& pass) {
+    PassTime time;
+    auto before = arrowcompute::extra::GetKernelCacheMetrics();
+    auto start = std::chrono::steady_clock::now();
+    THROW_NOT_OK(pass(&time.size));
+    time.micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    auto after = arrowcompute::extra::GetKernelCacheMetrics();
+    time.num_compiled = after.num_compiled - before.num_compiled;
+    time.compile_micros = (after.compile_nanos - before.compile_nanos) / 1000;
+    time.num_loaded = after.num_loaded - before.num_loaded;
+    time.load_micros = (after.load_nanos - before.load_nanos) / 1000;
+    return time;
+  }
+
+  std::unique_ptr<arrow::internal::TemporaryDir> kernel_dir_;
+  std::string saved_tmp_dir_;
+};
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,421 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/builder.h>
+#include <arrow/io/file.h>
+#include <arrow/memory_pool.h>
+#include <arrow/record_batch.h>
+#include <arrow/table.h>
+#include <arrow/type.h>
+#include <arrow/util/compression.h>
+#include <arrow/util/io_util.h>
+#include <gandiva/tree_expr_builder.h>
+#include <gtest/gtest.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "data_source/parquet/adapter.h"
+#include "tests/test_utils.h"
+#include "utils/macros.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+using ParquetFileReader = jni::parquet::adapters::ParquetFileReader;
+using ParquetFileWriter = jni::parquet::adapters::ParquetFileWriter;
+
+/// How the native reader reads a file
+enum class ReadMode {
+  // batches decoded synchronously, the filter applied above the scan
+  kPlain,
+  // row groups read ahead in background
+  kPrefetch,
+  // the column chunks of a row group fetched in few large requests
+  kCoalesced,
+  // the row groups skipped by their statistics, SetFilter
+  kPushdown,
+  // the filter column decoded first, the others only for the matching row groups,
+  // SetRowFilter
+  kLateMaterialization
+};
+
+std::string ToString(ReadMode mode) {
+  switch (mode) {
+    case ReadMode::kPlain:
+      return "plain";
+    case ReadMode::kPrefetch:
+      return "prefetch";
+    case ReadMode::kCoalesced:
+      return "coalesced";
+    case ReadMode::kPushdown:
+      return "pushdown";
+    case ReadMode::kLateMaterialization:
+      return "late materialization";
+  }
+  return "";
+}
+
+/// Shape of the file and of its read of one run
+struct ParquetCase {
+  // columns besides the key
+  int num_columns = 16;
+  // share of the columns which are strings, the others are int64
+  double string_share = 0.25;
+  bool dictionary = true;
+  ::parquet::Compression::type codec = ::parquet::Compression::SNAPPY;
+  int64_t row_group_rows = 64 * 1024;
+  // share of the rows whose key passes the filter, 1 for no filter
+  double selectivity = 1.0;
+  ReadMode mode = ReadMode::kPlain;
+  // whether the file reads pay the latency and bandwidth of a remote store
+  bool throttled = false;
+};
+
+std::ostream& operator<<(std::ostream& os, const ParquetCase& c) {
+  return os << "columns " << c.num_columns << ", string share " << c.string_share
+            << ", dictionary " << c.dictionary << ", codec "
+            << arrow::util::Codec::GetCodecAsString(c.codec) << ", row group rows "
+            << c.row_group_rows << ", selectivity " << c.selectivity << ", "
+            << ToString(c.mode) << (c.throttled ? ", throttled" : "");
+}
+
+/// \brief A file whose reads wait a latency and the time of their bytes at a
+/// bandwidth first, like those of HDFS or an object store
+class ThrottledFile : public arrow::io::RandomAccessFile {
+ public:
+  ThrottledFile(std::shared_ptr<arrow::io::RandomAccessFile> file, int64_t latency_us,
+                int64_t bytes_per_second)
+      : file_(std::move(file)),
+        latency_us_(latency_us),
+        bytes_per_second_(bytes_per_second) {}
+
+  arrow::Status Close() override { return file_->Close(); }
+  bool closed() const override { return file_->closed(); }
+  arrow::Result<int64_t> Tell() const override { return file_->Tell(); }
+  arrow::Status Seek(int64_t position) override { return file_->Seek(position); }
+  arrow::Result<int64_t> GetSize() override { return file_->GetSize(); }
+
+  arrow::Result<int64_t> Read(int64_t nbytes, void* out) override {
+    Wait(nbytes);
+    return file_->Read(nbytes, out);
+  }
+
+  arrow::Result<std::shared_ptr<arrow::Buffer>> Read(int64_t nbytes) override {
+    Wait(nbytes);
+    return file_->Read(nbytes);
+  }
+
+  arrow::Result<int64_t> ReadAt(int64_t position, int64_t nbytes, void* out) override {
+    Wait(nbytes);
+    return file_->ReadAt(position, nbytes, out);
+  }
+
+  arrow::Result<std::shared_ptr<arrow::Buffer>> ReadAt(int64_t position,
+                                                       int64_t nbytes) override {
+    Wait(nbytes);
+    return file_->ReadAt(position, nbytes);
+  }
+
+ private:
+  void Wait(int64_t nbytes) const {
+    std::this_thread::sleep_for(std::chrono::microseconds(
+        latency_us_ + nbytes * 1000000 / std::max<int64_t>(bytes_per_second_, 1)));
+  }
+
+  std::shared_ptr<arrow::io::RandomAccessFile> file_;
+  const int64_t latency_us_;
+  const int64_t bytes_per_second_;
+};
+
+/// \brief Writes random batches with the native writer, then reads them back with
+/// the native reader
+///
+/// The batches are generated once per case. The file read is written by parquet-cpp
+/// with the encoding and codec of the case, the native writer using the default ones.
+/// The key column counts the rows, so that the row groups are ordered by it and a
+/// filter of a key range skips those out of it.
+class BenchmarkParquetReader : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ARROW_ASSIGN_OR_THROW(tmp_dir_, arrow::internal::TemporaryDir::Make("parquet-bench"))
+  }
+
+  void Run(const ParquetCase& c) {
+    std::shared_ptr<arrow::Schema> schema;
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    MakeBatches(c, &schema, &batches);
+    auto path = tmp_dir_->path().ToString() + "/bench.parquet";
+    WriteFile(c, path, schema, batches);
+
+    std::shared_ptr<arrow::io::RandomAccessFile> file;
+    ARROW_ASSIGN_OR_THROW(file, arrow::io::ReadableFile::Open(path))
+    int64_t file_bytes;
+    ARROW_ASSIGN_OR_THROW(file_bytes, file->GetSize())
+    if (c.throttled) {
+      file = std::make_shared<ThrottledFile>(file, kThrottleLatencyUs,
+                                             kThrottleBytesPerSecond);
+    }
+    ::parquet::ArrowReaderProperties properties;
+    properties.set_batch_size(kBatchRows);
+    std::unique_ptr<ParquetFileReader> reader;
+    uint64_t elapse_read = 0;
+    TIME_MICRO_OR_THROW(elapse_read, ParquetFileReader::Open(
+                                         file, arrow::default_memory_pool(),
+                                         properties, &reader));
+    auto threshold = static_cast<int64_t>(c.selectivity * kNumBatches * kBatchRows);
+    auto condition = gandiva::TreeExprBuilder::MakeCondition(
+        gandiva::TreeExprBuilder::MakeFunction(
+            "less_than",
+            {gandiva::TreeExprBuilder::MakeField(schema->field(0)),
+             gandiva::TreeExprBuilder::MakeLiteral(threshold)},
+            arrow::boolean()));
+    bool filtered = c.selectivity < 1.0;
+    switch (c.mode) {
+      case ReadMode::kPlain:
+        break;
+      case ReadMode::kPrefetch:
+        THROW_NOT_OK(reader->SetPrefetch(2));
+        break;
+      case ReadMode::kCoalesced:
+        THROW_NOT_OK(reader->SetCoalescedReads(8192, 64 << 20, 4));
+        break;
+      case ReadMode::kPushdown:
+        if (filtered) {
+          THROW_NOT_OK(reader->SetFilter(condition));
+        }
+        break;
+      case ReadMode::kLateMaterialization:
+        if (filtered) {
+          THROW_NOT_OK(reader->SetRowFilter(condition));
+        }
+        break;
+    }
+    std::vector<int> columns(schema->num_fields());
+    std::iota(columns.begin(), columns.end(), 0);
+    TIME_MICRO_OR_THROW(elapse_read, reader->InitRecordBatchReader(
+                                         columns, 0, std::numeric_limits<int64_t>::max()));
+    int64_t rows_read = 0;
+    int64_t rows_matched = 0;
+    while (true) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      TIME_MICRO_OR_THROW(elapse_read, reader->ReadNext(&batch));
+      if (batch == nullptr) {
+        break;
+      }
+      rows_read += batch->num_rows();
+      // the rows out of the range read by the modes not filtering them
+      auto keys = std::static_pointer_cast<arrow::Int64Array>(batch->column(0));
+      for (int64_t i = 0; i < keys->length(); ++i) {
+        rows_matched += keys->Value(i) < threshold;
+      }
+    }
+    ASSERT_EQ(rows_matched, std::min<int64_t>(threshold, kNumBatches * kBatchRows));
+
+    std::cout << "==================== " << c << " ====================\n"
+              << "Write took " << TIME_TO_STRING(elapse_write_) << ", "
+              << Rate(kNumBatches * kBatchRows, file_bytes, elapse_write_)
+              << "\nRead took " << TIME_TO_STRING(elapse_read) << ", "
+              << Rate(rows_read, file_bytes, elapse_read) << "\nRead " << rows_read
+              << " rows, " << rows_matched << " matching, of a file of " << file_bytes
+              << " bytes" << std::endl;
+    RecordProperty("read_us", std::to_string(elapse_read));
+  }
+
+  /// Write batches with the native writer, timed, then the file read with parquet-cpp
+  void WriteFile(const ParquetCase& c, const std::string& path,
+                 const std::shared_ptr<arrow::Schema>& schema,
+                 const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches) {
+    std::shared_ptr<arrow::io::OutputStream> stream;
+    ARROW_ASSIGN_OR_THROW(stream, arrow::io::FileOutputStream::Open(path))
+    std::unique_ptr<ParquetFileWriter> writer;
+    THROW_NOT_OK(
+        ParquetFileWriter::Open(stream, arrow::default_memory_pool(), schema, &writer));
+    THROW_NOT_OK(writer->SetParallelWrite(write_threads_, c.row_group_rows));
+    elapse_write_ = 0;
+    for (const auto& batch : batches) {
+      TIME_MICRO_OR_THROW(elapse_write_, writer->WriteNext(batch));
+    }
+    TIME_MICRO_OR_THROW(elapse_write_, writer->Flush());
+    THROW_NOT_OK(stream->Close());
+
+    std::shared_ptr<arrow::Table> table;
+    THROW_NOT_OK(arrow::Table::FromRecordBatches(schema, batches, &table));
+    ARROW_ASSIGN_OR_THROW(stream, arrow::io::FileOutputStream::Open(path))
+    ::parquet::WriterProperties::Builder builder;
+    builder.compression(c.codec);
+    if (!c.dictionary) {
+      builder.disable_dictionary();
+    }
+    THROW_NOT_OK(::parquet::arrow::WriteTable(*table, arrow::default_memory_pool(),
+                                              stream, c.row_group_rows,
+                                              builder.build()));
+    THROW_NOT_OK(stream->Close());
+  }
+
+  static void MakeBatches(const ParquetCase& c, std::shared_ptr<arrow::Schema>* schema,
+                          std::vector<std::shared_ptr<arrow::RecordBatch>>* batches) {
+    auto num_strings = static_cast<int>(c.num_columns * c.string_share);
+    std::vector<std::shared_ptr<arrow::Field>> fields = {
+        arrow::field("f_key", arrow::int64())};
+    for (int i = 0; i < c.num_columns; ++i) {
+      auto type = i < num_strings ? arrow::utf8() : arrow::int64();
+      fields.push_back(arrow::field("f_" + std::to_string(i), type));
+    }
+    *schema = arrow::schema(fields);
+
+    std::mt19937 gen(42);
+    // few distinct values, for the dictionary pages to pay off
+    std::uniform_int_distribution<int64_t> value(0, 1 << 10);
+    std::uniform_int_distribution<int> length(4, 24);
+    std::bernoulli_distribution is_null(0.1);
+    for (int b = 0; b < kNumBatches; ++b) {
+      std::vector<std::shared_ptr<arrow::Array>> columns;
+      arrow::Int64Builder key_builder;
+      for (int64_t i = 0; i < kBatchRows; ++i) {
+        THROW_NOT_OK(key_builder.Append(b * kBatchRows + i));
+      }
+      columns.emplace_back();
+      THROW_NOT_OK(key_builder.Finish(&columns.back()));
+      for (int col = 0; col < c.num_columns; ++col) {
+        columns.emplace_back();
+        if (col < num_strings) {
+          arrow::StringBuilder builder;
+          for (int64_t i = 0; i < kBatchRows; ++i) {
+            if (is_null(gen)) {
+              THROW_NOT_OK(builder.AppendNull());
+            } else {
+              THROW_NOT_OK(
+                  builder.Append(std::string(length(gen), 'a' + value(gen) % 26)));
+            }
+          }
+          THROW_NOT_OK(builder.Finish(&columns.back()));
+        } else {
+          arrow::Int64Builder builder;
+          for (int64_t i = 0; i < kBatchRows; ++i) {
+            if (is_null(gen)) {
+              THROW_NOT_OK(builder.AppendNull());
+            } else {
+              THROW_NOT_OK(builder.Append(value(gen)));
+            }
+          }
+          THROW_NOT_OK(builder.Finish(&columns.back()));
+        }
+      }
+      batches->push_back(arrow::RecordBatch::Make(*schema, kBatchRows, columns));
+    }
+  }
+
+  static std::string Rate(int64_t rows, int64_t bytes, uint64_t micros) {
+    double seconds = std::max<uint64_t>(micros, 1) / 1e6;
+    return std::to_string(static_cast<int64_t>(rows / seconds)) + " rows/s, " +
+           std::to_string(static_cast<int64_t>(bytes / seconds / (1 << 20))) + " MB/s";
+  }
+
+  static constexpr int kNumBatches = 64;
+  static constexpr int64_t kBatchRows = 4096;
+  // of a read from a remote store, e.g. HDFS across racks
+  static constexpr int64_t kThrottleLatencyUs = 2000;
+  static constexpr int64_t kThrottleBytesPerSecond = 200 << 20;
+
+  std::unique_ptr<arrow::internal::TemporaryDir> tmp_dir_;
+  int write_threads_ = 1;
+  uint64_t elapse_write_ = 0;
+};
+
+TEST_F(BenchmarkParquetReader, WidthBenchmark) {
+  for (int num_columns : {4, 16, 64}) {
+    ParquetCase c;
+    c.num_columns = num_columns;
+    Run(c);
+  }
+}
+
+TEST_F(BenchmarkParquetReader, EncodingBenchmark) {
+  for (double string_share : {0.0, 0.5, 1.0}) {
+    for (bool dictionary : {true, false}) {
+      ParquetCase c;
+      c.string_share = string_share;
+      c.dictionary = dictionary;
+      Run(c);
+    }
+  }
+}
+
+TEST_F(BenchmarkParquetReader, CodecBenchmark) {
+  for (auto codec : {::parquet::Compression::UNCOMPRESSED, ::parquet::Compression::SNAPPY,
+                     ::parquet::Compression::ZSTD}) {
+    ParquetCase c;
+    c.codec = codec;
+    Run(c);
+  }
+}
+
+TEST_F(BenchmarkParquetReader, RowGroupSizeBenchmark) {
+  for (int64_t row_group_rows : {8 * 1024, 64 * 1024, 256 * 1024}) {
+    ParquetCase c;
+    c.row_group_rows = row_group_rows;
+    Run(c);
+  }
+}
+
+TEST_F(BenchmarkParquetReader, SelectivityBenchmark) {
+  for (auto mode : {ReadMode::kPlain, ReadMode::kPushdown,
+                    ReadMode::kLateMaterialization}) {
+    for (double selectivity : {0.01, 0.1, 0.5}) {
+      ParquetCase c;
+      c.row_group_rows = 16 * 1024;
+      c.selectivity = selectivity;
+      c.mode = mode;
+      Run(c);
+    }
+  }
+}
+
+TEST_F(BenchmarkParquetReader, ThrottledBenchmark) {
+  for (bool throttled : {false, true}) {
+    for (auto mode : {ReadMode::kPlain, ReadMode::kPrefetch, ReadMode::kCoalesced}) {
+      ParquetCase c;
+      c.throttled = throttled;
+      c.mode = mode;
+      Run(c);
+    }
+  }
+}
+
+TEST_F(BenchmarkParquetReader, WriteThreadsBenchmark) {
+  for (int write_threads : {1, 4, 8}) {
+    write_threads_ = write_threads;
+    ParquetCase c;
+    c.num_columns = 64;
+    std::cout << write_threads << " write threads" << std::endl;
+    Run(c);
+  }
+}
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
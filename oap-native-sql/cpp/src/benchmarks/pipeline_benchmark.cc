@@ -0,0 +1,617 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/builder.h>
+#include <arrow/io/file.h>
+#include <arrow/memory_pool.h>
+#include <arrow/record_batch.h>
+#include <arrow/type.h>
+#include <arrow/util/io_util.h>
+#include <gandiva/configuration.h>
+#include <gandiva/filter.h>
+#include <gandiva/projector.h>
+#include <gandiva/selection_vector.h>
+#include <gandiva/tree_expr_builder.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "codegen/code_generator.h"
+#include "codegen/code_generator_factory.h"
+#include "codegen/common/result_iterator.h"
+#include "data_source/parquet/adapter.h"
+#include "shuffle/splitter.h"
+#include "tests/test_utils.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+using ParquetFileReader = jni::parquet::adapters::ParquetFileReader;
+using ParquetFileWriter = jni::parquet::adapters::ParquetFileWriter;
+
+/// Microseconds spent in each operator of a pipeline, in the order they first ran
+class OperatorTimes {
+ public:
+  uint64_t& operator[](const std::string& name) {
+    for (auto& op : times_) {
+      if (op.first == name) {
+        return op.second;
+      }
+    }
+    times_.emplace_back(name, 0);
+    return times_.back().second;
+  }
+
+  const std::vector<std::pair<std::string, uint64_t>>& times() const { return times_; }
+
+ private:
+  std::vector<std::pair<std::string, uint64_t>> times_;
+};
+
+/// \brief gandiva filter, then projection of the rows selected, as the condition
+/// projector of a columnar filter and project does
+class FilterProject {
+ public:
+  FilterProject(const std::shared_ptr<arrow::Schema>& schema,
+                const gandiva::NodePtr& condition,
+                const std::vector<gandiva::ExpressionPtr>& exprs) {
+    auto configuration = gandiva::ConfigurationBuilder().DefaultConfiguration();
+    THROW_NOT_OK(gandiva::Filter::Make(
+        schema, TreeExprBuilder::MakeCondition(condition), configuration, &filter_));
+    THROW_NOT_OK(gandiva::Projector::Make(schema, exprs,
+                                          gandiva::SelectionVector::MODE_UINT32,
+                                          configuration, &projector_));
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    for (const auto& expr : exprs) {
+      fields.push_back(expr->result());
+    }
+    out_schema_ = arrow::schema(fields);
+  }
+
+  std::shared_ptr<arrow::Schema> out_schema() const { return out_schema_; }
+
+  void Evaluate(const arrow::RecordBatch& in, OperatorTimes* times,
+                std::shared_ptr<arrow::RecordBatch>* out) {
+    std::shared_ptr<gandiva::SelectionVector> selection;
+    THROW_NOT_OK(gandiva::SelectionVector::MakeInt32(in.num_rows(), pool_, &selection));
+    TIME_MICRO_OR_THROW((*times)["filter"], filter_->Evaluate(in, selection));
+    arrow::ArrayVector columns;
+    TIME_MICRO_OR_THROW((*times)["project"],
+                        projector_->Evaluate(in, selection.get(), pool_, &columns));
+    *out = arrow::RecordBatch::Make(out_schema_, selection->GetNumSlots(), columns);
+  }
+
+ private:
+  arrow::MemoryPool* pool_ = arrow::default_memory_pool();
+  std::shared_ptr<gandiva::Filter> filter_;
+  std::shared_ptr<gandiva::Projector> projector_;
+  std::shared_ptr<arrow::Schema> out_schema_;
+};
+
+/// \brief Q1, Q3 and Q6 of TPC-H as native pipelines over generated tables
+///
+/// The lineitem and orders tables are generated once into parquet files of a temporary
+/// directory, BENCHMARK_PIPELINE_ROWS lineitem rows, 4 per order. Decimals are doubles
+/// and dates are int32 days since the epoch, as gandiva has no date literal.
+///
+/// Each operator runs on the batches of the one before as they come, and is timed on
+/// its own: the scan, the filter and the projection, the build and the probe of the
+/// join, the aggregation and the shuffle split. The kernels are compiled before the
+/// pipeline runs, timed as codegen. The exchanges are split as on the map side of
+/// Spark, and the pipeline goes on with the same batches: reading them back on the
+/// reduce side is timed by BenchmarkShuffleSplit.
+class BenchmarkNativePipeline : public ::testing::Test {
+ public:
+  static void SetUpTestCase() {
+    ARROW_ASSIGN_OR_THROW(tmp_dir_, arrow::internal::TemporaryDir::Make("pipeline-bench"))
+    auto dir = tmp_dir_->path().ToString();
+    setenv("NATIVESQL_SPARK_LOCAL_DIRS", dir.c_str(), 1);
+    auto env_rows = std::getenv("BENCHMARK_PIPELINE_ROWS");
+    num_lineitem_rows_ =
+        env_rows == nullptr ? kDefaultLineitemRows : std::atoll(env_rows);
+
+    lineitem_schema_ = arrow::schema(
+        {field("l_orderkey", int64()), field("l_quantity", float64()),
+         field("l_extendedprice", float64()), field("l_discount", float64()),
+         field("l_tax", float64()), field("l_returnflag", utf8()),
+         field("l_linestatus", utf8()), field("l_shipdate", int32())});
+    orders_schema_ = arrow::schema({field("o_orderkey", int64()),
+                                    field("o_orderdate", int32()),
+                                    field("o_shippriority", int32())});
+    lineitem_path_ = dir + "lineitem.parquet";
+    orders_path_ = dir + "orders.parquet";
+    std::mt19937 gen(42);
+    WriteTable(lineitem_path_, lineitem_schema_, num_lineitem_rows_,
+               [&gen](int64_t offset, int64_t length) {
+                 return MakeLineitem(&gen, offset, length);
+               },
+               &lineitem_row_groups_);
+    WriteTable(orders_path_, orders_schema_, num_lineitem_rows_ / kLinesPerOrder,
+               [&gen](int64_t offset, int64_t length) {
+                 return MakeOrders(&gen, offset, length);
+               },
+               &orders_row_groups_);
+    std::cout << "Generated " << num_lineitem_rows_ << " lineitem rows in "
+              << lineitem_row_groups_ << " row groups, " << orders_row_groups_
+              << " row groups of orders" << std::endl;
+  }
+
+  static void TearDownTestCase() { tmp_dir_.reset(); }
+
+ protected:
+  /// Read columns of the file at path batch by batch, timed as scan
+  void Scan(const std::string& path, const std::vector<int>& columns,
+            int num_row_groups, OperatorTimes* times,
+            const std::function<void(const std::shared_ptr<arrow::RecordBatch>&)>& next) {
+    std::shared_ptr<arrow::io::RandomAccessFile> file;
+    ARROW_ASSIGN_OR_THROW(file, arrow::io::ReadableFile::Open(path));
+    ::parquet::ArrowReaderProperties properties;
+    properties.set_batch_size(kBatchRows);
+    std::unique_ptr<ParquetFileReader> reader;
+    std::vector<int> row_groups;
+    for (int i = 0; i < num_row_groups; ++i) {
+      row_groups.push_back(i);
+    }
+    TIME_MICRO_OR_THROW((*times)["scan"],
+                        ParquetFileReader::Open(file, arrow::default_memory_pool(),
+                                                properties, &reader));
+    TIME_MICRO_OR_THROW((*times)["scan"],
+                        reader->InitRecordBatchReader(columns, row_groups));
+    while (true) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      TIME_MICRO_OR_THROW((*times)["scan"], reader->ReadNext(&batch));
+      if (batch == nullptr) {
+        return;
+      }
+      next(batch);
+    }
+  }
+
+  /// Splitter of the exchange hash partitioning rows by the key columns
+  static std::shared_ptr<shuffle::Splitter> MakeExchange(
+      const std::shared_ptr<arrow::Schema>& schema, std::vector<int32_t> key_indices) {
+    shuffle::PartitioningOptions options;
+    options.partitioning = shuffle::Partitioning::HASH;
+    options.key_indices = std::move(key_indices);
+    std::shared_ptr<shuffle::Splitter> splitter;
+    ARROW_ASSIGN_OR_THROW(splitter,
+                          shuffle::Splitter::Make(schema, kNumPartitions, options));
+    return splitter;
+  }
+
+  /// Drain the result iterator of an aggregation, timed as aggregate
+  static void DrainAggregate(const std::shared_ptr<CodeGenerator>& aggregate,
+                             OperatorTimes* times,
+                             const std::function<void(const arrow::RecordBatch&)>& next) {
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> iter;
+    TIME_MICRO_OR_THROW((*times)["aggregate"], aggregate->finish(&iter));
+    while (iter->HasNext()) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      TIME_MICRO_OR_THROW((*times)["aggregate"], iter->Next(&batch));
+      next(*batch);
+    }
+  }
+
+  void Report(const std::string& query, int64_t num_output_rows,
+              const OperatorTimes& times) {
+    uint64_t total = 0;
+    for (const auto& op : times.times()) {
+      total += op.second;
+    }
+    std::cout << "==================== " << query << " ====================\n"
+              << num_lineitem_rows_ << " lineitem rows, " << num_output_rows
+              << " output rows, " << TIME_TO_STRING(total) << " in total\n";
+    for (const auto& op : times.times()) {
+      std::cout << op.first << " took " << TIME_TO_STRING(op.second) << ", "
+                << op.second * 100 / std::max<uint64_t>(total, 1) << "%\n";
+      RecordProperty(op.first + "_us", std::to_string(op.second));
+    }
+    std::cout << "================================================" << std::endl;
+    RecordProperty("total_us", std::to_string(total));
+  }
+
+  /// Schema of columns of schema, as read by Scan
+  static std::shared_ptr<arrow::Schema> Select(
+      const std::shared_ptr<arrow::Schema>& schema, const std::vector<int>& columns) {
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    for (auto i : columns) {
+      fields.push_back(schema->field(i));
+    }
+    return arrow::schema(fields);
+  }
+
+  static std::vector<gandiva::NodePtr> Columns(
+      const std::shared_ptr<arrow::Schema>& schema) {
+    std::vector<gandiva::NodePtr> nodes;
+    for (const auto& f : schema->fields()) {
+      nodes.push_back(TreeExprBuilder::MakeField(f));
+    }
+    return nodes;
+  }
+
+  static gandiva::NodePtr Column(const std::shared_ptr<arrow::Schema>& schema,
+                                 const std::string& name) {
+    return TreeExprBuilder::MakeField(schema->GetFieldByName(name));
+  }
+
+  static gandiva::NodePtr Call(const std::string& name,
+                               const std::vector<gandiva::NodePtr>& args,
+                               const std::shared_ptr<arrow::DataType>& type) {
+    return TreeExprBuilder::MakeFunction(name, args, type);
+  }
+
+  static gandiva::NodePtr Days(int32_t days) {
+    return TreeExprBuilder::MakeLiteral(days);
+  }
+
+  static gandiva::NodePtr Real(double value) {
+    return TreeExprBuilder::MakeLiteral(value);
+  }
+
+  static constexpr int64_t kBatchRows = 4096;
+  static constexpr int32_t kNumPartitions = 200;
+
+  static std::unique_ptr<arrow::internal::TemporaryDir> tmp_dir_;
+  static int64_t num_lineitem_rows_;
+  static std::shared_ptr<arrow::Schema> lineitem_schema_;
+  static std::shared_ptr<arrow::Schema> orders_schema_;
+  static std::string lineitem_path_;
+  static std::string orders_path_;
+  static int lineitem_row_groups_;
+  static int orders_row_groups_;
+
+ private:
+  static void WriteTable(
+      const std::string& path, const std::shared_ptr<arrow::Schema>& schema,
+      int64_t num_rows,
+      const std::function<std::shared_ptr<arrow::RecordBatch>(int64_t, int64_t)>& make,
+      int* num_row_groups) {
+    std::shared_ptr<arrow::io::OutputStream> stream;
+    ARROW_ASSIGN_OR_THROW(stream, arrow::io::FileOutputStream::Open(path));
+    std::unique_ptr<ParquetFileWriter> writer;
+    THROW_NOT_OK(
+        ParquetFileWriter::Open(stream, arrow::default_memory_pool(), schema, &writer));
+    THROW_NOT_OK(writer->SetParallelWrite(1, kRowGroupRows));
+    for (int64_t offset = 0; offset < num_rows; offset += kBatchRows) {
+      auto length = std::min(kBatchRows, num_rows - offset);
+      THROW_NOT_OK(writer->WriteNext(make(offset, length)));
+    }
+    THROW_NOT_OK(writer->Flush());
+    THROW_NOT_OK(stream->Close());
+    *num_row_groups = static_cast<int>((num_rows + kRowGroupRows - 1) / kRowGroupRows);
+  }
+
+  static std::shared_ptr<arrow::RecordBatch> MakeLineitem(std::mt19937* gen,
+                                                          int64_t offset,
+                                                          int64_t length) {
+    std::uniform_int_distribution<int> quantity(1, 50);
+    std::uniform_real_distribution<double> price(900.0, 105000.0);
+    std::uniform_int_distribution<int> discount(0, 10);
+    std::uniform_int_distribution<int> tax(0, 8);
+    std::uniform_int_distribution<int> flag(0, 2);
+    std::uniform_int_distribution<int32_t> shipdate(kMinDate, kMaxDate);
+    arrow::Int64Builder orderkey_builder;
+    arrow::DoubleBuilder quantity_builder, price_builder, discount_builder, tax_builder;
+    arrow::StringBuilder returnflag_builder, linestatus_builder;
+    arrow::Int32Builder shipdate_builder;
+    for (int64_t i = offset; i < offset + length; ++i) {
+      THROW_NOT_OK(orderkey_builder.Append(i / kLinesPerOrder));
+      THROW_NOT_OK(quantity_builder.Append(quantity(*gen)));
+      THROW_NOT_OK(price_builder.Append(price(*gen)));
+      THROW_NOT_OK(discount_builder.Append(discount(*gen) / 100.0));
+      THROW_NOT_OK(tax_builder.Append(tax(*gen) / 100.0));
+      auto date = shipdate(*gen);
+      THROW_NOT_OK(returnflag_builder.Append(std::string(1, "ANR"[flag(*gen)])));
+      THROW_NOT_OK(linestatus_builder.Append(date > kStatusDate ? "O" : "F"));
+      THROW_NOT_OK(shipdate_builder.Append(date));
+    }
+    std::vector<std::shared_ptr<arrow::Array>> columns(8);
+    THROW_NOT_OK(orderkey_builder.Finish(&columns[0]));
+    THROW_NOT_OK(quantity_builder.Finish(&columns[1]));
+    THROW_NOT_OK(price_builder.Finish(&columns[2]));
+    THROW_NOT_OK(discount_builder.Finish(&columns[3]));
+    THROW_NOT_OK(tax_builder.Finish(&columns[4]));
+    THROW_NOT_OK(returnflag_builder.Finish(&columns[5]));
+    THROW_NOT_OK(linestatus_builder.Finish(&columns[6]));
+    THROW_NOT_OK(shipdate_builder.Finish(&columns[7]));
+    return arrow::RecordBatch::Make(lineitem_schema_, length, columns);
+  }
+
+  static std::shared_ptr<arrow::RecordBatch> MakeOrders(std::mt19937* gen,
+                                                        int64_t offset, int64_t length) {
+    std::uniform_int_distribution<int32_t> orderdate(kMinDate, kMaxDate);
+    arrow::Int64Builder orderkey_builder;
+    arrow::Int32Builder orderdate_builder, shippriority_builder;
+    for (int64_t i = offset; i < offset + length; ++i) {
+      THROW_NOT_OK(orderkey_builder.Append(i));
+      THROW_NOT_OK(orderdate_builder.Append(orderdate(*gen)));
+      THROW_NOT_OK(shippriority_builder.Append(0));
+    }
+    std::vector<std::shared_ptr<arrow::Array>> columns(3);
+    THROW_NOT_OK(orderkey_builder.Finish(&columns[0]));
+    THROW_NOT_OK(orderdate_builder.Finish(&columns[1]));
+    THROW_NOT_OK(shippriority_builder.Finish(&columns[2]));
+    return arrow::RecordBatch::Make(orders_schema_, length, columns);
+  }
+
+  static constexpr int64_t kDefaultLineitemRows = 1 << 22;
+  static constexpr int64_t kRowGroupRows = 1 << 20;
+  static constexpr int kLinesPerOrder = 4;
+  // 1992-01-01 to 1998-12-31, the lines shipped after 1995-06-17 are open
+  static constexpr int32_t kMinDate = 8035;
+  static constexpr int32_t kMaxDate = 10591;
+  static constexpr int32_t kStatusDate = 9298;
+};
+
+std::unique_ptr<arrow::internal::TemporaryDir> BenchmarkNativePipeline::tmp_dir_;
+int64_t BenchmarkNativePipeline::num_lineitem_rows_ = 0;
+std::shared_ptr<arrow::Schema> BenchmarkNativePipeline::lineitem_schema_;
+std::shared_ptr<arrow::Schema> BenchmarkNativePipeline::orders_schema_;
+std::string BenchmarkNativePipeline::lineitem_path_;
+std::string BenchmarkNativePipeline::orders_path_;
+int BenchmarkNativePipeline::lineitem_row_groups_ = 0;
+int BenchmarkNativePipeline::orders_row_groups_ = 0;
+
+
+TEST_F(BenchmarkNativePipeline, Q1Benchmark) {
+  // scan, filter l_shipdate <= 1998-09-02 and project the charges
+  std::vector<int> columns = {1, 2, 3, 4, 5, 6, 7};
+  auto scan_schema = Select(lineitem_schema_, columns);
+  auto price = Column(scan_schema, "l_extendedprice");
+  auto discount = Column(scan_schema, "l_discount");
+  auto disc_price = Call(
+      "multiply", {price, Call("subtract", {Real(1.0), discount}, float64())}, float64());
+  auto charge = Call(
+      "multiply",
+      {disc_price, Call("add", {Real(1.0), Column(scan_schema, "l_tax")}, float64())},
+      float64());
+  auto condition = Call("less_than_or_equal_to",
+                        {Column(scan_schema, "l_shipdate"), Days(10471)}, boolean());
+  FilterProject filter_project(
+      scan_schema, condition,
+      {TreeExprBuilder::MakeExpression(Column(scan_schema, "l_returnflag"),
+                                       field("l_returnflag", utf8())),
+       TreeExprBuilder::MakeExpression(Column(scan_schema, "l_linestatus"),
+                                       field("l_linestatus", utf8())),
+       TreeExprBuilder::MakeExpression(Column(scan_schema, "l_quantity"),
+                                       field("l_quantity", float64())),
+       TreeExprBuilder::MakeExpression(price, field("l_extendedprice", float64())),
+       TreeExprBuilder::MakeExpression(disc_price, field("disc_price", float64())),
+       TreeExprBuilder::MakeExpression(charge, field("charge", float64())),
+       TreeExprBuilder::MakeExpression(discount, field("l_discount", float64()))});
+
+  // group by l_returnflag, l_linestatus
+  auto aggr_schema = filter_project.out_schema();
+  auto aggr_fields = Columns(aggr_schema);
+  auto n_aggr = Call("hashAggregateArrays",
+                     {Call("action_groupby", {aggr_fields[0]}, uint32()),
+                      Call("action_groupby", {aggr_fields[1]}, uint32()),
+                      Call("action_sum", {aggr_fields[2]}, uint32()),
+                      Call("action_sum", {aggr_fields[3]}, uint32()),
+                      Call("action_sum", {aggr_fields[4]}, uint32()),
+                      Call("action_sum", {aggr_fields[5]}, uint32()),
+                      Call("action_avg", {aggr_fields[2]}, uint32()),
+                      Call("action_avg", {aggr_fields[3]}, uint32()),
+                      Call("action_avg", {aggr_fields[6]}, uint32()),
+                      Call("action_countLiteral_1", {}, uint32())},
+                     uint32());
+  auto n_codegen_aggr =
+      Call("codegen_withOneInput",
+           {n_aggr, Call("codegen_schema", aggr_fields, uint32())}, uint32());
+  std::vector<std::shared_ptr<arrow::Field>> ret_fields = {
+      field("l_returnflag", utf8()),      field("l_linestatus", utf8()),
+      field("sum_qty", float64()),        field("sum_base_price", float64()),
+      field("sum_disc_price", float64()), field("sum_charge", float64()),
+      field("avg_qty", float64()),        field("avg_price", float64()),
+      field("avg_disc", float64()),       field("count_order", int64())};
+
+  OperatorTimes times;
+  std::shared_ptr<CodeGenerator> aggregate;
+  auto f_res = field("res", uint32());
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+  TIME_MICRO_OR_THROW(
+      times["codegen"],
+      CreateCodeGenerator(aggr_schema, {aggr_expr}, ret_fields, &aggregate, true));
+  std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+  Scan(lineitem_path_, columns, lineitem_row_groups_, &times,
+       [&](const std::shared_ptr<arrow::RecordBatch>& batch) {
+         std::shared_ptr<arrow::RecordBatch> projected;
+         filter_project.Evaluate(*batch, &times, &projected);
+         TIME_MICRO_OR_THROW(times["aggregate"],
+                             aggregate->evaluate(projected, &dummy_result_batches));
+       });
+
+  // the groups are exchanged by l_returnflag, l_linestatus for the final aggregation
+  auto exchange = MakeExchange(arrow::schema(ret_fields), {0, 1});
+  int64_t num_output_rows = 0;
+  DrainAggregate(aggregate, &times, [&](const arrow::RecordBatch& batch) {
+    TIME_MICRO_OR_THROW(times["shuffle_split"], exchange->Split(batch));
+    num_output_rows += batch.num_rows();
+  });
+  TIME_MICRO_OR_THROW(times["shuffle_split"], exchange->Stop());
+  Report("Q1", num_output_rows, times);
+}
+
+TEST_F(BenchmarkNativePipeline, Q3Benchmark) {
+  // build side, the orders before 1995-03-15
+  std::vector<int> orders_columns = {0, 1, 2};
+  std::vector<gandiva::ExpressionPtr> orders_exprs;
+  for (const auto& f : orders_schema_->fields()) {
+    auto node = TreeExprBuilder::MakeField(f);
+    orders_exprs.push_back(TreeExprBuilder::MakeExpression(node, f));
+  }
+  FilterProject orders_filter(
+      orders_schema_,
+      Call("less_than", {Column(orders_schema_, "o_orderdate"), Days(9204)}, boolean()),
+      orders_exprs);
+
+  // probe side, the revenue of the lines shipped after 1995-03-15
+  std::vector<int> lineitem_columns = {0, 2, 3, 7};
+  auto scan_schema = Select(lineitem_schema_, lineitem_columns);
+  auto revenue = Call(
+      "multiply",
+      {Column(scan_schema, "l_extendedprice"),
+       Call("subtract", {Real(1.0), Column(scan_schema, "l_discount")}, float64())},
+      float64());
+  FilterProject lineitem_filter(
+      scan_schema,
+      Call("greater_than", {Column(scan_schema, "l_shipdate"), Days(9204)}, boolean()),
+      {TreeExprBuilder::MakeExpression(Column(scan_schema, "l_orderkey"),
+                                       field("l_orderkey", int64())),
+       TreeExprBuilder::MakeExpression(revenue, field("revenue", float64()))});
+
+  // join on o_orderkey = l_orderkey, the output is the build side columns, then the
+  // probe side ones
+  auto left_schema = orders_filter.out_schema();
+  auto right_schema = lineitem_filter.out_schema();
+  auto left_fields = Columns(left_schema);
+  auto right_fields = Columns(right_schema);
+  auto join_fields = left_schema->fields();
+  for (const auto& f : right_schema->fields()) {
+    join_fields.push_back(f);
+  }
+  auto n_probe = Call("conditionedProbeArraysInner",
+                      {Call("codegen_left_key_schema", {left_fields[0]}, uint32()),
+                       Call("codegen_right_key_schema", {right_fields[0]}, uint32())},
+                      uint32());
+  auto n_codegen_probe =
+      Call("codegen_withTwoInputs",
+           {n_probe, Call("codegen_left_schema", left_fields, uint32()),
+            Call("codegen_right_schema", right_fields, uint32())},
+           uint32());
+
+  // group by l_orderkey, o_orderdate, o_shippriority
+  auto join_schema = arrow::schema(join_fields);
+  auto aggr_fields = Columns(join_schema);
+  auto n_aggr = Call("hashAggregateArrays",
+                     {Call("action_groupby", {aggr_fields[3]}, uint32()),
+                      Call("action_groupby", {aggr_fields[1]}, uint32()),
+                      Call("action_groupby", {aggr_fields[2]}, uint32()),
+                      Call("action_sum", {aggr_fields[4]}, uint32())},
+                     uint32());
+  auto n_codegen_aggr =
+      Call("codegen_withOneInput",
+           {n_aggr, Call("codegen_schema", aggr_fields, uint32())}, uint32());
+  std::vector<std::shared_ptr<arrow::Field>> ret_fields = {
+      field("l_orderkey", int64()), field("o_orderdate", int32()),
+      field("o_shippriority", int32()), field("revenue", float64())};
+
+  OperatorTimes times;
+  std::shared_ptr<CodeGenerator> join;
+  std::shared_ptr<CodeGenerator> aggregate;
+  auto f_res = field("res", uint32());
+  auto probe_expr = TreeExprBuilder::MakeExpression(n_codegen_probe, f_res);
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+  TIME_MICRO_OR_THROW(times["codegen"], CreateCodeGenerator(left_schema, {probe_expr},
+                                                            join_fields, &join, true));
+  TIME_MICRO_OR_THROW(
+      times["codegen"],
+      CreateCodeGenerator(join_schema, {aggr_expr}, ret_fields, &aggregate, true));
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+  auto orders_exchange = MakeExchange(left_schema, {0});
+  Scan(orders_path_, orders_columns, orders_row_groups_, &times,
+       [&](const std::shared_ptr<arrow::RecordBatch>& batch) {
+         std::shared_ptr<arrow::RecordBatch> selected;
+         orders_filter.Evaluate(*batch, &times, &selected);
+         TIME_MICRO_OR_THROW(times["shuffle_split"], orders_exchange->Split(*selected));
+         TIME_MICRO_OR_THROW(times["join_build"],
+                             join->evaluate(selected, &dummy_result_batches));
+       });
+  TIME_MICRO_OR_THROW(times["shuffle_split"], orders_exchange->Stop());
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> probe;
+  TIME_MICRO_OR_THROW(times["join_build"], join->finish(&probe));
+
+  auto lineitem_exchange = MakeExchange(right_schema, {0});
+  Scan(lineitem_path_, lineitem_columns, lineitem_row_groups_, &times,
+       [&](const std::shared_ptr<arrow::RecordBatch>& batch) {
+         std::shared_ptr<arrow::RecordBatch> projected;
+         lineitem_filter.Evaluate(*batch, &times, &projected);
+         TIME_MICRO_OR_THROW(times["shuffle_split"],
+                             lineitem_exchange->Split(*projected));
+         std::shared_ptr<arrow::RecordBatch> joined;
+         TIME_MICRO_OR_THROW(times["join_probe"],
+                             probe->Process(projected->columns(), &joined));
+         // the matches left over by Process are streamed by ProcessRemaining
+         while (joined != nullptr) {
+           TIME_MICRO_OR_THROW(times["aggregate"],
+                               aggregate->evaluate(joined, &dummy_result_batches));
+           TIME_MICRO_OR_THROW(times["join_probe"], probe->ProcessRemaining(&joined));
+         }
+       });
+  TIME_MICRO_OR_THROW(times["shuffle_split"], lineitem_exchange->Stop());
+
+  int64_t num_output_rows = 0;
+  DrainAggregate(aggregate, &times, [&](const arrow::RecordBatch& batch) {
+    num_output_rows += batch.num_rows();
+  });
+  Report("Q3", num_output_rows, times);
+}
+
+TEST_F(BenchmarkNativePipeline, Q6Benchmark) {
+  // the lines shipped in 1994 with a discount of 0.05 to 0.07 and a quantity below 24
+  std::vector<int> columns = {1, 2, 3, 7};
+  auto scan_schema = Select(lineitem_schema_, columns);
+  auto shipdate = Column(scan_schema, "l_shipdate");
+  auto discount = Column(scan_schema, "l_discount");
+  auto condition = TreeExprBuilder::MakeAnd(
+      {Call("greater_than_or_equal_to", {shipdate, Days(8766)}, boolean()),
+       Call("less_than", {shipdate, Days(9131)}, boolean()),
+       Call("greater_than_or_equal_to", {discount, Real(0.05)}, boolean()),
+       Call("less_than_or_equal_to", {discount, Real(0.07)}, boolean()),
+       Call("less_than", {Column(scan_schema, "l_quantity"), Real(24.0)}, boolean())});
+  auto f_revenue = field("revenue", float64());
+  auto revenue =
+      Call("multiply", {Column(scan_schema, "l_extendedprice"), discount}, float64());
+  FilterProject filter_project(scan_schema, condition,
+                               {TreeExprBuilder::MakeExpression(revenue, f_revenue)});
+
+  OperatorTimes times;
+  std::shared_ptr<CodeGenerator> aggregate;
+  auto n_sum = Call("sum", {TreeExprBuilder::MakeField(f_revenue)}, float64());
+  auto sum_expr = TreeExprBuilder::MakeExpression(n_sum, f_revenue);
+  TIME_MICRO_OR_THROW(times["codegen"],
+                      CreateCodeGenerator(filter_project.out_schema(), {sum_expr},
+                                          {f_revenue}, &aggregate, true));
+  std::vector<std::shared_ptr<arrow::RecordBatch>> result_batches;
+  Scan(lineitem_path_, columns, lineitem_row_groups_, &times,
+       [&](const std::shared_ptr<arrow::RecordBatch>& batch) {
+         std::shared_ptr<arrow::RecordBatch> projected;
+         filter_project.Evaluate(*batch, &times, &projected);
+         TIME_MICRO_OR_THROW(times["aggregate"],
+                             aggregate->evaluate(projected, &result_batches));
+       });
+  result_batches.clear();
+  TIME_MICRO_OR_THROW(times["aggregate"], aggregate->finish(&result_batches));
+  int64_t num_output_rows = 0;
+  for (const auto& batch : result_batches) {
+    num_output_rows += batch->num_rows();
+  }
+  Report("Q6", num_output_rows, times);
+}
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
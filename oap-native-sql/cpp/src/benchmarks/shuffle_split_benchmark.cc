@@ -0,0 +1,262 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/buffer.h>
+#include <arrow/builder.h>
+#include <arrow/io/file.h>
+#include <arrow/record_batch.h>
+#include <arrow/type.h>
+#include <arrow/util/compression.h>
+#include <arrow/util/io_util.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "shuffle/reader.h"
+#include "shuffle/splitter.h"
+#include "tests/test_utils.h"
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// Shape of the input and of the splitter of one run
+struct SplitCase {
+  int32_t num_partitions = 1000;
+  // columns besides the partition id
+  int num_columns = 16;
+  double null_ratio = 0.1;
+  // share of the columns which are strings, the others are int64
+  double string_share = 0.25;
+  int64_t buffer_size = kDefaultSplitterBufferSize;
+  arrow::Compression::type codec = arrow::Compression::LZ4_FRAME;
+};
+
+std::ostream& operator<<(std::ostream& os, const SplitCase& c) {
+  return os << "partitions " << c.num_partitions << ", columns " << c.num_columns
+            << ", null ratio " << c.null_ratio << ", string share " << c.string_share
+            << ", buffer size " << c.buffer_size << ", codec "
+            << arrow::util::Codec::GetCodecAsString(c.codec);
+}
+
+/// \brief Splits random batches, then reads back the partition files
+///
+/// The batches are generated once per case, so that split, spill and decompress only
+/// are timed. Spill is the serialization, compression and write of the partition
+/// buffers, timed by the splitter itself.
+class BenchmarkShuffleSplit : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ARROW_ASSIGN_OR_THROW(tmp_dir_, arrow::internal::TemporaryDir::Make("shuffle-bench"))
+    setenv("NATIVESQL_SPARK_LOCAL_DIRS", tmp_dir_->path().ToString().c_str(), 1);
+  }
+
+  void Run(const SplitCase& c) {
+    std::shared_ptr<arrow::Schema> schema;
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    MakeBatches(c, &schema, &batches);
+    int64_t num_rows = 0;
+    int64_t input_bytes = 0;
+    for (const auto& batch : batches) {
+      num_rows += batch->num_rows();
+      input_bytes += BatchBytes(*batch);
+    }
+
+    std::shared_ptr<Splitter> splitter;
+    ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(schema, c.num_partitions));
+    splitter->set_buffer_size(c.buffer_size);
+    splitter->set_compression_codec(c.codec);
+    uint64_t elapse_split = 0;
+    for (const auto& batch : batches) {
+      TIME_MICRO_OR_THROW(elapse_split, splitter->Split(*batch));
+    }
+    THROW_NOT_OK(splitter->Stop());
+    int64_t bytes_written;
+    ARROW_ASSIGN_OR_THROW(bytes_written, splitter->TotalBytesWritten());
+    auto elapse_spill =
+        (splitter->TotalCompressTime() + splitter->TotalWriteTime()) / 1000;
+
+    // each partition file is a block of the reduce side
+    std::vector<std::shared_ptr<arrow::Buffer>> blocks;
+    for (const auto& info : splitter->GetPartitionFileInfo()) {
+      std::shared_ptr<arrow::io::ReadableFile> file;
+      ARROW_ASSIGN_OR_THROW(file, arrow::io::ReadableFile::Open(info.second))
+      int64_t size;
+      ARROW_ASSIGN_OR_THROW(size, file->GetSize())
+      std::shared_ptr<arrow::Buffer> block;
+      ARROW_ASSIGN_OR_THROW(block, file->Read(size))
+      blocks.push_back(block);
+    }
+    std::shared_ptr<arrow::Schema> writer_schema;
+    ARROW_ASSIGN_OR_THROW(writer_schema, schema->RemoveField(0))
+    std::shared_ptr<ShuffleReader> reader;
+    ARROW_ASSIGN_OR_THROW(reader, ShuffleReader::Make(blocks, writer_schema))
+    uint64_t elapse_decompress = 0;
+    int64_t rows_read = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (reader->HasNext()) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      THROW_NOT_OK(reader->Next(&batch));
+      rows_read += batch->num_rows();
+    }
+    elapse_decompress += std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    ASSERT_EQ(rows_read, num_rows);
+
+    std::cout << "==================== " << c << " ====================\n"
+              << "Split took " << TIME_TO_STRING(elapse_split) << ", "
+              << Rate(num_rows, input_bytes, elapse_split) << "\nSpill took "
+              << TIME_TO_STRING(elapse_spill) << ", "
+              << Rate(num_rows, bytes_written, elapse_spill) << "\nDecompress took "
+              << TIME_TO_STRING(elapse_decompress) << ", "
+              << Rate(num_rows, bytes_written, elapse_decompress) << "\nWrote "
+              << bytes_written << " bytes of " << input_bytes << " input bytes, "
+              << splitter->TotalSpills() << " spills" << std::endl;
+  }
+
+  static void MakeBatches(const SplitCase& c, std::shared_ptr<arrow::Schema>* schema,
+                          std::vector<std::shared_ptr<arrow::RecordBatch>>* batches) {
+    auto num_strings = static_cast<int>(c.num_columns * c.string_share);
+    std::vector<std::shared_ptr<arrow::Field>> fields = {
+        arrow::field("f_pid", arrow::int32())};
+    for (int i = 0; i < c.num_columns; ++i) {
+      auto type = i < num_strings ? arrow::utf8() : arrow::int64();
+      fields.push_back(arrow::field("f_" + std::to_string(i), type));
+    }
+    *schema = arrow::schema(fields);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int32_t> pid(0, c.num_partitions - 1);
+    std::uniform_int_distribution<int64_t> value(0, 1 << 20);
+    std::uniform_int_distribution<int> length(4, 24);
+    std::bernoulli_distribution is_null(c.null_ratio);
+    for (int b = 0; b < kNumBatches; ++b) {
+      std::vector<std::shared_ptr<arrow::Array>> columns;
+      arrow::Int32Builder pid_builder;
+      for (int64_t i = 0; i < kBatchRows; ++i) {
+        THROW_NOT_OK(pid_builder.Append(pid(gen)));
+      }
+      columns.emplace_back();
+      THROW_NOT_OK(pid_builder.Finish(&columns.back()));
+      for (int col = 0; col < c.num_columns; ++col) {
+        columns.emplace_back();
+        if (col < num_strings) {
+          arrow::StringBuilder builder;
+          for (int64_t i = 0; i < kBatchRows; ++i) {
+            if (is_null(gen)) {
+              THROW_NOT_OK(builder.AppendNull());
+            } else {
+              THROW_NOT_OK(builder.Append(std::string(length(gen), 'a' + i % 26)));
+            }
+          }
+          THROW_NOT_OK(builder.Finish(&columns.back()));
+        } else {
+          arrow::Int64Builder builder;
+          for (int64_t i = 0; i < kBatchRows; ++i) {
+            if (is_null(gen)) {
+              THROW_NOT_OK(builder.AppendNull());
+            } else {
+              THROW_NOT_OK(builder.Append(value(gen)));
+            }
+          }
+          THROW_NOT_OK(builder.Finish(&columns.back()));
+        }
+      }
+      batches->push_back(arrow::RecordBatch::Make(*schema, kBatchRows, columns));
+    }
+  }
+
+  static int64_t BatchBytes(const arrow::RecordBatch& batch) {
+    int64_t bytes = 0;
+    for (int i = 0; i < batch.num_columns(); ++i) {
+      for (const auto& buffer : batch.column_data(i)->buffers) {
+        if (buffer != nullptr) bytes += buffer->size();
+      }
+    }
+    return bytes;
+  }
+
+  static std::string Rate(int64_t rows, int64_t bytes, uint64_t micros) {
+    double seconds = std::max<uint64_t>(micros, 1) / 1e6;
+    return std::to_string(static_cast<int64_t>(rows / seconds)) + " rows/s, " +
+           std::to_string(static_cast<int64_t>(bytes / seconds / (1 << 20))) + " MB/s";
+  }
+
+  static constexpr int kNumBatches = 64;
+  static constexpr int64_t kBatchRows = 4096;
+
+  std::unique_ptr<arrow::internal::TemporaryDir> tmp_dir_;
+};
+
+TEST_F(BenchmarkShuffleSplit, PartitionsBenchmark) {
+  for (int32_t num_partitions : {10, 100, 1000, 10000}) {
+    SplitCase c;
+    c.num_partitions = num_partitions;
+    Run(c);
+  }
+}
+
+TEST_F(BenchmarkShuffleSplit, WidthBenchmark) {
+  for (int num_columns : {4, 16, 64}) {
+    SplitCase c;
+    c.num_columns = num_columns;
+    Run(c);
+  }
+}
+
+TEST_F(BenchmarkShuffleSplit, NullRatioBenchmark) {
+  for (double null_ratio : {0.0, 0.1, 0.5, 0.9}) {
+    SplitCase c;
+    c.null_ratio = null_ratio;
+    Run(c);
+  }
+}
+
+TEST_F(BenchmarkShuffleSplit, StringShareBenchmark) {
+  for (double string_share : {0.0, 0.25, 0.5, 1.0}) {
+    SplitCase c;
+    c.string_share = string_share;
+    Run(c);
+  }
+}
+
+TEST_F(BenchmarkShuffleSplit, BufferSizeBenchmark) {
+  for (int64_t buffer_size : {1024, 4096, 16384}) {
+    SplitCase c;
+    c.buffer_size = buffer_size;
+    Run(c);
+  }
+}
+
+TEST_F(BenchmarkShuffleSplit, CodecBenchmark) {
+  for (auto codec : {arrow::Compression::UNCOMPRESSED, arrow::Compression::LZ4_FRAME,
+                     arrow::Compression::ZSTD}) {
+    SplitCase c;
+    c.codec = codec;
+    Run(c);
+  }
+}
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
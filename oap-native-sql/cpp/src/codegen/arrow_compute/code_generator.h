@@ -21,6 +21,7 @@
 #include <arrow/record_batch.h>
 #include <arrow/type.h>
 #include <chrono>
+#include <unordered_set>
 #include "codegen/arrow_compute/expr_visitor.h"
 #include "codegen/code_generator.h"
 #include "codegen/common/result_iterator.h"
@@ -36,7 +37,8 @@ class ArrowComputeCodeGenerator : public CodeGenerator {
       std::shared_ptr<arrow::Schema> schema_ptr,
       std::vector<std::shared_ptr<gandiva::Expression>> expr_vector,
       std::vector<std::shared_ptr<arrow::Field>> ret_types, bool return_when_finish,
-      std::vector<std::shared_ptr<::gandiva::Expression>> finish_exprs_vector)
+      std::vector<std::shared_ptr<::gandiva::Expression>> finish_exprs_vector,
+      arrow::MemoryPool* pool = arrow::default_memory_pool())
       : schema_(schema_ptr),
         ret_types_(ret_types),
         return_when_finish_(return_when_finish) {
@@ -48,12 +50,12 @@ class ArrowComputeCodeGenerator : public CodeGenerator {
       std::shared_ptr<ExprVisitor> root_visitor;
       if (finish_exprs_vector.empty()) {
         auto visitor = MakeExprVisitor(schema_ptr, expr, ret_types_, &expr_visitor_cache_,
-                                       &root_visitor);
+                                       &root_visitor, pool);
         auto status = DistinctInsert(root_visitor, &visitor_list_);
       } else {
         auto visitor =
             MakeExprVisitor(schema_ptr, expr, ret_types_, finish_exprs_vector[i++],
-                            &expr_visitor_cache_, &root_visitor);
+                            &expr_visitor_cache_, &root_visitor, pool);
         auto status = DistinctInsert(root_visitor, &visitor_list_);
       }
     }
@@ -241,6 +243,14 @@ class ArrowComputeCodeGenerator : public CodeGenerator {
     return arrow::Status::OK();
   }
 
+  arrow::Status GetMetrics(std::vector<KernelMetrics>* out) override {
+    std::unordered_set<ExprVisitor*> visited;
+    for (auto visitor : visitor_list_) {
+      visitor->GetMetrics(&visited, out);
+    }
+    return arrow::Status::OK();
+  }
+
  private:
   std::vector<std::shared_ptr<ExprVisitor>> visitor_list_;
   std::shared_ptr<arrow::Schema> schema_;
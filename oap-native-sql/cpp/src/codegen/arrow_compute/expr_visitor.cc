@@ -25,22 +25,135 @@
 #include <gandiva/node.h>
 #include <gandiva/tree_expr_builder.h>
 
+#include <chrono>
+#include <cstdlib>
+#include <functional>
 #include <memory>
 
 #include "codegen/arrow_compute/expr_visitor_impl.h"
+#include "codegen/arrow_compute/ext/codegen_common.h"
 #include "codegen/arrow_compute/ext/kernels_ext.h"
+#include "utils/trace.h"
 
 namespace sparkcolumnarplugin {
 namespace codegen {
 namespace arrowcompute {
 
+namespace {
+
+/// Run the call of a kernel, tracing it as a span named event and adding the time it
+/// took to metrics, the time waiting for generated codes to be compiled or loaded apart
+arrow::Status TimeKernel(KernelMetrics* metrics, const char* event,
+                         const std::string& kernel_name,
+                         const std::function<arrow::Status()>& func) {
+  if (metrics == nullptr) {
+    return func();
+  }
+  TraceSpan span("kernel", event, kernel_name);
+  auto wait_before = extra::KernelWaitNanos();
+  auto start = std::chrono::steady_clock::now();
+  auto status = func();
+  int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  int64_t wait = extra::KernelWaitNanos() - wait_before;
+  metrics->codegen_nanos += wait;
+  metrics->evaluate_nanos += nanos - wait;
+  return status;
+}
+
+int64_t NumRows(const ArrayList& in, const std::shared_ptr<arrow::Array>& selection) {
+  if (selection) {
+    return selection->length();
+  }
+  return in.empty() ? 0 : in[0]->length();
+}
+
+/// Iterator of a kernel counting the time and rows of its calls into the metrics of
+/// the kernel
+class MetricsResultIterator : public ResultIterator<arrow::RecordBatch> {
+ public:
+  MetricsResultIterator(std::shared_ptr<ResultIterator<arrow::RecordBatch>> iter,
+                        std::shared_ptr<KernelMetrics> metrics, std::string kernel_name)
+      : iter_(iter), metrics_(metrics), kernel_name_(std::move(kernel_name)) {}
+
+  bool HasNext() override { return iter_->HasNext(); }
+
+  arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+    RETURN_NOT_OK(Time("Next", [&] { return iter_->Next(out); }));
+    CountOutput(*out);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Process(const ArrayList& in, std::shared_ptr<arrow::RecordBatch>* out,
+                        const std::shared_ptr<arrow::Array>& selection) override {
+    metrics_->num_input_rows += NumRows(in, selection);
+    RETURN_NOT_OK(Time("Process", [&] { return iter_->Process(in, out, selection); }));
+    CountOutput(*out);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status ProcessRemaining(std::shared_ptr<arrow::RecordBatch>* out) override {
+    RETURN_NOT_OK(Time("ProcessRemaining", [&] { return iter_->ProcessRemaining(out); }));
+    CountOutput(*out);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status ProcessAndCacheOne(
+      const ArrayList& in, const std::shared_ptr<arrow::Array>& selection) override {
+    metrics_->num_input_rows += NumRows(in, selection);
+    return Time("ProcessAndCacheOne",
+                [&] { return iter_->ProcessAndCacheOne(in, selection); });
+  }
+
+  arrow::Status GetResult(std::shared_ptr<arrow::RecordBatch>* out) override {
+    RETURN_NOT_OK(Time("GetResult", [&] { return iter_->GetResult(out); }));
+    CountOutput(*out);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status GetRuntimeFilter(std::shared_ptr<RuntimeFilter>* out) override {
+    return iter_->GetRuntimeFilter(out);
+  }
+
+  arrow::Status GetJoinProbe(std::shared_ptr<JoinProbe>* out) override {
+    return iter_->GetJoinProbe(out);
+  }
+
+  void SetLimit(int64_t limit) override { iter_->SetLimit(limit); }
+
+  std::string ToString() override { return iter_->ToString(); }
+
+ private:
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> iter_;
+  std::shared_ptr<KernelMetrics> metrics_;
+  std::string kernel_name_;
+
+  arrow::Status Time(const char* event, const std::function<arrow::Status()>& func) {
+    return TimeKernel(metrics_.get(), event, kernel_name_, func);
+  }
+
+  void CountOutput(const std::shared_ptr<arrow::RecordBatch>& out) {
+    if (out) {
+      metrics_->num_output_rows += out->num_rows();
+    }
+  }
+};
+
+extra::KernalBase* KernelOf(const std::shared_ptr<ExprVisitorImpl>& impl) {
+  return impl ? impl->kernel().get() : nullptr;
+}
+
+}  // namespace
+
 arrow::Status MakeExprVisitor(std::shared_ptr<arrow::Schema> schema_ptr,
                               std::shared_ptr<gandiva::Expression> expr,
                               std::vector<std::shared_ptr<arrow::Field>> ret_fields,
                               ExprVisitorMap* expr_visitor_cache,
-                              std::shared_ptr<ExprVisitor>* out) {
+                              std::shared_ptr<ExprVisitor>* out,
+                              arrow::MemoryPool* pool) {
   auto visitor = std::make_shared<BuilderVisitor>(schema_ptr, expr->root(), ret_fields,
-                                                  expr_visitor_cache);
+                                                  expr_visitor_cache, pool);
   RETURN_NOT_OK(visitor->Eval());
   RETURN_NOT_OK(visitor->GetResult(out));
   return arrow::Status::OK();
@@ -51,9 +164,11 @@ arrow::Status MakeExprVisitor(std::shared_ptr<arrow::Schema> schema_ptr,
                               std::vector<std::shared_ptr<arrow::Field>> ret_fields,
                               std::shared_ptr<gandiva::Expression> finish_expr,
                               ExprVisitorMap* expr_visitor_cache,
-                              std::shared_ptr<ExprVisitor>* out) {
-  auto visitor = std::make_shared<BuilderVisitor>(
-      schema_ptr, expr->root(), ret_fields, finish_expr->root(), expr_visitor_cache);
+                              std::shared_ptr<ExprVisitor>* out,
+                              arrow::MemoryPool* pool) {
+  auto visitor =
+      std::make_shared<BuilderVisitor>(schema_ptr, expr->root(), ret_fields,
+                                       finish_expr->root(), expr_visitor_cache, pool);
   RETURN_NOT_OK(visitor->Eval());
   RETURN_NOT_OK(visitor->GetResult(out));
   return arrow::Status::OK();
@@ -75,11 +190,11 @@ arrow::Status BuilderVisitor::Visit(const gandiva::FunctionNode& node) {
   // if This functionNode is a "codegen",
   // we don't need to create expr_visitor for its children.
   if (func_name.compare(0, 8, "codegen_") == 0) {
-    RETURN_NOT_OK(ExprVisitor::Make(node, ret_fields_, &expr_visitor_));
+    RETURN_NOT_OK(ExprVisitor::Make(node, ret_fields_, &expr_visitor_, pool_));
   } else {
     for (auto child_node : node.children()) {
       auto child_visitor = std::make_shared<BuilderVisitor>(
-          schema_, child_node, ret_fields_, expr_visitor_cache_);
+          schema_, child_node, ret_fields_, expr_visitor_cache_, pool_);
       RETURN_NOT_OK(child_visitor->Eval());
       switch (child_visitor->GetNodeType()) {
         case BuilderVisitorNodeType::FunctionNode: {
@@ -105,7 +220,8 @@ arrow::Status BuilderVisitor::Visit(const gandiva::FunctionNode& node) {
     // instead, it will register itself to its dependency
     if (func_name.compare(0, 7, "action_") == 0) {
       if (dependency) {
-        RETURN_NOT_OK(dependency->AppendAction(func_name, param_names));
+        RETURN_NOT_OK(
+            dependency->AppendAction(func_name, param_names, node.return_type()));
         expr_visitor_ = dependency;
 #ifdef DEBUG
         std::cout << "Build ExprVisitor for " << node_id_ << ", return ExprVisitor is "
@@ -124,10 +240,11 @@ arrow::Status BuilderVisitor::Visit(const gandiva::FunctionNode& node) {
     if (search == expr_visitor_cache_->end()) {
       if (dependency) {
         RETURN_NOT_OK(ExprVisitor::Make(schema_, node.descriptor()->name(), param_names,
-                                        dependency, finish_func_, &expr_visitor_));
+                                        dependency, finish_func_, &expr_visitor_,
+                                        pool_));
       } else {
         RETURN_NOT_OK(ExprVisitor::Make(schema_, node.descriptor()->name(), param_names,
-                                        nullptr, finish_func_, &expr_visitor_));
+                                        nullptr, finish_func_, &expr_visitor_, pool_));
       }
       expr_visitor_cache_->insert(
           std::pair<std::string, std::shared_ptr<ExprVisitor>>(node_id_, expr_visitor_));
@@ -164,9 +281,10 @@ arrow::Status ExprVisitor::Make(std::shared_ptr<arrow::Schema> schema_ptr,
                                 std::vector<std::string> param_field_names,
                                 std::shared_ptr<ExprVisitor> dependency,
                                 std::shared_ptr<gandiva::Node> finish_func,
-                                std::shared_ptr<ExprVisitor>* out) {
+                                std::shared_ptr<ExprVisitor>* out,
+                                arrow::MemoryPool* pool) {
   auto expr = std::make_shared<ExprVisitor>(schema_ptr, func_name, param_field_names,
-                                            dependency, finish_func);
+                                            dependency, finish_func, pool);
   RETURN_NOT_OK(expr->MakeExprVisitorImpl(func_name, expr.get()));
   *out = expr;
   return arrow::Status::OK();
@@ -174,7 +292,8 @@ arrow::Status ExprVisitor::Make(std::shared_ptr<arrow::Schema> schema_ptr,
 
 arrow::Status ExprVisitor::Make(const gandiva::FunctionNode& node,
                                 std::vector<std::shared_ptr<arrow::Field>> ret_fields,
-                                std::shared_ptr<ExprVisitor>* out) {
+                                std::shared_ptr<ExprVisitor>* out,
+                                arrow::MemoryPool* pool) {
   auto func_name = node.descriptor()->name();
   if (func_name.compare("codegen_withOneInput") == 0) {
     auto children = node.children();
@@ -191,7 +310,7 @@ arrow::Status ExprVisitor::Make(const gandiva::FunctionNode& node,
       auto field_node = std::dynamic_pointer_cast<gandiva::FieldNode>(field);
       field_list.push_back(field_node->field());
     }
-    *out = std::make_shared<ExprVisitor>(func_name);
+    *out = std::make_shared<ExprVisitor>(func_name, pool);
     RETURN_NOT_OK((*out)->MakeExprVisitorImpl(codegen_func_node->descriptor()->name(),
                                               codegen_func_node, field_list, ret_fields,
                                               (*out).get()));
@@ -217,7 +336,7 @@ arrow::Status ExprVisitor::Make(const gandiva::FunctionNode& node,
       auto field_node = std::dynamic_pointer_cast<gandiva::FieldNode>(field);
       right_field_list.push_back(field_node->field());
     }
-    *out = std::make_shared<ExprVisitor>(func_name);
+    *out = std::make_shared<ExprVisitor>(func_name, pool);
     RETURN_NOT_OK((*out)->MakeExprVisitorImpl(
         codegen_func_node->descriptor()->name(), codegen_func_node, left_field_list,
         right_field_list, ret_fields, (*out).get()));
@@ -228,8 +347,12 @@ arrow::Status ExprVisitor::Make(const gandiva::FunctionNode& node,
 ExprVisitor::ExprVisitor(std::shared_ptr<arrow::Schema> schema_ptr, std::string func_name,
                          std::vector<std::string> param_field_names,
                          std::shared_ptr<ExprVisitor> dependency,
-                         std::shared_ptr<gandiva::Node> finish_func)
-    : schema_(schema_ptr), func_name_(func_name), param_field_names_(param_field_names) {
+                         std::shared_ptr<gandiva::Node> finish_func,
+                         arrow::MemoryPool* pool)
+    : schema_(schema_ptr),
+      func_name_(func_name),
+      param_field_names_(param_field_names),
+      ctx_(pool) {
   if (dependency) {
     dependency_ = dependency;
   }
@@ -238,7 +361,8 @@ ExprVisitor::ExprVisitor(std::shared_ptr<arrow::Schema> schema_ptr, std::string
   }
 }
 
-ExprVisitor::ExprVisitor(std::string func_name) : func_name_(func_name) {}
+ExprVisitor::ExprVisitor(std::string func_name, arrow::MemoryPool* pool)
+    : func_name_(func_name), ctx_(pool) {}
 
 arrow::Status ExprVisitor::MakeExprVisitorImpl(
     const std::string& func_name, std::shared_ptr<gandiva::FunctionNode> func_node,
@@ -249,6 +373,26 @@ arrow::Status ExprVisitor::MakeExprVisitorImpl(
                                                        ret_fields, p, &impl_));
     goto finish;
   }
+  if (func_name.compare("hashAggregateArraysPartial") == 0) {
+    RETURN_NOT_OK(HashAggregateArraysVisitorImpl::Make(
+        field_list, func_node->children(), ret_fields, p, &impl_, /*partial=*/true));
+    goto finish;
+  }
+  if (func_name.compare("sortedAggregateArrays") == 0) {
+    RETURN_NOT_OK(SortedAggregateArraysVisitorImpl::Make(
+        field_list, func_node->children(), ret_fields, p, &impl_));
+    goto finish;
+  }
+  if (func_name.compare("windowArrays") == 0) {
+    RETURN_NOT_OK(WindowArraysVisitorImpl::Make(field_list, func_node->children(),
+                                                ret_fields, p, &impl_));
+    goto finish;
+  }
+  if (func_name.compare("hashSetDistinct") == 0) {
+    RETURN_NOT_OK(HashSetArraysVisitorImpl::Make(extra::HashSetKernel::kDistinct,
+                                                 field_list, {}, p, &impl_));
+    goto finish;
+  }
 finish:
   return arrow::Status::OK();
 
@@ -261,11 +405,29 @@ arrow::Status ExprVisitor::MakeExprVisitorImpl(
     std::vector<std::shared_ptr<arrow::Field>> left_field_list,
     std::vector<std::shared_ptr<arrow::Field>> right_field_list,
     std::vector<std::shared_ptr<arrow::Field>> ret_fields, ExprVisitor* p) {
-  if (func_name.compare("conditionedProbeArraysInner") == 0 ||
-      func_name.compare("conditionedProbeArraysOuter") == 0 ||
-      func_name.compare("conditionedProbeArraysAnti") == 0 ||
-      func_name.compare("conditionedProbeArraysSemi") == 0 ||
-      func_name.compare("conditionedProbeArraysExistence") == 0) {
+  // the left input is the build side of a set operation, its right input is output
+  if (func_name.compare("hashSetIntersect") == 0 ||
+      func_name.compare("hashSetExcept") == 0) {
+    auto op = func_name.compare("hashSetIntersect") == 0
+                  ? extra::HashSetKernel::kIntersect
+                  : extra::HashSetKernel::kExcept;
+    RETURN_NOT_OK(HashSetArraysVisitorImpl::Make(op, left_field_list, right_field_list,
+                                                 p, &impl_));
+    goto finish;
+  }
+  // the join type follows the kernel prefix, e.g. sortMergeJoinInner
+  std::string join_type_name;
+  bool sort_merge = false;
+  if (func_name.compare(0, 22, "conditionedProbeArrays") == 0) {
+    join_type_name = func_name.substr(22);
+  } else if (func_name.compare(0, 13, "sortMergeJoin") == 0) {
+    join_type_name = func_name.substr(13);
+    sort_merge = true;
+  }
+  if (join_type_name == "Inner" || join_type_name == "Outer" ||
+      join_type_name == "Anti" || join_type_name == "Semi" ||
+      join_type_name == "Existence" ||
+      (join_type_name == "NullAwareAnti" && !sort_merge)) {
     // first child is left_key_schema
     std::vector<std::shared_ptr<arrow::Field>> left_key_list;
     auto left_func_node =
@@ -288,20 +450,22 @@ arrow::Status ExprVisitor::MakeExprVisitorImpl(
       condition_node = func_node->children()[2];
     }
     int join_type = 0;
-    if (func_name.compare("conditionedProbeArraysInner") == 0) {
+    if (join_type_name == "Inner") {
       join_type = 0;
-    } else if (func_name.compare("conditionedProbeArraysOuter") == 0) {
+    } else if (join_type_name == "Outer") {
       join_type = 1;
-    } else if (func_name.compare("conditionedProbeArraysAnti") == 0) {
+    } else if (join_type_name == "Anti") {
       join_type = 2;
-    } else if (func_name.compare("conditionedProbeArraysSemi") == 0) {
+    } else if (join_type_name == "Semi") {
       join_type = 3;
-    } else if (func_name.compare("conditionedProbeArraysExistence") == 0) {
+    } else if (join_type_name == "Existence") {
       join_type = 4;
+    } else if (join_type_name == "NullAwareAnti") {
+      join_type = 5;
     }
     RETURN_NOT_OK(ConditionedProbeArraysVisitorImpl::Make(
         left_key_list, right_key_list, condition_node, join_type, left_field_list,
-        right_field_list, ret_fields, p, &impl_));
+        right_field_list, ret_fields, p, &impl_, sort_merge));
     goto finish;
   }
 finish:
@@ -345,6 +509,24 @@ arrow::Status ExprVisitor::MakeExprVisitorImpl(const std::string& func_name,
     RETURN_NOT_OK(SortArraysToIndicesVisitorImpl::Make(p, &impl_, false, false));
     goto finish;
   }
+  // sortArraysToIndicesTopK<order>_<k>, e.g. sortArraysToIndicesTopKNullsFirstAsc_100
+  {
+    const std::string top_k_prefix = "sortArraysToIndicesTopK";
+    auto pos = func_name.rfind('_');
+    if (func_name.compare(0, top_k_prefix.size(), top_k_prefix) == 0 &&
+        pos != std::string::npos) {
+      auto order = func_name.substr(top_k_prefix.size(), pos - top_k_prefix.size());
+      auto limit = std::atoll(func_name.c_str() + pos + 1);
+      if (limit <= 0) {
+        return arrow::Status::Invalid("Top-k sort ", func_name, " needs a positive k");
+      }
+      bool nulls_first = order.compare(0, 10, "NullsFirst") == 0;
+      bool asc = order.size() >= 3 && order.compare(order.size() - 3, 3, "Asc") == 0;
+      RETURN_NOT_OK(
+          SortArraysToIndicesVisitorImpl::Make(p, &impl_, nulls_first, asc, limit));
+      goto finish;
+    }
+  }
   goto unrecognizedFail;
 finish:
   return arrow::Status::OK();
@@ -355,8 +537,10 @@ unrecognizedFail:
 }
 
 arrow::Status ExprVisitor::AppendAction(const std::string& func_name,
-                                        std::vector<std::string> param_name) {
+                                        std::vector<std::string> param_name,
+                                        std::shared_ptr<arrow::DataType> return_type) {
   action_name_list_.push_back(func_name);
+  action_return_type_list_.push_back(return_type);
   for (auto name : param_name) {
     action_param_list_.push_back(name);
   }
@@ -388,6 +572,7 @@ arrow::Status ExprVisitor::Eval(const std::shared_ptr<arrow::Array>& selection_i
 }
 
 arrow::Status ExprVisitor::Eval(const std::shared_ptr<arrow::RecordBatch>& in) {
+  in_selection_array_ = nullptr;
   in_record_batch_ = in;
   RETURN_NOT_OK(Eval());
   return arrow::Status::OK();
@@ -419,7 +604,14 @@ arrow::Status ExprVisitor::Eval() {
             << ", start to execute" << std::endl;
 #endif
   // now we has dependeny result as this visitor's input.
-  RETURN_NOT_OK(impl_->Eval());
+  auto kernel = KernelOf(impl_);
+  if (kernel && in_record_batch_) {
+    kernel->metrics_->num_input_rows += in_selection_array_
+                                            ? in_selection_array_->length()
+                                            : in_record_batch_->num_rows();
+  }
+  RETURN_NOT_OK(TimeKernel(kernel ? kernel->metrics_.get() : nullptr, "Evaluate",
+                           func_name_, [this] { return impl_->Eval(); }));
   return arrow::Status::OK();
 }
 
@@ -469,6 +661,20 @@ arrow::Status ExprVisitor::ResetDependency() {
   return arrow::Status::OK();
 }
 
+void ExprVisitor::GetMetrics(std::unordered_set<ExprVisitor*>* visited,
+                             std::vector<KernelMetrics>* out) {
+  if (!visited->insert(this).second) {
+    return;
+  }
+  if (dependency_) {
+    dependency_->GetMetrics(visited, out);
+  }
+  auto kernel = impl_ ? impl_->kernel() : nullptr;
+  if (kernel) {
+    out->push_back(kernel->GetMetrics());
+  }
+}
+
 arrow::Status ExprVisitor::Reset() {
   RETURN_NOT_OK(ResetDependency());
   switch (return_type_) {
@@ -511,7 +717,8 @@ arrow::Status ExprVisitor::Init() {
             ->descriptor()
             ->name();
     RETURN_NOT_OK(ExprVisitor::Make(schema_, finish_func_name, param_field_names_,
-                                    shared_from_this(), nullptr, &finish_visitor_));
+                                    shared_from_this(), nullptr, &finish_visitor_,
+                                    ctx_.memory_pool()));
     RETURN_NOT_OK(finish_visitor_->Init());
   }
   return arrow::Status::OK();
@@ -526,7 +733,28 @@ arrow::Status ExprVisitor::Finish(std::shared_ptr<ExprVisitor>* finish_visitor)
     RETURN_NOT_OK(dependency_->Finish(&dummy));
     RETURN_NOT_OK(GetResultFromDependency());
   }
-  RETURN_NOT_OK(impl_->Finish());
+  auto kernel = KernelOf(impl_);
+  auto metrics = kernel ? kernel->metrics_.get() : nullptr;
+  RETURN_NOT_OK(
+      TimeKernel(metrics, "Finish", func_name_, [this] { return impl_->Finish(); }));
+  if (metrics) {
+    switch (return_type_) {
+      case ArrowComputeResultType::Array:
+        metrics->num_output_rows += result_array_ ? result_array_->length() : 0;
+        break;
+      case ArrowComputeResultType::Batch:
+        metrics->num_output_rows +=
+            result_batch_.empty() ? 0 : result_batch_[0]->length();
+        break;
+      case ArrowComputeResultType::BatchList:
+        for (auto size : result_batch_size_list_) {
+          metrics->num_output_rows += size;
+        }
+        break;
+      default:
+        break;
+    }
+  }
   if (finish_visitor_) {
     RETURN_NOT_OK(finish_visitor_->Eval());
     std::shared_ptr<ExprVisitor> dummy;
@@ -545,7 +773,18 @@ arrow::Status ExprVisitor::MakeResultIterator(
     RETURN_NOT_OK(GetResultFromDependency());
   }
   if (!finish_visitor_) {
-    RETURN_NOT_OK(impl_->MakeResultIterator(schema, &result_batch_iterator_));
+    auto kernel = impl_->kernel();
+    if (kernel) {
+      auto make_iterator = [&] {
+        return impl_->MakeResultIterator(schema, &result_batch_iterator_);
+      };
+      RETURN_NOT_OK(TimeKernel(kernel->metrics_.get(), "MakeResultIterator", func_name_,
+                               make_iterator));
+      result_batch_iterator_ = std::make_shared<MetricsResultIterator>(
+          result_batch_iterator_, kernel->metrics_, func_name_);
+    } else {
+      RETURN_NOT_OK(impl_->MakeResultIterator(schema, &result_batch_iterator_));
+    }
     *out = result_batch_iterator_;
   } else {
     return arrow::Status::NotImplemented(
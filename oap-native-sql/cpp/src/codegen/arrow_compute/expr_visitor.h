@@ -18,6 +18,7 @@
 #pragma once
 
 #include <arrow/compute/context.h>
+#include <arrow/memory_pool.h>
 #include <arrow/status.h>
 #include <gandiva/node.h>
 #include <gandiva/node_visitor.h>
@@ -25,7 +26,9 @@
 #include <iostream>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "codegen/common/kernel_metrics.h"
 #include "codegen/common/result_iterator.h"
 #include "codegen/common/visitor_base.h"
 #include "utils/macros.h"
@@ -48,21 +51,25 @@ class BuilderVisitor : public VisitorBase {
   BuilderVisitor(std::shared_ptr<arrow::Schema> schema_ptr,
                  std::shared_ptr<gandiva::Node> func,
                  std::vector<std::shared_ptr<arrow::Field>> ret_fields,
-                 ExprVisitorMap* expr_visitor_cache)
+                 ExprVisitorMap* expr_visitor_cache,
+                 arrow::MemoryPool* pool = arrow::default_memory_pool())
       : schema_(schema_ptr),
         func_(func),
         ret_fields_(ret_fields),
-        expr_visitor_cache_(expr_visitor_cache) {}
+        expr_visitor_cache_(expr_visitor_cache),
+        pool_(pool) {}
   BuilderVisitor(std::shared_ptr<arrow::Schema> schema_ptr,
                  std::shared_ptr<gandiva::Node> func,
                  std::vector<std::shared_ptr<arrow::Field>> ret_fields,
                  std::shared_ptr<gandiva::Node> finish_func,
-                 ExprVisitorMap* expr_visitor_cache)
+                 ExprVisitorMap* expr_visitor_cache,
+                 arrow::MemoryPool* pool = arrow::default_memory_pool())
       : schema_(schema_ptr),
         func_(func),
         ret_fields_(ret_fields),
         finish_func_(finish_func),
-        expr_visitor_cache_(expr_visitor_cache) {}
+        expr_visitor_cache_(expr_visitor_cache),
+        pool_(pool) {}
   ~BuilderVisitor() {}
   arrow::Status Eval() {
     RETURN_NOT_OK(func_->Accept(*this));
@@ -85,6 +92,8 @@ class BuilderVisitor : public VisitorBase {
   BuilderVisitorNodeType node_type_;
   // ExprVisitor Cache, used when multiple node depends on same node.
   ExprVisitorMap* expr_visitor_cache_;
+  // allocates the memory of the kernels of the visitors made
+  arrow::MemoryPool* pool_;
   std::string node_id_;
 };
 
@@ -95,17 +104,21 @@ class ExprVisitor : public std::enable_shared_from_this<ExprVisitor> {
                             std::vector<std::string> param_field_names,
                             std::shared_ptr<ExprVisitor> dependency,
                             std::shared_ptr<gandiva::Node> finish_func,
-                            std::shared_ptr<ExprVisitor>* out);
+                            std::shared_ptr<ExprVisitor>* out,
+                            arrow::MemoryPool* pool = arrow::default_memory_pool());
   static arrow::Status Make(const gandiva::FunctionNode& node,
                             std::vector<std::shared_ptr<arrow::Field>> ret_fields,
-                            std::shared_ptr<ExprVisitor>* out);
+                            std::shared_ptr<ExprVisitor>* out,
+                            arrow::MemoryPool* pool = arrow::default_memory_pool());
 
   ExprVisitor(std::shared_ptr<arrow::Schema> schema_ptr, std::string func_name,
               std::vector<std::string> param_field_names,
               std::shared_ptr<ExprVisitor> dependency,
-              std::shared_ptr<gandiva::Node> finish_func);
+              std::shared_ptr<gandiva::Node> finish_func,
+              arrow::MemoryPool* pool = arrow::default_memory_pool());
 
-  ExprVisitor(std::string func_name);
+  ExprVisitor(std::string func_name,
+              arrow::MemoryPool* pool = arrow::default_memory_pool());
   ~ExprVisitor() {
 #ifdef DEBUG
     std::cout << "Destruct " << func_name_ << " ExprVisitor, ptr is " << this
@@ -124,7 +137,8 @@ class ExprVisitor : public std::enable_shared_from_this<ExprVisitor> {
       std::vector<std::shared_ptr<arrow::Field>> right_field_list,
       std::vector<std::shared_ptr<arrow::Field>> ret_fields, ExprVisitor* p);
   arrow::Status AppendAction(const std::string& func_name,
-                             std::vector<std::string> param_name);
+                             std::vector<std::string> param_name,
+                             std::shared_ptr<arrow::DataType> return_type);
   arrow::Status Init();
   arrow::Status Eval(const std::shared_ptr<arrow::Array>& selection_in,
                      const std::shared_ptr<arrow::RecordBatch>& in);
@@ -151,6 +165,11 @@ class ExprVisitor : public std::enable_shared_from_this<ExprVisitor> {
   arrow::Status GetResult(std::vector<ArrayList>* out, std::vector<int>* out_sizes,
                           std::vector<std::shared_ptr<arrow::Field>>* out_fields);
 
+  /// Append the metrics of the kernels of this visitor and its dependencies to out,
+  /// unless they are in visited already
+  void GetMetrics(std::unordered_set<ExprVisitor*>* visited,
+                  std::vector<KernelMetrics>* out);
+
   void PrintMetrics() {
     if (dependency_) {
       dependency_->PrintMetrics();
@@ -173,6 +192,7 @@ class ExprVisitor : public std::enable_shared_from_this<ExprVisitor> {
   std::shared_ptr<gandiva::Node> finish_func_;
   std::vector<std::string> action_name_list_;
   std::vector<std::string> action_param_list_;
+  std::vector<std::shared_ptr<arrow::DataType>> action_return_type_list_;
 
   // Input data from dependency.
   ArrowComputeResultType dependency_result_type_ = ArrowComputeResultType::None;
@@ -199,7 +219,7 @@ class ExprVisitor : public std::enable_shared_from_this<ExprVisitor> {
   // This is used when we want to output an ResultIterator<RecordBatch>
   std::shared_ptr<ResultIterator<arrow::RecordBatch>> result_batch_iterator_;
 
-  // Long live variables
+  // Long live variables, ctx_ allocates from the memory pool of the task
   arrow::compute::FunctionContext ctx_;
   std::shared_ptr<ExprVisitorImpl> impl_;
   std::shared_ptr<ExprVisitor> finish_visitor_;
@@ -223,14 +243,16 @@ arrow::Status MakeExprVisitor(std::shared_ptr<arrow::Schema> schema_ptr,
                               std::shared_ptr<gandiva::Expression> expr,
                               std::vector<std::shared_ptr<arrow::Field>> ret_fields_,
                               ExprVisitorMap* expr_visitor_cache,
-                              std::shared_ptr<ExprVisitor>* out);
+                              std::shared_ptr<ExprVisitor>* out,
+                              arrow::MemoryPool* pool = arrow::default_memory_pool());
 
 arrow::Status MakeExprVisitor(std::shared_ptr<arrow::Schema> schema_ptr,
                               std::shared_ptr<gandiva::Expression> expr,
                               std::vector<std::shared_ptr<arrow::Field>> ret_fields_,
                               std::shared_ptr<gandiva::Expression> finish_expr,
                               ExprVisitorMap* expr_visitor_cache,
-                              std::shared_ptr<ExprVisitor>* out);
+                              std::shared_ptr<ExprVisitor>* out,
+                              arrow::MemoryPool* pool = arrow::default_memory_pool());
 
 }  // namespace arrowcompute
 }  // namespace codegen
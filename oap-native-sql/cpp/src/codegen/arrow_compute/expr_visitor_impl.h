@@ -71,6 +71,9 @@ class ExprVisitorImpl {
                                          " MakeResultIterator is abstract.");
   }
 
+  /// Kernel of this visitor, null until Init
+  std::shared_ptr<extra::KernalBase> kernel() { return kernel_; }
+
  protected:
   ExprVisitor* p_;
   bool initialized_ = false;
@@ -119,7 +122,8 @@ class SplitArrayListWithActionVisitorImpl : public ExprVisitorImpl {
       type_list.push_back(field->type());
     }
     RETURN_NOT_OK(extra::SplitArrayListWithActionKernel::Make(
-        &p_->ctx_, p_->action_name_list_, type_list, &kernel_));
+        &p_->ctx_, p_->action_name_list_, type_list, p_->action_return_type_list_,
+        &kernel_));
     initialized_ = true;
     return arrow::Status::OK();
   }
@@ -349,11 +353,13 @@ class EncodeVisitorImpl : public ExprVisitorImpl {
 ////////////////////////// SortArraysToIndicesVisitorImpl ///////////////////////
 class SortArraysToIndicesVisitorImpl : public ExprVisitorImpl {
  public:
-  SortArraysToIndicesVisitorImpl(ExprVisitor* p, bool nulls_first, bool asc)
-      : ExprVisitorImpl(p), nulls_first_(nulls_first), asc_(asc) {}
+  SortArraysToIndicesVisitorImpl(ExprVisitor* p, bool nulls_first, bool asc,
+                                 int64_t limit = 0)
+      : ExprVisitorImpl(p), nulls_first_(nulls_first), asc_(asc), limit_(limit) {}
   static arrow::Status Make(ExprVisitor* p, std::shared_ptr<ExprVisitorImpl>* out,
-                            bool nulls_first, bool asc) {
-    auto impl = std::make_shared<SortArraysToIndicesVisitorImpl>(p, nulls_first, asc);
+                            bool nulls_first, bool asc, int64_t limit = 0) {
+    auto impl =
+        std::make_shared<SortArraysToIndicesVisitorImpl>(p, nulls_first, asc, limit);
     *out = impl;
     return arrow::Status::OK();
   }
@@ -370,7 +376,7 @@ class SortArraysToIndicesVisitorImpl : public ExprVisitorImpl {
       field_list.push_back(field);
     }
     RETURN_NOT_OK(extra::SortArraysToIndicesKernel::Make(
-        &p_->ctx_, field_list, p_->schema_, &kernel_, nulls_first_, asc_));
+        &p_->ctx_, field_list, p_->schema_, &kernel_, nulls_first_, asc_, limit_));
     initialized_ = true;
     return arrow::Status::OK();
   }
@@ -411,6 +417,8 @@ class SortArraysToIndicesVisitorImpl : public ExprVisitorImpl {
  private:
   bool nulls_first_;
   bool asc_;
+  // rows of a top-k sort, 0 to sort all
+  int64_t limit_;
 };
 
 ////////////////////////// ConditionedProbeArraysVisitorImpl ///////////////////////
@@ -422,10 +430,12 @@ class ConditionedProbeArraysVisitorImpl : public ExprVisitorImpl {
       std::shared_ptr<gandiva::Node> func_node, int join_type,
       std::vector<std::shared_ptr<arrow::Field>> left_field_list,
       std::vector<std::shared_ptr<arrow::Field>> right_field_list,
-      std::vector<std::shared_ptr<arrow::Field>> ret_fields, ExprVisitor* p)
+      std::vector<std::shared_ptr<arrow::Field>> ret_fields, ExprVisitor* p,
+      bool sort_merge = false)
       : left_key_list_(left_key_list),
         right_key_list_(right_key_list),
         join_type_(join_type),
+        sort_merge_(sort_merge),
         func_node_(func_node),
         left_field_list_(left_field_list),
         right_field_list_(right_field_list),
@@ -437,10 +447,11 @@ class ConditionedProbeArraysVisitorImpl : public ExprVisitorImpl {
                             std::vector<std::shared_ptr<arrow::Field>> left_field_list,
                             std::vector<std::shared_ptr<arrow::Field>> right_field_list,
                             std::vector<std::shared_ptr<arrow::Field>> ret_fields,
-                            ExprVisitor* p, std::shared_ptr<ExprVisitorImpl>* out) {
+                            ExprVisitor* p, std::shared_ptr<ExprVisitorImpl>* out,
+                            bool sort_merge = false) {
     auto impl = std::make_shared<ConditionedProbeArraysVisitorImpl>(
         left_key_list, right_key_list, func_node, join_type, left_field_list,
-        right_field_list, ret_fields, p);
+        right_field_list, ret_fields, p, sort_merge);
     *out = impl;
     return arrow::Status::OK();
   }
@@ -449,9 +460,15 @@ class ConditionedProbeArraysVisitorImpl : public ExprVisitorImpl {
     if (initialized_) {
       return arrow::Status::OK();
     }
-    RETURN_NOT_OK(extra::ConditionedProbeArraysKernel::Make(
-        &p_->ctx_, left_key_list_, right_key_list_, func_node_, join_type_,
-        left_field_list_, right_field_list_, arrow::schema(ret_fields_), &kernel_));
+    if (sort_merge_) {
+      RETURN_NOT_OK(extra::SortMergeJoinKernel::Make(
+          &p_->ctx_, left_key_list_, right_key_list_, func_node_, join_type_,
+          left_field_list_, right_field_list_, arrow::schema(ret_fields_), &kernel_));
+    } else {
+      RETURN_NOT_OK(extra::ConditionedProbeArraysKernel::Make(
+          &p_->ctx_, left_key_list_, right_key_list_, func_node_, join_type_,
+          left_field_list_, right_field_list_, arrow::schema(ret_fields_), &kernel_));
+    }
     initialized_ = true;
     return arrow::Status::OK();
   }
@@ -493,6 +510,8 @@ class ConditionedProbeArraysVisitorImpl : public ExprVisitorImpl {
  private:
   int col_id_;
   int join_type_;
+  // merge sorted inputs with SortMergeJoinKernel rather than probing a hash table
+  bool sort_merge_;
   std::shared_ptr<gandiva::Node> func_node_;
   std::vector<std::shared_ptr<arrow::Field>> left_key_list_;
   std::vector<std::shared_ptr<arrow::Field>> right_key_list_;
@@ -506,17 +525,19 @@ class HashAggregateArraysVisitorImpl : public ExprVisitorImpl {
   HashAggregateArraysVisitorImpl(std::vector<std::shared_ptr<arrow::Field>> field_list,
                                  std::vector<std::shared_ptr<gandiva::Node>> action_list,
                                  std::vector<std::shared_ptr<arrow::Field>> ret_fields,
-                                 ExprVisitor* p)
+                                 ExprVisitor* p, bool partial)
       : action_list_(action_list),
         field_list_(field_list),
         ret_fields_(ret_fields),
+        partial_(partial),
         ExprVisitorImpl(p) {}
   static arrow::Status Make(std::vector<std::shared_ptr<arrow::Field>> field_list,
                             std::vector<std::shared_ptr<gandiva::Node>> action_list,
                             std::vector<std::shared_ptr<arrow::Field>> ret_fields,
-                            ExprVisitor* p, std::shared_ptr<ExprVisitorImpl>* out) {
+                            ExprVisitor* p, std::shared_ptr<ExprVisitorImpl>* out,
+                            bool partial = false) {
     auto impl = std::make_shared<HashAggregateArraysVisitorImpl>(field_list, action_list,
-                                                                 ret_fields, p);
+                                                                 ret_fields, p, partial);
     *out = impl;
     return arrow::Status::OK();
   }
@@ -526,7 +547,8 @@ class HashAggregateArraysVisitorImpl : public ExprVisitorImpl {
       return arrow::Status::OK();
     }
     RETURN_NOT_OK(extra::HashAggregateKernel::Make(&p_->ctx_, field_list_, action_list_,
-                                                   arrow::schema(ret_fields_), &kernel_));
+                                                   arrow::schema(ret_fields_), &kernel_,
+                                                   partial_));
     initialized_ = true;
     return arrow::Status::OK();
   }
@@ -538,7 +560,13 @@ class HashAggregateArraysVisitorImpl : public ExprVisitorImpl {
         for (int i = 0; i < p_->in_record_batch_->num_columns(); i++) {
           in.push_back(p_->in_record_batch_->column(i));
         }
-        TIME_MICRO_OR_RAISE(p_->elapse_time_, kernel_->Evaluate(in));
+        if (p_->in_selection_array_) {
+          const auto& selection = p_->in_selection_array_;
+          TIME_MICRO_OR_RAISE(p_->elapse_time_,
+                              kernel_->EvaluateWithSelection(in, selection));
+        } else {
+          TIME_MICRO_OR_RAISE(p_->elapse_time_, kernel_->Evaluate(in));
+        }
         finish_return_type_ = ArrowComputeResultType::BatchIterator;
       } break;
       default:
@@ -569,6 +597,211 @@ class HashAggregateArraysVisitorImpl : public ExprVisitorImpl {
   std::vector<std::shared_ptr<gandiva::Node>> action_list_;
   std::vector<std::shared_ptr<arrow::Field>> field_list_;
   std::vector<std::shared_ptr<arrow::Field>> ret_fields_;
+  bool partial_;
+};
+////////////////////////// SortedAggregateArraysVisitorImpl ///////////////////////
+class SortedAggregateArraysVisitorImpl : public ExprVisitorImpl {
+ public:
+  SortedAggregateArraysVisitorImpl(
+      std::vector<std::shared_ptr<arrow::Field>> field_list,
+      std::vector<std::shared_ptr<gandiva::Node>> action_list,
+      std::vector<std::shared_ptr<arrow::Field>> ret_fields, ExprVisitor* p)
+      : action_list_(action_list),
+        field_list_(field_list),
+        ret_fields_(ret_fields),
+        ExprVisitorImpl(p) {}
+  static arrow::Status Make(std::vector<std::shared_ptr<arrow::Field>> field_list,
+                            std::vector<std::shared_ptr<gandiva::Node>> action_list,
+                            std::vector<std::shared_ptr<arrow::Field>> ret_fields,
+                            ExprVisitor* p, std::shared_ptr<ExprVisitorImpl>* out) {
+    auto impl = std::make_shared<SortedAggregateArraysVisitorImpl>(
+        field_list, action_list, ret_fields, p);
+    *out = impl;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Init() override {
+    if (initialized_) {
+      return arrow::Status::OK();
+    }
+    RETURN_NOT_OK(extra::SortedAggregateKernel::Make(
+        &p_->ctx_, field_list_, action_list_, arrow::schema(ret_fields_), &kernel_));
+    initialized_ = true;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Eval() override {
+    switch (p_->dependency_result_type_) {
+      case ArrowComputeResultType::None: {
+        ArrayList in;
+        for (int i = 0; i < p_->in_record_batch_->num_columns(); i++) {
+          in.push_back(p_->in_record_batch_->column(i));
+        }
+        if (p_->in_selection_array_) {
+          const auto& selection = p_->in_selection_array_;
+          TIME_MICRO_OR_RAISE(p_->elapse_time_,
+                              kernel_->EvaluateWithSelection(in, selection));
+        } else {
+          TIME_MICRO_OR_RAISE(p_->elapse_time_, kernel_->Evaluate(in));
+        }
+      } break;
+      default:
+        return arrow::Status::NotImplemented(
+            "SortedAggregateArraysVisitorImpl: Does not support this type of "
+            "input.");
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override {
+    // the input may be evaluated before, or streamed through Process of the iterator
+    TIME_MICRO_OR_RAISE(p_->elapse_time_, kernel_->MakeResultIterator(schema, out));
+    p_->return_type_ = ArrowComputeResultType::Batch;
+    return arrow::Status::OK();
+  }
+
+ private:
+  std::vector<std::shared_ptr<gandiva::Node>> action_list_;
+  std::vector<std::shared_ptr<arrow::Field>> field_list_;
+  std::vector<std::shared_ptr<arrow::Field>> ret_fields_;
+};
+////////////////////////// WindowArraysVisitorImpl ///////////////////////
+class WindowArraysVisitorImpl : public ExprVisitorImpl {
+ public:
+  WindowArraysVisitorImpl(
+      std::vector<std::shared_ptr<arrow::Field>> field_list,
+      std::vector<std::shared_ptr<gandiva::Node>> action_list,
+      std::vector<std::shared_ptr<arrow::Field>> ret_fields, ExprVisitor* p)
+      : action_list_(action_list),
+        field_list_(field_list),
+        ret_fields_(ret_fields),
+        ExprVisitorImpl(p) {}
+  static arrow::Status Make(std::vector<std::shared_ptr<arrow::Field>> field_list,
+                            std::vector<std::shared_ptr<gandiva::Node>> action_list,
+                            std::vector<std::shared_ptr<arrow::Field>> ret_fields,
+                            ExprVisitor* p, std::shared_ptr<ExprVisitorImpl>* out) {
+    auto impl = std::make_shared<WindowArraysVisitorImpl>(
+        field_list, action_list, ret_fields, p);
+    *out = impl;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Init() override {
+    if (initialized_) {
+      return arrow::Status::OK();
+    }
+    RETURN_NOT_OK(extra::WindowKernel::Make(
+        &p_->ctx_, field_list_, action_list_, arrow::schema(ret_fields_), &kernel_));
+    initialized_ = true;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Eval() override {
+    switch (p_->dependency_result_type_) {
+      case ArrowComputeResultType::None: {
+        ArrayList in;
+        for (int i = 0; i < p_->in_record_batch_->num_columns(); i++) {
+          in.push_back(p_->in_record_batch_->column(i));
+        }
+        if (p_->in_selection_array_) {
+          const auto& selection = p_->in_selection_array_;
+          TIME_MICRO_OR_RAISE(p_->elapse_time_,
+                              kernel_->EvaluateWithSelection(in, selection));
+        } else {
+          TIME_MICRO_OR_RAISE(p_->elapse_time_, kernel_->Evaluate(in));
+        }
+      } break;
+      default:
+        return arrow::Status::NotImplemented(
+            "WindowArraysVisitorImpl: Does not support this type of "
+            "input.");
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override {
+    // the sorted input may be evaluated before, or streamed through Process of the
+    // iterator
+    TIME_MICRO_OR_RAISE(p_->elapse_time_, kernel_->MakeResultIterator(schema, out));
+    p_->return_type_ = ArrowComputeResultType::Batch;
+    return arrow::Status::OK();
+  }
+
+ private:
+  std::vector<std::shared_ptr<gandiva::Node>> action_list_;
+  std::vector<std::shared_ptr<arrow::Field>> field_list_;
+  std::vector<std::shared_ptr<arrow::Field>> ret_fields_;
+};
+////////////////////////// HashSetArraysVisitorImpl ///////////////////////
+class HashSetArraysVisitorImpl : public ExprVisitorImpl {
+ public:
+  HashSetArraysVisitorImpl(extra::HashSetKernel::SetOp op,
+                           std::vector<std::shared_ptr<arrow::Field>> build_field_list,
+                           std::vector<std::shared_ptr<arrow::Field>> probe_field_list,
+                           ExprVisitor* p)
+      : op_(op),
+        build_field_list_(build_field_list),
+        probe_field_list_(probe_field_list),
+        ExprVisitorImpl(p) {}
+  static arrow::Status Make(extra::HashSetKernel::SetOp op,
+                            std::vector<std::shared_ptr<arrow::Field>> build_field_list,
+                            std::vector<std::shared_ptr<arrow::Field>> probe_field_list,
+                            ExprVisitor* p, std::shared_ptr<ExprVisitorImpl>* out) {
+    auto impl = std::make_shared<HashSetArraysVisitorImpl>(op, build_field_list,
+                                                           probe_field_list, p);
+    *out = impl;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Init() override {
+    if (initialized_) {
+      return arrow::Status::OK();
+    }
+    RETURN_NOT_OK(extra::HashSetKernel::Make(&p_->ctx_, op_, build_field_list_,
+                                             probe_field_list_, &kernel_));
+    initialized_ = true;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Eval() override {
+    switch (p_->dependency_result_type_) {
+      case ArrowComputeResultType::None: {
+        ArrayList in;
+        for (int i = 0; i < p_->in_record_batch_->num_columns(); i++) {
+          in.push_back(p_->in_record_batch_->column(i));
+        }
+        if (p_->in_selection_array_) {
+          const auto& selection = p_->in_selection_array_;
+          TIME_MICRO_OR_RAISE(p_->elapse_time_,
+                              kernel_->EvaluateWithSelection(in, selection));
+        } else {
+          TIME_MICRO_OR_RAISE(p_->elapse_time_, kernel_->Evaluate(in));
+        }
+      } break;
+      default:
+        return arrow::Status::NotImplemented(
+            "HashSetArraysVisitorImpl: Does not support this type of "
+            "input.");
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override {
+    TIME_MICRO_OR_RAISE(p_->elapse_time_, kernel_->MakeResultIterator(schema, out));
+    p_->return_type_ = ArrowComputeResultType::Batch;
+    return arrow::Status::OK();
+  }
+
+ private:
+  extra::HashSetKernel::SetOp op_;
+  std::vector<std::shared_ptr<arrow::Field>> build_field_list_;
+  std::vector<std::shared_ptr<arrow::Field>> probe_field_list_;
 };
 }  // namespace arrowcompute
 }  // namespace codegen
@@ -27,6 +27,7 @@
 #include <sstream>
 
 #include "codegen/arrow_compute/ext/codegen_common.h"
+#include "codegen/arrow_compute/ext/decimal_accumulator.h"
 
 namespace sparkcolumnarplugin {
 namespace codegen {
@@ -61,6 +62,17 @@ class ActionCodeGen {
     }
   }
   std::shared_ptr<gandiva::Expression> GetProjectorExpr() { return projector_expr_; }
+  /// Read the projected input from the member fused_name of the kernel instead of the
+  /// projected batch, see FusedProjectionCodeGen
+  void FuseProjection(const std::string& fused_name) {
+    for (auto& typed_input : typed_input_and_prepare_list_) {
+      if (typed_input.second.find("projected_batch->GetColumnByName") !=
+          std::string::npos) {
+        typed_input.second = "auto " + typed_input.first + " = &" + fused_name + ";";
+      }
+    }
+    projector_expr_ = nullptr;
+  }
   std::vector<std::shared_ptr<arrow::Field>> GetInputFieldList() {
     return input_field_list_;
   }
@@ -270,11 +282,13 @@ class GroupByActionCodeGen : public ActionCodeGen {
 
 class SumActionCodeGen : public ActionCodeGen {
  public:
+  /// A sum of decimals is of the decimal res_type, or of Spark's type of its input
   SumActionCodeGen(std::string name, std::vector<std::string> child_list,
                    std::vector<std::string> input_list,
                    std::vector<std::shared_ptr<arrow::Field>> input_fields_list,
                    std::string prepare_codes_str,
-                   std::shared_ptr<gandiva::Expression> projector) {
+                   std::shared_ptr<gandiva::Expression> projector,
+                   std::shared_ptr<arrow::DataType> res_type = nullptr) {
     is_key_ = false;
     std::string sig_name;
     std::shared_ptr<arrow::DataType> data_type;
@@ -292,6 +306,13 @@ class SumActionCodeGen : public ActionCodeGen {
       GetTypedArrayCastString(data_type, input_list[0]);
     }
     func_sig_list_.push_back(sig_name);
+    if (data_type->id() == arrow::Type::DECIMAL) {
+      if (!res_type || res_type->id() != arrow::Type::DECIMAL) {
+        res_type = DecimalSumType(*data_type);
+      }
+      MakeDecimalSumCodes(sig_name, res_type);
+      return;
+    }
     auto tmp_name = typed_input_and_prepare_list_[0].first + "_tmp";
     std::stringstream prepare_codes_ss;
     prepare_codes_ss << GetCTypeString(data_type) << " " << tmp_name << " = 0;"
@@ -346,6 +367,54 @@ class SumActionCodeGen : public ActionCodeGen {
     finish_var_array_codes_list_.push_back(
         GetTypedResultArrayString(data_type, sig_name));
   }
+
+ private:
+  /// Sum the decimals into DecimalAccumulators, which are null out of res_type
+  void MakeDecimalSumCodes(const std::string& sig_name,
+                           std::shared_ptr<arrow::DataType> res_type) {
+    auto precision =
+        arrow::internal::checked_cast<const arrow::DecimalType&>(*res_type).precision();
+    auto typed_name = typed_input_and_prepare_list_[0].first;
+    auto tmp_name = typed_name + "_tmp";
+    std::stringstream prepare_codes_ss;
+    prepare_codes_ss << "int128_t " << tmp_name << " = 0;" << std::endl;
+    prepare_codes_ss << "if (!" << typed_name << "->IsNull(cur_id_)) {" << std::endl;
+    prepare_codes_ss << tmp_name << " = LoadDecimal(" << typed_name
+                     << "->GetValue(cur_id_));" << std::endl;
+    prepare_codes_ss << "}" << std::endl;
+    std::string vector_define = "std::vector<DecimalAccumulator> ";
+
+    func_sig_define_codes_list_.push_back(vector_define + sig_name + ";\n");
+    on_exists_prepare_codes_list_.push_back(prepare_codes_ss.str() + "\n");
+    on_new_prepare_codes_list_.push_back(prepare_codes_ss.str() + "\n");
+    on_exists_codes_list_.push_back(sig_name + "[i].Add(" + tmp_name + ");");
+    on_new_codes_list_.push_back(sig_name + ".emplace_back();\n" + sig_name +
+                                 ".back().Add(" + tmp_name + ");");
+    on_finish_codes_list_.push_back("");
+
+    auto cache_name = sig_name + "_vector_";
+    auto builder_name = sig_name + "_builder_";
+    std::stringstream to_builder_ss;
+    to_builder_ss << "if (" << cache_name << "[offset_ + count].Fits(" << precision
+                  << ")) {" << std::endl;
+    to_builder_ss << "RETURN_NOT_OK(" << builder_name << "->Append(ToDecimal128("
+                  << cache_name << "[offset_ + count].sum)));" << std::endl;
+    to_builder_ss << "} else {" << std::endl;
+    to_builder_ss << "RETURN_NOT_OK(" << builder_name << "->AppendNull());" << std::endl;
+    to_builder_ss << "}" << std::endl;
+
+    finish_variable_list_.push_back(sig_name);
+    finish_var_parameter_codes_list_.push_back(vector_define + sig_name + "_vector_tmp");
+    finish_var_define_codes_list_.push_back(
+        vector_define + cache_name + ";\nstd::shared_ptr<arrow::Decimal128Builder> " +
+        builder_name + ";\n");
+    finish_var_prepare_codes_list_.push_back(
+        GetTypedVectorAndBuilderPrepareString(res_type, sig_name));
+    finish_var_to_builder_codes_list_.push_back(to_builder_ss.str());
+    finish_var_to_array_codes_list_.push_back(
+        GetTypedResultToArrayString(res_type, sig_name));
+    finish_var_array_codes_list_.push_back(GetTypedResultArrayString(res_type, sig_name));
+  }
 };
 
 class CountActionCodeGen : public ActionCodeGen {
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <arrow/array.h>
 #include <arrow/builder.h>
 #include <arrow/compute/context.h>
 #include <arrow/status.h>
@@ -24,10 +25,18 @@
 #include <arrow/type_fwd.h>
 #include <arrow/type_traits.h>
 #include <arrow/util/checked_cast.h>
+#include <arrow/util/string_view.h>
 
+#include <cmath>
+#include <cstring>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <type_traits>
+
+#include "codegen/arrow_compute/ext/decimal_accumulator.h"
+#include "codegen/arrow_compute/ext/sketches.h"
 
 namespace sparkcolumnarplugin {
 namespace codegen {
@@ -54,10 +63,46 @@ struct FindAccumulatorType<I, arrow::enable_if_floating_point<I>> {
   using Type = arrow::DoubleType;
 };
 
+/// Call update(group_id, row_id) for each row of group_ids whose group isn't null
+template <typename Update>
+void ForEachGroupedRow(const arrow::Int32Array& group_ids, Update&& update) {
+  const int32_t* ids = group_ids.raw_values();
+  if (group_ids.null_count() == 0) {
+    for (int64_t i = 0; i < group_ids.length(); i++) {
+      update(ids[i], i);
+    }
+  } else {
+    for (int64_t i = 0; i < group_ids.length(); i++) {
+      if (group_ids.IsValid(i)) {
+        update(ids[i], i);
+      }
+    }
+  }
+}
+
 class ActionBase {
  public:
   virtual int RequiredColNum() { return 1; }
 
+  /// \brief Aggregate the rows of a batch into the groups of group_ids
+  ///
+  /// Actions override this with a typed loop over the whole batch. By default the
+  /// callbacks of Submit are called row by row.
+  virtual arrow::Status Evaluate(const ArrayList& in, int max_group_id,
+                                 const arrow::Int32Array& group_ids) {
+    std::function<arrow::Status(int)> on_valid;
+    std::function<arrow::Status()> on_null;
+    RETURN_NOT_OK(Submit(in, max_group_id, &on_valid, &on_null));
+    for (int64_t i = 0; i < group_ids.length(); i++) {
+      if (group_ids.IsValid(i)) {
+        RETURN_NOT_OK(on_valid(group_ids.GetView(i)));
+      } else {
+        RETURN_NOT_OK(on_null());
+      }
+    }
+    return arrow::Status::OK();
+  }
+
   virtual arrow::Status Submit(ArrayList in, int max_group_id,
                                std::function<arrow::Status(int)>* on_valid,
                                std::function<arrow::Status()>* on_null) {
@@ -84,6 +129,7 @@ class ActionBase {
   virtual arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) {
     return arrow::Status::NotImplemented("ActionBase Finish is abstract.");
   }
+  /// Output the results of all the groups, which are then dropped for the next ones
   virtual arrow::Status FinishAndReset(ArrayList* out) {
     return arrow::Status::NotImplemented("ActionBase FinishAndReset is abstract.");
   }
@@ -168,6 +214,13 @@ class UniqueAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
   uint64_t GetResultLength() { return cache_.size(); }
 
   arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
@@ -259,6 +312,31 @@ class CountAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_validity_.size() <= max_group_id) {
+      cache_validity_.resize(max_group_id + 1, false);
+      cache_.resize(max_group_id + 1, 0);
+    }
+
+    const auto& in = *in_list[0];
+    if (in.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        cache_validity_[group_id] = true;
+        if (in.IsValid(i)) {
+          cache_[group_id] += 1;
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        cache_validity_[group_id] = true;
+        cache_[group_id] += 1;
+      });
+    }
+    return arrow::Status::OK();
+  }
+
   arrow::Status Finish(ArrayList* out) override {
     std::shared_ptr<arrow::Array> arr_out;
     RETURN_NOT_OK(builder_->AppendValues(cache_, cache_validity_));
@@ -267,6 +345,13 @@ class CountAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
   uint64_t GetResultLength() { return cache_.size(); }
 
   arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
@@ -342,6 +427,21 @@ class CountLiteralAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_validity_.size() <= max_group_id) {
+      cache_validity_.resize(max_group_id + 1, false);
+      cache_.resize(max_group_id + 1, 0);
+    }
+
+    ForEachGroupedRow(group_ids, [this](int32_t group_id, int64_t i) {
+      cache_validity_[group_id] = true;
+      cache_[group_id] += arg_;
+    });
+    return arrow::Status::OK();
+  }
+
   arrow::Status Finish(ArrayList* out) override {
     std::shared_ptr<arrow::Array> arr_out;
     RETURN_NOT_OK(builder_->AppendValues(cache_, cache_validity_));
@@ -351,6 +451,13 @@ class CountLiteralAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
   uint64_t GetResultLength() { return cache_.size(); }
 
   arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
@@ -452,6 +559,40 @@ class MinAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_validity_.size() <= max_group_id) {
+      cache_validity_.resize(max_group_id + 1, false);
+      cache_.resize(max_group_id + 1, 0);
+    }
+
+    const auto& in = *in_list[0];
+    const auto data = in.data()->GetValues<CType>(1);
+    if (in.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (!cache_validity_[group_id]) {
+          cache_[group_id] = data[i];
+          cache_validity_[group_id] = true;
+        }
+        if (in.IsValid(i) && data[i] < cache_[group_id]) {
+          cache_[group_id] = data[i];
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (!cache_validity_[group_id]) {
+          cache_[group_id] = data[i];
+          cache_validity_[group_id] = true;
+        }
+        if (data[i] < cache_[group_id]) {
+          cache_[group_id] = data[i];
+        }
+      });
+    }
+    return arrow::Status::OK();
+  }
+
   arrow::Status Finish(ArrayList* out) override {
     std::shared_ptr<arrow::Array> arr_out;
     RETURN_NOT_OK(builder_->AppendValues(cache_, cache_validity_));
@@ -461,6 +602,13 @@ class MinAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
   uint64_t GetResultLength() { return cache_.size(); }
 
   arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
@@ -566,6 +714,40 @@ class MaxAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_validity_.size() <= max_group_id) {
+      cache_validity_.resize(max_group_id + 1, false);
+      cache_.resize(max_group_id + 1, 0);
+    }
+
+    const auto& in = *in_list[0];
+    const auto data = in.data()->GetValues<CType>(1);
+    if (in.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (!cache_validity_[group_id]) {
+          cache_[group_id] = data[i];
+          cache_validity_[group_id] = true;
+        }
+        if (in.IsValid(i) && data[i] > cache_[group_id]) {
+          cache_[group_id] = data[i];
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (!cache_validity_[group_id]) {
+          cache_[group_id] = data[i];
+          cache_validity_[group_id] = true;
+        }
+        if (data[i] > cache_[group_id]) {
+          cache_[group_id] = data[i];
+        }
+      });
+    }
+    return arrow::Status::OK();
+  }
+
   arrow::Status Finish(ArrayList* out) override {
     std::shared_ptr<arrow::Array> arr_out;
     RETURN_NOT_OK(builder_->AppendValues(cache_, cache_validity_));
@@ -575,6 +757,13 @@ class MaxAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
   uint64_t GetResultLength() { return cache_.size(); }
 
   arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
@@ -670,6 +859,32 @@ class SumAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_validity_.size() <= max_group_id) {
+      cache_validity_.resize(max_group_id + 1, false);
+      cache_.resize(max_group_id + 1, 0);
+    }
+
+    const auto& in = *in_list[0];
+    const auto data = in.data()->GetValues<CType>(1);
+    if (in.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        cache_validity_[group_id] = true;
+        if (in.IsValid(i)) {
+          cache_[group_id] += data[i];
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        cache_validity_[group_id] = true;
+        cache_[group_id] += data[i];
+      });
+    }
+    return arrow::Status::OK();
+  }
+
   arrow::Status Finish(ArrayList* out) override {
     std::shared_ptr<arrow::Array> arr_out;
     RETURN_NOT_OK(builder_->AppendValues(cache_, cache_validity_));
@@ -679,6 +894,13 @@ class SumAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
   uint64_t GetResultLength() { return cache_.size(); }
 
   arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
@@ -772,6 +994,35 @@ class AvgAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_validity_.size() <= max_group_id) {
+      cache_validity_.resize(max_group_id + 1, false);
+      cache_sum_.resize(max_group_id + 1, 0);
+      cache_count_.resize(max_group_id + 1, 0);
+    }
+
+    const auto& in = *in_list[0];
+    const auto data = in.data()->GetValues<CType>(1);
+    if (in.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (in.IsValid(i)) {
+          cache_validity_[group_id] = true;
+          cache_sum_[group_id] += data[i];
+          cache_count_[group_id] += 1;
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        cache_validity_[group_id] = true;
+        cache_sum_[group_id] += data[i];
+        cache_count_[group_id] += 1;
+      });
+    }
+    return arrow::Status::OK();
+  }
+
   arrow::Status Finish(ArrayList* out) override {
     for (int i = 0; i < cache_sum_.size(); i++) {
       cache_sum_[i] /= cache_count_[i];
@@ -785,6 +1036,14 @@ class AvgAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_sum_.clear();
+    cache_count_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
   uint64_t GetResultLength() { return cache_sum_.size(); }
 
   arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
@@ -880,6 +1139,35 @@ class SumCountAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_validity_.size() <= max_group_id) {
+      cache_validity_.resize(max_group_id + 1, false);
+      cache_sum_.resize(max_group_id + 1, 0);
+      cache_count_.resize(max_group_id + 1, 0);
+    }
+
+    const auto& in = *in_list[0];
+    const auto data = in.data()->GetValues<CType>(1);
+    if (in.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (in.IsValid(i)) {
+          cache_validity_[group_id] = true;
+          cache_sum_[group_id] += data[i];
+          cache_count_[group_id] += 1;
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        cache_validity_[group_id] = true;
+        cache_sum_[group_id] += data[i];
+        cache_count_[group_id] += 1;
+      });
+    }
+    return arrow::Status::OK();
+  }
+
   arrow::Status Finish(ArrayList* out) override {
     std::shared_ptr<arrow::Array> sum_array;
     auto sum_builder = new arrow::DoubleBuilder(ctx_->memory_pool());
@@ -897,6 +1185,14 @@ class SumCountAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_sum_.clear();
+    cache_count_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
   uint64_t GetResultLength() { return cache_sum_.size(); }
 
   arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
@@ -997,6 +1293,36 @@ class AvgByCountAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_validity_.size() <= max_group_id) {
+      cache_validity_.resize(max_group_id + 1, false);
+      cache_sum_.resize(max_group_id + 1, 0);
+      cache_count_.resize(max_group_id + 1, 0);
+    }
+
+    const auto& in_sum = *in_list[0];
+    const auto data_sum = in_sum.data()->GetValues<double>(1);
+    const auto data_count = in_list[1]->data()->GetValues<int64_t>(1);
+    if (in_sum.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (in_sum.IsValid(i)) {
+          cache_validity_[group_id] = true;
+          cache_sum_[group_id] += data_sum[i];
+          cache_count_[group_id] += data_count[i];
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        cache_validity_[group_id] = true;
+        cache_sum_[group_id] += data_sum[i];
+        cache_count_[group_id] += data_count[i];
+      });
+    }
+    return arrow::Status::OK();
+  }
+
   arrow::Status Finish(ArrayList* out) override {
     std::shared_ptr<arrow::Array> out_arr;
     for (int i = 0; i < cache_sum_.size(); i++) {
@@ -1010,6 +1336,14 @@ class AvgByCountAction : public ActionBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_sum_.clear();
+    cache_count_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
   uint64_t GetResultLength() { return cache_sum_.size(); }
 
   arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
@@ -1050,6 +1384,497 @@ class AvgByCountAction : public ActionBase {
   std::vector<bool> cache_validity_;
 };
 
+//////////////// DecimalSumAction ///////////////
+/// \brief sum of decimals, and with_count their count as SumCountAction
+///
+/// The sum of a group is null if it isn't a decimal of the precision of res_type, as
+/// Spark's sum when spark.sql.ansi.enabled is off.
+class DecimalSumAction : public ActionBase {
+ public:
+  DecimalSumAction(arrow::compute::FunctionContext* ctx,
+                   std::shared_ptr<arrow::DataType> res_type, bool with_count)
+      : ctx_(ctx),
+        res_type_(res_type),
+        precision_(
+            arrow::internal::checked_cast<const arrow::DecimalType&>(*res_type)
+                .precision()),
+        with_count_(with_count) {
+#ifdef DEBUG
+    std::cout << "Construct DecimalSumAction" << std::endl;
+#endif
+  }
+  ~DecimalSumAction() {
+#ifdef DEBUG
+    std::cout << "Destruct DecimalSumAction" << std::endl;
+#endif
+  }
+
+  int RequiredColNum() { return 1; }
+
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_validity_.size() <= max_group_id) {
+      cache_validity_.resize(max_group_id + 1, false);
+      cache_sum_.resize(max_group_id + 1);
+      cache_count_.resize(max_group_id + 1, 0);
+    }
+
+    const auto& in =
+        arrow::internal::checked_cast<const arrow::Decimal128Array&>(*in_list[0]);
+    const uint8_t* values = in.raw_values();
+    if (in.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (in.IsValid(i)) {
+          cache_validity_[group_id] = true;
+          cache_sum_[group_id].Add(LoadDecimal(values + i * 16));
+          cache_count_[group_id] += 1;
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        cache_validity_[group_id] = true;
+        cache_sum_[group_id].Add(LoadDecimal(values + i * 16));
+        cache_count_[group_id] += 1;
+      });
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Finish(ArrayList* out) override {
+    return Finish(0, GetResultLength(), out);
+  }
+
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_sum_.clear();
+    cache_count_.clear();
+    cache_validity_.clear();
+    return arrow::Status::OK();
+  }
+
+  uint64_t GetResultLength() { return cache_sum_.size(); }
+
+  arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
+    arrow::Decimal128Builder sum_builder(res_type_, ctx_->memory_pool());
+    arrow::Int64Builder count_builder(ctx_->memory_pool());
+    for (uint64_t i = 0; i < length; i++) {
+      const auto& sum = cache_sum_[offset + i];
+      if (cache_validity_[offset + i] && sum.Fits(precision_)) {
+        RETURN_NOT_OK(sum_builder.Append(ToDecimal128(sum.sum)));
+      } else {
+        RETURN_NOT_OK(sum_builder.AppendNull());
+      }
+      if (cache_validity_[offset + i]) {
+        RETURN_NOT_OK(count_builder.Append(cache_count_[offset + i]));
+      } else {
+        RETURN_NOT_OK(count_builder.AppendNull());
+      }
+    }
+
+    std::shared_ptr<arrow::Array> sum_array;
+    RETURN_NOT_OK(sum_builder.Finish(&sum_array));
+    out->push_back(sum_array);
+    if (with_count_) {
+      std::shared_ptr<arrow::Array> count_array;
+      RETURN_NOT_OK(count_builder.Finish(&count_array));
+      out->push_back(count_array);
+    }
+    return arrow::Status::OK();
+  }
+
+ private:
+  arrow::compute::FunctionContext* ctx_;
+  const std::shared_ptr<arrow::DataType> res_type_;
+  const int precision_;
+  const bool with_count_;
+  // result
+  std::vector<DecimalAccumulator> cache_sum_;
+  std::vector<int64_t> cache_count_;
+  std::vector<bool> cache_validity_;
+};
+
+//////////////// DecimalAvgAction ///////////////
+/// \brief avg of decimals, or by_count of the sums and counts of DecimalSumAction
+///
+/// The average is rounded half up to the scale of res_type, and null if it isn't a
+/// decimal of its precision, as Spark's avg.
+class DecimalAvgAction : public ActionBase {
+ public:
+  DecimalAvgAction(arrow::compute::FunctionContext* ctx,
+                   std::shared_ptr<arrow::DataType> in_type,
+                   std::shared_ptr<arrow::DataType> res_type, bool by_count)
+      : ctx_(ctx), res_type_(res_type), by_count_(by_count) {
+#ifdef DEBUG
+    std::cout << "Construct DecimalAvgAction" << std::endl;
+#endif
+    const auto& in_decimal =
+        arrow::internal::checked_cast<const arrow::DecimalType&>(*in_type);
+    const auto& res_decimal =
+        arrow::internal::checked_cast<const arrow::DecimalType&>(*res_type);
+    precision_ = res_decimal.precision();
+    scale_up_ = res_decimal.scale() - in_decimal.scale();
+  }
+  ~DecimalAvgAction() {
+#ifdef DEBUG
+    std::cout << "Destruct DecimalAvgAction" << std::endl;
+#endif
+  }
+
+  int RequiredColNum() { return by_count_ ? 2 : 1; }
+
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (cache_sum_.size() <= max_group_id) {
+      cache_sum_.resize(max_group_id + 1);
+      cache_count_.resize(max_group_id + 1, 0);
+    }
+
+    const auto& in =
+        arrow::internal::checked_cast<const arrow::Decimal128Array&>(*in_list[0]);
+    const uint8_t* values = in.raw_values();
+    if (by_count_) {
+      const auto& in_count =
+          arrow::internal::checked_cast<const arrow::Int64Array&>(*in_list[1]);
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (in_count.IsValid(i)) {
+          // a null sum of counted values overflowed, which the average keeps
+          DecimalAccumulator sum;
+          sum.overflow = in.IsNull(i);
+          if (in.IsValid(i)) sum.sum = LoadDecimal(values + i * 16);
+          cache_sum_[group_id].Merge(sum);
+          cache_count_[group_id] += in_count.GetView(i);
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (in.IsValid(i)) {
+          cache_sum_[group_id].Add(LoadDecimal(values + i * 16));
+          cache_count_[group_id] += 1;
+        }
+      });
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Finish(ArrayList* out) override {
+    return Finish(0, GetResultLength(), out);
+  }
+
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    cache_sum_.clear();
+    cache_count_.clear();
+    return arrow::Status::OK();
+  }
+
+  uint64_t GetResultLength() { return cache_sum_.size(); }
+
+  arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
+    arrow::Decimal128Builder builder(res_type_, ctx_->memory_pool());
+    for (uint64_t i = 0; i < length; i++) {
+      const auto& sum = cache_sum_[offset + i];
+      auto count = cache_count_[offset + i];
+      DecimalAccumulator avg;
+      if (count > 0 && !sum.overflow &&
+          DivideRoundHalfUp(sum.sum, count, scale_up_, &avg.sum) &&
+          avg.Fits(precision_)) {
+        RETURN_NOT_OK(builder.Append(ToDecimal128(avg.sum)));
+      } else {
+        RETURN_NOT_OK(builder.AppendNull());
+      }
+    }
+
+    std::shared_ptr<arrow::Array> arr_out;
+    RETURN_NOT_OK(builder.Finish(&arr_out));
+    out->push_back(arr_out);
+    return arrow::Status::OK();
+  }
+
+ private:
+  arrow::compute::FunctionContext* ctx_;
+  const std::shared_ptr<arrow::DataType> res_type_;
+  const bool by_count_;
+  int precision_;
+  int scale_up_;
+  // result
+  std::vector<DecimalAccumulator> cache_sum_;
+  std::vector<int64_t> cache_count_;
+};
+
+//////////////// Approximate Actions ///////////////
+/// Whether an approximate action aggregates input values or the partial states of
+/// another aggregation, and whether it outputs partial states or the final result
+enum class ApproxMode { kPartial, kPartialMerge, kFinal };
+
+/// Spark's XxHash64Function of a value, with -0.0 and NaN of floats canonicalized
+inline uint64_t SparkXxHash64(int64_t value, uint64_t seed) {
+  return xxh64::HashLong(value, seed);
+}
+inline uint64_t SparkXxHash64(uint64_t value, uint64_t seed) {
+  return xxh64::HashLong(static_cast<int64_t>(value), seed);
+}
+template <typename CType>
+typename std::enable_if<std::is_integral<CType>::value && sizeof(CType) <= 4,
+                        uint64_t>::type
+SparkXxHash64(CType value, uint64_t seed) {
+  return xxh64::HashInt(static_cast<int32_t>(value), seed);
+}
+inline uint64_t SparkXxHash64(float value, uint64_t seed) {
+  int32_t bits = 0x7fc00000;
+  if (value == 0) {
+    bits = 0;
+  } else if (!std::isnan(value)) {
+    std::memcpy(&bits, &value, sizeof(bits));
+  }
+  return xxh64::HashInt(bits, seed);
+}
+inline uint64_t SparkXxHash64(double value, uint64_t seed) {
+  int64_t bits = 0x7ff8000000000000LL;
+  if (value == 0) {
+    bits = 0;
+  } else if (!std::isnan(value)) {
+    std::memcpy(&bits, &value, sizeof(bits));
+  }
+  return xxh64::HashLong(bits, seed);
+}
+inline uint64_t SparkXxHash64(arrow::util::string_view value, uint64_t seed) {
+  return xxh64::HashBytes(reinterpret_cast<const uint8_t*>(value.data()), value.size(),
+                          seed);
+}
+
+/// \brief approx_count_distinct, as Spark's HyperLogLogPlusPlus
+///
+/// The partial state of a group is its num_words() int64 register words, one column
+/// each, in the layout of the aggregation buffer of Spark.
+template <typename DataType>
+class ApproxCountDistinctAction : public ActionBase {
+ public:
+  ApproxCountDistinctAction(arrow::compute::FunctionContext* ctx, int p, ApproxMode mode)
+      : ctx_(ctx), registers_(p), num_words_(registers_.num_words()), mode_(mode) {
+#ifdef DEBUG
+    std::cout << "Construct ApproxCountDistinctAction" << std::endl;
+#endif
+  }
+  ~ApproxCountDistinctAction() {
+#ifdef DEBUG
+    std::cout << "Destruct ApproxCountDistinctAction" << std::endl;
+#endif
+  }
+
+  int RequiredColNum() { return mode_ == ApproxMode::kPartial ? 1 : num_words_; }
+
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (words_.size() <= static_cast<size_t>(max_group_id) * num_words_) {
+      words_.resize(static_cast<size_t>(max_group_id + 1) * num_words_, 0);
+    }
+
+    if (mode_ != ApproxMode::kPartial) {
+      for (int w = 0; w < num_words_; w++) {
+        const auto& in = arrow::internal::checked_cast<const arrow::Int64Array&>(
+            *in_list[w]);
+        ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+          if (in.IsValid(i)) {
+            GroupWords(group_id)[w] =
+                HllRegisters::MergeWord(GroupWords(group_id)[w], in.GetView(i));
+          }
+        });
+      }
+      return arrow::Status::OK();
+    }
+
+    // hash the whole batch first, then scatter the hashes to the registers of groups
+    const auto& in = arrow::internal::checked_cast<const ArrayType&>(*in_list[0]);
+    hashes_.resize(in.length());
+    for (int64_t i = 0; i < in.length(); i++) {
+      hashes_[i] = SparkXxHash64(in.GetView(i), HllRegisters::kSeed);
+    }
+    if (in.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (in.IsValid(i)) {
+          registers_.Update(hashes_[i], GroupWords(group_id));
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        registers_.Update(hashes_[i], GroupWords(group_id));
+      });
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Finish(ArrayList* out) override {
+    return Finish(0, GetResultLength(), out);
+  }
+
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    words_.clear();
+    return arrow::Status::OK();
+  }
+
+  uint64_t GetResultLength() { return words_.size() / num_words_; }
+
+  arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
+    if (mode_ == ApproxMode::kFinal) {
+      arrow::Int64Builder builder(ctx_->memory_pool());
+      RETURN_NOT_OK(builder.Reserve(length));
+      for (uint64_t i = 0; i < length; i++) {
+        builder.UnsafeAppend(registers_.Estimate(&words_[(offset + i) * num_words_]));
+      }
+      std::shared_ptr<arrow::Array> arr_out;
+      RETURN_NOT_OK(builder.Finish(&arr_out));
+      out->push_back(arr_out);
+      return arrow::Status::OK();
+    }
+    for (int w = 0; w < num_words_; w++) {
+      arrow::Int64Builder builder(ctx_->memory_pool());
+      RETURN_NOT_OK(builder.Reserve(length));
+      for (uint64_t i = 0; i < length; i++) {
+        builder.UnsafeAppend(words_[(offset + i) * num_words_ + w]);
+      }
+      std::shared_ptr<arrow::Array> arr_out;
+      RETURN_NOT_OK(builder.Finish(&arr_out));
+      out->push_back(arr_out);
+    }
+    return arrow::Status::OK();
+  }
+
+ private:
+  using ArrayType = typename arrow::TypeTraits<DataType>::ArrayType;
+
+  int64_t* GroupWords(int32_t group_id) {
+    return &words_[static_cast<size_t>(group_id) * num_words_];
+  }
+
+  arrow::compute::FunctionContext* ctx_;
+  const HllRegisters registers_;
+  const int num_words_;
+  const ApproxMode mode_;
+  std::vector<uint64_t> hashes_;
+  // result
+  std::vector<int64_t> words_;
+};
+
+/// \brief percentile_approx of a percentage, by a t-digest per group
+///
+/// The partial state of a group is its serialized t-digest in a binary column, which
+/// only another ApproxPercentileAction can merge. The result is a double.
+template <typename DataType>
+class ApproxPercentileAction : public ActionBase {
+ public:
+  ApproxPercentileAction(arrow::compute::FunctionContext* ctx, double percentage,
+                         double compression, ApproxMode mode)
+      : ctx_(ctx), percentage_(percentage), compression_(compression), mode_(mode) {
+#ifdef DEBUG
+    std::cout << "Construct ApproxPercentileAction" << std::endl;
+#endif
+  }
+  ~ApproxPercentileAction() {
+#ifdef DEBUG
+    std::cout << "Destruct ApproxPercentileAction" << std::endl;
+#endif
+  }
+
+  int RequiredColNum() { return 1; }
+
+  arrow::Status Evaluate(const ArrayList& in_list, int max_group_id,
+                         const arrow::Int32Array& group_ids) override {
+    // resize result data
+    if (digests_.size() <= max_group_id) {
+      digests_.resize(max_group_id + 1, TDigest(compression_));
+    }
+
+    if (mode_ != ApproxMode::kPartial) {
+      const auto& in =
+          arrow::internal::checked_cast<const arrow::BinaryArray&>(*in_list[0]);
+      bool valid_state = true;
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (in.IsValid(i)) {
+          auto state = in.GetView(i);
+          valid_state &= digests_[group_id].MergeSerialized(
+              reinterpret_cast<const uint8_t*>(state.data()), state.size());
+        }
+      });
+      if (!valid_state) {
+        return arrow::Status::Invalid("ApproxPercentileAction got an invalid state.");
+      }
+      return arrow::Status::OK();
+    }
+
+    const auto& in = *in_list[0];
+    const auto data = in.data()->GetValues<CType>(1);
+    if (in.null_count()) {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        if (in.IsValid(i)) {
+          digests_[group_id].Add(static_cast<double>(data[i]));
+        }
+      });
+    } else {
+      ForEachGroupedRow(group_ids, [&](int32_t group_id, int64_t i) {
+        digests_[group_id].Add(static_cast<double>(data[i]));
+      });
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Finish(ArrayList* out) override {
+    return Finish(0, GetResultLength(), out);
+  }
+
+  arrow::Status FinishAndReset(ArrayList* out) override {
+    RETURN_NOT_OK(Finish(out));
+    digests_.clear();
+    return arrow::Status::OK();
+  }
+
+  uint64_t GetResultLength() { return digests_.size(); }
+
+  arrow::Status Finish(uint64_t offset, uint64_t length, ArrayList* out) override {
+    std::shared_ptr<arrow::Array> arr_out;
+    if (mode_ == ApproxMode::kFinal) {
+      arrow::DoubleBuilder builder(ctx_->memory_pool());
+      for (uint64_t i = 0; i < length; i++) {
+        auto& digest = digests_[offset + i];
+        if (digest.empty()) {
+          RETURN_NOT_OK(builder.AppendNull());
+        } else {
+          RETURN_NOT_OK(builder.Append(digest.Quantile(percentage_)));
+        }
+      }
+      RETURN_NOT_OK(builder.Finish(&arr_out));
+    } else {
+      arrow::BinaryBuilder builder(ctx_->memory_pool());
+      std::string state;
+      for (uint64_t i = 0; i < length; i++) {
+        auto& digest = digests_[offset + i];
+        if (digest.empty()) {
+          RETURN_NOT_OK(builder.AppendNull());
+        } else {
+          state.clear();
+          digest.Serialize(&state);
+          RETURN_NOT_OK(builder.Append(state));
+        }
+      }
+      RETURN_NOT_OK(builder.Finish(&arr_out));
+    }
+    out->push_back(arr_out);
+    return arrow::Status::OK();
+  }
+
+ private:
+  using CType = typename arrow::TypeTraits<DataType>::CType;
+  arrow::compute::FunctionContext* ctx_;
+  const double percentage_;
+  const double compression_;
+  const ApproxMode mode_;
+  // result
+  std::vector<TDigest> digests_;
+};
+
 ///////////////////// Public Functions //////////////////
 #define PROCESS_SUPPORTED_TYPES(PROCESS) \
   PROCESS(arrow::UInt8Type)              \
@@ -1210,6 +2035,110 @@ arrow::Status MakeAvgByCountAction(arrow::compute::FunctionContext* ctx,
   return arrow::Status::OK();
 }
 
+arrow::Status MakeApproxCountDistinctAction(arrow::compute::FunctionContext* ctx,
+                                            std::shared_ptr<arrow::DataType> type, int p,
+                                            ApproxMode mode,
+                                            std::shared_ptr<ActionBase>* out) {
+  // linear counting thresholds of Spark are known from p = 4 to 18
+  if (p < 4 || p > 18) {
+    return arrow::Status::Invalid("approxCountDistinct precision ", p,
+                                  " is out of [4, 18].");
+  }
+  if (mode != ApproxMode::kPartial) {
+    // the input is the register words of partial states
+    *out = std::make_shared<ApproxCountDistinctAction<arrow::Int64Type>>(ctx, p, mode);
+    return arrow::Status::OK();
+  }
+  switch (type->id()) {
+#define PROCESS(InType)                                                    \
+  case InType::type_id: {                                                  \
+    auto action_ptr =                                                      \
+        std::make_shared<ApproxCountDistinctAction<InType>>(ctx, p, mode); \
+    *out = std::dynamic_pointer_cast<ActionBase>(action_ptr);              \
+  } break;
+    PROCESS_SUPPORTED_TYPES(PROCESS)
+    PROCESS(arrow::Date32Type)
+    PROCESS(arrow::StringType)
+#undef PROCESS
+    default:
+      return arrow::Status::NotImplemented("approxCountDistinct of ", type->ToString(),
+                                           " is not supported.");
+  }
+  return arrow::Status::OK();
+}
+
+arrow::Status MakeApproxPercentileAction(arrow::compute::FunctionContext* ctx,
+                                         std::shared_ptr<arrow::DataType> type,
+                                         double percentage, double accuracy,
+                                         ApproxMode mode,
+                                         std::shared_ptr<ActionBase>* out) {
+  // a digest of compression c keeps up to 8 * c centroids per group, so the accuracy
+  // of Spark, 10000 by default, is capped to bound the memory of many groups
+  constexpr double kMaxCompression = 200;
+  if (percentage < 0 || percentage > 1 || accuracy <= 0) {
+    return arrow::Status::Invalid("approxPercentile of ", percentage, " with accuracy ",
+                                  accuracy, " is invalid.");
+  }
+  double compression = std::min(accuracy, kMaxCompression);
+  if (mode != ApproxMode::kPartial) {
+    // the input is the serialized digests of partial states
+    *out = std::make_shared<ApproxPercentileAction<arrow::DoubleType>>(
+        ctx, percentage, compression, mode);
+    return arrow::Status::OK();
+  }
+  switch (type->id()) {
+#define PROCESS(InType)                                                 \
+  case InType::type_id: {                                               \
+    auto action_ptr = std::make_shared<ApproxPercentileAction<InType>>( \
+        ctx, percentage, compression, mode);                            \
+    *out = std::dynamic_pointer_cast<ActionBase>(action_ptr);           \
+  } break;
+    PROCESS_SUPPORTED_TYPES(PROCESS)
+#undef PROCESS
+    default:
+      return arrow::Status::NotImplemented("approxPercentile of ", type->ToString(),
+                                           " is not supported.");
+  }
+  return arrow::Status::OK();
+}
+
+/// Whether MakeDecimalAction makes the action of name for decimals
+bool IsDecimalAction(const std::string& name) {
+  return name == "action_sum" || name == "action_sum_count" || name == "action_avg" ||
+         name == "action_avgByCount";
+}
+
+/// \brief Make the action_sum, action_sum_count, action_avg or action_avgByCount of
+/// decimals of in_type
+///
+/// res_type is the decimal type of the sum or the average. If it isn't a decimal, Spark's
+/// type for input values of in_type is taken. As the input of action_avgByCount is sums
+/// of decimal(p + 10, s), the type of their average is then decimal(p + 4, s + 4).
+arrow::Status MakeDecimalAction(arrow::compute::FunctionContext* ctx,
+                                const std::string& name,
+                                std::shared_ptr<arrow::DataType> in_type,
+                                std::shared_ptr<arrow::DataType> res_type,
+                                std::shared_ptr<ActionBase>* out) {
+  bool spark_type = !res_type || res_type->id() != arrow::Type::DECIMAL;
+  if (name == "action_sum" || name == "action_sum_count") {
+    if (spark_type) res_type = DecimalSumType(*in_type);
+    *out = std::make_shared<DecimalSumAction>(ctx, res_type, name == "action_sum_count");
+  } else if (name == "action_avg") {
+    if (spark_type) res_type = DecimalAvgType(*in_type);
+    *out = std::make_shared<DecimalAvgAction>(ctx, in_type, res_type, false);
+  } else if (name == "action_avgByCount") {
+    if (spark_type) {
+      const auto& decimal =
+          arrow::internal::checked_cast<const arrow::DecimalType&>(*in_type);
+      res_type = BoundedDecimalType(decimal.precision() - 6, decimal.scale() + 4);
+    }
+    *out = std::make_shared<DecimalAvgAction>(ctx, in_type, res_type, true);
+  } else {
+    return arrow::Status::NotImplemented(name, " of decimals is not supported.");
+  }
+  return arrow::Status::OK();
+}
+
 #undef PROCESS_SUPPORTED_TYPES
 
 }  // namespace extra
@@ -23,11 +23,26 @@ namespace codegen {
 namespace arrowcompute {
 namespace extra {
 struct ArrayItemIndex {
+  /// Bounds of the number of cached batches and of the rows of a batch
+  static constexpr uint64_t kMaxArrays = UINT16_MAX + 1ULL;
+  static constexpr uint64_t kMaxRows = UINT16_MAX + 1ULL;
+
   uint16_t id = 0;
   uint16_t array_id = 0;
   ArrayItemIndex() : array_id(0), id(0) {}
   ArrayItemIndex(uint16_t array_id, uint16_t id) : array_id(array_id), id(id) {}
 };
+
+/// ArrayItemIndex of twice the size, for inputs of many or large batches
+struct WideArrayItemIndex {
+  static constexpr uint64_t kMaxArrays = UINT32_MAX + 1ULL;
+  static constexpr uint64_t kMaxRows = UINT32_MAX + 1ULL;
+
+  uint32_t id = 0;
+  uint32_t array_id = 0;
+  WideArrayItemIndex() : array_id(0), id(0) {}
+  WideArrayItemIndex(uint32_t array_id, uint32_t id) : array_id(array_id), id(id) {}
+};
 }  // namespace extra
 }  // namespace arrowcompute
 }  // namespace codegen
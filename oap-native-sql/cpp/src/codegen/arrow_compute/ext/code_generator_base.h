@@ -19,9 +19,11 @@
 #include <arrow/array.h>
 #include <arrow/type.h>
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
+#include "codegen/common/kernel_metrics.h"
 #include "codegen/common/result_iterator.h"
 
 namespace sparkcolumnarplugin {
@@ -40,6 +42,13 @@ class CodeGenBase {
     return arrow::Status::NotImplemented(
         "CodeGenBase Evaluate is an abstract interface.");
   }
+  /// Evaluate the rows i of in with selected[i] set, all of them if selected is null
+  virtual arrow::Status Evaluate(
+      const ArrayList& in, const std::shared_ptr<arrow::RecordBatch>& projected_batch,
+      const uint8_t* selected) {
+    return arrow::Status::NotImplemented(
+        "CodeGenBase Evaluate is an abstract interface.");
+  }
   virtual arrow::Status Finish(std::shared_ptr<arrow::Array>* out) {
     return arrow::Status::NotImplemented("CodeGenBase Finish is an abstract interface.");
   }
@@ -49,6 +58,19 @@ class CodeGenBase {
     return arrow::Status::NotImplemented(
         "CodeGenBase MakeResultIterator is an abstract interface.");
   }
+  /// Groups aggregated so far by an aggregation kernel
+  virtual uint64_t NumGroups() { return 0; }
+  /// Set the gauges of metrics, e.g. the size of the hash table of a join
+  virtual void UpdateMetrics(KernelMetrics* metrics) {}
+  /// Bytes of the input batches a kernel keeps, e.g. the cached columns of a sort
+  virtual int64_t CachedBytes() { return 0; }
+  /// Iterator merging runs of batches each sorted by the keys of this kernel
+  virtual arrow::Status MakeMergeResultIterator(
+      std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> runs,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+    return arrow::Status::NotImplemented(
+        "CodeGenBase MakeMergeResultIterator is an abstract interface.");
+  }
 };
 }  // namespace extra
 }  // namespace arrowcompute
@@ -24,9 +24,33 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <arrow/array.h>
+#include <arrow/compute/kernels/take.h>
+#include <arrow/filesystem/filesystem.h>
+#include <arrow/filesystem/path_util.h>
+#include <arrow/io/file.h>
+#include <arrow/util/config.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
+#include <future>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <shared_mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include "codegen/arrow_compute/ext/array_item_index.h"
+#ifdef NATIVESQL_ORC_JIT
+#include "codegen/arrow_compute/ext/orc_jit.h"
+#endif
+#include "utils/trace.h"
 
 namespace sparkcolumnarplugin {
 namespace codegen {
@@ -35,25 +59,7 @@ namespace extra {
 
 std::string BaseCodes() {
   return R"(
-#include <arrow/array.h>
-#include <arrow/array/builder_binary.h>
-#include <arrow/array/builder_primitive.h>
-#include <arrow/buffer.h>
-#include <arrow/builder.h>
-#include <arrow/compute/context.h>
-#include <arrow/record_batch.h>
-#include <arrow/type.h>
-#include <arrow/type_traits.h>
-
-#include <algorithm>
-#include <iostream>
-
-#include "codegen/arrow_compute/ext/array_item_index.h"
-#include "codegen/arrow_compute/ext/code_generator_base.h"
-#include "codegen/arrow_compute/ext/kernels_ext.h"
-#include "codegen/common/result_iterator.h"
-#include "sparsehash/sparse_hash_map.h"
-#include "third_party/arrow/utils/hashing.h"
+#include "codegen/arrow_compute/ext/codegen_includes.h"
 
 using namespace sparkcolumnarplugin::codegen::arrowcompute::extra;
 
@@ -79,15 +85,23 @@ std::string GetArrowTypeDefString(std::shared_ptr<arrow::DataType> type) {
     case arrow::Int64Type::type_id:
       return "int64()";
     case arrow::FloatType::type_id:
-      return "float632()";
+      return "float32()";
     case arrow::DoubleType::type_id:
       return "float64()";
     case arrow::Date32Type::type_id:
       return "date32()";
     case arrow::StringType::type_id:
       return "utf8()";
+    case arrow::BinaryType::type_id:
+      return "binary()";
     case arrow::BooleanType::type_id:
       return "boolean()";  
+    case arrow::Decimal128Type::type_id: {
+      const auto& decimal =
+          arrow::internal::checked_cast<const arrow::DecimalType&>(*type);
+      return "decimal(" + std::to_string(decimal.precision()) + ", " +
+             std::to_string(decimal.scale()) + ")";
+    }
     default:
       std::cout << "GetArrowTypeString can't convert " << type->ToString() << std::endl;
       throw;
@@ -118,9 +132,12 @@ std::string GetCTypeString(std::shared_ptr<arrow::DataType> type) {
     case arrow::Date32Type::type_id:
       return "int32_t";
     case arrow::StringType::type_id:
+    case arrow::BinaryType::type_id:
       return "std::string";
     case arrow::BooleanType::type_id:
       return "bool";    
+    case arrow::Decimal128Type::type_id:
+      return "arrow::Decimal128";
     default:
       std::cout << "GetCTypeString can't convert " << type->ToString() << std::endl;
       throw;
@@ -152,8 +169,12 @@ std::string GetTypeString(std::shared_ptr<arrow::DataType> type, std::string tai
       return "Date32" + tail;
     case arrow::StringType::type_id:
       return "String" + tail;
+    case arrow::BinaryType::type_id:
+      return "Binary" + tail;
     case arrow::BooleanType::type_id:
       return "Boolean" + tail;    
+    case arrow::Decimal128Type::type_id:
+      return "Decimal128" + tail;
     default:
       std::cout << "GetTypeString can't convert " << type->ToString() << std::endl;
       throw;
@@ -166,6 +187,22 @@ std::string GetTypedArrayDefineString(std::shared_ptr<arrow::DataType> type,
          name + ";\n";
 }
 
+std::string GetStringLiteralString(const std::string& value) {
+  // the bytes but letters and digits as octal escapes, which take at most 3 digits
+  std::stringstream ss;
+  ss << "\"";
+  for (auto c : value) {
+    if (isalnum(static_cast<unsigned char>(c))) {
+      ss << c;
+    } else {
+      ss << '\\' << std::oct << std::setw(3) << std::setfill('0')
+         << static_cast<int>(static_cast<unsigned char>(c)) << std::dec;
+    }
+  }
+  ss << "\"";
+  return ss.str();
+}
+
 arrow::Status GetIndexList(const std::vector<std::shared_ptr<arrow::Field>>& target_list,
                            const std::vector<std::shared_ptr<arrow::Field>>& source_list,
                            std::vector<int>* out) {
@@ -224,7 +261,180 @@ int GetBatchSize() {
   return batch_size;
 }
 
+int GetIteratorPrefetch() {
+  const char* env_prefetch = std::getenv("NATIVESQL_ITERATOR_PREFETCH");
+  if (env_prefetch == nullptr) {
+    return 0;
+  }
+  int prefetch = atoi(env_prefetch);
+  return prefetch > 0 ? prefetch : 0;
+}
+
+int64_t GetBatchBytes() {
+  const char* env_bytes = std::getenv("NATIVESQL_BATCH_BYTES");
+  if (env_bytes == nullptr) {
+    return 0;
+  }
+  int64_t bytes = std::atoll(env_bytes);
+  return bytes > 0 ? bytes : 0;
+}
+
+namespace {
+
+int64_t BufferBytes(const arrow::ArrayData& data) {
+  int64_t bytes = 0;
+  for (const auto& buffer : data.buffers) {
+    if (buffer != nullptr) {
+      bytes += buffer->size();
+    }
+  }
+  for (const auto& child : data.child_data) {
+    bytes += BufferBytes(*child);
+  }
+  return bytes;
+}
+
+}  // namespace
+
+BatchSizer::BatchSizer()
+    : budget_bytes_(GetBatchBytes()),
+      min_rows_(std::min<int64_t>(GetBatchSize(), 1024)),
+      max_rows_(std::max<int64_t>(GetBatchSize(), ArrayItemIndex::kMaxRows)),
+      rows_(GetBatchSize()) {}
+
+void BatchSizer::Update(const arrow::RecordBatch& batch) {
+  if (budget_bytes_ == 0 || batch.num_rows() == 0) {
+    return;
+  }
+  total_rows_ += batch.num_rows();
+  for (int i = 0; i < batch.num_columns(); ++i) {
+    total_bytes_ += BufferBytes(*batch.column_data(i));
+  }
+  auto bytes_per_row = std::max<int64_t>(1, total_bytes_ / total_rows_);
+  rows_ = std::min(max_rows_, std::max(min_rows_, budget_bytes_ / bytes_per_row));
+}
+
+int64_t GetJoinMemoryBudget() {
+  const char* env_budget = std::getenv("NATIVESQL_JOIN_MEMORY_BUDGET");
+  if (env_budget == nullptr) {
+    return 0;
+  }
+  int64_t budget = std::atoll(env_budget);
+  return budget > 0 ? budget : 0;
+}
+
+int64_t GetSortMemoryBudget() {
+  const char* env_budget = std::getenv("NATIVESQL_SORT_MEMORY_BUDGET");
+  if (env_budget == nullptr) {
+    return 0;
+  }
+  int64_t budget = std::atoll(env_budget);
+  return budget > 0 ? budget : 0;
+}
+
+int64_t GetAggregateMemoryBudget() {
+  const char* env_budget = std::getenv("NATIVESQL_AGGREGATE_MEMORY_BUDGET");
+  if (env_budget == nullptr) {
+    return 0;
+  }
+  int64_t budget = std::atoll(env_budget);
+  return budget > 0 ? budget : 0;
+}
+
+int64_t ArrayListBytes(const ArrayList& arrays) {
+  int64_t bytes = 0;
+  for (const auto& array : arrays) {
+    for (const auto& buffer : array->data()->buffers) {
+      if (buffer != nullptr) {
+        bytes += buffer->size();
+      }
+    }
+  }
+  return bytes;
+}
+
+arrow::Status DecodeDictionaries(arrow::compute::FunctionContext* ctx,
+                                 const ArrayList& in, ArrayList* out) {
+  out->clear();
+  for (const auto& array : in) {
+    if (array->type_id() != arrow::Type::DICTIONARY) {
+      out->push_back(array);
+      continue;
+    }
+    const auto& dictionary_array = static_cast<const arrow::DictionaryArray&>(*array);
+    std::shared_ptr<arrow::Array> decoded;
+    RETURN_NOT_OK(arrow::compute::Take(ctx, *dictionary_array.dictionary(),
+                                       *dictionary_array.indices(),
+                                       arrow::compute::TakeOptions(), &decoded));
+    out->push_back(decoded);
+  }
+  return arrow::Status::OK();
+}
+
+int GetJoinBuildThreads() {
+  const char* env_threads = std::getenv("NATIVESQL_JOIN_BUILD_THREADS");
+  if (env_threads == nullptr) {
+    return 1;
+  }
+  int threads = atoi(env_threads);
+  return threads > 1 ? threads : 1;
+}
+
+int GetSortThreads() {
+  const char* env_threads = std::getenv("NATIVESQL_SORT_THREADS");
+  if (env_threads == nullptr) {
+    return 1;
+  }
+  int threads = atoi(env_threads);
+  return threads > 1 ? threads : 1;
+}
+
+int GetAggregateThreads() {
+  const char* env_threads = std::getenv("NATIVESQL_AGGREGATE_THREADS");
+  if (env_threads == nullptr) {
+    return 1;
+  }
+  int threads = atoi(env_threads);
+  return threads > 1 ? threads : 1;
+}
+
+std::string GetItemIndexType() {
+  const char* env_item_index = std::getenv("NATIVESQL_ITEM_INDEX");
+  if ((env_item_index != nullptr && std::string(env_item_index) == "wide") ||
+      static_cast<uint64_t>(GetBatchSize()) > ArrayItemIndex::kMaxRows) {
+    return "WideArrayItemIndex";
+  }
+  return "ArrayItemIndex";
+}
+
+bool GetPrecompiledKernels() {
+  const char* env_precompiled = std::getenv("NATIVESQL_PRECOMPILED_KERNELS");
+  return env_precompiled == nullptr || std::string(env_precompiled) != "false";
+}
+
+bool GetCompactCache() {
+  const char* env_format = std::getenv("NATIVESQL_CACHE_FORMAT");
+  return env_format != nullptr && std::string(env_format) == "compact";
+}
+
+bool IsCompactType(const std::shared_ptr<arrow::DataType>& type) {
+  switch (type->id()) {
+    case arrow::Type::INT16:
+    case arrow::Type::INT32:
+    case arrow::Type::INT64:
+    case arrow::Type::UINT16:
+    case arrow::Type::UINT32:
+    case arrow::Type::UINT64:
+    case arrow::Type::DATE32:
+    case arrow::Type::DATE64:
+      return true;
+    default:
+      return false;
+  }
+}
+
 int FileSpinLock() {
+  TRACE_SPAN("codegen", "FileSpinLock");
   std::string lockfile = GetTempPath() + "/nativesql_compile.lock";
 
   auto fd = open(lockfile.c_str(), O_CREAT, S_IRWXU | S_IRWXG);
@@ -233,12 +443,101 @@ int FileSpinLock() {
   return fd;
 }
 
+int FileSpinLock(const std::string& signature) {
+  TRACE_SPAN("codegen", "FileSpinLock");
+  std::string outpath = GetTempPath() + "/tmp/";
+  mkdir(outpath.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+  std::string lockfile = outpath + "/nativesql_compile_" + signature + ".lock";
+
+  auto fd = open(lockfile.c_str(), O_CREAT, S_IRWXU | S_IRWXG);
+  flock(fd, LOCK_EX);
+
+  return fd;
+}
+
 void FileSpinUnLock(int fd) {
   flock(fd, LOCK_UN);
   close(fd);
 }
 
+std::vector<std::string> GetCompileArgs() {
+  std::vector<std::string> args = {"-I" + GetTempPath() + "/nativesql_include/",
+                                   "-I" + GetTempPath() + "/include/"};
+  const char* env_arrow_dir = std::getenv("LIBARROW_DIR");
+  if (env_arrow_dir != nullptr) {
+    args.push_back("-I" + std::string(env_arrow_dir) + "/include");
+  }
+  args.insert(args.end(), {"-O3", "-march=native", "-fPIC"});
+  return args;
+}
+
+bool UseInProcessCompiler() {
+#ifdef NATIVESQL_ORC_JIT
+  const char* env_backend = std::getenv("NATIVESQL_JIT_BACKEND");
+  return env_backend != nullptr && std::string(env_backend) == "orc";
+#else
+  return false;
+#endif
+}
+
+namespace {
+
+constexpr const char* kIncludesHeader = "codegen/arrow_compute/ext/codegen_includes.h";
+
+std::string GetLibraryPath(const std::string& signature) {
+  return GetTempPath() + "/tmp/" + "/spark-columnar-plugin-codegen-" + signature + ".so";
+}
+
+// Build the precompiled header of codegen_includes.h once per node, with the flags of
+// the kernels as gcc ignores it otherwise. Return the directory to search first for it,
+// empty if it can't be built, the kernels then parse the headers themselves.
+std::string GetPrecompiledHeaderDir(const std::string& compiler) {
+  std::string pch_dir = GetTempPath() + "/tmp/pch";
+  std::string pch_file = pch_dir + "/" + kIncludesHeader + ".gch";
+  struct stat tstat;
+  if (stat(pch_file.c_str(), &tstat) == 0) {
+    return pch_dir;
+  }
+
+  // the headers are extracted from the jar or found in the build tree, see GetCompileArgs
+  std::string header;
+  for (auto dir : {"/nativesql_include/", "/include/"}) {
+    auto path = GetTempPath() + dir + kIncludesHeader;
+    if (stat(path.c_str(), &tstat) == 0) {
+      header = path;
+      break;
+    }
+  }
+  if (header.empty()) {
+    return "";
+  }
+
+  auto fd = FileSpinLock();
+  if (stat(pch_file.c_str(), &tstat) != 0) {
+    std::string cmd = "mkdir -p " + pch_file.substr(0, pch_file.rfind('/')) + " && " +
+                      compiler + " -std=c++14 -Wno-deprecated-declarations ";
+    for (const auto& arg : GetCompileArgs()) {
+      cmd += arg + " ";
+    }
+    // built aside then renamed, a task never sees a partial header
+    cmd += "-x c++-header " + header + " -o " + pch_file + ".tmp && mv " + pch_file +
+           ".tmp " + pch_file;
+    std::cout << cmd << std::endl;
+    int ret = system(cmd.c_str());
+    if (WEXITSTATUS(ret) != EXIT_SUCCESS) {
+      std::cout << "precompiling " << header << " failed" << std::endl;
+      FileSpinUnLock(fd);
+      return "";
+    }
+  }
+  FileSpinUnLock(fd);
+  return pch_dir;
+}
+
+}  // namespace
+
 arrow::Status CompileCodes(std::string codes, std::string signature) {
+  TraceSpan span("codegen", "CompileCodes", signature);
   // temporary cpp/library output files
   srand(time(NULL));
   std::string outpath = GetTempPath() + "/tmp/";
@@ -251,8 +550,7 @@ arrow::Status CompileCodes(std::string codes, std::string signature) {
 
   // output code to file
   if (out.bad()) {
-    std::cout << "cannot open " << cppfile << std::endl;
-    exit(EXIT_FAILURE);
+    return arrow::Status::IOError("cannot open ", cppfile);
   }
   out << codes;
 #ifdef DEBUG
@@ -270,23 +568,25 @@ arrow::Status CompileCodes(std::string codes, std::string signature) {
   std::string env_gcc = std::string(env_gcc_);
 
   const char* env_arrow_dir = std::getenv("LIBARROW_DIR");
-  std::string arrow_header;
   std::string arrow_lib, arrow_lib2;
-  std::string nativesql_header = " -I" + GetTempPath() + "/nativesql_include/ ";
-  std::string nativesql_header_2 = " -I" + GetTempPath() + "/include/ ";
   std::string nativesql_lib = " -L" + GetTempPath() + " ";
   if (env_arrow_dir != nullptr) {
-    arrow_header = " -I" + std::string(env_arrow_dir) + "/include ";
     arrow_lib = " -L" + std::string(env_arrow_dir) + "/lib64 ";
     // incase there's a different location for libarrow.so
     arrow_lib2 = " -L" + std::string(env_arrow_dir) + "/lib ";
   }
   // compile the code
-  std::string cmd = env_gcc + " -std=c++14 -Wno-deprecated-declarations " + arrow_header +
-                    arrow_lib + arrow_lib2 + nativesql_header + nativesql_header_2 +
-                    nativesql_lib + cppfile + " -o " + libfile +
-                    " -O3 -march=native -shared -fPIC -larrow -lspark_columnar_jni 2> " +
-                    logfile;
+  std::string cmd = env_gcc + " -std=c++14 -Wno-deprecated-declarations ";
+  // searched before the headers, gcc takes the precompiled one if it matches
+  auto pch_dir = GetPrecompiledHeaderDir(env_gcc);
+  if (!pch_dir.empty()) {
+    cmd += "-I" + pch_dir + " ";
+  }
+  for (const auto& arg : GetCompileArgs()) {
+    cmd += arg + " ";
+  }
+  cmd += arrow_lib + arrow_lib2 + nativesql_lib + cppfile + " -o " + libfile +
+         " -shared -larrow -lspark_columnar_jni 2> " + logfile;
   //#ifdef DEBUG
   std::cout << cmd << std::endl;
   //#endif
@@ -296,21 +596,64 @@ arrow::Status CompileCodes(std::string codes, std::string signature) {
     std::cout << cmd << std::endl;
     cmd = "ls -R -l " + GetTempPath() + "; cat " + logfile;
     system(cmd.c_str());
-    exit(EXIT_FAILURE);
+    return arrow::Status::Invalid("compilation failed, see ", logfile);
   }
 
   struct stat tstat;
   ret = stat(libfile.c_str(), &tstat);
   if (ret == -1) {
-    std::cout << "stat failed: " << strerror(errno) << std::endl;
-    exit(EXIT_FAILURE);
+    return arrow::Status::IOError("stat ", libfile, " failed: ", strerror(errno));
   }
 
   return arrow::Status::OK();
 }
 
-arrow::Status LoadLibrary(std::string signature, arrow::compute::FunctionContext* ctx,
-                          std::shared_ptr<CodeGenBase>* out) {
+namespace {
+
+// MakeCodeGen of the kernels loaded by this process, by signature
+std::shared_timed_mutex kernel_cache_mutex;
+std::unordered_map<std::string, MakeCodeGenFunc> kernel_cache;
+
+// serialize the compilations of each signature within this process
+std::mutex signature_locks_mutex;
+std::unordered_map<std::string, std::shared_ptr<std::mutex>> signature_locks;
+
+// background compilations in flight, by signature
+std::mutex pending_kernels_mutex;
+std::unordered_map<std::string, KernelFuture> pending_kernels;
+
+// kernels made by this process, see GetKernelCacheMetrics
+std::atomic<int64_t> num_compiled{0};
+std::atomic<int64_t> compile_nanos{0};
+std::atomic<int64_t> num_loaded{0};
+std::atomic<int64_t> load_nanos{0};
+
+// time each thread waited in MakeKernel, see KernelWaitNanos
+thread_local int64_t kernel_wait_nanos = 0;
+
+int64_t NanosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+MakeCodeGenFunc LookupKernel(const std::string& signature) {
+  std::shared_lock<std::shared_timed_mutex> lock(kernel_cache_mutex);
+  auto it = kernel_cache.find(signature);
+  return it == kernel_cache.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<std::mutex> GetSignatureLock(const std::string& signature) {
+  std::lock_guard<std::mutex> lock(signature_locks_mutex);
+  auto& signature_lock = signature_locks[signature];
+  if (signature_lock == nullptr) {
+    signature_lock = std::make_shared<std::mutex>();
+  }
+  return signature_lock;
+}
+
+arrow::Status LoadMakeCodeGen(const std::string& signature, MakeCodeGenFunc* out) {
+  TraceSpan span("codegen", "LoadLibrary", signature);
   std::string outpath = GetTempPath() + "/tmp/";
   std::string prefix = "/spark-columnar-plugin-codegen-";
   std::string libfile = outpath + prefix + signature + ".so";
@@ -324,19 +667,319 @@ arrow::Status LoadLibrary(std::string signature, arrow::compute::FunctionContext
   // (to be cast to function pointer later)
 
   std::cout << "LoadLibrary " << libfile << std::endl;
-  void (*MakeCodeGen)(arrow::compute::FunctionContext * ctx,
-                      std::shared_ptr<CodeGenBase> * out);
-  *(void**)(&MakeCodeGen) = dlsym(dynlib, "MakeCodeGen");
+  *(void**)(out) = dlsym(dynlib, "MakeCodeGen");
   const char* dlsym_error = dlerror();
   if (dlsym_error != NULL) {
     std::stringstream ss;
     ss << "error loading symbol:\n" << dlsym_error << std::endl;
     return arrow::Status::Invalid(ss.str());
   }
+  return arrow::Status::OK();
+}
 
+// Compiler, CPU features and arrow version the kernel libraries depend on, since the
+// kernels are built with -march=native against the headers of this arrow
+std::string GetKernelFingerprint() {
+  static const std::string fingerprint = [] {
+    std::stringstream ss;
+    const char* env_gcc = std::getenv("CC");
+    std::string compiler = env_gcc == nullptr ? "gcc" : env_gcc;
+    ss << compiler << "|";
+    auto version = popen((compiler + " -dumpfullversion -dumpversion").c_str(), "r");
+    if (version != nullptr) {
+      char buf[64];
+      while (fgets(buf, sizeof(buf), version) != nullptr) {
+        ss << buf;
+      }
+      pclose(version);
+    }
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+      if (line.compare(0, 5, "flags") == 0) {
+        ss << line;
+        break;
+      }
+    }
+    ss << "|" << ARROW_VERSION_STRING;
+    return GetSignature(ss.str());
+  }();
+  return fingerprint;
+}
+
+// The kernel store and the path of the library of signature in it, null if no store
+// is configured
+arrow::Status GetStoredLibrary(const std::string& signature,
+                               std::shared_ptr<arrow::fs::FileSystem>* fs,
+                               std::string* path) {
+  const char* env_store = std::getenv("NATIVESQL_KERNEL_STORE");
+  if (env_store == nullptr || std::string(env_store).empty()) {
+    *fs = nullptr;
+    return arrow::Status::OK();
+  }
+  std::string root;
+  ARROW_ASSIGN_OR_RAISE(*fs, arrow::fs::FileSystemFromUri(env_store, &root));
+  *path = arrow::fs::internal::ConcatAbstractPath(
+      arrow::fs::internal::ConcatAbstractPath(root, GetKernelFingerprint()),
+      "spark-columnar-plugin-codegen-" + signature + ".so");
+  return arrow::Status::OK();
+}
+
+arrow::Status CopyStream(arrow::io::InputStream* in, arrow::io::OutputStream* out) {
+  constexpr int64_t kChunkSize = 1 << 20;
+  while (true) {
+    ARROW_ASSIGN_OR_RAISE(auto chunk, in->Read(kChunkSize));
+    if (chunk->size() == 0) {
+      break;
+    }
+    RETURN_NOT_OK(out->Write(chunk->data(), chunk->size()));
+  }
+  return out->Close();
+}
+
+// Copy the library of signature from the kernel store, false if it is not there
+arrow::Result<bool> FetchKernel(const std::string& signature) {
+  std::shared_ptr<arrow::fs::FileSystem> fs;
+  std::string path;
+  RETURN_NOT_OK(GetStoredLibrary(signature, &fs, &path));
+  if (fs == nullptr) {
+    return false;
+  }
+  ARROW_ASSIGN_OR_RAISE(auto info, fs->GetFileInfo(path));
+  if (info.type() != arrow::fs::FileType::File) {
+    return false;
+  }
+  std::string libfile = GetLibraryPath(signature);
+  ARROW_ASSIGN_OR_RAISE(auto in, fs->OpenInputStream(path));
+  // written aside then renamed, dlopen never sees a partial library
+  ARROW_ASSIGN_OR_RAISE(auto out, arrow::io::FileOutputStream::Open(libfile + ".tmp"));
+  RETURN_NOT_OK(CopyStream(in.get(), out.get()));
+  if (rename((libfile + ".tmp").c_str(), libfile.c_str()) != 0) {
+    return arrow::Status::IOError("rename to ", libfile, " failed: ", strerror(errno));
+  }
+  std::cout << "Fetched " << path << std::endl;
+  return true;
+}
+
+// Copy the library of signature compiled on this node to the kernel store
+arrow::Status PublishKernel(const std::string& signature) {
+  std::shared_ptr<arrow::fs::FileSystem> fs;
+  std::string path;
+  RETURN_NOT_OK(GetStoredLibrary(signature, &fs, &path));
+  if (fs == nullptr) {
+    return arrow::Status::OK();
+  }
+  RETURN_NOT_OK(fs->CreateDir(arrow::fs::internal::GetAbstractPathParent(path).first));
+  ARROW_ASSIGN_OR_RAISE(auto in,
+                        arrow::io::ReadableFile::Open(GetLibraryPath(signature)));
+  // executors of other nodes may publish the same kernel, the last rename wins
+  auto tmp_path = path + "." + GetSignature(std::to_string(getpid()) + "@" +
+                                            std::to_string(gethostid()));
+  ARROW_ASSIGN_OR_RAISE(auto out, fs->OpenOutputStream(tmp_path));
+  RETURN_NOT_OK(CopyStream(in.get(), out.get()));
+  return fs->Move(tmp_path, path);
+}
+
+// Load the library of signature compiled on this node or else fetched from the kernel
+// store. The caller holds the locks of signature.
+arrow::Status LoadOrFetchMakeCodeGen(const std::string& signature, MakeCodeGenFunc* out) {
+  auto status = LoadMakeCodeGen(signature, out);
+  if (status.ok()) {
+    return status;
+  }
+  auto fetched = FetchKernel(signature);
+  if (!fetched.ok()) {
+    std::cout << "Fetching kernel " << signature
+              << " failed: " << fetched.status().ToString() << std::endl;
+  } else if (*fetched) {
+    status = LoadMakeCodeGen(signature, out);
+  }
+  return status;
+}
+
+}  // namespace
+
+arrow::Status LoadLibrary(std::string signature, arrow::compute::FunctionContext* ctx,
+                          std::shared_ptr<CodeGenBase>* out) {
+  MakeCodeGenFunc MakeCodeGen;
+  RETURN_NOT_OK(LoadMakeCodeGen(signature, &MakeCodeGen));
+  MakeCodeGen(ctx, out);
+  return arrow::Status::OK();
+}
+
+std::string GetSignature(const std::string& func_args) {
+  // 128 bits FNV-1a, std::hash is neither stable across builds nor wide enough to rule
+  // out collisions between the kernels cached on disk
+  const unsigned __int128 prime = (static_cast<unsigned __int128>(1) << 88) + 0x13b;
+  const uint64_t offset_high = 0x6c62272e07bb0142ULL;
+  const uint64_t offset_low = 0x62b821756295c58dULL;
+  auto hash = (static_cast<unsigned __int128>(offset_high) << 64) | offset_low;
+  for (auto c : func_args) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= prime;
+  }
+  std::stringstream signature_ss;
+  signature_ss << std::hex << std::setfill('0') << std::setw(16)
+               << static_cast<uint64_t>(hash >> 64) << std::setw(16)
+               << static_cast<uint64_t>(hash);
+  return signature_ss.str();
+}
+
+// Load the kernel of signature from the cache, the disk or by compiling it
+arrow::Result<MakeCodeGenFunc> LoadOrCompileMakeCodeGen(
+    const std::string& signature, const std::function<std::string()>& produce_codes) {
+  auto MakeCodeGen = LookupKernel(signature);
+  if (MakeCodeGen != nullptr) {
+    return MakeCodeGen;
+  }
+
+  auto signature_lock = GetSignatureLock(signature);
+  std::lock_guard<std::mutex> lock(*signature_lock);
+  // another task of this process may have loaded it while we waited
+  MakeCodeGen = LookupKernel(signature);
+  if (MakeCodeGen != nullptr) {
+    return MakeCodeGen;
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (UseInProcessCompiler()) {
+#ifdef NATIVESQL_ORC_JIT
+    ARROW_ASSIGN_OR_RAISE(
+        auto address, CompileInProcess(produce_codes(), signature, GetCompileArgs()));
+    MakeCodeGen = reinterpret_cast<MakeCodeGenFunc>(address);
+    ++num_compiled;
+    compile_nanos += NanosSince(start);
+#endif
+  } else {
+    auto file_lock = FileSpinLock(signature);
+    auto status = LoadOrFetchMakeCodeGen(signature, &MakeCodeGen);
+    if (status.ok()) {
+      ++num_loaded;
+      load_nanos += NanosSince(start);
+    } else {
+      status = CompileCodes(produce_codes(), signature);
+      if (status.ok()) {
+        status = LoadMakeCodeGen(signature, &MakeCodeGen);
+      }
+      if (status.ok()) {
+        ++num_compiled;
+        compile_nanos += NanosSince(start);
+      }
+      if (status.ok()) {
+        auto published = PublishKernel(signature);
+        if (!published.ok()) {
+          std::cout << "Publishing kernel " << signature
+                    << " failed: " << published.ToString() << std::endl;
+        }
+      }
+    }
+    FileSpinUnLock(file_lock);
+    RETURN_NOT_OK(status);
+  }
+
+  std::unique_lock<std::shared_timed_mutex> cache_lock(kernel_cache_mutex);
+  kernel_cache[signature] = MakeCodeGen;
+  return MakeCodeGen;
+}
+
+arrow::Status LoadOrCompileLibrary(const std::string& signature,
+                                   const std::function<std::string()>& produce_codes,
+                                   arrow::compute::FunctionContext* ctx,
+                                   std::shared_ptr<CodeGenBase>* out) {
+  ARROW_ASSIGN_OR_RAISE(auto MakeCodeGen,
+                        LoadOrCompileMakeCodeGen(signature, produce_codes));
   MakeCodeGen(ctx, out);
   return arrow::Status::OK();
 }
+
+KernelFuture LoadOrCompileLibraryAsync(
+    const std::string& signature, const std::function<std::string()>& produce_codes) {
+  auto MakeCodeGen = LookupKernel(signature);
+  if (MakeCodeGen != nullptr) {
+    std::promise<arrow::Result<MakeCodeGenFunc>> loaded;
+    loaded.set_value(MakeCodeGen);
+    return loaded.get_future().share();
+  }
+
+  std::lock_guard<std::mutex> lock(pending_kernels_mutex);
+  auto it = pending_kernels.find(signature);
+  if (it != pending_kernels.end()) {
+    return it->second;
+  }
+  // the producer refers to the kernel, which may be gone before the compilation ends
+  auto codes = produce_codes();
+  // a packaged task rather than std::async, whose last future would block in its
+  // destructor, here possibly on the compiling thread itself
+  auto task = std::make_shared<std::packaged_task<arrow::Result<MakeCodeGenFunc>()>>(
+      [signature, codes]() {
+        auto result =
+            LoadOrCompileMakeCodeGen(signature, [&codes] { return codes; });
+        std::lock_guard<std::mutex> lock(pending_kernels_mutex);
+        pending_kernels.erase(signature);
+        return result;
+      });
+  KernelFuture kernel = task->get_future().share();
+  std::thread([task]() { (*task)(); }).detach();
+  pending_kernels[signature] = kernel;
+  return kernel;
+}
+
+arrow::Status WarmUpKernels(const std::vector<std::string>& signatures) {
+  if (UseInProcessCompiler()) {
+    return arrow::Status::OK();
+  }
+  int loaded = 0;
+  for (const auto& signature : signatures) {
+    if (LookupKernel(signature) != nullptr) {
+      continue;
+    }
+    auto signature_lock = GetSignatureLock(signature);
+    std::lock_guard<std::mutex> lock(*signature_lock);
+    MakeCodeGenFunc MakeCodeGen;
+    auto start = std::chrono::steady_clock::now();
+    auto file_lock = FileSpinLock(signature);
+    auto status = LoadOrFetchMakeCodeGen(signature, &MakeCodeGen);
+    FileSpinUnLock(file_lock);
+    // not compiled anywhere yet, the first task using it compiles it
+    if (status.ok()) {
+      ++num_loaded;
+      load_nanos += NanosSince(start);
+      std::unique_lock<std::shared_timed_mutex> cache_lock(kernel_cache_mutex);
+      kernel_cache[signature] = MakeCodeGen;
+      ++loaded;
+    }
+  }
+  std::cout << "Warmed up " << loaded << " of " << signatures.size() << " kernels"
+            << std::endl;
+  return arrow::Status::OK();
+}
+
+KernelCacheMetrics GetKernelCacheMetrics() {
+  KernelCacheMetrics metrics;
+  metrics.num_compiled = num_compiled;
+  metrics.compile_nanos = compile_nanos;
+  metrics.num_loaded = num_loaded;
+  metrics.load_nanos = load_nanos;
+  return metrics;
+}
+
+void ClearKernelCache() {
+  std::unique_lock<std::shared_timed_mutex> cache_lock(kernel_cache_mutex);
+  kernel_cache.clear();
+}
+
+int64_t KernelWaitNanos() { return kernel_wait_nanos; }
+
+arrow::Status MakeKernel(const KernelFuture& kernel, arrow::compute::FunctionContext* ctx,
+                         std::shared_ptr<CodeGenBase>* out) {
+  if (*out == nullptr) {
+    TRACE_SPAN("codegen", "WaitKernel");
+    auto start = std::chrono::steady_clock::now();
+    ARROW_ASSIGN_OR_RAISE(auto MakeCodeGen, kernel.get());
+    kernel_wait_nanos += NanosSince(start);
+    MakeCodeGen(ctx, out);
+  }
+  return arrow::Status::OK();
+}
 }  // namespace extra
 }  // namespace arrowcompute
 }  // namespace codegen
@@ -17,10 +17,15 @@
 
 #pragma once
 #include <arrow/compute/context.h>
+#include <arrow/record_batch.h>
+#include <arrow/result.h>
 #include <arrow/type.h>
 
+#include <functional>
+#include <future>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "codegen/arrow_compute/ext/code_generator_base.h"
 
@@ -33,15 +38,110 @@ std::string BaseCodes();
 
 int FileSpinLock();
 
+/// Lock held while compiling the kernel of signature, shared by the executors of a node
+int FileSpinLock(const std::string& signature);
+
 void FileSpinUnLock(int fd);
 
+/// Directory of the headers and libraries the kernels are compiled with, and of the
+/// kernels in its tmp, NATIVESQL_TMP_DIR
+std::string GetTempPath();
+
 int GetBatchSize();
+
+/// Bytes of the output batches of the result iterators, NATIVESQL_BATCH_BYTES. 0, the
+/// default, outputs batches of GetBatchSize() rows whatever their width.
+int64_t GetBatchBytes();
+
+/// \brief Rows of the next output batch of a result iterator
+///
+/// Sized at run time for GetBatchBytes() from the bytes per row of the batches output so
+/// far, so that a narrow schema makes batches of more rows than a wide one, starting
+/// from GetBatchSize() rows. The rows stay below what an ArrayItemIndex holds, unless
+/// GetBatchSize() is above it already.
+class BatchSizer {
+ public:
+  BatchSizer();
+
+  int64_t rows() const { return rows_; }
+
+  /// Size the next batch from batch, just output
+  void Update(const arrow::RecordBatch& batch);
+
+ private:
+  const int64_t budget_bytes_;
+  const int64_t min_rows_;
+  const int64_t max_rows_;
+  int64_t rows_;
+  int64_t total_rows_ = 0;
+  int64_t total_bytes_ = 0;
+};
+
+/// Bytes of build side a hash join keeps in memory before it spills both sides by hash
+/// partition and joins them one partition at a time, NATIVESQL_JOIN_MEMORY_BUDGET. 0,
+/// the default, never spills.
+int64_t GetJoinMemoryBudget();
+
+/// Bytes of input a sort keeps in memory before it spills them as a sorted run, which
+/// are merged once the input is over, NATIVESQL_SORT_MEMORY_BUDGET. 0, the default,
+/// never spills.
+int64_t GetSortMemoryBudget();
+
+/// Bytes of input a hash aggregation keeps in memory before it spills them by hash
+/// partition of the group keys and aggregates them one partition at a time, if its
+/// groups are about as many as its rows, NATIVESQL_AGGREGATE_MEMORY_BUDGET. 0, the
+/// default, never spills.
+int64_t GetAggregateMemoryBudget();
+
+/// Bytes of the buffers of arrays, shared buffers counted once per array
+int64_t ArrayListBytes(const ArrayList& arrays);
+
+/// \brief in with its dictionary arrays replaced by their values, the other arrays kept
+///
+/// For the kernels whose generated codes read their input by the value types of the
+/// dictionaries, e.g. of the string columns of a parquet scan read as dictionaries.
+arrow::Status DecodeDictionaries(arrow::compute::FunctionContext* ctx,
+                                 const ArrayList& in, ArrayList* out);
+
+/// Threads building the hash table of a join, NATIVESQL_JOIN_BUILD_THREADS. 1, the
+/// default, builds it on the task thread as the build batches arrive. With more, the
+/// batches are kept and the table is built from all of them once they are complete.
+int GetJoinBuildThreads();
+
+/// Threads sorting the rows of SortArraysToIndicesKernel once its input is complete,
+/// NATIVESQL_SORT_THREADS, e.g. for tasks that own a whole partition after a range
+/// shuffle. 1, the default, sorts on the task thread only.
+int GetSortThreads();
+
+/// Threads of a hash aggregation, NATIVESQL_AGGREGATE_THREADS. Each aggregates the rows
+/// of one hash partition of the group keys. 1, the default, aggregates on the task
+/// thread only.
+int GetAggregateThreads();
+
+/// ArrayItemIndex, or WideArrayItemIndex if batches of GetBatchSize() rows don't fit
+/// it or NATIVESQL_ITEM_INDEX=wide, e.g. for build sides of more than 65536 batches
+std::string GetItemIndexType();
+
+/// Whether kernels of the common shapes are made from the variants compiled into this
+/// library rather than generated and compiled at run time, see precompiled_kernels.h,
+/// NATIVESQL_PRECOMPILED_KERNELS. On by default.
+bool GetPrecompiledKernels();
+
+/// Whether sorts and join build sides cache their integer and date payload columns as
+/// CompactArray, NATIVESQL_CACHE_FORMAT=compact. Off by default, the cached columns are
+/// the input arrays.
+bool GetCompactCache();
+
+/// Whether a cached column of type can be a CompactArray, see GetCompactCache
+bool IsCompactType(const std::shared_ptr<arrow::DataType>& type);
 std::string GetArrowTypeDefString(std::shared_ptr<arrow::DataType> type);
 std::string GetCTypeString(std::shared_ptr<arrow::DataType> type);
 std::string GetTypeString(std::shared_ptr<arrow::DataType> type,
                           std::string tail = "Type");
 std::string GetTypedArrayDefineString(std::shared_ptr<arrow::DataType> type,
                                       std::string name);
+/// C++ string literal of the bytes of value, whatever they are, a NUL one included
+std::string GetStringLiteralString(const std::string& value);
 template <typename T>
 std::string GetStringFromList(std::vector<T> list) {
   std::stringstream ss;
@@ -58,10 +158,80 @@ arrow::Status GetIndexListFromSchema(
     const std::vector<std::shared_ptr<arrow::Field>>& field_list,
     std::vector<int>* index_list);
 
+/// Include, optimization and code generation flags of the generated codes
+std::vector<std::string> GetCompileArgs();
+
+/// True if kernels are compiled in process with the ORC JIT rather than by the system
+/// compiler into libraries, selected by NATIVESQL_JIT_BACKEND=orc in builds with
+/// ORC_JIT on
+bool UseInProcessCompiler();
+
 arrow::Status CompileCodes(std::string codes, std::string signature);
 
 arrow::Status LoadLibrary(std::string signature, arrow::compute::FunctionContext* ctx,
                           std::shared_ptr<CodeGenBase>* out);
+
+/// Signature of the kernel generated from func_args, stable across builds and
+/// processes. Names the source and library files of the kernel.
+std::string GetSignature(const std::string& func_args);
+
+/// Make the kernel of signature from the kernels already loaded by this process, else
+/// from the library compiled by any task on this node or fetched from the kernel store
+/// at NATIVESQL_KERNEL_STORE, else compile the codes returned by produce_codes and
+/// publish the library to the store. Only compilations of the same signature wait for
+/// each other.
+arrow::Status LoadOrCompileLibrary(const std::string& signature,
+                                   const std::function<std::string()>& produce_codes,
+                                   arrow::compute::FunctionContext* ctx,
+                                   std::shared_ptr<CodeGenBase>* out);
+
+using MakeCodeGenFunc = void (*)(arrow::compute::FunctionContext* ctx,
+                                 std::shared_ptr<CodeGenBase>* out);
+
+/// MakeCodeGen of a kernel being loaded or compiled in background
+using KernelFuture = std::shared_future<arrow::Result<MakeCodeGenFunc>>;
+
+/// Batches an iterator read by the JVM produces ahead of it on a thread of its own,
+/// NATIVESQL_ITERATOR_PREFETCH. 0, the default, produces each batch when it is read.
+int GetIteratorPrefetch();
+
+/// Same as LoadOrCompileLibrary, but compile on a background thread so that the task
+/// goes on, e.g. with the compilation of its other kernels. The codes are produced on
+/// the calling thread if the kernel is not loaded yet. Requests of a signature being
+/// compiled share its future.
+KernelFuture LoadOrCompileLibraryAsync(const std::string& signature,
+                                       const std::function<std::string()>& produce_codes);
+
+/// Load the kernels of signatures into the cache of this process, from this node or
+/// else from the kernel store at NATIVESQL_KERNEL_STORE, e.g. at executor startup.
+/// Kernels not compiled anywhere yet are left to the first task using them.
+arrow::Status WarmUpKernels(const std::vector<std::string>& signatures);
+
+/// Kernels made by this process and the time it took, lookups in its cache excluded
+struct KernelCacheMetrics {
+  /// compiled from their codes
+  int64_t num_compiled = 0;
+  int64_t compile_nanos = 0;
+  /// loaded from the libraries compiled earlier on this node or fetched from the store
+  int64_t num_loaded = 0;
+  int64_t load_nanos = 0;
+};
+
+KernelCacheMetrics GetKernelCacheMetrics();
+
+/// Drop the kernels loaded by this process, which are loaded again from their libraries
+/// by the next requests, e.g. for benchmarks to time the loads. The libraries stay
+/// mapped.
+void ClearKernelCache();
+
+/// Time the calling thread has waited in MakeKernel for kernels to be compiled or
+/// loaded, e.g. for a visitor to tell it apart from the time in its kernel
+int64_t KernelWaitNanos();
+
+/// Wait for kernel, then make it into out unless it is made already. A failed
+/// compilation is returned as error.
+arrow::Status MakeKernel(const KernelFuture& kernel, arrow::compute::FunctionContext* ctx,
+                         std::shared_ptr<CodeGenBase>* out);
 }  // namespace extra
 }  // namespace arrowcompute
 }  // namespace codegen
@@ -0,0 +1,56 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+// The includes of all generated kernels, compiled once per node into a precompiled
+// header, see CompileCodes. Must be the first include of the generated codes.
+
+#include <arrow/array.h>
+#include <arrow/array/builder_binary.h>
+#include <arrow/array/builder_primitive.h>
+#include <arrow/array/concatenate.h>
+#include <arrow/buffer.h>
+#include <arrow/builder.h>
+#include <arrow/compute/context.h>
+#include <arrow/record_batch.h>
+#include <arrow/type.h>
+#include <arrow/type_traits.h>
+#include <arrow/util/bit_util.h>
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+#include "codegen/arrow_compute/ext/array_item_index.h"
+#include "codegen/arrow_compute/ext/code_generator_base.h"
+#include "codegen/arrow_compute/ext/codegen_common.h"
+#include "codegen/arrow_compute/ext/compact_array.h"
+#include "codegen/arrow_compute/ext/decimal_accumulator.h"
+#include "codegen/arrow_compute/ext/gather.h"
+#include "codegen/arrow_compute/ext/join_hash_table.h"
+#include "codegen/arrow_compute/ext/key_prefix.h"
+#include "codegen/arrow_compute/ext/kernels_ext.h"
+#include "codegen/arrow_compute/ext/loser_tree.h"
+#include "codegen/arrow_compute/ext/memo_table_instances.h"
+#include "codegen/arrow_compute/ext/parallel_sort.h"
+#include "codegen/common/join_probe.h"
+#include "codegen/common/result_iterator.h"
+#include "codegen/common/runtime_filter.h"
+#include "codegen/common/string_predicates.h"
+#include "sparsehash/sparse_hash_map.h"
+#include "third_party/arrow/utils/hashing.h"
+#include "third_party/ska_sort.hpp"
@@ -17,31 +17,79 @@
 
 #include "codegen/arrow_compute/ext/codegen_node_visitor.h"
 
+#include <gandiva/literal_holder.h>
 #include <gandiva/node.h>
 
+#include "codegen/arrow_compute/ext/codegen_common.h"
+#include "codegen/common/string_predicates.h"
+
 #include <iostream>
 
 namespace sparkcolumnarplugin {
 namespace codegen {
 namespace arrowcompute {
 namespace extra {
+bool GetStringPredicateCodes(const gandiva::FunctionNode& node, std::string* out) {
+  StringPredicate::Kind kind;
+  const auto& children = node.children();
+  if (!StringPredicate::GetKind(node.descriptor()->name(), &kind) ||
+      children.size() != 2) {
+    return false;
+  }
+  auto type_id = children[0]->return_type()->id();
+  auto literal = std::dynamic_pointer_cast<gandiva::LiteralNode>(children[1]);
+  if ((type_id != arrow::Type::STRING && type_id != arrow::Type::BINARY) || !literal ||
+      literal->is_null() || literal->return_type()->id() != type_id) {
+    return false;
+  }
+  std::string kind_name;
+  switch (kind) {
+    case StringPredicate::Kind::EQUAL:
+      kind_name = "EQUAL";
+      break;
+    case StringPredicate::Kind::STARTS_WITH:
+      kind_name = "STARTS_WITH";
+      break;
+    case StringPredicate::Kind::ENDS_WITH:
+      kind_name = "ENDS_WITH";
+      break;
+    case StringPredicate::Kind::CONTAINS:
+      kind_name = "CONTAINS";
+      break;
+    case StringPredicate::Kind::LIKE:
+      kind_name = "LIKE";
+      break;
+  }
+  const auto& pattern = arrow::util::get<std::string>(literal->holder());
+  *out = "sparkcolumnarplugin::codegen::StringPredicate(sparkcolumnarplugin::codegen::"
+         "StringPredicate::Kind::" +
+         kind_name + ", std::string(" + GetStringLiteralString(pattern) + ", " +
+         std::to_string(pattern.size()) + "))";
+  return true;
+}
+
 std::string CodeGenNodeVisitor::GetInput() { return input_codes_str_; }
 std::string CodeGenNodeVisitor::GetResult() { return codes_str_; }
 std::string CodeGenNodeVisitor::GetPreCheck() { return check_str_; }
+arrow::Status CodeGenNodeVisitor::MakeChildVisitor(
+    std::shared_ptr<gandiva::Node> child, std::shared_ptr<CodeGenNodeVisitor>* out) {
+  if (action_impl_) {
+    RETURN_NOT_OK(MakeCodeGenNodeVisitor(child, field_list_v_[0], action_impl_, out));
+  } else {
+    RETURN_NOT_OK(MakeCodeGenNodeVisitor(child, field_list_v_, func_count_, codes_ss_,
+                                         left_indices_, right_indices_, out,
+                                         vectorized_));
+  }
+  vectorizable_ = vectorizable_ && (*out)->IsVectorizable();
+  return arrow::Status::OK();
+}
 arrow::Status CodeGenNodeVisitor::Visit(const gandiva::FunctionNode& node) {
   std::vector<std::shared_ptr<CodeGenNodeVisitor>> child_visitor_list;
   auto cur_func_id = *func_count_;
   for (auto child : node.children()) {
     std::shared_ptr<CodeGenNodeVisitor> child_visitor;
     *func_count_ = *func_count_ + 1;
-    if (action_impl_) {
-      RETURN_NOT_OK(
-          MakeCodeGenNodeVisitor(child, field_list_v_[0], action_impl_, &child_visitor));
-    } else {
-      RETURN_NOT_OK(MakeCodeGenNodeVisitor(child, field_list_v_, func_count_, codes_ss_,
-                                           left_indices_, right_indices_,
-                                           &child_visitor));
-    }
+    RETURN_NOT_OK(MakeChildVisitor(child, &child_visitor));
     child_visitor_list.push_back(child_visitor);
   }
 
@@ -50,6 +98,7 @@ arrow::Status CodeGenNodeVisitor::Visit(const gandiva::FunctionNode& node) {
   if (action_impl_) {
     if (func_name.compare(0, 7, "action_") == 0) {
       action_impl_->SetActionName(func_name);
+      action_impl_->SetResultType(node.return_type());
       std::vector<std::string> child_res;
       for (auto child : child_visitor_list) {
         child_res.push_back(child->GetResult());
@@ -65,7 +114,14 @@ arrow::Status CodeGenNodeVisitor::Visit(const gandiva::FunctionNode& node) {
       RETURN_NOT_OK(action_impl_->MakeGandivaProjection(func_, field_list_v_[0]));
     }
   } else {
-    if (func_name.compare("less_than") == 0) {
+    std::string predicate_codes;
+    if (GetStringPredicateCodes(node, &predicate_codes)) {
+      // the pattern is parsed once, the first time the codes run
+      auto predicate = "string_predicate_" + std::to_string(cur_func_id);
+      *codes_ss_ << "static const auto " << predicate << " = " << predicate_codes << ";"
+                 << std::endl;
+      ss << predicate << ".Match(" << child_visitor_list[0]->GetResult() << ")";
+    } else if (func_name.compare("less_than") == 0) {
       ss << "(" << child_visitor_list[0]->GetResult() << " < "
          << child_visitor_list[1]->GetResult() << ")";
     } else if (func_name.compare("greater_than") == 0) {
@@ -125,6 +181,8 @@ arrow::Status CodeGenNodeVisitor::Visit(const gandiva::FieldNode& node) {
       *codes_ss_ << "auto " << codes_str_ << " = " << typed_input_codes_str
                  << "->GetString(cur_id_);" << std::endl;
     }
+  } else if (vectorized_) {
+    VisitVectorizedField(index, arg_id, field_list_v_[index][arg_id]);
   } else {
     if (index == 0) {
       codes_str_ = "input_field_" + std::to_string(cur_func_id);
@@ -148,18 +206,73 @@ arrow::Status CodeGenNodeVisitor::Visit(const gandiva::FieldNode& node) {
   return arrow::Status::OK();
 }
 
+void CodeGenNodeVisitor::VisitVectorizedField(int index, int arg_id,
+                                              std::shared_ptr<arrow::Field> field) {
+  auto cur_func_id = *func_count_;
+  switch (field->type()->id()) {
+    case arrow::Type::UINT8:
+    case arrow::Type::INT8:
+    case arrow::Type::UINT16:
+    case arrow::Type::INT16:
+    case arrow::Type::UINT32:
+    case arrow::Type::INT32:
+    case arrow::Type::UINT64:
+    case arrow::Type::INT64:
+    case arrow::Type::FLOAT:
+    case arrow::Type::DOUBLE:
+    case arrow::Type::DATE32:
+      break;
+    default:
+      vectorizable_ = false;
+      return;
+  }
+  auto values = "input_field_" + std::to_string(cur_func_id);
+  codes_str_ = values + "[k]";
+  *codes_ss_ << "std::vector<" << GetCTypeString(field->type()) << "> " << values
+             << "(cond_length);" << std::endl;
+  if (index == 0) {
+    // the build rows are spread over the cached arrays
+    input_codes_str_ = "cached_0_" + std::to_string(arg_id) + "_";
+    *codes_ss_ << "for (int k = 0; k < cond_length; k++) {" << std::endl
+               << "  auto x = build_ids_[k];" << std::endl
+               << "  cond_valid[k] &= !" << input_codes_str_
+               << "[x.array_id]->IsNull(x.id);" << std::endl
+               << "  " << codes_str_ << " = " << input_codes_str_
+               << "[x.array_id]->GetView(x.id);" << std::endl
+               << "}" << std::endl;
+  } else {
+    input_codes_str_ = "cached_1_" + std::to_string(arg_id) + "_";
+    *codes_ss_ << "if (" << input_codes_str_ << "->null_count() > 0) {" << std::endl
+               << "  for (int k = 0; k < cond_length; k++) {" << std::endl
+               << "    cond_valid[k] &= !" << input_codes_str_
+               << "->IsNull(probe_ids_[k]);" << std::endl
+               << "  }" << std::endl
+               << "}" << std::endl
+               << "auto raw_" << values << " = " << input_codes_str_ << "->raw_values();"
+               << std::endl
+               << "for (int k = 0; k < cond_length; k++) {" << std::endl
+               << "  " << codes_str_ << " = raw_" << values << "[probe_ids_[k]];"
+               << std::endl
+               << "}" << std::endl;
+  }
+}
+
 arrow::Status CodeGenNodeVisitor::Visit(const gandiva::IfNode& node) {
   if (action_impl_) {
     RETURN_NOT_OK(action_impl_->MakeGandivaProjection(func_, field_list_v_[0]));
   }
+  vectorizable_ = false;
   return arrow::Status::OK();
 }
 
 arrow::Status CodeGenNodeVisitor::Visit(const gandiva::LiteralNode& node) {
   auto cur_func_id = *func_count_;
   if (node.return_type()->id() == arrow::Type::STRING) {
-    *codes_ss_ << "auto input_field_" << cur_func_id << R"( = ")"
-               << gandiva::ToString(node.holder()) << R"(";)" << std::endl;
+    vectorizable_ = false;
+    auto value =
+        node.is_null() ? std::string() : arrow::util::get<std::string>(node.holder());
+    *codes_ss_ << "auto input_field_" << cur_func_id << " = "
+               << GetStringLiteralString(value) << ";" << std::endl;
 
   } else {
     *codes_ss_ << "auto input_field_" << cur_func_id << " = "
@@ -178,24 +291,20 @@ arrow::Status CodeGenNodeVisitor::Visit(const gandiva::BooleanNode& node) {
   for (auto child : node.children()) {
     std::shared_ptr<CodeGenNodeVisitor> child_visitor;
     *func_count_ = *func_count_ + 1;
-    if (action_impl_) {
-      RETURN_NOT_OK(
-          MakeCodeGenNodeVisitor(child, field_list_v_[0], action_impl_, &child_visitor));
-    } else {
-      RETURN_NOT_OK(MakeCodeGenNodeVisitor(child, field_list_v_, func_count_, codes_ss_,
-                                           left_indices_, right_indices_,
-                                           &child_visitor));
-    }
+    RETURN_NOT_OK(MakeChildVisitor(child, &child_visitor));
     child_visitor_list.push_back(child_visitor);
   }
 
+  // without branches when vectorized, all the operands are evaluated anyway
+  std::string and_str = vectorized_ ? " & " : " && ";
+  std::string or_str = vectorized_ ? " | " : " || ";
   std::stringstream ss;
   if (node.expr_type() == gandiva::BooleanNode::AND) {
-    ss << "(" << child_visitor_list[0]->GetResult() << ") && ("
+    ss << "(" << child_visitor_list[0]->GetResult() << ")" << and_str << "("
        << child_visitor_list[1]->GetResult() << ")";
   }
   if (node.expr_type() == gandiva::BooleanNode::OR) {
-    ss << "(" << child_visitor_list[0]->GetResult() << ") || ("
+    ss << "(" << child_visitor_list[0]->GetResult() << ")" << or_str << "("
        << child_visitor_list[1]->GetResult() << ")";
   }
   codes_str_ = ss.str();
@@ -206,14 +315,9 @@ arrow::Status CodeGenNodeVisitor::Visit(const gandiva::InExpressionNode<int>& no
   auto cur_func_id = *func_count_;
   std::shared_ptr<CodeGenNodeVisitor> child_visitor;
   *func_count_ = *func_count_ + 1;
-  if (action_impl_) {
-    RETURN_NOT_OK(MakeCodeGenNodeVisitor(node.eval_expr(), field_list_v_[0], action_impl_,
-                                         &child_visitor));
-  } else {
-    RETURN_NOT_OK(MakeCodeGenNodeVisitor(node.eval_expr(), field_list_v_, func_count_,
-                                         codes_ss_, left_indices_, right_indices_,
-                                         &child_visitor));
-  }
+  RETURN_NOT_OK(MakeChildVisitor(node.eval_expr(), &child_visitor));
+  // the lookup in a std::vector doesn't vectorize
+  vectorizable_ = false;
   *codes_ss_ << "std::vector<int> input_field_" << cur_func_id << " = {";
   bool add_comma = false;
   for (auto& value : node.values()) {
@@ -239,14 +343,9 @@ arrow::Status CodeGenNodeVisitor::Visit(const gandiva::InExpressionNode<long int
   auto cur_func_id = *func_count_;
   std::shared_ptr<CodeGenNodeVisitor> child_visitor;
   *func_count_ = *func_count_ + 1;
-  if (action_impl_) {
-    RETURN_NOT_OK(MakeCodeGenNodeVisitor(node.eval_expr(), field_list_v_[0], action_impl_,
-                                         &child_visitor));
-  } else {
-    RETURN_NOT_OK(MakeCodeGenNodeVisitor(node.eval_expr(), field_list_v_, func_count_,
-                                         codes_ss_, left_indices_, right_indices_,
-                                         &child_visitor));
-  }
+  RETURN_NOT_OK(MakeChildVisitor(node.eval_expr(), &child_visitor));
+  // the lookup in a std::vector doesn't vectorize
+  vectorizable_ = false;
   *codes_ss_ << "std::vector<long int> input_field_" << cur_func_id << " = {";
   bool add_comma = false;
   for (auto& value : node.values()) {
@@ -273,14 +372,9 @@ arrow::Status CodeGenNodeVisitor::Visit(
   auto cur_func_id = *func_count_;
   std::shared_ptr<CodeGenNodeVisitor> child_visitor;
   *func_count_ = *func_count_ + 1;
-  if (action_impl_) {
-    RETURN_NOT_OK(MakeCodeGenNodeVisitor(node.eval_expr(), field_list_v_[0], action_impl_,
-                                         &child_visitor));
-  } else {
-    RETURN_NOT_OK(MakeCodeGenNodeVisitor(node.eval_expr(), field_list_v_, func_count_,
-                                         codes_ss_, left_indices_, right_indices_,
-                                         &child_visitor));
-  }
+  RETURN_NOT_OK(MakeChildVisitor(node.eval_expr(), &child_visitor));
+  // the lookup in a std::vector doesn't vectorize
+  vectorizable_ = false;
   *codes_ss_ << "std::vector<std::string> input_field_" << cur_func_id << " = {";
   bool add_comma = false;
   for (auto& value : node.values()) {
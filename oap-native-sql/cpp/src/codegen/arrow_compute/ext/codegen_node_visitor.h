@@ -26,18 +26,30 @@ namespace sparkcolumnarplugin {
 namespace codegen {
 namespace arrowcompute {
 namespace extra {
+/// Whether node is one of the StringPredicate functions of a string operand and a
+/// string literal, and if so the expression constructing the predicate of the literal
+bool GetStringPredicateCodes(const gandiva::FunctionNode& node, std::string* out);
+
+/// With two field lists, the visitor emits the body of a join condition. It is evaluated
+/// row by row, on the build row x and the probe row y, or if vectorized, on all the
+/// cond_length candidate matches build_ids_ and probe_ids_ of a batch at once: each
+/// field is gathered into a column vector, its nulls ANDed into cond_valid, and the
+/// result is an expression of the k-th element of the vectors, which the compiler can
+/// vectorize. Only numeric fields are vectorizable, see IsVectorizable.
 class CodeGenNodeVisitor : public VisitorBase {
  public:
   CodeGenNodeVisitor(std::shared_ptr<gandiva::Node> func,
                      std::vector<std::vector<std::shared_ptr<arrow::Field>>> field_list_v,
                      int* func_count, std::stringstream* codes_ss,
-                     std::vector<int>* left_indices, std::vector<int>* right_indices)
+                     std::vector<int>* left_indices, std::vector<int>* right_indices,
+                     bool vectorized = false)
       : func_(func),
         field_list_v_(field_list_v),
         func_count_(func_count),
         codes_ss_(codes_ss),
         left_indices_(left_indices),
-        right_indices_(right_indices) {}
+        right_indices_(right_indices),
+        vectorized_(vectorized) {}
   CodeGenNodeVisitor(std::shared_ptr<gandiva::Node> func,
                      std::vector<std::shared_ptr<arrow::Field>> field_list)
       : func_(func), field_list_v_({field_list}) {
@@ -70,6 +82,7 @@ class CodeGenNodeVisitor : public VisitorBase {
   std::string GetInput();
   std::string GetResult();
   std::string GetPreCheck();
+  bool IsVectorizable() { return vectorizable_; }
   arrow::Status Visit(const gandiva::FunctionNode& node) override;
   arrow::Status Visit(const gandiva::FieldNode& node) override;
   arrow::Status Visit(const gandiva::IfNode& node) override;
@@ -93,8 +106,13 @@ class CodeGenNodeVisitor : public VisitorBase {
   std::vector<std::shared_ptr<arrow::Field>>* left_field_ = nullptr;
   std::vector<int>* right_indices_ = nullptr;
   std::vector<std::shared_ptr<arrow::Field>>* right_field_ = nullptr;
+  bool vectorized_ = false;
+  bool vectorizable_ = true;
   arrow::Status InsertToIndices(int index, int arg_id,
                                 std::shared_ptr<arrow::Field> field);
+  arrow::Status MakeChildVisitor(std::shared_ptr<gandiva::Node> child,
+                                 std::shared_ptr<CodeGenNodeVisitor>* out);
+  void VisitVectorizedField(int index, int arg_id, std::shared_ptr<arrow::Field> field);
 };
 static arrow::Status MakeCodeGenNodeVisitor(
     std::shared_ptr<gandiva::Node> func,
@@ -121,9 +139,10 @@ static arrow::Status MakeCodeGenNodeVisitor(
     std::shared_ptr<gandiva::Node> func,
     std::vector<std::vector<std::shared_ptr<arrow::Field>>> field_list_v, int* func_count,
     std::stringstream* codes_ss, std::vector<int>* left_indices,
-    std::vector<int>* right_indices, std::shared_ptr<CodeGenNodeVisitor>* out) {
+    std::vector<int>* right_indices, std::shared_ptr<CodeGenNodeVisitor>* out,
+    bool vectorized = false) {
   auto visitor = std::make_shared<CodeGenNodeVisitor>(
-      func, field_list_v, func_count, codes_ss, left_indices, right_indices);
+      func, field_list_v, func_count, codes_ss, left_indices, right_indices, vectorized);
   RETURN_NOT_OK(visitor->Eval());
   *out = visitor;
   return arrow::Status::OK();
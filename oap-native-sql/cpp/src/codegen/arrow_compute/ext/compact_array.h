@@ -0,0 +1,231 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/array.h>
+#include <arrow/buffer.h>
+#include <arrow/memory_pool.h>
+#include <arrow/result.h>
+#include <arrow/status.h>
+#include <arrow/util/bit_util.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "codegen/arrow_compute/ext/gather.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// \brief Cached integer array in frame-of-reference form
+///
+/// The values are kept as their offsets from the smallest one, in the fewest bytes
+/// holding the largest offset, so that a column of clustered values, e.g. ids, dates or
+/// small counters, takes a half to an eighth of its size while a sort or a join build
+/// side holds it. Unlike a block compression, a value is still read in O(1), for the
+/// random reads of a gather. The validity bitmap is the one of the input array. An
+/// array whose offsets don't fit a narrower type keeps its input values.
+template <typename ArrayType>
+class CompactArray {
+ public:
+  using TypeClass = typename ArrayType::TypeClass;
+  using CType = typename TypeClass::c_type;
+
+  static arrow::Status Make(const std::shared_ptr<arrow::Array>& in,
+                            arrow::MemoryPool* pool, std::shared_ptr<CompactArray>* out) {
+    const auto& array = static_cast<const ArrayType&>(*in);
+    auto compact = std::make_shared<CompactArray>();
+    compact->type_ = in->type();
+    compact->length_ = in->length();
+    compact->null_count_ = in->null_count();
+    if (compact->null_count_ != 0) {
+      compact->null_bitmap_ = in->null_bitmap();
+      compact->null_bitmap_data_ = in->null_bitmap_data();
+      compact->offset_ = in->offset();
+    }
+    const CType* values = array.raw_values();
+    bool empty = true;
+    CType min = 0;
+    CType max = 0;
+    for (int64_t i = 0; i < array.length(); ++i) {
+      if (compact->null_count_ != 0 && array.IsNull(i)) {
+        continue;
+      }
+      if (empty || values[i] < min) {
+        min = values[i];
+      }
+      if (empty || values[i] > max) {
+        max = values[i];
+      }
+      empty = false;
+    }
+    auto range = static_cast<UType>(static_cast<UType>(max) - static_cast<UType>(min));
+    if (range <= std::numeric_limits<uint8_t>::max()) {
+      compact->width_ = 1;
+    } else if (range <= std::numeric_limits<uint16_t>::max()) {
+      compact->width_ = 2;
+    } else if (range <= std::numeric_limits<uint32_t>::max()) {
+      compact->width_ = 4;
+    } else {
+      compact->width_ = 8;
+    }
+    if (compact->width_ >= static_cast<int>(sizeof(CType))) {
+      // no narrower type, the input values as they are
+      compact->width_ = sizeof(CType);
+      compact->values_ = in->data()->buffers[1];
+      compact->values_data_ = reinterpret_cast<const uint8_t*>(values);
+      *out = std::move(compact);
+      return arrow::Status::OK();
+    }
+    compact->base_ = min;
+    ARROW_ASSIGN_OR_RAISE(compact->values_,
+                          arrow::AllocateBuffer(array.length() * compact->width_, pool));
+    auto data = compact->values_->mutable_data();
+    switch (compact->width_) {
+      case 1:
+        compact->Encode(array, reinterpret_cast<uint8_t*>(data));
+        break;
+      case 2:
+        compact->Encode(array, reinterpret_cast<uint16_t*>(data));
+        break;
+      default:
+        compact->Encode(array, reinterpret_cast<uint32_t*>(data));
+        break;
+    }
+    compact->values_data_ = data;
+    *out = std::move(compact);
+    return arrow::Status::OK();
+  }
+
+  int64_t length() const { return length_; }
+  int64_t null_count() const { return null_count_; }
+  const std::shared_ptr<arrow::DataType>& type() const { return type_; }
+
+  bool IsNull(int64_t i) const {
+    return null_bitmap_data_ != nullptr &&
+           !arrow::BitUtil::GetBit(null_bitmap_data_, offset_ + i);
+  }
+
+  CType GetView(int64_t i) const {
+    switch (width_) {
+      case 1:
+        return Decode(reinterpret_cast<const uint8_t*>(values_data_)[i]);
+      case 2:
+        return Decode(reinterpret_cast<const uint16_t*>(values_data_)[i]);
+      case 4:
+        return Decode(reinterpret_cast<const uint32_t*>(values_data_)[i]);
+      default:
+        return reinterpret_cast<const CType*>(values_data_)[i];
+    }
+  }
+  CType Value(int64_t i) const { return GetView(i); }
+
+  /// Bytes of its buffers
+  int64_t bytes() const {
+    return (values_ != nullptr ? values_->size() : 0) +
+           (null_bitmap_ != nullptr ? null_bitmap_->size() : 0);
+  }
+
+ private:
+  using UType = typename std::make_unsigned<CType>::type;
+
+  template <typename OffsetType>
+  void Encode(const ArrayType& array, OffsetType* offsets) const {
+    const CType* values = array.raw_values();
+    for (int64_t i = 0; i < array.length(); ++i) {
+      // the slots of nulls may hold anything
+      offsets[i] = array.IsNull(i)
+                       ? 0
+                       : static_cast<OffsetType>(static_cast<UType>(values[i]) -
+                                                 static_cast<UType>(base_));
+    }
+  }
+
+  template <typename OffsetType>
+  CType Decode(OffsetType offset) const {
+    return static_cast<CType>(static_cast<UType>(static_cast<UType>(base_) + offset));
+  }
+
+  std::shared_ptr<arrow::DataType> type_;
+  int64_t length_ = 0;
+  int64_t null_count_ = 0;
+  std::shared_ptr<arrow::Buffer> null_bitmap_;
+  const uint8_t* null_bitmap_data_ = nullptr;
+  int64_t offset_ = 0;
+  std::shared_ptr<arrow::Buffer> values_;
+  const uint8_t* values_data_ = nullptr;
+  CType base_ = 0;
+  int width_ = sizeof(CType);
+};
+
+/// \brief Append in to the cached arrays of a column
+template <typename ArrayType>
+arrow::Status CacheArray(const std::shared_ptr<arrow::Array>& in, arrow::MemoryPool* pool,
+                         std::vector<std::shared_ptr<ArrayType>>* cached) {
+  cached->push_back(std::dynamic_pointer_cast<ArrayType>(in));
+  return arrow::Status::OK();
+}
+
+template <typename ArrayType>
+arrow::Status CacheArray(const std::shared_ptr<arrow::Array>& in, arrow::MemoryPool* pool,
+                         std::vector<std::shared_ptr<CompactArray<ArrayType>>>* cached) {
+  std::shared_ptr<CompactArray<ArrayType>> compact;
+  RETURN_NOT_OK(CompactArray<ArrayType>::Make(in, pool, &compact));
+  cached->push_back(std::move(compact));
+  return arrow::Status::OK();
+}
+
+/// Bytes of the buffers of a cached array
+template <typename ArrayType>
+int64_t CachedArrayBytes(const ArrayType& array) {
+  int64_t bytes = 0;
+  for (const auto& buffer : array.data()->buffers) {
+    if (buffer != nullptr) {
+      bytes += buffer->size();
+    }
+  }
+  return bytes;
+}
+
+template <typename ArrayType>
+int64_t CachedArrayBytes(const CompactArray<ArrayType>& array) {
+  return array.bytes();
+}
+
+/// \brief Gather the values of cached compact arrays at items into out, see GatherArray
+template <typename ArrayType, typename BuilderType, typename ItemIndex>
+arrow::Status GatherArray(
+    const std::vector<std::shared_ptr<CompactArray<ArrayType>>>& arrays,
+    const ItemIndex* items, const int32_t* order, int64_t length, arrow::MemoryPool* pool,
+    BuilderType* builder, std::shared_ptr<arrow::Array>* out) {
+  if (length == 0) {
+    return builder->Finish(out);
+  }
+  return GatherValues<typename CompactArray<ArrayType>::CType>(arrays, items, order,
+                                                               length, pool, out);
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
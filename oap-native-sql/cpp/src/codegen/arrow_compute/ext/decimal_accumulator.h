@@ -0,0 +1,130 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/type.h>
+#include <arrow/util/checked_cast.h>
+#include <arrow/util/decimal.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+using int128_t = __int128;
+using uint128_t = unsigned __int128;
+
+/// Largest precision of a decimal, as DecimalType.MAX_PRECISION of Spark
+constexpr int kMaxDecimalPrecision = 38;
+
+/// Spark's DecimalType.bounded
+inline std::shared_ptr<arrow::DataType> BoundedDecimalType(int precision, int scale) {
+  return arrow::decimal(std::min(precision, kMaxDecimalPrecision),
+                        std::min(scale, kMaxDecimalPrecision));
+}
+
+/// Type of Spark's sum of a decimal(p, s), decimal(p + 10, s)
+inline std::shared_ptr<arrow::DataType> DecimalSumType(const arrow::DataType& type) {
+  const auto& decimal = arrow::internal::checked_cast<const arrow::DecimalType&>(type);
+  return BoundedDecimalType(decimal.precision() + 10, decimal.scale());
+}
+
+/// Type of Spark's avg of a decimal(p, s), decimal(p + 4, s + 4)
+inline std::shared_ptr<arrow::DataType> DecimalAvgType(const arrow::DataType& type) {
+  const auto& decimal = arrow::internal::checked_cast<const arrow::DecimalType&>(type);
+  return BoundedDecimalType(decimal.precision() + 4, decimal.scale() + 4);
+}
+
+/// Unscaled value of the little-endian Decimal128 at bytes
+inline int128_t LoadDecimal(const uint8_t* bytes) {
+  uint64_t low;
+  uint64_t high;
+  std::memcpy(&low, bytes, sizeof(low));
+  std::memcpy(&high, bytes + sizeof(low), sizeof(high));
+  return static_cast<int128_t>((static_cast<uint128_t>(high) << 64) | low);
+}
+
+inline arrow::Decimal128 ToDecimal128(int128_t value) {
+  return arrow::Decimal128(static_cast<int64_t>(value >> 64),
+                           static_cast<uint64_t>(value));
+}
+
+inline int128_t PowerOfTen(int n) {
+  int128_t res = 1;
+  for (int i = 0; i < n; i++) res *= 10;
+  return res;
+}
+
+/// \brief Exact sum of the unscaled values of decimals
+///
+/// The values are added in 128 bits, which compiles to an add with carry. A sum out of
+/// them is marked overflowed, and is then null as Spark's sum out of the precision of
+/// its decimal type.
+struct DecimalAccumulator {
+  int128_t sum = 0;
+  bool overflow = false;
+
+  void Add(int128_t value) { overflow |= __builtin_add_overflow(sum, value, &sum); }
+
+  void Merge(const DecimalAccumulator& other) {
+    Add(other.sum);
+    overflow |= other.overflow;
+  }
+
+  /// Whether the sum is a decimal of precision
+  bool Fits(int precision) const {
+    auto bound = PowerOfTen(precision);
+    return !overflow && sum < bound && sum > -bound;
+  }
+};
+
+/// \brief Quotient of sum * 10^scale_up by count, rounded half up as Spark's decimals
+///
+/// sum is divided first so that only the remainder is scaled in 128 bits. False if the
+/// quotient is out of 128 bits.
+inline bool DivideRoundHalfUp(int128_t sum, int64_t count, int scale_up, int128_t* out) {
+  bool negative = sum < 0;
+  uint128_t abs_sum = static_cast<uint128_t>(sum);
+  if (negative) abs_sum = -abs_sum;
+  uint128_t divisor = static_cast<uint128_t>(count);
+  uint128_t scale = static_cast<uint128_t>(PowerOfTen(scale_up));
+  uint128_t quotient;
+  uint128_t remainder;
+  if (__builtin_mul_overflow(abs_sum / divisor, scale, &quotient) ||
+      __builtin_mul_overflow(abs_sum % divisor, scale, &remainder)) {
+    return false;
+  }
+  uint128_t fraction = remainder / divisor;
+  if ((remainder % divisor) * 2 >= divisor) fraction++;
+  if (__builtin_add_overflow(quotient, fraction, &quotient) ||
+      quotient > static_cast<uint128_t>(~uint128_t(0) >> 1)) {
+    return false;
+  }
+  *out = negative ? -static_cast<int128_t>(quotient) : static_cast<int128_t>(quotient);
+  return true;
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
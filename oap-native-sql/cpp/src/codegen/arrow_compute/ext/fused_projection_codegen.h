@@ -0,0 +1,442 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/type.h>
+#include <gandiva/literal_holder.h>
+#include <gandiva/node.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "codegen/arrow_compute/ext/codegen_common.h"
+#include "codegen/arrow_compute/ext/codegen_node_visitor.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// \brief Generates the projections of the action inputs into the aggregation loop
+///
+/// A projection is computed row by row by a generated struct with the IsNull and
+/// GetView of a typed array, so that the actions read it as any input and it never
+/// materializes as an Arrow array. Each distinct subexpression of all the projections
+/// added is one struct, computed once per row however many projections share it.
+/// Additions, subtractions, multiplications, casts and comparisons of numeric input
+/// fields and literals, the and, or and not of booleans, and the StringPredicate of a
+/// string input field and a literal can be fused, see CanFuse, others are left to
+/// gandiva. A string predicate is evaluated a batch at a time into a bitmap.
+class FusedProjectionCodeGen {
+ public:
+  FusedProjectionCodeGen(std::vector<std::shared_ptr<arrow::Field>> input_field_list)
+      : input_field_list_(input_field_list) {}
+
+  bool CanFuse(const gandiva::NodePtr& node) {
+    auto type = node->return_type();
+    if (!IsNumeric(type) && type->id() != arrow::Type::BOOL) {
+      return false;
+    }
+    if (auto field_node = std::dynamic_pointer_cast<gandiva::FieldNode>(node)) {
+      return GetInputIndex(*field_node) >= 0;
+    }
+    if (auto literal_node = std::dynamic_pointer_cast<gandiva::LiteralNode>(node)) {
+      return !GetLiteralString(*literal_node).empty();
+    }
+    if (auto boolean_node = std::dynamic_pointer_cast<gandiva::BooleanNode>(node)) {
+      for (const auto& child : boolean_node->children()) {
+        if (child->return_type()->id() != arrow::Type::BOOL || !CanFuse(child)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    auto func_node = std::dynamic_pointer_cast<gandiva::FunctionNode>(node);
+    if (!func_node) {
+      return false;
+    }
+    const auto& children = func_node->children();
+    std::string predicate_codes;
+    if (GetStringPredicateCodes(*func_node, &predicate_codes)) {
+      auto field_node = std::dynamic_pointer_cast<gandiva::FieldNode>(children[0]);
+      return field_node && GetInputIndex(*field_node, true) >= 0;
+    }
+    for (const auto& child : children) {
+      if (!CanFuse(child)) {
+        return false;
+      }
+    }
+    auto name = func_node->descriptor()->name();
+    if (name == "add" || name == "subtract" || name == "multiply") {
+      return children.size() == 2 && IsNumeric(type);
+    }
+    if (name == "castBIGINT" || name == "castINT" || name == "castFLOAT4" ||
+        name == "castFLOAT8") {
+      // floats cast to integers round in gandiva
+      return children.size() == 1 && IsNumeric(children[0]->return_type()) &&
+             !(arrow::is_floating(children[0]->return_type()->id()) &&
+               arrow::is_integer(type->id()));
+    }
+    if (!GetComparisonOperator(name).empty()) {
+      return children.size() == 2 && IsNumeric(children[0]->return_type()) &&
+             IsNumeric(children[1]->return_type());
+    }
+    if (name == "not") {
+      return children.size() == 1 &&
+             children[0]->return_type()->id() == arrow::Type::BOOL;
+    }
+    return false;
+  }
+
+  /// Add a node CanFuse, the name returned is that of the member struct computing it
+  std::string Add(const gandiva::NodePtr& node) { return GetNodeName(node); }
+
+  bool empty() { return node_ids_.empty(); }
+
+  /// Definitions of the structs, in the order of their dependencies
+  std::string GetDefineCodes() { return define_ss_.str(); }
+
+  /// Members of the kernel holding the structs
+  std::string GetMemberCodes() { return member_ss_.str(); }
+
+  /// Codes pointing the structs to the input arrays in of a batch
+  std::string GetPrepareCodes() {
+    std::stringstream ss;
+    for (auto index : input_indices_) {
+      auto type = input_field_list_[index]->type();
+      ss << "auto fused_in_" << index << " = std::dynamic_pointer_cast<arrow::"
+         << GetTypeString(type, "Array") << ">(in[" << index << "]);" << std::endl;
+    }
+    ss << prepare_ss_.str();
+    return ss.str();
+  }
+
+ private:
+  std::vector<std::shared_ptr<arrow::Field>> input_field_list_;
+  // struct of each subexpression by its string
+  std::unordered_map<std::string, int> node_ids_;
+  std::vector<int> input_indices_;
+  std::stringstream define_ss_;
+  std::stringstream member_ss_;
+  std::stringstream prepare_ss_;
+
+  static bool IsNumeric(const std::shared_ptr<arrow::DataType>& type) {
+    return arrow::is_integer(type->id()) || arrow::is_floating(type->id());
+  }
+
+  static std::string GetComparisonOperator(const std::string& name) {
+    if (name == "equal") return " == ";
+    if (name == "not_equal") return " != ";
+    if (name == "less_than") return " < ";
+    if (name == "less_than_or_equal_to") return " <= ";
+    if (name == "greater_than") return " > ";
+    if (name == "greater_than_or_equal_to") return " >= ";
+    return "";
+  }
+
+  static gandiva::NodeVector GetChildren(const gandiva::NodePtr& node) {
+    if (auto boolean_node = std::dynamic_pointer_cast<gandiva::BooleanNode>(node)) {
+      return boolean_node->children();
+    }
+    if (auto func_node = std::dynamic_pointer_cast<gandiva::FunctionNode>(node)) {
+      return func_node->children();
+    }
+    return {};
+  }
+
+  // Index of the input field of node if numeric or boolean, or with strings a string
+  // or a binary, else -1
+  int GetInputIndex(const gandiva::FieldNode& node, bool strings = false) {
+    for (int i = 0; i < input_field_list_.size(); i++) {
+      if (input_field_list_[i]->name() == node.field()->name()) {
+        auto type_id = input_field_list_[i]->type()->id();
+        if (strings) {
+          return type_id == arrow::Type::STRING || type_id == arrow::Type::BINARY ? i
+                                                                                  : -1;
+        }
+        return IsNumeric(input_field_list_[i]->type()) || type_id == arrow::Type::BOOL
+                   ? i
+                   : -1;
+      }
+    }
+    return -1;
+  }
+
+  void AddInputIndex(int index) {
+    if (std::find(input_indices_.begin(), input_indices_.end(), index) ==
+        input_indices_.end()) {
+      input_indices_.push_back(index);
+    }
+  }
+
+  // Define the struct of a string predicate, which matches the whole batch when
+  // prepared
+  void DefineStringPredicate(const gandiva::FunctionNode& node,
+                             const std::string& struct_name, const std::string& name) {
+    std::string predicate_codes;
+    GetStringPredicateCodes(node, &predicate_codes);
+    auto field_node = std::dynamic_pointer_cast<gandiva::FieldNode>(node.children()[0]);
+    auto index = GetInputIndex(*field_node, true);
+    AddInputIndex(index);
+    auto member = "in_" + std::to_string(index) + "_";
+    define_ss_ << "struct " << struct_name << " {" << std::endl;
+    define_ss_ << "  const arrow::" << GetTypeString(field_node->return_type(), "Array")
+               << "* " << member << " = nullptr;" << std::endl;
+    define_ss_ << "  const sparkcolumnarplugin::codegen::StringPredicate predicate_ = "
+               << predicate_codes << ";" << std::endl;
+    define_ss_ << "  // whether each row is valid and matches" << std::endl;
+    define_ss_ << "  std::vector<uint8_t> matches_;" << std::endl;
+    define_ss_ << "  void Prepare() {" << std::endl;
+    define_ss_ << "    matches_.resize(arrow::BitUtil::BytesForBits(" << member
+               << "->length()));" << std::endl;
+    define_ss_ << "    predicate_.Evaluate(*" << member << ", matches_.data());"
+               << std::endl;
+    define_ss_ << "  }" << std::endl;
+    define_ss_ << "  bool IsNull(int64_t i) { return " << member << "->IsNull(i); }"
+               << std::endl;
+    define_ss_ << "  bool GetView(int64_t i) {" << std::endl;
+    define_ss_ << "    return arrow::BitUtil::GetBit(matches_.data(), i);" << std::endl;
+    define_ss_ << "  }" << std::endl;
+    define_ss_ << "};" << std::endl;
+
+    member_ss_ << struct_name << " " << name << ";" << std::endl;
+    prepare_ss_ << name << "." << member << " = fused_in_" << index << ".get();"
+                << std::endl;
+    prepare_ss_ << name << ".Prepare();" << std::endl;
+  }
+
+  // C++ literal of a valid finite number or a boolean, empty otherwise
+  static std::string GetLiteralString(const gandiva::LiteralNode& node) {
+    if (node.is_null()) {
+      return "";
+    }
+    const auto& holder = node.holder();
+    std::stringstream ss;
+    switch (node.return_type()->id()) {
+      case arrow::Type::BOOL:
+        return arrow::util::get<bool>(holder) ? "true" : "false";
+      case arrow::Type::INT8:
+        return std::to_string(arrow::util::get<int8_t>(holder));
+      case arrow::Type::INT16:
+        return std::to_string(arrow::util::get<int16_t>(holder));
+      case arrow::Type::INT32:
+        return std::to_string(arrow::util::get<int32_t>(holder));
+      case arrow::Type::INT64:
+        // the smallest int64 has no literal of its own
+        if (arrow::util::get<int64_t>(holder) == std::numeric_limits<int64_t>::min()) {
+          return "";
+        }
+        return std::to_string(arrow::util::get<int64_t>(holder)) + "LL";
+      case arrow::Type::UINT8:
+        return std::to_string(arrow::util::get<uint8_t>(holder));
+      case arrow::Type::UINT16:
+        return std::to_string(arrow::util::get<uint16_t>(holder));
+      case arrow::Type::UINT32:
+        return std::to_string(arrow::util::get<uint32_t>(holder)) + "U";
+      case arrow::Type::UINT64:
+        return std::to_string(arrow::util::get<uint64_t>(holder)) + "ULL";
+      case arrow::Type::FLOAT: {
+        auto value = arrow::util::get<float>(holder);
+        if (!std::isfinite(value)) {
+          return "";
+        }
+        ss << std::setprecision(9) << std::showpoint << value << "f";
+        return ss.str();
+      }
+      case arrow::Type::DOUBLE: {
+        auto value = arrow::util::get<double>(holder);
+        if (!std::isfinite(value)) {
+          return "";
+        }
+        ss << std::setprecision(17) << std::showpoint << value;
+        return ss.str();
+      }
+      default:
+        return "";
+    }
+  }
+
+  // validity and value of a child of a struct at row i, and its member if any
+  struct Operand {
+    std::string valid;
+    std::string value;
+    std::string member_define;
+    std::string member_prepare;
+  };
+
+  Operand GetOperand(const gandiva::NodePtr& node, const std::string& owner) {
+    Operand operand;
+    if (auto field_node = std::dynamic_pointer_cast<gandiva::FieldNode>(node)) {
+      auto index = GetInputIndex(*field_node);
+      AddInputIndex(index);
+      auto member = "in_" + std::to_string(index) + "_";
+      operand.valid = "!" + member + "->IsNull(i)";
+      operand.value = member + "->GetView(i)";
+      operand.member_define = "const arrow::" +
+                              GetTypeString(node->return_type(), "Array") + "* " +
+                              member + " = nullptr;";
+      operand.member_prepare = owner + "." + member + " = fused_in_" +
+                               std::to_string(index) + ".get();";
+    } else if (auto literal_node =
+                   std::dynamic_pointer_cast<gandiva::LiteralNode>(node)) {
+      operand.valid = "true";
+      operand.value = GetLiteralString(*literal_node);
+    } else {
+      auto name = GetNodeName(node);
+      auto member = name + "ptr_";
+      operand.valid = "!" + member + "->IsNull(i)";
+      operand.value = member + "->GetView(i)";
+      operand.member_define = "Fused" + name.substr(6, name.size() - 7) + "* " + member +
+                              " = nullptr;";
+      operand.member_prepare = owner + "." + member + " = &" + name + ";";
+    }
+    return operand;
+  }
+
+  // Validity and value of node at row i from those of its operands
+  static void GetComputeCodes(const gandiva::NodePtr& node,
+                              const std::vector<Operand>& operands, std::string* valid,
+                              std::string* value) {
+    std::string all_valid;
+    for (const auto& operand : operands) {
+      all_valid += (all_valid.empty() ? "" : " && ") + operand.valid;
+    }
+    if (auto boolean_node = std::dynamic_pointer_cast<gandiva::BooleanNode>(node)) {
+      // a null is unknown, an and of a false or an or of a true is known still
+      bool is_and = boolean_node->expr_type() == gandiva::BooleanNode::AND;
+      std::string decided;
+      for (const auto& operand : operands) {
+        decided += std::string(decided.empty() ? "" : " || ") + "(" + operand.valid +
+                   " && " + (is_and ? "!" : "") + operand.value + ")";
+      }
+      *valid = "(" + all_valid + ") || " + decided;
+      *value = is_and ? "!(" + decided + ")" : decided;
+      return;
+    }
+    *valid = all_valid;
+    auto func_name =
+        std::dynamic_pointer_cast<gandiva::FunctionNode>(node)->descriptor()->name();
+    auto ctype = GetCTypeString(node->return_type());
+    auto comparison = GetComparisonOperator(func_name);
+    if (func_name == "not") {
+      *value = "!" + operands[0].value;
+    } else if (!comparison.empty()) {
+      *value = operands[0].value + comparison + operands[1].value;
+    } else if (operands.size() == 1) {
+      *value = "static_cast<" + ctype + ">(" + operands[0].value + ")";
+    } else {
+      std::string op =
+          func_name == "add" ? " + " : func_name == "subtract" ? " - " : " * ";
+      // integers wrap on overflow as in gandiva, computed unsigned not to overflow
+      std::string operand_ctype =
+          arrow::is_integer(node->return_type()->id()) ? "uint64_t" : ctype;
+      *value = "static_cast<" + ctype + ">(static_cast<" + operand_ctype + ">(" +
+               operands[0].value + ")" + op + "static_cast<" + operand_ctype + ">(" +
+               operands[1].value + "))";
+    }
+  }
+
+  // Name of the member struct of a function or boolean node, defining it first if new
+  std::string GetNodeName(const gandiva::NodePtr& node) {
+    auto key = node->ToString();
+    auto it = node_ids_.find(key);
+    if (it != node_ids_.end()) {
+      return "fused_" + std::to_string(it->second) + "_";
+    }
+    auto children = GetChildren(node);
+    // the children are defined first, with the ids before
+    for (const auto& child : children) {
+      if (!GetChildren(child).empty()) {
+        GetNodeName(child);
+      }
+    }
+    auto id = static_cast<int>(node_ids_.size());
+    node_ids_[key] = id;
+    auto struct_name = "Fused" + std::to_string(id);
+    auto name = "fused_" + std::to_string(id) + "_";
+    auto func_node = std::dynamic_pointer_cast<gandiva::FunctionNode>(node);
+    std::string predicate_codes;
+    if (func_node && GetStringPredicateCodes(*func_node, &predicate_codes)) {
+      define_ss_ << "// " << key << std::endl;
+      DefineStringPredicate(*func_node, struct_name, name);
+      return name;
+    }
+    std::vector<Operand> operands;
+    for (const auto& child : children) {
+      operands.push_back(GetOperand(child, name));
+    }
+    std::string valid;
+    std::string value;
+    GetComputeCodes(node, operands, &valid, &value);
+    // an operand twice, as in f * f, is a single member
+    std::vector<std::string> member_defines;
+    std::vector<std::string> member_prepares;
+    for (const auto& operand : operands) {
+      if (!operand.member_define.empty() &&
+          std::find(member_defines.begin(), member_defines.end(),
+                    operand.member_define) == member_defines.end()) {
+        member_defines.push_back(operand.member_define);
+        member_prepares.push_back(operand.member_prepare);
+      }
+    }
+
+    auto ctype = GetCTypeString(node->return_type());
+    define_ss_ << "// " << key << std::endl;
+    define_ss_ << "struct " << struct_name << " {" << std::endl;
+    for (const auto& member_define : member_defines) {
+      define_ss_ << "  " << member_define << std::endl;
+    }
+    define_ss_ << "  int64_t row_ = -1;" << std::endl;
+    define_ss_ << "  bool valid_ = false;" << std::endl;
+    define_ss_ << "  " << ctype << " value_ = 0;" << std::endl;
+    define_ss_ << "  void Compute(int64_t i) {" << std::endl;
+    define_ss_ << "    if (i == row_) return;" << std::endl;
+    define_ss_ << "    row_ = i;" << std::endl;
+    define_ss_ << "    valid_ = " << valid << ";" << std::endl;
+    define_ss_ << "    if (valid_) value_ = " << value << ";" << std::endl;
+    define_ss_ << "  }" << std::endl;
+    define_ss_ << "  bool IsNull(int64_t i) {" << std::endl;
+    define_ss_ << "    Compute(i);" << std::endl;
+    define_ss_ << "    return !valid_;" << std::endl;
+    define_ss_ << "  }" << std::endl;
+    define_ss_ << "  " << ctype << " GetView(int64_t i) {" << std::endl;
+    define_ss_ << "    Compute(i);" << std::endl;
+    define_ss_ << "    return value_;" << std::endl;
+    define_ss_ << "  }" << std::endl;
+    define_ss_ << "};" << std::endl;
+
+    member_ss_ << struct_name << " " << name << ";" << std::endl;
+    prepare_ss_ << name << ".row_ = -1;" << std::endl;
+    for (const auto& member_prepare : member_prepares) {
+      prepare_ss_ << member_prepare << std::endl;
+    }
+    return name;
+  }
+};
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,177 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/array.h>
+#include <arrow/buffer.h>
+#include <arrow/memory_pool.h>
+#include <arrow/result.h>
+#include <arrow/status.h>
+#include <arrow/util/bit_util.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// \brief Append the values of cached arrays at items to builder
+///
+/// Gathers one output column of a join from its selection vector, so that the loop
+/// only touches the arrays of this column. A null is appended where valid is 0, or
+/// where the value is null. valid may be null if all items are valid.
+template <typename ArrayType, typename BuilderType, typename ItemIndex>
+arrow::Status GatherItems(const std::vector<std::shared_ptr<ArrayType>>& arrays,
+                          const ItemIndex* items, const uint8_t* valid, int64_t length,
+                          BuilderType* builder) {
+  RETURN_NOT_OK(builder->Reserve(length));
+  for (int64_t k = 0; k < length; ++k) {
+    if (valid != nullptr && valid[k] == 0) {
+      RETURN_NOT_OK(builder->AppendNull());
+      continue;
+    }
+    const auto& array = *arrays[items[k].array_id];
+    if (array.IsNull(items[k].id)) {
+      RETURN_NOT_OK(builder->AppendNull());
+    } else {
+      RETURN_NOT_OK(builder->Append(array.GetView(items[k].id)));
+    }
+  }
+  return arrow::Status::OK();
+}
+
+/// \brief Append the values of array at rows to builder
+template <typename ArrayType, typename BuilderType>
+arrow::Status GatherRows(const ArrayType& array, const int32_t* rows, int64_t length,
+                         BuilderType* builder) {
+  RETURN_NOT_OK(builder->Reserve(length));
+  if (array.null_count() == 0) {
+    for (int64_t k = 0; k < length; ++k) {
+      RETURN_NOT_OK(builder->Append(array.GetView(rows[k])));
+    }
+    return arrow::Status::OK();
+  }
+  for (int64_t k = 0; k < length; ++k) {
+    if (array.IsNull(rows[k])) {
+      RETURN_NOT_OK(builder->AppendNull());
+    } else {
+      RETURN_NOT_OK(builder->Append(array.GetView(rows[k])));
+    }
+  }
+  return arrow::Status::OK();
+}
+
+/// \brief Permutation of [0, length) visiting the items array by array
+///
+/// Items of the same array keep their order, so that a gather following it reads each
+/// source array in one pass.
+template <typename ItemIndex>
+void OrderByArray(const ItemIndex* items, int64_t length, std::vector<int32_t>* order) {
+  order->resize(length);
+  std::iota(order->begin(), order->end(), 0);
+  std::stable_sort(order->begin(), order->end(), [items](int32_t x, int32_t y) {
+    return items[x].array_id < items[y].array_id;
+  });
+}
+
+// Arrays of c_type values, e.g. not booleans, nor decimals whose raw_values are bytes
+template <typename ArrayType, typename = void>
+struct HasRawValues : std::false_type {};
+
+template <typename ArrayType>
+struct HasRawValues<ArrayType,
+                    decltype(void(std::declval<const ArrayType&>().raw_values()),
+                             void(typename ArrayType::TypeClass::c_type()))>
+    : std::true_type {};
+
+/// \brief Gather the CType values of cached arrays at items into out
+///
+/// Reads in the order of OrderByArray and writes straight to the output positions, for
+/// the arrays of CType values, e.g. NumericArray or CompactArray.
+template <typename CType, typename ArrayType, typename ItemIndex>
+arrow::Status GatherValues(const std::vector<std::shared_ptr<ArrayType>>& arrays,
+                           const ItemIndex* items, const int32_t* order, int64_t length,
+                           arrow::MemoryPool* pool, std::shared_ptr<arrow::Array>* out) {
+  ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> values,
+                        arrow::AllocateBuffer(length * sizeof(CType), pool));
+  auto out_values = reinterpret_cast<CType*>(values->mutable_data());
+  std::shared_ptr<arrow::Buffer> validity;
+  uint8_t* out_valid = nullptr;
+  int64_t null_count = 0;
+  for (int64_t k = 0; k < length; ++k) {
+    auto pos = order[k];
+    const auto& item = items[pos];
+    const auto& array = *arrays[item.array_id];
+    out_values[pos] = array.GetView(item.id);
+    if (array.null_count() != 0 && array.IsNull(item.id)) {
+      if (out_valid == nullptr) {
+        auto validity_size = arrow::BitUtil::BytesForBits(length);
+        ARROW_ASSIGN_OR_RAISE(validity, arrow::AllocateBuffer(validity_size, pool));
+        out_valid = validity->mutable_data();
+        std::memset(out_valid, 0xff, validity_size);
+      }
+      arrow::BitUtil::ClearBit(out_valid, pos);
+      ++null_count;
+    }
+  }
+  const auto& type = arrays[items[0].array_id]->type();
+  *out = arrow::MakeArray(
+      arrow::ArrayData::Make(type, length, {validity, values}, null_count));
+  return arrow::Status::OK();
+}
+
+/// \brief Gather the values of cached arrays at items into out
+///
+/// Fixed-width values are read in the order of OrderByArray and written straight to
+/// their output positions, without a builder. The other types are appended to builder,
+/// in output order.
+template <typename ArrayType, typename BuilderType, typename ItemIndex>
+typename std::enable_if<HasRawValues<ArrayType>::value, arrow::Status>::type
+GatherArray(const std::vector<std::shared_ptr<ArrayType>>& arrays,
+            const ItemIndex* items, const int32_t* order, int64_t length,
+            arrow::MemoryPool* pool, BuilderType* builder,
+            std::shared_ptr<arrow::Array>* out) {
+  if (length == 0) {
+    return builder->Finish(out);
+  }
+  return GatherValues<typename ArrayType::TypeClass::c_type>(arrays, items, order,
+                                                             length, pool, out);
+}
+
+template <typename ArrayType, typename BuilderType, typename ItemIndex>
+typename std::enable_if<!HasRawValues<ArrayType>::value, arrow::Status>::type
+GatherArray(const std::vector<std::shared_ptr<ArrayType>>& arrays,
+            const ItemIndex* items, const int32_t* order, int64_t length,
+            arrow::MemoryPool* pool, BuilderType* builder,
+            std::shared_ptr<arrow::Array>* out) {
+  RETURN_NOT_OK(GatherItems(arrays, items, nullptr, length, builder));
+  return builder->Finish(out);
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
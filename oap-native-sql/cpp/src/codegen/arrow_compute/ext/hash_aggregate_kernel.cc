@@ -15,16 +15,25 @@
  * limitations under the License.
  */
 
+#include <arrow/builder.h>
 #include <arrow/compute/context.h>
+#include <arrow/compute/kernels/take.h>
 #include <arrow/type.h>
 #include <arrow/type_fwd.h>
 #include <arrow/type_traits.h>
+#include <gandiva/filter.h>
+#include <gandiva/selection_vector.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstdio>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <numeric>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "codegen/arrow_compute/ext/array_item_index.h"
@@ -32,9 +41,16 @@
 #include "codegen/arrow_compute/ext/codegen_common.h"
 #include "codegen/arrow_compute/ext/codegen_node_visitor.h"
 #include "codegen/arrow_compute/ext/codegen_register.h"
+#include "codegen/arrow_compute/ext/fused_projection_codegen.h"
 #include "codegen/arrow_compute/ext/kernels_ext.h"
+#include "codegen/arrow_compute/ext/spill.h"
 #include "codegen/arrow_compute/ext/typed_action_codegen_impl.h"
+#include "codegen/common/gandiva_cache.h"
+#include "third_party/arrow/utils/hashing.h"
+#include "utils/arena_memory_pool.h"
 #include "utils/macros.h"
+#include "utils/task_memory_pool.h"
+#include "utils/task_scheduler.h"
 
 namespace sparkcolumnarplugin {
 namespace codegen {
@@ -42,21 +58,158 @@ namespace arrowcompute {
 namespace extra {
 using ArrayList = std::vector<std::shared_ptr<arrow::Array>>;
 
+namespace {
+
+// Keys HashKeyRows can hash: strings and the fixed-width types but bool
+bool CanHashKeys(const std::vector<std::shared_ptr<arrow::DataType>>& types) {
+  for (const auto& type : types) {
+    auto fixed_width = dynamic_cast<const arrow::FixedWidthType*>(type.get());
+    bool can_hash = arrow::is_binary_like(type->id()) ||
+                    (fixed_width != nullptr && fixed_width->bit_width() % 8 == 0 &&
+                     type->id() != arrow::Type::DICTIONARY);
+    if (!can_hash) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Hash the keys of each row, rows of equal keys hash alike, see CanHashKeys
+void HashKeyRows(const ArrayList& keys, std::vector<uint64_t>* hashes) {
+  using arrow::internal::ComputeStringHash;
+  auto& h = *hashes;
+  h.assign(keys[0]->length(), 0);
+  for (const auto& key : keys) {
+    if (arrow::is_binary_like(key->type_id())) {
+      const auto& binary = static_cast<const arrow::BinaryArray&>(*key);
+      for (int64_t i = 0; i < binary.length(); i++) {
+        auto value = binary.GetView(i);
+        h[i] = h[i] * 31 +
+               (binary.IsValid(i) ? ComputeStringHash<0>(value.data(), value.size()) : 0);
+      }
+    } else {
+      const auto& type = static_cast<const arrow::FixedWidthType&>(*key->type());
+      auto width = type.bit_width() / 8;
+      auto values = key->data()->buffers[1]->data() + key->offset() * width;
+      for (int64_t i = 0; i < key->length(); i++) {
+        h[i] = h[i] * 31 +
+               (key->IsValid(i) ? ComputeStringHash<0>(values + i * width, width) : 0);
+      }
+    }
+  }
+}
+
+template <typename ArrayType>
+arrow::Status MarkSelected(const arrow::Array& selection, int64_t length,
+                           uint8_t* mask) {
+  const auto& indices = static_cast<const ArrayType&>(selection);
+  for (int64_t i = 0; i < indices.length(); i++) {
+    auto index = static_cast<int64_t>(indices.Value(i));
+    if (index < 0 || index >= length) {
+      return arrow::Status::Invalid("Selected row ", index, " out of a batch of ",
+                                    length);
+    }
+    mask[index] = 1;
+  }
+  return arrow::Status::OK();
+}
+
+// Set the mask of the rows of a batch of length selected by the indices of selection,
+// as made by a gandiva filter
+arrow::Status SelectionToMask(const arrow::Array& selection, int64_t length,
+                              std::vector<uint8_t>* mask) {
+  mask->assign(length, 0);
+  switch (selection.type_id()) {
+    case arrow::Type::UINT16:
+      return MarkSelected<arrow::UInt16Array>(selection, length, mask->data());
+    case arrow::Type::INT32:
+      return MarkSelected<arrow::Int32Array>(selection, length, mask->data());
+    case arrow::Type::UINT32:
+      return MarkSelected<arrow::UInt32Array>(selection, length, mask->data());
+    case arrow::Type::INT64:
+      return MarkSelected<arrow::Int64Array>(selection, length, mask->data());
+    default:
+      return arrow::Status::NotImplemented("Selection of ",
+                                           selection.type()->ToString(), " indices");
+  }
+}
+
+// Take the rows of in at indices
+arrow::Status TakeArrays(arrow::compute::FunctionContext* ctx, const ArrayList& in,
+                         const arrow::Array& indices, ArrayList* out) {
+  for (const auto& array : in) {
+    std::shared_ptr<arrow::Array> taken;
+    RETURN_NOT_OK(arrow::compute::Take(ctx, *array, indices,
+                                       arrow::compute::TakeOptions(), &taken));
+    out->push_back(taken);
+  }
+  return arrow::Status::OK();
+}
+
+}  // namespace
+
 ///////////////  SortArraysToIndices  ////////////////
 class HashAggregateKernel::Impl {
  public:
   Impl(arrow::compute::FunctionContext* ctx,
        std::vector<std::shared_ptr<arrow::Field>> input_field_list,
        std::vector<std::shared_ptr<gandiva::Node>> action_list,
-       std::shared_ptr<arrow::Schema> result_schema)
+       std::shared_ptr<arrow::Schema> result_schema, bool partial,
+       std::shared_ptr<KernelMetrics> metrics)
       : ctx_(ctx),
         input_field_list_(input_field_list),
+        input_schema_(arrow::schema(input_field_list)),
         action_list_(action_list),
-        result_schema_(result_schema) {
+        result_schema_(result_schema),
+        partial_(partial),
+        fused_projection_(input_field_list),
+        scratch_pool_(ctx->memory_pool()),
+        metrics_(std::move(metrics)) {
+    THROW_NOT_OK(PrepareFilter());
     // if there is projection inside aggregate, we need to extract them into
     // projector_list
     THROW_NOT_OK(PrepareActionCodegen());
     THROW_NOT_OK(LoadJITFunction());
+    // the input of a spilled aggregation is partitioned by its group keys, the keys
+    // computed by a projection can't spill
+    for (const auto& key : key_list_) {
+      std::vector<int> key_index;
+      THROW_NOT_OK(GetIndexList({key.first}, input_field_list_, &key_index));
+      if (key_index[0] >= static_cast<int>(input_field_list_.size())) {
+        key_indices_.clear();
+        break;
+      }
+      key_indices_.push_back(key_index[0]);
+    }
+    std::vector<std::shared_ptr<arrow::DataType>> key_types;
+    for (auto index : key_indices_) {
+      key_types.push_back(input_field_list_[index]->type());
+    }
+    // the partitions of a parallel aggregation don't spill
+    auto num_threads = GetAggregateThreads();
+    if (num_threads > 1 && !key_indices_.empty() && CanHashKeys(key_types) &&
+        GetAggregateMemoryBudget() <= 0) {
+      for (int i = 0; i < num_threads; i++) {
+        partition_ctxs_.emplace_back(
+            new arrow::compute::FunctionContext(ctx_->memory_pool()));
+      }
+    }
+    // a task short of memory has the aggregation spill at its next batch, which needs
+    // the input kept under a memory budget
+    task_pool_ = dynamic_cast<TaskMemoryPool*>(ctx_->memory_pool());
+    if (task_pool_ != nullptr && GetAggregateMemoryBudget() > 0) {
+      spiller_id_ = task_pool_->AddSpiller([this](int64_t bytes) {
+        spill_requested_ = true;
+        return int64_t(0);
+      });
+    } else {
+      task_pool_ = nullptr;
+    }
+  }
+  virtual ~Impl() {
+    if (task_pool_ != nullptr) {
+      task_pool_->RemoveSpiller(spiller_id_);
+    }
   }
   virtual arrow::Status LoadJITFunction() {
     // generate ddl signature
@@ -72,51 +225,141 @@ class HashAggregateKernel::Impl {
       RETURN_NOT_OK(MakeCodeGenRegister(action, &node_tmp));
       func_args_ss << node_tmp->GetFingerprint() << "|";
     }
+    if (condition_) {
+      func_args_ss << "[filter]" << condition_->ToString() << "|";
+    }
     func_args_ss << "[output_schema]";
     for (auto field : result_schema_->fields()) {
       func_args_ss << field->type()->ToString() << "|";
     }
+    if (partial_) {
+      func_args_ss << "[partial]";
+    }
 
     //#ifdef DEBUG
     std::cout << "func_args_ss is " << func_args_ss.str() << std::endl;
     //#endif
 
-    std::stringstream signature_ss;
-    signature_ss << std::hex << std::hash<std::string>{}(func_args_ss.str());
-    std::string signature = signature_ss.str();
+    auto signature = GetSignature(func_args_ss.str());
     std::cout << "signature is " << signature << std::endl;
 
-    auto file_lock = FileSpinLock();
-    auto status = LoadLibrary(signature, ctx_, &hash_aggregater_);
-    if (!status.ok()) {
-      // process
-      auto codes = ProduceCodes();
-      // compile codes
-      RETURN_NOT_OK(CompileCodes(codes, signature));
-      RETURN_NOT_OK(LoadLibrary(signature, ctx_, &hash_aggregater_));
-    }
-    FileSpinUnLock(file_lock);
+    // compiled in background, the aggregater is made on first use
+    hash_aggregater_kernel_ =
+        LoadOrCompileLibraryAsync(signature, [this] { return ProduceCodes(); });
     return arrow::Status::OK();
   }
 
   virtual arrow::Status Evaluate(const ArrayList& in) {
-    if (projector_) {
-      auto length = in.size() > 0 ? in[0]->length() : 0;
-      arrow::ArrayVector outputs;
-      auto in_batch = arrow::RecordBatch::Make(original_input_schema_, length, in);
-      RETURN_NOT_OK(projector_->Evaluate(*in_batch, ctx_->memory_pool(), &outputs));
-      auto out_batch = arrow::RecordBatch::Make(projected_input_schema_, length, outputs);
-      RETURN_NOT_OK(hash_aggregater_->Evaluate(in, out_batch));
-    } else {
-      std::shared_ptr<arrow::RecordBatch> empty_batch;
-      RETURN_NOT_OK(hash_aggregater_->Evaluate(in, empty_batch));
+    if (filter_ != nullptr) {
+      // gandiva reads decoded columns
+      ArrayList decoded;
+      ArrayList selected;
+      RETURN_NOT_OK(DecodeDictionaries(ctx_, in, &decoded));
+      RETURN_NOT_OK(SelectArrays(decoded, &selected));
+      return EvaluateSelected(selected);
+    }
+    return EvaluateSelected(in);
+  }
+
+  virtual arrow::Status EvaluateWithSelection(
+      const ArrayList& in, const std::shared_ptr<arrow::Array>& selection) {
+    // the rows kept for a spill, or filtered by gandiva, are taken
+    if (filter_ != nullptr || splitter_ != nullptr ||
+        (GetAggregateMemoryBudget() > 0 && can_spill_)) {
+      ArrayList taken;
+      RETURN_NOT_OK(TakeArrays(ctx_, in, *selection, &taken));
+      return Evaluate(taken);
+    }
+    ArrayList decoded;
+    RETURN_NOT_OK(DecodeDictionaries(ctx_, in, &decoded));
+    auto length = decoded.empty() ? 0 : decoded[0]->length();
+    RETURN_NOT_OK(SelectionToMask(*selection, length, &selected_));
+    if (!partition_ctxs_.empty()) {
+      return AggregatePartitions(decoded, selected_.data());
+    }
+    RETURN_NOT_OK(MakeKernel(hash_aggregater_kernel_, ctx_, &hash_aggregater_));
+    return Aggregate(hash_aggregater_.get(), decoded, selected_.data());
+  }
+
+  // Aggregate the rows of encoded_in passing the filter, or all of them if there is none
+  arrow::Status EvaluateSelected(const ArrayList& encoded_in) {
+    // the spill files are read back with the decoded types of input_schema_
+    ArrayList in;
+    RETURN_NOT_OK(DecodeDictionaries(ctx_, encoded_in, &in));
+    if (splitter_ != nullptr) {
+      return SplitArrays(splitter_.get(), input_schema_, in);
+    }
+    if (!partition_ctxs_.empty()) {
+      return AggregatePartitions(in);
     }
+    RETURN_NOT_OK(MakeKernel(hash_aggregater_kernel_, ctx_, &hash_aggregater_));
+    RETURN_NOT_OK(Aggregate(hash_aggregater_.get(), in));
+
+    auto memory_budget = GetAggregateMemoryBudget();
+    if (memory_budget <= 0 || !can_spill_) {
+      return arrow::Status::OK();
+    }
+    input_arrays_.push_back(in);
+    input_bytes_ += ArrayListBytes(in);
+    input_rows_ += in.empty() ? 0 : in[0]->length();
+    if (input_bytes_ <= memory_budget && !spill_requested_) {
+      return arrow::Status::OK();
+    }
+    bool requested = spill_requested_.exchange(false);
+    // groups are taken as wide as the input rows
+    auto group_bytes = static_cast<int64_t>(hash_aggregater_->NumGroups()) *
+                       (input_bytes_ / std::max<int64_t>(input_rows_, 1));
+    Result<std::shared_ptr<Splitter>> splitter =
+        arrow::Status::Invalid("Aggregation keys can't be spilled");
+    if ((requested || group_bytes * 2 > memory_budget) && !key_indices_.empty()) {
+      splitter = MakeSpillSplitter(input_schema_, key_indices_, kSpillPartitions,
+                                   memory_budget);
+    }
+    if (!splitter.ok()) {
+      // few groups for their input, or keys the splitter can't hash, stay in memory
+      can_spill_ = false;
+      input_arrays_.clear();
+      return arrow::Status::OK();
+    }
+    // from now on the input is spilled by hash partition of the keys, each partition
+    // is aggregated on its own once the input is over. The groups so far are dropped.
+    splitter_ = splitter.ValueOrDie();
+    for (const auto& arrays : input_arrays_) {
+      RETURN_NOT_OK(SplitArrays(splitter_.get(), input_schema_, arrays));
+    }
+    input_arrays_.clear();
+    hash_aggregater_ = nullptr;
     return arrow::Status::OK();
   }
 
   virtual arrow::Status MakeResultIterator(
       std::shared_ptr<arrow::Schema> schema,
       std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+    if (spilled_) {
+      // the partition files are consumed by the first iterator
+      return arrow::Status::Invalid("A spilled aggregation can only be finished once");
+    }
+    if (splitter_ != nullptr) {
+      spilled_ = true;
+      RETURN_NOT_OK(StopSpillSplitter(splitter_.get(), &metrics_->spill_bytes));
+      *out = std::make_shared<SpilledAggregateResultIterator>(
+          this, schema, splitter_->GetPartitionFileInfo());
+      splitter_ = nullptr;
+      return arrow::Status::OK();
+    }
+    if (!partition_ctxs_.empty()) {
+      std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> partition_iters;
+      for (size_t p = 0; p < partition_ctxs_.size(); p++) {
+        RETURN_NOT_OK(MakePartitionAggregater(p));
+        std::shared_ptr<ResultIterator<arrow::RecordBatch>> iter;
+        RETURN_NOT_OK(partition_aggregaters_[p]->MakeResultIterator(schema, &iter));
+        partition_iters.push_back(iter);
+      }
+      *out = std::make_shared<ConcatResultIterator>(std::move(partition_iters));
+      return arrow::Status::OK();
+    }
+    input_arrays_.clear();
+    RETURN_NOT_OK(MakeKernel(hash_aggregater_kernel_, ctx_, &hash_aggregater_));
     RETURN_NOT_OK(hash_aggregater_->MakeResultIterator(schema, out));
     return arrow::Status::OK();
   }
@@ -125,18 +368,332 @@ class HashAggregateKernel::Impl {
     return arrow::Status::OK();
   }
 
+  // the groups of a spilled aggregation are counted as its partitions are aggregated
+  void UpdateMetrics(KernelMetrics* metrics) {
+    if (hash_aggregater_ != nullptr) {
+      metrics->hash_table_size = hash_aggregater_->NumGroups();
+    } else if (!partition_aggregaters_.empty()) {
+      metrics->hash_table_size = 0;
+      for (const auto& aggregater : partition_aggregaters_) {
+        if (aggregater != nullptr) {
+          metrics->hash_table_size += aggregater->NumGroups();
+        }
+      }
+    }
+  }
+
  protected:
+  using Splitter = sparkcolumnarplugin::shuffle::Splitter;
+  using ShuffleReader = sparkcolumnarplugin::shuffle::ShuffleReader;
+  template <typename T>
+  using Result = arrow::Result<T>;
+
+  /// Number of hash partitions of a spilled aggregation
+  static constexpr int32_t kSpillPartitions = 16;
+  /// A partial aggregation stops hashing its keys once its first GetBatchSize() rows
+  /// make more groups than this per ten rows
+  static constexpr int32_t kBypassGroupsPerTenRows = 9;
+
+  /// \brief Returns the groups of the partitions of a parallel aggregation one
+  /// partition after the other, a group being in a single partition
+  class ConcatResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    explicit ConcatResultIterator(
+        std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> iters)
+        : iters_(std::move(iters)) {}
+
+    std::string ToString() override { return "ConcatResultIterator"; }
+
+    bool HasNext() override {
+      while (next_ < iters_.size() && !iters_[next_]->HasNext()) {
+        next_++;
+      }
+      return next_ < iters_.size();
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      if (!HasNext()) {
+        return arrow::Status::Invalid("No more batches in parallel aggregation");
+      }
+      return iters_[next_]->Next(out);
+    }
+
+   private:
+    std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> iters_;
+    size_t next_ = 0;
+  };
+
+  /// \brief Aggregates the partitions of a spilled aggregation
+  ///
+  /// The partitions are aggregated one at a time once the input is over, each by an
+  /// aggregater of its own. As all the rows of a group are in the same partition, this
+  /// holds for any action. Partitions are aggregated whatever their size.
+  class SpilledAggregateResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    SpilledAggregateResultIterator(
+        Impl* kernel, std::shared_ptr<arrow::Schema> schema,
+        const std::vector<std::pair<int32_t, std::string>>& partition_files)
+        : ctx_(kernel->ctx_),
+          metrics_(kernel->metrics_),
+          aggregater_kernel_(kernel->hash_aggregater_kernel_),
+          projector_(kernel->projector_),
+          original_input_schema_(kernel->original_input_schema_),
+          projected_input_schema_(kernel->projected_input_schema_),
+          result_schema_(std::move(schema)) {
+      for (const auto& file : partition_files) {
+        partition_files_.push_back(file.second);
+      }
+    }
+
+    ~SpilledAggregateResultIterator() {
+      // files of the partitions not aggregated yet
+      for (const auto& file : partition_files_) {
+        std::remove(file.c_str());
+      }
+    }
+
+    std::string ToString() override { return "SpilledAggregateResultIterator"; }
+
+    bool HasNext() override {
+      if (next_ == nullptr && status_.ok()) {
+        status_ = AggregateNext();
+      }
+      return next_ != nullptr || !status_.ok();
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      if (!HasNext()) {
+        return arrow::Status::Invalid("No more batches in spilled aggregation");
+      }
+      RETURN_NOT_OK(status_);
+      *out = std::move(next_);
+      next_ = nullptr;
+      return arrow::Status::OK();
+    }
+
+   private:
+    // Read the next batch of groups into next_, aggregating the next partitions as the
+    // groups of the last one run out. Leave next_ null once all are aggregated.
+    arrow::Status AggregateNext() {
+      while (true) {
+        if (partition_iter_ != nullptr) {
+          while (partition_iter_->HasNext()) {
+            std::shared_ptr<arrow::RecordBatch> out;
+            RETURN_NOT_OK(partition_iter_->Next(&out));
+            if (out->num_rows() > 0) {
+              next_ = std::move(out);
+              return arrow::Status::OK();
+            }
+          }
+          partition_iter_ = nullptr;
+          aggregater_ = nullptr;
+        }
+        if (partition_files_.empty()) {
+          return arrow::Status::OK();
+        }
+        auto file = std::move(partition_files_.front());
+        partition_files_.pop_front();
+        ARROW_ASSIGN_OR_RAISE(auto reader, OpenSpillFile(file));
+        std::remove(file.c_str());
+        RETURN_NOT_OK(MakeKernel(aggregater_kernel_, ctx_, &aggregater_));
+        while (reader->HasNext()) {
+          std::shared_ptr<arrow::RecordBatch> batch;
+          RETURN_NOT_OK(reader->Next(&batch));
+          RETURN_NOT_OK(AggregateArrays(ctx_, projector_.get(), original_input_schema_,
+                                        projected_input_schema_, aggregater_.get(),
+                                        batch->columns()));
+        }
+        RETURN_NOT_OK(aggregater_->MakeResultIterator(result_schema_, &partition_iter_));
+        metrics_->hash_table_size += aggregater_->NumGroups();
+      }
+    }
+
+    arrow::compute::FunctionContext* ctx_;
+    std::shared_ptr<KernelMetrics> metrics_;
+    KernelFuture aggregater_kernel_;
+    std::shared_ptr<gandiva::Projector> projector_;
+    std::shared_ptr<arrow::Schema> original_input_schema_;
+    std::shared_ptr<arrow::Schema> projected_input_schema_;
+    std::shared_ptr<arrow::Schema> result_schema_;
+    std::deque<std::string> partition_files_;
+
+    // the partition being returned
+    std::shared_ptr<CodeGenBase> aggregater_;
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> partition_iter_;
+
+    std::shared_ptr<arrow::RecordBatch> next_;
+    arrow::Status status_;
+  };
+
+  // Aggregate in with aggregater, with the outputs of projector if there are projected
+  // actions. Only the rows i with selected[i] set are aggregated if selected isn't null.
+  static arrow::Status AggregateArrays(
+      arrow::compute::FunctionContext* ctx, gandiva::Projector* projector,
+      const std::shared_ptr<arrow::Schema>& original_input_schema,
+      const std::shared_ptr<arrow::Schema>& projected_input_schema,
+      CodeGenBase* aggregater, const ArrayList& in, const uint8_t* selected = nullptr) {
+    if (projector != nullptr) {
+      auto length = in.size() > 0 ? in[0]->length() : 0;
+      arrow::ArrayVector outputs;
+      auto in_batch = arrow::RecordBatch::Make(original_input_schema, length, in);
+      RETURN_NOT_OK(projector->Evaluate(*in_batch, ctx->memory_pool(), &outputs));
+      auto out_batch = arrow::RecordBatch::Make(projected_input_schema, length, outputs);
+      return aggregater->Evaluate(in, out_batch, selected);
+    }
+    std::shared_ptr<arrow::RecordBatch> empty_batch;
+    return aggregater->Evaluate(in, empty_batch, selected);
+  }
+
+  arrow::Status Aggregate(CodeGenBase* aggregater, const ArrayList& in,
+                          const uint8_t* selected = nullptr) {
+    return AggregateArrays(ctx_, projector_.get(), original_input_schema_,
+                           projected_input_schema_, aggregater, in, selected);
+  }
+
+  // made on the task thread, see MakeKernel
+  arrow::Status MakePartitionAggregater(size_t partition) {
+    partition_aggregaters_.resize(partition_ctxs_.size());
+    return MakeKernel(hash_aggregater_kernel_, partition_ctxs_[partition].get(),
+                      &partition_aggregaters_[partition]);
+  }
+
+  // Split the rows of in, those selected if selected isn't null, by hash partition of
+  // their keys, then aggregate each partition by an aggregater of its own on a thread
+  // of the task scheduler
+  arrow::Status AggregatePartitions(const ArrayList& in,
+                                    const uint8_t* selected = nullptr) {
+    auto num_partitions = partition_ctxs_.size();
+    ArrayList keys;
+    for (auto index : key_indices_) {
+      keys.push_back(in[index]);
+    }
+    HashKeyRows(keys, &hashes_);
+    std::vector<std::vector<int32_t>> partition_rows(num_partitions);
+    for (size_t i = 0; i < hashes_.size(); i++) {
+      if (selected == nullptr || selected[i]) {
+        partition_rows[hashes_[i] % num_partitions].push_back(static_cast<int32_t>(i));
+      }
+    }
+    for (size_t p = 0; p < num_partitions; p++) {
+      RETURN_NOT_OK(MakePartitionAggregater(p));
+    }
+
+    auto aggregate = [this, &in, &partition_rows](size_t p) -> arrow::Status {
+      if (partition_rows[p].empty()) {
+        return arrow::Status::OK();
+      }
+      auto ctx = partition_ctxs_[p].get();
+      arrow::Int32Builder indices_builder(ctx->memory_pool());
+      RETURN_NOT_OK(indices_builder.AppendValues(partition_rows[p].data(),
+                                                 partition_rows[p].size()));
+      std::shared_ptr<arrow::Array> indices;
+      RETURN_NOT_OK(indices_builder.Finish(&indices));
+      ArrayList partition_in;
+      for (const auto& array : in) {
+        std::shared_ptr<arrow::Array> taken;
+        RETURN_NOT_OK(arrow::compute::Take(ctx, *array, *indices,
+                                           arrow::compute::TakeOptions(), &taken));
+        partition_in.push_back(taken);
+      }
+      return AggregateArrays(ctx, projector_.get(), original_input_schema_,
+                             projected_input_schema_, partition_aggregaters_[p].get(),
+                             partition_in);
+    };
+    return TaskScheduler::Global()->ParallelFor(
+        num_partitions, static_cast<int>(num_partitions),
+        [&aggregate](int64_t p) { return aggregate(p); });
+  }
+
   std::vector<std::shared_ptr<arrow::Field>> input_field_list_;
+  std::shared_ptr<arrow::Schema> input_schema_;
   std::shared_ptr<arrow::Schema> original_input_schema_;
   std::shared_ptr<arrow::Schema> projected_input_schema_;
   std::vector<std::shared_ptr<gandiva::Node>> action_list_;
   std::shared_ptr<arrow::Schema> result_schema_;
+  // a partial aggregation may return a group more than once
+  const bool partial_;
+  KernelFuture hash_aggregater_kernel_;
   std::shared_ptr<CodeGenBase> hash_aggregater_;
   arrow::compute::FunctionContext* ctx_;
   std::vector<std::shared_ptr<arrow::Field>> field_list_;
   std::shared_ptr<gandiva::Projector> projector_;
+  // condition of the codegen_filter child, if any, fused into the aggregation loop as
+  // fused_condition_ or else evaluated by filter_ before it
+  gandiva::NodePtr condition_;
+  std::string fused_condition_;
+  std::shared_ptr<gandiva::Filter> filter_;
+  // projections of the action inputs computed in the aggregation loop, the others are
+  // projected by projector_
+  FusedProjectionCodeGen fused_projection_;
   std::vector<std::shared_ptr<ActionCodeGen>> action_impl_list_;
   std::vector<std::pair<std::shared_ptr<arrow::Field>, std::string>> key_list_;
+  // input indices of the group keys, empty if some key isn't an input field
+  std::vector<int32_t> key_indices_;
+  // input batches given to hash_aggregater_, kept while under the memory budget in case
+  // the aggregation spills
+  std::vector<ArrayList> input_arrays_;
+  int64_t input_bytes_ = 0;
+  int64_t input_rows_ = 0;
+  bool can_spill_ = true;
+  bool spilled_ = false;
+  // spills the input of an aggregation over the memory budget
+  std::shared_ptr<Splitter> splitter_;
+  TaskMemoryPool* task_pool_;
+  int64_t spiller_id_ = 0;
+  // set when the task asked for memory back
+  std::atomic<bool> spill_requested_{false};
+  // one per thread of a parallel aggregation, none otherwise
+  std::vector<std::unique_ptr<arrow::compute::FunctionContext>> partition_ctxs_;
+  std::vector<std::shared_ptr<CodeGenBase>> partition_aggregaters_;
+  std::vector<uint64_t> hashes_;
+  // rows of the last batch evaluated with a selection
+  std::vector<uint8_t> selected_;
+  // transient arrays of a batch
+  ArenaMemoryPool scratch_pool_;
+  // of the kernel, see KernalBase::metrics_
+  std::shared_ptr<KernelMetrics> metrics_;
+
+  /// The rows aggregated are those passing the condition of a codegen_filter child,
+  /// the filter of the stage before the aggregation
+  arrow::Status PrepareFilter() {
+    auto it = std::find_if(action_list_.begin(), action_list_.end(),
+                           [](const std::shared_ptr<gandiva::Node>& node) {
+                             auto func_node =
+                                 std::dynamic_pointer_cast<gandiva::FunctionNode>(node);
+                             return func_node && func_node->descriptor()->name() ==
+                                                     "codegen_filter";
+                           });
+    if (it == action_list_.end()) {
+      return arrow::Status::OK();
+    }
+    auto filter_node = std::dynamic_pointer_cast<gandiva::FunctionNode>(*it);
+    if (filter_node->children().size() != 1) {
+      return arrow::Status::Invalid("codegen_filter expects one argument");
+    }
+    condition_ = filter_node->children()[0];
+    action_list_.erase(it);
+    if (fused_projection_.CanFuse(condition_)) {
+      fused_condition_ = fused_projection_.Add(condition_);
+      return arrow::Status::OK();
+    }
+    auto configuration = gandiva::ConfigurationBuilder().DefaultConfiguration();
+    return MakeCachedFilter(input_schema_,
+                            gandiva::TreeExprBuilder::MakeCondition(condition_),
+                            configuration, &filter_);
+  }
+
+  // Take the rows of in passing filter_
+  arrow::Status SelectArrays(const ArrayList& in, ArrayList* out) {
+    auto length = in.size() > 0 ? in[0]->length() : 0;
+    auto in_batch = arrow::RecordBatch::Make(input_schema_, length, in);
+    // the selection of the last batch is freed
+    scratch_pool_.Reset();
+    std::shared_ptr<gandiva::SelectionVector> selection;
+    RETURN_NOT_OK(
+        gandiva::SelectionVector::MakeInt32(length, &scratch_pool_, &selection));
+    RETURN_NOT_OK(filter_->Evaluate(*in_batch, selection));
+    return TakeArrays(ctx_, in, *selection->ToArray(), out);
+  }
 
   arrow::Status PrepareActionCodegen() {
     std::vector<gandiva::ExpressionPtr> expr_list;
@@ -147,24 +704,29 @@ class HashAggregateKernel::Impl {
       RETURN_NOT_OK(MakeCodeGenNodeVisitor(func_node, input_field_list_, &action_codegen,
                                            &codegen_visitor));
       action_impl_list_.push_back(action_codegen);
-      if (action_codegen->IsPreProjected()) {
-        auto expr = action_codegen->GetProjectorExpr();
+      if (!action_codegen->IsPreProjected()) {
+        continue;
+      }
+      auto expr = action_codegen->GetProjectorExpr();
+      if (!action_codegen->IsGroupBy() && fused_projection_.CanFuse(expr->root())) {
+        action_codegen->FuseProjection(fused_projection_.Add(expr->root()));
+        continue;
+      }
+      // the same projection of several actions is projected once
+      auto name = expr->result()->name();
+      auto same_name = [&name](const gandiva::FieldPtr& f) { return f->name() == name; };
+      if (std::none_of(output_field_list.begin(), output_field_list.end(), same_name)) {
         output_field_list.push_back(expr->result());
         expr_list.push_back(expr);
       }
     }
     RETURN_NOT_OK(GetGroupKey(action_impl_list_, &key_list_));
-    if (key_list_.size() > 1) {
-      auto expr = GetConcatedKernel(key_list_);
-      output_field_list.push_back(expr->result());
-      expr_list.push_back(expr);
-    }
     if (!expr_list.empty()) {
       original_input_schema_ = arrow::schema(input_field_list_);
       projected_input_schema_ = arrow::schema(output_field_list);
       auto configuration = gandiva::ConfigurationBuilder().DefaultConfiguration();
-      RETURN_NOT_OK(gandiva::Projector::Make(original_input_schema_, expr_list,
-                                             configuration, &projector_));
+      RETURN_NOT_OK(MakeCachedProjector(original_input_schema_, expr_list, configuration,
+                                        &projector_));
     }
     return arrow::Status::OK();
   }
@@ -256,35 +818,167 @@ class HashAggregateKernel::Impl {
     auto result_cached_array_str = GetParameterList(result_cached_array_list, false);
 
     bool multiple_cols = (key_list_.size() > 1);
-    std::string concat_kernel;
+    auto key_type = key_list_[0].first->type();
+    std::string key_array_str = key_list_[0].second;
+    std::string make_key_normalizer_str;
+    std::string normalize_keys_str;
+    if (multiple_cols) {
+      // group by the normalized keys, see NormalizeKeysKernel
+      std::vector<std::shared_ptr<arrow::DataType>> key_type_list;
+      std::stringstream key_type_list_ss;
+      std::stringstream key_array_list_ss;
+      for (const auto& key : key_list_) {
+        key_type_list.push_back(key.first->type());
+        key_type_list_ss << "arrow::" << GetArrowTypeDefString(key.first->type()) << ", ";
+        key_array_list_ss << key.second << ", ";
+      }
+      key_type = NormalizeKeysKernel::NormalizedType(key_type_list);
+      make_key_normalizer_str = "NormalizeKeysKernel::Make(ctx_, {" +
+                                key_type_list_ss.str() + "}, &key_normalizer_);";
+      normalize_keys_str = "std::shared_ptr<arrow::Array> normalized_keys;\n"
+                           "RETURN_NOT_OK(key_normalizer_->Evaluate({" +
+                           key_array_list_ss.str() + "}, &normalized_keys));\n";
+      key_array_str = "normalized_keys";
+    }
     std::string hash_map_type_str = "typename arrow::internal::HashTraits<arrow::" +
-                                    GetTypeString(arrow::int32(), "Type") +
-                                    ">::MemoTableType";
-    ;
-    std::string evaluate_get_typed_key_array_str;
-    std::string evaluate_get_typed_key_method_str;
-    if (!multiple_cols) {
-      hash_map_type_str = "typename arrow::internal::HashTraits<arrow::" +
-                          GetTypeString(key_list_[0].first->type(), "Type") +
-                          ">::MemoTableType";
-      evaluate_get_typed_key_array_str =
-          "auto typed_array = std::dynamic_pointer_cast<arrow::" +
-          GetTypeString(key_list_[0].first->type(), "Array") + ">(" +
-          key_list_[0].second + ");";
-      if (key_list_[0].first->type()->id() != arrow::Type::STRING) {
-        evaluate_get_typed_key_method_str = "GetView";
-      } else {
-        evaluate_get_typed_key_method_str = "GetString";
+                                    GetTypeString(key_type, "Type") + ">::MemoTableType";
+    std::string evaluate_get_typed_key_array_str =
+        normalize_keys_str + "auto typed_array = std::dynamic_pointer_cast<arrow::" +
+        GetTypeString(key_type, "Array") + ">(" + key_array_str + ");";
+    std::string evaluate_get_typed_key_method_str = "GetView";
+    if (key_type->id() == arrow::Type::STRING || key_type->id() == arrow::Type::BINARY) {
+      evaluate_get_typed_key_method_str = "GetString";
+    }
+    // the rows not selected, or of a null or false condition, are skipped
+    std::string filter_str =
+        "\n      if (selected != nullptr && !selected[cur_id_]) {\n"
+        "        continue;\n"
+        "      }";
+    if (!fused_condition_.empty()) {
+      filter_str += "\n      if (" + fused_condition_ + ".IsNull(cur_id_) || !" +
+                    fused_condition_ + ".GetView(cur_id_)) {\n        continue;\n      }";
+    }
+    std::string bypass_str;
+    std::string sample_str;
+    std::string bypass_define_str;
+    if (partial_) {
+      // the groups of a partial aggregation are merged again by the final one, so once
+      // the keys look nearly all distinct each row is let through as a group of its own
+      bypass_str = R"(
+    if (bypass_) {
+      for (cur_id_ = 0; cur_id_ < typed_array->length(); cur_id_++) {)" + filter_str +
+                 R"(
+        if (!typed_array->IsNull(cur_id_)) {
+          insert_on_not_found(num_groups_);
+        }
       }
-    } else {
-      evaluate_get_typed_key_array_str =
-          "auto typed_array = "
-          "std::dynamic_pointer_cast<arrow::Int32Array>(projected_batch->GetColumnByName("
-          "\"projection_key\"));";
-      evaluate_get_typed_key_method_str = "GetView";
+      return arrow::Status::OK();
+    }
+)";
+      sample_str = R"(
+    if (sampled_rows_ < sample_rows_) {
+      sampled_rows_ += typed_array->length();
+      bypass_ = sampled_rows_ >= sample_rows_ &&
+                num_groups_ * 10 > sampled_rows_ * )" +
+                   std::to_string(kBypassGroupsPerTenRows) + R"(;
+      if (bypass_) {
+        hash_table_ = nullptr;
+      }
+    }
+)";
+      bypass_define_str = R"(
+  const uint64_t sample_rows_ = GetBatchSize();
+  uint64_t sampled_rows_ = 0;
+  bool bypass_ = false;)";
     }
+    std::string direct_str;
+    std::string direct_define_str;
+    if (!multiple_cols &&
+        (arrow::is_integer(key_type->id()) || key_type->id() == arrow::Type::DATE32)) {
+      // integer keys of a small range index their groups directly, see StartDirect
+      auto key_ctype_str = GetCTypeString(key_type);
+      direct_str = R"(
+    if (!direct_checked_) {
+      StartDirect(*typed_array);
+    }
+    if (direct_) {
+      for (; cur_id_ < typed_array->length(); cur_id_++) {)" + filter_str + R"(
+        if (typed_array->IsNull(cur_id_)) {
+          continue;
+        }
+        auto slot = static_cast<uint64_t>(typed_array->GetView(cur_id_)) - direct_min_;
+        if (slot >= kDirectSlots) {
+          // out of range, this key and the next ones are hashed
+          LeaveDirect();
+          break;
+        }
+        if (direct_groups_[slot] < 0) {
+          direct_groups_[slot] = num_groups_;
+          insert_on_not_found(num_groups_);
+        } else {
+          insert_on_found(direct_groups_[slot]);
+        }
+      }
+    }
+)";
+      direct_define_str = R"(
+  // group of each key from direct_min_ on, negative if none yet
+  static constexpr uint64_t kDirectSlots = 1 << 16;
+  bool direct_checked_ = false;
+  bool direct_ = false;
+  uint64_t direct_min_ = 0;
+  std::vector<int32_t> direct_groups_;
 
-    return BaseCodes() + R"(
+  // Index the groups by key if the keys of the first batch with a valid key span less
+  // than half of kDirectSlots, the other slots being shared around them. The keys are
+  // taken modulo 2^64, as the slot of any key.
+  void StartDirect(const arrow::)" +
+                          GetTypeString(key_type, "Array") + R"(& keys) {
+    if (keys.null_count() == keys.length()) {
+      return;
+    }
+    direct_checked_ = true;
+    bool found = false;
+    )" + key_ctype_str +
+                          R"( min = 0, max = 0;
+    for (int64_t i = 0; i < keys.length(); i++) {
+      if (keys.IsValid(i)) {
+        auto key = keys.GetView(i);
+        min = found && min < key ? min : key;
+        max = found && max > key ? max : key;
+        found = true;
+      }
+    }
+    auto range = static_cast<uint64_t>(max) - static_cast<uint64_t>(min);
+    if (range >= kDirectSlots / 2) {
+      return;
+    }
+    direct_min_ = static_cast<uint64_t>(min) - (kDirectSlots - range) / 2;
+    direct_groups_.assign(kDirectSlots, -1);
+    direct_ = true;
+  }
+
+  // Insert the keys of the groups so far into hash_table_, in the order of the groups
+  // so that their memo indices are the groups
+  void LeaveDirect() {
+    std::vector<)" + key_ctype_str +
+                          R"(> keys(num_groups_);
+    for (uint64_t slot = 0; slot < kDirectSlots; slot++) {
+      if (direct_groups_[slot] >= 0) {
+        keys[direct_groups_[slot]] = static_cast<)" +
+                          key_ctype_str + R"(>(direct_min_ + slot);
+      }
+    }
+    int memo_index = 0;
+    for (auto key : keys) {
+      hash_table_->GetOrInsert(key, [](int32_t) {}, [](int32_t) {}, &memo_index);
+    }
+    direct_ = false;
+    direct_groups_ = std::vector<int32_t>();
+  })";
+    }
+
+    return BaseCodes() + fused_projection_.GetDefineCodes() + R"(
 using HashMap = )" +
            hash_map_type_str + R"(;
 
@@ -292,11 +986,19 @@ class TypedGroupbyHashAggregateImpl : public CodeGenBase {
  public:
   TypedGroupbyHashAggregateImpl(arrow::compute::FunctionContext* ctx) : ctx_(ctx) {
     hash_table_ = std::make_shared<HashMap>(ctx_->memory_pool());
+    )" + make_key_normalizer_str +
+           R"(
   }
 
   arrow::Status Evaluate(const ArrayList& in, const std::shared_ptr<arrow::RecordBatch>& projected_batch) override {
+    return Evaluate(in, projected_batch, nullptr);
+  }
+
+  arrow::Status Evaluate(const ArrayList& in,
+                         const std::shared_ptr<arrow::RecordBatch>& projected_batch,
+                         const uint8_t* selected) override {
     )" + evaluate_get_typed_key_array_str +
-           evaluate_get_typed_array_str +
+           fused_projection_.GetPrepareCodes() + evaluate_get_typed_array_str +
            R"(
     auto insert_on_found = [this)" +
            typed_input_parameter_str + R"(](int32_t i) {
@@ -309,17 +1011,18 @@ class TypedGroupbyHashAggregateImpl : public CodeGenBase {
       )" + compute_on_new_str +
            R"(
     };
-
+)" + bypass_str + R"(
     cur_id_ = 0;
-    int memo_index = 0;
+    int memo_index = 0;)" + direct_str +
+           R"(
     if (typed_array->null_count() == 0) {
-      for (; cur_id_ < typed_array->length(); cur_id_++) {
+      for (; cur_id_ < typed_array->length(); cur_id_++) {)" + filter_str + R"(
         hash_table_->GetOrInsert(typed_array->)" +
            evaluate_get_typed_key_method_str + R"((cur_id_), insert_on_found,
                                  insert_on_not_found, &memo_index);
       }
     } else {
-      for (; cur_id_ < typed_array->length(); cur_id_++) {
+      for (; cur_id_ < typed_array->length(); cur_id_++) {)" + filter_str + R"(
         if (typed_array->IsNull(cur_id_)) {
           //hash_table_->GetOrInsertNull(insert_on_found, insert_on_not_found);
         } else {
@@ -330,9 +1033,13 @@ class TypedGroupbyHashAggregateImpl : public CodeGenBase {
         }
       }
     }
+)" + sample_str +
+           R"(
     return arrow::Status::OK();
   }
 
+  uint64_t NumGroups() override { return num_groups_; }
+
   arrow::Status MakeResultIterator(
       std::shared_ptr<arrow::Schema> schema,
       std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override {
@@ -348,11 +1055,13 @@ class TypedGroupbyHashAggregateImpl : public CodeGenBase {
 
  private:
   )" + impl_cached_define_str +
-           R"(
+           fused_projection_.GetMemberCodes() + R"(
   arrow::compute::FunctionContext* ctx_;
   uint64_t num_groups_ = 0;
   uint64_t cur_id_ = 0;
   std::shared_ptr<HashMap> hash_table_;
+  std::shared_ptr<KernalBase> key_normalizer_;)" +
+           bypass_define_str + direct_define_str + R"(
 
   class HashAggregationResultIterator : public ResultIterator<arrow::RecordBatch> {
    public:
@@ -376,9 +1085,7 @@ class TypedGroupbyHashAggregateImpl : public CodeGenBase {
     }
 
     arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) {
-      auto length = (total_length_ - offset_) > )" +
-           std::to_string(GetBatchSize()) + R"( ? )" + std::to_string(GetBatchSize()) +
-           R"( : (total_length_ - offset_);
+      auto length = std::min<uint64_t>(total_length_ - offset_, batch_sizer_.rows());
       uint64_t count = 0;
       while (count < length) {
         )" +
@@ -390,6 +1097,7 @@ class TypedGroupbyHashAggregateImpl : public CodeGenBase {
            R"(
       *out = arrow::RecordBatch::Make(result_schema_, length, {)" +
            result_cached_array_str + R"(});
+      batch_sizer_.Update(**out);
       return arrow::Status::OK();
     }
 
@@ -400,6 +1108,7 @@ class TypedGroupbyHashAggregateImpl : public CodeGenBase {
     uint64_t offset_ = 0;
     ArrayItemIndex* indices_begin_;
     const uint64_t total_length_;
+    BatchSizer batch_sizer_;
     std::shared_ptr<arrow::Schema> result_schema_;
     arrow::compute::FunctionContext* ctx_;
   };
@@ -447,45 +1156,16 @@ extern "C" void MakeCodeGen(arrow::compute::FunctionContext* ctx,
       return ", " + ret;
     }
   }
-
-  gandiva::ExpressionPtr GetConcatedKernel(
-      std::vector<std::pair<std::shared_ptr<arrow::Field>, std::string>> key_list) {
-    int index = 0;
-    std::vector<std::shared_ptr<gandiva::Node>> func_node_list = {};
-    std::vector<std::shared_ptr<arrow::Field>> field_list = {};
-    for (auto type_name_pair : key_list) {
-      auto type = type_name_pair.first->type();
-      auto name = type_name_pair.first->name();
-      auto field = arrow::field(name, type);
-      field_list.push_back(field);
-      auto field_node = gandiva::TreeExprBuilder::MakeField(field);
-      auto func_node =
-          gandiva::TreeExprBuilder::MakeFunction("hash32", {field_node}, arrow::int32());
-      func_node_list.push_back(func_node);
-      if (func_node_list.size() == 2) {
-        auto shift_func_node = gandiva::TreeExprBuilder::MakeFunction(
-            "multiply",
-            {func_node_list[0], gandiva::TreeExprBuilder::MakeLiteral((int32_t)10)},
-            arrow::int32());
-        auto tmp_func_node = gandiva::TreeExprBuilder::MakeFunction(
-            "add", {shift_func_node, func_node_list[1]}, arrow::int32());
-        func_node_list.clear();
-        func_node_list.push_back(tmp_func_node);
-      }
-      index++;
-    }
-    return gandiva::TreeExprBuilder::MakeExpression(
-        func_node_list[0], arrow::field("projection_key", arrow::int32()));
-  }
 };
 
 arrow::Status HashAggregateKernel::Make(
     arrow::compute::FunctionContext* ctx,
     std::vector<std::shared_ptr<arrow::Field>> input_field_list,
     std::vector<std::shared_ptr<gandiva::Node>> action_list,
-    std::shared_ptr<arrow::Schema> result_schema, std::shared_ptr<KernalBase>* out) {
+    std::shared_ptr<arrow::Schema> result_schema, std::shared_ptr<KernalBase>* out,
+    bool partial) {
   *out = std::make_shared<HashAggregateKernel>(ctx, input_field_list, action_list,
-                                               result_schema);
+                                               result_schema, partial);
   return arrow::Status::OK();
 }
 
@@ -493,8 +1173,9 @@ HashAggregateKernel::HashAggregateKernel(
     arrow::compute::FunctionContext* ctx,
     std::vector<std::shared_ptr<arrow::Field>> input_field_list,
     std::vector<std::shared_ptr<gandiva::Node>> action_list,
-    std::shared_ptr<arrow::Schema> result_schema) {
-  impl_.reset(new Impl(ctx, input_field_list, action_list, result_schema));
+    std::shared_ptr<arrow::Schema> result_schema, bool partial) {
+  impl_.reset(
+      new Impl(ctx, input_field_list, action_list, result_schema, partial, metrics_));
   kernel_name_ = "HashAggregateKernelKernel";
 }
 #undef PROCESS_SUPPORTED_TYPES
@@ -503,12 +1184,23 @@ arrow::Status HashAggregateKernel::Evaluate(const ArrayList& in) {
   return impl_->Evaluate(in);
 }
 
+arrow::Status HashAggregateKernel::EvaluateWithSelection(
+    const ArrayList& in, const std::shared_ptr<arrow::Array>& selection) {
+  return impl_->EvaluateWithSelection(in, selection);
+}
+
 arrow::Status HashAggregateKernel::MakeResultIterator(
     std::shared_ptr<arrow::Schema> schema,
     std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
   return impl_->MakeResultIterator(schema, out);
 }
 
+KernelMetrics HashAggregateKernel::GetMetrics() {
+  auto metrics = KernalBase::GetMetrics();
+  impl_->UpdateMetrics(&metrics);
+  return metrics;
+}
+
 }  // namespace extra
 }  // namespace arrowcompute
 }  // namespace codegen
@@ -0,0 +1,631 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/buffer.h>
+#include <arrow/compute/context.h>
+#include <arrow/compute/kernels/take.h>
+#include <arrow/record_batch.h>
+#include <arrow/type.h>
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "codegen/arrow_compute/ext/codegen_common.h"
+#include "codegen/arrow_compute/ext/kernels_ext.h"
+#include "codegen/arrow_compute/ext/memo_table_instances.h"
+#include "codegen/arrow_compute/ext/spill.h"
+#include "utils/macros.h"
+#include "utils/task_memory_pool.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+using ArrayList = std::vector<std::shared_ptr<arrow::Array>>;
+
+namespace {
+
+// Take the rows of in at indices
+arrow::Status TakeRows(arrow::compute::FunctionContext* ctx, const ArrayList& in,
+                       std::vector<int32_t>* indices, ArrayList* out) {
+  auto length = static_cast<int64_t>(indices->size());
+  arrow::Int32Array index_array(length, arrow::Buffer::Wrap(*indices));
+  for (const auto& array : in) {
+    std::shared_ptr<arrow::Array> taken;
+    RETURN_NOT_OK(arrow::compute::Take(ctx, *array, index_array,
+                                       arrow::compute::TakeOptions(), &taken));
+    out->push_back(std::move(taken));
+  }
+  return arrow::Status::OK();
+}
+
+template <typename MemoTable, typename ArrayType>
+arrow::Status LookupKeys(MemoTable* table, const ArrayType& keys, bool insert,
+                         int32_t* ids) {
+  for (int64_t i = 0; i < keys.length(); i++) {
+    if (insert) {
+      RETURN_NOT_OK(table->GetOrInsert(keys.GetView(i), &ids[i]));
+    } else {
+      ids[i] = table->Get(keys.GetView(i));
+    }
+  }
+  return arrow::Status::OK();
+}
+
+/// \brief The distinct rows of the inputs of a set operation
+///
+/// Rows are told apart by their normalized keys, see NormalizeKeysKernel, held by the
+/// memo table of the hash aggregations. Nulls are equal, as for the DISTINCT, INTERSECT
+/// and EXCEPT of Spark.
+class DistinctRows {
+ public:
+  DistinctRows(arrow::compute::FunctionContext* ctx,
+               const std::vector<std::shared_ptr<arrow::DataType>>& types)
+      : ctx_(ctx), normalizer_(ctx, types) {
+    if (NormalizeKeysKernel::NormalizedType(types)->id() == arrow::Type::INT64) {
+      words_.reset(new arrow::internal::ScalarMemoTable<int64_t>(ctx->memory_pool()));
+    } else {
+      strings_.reset(new arrow::internal::BinaryMemoTable<arrow::BinaryBuilder>(
+          ctx->memory_pool()));
+    }
+  }
+
+  int32_t size() const { return words_ != nullptr ? words_->size() : strings_->size(); }
+
+  /// Insert the rows of in, the first row of each new key is appended to out
+  arrow::Status Insert(const ArrayList& in, ArrayList* out) {
+    auto first = size();
+    RETURN_NOT_OK(Lookup(in, true));
+    // new keys get the next ids in the order of their first rows
+    std::vector<int32_t> rows;
+    for (int32_t i = 0; i < static_cast<int32_t>(ids_.size()); i++) {
+      if (ids_[i] == first + static_cast<int32_t>(rows.size())) {
+        rows.push_back(i);
+      }
+    }
+    return TakeRows(ctx_, in, &rows, out);
+  }
+
+  /// Append to out the rows of in kept by op against the rows inserted before the
+  /// first Probe, once per key over all the calls
+  arrow::Status Probe(HashSetKernel::SetOp op, const ArrayList& in, ArrayList* out) {
+    if (num_inserted_ < 0) {
+      num_inserted_ = size();
+      emitted_.assign(num_inserted_, 0);
+    }
+    std::vector<int32_t> rows;
+    if (op == HashSetKernel::kIntersect) {
+      RETURN_NOT_OK(Lookup(in, false));
+      for (int32_t i = 0; i < static_cast<int32_t>(ids_.size()); i++) {
+        auto id = ids_[i];
+        if (id != arrow::internal::kKeyNotFound && !emitted_[id]) {
+          emitted_[id] = 1;
+          rows.push_back(i);
+        }
+      }
+    } else {
+      // the keys not inserted go into the set too, so that each is kept once
+      auto first = size();
+      RETURN_NOT_OK(Lookup(in, true));
+      for (int32_t i = 0; i < static_cast<int32_t>(ids_.size()); i++) {
+        if (ids_[i] == first + static_cast<int32_t>(rows.size())) {
+          rows.push_back(i);
+        }
+      }
+    }
+    return TakeRows(ctx_, in, &rows, out);
+  }
+
+ private:
+  // Look up the keys of the rows of in into ids_, inserting the new ones if insert
+  arrow::Status Lookup(const ArrayList& in, bool insert) {
+    std::shared_ptr<arrow::Array> keys;
+    RETURN_NOT_OK(normalizer_.Evaluate(in, &keys));
+    ids_.resize(keys->length());
+    if (words_ != nullptr) {
+      return LookupKeys(words_.get(), static_cast<const arrow::Int64Array&>(*keys),
+                        insert, ids_.data());
+    }
+    return LookupKeys(strings_.get(), static_cast<const arrow::BinaryArray&>(*keys),
+                      insert, ids_.data());
+  }
+
+  arrow::compute::FunctionContext* ctx_;
+  NormalizeKeysKernel normalizer_;
+  // by the type of the normalized keys
+  std::unique_ptr<arrow::internal::ScalarMemoTable<int64_t>> words_;
+  std::unique_ptr<arrow::internal::BinaryMemoTable<arrow::BinaryBuilder>> strings_;
+  std::vector<int32_t> ids_;
+  // the keys inserted before the first Probe, and those of them already probed
+  int32_t num_inserted_ = -1;
+  std::vector<uint8_t> emitted_;
+};
+
+std::vector<std::shared_ptr<arrow::DataType>> FieldTypes(
+    const std::vector<std::shared_ptr<arrow::Field>>& field_list) {
+  std::vector<std::shared_ptr<arrow::DataType>> types;
+  for (const auto& field : field_list) {
+    types.push_back(field->type());
+  }
+  return types;
+}
+
+std::shared_ptr<arrow::RecordBatch> MakeBatch(
+    const std::shared_ptr<arrow::Schema>& schema, ArrayList arrays) {
+  auto length = arrays.empty() ? 0 : arrays[0]->length();
+  return arrow::RecordBatch::Make(schema, length, std::move(arrays));
+}
+
+}  // namespace
+
+///////////////  HashSet  ////////////////
+class HashSetKernel::Impl {
+ public:
+  Impl(arrow::compute::FunctionContext* ctx, SetOp op,
+       const std::vector<std::shared_ptr<arrow::Field>>& build_field_list,
+       const std::vector<std::shared_ptr<arrow::Field>>& probe_field_list,
+       std::shared_ptr<KernelMetrics> metrics)
+      : ctx_(ctx),
+        op_(op),
+        build_schema_(arrow::schema(build_field_list)),
+        probe_schema_(arrow::schema(probe_field_list)),
+        types_(FieldTypes(build_field_list)),
+        metrics_(std::move(metrics)) {
+    if (op_ != kDistinct) {
+      auto probe_types = FieldTypes(probe_field_list);
+      bool same_types = probe_types.size() == types_.size();
+      for (size_t i = 0; same_types && i < types_.size(); i++) {
+        same_types = probe_types[i]->Equals(*types_[i]);
+      }
+      if (!same_types) {
+        THROW_NOT_OK(arrow::Status::Invalid(
+            "Set operation of inputs of different column types: ",
+            build_schema_->ToString(), " and ", probe_schema_->ToString()));
+      }
+    }
+    for (int32_t i = 0; i < static_cast<int32_t>(types_.size()); i++) {
+      key_indices_.push_back(i);
+    }
+    rows_.reset(new DistinctRows(ctx_, types_));
+    // a task short of memory has the set spill at its next batch, as an aggregation
+    task_pool_ = dynamic_cast<TaskMemoryPool*>(ctx_->memory_pool());
+    if (task_pool_ != nullptr && GetAggregateMemoryBudget() > 0) {
+      spiller_id_ = task_pool_->AddSpiller([this](int64_t bytes) {
+        spill_requested_ = true;
+        return int64_t(0);
+      });
+    } else {
+      task_pool_ = nullptr;
+    }
+  }
+
+  ~Impl() {
+    if (task_pool_ != nullptr) {
+      task_pool_->RemoveSpiller(spiller_id_);
+    }
+  }
+
+  arrow::Status Evaluate(const ArrayList& encoded_in) {
+    // the spill files are read back with the decoded types of build_schema_
+    ArrayList in;
+    RETURN_NOT_OK(DecodeDictionaries(ctx_, encoded_in, &in));
+    if (splitter_ != nullptr) {
+      return SplitArrays(splitter_.get(), build_schema_, in);
+    }
+    ArrayList distinct;
+    RETURN_NOT_OK(rows_->Insert(in, &distinct));
+    if (distinct.empty() || distinct[0]->length() == 0) {
+      return arrow::Status::OK();
+    }
+    distinct_bytes_ += ArrayListBytes(distinct);
+    distinct_arrays_.push_back(std::move(distinct));
+
+    auto memory_budget = GetAggregateMemoryBudget();
+    if (memory_budget <= 0 || !can_spill_ ||
+        (distinct_bytes_ <= memory_budget && !spill_requested_)) {
+      return arrow::Status::OK();
+    }
+    spill_requested_ = false;
+    auto splitter =
+        MakeSpillSplitter(build_schema_, key_indices_, kSpillPartitions, memory_budget);
+    if (!splitter.ok()) {
+      // rows the splitter can't hash stay in memory
+      can_spill_ = false;
+      return arrow::Status::OK();
+    }
+    // from now on the rows are spilled by hash partition, each partition is made
+    // distinct on its own once the input is over. The distinct rows so far are spilled
+    // and their keys dropped.
+    splitter_ = splitter.ValueOrDie();
+    for (const auto& arrays : distinct_arrays_) {
+      RETURN_NOT_OK(SplitArrays(splitter_.get(), build_schema_, arrays));
+    }
+    distinct_arrays_.clear();
+    rows_ = nullptr;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+    if (finished_) {
+      return arrow::Status::Invalid("A set operation can only be finished once");
+    }
+    finished_ = true;
+    std::vector<std::pair<int32_t, std::string>> build_files;
+    if (splitter_ != nullptr) {
+      RETURN_NOT_OK(StopSpillSplitter(splitter_.get(), &metrics_->spill_bytes));
+      build_files = splitter_->GetPartitionFileInfo();
+      splitter_ = nullptr;
+    }
+    if (op_ == kDistinct) {
+      // only the distinct rows are returned, the keys are dropped
+      if (rows_ != nullptr) {
+        metrics_->hash_table_size = rows_->size();
+        rows_ = nullptr;
+      }
+      *out = std::make_shared<DistinctResultIterator>(
+          this, std::move(schema), std::move(distinct_arrays_), build_files);
+      return arrow::Status::OK();
+    }
+    // the build side is probed by its keys
+    distinct_arrays_.clear();
+    std::shared_ptr<Splitter> probe_splitter;
+    if (!build_files.empty()) {
+      // the probe side is spilled by the same hash partitions
+      ARROW_ASSIGN_OR_RAISE(probe_splitter,
+                            MakeSpillSplitter(probe_schema_, key_indices_,
+                                              kSpillPartitions,
+                                              GetAggregateMemoryBudget()));
+    }
+    *out = std::make_shared<ProbeResultIterator>(this, std::move(schema),
+                                                 std::move(rows_), build_files,
+                                                 std::move(probe_splitter));
+    return arrow::Status::OK();
+  }
+
+  void UpdateMetrics(KernelMetrics* metrics) {
+    if (rows_ != nullptr) {
+      metrics->hash_table_size = rows_->size();
+    }
+  }
+
+ private:
+  using Splitter = sparkcolumnarplugin::shuffle::Splitter;
+
+  /// Number of hash partitions of a spilled set operation
+  static constexpr int32_t kSpillPartitions = 16;
+
+  // Read the rows of a spill file of the build side into a set of its own
+  static arrow::Status LoadPartition(
+      arrow::compute::FunctionContext* ctx,
+      const std::vector<std::shared_ptr<arrow::DataType>>& types,
+      const std::string& file, std::unique_ptr<DistinctRows>* rows,
+      std::deque<ArrayList>* distinct) {
+    rows->reset(new DistinctRows(ctx, types));
+    ARROW_ASSIGN_OR_RAISE(auto reader, OpenSpillFile(file));
+    std::remove(file.c_str());
+    while (reader->HasNext()) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      RETURN_NOT_OK(reader->Next(&batch));
+      ArrayList arrays;
+      RETURN_NOT_OK((*rows)->Insert(batch->columns(), &arrays));
+      if (distinct != nullptr && arrays[0]->length() > 0) {
+        distinct->push_back(std::move(arrays));
+      }
+    }
+    return arrow::Status::OK();
+  }
+
+  /// \brief Returns the distinct rows of a DISTINCT
+  ///
+  /// The rows kept in memory first, then those of each spilled partition, made distinct
+  /// one partition at a time. As equal rows hash alike, a row is in a single partition.
+  class DistinctResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    DistinctResultIterator(Impl* kernel, std::shared_ptr<arrow::Schema> schema,
+                           std::vector<ArrayList> distinct_arrays,
+                           const std::vector<std::pair<int32_t, std::string>>& files)
+        : ctx_(kernel->ctx_),
+          types_(kernel->types_),
+          metrics_(kernel->metrics_),
+          schema_(std::move(schema)),
+          distinct_(distinct_arrays.begin(), distinct_arrays.end()) {
+      for (const auto& file : files) {
+        files_.push_back(file.second);
+      }
+    }
+
+    ~DistinctResultIterator() {
+      // files of the partitions not read yet
+      for (const auto& file : files_) {
+        std::remove(file.c_str());
+      }
+    }
+
+    std::string ToString() override { return "DistinctResultIterator"; }
+
+    bool HasNext() override {
+      while (distinct_.empty() && !files_.empty() && status_.ok()) {
+        auto file = std::move(files_.front());
+        files_.pop_front();
+        std::unique_ptr<DistinctRows> rows;
+        status_ = LoadPartition(ctx_, types_, file, &rows, &distinct_);
+        metrics_->hash_table_size += rows->size();
+      }
+      return !distinct_.empty() || !status_.ok();
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      if (!HasNext()) {
+        return arrow::Status::Invalid("No more batches in distinct");
+      }
+      RETURN_NOT_OK(status_);
+      *out = MakeBatch(schema_, std::move(distinct_.front()));
+      distinct_.pop_front();
+      return arrow::Status::OK();
+    }
+
+   private:
+    arrow::compute::FunctionContext* ctx_;
+    std::vector<std::shared_ptr<arrow::DataType>> types_;
+    std::shared_ptr<KernelMetrics> metrics_;
+    std::shared_ptr<arrow::Schema> schema_;
+    std::deque<ArrayList> distinct_;
+    std::deque<std::string> files_;
+    arrow::Status status_;
+  };
+
+  /// \brief Probes the build side of an INTERSECT or EXCEPT
+  ///
+  /// Process returns the rows of each probe batch kept by the set operation. Once the
+  /// build side spilled, Process spills the probe batches by the same hash partitions
+  /// and returns empty batches instead. Once the probe side is over, HasNext and Next
+  /// probe the partitions of both sides one at a time.
+  class ProbeResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    ProbeResultIterator(Impl* kernel, std::shared_ptr<arrow::Schema> schema,
+                        std::unique_ptr<DistinctRows> rows,
+                        const std::vector<std::pair<int32_t, std::string>>& build_files,
+                        std::shared_ptr<Splitter> probe_splitter)
+        : ctx_(kernel->ctx_),
+          op_(kernel->op_),
+          types_(kernel->types_),
+          probe_schema_(kernel->probe_schema_),
+          metrics_(kernel->metrics_),
+          schema_(std::move(schema)),
+          rows_(std::move(rows)),
+          build_files_(build_files),
+          probe_splitter_(std::move(probe_splitter)) {}
+
+    ~ProbeResultIterator() {
+      // files of the partitions not probed yet
+      for (const auto& file : build_files_) {
+        std::remove(file.second.c_str());
+      }
+      for (const auto& partition : partitions_) {
+        std::remove(partition.second.build_file.c_str());
+        std::remove(partition.second.probe_file.c_str());
+      }
+    }
+
+    std::string ToString() override { return "HashSetProbeResultIterator"; }
+
+    arrow::Status Process(const ArrayList& encoded_in,
+                          std::shared_ptr<arrow::RecordBatch>* out,
+                          const std::shared_ptr<arrow::Array>& selection) override {
+      if (probe_done_) {
+        return arrow::Status::Invalid("Set operation probe side is over");
+      }
+      ArrayList in;
+      RETURN_NOT_OK(DecodeDictionaries(ctx_, encoded_in, &in));
+      if (selection != nullptr) {
+        ArrayList taken;
+        std::vector<int32_t> rows;
+        RETURN_NOT_OK(SelectionRows(*selection, &rows));
+        RETURN_NOT_OK(TakeRows(ctx_, in, &rows, &taken));
+        in = std::move(taken);
+      }
+      ArrayList kept;
+      if (probe_splitter_ != nullptr) {
+        // the rows are probed once the probe side is over, see HasNext
+        RETURN_NOT_OK(SplitArrays(probe_splitter_.get(), probe_schema_, in));
+        std::vector<int32_t> none;
+        RETURN_NOT_OK(TakeRows(ctx_, in, &none, &kept));
+      } else {
+        RETURN_NOT_OK(rows_->Probe(op_, in, &kept));
+      }
+      *out = MakeBatch(schema_, std::move(kept));
+      return arrow::Status::OK();
+    }
+
+    bool HasNext() override {
+      if (probe_splitter_ == nullptr && partitions_.empty() && build_files_.empty()) {
+        // not spilled, everything was returned by Process
+        return false;
+      }
+      if (next_ == nullptr && status_.ok()) {
+        status_ = ProbeNext();
+      }
+      return next_ != nullptr || !status_.ok();
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      if (!HasNext()) {
+        return arrow::Status::Invalid("No more batches in set operation");
+      }
+      RETURN_NOT_OK(status_);
+      *out = std::move(next_);
+      next_ = nullptr;
+      return arrow::Status::OK();
+    }
+
+   private:
+    struct Partition {
+      std::string build_file;
+      std::string probe_file;
+    };
+
+    static arrow::Status SelectionRows(const arrow::Array& selection,
+                                       std::vector<int32_t>* rows) {
+      switch (selection.type_id()) {
+        case arrow::Type::UINT16: {
+          const auto& indices = static_cast<const arrow::UInt16Array&>(selection);
+          for (int64_t i = 0; i < indices.length(); i++) {
+            rows->push_back(indices.Value(i));
+          }
+        } break;
+        case arrow::Type::INT32: {
+          const auto& indices = static_cast<const arrow::Int32Array&>(selection);
+          rows->assign(indices.raw_values(), indices.raw_values() + indices.length());
+        } break;
+        default:
+          return arrow::Status::NotImplemented("Selection of ",
+                                               selection.type()->ToString(), " indices");
+      }
+      return arrow::Status::OK();
+    }
+
+    // Read the kept rows of the partition being probed into next_, moving to the next
+    // partitions as they run out. Leave next_ null once all are probed.
+    arrow::Status ProbeNext() {
+      if (!probe_done_) {
+        probe_done_ = true;
+        RETURN_NOT_OK(StopSpillSplitter(probe_splitter_.get(), &metrics_->spill_bytes));
+        for (const auto& file : build_files_) {
+          partitions_[file.first].build_file = file.second;
+        }
+        build_files_.clear();
+        for (const auto& file : probe_splitter_->GetPartitionFileInfo()) {
+          partitions_[file.first].probe_file = file.second;
+        }
+      }
+      while (true) {
+        while (probe_reader_ != nullptr && probe_reader_->HasNext()) {
+          std::shared_ptr<arrow::RecordBatch> batch;
+          RETURN_NOT_OK(probe_reader_->Next(&batch));
+          ArrayList kept;
+          RETURN_NOT_OK(rows_->Probe(op_, batch->columns(), &kept));
+          if (kept[0]->length() > 0) {
+            next_ = MakeBatch(schema_, std::move(kept));
+            return arrow::Status::OK();
+          }
+        }
+        probe_reader_ = nullptr;
+        rows_ = nullptr;
+        if (partitions_.empty()) {
+          return arrow::Status::OK();
+        }
+        auto partition = std::move(partitions_.begin()->second);
+        partitions_.erase(partitions_.begin());
+        if (partition.probe_file.empty()) {
+          // no probe row kept
+          std::remove(partition.build_file.c_str());
+          continue;
+        }
+        if (partition.build_file.empty()) {
+          rows_.reset(new DistinctRows(ctx_, types_));
+        } else {
+          RETURN_NOT_OK(
+              LoadPartition(ctx_, types_, partition.build_file, &rows_, nullptr));
+        }
+        metrics_->hash_table_size += rows_->size();
+        ARROW_ASSIGN_OR_RAISE(probe_reader_, OpenSpillFile(partition.probe_file));
+        std::remove(partition.probe_file.c_str());
+      }
+    }
+
+    arrow::compute::FunctionContext* ctx_;
+    SetOp op_;
+    std::vector<std::shared_ptr<arrow::DataType>> types_;
+    std::shared_ptr<arrow::Schema> probe_schema_;
+    std::shared_ptr<KernelMetrics> metrics_;
+    std::shared_ptr<arrow::Schema> schema_;
+    // the build side, of the partition being probed once spilled
+    std::unique_ptr<DistinctRows> rows_;
+    std::vector<std::pair<int32_t, std::string>> build_files_;
+    std::shared_ptr<Splitter> probe_splitter_;
+
+    bool probe_done_ = false;
+    std::map<int32_t, Partition> partitions_;
+    std::shared_ptr<sparkcolumnarplugin::shuffle::ShuffleReader> probe_reader_;
+    std::shared_ptr<arrow::RecordBatch> next_;
+    arrow::Status status_;
+  };
+
+  arrow::compute::FunctionContext* ctx_;
+  SetOp op_;
+  std::shared_ptr<arrow::Schema> build_schema_;
+  std::shared_ptr<arrow::Schema> probe_schema_;
+  std::vector<std::shared_ptr<arrow::DataType>> types_;
+  std::vector<int32_t> key_indices_;
+  std::shared_ptr<KernelMetrics> metrics_;
+
+  std::unique_ptr<DistinctRows> rows_;
+  // the first rows of the keys inserted while in memory
+  std::vector<ArrayList> distinct_arrays_;
+  int64_t distinct_bytes_ = 0;
+  bool can_spill_ = true;
+  std::shared_ptr<Splitter> splitter_;
+  bool finished_ = false;
+
+  TaskMemoryPool* task_pool_ = nullptr;
+  int64_t spiller_id_ = 0;
+  std::atomic<bool> spill_requested_ = {false};
+};
+
+arrow::Status HashSetKernel::Make(
+    arrow::compute::FunctionContext* ctx, SetOp op,
+    const std::vector<std::shared_ptr<arrow::Field>>& build_field_list,
+    const std::vector<std::shared_ptr<arrow::Field>>& probe_field_list,
+    std::shared_ptr<KernalBase>* out) {
+  *out = std::make_shared<HashSetKernel>(ctx, op, build_field_list, probe_field_list);
+  return arrow::Status::OK();
+}
+
+HashSetKernel::HashSetKernel(
+    arrow::compute::FunctionContext* ctx, SetOp op,
+    const std::vector<std::shared_ptr<arrow::Field>>& build_field_list,
+    const std::vector<std::shared_ptr<arrow::Field>>& probe_field_list) {
+  impl_.reset(new Impl(ctx, op, build_field_list, probe_field_list, metrics_));
+  kernel_name_ = "HashSetKernel";
+}
+
+arrow::Status HashSetKernel::Evaluate(const ArrayList& in) { return impl_->Evaluate(in); }
+
+arrow::Status HashSetKernel::MakeResultIterator(
+    std::shared_ptr<arrow::Schema> schema,
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+  return impl_->MakeResultIterator(schema, out);
+}
+
+KernelMetrics HashSetKernel::GetMetrics() {
+  auto metrics = KernalBase::GetMetrics();
+  impl_->UpdateMetrics(&metrics);
+  return metrics;
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,778 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <arrow/array.h>
+#include <arrow/memory_pool.h>
+#include <arrow/util/string_view.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "utils/column_hash.h"
+#include "utils/large_page_memory_pool.h"
+#include "utils/task_scheduler.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// \brief How the slots of a JoinHashTable hold their keys: by value
+template <typename Key>
+class JoinKeyStore {
+ public:
+  using SlotKey = Key;
+  /// The type keys are looked up by
+  using View = const Key&;
+
+  SlotKey Add(View key) { return key; }
+  bool Equals(const SlotKey& slot_key, View key) const { return slot_key == key; }
+  View Get(const SlotKey& slot_key) const { return slot_key; }
+
+  // the side storage of the keys, which slots filled through another store reference
+  // once moved to [base, base + other.size()) of this one
+  int64_t size() const { return 0; }
+  void Resize(int64_t size) {}
+  void CopyFrom(const JoinKeyStore& other, int64_t base) {}
+  static void Rebase(SlotKey* slot_key, int64_t base) {}
+};
+
+/// \brief String keys held in one contiguous arena instead of an allocation each
+///
+/// A slot holds the length and the first kPrefixSize bytes of its key next to its
+/// offset in the arena, so that a probe compares the length and the prefix before
+/// touching the arena, and keys no longer than the prefix don't touch it at all and
+/// aren't copied to it.
+template <>
+class JoinKeyStore<std::string> {
+ public:
+  static constexpr size_t kPrefixSize = 8;
+
+  // 4 byte aligned so that with the hash and the key id a slot packs into 32 bytes
+  struct SlotKey {
+    char prefix[kPrefixSize];
+    uint32_t length;
+    uint32_t offset_low;
+    uint32_t offset_high;
+
+    int64_t offset() const {
+      return static_cast<int64_t>(offset_high) << 32 | offset_low;
+    }
+    void set_offset(int64_t offset) {
+      offset_low = static_cast<uint32_t>(offset);
+      offset_high = static_cast<uint32_t>(offset >> 32);
+    }
+  };
+  using View = arrow::util::string_view;
+
+  SlotKey Add(View key) {
+    SlotKey slot_key = MakeSlotKey(key);
+    if (key.size() > kPrefixSize) {
+      slot_key.set_offset(static_cast<int64_t>(arena_.size()));
+      arena_.insert(arena_.end(), key.data(), key.data() + key.size());
+    }
+    return slot_key;
+  }
+
+  bool Equals(const SlotKey& slot_key, View key) const {
+    if (slot_key.length != key.size()) {
+      return false;
+    }
+    auto prefix = MakeSlotKey(key);
+    if (memcmp(slot_key.prefix, prefix.prefix, kPrefixSize) != 0) {
+      return false;
+    }
+    return key.size() <= kPrefixSize ||
+           memcmp(arena_.data() + slot_key.offset() + kPrefixSize,
+                  key.data() + kPrefixSize, key.size() - kPrefixSize) == 0;
+  }
+
+  View Get(const SlotKey& slot_key) const {
+    if (slot_key.length <= kPrefixSize) {
+      return View(slot_key.prefix, slot_key.length);
+    }
+    return View(arena_.data() + slot_key.offset(), slot_key.length);
+  }
+
+  int64_t size() const { return static_cast<int64_t>(arena_.size()); }
+  void Resize(int64_t size) { arena_.resize(static_cast<size_t>(size)); }
+  void CopyFrom(const JoinKeyStore& other, int64_t base) {
+    std::copy(other.arena_.begin(), other.arena_.end(), arena_.begin() + base);
+  }
+  static void Rebase(SlotKey* slot_key, int64_t base) {
+    if (slot_key->length > kPrefixSize) {
+      slot_key->set_offset(slot_key->offset() + base);
+    }
+  }
+
+ private:
+  static SlotKey MakeSlotKey(View key) {
+    SlotKey slot_key = {};
+    memcpy(slot_key.prefix, key.data(),
+           key.size() < kPrefixSize ? key.size() : kPrefixSize);
+    slot_key.length = static_cast<uint32_t>(key.size());
+    return slot_key;
+  }
+
+  // backed by large pages if configured like the slots
+  std::vector<char, LargePageAllocator<char>> arena_;
+};
+
+/// \brief Hash table of the build side of a hash join
+///
+/// Open addressing with linear probing over slots holding the hash, the key and the id
+/// of each distinct key, so that a probe mostly touches one cache line. The rows of a
+/// key are chained in insertion order through one contiguous next array instead of a
+/// vector per key. Holds at most 2^31 rows.
+///
+/// GetBatch looks up a group of probe keys at a time, prefetching the slots and then the
+/// first rows of the whole group before reading any of them, so that the cache misses
+/// of a large table overlap instead of stalling the probe one row at a time.
+///
+/// Once the slots outgrow the last level cache the table switches to a radix
+/// partitioned layout: the high bits of the hash pick one of many independent
+/// partitions of about the size of L2, the low bits the slot in it. InsertBatch and
+/// GetBatch then group the rows of a batch by partition and handle one partition at a
+/// time, so that the slots they touch stay in cache.
+///
+/// As the partitions of a partitioned table are independent, InsertBatches builds such
+/// a table from all the build batches at once on several threads, each inserting the
+/// rows of one partition at a time.
+///
+/// The keys are held by a JoinKeyStore, string keys in an arena.
+template <typename Key, typename Index>
+class JoinHashTable {
+ public:
+  using KeyStore = JoinKeyStore<Key>;
+  /// The type keys are looked up by, e.g. a string_view for string keys
+  using KeyView = typename KeyStore::View;
+
+  static constexpr int32_t kNotFound = -1;
+  /// Number of rows looked up together, with prefetching, by GetBatch
+  static constexpr int64_t kProbeBatchSize = 32;
+
+  /// Iterates the rows of one key
+  class ItemRange {
+   public:
+    class Iterator {
+     public:
+      Iterator() : table_(nullptr), row_(kNotFound) {}
+      Iterator(const JoinHashTable* table, int32_t row) : table_(table), row_(row) {}
+      const Index& operator*() const { return table_->items_[row_]; }
+      Iterator& operator++() {
+        row_ = table_->next_[row_];
+        return *this;
+      }
+      bool operator!=(const Iterator& other) const { return row_ != other.row_; }
+
+     private:
+      const JoinHashTable* table_;
+      int32_t row_;
+    };
+
+    ItemRange(const JoinHashTable* table, int32_t head) : table_(table), head_(head) {}
+    Iterator begin() const { return Iterator(table_, head_); }
+    Iterator end() const { return Iterator(table_, kNotFound); }
+
+   private:
+    const JoinHashTable* table_;
+    int32_t head_;
+  };
+
+  /// \param radix_threshold slot bytes above which the table is radix partitioned
+  explicit JoinHashTable(arrow::MemoryPool* pool = nullptr,
+                         size_t radix_threshold = kDefaultRadixThreshold)
+      : radix_threshold_(radix_threshold) {
+    Resize(kInitialCapacity);
+  }
+
+  void Insert(KeyView key, const Index& item) {
+    auto hash = ComputeHash(key);
+    Insert(hash, key, item);
+  }
+
+  void InsertNull(const Index& item) {
+    if (null_key_id_ == kNotFound) {
+      null_key_id_ = NewKey();
+    }
+    Append(null_key_id_, item);
+  }
+
+  /// Insert every row of array, row i as item make_item(i). Partitioned tables insert
+  /// the rows grouped by partition, the rows of a key keep their order.
+  template <typename ArrayType, typename MakeItem>
+  void InsertBatch(const ArrayType& array, MakeItem&& make_item) {
+    auto length = array.length();
+    if (radix_bits_ == 0) {
+      for (int64_t i = 0; i < length; ++i) {
+        if (array.IsNull(i)) {
+          InsertNull(make_item(i));
+        } else {
+          Insert(array.GetView(i), make_item(i));
+        }
+      }
+      return;
+    }
+    std::vector<uint64_t> hashes(length);
+    std::vector<int32_t> order;
+    PartitionRows(array, 0, length, &hashes, &order);
+    for (int64_t i = 0; i < length; ++i) {
+      if (array.IsNull(i)) {
+        InsertNull(make_item(i));
+      }
+    }
+    for (auto i : order) {
+      Insert(hashes[i], array.GetView(i), make_item(i));
+    }
+  }
+
+  /// Insert every row of arrays into an empty table, row i of arrays[a] as item
+  /// make_item(a, i), on num_threads threads. make_item is called concurrently. Tables
+  /// too small to be partitioned are built by InsertBatch on the calling thread. The
+  /// rows of a key keep their order.
+  template <typename ArrayType, typename MakeItem>
+  void InsertBatches(const std::vector<std::shared_ptr<ArrayType>>& arrays,
+                     MakeItem&& make_item, int num_threads) {
+    size_t num_rows = 0;
+    for (const auto& array : arrays) {
+      num_rows += array->length();
+    }
+    // at most one key per row, size for all of them once to never resize while the
+    // partitions are built concurrently
+    auto capacity = kInitialCapacity;
+    while (capacity < 2 * num_rows) {
+      capacity *= 2;
+    }
+    if (num_threads <= 1 || num_keys() > 0 ||
+        capacity * sizeof(Slot) <= radix_threshold_) {
+      for (size_t a = 0; a < arrays.size(); ++a) {
+        InsertBatch(*arrays[a], [&make_item, a](int64_t i) { return make_item(a, i); });
+      }
+      return;
+    }
+
+    std::vector<std::vector<uint64_t>> hashes(arrays.size());
+    ParallelFor(arrays.size(), num_threads, [&](size_t a) {
+      const auto& array = *arrays[a];
+      hashes[a].resize(array.length());
+      HashRows(array, 0, array.length(), hashes[a].data());
+    });
+
+    // by array: the rows grouped by partition, and where each partition starts
+    std::vector<std::vector<int32_t>> orders(arrays.size());
+    std::vector<std::vector<int32_t>> starts(arrays.size());
+    // by partition: number of rows, and the first row in items_
+    std::vector<int32_t> partition_rows;
+    std::vector<int32_t> row_bases;
+    Resize(capacity);
+    while (true) {
+      size_t num_partitions = size_t(1) << radix_bits_;
+      ParallelFor(arrays.size(), num_threads, [&](size_t a) {
+        CountPartitions(*arrays[a], hashes[a], &starts[a]);
+      });
+      partition_rows.assign(num_partitions, 0);
+      for (const auto& array_starts : starts) {
+        for (size_t p = 0; p < num_partitions; ++p) {
+          partition_rows[p] += array_starts[p + 1];
+        }
+      }
+      // the rows bound the keys of a partition, keep at most half of its slots used
+      auto max_rows = *std::max_element(partition_rows.begin(), partition_rows.end());
+      if (static_cast<size_t>(max_rows) * 2 <= partition_mask_ + 1) {
+        break;
+      }
+      Resize(slots_.size() * 2);
+    }
+    size_t num_partitions = partition_rows.size();
+    row_bases.assign(num_partitions, 0);
+    for (size_t p = 1; p < num_partitions; ++p) {
+      row_bases[p] = row_bases[p - 1] + partition_rows[p - 1];
+    }
+    auto num_valid = row_bases.back() + partition_rows.back();
+    ParallelFor(arrays.size(), num_threads, [&](size_t a) {
+      OrderRows(*arrays[a], hashes[a], &starts[a], &orders[a]);
+    });
+
+    // insert each partition into its slots with key ids local to the partition
+    items_.resize(num_valid);
+    next_.assign(num_valid, kNotFound);
+    std::vector<std::vector<int32_t>> partition_heads(num_partitions);
+    std::vector<std::vector<int32_t>> partition_tails(num_partitions);
+    std::vector<std::vector<int32_t>> partition_counts(num_partitions);
+    // the keys of each partition, moved to key_store_ once all are built
+    std::vector<KeyStore> partition_stores(num_partitions);
+    ParallelFor(num_partitions, num_threads, [&](size_t p) {
+      auto& heads = partition_heads[p];
+      auto& tails = partition_tails[p];
+      auto& counts = partition_counts[p];
+      auto& store = partition_stores[p];
+      auto row = row_bases[p];
+      for (size_t a = 0; a < arrays.size(); ++a) {
+        // the partitions before p were moved past by OrderRows, p starts at the end of
+        // p - 1
+        auto begin = p == 0 ? 0 : starts[a][p - 1];
+        for (auto k = begin; k < starts[a][p]; ++k) {
+          auto i = orders[a][k];
+          auto hash = hashes[a][i];
+          KeyView key = arrays[a]->GetView(i);
+          auto slot = FindSlot(hash, key, store);
+          auto key_id = slots_[slot].key_id;
+          if (key_id == kNotFound) {
+            slots_[slot] = {hash, static_cast<int32_t>(heads.size()), store.Add(key)};
+            heads.push_back(row);
+            tails.push_back(row);
+            counts.push_back(1);
+          } else {
+            next_[tails[key_id]] = row;
+            tails[key_id] = row;
+            ++counts[key_id];
+          }
+          items_[row] = make_item(a, i);
+          ++row;
+        }
+      }
+    });
+
+    // number the keys of the partitions consecutively
+    std::vector<int32_t> key_bases(num_partitions, 0);
+    for (size_t p = 1; p < num_partitions; ++p) {
+      key_bases[p] =
+          key_bases[p - 1] + static_cast<int32_t>(partition_heads[p - 1].size());
+    }
+    auto total_keys = key_bases.back() + partition_heads.back().size();
+    heads_.resize(total_keys);
+    tails_.resize(total_keys);
+    counts_.resize(total_keys);
+    std::vector<int64_t> store_bases(num_partitions, key_store_.size());
+    for (size_t p = 1; p < num_partitions; ++p) {
+      store_bases[p] = store_bases[p - 1] + partition_stores[p - 1].size();
+    }
+    key_store_.Resize(store_bases.back() + partition_stores.back().size());
+    ParallelFor(num_partitions, num_threads, [&](size_t p) {
+      key_store_.CopyFrom(partition_stores[p], store_bases[p]);
+      std::copy(partition_heads[p].begin(), partition_heads[p].end(),
+                heads_.begin() + key_bases[p]);
+      std::copy(partition_tails[p].begin(), partition_tails[p].end(),
+                tails_.begin() + key_bases[p]);
+      std::copy(partition_counts[p].begin(), partition_counts[p].end(),
+                counts_.begin() + key_bases[p]);
+      partition_keys_[p] = partition_heads[p].size();
+      auto base = p << partition_bits_;
+      for (size_t slot = base; slot <= base + partition_mask_; ++slot) {
+        if (slots_[slot].key_id != kNotFound) {
+          slots_[slot].key_id += key_bases[p];
+          KeyStore::Rebase(&slots_[slot].key, store_bases[p]);
+        }
+      }
+    });
+
+    for (size_t a = 0; a < arrays.size(); ++a) {
+      for (int64_t i = 0; i < arrays[a]->length(); ++i) {
+        if (arrays[a]->IsNull(i)) {
+          InsertNull(make_item(a, i));
+        }
+      }
+    }
+    // sized for distinct keys, shrink if there are many duplicates
+    if (slots_.size() > 8 * total_keys && slots_.size() > kInitialCapacity) {
+      auto shrunk = kInitialCapacity;
+      while (shrunk < 4 * total_keys) {
+        shrunk *= 2;
+      }
+      Resize(shrunk);
+    }
+  }
+
+  /// Id of key to pass to Items, kNotFound if absent
+  int32_t Get(KeyView key) const {
+    auto hash = ComputeHash(key);
+    return slots_[FindSlot(hash, key)].key_id;
+  }
+
+  int32_t GetNull() const { return null_key_id_; }
+
+  /// Look up the keys of rows [offset, offset + length) of array into key_ids. Null
+  /// rows get GetNull().
+  template <typename ArrayType>
+  void GetBatch(const ArrayType& array, int64_t offset, int64_t length,
+                int32_t* key_ids) const {
+    if (radix_bits_ == 0) {
+      for (int64_t begin = 0; begin < length; begin += kProbeBatchSize) {
+        GetGroup(array, offset + begin, std::min(kProbeBatchSize, length - begin),
+                 key_ids + begin);
+      }
+      return;
+    }
+    std::vector<uint64_t> hashes(length);
+    std::vector<int32_t> order;
+    PartitionRows(array, offset, length, &hashes, &order);
+    for (int64_t i = 0; i < length; ++i) {
+      if (array.IsNull(offset + i)) {
+        key_ids[i] = null_key_id_;
+      }
+    }
+    for (auto i : order) {
+      key_ids[i] = slots_[FindSlot(hashes[i], array.GetView(offset + i))].key_id;
+    }
+  }
+
+  /// Key ids of the entries of the dictionary last looked up by GetDictionaryBatch
+  struct DictionaryKeyIds {
+    std::shared_ptr<arrow::Array> dictionary;
+    std::vector<int32_t> key_ids;
+  };
+
+  /// GetBatch of a dictionary array whose dictionary is an ArrayType. Each entry of the
+  /// dictionary is looked up once into cache, kept for the next batches sharing the
+  /// dictionary, e.g. the batches of a parquet row group read as dictionaries.
+  template <typename ArrayType>
+  void GetDictionaryBatch(const arrow::DictionaryArray& array, int64_t offset,
+                          int64_t length, int32_t* key_ids,
+                          DictionaryKeyIds* cache) const {
+    if (cache->dictionary != array.dictionary()) {
+      const auto& dictionary = static_cast<const ArrayType&>(*array.dictionary());
+      cache->dictionary = array.dictionary();
+      cache->key_ids.resize(dictionary.length());
+      GetBatch(dictionary, 0, dictionary.length(), cache->key_ids.data());
+    }
+    for (int64_t i = 0; i < length; ++i) {
+      key_ids[i] = array.IsNull(offset + i)
+                       ? null_key_id_
+                       : cache->key_ids[array.GetValueIndex(offset + i)];
+    }
+  }
+
+  ItemRange Items(int32_t key_id) const { return ItemRange(this, heads_[key_id]); }
+
+  /// Number of rows of the key of key_id, e.g. to tell the hot keys of a skewed build
+  /// side
+  int32_t NumItems(int32_t key_id) const { return counts_[key_id]; }
+
+  /// Call func on each distinct non null key, as a KeyView
+  template <typename Func>
+  void ForEachKey(Func&& func) const {
+    for (const auto& slot : slots_) {
+      if (slot.key_id != kNotFound) {
+        func(key_store_.Get(slot.key));
+      }
+    }
+  }
+
+  /// Slots probed to find each key summed over the keys, i.e. the distance of each key
+  /// from the slot of its hash plus one. Scans the slots.
+  int64_t ProbeChainLength() const {
+    int64_t length = 0;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      if (slots_[i].key_id != kNotFound) {
+        length += ((i - FindSlotStart(slots_[i].hash)) & partition_mask_) + 1;
+      }
+    }
+    return length;
+  }
+
+  int32_t num_keys() const { return static_cast<int32_t>(heads_.size()); }
+  int64_t num_items() const { return static_cast<int64_t>(items_.size()); }
+  /// log2 of the number of partitions, 0 if not partitioned
+  int radix_bits() const { return radix_bits_; }
+
+ private:
+  static constexpr size_t kInitialCapacity = 1024;
+  // slot bytes above which GetBatch prefetches, about the size of a last level cache
+  static constexpr size_t kPrefetchThreshold = 8 << 20;
+  static constexpr size_t kDefaultRadixThreshold = 32 << 20;
+  // slot bytes of a partition, fitting L2
+  static constexpr size_t kPartitionBytes = 256 << 10;
+
+  struct Slot {
+    uint64_t hash;
+    int32_t key_id;
+    typename KeyStore::SlotKey key;
+  };
+  // backed by large pages if configured, the slots are probed at random
+  using SlotVector = std::vector<Slot, LargePageAllocator<Slot>>;
+
+  // the hashes of fasthash, HashRows hashes the values of a batch the same way
+  template <typename T>
+  static typename std::enable_if<std::is_arithmetic<T>::value, uint64_t>::type
+  ComputeHash(T key) {
+    return fasthash::HashValue(key);
+  }
+
+  static uint64_t ComputeHash(arrow::util::string_view key) {
+    return fasthash::HashBytes(key.data(), static_cast<int64_t>(key.size()));
+  }
+
+  static uint64_t ComputeHash(const std::string& key) {
+    return ComputeHash(arrow::util::string_view(key));
+  }
+
+  template <typename T>
+  static typename std::enable_if<
+      !std::is_arithmetic<T>::value &&
+          !std::is_convertible<const T&, arrow::util::string_view>::value,
+      uint64_t>::type
+  ComputeHash(const T& key) {
+    // std::hash of integers is the identity, mix it for linear probing
+    return fasthash::HashWord(std::hash<T>()(key));
+  }
+
+  // Hash rows [offset, offset + length) of array into hashes, the null ones too but
+  // their hashes are not used. Numeric arrays are hashed in one vectorizable loop.
+  template <typename T>
+  static void HashRows(const arrow::NumericArray<T>& array, int64_t offset,
+                       int64_t length, uint64_t* hashes) {
+    fasthash::HashValues(array.raw_values() + offset, length, hashes);
+  }
+
+  template <typename ArrayType>
+  static void HashRows(const ArrayType& array, int64_t offset, int64_t length,
+                       uint64_t* hashes) {
+    for (int64_t i = 0; i < length; ++i) {
+      if (!array.IsNull(offset + i)) {
+        hashes[i] = ComputeHash(array.GetView(offset + i));
+      }
+    }
+  }
+
+  size_t Partition(uint64_t hash) const {
+    return radix_bits_ == 0 ? 0 : static_cast<size_t>(hash >> (64 - radix_bits_));
+  }
+
+  // Slot of key, or the empty slot where it would be inserted
+  size_t FindSlot(uint64_t hash, KeyView key) const {
+    return FindSlot(hash, key, key_store_);
+  }
+
+  // The same with the slots of an InsertBatches partition, whose keys are in store
+  size_t FindSlot(uint64_t hash, KeyView key, const KeyStore& store) const {
+    auto base = Partition(hash) << partition_bits_;
+    auto slot = hash & partition_mask_;
+    while (slots_[base + slot].key_id != kNotFound &&
+           (slots_[base + slot].hash != hash ||
+            !store.Equals(slots_[base + slot].key, key))) {
+      slot = (slot + 1) & partition_mask_;
+    }
+    return base + slot;
+  }
+
+  void Insert(uint64_t hash, KeyView key, const Index& item) {
+    auto slot = FindSlot(hash, key);
+    auto key_id = slots_[slot].key_id;
+    if (key_id == kNotFound) {
+      key_id = NewKey();
+      slots_[slot] = {hash, key_id, key_store_.Add(key)};
+      // keep at most half of the slots of each partition used so that probe sequences
+      // stay short
+      if (++partition_keys_[Partition(hash)] * 2 > partition_mask_ + 1) {
+        Resize(slots_.size() * 2);
+      }
+    }
+    Append(key_id, item);
+  }
+
+  void Resize(size_t capacity) {
+    radix_bits_ = 0;
+    partition_bits_ = 0;
+    while ((size_t(1) << partition_bits_) < capacity) {
+      ++partition_bits_;
+    }
+    if (capacity * sizeof(Slot) > radix_threshold_) {
+      while ((size_t(1) << (partition_bits_ - 1)) * sizeof(Slot) >= kPartitionBytes) {
+        --partition_bits_;
+        ++radix_bits_;
+      }
+    }
+    partition_mask_ = (size_t(1) << partition_bits_) - 1;
+    partition_keys_.assign(size_t(1) << radix_bits_, 0);
+
+    SlotVector old_slots(capacity, Slot{0, kNotFound, typename KeyStore::SlotKey()});
+    old_slots.swap(slots_);
+    for (auto& old_slot : old_slots) {
+      if (old_slot.key_id != kNotFound) {
+        auto partition = Partition(old_slot.hash);
+        auto base = partition << partition_bits_;
+        auto slot = old_slot.hash & partition_mask_;
+        while (slots_[base + slot].key_id != kNotFound) {
+          slot = (slot + 1) & partition_mask_;
+        }
+        ++partition_keys_[partition];
+        slots_[base + slot] = std::move(old_slot);
+      }
+    }
+  }
+
+  // Look up at most kProbeBatchSize rows
+  template <typename ArrayType>
+  void GetGroup(const ArrayType& array, int64_t offset, int64_t length,
+                int32_t* key_ids) const {
+    uint64_t hashes[kProbeBatchSize];
+    // tables fitting in the cache gain nothing from prefetching
+    auto prefetch = slots_.size() * sizeof(Slot) > kPrefetchThreshold;
+    HashRows(array, offset, length, hashes);
+    if (prefetch) {
+      for (int64_t i = 0; i < length; ++i) {
+        if (!array.IsNull(offset + i)) {
+          __builtin_prefetch(&slots_[FindSlotStart(hashes[i])]);
+        }
+      }
+    }
+    for (int64_t i = 0; i < length; ++i) {
+      if (array.IsNull(offset + i)) {
+        key_ids[i] = null_key_id_;
+      } else {
+        key_ids[i] = slots_[FindSlot(hashes[i], array.GetView(offset + i))].key_id;
+      }
+      if (prefetch && key_ids[i] != kNotFound) {
+        __builtin_prefetch(&items_[heads_[key_ids[i]]]);
+      }
+    }
+  }
+
+  size_t FindSlotStart(uint64_t hash) const {
+    return (Partition(hash) << partition_bits_) + (hash & partition_mask_);
+  }
+
+  // Hash the non null rows [offset, offset + length) of array into hashes and list them
+  // in order grouped by partition, by a stable counting sort
+  template <typename ArrayType>
+  void PartitionRows(const ArrayType& array, int64_t offset, int64_t length,
+                     std::vector<uint64_t>* hashes, std::vector<int32_t>* order) const {
+    std::vector<int32_t> starts((size_t(1) << radix_bits_) + 1, 0);
+    int64_t num_valid = 0;
+    HashRows(array, offset, length, hashes->data());
+    for (int64_t i = 0; i < length; ++i) {
+      if (!array.IsNull(offset + i)) {
+        ++starts[Partition((*hashes)[i]) + 1];
+        ++num_valid;
+      }
+    }
+    for (size_t p = 1; p < starts.size(); ++p) {
+      starts[p] += starts[p - 1];
+    }
+    order->resize(num_valid);
+    for (int64_t i = 0; i < length; ++i) {
+      if (!array.IsNull(offset + i)) {
+        (*order)[starts[Partition((*hashes)[i])]++] = static_cast<int32_t>(i);
+      }
+    }
+  }
+
+  // Count the non null rows of array in each partition into starts[p + 1]
+  template <typename ArrayType>
+  void CountPartitions(const ArrayType& array, const std::vector<uint64_t>& hashes,
+                       std::vector<int32_t>* starts) const {
+    starts->assign((size_t(1) << radix_bits_) + 1, 0);
+    for (int64_t i = 0; i < array.length(); ++i) {
+      if (!array.IsNull(i)) {
+        ++(*starts)[Partition(hashes[i]) + 1];
+      }
+    }
+  }
+
+  // List the non null rows of array grouped by partition from the counts of
+  // CountPartitions. Leaves starts[p] at the end of partition p.
+  template <typename ArrayType>
+  void OrderRows(const ArrayType& array, const std::vector<uint64_t>& hashes,
+                 std::vector<int32_t>* starts, std::vector<int32_t>* order) const {
+    for (size_t p = 1; p < starts->size(); ++p) {
+      (*starts)[p] += (*starts)[p - 1];
+    }
+    order->resize(starts->back());
+    for (int64_t i = 0; i < array.length(); ++i) {
+      if (!array.IsNull(i)) {
+        (*order)[(*starts)[Partition(hashes[i])]++] = static_cast<int32_t>(i);
+      }
+    }
+  }
+
+  // Run func(i) for each i in [0, n) on num_threads threads of the task scheduler, the
+  // calling thread included
+  template <typename Func>
+  static void ParallelFor(size_t n, int num_threads, Func&& func) {
+    auto status = TaskScheduler::Global()->ParallelFor(
+        static_cast<int64_t>(n), num_threads, [&func](int64_t i) {
+          func(static_cast<size_t>(i));
+          return arrow::Status::OK();
+        });
+    (void)status;
+  }
+
+  int32_t NewKey() {
+    heads_.push_back(kNotFound);
+    tails_.push_back(kNotFound);
+    counts_.push_back(0);
+    return static_cast<int32_t>(heads_.size() - 1);
+  }
+
+  void Append(int32_t key_id, const Index& item) {
+    auto row = static_cast<int32_t>(items_.size());
+    items_.push_back(item);
+    next_.push_back(kNotFound);
+    if (tails_[key_id] == kNotFound) {
+      heads_[key_id] = row;
+    } else {
+      next_[tails_[key_id]] = row;
+    }
+    tails_[key_id] = row;
+    ++counts_[key_id];
+  }
+
+  const size_t radix_threshold_;
+  SlotVector slots_;
+  KeyStore key_store_;
+  int radix_bits_ = 0;
+  // log2 of the slots of a partition
+  int partition_bits_ = 0;
+  size_t partition_mask_ = 0;
+  std::vector<size_t> partition_keys_;
+  int32_t null_key_id_ = kNotFound;
+
+  // by key id: first and last row of the key, and its number of rows
+  std::vector<int32_t> heads_;
+  std::vector<int32_t> tails_;
+  std::vector<int32_t> counts_;
+  // by row: the build side item and the next row of the same key
+  std::vector<Index> items_;
+  std::vector<int32_t> next_;
+};
+
+template <typename Key, typename Index>
+constexpr int32_t JoinHashTable<Key, Index>::kNotFound;
+template <typename Key, typename Index>
+constexpr int64_t JoinHashTable<Key, Index>::kProbeBatchSize;
+template <typename Key, typename Index>
+constexpr size_t JoinHashTable<Key, Index>::kInitialCapacity;
+template <typename Key, typename Index>
+constexpr size_t JoinHashTable<Key, Index>::kPrefetchThreshold;
+template <typename Key, typename Index>
+constexpr size_t JoinHashTable<Key, Index>::kDefaultRadixThreshold;
+template <typename Key, typename Index>
+constexpr size_t JoinHashTable<Key, Index>::kPartitionBytes;
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
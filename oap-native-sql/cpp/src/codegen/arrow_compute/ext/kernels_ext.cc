@@ -19,12 +19,14 @@
 
 #include <arrow/array/builder_binary.h>
 #include <arrow/array/builder_primitive.h>
+#include <arrow/array/concatenate.h>
 #include <arrow/compute/context.h>
 #include <arrow/compute/kernel.h>
 #include <arrow/compute/kernels/count.h>
 #include <arrow/compute/kernels/hash.h>
 #include <arrow/compute/kernels/minmax.h>
 #include <arrow/compute/kernels/sum.h>
+#include <arrow/compute/kernels/take.h>
 #include <arrow/pretty_print.h>
 #include <arrow/status.h>
 #include <arrow/type.h>
@@ -39,17 +41,25 @@
 #include <gandiva/projector.h>
 #include <gandiva/tree_expr_builder.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <unordered_map>
+#include <utility>
 
 #include "codegen/arrow_compute/ext/actions_impl.h"
 #include "codegen/arrow_compute/ext/array_item_index.h"
 #include "codegen/arrow_compute/ext/codegen_common.h"
+#include "codegen/arrow_compute/ext/reduce.h"
+#include "codegen/common/gandiva_cache.h"
 //#include "codegen/arrow_compute/ext/codegen_node_visitor.h"
 #include "third_party/arrow/utils/hashing.h"
+#include "utils/arena_memory_pool.h"
+#include "utils/column_hash.h"
 #include "utils/macros.h"
 
 namespace sparkcolumnarplugin {
@@ -59,17 +69,112 @@ namespace extra {
 
 using ArrayList = std::vector<std::shared_ptr<arrow::Array>>;
 
+/// \brief Parse what follows the name of an approximate action
+///
+/// That is "_<args>" for the partial aggregation of input values, "Merge_<args>" to
+/// merge partial states into partial states and "Final_<args>" to merge them into the
+/// result, args being separated by '_'.
+static arrow::Status ParseApproxAction(const std::string& suffix, ApproxMode* mode,
+                                       std::vector<double>* args) {
+  auto pos = suffix.find('_');
+  auto mode_name = suffix.substr(0, pos);
+  if (mode_name.empty()) {
+    *mode = ApproxMode::kPartial;
+  } else if (mode_name == "Merge") {
+    *mode = ApproxMode::kPartialMerge;
+  } else if (mode_name == "Final") {
+    *mode = ApproxMode::kFinal;
+  } else {
+    return arrow::Status::Invalid("Unknown approximate action mode ", mode_name);
+  }
+  while (pos != std::string::npos) {
+    auto next = suffix.find('_', pos + 1);
+    args->push_back(std::stod(suffix.substr(pos + 1, next - pos - 1)));
+    pos = next;
+  }
+  if (args->empty()) {
+    return arrow::Status::Invalid("Approximate action expects arguments after ",
+                                  mode_name);
+  }
+  return arrow::Status::OK();
+}
+
+/// Make the action of action_name for input values of type, res_type being the return
+/// type of its node
+static arrow::Status MakeAction(arrow::compute::FunctionContext* ctx,
+                                const std::string& action_name,
+                                std::shared_ptr<arrow::DataType> type,
+                                std::shared_ptr<arrow::DataType> res_type,
+                                std::shared_ptr<ActionBase>* out) {
+  if (type && type->id() == arrow::Type::DECIMAL && IsDecimalAction(action_name)) {
+    RETURN_NOT_OK(MakeDecimalAction(ctx, action_name, type, res_type, out));
+  } else if (action_name.compare("action_unique") == 0) {
+    RETURN_NOT_OK(MakeUniqueAction(ctx, type, out));
+  } else if (action_name.compare("action_count") == 0) {
+    RETURN_NOT_OK(MakeCountAction(ctx, out));
+  } else if (action_name.compare("action_sum") == 0) {
+    RETURN_NOT_OK(MakeSumAction(ctx, type, out));
+  } else if (action_name.compare("action_avg") == 0) {
+    RETURN_NOT_OK(MakeAvgAction(ctx, type, out));
+  } else if (action_name.compare("action_min") == 0) {
+    RETURN_NOT_OK(MakeMinAction(ctx, type, out));
+  } else if (action_name.compare("action_max") == 0) {
+    RETURN_NOT_OK(MakeMaxAction(ctx, type, out));
+  } else if (action_name.compare("action_sum_count") == 0) {
+    RETURN_NOT_OK(MakeSumCountAction(ctx, type, out));
+  } else if (action_name.compare("action_avgByCount") == 0) {
+    RETURN_NOT_OK(MakeAvgByCountAction(ctx, type, out));
+  } else if (action_name.compare(0, 20, "action_countLiteral_") == 0) {
+    int arg = std::stoi(action_name.substr(20));
+    RETURN_NOT_OK(MakeCountLiteralAction(ctx, arg, out));
+  } else if (action_name.compare(0, 26, "action_approxCountDistinct") == 0) {
+    ApproxMode mode;
+    std::vector<double> args;
+    RETURN_NOT_OK(ParseApproxAction(action_name.substr(26), &mode, &args));
+    RETURN_NOT_OK(MakeApproxCountDistinctAction(ctx, type, static_cast<int>(args[0]),
+                                                mode, out));
+  } else if (action_name.compare(0, 23, "action_approxPercentile") == 0) {
+    ApproxMode mode;
+    std::vector<double> args;
+    RETURN_NOT_OK(ParseApproxAction(action_name.substr(23), &mode, &args));
+    // the accuracy of Spark defaults to 10000
+    double accuracy = args.size() > 1 ? args[1] : 10000;
+    RETURN_NOT_OK(
+        MakeApproxPercentileAction(ctx, type, args[0], accuracy, mode, out));
+  } else {
+    return arrow::Status::NotImplemented(action_name, " is not implementetd.");
+  }
+  return arrow::Status::OK();
+}
+
+///////////////  KernalBase  ////////////////
+arrow::Status KernalBase::EvaluateWithSelection(
+    const ArrayList& in, const std::shared_ptr<arrow::Array>& selection) {
+  arrow::compute::FunctionContext ctx;
+  ArrayList taken;
+  for (const auto& array : in) {
+    std::shared_ptr<arrow::Array> out;
+    RETURN_NOT_OK(arrow::compute::Take(&ctx, *array, *selection,
+                                       arrow::compute::TakeOptions(), &out));
+    taken.push_back(out);
+  }
+  return Evaluate(taken);
+}
+
 ///////////////  SplitArrayListWithAction  ////////////////
 class SplitArrayListWithActionKernel::Impl {
  public:
   Impl(arrow::compute::FunctionContext* ctx, std::vector<std::string> action_name_list,
-       std::vector<std::shared_ptr<arrow::DataType>> type_list)
+       std::vector<std::shared_ptr<arrow::DataType>> type_list,
+       std::vector<std::shared_ptr<arrow::DataType>> res_type_list)
       : ctx_(ctx), action_name_list_(action_name_list) {
-    InitActionList(type_list);
+    InitActionList(type_list, res_type_list);
   }
   ~Impl() {}
 
-  arrow::Status InitActionList(std::vector<std::shared_ptr<arrow::DataType>> type_list) {
+  arrow::Status InitActionList(
+      std::vector<std::shared_ptr<arrow::DataType>> type_list,
+      std::vector<std::shared_ptr<arrow::DataType>> res_type_list) {
     int type_id = 0;
 #ifdef DEBUG
     std::cout << "action_name_list_ has " << action_name_list_.size()
@@ -78,30 +183,12 @@ class SplitArrayListWithActionKernel::Impl {
 #endif
     for (int action_id = 0; action_id < action_name_list_.size(); action_id++) {
       std::shared_ptr<ActionBase> action;
-      if (action_name_list_[action_id].compare("action_unique") == 0) {
-        RETURN_NOT_OK(MakeUniqueAction(ctx_, type_list[type_id], &action));
-      } else if (action_name_list_[action_id].compare("action_count") == 0) {
-        RETURN_NOT_OK(MakeCountAction(ctx_, &action));
-      } else if (action_name_list_[action_id].compare("action_sum") == 0) {
-        RETURN_NOT_OK(MakeSumAction(ctx_, type_list[type_id], &action));
-      } else if (action_name_list_[action_id].compare("action_avg") == 0) {
-        RETURN_NOT_OK(MakeAvgAction(ctx_, type_list[type_id], &action));
-      } else if (action_name_list_[action_id].compare("action_min") == 0) {
-        RETURN_NOT_OK(MakeMinAction(ctx_, type_list[type_id], &action));
-      } else if (action_name_list_[action_id].compare("action_max") == 0) {
-        RETURN_NOT_OK(MakeMaxAction(ctx_, type_list[type_id], &action));
-      } else if (action_name_list_[action_id].compare("action_sum_count") == 0) {
-        RETURN_NOT_OK(MakeSumCountAction(ctx_, type_list[type_id], &action));
-      } else if (action_name_list_[action_id].compare("action_avgByCount") == 0) {
-        RETURN_NOT_OK(MakeAvgByCountAction(ctx_, type_list[type_id], &action));
-      } else if (action_name_list_[action_id].compare(0, 20, "action_countLiteral_") ==
-                 0) {
-        int arg = std::stoi(action_name_list_[action_id].substr(20));
-        RETURN_NOT_OK(MakeCountLiteralAction(ctx_, arg, &action));
-      } else {
-        return arrow::Status::NotImplemented(action_name_list_[action_id],
-                                             " is not implementetd.");
+      std::shared_ptr<arrow::DataType> res_type;
+      if (action_id < res_type_list.size()) {
+        res_type = res_type_list[action_id];
       }
+      RETURN_NOT_OK(MakeAction(ctx_, action_name_list_[action_id], type_list[type_id],
+                               res_type, &action));
       type_id += action->RequiredColNum();
       action_list_.push_back(action);
     }
@@ -126,8 +213,7 @@ class SplitArrayListWithActionKernel::Impl {
       }
     }
 
-    std::vector<std::function<arrow::Status(int)>> eval_func_list;
-    std::vector<std::function<arrow::Status()>> eval_null_func_list;
+    // each action aggregates the whole batch in a typed loop of its own
     int col_id = 0;
     ArrayList cols;
     for (int i = 0; i < action_list_.size(); i++) {
@@ -136,24 +222,7 @@ class SplitArrayListWithActionKernel::Impl {
       for (int j = 0; j < action->RequiredColNum(); j++) {
         cols.push_back(in[col_id++]);
       }
-      std::function<arrow::Status(int)> func;
-      std::function<arrow::Status()> null_func;
-      action->Submit(cols, max_group_id, &func, &null_func);
-      eval_func_list.push_back(func);
-      eval_null_func_list.push_back(null_func);
-    }
-
-    for (int row_id = 0; row_id < in_dict->length(); row_id++) {
-      if (in_dict->IsValid(row_id)) {
-        auto group_id = typed_in_dict->GetView(row_id);
-        for (auto eval_func : eval_func_list) {
-          eval_func(group_id);
-        }
-      } else {
-        for (auto eval_func : eval_null_func_list) {
-          eval_func();
-        }
-      }
+      RETURN_NOT_OK(action->Evaluate(cols, max_group_id, *typed_in_dict));
     }
     return arrow::Status::OK();
   }
@@ -215,11 +284,10 @@ class SplitArrayListWithActionKernel::Impl {
         *out = nullptr;
         return arrow::Status::OK();
       }
-      auto length = (total_length_ - offset_) > GetBatchSize()
-                        ? GetBatchSize()
-                        : (total_length_ - offset_);
+      auto length = std::min<uint64_t>(total_length_ - offset_, batch_sizer_.rows());
       TIME_MICRO_OR_RAISE(elapse_time_, eval_func_(offset_, length, out));
       offset_ += length;
+      batch_sizer_.Update(**out);
       // arrow::PrettyPrint(*(*out).get(), 2, &std::cout);
       return arrow::Status::OK();
     }
@@ -231,6 +299,7 @@ class SplitArrayListWithActionKernel::Impl {
         eval_func_;
     uint64_t offset_ = 0;
     const uint64_t total_length_;
+    BatchSizer batch_sizer_;
     uint64_t elapse_time_ = 0;
   };
 };
@@ -238,16 +307,18 @@ class SplitArrayListWithActionKernel::Impl {
 arrow::Status SplitArrayListWithActionKernel::Make(
     arrow::compute::FunctionContext* ctx, std::vector<std::string> action_name_list,
     std::vector<std::shared_ptr<arrow::DataType>> type_list,
+    std::vector<std::shared_ptr<arrow::DataType>> res_type_list,
     std::shared_ptr<KernalBase>* out) {
-  *out =
-      std::make_shared<SplitArrayListWithActionKernel>(ctx, action_name_list, type_list);
+  *out = std::make_shared<SplitArrayListWithActionKernel>(ctx, action_name_list,
+                                                          type_list, res_type_list);
   return arrow::Status::OK();
 }
 
 SplitArrayListWithActionKernel::SplitArrayListWithActionKernel(
     arrow::compute::FunctionContext* ctx, std::vector<std::string> action_name_list,
-    std::vector<std::shared_ptr<arrow::DataType>> type_list) {
-  impl_.reset(new Impl(ctx, action_name_list, type_list));
+    std::vector<std::shared_ptr<arrow::DataType>> type_list,
+    std::vector<std::shared_ptr<arrow::DataType>> res_type_list) {
+  impl_.reset(new Impl(ctx, action_name_list, type_list, res_type_list));
   kernel_name_ = "SplitArrayListWithActionKernel";
 }
 
@@ -266,6 +337,846 @@ arrow::Status SplitArrayListWithActionKernel::MakeResultIterator(
   return impl_->MakeResultIterator(schema, out);
 }
 
+///////////////  SortedAggregate  ////////////////
+namespace {
+
+// Mark in starts the rows of key that differ from the row before, nulls being equal
+template <typename ArrayType>
+void MarkKeyChanges(const ArrayType& key, std::vector<uint8_t>* starts) {
+  auto& s = *starts;
+  if (key.null_count() == 0) {
+    for (int64_t i = 1; i < key.length(); i++) {
+      s[i] |= key.GetView(i) != key.GetView(i - 1);
+    }
+    return;
+  }
+  for (int64_t i = 1; i < key.length(); i++) {
+    bool valid = key.IsValid(i);
+    s[i] |= valid != key.IsValid(i - 1) ||
+            (valid && key.GetView(i) != key.GetView(i - 1));
+  }
+}
+
+void MarkKeyChanges(const arrow::Array& key, std::vector<uint8_t>* starts) {
+  switch (key.type_id()) {
+#define PROCESS(InType)                                                           \
+  case InType::type_id: {                                                         \
+    using ArrayType = typename arrow::TypeTraits<InType>::ArrayType;              \
+    MarkKeyChanges(arrow::internal::checked_cast<const ArrayType&>(key), starts); \
+  } break;
+    PROCESS(arrow::BooleanType)
+    PROCESS(arrow::UInt8Type)
+    PROCESS(arrow::Int8Type)
+    PROCESS(arrow::UInt16Type)
+    PROCESS(arrow::Int16Type)
+    PROCESS(arrow::UInt32Type)
+    PROCESS(arrow::Int32Type)
+    PROCESS(arrow::UInt64Type)
+    PROCESS(arrow::Int64Type)
+    PROCESS(arrow::FloatType)
+    PROCESS(arrow::DoubleType)
+    PROCESS(arrow::Date32Type)
+    PROCESS(arrow::StringType)
+    PROCESS(arrow::BinaryType)
+    PROCESS(arrow::Decimal128Type)
+#undef PROCESS
+    default: {
+      auto& s = *starts;
+      for (int64_t i = 1; i < key.length(); i++) {
+        s[i] |= !key.RangeEquals(key, i, i + 1, i - 1);
+      }
+    } break;
+  }
+}
+
+}  // namespace
+
+class SortedAggregateKernel::Impl {
+ public:
+  Impl(arrow::compute::FunctionContext* ctx,
+       std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+       std::vector<std::shared_ptr<gandiva::Node>> action_list,
+       std::shared_ptr<arrow::Schema> result_schema)
+      : ctx_(ctx), result_schema_(result_schema), scratch_pool_(ctx->memory_pool()) {
+    THROW_NOT_OK(InitActionList(arrow::schema(input_field_list), action_list));
+  }
+
+  arrow::Status InitActionList(std::shared_ptr<arrow::Schema> input_schema,
+                               std::vector<std::shared_ptr<gandiva::Node>> action_list) {
+    for (const auto& node : action_list) {
+      auto func_node = std::dynamic_pointer_cast<gandiva::FunctionNode>(node);
+      if (!func_node) {
+        return arrow::Status::Invalid("SortedAggregateKernel expects action nodes, got ",
+                                      node->ToString());
+      }
+      auto action_name = func_node->descriptor()->name();
+      std::vector<int> input_indices;
+      for (const auto& child : func_node->children()) {
+        auto field_node = std::dynamic_pointer_cast<gandiva::FieldNode>(child);
+        auto index =
+            field_node ? input_schema->GetFieldIndex(field_node->field()->name()) : -1;
+        if (index < 0) {
+          return arrow::Status::NotImplemented(
+              "SortedAggregateKernel expects input fields as the children of ",
+              action_name, ", got ", child->ToString());
+        }
+        input_indices.push_back(index);
+      }
+      if (action_name == "action_groupby") {
+        if (input_indices.size() != 1) {
+          return arrow::Status::Invalid("action_groupby expects one key field");
+        }
+        node_keys_.push_back(key_indices_.size());
+        key_indices_.push_back(input_indices[0]);
+        continue;
+      }
+      std::shared_ptr<arrow::DataType> type;
+      if (!input_indices.empty()) {
+        type = input_schema->field(input_indices[0])->type();
+      }
+      std::shared_ptr<ActionBase> action;
+      RETURN_NOT_OK(
+          MakeAction(ctx_, action_name, type, func_node->return_type(), &action));
+      if (!action) {
+        return arrow::Status::NotImplemented(action_name,
+                                             " is not supported for its input type.");
+      }
+      if (action->RequiredColNum() != static_cast<int>(input_indices.size())) {
+        return arrow::Status::Invalid(action_name, " expects ", action->RequiredColNum(),
+                                      " input fields, got ", input_indices.size());
+      }
+      node_keys_.push_back(-1);
+      action_list_.push_back(action);
+      action_input_list_.push_back(input_indices);
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Evaluate(const ArrayList& in) {
+    std::shared_ptr<arrow::RecordBatch> out;
+    RETURN_NOT_OK(Aggregate(in, &out));
+    if (out) {
+      output_list_.push_back(out);
+    }
+    return arrow::Status::OK();
+  }
+
+  /// \brief Aggregate a batch into the open group and the groups it starts
+  ///
+  /// out is the batch of the groups ended by in, or null if it ends none. The open group
+  /// is the last one of in, which the next batch may go on.
+  arrow::Status Aggregate(const ArrayList& in, std::shared_ptr<arrow::RecordBatch>* out) {
+    *out = nullptr;
+    auto length = in.empty() ? 0 : in[0]->length();
+    if (length == 0) {
+      return arrow::Status::OK();
+    }
+    // the group ids and key rows of the last batch are freed
+    scratch_pool_.Reset();
+    ArrayList keys;
+    for (auto index : key_indices_) {
+      keys.push_back(in[index]);
+    }
+    // 1 at the rows starting a group, the first one going on the open group if its keys
+    // are those of the last row before
+    std::vector<uint8_t> starts(length, 0);
+    for (const auto& key : keys) {
+      MarkKeyChanges(*key, &starts);
+    }
+    starts[0] = !open_;
+    for (size_t i = 0; open_ && i < keys.size(); i++) {
+      starts[0] |= !last_keys_[i]->RangeEquals(*keys[i], 0, 1, 0);
+    }
+
+    std::vector<int32_t> group_starts;
+    for (int64_t i = 0; i < length; i++) {
+      if (starts[i]) group_starts.push_back(i);
+    }
+    // the groups before the last one of in end, the open group being group 0
+    int32_t num_ended = static_cast<int32_t>(group_starts.size()) - (open_ ? 0 : 1);
+    int64_t last_start = group_starts.empty() ? 0 : group_starts.back();
+    arrow::Int32Builder group_id_builder(&scratch_pool_);
+    RETURN_NOT_OK(group_id_builder.Resize(length));
+    int32_t group_id = open_ ? 0 : -1;
+    for (int64_t i = 0; i < length; i++) {
+      group_id += starts[i];
+      group_id_builder.UnsafeAppend(i < last_start ? group_id : 0);
+    }
+    std::shared_ptr<arrow::Array> group_ids;
+    RETURN_NOT_OK(group_id_builder.Finish(&group_ids));
+
+    if (num_ended > 0) {
+      if (last_start > 0) {
+        RETURN_NOT_OK(EvaluateActions(in, 0, last_start, group_ids, num_ended - 1));
+      }
+      // the keys of a group are those of its first row, or of the last row before in
+      std::vector<int32_t> key_rows;
+      if (open_ && !starts[0]) key_rows.push_back(0);
+      key_rows.insert(key_rows.end(), group_starts.begin(), group_starts.end() - 1);
+      arrow::Int32Builder key_row_builder(&scratch_pool_);
+      RETURN_NOT_OK(key_row_builder.AppendValues(key_rows));
+      std::shared_ptr<arrow::Array> key_row_indices;
+      RETURN_NOT_OK(key_row_builder.Finish(&key_row_indices));
+      ArrayList group_keys;
+      for (size_t i = 0; i < keys.size(); i++) {
+        std::shared_ptr<arrow::Array> taken;
+        RETURN_NOT_OK(arrow::compute::Take(ctx_, *keys[i], *key_row_indices,
+                                           arrow::compute::TakeOptions(), &taken));
+        if (open_ && starts[0]) {
+          RETURN_NOT_OK(
+              arrow::Concatenate({last_keys_[i], taken}, ctx_->memory_pool(), &taken));
+        }
+        group_keys.push_back(taken);
+      }
+      RETURN_NOT_OK(FinishGroups(group_keys, num_ended, out));
+    }
+    RETURN_NOT_OK(EvaluateActions(in, last_start, length - last_start,
+                                  group_ids->Slice(last_start), 0));
+    last_keys_.clear();
+    for (const auto& key : keys) {
+      last_keys_.push_back(key->Slice(length - 1, 1));
+    }
+    open_ = true;
+    return arrow::Status::OK();
+  }
+
+  /// Output the open group once the input is over, out is null if there is none
+  arrow::Status FinishOpenGroup(std::shared_ptr<arrow::RecordBatch>* out) {
+    *out = nullptr;
+    if (!open_) {
+      return arrow::Status::OK();
+    }
+    open_ = false;
+    return FinishGroups(last_keys_, 1, out);
+  }
+
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+    *out = std::make_shared<SortedAggregateResultIterator>(this);
+    return arrow::Status::OK();
+  }
+
+ private:
+  arrow::compute::FunctionContext* ctx_;
+  std::shared_ptr<arrow::Schema> result_schema_;
+  // by node, the index of its key in key_indices_ or -1 for an action
+  std::vector<int> node_keys_;
+  std::vector<int> key_indices_;
+  std::vector<std::shared_ptr<ActionBase>> action_list_;
+  std::vector<std::vector<int>> action_input_list_;
+  // whether the last group aggregated may go on in the next batch, and its keys
+  bool open_ = false;
+  ArrayList last_keys_;
+  // the groups ended by the batches of Evaluate
+  std::deque<std::shared_ptr<arrow::RecordBatch>> output_list_;
+  // transient arrays of a batch
+  ArenaMemoryPool scratch_pool_;
+
+  arrow::Status EvaluateActions(const ArrayList& in, int64_t offset, int64_t length,
+                                const std::shared_ptr<arrow::Array>& group_ids,
+                                int max_group_id) {
+    const auto& typed_group_ids =
+        arrow::internal::checked_cast<const arrow::Int32Array&>(*group_ids);
+    ArrayList cols;
+    for (size_t i = 0; i < action_list_.size(); i++) {
+      cols.clear();
+      for (auto index : action_input_list_[i]) {
+        cols.push_back(in[index]->Slice(offset, length));
+      }
+      RETURN_NOT_OK(action_list_[i]->Evaluate(cols, max_group_id, typed_group_ids));
+    }
+    return arrow::Status::OK();
+  }
+
+  // Output num_groups groups of the keys and the results of the actions, which are reset
+  arrow::Status FinishGroups(const ArrayList& group_keys, int64_t num_groups,
+                             std::shared_ptr<arrow::RecordBatch>* out) {
+    ArrayList result_list;
+    auto action = action_list_.begin();
+    for (auto key : node_keys_) {
+      if (key >= 0) {
+        result_list.push_back(group_keys[key]);
+      } else {
+        RETURN_NOT_OK((*action++)->FinishAndReset(&result_list));
+      }
+    }
+    *out = arrow::RecordBatch::Make(result_schema_, num_groups, result_list);
+    return arrow::Status::OK();
+  }
+
+  class SortedAggregateResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    SortedAggregateResultIterator(Impl* impl) : impl_(impl) {}
+
+    std::string ToString() override { return "SortedAggregateResultIterator"; }
+
+    bool HasNext() override { return !impl_->output_list_.empty() || impl_->open_; }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      if (!impl_->output_list_.empty()) {
+        *out = impl_->output_list_.front();
+        impl_->output_list_.pop_front();
+        return arrow::Status::OK();
+      }
+      return impl_->FinishOpenGroup(out);
+    }
+
+    arrow::Status Process(const ArrayList& in, std::shared_ptr<arrow::RecordBatch>* out,
+                          const std::shared_ptr<arrow::Array>& selection) override {
+      if (selection) {
+        return arrow::Status::NotImplemented(
+            "SortedAggregateResultIterator doesn't support a selection.");
+      }
+      return impl_->Aggregate(in, out);
+    }
+
+   private:
+    Impl* impl_;
+  };
+};
+
+arrow::Status SortedAggregateKernel::Make(
+    arrow::compute::FunctionContext* ctx,
+    std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+    std::vector<std::shared_ptr<gandiva::Node>> action_list,
+    std::shared_ptr<arrow::Schema> result_schema, std::shared_ptr<KernalBase>* out) {
+  *out = std::make_shared<SortedAggregateKernel>(ctx, input_field_list, action_list,
+                                                 result_schema);
+  return arrow::Status::OK();
+}
+
+SortedAggregateKernel::SortedAggregateKernel(
+    arrow::compute::FunctionContext* ctx,
+    std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+    std::vector<std::shared_ptr<gandiva::Node>> action_list,
+    std::shared_ptr<arrow::Schema> result_schema) {
+  impl_.reset(new Impl(ctx, input_field_list, action_list, result_schema));
+  kernel_name_ = "SortedAggregateKernel";
+}
+
+arrow::Status SortedAggregateKernel::Evaluate(const ArrayList& in) {
+  return impl_->Evaluate(in);
+}
+
+arrow::Status SortedAggregateKernel::MakeResultIterator(
+    std::shared_ptr<arrow::Schema> schema,
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+  return impl_->MakeResultIterator(schema, out);
+}
+
+///////////////  Window  ////////////////
+namespace {
+
+enum class WindowFunctionKind { kRowNumber, kRank, kDenseRank, kFrameAggregate };
+
+/// How the results of a frame aggregate over consecutive rows combine into the result
+/// over all of them
+enum class FrameCombine { kSum, kMin, kMax };
+
+template <typename ArrayType>
+auto FrameValue(const ArrayType& array, int64_t i) -> decltype(array.GetView(i)) {
+  return array.GetView(i);
+}
+
+arrow::Decimal128 FrameValue(const arrow::Decimal128Array& array, int64_t i) {
+  return arrow::Decimal128(array.GetValue(i));
+}
+
+// Combine the aggregates of the frame ends of frames into running aggregates, from the
+// start of their partition. resets is 1 at the frame ends starting a partition, carry
+// is the running aggregate of the last batch, for a partition going on here.
+template <typename ArrowType, typename Combine>
+arrow::Status CombineRunningFrames(const arrow::Array& frames,
+                                   const std::vector<uint8_t>& resets,
+                                   arrow::MemoryPool* pool, Combine&& combine,
+                                   std::shared_ptr<arrow::Array>* carry,
+                                   std::shared_ptr<arrow::Array>* out) {
+  using ArrayType = typename arrow::TypeTraits<ArrowType>::ArrayType;
+  using BuilderType = typename arrow::TypeTraits<ArrowType>::BuilderType;
+  using ValueType = decltype(FrameValue(std::declval<const ArrayType&>(), 0));
+  const auto& typed_frames = arrow::internal::checked_cast<const ArrayType&>(frames);
+  std::unique_ptr<arrow::ArrayBuilder> builder;
+  RETURN_NOT_OK(arrow::MakeBuilder(pool, frames.type(), &builder));
+  auto& typed_builder = arrow::internal::checked_cast<BuilderType&>(*builder);
+  RETURN_NOT_OK(typed_builder.Reserve(frames.length()));
+  ValueType running{};
+  bool valid = false;
+  if (*carry && !resets[0]) {
+    const auto& typed_carry = arrow::internal::checked_cast<const ArrayType&>(**carry);
+    valid = typed_carry.IsValid(0);
+    if (valid) running = FrameValue(typed_carry, 0);
+  }
+  for (int64_t i = 0; i < frames.length(); i++) {
+    if (resets[i]) {
+      valid = false;
+    }
+    if (typed_frames.IsValid(i)) {
+      ValueType value = FrameValue(typed_frames, i);
+      running = valid ? combine(running, value) : value;
+      valid = true;
+    }
+    if (valid) {
+      RETURN_NOT_OK(typed_builder.Append(running));
+    } else {
+      RETURN_NOT_OK(typed_builder.AppendNull());
+    }
+  }
+  RETURN_NOT_OK(typed_builder.Finish(out));
+  *carry = (*out)->Slice((*out)->length() - 1, 1);
+  return arrow::Status::OK();
+}
+
+template <typename ArrowType>
+arrow::Status CombineRunningFrames(FrameCombine combine, const arrow::Array& frames,
+                                   const std::vector<uint8_t>& resets,
+                                   arrow::MemoryPool* pool,
+                                   std::shared_ptr<arrow::Array>* carry,
+                                   std::shared_ptr<arrow::Array>* out) {
+  using ArrayType = typename arrow::TypeTraits<ArrowType>::ArrayType;
+  using ValueType = decltype(FrameValue(std::declval<const ArrayType&>(), 0));
+  switch (combine) {
+    case FrameCombine::kSum:
+      return CombineRunningFrames<ArrowType>(
+          frames, resets, pool,
+          [](const ValueType& a, const ValueType& b) -> ValueType {
+            ValueType sum = a;
+            sum += b;
+            return sum;
+          },
+          carry, out);
+    case FrameCombine::kMin:
+      return CombineRunningFrames<ArrowType>(
+          frames, resets, pool,
+          [](const ValueType& a, const ValueType& b) -> ValueType {
+            return b < a ? b : a;
+          },
+          carry, out);
+    case FrameCombine::kMax:
+      return CombineRunningFrames<ArrowType>(
+          frames, resets, pool,
+          [](const ValueType& a, const ValueType& b) -> ValueType {
+            return a < b ? b : a;
+          },
+          carry, out);
+  }
+  return arrow::Status::OK();
+}
+
+arrow::Status CombineRunningFrames(FrameCombine combine, const arrow::Array& frames,
+                                   const std::vector<uint8_t>& resets,
+                                   arrow::MemoryPool* pool,
+                                   std::shared_ptr<arrow::Array>* carry,
+                                   std::shared_ptr<arrow::Array>* out) {
+  switch (frames.type_id()) {
+#define PROCESS(InType)                                                            \
+  case InType::type_id:                                                            \
+    return CombineRunningFrames<InType>(combine, frames, resets, pool, carry, out);
+    PROCESS(arrow::UInt8Type)
+    PROCESS(arrow::Int8Type)
+    PROCESS(arrow::UInt16Type)
+    PROCESS(arrow::Int16Type)
+    PROCESS(arrow::UInt32Type)
+    PROCESS(arrow::Int32Type)
+    PROCESS(arrow::UInt64Type)
+    PROCESS(arrow::Int64Type)
+    PROCESS(arrow::FloatType)
+    PROCESS(arrow::DoubleType)
+    PROCESS(arrow::Date32Type)
+    PROCESS(arrow::Decimal128Type)
+#undef PROCESS
+    default:
+      return arrow::Status::NotImplemented("Running window aggregates of ",
+                                           frames.type()->ToString(),
+                                           " are not supported.");
+  }
+}
+
+}  // namespace
+
+class WindowKernel::Impl {
+ public:
+  Impl(arrow::compute::FunctionContext* ctx,
+       std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+       std::vector<std::shared_ptr<gandiva::Node>> action_list,
+       std::shared_ptr<arrow::Schema> result_schema)
+      : ctx_(ctx), result_schema_(result_schema), scratch_pool_(ctx->memory_pool()) {
+    THROW_NOT_OK(InitFunctionList(arrow::schema(input_field_list), action_list));
+  }
+
+  arrow::Status InitFunctionList(
+      std::shared_ptr<arrow::Schema> input_schema,
+      std::vector<std::shared_ptr<gandiva::Node>> action_list) {
+    for (const auto& node : action_list) {
+      auto func_node = std::dynamic_pointer_cast<gandiva::FunctionNode>(node);
+      if (!func_node) {
+        return arrow::Status::Invalid("WindowKernel expects function nodes, got ",
+                                      node->ToString());
+      }
+      auto name = func_node->descriptor()->name();
+      std::vector<int> input_indices;
+      for (const auto& child : func_node->children()) {
+        auto field_node = std::dynamic_pointer_cast<gandiva::FieldNode>(child);
+        auto index =
+            field_node ? input_schema->GetFieldIndex(field_node->field()->name()) : -1;
+        if (index < 0) {
+          return arrow::Status::NotImplemented(
+              "WindowKernel expects input fields as the children of ", name, ", got ",
+              child->ToString());
+        }
+        input_indices.push_back(index);
+      }
+      if (name == "action_partitionby" || name == "action_orderby") {
+        if (input_indices.size() != 1) {
+          return arrow::Status::Invalid(name, " expects one key field");
+        }
+        auto& keys = name == "action_partitionby" ? partition_indices_ : order_indices_;
+        keys.push_back(input_indices[0]);
+        continue;
+      }
+      if (name == "window_row_number") {
+        function_list_.push_back({WindowFunctionKind::kRowNumber});
+        continue;
+      }
+      if (name == "window_rank") {
+        function_list_.push_back({WindowFunctionKind::kRank});
+        continue;
+      }
+      if (name == "window_dense_rank") {
+        function_list_.push_back({WindowFunctionKind::kDenseRank});
+        continue;
+      }
+      FrameCombine combine;
+      if (name == "action_sum" || name == "action_count" ||
+          name.compare(0, 20, "action_countLiteral_") == 0) {
+        combine = FrameCombine::kSum;
+      } else if (name == "action_min") {
+        combine = FrameCombine::kMin;
+      } else if (name == "action_max") {
+        combine = FrameCombine::kMax;
+      } else {
+        return arrow::Status::NotImplemented(name, " is not supported by WindowKernel.");
+      }
+      std::shared_ptr<arrow::DataType> type;
+      if (!input_indices.empty()) {
+        type = input_schema->field(input_indices[0])->type();
+      }
+      std::shared_ptr<ActionBase> action;
+      RETURN_NOT_OK(MakeAction(ctx_, name, type, func_node->return_type(), &action));
+      if (!action) {
+        return arrow::Status::NotImplemented(name,
+                                             " is not supported for its input type.");
+      }
+      if (action->RequiredColNum() != static_cast<int>(input_indices.size())) {
+        return arrow::Status::Invalid(name, " expects ", action->RequiredColNum(),
+                                      " input fields, got ", input_indices.size());
+      }
+      function_list_.push_back(
+          {WindowFunctionKind::kFrameAggregate, static_cast<int>(action_list_.size())});
+      action_list_.push_back(action);
+      action_combine_list_.push_back(combine);
+      action_input_list_.push_back(input_indices);
+    }
+    carry_list_.resize(action_list_.size());
+    num_input_fields_ = input_schema->num_fields();
+    if (result_schema_->num_fields() !=
+        num_input_fields_ + static_cast<int>(function_list_.size())) {
+      return arrow::Status::Invalid(
+          "WindowKernel expects the input fields then one field per window function as "
+          "its result, got ",
+          result_schema_->ToString());
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Evaluate(const ArrayList& in) {
+    std::shared_ptr<arrow::RecordBatch> out;
+    RETURN_NOT_OK(Window(in, false, &out));
+    if (out) {
+      output_list_.push_back(out);
+    }
+    return arrow::Status::OK();
+  }
+
+  /// \brief Add a batch to the rows waiting for the end of their frame, then output the
+  /// rows whose frame ends
+  ///
+  /// out is null if no frame ends. With finish the input is over, in may be empty, and
+  /// the rows waiting are all output.
+  arrow::Status Window(const ArrayList& in, bool finish,
+                       std::shared_ptr<arrow::RecordBatch>* out) {
+    *out = nullptr;
+    ArrayList rows;
+    if (pending_.empty()) {
+      rows = in;
+    } else if (in.empty() || in[0]->length() == 0) {
+      rows = pending_;
+    } else {
+      for (size_t i = 0; i < in.size(); i++) {
+        std::shared_ptr<arrow::Array> concatenated;
+        RETURN_NOT_OK(
+            arrow::Concatenate({pending_[i], in[i]}, ctx_->memory_pool(), &concatenated));
+        rows.push_back(concatenated);
+      }
+    }
+    auto length = rows.empty() ? 0 : rows[0]->length();
+    if (length == 0) {
+      return arrow::Status::OK();
+    }
+    // the frame ids of the last batch are freed
+    scratch_pool_.Reset();
+    // 1 at the rows starting a partition, the first one going on the partition of the
+    // last row output if its keys are the same
+    std::vector<uint8_t> partition_starts(length, 0);
+    for (auto index : partition_indices_) {
+      MarkKeyChanges(*rows[index], &partition_starts);
+    }
+    partition_starts[0] = !has_output_;
+    for (size_t i = 0; has_output_ && i < partition_indices_.size(); i++) {
+      partition_starts[0] |=
+          !last_partition_keys_[i]->RangeEquals(*rows[partition_indices_[i]], 0, 1, 0);
+    }
+    // 1 at the rows starting the rows of the same order keys, which end the same
+    // frame. Rows wait for the end of their frame, so the first one starts its own.
+    std::vector<uint8_t> peer_starts = partition_starts;
+    for (auto index : order_indices_) {
+      MarkKeyChanges(*rows[index], &peer_starts);
+    }
+    peer_starts[0] = 1;
+    const auto& frame_starts = order_indices_.empty() ? partition_starts : peer_starts;
+
+    // the rows of the last frame may go on in the next batch
+    int64_t end = length;
+    if (!finish) {
+      end = 0;
+      for (int64_t i = length - 1; i > 0; i--) {
+        if (frame_starts[i]) {
+          end = i;
+          break;
+        }
+      }
+    }
+    if (end > 0) {
+      RETURN_NOT_OK(WindowRows(rows, end, partition_starts, peer_starts, out));
+      last_partition_keys_.clear();
+      for (auto index : partition_indices_) {
+        last_partition_keys_.push_back(rows[index]->Slice(end - 1, 1));
+      }
+      has_output_ = true;
+    }
+    pending_.clear();
+    if (end < length) {
+      for (const auto& row : rows) {
+        pending_.push_back(row->Slice(end));
+      }
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+    *out = std::make_shared<WindowResultIterator>(this);
+    return arrow::Status::OK();
+  }
+
+ private:
+  struct WindowFunction {
+    WindowFunctionKind kind;
+    // index in action_list_ of a frame aggregate
+    int action;
+  };
+
+  arrow::compute::FunctionContext* ctx_;
+  std::shared_ptr<arrow::Schema> result_schema_;
+  int num_input_fields_ = 0;
+  std::vector<int> partition_indices_;
+  std::vector<int> order_indices_;
+  std::vector<WindowFunction> function_list_;
+  std::vector<std::shared_ptr<ActionBase>> action_list_;
+  std::vector<std::vector<int>> action_input_list_;
+  std::vector<FrameCombine> action_combine_list_;
+  // the rows waiting for the end of their frame
+  ArrayList pending_;
+  // the partition keys of the last row output, and the state of its partition
+  bool has_output_ = false;
+  ArrayList last_partition_keys_;
+  int32_t row_number_ = 0;
+  int32_t rank_ = 0;
+  int32_t dense_rank_ = 0;
+  // by action, the running aggregate of the last row output
+  ArrayList carry_list_;
+  // the rows ended by the batches of Evaluate
+  std::deque<std::shared_ptr<arrow::RecordBatch>> output_list_;
+  // transient arrays of a batch
+  ArenaMemoryPool scratch_pool_;
+
+  // Output the first length rows, followed by their window functions
+  arrow::Status WindowRows(const ArrayList& rows, int64_t length,
+                           const std::vector<uint8_t>& partition_starts,
+                           const std::vector<uint8_t>& peer_starts,
+                           std::shared_ptr<arrow::RecordBatch>* out) {
+    std::vector<int32_t> row_numbers(length);
+    std::vector<int32_t> ranks(length);
+    std::vector<int32_t> dense_ranks(length);
+    for (int64_t i = 0; i < length; i++) {
+      if (partition_starts[i]) {
+        row_number_ = 0;
+        dense_rank_ = 0;
+      }
+      ++row_number_;
+      if (peer_starts[i]) {
+        rank_ = row_number_;
+        ++dense_rank_;
+      }
+      row_numbers[i] = row_number_;
+      ranks[i] = rank_;
+      dense_ranks[i] = dense_rank_;
+    }
+
+    ArrayList frame_results;
+    RETURN_NOT_OK(AggregateFrames(rows, length, partition_starts, peer_starts,
+                                  &frame_results));
+
+    ArrayList result_list;
+    for (int i = 0; i < num_input_fields_; i++) {
+      result_list.push_back(rows[i]->Slice(0, length));
+    }
+    for (const auto& function : function_list_) {
+      const std::vector<int32_t>* values = nullptr;
+      switch (function.kind) {
+        case WindowFunctionKind::kRowNumber:
+          values = &row_numbers;
+          break;
+        case WindowFunctionKind::kRank:
+          values = &ranks;
+          break;
+        case WindowFunctionKind::kDenseRank:
+          values = &dense_ranks;
+          break;
+        case WindowFunctionKind::kFrameAggregate:
+          result_list.push_back(frame_results[function.action]);
+          continue;
+      }
+      arrow::Int32Builder builder(ctx_->memory_pool());
+      RETURN_NOT_OK(builder.AppendValues(*values));
+      std::shared_ptr<arrow::Array> array;
+      RETURN_NOT_OK(builder.Finish(&array));
+      result_list.push_back(array);
+    }
+    *out = arrow::RecordBatch::Make(result_schema_, length, result_list);
+    return arrow::Status::OK();
+  }
+
+  // Aggregate the frame of each of the first length rows, one group per frame end
+  arrow::Status AggregateFrames(const ArrayList& rows, int64_t length,
+                                const std::vector<uint8_t>& partition_starts,
+                                const std::vector<uint8_t>& peer_starts,
+                                ArrayList* out) {
+    if (action_list_.empty()) {
+      return arrow::Status::OK();
+    }
+    const auto& frame_starts = order_indices_.empty() ? partition_starts : peer_starts;
+    arrow::Int32Builder frame_id_builder(&scratch_pool_);
+    RETURN_NOT_OK(frame_id_builder.Resize(length));
+    // by frame end, whether it starts a partition
+    std::vector<uint8_t> resets;
+    int32_t frame_id = -1;
+    for (int64_t i = 0; i < length; i++) {
+      if (frame_starts[i]) {
+        ++frame_id;
+        resets.push_back(partition_starts[i]);
+      }
+      frame_id_builder.UnsafeAppend(frame_id);
+    }
+    std::shared_ptr<arrow::Array> frame_ids;
+    RETURN_NOT_OK(frame_id_builder.Finish(&frame_ids));
+    const auto& typed_frame_ids =
+        arrow::internal::checked_cast<const arrow::Int32Array&>(*frame_ids);
+
+    ArrayList cols;
+    for (size_t i = 0; i < action_list_.size(); i++) {
+      cols.clear();
+      for (auto index : action_input_list_[i]) {
+        cols.push_back(rows[index]->Slice(0, length));
+      }
+      RETURN_NOT_OK(action_list_[i]->Evaluate(cols, frame_id, typed_frame_ids));
+      ArrayList frames;
+      RETURN_NOT_OK(action_list_[i]->FinishAndReset(&frames));
+      auto frame_results = frames[0];
+      // without order keys the frame is the whole partition, ended by one group
+      if (!order_indices_.empty()) {
+        RETURN_NOT_OK(CombineRunningFrames(action_combine_list_[i], *frames[0], resets,
+                                           ctx_->memory_pool(), &carry_list_[i],
+                                           &frame_results));
+      }
+      std::shared_ptr<arrow::Array> taken;
+      RETURN_NOT_OK(arrow::compute::Take(ctx_, *frame_results, *frame_ids,
+                                         arrow::compute::TakeOptions(), &taken));
+      out->push_back(taken);
+    }
+    return arrow::Status::OK();
+  }
+
+  class WindowResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    WindowResultIterator(Impl* impl) : impl_(impl) {}
+
+    std::string ToString() override { return "WindowResultIterator"; }
+
+    bool HasNext() override {
+      return !impl_->output_list_.empty() || !impl_->pending_.empty();
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      if (!impl_->output_list_.empty()) {
+        *out = impl_->output_list_.front();
+        impl_->output_list_.pop_front();
+        return arrow::Status::OK();
+      }
+      return impl_->Window({}, true, out);
+    }
+
+    arrow::Status Process(const ArrayList& in, std::shared_ptr<arrow::RecordBatch>* out,
+                          const std::shared_ptr<arrow::Array>& selection) override {
+      if (selection) {
+        return arrow::Status::NotImplemented(
+            "WindowResultIterator doesn't support a selection.");
+      }
+      return impl_->Window(in, false, out);
+    }
+
+   private:
+    Impl* impl_;
+  };
+};
+
+arrow::Status WindowKernel::Make(
+    arrow::compute::FunctionContext* ctx,
+    std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+    std::vector<std::shared_ptr<gandiva::Node>> action_list,
+    std::shared_ptr<arrow::Schema> result_schema, std::shared_ptr<KernalBase>* out) {
+  *out = std::make_shared<WindowKernel>(ctx, input_field_list, action_list,
+                                        result_schema);
+  return arrow::Status::OK();
+}
+
+WindowKernel::WindowKernel(arrow::compute::FunctionContext* ctx,
+                           std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+                           std::vector<std::shared_ptr<gandiva::Node>> action_list,
+                           std::shared_ptr<arrow::Schema> result_schema) {
+  impl_.reset(new Impl(ctx, input_field_list, action_list, result_schema));
+  kernel_name_ = "WindowKernel";
+}
+
+arrow::Status WindowKernel::Evaluate(const ArrayList& in) { return impl_->Evaluate(in); }
+
+arrow::Status WindowKernel::MakeResultIterator(
+    std::shared_ptr<arrow::Schema> schema,
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+  return impl_->MakeResultIterator(schema, out);
+}
+
 ///////////////  UniqueArray  ////////////////
 /*class UniqueArrayKernel::Impl {
  public:
@@ -328,6 +1239,95 @@ arrow::Status UniqueArrayKernel::Finish(std::shared_ptr<arrow::Array>* out) {
   PROCESS(arrow::FloatType)              \
   PROCESS(arrow::DoubleType)
 
+// Result type of arrow::compute::Sum
+template <typename I, typename Enable = void>
+struct SumResultType {};
+
+template <typename I>
+struct SumResultType<I, arrow::enable_if_signed_integer<I>> {
+  using Type = arrow::Int64Type;
+};
+
+template <typename I>
+struct SumResultType<I, arrow::enable_if_unsigned_integer<I>> {
+  using Type = arrow::UInt64Type;
+};
+
+template <typename I>
+struct SumResultType<I, arrow::enable_if_floating_point<I>> {
+  using Type = arrow::DoubleType;
+};
+
+// validity of the reductions, null if all the values are valid
+static const uint8_t* ReduceValidBits(const arrow::Array& in) {
+  return in.null_count() == 0 ? nullptr : in.null_bitmap_data();
+}
+
+/// Sum the valid values of in as arrow::compute::Sum, in lanes for the primitive types
+/// and with arrow::compute::Sum for the others
+static arrow::Status SumArray(arrow::compute::FunctionContext* ctx,
+                              const arrow::Array& in,
+                              std::shared_ptr<arrow::Scalar>* out) {
+  switch (in.type_id()) {
+#define PROCESS(DataType)                                                          \
+  case DataType::type_id: {                                                        \
+    using CType = typename arrow::TypeTraits<DataType>::CType;                     \
+    using ResCType =                                                               \
+        typename arrow::TypeTraits<typename SumResultType<DataType>::Type>::CType; \
+    *out = arrow::MakeScalar(SumValues<ResCType>(in.data()->GetValues<CType>(1),   \
+                                                 ReduceValidBits(in), in.offset(), \
+                                                 in.length()));                    \
+    return arrow::Status::OK();                                                    \
+  }
+    PROCESS_SUPPORTED_TYPES(PROCESS)
+#undef PROCESS
+    default:
+      break;
+  }
+  arrow::compute::Datum output;
+  RETURN_NOT_OK(arrow::compute::Sum(ctx, in, &output));
+  *out = output.scalar();
+  return arrow::Status::OK();
+}
+
+/// Take the minimum, or the maximum if max, of the valid values of in, in lanes for the
+/// primitive types and with arrow::compute::MinMax for the others. Null if there are no
+/// valid values of a primitive type.
+static arrow::Status MinMaxArray(arrow::compute::FunctionContext* ctx,
+                                 const arrow::Array& in, bool max,
+                                 std::shared_ptr<arrow::Scalar>* out) {
+  switch (in.type_id()) {
+#define PROCESS(DataType)                                                              \
+  case DataType::type_id: {                                                            \
+    using CType = typename arrow::TypeTraits<DataType>::CType;                         \
+    *out = nullptr;                                                                    \
+    if (in.null_count() < in.length()) {                                               \
+      auto values = in.data()->GetValues<CType>(1);                                    \
+      *out = arrow::MakeScalar(                                                        \
+          max ? MaxValues(values, ReduceValidBits(in), in.offset(), in.length())       \
+              : MinValues(values, ReduceValidBits(in), in.offset(), in.length()));     \
+    }                                                                                  \
+    return arrow::Status::OK();                                                        \
+  }
+    PROCESS_SUPPORTED_TYPES(PROCESS)
+#undef PROCESS
+    default:
+      break;
+  }
+  arrow::compute::Datum minMaxOut;
+  arrow::compute::MinMaxOptions option;
+  RETURN_NOT_OK(arrow::compute::MinMax(ctx, option, in, &minMaxOut));
+  if (!minMaxOut.is_collection()) {
+    return arrow::Status::Invalid("MinMax return an invalid result.");
+  }
+  auto col = minMaxOut.collection();
+  if (col.size() < 2) {
+    return arrow::Status::Invalid("MinMax return an invalid result.");
+  }
+  *out = col[max ? 1 : 0].scalar();
+  return arrow::Status::OK();
+}
+
 ///////////////  SumArray  ////////////////
 class SumArrayKernel::Impl {
  public:
@@ -335,10 +1335,10 @@ class SumArrayKernel::Impl {
       : ctx_(ctx), data_type_(data_type) {}
   ~Impl() {}
   arrow::Status Evaluate(const ArrayList& in) {
-    arrow::compute::Datum output;
-    RETURN_NOT_OK(arrow::compute::Sum(ctx_, *in[0].get(), &output));
-    res_data_type_ = output.scalar()->type;
-    scalar_list_.push_back(output.scalar());
+    std::shared_ptr<arrow::Scalar> output;
+    RETURN_NOT_OK(SumArray(ctx_, *in[0], &output));
+    res_data_type_ = output->type;
+    scalar_list_.push_back(output);
     return arrow::Status::OK();
   }
 
@@ -404,10 +1404,9 @@ class CountArrayKernel::Impl {
       : ctx_(ctx), data_type_(data_type) {}
   ~Impl() {}
   arrow::Status Evaluate(const ArrayList& in) {
-    arrow::compute::Datum output;
-    arrow::compute::CountOptions option(arrow::compute::CountOptions::COUNT_ALL);
-    RETURN_NOT_OK(arrow::compute::Count(ctx_, option, *in[0].get(), &output));
-    scalar_list_.push_back(output.scalar());
+    // the null count is a popcount of the validity, cached by the array
+    int64_t count = in[0]->length() - in[0]->null_count();
+    scalar_list_.push_back(arrow::MakeScalar(count));
     return arrow::Status::OK();
   }
 
@@ -465,14 +1464,12 @@ class SumCountArrayKernel::Impl {
       : ctx_(ctx), data_type_(data_type) {}
   ~Impl() {}
   arrow::Status Evaluate(const ArrayList& in) {
-    arrow::compute::Datum sum_out;
-    arrow::compute::Datum cnt_out;
-    arrow::compute::CountOptions option(arrow::compute::CountOptions::COUNT_ALL);
-    RETURN_NOT_OK(arrow::compute::Sum(ctx_, *in[0].get(), &sum_out));
-    RETURN_NOT_OK(arrow::compute::Count(ctx_, option, *in[0].get(), &cnt_out));
-    res_data_type_ = sum_out.scalar()->type;
-    sum_scalar_list_.push_back(sum_out.scalar());
-    cnt_scalar_list_.push_back(cnt_out.scalar());
+    std::shared_ptr<arrow::Scalar> sum_out;
+    RETURN_NOT_OK(SumArray(ctx_, *in[0], &sum_out));
+    int64_t count = in[0]->length() - in[0]->null_count();
+    res_data_type_ = sum_out->type;
+    sum_scalar_list_.push_back(sum_out);
+    cnt_scalar_list_.push_back(arrow::MakeScalar(count));
     return arrow::Status::OK();
   }
 
@@ -552,14 +1549,14 @@ class AvgByCountArrayKernel::Impl {
       : ctx_(ctx), data_type_(data_type) {}
   ~Impl() {}
   arrow::Status Evaluate(const ArrayList& in) {
-    arrow::compute::Datum sum_out;
-    arrow::compute::Datum cnt_out;
-    RETURN_NOT_OK(arrow::compute::Sum(ctx_, *in[0].get(), &sum_out));
-    RETURN_NOT_OK(arrow::compute::Sum(ctx_, *in[1].get(), &cnt_out));
-    sum_scalar_list_.push_back(sum_out.scalar());
-    cnt_scalar_list_.push_back(cnt_out.scalar());
-    sum_res_data_type_ = sum_out.scalar()->type;
-    cnt_res_data_type_ = cnt_out.scalar()->type;
+    std::shared_ptr<arrow::Scalar> sum_out;
+    std::shared_ptr<arrow::Scalar> cnt_out;
+    RETURN_NOT_OK(SumArray(ctx_, *in[0], &sum_out));
+    RETURN_NOT_OK(SumArray(ctx_, *in[1], &cnt_out));
+    sum_scalar_list_.push_back(sum_out);
+    cnt_scalar_list_.push_back(cnt_out);
+    sum_res_data_type_ = sum_out->type;
+    cnt_res_data_type_ = cnt_out->type;
     return arrow::Status::OK();
   }
 
@@ -647,18 +1644,12 @@ class MinArrayKernel::Impl {
       : ctx_(ctx), data_type_(data_type) {}
   ~Impl() {}
   arrow::Status Evaluate(const ArrayList& in) {
-    arrow::compute::Datum minMaxOut;
-    arrow::compute::MinMaxOptions option;
-    RETURN_NOT_OK(arrow::compute::MinMax(ctx_, option, *in[0].get(), &minMaxOut));
-    if (!minMaxOut.is_collection()) {
-      return arrow::Status::Invalid("MinMax return an invalid result.");
-    }
-    auto col = minMaxOut.collection();
-    if (col.size() < 2) {
-      return arrow::Status::Invalid("MinMax return an invalid result.");
+    std::shared_ptr<arrow::Scalar> min;
+    RETURN_NOT_OK(MinMaxArray(ctx_, *in[0], /*max=*/false, &min));
+    // batches of nulls only have no min
+    if (min != nullptr) {
+      scalar_list_.push_back(min);
     }
-    auto min = col[0].scalar();
-    scalar_list_.push_back(min);
     return arrow::Status::OK();
   }
 
@@ -678,6 +1669,13 @@ class MinArrayKernel::Impl {
   arrow::Status FinishInternal(ArrayList* out) {
     using CType = typename arrow::TypeTraits<DataType>::CType;
     using ScalarType = typename arrow::TypeTraits<DataType>::ScalarType;
+    if (scalar_list_.empty()) {
+      // no valid value in any batch
+      std::shared_ptr<arrow::Array> arr_out;
+      RETURN_NOT_OK(arrow::MakeArrayOfNull(data_type_, 1, &arr_out));
+      out->push_back(arr_out);
+      return arrow::Status::OK();
+    }
     auto typed_scalar = std::dynamic_pointer_cast<ScalarType>(scalar_list_[0]);
     CType res = typed_scalar->value;
     for (size_t i = 1; i < scalar_list_.size(); i++) {
@@ -725,18 +1723,12 @@ class MaxArrayKernel::Impl {
       : ctx_(ctx), data_type_(data_type) {}
   ~Impl() {}
   arrow::Status Evaluate(const ArrayList& in) {
-    arrow::compute::Datum minMaxOut;
-    arrow::compute::MinMaxOptions option;
-    RETURN_NOT_OK(arrow::compute::MinMax(ctx_, option, *in[0].get(), &minMaxOut));
-    if (!minMaxOut.is_collection()) {
-      return arrow::Status::Invalid("MinMax return an invalid result.");
-    }
-    auto col = minMaxOut.collection();
-    if (col.size() < 2) {
-      return arrow::Status::Invalid("MinMax return an invalid result.");
+    std::shared_ptr<arrow::Scalar> max;
+    RETURN_NOT_OK(MinMaxArray(ctx_, *in[0], /*max=*/true, &max));
+    // batches of nulls only have no max
+    if (max != nullptr) {
+      scalar_list_.push_back(max);
     }
-    auto max = col[1].scalar();
-    scalar_list_.push_back(max);
     return arrow::Status::OK();
   }
 
@@ -756,6 +1748,13 @@ class MaxArrayKernel::Impl {
   arrow::Status FinishInternal(ArrayList* out) {
     using CType = typename arrow::TypeTraits<DataType>::CType;
     using ScalarType = typename arrow::TypeTraits<DataType>::ScalarType;
+    if (scalar_list_.empty()) {
+      // no valid value in any batch
+      std::shared_ptr<arrow::Array> arr_out;
+      RETURN_NOT_OK(arrow::MakeArrayOfNull(data_type_, 1, &arr_out));
+      out->push_back(arr_out);
+      return arrow::Status::OK();
+    }
     auto typed_scalar = std::dynamic_pointer_cast<ScalarType>(scalar_list_[0]);
     CType res = typed_scalar->value;
     for (size_t i = 1; i < scalar_list_.size(); i++) {
@@ -910,61 +1909,30 @@ class HashArrayKernel::Impl {
  public:
   Impl(arrow::compute::FunctionContext* ctx,
        std::vector<std::shared_ptr<arrow::DataType>> type_list)
-      : ctx_(ctx) {
-    // create a new result array type here
-    std::vector<std::shared_ptr<gandiva::Node>> func_node_list = {};
-    std::vector<std::shared_ptr<arrow::Field>> field_list = {};
-
-    gandiva::ExpressionPtr expr;
-    int index = 0;
-    for (auto type : type_list) {
-      auto field = arrow::field(std::to_string(index), type);
-      field_list.push_back(field);
-      auto field_node = gandiva::TreeExprBuilder::MakeField(field);
-      auto func_node =
-          gandiva::TreeExprBuilder::MakeFunction("hash32", {field_node}, arrow::int32());
-      func_node_list.push_back(func_node);
-      if (func_node_list.size() == 2) {
-        auto shift_func_node = gandiva::TreeExprBuilder::MakeFunction(
-            "multiply",
-            {func_node_list[0], gandiva::TreeExprBuilder::MakeLiteral((int32_t)10)},
-            arrow::int32());
-        auto tmp_func_node = gandiva::TreeExprBuilder::MakeFunction(
-            "add", {shift_func_node, func_node_list[1]}, arrow::int32());
-        func_node_list.clear();
-        func_node_list.push_back(tmp_func_node);
-      }
-      index++;
-    }
-    expr = gandiva::TreeExprBuilder::MakeExpression(func_node_list[0],
-                                                    arrow::field("res", arrow::int32()));
-    std::cout << expr->ToString() << std::endl;
-    schema_ = arrow::schema(field_list);
-    auto configuration = gandiva::ConfigurationBuilder().DefaultConfiguration();
-    auto status = gandiva::Projector::Make(schema_, {expr}, configuration, &projector);
-    pool_ = ctx_->memory_pool();
-  }
+      : ctx_(ctx), pool_(ctx_->memory_pool()) {}
 
   arrow::Status Evaluate(const ArrayList& in, std::shared_ptr<arrow::Array>* out) {
     auto length = in[0]->length();
-    auto num_columns = in.size();
-
-    auto in_batch = arrow::RecordBatch::Make(schema_, length, in);
-    // arrow::PrettyPrintOptions print_option(2, 500);
-    // arrow::PrettyPrint(*in_batch.get(), print_option, &std::cout);
-
-    arrow::ArrayVector outputs;
-    RETURN_NOT_OK(projector->Evaluate(*in_batch, pool_, &outputs));
-    *out = outputs[0];
+    // column at a time, each key is mixed into the hash of the previous ones
+    hashes_.resize(length);
+    for (size_t i = 0; i < in.size(); ++i) {
+      RETURN_NOT_OK(fasthash::HashColumn(*in[i], i > 0, hashes_.data()));
+    }
 
+    std::shared_ptr<arrow::Buffer> buffer;
+    ARROW_ASSIGN_OR_RAISE(buffer, arrow::AllocateBuffer(length * sizeof(int32_t), pool_));
+    auto values = reinterpret_cast<int32_t*>(buffer->mutable_data());
+    for (int64_t i = 0; i < length; ++i) {
+      values[i] = static_cast<int32_t>(hashes_[i] ^ (hashes_[i] >> 32));
+    }
+    *out = std::make_shared<arrow::Int32Array>(length, buffer);
     return arrow::Status::OK();
   }
 
  private:
   arrow::compute::FunctionContext* ctx_;
-  std::shared_ptr<gandiva::Projector> projector;
-  std::shared_ptr<arrow::Schema> schema_;
   arrow::MemoryPool* pool_;
+  std::vector<uint64_t> hashes_;
 };
 
 arrow::Status HashArrayKernel::Make(
@@ -987,6 +1955,215 @@ arrow::Status HashArrayKernel::Evaluate(const ArrayList& in,
   return impl_->Evaluate(in, out);
 }
 
+///////////////  NormalizeKeys  ////////////////
+namespace {
+
+// Bytes of a value of a fixed-width type, 0 for variable-width types
+int NormalizedWidth(const arrow::DataType& type) {
+  if (type.id() == arrow::Type::BOOL) {
+    return 1;
+  }
+  if (type.id() == arrow::Type::DICTIONARY) {
+    // the indices of different batches don't compare
+    return 0;
+  }
+  auto fixed_width = dynamic_cast<const arrow::FixedWidthType*>(&type);
+  return fixed_width == nullptr ? 0 : fixed_width->bit_width() / 8;
+}
+
+}  // namespace
+
+class NormalizeKeysKernel::Impl {
+ public:
+  Impl(arrow::compute::FunctionContext* ctx,
+       std::vector<std::shared_ptr<arrow::DataType>> type_list)
+      : ctx_(ctx), null_bytes_((type_list.size() + 7) / 8) {
+    fixed_bytes_ = null_bytes_;
+    for (const auto& type : type_list) {
+      auto width = NormalizedWidth(*type);
+      if (type->id() == arrow::Type::BOOL) {
+        kinds_.push_back(kBool);
+      } else if (width > 0) {
+        kinds_.push_back(kFixedWidth);
+      } else {
+        kinds_.push_back(kVarWidth);
+        // the length of the value
+        width = sizeof(int32_t);
+        has_var_width_ = true;
+      }
+      widths_.push_back(width);
+      fixed_bytes_ += width;
+    }
+    type_list_ = std::move(type_list);
+  }
+
+  arrow::Status Evaluate(const ArrayList& in, std::shared_ptr<arrow::Array>* out) {
+    if (in.size() != type_list_.size()) {
+      return arrow::Status::Invalid("Expected ", type_list_.size(), " key columns, got ",
+                                    in.size());
+    }
+    for (size_t c = 0; c < in.size(); ++c) {
+      const auto& type = *in[c]->type();
+      if (type.id() != type_list_[c]->id() ||
+          NormalizedWidth(type) != NormalizedWidth(*type_list_[c])) {
+        return arrow::Status::Invalid("Key column ", c, " is ", type.ToString(),
+                                      ", expected ", type_list_[c]->ToString());
+      }
+      if (kinds_[c] == kVarWidth && type.id() != arrow::Type::STRING &&
+          type.id() != arrow::Type::BINARY) {
+        return arrow::Status::NotImplemented("Can't normalize keys of type ",
+                                             type.ToString());
+      }
+    }
+    auto length = in.empty() ? 0 : in[0]->length();
+    if (!has_var_width_ && fixed_bytes_ <= static_cast<int64_t>(sizeof(int64_t))) {
+      return EvaluateWord(in, length, out);
+    }
+    return EvaluateBinary(in, length, out);
+  }
+
+ private:
+  enum Kind { kBool, kFixedWidth, kVarWidth };
+
+  // Set the null bit of column c, or write its fixed-width part of row i at out. Return
+  // the length of a variable-width value, which the caller writes.
+  int32_t WriteColumn(const arrow::Array& array, int64_t i, size_t c, uint8_t* null_bits,
+                      uint8_t* out) const {
+    const auto& data = *array.data();
+    if (array.IsNull(i)) {
+      arrow::BitUtil::SetBit(null_bits, c);
+      return 0;
+    }
+    auto values = data.buffers[1]->data();
+    switch (kinds_[c]) {
+      case kBool:
+        *out = arrow::BitUtil::GetBit(values, data.offset + i) ? 1 : 0;
+        return 0;
+      case kFixedWidth:
+        std::memcpy(out, values + (data.offset + i) * widths_[c], widths_[c]);
+        return 0;
+      case kVarWidth:
+      default:
+        break;
+    }
+    // the value follows the fixed-width part of the row
+    auto offsets = reinterpret_cast<const int32_t*>(values) + data.offset;
+    int32_t value_length = offsets[i + 1] - offsets[i];
+    std::memcpy(out, &value_length, sizeof(int32_t));
+    return value_length;
+  }
+
+  arrow::Status EvaluateWord(const ArrayList& in, int64_t length,
+                             std::shared_ptr<arrow::Array>* out) {
+    ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> buffer,
+                          arrow::AllocateBuffer(length * sizeof(int64_t),
+                                                ctx_->memory_pool()));
+    auto rows = buffer->mutable_data();
+    std::memset(rows, 0, length * sizeof(int64_t));
+    for (int64_t i = 0; i < length; ++i) {
+      auto row = rows + i * sizeof(int64_t);
+      auto offset = null_bytes_;
+      for (size_t c = 0; c < in.size(); ++c) {
+        WriteColumn(*in[c], i, c, row, row + offset);
+        offset += widths_[c];
+      }
+    }
+    *out = std::make_shared<arrow::Int64Array>(length, buffer);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status EvaluateBinary(const ArrayList& in, int64_t length,
+                               std::shared_ptr<arrow::Array>* out) {
+    ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> offsets_buffer,
+                          arrow::AllocateBuffer((length + 1) * sizeof(int32_t),
+                                                ctx_->memory_pool()));
+    auto offsets = reinterpret_cast<int32_t*>(offsets_buffer->mutable_data());
+    // the total size first, then the rows
+    int64_t total_bytes = 0;
+    for (int64_t i = 0; i < length; ++i) {
+      offsets[i] = static_cast<int32_t>(total_bytes);
+      total_bytes += fixed_bytes_;
+      for (size_t c = 0; c < in.size(); ++c) {
+        if (kinds_[c] == kVarWidth && !in[c]->IsNull(i)) {
+          const auto& binary = static_cast<const arrow::BinaryArray&>(*in[c]);
+          total_bytes += binary.value_length(i);
+        }
+      }
+      if (total_bytes > std::numeric_limits<int32_t>::max()) {
+        return arrow::Status::CapacityError("Normalized keys exceed 2GB in one batch");
+      }
+    }
+    offsets[length] = static_cast<int32_t>(total_bytes);
+
+    ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> data_buffer,
+                          arrow::AllocateBuffer(total_bytes, ctx_->memory_pool()));
+    auto data = data_buffer->mutable_data();
+    std::memset(data, 0, total_bytes);
+    for (int64_t i = 0; i < length; ++i) {
+      auto row = data + offsets[i];
+      auto offset = null_bytes_;
+      auto var_offset = fixed_bytes_;
+      for (size_t c = 0; c < in.size(); ++c) {
+        auto value_length = WriteColumn(*in[c], i, c, row, row + offset);
+        if (value_length > 0) {
+          const auto& binary = static_cast<const arrow::BinaryArray&>(*in[c]);
+          std::memcpy(row + var_offset, binary.GetValue(i, &value_length), value_length);
+          var_offset += value_length;
+        }
+        offset += widths_[c];
+      }
+    }
+    *out = std::make_shared<arrow::BinaryArray>(length, offsets_buffer, data_buffer);
+    return arrow::Status::OK();
+  }
+
+  arrow::compute::FunctionContext* ctx_;
+  std::vector<std::shared_ptr<arrow::DataType>> type_list_;
+  // by column: how it is written and its bytes in the fixed-width part of a row
+  std::vector<Kind> kinds_;
+  std::vector<int> widths_;
+  const int64_t null_bytes_;
+  // the null bits and the fixed-width part of a row
+  int64_t fixed_bytes_;
+  bool has_var_width_ = false;
+};
+
+arrow::Status NormalizeKeysKernel::Make(
+    arrow::compute::FunctionContext* ctx,
+    std::vector<std::shared_ptr<arrow::DataType>> type_list,
+    std::shared_ptr<KernalBase>* out) {
+  *out = std::make_shared<NormalizeKeysKernel>(ctx, type_list);
+  return arrow::Status::OK();
+}
+
+std::shared_ptr<arrow::DataType> NormalizeKeysKernel::NormalizedType(
+    const std::vector<std::shared_ptr<arrow::DataType>>& type_list) {
+  int64_t bytes = (type_list.size() + 7) / 8;
+  for (const auto& type : type_list) {
+    auto width = NormalizedWidth(*type);
+    if (width == 0) {
+      return arrow::binary();
+    }
+    bytes += width;
+  }
+  if (bytes <= static_cast<int64_t>(sizeof(int64_t))) {
+    return arrow::int64();
+  }
+  return arrow::binary();
+}
+
+NormalizeKeysKernel::NormalizeKeysKernel(
+    arrow::compute::FunctionContext* ctx,
+    std::vector<std::shared_ptr<arrow::DataType>> type_list) {
+  impl_.reset(new Impl(ctx, type_list));
+  kernel_name_ = "NormalizeKeysKernel";
+}
+
+arrow::Status NormalizeKeysKernel::Evaluate(const ArrayList& in,
+                                            std::shared_ptr<arrow::Array>* out) {
+  return impl_->Evaluate(in, out);
+}
+
 }  // namespace extra
 }  // namespace arrowcompute
 }  // namespace codegen
@@ -24,6 +24,7 @@
 #include <gandiva/node.h>
 #include <gandiva/tree_expr_builder.h>
 
+#include "codegen/common/kernel_metrics.h"
 #include "codegen/common/result_iterator.h"
 
 using ArrayList = std::vector<std::shared_ptr<arrow::Array>>;
@@ -62,6 +63,10 @@ class KernalBase {
                                          kernel_name_,
                                          ", input is array, output is array.");
   }
+  /// Evaluate the rows of in at the indices of selection, as made by a gandiva filter.
+  /// The rows are taken then evaluated unless the kernel aggregates them in place.
+  virtual arrow::Status EvaluateWithSelection(
+      const ArrayList& in, const std::shared_ptr<arrow::Array>& selection);
   virtual arrow::Status Finish(ArrayList* out) {
     return arrow::Status::NotImplemented("Finish is abstract interface for ",
                                          kernel_name_, ", output is arrayList");
@@ -72,19 +77,32 @@ class KernalBase {
     return arrow::Status::NotImplemented("MakeResultIterator is abstract interface for ",
                                          kernel_name_);
   }
+  /// Counters of this kernel, with the gauges of its hash table if it has one
+  virtual KernelMetrics GetMetrics() {
+    KernelMetrics metrics = *metrics_;
+    metrics.name = kernel_name_;
+    return metrics;
+  }
 
   std::string kernel_name_;
+  /// counted by the visitor of this kernel and by the kernel itself, e.g. its spills.
+  /// Shared with the result iterators of the kernel, which may outlive it.
+  std::shared_ptr<KernelMetrics> metrics_ = std::make_shared<KernelMetrics>();
 };
 
 class SplitArrayListWithActionKernel : public KernalBase {
  public:
+  /// res_type_list holds the return types of the action nodes, of which the decimal
+  /// actions take the type of their result
   static arrow::Status Make(arrow::compute::FunctionContext* ctx,
                             std::vector<std::string> action_name_list,
                             std::vector<std::shared_ptr<arrow::DataType>> type_list,
+                            std::vector<std::shared_ptr<arrow::DataType>> res_type_list,
                             std::shared_ptr<KernalBase>* out);
-  SplitArrayListWithActionKernel(arrow::compute::FunctionContext* ctx,
-                                 std::vector<std::string> action_name_list,
-                                 std::vector<std::shared_ptr<arrow::DataType>> type_list);
+  SplitArrayListWithActionKernel(
+      arrow::compute::FunctionContext* ctx, std::vector<std::string> action_name_list,
+      std::vector<std::shared_ptr<arrow::DataType>> type_list,
+      std::vector<std::shared_ptr<arrow::DataType>> res_type_list);
   arrow::Status Evaluate(const ArrayList& in,
                          const std::shared_ptr<arrow::Array>& dict) override;
   arrow::Status Finish(ArrayList* out) override;
@@ -128,6 +146,33 @@ class HashArrayKernel : public KernalBase {
   arrow::compute::FunctionContext* ctx_;
 };
 
+/// \brief Packs the columns of multi-column keys into one normalized key per row
+///
+/// Two rows have equal normalized keys iff their keys are equal column by column, nulls
+/// included, so a hash table compares them once rather than column by column. A row
+/// starts with one null bit per column, then each column in order: fixed-width values as
+/// their bytes, zeroed if null, variable-width values as a 4 byte length and their
+/// bytes. Keys of at most 8 bytes, e.g. two int32 columns, are packed into an int64
+/// word, the others into a binary string. The normalized keys are never null.
+class NormalizeKeysKernel : public KernalBase {
+ public:
+  static arrow::Status Make(arrow::compute::FunctionContext* ctx,
+                            std::vector<std::shared_ptr<arrow::DataType>> type_list,
+                            std::shared_ptr<KernalBase>* out);
+  /// int64 or binary, the type of the normalized keys of columns of type_list
+  static std::shared_ptr<arrow::DataType> NormalizedType(
+      const std::vector<std::shared_ptr<arrow::DataType>>& type_list);
+  NormalizeKeysKernel(arrow::compute::FunctionContext* ctx,
+                      std::vector<std::shared_ptr<arrow::DataType>> type_list);
+  arrow::Status Evaluate(const ArrayList& in,
+                         std::shared_ptr<arrow::Array>* out) override;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+  arrow::compute::FunctionContext* ctx_;
+};
+
 class SumArrayKernel : public KernalBase {
  public:
   static arrow::Status Make(arrow::compute::FunctionContext* ctx,
@@ -226,18 +271,22 @@ class MaxArrayKernel : public KernalBase {
 
 class SortArraysToIndicesKernel : public KernalBase {
  public:
+  /// \param limit if positive, only the first limit rows are returned, and only as
+  /// many are kept while the input is evaluated
   static arrow::Status Make(arrow::compute::FunctionContext* ctx,
                             std::vector<std::shared_ptr<arrow::Field>> key_field_list,
                             std::shared_ptr<arrow::Schema> result_schema,
-                            std::shared_ptr<KernalBase>* out, bool nulls_first, bool asc);
+                            std::shared_ptr<KernalBase>* out, bool nulls_first, bool asc,
+                            int64_t limit = 0);
   SortArraysToIndicesKernel(arrow::compute::FunctionContext* ctx,
                             std::vector<std::shared_ptr<arrow::Field>> key_field_list,
                             std::shared_ptr<arrow::Schema> result_schema,
-                            bool nulls_first, bool asc);
+                            bool nulls_first, bool asc, int64_t limit = 0);
   arrow::Status Evaluate(const ArrayList& in) override;
   arrow::Status MakeResultIterator(
       std::shared_ptr<arrow::Schema> schema,
       std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override;
+  KernelMetrics GetMetrics() override;
 
   class Impl;
 
@@ -248,15 +297,131 @@ class SortArraysToIndicesKernel : public KernalBase {
 
 class HashAggregateKernel : public KernalBase {
  public:
+  /// \param action_list the actions, and optionally a codegen_filter(condition) whose
+  /// condition selects the rows aggregated, as a filter before the aggregation
+  /// \param partial true for the partial aggregation before a shuffle, which then
+  /// passes the rows of nearly all distinct keys as groups of their own to the final one
   static arrow::Status Make(arrow::compute::FunctionContext* ctx,
                             std::vector<std::shared_ptr<arrow::Field>> input_field_list,
                             std::vector<std::shared_ptr<gandiva::Node>> action_list,
                             std::shared_ptr<arrow::Schema> result_schema,
-                            std::shared_ptr<KernalBase>* out);
+                            std::shared_ptr<KernalBase>* out, bool partial = false);
   HashAggregateKernel(arrow::compute::FunctionContext* ctx,
                       std::vector<std::shared_ptr<arrow::Field>> input_field_list,
                       std::vector<std::shared_ptr<gandiva::Node>> action_list,
-                      std::shared_ptr<arrow::Schema> result_schema);
+                      std::shared_ptr<arrow::Schema> result_schema, bool partial = false);
+  arrow::Status Evaluate(const ArrayList& in) override;
+  /// Aggregates the selected rows in place, see CodeGenBase
+  arrow::Status EvaluateWithSelection(
+      const ArrayList& in, const std::shared_ptr<arrow::Array>& selection) override;
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override;
+  KernelMetrics GetMetrics() override;
+
+  class Impl;
+
+ private:
+  std::unique_ptr<Impl> impl_;
+  arrow::compute::FunctionContext* ctx_;
+};
+
+/// \brief DISTINCT, INTERSECT and EXCEPT of whole rows by hash, without aggregates
+///
+/// Evaluate inserts the rows of the build side into a hash set of their normalized
+/// keys, nulls equal to nulls. For kDistinct the result iterator returns the first row
+/// of each distinct key. For kIntersect and kExcept, Process of the result iterator
+/// returns the rows of each probe batch whose keys are, or aren't, in the build side,
+/// each distinct row once over the whole probe side. Both sides have the same column
+/// types.
+///
+/// Past the memory budget of the aggregations, GetAggregateMemoryBudget(), the build
+/// side is spilled by hash partition of the rows, and so is the probe side. The
+/// partitions are then made distinct, or probed, one at a time by HasNext and Next of
+/// the result iterator, once the input is over.
+class HashSetKernel : public KernalBase {
+ public:
+  enum SetOp { kDistinct, kIntersect, kExcept };
+  /// \param probe_field_list the columns of the probe side, unused by kDistinct
+  static arrow::Status Make(
+      arrow::compute::FunctionContext* ctx, SetOp op,
+      const std::vector<std::shared_ptr<arrow::Field>>& build_field_list,
+      const std::vector<std::shared_ptr<arrow::Field>>& probe_field_list,
+      std::shared_ptr<KernalBase>* out);
+  HashSetKernel(arrow::compute::FunctionContext* ctx, SetOp op,
+                const std::vector<std::shared_ptr<arrow::Field>>& build_field_list,
+                const std::vector<std::shared_ptr<arrow::Field>>& probe_field_list);
+  arrow::Status Evaluate(const ArrayList& in) override;
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override;
+  KernelMetrics GetMetrics() override;
+
+  class Impl;
+
+ private:
+  std::unique_ptr<Impl> impl_;
+  arrow::compute::FunctionContext* ctx_;
+};
+
+/// \brief Aggregates input sorted by its group keys without a hash table
+///
+/// A group ends where the keys of a row differ from those of the row before, so only the
+/// last group aggregated is kept open, in the ActionBase actions of the nodes. The
+/// action_list is made of action_groupby nodes of the keys and of action nodes, whose
+/// children are fields of input_field_list, in the order of the result columns. The
+/// groups ended by the batches of Evaluate are output by Next of the result iterator.
+/// Its Process aggregates a batch and outputs the groups it ends, or null if none. Next
+/// outputs the open group once the input is over.
+class SortedAggregateKernel : public KernalBase {
+ public:
+  static arrow::Status Make(arrow::compute::FunctionContext* ctx,
+                            std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+                            std::vector<std::shared_ptr<gandiva::Node>> action_list,
+                            std::shared_ptr<arrow::Schema> result_schema,
+                            std::shared_ptr<KernalBase>* out);
+  SortedAggregateKernel(arrow::compute::FunctionContext* ctx,
+                        std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+                        std::vector<std::shared_ptr<gandiva::Node>> action_list,
+                        std::shared_ptr<arrow::Schema> result_schema);
+  arrow::Status Evaluate(const ArrayList& in) override;
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override;
+
+  class Impl;
+
+ private:
+  std::unique_ptr<Impl> impl_;
+  arrow::compute::FunctionContext* ctx_;
+};
+
+/// \brief Window functions over input sorted by its partition and order keys
+///
+/// The action_list is made of action_partitionby and action_orderby nodes of the keys,
+/// window_row_number, window_rank and window_dense_rank nodes, and action_sum,
+/// action_count, action_min and action_max nodes of input fields aggregated over the
+/// frame of each row. As in Spark, the frame goes from the start of the partition to
+/// the last row of the same order keys as the row, or is the whole partition without
+/// order keys. The frame aggregates are made by the ActionBase actions of the nodes, one
+/// group per frame end, combined into running values.
+///
+/// The result rows are the input rows followed by the window columns, in the order of
+/// the window nodes. Rows are output once their frame ends, so the rows of the last
+/// order keys, or of the last partition without order keys, wait for the next batch.
+/// Process outputs the rows a batch ends, or null if none, and Next the rows of the
+/// batches of Evaluate, then the rows left once the input is over.
+class WindowKernel : public KernalBase {
+ public:
+  static arrow::Status Make(arrow::compute::FunctionContext* ctx,
+                            std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+                            std::vector<std::shared_ptr<gandiva::Node>> action_list,
+                            std::shared_ptr<arrow::Schema> result_schema,
+                            std::shared_ptr<KernalBase>* out);
+  WindowKernel(arrow::compute::FunctionContext* ctx,
+               std::vector<std::shared_ptr<arrow::Field>> input_field_list,
+               std::vector<std::shared_ptr<gandiva::Node>> action_list,
+               std::shared_ptr<arrow::Schema> result_schema);
   arrow::Status Evaluate(const ArrayList& in) override;
   arrow::Status MakeResultIterator(
       std::shared_ptr<arrow::Schema> schema,
@@ -303,6 +468,43 @@ class ConditionedProbeArraysKernel : public KernalBase {
       const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
       const std::shared_ptr<arrow::Schema>& result_schema);
   arrow::Status Evaluate(const ArrayList& in) override;
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override;
+  KernelMetrics GetMetrics() override;
+  class Impl;
+
+ private:
+  std::unique_ptr<Impl> impl_;
+  arrow::compute::FunctionContext* ctx_;
+};
+
+/// \brief Joins two streams sorted by their keys
+///
+/// The left stream is buffered by Evaluate. The result iterator merges it with the
+/// batches of the right stream given to Process, which must follow the same ascending
+/// order of the keys, e.g. both sorted by SortArraysToIndicesKernel. The join types and
+/// conditions are those of ConditionedProbeArraysKernel. Rows with a null key never
+/// match. The left batches are released as the merge passes them.
+class SortMergeJoinKernel : public KernalBase {
+ public:
+  static arrow::Status Make(
+      arrow::compute::FunctionContext* ctx,
+      const std::vector<std::shared_ptr<arrow::Field>>& left_key_list,
+      const std::vector<std::shared_ptr<arrow::Field>>& right_key_list,
+      const std::shared_ptr<gandiva::Node>& func_node, int join_type,
+      const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
+      const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
+      const std::shared_ptr<arrow::Schema>& result_schema,
+      std::shared_ptr<KernalBase>* out);
+  SortMergeJoinKernel(arrow::compute::FunctionContext* ctx,
+                      const std::vector<std::shared_ptr<arrow::Field>>& left_key_list,
+                      const std::vector<std::shared_ptr<arrow::Field>>& right_key_list,
+                      const std::shared_ptr<gandiva::Node>& func_node, int join_type,
+                      const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
+                      const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
+                      const std::shared_ptr<arrow::Schema>& result_schema);
+  arrow::Status Evaluate(const ArrayList& in) override;
   arrow::Status MakeResultIterator(
       std::shared_ptr<arrow::Schema> schema,
       std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override;
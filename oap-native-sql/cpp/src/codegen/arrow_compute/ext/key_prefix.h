@@ -0,0 +1,154 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/util/string_view.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "third_party/ska_sort.hpp"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// \brief Normalized key prefixes, unsigned integers ordered as their keys
+///
+/// a < b implies NormalizeKeyPrefix(a) <= NormalizeKeyPrefix(b), equal prefixes leave
+/// the order to the full comparison of the keys.
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value,
+                               uint64_t>::type
+NormalizeKeyPrefix(T value) {
+  return static_cast<uint64_t>(static_cast<int64_t>(value)) ^ (uint64_t{1} << 63);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value,
+                               uint64_t>::type
+NormalizeKeyPrefix(T value) {
+  return static_cast<uint64_t>(value);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, uint64_t>::type
+NormalizeKeyPrefix(T value) {
+  // float converts exactly to double. Set the sign bit of positives, flip all the bits
+  // of negatives so that larger magnitudes come first.
+  double d = value;
+  uint64_t bits;
+  std::memcpy(&bits, &d, sizeof(bits));
+  constexpr auto kSign = uint64_t{1} << 63;
+  return (bits & kSign) ? ~bits : bits | kSign;
+}
+
+/// The 8 bytes from offset, big endian and zero padded
+inline uint64_t NormalizeKeyPrefix(arrow::util::string_view value, size_t offset = 0) {
+  uint64_t prefix = 0;
+  auto length =
+      value.size() > offset ? std::min<size_t>(value.size() - offset, sizeof(prefix)) : 0;
+  for (size_t i = 0; i < length; ++i) {
+    prefix |= static_cast<uint64_t>(static_cast<uint8_t>(value[offset + i]))
+              << (56 - 8 * i);
+  }
+  return prefix;
+}
+
+template <typename Index>
+struct PrefixedIndex {
+  uint64_t prefix;
+  Index index;
+};
+
+namespace detail {
+
+// Radix sort [begin, end) on the prefixes at offset, then each run of equal prefixes
+// on the prefixes at offset + 8 while below max_offset, else by comp
+template <typename Index, typename Prefix, typename Comp>
+void SortPrefixed(PrefixedIndex<Index>* begin, PrefixedIndex<Index>* end,
+                  Prefix& prefix, Comp& comp, size_t offset, size_t max_offset) {
+  // below, refining prefixes costs more than comparing the keys
+  constexpr int64_t kMinRefineRows = 32;
+  ska_sort(begin, end, [](const PrefixedIndex<Index>& x) { return x.prefix; });
+  for (auto run_begin = begin; run_begin != end;) {
+    auto run_end = run_begin + 1;
+    while (run_end != end && run_end->prefix == run_begin->prefix) {
+      ++run_end;
+    }
+    auto next_offset = offset + sizeof(uint64_t);
+    if (run_end - run_begin >= kMinRefineRows && next_offset < max_offset) {
+      for (auto it = run_begin; it != run_end; ++it) {
+        it->prefix = prefix(it->index, next_offset);
+      }
+      SortPrefixed(run_begin, run_end, prefix, comp, next_offset, max_offset);
+    } else if (run_end - run_begin > 1) {
+      std::sort(run_begin, run_end,
+                [&comp](const PrefixedIndex<Index>& x, const PrefixedIndex<Index>& y) {
+                  return comp(x.index, y.index);
+                });
+    }
+    run_begin = run_end;
+  }
+}
+
+template <typename Index, typename Prefix, typename Comp>
+void SortByPrefixes(Index* begin, Index* end, Prefix& prefix, Comp& comp,
+                    size_t max_offset) {
+  std::vector<PrefixedIndex<Index>> keyed(end - begin);
+  for (size_t i = 0; i < keyed.size(); ++i) {
+    keyed[i] = {prefix(begin[i], 0), begin[i]};
+  }
+  SortPrefixed(keyed.data(), keyed.data() + keyed.size(), prefix, comp, 0, max_offset);
+  for (size_t i = 0; i < keyed.size(); ++i) {
+    begin[i] = keyed[i].index;
+  }
+}
+
+}  // namespace detail
+
+/// \brief Sort [begin, end) by the normalized prefix of the first key, then comp
+///
+/// The pairs of prefix and index are laid out contiguously and radix sorted on the
+/// prefix, comp then only sorts the runs of equal prefixes. prefix(x) must be
+/// consistent with comp, see NormalizeKeyPrefix.
+template <typename Index, typename Prefix, typename Comp>
+void SortByKeyPrefix(Index* begin, Index* end, Prefix prefix, Comp comp) {
+  auto offset_prefix = [&prefix](const Index& x, size_t) { return prefix(x); };
+  detail::SortByPrefixes(begin, end, offset_prefix, comp, sizeof(uint64_t));
+}
+
+/// \brief Same as SortByKeyPrefix for a first key of strings
+///
+/// prefix(x, offset) normalizes the 8 bytes of the key from offset. Large runs of equal
+/// prefixes, e.g. URLs sharing their scheme and host, are radix sorted again on the
+/// following 8 bytes, comp only sorts the runs left after kMaxStringPrefixBytes.
+template <typename Index, typename Prefix, typename Comp>
+void SortByStringPrefix(Index* begin, Index* end, Prefix prefix, Comp comp) {
+  constexpr size_t kMaxStringPrefixBytes = 64;
+  detail::SortByPrefixes(begin, end, prefix, comp, kMaxStringPrefixBytes);
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// \brief Tournament tree of losers picking the smallest of k sorted runs
+///
+/// Leaves are run indices in [0, k), ordered by less(a, b), a strict total order which
+/// should rank exhausted runs last. Each node keeps the loser of the match played
+/// there, so replacing the winner costs one comparison per level, log2(k) in all,
+/// against the losers on the path to the root only.
+template <typename Less>
+class LoserTree {
+ public:
+  LoserTree(int32_t num_leaves, Less less)
+      : num_leaves_(num_leaves),
+        less_(std::move(less)),
+        tree_(num_leaves, int32_t{kNone}) {}
+
+  /// Play the first tournament, once all the runs are at their first row
+  void Build() {
+    tree_.assign(num_leaves_, int32_t{kNone});
+    for (int32_t leaf = num_leaves_ - 1; leaf >= 0; --leaf) {
+      Replay(leaf);
+    }
+  }
+
+  /// Run of the smallest row, -1 if there are no runs
+  int32_t Winner() const { return num_leaves_ == 0 ? kNone : tree_[0]; }
+
+  /// Play the matches of leaf up to the root again, after its row changed. leaf is the
+  /// winner, except while building.
+  void Replay(int32_t leaf) {
+    auto winner = leaf;
+    for (auto node = (leaf + num_leaves_) / 2; node > 0; node /= 2) {
+      // an empty node, only while building, wins against all
+      if (tree_[node] == kNone || (winner != kNone && less_(tree_[node], winner))) {
+        std::swap(tree_[node], winner);
+      }
+    }
+    tree_[0] = winner;
+  }
+
+ private:
+  static constexpr int32_t kNone = -1;
+
+  const int32_t num_leaves_;
+  Less less_;
+  // tree_[0] is the winner, tree_[1, k) the losers of the internal nodes
+  std::vector<int32_t> tree_;
+};
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,36 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "codegen/arrow_compute/ext/memo_table_instances.h"
+
+namespace arrow {
+namespace internal {
+
+template class SmallScalarMemoTable<bool>;
+template class SmallScalarMemoTable<int8_t>;
+template class SmallScalarMemoTable<uint8_t>;
+template class ScalarMemoTable<int16_t>;
+template class ScalarMemoTable<uint16_t>;
+template class ScalarMemoTable<int32_t>;
+template class ScalarMemoTable<uint32_t>;
+template class ScalarMemoTable<int64_t>;
+template class ScalarMemoTable<uint64_t>;
+template class ScalarMemoTable<float>;
+template class ScalarMemoTable<double>;
+template class BinaryMemoTable<BinaryBuilder>;
+
+}  // namespace internal
+}  // namespace arrow
@@ -0,0 +1,45 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <arrow/array/builder_binary.h>
+
+#include <cstdint>
+
+#include "third_party/arrow/utils/hashing.h"
+
+// The memo tables of the hash aggregate kernels, instantiated once in
+// libspark_columnar_jni rather than in every generated kernel
+
+namespace arrow {
+namespace internal {
+
+extern template class SmallScalarMemoTable<bool>;
+extern template class SmallScalarMemoTable<int8_t>;
+extern template class SmallScalarMemoTable<uint8_t>;
+extern template class ScalarMemoTable<int16_t>;
+extern template class ScalarMemoTable<uint16_t>;
+extern template class ScalarMemoTable<int32_t>;
+extern template class ScalarMemoTable<uint32_t>;
+extern template class ScalarMemoTable<int64_t>;
+extern template class ScalarMemoTable<uint64_t>;
+extern template class ScalarMemoTable<float>;
+extern template class ScalarMemoTable<double>;
+extern template class BinaryMemoTable<BinaryBuilder>;
+
+}  // namespace internal
+}  // namespace arrow
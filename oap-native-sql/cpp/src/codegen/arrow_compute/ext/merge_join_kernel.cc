@@ -0,0 +1,596 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/compute/context.h>
+#include <arrow/status.h>
+#include <arrow/type.h>
+#include <gandiva/node.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "codegen/arrow_compute/ext/array_item_index.h"
+#include "codegen/arrow_compute/ext/code_generator_base.h"
+#include "codegen/arrow_compute/ext/codegen_common.h"
+#include "codegen/arrow_compute/ext/codegen_node_visitor.h"
+#include "codegen/arrow_compute/ext/kernels_ext.h"
+#include "utils/macros.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+using ArrayList = std::vector<std::shared_ptr<arrow::Array>>;
+
+///////////////  SortMergeJoin  ////////////////
+class SortMergeJoinKernel::Impl {
+ public:
+  Impl(arrow::compute::FunctionContext* ctx,
+       const std::vector<std::shared_ptr<arrow::Field>>& left_key_list,
+       const std::vector<std::shared_ptr<arrow::Field>>& right_key_list,
+       const std::shared_ptr<gandiva::Node>& func_node, int join_type,
+       const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
+       const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
+       const std::shared_ptr<arrow::Schema>& result_schema)
+      : ctx_(ctx) {
+    std::vector<int> left_key_index_list;
+    THROW_NOT_OK(GetIndexList(left_key_list, left_field_list, &left_key_index_list));
+    std::vector<int> right_key_index_list;
+    THROW_NOT_OK(GetIndexList(right_key_list, right_field_list, &right_key_index_list));
+    if (left_key_index_list.empty() ||
+        left_key_index_list.size() != right_key_index_list.size()) {
+      throw std::runtime_error("SortMergeJoinKernel expects as many keys on both sides");
+    }
+    THROW_NOT_OK(LoadJITFunction(func_node, join_type, left_key_index_list,
+                                 right_key_index_list, left_field_list, right_field_list,
+                                 result_schema));
+  }
+
+  arrow::Status Evaluate(const ArrayList& in) {
+    RETURN_NOT_OK(MakeKernel(merger_kernel_, ctx_, &merger_));
+    return merger_->Evaluate(in);
+  }
+
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+    RETURN_NOT_OK(MakeKernel(merger_kernel_, ctx_, &merger_));
+    return merger_->MakeResultIterator(schema, out);
+  }
+
+ private:
+  arrow::compute::FunctionContext* ctx_;
+  KernelFuture merger_kernel_;
+  std::shared_ptr<CodeGenBase> merger_;
+
+  arrow::Status LoadJITFunction(
+      const std::shared_ptr<gandiva::Node>& func_node, int join_type,
+      const std::vector<int>& left_key_index_list,
+      const std::vector<int>& right_key_index_list,
+      const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
+      const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
+      const std::shared_ptr<arrow::Schema>& result_schema) {
+    // generate ddl signature
+    std::stringstream func_args_ss;
+    func_args_ss << "<MergeJoin>"
+                 << "[JoinType]" << join_type;
+    if (func_node) {
+      func_args_ss << "[cond]" << func_node->ToString();
+    }
+    func_args_ss << "[BuildSchema]";
+    for (auto field : left_field_list) {
+      func_args_ss << field->ToString();
+    }
+    func_args_ss << "[ProbeSchema]";
+    for (auto field : right_field_list) {
+      func_args_ss << field->ToString();
+    }
+    func_args_ss << "[LeftKeyIndex]";
+    for (auto i : left_key_index_list) {
+      func_args_ss << i << ",";
+    }
+    func_args_ss << "[RightKeyIndex]";
+    for (auto i : right_key_index_list) {
+      func_args_ss << i << ",";
+    }
+    func_args_ss << "[ResultSchema]" << result_schema->ToString();
+    func_args_ss << "[Index]" << GetItemIndexType();
+
+    auto signature = GetSignature(func_args_ss.str());
+    // compiled in background, the merger is made on first use
+    merger_kernel_ = LoadOrCompileLibraryAsync(signature, [&] {
+      return ProduceCodes(func_node, join_type, left_key_index_list, right_key_index_list,
+                          left_field_list, right_field_list, result_schema);
+    });
+    return arrow::Status::OK();
+  }
+
+  // One output column of the join
+  struct OutColumn {
+    std::string indice;
+    std::string data_type;
+  };
+
+  std::string GetTypeDefine(const std::string& indice, const std::string& data_type) {
+    return "using DataType_" + indice + " = typename arrow::" + data_type +
+           ";\n"
+           "using ArrayType_" +
+           indice + " = typename arrow::TypeTraits<DataType_" + indice +
+           ">::ArrayType;\n"
+           "using BuilderType_" +
+           indice + " = typename arrow::TypeTraits<DataType_" + indice +
+           ">::BuilderType;\n";
+  }
+
+  std::string GetCompareKeys(const std::vector<int>& left_key_index_list,
+                             const std::vector<int>& right_key_index_list) {
+    std::stringstream ss;
+    for (size_t k = 0; k < left_key_index_list.size(); k++) {
+      ss << "{\nauto l = cached_0_" << left_key_index_list[k]
+         << "_[x.array_id]->GetView(x.id);\n"
+         << "auto r = cached_1_" << right_key_index_list[k] << "_->GetView(y);\n"
+         << "if (l < r) return -1;\nif (r < l) return 1;\n}\n";
+    }
+    return ss.str();
+  }
+
+  std::string GetKeyIsNull(const std::vector<int>& key_index_list, bool left) {
+    std::stringstream ss;
+    for (size_t k = 0; k < key_index_list.size(); k++) {
+      if (k > 0) {
+        ss << " || ";
+      }
+      if (left) {
+        ss << "cached_0_" << key_index_list[k] << "_[x.array_id]->IsNull(x.id)";
+      } else {
+        ss << "cached_1_" << key_index_list[k] << "_->IsNull(y)";
+      }
+    }
+    return ss.str();
+  }
+
+  // The body of the loop over the right rows, recording the output rows in the
+  // selection vectors as the probe kernel does
+  std::string GetMergeRow(int join_type, bool cond_check) {
+    std::string check_all = cond_check ? "ConditionCheck(tmp, i)" : "true";
+    switch (join_type) {
+      case 0: /*Inner Join*/
+        return R"(
+        if (matched) {
+          for (auto tmp : run_) {
+            if ()" + check_all +
+               R"() {
+              probe_ids_.push_back(i);
+              build_ids_.push_back(tmp);
+            }
+          }
+        }
+)";
+      case 1: /*Outer Join*/
+        return R"(
+        bool found = false;
+        if (matched) {
+          for (auto tmp : run_) {
+            if ()" + check_all +
+               R"() {
+              probe_ids_.push_back(i);
+              build_ids_.push_back(tmp);
+              build_valid_.push_back(1);
+              found = true;
+            }
+          }
+        }
+        if (!found) {
+          probe_ids_.push_back(i);
+          build_ids_.emplace_back();
+          build_valid_.push_back(0);
+        }
+)";
+      case 2:   /*Anti Join*/
+      case 3:   /*Semi Join*/
+      case 4: { /*Existence Join*/
+        std::string emit;
+        if (join_type == 2) {
+          emit = "if (!found) {\n  probe_ids_.push_back(i);\n}\n";
+        } else if (join_type == 3) {
+          emit = "if (found) {\n  probe_ids_.push_back(i);\n}\n";
+        } else {
+          emit = "probe_ids_.push_back(i);\nbuild_valid_.push_back(found);\n";
+        }
+        return R"(
+        bool found = false;
+        if (matched) {
+          for (auto tmp : run_) {
+            if ()" + check_all +
+               R"() {
+              found = true;
+              break;
+            }
+          }
+        }
+        )" + emit;
+      }
+      default:
+        throw std::runtime_error("SortMergeJoinKernel doesn't support join type " +
+                                 std::to_string(join_type));
+    }
+  }
+
+  std::string ProduceCodes(
+      const std::shared_ptr<gandiva::Node>& func_node, int join_type,
+      const std::vector<int>& left_key_index_list,
+      const std::vector<int>& right_key_index_list,
+      const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
+      const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
+      const std::shared_ptr<arrow::Schema>& result_schema) {
+    std::vector<int> left_cond_index_list;
+    std::vector<int> right_cond_index_list;
+    std::string condition_check_str;
+    if (func_node) {
+      std::shared_ptr<CodeGenNodeVisitor> func_node_visitor;
+      int func_count = 0;
+      std::stringstream codes_ss;
+      MakeCodeGenNodeVisitor(func_node, {left_field_list, right_field_list}, &func_count,
+                             &codes_ss, &left_cond_index_list, &right_cond_index_list,
+                             &func_node_visitor);
+      condition_check_str = "inline bool ConditionCheck(ItemIndex x, int y) {\n" +
+                            codes_ss.str() + "return " + func_node_visitor->GetResult() +
+                            ";\n}\n";
+    }
+
+    // the result columns in schema order, out of the left, the right or the exists
+    // column of an existence join. Only inner and outer joins read left columns.
+    bool gather_left = (join_type == 0 || join_type == 1);
+    bool has_exists = false;
+    std::vector<OutColumn> out_columns;
+    std::set<int> left_cache_set(left_key_index_list.begin(), left_key_index_list.end());
+    left_cache_set.insert(left_cond_index_list.begin(), left_cond_index_list.end());
+    std::set<int> right_cache_set(right_key_index_list.begin(),
+                                  right_key_index_list.end());
+    right_cache_set.insert(right_cond_index_list.begin(), right_cond_index_list.end());
+    using FieldList = std::vector<std::shared_ptr<arrow::Field>>;
+    for (const auto& target : result_schema->fields()) {
+      auto find_field = [&target](const FieldList& list) {
+        for (size_t i = 0; i < list.size(); i++) {
+          if (list[i]->name() == target->name()) {
+            return static_cast<int>(i);
+          }
+        }
+        return -1;
+      };
+      auto left_index = find_field(left_field_list);
+      if (left_index != -1) {
+        if (gather_left) {
+          left_cache_set.insert(left_index);
+        }
+        out_columns.push_back({"0_" + std::to_string(left_index),
+                               GetTypeString(left_field_list[left_index]->type())});
+        continue;
+      }
+      auto right_index = find_field(right_field_list);
+      if (right_index != -1) {
+        right_cache_set.insert(right_index);
+        out_columns.push_back({"1_" + std::to_string(right_index),
+                               GetTypeString(right_field_list[right_index]->type())});
+        continue;
+      }
+      if (join_type == 4 && !has_exists) {
+        out_columns.push_back({"1_exists", "BooleanType"});
+        has_exists = true;
+      }
+    }
+    if (join_type == 4 && !has_exists) {
+      out_columns.push_back({"1_exists", "BooleanType"});
+    }
+
+    std::stringstream left_define_ss;
+    std::stringstream left_cache_insert_ss;
+    std::stringstream left_params_ss;
+    std::stringstream left_args_ss;
+    std::stringstream left_set_ss;
+    std::stringstream left_release_ss;
+    for (auto i : left_cache_set) {
+      auto indice = "0_" + std::to_string(i);
+      left_define_ss << GetTypeDefine(indice, GetTypeString(left_field_list[i]->type()))
+                     << "std::vector<std::shared_ptr<ArrayType_" << indice << ">> cached_"
+                     << indice << "_;\n";
+      left_cache_insert_ss << "cached_" << indice
+                           << "_.push_back(std::dynamic_pointer_cast<ArrayType_" << indice
+                           << ">(in[" << i << "]));\n";
+      left_params_ss << ",\nstd::vector<std::shared_ptr<ArrayType_" << indice
+                     << ">> cached_" << indice;
+      left_args_ss << ", std::move(cached_" << indice << "_)";
+      left_set_ss << "cached_" << indice << "_ = std::move(cached_" << indice << ");\n";
+      left_release_ss << "cached_" << indice << "_[released_batches_] = nullptr;\n";
+    }
+    std::stringstream right_define_ss;
+    std::stringstream right_set_ss;
+    for (auto i : right_cache_set) {
+      auto indice = "1_" + std::to_string(i);
+      right_define_ss << GetTypeDefine(indice, GetTypeString(right_field_list[i]->type()))
+                      << "std::shared_ptr<ArrayType_" << indice << "> cached_" << indice
+                      << "_;\n";
+      right_set_ss << "cached_" << indice << "_ = std::dynamic_pointer_cast<ArrayType_"
+                   << indice << ">(in[" << i << "]);\n";
+    }
+
+    std::stringstream builder_define_ss;
+    std::stringstream builder_prepare_ss;
+    std::stringstream gather_ss;
+    std::stringstream finish_ss;
+    std::stringstream out_list_ss;
+    for (const auto& column : out_columns) {
+      const auto& indice = column.indice;
+      if (indice == "1_exists") {
+        builder_define_ss << GetTypeDefine(indice, column.data_type);
+        gather_ss << "RETURN_NOT_OK(builder_1_exists_->AppendValues(build_valid_.data(), "
+                     "out_length));\n";
+      } else if (indice[0] == '0') {
+        if (gather_left) {
+          gather_ss << "RETURN_NOT_OK(GatherItems(cached_" << indice
+                    << "_, build_ids_.data(), "
+                    << (join_type == 1 ? "build_valid_.data()" : "nullptr")
+                    << ", out_length, builder_" << indice << "_.get()));\n";
+        } else {
+          // not cached, see above
+          builder_define_ss << GetTypeDefine(indice, column.data_type);
+          gather_ss << "RETURN_NOT_OK(builder_" << indice
+                    << "_->AppendNulls(out_length));\n";
+        }
+      } else {
+        gather_ss << "RETURN_NOT_OK(GatherRows(*cached_" << indice
+                  << "_, probe_ids_.data(), out_length, builder_" << indice
+                  << "_.get()));\n";
+      }
+      builder_define_ss << "std::shared_ptr<BuilderType_" << indice << "> builder_"
+                        << indice << "_;\n";
+      builder_prepare_ss << "std::unique_ptr<arrow::ArrayBuilder> builder_" << indice
+                         << ";\n"
+                         << "arrow::MakeBuilder(ctx_->memory_pool(), "
+                            "arrow::TypeTraits<DataType_"
+                         << indice << ">::type_singleton(), &builder_" << indice
+                         << ");\n"
+                         << "builder_" << indice
+                         << "_.reset(arrow::internal::checked_cast<BuilderType_" << indice
+                         << "*>(builder_" << indice << ".release()));\n";
+      finish_ss << "std::shared_ptr<arrow::Array> out_" << indice << ";\n"
+                << "RETURN_NOT_OK(builder_" << indice << "_->Finish(&out_" << indice
+                << "));\n";
+      out_list_ss << (out_list_ss.tellp() > 0 ? ", " : "") << "out_" << indice;
+    }
+
+    return BaseCodes() + "using ItemIndex = " + GetItemIndexType() + ";\n" + R"(
+class TypedMergeJoinImpl : public CodeGenBase {
+ public:
+  TypedMergeJoinImpl(arrow::compute::FunctionContext* ctx) : ctx_(ctx) {}
+
+  arrow::Status Evaluate(const ArrayList& in) override {
+    if (batch_lengths_.size() >= ItemIndex::kMaxArrays ||
+        static_cast<uint64_t>(in[0]->length()) > ItemIndex::kMaxRows) {
+      return arrow::Status::Invalid(
+          "Merge join buffered side exceeds ", ItemIndex::kMaxArrays, " batches of ",
+          ItemIndex::kMaxRows, " rows, set NATIVESQL_ITEM_INDEX=wide");
+    }
+    if (in[0]->length() == 0) {
+      return arrow::Status::OK();
+    }
+    batch_lengths_.push_back(in[0]->length());
+    )" + left_cache_insert_ss.str() +
+           R"(
+    return arrow::Status::OK();
+  }
+
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override {
+    if (merged_) {
+      // the buffered batches are released by the iterator as it passes them
+      return arrow::Status::Invalid("A merge join can only be merged once");
+    }
+    merged_ = true;
+    *out = std::make_shared<MergeJoinResultIterator>(ctx_, schema,
+                                                     std::move(batch_lengths_))" +
+           left_args_ss.str() + R"();
+    return arrow::Status::OK();
+  }
+
+ private:
+  arrow::compute::FunctionContext* ctx_;
+  bool merged_ = false;
+  std::vector<int64_t> batch_lengths_;
+  )" + left_define_ss.str() +
+           R"(
+
+  /// Merges the right batches, sorted by key, with the buffered left batches, sorted by
+  /// the same key. Rows with a null key never match.
+  class MergeJoinResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    MergeJoinResultIterator(arrow::compute::FunctionContext* ctx,
+                            std::shared_ptr<arrow::Schema> schema,
+                            std::vector<int64_t> batch_lengths)" +
+           left_params_ss.str() + R"()
+        : ctx_(ctx), result_schema_(schema), batch_lengths_(std::move(batch_lengths)) {
+      )" + left_set_ss.str() +
+           builder_prepare_ss.str() + R"(
+    }
+
+    std::string ToString() override { return "MergeJoinResultIterator"; }
+
+    arrow::Status Process(const ArrayList& in, std::shared_ptr<arrow::RecordBatch>* out,
+                          const std::shared_ptr<arrow::Array>& selection) override {
+      auto length = in[0]->length();
+      probe_ids_.clear();
+      build_ids_.clear();
+      build_valid_.clear();
+      ReleaseBatches();
+      )" + right_set_ss.str() +
+           R"(
+      for (int i = 0; i < length; i++) {
+        bool matched = !RightKeyIsNull(i) && SeekRun(i);)" +
+           GetMergeRow(join_type, func_node != nullptr) + R"(
+      }
+      // materialize the output columns one at a time from the selection vectors
+      int64_t out_length = probe_ids_.size();
+      )" + gather_ss.str() +
+           finish_ss.str() + R"(
+      *out = arrow::RecordBatch::Make(result_schema_, out_length, {)" +
+           out_list_ss.str() + R"(});
+      return arrow::Status::OK();
+    }
+
+   private:
+    arrow::compute::FunctionContext* ctx_;
+    std::shared_ptr<arrow::Schema> result_schema_;
+    const std::vector<int64_t> batch_lengths_;
+    // next left row to compare, only moves forward
+    uint64_t cursor_array_id_ = 0;
+    int64_t cursor_id_ = 0;
+    // left rows of the keys of the last matched right row
+    std::vector<ItemIndex> run_;
+    uint64_t released_batches_ = 0;
+    // selection vectors of the output rows of a batch, see SortMergeJoinKernel
+    std::vector<int32_t> probe_ids_;
+    std::vector<ItemIndex> build_ids_;
+    std::vector<uint8_t> build_valid_;
+    )" + right_define_ss.str() +
+           builder_define_ss.str() + R"(
+
+    inline int CompareKeys(ItemIndex x, int y) {
+      )" + GetCompareKeys(left_key_index_list, right_key_index_list) +
+           R"(
+      return 0;
+    }
+
+    inline bool LeftKeyIsNull(ItemIndex x) {
+      return )" +
+           GetKeyIsNull(left_key_index_list, true) + R"(;
+    }
+
+    inline bool RightKeyIsNull(int y) {
+      return )" +
+           GetKeyIsNull(right_key_index_list, false) + R"(;
+    }
+
+    inline void AdvanceCursor() {
+      if (++cursor_id_ == batch_lengths_[cursor_array_id_]) {
+        cursor_array_id_++;
+        cursor_id_ = 0;
+      }
+    }
+
+    // Collect in run_ the left rows whose keys equal the keys of right row y, false if
+    // there is none
+    bool SeekRun(int y) {
+      if (!run_.empty()) {
+        auto cmp = CompareKeys(run_[0], y);
+        if (cmp == 0) {
+          return true;
+        }
+        if (cmp > 0) {
+          return false;
+        }
+        run_.clear();
+      }
+      while (cursor_array_id_ < batch_lengths_.size()) {
+        ItemIndex x(cursor_array_id_, cursor_id_);
+        if (LeftKeyIsNull(x)) {
+          AdvanceCursor();
+          continue;
+        }
+        auto cmp = CompareKeys(x, y);
+        if (cmp > 0) {
+          break;
+        }
+        if (cmp == 0) {
+          run_.push_back(x);
+        } else if (!run_.empty()) {
+          break;
+        }
+        AdvanceCursor();
+      }
+      return !run_.empty();
+    }
+
+    // Drop the left batches the merge has passed, they are never read again
+    void ReleaseBatches() {
+      uint64_t first_needed = run_.empty() ? cursor_array_id_ : run_[0].array_id;
+      first_needed = std::min<uint64_t>(first_needed, batch_lengths_.size());
+      for (; released_batches_ < first_needed; released_batches_++) {
+        )" + left_release_ss.str() +
+           R"(
+      }
+    }
+
+    )" + condition_check_str +
+           R"(
+  };
+};
+
+extern "C" void MakeCodeGen(arrow::compute::FunctionContext* ctx,
+                            std::shared_ptr<CodeGenBase>* out) {
+  *out = std::make_shared<TypedMergeJoinImpl>(ctx);
+}
+    )";
+  }
+};
+
+SortMergeJoinKernel::SortMergeJoinKernel(
+    arrow::compute::FunctionContext* ctx,
+    const std::vector<std::shared_ptr<arrow::Field>>& left_key_list,
+    const std::vector<std::shared_ptr<arrow::Field>>& right_key_list,
+    const std::shared_ptr<gandiva::Node>& func_node, int join_type,
+    const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
+    const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
+    const std::shared_ptr<arrow::Schema>& result_schema) {
+  impl_.reset(new Impl(ctx, left_key_list, right_key_list, func_node, join_type,
+                       left_field_list, right_field_list, result_schema));
+  kernel_name_ = "SortMergeJoinKernel";
+}
+
+arrow::Status SortMergeJoinKernel::Make(
+    arrow::compute::FunctionContext* ctx,
+    const std::vector<std::shared_ptr<arrow::Field>>& left_key_list,
+    const std::vector<std::shared_ptr<arrow::Field>>& right_key_list,
+    const std::shared_ptr<gandiva::Node>& func_node, int join_type,
+    const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
+    const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
+    const std::shared_ptr<arrow::Schema>& result_schema,
+    std::shared_ptr<KernalBase>* out) {
+  *out = std::make_shared<SortMergeJoinKernel>(ctx, left_key_list, right_key_list,
+                                               func_node, join_type, left_field_list,
+                                               right_field_list, result_schema);
+  return arrow::Status::OK();
+}
+
+arrow::Status SortMergeJoinKernel::Evaluate(const ArrayList& in) {
+  return impl_->Evaluate(in);
+}
+
+arrow::Status SortMergeJoinKernel::MakeResultIterator(
+    std::shared_ptr<arrow::Schema> schema,
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+  return impl_->MakeResultIterator(schema, out);
+}
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,178 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "codegen/arrow_compute/ext/orc_jit.h"
+
+#include <dlfcn.h>
+
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/DiagnosticOptions.h>
+#include <clang/CodeGen/CodeGenAction.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Frontend/TextDiagnosticPrinter.h>
+#include <clang/Frontend/Utils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+namespace {
+
+std::string ToString(llvm::Error error) {
+  std::string message;
+  llvm::raw_string_ostream os(message);
+  os << error;
+  return os.str();
+}
+
+// the JIT shared by all kernels of the process, never destroyed as the kernels it
+// holds may live until the process exits
+arrow::Result<llvm::orc::LLJIT*> GetJIT() {
+  static std::once_flag init_flag;
+  static llvm::orc::LLJIT* jit = nullptr;
+  static std::string init_error;
+  std::call_once(init_flag, [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+    auto created = llvm::orc::LLJITBuilder().create();
+    if (!created) {
+      init_error = ToString(created.takeError());
+      return;
+    }
+    jit = created->release();
+  });
+  if (jit == nullptr) {
+    return arrow::Status::Invalid("Failed to create ORC JIT: ", init_error);
+  }
+  return jit;
+}
+
+// Compile codes to a module of context, the diagnostics are written to errors
+arrow::Result<std::unique_ptr<llvm::Module>> CompileModule(
+    const std::string& codes, const std::string& signature,
+    const std::vector<std::string>& compile_args, llvm::LLVMContext* context,
+    std::string* errors) {
+  llvm::raw_string_ostream errors_os(*errors);
+  auto diagnostic_options = llvm::makeIntrusiveRefCnt<clang::DiagnosticOptions>();
+  auto diagnostics = clang::CompilerInstance::createDiagnostics(
+      diagnostic_options.get(),
+      new clang::TextDiagnosticPrinter(errors_os, diagnostic_options.get()));
+
+  // the driver finds the system and C++ standard headers as it would for the clang
+  // command line. -fsyntax-only keeps it to a single frontend job, whose action is
+  // replaced below.
+  auto file_name = "spark-columnar-plugin-codegen-" + signature + ".cc";
+  std::vector<std::string> args = {"clang++", "-std=c++14", "-fsyntax-only"};
+  args.insert(args.end(), compile_args.begin(), compile_args.end());
+  args.push_back(file_name);
+  std::vector<const char*> argv;
+  for (const auto& arg : args) {
+    argv.push_back(arg.c_str());
+  }
+  std::shared_ptr<clang::CompilerInvocation> invocation =
+      clang::createInvocationFromCommandLine(argv, diagnostics);
+  if (invocation == nullptr) {
+    errors_os.flush();
+    return arrow::Status::Invalid("Invalid compile arguments: ", *errors);
+  }
+  // the codes are compiled from memory, nothing is written to disk
+  invocation->getPreprocessorOpts().addRemappedFile(
+      file_name, llvm::MemoryBuffer::getMemBufferCopy(codes, file_name).release());
+  invocation->getFrontendOpts().DisableFree = false;
+
+  clang::CompilerInstance compiler;
+  compiler.setInvocation(std::move(invocation));
+  compiler.setDiagnostics(diagnostics.get());
+  clang::EmitLLVMOnlyAction action(context);
+  if (!compiler.ExecuteAction(action)) {
+    errors_os.flush();
+    return arrow::Status::Invalid("Compilation failed: ", *errors);
+  }
+  auto module = action.takeModule();
+  if (module == nullptr) {
+    return arrow::Status::Invalid("Compilation of ", signature, " produced no module");
+  }
+  return std::move(module);
+}
+
+}  // namespace
+
+arrow::Result<void*> CompileInProcess(const std::string& codes,
+                                      const std::string& signature,
+                                      const std::vector<std::string>& compile_args) {
+  ARROW_ASSIGN_OR_RAISE(auto jit, GetJIT());
+
+  auto context = std::make_unique<llvm::LLVMContext>();
+  std::string errors;
+  ARROW_ASSIGN_OR_RAISE(auto module,
+                        CompileModule(codes, signature, compile_args, context.get(),
+                                      &errors));
+  module->setDataLayout(jit->getDataLayout());
+
+  // every kernel defines MakeCodeGen, each gets a library of its own
+  auto& library = jit->createJITDylib("nativesql_" + signature);
+  // the JVM loads this plugin with local symbols, search it and its dependencies
+  // explicitly rather than the global scope only
+  Dl_info plugin_info;
+  if (dladdr(reinterpret_cast<void*>(&CompileInProcess), &plugin_info) == 0) {
+    return arrow::Status::Invalid("Failed to locate the plugin library: ", dlerror());
+  }
+  auto generator = llvm::orc::DynamicLibrarySearchGenerator::Load(
+      plugin_info.dli_fname, jit->getDataLayout().getGlobalPrefix());
+  if (!generator) {
+    return arrow::Status::Invalid("Failed to resolve plugin symbols: ",
+                                  ToString(generator.takeError()));
+  }
+  library.addGenerator(std::move(*generator));
+  if (auto error = jit->addIRModule(
+          library, llvm::orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+    return arrow::Status::Invalid("Failed to add kernel ", signature, ": ",
+                                  ToString(std::move(error)));
+  }
+
+  auto symbol = jit->lookup(library, "MakeCodeGen");
+  if (!symbol) {
+    return arrow::Status::Invalid("Failed to link kernel ", signature, ": ",
+                                  ToString(symbol.takeError()));
+  }
+  // static initializers of the kernel, e.g. of the headers it includes
+  if (auto error = jit->runConstructors()) {
+    return arrow::Status::Invalid("Failed to initialize kernel ", signature, ": ",
+                                  ToString(std::move(error)));
+  }
+  return reinterpret_cast<void*>(static_cast<uintptr_t>(symbol->getAddress()));
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
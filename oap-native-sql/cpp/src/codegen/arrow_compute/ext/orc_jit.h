@@ -0,0 +1,42 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <arrow/result.h>
+
+#include <string>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// Compile codes with clang inside this process and link them with the ORC JIT, in a
+/// library of their own so that each kernel has its MakeCodeGen. Undefined symbols
+/// resolve to this plugin and the libraries it links, e.g. arrow.
+///
+/// \param compile_args compiler flags as for gcc, e.g. -I and -O
+/// \return address of the MakeCodeGen function of codes
+arrow::Result<void*> CompileInProcess(const std::string& codes,
+                                      const std::string& signature,
+                                      const std::vector<std::string>& compile_args);
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
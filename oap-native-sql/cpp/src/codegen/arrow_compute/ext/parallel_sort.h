@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "utils/task_scheduler.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// \brief Sort [begin, end) on num_threads threads of the task scheduler, the calling
+/// thread included
+///
+/// sort(chunk_begin, chunk_end) sorts contiguous chunks of about the same size
+/// concurrently, which are then merged pairwise by comp, the merges of a round running
+/// concurrently too. Ranges too small to pay for the threads are sorted on the calling
+/// thread only. sort and comp must order alike and be safe to call concurrently.
+template <typename Index, typename Sort, typename Comp>
+void ParallelSort(Index* begin, Index* end, int num_threads, Sort sort, Comp comp) {
+  constexpr int64_t kMinChunkRows = 1 << 15;
+  auto length = static_cast<int64_t>(end - begin);
+  auto num_chunks = std::min<int64_t>(num_threads, length / kMinChunkRows);
+  if (num_chunks <= 1) {
+    sort(begin, end);
+    return;
+  }
+
+  std::vector<Index*> bounds;
+  for (int64_t i = 0; i <= num_chunks; ++i) {
+    bounds.push_back(begin + length * i / num_chunks);
+  }
+  // run func(i) for each i in [0, n), on a thread each if the scheduler has them
+  auto run = [](int64_t n, const std::function<void(int64_t)>& func) {
+    auto status = TaskScheduler::Global()->ParallelFor(
+        n, static_cast<int>(n), [&func](int64_t i) {
+          func(i);
+          return arrow::Status::OK();
+        });
+    (void)status;
+  };
+  run(num_chunks, [&](int64_t i) { sort(bounds[i], bounds[i + 1]); });
+  for (int64_t width = 1; width < num_chunks; width *= 2) {
+    auto num_merges = (num_chunks + 2 * width - 1) / (2 * width);
+    run(num_merges, [&](int64_t i) {
+      auto first = 2 * width * i;
+      auto middle = std::min(first + width, num_chunks);
+      auto last = std::min(first + 2 * width, num_chunks);
+      std::inplace_merge(bounds[first], bounds[middle], bounds[last], comp);
+    });
+  }
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,55 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/compute/context.h>
+#include <arrow/type.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "codegen/arrow_compute/ext/code_generator_base.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// Makes the kernel of a variant compiled into the library, the parameters of its
+/// shape bound, as the MakeCodeGen of a generated kernel does
+using PrecompiledKernel = std::function<void(arrow::compute::FunctionContext* ctx,
+                                             std::shared_ptr<CodeGenBase>* out)>;
+
+/// \brief The sorter of SortArraysToIndicesKernel compiled into the library for the
+/// keys at key_indices of result_schema, false if their shape isn't one of the variants
+///
+/// The variants are template instances for one or two keys, either of them of int32,
+/// int64, date32 or double and the first one possibly of utf8, each for both item
+/// indices, and sort the same way as the generated sorter. The other columns may be of
+/// any integer, floating point, date32, boolean, utf8 or binary type, they are gathered
+/// through a virtual call per column and batch. Compact caches are left to the
+/// generated sorter.
+bool GetPrecompiledSorter(std::shared_ptr<arrow::Schema> result_schema,
+                          const std::vector<int>& key_indices, bool nulls_first, bool asc,
+                          PrecompiledKernel* out);
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
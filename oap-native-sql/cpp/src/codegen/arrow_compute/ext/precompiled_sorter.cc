@@ -0,0 +1,746 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/array.h>
+#include <arrow/buffer.h>
+#include <arrow/builder.h>
+#include <arrow/record_batch.h>
+#include <arrow/type_traits.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "codegen/arrow_compute/ext/array_item_index.h"
+#include "codegen/arrow_compute/ext/codegen_common.h"
+#include "codegen/arrow_compute/ext/compact_array.h"
+#include "codegen/arrow_compute/ext/gather.h"
+#include "codegen/arrow_compute/ext/key_prefix.h"
+#include "codegen/arrow_compute/ext/loser_tree.h"
+#include "codegen/arrow_compute/ext/parallel_sort.h"
+#include "codegen/arrow_compute/ext/precompiled_kernels.h"
+#include "codegen/common/result_iterator.h"
+#include "third_party/ska_sort.hpp"
+#include "utils/macros.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+namespace {
+
+// the payload types of the variants, see GetPrecompiledSorter
+#define PROCESS_SUPPORTED_COLUMN_TYPES(PROCESS) \
+  PROCESS(arrow::UInt8Type)                     \
+  PROCESS(arrow::Int8Type)                      \
+  PROCESS(arrow::UInt16Type)                    \
+  PROCESS(arrow::Int16Type)                     \
+  PROCESS(arrow::UInt32Type)                    \
+  PROCESS(arrow::Int32Type)                     \
+  PROCESS(arrow::UInt64Type)                    \
+  PROCESS(arrow::Int64Type)                     \
+  PROCESS(arrow::FloatType)                     \
+  PROCESS(arrow::DoubleType)                    \
+  PROCESS(arrow::Date32Type)                    \
+  PROCESS(arrow::BooleanType)                   \
+  PROCESS(arrow::StringType)                    \
+  PROCESS(arrow::BinaryType)
+
+/// \brief A column of the precompiled sorter, whatever its type
+///
+/// Holds the cached batches of a sort, or the current batches of the runs of a merge,
+/// and gathers them in sort order as the generated sorter does for each of its columns.
+template <typename ItemIndex>
+class SortColumn {
+ public:
+  virtual ~SortColumn() = default;
+
+  /// Cache in, the column of a batch to sort, bytes are those it keeps
+  virtual arrow::Status Cache(const std::shared_ptr<arrow::Array>& in,
+                              int64_t* bytes) = 0;
+
+  /// The cached values at items, read in order, see OrderByArray
+  virtual arrow::Status Gather(const ItemIndex* items, const int32_t* order,
+                               int64_t length, std::shared_ptr<arrow::Array>* out) = 0;
+
+  /// Make array the current batch of run r, in the slot following those loaded since
+  /// the last GatherRuns
+  virtual void LoadRun(int32_t num_runs, int32_t r,
+                       const std::shared_ptr<arrow::Array>& array) = 0;
+
+  /// The values of the loaded batches at items, whose array_id is their slot. The
+  /// slots are the runs from then on.
+  virtual arrow::Status GatherRuns(const WideArrayItemIndex* items, const int32_t* order,
+                                   int64_t length,
+                                   std::shared_ptr<arrow::Array>* out) = 0;
+};
+
+template <typename DataType, typename ItemIndex>
+class TypedSortColumn : public SortColumn<ItemIndex> {
+ public:
+  using ArrayType = typename arrow::TypeTraits<DataType>::ArrayType;
+  using BuilderType = typename arrow::TypeTraits<DataType>::BuilderType;
+
+  static arrow::Status Make(arrow::MemoryPool* pool,
+                            const std::shared_ptr<arrow::DataType>& type,
+                            std::shared_ptr<TypedSortColumn>* out) {
+    std::unique_ptr<arrow::ArrayBuilder> builder;
+    RETURN_NOT_OK(arrow::MakeBuilder(pool, type, &builder));
+    *out = std::make_shared<TypedSortColumn>(pool);
+    (*out)->builder_.reset(static_cast<BuilderType*>(builder.release()));
+    return arrow::Status::OK();
+  }
+
+  explicit TypedSortColumn(arrow::MemoryPool* pool) : pool_(pool) {}
+
+  arrow::Status Cache(const std::shared_ptr<arrow::Array>& in, int64_t* bytes) override {
+    RETURN_NOT_OK(CacheArray(in, pool_, &cached_));
+    *bytes = CachedArrayBytes(*cached_.back());
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Gather(const ItemIndex* items, const int32_t* order, int64_t length,
+                       std::shared_ptr<arrow::Array>* out) override {
+    return GatherArray(cached_, items, order, length, pool_, builder_.get(), out);
+  }
+
+  void LoadRun(int32_t num_runs, int32_t r,
+               const std::shared_ptr<arrow::Array>& array) override {
+    runs_.resize(num_runs);
+    runs_[r] = std::static_pointer_cast<ArrayType>(array);
+    slots_.push_back(runs_[r]);
+  }
+
+  arrow::Status GatherRuns(const WideArrayItemIndex* items, const int32_t* order,
+                           int64_t length, std::shared_ptr<arrow::Array>* out) override {
+    RETURN_NOT_OK(GatherArray(slots_, items, order, length, pool_, builder_.get(), out));
+    slots_ = runs_;
+    return arrow::Status::OK();
+  }
+
+  const std::vector<std::shared_ptr<ArrayType>>& cached() const { return cached_; }
+  const std::vector<std::shared_ptr<ArrayType>>& runs() const { return runs_; }
+
+ private:
+  arrow::MemoryPool* pool_;
+  std::unique_ptr<BuilderType> builder_;
+  std::vector<std::shared_ptr<ArrayType>> cached_;
+  // current batch of each run, and batches of the slots
+  std::vector<std::shared_ptr<ArrayType>> runs_;
+  std::vector<std::shared_ptr<ArrayType>> slots_;
+};
+
+template <typename ItemIndex>
+arrow::Status MakeSortColumn(arrow::MemoryPool* pool,
+                             const std::shared_ptr<arrow::DataType>& type,
+                             std::shared_ptr<SortColumn<ItemIndex>>* out) {
+  switch (type->id()) {
+#define PROCESS(InType)                                                   \
+  case InType::type_id: {                                                 \
+    std::shared_ptr<TypedSortColumn<InType, ItemIndex>> column;           \
+    RETURN_NOT_OK(                                                        \
+        (TypedSortColumn<InType, ItemIndex>::Make(pool, type, &column))); \
+    *out = std::move(column);                                             \
+    return arrow::Status::OK();                                           \
+  }
+    PROCESS_SUPPORTED_COLUMN_TYPES(PROCESS)
+#undef PROCESS
+    default:
+      return arrow::Status::NotImplemented("Precompiled sorter doesn't support ",
+                                           type->ToString());
+  }
+}
+
+bool IsSupportedColumnType(const arrow::DataType& type) {
+  switch (type.id()) {
+#define PROCESS(InType) case InType::type_id:
+    PROCESS_SUPPORTED_COLUMN_TYPES(PROCESS)
+#undef PROCESS
+    return true;
+    default:
+      return false;
+  }
+}
+
+/// \brief The columns of a result schema, those of the keys typed
+template <typename ItemIndex, typename... KeyTypes>
+class SortColumns {
+ public:
+  static constexpr size_t kNumKeys = sizeof...(KeyTypes);
+  using KeyColumns = std::tuple<TypedSortColumn<KeyTypes, ItemIndex>*...>;
+  using FirstKeyType = typename std::tuple_element<0, std::tuple<KeyTypes...>>::type;
+
+  arrow::Status Make(arrow::MemoryPool* pool, const arrow::Schema& schema,
+                     const std::vector<int>& key_indices) {
+    columns_.resize(schema.num_fields());
+    RETURN_NOT_OK(MakeKeys(pool, schema, key_indices));
+    for (int i = 0; i < schema.num_fields(); ++i) {
+      if (columns_[i] == nullptr) {
+        RETURN_NOT_OK(MakeSortColumn(pool, schema.field(i)->type(), &columns_[i]));
+      }
+    }
+    return arrow::Status::OK();
+  }
+
+  const std::vector<std::shared_ptr<SortColumn<ItemIndex>>>& columns() const {
+    return columns_;
+  }
+
+  template <size_t I>
+  const TypedSortColumn<typename std::tuple_element<I, std::tuple<KeyTypes...>>::type,
+                        ItemIndex>&
+  key() const {
+    return *std::get<I>(keys_);
+  }
+
+  /// Whether cached row x comes before cached row y, by the keys from the I-th
+  template <size_t I = 0>
+  typename std::enable_if<(I < kNumKeys), bool>::type Less(const ItemIndex& x,
+                                                           const ItemIndex& y,
+                                                           bool asc) const {
+    const auto& arrays = std::get<I>(keys_)->cached();
+    auto x_key = arrays[x.array_id]->GetView(x.id);
+    auto y_key = arrays[y.array_id]->GetView(y.id);
+    if (x_key == y_key) {
+      return Less<I + 1>(x, y, asc);
+    }
+    return asc ? x_key < y_key : x_key > y_key;
+  }
+
+  template <size_t I = 0>
+  typename std::enable_if<(I == kNumKeys), bool>::type Less(const ItemIndex& x,
+                                                            const ItemIndex& y,
+                                                            bool asc) const {
+    return false;
+  }
+
+  /// Whether row x of run a comes before row y of run b by the keys from the I-th,
+  /// tie_less if their keys are equal
+  template <size_t I = 0>
+  typename std::enable_if<(I < kNumKeys), bool>::type RunLess(int32_t a, int64_t x,
+                                                              int32_t b, int64_t y,
+                                                              bool asc,
+                                                              bool tie_less) const {
+    const auto& runs = std::get<I>(keys_)->runs();
+    auto x_key = runs[a]->GetView(x);
+    auto y_key = runs[b]->GetView(y);
+    if (x_key != y_key) {
+      return asc ? x_key < y_key : x_key > y_key;
+    }
+    return RunLess<I + 1>(a, x, b, y, asc, tie_less);
+  }
+
+  template <size_t I = 0>
+  typename std::enable_if<(I == kNumKeys), bool>::type RunLess(int32_t a, int64_t x,
+                                                               int32_t b, int64_t y,
+                                                               bool asc,
+                                                               bool tie_less) const {
+    return tie_less;
+  }
+
+ private:
+  template <size_t I = 0>
+  typename std::enable_if<(I < kNumKeys), arrow::Status>::type MakeKeys(
+      arrow::MemoryPool* pool, const arrow::Schema& schema,
+      const std::vector<int>& key_indices) {
+    using Column = typename std::remove_pointer<
+        typename std::tuple_element<I, KeyColumns>::type>::type;
+    auto index = key_indices[I];
+    std::shared_ptr<Column> column;
+    RETURN_NOT_OK(Column::Make(pool, schema.field(index)->type(), &column));
+    std::get<I>(keys_) = column.get();
+    columns_[index] = std::move(column);
+    return MakeKeys<I + 1>(pool, schema, key_indices);
+  }
+
+  template <size_t I = 0>
+  typename std::enable_if<(I == kNumKeys), arrow::Status>::type MakeKeys(
+      arrow::MemoryPool* pool, const arrow::Schema& schema,
+      const std::vector<int>& key_indices) {
+    return arrow::Status::OK();
+  }
+
+  std::vector<std::shared_ptr<SortColumn<ItemIndex>>> columns_;
+  // the columns of the keys, owned by columns_
+  KeyColumns keys_;
+};
+
+/// \brief The generated TypedSorterImpl of SortArraysToIndicesKernel, for keys of
+/// KeyTypes
+///
+/// Places the rows with a null first column first or last in input order and sorts the
+/// others by the keys, the first one by its normalized prefix unless a single
+/// ascending key is radix sorted by ska_sort. The sorted rows are gathered column by
+/// column, and sorted runs merged by a loser tree.
+template <typename ItemIndex, typename... KeyTypes>
+class PrecompiledSorter : public CodeGenBase {
+ public:
+  using Columns = SortColumns<ItemIndex, KeyTypes...>;
+  using FirstKeyType = typename Columns::FirstKeyType;
+
+  PrecompiledSorter(arrow::compute::FunctionContext* ctx,
+                    std::shared_ptr<arrow::Schema> result_schema,
+                    std::vector<int> key_indices, bool nulls_first, bool asc)
+      : ctx_(ctx),
+        result_schema_(std::move(result_schema)),
+        key_indices_(std::move(key_indices)),
+        nulls_first_(nulls_first),
+        asc_(asc) {
+    THROW_NOT_OK(columns_.Make(ctx_->memory_pool(), *result_schema_, key_indices_));
+  }
+
+  arrow::Status Evaluate(const ArrayList& in) override {
+    if (num_batches_ >= ItemIndex::kMaxArrays ||
+        static_cast<uint64_t>(in[0]->length()) > ItemIndex::kMaxRows) {
+      return arrow::Status::Invalid(
+          "Sort input exceeds ", ItemIndex::kMaxArrays, " batches of ",
+          ItemIndex::kMaxRows, " rows, set NATIVESQL_ITEM_INDEX=wide");
+    }
+    num_batches_++;
+    items_total_ += in[0]->length();
+    nulls_total_ += in[0]->null_count();
+    first_.push_back(in[0]);
+    for (size_t i = 0; i < columns_.columns().size(); ++i) {
+      int64_t bytes;
+      RETURN_NOT_OK(columns_.columns()[i]->Cache(in[i], &bytes));
+      cached_bytes_ += bytes;
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Finish(std::shared_ptr<arrow::Array>* out) override {
+    std::shared_ptr<arrow::Buffer> indices_buf;
+    int64_t buf_size = items_total_ * sizeof(ItemIndex);
+    RETURN_NOT_OK(arrow::AllocateBuffer(ctx_->memory_pool(), buf_size, &indices_buf));
+
+    auto indices_begin = reinterpret_cast<ItemIndex*>(indices_buf->mutable_data());
+    auto valid_begin = nulls_first_ ? indices_begin + nulls_total_ : indices_begin;
+    auto null_begin =
+        nulls_first_ ? indices_begin : indices_begin + items_total_ - nulls_total_;
+    int64_t indices_i = 0;
+    int64_t indices_null = 0;
+    for (uint64_t array_id = 0; array_id < num_batches_; array_id++) {
+      const auto& first = *first_[array_id];
+      for (int64_t i = 0; i < first.length(); i++) {
+        if (!first.IsNull(i)) {
+          valid_begin[indices_i++] = ItemIndex(array_id, i);
+        } else {
+          null_begin[indices_null++] = ItemIndex(array_id, i);
+        }
+      }
+    }
+
+    auto comp = [this](const ItemIndex& x, const ItemIndex& y) {
+      return columns_.Less(x, y, asc_);
+    };
+    ParallelSort(
+        valid_begin, valid_begin + (items_total_ - nulls_total_), sort_threads_,
+        [this, &comp](ItemIndex* begin, ItemIndex* end) {
+          SortChunk(begin, end, comp, std::is_same<FirstKeyType, arrow::StringType>());
+        },
+        comp);
+
+    auto out_type = std::make_shared<arrow::FixedSizeBinaryType>(sizeof(ItemIndex) /
+                                                                 sizeof(int32_t));
+    *out = std::make_shared<arrow::FixedSizeBinaryArray>(out_type, items_total_,
+                                                         indices_buf);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status MakeResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override {
+    std::shared_ptr<arrow::Array> indices_out;
+    RETURN_NOT_OK(Finish(&indices_out));
+    *out = std::make_shared<SorterResultIterator>(indices_out, columns_.columns(),
+                                                  result_schema_);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status MakeMergeResultIterator(
+      std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> runs,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override {
+    auto merge = std::make_shared<MergeSorterResultIterator>(std::move(runs),
+                                                             result_schema_,
+                                                             nulls_first_, asc_);
+    RETURN_NOT_OK(merge->Init(ctx_->memory_pool(), key_indices_));
+    *out = std::move(merge);
+    return arrow::Status::OK();
+  }
+
+  int64_t CachedBytes() override { return cached_bytes_; }
+
+ private:
+  // the first key of strings, its ties are refined on the following bytes
+  template <typename Comp>
+  void SortChunk(ItemIndex* begin, ItemIndex* end, Comp& comp, std::true_type) const {
+    const auto& arrays = columns_.template key<0>().cached();
+    auto asc = asc_;
+    SortByStringPrefix(begin, end,
+                       [&arrays, asc](const ItemIndex& x, size_t offset) {
+                         auto key = arrays[x.array_id]->GetView(x.id);
+                         auto prefix = NormalizeKeyPrefix(key, offset);
+                         return asc ? prefix : ~prefix;
+                       },
+                       comp);
+  }
+
+  template <typename Comp>
+  void SortChunk(ItemIndex* begin, ItemIndex* end, Comp& comp, std::false_type) const {
+    const auto& arrays = columns_.template key<0>().cached();
+    if (asc_ && Columns::kNumKeys == 1) {
+      ska_sort(begin, end, [&arrays](const ItemIndex& x) {
+        return arrays[x.array_id]->GetView(x.id);
+      });
+      return;
+    }
+    // radix sort on the first key, comp only breaks the ties of its prefix
+    auto asc = asc_;
+    SortByKeyPrefix(begin, end,
+                    [&arrays, asc](const ItemIndex& x) {
+                      auto prefix = NormalizeKeyPrefix(arrays[x.array_id]->GetView(x.id));
+                      return asc ? prefix : ~prefix;
+                    },
+                    comp);
+  }
+
+  class SorterResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    SorterResultIterator(std::shared_ptr<arrow::Array> indices_in,
+                         std::vector<std::shared_ptr<SortColumn<ItemIndex>>> columns,
+                         std::shared_ptr<arrow::Schema> result_schema)
+        : total_length_(indices_in->length()),
+          indices_in_cache_(std::move(indices_in)),
+          columns_(std::move(columns)),
+          result_schema_(std::move(result_schema)) {
+      indices_begin_ = reinterpret_cast<ItemIndex*>(
+          indices_in_cache_->data()->buffers[1]->mutable_data());
+    }
+
+    std::string ToString() override { return "SortArraysToIndicesResultIterator"; }
+
+    bool HasNext() override { return offset_ < total_length_; }
+
+    void SetLimit(int64_t limit) override {
+      total_length_ = std::min<uint64_t>(total_length_, offset_ + limit);
+      if (offset_ >= total_length_) {
+        indices_in_cache_ = nullptr;
+        columns_.clear();
+      }
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      auto length = std::min<uint64_t>(total_length_ - offset_, batch_sizer_.rows());
+      // read the cached batches one at a time rather than in sort order
+      auto items = indices_begin_ + offset_;
+      OrderByArray(items, length, &order_);
+      ArrayList arrays;
+      for (const auto& column : columns_) {
+        std::shared_ptr<arrow::Array> array;
+        RETURN_NOT_OK(column->Gather(items, order_.data(), length, &array));
+        arrays.push_back(std::move(array));
+      }
+      offset_ += length;
+      *out = arrow::RecordBatch::Make(result_schema_, length, arrays);
+      batch_sizer_.Update(**out);
+      return arrow::Status::OK();
+    }
+
+   private:
+    uint64_t total_length_;
+    std::shared_ptr<arrow::Array> indices_in_cache_;
+    std::vector<std::shared_ptr<SortColumn<ItemIndex>>> columns_;
+    std::shared_ptr<arrow::Schema> result_schema_;
+    uint64_t offset_ = 0;
+    ItemIndex* indices_begin_;
+    std::vector<int32_t> order_;
+    BatchSizer batch_sizer_;
+  };
+
+  // k-way merge of sorted runs with a loser tree, in the order of Finish
+  class MergeSorterResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    MergeSorterResultIterator(
+        std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> runs,
+        std::shared_ptr<arrow::Schema> result_schema, bool nulls_first, bool asc)
+        : runs_(std::move(runs)),
+          num_runs_(runs_.size()),
+          result_schema_(std::move(result_schema)),
+          nulls_first_(nulls_first),
+          asc_(asc),
+          tree_(num_runs_, RunLess{this}),
+          rows_(num_runs_, 0),
+          lengths_(num_runs_, 0),
+          slots_(num_runs_, 0),
+          done_(num_runs_, false),
+          first_runs_(num_runs_) {}
+
+    arrow::Status Init(arrow::MemoryPool* pool, const std::vector<int>& key_indices) {
+      return columns_.Make(pool, *result_schema_, key_indices);
+    }
+
+    std::string ToString() override { return "SortArraysToIndicesMergeResultIterator"; }
+
+    bool HasNext() override {
+      if (remaining_ == 0) {
+        return false;
+      }
+      if (!started_) {
+        started_ = true;
+        status_ = Start();
+      }
+      if (!status_.ok()) {
+        return true;
+      }
+      auto winner = tree_.Winner();
+      return winner >= 0 && !done_[winner];
+    }
+
+    void SetLimit(int64_t limit) override {
+      if (remaining_ < 0 || limit < remaining_) {
+        remaining_ = limit;
+      }
+      if (remaining_ == 0) {
+        // the run files are removed with their iterators
+        runs_.clear();
+        first_runs_.clear();
+      }
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      if (!HasNext()) {
+        return arrow::Status::Invalid("No more batches in sort merge");
+      }
+      RETURN_NOT_OK(status_);
+      items_.clear();
+      auto max_rows = remaining_ < 0 ? batch_sizer_.rows()
+                                     : std::min<int64_t>(batch_sizer_.rows(), remaining_);
+      while (static_cast<int64_t>(items_.size()) < max_rows) {
+        auto winner = tree_.Winner();
+        if (done_[winner]) {
+          break;
+        }
+        items_.emplace_back(slots_[winner], rows_[winner]);
+        if (++rows_[winner] == lengths_[winner]) {
+          RETURN_NOT_OK(LoadNext(winner));
+        }
+        tree_.Replay(winner);
+      }
+      int64_t length = items_.size();
+      OrderByArray(items_.data(), length, &order_);
+      ArrayList arrays;
+      for (const auto& column : columns_.columns()) {
+        std::shared_ptr<arrow::Array> array;
+        RETURN_NOT_OK(column->GatherRuns(items_.data(), order_.data(), length, &array));
+        arrays.push_back(std::move(array));
+      }
+      // only the current batches of the runs are referenced from now on
+      for (int32_t r = 0; r < num_runs_; ++r) {
+        slots_[r] = r;
+      }
+      num_slots_ = num_runs_;
+      *out = arrow::RecordBatch::Make(result_schema_, length, arrays);
+      batch_sizer_.Update(**out);
+      if (remaining_ > 0) {
+        SetLimit(remaining_ - length);
+      }
+      return arrow::Status::OK();
+    }
+
+   private:
+    struct RunLess {
+      MergeSorterResultIterator* iter;
+      bool operator()(int32_t a, int32_t b) const { return iter->Less(a, b); }
+    };
+
+    arrow::Status Start() {
+      for (int32_t r = 0; r < num_runs_; ++r) {
+        RETURN_NOT_OK(LoadNext(r));
+      }
+      tree_.Build();
+      return arrow::Status::OK();
+    }
+
+    // Move run r to its next non-empty batch, or mark it done
+    arrow::Status LoadNext(int32_t r) {
+      while (runs_[r]->HasNext()) {
+        std::shared_ptr<arrow::RecordBatch> batch;
+        RETURN_NOT_OK(runs_[r]->Next(&batch));
+        if (batch->num_rows() == 0) {
+          continue;
+        }
+        for (int i = 0; i < batch->num_columns(); ++i) {
+          columns_.columns()[i]->LoadRun(num_runs_, r, batch->column(i));
+        }
+        first_runs_[r] = batch->column(0);
+        slots_[r] = num_slots_++;
+        rows_[r] = 0;
+        lengths_[r] = batch->num_rows();
+        return arrow::Status::OK();
+      }
+      done_[r] = true;
+      return arrow::Status::OK();
+    }
+
+    // Whether the current row of run a comes before the one of run b, done runs last
+    // and ties in run order. The null rows of the first column come first or last in
+    // input order, as placed by Finish, the others are ordered by the keys.
+    bool Less(int32_t a, int32_t b) const {
+      if (done_[a] || done_[b]) {
+        return done_[a] == done_[b] ? a < b : done_[b];
+      }
+      auto x = rows_[a];
+      auto y = rows_[b];
+      bool x_null = first_runs_[a]->IsNull(x);
+      bool y_null = first_runs_[b]->IsNull(y);
+      if (x_null || y_null) {
+        return x_null == y_null ? a < b : (nulls_first_ ? x_null : y_null);
+      }
+      return columns_.RunLess(a, x, b, y, asc_, a < b);
+    }
+
+    std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> runs_;
+    const int32_t num_runs_;
+    std::shared_ptr<arrow::Schema> result_schema_;
+    const bool nulls_first_;
+    const bool asc_;
+    Columns columns_;
+    LoserTree<RunLess> tree_;
+    // current row, and rows of the current batch, of each run
+    std::vector<int64_t> rows_;
+    std::vector<int64_t> lengths_;
+    // slot of the current batch of each run, the slots hold the batches of the rows of
+    // the batch being merged
+    std::vector<int32_t> slots_;
+    std::vector<bool> done_;
+    // the current batch of the first column of each run, for its nulls
+    std::vector<std::shared_ptr<arrow::Array>> first_runs_;
+    int32_t num_slots_ = 0;
+    std::vector<WideArrayItemIndex> items_;
+    std::vector<int32_t> order_;
+    BatchSizer batch_sizer_;
+    bool started_ = false;
+    arrow::Status status_;
+    // rows to merge at most, -1 for all of them
+    int64_t remaining_ = -1;
+  };
+
+  arrow::compute::FunctionContext* ctx_;
+  std::shared_ptr<arrow::Schema> result_schema_;
+  const std::vector<int> key_indices_;
+  const bool nulls_first_;
+  const bool asc_;
+  Columns columns_;
+  std::vector<std::shared_ptr<arrow::Array>> first_;
+  const int sort_threads_ = GetSortThreads();
+  uint64_t num_batches_ = 0;
+  uint64_t items_total_ = 0;
+  uint64_t nulls_total_ = 0;
+  int64_t cached_bytes_ = 0;
+};
+
+template <typename T>
+struct TypeTag {
+  using Type = T;
+};
+
+// Call visit(TypeTag<KeyType>()) for the key type of type among the precompiled ones,
+// false without calling it if there is none. Strings are first keys only.
+template <typename Visit>
+bool VisitKeyType(const arrow::DataType& type, bool first, Visit&& visit) {
+  switch (type.id()) {
+    case arrow::Type::INT32:
+      return visit(TypeTag<arrow::Int32Type>());
+    case arrow::Type::INT64:
+      return visit(TypeTag<arrow::Int64Type>());
+    case arrow::Type::DATE32:
+      return visit(TypeTag<arrow::Date32Type>());
+    case arrow::Type::DOUBLE:
+      return visit(TypeTag<arrow::DoubleType>());
+    case arrow::Type::STRING:
+      return first && visit(TypeTag<arrow::StringType>());
+    default:
+      return false;
+  }
+}
+
+template <typename ItemIndex, typename... KeyTypes>
+PrecompiledKernel MakePrecompiledSorter(std::shared_ptr<arrow::Schema> result_schema,
+                                        const std::vector<int>& key_indices,
+                                        bool nulls_first, bool asc) {
+  return [result_schema, key_indices, nulls_first, asc](
+             arrow::compute::FunctionContext* ctx, std::shared_ptr<CodeGenBase>* out) {
+    *out = std::make_shared<PrecompiledSorter<ItemIndex, KeyTypes...>>(
+        ctx, result_schema, key_indices, nulls_first, asc);
+  };
+}
+
+template <typename ItemIndex>
+bool GetTypedSorter(std::shared_ptr<arrow::Schema> result_schema,
+                    const std::vector<int>& key_indices, bool nulls_first, bool asc,
+                    PrecompiledKernel* out) {
+  const auto& first_type = *result_schema->field(key_indices[0])->type();
+  return VisitKeyType(first_type, true, [&](auto first_tag) {
+    using FirstKeyType = typename decltype(first_tag)::Type;
+    if (key_indices.size() == 1) {
+      *out = MakePrecompiledSorter<ItemIndex, FirstKeyType>(result_schema, key_indices,
+                                                            nulls_first, asc);
+      return true;
+    }
+    const auto& second_type = *result_schema->field(key_indices[1])->type();
+    return VisitKeyType(second_type, false, [&](auto second_tag) {
+      using SecondKeyType = typename decltype(second_tag)::Type;
+      *out = MakePrecompiledSorter<ItemIndex, FirstKeyType, SecondKeyType>(
+          result_schema, key_indices, nulls_first, asc);
+      return true;
+    });
+  });
+}
+
+#undef PROCESS_SUPPORTED_COLUMN_TYPES
+
+}  // namespace
+
+bool GetPrecompiledSorter(std::shared_ptr<arrow::Schema> result_schema,
+                          const std::vector<int>& key_indices, bool nulls_first, bool asc,
+                          PrecompiledKernel* out) {
+  if (key_indices.empty() || key_indices.size() > 2 || GetCompactCache()) {
+    return false;
+  }
+  for (const auto& field : result_schema->fields()) {
+    if (!IsSupportedColumnType(*field->type())) {
+      return false;
+    }
+  }
+  if (GetItemIndexType() == "WideArrayItemIndex") {
+    return GetTypedSorter<WideArrayItemIndex>(result_schema, key_indices, nulls_first,
+                                              asc, out);
+  }
+  return GetTypedSorter<ArrayItemIndex>(result_schema, key_indices, nulls_first, asc,
+                                        out);
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
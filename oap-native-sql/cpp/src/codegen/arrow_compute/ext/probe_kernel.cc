@@ -15,7 +15,9 @@
  * limitations under the License.
  */
 
+#include <arrow/builder.h>
 #include <arrow/compute/context.h>
+#include <arrow/io/file.h>
 #include <arrow/status.h>
 #include <arrow/type.h>
 #include <arrow/type_fwd.h>
@@ -31,9 +33,12 @@
 #include <unistd.h>
 
 #include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
 
 #include "codegen/arrow_compute/ext/array_item_index.h"
@@ -41,6 +46,9 @@
 #include "codegen/arrow_compute/ext/codegen_common.h"
 #include "codegen/arrow_compute/ext/codegen_node_visitor.h"
 #include "codegen/arrow_compute/ext/kernels_ext.h"
+#include "codegen/arrow_compute/ext/spill.h"
+#include "shuffle/reader.h"
+#include "shuffle/splitter.h"
 #include "utils/macros.h"
 
 namespace sparkcolumnarplugin {
@@ -59,12 +67,28 @@ class ConditionedProbeArraysKernel::Impl {
        const std::shared_ptr<gandiva::Node>& func_node, int join_type,
        const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
        const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
-       const std::shared_ptr<arrow::Schema>& result_schema)
-      : ctx_(ctx) {
+       const std::shared_ptr<arrow::Schema>& result_schema,
+       std::shared_ptr<KernelMetrics> metrics)
+      : ctx_(ctx),
+        metrics_(std::move(metrics)),
+        left_schema_(arrow::schema(left_field_list)),
+        right_schema_(arrow::schema(right_field_list)) {
+    if (join_type == 5) {
+      // Spark plans NOT IN as a null aware anti join only on a single key without
+      // other condition
+      if (func_node || left_key_list.size() != 1) {
+        THROW_NOT_OK(arrow::Status::NotImplemented(
+            "Null aware anti join takes a single key and no condition"));
+      }
+      // a partition of a grace hash join doesn't know the null keys of the others
+      can_spill_ = false;
+    }
     std::vector<int> left_key_index_list;
     THROW_NOT_OK(GetIndexList(left_key_list, left_field_list, &left_key_index_list));
     std::vector<int> right_key_index_list;
     THROW_NOT_OK(GetIndexList(right_key_list, right_field_list, &right_key_index_list));
+    left_key_indices_.assign(left_key_index_list.begin(), left_key_index_list.end());
+    right_key_indices_.assign(right_key_index_list.begin(), right_key_index_list.end());
 
     std::vector<int> left_shuffle_index_list;
     std::vector<int> right_shuffle_index_list;
@@ -81,28 +105,390 @@ class ConditionedProbeArraysKernel::Impl {
     THROW_NOT_OK(LoadJITFunction(func_node, join_type, left_key_index_list,
                                  right_key_index_list, left_shuffle_index_list,
                                  right_shuffle_index_list, left_field_list,
-                                 right_field_list, result_schema_index_list, exist_index, &prober_));
+                                 right_field_list, result_schema_index_list, exist_index,
+                                 &prober_kernel_));
   }
 
   arrow::Status Evaluate(const ArrayList& in_arr_list) {
+    if (build_splitter_ != nullptr) {
+      return SplitArrays(build_splitter_.get(), left_schema_, in_arr_list);
+    }
     // cache in_arr_list for prober data shuffling
+    RETURN_NOT_OK(MakeKernel(prober_kernel_, ctx_, &prober_));
     RETURN_NOT_OK(prober_->Evaluate(in_arr_list));
+
+    auto memory_budget = GetJoinMemoryBudget();
+    if (memory_budget <= 0 || !can_spill_) {
+      return arrow::Status::OK();
+    }
+    build_arrays_.push_back(in_arr_list);
+    build_bytes_ += ArrayListBytes(in_arr_list);
+    if (build_bytes_ > memory_budget) {
+      // grace hash join from now on: the build side is spilled by hash partition, and
+      // the hash table built so far is dropped
+      auto splitter = MakeSpillSplitter(left_schema_, left_key_indices_,
+                                        kGraceJoinPartitions, memory_budget);
+      if (!splitter.ok()) {
+        // keys the splitter can't hash, stay in memory
+        can_spill_ = false;
+        build_arrays_.clear();
+        return arrow::Status::OK();
+      }
+      build_splitter_ = splitter.ValueOrDie();
+      for (const auto& arrays : build_arrays_) {
+        RETURN_NOT_OK(SplitArrays(build_splitter_.get(), left_schema_, arrays));
+      }
+      build_arrays_.clear();
+      prober_ = nullptr;
+    }
     return arrow::Status::OK();
   }
 
   arrow::Status MakeResultIterator(
       std::shared_ptr<arrow::Schema> schema,
       std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+    if (spilled_) {
+      // the partition files are consumed by the first iterator
+      return arrow::Status::Invalid("A spilled hash join can only be probed once");
+    }
+    if (build_splitter_ != nullptr) {
+      spilled_ = true;
+      RETURN_NOT_OK(StopSpillSplitter(build_splitter_.get(), &metrics_->spill_bytes));
+      auto memory_budget = GetJoinMemoryBudget();
+      ARROW_ASSIGN_OR_RAISE(auto probe_splitter,
+                            MakeSpillSplitter(right_schema_, right_key_indices_,
+                                              kGraceJoinPartitions, memory_budget));
+      *out = std::make_shared<GraceProberResultIterator>(
+          this, schema, build_splitter_->GetPartitionFileInfo(),
+          std::move(probe_splitter), memory_budget);
+      build_splitter_ = nullptr;
+      return arrow::Status::OK();
+    }
+    build_arrays_.clear();
+    RETURN_NOT_OK(MakeKernel(prober_kernel_, ctx_, &prober_));
     RETURN_NOT_OK(prober_->MakeResultIterator(schema, out));
     return arrow::Status::OK();
   }
 
+  void UpdateMetrics(KernelMetrics* metrics) {
+    if (prober_ != nullptr) {
+      prober_->UpdateMetrics(metrics);
+    }
+  }
+
  private:
   using ArrayType = typename arrow::TypeTraits<arrow::Int64Type>::ArrayType;
+  using Splitter = sparkcolumnarplugin::shuffle::Splitter;
+  using ShuffleReader = sparkcolumnarplugin::shuffle::ShuffleReader;
+
+  /// Number of hash partitions of each level of a grace hash join
+  static constexpr int32_t kGraceJoinPartitions = 16;
+  /// Levels of repartitioning of the partitions still over the memory budget, the
+  /// partitions of the last level are joined whatever their size
+  static constexpr int kGraceJoinMaxLevels = 3;
+
+  /// \brief Probes a grace hash join
+  ///
+  /// Process spills the probe batches by hash partition as they come and returns empty
+  /// batches. Once the probe side is over, HasNext and Next join the partitions of both
+  /// sides one at a time, each with a prober of its own. Partitions of a build side
+  /// still over the memory budget are partitioned again into more hash partitions,
+  /// e.g. for skewed keys.
+  class GraceProberResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    GraceProberResultIterator(
+        Impl* kernel, std::shared_ptr<arrow::Schema> schema,
+        const std::vector<std::pair<int32_t, std::string>>& build_files,
+        std::shared_ptr<Splitter> probe_splitter, int64_t memory_budget)
+        : ctx_(kernel->ctx_),
+          metrics_(kernel->metrics_),
+          prober_kernel_(kernel->prober_kernel_),
+          left_schema_(kernel->left_schema_),
+          right_schema_(kernel->right_schema_),
+          left_key_indices_(kernel->left_key_indices_),
+          right_key_indices_(kernel->right_key_indices_),
+          result_schema_(std::move(schema)),
+          build_files_(build_files),
+          probe_splitter_(std::move(probe_splitter)),
+          memory_budget_(memory_budget) {}
+
+    ~GraceProberResultIterator() {
+      // files of the partitions not joined yet
+      if (!probe_done_) {
+        for (const auto& file : build_files_) {
+          std::remove(file.second.c_str());
+        }
+      }
+      for (const auto& partition : partitions_) {
+        std::remove(partition.build_file.c_str());
+        std::remove(partition.probe_file.c_str());
+      }
+    }
+
+    std::string ToString() override { return "GraceProberResultIterator"; }
+
+    arrow::Status Process(const ArrayList& in, std::shared_ptr<arrow::RecordBatch>* out,
+                          const std::shared_ptr<arrow::Array>& selection) override {
+      if (probe_done_) {
+        return arrow::Status::Invalid("Grace hash join probe side is over");
+      }
+      if (!stopped_) {
+        RETURN_NOT_OK(SplitArrays(probe_splitter_.get(), right_schema_, in));
+      }
+      // the rows are joined once the probe side is over, see HasNext
+      ArrayList empty;
+      for (const auto& field : result_schema_->fields()) {
+        std::unique_ptr<arrow::ArrayBuilder> builder;
+        RETURN_NOT_OK(arrow::MakeBuilder(ctx_->memory_pool(), field->type(), &builder));
+        std::shared_ptr<arrow::Array> array;
+        RETURN_NOT_OK(builder->Finish(&array));
+        empty.push_back(std::move(array));
+      }
+      *out = arrow::RecordBatch::Make(result_schema_, 0, std::move(empty));
+      return arrow::Status::OK();
+    }
+
+    bool HasNext() override {
+      if (stopped_) {
+        return false;
+      }
+      if (next_ == nullptr && status_.ok()) {
+        status_ = JoinNext();
+      }
+      return next_ != nullptr || !status_.ok();
+    }
+
+    // Drop the partitions not joined yet once the consumer is done
+    void SetLimit(int64_t limit) override {
+      if (limit > 0 || stopped_) {
+        return;
+      }
+      stopped_ = true;
+      next_ = nullptr;
+      probe_batch_ = nullptr;
+      probe_reader_ = nullptr;
+      prober_iter_ = nullptr;
+      build_batches_.clear();
+      for (const auto& partition : partitions_) {
+        std::remove(partition.build_file.c_str());
+        std::remove(partition.probe_file.c_str());
+      }
+      partitions_.clear();
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      if (!HasNext()) {
+        return arrow::Status::Invalid("No more batches in grace hash join");
+      }
+      RETURN_NOT_OK(status_);
+      *out = std::move(next_);
+      next_ = nullptr;
+      return arrow::Status::OK();
+    }
+
+   private:
+    struct Partition {
+      std::string build_file;
+      std::string probe_file;
+      // number of hash partitions of the level of this partition
+      int32_t num_partitions;
+    };
+
+    // Stop spilling the probe side and pair the partition files of both sides
+    arrow::Status FinishProbe() {
+      probe_done_ = true;
+      RETURN_NOT_OK(StopSpillSplitter(probe_splitter_.get(), &metrics_->spill_bytes));
+      std::vector<std::pair<int32_t, std::string>> probe_files =
+          probe_splitter_->GetPartitionFileInfo();
+      probe_splitter_ = nullptr;
+      PairFiles(build_files_, probe_files, kGraceJoinPartitions);
+      return arrow::Status::OK();
+    }
+
+    void PairFiles(const std::vector<std::pair<int32_t, std::string>>& build_files,
+                   const std::vector<std::pair<int32_t, std::string>>& probe_files,
+                   int32_t num_partitions) {
+      std::map<int32_t, Partition> by_pid;
+      for (const auto& file : build_files) {
+        by_pid[file.first] = {file.second, "", num_partitions};
+      }
+      for (const auto& file : probe_files) {
+        auto& partition = by_pid[file.first];
+        partition.probe_file = file.second;
+        partition.num_partitions = num_partitions;
+      }
+      for (auto& entry : by_pid) {
+        partitions_.push_back(std::move(entry.second));
+      }
+    }
+
+    // Read the batches of the probe partition being joined into next_, moving to the
+    // next partitions as they run out. Leave next_ null once all are joined.
+    arrow::Status JoinNext() {
+      if (!probe_done_) {
+        RETURN_NOT_OK(FinishProbe());
+      }
+      while (true) {
+        if (probe_reader_ != nullptr) {
+          std::shared_ptr<arrow::RecordBatch> out;
+          while (true) {
+            if (probe_batch_ != nullptr) {
+              // matches of hot keys of the last probe batch
+              RETURN_NOT_OK(prober_iter_->ProcessRemaining(&out));
+              if (out == nullptr) {
+                probe_batch_ = nullptr;
+                continue;
+              }
+            } else if (probe_reader_->HasNext()) {
+              RETURN_NOT_OK(probe_reader_->Next(&probe_batch_));
+              RETURN_NOT_OK(prober_iter_->Process(probe_batch_->columns(), &out));
+            } else {
+              break;
+            }
+            if (out->num_rows() > 0) {
+              next_ = std::move(out);
+              return arrow::Status::OK();
+            }
+          }
+          probe_reader_ = nullptr;
+          prober_iter_ = nullptr;
+          build_batches_.clear();
+        }
+        if (partitions_.empty()) {
+          return arrow::Status::OK();
+        }
+        auto partition = std::move(partitions_.front());
+        partitions_.pop_front();
+        RETURN_NOT_OK(StartPartition(partition));
+      }
+    }
+
+    // Build the prober of a partition, or repartition it if its build side exceeds the
+    // memory budget
+    arrow::Status StartPartition(const Partition& partition) {
+      if (partition.probe_file.empty()) {
+        // no probe row to join
+        std::remove(partition.build_file.c_str());
+        return arrow::Status::OK();
+      }
+      std::vector<std::shared_ptr<arrow::RecordBatch>> build_batches;
+      if (!partition.build_file.empty()) {
+        ARROW_ASSIGN_OR_RAISE(auto build_reader, OpenSpillFile(partition.build_file));
+        while (build_reader->HasNext()) {
+          std::shared_ptr<arrow::RecordBatch> batch;
+          RETURN_NOT_OK(build_reader->Next(&batch));
+          build_batches.push_back(std::move(batch));
+        }
+      }
+      int64_t build_bytes = 0;
+      for (const auto& batch : build_batches) {
+        build_bytes += ArrayListBytes(batch->columns());
+      }
+      auto max_partitions = kGraceJoinPartitions;
+      for (int level = 1; level < kGraceJoinMaxLevels; ++level) {
+        max_partitions *= kGraceJoinPartitions;
+      }
+      if (build_bytes > memory_budget_ && partition.num_partitions < max_partitions) {
+        return Repartition(partition, build_batches);
+      }
+
+      std::shared_ptr<CodeGenBase> prober;
+      KernelMetrics partition_metrics;
+      RETURN_NOT_OK(MakeKernel(prober_kernel_, ctx_, &prober));
+      for (const auto& batch : build_batches) {
+        RETURN_NOT_OK(prober->Evaluate(batch->columns()));
+      }
+      RETURN_NOT_OK(prober->MakeResultIterator(result_schema_, &prober_iter_));
+      // the hash tables of the partitions are summed up
+      prober->UpdateMetrics(&partition_metrics);
+      metrics_->hash_table_size += partition_metrics.hash_table_size;
+      metrics_->probe_chain_length += partition_metrics.probe_chain_length;
+      ARROW_ASSIGN_OR_RAISE(probe_reader_, OpenSpillFile(partition.probe_file));
+      // the prober refers to the build batches
+      build_batches_ = std::move(build_batches);
+      std::remove(partition.build_file.c_str());
+      std::remove(partition.probe_file.c_str());
+      return arrow::Status::OK();
+    }
+
+    // Split both sides of partition into kGraceJoinPartitions partitions of the next
+    // level. As rows go to partition pmod(hash, n), a partition of pmod(hash,
+    // num_partitions) splits into the partitions of pmod(hash, num_partitions *
+    // kGraceJoinPartitions) congruent to it.
+    arrow::Status Repartition(
+        const Partition& partition,
+        const std::vector<std::shared_ptr<arrow::RecordBatch>>& build_batches) {
+      auto num_partitions = partition.num_partitions * kGraceJoinPartitions;
+      ARROW_ASSIGN_OR_RAISE(auto build_splitter,
+                            MakeSpillSplitter(left_schema_, left_key_indices_,
+                                              num_partitions, memory_budget_));
+      for (const auto& batch : build_batches) {
+        RETURN_NOT_OK(build_splitter->Split(*batch));
+      }
+      RETURN_NOT_OK(StopSpillSplitter(build_splitter.get(), &metrics_->spill_bytes));
+
+      ARROW_ASSIGN_OR_RAISE(auto probe_splitter,
+                            MakeSpillSplitter(right_schema_, right_key_indices_,
+                                              num_partitions, memory_budget_));
+      ARROW_ASSIGN_OR_RAISE(auto probe_reader, OpenSpillFile(partition.probe_file));
+      while (probe_reader->HasNext()) {
+        std::shared_ptr<arrow::RecordBatch> batch;
+        RETURN_NOT_OK(probe_reader->Next(&batch));
+        RETURN_NOT_OK(probe_splitter->Split(*batch));
+      }
+      RETURN_NOT_OK(StopSpillSplitter(probe_splitter.get(), &metrics_->spill_bytes));
+      std::remove(partition.build_file.c_str());
+      std::remove(partition.probe_file.c_str());
+
+      PairFiles(build_splitter->GetPartitionFileInfo(),
+                probe_splitter->GetPartitionFileInfo(), num_partitions);
+      return arrow::Status::OK();
+    }
+
+    arrow::compute::FunctionContext* ctx_;
+    std::shared_ptr<KernelMetrics> metrics_;
+    KernelFuture prober_kernel_;
+    std::shared_ptr<arrow::Schema> left_schema_;
+    std::shared_ptr<arrow::Schema> right_schema_;
+    std::vector<int32_t> left_key_indices_;
+    std::vector<int32_t> right_key_indices_;
+    std::shared_ptr<arrow::Schema> result_schema_;
+    std::vector<std::pair<int32_t, std::string>> build_files_;
+    std::shared_ptr<Splitter> probe_splitter_;
+    int64_t memory_budget_;
+
+    bool probe_done_ = false;
+    std::deque<Partition> partitions_;
+    // the partition being joined
+    std::vector<std::shared_ptr<arrow::RecordBatch>> build_batches_;
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> prober_iter_;
+    std::shared_ptr<ShuffleReader> probe_reader_;
+    // the probe batch whose hot key matches are still returned by prober_iter_
+    std::shared_ptr<arrow::RecordBatch> probe_batch_;
+
+    std::shared_ptr<arrow::RecordBatch> next_;
+    arrow::Status status_;
+    bool stopped_ = false;
+  };
 
   arrow::compute::FunctionContext* ctx_;
+  std::shared_ptr<KernelMetrics> metrics_;
+  KernelFuture prober_kernel_;
   std::shared_ptr<CodeGenBase> prober_;
 
+  std::shared_ptr<arrow::Schema> left_schema_;
+  std::shared_ptr<arrow::Schema> right_schema_;
+  std::vector<int32_t> left_key_indices_;
+  std::vector<int32_t> right_key_indices_;
+  // build batches given to prober_, kept while under the memory budget in case the
+  // join turns into a grace hash join
+  std::vector<ArrayList> build_arrays_;
+  int64_t build_bytes_ = 0;
+  bool can_spill_ = true;
+  bool spilled_ = false;
+  // spills the build side of a grace hash join
+  std::shared_ptr<Splitter> build_splitter_;
+
   
   arrow::Status GetResultIndexList(
       const std::shared_ptr<arrow::Schema>& result_schema,
@@ -155,7 +541,7 @@ class ConditionedProbeArraysKernel::Impl {
       const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
       const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
       const std::vector<std::pair<int, int>>& result_schema_index_list, int exist_index,
-      std::shared_ptr<CodeGenBase>* out) {
+      KernelFuture* out) {
     // generate ddl signature
     std::stringstream func_args_ss;
     func_args_ss << "<HashJoin>"
@@ -187,39 +573,48 @@ class ConditionedProbeArraysKernel::Impl {
     for (auto i : right_shuffle_index_list) {
       func_args_ss << i << ",";
     }
-
-    std::stringstream signature_ss;
-    signature_ss << std::hex << std::hash<std::string>{}(func_args_ss.str());
-    std::string signature = signature_ss.str();
-
-    auto file_lock = FileSpinLock();
-    auto status = LoadLibrary(signature, ctx_, out);
-    if (!status.ok()) {
-      // process
-      auto codes =
-          ProduceCodes(func_node, join_type, left_key_index_list, right_key_index_list,
-                       left_shuffle_index_list, right_shuffle_index_list, left_field_list,
-                       right_field_list, result_schema_index_list, exist_index);
-      // compile codes
-      RETURN_NOT_OK(CompileCodes(codes, signature));
-      RETURN_NOT_OK(LoadLibrary(signature, ctx_, out));
+    func_args_ss << "[Index]" << GetItemIndexType();
+    if (GetCompactCache()) {
+      func_args_ss << "[Cache]compact";
     }
-    FileSpinUnLock(file_lock);
+
+    auto signature = GetSignature(func_args_ss.str());
+    // compiled in background, the prober is made on first use
+    *out = LoadOrCompileLibraryAsync(signature, [&] {
+      return ProduceCodes(func_node, join_type, left_key_index_list, right_key_index_list,
+                          left_shuffle_index_list, right_shuffle_index_list,
+                          left_field_list, right_field_list, result_schema_index_list,
+                          exist_index);
+    });
     return arrow::Status::OK();
   }
 
   class TypedProberCodeGenImpl {
    public:
-    TypedProberCodeGenImpl(std::string indice, std::string dataTypeName, bool left = true)
-        : indice_(indice), dataTypeName_(dataTypeName), left_(left) {}
+    TypedProberCodeGenImpl(std::string indice, std::string dataTypeName, bool left = true,
+                           bool compact = false)
+        : indice_(indice), dataTypeName_(dataTypeName), left_(left), compact_(compact) {}
     std::string GetImplCachedDefine() {
       std::stringstream ss;
       ss << "using DataType_" << indice_ << " = typename arrow::" << dataTypeName_ << ";"
          << std::endl;
       ss << "using ArrayType_" << indice_ << " = typename arrow::TypeTraits<DataType_"
          << indice_ << ">::ArrayType;" << std::endl;
-      ss << "std::vector<std::shared_ptr<ArrayType_" << indice_ << ">> cached_" << indice_
-         << "_;" << std::endl;
+      ss << GetCachedTypeDefine();
+      ss << "std::vector<std::shared_ptr<CachedType_" << indice_ << ">> cached_"
+         << indice_ << "_;" << std::endl;
+      return ss.str();
+    }
+    // the cached arrays of a build column, compact ones for a payload column of
+    // GetCompactCache()
+    std::string GetCachedTypeDefine() {
+      std::stringstream ss;
+      ss << "using CachedType_" << indice_ << " = ";
+      if (compact_) {
+        ss << "CompactArray<ArrayType_" << indice_ << ">;" << std::endl;
+      } else {
+        ss << "ArrayType_" << indice_ << ";" << std::endl;
+      }
       return ss.str();
     }
     std::string GetResultIteratorPrepare() {
@@ -256,7 +651,8 @@ class ConditionedProbeArraysKernel::Impl {
             "arrow::TypeTraits<DataType_"
          << indice_ << ">::BuilderType;" << std::endl;
       if (left_) {
-        ss << "std::vector<std::shared_ptr<ArrayType_" << indice_ << ">> cached_"
+        ss << GetCachedTypeDefine();
+        ss << "std::vector<std::shared_ptr<CachedType_" << indice_ << ">> cached_"
            << indice_ << "_;" << std::endl;
       } else {
         ss << "std::shared_ptr<ArrayType_" << indice_ << "> cached_" << indice_ << "_;"
@@ -274,6 +670,7 @@ class ConditionedProbeArraysKernel::Impl {
     std::string indice_;
     std::string dataTypeName_;
     bool left_;
+    bool compact_;
   };
   std::string GetJoinKeyTypeListDefine(
       std::vector<int> key_index_list,
@@ -292,8 +689,8 @@ class ConditionedProbeArraysKernel::Impl {
   std::string GetEvaluateCacheInsert(const std::vector<int>& index_list) {
     std::stringstream ss;
     for (auto i : index_list) {
-      ss << "cached_0_" << i << "_.push_back(std::dynamic_pointer_cast<ArrayType_0_" << i
-         << ">(in[" << i << "]));" << std::endl;
+      ss << "RETURN_NOT_OK(CacheArray(in[" << i << "], ctx_->memory_pool(), &cached_0_"
+         << i << "_));" << std::endl;
     }
     return ss.str();
   }
@@ -336,10 +733,10 @@ class ConditionedProbeArraysKernel::Impl {
     std::stringstream ss;
     for (int i = 0; i < key_indices.size(); i++) {
       if (i != (key_indices.size() - 1)) {
-        ss << "const std::vector<std::shared_ptr<ArrayType_0_" << key_indices[i]
+        ss << "const std::vector<std::shared_ptr<CachedType_0_" << key_indices[i]
            << ">> &cached_0_" << key_indices[i] << ", " << std::endl;
       } else {
-        ss << "const std::vector<std::shared_ptr<ArrayType_0_" << key_indices[i]
+        ss << "const std::vector<std::shared_ptr<CachedType_0_" << key_indices[i]
            << ">> &cached_0_" << key_indices[i];
       }
     }
@@ -423,179 +820,145 @@ class ConditionedProbeArraysKernel::Impl {
     }
     return ss.str();
   }
-  std::string GetInnerJoin(bool cond_check,
-                           const std::vector<int>& left_shuffle_index_list,
-                           const std::vector<int>& right_shuffle_index_list) {
-    std::stringstream ss;
-    for (auto i : left_shuffle_index_list) {
-      ss << "RETURN_NOT_OK(builder_0_" << i << "_->Append(cached_0_" << i
-         << "_[tmp.array_id]->GetView(tmp."
-            "id)));"
-         << std::endl;
-    }
-    for (auto i : right_shuffle_index_list) {
-      ss << "RETURN_NOT_OK(builder_1_" << i << "_->Append(cached_1_" << i
-         << "_->GetView(i)));" << std::endl;
-    }
+  // The probe loops below only record the matches of the probe rows in the selection
+  // vectors probe_ids_, build_ids_ and, for the joins which emit unmatched rows,
+  // build_valid_. The output columns are gathered from them afterwards, see
+  // GetProcessGather.
+  std::string GetAppendMatch(bool with_valid) {
+    return std::string("probe_ids_.push_back(i); build_ids_.push_back(tmp);") +
+           (with_valid ? " build_valid_.push_back(1);" : "");
+  }
+  std::string GetAppendUnmatched(bool with_valid) {
+    return std::string("probe_ids_.push_back(i);") +
+           (with_valid ? " build_ids_.emplace_back(); build_valid_.push_back(0);" : "");
+  }
+  std::string GetInnerJoin(bool cond_check) {
     std::string shuffle_str;
     if (cond_check) {
       shuffle_str = R"(
               if (ConditionCheck(tmp, i)) {
-                )" + ss.str() +
+                )" + GetAppendMatch(false) +
                     R"(
-                out_length += 1;
               }
       )";
     } else {
       shuffle_str = R"(
-              )" + ss.str() +
+              )" + GetAppendMatch(false) +
                     R"(
-              out_length += 1;
       )";
     }
     return R"(
         if (!typed_array->IsNull(i)) {
-          auto index = hash_table_->Get(typed_array->GetView(i));
+          auto index = key_ids_[i];
           if (index != -1) {
-            for (auto tmp : (*memo_index_to_arrayid_)[index]) {
-              )" +
+            if (hash_table_->NumItems(index) > hot_key_rows_) {
+              // streamed by ProcessRemaining
+              hot_rows_.push_back(i);
+            } else {
+              for (auto tmp : hash_table_->Items(index)) {
+                )" +
            shuffle_str + R"(
+              }
             }
           }
         }
   )";
   }
-  std::string GetOuterJoin(bool cond_check,
-                           const std::vector<int>& left_shuffle_index_list,
-                           const std::vector<int>& right_shuffle_index_list) {
-    std::stringstream left_null_ss;
-    std::stringstream left_valid_ss;
-    std::stringstream right_valid_ss;
-    for (auto i : left_shuffle_index_list) {
-      left_valid_ss << "RETURN_NOT_OK(builder_0_" << i << "_->Append(cached_0_" << i
-                    << "_[tmp.array_id]->GetView(tmp."
-                       "id)));"
-                    << std::endl;
-      left_null_ss << "RETURN_NOT_OK(builder_0_" << i << "_->AppendNull());" << std::endl;
-    }
-    for (auto i : right_shuffle_index_list) {
-      right_valid_ss << "RETURN_NOT_OK(builder_1_" << i << "_->Append(cached_1_" << i
-                     << "_->GetView(i)));" << std::endl;
-    }
+  std::string GetOuterJoin(bool cond_check) {
     std::string shuffle_str;
     if (cond_check) {
       shuffle_str = R"(
               if (ConditionCheck(tmp, i)) {
-                )" + left_valid_ss.str() +
-                    right_valid_ss.str() + R"(
-                out_length += 1;
+                )" + GetAppendMatch(true) +
+                    R"(
               }
       )";
     } else {
       shuffle_str = R"(
-              )" + left_valid_ss.str() +
-                    right_valid_ss.str() + R"(
-              out_length += 1;
+              )" + GetAppendMatch(true) +
+                    R"(
       )";
     }
     return R"(
-        int32_t index;
-        if (!typed_array->IsNull(i)) {
-          index = hash_table_->Get(typed_array->GetView(i));
-        } else {
-          index = hash_table_->GetNull();
-        }
+        auto index = key_ids_[i];
         if (index == -1) {
           )" +
-           left_null_ss.str() + right_valid_ss.str() + R"(
-          out_length += 1;
+           GetAppendUnmatched(true) + R"(
+        } else if (hash_table_->NumItems(index) > hot_key_rows_) {
+          // streamed by ProcessRemaining
+          hot_rows_.push_back(i);
         } else {
-          for (auto tmp : (*memo_index_to_arrayid_)[index]) {
+          for (auto tmp : hash_table_->Items(index)) {
             )" +
            shuffle_str + R"(
           }
         }
   )";
   }
-  std::string GetAntiJoin(bool cond_check,
-                          const std::vector<int>& left_shuffle_index_list,
-                          const std::vector<int>& right_shuffle_index_list) {
-    std::stringstream left_null_ss;
-    std::stringstream right_valid_ss;
-    for (auto i : left_shuffle_index_list) {
-      left_null_ss << "RETURN_NOT_OK(builder_0_" << i << "_->AppendNull());" << std::endl;
-    }
-    for (auto i : right_shuffle_index_list) {
-      right_valid_ss << "RETURN_NOT_OK(builder_1_" << i << "_->Append(cached_1_" << i
-                     << "_->GetView(i)));" << std::endl;
-    }
+  std::string GetAntiJoin(bool cond_check) {
     std::string shuffle_str;
     if (cond_check) {
       shuffle_str = R"(
         } else {
           bool found = false;
-          for (auto tmp : (*memo_index_to_arrayid_)[index]) {
+          for (auto tmp : hash_table_->Items(index)) {
             if (ConditionCheck(tmp, i)) {
               found = true;
               break;
             }
           }
           if (!found) {
-              )" + left_null_ss.str() +
-                    right_valid_ss.str() + R"(
-            out_length += 1;
+            )" + GetAppendUnmatched(false) +
+                    R"(
           }
       )";
     }
+    // a null key equals no build key, even the null ones
     return R"(
-        int32_t index;
-        if (!typed_array->IsNull(i)) {
-          index = hash_table_->Get(typed_array->GetView(i));
-        } else {
-          index = hash_table_->GetNull();
-        }
-        if (index == -1) {
+        auto index = key_ids_[i];
+        if (index == -1 || typed_array->IsNull(i)) {
           )" +
-           left_null_ss.str() + right_valid_ss.str() + R"(
-          out_length += 1;
+           GetAppendUnmatched(false) + R"(
           )" +
            shuffle_str + R"(
         }
   )";
   }
-  std::string GetSemiJoin(bool cond_check,
-                          const std::vector<int>& left_shuffle_index_list,
-                          const std::vector<int>& right_shuffle_index_list) {
-    std::stringstream ss;
-    for (auto i : left_shuffle_index_list) {
-      ss << "RETURN_NOT_OK(builder_0_" << i << "_->AppendNull());" << std::endl;
-    }
-    for (auto i : right_shuffle_index_list) {
-      ss << "RETURN_NOT_OK(builder_1_" << i << "_->Append(cached_1_" << i
-         << "_->GetView(i)));" << std::endl;
-    }
+  // NOT IN: a probe row is kept only if its key is not null and differs from every
+  // build key, none of them null, unless the build side is empty, which keeps all the
+  // probe rows. As whether the build side has a null key decides every probe row, the
+  // hash table must hold the whole build side.
+  std::string GetNullAwareAntiJoin() {
+    return R"(
+        if (hash_table_->num_keys() == 0 ||
+            (hash_table_->GetNull() == -1 && key_ids_[i] == -1 &&
+             !typed_array->IsNull(i))) {
+          )" +
+           GetAppendUnmatched(false) + R"(
+        }
+  )";
+  }
+  std::string GetSemiJoin(bool cond_check) {
     std::string shuffle_str;
     if (cond_check) {
       shuffle_str = R"(
-            for (auto tmp : (*memo_index_to_arrayid_)[index]) {
+            for (auto tmp : hash_table_->Items(index)) {
               if (ConditionCheck(tmp, i)) {
-                )" + ss.str() +
+                )" + GetAppendUnmatched(false) +
                     R"(
-                out_length += 1;
                 break;
               }
             }
       )";
     } else {
       shuffle_str = R"(
-              )" + ss.str() +
+              )" + GetAppendUnmatched(false) +
                     R"(
-              out_length += 1;
       )";
     }
     return R"(
         if (!typed_array->IsNull(i)) {
-          auto index = hash_table_->Get(typed_array->GetView(i));
+          auto index = key_ids_[i];
           if (index != -1) {
                 )" +
            shuffle_str + R"(
@@ -603,87 +966,162 @@ class ConditionedProbeArraysKernel::Impl {
         }
   )";
   }
-  std::string GetExistenceJoin(bool cond_check,
-                           const std::vector<int>& left_shuffle_index_list,
-                           const std::vector<int>& right_shuffle_index_list) {
-    std::stringstream right_exist_ss;
-    std::stringstream right_not_exist_ss;
-    std::stringstream left_valid_ss;
-    std::stringstream right_valid_ss;
-    auto right_size = right_shuffle_index_list.size();
-
-    right_exist_ss << "const bool exist = true; RETURN_NOT_OK(builder_1_exists_->Append(exist));"
-                    << std::endl;
-    right_not_exist_ss << "const bool not_exist = false; RETURN_NOT_OK(builder_1_exists_->Append(not_exist));"
-                    << std::endl;
-
-    for (auto i : right_shuffle_index_list) {
-      right_valid_ss << "RETURN_NOT_OK(builder_1_" << i << "_->Append(cached_1_" << i
-                     << "_->GetView(i)));" << std::endl;
-    }
+  std::string GetExistenceJoin(bool cond_check) {
+    // one row per probe row, build_valid_ holds the exists column
     std::string shuffle_str;
     if (cond_check) {
       shuffle_str = R"(
-              if (ConditionCheck(tmp, i)) {
-                )" + right_valid_ss.str() +
-                    right_exist_ss.str() + R"(
-                out_length += 1;
-              }
+          bool found = false;
+          for (auto tmp : hash_table_->Items(index)) {
+            if (ConditionCheck(tmp, i)) {
+              found = true;
+              break;
+            }
+          }
+          probe_ids_.push_back(i);
+          build_valid_.push_back(found);
       )";
     } else {
       shuffle_str = R"(
-              )" + right_valid_ss.str() +
-                    right_exist_ss.str() + R"(
-              out_length += 1;
+          probe_ids_.push_back(i);
+          build_valid_.push_back(1);
       )";
     }
     return R"(
-        int32_t index;
-        if (!typed_array->IsNull(i)) {
-          index = hash_table_->Get(typed_array->GetView(i));
-        } else {
-          index = hash_table_->GetNull();
-        }
-        if (index == -1) {
-          )" +
-           right_valid_ss.str() + right_not_exist_ss.str() + R"(
-          out_length += 1;
+        auto index = key_ids_[i];
+        if (index == -1 || typed_array->IsNull(i)) {
+          probe_ids_.push_back(i);
+          build_valid_.push_back(0);
         } else {
             )" +
            shuffle_str + R"(
         }
   )";
   }
-  std::string GetProcessProbe(int join_type, bool cond_check,
-                              const std::vector<int>& left_shuffle_index_list,
-                              const std::vector<int>& right_shuffle_index_list) {
+  std::string GetProcessProbe(int join_type, bool cond_check) {
     switch (join_type) {
       case 0: { /*Inner Join*/
-        return GetInnerJoin(cond_check, left_shuffle_index_list,
-                            right_shuffle_index_list);
+        return GetInnerJoin(cond_check);
       } break;
       case 1: { /*Outer Join*/
-        return GetOuterJoin(cond_check, left_shuffle_index_list,
-                            right_shuffle_index_list);
+        return GetOuterJoin(cond_check);
       } break;
       case 2: { /*Anti Join*/
-        return GetAntiJoin(cond_check, left_shuffle_index_list, right_shuffle_index_list);
+        return GetAntiJoin(cond_check);
       } break;
       case 3: { /*Semi Join*/
-        return GetSemiJoin(cond_check, left_shuffle_index_list, right_shuffle_index_list);
+        return GetSemiJoin(cond_check);
       } break;
       case 4: { /*Existence Join*/
-        return GetExistenceJoin(cond_check, left_shuffle_index_list,
-                            right_shuffle_index_list);
+        return GetExistenceJoin(cond_check);
+      } break;
+      case 5: { /*Null Aware Anti Join*/
+        return GetNullAwareAntiJoin();
       } break;
       default:
-        std::cout << "ConditionedProbeArraysTypedImpl only support join type: InnerJoin, "
-                     "RightJoin"
+        std::cout << "ConditionedProbeArraysTypedImpl only support join type: Inner, "
+                     "Outer, Anti, Semi, Existence, NullAwareAnti"
                   << std::endl;
         throw;
     }
     return "";
   }
+  // Inner and outer joins emit a row per build row of a key, the probe rows of the hot
+  // keys, with more build rows than fit a batch, are left to ProcessRemaining which
+  // returns their matches in chunks of a batch. A skewed key then never expands into
+  // one giant batch.
+  std::string GetProcessRemaining(int join_type, bool cond_check,
+                                  const std::string& process_filter_str,
+                                  const std::string& process_gather_str,
+                                  const std::string& process_finish_str,
+                                  const std::string& process_out_list_str) {
+    if (join_type != 0 && join_type != 1) {
+      return "";
+    }
+    auto append_match = GetAppendMatch(join_type == 1);
+    if (cond_check) {
+      append_match = "if (ConditionCheck(tmp, i)) {\n" + append_match + "\n}";
+    }
+    return R"(
+    arrow::Status ProcessRemaining(std::shared_ptr<arrow::RecordBatch> *out) override {
+      if (hot_pos_ == hot_rows_.size()) {
+        *out = nullptr;
+        return arrow::Status::OK();
+      }
+      probe_ids_.clear();
+      build_ids_.clear();
+      build_valid_.clear();
+      HashMap::ItemRange::Iterator end;
+      while (hot_pos_ < hot_rows_.size()) {
+        int i = hot_rows_[hot_pos_];
+        if (!hot_started_) {
+          hot_item_ = hash_table_->Items(key_ids_[i]).begin();
+          hot_started_ = true;
+        }
+        for (; hot_item_ != end &&
+               static_cast<int64_t>(probe_ids_.size()) < hot_key_rows_;
+             ++hot_item_) {
+          auto tmp = *hot_item_;
+          )" +
+           append_match + R"(
+        }
+        if (hot_item_ != end) {
+          // the chunk is full
+          break;
+        }
+        hot_started_ = false;
+        hot_pos_++;
+      }
+      )" + process_filter_str + R"(
+      int64_t out_length = probe_ids_.size();
+      )" + process_gather_str +
+           process_finish_str + R"(
+      *out = arrow::RecordBatch::Make(
+          result_schema_, out_length,
+          {)" +
+           process_out_list_str + R"(});
+      return arrow::Status::OK();
+    }
+)";
+  }
+  std::string GetProcessGather(int join_type,
+                               const std::vector<int>& left_shuffle_index_list,
+                               const std::vector<int>& right_shuffle_index_list) {
+    std::stringstream ss;
+    for (auto i : left_shuffle_index_list) {
+      switch (join_type) {
+        case 0:
+          ss << "RETURN_NOT_OK(GatherItems(cached_0_" << i
+             << "_, build_ids_.data(), nullptr, out_length, builder_0_" << i
+             << "_.get()));" << std::endl;
+          break;
+        case 1:
+          ss << "RETURN_NOT_OK(GatherItems(cached_0_" << i
+             << "_, build_ids_.data(), build_valid_.data(), out_length, builder_0_" << i
+             << "_.get()));" << std::endl;
+          break;
+        case 2:
+        case 3:
+        case 5:
+          ss << "RETURN_NOT_OK(builder_0_" << i << "_->AppendNulls(out_length));"
+             << std::endl;
+          break;
+        default:
+          break;
+      }
+    }
+    for (auto i : right_shuffle_index_list) {
+      ss << "RETURN_NOT_OK(GatherRows(*cached_1_" << i
+         << "_, probe_ids_.data(), out_length, builder_1_" << i << "_.get()));"
+         << std::endl;
+    }
+    if (join_type == 4) {
+      ss << "RETURN_NOT_OK(builder_1_exists_->AppendValues(build_valid_.data(), "
+            "out_length));"
+         << std::endl;
+    }
+    return ss.str();
+  }
   std::string GetConditionCheckFunc(
       const std::shared_ptr<gandiva::Node>& func_node,
       const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
@@ -697,7 +1135,7 @@ class ConditionedProbeArraysKernel::Impl {
                            &func_node_visitor);
 
     return R"(
-    inline bool ConditionCheck(ArrayItemIndex x, int y) {
+    inline bool ConditionCheck(ItemIndex x, int y) {
       )" + codes_ss.str() +
            R"(
         return )" +
@@ -706,14 +1144,58 @@ class ConditionedProbeArraysKernel::Impl {
     }
   )";
   }
+  // The condition of all the candidate matches of a batch at once, see
+  // CodeGenNodeVisitor, the matches failing it are then dropped from the selection
+  // vectors without branches. Empty if the condition doesn't vectorize.
+  std::string GetConditionFilterFunc(
+      const std::shared_ptr<gandiva::Node>& func_node,
+      const std::vector<std::shared_ptr<arrow::Field>>& left_field_list,
+      const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
+      std::vector<int>* left_out_index_list, std::vector<int>* right_out_index_list) {
+    std::shared_ptr<CodeGenNodeVisitor> func_node_visitor;
+    int func_count = 0;
+    std::stringstream codes_ss;
+    MakeCodeGenNodeVisitor(func_node, {left_field_list, right_field_list}, &func_count,
+                           &codes_ss, left_out_index_list, right_out_index_list,
+                           &func_node_visitor, true);
+    if (!func_node_visitor->IsVectorizable()) {
+      return "";
+    }
+
+    return R"(
+    inline void ConditionFilter() {
+      int cond_length = probe_ids_.size();
+      std::vector<uint8_t> cond_valid(cond_length, 1);
+      )" + codes_ss.str() +
+           R"(
+      std::vector<uint8_t> cond_keep(cond_length);
+      for (int k = 0; k < cond_length; k++) {
+        cond_keep[k] = cond_valid[k] & ()" +
+           func_node_visitor->GetResult() +
+           R"();
+      }
+      int kept = 0;
+      for (int k = 0; k < cond_length; k++) {
+        probe_ids_[kept] = probe_ids_[k];
+        build_ids_[kept] = build_ids_[k];
+        kept += cond_keep[k];
+      }
+      probe_ids_.resize(kept);
+      build_ids_.resize(kept);
+    }
+  )";
+  }
   arrow::Status GetTypedProberCodeGen(
       std::string prefix, bool left, const std::vector<int>& index_list,
       const std::vector<std::shared_ptr<arrow::Field>>& field_list, int exist_index, 
-      std::vector<std::shared_ptr<TypedProberCodeGenImpl>>* out_list, int join_type = -1) {
+      std::vector<std::shared_ptr<TypedProberCodeGenImpl>>* out_list, int join_type = -1,
+      const std::vector<int>& compact_index_list = {}) {
     for (auto i : index_list) {
       auto field = field_list[i];
+      bool compact = std::find(compact_index_list.begin(), compact_index_list.end(), i) !=
+                     compact_index_list.end();
       auto codegen = std::make_shared<TypedProberCodeGenImpl>(
-          prefix + std::to_string(i), GetTypeString(field->type()), left);
+          prefix + std::to_string(i), GetTypeString(field->type()), left, compact);
       (*out_list).push_back(codegen);
     }
     if (join_type == 4 && exist_index != -1) {
@@ -735,10 +1217,183 @@ class ConditionedProbeArraysKernel::Impl {
     std::sort(ret.begin(), ret.end());
     return ret;
   }
-  std::string GetKeyCType(const std::vector<int>& key_index_list,
-                          const std::vector<std::shared_ptr<arrow::Field>>& field_list) {
-    auto field = field_list[key_index_list[0]];
-    return GetCTypeString(field->type());
+  std::string GetRuntimeFilterFunc(
+      bool multiple_cols, const std::vector<int>& key_index_list,
+      const std::vector<std::shared_ptr<arrow::Field>>& field_list) {
+    // the probe side can only reproduce single integer keys, not the gandiva hash of
+    // multiple keys, and uint64 keys don't fit the int64 range of the filter
+    if (multiple_cols) {
+      return "";
+    }
+    switch (field_list[key_index_list[0]]->type()->id()) {
+      case arrow::Type::INT8:
+      case arrow::Type::INT16:
+      case arrow::Type::INT32:
+      case arrow::Type::INT64:
+      case arrow::Type::UINT8:
+      case arrow::Type::UINT16:
+      case arrow::Type::UINT32:
+      case arrow::Type::DATE32:
+      case arrow::Type::DATE64:
+        break;
+      default:
+        return "";
+    }
+    return R"(
+    arrow::Status GetRuntimeFilter(std::shared_ptr<RuntimeFilter> *out) override {
+      std::lock_guard<std::mutex> lock(runtime_filter_mtx_);
+      if (!runtime_filter_) {
+        runtime_filter_ = std::make_shared<RuntimeFilter>(hash_table_->num_keys());
+        hash_table_->ForEachKey(
+            [this](int64_t key) { runtime_filter_->Insert(key); });
+      }
+      *out = runtime_filter_;
+      return arrow::Status::OK();
+    }
+  private:
+    std::mutex runtime_filter_mtx_;
+    std::shared_ptr<RuntimeFilter> runtime_filter_;
+  public:
+)";
+  }
+  // The build side of an inner or outer join without a condition for a kernel probing
+  // it with other joins, see JoinProbe. The condition of a join reads probe side
+  // columns by their index in its own probe schema, so the joins with one have none.
+  std::string GetJoinProbeFunc(
+      int join_type, bool has_condition, bool multiple_cols,
+      const std::string& key_array_type_str,
+      const std::vector<int>& left_shuffle_index_list,
+      const std::vector<std::shared_ptr<TypedProberCodeGenImpl>>& left_shuffle_codegen_list,
+      const std::vector<std::pair<int, int>>& result_schema_index_list) {
+    if ((join_type != 0 && join_type != 1) || has_condition) {
+      return "";
+    }
+    std::stringstream fields_ss;
+    std::stringstream out_ss;
+    for (size_t pos = 0; pos < result_schema_index_list.size(); pos++) {
+      const auto& index = result_schema_index_list[pos];
+      if (index.first != 0) {
+        continue;
+      }
+      fields_ss << "fields.push_back(iter_->result_schema_->field(" << pos << "));"
+                << std::endl;
+      out_ss << "out->push_back("
+             << left_shuffle_codegen_list[index.second]->GetProcessOutList() << ");"
+             << std::endl;
+    }
+    std::stringstream gather_ss;
+    for (auto i : left_shuffle_index_list) {
+      gather_ss << "RETURN_NOT_OK(GatherItems(cached_0_" << i
+                << "_, join_probe_items_.data(), valid, out_length, builder_0_" << i
+                << "_.get()));" << std::endl;
+    }
+    for (auto codegen : left_shuffle_codegen_list) {
+      gather_ss << codegen->GetProcessFinish();
+    }
+    std::string typed_array_str;
+    if (multiple_cols) {
+      typed_array_str = R"(
+      std::shared_ptr<arrow::Array> normalized_keys;
+      RETURN_NOT_OK(hash_kernel_->Evaluate(keys, &normalized_keys));
+      auto typed_array = std::dynamic_pointer_cast<arrow::)" +
+                        key_array_type_str + R"(>(normalized_keys);)";
+    } else {
+      typed_array_str = R"(
+      auto typed_array = std::dynamic_pointer_cast<arrow::)" +
+                        key_array_type_str + R"(>(keys[0]);)";
+    }
+    return R"(
+    arrow::Status GetJoinProbe(
+        std::shared_ptr<sparkcolumnarplugin::codegen::JoinProbe> *out) override {
+      *out = std::make_shared<Probe>(this);
+      return arrow::Status::OK();
+    }
+  private:
+    class Probe : public sparkcolumnarplugin::codegen::JoinProbe {
+     public:
+      explicit Probe(ProberResultIterator *iter) : iter_(iter) {}
+
+      arrow::Status Lookup(const ArrayList &keys, const std::vector<int32_t> &rows,
+                           std::vector<int32_t> *positions,
+                           std::vector<uint64_t> *build_ids) override {
+        return iter_->JoinProbeLookup(keys, rows, positions, build_ids);
+      }
+
+      std::vector<std::shared_ptr<arrow::Field>> build_fields() override {
+        std::vector<std::shared_ptr<arrow::Field>> fields;
+        )" + fields_ss.str() +
+           R"(
+        return fields;
+      }
+
+      arrow::Status Gather(const std::vector<uint64_t> &build_ids, const uint8_t *valid,
+                           ArrayList *out) override {
+        return iter_->JoinProbeGather(build_ids, valid, out);
+      }
+
+     private:
+      ProberResultIterator *iter_;
+    };
+
+    arrow::Status JoinProbeLookup(const ArrayList &encoded_keys,
+                                  const std::vector<int32_t> &rows,
+                                  std::vector<int32_t> *positions,
+                                  std::vector<uint64_t> *build_ids) {
+      // released by SetLimit, nothing matches
+      if (hash_table_ == nullptr) {
+        return arrow::Status::OK();
+      }
+      ArrayList keys;
+      RETURN_NOT_OK(DecodeDictionaries(ctx_, encoded_keys, &keys));)" +
+           typed_array_str + R"(
+      auto length = typed_array->length();
+      auto size = static_cast<int32_t>(rows.size());
+      auto append = [&](int32_t k, int32_t index) {
+        for (auto tmp : hash_table_->Items(index)) {
+          positions->push_back(k);
+          build_ids->push_back((static_cast<uint64_t>(tmp.array_id) << 32) | tmp.id);
+        }
+      };
+      // the whole batch at once, so that the cache misses overlap, unless the rows
+      // left by the joins probed before are few
+      if (size * 4 >= length) {
+        key_ids_.resize(length);
+        hash_table_->GetBatch(*typed_array, 0, length, key_ids_.data());
+        for (int32_t k = 0; k < size; k++) {
+          auto i = rows[k];
+          if (!typed_array->IsNull(i) && key_ids_[i] != -1) {
+            append(k, key_ids_[i]);
+          }
+        }
+      } else {
+        for (int32_t k = 0; k < size; k++) {
+          auto i = rows[k];
+          if (!typed_array->IsNull(i)) {
+            auto index = hash_table_->Get(typed_array->GetView(i));
+            if (index != -1) {
+              append(k, index);
+            }
+          }
+        }
+      }
+      return arrow::Status::OK();
+    }
+
+    arrow::Status JoinProbeGather(const std::vector<uint64_t> &build_ids,
+                                  const uint8_t *valid, ArrayList *out) {
+      int64_t out_length = build_ids.size();
+      join_probe_items_.resize(out_length);
+      for (int64_t k = 0; k < out_length; k++) {
+        join_probe_items_[k] = ItemIndex(build_ids[k] >> 32, build_ids[k] & 0xffffffff);
+      }
+      )" + gather_ss.str() +
+           out_ss.str() + R"(
+      return arrow::Status::OK();
+    }
+
+    std::vector<ItemIndex> join_probe_items_;
+  public:
+)";
   }
   std::string GetTypedArray(bool multiple_cols, std::string index, int i,
                             std::string data_type,
@@ -747,11 +1402,12 @@ class ConditionedProbeArraysKernel::Impl {
     if (multiple_cols) {
       ss << "auto concat_kernel_arr_list = {" << evaluate_encode_join_key_str << "};"
          << std::endl;
-      ss << "std::shared_ptr<arrow::Array> hash_in;" << std::endl;
-      ss << "RETURN_NOT_OK(hash_kernel_->Evaluate(concat_kernel_arr_list, &hash_in));"
-         << std::endl;
-      ss << "auto typed_array = std::dynamic_pointer_cast<arrow::Int32Array>(hash_in);"
+      ss << "std::shared_ptr<arrow::Array> normalized_keys;" << std::endl;
+      ss << "RETURN_NOT_OK(hash_kernel_->Evaluate(concat_kernel_arr_list, "
+            "&normalized_keys));"
          << std::endl;
+      ss << "auto typed_array = std::dynamic_pointer_cast<arrow::" << data_type
+         << ">(normalized_keys);" << std::endl;
     } else {
       ss << "auto typed_array = std::dynamic_pointer_cast<arrow::" << data_type << ">(in["
          << i << "]);" << std::endl;
@@ -771,30 +1427,63 @@ class ConditionedProbeArraysKernel::Impl {
     std::vector<int> right_cond_index_list;
     bool cond_check = false;
     bool multiple_cols = (left_key_index_list.size() > 1);
-    std::string key_ctype_str =
-        "int64_t";  // multiple col will use gandiva hash to get int64_t
-    if (!multiple_cols) {
-      key_ctype_str = GetKeyCType(left_key_index_list, left_field_list);
+    // multiple key columns are looked up by their normalized key, see
+    // NormalizeKeysKernel
+    auto key_type = left_field_list[left_key_index_list[0]]->type();
+    if (multiple_cols) {
+      std::vector<std::shared_ptr<arrow::DataType>> key_type_list;
+      for (auto i : left_key_index_list) {
+        key_type_list.push_back(left_field_list[i]->type());
+      }
+      key_type = NormalizeKeysKernel::NormalizedType(key_type_list);
     }
+    auto key_ctype_str = GetCTypeString(key_type);
+    auto key_array_type_str = GetTypeString(key_type, "Array");
     std::string condition_check_str;
+    std::string process_filter_str;
     if (func_node) {
       condition_check_str =
           GetConditionCheckFunc(func_node, left_field_list, right_field_list,
                                 &left_cond_index_list, &right_cond_index_list);
       cond_check = true;
+      // an inner join keeps the matches passing the condition whatever the others, so
+      // all the candidates of a batch are filtered at once after the probe
+      if (join_type == 0) {
+        auto condition_filter_str =
+            GetConditionFilterFunc(func_node, left_field_list, right_field_list,
+                                   &left_cond_index_list, &right_cond_index_list);
+        if (!condition_filter_str.empty()) {
+          condition_check_str += condition_filter_str;
+          process_filter_str = "ConditionFilter();";
+          cond_check = false;
+        }
+      }
     }
-    auto process_probe_str = GetProcessProbe(
-        join_type, cond_check, left_shuffle_index_list, right_shuffle_index_list);
+    auto process_probe_str = GetProcessProbe(join_type, cond_check);
+    auto process_gather_str =
+        GetProcessGather(join_type, left_shuffle_index_list, right_shuffle_index_list);
     auto left_cache_index_list =
         MergeKeyIndexList(left_cond_index_list, left_shuffle_index_list);
     auto right_cache_index_list =
         MergeKeyIndexList(right_cond_index_list, right_shuffle_index_list);
 
+    // the build columns only gathered, the condition reads its columns by their types
+    std::vector<int> left_compact_index_list;
+    if (GetCompactCache()) {
+      for (auto i : left_shuffle_index_list) {
+        if (std::find(left_cond_index_list.begin(), left_cond_index_list.end(), i) ==
+                left_cond_index_list.end() &&
+            IsCompactType(left_field_list[i]->type())) {
+          left_compact_index_list.push_back(i);
+        }
+      }
+    }
+
     std::vector<std::shared_ptr<TypedProberCodeGenImpl>> left_cache_codegen_list;
     std::vector<std::shared_ptr<TypedProberCodeGenImpl>> left_shuffle_codegen_list;
     std::vector<std::shared_ptr<TypedProberCodeGenImpl>> right_shuffle_codegen_list;
     GetTypedProberCodeGen("0_", true, left_cache_index_list, left_field_list, exist_index,
-                          &left_cache_codegen_list);
+                          &left_cache_codegen_list, -1, left_compact_index_list);
     GetTypedProberCodeGen("0_", true, left_shuffle_index_list, left_field_list, exist_index,
                           &left_shuffle_codegen_list);
     GetTypedProberCodeGen("1_", false, right_shuffle_index_list, right_field_list, exist_index,
@@ -817,68 +1506,81 @@ class ConditionedProbeArraysKernel::Impl {
         result_schema_index_list, left_shuffle_codegen_list, right_shuffle_codegen_list);
     auto result_iter_cached_define_str =
         GetResultIterCachedDefine(left_cache_codegen_list, right_shuffle_codegen_list);
-    auto evaluate_get_typed_array_str = GetTypedArray(
-        multiple_cols, "0_" + std::to_string(left_key_index_list[0]),
-        left_key_index_list[0],
-        GetTypeString(left_field_list[left_key_index_list[0]]->type(), "Array"),
-        evaluate_encode_join_key_str);
-    auto process_get_typed_array_str = GetTypedArray(
-        multiple_cols, "1_" + std::to_string(right_key_index_list[0]),
-        right_key_index_list[0],
-        GetTypeString(left_field_list[left_key_index_list[0]]->type(), "Array"),
-        process_encode_join_key_str);
-    return BaseCodes() + R"(
+    auto process_remaining_str =
+        GetProcessRemaining(join_type, cond_check, process_filter_str, process_gather_str,
+                            process_finish_str,
+                            process_out_list_str);
+    auto runtime_filter_func_str =
+        GetRuntimeFilterFunc(multiple_cols, left_key_index_list, left_field_list);
+    auto join_probe_func_str = GetJoinProbeFunc(
+        join_type, func_node != nullptr, multiple_cols, key_array_type_str,
+        left_shuffle_index_list, left_shuffle_codegen_list, result_schema_index_list);
+    auto evaluate_get_typed_array_str =
+        GetTypedArray(multiple_cols, "0_" + std::to_string(left_key_index_list[0]),
+                      left_key_index_list[0], key_array_type_str,
+                      evaluate_encode_join_key_str);
+    auto process_get_typed_array_str =
+        GetTypedArray(multiple_cols, "1_" + std::to_string(right_key_index_list[0]),
+                      right_key_index_list[0], key_array_type_str,
+                      process_encode_join_key_str);
+    std::string process_lookup_str =
+        "hash_table_->GetBatch(*typed_array, 0, length, key_ids_.data());";
+    if (!multiple_cols) {
+      auto key_in = "encoded_in[" + std::to_string(right_key_index_list[0]) + "]";
+      process_lookup_str = "if (" + key_in + R"(->type_id() == arrow::Type::DICTIONARY) {
+        hash_table_->GetDictionaryBatch<KeyArray>(
+            static_cast<const arrow::DictionaryArray&>(*)" +
+                           key_in + R"(), 0, length, key_ids_.data(),
+            &dictionary_key_ids_);
+      } else {
+        )" + process_lookup_str + R"(
+      })";
+    }
+    return BaseCodes() + "using ItemIndex = " + GetItemIndexType() + ";\n" + R"(
 //#include <arrow/pretty_print.h>
 //using HashMap = arrow::internal::ScalarMemoTable<)" +
            key_ctype_str + R"(>;
-using HashMap = SparseHashMap<)" +
-           key_ctype_str + R"(>;
+using HashMap = JoinHashTable<)" +
+           key_ctype_str + R"(, ItemIndex>;
+using KeyArray = arrow::)" +
+           key_array_type_str + R"(;
 class TypedProberImpl : public CodeGenBase {
  public:
-  TypedProberImpl(arrow::compute::FunctionContext *ctx) : ctx_(ctx) {
+  TypedProberImpl(arrow::compute::FunctionContext *ctx)
+      : ctx_(ctx), build_threads_(GetJoinBuildThreads()) {
     hash_table_ = std::make_shared<HashMap>(
         ctx_->memory_pool());
         )" +
            (multiple_cols ? R"(
-    // Create Hash Kernel
+    // Create Key Normalizing Kernel
     auto type_list = {)" + join_key_type_list_define_str +
                                 R"(};
-    HashArrayKernel::Make(ctx_, type_list, &hash_kernel_);)"
+    NormalizeKeysKernel::Make(ctx_, type_list, &hash_kernel_);)"
                           : "") +
            R"(
   }
   ~TypedProberImpl() {}
 
-  arrow::Status Evaluate(const ArrayList& in) override {
+  arrow::Status Evaluate(const ArrayList& encoded_in) override {
+    ArrayList in;
+    RETURN_NOT_OK(DecodeDictionaries(ctx_, encoded_in, &in));
+    if (cur_array_id_ >= ItemIndex::kMaxArrays ||
+        static_cast<uint64_t>(in[0]->length()) > ItemIndex::kMaxRows) {
+      return arrow::Status::Invalid(
+          "Join build side exceeds ", ItemIndex::kMaxArrays, " batches of ",
+          ItemIndex::kMaxRows, " rows, set NATIVESQL_ITEM_INDEX=wide");
+    }
     )" + evaluate_cache_insert_str +
            evaluate_get_typed_array_str +
            R"(
 
-    auto insert_on_found = [this](int32_t i) {
-      memo_index_to_arrayid_[i].emplace_back(cur_array_id_, cur_id_);
-    };
-    auto insert_on_not_found = [this](int32_t i) {
-      memo_index_to_arrayid_.push_back(
-          {ArrayItemIndex(cur_array_id_, cur_id_)});
-    };
-
-    cur_id_ = 0;
-    int memo_index = 0;
-    if (typed_array->null_count() == 0) {
-      for (; cur_id_ < typed_array->length(); cur_id_++) {
-        hash_table_->GetOrInsert(typed_array->GetView(cur_id_), insert_on_found,
-                                 insert_on_not_found, &memo_index);
-      }
+    if (build_threads_ > 1) {
+      // built from all the batches at once, see MakeResultIterator
+      key_arrays_.push_back(typed_array);
     } else {
-      for (; cur_id_ < typed_array->length(); cur_id_++) {
-        if (typed_array->IsNull(cur_id_)) {
-          hash_table_->GetOrInsertNull(insert_on_found, insert_on_not_found);
-        } else {
-          hash_table_->GetOrInsert(typed_array->GetView(cur_id_),
-                                   insert_on_found, insert_on_not_found,
-                                   &memo_index);
-        }
-      }
+      auto array_id = cur_array_id_;
+      hash_table_->InsertBatch(
+          *typed_array, [array_id](int64_t id) { return ItemIndex(array_id, id); });
     }
     cur_array_id_++;
     return arrow::Status::OK();
@@ -887,20 +1589,33 @@ class TypedProberImpl : public CodeGenBase {
   arrow::Status MakeResultIterator(
       std::shared_ptr<arrow::Schema> schema,
       std::shared_ptr<ResultIterator<arrow::RecordBatch>> *out) override {
+    if (!key_arrays_.empty()) {
+      hash_table_->InsertBatches(
+          key_arrays_,
+          [](size_t array_id, int64_t id) { return ItemIndex(array_id, id); },
+          build_threads_);
+      key_arrays_.clear();
+    }
     *out = std::make_shared<ProberResultIterator>(
-        ctx_, schema, hash_kernel_, hash_table_, &memo_index_to_arrayid_)" +
+        ctx_, schema, hash_kernel_, hash_table_)" +
            finish_cached_parameter_str + R"(
     );
     return arrow::Status::OK();
   }
 
+  void UpdateMetrics(sparkcolumnarplugin::codegen::KernelMetrics *metrics) override {
+    metrics->hash_table_size = hash_table_->num_keys();
+    metrics->probe_chain_length = hash_table_->ProbeChainLength();
+  }
+
 private:
   uint64_t cur_array_id_ = 0;
-  uint64_t cur_id_ = 0;
   arrow::compute::FunctionContext *ctx_;
   std::shared_ptr<KernalBase> hash_kernel_;
   std::shared_ptr<HashMap> hash_table_;
-  std::vector<std::vector<ArrayItemIndex>> memo_index_to_arrayid_;
+  const int build_threads_;
+  // key arrays of the build side not inserted yet
+  std::vector<std::shared_ptr<KeyArray>> key_arrays_;
   )" + impl_cached_define_str +
            R"( 
 
@@ -910,32 +1625,71 @@ private:
         arrow::compute::FunctionContext *ctx,
         std::shared_ptr<arrow::Schema> schema,
         std::shared_ptr<KernalBase> hash_kernel,
-        std::shared_ptr<HashMap> hash_table,
-        std::vector<std::vector<ArrayItemIndex>> *memo_index_to_arrayid)" +
+        std::shared_ptr<HashMap> hash_table)" +
            result_iter_params_str + R"(
         )
         : ctx_(ctx), result_schema_(schema), hash_kernel_(hash_kernel),
-          hash_table_(hash_table),
-          memo_index_to_arrayid_(memo_index_to_arrayid) {
+          hash_table_(hash_table) {
             )" +
            result_iter_set_str + result_iter_prepare_str + R"(
     }
 
     std::string ToString() override { return "ProberResultIterator"; }
+)" + runtime_filter_func_str + join_probe_func_str +
+           R"(
+
+    // the probe batches are pushed through Process, which returns empty batches once
+    // the consumer is done and the hash table is released
+    void SetLimit(int64_t limit) override {
+      if (limit == 0) {
+        hash_table_ = nullptr;
+        hot_rows_.clear();
+        hot_pos_ = 0;
+        hot_started_ = false;
+      }
+    }
 
     arrow::Status
-    Process(const ArrayList &in, std::shared_ptr<arrow::RecordBatch> *out,
+    Process(const ArrayList &encoded_in, std::shared_ptr<arrow::RecordBatch> *out,
             const std::shared_ptr<arrow::Array> &selection) override {
+      if (hash_table_ == nullptr) {
+        ArrayList empty;
+        for (const auto &field : result_schema_->fields()) {
+          std::unique_ptr<arrow::ArrayBuilder> builder;
+          RETURN_NOT_OK(arrow::MakeBuilder(ctx_->memory_pool(), field->type(), &builder));
+          std::shared_ptr<arrow::Array> array;
+          RETURN_NOT_OK(builder->Finish(&array));
+          empty.push_back(std::move(array));
+        }
+        *out = arrow::RecordBatch::Make(result_schema_, 0, std::move(empty));
+        return arrow::Status::OK();
+      }
+      // the columns are read decoded, a dictionary key is looked up by its dictionary
+      ArrayList in;
+      RETURN_NOT_OK(DecodeDictionaries(ctx_, encoded_in, &in));
       auto length = in[0]->length();
-      uint64_t out_length = 0;
+      probe_ids_.clear();
+      build_ids_.clear();
+      build_valid_.clear();
+      hot_rows_.clear();
+      hot_pos_ = 0;
+      hot_started_ = false;
       )" + process_right_set_str +
            process_get_typed_array_str +
            R"(
 
+      // look up all keys first so that their cache misses overlap, partition by
+      // partition if the table is partitioned
+      key_ids_.resize(length);
+      )" + process_lookup_str + R"(
       for (int i = 0; i < length; i++) {)" +
            process_probe_str + R"(
       }
-      )" + process_finish_str +
+      )" + process_filter_str + R"(
+      // materialize the output columns one at a time from the selection vectors
+      int64_t out_length = probe_ids_.size();
+      )" + process_gather_str +
+           process_finish_str +
            R"(
       *out = arrow::RecordBatch::Make(
           result_schema_, out_length,
@@ -944,13 +1698,27 @@ private:
       //arrow::PrettyPrint(*(*out).get(), 2, &std::cout);
       return arrow::Status::OK();
     }
-
+)" + process_remaining_str +
+           R"(
   private:
     arrow::compute::FunctionContext *ctx_;
     std::shared_ptr<arrow::Schema> result_schema_;
     std::shared_ptr<KernalBase> hash_kernel_;
     std::shared_ptr<HashMap> hash_table_;
-    std::vector<std::vector<ArrayItemIndex>> *memo_index_to_arrayid_;
+    std::vector<int32_t> key_ids_;
+    HashMap::DictionaryKeyIds dictionary_key_ids_;
+    // selection vectors of the output rows of a batch: the probe row, the build row and
+    // whether there is one, see GetProcessGather
+    std::vector<int32_t> probe_ids_;
+    std::vector<ItemIndex> build_ids_;
+    std::vector<uint8_t> build_valid_;
+    // build rows of a key above which its matches are streamed by ProcessRemaining
+    const int64_t hot_key_rows_ = GetBatchSize();
+    // probe rows of hot keys, and the next match to return
+    std::vector<int32_t> hot_rows_;
+    size_t hot_pos_ = 0;
+    bool hot_started_ = false;
+    HashMap::ItemRange::Iterator hot_item_;
 )" + result_iter_cached_define_str +
            R"(
       )" + condition_check_str +
@@ -990,7 +1758,7 @@ ConditionedProbeArraysKernel::ConditionedProbeArraysKernel(
     const std::vector<std::shared_ptr<arrow::Field>>& right_field_list,
     const std::shared_ptr<arrow::Schema>& result_schema) {
   impl_.reset(new Impl(ctx, left_key_list, right_key_list, func_node, join_type,
-                       left_field_list, right_field_list, result_schema));
+                       left_field_list, right_field_list, result_schema, metrics_));
   kernel_name_ = "ConditionedProbeArraysKernel";
 }
 
@@ -1003,6 +1771,12 @@ arrow::Status ConditionedProbeArraysKernel::MakeResultIterator(
     std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
   return impl_->MakeResultIterator(schema, out);
 }
+
+KernelMetrics ConditionedProbeArraysKernel::GetMetrics() {
+  auto metrics = KernalBase::GetMetrics();
+  impl_->UpdateMetrics(&metrics);
+  return metrics;
+}
 }  // namespace extra
 }  // namespace arrowcompute
 }  // namespace codegen
@@ -0,0 +1,123 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// Number of independent lanes of the reductions below, which the compiler keeps in
+/// vector registers. The lanes are reduced together at the end.
+constexpr int kReduceLanes = 16;
+
+namespace detail {
+
+inline bool IsValidBit(const uint8_t* valid_bits, int64_t i) {
+  return (valid_bits[i >> 3] >> (i & 7)) & 1;
+}
+
+template <typename Acc, typename CType, typename Op>
+Acc Reduce(const CType* values, const uint8_t* valid_bits, int64_t offset,
+           int64_t length, Acc identity, Op op) {
+  Acc lanes[kReduceLanes];
+  std::fill(lanes, lanes + kReduceLanes, identity);
+  int64_t i = 0;
+  if (valid_bits == nullptr) {
+    for (; i + kReduceLanes <= length; i += kReduceLanes) {
+      for (int k = 0; k < kReduceLanes; k++) {
+        lanes[k] = op(lanes[k], static_cast<Acc>(values[i + k]));
+      }
+    }
+    for (; i < length; i++) {
+      lanes[0] = op(lanes[0], static_cast<Acc>(values[i]));
+    }
+  } else {
+    for (; i + kReduceLanes <= length; i += kReduceLanes) {
+      for (int k = 0; k < kReduceLanes; k++) {
+        auto value = IsValidBit(valid_bits, offset + i + k)
+                         ? static_cast<Acc>(values[i + k])
+                         : identity;
+        lanes[k] = op(lanes[k], value);
+      }
+    }
+    for (; i < length; i++) {
+      if (IsValidBit(valid_bits, offset + i)) {
+        lanes[0] = op(lanes[0], static_cast<Acc>(values[i]));
+      }
+    }
+  }
+  Acc res = identity;
+  for (int k = 0; k < kReduceLanes; k++) {
+    res = op(res, lanes[k]);
+  }
+  return res;
+}
+
+template <typename CType>
+CType MaxIdentity() {
+  using Limits = std::numeric_limits<CType>;
+  return Limits::has_infinity ? -Limits::infinity() : Limits::lowest();
+}
+
+template <typename CType>
+CType MinIdentity() {
+  using Limits = std::numeric_limits<CType>;
+  return Limits::has_infinity ? Limits::infinity() : Limits::max();
+}
+
+}  // namespace detail
+
+/// \brief Sum of the valid values, 0 if there is none
+///
+/// values points to the first value of the array and offset is the bit of its first
+/// value in valid_bits, which may be null if all are valid. Nulls are replaced by the
+/// identity of the reduction rather than branched over.
+template <typename Acc, typename CType>
+Acc SumValues(const CType* values, const uint8_t* valid_bits, int64_t offset,
+              int64_t length) {
+  return detail::Reduce<Acc>(values, valid_bits, offset, length, Acc(0),
+                             [](Acc a, Acc b) { return a + b; });
+}
+
+/// Minimum of the valid values, as SumValues, the largest CType if there is none
+template <typename CType>
+CType MinValues(const CType* values, const uint8_t* valid_bits, int64_t offset,
+                int64_t length) {
+  return detail::Reduce<CType>(values, valid_bits, offset, length,
+                               detail::MinIdentity<CType>(),
+                               [](CType a, CType b) { return b < a ? b : a; });
+}
+
+/// Maximum of the valid values, as SumValues, the smallest CType if there is none
+template <typename CType>
+CType MaxValues(const CType* values, const uint8_t* valid_bits, int64_t offset,
+                int64_t length) {
+  return detail::Reduce<CType>(values, valid_bits, offset, length,
+                               detail::MaxIdentity<CType>(),
+                               [](CType a, CType b) { return b > a ? b : a; });
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,370 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// \brief XXH64, as Spark's XXH64 with which HyperLogLogPlusPlus hashes its input
+namespace xxh64 {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t Load64(const uint8_t* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t Load32(const uint8_t* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t Fmix(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) {
+  return Rotl(acc + input * kPrime2, 31) * kPrime1;
+}
+
+inline uint64_t HashInt(int32_t input, uint64_t seed) {
+  uint64_t hash = seed + kPrime5 + 4;
+  hash ^= static_cast<uint64_t>(static_cast<uint32_t>(input)) * kPrime1;
+  hash = Rotl(hash, 23) * kPrime2 + kPrime3;
+  return Fmix(hash);
+}
+
+inline uint64_t HashLong(int64_t input, uint64_t seed) {
+  uint64_t hash = seed + kPrime5 + 8;
+  hash ^= Round(0, static_cast<uint64_t>(input));
+  hash = Rotl(hash, 27) * kPrime1 + kPrime4;
+  return Fmix(hash);
+}
+
+inline uint64_t HashBytes(const uint8_t* data, int64_t length, uint64_t seed) {
+  const uint8_t* end = data + length;
+  uint64_t hash;
+  if (length >= 32) {
+    const uint8_t* limit = end - 32;
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    do {
+      v1 = Round(v1, Load64(data));
+      v2 = Round(v2, Load64(data + 8));
+      v3 = Round(v3, Load64(data + 16));
+      v4 = Round(v4, Load64(data + 24));
+      data += 32;
+    } while (data <= limit);
+    hash = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+    for (uint64_t v : {v1, v2, v3, v4}) {
+      hash ^= Round(0, v);
+      hash = hash * kPrime1 + kPrime4;
+    }
+  } else {
+    hash = seed + kPrime5;
+  }
+  hash += static_cast<uint64_t>(length);
+  for (; data + 8 <= end; data += 8) {
+    hash ^= Round(0, Load64(data));
+    hash = Rotl(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (data + 4 <= end) {
+    hash ^= static_cast<uint64_t>(Load32(data)) * kPrime1;
+    hash = Rotl(hash, 23) * kPrime2 + kPrime3;
+    data += 4;
+  }
+  for (; data < end; data++) {
+    hash ^= static_cast<uint64_t>(*data) * kPrime5;
+    hash = Rotl(hash, 11) * kPrime1;
+  }
+  return Fmix(hash);
+}
+
+}  // namespace xxh64
+
+/// \brief Registers of Spark's HyperLogLogPlusPlus
+///
+/// The 2^p registers of 6 bits of a group are packed 10 to a word in num_words()
+/// int64 words, which is the aggregation buffer of Spark. Partial states can thus be
+/// merged by either side of a shuffle.
+class HllRegisters {
+ public:
+  /// Seed of the hash of the input values
+  static constexpr uint64_t kSeed = 42;
+
+  /// Precision of the relative standard deviation of an approx_count_distinct
+  static int PrecisionOf(double relative_sd) {
+    return static_cast<int>(std::ceil(2.0 * std::log2(1.106 / relative_sd)));
+  }
+
+  explicit HllRegisters(int p)
+      : p_(p), m_(1 << p), num_words_(((1 << p) + kPerWord - 1) / kPerWord) {}
+
+  int num_words() const { return num_words_; }
+
+  /// Add the value of hash to the registers at words
+  void Update(uint64_t hash, int64_t* words) const {
+    int idx = static_cast<int>(hash >> (64 - p_));
+    uint64_t w = (hash << p_) | (uint64_t(1) << (p_ - 1));
+    uint64_t pw = static_cast<uint64_t>(__builtin_clzll(w)) + 1;
+    int word = idx / kPerWord;
+    int shift = kBits * (idx - word * kPerWord);
+    uint64_t value = static_cast<uint64_t>(words[word]);
+    if (pw > ((value >> shift) & kMask)) {
+      words[word] = static_cast<int64_t>((value & ~(kMask << shift)) | (pw << shift));
+    }
+  }
+
+  /// Maximum of each register of two words
+  static int64_t MergeWord(int64_t left, int64_t right) {
+    uint64_t l = static_cast<uint64_t>(left);
+    uint64_t r = static_cast<uint64_t>(right);
+    uint64_t res = 0;
+    for (int shift = 0; shift < kBits * kPerWord; shift += kBits) {
+      res |= std::max(l & (kMask << shift), r & (kMask << shift));
+    }
+    return static_cast<int64_t>(res);
+  }
+
+  /// Take the maximum of the registers at words and at other
+  void Merge(const int64_t* other, int64_t* words) const {
+    for (int i = 0; i < num_words_; i++) {
+      words[i] = MergeWord(words[i], other[i]);
+    }
+  }
+
+  /// \brief Estimate of the number of distinct values added to the registers at words
+  ///
+  /// As Spark, small cardinalities are estimated by linear counting. Spark also
+  /// corrects the raw estimate of cardinalities below 5 * 2^p with its empirical bias
+  /// tables, which aren't carried here, so those may differ by a few percent.
+  int64_t Estimate(const int64_t* words) const {
+    double z_inverse = 0;
+    double zeros = 0;
+    for (int idx = 0; idx < m_; idx++) {
+      int word = idx / kPerWord;
+      int shift = kBits * (idx - word * kPerWord);
+      uint64_t value = (static_cast<uint64_t>(words[word]) >> shift) & kMask;
+      z_inverse += 1.0 / static_cast<double>(uint64_t(1) << value);
+      if (value == 0) zeros += 1;
+    }
+    // cardinalities under which linear counting is used, from p = 4
+    static constexpr int kNumThresholds = 15;
+    static constexpr double kThresholds[kNumThresholds] = {
+        10, 20, 40, 80, 220, 400, 900, 1800, 3100, 6500, 11500, 20000, 50000, 120000,
+        350000};
+    double m = m_;
+    double estimate = Alpha() * m * m / z_inverse;
+    if (zeros > 0) {
+      double linear = m * std::log(m / zeros);
+      if (p_ - 4 < kNumThresholds && linear <= kThresholds[p_ - 4]) {
+        estimate = linear;
+      }
+    }
+    return std::llround(estimate);
+  }
+
+ private:
+  static constexpr int kBits = 6;
+  static constexpr int kPerWord = 10;
+  static constexpr uint64_t kMask = 0x3f;
+
+  double Alpha() const {
+    switch (p_) {
+      case 4:
+        return 0.673;
+      case 5:
+        return 0.697;
+      case 6:
+        return 0.709;
+      default:
+        return 0.7213 / (1.0 + 1.079 / m_);
+    }
+  }
+
+  const int p_;
+  const int m_;
+  const int num_words_;
+};
+
+/// \brief Merging t-digest of a group of values
+///
+/// Values are buffered and merged into centroids whose weight is bounded by
+/// 4 * n * q * (1 - q) / compression, so the quantiles near the tails are the most
+/// accurate. Two digests merge by compressing their centroids together.
+class TDigest {
+ public:
+  explicit TDigest(double compression = 100) : compression_(compression) {}
+
+  bool empty() const { return centroids_.empty() && buffer_.empty(); }
+
+  void Add(double value) {
+    if (std::isnan(value)) return;
+    buffer_.push_back({value, 1});
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    if (buffer_.size() >= BufferLimit()) Compress();
+  }
+
+  void Merge(const TDigest& other) {
+    if (other.empty()) return;
+    buffer_.insert(buffer_.end(), other.centroids_.begin(), other.centroids_.end());
+    buffer_.insert(buffer_.end(), other.buffer_.begin(), other.buffer_.end());
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    Compress();
+  }
+
+  /// Approximate q-quantile of the values, NaN if there is none
+  double Quantile(double q) {
+    Compress();
+    if (centroids_.empty()) return std::numeric_limits<double>::quiet_NaN();
+    if (centroids_.size() == 1) return centroids_[0].mean;
+    double target = std::min(std::max(q, 0.0), 1.0) * total_;
+    const auto& first = centroids_.front();
+    if (target < first.weight / 2) {
+      return Interpolate(min_, first.mean, target / (first.weight / 2));
+    }
+    double center = first.weight / 2;
+    for (size_t i = 1; i < centroids_.size(); i++) {
+      double next = center + (centroids_[i - 1].weight + centroids_[i].weight) / 2;
+      if (target < next) {
+        return Interpolate(centroids_[i - 1].mean, centroids_[i].mean,
+                           (target - center) / (next - center));
+      }
+      center = next;
+    }
+    const auto& last = centroids_.back();
+    return Interpolate(last.mean, max_, (target - center) / (last.weight / 2));
+  }
+
+  /// Append the centroids to out as min, max, count and (mean, weight) doubles
+  void Serialize(std::string* out) {
+    Compress();
+    Append(min_, out);
+    Append(max_, out);
+    Append(static_cast<double>(centroids_.size()), out);
+    for (const auto& c : centroids_) {
+      Append(c.mean, out);
+      Append(c.weight, out);
+    }
+  }
+
+  /// Merge a digest serialized by Serialize, false if data isn't one
+  bool MergeSerialized(const uint8_t* data, int64_t length) {
+    if (length < 3 * 8) return false;
+    double min = Load(data), max = Load(data + 8), count = Load(data + 16);
+    if (length != static_cast<int64_t>(3 + 2 * count) * 8) return false;
+    if (count == 0) return true;
+    for (int64_t i = 0; i < static_cast<int64_t>(count); i++) {
+      buffer_.push_back({Load(data + 24 + 16 * i), Load(data + 32 + 16 * i)});
+    }
+    min_ = std::min(min_, min);
+    max_ = std::max(max_, max);
+    if (buffer_.size() >= BufferLimit()) Compress();
+    return true;
+  }
+
+ private:
+  struct Centroid {
+    double mean;
+    double weight;
+  };
+
+  static double Interpolate(double from, double to, double t) {
+    return from + (to - from) * std::min(std::max(t, 0.0), 1.0);
+  }
+
+  static void Append(double value, std::string* out) {
+    out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  static double Load(const uint8_t* data) {
+    double value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  size_t BufferLimit() const { return static_cast<size_t>(compression_) * 8; }
+
+  void Compress() {
+    if (buffer_.empty()) return;
+    buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+    std::sort(buffer_.begin(), buffer_.end(),
+              [](const Centroid& l, const Centroid& r) { return l.mean < r.mean; });
+    double total = 0;
+    for (const auto& c : buffer_) total += c.weight;
+    centroids_.clear();
+    Centroid cur = buffer_[0];
+    double so_far = 0;
+    for (size_t i = 1; i < buffer_.size(); i++) {
+      const auto& c = buffer_[i];
+      double weight = cur.weight + c.weight;
+      double q = (so_far + weight / 2) / total;
+      if (weight <= 4 * total * q * (1 - q) / compression_) {
+        cur.mean += (c.mean - cur.mean) * c.weight / weight;
+        cur.weight = weight;
+      } else {
+        so_far += cur.weight;
+        centroids_.push_back(cur);
+        cur = c;
+      }
+    }
+    centroids_.push_back(cur);
+    total_ = total;
+    buffer_.clear();
+  }
+
+  const double compression_;
+  std::vector<Centroid> centroids_;
+  std::vector<Centroid> buffer_;
+  double total_ = 0;
+  double min_ = std::numeric_limits<double>::infinity();
+  double max_ = -std::numeric_limits<double>::infinity();
+};
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
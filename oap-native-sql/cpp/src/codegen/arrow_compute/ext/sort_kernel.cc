@@ -16,21 +16,30 @@
  */
 
 #include <arrow/compute/context.h>
+#include <arrow/filesystem/path_util.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/reader.h>
+#include <arrow/ipc/writer.h>
 #include <arrow/type.h>
 #include <arrow/type_fwd.h>
 #include <arrow/type_traits.h>
+#include <arrow/util/io_util.h>
 
 #include <algorithm>
 #include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <memory>
 #include <numeric>
+#include <string>
 #include <vector>
 
 #include "codegen/arrow_compute/ext/array_item_index.h"
 #include "codegen/arrow_compute/ext/code_generator_base.h"
 #include "codegen/arrow_compute/ext/codegen_common.h"
 #include "codegen/arrow_compute/ext/kernels_ext.h"
+#include "codegen/arrow_compute/ext/precompiled_kernels.h"
+#include "codegen/arrow_compute/ext/spill.h"
 
 namespace sparkcolumnarplugin {
 namespace codegen {
@@ -38,13 +47,50 @@ namespace arrowcompute {
 namespace extra {
 using ArrayList = std::vector<std::shared_ptr<arrow::Array>>;
 
+/// \brief Returns the first rows of a sorted iterator, for top-k sorts
+class LimitResultIterator : public ResultIterator<arrow::RecordBatch> {
+ public:
+  LimitResultIterator(std::shared_ptr<ResultIterator<arrow::RecordBatch>> in,
+                      int64_t limit)
+      : in_(std::move(in)), remaining_(limit) {}
+
+  std::string ToString() override { return "LimitResultIterator"; }
+
+  bool HasNext() override { return remaining_ > 0 && in_->HasNext(); }
+
+  void SetLimit(int64_t limit) override {
+    if (limit >= remaining_) {
+      return;
+    }
+    remaining_ = limit;
+    in_->SetLimit(limit);
+  }
+
+  arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+    if (!HasNext()) {
+      return arrow::Status::Invalid("No more batches in top-k sort");
+    }
+    RETURN_NOT_OK(in_->Next(out));
+    if ((*out)->num_rows() > remaining_) {
+      *out = (*out)->Slice(0, remaining_);
+    }
+    remaining_ -= (*out)->num_rows();
+    return arrow::Status::OK();
+  }
+
+ private:
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> in_;
+  int64_t remaining_;
+};
+
 ///////////////  SortArraysToIndices  ////////////////
 class SortArraysToIndicesKernel::Impl {
  public:
   Impl(arrow::compute::FunctionContext* ctx,
        std::vector<std::shared_ptr<arrow::Field>> key_field_list,
-       std::shared_ptr<arrow::Schema> result_schema, bool nulls_first, bool asc)
-      : ctx_(ctx), nulls_first_(nulls_first), asc_(asc) {
+       std::shared_ptr<arrow::Schema> result_schema, bool nulls_first, bool asc,
+       int64_t limit)
+      : ctx_(ctx), nulls_first_(nulls_first), asc_(asc), limit_(limit) {
     for (auto field : key_field_list) {
       auto indices = result_schema->GetAllFieldIndices(field->name());
       if (indices.size() != 1) {
@@ -59,6 +105,11 @@ class SortArraysToIndicesKernel::Impl {
   virtual arrow::Status LoadJITFunction(
       std::vector<std::shared_ptr<arrow::Field>> key_field_list,
       std::shared_ptr<arrow::Schema> result_schema) {
+    if (precompile_ && GetPrecompiledKernels() &&
+        GetPrecompiledSorter(result_schema, key_index_list_, nulls_first_, asc_,
+                             &precompiled_sorter_)) {
+      return arrow::Status::OK();
+    }
     // generate ddl signature
     std::stringstream func_args_ss;
     func_args_ss << "[Sorter]" << (nulls_first_ ? "nulls_first" : "nulls_last") << "|"
@@ -69,37 +120,65 @@ class SortArraysToIndicesKernel::Impl {
     }
 
     func_args_ss << "[schema]" << result_schema->ToString();
+    func_args_ss << "[index]" << GetItemIndexType();
+    if (GetCompactCache()) {
+      func_args_ss << "[cache]compact";
+    }
 
     //#ifdef DEBUG
     std::cout << "func_args_ss is " << func_args_ss.str() << std::endl;
     //#endif
 
-    std::stringstream signature_ss;
-    signature_ss << std::hex << std::hash<std::string>{}(func_args_ss.str());
-    std::string signature = signature_ss.str();
-
-    auto file_lock = FileSpinLock();
-    auto status = LoadLibrary(signature, ctx_, &sorter);
-    if (!status.ok()) {
-      // process
-      auto codes = ProduceCodes(result_schema);
-      // compile codes
-      RETURN_NOT_OK(CompileCodes(codes, signature));
-      RETURN_NOT_OK(LoadLibrary(signature, ctx_, &sorter));
-    }
-    FileSpinUnLock(file_lock);
+    auto signature = GetSignature(func_args_ss.str());
+    // compiled in background, the sorter is made on first use
+    sorter_kernel = LoadOrCompileLibraryAsync(
+        signature, [&] { return ProduceCodes(result_schema); });
     return arrow::Status::OK();
   }
 
+  virtual ~Impl() = default;
+
   virtual arrow::Status Evaluate(const ArrayList& in) {
+    if (limit_ > 0) {
+      return EvaluateTopK(in);
+    }
+    RETURN_NOT_OK(MakeSorter());
     RETURN_NOT_OK(sorter->Evaluate(in));
+
+    auto memory_budget = GetSortMemoryBudget();
+    if (memory_budget <= 0) {
+      return arrow::Status::OK();
+    }
+    // the bytes the sorter keeps, less than those of in if its columns are compact
+    cached_bytes_ = sorter->CachedBytes();
+    if (cached_bytes_ > memory_budget) {
+      RETURN_NOT_OK(SpillRun());
+    }
     return arrow::Status::OK();
   }
 
   virtual arrow::Status MakeResultIterator(
       std::shared_ptr<arrow::Schema> schema,
       std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
-    RETURN_NOT_OK(sorter->MakeResultIterator(schema, out));
+    if (limit_ > 0) {
+      return MakeTopKResultIterator(schema, out);
+    }
+    if (merged_) {
+      // the runs are consumed by the first iterator
+      return arrow::Status::Invalid("A spilled sort can only be iterated once");
+    }
+    RETURN_NOT_OK(MakeSorter());
+    if (spill_target_ == nullptr || spill_target_->num_runs() == 0) {
+      RETURN_NOT_OK(sorter->MakeResultIterator(schema, out));
+      return arrow::Status::OK();
+    }
+    // external sort: merge the spilled runs and the rows still in memory, the last run
+    merged_ = true;
+    ARROW_ASSIGN_OR_RAISE(auto runs, spill_target_->TakeRuns());
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> last_run;
+    RETURN_NOT_OK(sorter->MakeResultIterator(schema, &last_run));
+    runs.push_back(std::move(last_run));
+    RETURN_NOT_OK(sorter->MakeMergeResultIterator(std::move(runs), out));
     return arrow::Status::OK();
   }
 
@@ -107,24 +186,117 @@ class SortArraysToIndicesKernel::Impl {
     return arrow::Status::OK();
   }
 
+  int64_t spill_bytes() const { return spill_bytes_; }
+
  protected:
+  KernelFuture sorter_kernel;
+  // set instead of sorter_kernel if the keys are of a precompiled shape
+  PrecompiledKernel precompiled_sorter_;
+  // whether the sorter may be a precompiled one, which sorts through indices
+  bool precompile_ = true;
   std::shared_ptr<CodeGenBase> sorter;
   arrow::compute::FunctionContext* ctx_;
   bool nulls_first_;
   bool asc_;
+  // rows of a top-k sort, 0 to sort all
+  const int64_t limit_;
   std::vector<int> key_index_list_;
+
+  // Make the sorter if there is none, once compiled
+  arrow::Status MakeSorter() {
+    if (sorter != nullptr) {
+      return arrow::Status::OK();
+    }
+    if (precompiled_sorter_) {
+      precompiled_sorter_(ctx_, &sorter);
+      return arrow::Status::OK();
+    }
+    return MakeKernel(sorter_kernel, ctx_, &sorter);
+  }
+
+  // Top-k: once the new rows outnumber the kept ones, keep only the first limit_ rows of
+  // the cached ones, so that the sorter holds O(limit_ + batch) rows
+  arrow::Status EvaluateTopK(const ArrayList& in) {
+    RETURN_NOT_OK(MakeSorter());
+    RETURN_NOT_OK(sorter->Evaluate(in));
+    cached_rows_ += in[0]->length();
+    if (cached_rows_ < limit_ + std::max<int64_t>(limit_, GetBatchSize())) {
+      return arrow::Status::OK();
+    }
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> top;
+    RETURN_NOT_OK(MakeTopKResultIterator(nullptr, &top));
+    std::vector<std::shared_ptr<arrow::RecordBatch>> kept;
+    while (top->HasNext()) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      RETURN_NOT_OK(top->Next(&batch));
+      kept.push_back(std::move(batch));
+    }
+    // the sorted batches are copies, the cached ones are released with the sorter
+    top = nullptr;
+    sorter = nullptr;
+    cached_rows_ = 0;
+    RETURN_NOT_OK(MakeSorter());
+    for (const auto& batch : kept) {
+      RETURN_NOT_OK(sorter->Evaluate(batch->columns()));
+      cached_rows_ += batch->num_rows();
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status MakeTopKResultIterator(
+      std::shared_ptr<arrow::Schema> schema,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+    RETURN_NOT_OK(MakeSorter());
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> sorted;
+    RETURN_NOT_OK(sorter->MakeResultIterator(schema, &sorted));
+    *out = std::make_shared<LimitResultIterator>(std::move(sorted), limit_);
+    return arrow::Status::OK();
+  }
+
+  // Sort the cached batches and spill them as a run, then start a new sorter for the
+  // following batches
+  arrow::Status SpillRun() {
+    if (spill_target_ == nullptr) {
+      spill_target_ = MakeSpillTarget("columnar-sort-");
+    }
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> sorted;
+    RETURN_NOT_OK(sorter->MakeResultIterator(nullptr, &sorted));
+    RETURN_NOT_OK(spill_target_->Spill(sorted.get(), &spill_bytes_));
+
+    // the iterator holds the cached batches
+    sorted = nullptr;
+    sorter = nullptr;
+    cached_bytes_ = 0;
+    return arrow::Status::OK();
+  }
+
+  int64_t cached_rows_ = 0;
+  int64_t cached_bytes_ = 0;
+  // the runs spilled, freed with the kernel if not merged
+  std::shared_ptr<SpillTarget> spill_target_;
+  bool merged_ = false;
+  // bytes of the runs spilled so far
+  int64_t spill_bytes_ = 0;
   class TypedSorterCodeGenImpl {
    public:
-    TypedSorterCodeGenImpl(std::string indice, std::string dataTypeName, std::string name)
-        : indice_(indice), dataTypeName_(dataTypeName), name_(name) {}
+    TypedSorterCodeGenImpl(std::string indice, std::string dataTypeName, std::string name,
+                           bool compact = false)
+        : indice_(indice), dataTypeName_(dataTypeName), name_(name), compact_(compact) {}
     std::string GetCachedVariablesDefine() {
       return "using DataType_" + indice_ + " = typename arrow::" + dataTypeName_ +
              ";\n"
              "using ArrayType_" +
              indice_ + " = typename arrow::TypeTraits<DataType_" + indice_ +
-             ">::ArrayType;\n"
-             "std::vector<std::shared_ptr<ArrayType_" +
-             indice_ + ">> cached_" + indice_ + "_;\n";
+             ">::ArrayType;\n" + GetCachedTypeDefine() +
+             "std::vector<std::shared_ptr<CachedType_" + indice_ + ">> cached_" +
+             indice_ + "_;\n";
+    }
+    // the cached arrays of the column, compact ones for a payload column of
+    // GetCompactCache()
+    std::string GetCachedTypeDefine() {
+      auto cached_type = compact_ ? "CompactArray<ArrayType_" + indice_ + ">"
+                                  : "ArrayType_" + indice_;
+      return "using CachedType_" + indice_ + " = " + cached_type + ";\n";
     }
     std::string GetResultIterDefine() {
       return "cached_" + indice_ + "_ = cached_" + indice_ +
@@ -142,6 +314,19 @@ class SortArraysToIndicesKernel::Impl {
     std::string GetFieldDefine() {
       return "arrow::field(\"" + name_ + "\", data_type_" + indice_ + ")";
     }
+    std::string GetMergeIterDefine() {
+      return "run_" + indice_ +
+             "_.resize(num_runs_);\n"
+             "std::unique_ptr<arrow::ArrayBuilder> builder_" +
+             indice_ +
+             ";\n"
+             "arrow::MakeBuilder(ctx_->memory_pool(), data_type_" +
+             indice_ + ", &builder_" + indice_ +
+             ");\n"
+             "builder_" +
+             indice_ + "_.reset(arrow::internal::checked_cast<BuilderType_" + indice_ +
+             "*>(builder_" + indice_ + ".release()));\n";
+    }
     std::string GetResultIterVariables() {
       return R"(
     using DataType_)" +
@@ -155,7 +340,9 @@ class SortArraysToIndicesKernel::Impl {
     std::shared_ptr<arrow::DataType> data_type_)" +
              indice_ + R"( = arrow::TypeTraits<DataType_)" + indice_ +
              R"(>::type_singleton();
-    std::vector<std::shared_ptr<ArrayType_)" +
+    )" + GetCachedTypeDefine() +
+             R"(
+    std::vector<std::shared_ptr<CachedType_)" +
              indice_ + R"(>> cached_)" + indice_ + R"(_;
     std::shared_ptr<BuilderType_)" +
              indice_ + R"(> builder_)" + indice_ + R"(_;
@@ -166,14 +353,20 @@ class SortArraysToIndicesKernel::Impl {
     std::string indice_;
     std::string dataTypeName_;
     std::string name_;
+    bool compact_;
   };
 
   virtual std::string ProduceCodes(std::shared_ptr<arrow::Schema> result_schema) {
     int indice = 0;
     std::vector<std::shared_ptr<TypedSorterCodeGenImpl>> shuffle_typed_codegen_list;
     for (auto field : result_schema->fields()) {
+      // the keys are read at random while sorting, and the first column by Finish
+      bool compact = GetCompactCache() && indice != 0 &&
+                     std::find(key_index_list_.begin(), key_index_list_.end(), indice) ==
+                         key_index_list_.end() &&
+                     IsCompactType(field->type());
       auto codegen = std::make_shared<TypedSorterCodeGenImpl>(
-          std::to_string(indice), GetTypeString(field->type()), field->name());
+          std::to_string(indice), GetTypeString(field->type()), field->name(), compact);
       shuffle_typed_codegen_list.push_back(codegen);
       indice++;
     }
@@ -184,7 +377,8 @@ class SortArraysToIndicesKernel::Impl {
 
     std::string pre_sort_null_str = GetPreSortNull();
 
-    std::string sort_func_str = GetSortFunction(key_index_list_);
+    std::string sort_func_str = GetSortFunction(
+        key_index_list_, result_schema->field(key_index_list_[0])->type());
 
     std::string make_result_iter_str =
         GetMakeResultIter(shuffle_typed_codegen_list.size());
@@ -197,24 +391,38 @@ class SortArraysToIndicesKernel::Impl {
 
     std::string result_iter_define_str = GetResultIterDefine(shuffle_typed_codegen_list);
 
-    std::string typed_build_str = GetTypedBuild(shuffle_typed_codegen_list.size());
+    std::string typed_gather_str = GetTypedGather(shuffle_typed_codegen_list.size());
 
     std::string result_variables_define_str =
         GetResultIterVariables(shuffle_typed_codegen_list);
 
-    std::string typed_res_array_build_str =
-        GetTypedResArrayBuild(shuffle_typed_codegen_list.size());
-
     std::string typed_res_array_str = GetTypedResArray(shuffle_typed_codegen_list.size());
 
-    return BaseCodes() + R"(
-#include "third_party/ska_sort.hpp"
+    std::string release_cached_str = GetCachedRelease(shuffle_typed_codegen_list.size());
+
+    std::string merge_iter_define_str = GetMergeIterDefine(shuffle_typed_codegen_list);
+
+    std::string merge_less_str = GetMergeLess(key_index_list_);
+
+    std::string merge_load_str = GetMergeLoad(shuffle_typed_codegen_list.size());
+
+    std::string merge_gather_str = GetMergeGather(shuffle_typed_codegen_list.size());
 
+    std::string merge_variables_define_str =
+        GetMergeVariables(shuffle_typed_codegen_list);
+
+    return BaseCodes() + "using ItemIndex = " + GetItemIndexType() + ";\n" + R"(
 class TypedSorterImpl : public CodeGenBase {
  public:
   TypedSorterImpl(arrow::compute::FunctionContext* ctx) : ctx_(ctx) {}
 
   arrow::Status Evaluate(const ArrayList& in) override {
+    if (num_batches_ >= ItemIndex::kMaxArrays ||
+        static_cast<uint64_t>(in[0]->length()) > ItemIndex::kMaxRows) {
+      return arrow::Status::Invalid(
+          "Sort input exceeds ", ItemIndex::kMaxArrays, " batches of ",
+          ItemIndex::kMaxRows, " rows, set NATIVESQL_ITEM_INDEX=wide");
+    }
     num_batches_++;
     items_total_ += in[0]->length();
     nulls_total_ += in[0]->null_count();
@@ -229,13 +437,13 @@ class TypedSorterImpl : public CodeGenBase {
            R"(
     // initiate buffer for all arrays
     std::shared_ptr<arrow::Buffer> indices_buf;
-    int64_t buf_size = items_total_ * sizeof(ArrayItemIndex);
+    int64_t buf_size = items_total_ * sizeof(ItemIndex);
     RETURN_NOT_OK(arrow::AllocateBuffer(ctx_->memory_pool(), buf_size, &indices_buf));
 
     // start to partition not_null with null
-    ArrayItemIndex* indices_begin =
-        reinterpret_cast<ArrayItemIndex*>(indices_buf->mutable_data());
-    ArrayItemIndex* indices_end = indices_begin + items_total_;
+    ItemIndex* indices_begin =
+        reinterpret_cast<ItemIndex*>(indices_buf->mutable_data());
+    ItemIndex* indices_end = indices_begin + items_total_;
 
     int64_t indices_i = 0;
     int64_t indices_null = 0;
@@ -260,7 +468,7 @@ class TypedSorterImpl : public CodeGenBase {
     }
     )" + sort_func_str +
            R"(
-    auto out_type = std::make_shared<arrow::FixedSizeBinaryType>(sizeof(ArrayItemIndex) /
+    auto out_type = std::make_shared<arrow::FixedSizeBinaryType>(sizeof(ItemIndex) /
                                                                  sizeof(int32_t));
     *out = std::make_shared<arrow::FixedSizeBinaryArray>(out_type, items_total_,
                                                          indices_buf);
@@ -277,14 +485,25 @@ class TypedSorterImpl : public CodeGenBase {
     return arrow::Status::OK();
   }
 
+  arrow::Status MakeMergeResultIterator(
+      std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> runs,
+      std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override {
+    *out = std::make_shared<MergeSorterResultIterator>(ctx_, std::move(runs));
+    return arrow::Status::OK();
+  }
+
+  int64_t CachedBytes() override { return cached_bytes_; }
+
  private:
   )" + cached_variables_define_str +
            R"(
   std::vector<std::shared_ptr<arrow::Array>> first_;
   arrow::compute::FunctionContext* ctx_;
+  const int sort_threads_ = GetSortThreads();
   uint64_t num_batches_ = 0;
   uint64_t items_total_ = 0;
   uint64_t nulls_total_ = 0;
+  int64_t cached_bytes_ = 0;
 
   class SorterResultIterator : public ResultIterator<arrow::RecordBatch> {
    public:
@@ -294,7 +513,7 @@ class TypedSorterImpl : public CodeGenBase {
            R"(): ctx_(ctx), total_length_(indices_in->length()), indices_in_cache_(indices_in) {
      )" + result_iter_define_str +
            R"(
-      indices_begin_ = (ArrayItemIndex*)indices_in->data()->buffers[1]->mutable_data();
+      indices_begin_ = (ItemIndex*)indices_in->data()->buffers[1]->mutable_data();
     }
 
     std::string ToString() override { return "SortArraysToIndicesResultIterator"; }
@@ -306,21 +525,26 @@ class TypedSorterImpl : public CodeGenBase {
       return true;
     }
 
-    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) {
-      auto length = (total_length_ - offset_) > )" +
-           std::to_string(GetBatchSize()) + R"( ? )" + std::to_string(GetBatchSize()) +
-           R"( : (total_length_ - offset_);
-      uint64_t count = 0;
-      while (count < length) {
-        auto item = indices_begin_ + offset_ + count++;
-      )" + typed_build_str +
+    void SetLimit(int64_t limit) override {
+      total_length_ = std::min<uint64_t>(total_length_, offset_ + limit);
+      if (offset_ >= total_length_) {
+        indices_in_cache_ = nullptr;
+        )" + release_cached_str +
            R"(
       }
-      offset_ += length;
-      )" + typed_res_array_build_str +
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) {
+      auto length = std::min<uint64_t>(total_length_ - offset_, batch_sizer_.rows());
+      // read the cached batches one at a time rather than in sort order
+      auto items = indices_begin_ + offset_;
+      OrderByArray(items, length, &order_);
+      )" + typed_gather_str +
            R"(
+      offset_ += length;
       *out = arrow::RecordBatch::Make(result_schema_, length, {)" +
            typed_res_array_str + R"(});
+      batch_sizer_.Update(**out);
       return arrow::Status::OK();
     }
 
@@ -329,11 +553,165 @@ class TypedSorterImpl : public CodeGenBase {
            R"(
     std::shared_ptr<arrow::Array> indices_in_cache_;
     uint64_t offset_ = 0;
-    ArrayItemIndex* indices_begin_;
-    const uint64_t total_length_;
+    ItemIndex* indices_begin_;
+    std::vector<int32_t> order_;
+    uint64_t total_length_;
+    BatchSizer batch_sizer_;
     std::shared_ptr<arrow::Schema> result_schema_;
     arrow::compute::FunctionContext* ctx_;
   };
+
+  // k-way merge of sorted runs with a loser tree, in the order of Finish
+  class MergeSorterResultIterator : public ResultIterator<arrow::RecordBatch> {
+   public:
+    MergeSorterResultIterator(
+        arrow::compute::FunctionContext* ctx,
+        std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> runs)
+        : ctx_(ctx),
+          runs_(std::move(runs)),
+          num_runs_(runs_.size()),
+          tree_(num_runs_, RunLess{this}),
+          rows_(num_runs_, 0),
+          lengths_(num_runs_, 0),
+          slots_(num_runs_, 0),
+          done_(num_runs_, false) {
+      )" + merge_iter_define_str +
+           R"(
+    }
+
+    std::string ToString() override { return "SortArraysToIndicesMergeResultIterator"; }
+
+    bool HasNext() override {
+      if (remaining_ == 0) {
+        return false;
+      }
+      if (!started_) {
+        started_ = true;
+        status_ = Start();
+      }
+      if (!status_.ok()) {
+        return true;
+      }
+      auto winner = tree_.Winner();
+      return winner >= 0 && !done_[winner];
+    }
+
+    void SetLimit(int64_t limit) override {
+      if (remaining_ < 0 || limit < remaining_) {
+        remaining_ = limit;
+      }
+      if (remaining_ == 0) {
+        // the run files are removed with their iterators
+        runs_.clear();
+      }
+    }
+
+    arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+      if (!HasNext()) {
+        return arrow::Status::Invalid("No more batches in sort merge");
+      }
+      RETURN_NOT_OK(status_);
+      items_.clear();
+      auto max_rows = remaining_ < 0 ? batch_sizer_.rows()
+                                     : std::min<int64_t>(batch_sizer_.rows(), remaining_);
+      while (static_cast<int64_t>(items_.size()) < max_rows) {
+        auto winner = tree_.Winner();
+        if (done_[winner]) {
+          break;
+        }
+        items_.emplace_back(slots_[winner], rows_[winner]);
+        if (++rows_[winner] == lengths_[winner]) {
+          RETURN_NOT_OK(LoadNext(winner));
+        }
+        tree_.Replay(winner);
+      }
+      int64_t length = items_.size();
+      OrderByArray(items_.data(), length, &order_);
+      )" + merge_gather_str +
+           R"(
+      // only the current batches of the runs are referenced from now on
+      for (int32_t r = 0; r < num_runs_; ++r) {
+        slots_[r] = r;
+      }
+      num_slots_ = num_runs_;
+      *out = arrow::RecordBatch::Make(result_schema_, length, {)" +
+           typed_res_array_str + R"(});
+      batch_sizer_.Update(**out);
+      if (remaining_ > 0) {
+        SetLimit(remaining_ - length);
+      }
+      return arrow::Status::OK();
+    }
+
+   private:
+    struct RunLess {
+      MergeSorterResultIterator* iter;
+      bool operator()(int32_t a, int32_t b) const { return iter->Less(a, b); }
+    };
+
+    arrow::Status Start() {
+      for (int32_t r = 0; r < num_runs_; ++r) {
+        RETURN_NOT_OK(LoadNext(r));
+      }
+      tree_.Build();
+      return arrow::Status::OK();
+    }
+
+    // Move run r to its next non-empty batch, or mark it done
+    arrow::Status LoadNext(int32_t r) {
+      while (runs_[r]->HasNext()) {
+        std::shared_ptr<arrow::RecordBatch> batch;
+        RETURN_NOT_OK(runs_[r]->Next(&batch));
+        if (batch->num_rows() == 0) {
+          continue;
+        }
+        )" + merge_load_str +
+           R"(
+        slots_[r] = num_slots_++;
+        rows_[r] = 0;
+        lengths_[r] = batch->num_rows();
+        return arrow::Status::OK();
+      }
+      done_[r] = true;
+      return arrow::Status::OK();
+    }
+
+    // Whether the current row of run a comes before the one of run b, done runs last
+    // and ties in run order
+    bool Less(int32_t a, int32_t b) const {
+      if (done_[a] || done_[b]) {
+        return done_[a] == done_[b] ? a < b : done_[b];
+      }
+      auto x = rows_[a];
+      auto y = rows_[b];
+      )" + merge_less_str +
+           R"(
+      return a < b;
+    }
+
+    arrow::compute::FunctionContext* ctx_;
+    std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>> runs_;
+    const int32_t num_runs_;
+    LoserTree<RunLess> tree_;
+    // current row, and rows of the current batch, of each run
+    std::vector<int64_t> rows_;
+    std::vector<int64_t> lengths_;
+    // slot of the current batch of each run, the slots hold the batches of the rows of
+    // the batch being merged
+    std::vector<int32_t> slots_;
+    std::vector<bool> done_;
+    int32_t num_slots_ = 0;
+    std::vector<WideArrayItemIndex> items_;
+    std::vector<int32_t> order_;
+    BatchSizer batch_sizer_;
+    bool started_ = false;
+    arrow::Status status_;
+    // rows to merge at most, -1 for all of them
+    int64_t remaining_ = -1;
+    std::shared_ptr<arrow::Schema> result_schema_;
+    )" + merge_variables_define_str +
+           R"(
+  };
 };
 
 extern "C" void MakeCodeGen(arrow::compute::FunctionContext* ctx,
@@ -346,14 +724,16 @@ extern "C" void MakeCodeGen(arrow::compute::FunctionContext* ctx,
   std::string GetCachedInsert(int shuffle_size) {
     std::stringstream ss;
     for (int i = 0; i < shuffle_size; i++) {
-      ss << "cached_" << i << "_.push_back(std::dynamic_pointer_cast<ArrayType_" << i
-         << ">(in[" << i << "]));" << std::endl;
+      ss << "RETURN_NOT_OK(CacheArray(in[" << i << "], ctx_->memory_pool(), &cached_" << i
+         << "_));\n"
+         << "cached_bytes_ += CachedArrayBytes(*cached_" << i << "_.back());"
+         << std::endl;
     }
     return ss.str();
   }
   std::string GetCompFunction(std::vector<int> sort_key_index_list) {
     std::stringstream ss;
-    ss << "auto comp = [this](ArrayItemIndex x, ArrayItemIndex y) {"
+    ss << "auto comp = [this](ItemIndex x, ItemIndex y) {"
        << GetCompFunction_(0, sort_key_index_list) << "};";
     return ss.str();
   }
@@ -404,41 +784,57 @@ extern "C" void MakeCodeGen(arrow::compute::FunctionContext* ctx,
     (indices_end - nulls_total_ + indices_null)->id = i;)";
     }
   }
-  std::string GetSortFunction(std::vector<int>& key_index_list) {
-    if (asc_) {
-      if (key_index_list.size() == 1) {
-        if (nulls_first_) {
-          return "ska_sort(indices_begin + nulls_total_, indices_begin + "
-                 "items_total_, "
-                 "[this](auto& x) -> decltype(auto){ return cached_" +
-                 std::to_string(key_index_list[0]) + "_[x.array_id]->GetView(x.id); });";
-        } else {
-          return "ska_sort(indices_begin, indices_begin + items_total_ - "
-                 "nulls_total_, "
-                 "[this](auto& x) -> decltype(auto){ return cached_" +
-                 std::to_string(key_index_list[0]) + "_[x.array_id]->GetView(x.id); });";
-        }
-
-      } else {
-        if (nulls_first_) {
-          return "std::sort(indices_begin + nulls_total_, indices_begin + "
-                 "items_total_, "
-                 "comp);";
-        } else {
-          return "std::sort(indices_begin, indices_begin + items_total_ - "
-                 "nulls_total_, comp);";
-        }
-      }
+  // Whether the fixed-width NormalizeKeyPrefix orders the values of type as GetView does
+  static bool HasKeyPrefix(const std::shared_ptr<arrow::DataType>& type) {
+    switch (type->id()) {
+      case arrow::Type::BOOL:
+      case arrow::Type::UINT8:
+      case arrow::Type::INT8:
+      case arrow::Type::UINT16:
+      case arrow::Type::INT16:
+      case arrow::Type::UINT32:
+      case arrow::Type::INT32:
+      case arrow::Type::UINT64:
+      case arrow::Type::INT64:
+      case arrow::Type::FLOAT:
+      case arrow::Type::DOUBLE:
+      case arrow::Type::DATE32:
+      case arrow::Type::DATE64:
+      case arrow::Type::TIMESTAMP:
+        return true;
+      default:
+        return false;
+    }
+  }
+  std::string GetSortFunction(std::vector<int>& key_index_list,
+                              const std::shared_ptr<arrow::DataType>& first_key_type) {
+    std::string range =
+        nulls_first_ ? "indices_begin + nulls_total_, indices_begin + items_total_"
+                     : "indices_begin, indices_begin + items_total_ - nulls_total_";
+    auto first_key = "cached_" + std::to_string(key_index_list[0]) +
+                     "_[x.array_id]->GetView(x.id)";
+    std::string chunk_sort;
+    if (arrow::is_binary_like(first_key_type->id())) {
+      // long strings often share their first bytes, refine the prefixes of the ties
+      chunk_sort =
+          "SortByStringPrefix(begin, end, [this](const ItemIndex& x, size_t offset) { "
+          "return " +
+          std::string(asc_ ? "" : "~") + "NormalizeKeyPrefix(" + first_key +
+          ", offset); }, comp);";
+    } else if (asc_ && key_index_list.size() == 1) {
+      chunk_sort = "ska_sort(begin, end, [this](auto& x) -> decltype(auto){ return " +
+                   first_key + "; });";
+    } else if (HasKeyPrefix(first_key_type)) {
+      // radix sort on the first key, comp only breaks the ties of its prefix
+      chunk_sort = "SortByKeyPrefix(begin, end, [this](const ItemIndex& x) { return " +
+                   std::string(asc_ ? "" : "~") + "NormalizeKeyPrefix(" + first_key +
+                   "); }, comp);";
     } else {
-      if (nulls_first_) {
-        return "std::sort(indices_begin + nulls_total_, indices_begin + "
-               "items_total_, "
-               "comp);";
-      } else {
-        return "std::sort(indices_begin, indices_begin + items_total_ - "
-               "nulls_total_, comp);";
-      }
+      chunk_sort = "std::sort(begin, end, comp);";
     }
+    return "ParallelSort(" + range +
+           ", sort_threads_, [this, &comp](ItemIndex* begin, ItemIndex* end) { " +
+           chunk_sort + " }, comp);";
   }
   std::string GetMakeResultIter(int shuffle_size) {
     std::stringstream ss;
@@ -467,10 +863,10 @@ extern "C" void MakeCodeGen(arrow::compute::FunctionContext* ctx,
     std::stringstream ss;
     for (int i = 0; i < shuffle_size; i++) {
       if (i + 1 < shuffle_size) {
-        ss << "std::vector<std::shared_ptr<ArrayType_" << i << ">> cached_" << i << ","
+        ss << "std::vector<std::shared_ptr<CachedType_" << i << ">> cached_" << i << ","
            << std::endl;
       } else {
-        ss << "std::vector<std::shared_ptr<ArrayType_" << i << ">> cached_" << i;
+        ss << "std::vector<std::shared_ptr<CachedType_" << i << ">> cached_" << i;
       }
     }
     return ss.str();
@@ -491,24 +887,13 @@ extern "C" void MakeCodeGen(arrow::compute::FunctionContext* ctx,
        << std::endl;
     return ss.str();
   }
-  std::string GetTypedBuild(int shuffle_size) {
-    std::stringstream ss;
-    for (int i = 0; i < shuffle_size; i++) {
-      ss << "if (!cached_" << i << "_[item->array_id]->IsNull(item->id)) {\n"
-         << "  RETURN_NOT_OK(builder_" << i << "_->Append(cached_" << i
-         << "_[item->array_id]->GetView(item->id)));\n"
-         << "} else {\n"
-         << "  RETURN_NOT_OK(builder_" << i << "_->AppendNull());\n"
-         << "}" << std::endl;
-    }
-    return ss.str();
-  }
-  std::string GetTypedResArrayBuild(int shuffle_size) {
+  std::string GetTypedGather(int shuffle_size) {
     std::stringstream ss;
     for (int i = 0; i < shuffle_size; i++) {
       ss << "std::shared_ptr<arrow::Array> out_" << i << ";\n"
-         << "RETURN_NOT_OK(builder_" << i << "_->Finish(&out_" << i << "));\n"
-         << "builder_" << i << "_->Reset();" << std::endl;
+         << "RETURN_NOT_OK(GatherArray(cached_" << i
+         << "_, items, order_.data(), length, ctx_->memory_pool(), builder_" << i
+         << "_.get(), &out_" << i << "));" << std::endl;
     }
     return ss.str();
   }
@@ -523,6 +908,13 @@ extern "C" void MakeCodeGen(arrow::compute::FunctionContext* ctx,
     }
     return ss.str();
   }
+  std::string GetCachedRelease(int shuffle_size) {
+    std::stringstream ss;
+    for (int i = 0; i < shuffle_size; i++) {
+      ss << "cached_" << i << "_.clear();" << std::endl;
+    }
+    return ss.str();
+  }
   std::string GetResultIterVariables(
       std::vector<std::shared_ptr<TypedSorterCodeGenImpl>> shuffle_typed_codegen_list) {
     std::stringstream ss;
@@ -531,6 +923,75 @@ extern "C" void MakeCodeGen(arrow::compute::FunctionContext* ctx,
     }
     return ss.str();
   }
+  std::string GetMergeIterDefine(
+      std::vector<std::shared_ptr<TypedSorterCodeGenImpl>> shuffle_typed_codegen_list) {
+    std::stringstream ss;
+    std::stringstream field_define_ss;
+    for (auto codegen : shuffle_typed_codegen_list) {
+      ss << codegen->GetMergeIterDefine() << std::endl;
+      if (codegen != *(shuffle_typed_codegen_list.end() - 1)) {
+        field_define_ss << codegen->GetFieldDefine() << ",";
+      } else {
+        field_define_ss << codegen->GetFieldDefine();
+      }
+    }
+    ss << "result_schema_ = arrow::schema({" << field_define_ss.str() << "});\n"
+       << std::endl;
+    return ss.str();
+  }
+  // the null rows of the first column come first or last in input order, as placed by
+  // Finish, the others are ordered by the keys
+  std::string GetMergeLess(std::vector<int> sort_key_index_list) {
+    std::stringstream ss;
+    ss << "bool x_null = run_0_[a]->IsNull(x);\n"
+       << "bool y_null = run_0_[b]->IsNull(y);\n"
+       << "if (x_null || y_null) {\n"
+       << "  return x_null == y_null ? a < b : " << (nulls_first_ ? "x_null" : "y_null")
+       << ";\n"
+       << "}" << std::endl;
+    for (auto key_id : sort_key_index_list) {
+      ss << "{\n"
+         << "  auto x_key = run_" << key_id << "_[a]->GetView(x);\n"
+         << "  auto y_key = run_" << key_id << "_[b]->GetView(y);\n"
+         << "  if (x_key != y_key) {\n"
+         << "    return x_key " << (asc_ ? "<" : ">") << " y_key;\n"
+         << "  }\n"
+         << "}" << std::endl;
+    }
+    return ss.str();
+  }
+  std::string GetMergeLoad(int shuffle_size) {
+    std::stringstream ss;
+    for (int i = 0; i < shuffle_size; i++) {
+      ss << "run_" << i << "_[r] = std::static_pointer_cast<ArrayType_" << i
+         << ">(batch->column(" << i << "));\n"
+         << "slots_" << i << "_.push_back(run_" << i << "_[r]);" << std::endl;
+    }
+    return ss.str();
+  }
+  std::string GetMergeGather(int shuffle_size) {
+    std::stringstream ss;
+    for (int i = 0; i < shuffle_size; i++) {
+      ss << "std::shared_ptr<arrow::Array> out_" << i << ";\n"
+         << "RETURN_NOT_OK(GatherArray(slots_" << i
+         << "_, items_.data(), order_.data(), length, ctx_->memory_pool(), builder_"
+         << i << "_.get(), &out_" << i << "));\n"
+         << "slots_" << i << "_ = run_" << i << "_;" << std::endl;
+    }
+    return ss.str();
+  }
+  std::string GetMergeVariables(
+      std::vector<std::shared_ptr<TypedSorterCodeGenImpl>> shuffle_typed_codegen_list) {
+    std::stringstream ss;
+    ss << GetResultIterVariables(shuffle_typed_codegen_list);
+    for (int i = 0; i < shuffle_typed_codegen_list.size(); i++) {
+      // current batch of each run, and batches of the slots
+      ss << "std::vector<std::shared_ptr<ArrayType_" << i << ">> run_" << i << "_;\n"
+         << "std::vector<std::shared_ptr<ArrayType_" << i << ">> slots_" << i << "_;"
+         << std::endl;
+    }
+    return ss.str();
+  }
 };
 
 ///////////////  SortArraysInPlace  ////////////////
@@ -539,8 +1000,10 @@ class SortInplaceKernel : public SortArraysToIndicesKernel::Impl {
   SortInplaceKernel(arrow::compute::FunctionContext* ctx,
                     std::vector<std::shared_ptr<arrow::Field>> key_field_list,
                     std::shared_ptr<arrow::Schema> result_schema, bool nulls_first,
-                    bool asc)
-      : Impl(ctx, key_field_list, result_schema, nulls_first, asc) {
+                    bool asc, int64_t limit)
+      : Impl(ctx, key_field_list, result_schema, nulls_first, asc, limit) {
+    // the sorter sorts the values themselves
+    precompile_ = false;
     auto indices = result_schema->GetAllFieldIndices(key_field_list[0]->name());
     if (indices.size() != 1) {
       std::cout << "[ERROR] SortArraysToIndicesKernel::Impl can't find key "
@@ -551,6 +1014,10 @@ class SortInplaceKernel : public SortArraysToIndicesKernel::Impl {
   }
 
   arrow::Status Evaluate(const ArrayList& in) override {
+    if (limit_ > 0) {
+      return EvaluateTopK(in);
+    }
+    RETURN_NOT_OK(MakeSorter());
     RETURN_NOT_OK(sorter->Evaluate(in));
     return arrow::Status::OK();
   }
@@ -558,6 +1025,10 @@ class SortInplaceKernel : public SortArraysToIndicesKernel::Impl {
   arrow::Status MakeResultIterator(
       std::shared_ptr<arrow::Schema> schema,
       std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) override {
+    if (limit_ > 0) {
+      return MakeTopKResultIterator(schema, out);
+    }
+    RETURN_NOT_OK(MakeSorter());
     RETURN_NOT_OK(sorter->MakeResultIterator(schema, out));
     return arrow::Status::OK();
   }
@@ -643,10 +1114,6 @@ class SortInplaceKernel : public SortArraysToIndicesKernel::Impl {
     std::string typed_res_array_str = GetTypedResArray(typed_codegen_list.size());
 
     return BaseCodes() + R"(
-#include <arrow/array/concatenate.h>
-
-#include "third_party/ska_sort.hpp"
-
 class TypedSorterImpl : public CodeGenBase {
  public:
   TypedSorterImpl(arrow::compute::FunctionContext* ctx) : ctx_(ctx) {}
@@ -708,10 +1175,13 @@ class TypedSorterImpl : public CodeGenBase {
       return true;
     }
 
+    // the indices are the sorter's, released with it
+    void SetLimit(int64_t limit) override {
+      total_length_ = std::min<uint64_t>(total_length_, offset_ + limit);
+    }
+
     arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) {
-      auto length = (total_length_ - offset_) > )" +
-           std::to_string(GetBatchSize()) + R"( ? )" + std::to_string(GetBatchSize()) +
-           R"( : (total_length_ - offset_);
+      auto length = std::min<uint64_t>(total_length_ - offset_, batch_sizer_.rows());
       uint64_t count = 0;
       if (offset_ >= nulls_total_) {
         while (count < length){
@@ -731,6 +1201,7 @@ class TypedSorterImpl : public CodeGenBase {
            R"(
       *out = arrow::RecordBatch::Make(result_schema_, length, {)" +
            typed_res_array_str + R"(});
+      batch_sizer_.Update(**out);
       return arrow::Status::OK();
     }
 
@@ -741,8 +1212,9 @@ class TypedSorterImpl : public CodeGenBase {
     uint64_t offset_ = 0;
     )" + ctype_str +
            R"(* indices_begin_;
-    const uint64_t total_length_;
+    uint64_t total_length_;
     const uint64_t nulls_total_;
+    BatchSizer batch_sizer_;
     std::shared_ptr<arrow::Schema> result_schema_;
     arrow::compute::FunctionContext* ctx_;
   };
@@ -860,22 +1332,23 @@ arrow::Status SortArraysToIndicesKernel::Make(
     arrow::compute::FunctionContext* ctx,
     std::vector<std::shared_ptr<arrow::Field>> key_field_list,
     std::shared_ptr<arrow::Schema> result_schema, std::shared_ptr<KernalBase>* out,
-    bool nulls_first, bool asc) {
+    bool nulls_first, bool asc, int64_t limit) {
   *out = std::make_shared<SortArraysToIndicesKernel>(ctx, key_field_list, result_schema,
-                                                     nulls_first, asc);
+                                                     nulls_first, asc, limit);
   return arrow::Status::OK();
 }
 
 SortArraysToIndicesKernel::SortArraysToIndicesKernel(
     arrow::compute::FunctionContext* ctx,
     std::vector<std::shared_ptr<arrow::Field>> key_field_list,
-    std::shared_ptr<arrow::Schema> result_schema, bool nulls_first, bool asc) {
+    std::shared_ptr<arrow::Schema> result_schema, bool nulls_first, bool asc,
+    int64_t limit) {
   if (key_field_list.size() == 1 && result_schema->num_fields() == 1) {
     std::cout << "UseSortInplace" << std::endl;
-    impl_.reset(
-        new SortInplaceKernel(ctx, key_field_list, result_schema, nulls_first, asc));
+    impl_.reset(new SortInplaceKernel(ctx, key_field_list, result_schema, nulls_first,
+                                      asc, limit));
   } else {
-    impl_.reset(new Impl(ctx, key_field_list, result_schema, nulls_first, asc));
+    impl_.reset(new Impl(ctx, key_field_list, result_schema, nulls_first, asc, limit));
   }
   auto status = impl_->LoadJITFunction(key_field_list, result_schema);
   if (!status.ok()) {
@@ -896,6 +1369,12 @@ arrow::Status SortArraysToIndicesKernel::MakeResultIterator(
   return impl_->MakeResultIterator(schema, out);
 }
 
+KernelMetrics SortArraysToIndicesKernel::GetMetrics() {
+  auto metrics = KernalBase::GetMetrics();
+  metrics.spill_bytes = impl_->spill_bytes();
+  return metrics;
+}
+
 }  // namespace extra
 }  // namespace arrowcompute
 }  // namespace codegen
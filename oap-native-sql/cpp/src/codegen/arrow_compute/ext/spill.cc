@@ -0,0 +1,362 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codegen/arrow_compute/ext/spill.h"
+
+#include <arrow/buffer.h>
+#include <arrow/filesystem/path_util.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/reader.h>
+#include <arrow/ipc/writer.h>
+#include <arrow/record_batch.h>
+#include <arrow/util/io_util.h>
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#ifdef NATIVESQL_PMEM_SPILL
+#include "utils/pmem_memory_pool.h"
+#endif
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+using sparkcolumnarplugin::shuffle::ShuffleReader;
+using sparkcolumnarplugin::shuffle::Splitter;
+
+arrow::Status SplitArrays(Splitter* splitter,
+                          const std::shared_ptr<arrow::Schema>& schema,
+                          const std::vector<std::shared_ptr<arrow::Array>>& arrays) {
+  auto num_rows = arrays.empty() ? 0 : arrays[0]->length();
+  return splitter->Split(*arrow::RecordBatch::Make(schema, num_rows, arrays));
+}
+
+arrow::Result<std::shared_ptr<Splitter>> MakeSpillSplitter(
+    const std::shared_ptr<arrow::Schema>& schema, const std::vector<int32_t>& keys,
+    int32_t num_partitions, int64_t memory_budget) {
+  sparkcolumnarplugin::shuffle::PartitioningOptions options;
+  options.partitioning = sparkcolumnarplugin::shuffle::Partitioning::HASH;
+  options.key_indices = keys;
+  ARROW_ASSIGN_OR_RAISE(auto splitter, Splitter::Make(schema, num_partitions, options));
+  splitter->set_memory_limit(memory_budget);
+  return splitter;
+}
+
+arrow::Status StopSpillSplitter(Splitter* splitter, int64_t* spill_bytes) {
+  RETURN_NOT_OK(splitter->Stop());
+  ARROW_ASSIGN_OR_RAISE(auto bytes, splitter->TotalBytesWritten());
+  *spill_bytes += bytes;
+  return arrow::Status::OK();
+}
+
+arrow::Result<std::shared_ptr<ShuffleReader>> OpenSpillFile(const std::string& path) {
+  ARROW_ASSIGN_OR_RAISE(auto file, arrow::io::ReadableFile::Open(path));
+  ARROW_ASSIGN_OR_RAISE(auto size, file->GetSize());
+  ARROW_ASSIGN_OR_RAISE(auto buffer, file->Read(size));
+  RETURN_NOT_OK(file->Close());
+  return ShuffleReader::Make({std::move(buffer)});
+}
+
+namespace {
+
+using RunList = std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>>;
+
+/// \brief Reads back a run spilled by DiskSpillTarget
+///
+/// Streams the batches of the run file one at a time, the file is removed with the
+/// iterator.
+class SpilledRunIterator : public ResultIterator<arrow::RecordBatch> {
+ public:
+  static arrow::Result<std::shared_ptr<SpilledRunIterator>> Open(
+      const std::string& path, std::shared_ptr<arrow::internal::TemporaryDir> dir) {
+    ARROW_ASSIGN_OR_RAISE(auto file, arrow::io::ReadableFile::Open(path));
+    ARROW_ASSIGN_OR_RAISE(auto reader,
+                          arrow::ipc::RecordBatchStreamReader::Open(file.get()));
+    return std::make_shared<SpilledRunIterator>(path, std::move(dir), std::move(file),
+                                                std::move(reader));
+  }
+
+  SpilledRunIterator(std::string path, std::shared_ptr<arrow::internal::TemporaryDir> dir,
+                     std::shared_ptr<arrow::io::ReadableFile> file,
+                     std::shared_ptr<arrow::RecordBatchReader> reader)
+      : path_(std::move(path)),
+        dir_(std::move(dir)),
+        file_(std::move(file)),
+        reader_(std::move(reader)) {}
+
+  ~SpilledRunIterator() {
+    reader_ = nullptr;
+    file_ = nullptr;
+    std::remove(path_.c_str());
+  }
+
+  std::string ToString() override { return "SpilledRunIterator"; }
+
+  /// Read ahead one batch, true if there is one or if reading it failed, in which case
+  /// Next returns the error
+  bool HasNext() override {
+    if (next_ == nullptr && status_.ok() && !done_) {
+      status_ = reader_->ReadNext(&next_);
+      done_ = status_.ok() && next_ == nullptr;
+    }
+    return next_ != nullptr || !status_.ok();
+  }
+
+  arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+    if (!HasNext()) {
+      return arrow::Status::Invalid("No more batches in spilled run ", path_);
+    }
+    RETURN_NOT_OK(status_);
+    *out = std::move(next_);
+    next_ = nullptr;
+    return arrow::Status::OK();
+  }
+
+ private:
+  const std::string path_;
+  // the directory of the run files, removed with the last of its runs
+  std::shared_ptr<arrow::internal::TemporaryDir> dir_;
+  std::shared_ptr<arrow::io::ReadableFile> file_;
+  std::shared_ptr<arrow::RecordBatchReader> reader_;
+  std::shared_ptr<arrow::RecordBatch> next_;
+  arrow::Status status_;
+  bool done_ = false;
+};
+
+/// \brief Writes each run as an IPC stream file of a temporary directory
+class DiskSpillTarget : public SpillTarget {
+ public:
+  explicit DiskSpillTarget(std::string prefix) : prefix_(std::move(prefix)) {}
+
+  ~DiskSpillTarget() override {
+    for (const auto& path : run_files_) {
+      std::remove(path.c_str());
+    }
+  }
+
+  arrow::Status Spill(ResultIterator<arrow::RecordBatch>* batches,
+                      int64_t* spill_bytes) override {
+    if (spill_dir_ == nullptr) {
+      ARROW_ASSIGN_OR_RAISE(spill_dir_, arrow::internal::TemporaryDir::Make(prefix_));
+    }
+    auto path = arrow::fs::internal::ConcatAbstractPath(
+        spill_dir_->path().ToString(), "run-" + std::to_string(num_files_++) + ".arrow");
+    ARROW_ASSIGN_OR_RAISE(auto file, arrow::io::FileOutputStream::Open(path));
+    run_files_.push_back(path);
+
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+    while (batches->HasNext()) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      RETURN_NOT_OK(batches->Next(&batch));
+      if (writer == nullptr) {
+        ARROW_ASSIGN_OR_RAISE(writer,
+                              arrow::ipc::NewStreamWriter(file.get(), batch->schema()));
+      }
+      RETURN_NOT_OK(writer->WriteRecordBatch(*batch));
+    }
+    if (writer != nullptr) {
+      RETURN_NOT_OK(writer->Close());
+    }
+    ARROW_ASSIGN_OR_RAISE(auto run_bytes, file->Tell());
+    *spill_bytes += run_bytes;
+    RETURN_NOT_OK(file->Close());
+    if (writer == nullptr) {
+      // no rows, e.g. empty batches
+      std::remove(path.c_str());
+      run_files_.pop_back();
+    }
+    return arrow::Status::OK();
+  }
+
+  int64_t num_runs() const override { return run_files_.size(); }
+
+  arrow::Result<RunList> TakeRuns() override {
+    RunList runs;
+    for (const auto& path : run_files_) {
+      ARROW_ASSIGN_OR_RAISE(auto run, SpilledRunIterator::Open(path, spill_dir_));
+      runs.push_back(std::move(run));
+    }
+    run_files_.clear();
+    return runs;
+  }
+
+ private:
+  const std::string prefix_;
+  std::shared_ptr<arrow::internal::TemporaryDir> spill_dir_;
+  std::vector<std::string> run_files_;
+  int num_files_ = 0;
+};
+
+#ifdef NATIVESQL_PMEM_SPILL
+/// \brief Hands out batches kept in memory, e.g. a run in PMem, freed with the iterator
+class BatchListIterator : public ResultIterator<arrow::RecordBatch> {
+ public:
+  explicit BatchListIterator(std::vector<std::shared_ptr<arrow::RecordBatch>> batches)
+      : batches_(std::move(batches)) {}
+
+  std::string ToString() override { return "BatchListIterator"; }
+
+  bool HasNext() override { return next_ < batches_.size(); }
+
+  arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+    if (!HasNext()) {
+      return arrow::Status::Invalid("No more batches in spilled run");
+    }
+    // freed once handed out
+    *out = std::move(batches_[next_++]);
+    return arrow::Status::OK();
+  }
+
+ private:
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches_;
+  size_t next_ = 0;
+};
+
+/// \brief The batches of a list, then those left in rest
+class ChainedIterator : public ResultIterator<arrow::RecordBatch> {
+ public:
+  ChainedIterator(std::vector<std::shared_ptr<arrow::RecordBatch>> first,
+                  ResultIterator<arrow::RecordBatch>* rest)
+      : first_(std::move(first)), rest_(rest) {}
+
+  bool HasNext() override { return first_.HasNext() || rest_->HasNext(); }
+
+  arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override {
+    return first_.HasNext() ? first_.Next(out) : rest_->Next(out);
+  }
+
+ private:
+  BatchListIterator first_;
+  ResultIterator<arrow::RecordBatch>* rest_;
+};
+
+/// Copy of the buffers of data and of its children into pool, adding their bytes to
+/// bytes. NotImplemented for dictionaries, which are left to disk.
+arrow::Result<std::shared_ptr<arrow::ArrayData>> CopyArrayData(
+    const arrow::ArrayData& data, arrow::MemoryPool* pool, int64_t* bytes) {
+  if (data.type->id() == arrow::Type::DICTIONARY) {
+    return arrow::Status::NotImplemented("PMem spill of dictionary arrays");
+  }
+  auto copy = std::make_shared<arrow::ArrayData>(data);
+  for (auto& buffer : copy->buffers) {
+    if (buffer == nullptr) {
+      continue;
+    }
+    ARROW_ASSIGN_OR_RAISE(auto pmem_buffer, arrow::AllocateBuffer(buffer->size(), pool));
+    memcpy(pmem_buffer->mutable_data(), buffer->data(), buffer->size());
+    *bytes += buffer->size();
+    buffer = std::move(pmem_buffer);
+  }
+  for (auto& child : copy->child_data) {
+    ARROW_ASSIGN_OR_RAISE(child, CopyArrayData(*child, pool, bytes));
+  }
+  return copy;
+}
+
+/// \brief Keeps each run in PMem as Arrow buffers, or on disk past the PMem capacity
+class PmemSpillTarget : public SpillTarget {
+ public:
+  PmemSpillTarget(arrow::MemoryPool* pool, std::string prefix)
+      : pool_(pool), disk_(std::move(prefix)) {}
+
+  arrow::Status Spill(ResultIterator<arrow::RecordBatch>* batches,
+                      int64_t* spill_bytes) override {
+    std::vector<std::shared_ptr<arrow::RecordBatch>> run;
+    int64_t run_bytes = 0;
+    while (batches->HasNext()) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      RETURN_NOT_OK(batches->Next(&batch));
+      auto copy = CopyBatch(*batch, &run_bytes);
+      if (copy.ok()) {
+        run.push_back(std::move(copy).ValueOrDie());
+        continue;
+      }
+      if (!copy.status().IsOutOfMemory() && !copy.status().IsNotImplemented()) {
+        return copy.status();
+      }
+      // the whole run goes to disk, the batches copied so far freed once written
+      run.push_back(std::move(batch));
+      ChainedIterator rest(std::move(run), batches);
+      auto disk_runs = disk_.num_runs();
+      RETURN_NOT_OK(disk_.Spill(&rest, spill_bytes));
+      if (disk_.num_runs() > disk_runs) {
+        runs_.emplace_back();
+      }
+      return arrow::Status::OK();
+    }
+    if (!run.empty()) {
+      *spill_bytes += run_bytes;
+      runs_.push_back(std::move(run));
+    }
+    return arrow::Status::OK();
+  }
+
+  int64_t num_runs() const override { return runs_.size(); }
+
+  arrow::Result<RunList> TakeRuns() override {
+    ARROW_ASSIGN_OR_RAISE(auto disk_runs, disk_.TakeRuns());
+    RunList runs;
+    size_t next_disk_run = 0;
+    for (auto& run : runs_) {
+      // an empty run is one on disk
+      if (run.empty()) {
+        runs.push_back(std::move(disk_runs[next_disk_run++]));
+      } else {
+        runs.push_back(std::make_shared<BatchListIterator>(std::move(run)));
+      }
+    }
+    runs_.clear();
+    return runs;
+  }
+
+ private:
+  arrow::Result<std::shared_ptr<arrow::RecordBatch>> CopyBatch(
+      const arrow::RecordBatch& batch, int64_t* bytes) {
+    std::vector<std::shared_ptr<arrow::ArrayData>> columns;
+    for (int i = 0; i < batch.num_columns(); ++i) {
+      ARROW_ASSIGN_OR_RAISE(auto column,
+                            CopyArrayData(*batch.column_data(i), pool_, bytes));
+      columns.push_back(std::move(column));
+    }
+    return arrow::RecordBatch::Make(batch.schema(), batch.num_rows(), std::move(columns));
+  }
+
+  arrow::MemoryPool* pool_;
+  DiskSpillTarget disk_;
+  // the batches of each run in PMem, in spill order, empty for those on disk
+  std::vector<std::vector<std::shared_ptr<arrow::RecordBatch>>> runs_;
+};
+#endif
+
+}  // namespace
+
+std::shared_ptr<SpillTarget> MakeSpillTarget(const std::string& prefix) {
+#ifdef NATIVESQL_PMEM_SPILL
+  if (auto pool = sparkcolumnarplugin::PmemMemoryPool::Default()) {
+    return std::make_shared<PmemSpillTarget>(pool, prefix);
+  }
+#endif
+  return std::make_shared<DiskSpillTarget>(prefix);
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,89 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/array.h>
+#include <arrow/record_batch.h>
+#include <arrow/result.h>
+#include <arrow/status.h>
+#include <arrow/type.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "codegen/common/result_iterator.h"
+#include "shuffle/reader.h"
+#include "shuffle/splitter.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// Split the arrays of a batch of schema by splitter
+arrow::Status SplitArrays(sparkcolumnarplugin::shuffle::Splitter* splitter,
+                          const std::shared_ptr<arrow::Schema>& schema,
+                          const std::vector<std::shared_ptr<arrow::Array>>& arrays);
+
+/// Splitter spilling rows by hash partition of their keys, into one file per partition.
+/// Fails for keys the splitter can't hash.
+arrow::Result<std::shared_ptr<sparkcolumnarplugin::shuffle::Splitter>> MakeSpillSplitter(
+    const std::shared_ptr<arrow::Schema>& schema, const std::vector<int32_t>& keys,
+    int32_t num_partitions, int64_t memory_budget);
+
+/// Stop splitter, adding the bytes it spilled to spill_bytes
+arrow::Status StopSpillSplitter(sparkcolumnarplugin::shuffle::Splitter* splitter,
+                                int64_t* spill_bytes);
+
+/// Reader of the batches of a partition file of MakeSpillSplitter, read at once
+arrow::Result<std::shared_ptr<sparkcolumnarplugin::shuffle::ShuffleReader>>
+OpenSpillFile(const std::string& path);
+
+/// \brief Where a kernel spills the runs of batches it can't keep in memory
+///
+/// A run is the batches of one iterator, spilled at once and read back once, in order.
+/// Built with PMEM_SPILL and with PmemMemoryPool::Default() set up, the runs are copied
+/// to PMem, where they stay Arrow buffers read back without deserialization, a run past
+/// the PMem capacity going to disk. Otherwise they are written as IPC stream files of a
+/// temporary directory. The runs not taken are freed with the target.
+class SpillTarget {
+ public:
+  virtual ~SpillTarget() = default;
+
+  /// Spill the batches left in batches as a run, adding the bytes spilled to
+  /// spill_bytes. A run of no batch is dropped.
+  virtual arrow::Status Spill(ResultIterator<arrow::RecordBatch>* batches,
+                              int64_t* spill_bytes) = 0;
+
+  /// Runs spilled and not taken yet
+  virtual int64_t num_runs() const = 0;
+
+  /// Iterators over the runs spilled and not taken yet, in spill order, each freeing
+  /// its run once destroyed
+  virtual arrow::Result<std::vector<std::shared_ptr<ResultIterator<arrow::RecordBatch>>>>
+  TakeRuns() = 0;
+};
+
+/// Spill target of a kernel, its temporary directory named after prefix
+std::shared_ptr<SpillTarget> MakeSpillTarget(const std::string& prefix);
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,271 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codegen/arrow_compute/ext/star_join.h"
+
+#include <arrow/builder.h>
+#include <arrow/compute/context.h>
+#include <arrow/compute/kernels/take.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "codegen/common/join_probe.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+namespace {
+
+using ArrayList = std::vector<std::shared_ptr<arrow::Array>>;
+
+template <typename ArrayType>
+arrow::Status AppendSelected(const arrow::Array& selection, int64_t length,
+                             std::vector<int32_t>* rows) {
+  const auto& indices = static_cast<const ArrayType&>(selection);
+  for (int64_t i = 0; i < indices.length(); i++) {
+    auto index = static_cast<int64_t>(indices.Value(i));
+    if (index < 0 || index >= length) {
+      return arrow::Status::Invalid("Selected row ", index, " out of a batch of ",
+                                    length);
+    }
+    rows->push_back(static_cast<int32_t>(index));
+  }
+  return arrow::Status::OK();
+}
+
+// The rows of a batch of length selected by selection, as made by a gandiva filter, all
+// of them without one
+arrow::Status SelectedRows(const std::shared_ptr<arrow::Array>& selection,
+                           int64_t length, std::vector<int32_t>* rows) {
+  rows->clear();
+  if (selection == nullptr) {
+    rows->resize(length);
+    for (int32_t i = 0; i < length; i++) {
+      (*rows)[i] = i;
+    }
+    return arrow::Status::OK();
+  }
+  switch (selection->type_id()) {
+    case arrow::Type::UINT16:
+      return AppendSelected<arrow::UInt16Array>(*selection, length, rows);
+    case arrow::Type::INT32:
+      return AppendSelected<arrow::Int32Array>(*selection, length, rows);
+    case arrow::Type::UINT32:
+      return AppendSelected<arrow::UInt32Array>(*selection, length, rows);
+    case arrow::Type::UINT64:
+      return AppendSelected<arrow::UInt64Array>(*selection, length, rows);
+    default:
+      return arrow::Status::Invalid("Selection vector of type ",
+                                    selection->type()->ToString());
+  }
+}
+
+// Whether each of the n rows probed has exactly one match, positions being 0 to n - 1
+bool OneMatchEach(const std::vector<int32_t>& positions, size_t n) {
+  if (positions.size() != n) {
+    return false;
+  }
+  for (size_t k = 0; k < n; k++) {
+    if (positions[k] != static_cast<int32_t>(k)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class StarJoinResultIterator : public ResultIterator<arrow::RecordBatch> {
+ public:
+  struct Dimension {
+    StarJoinDimension spec;
+    std::shared_ptr<JoinProbe> probe;
+  };
+
+  StarJoinResultIterator(arrow::MemoryPool* pool, std::shared_ptr<arrow::Schema> schema,
+                         std::vector<Dimension> dimensions)
+      : pool_(pool),
+        schema_(std::move(schema)),
+        dimensions_(std::move(dimensions)),
+        build_ids_(dimensions_.size()),
+        build_valid_(dimensions_.size()),
+        next_build_ids_(dimensions_.size()),
+        next_build_valid_(dimensions_.size()) {
+    for (size_t d = 0; d < dimensions_.size(); d++) {
+      probe_order_.push_back(d);
+    }
+    // the inner joins drop rows, the outer ones never do
+    std::stable_sort(probe_order_.begin(), probe_order_.end(), [this](size_t x, size_t y) {
+      return dimensions_[x].spec.join_type == 0 && dimensions_[y].spec.join_type != 0;
+    });
+  }
+
+  std::string ToString() override { return "StarJoinResultIterator"; }
+
+  void SetLimit(int64_t limit) override {
+    for (auto& dimension : dimensions_) {
+      dimension.spec.build->SetLimit(limit);
+    }
+  }
+
+  arrow::Status Process(const ArrayList& in, std::shared_ptr<arrow::RecordBatch>* out,
+                        const std::shared_ptr<arrow::Array>& selection) override {
+    auto length = in.empty() ? 0 : in[0]->length();
+    RETURN_NOT_OK(SelectedRows(selection, length, &rows_));
+    for (size_t d = 0; d < dimensions_.size(); d++) {
+      build_ids_[d].clear();
+      build_valid_[d].clear();
+    }
+    for (size_t n = 0; n < probe_order_.size() && !rows_.empty(); n++) {
+      auto d = probe_order_[n];
+      const auto& dimension = dimensions_[d];
+      ArrayList keys;
+      for (auto i : dimension.spec.key_indices) {
+        keys.push_back(in[i]);
+      }
+      positions_.clear();
+      ids_.clear();
+      RETURN_NOT_OK(dimension.probe->Lookup(keys, rows_, &positions_, &ids_));
+      if (OneMatchEach(positions_, rows_.size())) {
+        // the rows stay as they are, e.g. for the unique keys of most dimensions
+        build_ids_[d].swap(ids_);
+        build_valid_[d].assign(rows_.size(), 1);
+      } else {
+        Expand(n, dimension.spec.join_type == 1);
+      }
+    }
+
+    // materialize the output columns once from the selection vectors
+    int64_t out_length = rows_.size();
+    ArrayList columns;
+    arrow::Int32Builder indices_builder(pool_);
+    RETURN_NOT_OK(indices_builder.AppendValues(rows_));
+    std::shared_ptr<arrow::Array> indices;
+    RETURN_NOT_OK(indices_builder.Finish(&indices));
+    arrow::compute::FunctionContext ctx(pool_);
+    for (const auto& column : in) {
+      std::shared_ptr<arrow::Array> taken;
+      RETURN_NOT_OK(arrow::compute::Take(&ctx, *column, *indices,
+                                         arrow::compute::TakeOptions(), &taken));
+      columns.push_back(std::move(taken));
+    }
+    for (size_t d = 0; d < dimensions_.size(); d++) {
+      // the dimensions not probed once no row is left, with no build id either
+      build_ids_[d].resize(out_length);
+      build_valid_[d].resize(out_length);
+      RETURN_NOT_OK(dimensions_[d].probe->Gather(build_ids_[d], build_valid_[d].data(),
+                                                 &columns));
+    }
+    *out = arrow::RecordBatch::Make(schema_, out_length, std::move(columns));
+    return arrow::Status::OK();
+  }
+
+ private:
+  // Join the rows so far with the matches of the n-th dimension probed, positions_ and
+  // ids_, one row per match, the rows without match kept with a null build row if
+  // outer, dropped otherwise
+  void Expand(size_t n, bool outer) {
+    auto d = probe_order_[n];
+    next_rows_.clear();
+    for (size_t m = 0; m <= n; m++) {
+      next_build_ids_[probe_order_[m]].clear();
+      next_build_valid_[probe_order_[m]].clear();
+    }
+    auto append = [&](size_t k, uint64_t id, uint8_t valid) {
+      next_rows_.push_back(rows_[k]);
+      for (size_t m = 0; m < n; m++) {
+        auto prev = probe_order_[m];
+        next_build_ids_[prev].push_back(build_ids_[prev][k]);
+        next_build_valid_[prev].push_back(build_valid_[prev][k]);
+      }
+      next_build_ids_[d].push_back(id);
+      next_build_valid_[d].push_back(valid);
+    };
+    size_t match = 0;
+    for (size_t k = 0; k < rows_.size(); k++) {
+      bool matched = false;
+      for (; match < positions_.size() && positions_[match] == static_cast<int32_t>(k);
+           match++) {
+        append(k, ids_[match], 1);
+        matched = true;
+      }
+      if (!matched && outer) {
+        append(k, 0, 0);
+      }
+    }
+    rows_.swap(next_rows_);
+    for (size_t m = 0; m <= n; m++) {
+      auto probed = probe_order_[m];
+      build_ids_[probed].swap(next_build_ids_[probed]);
+      build_valid_[probed].swap(next_build_valid_[probed]);
+    }
+  }
+
+  arrow::MemoryPool* pool_;
+  std::shared_ptr<arrow::Schema> schema_;
+  std::vector<Dimension> dimensions_;
+  // dimension indices in probe order
+  std::vector<size_t> probe_order_;
+  // selection vectors of the output rows: the fact row, and the build row of each
+  // dimension with whether there is one
+  std::vector<int32_t> rows_;
+  std::vector<std::vector<uint64_t>> build_ids_;
+  std::vector<std::vector<uint8_t>> build_valid_;
+  // the matches of the last dimension probed, positions in rows_ and build rows
+  std::vector<int32_t> positions_;
+  std::vector<uint64_t> ids_;
+  std::vector<int32_t> next_rows_;
+  std::vector<std::vector<uint64_t>> next_build_ids_;
+  std::vector<std::vector<uint8_t>> next_build_valid_;
+};
+
+}  // namespace
+
+arrow::Status MakeStarJoinIterator(
+    arrow::MemoryPool* pool, const std::shared_ptr<arrow::Schema>& fact_schema,
+    std::vector<StarJoinDimension> dimensions,
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+  std::vector<StarJoinResultIterator::Dimension> probed;
+  std::vector<std::shared_ptr<arrow::Field>> fields = fact_schema->fields();
+  for (auto& dimension : dimensions) {
+    if (dimension.join_type != 0 && dimension.join_type != 1) {
+      return arrow::Status::NotImplemented("Star join of join type ",
+                                           dimension.join_type);
+    }
+    for (auto i : dimension.key_indices) {
+      if (i < 0 || i >= fact_schema->num_fields()) {
+        return arrow::Status::Invalid("Star join key ", i, " out of ",
+                                      fact_schema->num_fields(), " fact columns");
+      }
+    }
+    std::shared_ptr<JoinProbe> probe;
+    RETURN_NOT_OK(dimension.build->GetJoinProbe(&probe));
+    for (const auto& field : probe->build_fields()) {
+      fields.push_back(field);
+    }
+    probed.push_back({std::move(dimension), std::move(probe)});
+  }
+  *out = std::make_shared<StarJoinResultIterator>(pool, arrow::schema(fields),
+                                                  std::move(probed));
+  return arrow::Status::OK();
+}
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
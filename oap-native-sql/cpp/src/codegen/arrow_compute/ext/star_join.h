@@ -0,0 +1,64 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/record_batch.h>
+#include <arrow/status.h>
+#include <arrow/type.h>
+
+#include <memory>
+#include <vector>
+
+#include "codegen/common/result_iterator.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+namespace arrowcompute {
+namespace extra {
+
+/// A dimension of a star join: the result iterator of its built join, e.g. one attached
+/// to a shared broadcast build, whose probe side keys are the fact columns at
+/// key_indices
+struct StarJoinDimension {
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> build;
+  /// 0 for an inner join, 1 for an outer one keeping the unmatched fact rows, as the
+  /// join types of ConditionedProbeArraysKernel
+  int join_type = 0;
+  std::vector<int> key_indices;
+};
+
+/// \brief Iterator joining each fact batch passed to Process with all the dimensions at
+/// once, instead of through a chain of joins materializing a batch each
+///
+/// The fact rows are probed against the dimensions one after the other, through the
+/// JoinProbe of their builds, by a selection vector of the joined rows so far: a row
+/// missing an inner dimension is dropped and not looked up in the next ones, the inner
+/// dimensions going first. The output, the fact columns followed by the build columns
+/// of each dimension, is gathered once at the end. The matches of a batch aren't split,
+/// so dimension keys of many build rows make large output batches. Fails for a
+/// dimension whose join has no JoinProbe, e.g. one with a condition.
+arrow::Status MakeStarJoinIterator(
+    arrow::MemoryPool* pool, const std::shared_ptr<arrow::Schema>& fact_schema,
+    std::vector<StarJoinDimension> dimensions,
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out);
+
+}  // namespace extra
+}  // namespace arrowcompute
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -41,6 +41,10 @@ class TypedActionCodeGenImpl {
     action_name_ = action_name;
     return arrow::Status::OK();
   }
+  arrow::Status SetResultType(std::shared_ptr<arrow::DataType> res_type) {
+    res_type_ = res_type;
+    return arrow::Status::OK();
+  }
   arrow::Status SetInputList(std::vector<std::string> var_list) {
     input_list_ = var_list;
     return arrow::Status::OK();
@@ -102,7 +106,7 @@ class TypedActionCodeGenImpl {
       }
       *action_codegen = std::make_shared<SumActionCodeGen>(
           name, child_list_, input_list_, input_fields_list_, codes_ss_.str(),
-          named_projector_);
+          named_projector_, res_type_);
 
     } else if (action_name_.compare("action_count") == 0) {
       std::string name;
@@ -170,6 +174,7 @@ class TypedActionCodeGenImpl {
   std::vector<std::string> input_list_;
   std::vector<std::string> child_list_;
   std::string action_name_;
+  std::shared_ptr<arrow::DataType> res_type_;
   std::shared_ptr<gandiva::Expression> named_projector_;
   gandiva::NodePtr func_node_;
 };
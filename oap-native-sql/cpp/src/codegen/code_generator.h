@@ -21,6 +21,7 @@
 #include <arrow/type.h>
 #include <gandiva/expression.h>
 #include <gandiva/node.h>
+#include "codegen/common/kernel_metrics.h"
 #include "codegen/common/result_iterator.h"
 namespace sparkcolumnarplugin {
 namespace codegen {
@@ -53,6 +54,10 @@ class CodeGenerator {
     return arrow::Status::NotImplemented(
         "evaluate with selection array is not Implemented.");
   }
+  /// Counters of the kernels of this generator, see KernelMetrics
+  virtual arrow::Status GetMetrics(std::vector<KernelMetrics>* out) {
+    return arrow::Status::NotImplemented("GetMetrics is not Implemented.");
+  }
   virtual std::string ToString() { return ""; }
 };
 }  // namespace codegen
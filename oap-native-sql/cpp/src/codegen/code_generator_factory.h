@@ -15,6 +15,7 @@
  * limitations under the License.
  */
 
+#include <arrow/memory_pool.h>
 #include <arrow/type.h>
 #include <gandiva/expression.h>
 
@@ -26,20 +27,24 @@
 
 namespace sparkcolumnarplugin {
 namespace codegen {
+/// The kernels of arrow compute expressions allocate from pool, the memory pool of the
+/// task
 arrow::Status CreateCodeGenerator(
     std::shared_ptr<arrow::Schema> schema_ptr,
     std::vector<std::shared_ptr<::gandiva::Expression>> exprs_vector,
     std::vector<std::shared_ptr<arrow::Field>> ret_types,
     std::shared_ptr<CodeGenerator>* out, bool return_when_finish = false,
     std::vector<std::shared_ptr<::gandiva::Expression>> finish_exprs_vector =
-        std::vector<std::shared_ptr<::gandiva::Expression>>()) {
+        std::vector<std::shared_ptr<::gandiva::Expression>>(),
+    arrow::MemoryPool* pool = arrow::default_memory_pool()) {
   ExprVisitor nodeVisitor;
   int codegen_type;
   auto status = nodeVisitor.create(exprs_vector, &codegen_type);
   switch (codegen_type) {
     case ARROW_COMPUTE:
       *out = std::make_shared<arrowcompute::ArrowComputeCodeGenerator>(
-          schema_ptr, exprs_vector, ret_types, return_when_finish, finish_exprs_vector);
+          schema_ptr, exprs_vector, ret_types, return_when_finish, finish_exprs_vector,
+          pool);
       break;
     case GANDIVA:
       *out = std::make_shared<gandiva::GandivaCodeGenerator>(
@@ -0,0 +1,236 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/status.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "codegen/common/result_iterator.h"
+
+/// \brief Iterator producing the batches of upstream on a thread of its own, up to
+/// capacity batches ahead of its consumer
+///
+/// The producer starts with the first HasNext or Next, so that Next returns right away
+/// once the consumer is slower than upstream, e.g. a sort or a join output read by the
+/// JVM. Until then the other calls go to upstream as is, an iterator fed by Process
+/// never starts one. An error of upstream is returned by the Next it would have
+/// produced. Once the rows of SetLimit are consumed the producer is stopped, after the
+/// batch it is producing, if any, and upstream is told.
+template <typename T>
+class AsyncResultIterator : public ResultIterator<T> {
+ public:
+  AsyncResultIterator(std::shared_ptr<ResultIterator<T>> upstream, int capacity)
+      : upstream_(std::move(upstream)), capacity_(capacity > 0 ? capacity : 1) {}
+
+  ~AsyncResultIterator() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    not_full_.notify_all();
+    // the batch being produced, if any, is finished first
+    if (producer_.joinable()) {
+      producer_.join();
+    }
+  }
+
+  bool HasNext() override {
+    if (remaining_ == 0) {
+      return false;
+    }
+    Start();
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !queue_.empty() || finished_; });
+    return !queue_.empty();
+  }
+
+  arrow::Status Next(std::shared_ptr<T>* out) override {
+    if (remaining_ == 0) {
+      return arrow::Status::Invalid("AsyncResultIterator Next() is past its limit");
+    }
+    Start();
+    Produced produced;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_empty_.wait(lock, [this] { return !queue_.empty() || finished_; });
+      if (queue_.empty()) {
+        return arrow::Status::Invalid("AsyncResultIterator Next() has no more batches");
+      }
+      produced = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    not_full_.notify_one();
+    RETURN_NOT_OK(produced.status);
+    *out = std::move(produced.batch);
+    if (remaining_ > 0) {
+      if ((*out)->num_rows() > remaining_) {
+        *out = (*out)->Slice(0, remaining_);
+      }
+      remaining_ -= (*out)->num_rows();
+      if (remaining_ == 0) {
+        Stop();
+      }
+    }
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Process(const std::vector<std::shared_ptr<arrow::Array>>& in,
+                        std::shared_ptr<T>* out,
+                        const std::shared_ptr<arrow::Array>& selection) override {
+    RETURN_NOT_OK(CheckNotStarted());
+    return upstream_->Process(in, out, selection);
+  }
+
+  arrow::Status ProcessRemaining(std::shared_ptr<T>* out) override {
+    RETURN_NOT_OK(CheckNotStarted());
+    return upstream_->ProcessRemaining(out);
+  }
+
+  arrow::Status ProcessAndCacheOne(
+      const std::vector<std::shared_ptr<arrow::Array>>& in,
+      const std::shared_ptr<arrow::Array>& selection) override {
+    RETURN_NOT_OK(CheckNotStarted());
+    return upstream_->ProcessAndCacheOne(in, selection);
+  }
+
+  arrow::Status GetResult(std::shared_ptr<arrow::RecordBatch>* out) override {
+    RETURN_NOT_OK(CheckNotStarted());
+    return upstream_->GetResult(out);
+  }
+
+  arrow::Status GetRuntimeFilter(
+      std::shared_ptr<sparkcolumnarplugin::codegen::RuntimeFilter>* out) override {
+    RETURN_NOT_OK(CheckNotStarted());
+    return upstream_->GetRuntimeFilter(out);
+  }
+
+  arrow::Status GetJoinProbe(
+      std::shared_ptr<sparkcolumnarplugin::codegen::JoinProbe>* out) override {
+    RETURN_NOT_OK(CheckNotStarted());
+    return upstream_->GetJoinProbe(out);
+  }
+
+  void SetLimit(int64_t limit) override {
+    if (remaining_ >= 0 && remaining_ <= limit) {
+      return;
+    }
+    remaining_ = limit;
+    if (!started_) {
+      upstream_->SetLimit(limit);
+    } else if (limit == 0) {
+      Stop();
+    }
+    // else the batches queued count, upstream is told once they reach the limit
+  }
+
+  std::string ToString() override {
+    return "AsyncResultIterator(" + upstream_->ToString() + ")";
+  }
+
+ private:
+  struct Produced {
+    arrow::Status status;
+    std::shared_ptr<T> batch;
+  };
+
+  // called by the consumer only
+  void Start() {
+    if (!started_) {
+      started_ = true;
+      producer_ = std::thread(&AsyncResultIterator::Produce, this);
+    }
+  }
+
+  // called by the consumer only, once it is done
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    not_full_.notify_all();
+    if (producer_.joinable()) {
+      producer_.join();
+    }
+    queue_.clear();
+    upstream_->SetLimit(0);
+  }
+
+  arrow::Status CheckNotStarted() {
+    if (started_) {
+      return arrow::Status::Invalid(
+          "AsyncResultIterator can't be processed once it is iterated");
+    }
+    return arrow::Status::OK();
+  }
+
+  void Produce() {
+    while (true) {
+      {
+        // wait for room first, so that no more than capacity_ batches are held
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] {
+          return static_cast<int>(queue_.size()) < capacity_ || stopped_;
+        });
+        if (stopped_) {
+          break;
+        }
+      }
+      if (!upstream_->HasNext()) {
+        break;
+      }
+      Produced produced;
+      produced.status = upstream_->Next(&produced.batch);
+      bool failed = !produced.status.ok();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(produced));
+      }
+      not_empty_.notify_one();
+      if (failed) {
+        break;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finished_ = true;
+    }
+    not_empty_.notify_all();
+  }
+
+  std::shared_ptr<ResultIterator<T>> upstream_;
+  const int capacity_;
+  bool started_ = false;
+  std::thread producer_;
+  // rows the consumer takes at most, -1 if unlimited
+  int64_t remaining_ = -1;
+
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<Produced> queue_;
+  bool finished_ = false;
+  bool stopped_ = false;
+};
@@ -0,0 +1,147 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codegen/common/gandiva_cache.h"
+
+#include <cstdlib>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+namespace {
+
+int64_t GetGandivaCacheSize() {
+  const char* env_size = std::getenv("NATIVESQL_GANDIVA_CACHE_SIZE");
+  if (env_size == nullptr) {
+    return 256;
+  }
+  int64_t size = std::atoll(env_size);
+  return size > 0 ? size : 0;
+}
+
+// the projectors and filters by key, the most recently used first in lru
+struct Entry {
+  std::shared_ptr<void> value;
+  std::list<std::string>::iterator lru_position;
+};
+
+std::mutex cache_mutex;
+std::list<std::string> lru;
+std::unordered_map<std::string, Entry> cache;
+GandivaCacheMetrics metrics;
+
+// Expressions print with their field names and types, so the same prints are the same
+// expressions over the same schema
+std::string MakeKey(const char* kind, const arrow::Schema& schema,
+                    const std::string& exprs,
+                    const gandiva::Configuration& configuration) {
+  return std::string(kind) + "|" + schema.ToString() + "|" + exprs + "|" +
+         std::to_string(configuration.Hash());
+}
+
+std::shared_ptr<void> Lookup(const std::string& key) {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    ++metrics.misses;
+    return nullptr;
+  }
+  ++metrics.hits;
+  lru.splice(lru.begin(), lru, it->second.lru_position);
+  return it->second.value;
+}
+
+// Insert value built for key unless another task did meanwhile, return the one cached
+std::shared_ptr<void> Insert(const std::string& key, std::shared_ptr<void> value) {
+  static const int64_t capacity = GetGandivaCacheSize();
+  if (capacity == 0) {
+    return value;
+  }
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    return it->second.value;
+  }
+  while (static_cast<int64_t>(cache.size()) >= capacity) {
+    cache.erase(lru.back());
+    lru.pop_back();
+    ++metrics.evictions;
+  }
+  lru.push_front(key);
+  cache.emplace(key, Entry{value, lru.begin()});
+  return value;
+}
+
+}  // namespace
+
+arrow::Status MakeCachedProjector(std::shared_ptr<arrow::Schema> schema,
+                                  const gandiva::ExpressionVector& exprs,
+                                  std::shared_ptr<gandiva::Configuration> configuration,
+                                  std::shared_ptr<gandiva::Projector>* out) {
+  std::string exprs_str;
+  for (const auto& expr : exprs) {
+    exprs_str += expr->ToString() + " as " + expr->result()->ToString() + ";";
+  }
+  auto key = MakeKey("projector", *schema, exprs_str, *configuration);
+  auto cached = Lookup(key);
+  if (cached != nullptr) {
+    *out = std::static_pointer_cast<gandiva::Projector>(cached);
+    return arrow::Status::OK();
+  }
+  // built out of the lock, tasks building others don't wait for LLVM
+  std::shared_ptr<gandiva::Projector> projector;
+  RETURN_NOT_OK(gandiva::Projector::Make(schema, exprs, configuration, &projector));
+  *out = std::static_pointer_cast<gandiva::Projector>(Insert(key, projector));
+  return arrow::Status::OK();
+}
+
+arrow::Status MakeCachedFilter(std::shared_ptr<arrow::Schema> schema,
+                               gandiva::ConditionPtr condition,
+                               std::shared_ptr<gandiva::Configuration> configuration,
+                               std::shared_ptr<gandiva::Filter>* out) {
+  auto key = MakeKey("filter", *schema, condition->ToString(), *configuration);
+  auto cached = Lookup(key);
+  if (cached != nullptr) {
+    *out = std::static_pointer_cast<gandiva::Filter>(cached);
+    return arrow::Status::OK();
+  }
+  std::shared_ptr<gandiva::Filter> filter;
+  RETURN_NOT_OK(gandiva::Filter::Make(schema, condition, configuration, &filter));
+  *out = std::static_pointer_cast<gandiva::Filter>(Insert(key, filter));
+  return arrow::Status::OK();
+}
+
+GandivaCacheMetrics GetGandivaCacheMetrics() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  auto result = metrics;
+  result.size = cache.size();
+  return result;
+}
+
+void ClearGandivaCache() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  cache.clear();
+  lru.clear();
+}
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,65 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/status.h>
+#include <arrow/type.h>
+#include <gandiva/configuration.h>
+#include <gandiva/filter.h>
+#include <gandiva/projector.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+/// Same as gandiva::Projector::Make, but share the projector with the other tasks of
+/// this process building the same expressions over the same schema, so that each is
+/// compiled by LLVM once. The NATIVESQL_GANDIVA_CACHE_SIZE most recently used
+/// projectors and filters are kept.
+arrow::Status MakeCachedProjector(std::shared_ptr<arrow::Schema> schema,
+                                  const gandiva::ExpressionVector& exprs,
+                                  std::shared_ptr<gandiva::Configuration> configuration,
+                                  std::shared_ptr<gandiva::Projector>* out);
+
+/// Same as MakeCachedProjector, for gandiva::Filter::Make
+arrow::Status MakeCachedFilter(std::shared_ptr<arrow::Schema> schema,
+                               gandiva::ConditionPtr condition,
+                               std::shared_ptr<gandiva::Configuration> configuration,
+                               std::shared_ptr<gandiva::Filter>* out);
+
+/// Lookups in the projector and filter cache of this process
+struct GandivaCacheMetrics {
+  int64_t hits = 0;
+  /// built, as not in the cache
+  int64_t misses = 0;
+  /// dropped as least recently used, built again by their next lookup
+  int64_t evictions = 0;
+  /// projectors and filters in the cache
+  int64_t size = 0;
+};
+
+GandivaCacheMetrics GetGandivaCacheMetrics();
+
+/// Drop the projectors and filters of the cache, the ones in use stay alive until their
+/// last user is done
+void ClearGandivaCache();
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
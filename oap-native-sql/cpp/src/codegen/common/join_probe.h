@@ -0,0 +1,60 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/array.h>
+#include <arrow/status.h>
+#include <arrow/type.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+/// \brief The built side of a hash join, probed by a kernel other than the join's own,
+/// e.g. StarJoinResultIterator probing the dimension tables of a star join at once
+///
+/// Build rows are named by opaque ids, valid as long as the join's result iterator.
+/// Only the joins without a condition have one.
+class JoinProbe {
+ public:
+  virtual ~JoinProbe() = default;
+
+  /// Look up the probe rows at rows of the key columns keys, in the order of the
+  /// join's probe side keys. For each build row matching the key of rows[k], append k
+  /// to positions and the id of the build row to build_ids, the matches of a row one
+  /// after the other and the rows in their order. A null key matches no build row.
+  virtual arrow::Status Lookup(const std::vector<std::shared_ptr<arrow::Array>>& keys,
+                               const std::vector<int32_t>& rows,
+                               std::vector<int32_t>* positions,
+                               std::vector<uint64_t>* build_ids) = 0;
+
+  /// The build side columns the join outputs, in the order of its result schema
+  virtual std::vector<std::shared_ptr<arrow::Field>> build_fields() = 0;
+
+  /// Gather the build side columns of build_fields() at build_ids, null where valid is
+  /// 0. valid may be null if all ids are valid.
+  virtual arrow::Status Gather(const std::vector<uint64_t>& build_ids,
+                               const uint8_t* valid,
+                               std::vector<std::shared_ptr<arrow::Array>>* out) = 0;
+};
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
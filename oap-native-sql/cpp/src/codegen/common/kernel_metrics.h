@@ -0,0 +1,46 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+/// \brief Runtime counters of a kernel, read by the plan through
+/// ExpressionEvaluator.getMetrics for the Spark UI
+struct KernelMetrics {
+  std::string name;
+  /// time in the kernel, waiting for its compilation excluded
+  int64_t evaluate_nanos = 0;
+  int64_t num_input_rows = 0;
+  int64_t num_output_rows = 0;
+  /// keys of the hash table of a join or groups of an aggregation
+  int64_t hash_table_size = 0;
+  /// slots probed to find each key of the hash table summed over them, so that the
+  /// average probe chain length is probe_chain_length / hash_table_size
+  int64_t probe_chain_length = 0;
+  /// bytes written to local disk when the kernel went over its memory budget
+  int64_t spill_bytes = 0;
+  /// time waiting for the generated codes of the kernel to be compiled or loaded
+  int64_t codegen_nanos = 0;
+};
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
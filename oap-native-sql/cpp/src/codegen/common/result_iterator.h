@@ -21,6 +21,13 @@
 #include <arrow/status.h>
 #include <arrow/type_fwd.h>
 
+namespace sparkcolumnarplugin {
+namespace codegen {
+class JoinProbe;
+class RuntimeFilter;
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
+
 template <typename T>
 class ResultIterator {
  public:
@@ -33,6 +40,13 @@ class ResultIterator {
       const std::shared_ptr<arrow::Array>& selection = nullptr) {
     return arrow::Status::NotImplemented("ResultIterator abstract Process()");
   }
+  /// Output rows of the last Process input left over to bound the batches, e.g. the
+  /// matches of the hot keys of a join. Sets out to null once there is none left; call
+  /// until then before the next Process, while the last input is still valid.
+  virtual arrow::Status ProcessRemaining(std::shared_ptr<T>* out) {
+    *out = nullptr;
+    return arrow::Status::OK();
+  }
   virtual arrow::Status ProcessAndCacheOne(
       const std::vector<std::shared_ptr<arrow::Array>>& in,
       const std::shared_ptr<arrow::Array>& selection = nullptr) {
@@ -41,5 +55,22 @@ class ResultIterator {
   virtual arrow::Status GetResult(std::shared_ptr<arrow::RecordBatch>* out) {
     return arrow::Status::NotImplemented("ResultIterator abstract GetResult()");
   }
+  /// Filter of the build side keys of a join, for the probe side scan
+  virtual arrow::Status GetRuntimeFilter(
+      std::shared_ptr<sparkcolumnarplugin::codegen::RuntimeFilter>* out) {
+    return arrow::Status::NotImplemented("ResultIterator abstract GetRuntimeFilter()");
+  }
+  /// Build side of a join for a kernel probing it together with other joins, see
+  /// JoinProbe, valid as long as this iterator
+  virtual arrow::Status GetJoinProbe(
+      std::shared_ptr<sparkcolumnarplugin::codegen::JoinProbe>* out) {
+    return arrow::Status::NotImplemented("ResultIterator abstract GetJoinProbe()");
+  }
+  /// Signals that no more than limit further rows will be consumed, 0 once the consumer
+  /// is done, e.g. when a LIMIT downstream is satisfied. The iterator may then stop
+  /// producing, HasNext returning false past the limit, release the inputs it caches
+  /// and stop its background work, and passes the signal on to the iterators it reads
+  /// from. Called by the consumer, a smaller limit than a previous one only counts.
+  virtual void SetLimit(int64_t limit) {}
   virtual std::string ToString() { return ""; }
 };
@@ -0,0 +1,63 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codegen/common/runtime_filter.h"
+
+#include <cstring>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+namespace {
+
+constexpr int64_t kHeaderSize = 3 * sizeof(int64_t);
+
+}  // namespace
+
+std::string RuntimeFilter::Serialize() const {
+  std::string out(kHeaderSize + blocks_.size() * sizeof(uint32_t), '\0');
+  int64_t header[] = {min_, max_, num_blocks_};
+  std::memcpy(&out[0], header, kHeaderSize);
+  std::memcpy(&out[kHeaderSize], blocks_.data(), blocks_.size() * sizeof(uint32_t));
+  return out;
+}
+
+arrow::Result<std::shared_ptr<RuntimeFilter>> RuntimeFilter::Deserialize(
+    const uint8_t* data, int64_t size) {
+  if (size < kHeaderSize) {
+    return arrow::Status::Invalid("Runtime filter of ", size, " bytes is truncated");
+  }
+  int64_t header[3];
+  std::memcpy(header, data, kHeaderSize);
+  auto num_blocks = header[2];
+  if (num_blocks <= 0 ||
+      size != kHeaderSize + num_blocks * kWordsPerBlock *
+                                static_cast<int64_t>(sizeof(uint32_t))) {
+    return arrow::Status::Invalid("Runtime filter of ", size, " bytes has ", num_blocks,
+                                  " blocks");
+  }
+  auto filter = std::make_shared<RuntimeFilter>(0);
+  filter->min_ = header[0];
+  filter->max_ = header[1];
+  filter->num_blocks_ = num_blocks;
+  filter->blocks_.resize(num_blocks * kWordsPerBlock);
+  std::memcpy(filter->blocks_.data(), data + kHeaderSize, size - kHeaderSize);
+  return filter;
+}
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,120 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/result.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+/// \brief Filter of the keys of a join build side, to prune probe side rows before they
+/// reach the join
+///
+/// A blocked Bloom filter, each key setting 8 bits of a single 256 bit block so that a
+/// lookup touches one cache line, plus the range of the keys for pruning row groups by
+/// their statistics. Keys are 64 bit integers. False positives are possible, false
+/// negatives are not.
+class RuntimeFilter {
+ public:
+  /// \param num_keys expected number of distinct keys, sizes the filter to 16 bits per
+  /// key, about a 0.1% false positive rate
+  explicit RuntimeFilter(int64_t num_keys)
+      : num_blocks_(std::max<int64_t>(1, (num_keys * 16 + kBlockBits - 1) / kBlockBits)),
+        blocks_(num_blocks_ * kWordsPerBlock, 0) {}
+
+  void Insert(int64_t key) {
+    auto hash = Hash(key);
+    auto block = &blocks_[BlockIndex(hash) * kWordsPerBlock];
+    for (int i = 0; i < kWordsPerBlock; ++i) {
+      block[i] |= BitMask(hash, i);
+    }
+    min_ = std::min(min_, key);
+    max_ = std::max(max_, key);
+  }
+
+  bool MightContain(int64_t key) const {
+    if (key < min_ || key > max_) {
+      return false;
+    }
+    auto hash = Hash(key);
+    auto block = &blocks_[BlockIndex(hash) * kWordsPerBlock];
+    for (int i = 0; i < kWordsPerBlock; ++i) {
+      auto mask = BitMask(hash, i);
+      if ((block[i] & mask) != mask) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// False if no key lies in [min, max]
+  bool MightOverlap(int64_t min, int64_t max) const { return min <= max_ && max >= min_; }
+
+  /// Both are reversed, min > max, if no key was inserted
+  int64_t min() const { return min_; }
+  int64_t max() const { return max_; }
+
+  /// Little endian min, max, number of blocks, then the blocks as 32 bit words
+  std::string Serialize() const;
+
+  static arrow::Result<std::shared_ptr<RuntimeFilter>> Deserialize(const uint8_t* data,
+                                                                 int64_t size);
+
+ private:
+  static constexpr int kWordsPerBlock = 8;
+  static constexpr int64_t kBlockBits = kWordsPerBlock * 32;
+
+  static uint64_t Hash(int64_t key) {
+    // murmur3 finalizer
+    auto h = static_cast<uint64_t>(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // the high half of the hash picks the block, the low half the bits in it
+  int64_t BlockIndex(uint64_t hash) const {
+    auto num_blocks = static_cast<uint64_t>(num_blocks_);
+    return static_cast<int64_t>(((hash >> 32) * num_blocks) >> 32);
+  }
+
+  static uint32_t BitMask(uint64_t hash, int word) {
+    static constexpr uint32_t kSalts[kWordsPerBlock] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+    return 1U << ((static_cast<uint32_t>(hash) * kSalts[word]) >> 27);
+  }
+
+  int64_t num_blocks_;
+  std::vector<uint32_t> blocks_;
+  int64_t min_ = std::numeric_limits<int64_t>::max();
+  int64_t max_ = std::numeric_limits<int64_t>::min();
+};
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,326 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codegen/common/string_predicates.h"
+
+#include <arrow/util/bit_util.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+namespace {
+
+using FindFunc = int64_t (*)(const char* haystack, int64_t haystack_length,
+                             const char* needle, int64_t needle_length);
+
+bool BytesEqual(const char* a, const char* b, int64_t length) {
+  return length == 0 || memcmp(a, b, length) == 0;
+}
+
+int64_t FindScalar(const char* haystack, int64_t haystack_length, const char* needle,
+                   int64_t needle_length) {
+  if (needle_length == 0) {
+    return 0;
+  }
+  if (needle_length > haystack_length) {
+    return -1;
+  }
+  auto last_start = haystack + haystack_length - needle_length;
+  for (auto p = haystack; p <= last_start; ++p) {
+    p = static_cast<const char*>(memchr(p, needle[0], last_start - p + 1));
+    if (p == nullptr) {
+      return -1;
+    }
+    if (BytesEqual(p + 1, needle + 1, needle_length - 1)) {
+      return p - haystack;
+    }
+  }
+  return -1;
+}
+
+#if defined(__x86_64__)
+
+// A block is 16 or 32 candidate starts, whose first bytes are compared with the first
+// byte of needle and whose last bytes, needle_length - 1 further, with its last one.
+// The starts of the last block that would read past haystack are left to scalar code.
+
+int64_t FindSse2(const char* haystack, int64_t haystack_length, const char* needle,
+                 int64_t needle_length) {
+  if (needle_length < 2 || needle_length > haystack_length) {
+    return FindScalar(haystack, haystack_length, needle, needle_length);
+  }
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+  int64_t i = 0;
+  for (; i + needle_length - 1 + 16 <= haystack_length; i += 16) {
+    auto block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i));
+    auto block_last = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(haystack + i + needle_length - 1));
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))));
+    while (mask != 0) {
+      auto bit = __builtin_ctz(mask);
+      if (BytesEqual(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+        return i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+  auto found = FindScalar(haystack + i, haystack_length - i, needle, needle_length);
+  return found < 0 ? -1 : i + found;
+}
+
+__attribute__((target("avx2"))) int64_t FindAvx2(const char* haystack,
+                                                 int64_t haystack_length,
+                                                 const char* needle,
+                                                 int64_t needle_length) {
+  if (needle_length < 2 || needle_length > haystack_length) {
+    return FindScalar(haystack, haystack_length, needle, needle_length);
+  }
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+  int64_t i = 0;
+  for (; i + needle_length - 1 + 32 <= haystack_length; i += 32) {
+    auto block_first =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(haystack + i));
+    auto block_last = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(haystack + i + needle_length - 1));
+    auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last))));
+    while (mask != 0) {
+      auto bit = __builtin_ctz(mask);
+      if (BytesEqual(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+        return i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+  auto found = FindSse2(haystack + i, haystack_length - i, needle, needle_length);
+  return found < 0 ? -1 : i + found;
+}
+
+FindFunc DetectFind() {
+  return __builtin_cpu_supports("avx2") ? FindAvx2 : FindSse2;
+}
+
+#else
+
+FindFunc DetectFind() { return FindScalar; }
+
+#endif
+
+// Bytes of the UTF-8 character starting with byte, 1 for an invalid one
+int64_t CharLength(char byte) {
+  auto b = static_cast<uint8_t>(byte);
+  return b < 0xC0 ? 1 : b < 0xE0 ? 2 : b < 0xF0 ? 3 : 4;
+}
+
+}  // namespace
+
+int64_t FindSubstring(const char* haystack, int64_t haystack_length, const char* needle,
+                      int64_t needle_length) {
+  static const FindFunc find = DetectFind();
+  return find(haystack, haystack_length, needle, needle_length);
+}
+
+constexpr int StringPredicate::kAnyChar;
+constexpr int StringPredicate::kAnyString;
+
+bool StringPredicate::GetKind(const std::string& function_name, Kind* out) {
+  if (function_name == "equal") {
+    *out = Kind::EQUAL;
+  } else if (function_name == "starts_with") {
+    *out = Kind::STARTS_WITH;
+  } else if (function_name == "ends_with") {
+    *out = Kind::ENDS_WITH;
+  } else if (function_name == "is_substr") {
+    *out = Kind::CONTAINS;
+  } else if (function_name == "like") {
+    *out = Kind::LIKE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+StringPredicate::StringPredicate(Kind kind, std::string pattern) {
+  switch (kind) {
+    case Kind::EQUAL:
+      pieces_ = {std::move(pattern)};
+      break;
+    case Kind::STARTS_WITH:
+      pieces_ = {std::move(pattern), ""};
+      break;
+    case Kind::ENDS_WITH:
+      pieces_ = {"", std::move(pattern)};
+      break;
+    case Kind::CONTAINS:
+      pieces_ = {"", std::move(pattern), ""};
+      break;
+    case Kind::LIKE: {
+      std::string piece;
+      for (size_t i = 0; i < pattern.size(); ++i) {
+        auto c = pattern[i];
+        if (c == '\\' && i + 1 < pattern.size()) {
+          c = pattern[++i];
+        } else if (c == '%') {
+          pieces_.push_back(std::move(piece));
+          piece.clear();
+          tokens_.push_back(kAnyString);
+          continue;
+        } else if (c == '_') {
+          wildcards_ = true;
+          tokens_.push_back(kAnyChar);
+          continue;
+        }
+        piece += c;
+        tokens_.push_back(static_cast<uint8_t>(c));
+      }
+      pieces_.push_back(std::move(piece));
+      if (!wildcards_) {
+        tokens_.clear();
+      }
+      break;
+    }
+  }
+  // the empty pieces between two % match anything
+  if (pieces_.size() > 2) {
+    auto last = std::move(pieces_.back());
+    pieces_.pop_back();
+    std::vector<std::string> pieces = {std::move(pieces_[0])};
+    for (size_t p = 1; p < pieces_.size(); ++p) {
+      if (!pieces_[p].empty()) {
+        pieces.push_back(std::move(pieces_[p]));
+      }
+    }
+    pieces.push_back(std::move(last));
+    pieces_ = std::move(pieces);
+  }
+}
+
+bool StringPredicate::Match(arrow::util::string_view value) const {
+  auto length = static_cast<int64_t>(value.size());
+  return wildcards_ ? MatchWildcards(value.data(), length)
+                    : MatchPieces(value.data(), length);
+}
+
+bool StringPredicate::MatchPieces(const char* data, int64_t length) const {
+  const auto& first = pieces_.front();
+  if (pieces_.size() == 1) {
+    return length == static_cast<int64_t>(first.size()) &&
+           BytesEqual(data, first.data(), length);
+  }
+  const auto& last = pieces_.back();
+  auto begin = static_cast<int64_t>(first.size());
+  auto end = length - static_cast<int64_t>(last.size());
+  if (end < begin || !BytesEqual(data, first.data(), begin) ||
+      !BytesEqual(data + end, last.data(), length - end)) {
+    return false;
+  }
+  for (size_t p = 1; p + 1 < pieces_.size(); ++p) {
+    const auto& piece = pieces_[p];
+    auto piece_length = static_cast<int64_t>(piece.size());
+    auto found = FindSubstring(data + begin, end - begin, piece.data(), piece_length);
+    if (found < 0) {
+      return false;
+    }
+    begin += found + piece_length;
+  }
+  return true;
+}
+
+bool StringPredicate::MatchWildcards(const char* data, int64_t length) const {
+  // greedy, backtracking to the last % only: a % matches one more character each time
+  // the tokens after it fail
+  auto num_tokens = tokens_.size();
+  int64_t i = 0;
+  size_t t = 0;
+  int64_t star_i = -1;
+  size_t star_t = 0;
+  while (i < length) {
+    if (t < num_tokens && tokens_[t] == kAnyString) {
+      star_t = ++t;
+      star_i = i;
+    } else if (t < num_tokens && tokens_[t] == kAnyChar) {
+      i = std::min(length, i + CharLength(data[i]));
+      ++t;
+    } else if (t < num_tokens && tokens_[t] == static_cast<uint8_t>(data[i])) {
+      ++i;
+      ++t;
+    } else if (star_i >= 0) {
+      star_i = std::min(length, star_i + CharLength(data[star_i]));
+      i = star_i;
+      t = star_t;
+    } else {
+      return false;
+    }
+  }
+  while (t < num_tokens && tokens_[t] == kAnyString) {
+    ++t;
+  }
+  return t == num_tokens;
+}
+
+void StringPredicate::Evaluate(const arrow::BinaryArray& array, uint8_t* out) const {
+  auto length = array.length();
+  memset(out, 0, arrow::BitUtil::BytesForBits(length));
+  auto offsets = array.raw_value_offsets();
+  auto data = reinterpret_cast<const char*>(array.raw_data());
+  if (!IsContains()) {
+    for (int64_t i = 0; i < length; ++i) {
+      if (array.IsValid(i) && Match(array.GetView(i))) {
+        arrow::BitUtil::SetBit(out, i);
+      }
+    }
+    return;
+  }
+  // search the value data of all the rows, an occurrence across two rows is skipped
+  const auto& needle = pieces_[1];
+  auto needle_length = static_cast<int64_t>(needle.size());
+  int64_t pos = offsets[0];
+  int64_t end = offsets[length];
+  int64_t row = 0;
+  while (pos < end) {
+    auto found = FindSubstring(data + pos, end - pos, needle.data(), needle_length);
+    if (found < 0) {
+      break;
+    }
+    auto start = pos + found;
+    while (offsets[row + 1] <= start) {
+      ++row;
+    }
+    if (start + needle_length <= offsets[row + 1]) {
+      if (array.IsValid(row)) {
+        arrow::BitUtil::SetBit(out, row);
+      }
+      pos = offsets[row + 1];
+    } else {
+      pos = start + 1;
+    }
+  }
+}
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
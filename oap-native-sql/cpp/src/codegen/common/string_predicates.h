@@ -0,0 +1,83 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/array.h>
+#include <arrow/util/string_view.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+/// Position of the first occurrence of needle in haystack, -1 if none. Compares the
+/// first and the last byte of needle with 32 bytes of haystack at a time with AVX2, 16
+/// with SSE2, and checks the rest of needle at the candidates only.
+int64_t FindSubstring(const char* haystack, int64_t haystack_length, const char* needle,
+                      int64_t needle_length);
+
+/// \brief A predicate of strings against a constant pattern, as the gandiva functions
+/// equal, starts_with, ends_with, is_substr and like with a literal second operand
+///
+/// A like pattern, whose escape is a backslash, is split at its % into literal pieces:
+/// the first must start the string, the last end it and the others are searched in
+/// between in order. Patterns with _, which matches one UTF-8 character, are matched
+/// by backtracking instead.
+///
+/// Evaluate matches all the rows of a batch into a bitmap. A substring is searched
+/// through the value data of the batch as a whole rather than row by row, each
+/// occurrence found mapped to its row through the offsets, so that the rows without
+/// one cost nothing but the search.
+class StringPredicate {
+ public:
+  enum class Kind { EQUAL, STARTS_WITH, ENDS_WITH, CONTAINS, LIKE };
+
+  /// Kind of the gandiva function name, false if there is none
+  static bool GetKind(const std::string& function_name, Kind* out);
+
+  StringPredicate(Kind kind, std::string pattern);
+
+  bool Match(arrow::util::string_view value) const;
+
+  /// Set bit i of out to whether row i of array is valid and matches. out holds
+  /// array.length() bits.
+  void Evaluate(const arrow::BinaryArray& array, uint8_t* out) const;
+
+ private:
+  bool MatchPieces(const char* data, int64_t length) const;
+  bool MatchWildcards(const char* data, int64_t length) const;
+  // whether the predicate is a single piece searched anywhere in the string
+  bool IsContains() const {
+    return !wildcards_ && pieces_.size() == 3 && pieces_[0].empty() && pieces_[2].empty();
+  }
+
+  static constexpr int kAnyChar = -1;
+  static constexpr int kAnyString = -2;
+
+  // the pieces between the unescaped % of the pattern, a single one without %
+  std::vector<std::string> pieces_;
+  // whether the pattern has an unescaped _, and if so its bytes, kAnyChar for a _ and
+  // kAnyString for a %
+  bool wildcards_ = false;
+  std::vector<int> tokens_;
+};
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
@@ -15,6 +15,8 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <iostream>
 #include <memory>
@@ -25,13 +27,24 @@
 #include <arrow/io/interfaces.h>
 #include <arrow/record_batch.h>
 #include <arrow/table.h>
+#include <gandiva/condition.h>
 #include <parquet/arrow/reader.h>
 #include <parquet/arrow/schema.h>
 #include <parquet/arrow/writer.h>
+#include <parquet/column_writer.h>
+#include <parquet/exception.h>
 #include <parquet/file_reader.h>
 #include <parquet/file_writer.h>
 #include <parquet/schema.h>
+#include <parquet/statistics.h>
+#include "codegen/common/runtime_filter.h"
 #include "data_source/parquet/adapter.h"
+#include "data_source/parquet/chunk_cache.h"
+#include "data_source/parquet/late_materialized_reader.h"
+#include "data_source/parquet/parallel_row_group_reader.h"
+#include "data_source/parquet/prefetcher.h"
+#include "data_source/parquet/statistics_filter.h"
+#include "utils/task_scheduler.h"
 
 namespace jni {
 namespace parquet {
@@ -47,19 +60,131 @@ class ParquetFileReader::Impl {
 
   Status Open(std::shared_ptr<RandomAccessFile>& file, MemoryPool* pool,
               ::parquet::ArrowReaderProperties properties) {
-    file_ = file;
+    pool_ = pool;
+    batch_size_ = properties.batch_size();
+    properties_ = properties;
+    // the reads of the row groups prefetched are served from memory
+    file_ = std::make_shared<PrefetchedFile>(file);
     RETURN_NOT_OK(GetRowGroupOffset(file_));
     RETURN_NOT_OK(::parquet::arrow::FileReader::Make(
         pool, ::parquet::ParquetFileReader::Open(file_), properties, &parquet_reader_));
     return Status::OK();
   }
 
+  Status SetRuntimeFilter(
+      int column_index,
+      std::shared_ptr<sparkcolumnarplugin::codegen::RuntimeFilter> filter) {
+    auto metadata = parquet_reader_->parquet_reader()->metadata();
+    if (column_index < 0 || column_index >= metadata->num_columns()) {
+      return Status::Invalid("Runtime filter column ", column_index,
+                             " is out of the file columns");
+    }
+    filter_column_ = column_index;
+    runtime_filter_ = std::move(filter);
+    return Status::OK();
+  }
+
+  Status SetFilter(std::shared_ptr<gandiva::Condition> condition) {
+    if (condition == nullptr) {
+      return Status::Invalid("Filter condition must not be null");
+    }
+    statistics_filter_ = std::make_shared<StatisticsFilter>(condition->root());
+    return Status::OK();
+  }
+
+  Status SetRowFilter(std::shared_ptr<gandiva::Condition> condition) {
+    if (condition == nullptr) {
+      return Status::Invalid("Row filter condition must not be null");
+    }
+    row_filter_ = std::move(condition);
+    return Status::OK();
+  }
+
+  Status SetReadDictionary(const std::vector<int>& column_indices) {
+    auto metadata = parquet_reader_->parquet_reader()->metadata();
+    for (auto column_index : column_indices) {
+      if (column_index < 0 || column_index >= metadata->num_columns()) {
+        return Status::Invalid("Dictionary column ", column_index,
+                               " is out of the file columns");
+      }
+      properties_.set_read_dictionary(column_index, true);
+    }
+    // the properties are fixed at Make, the footer read by Open is reused
+    return ::parquet::arrow::FileReader::Make(
+        pool_,
+        ::parquet::ParquetFileReader::Open(file_, ::parquet::default_reader_properties(),
+                                           metadata),
+        properties_, &parquet_reader_);
+  }
+
+  Status SetPrefetch(int row_groups) {
+    if (row_groups < 0) {
+      return Status::Invalid("Row groups to prefetch must not be negative, got ",
+                             row_groups);
+    }
+    prefetch_row_groups_ = row_groups;
+    return Status::OK();
+  }
+
+  Status SetCoalescedReads(int64_t hole_size_limit, int64_t range_size_limit,
+                           int io_threads) {
+    if (hole_size_limit < 0 || range_size_limit <= 0 || io_threads <= 0) {
+      return Status::Invalid("Invalid coalesced reads, hole size limit ", hole_size_limit,
+                             ", range size limit ", range_size_limit, ", I/O threads ",
+                             io_threads);
+    }
+    coalesced_reads_ = true;
+    coalescing_.hole_size_limit = hole_size_limit;
+    coalescing_.range_size_limit = range_size_limit;
+    coalescing_.io_threads = io_threads;
+    return Status::OK();
+  }
+
+  Status SetChunkCache(const std::string& file_key) {
+    if (file_key.empty()) {
+      return Status::Invalid("Chunk cache key must not be empty");
+    }
+    if (ColumnChunkCacheCapacity() > 0) {
+      file_->SetChunkCache(file_key, *parquet_reader_->parquet_reader()->metadata());
+    }
+    return Status::OK();
+  }
+
   Status InitRecordBatchReader(const std::vector<int>& column_indices,
                                const std::vector<int>& row_group_indices) {
-    RETURN_NOT_OK(
-        GetRecordBatchReader(row_group_indices, column_indices, &record_batch_reader_));
+    auto pruned_row_group_indices = PruneRowGroups(row_group_indices);
+    if (row_filter_ != nullptr) {
+      auto status = LateMaterializedReader::Make(
+          parquet_reader_.get(), pool_, pruned_row_group_indices, column_indices,
+          row_filter_, batch_size_, &late_materialized_reader_);
+      if (status.ok()) {
+        schema_ = late_materialized_reader_->schema();
+        return Status::OK();
+      }
+      if (!status.IsNotImplemented()) {
+        return status;
+      }
+      // every row is read, the filter above the scan still drops them
+    }
+    if (coalesced_reads_ && prefetch_row_groups_ == 0) {
+      // the batch readers read the chunks of a row group through file_, which fetches
+      // them all at once
+      file_->SetCoalescedReads(parquet_reader_->parquet_reader()->metadata(),
+                               column_indices, coalescing_);
+    }
+    RETURN_NOT_OK(GetRecordBatchReader(pruned_row_group_indices, column_indices,
+                                       &record_batch_reader_));
+    if (prefetch_row_groups_ > 0) {
+      schema_ = record_batch_reader_->schema();
+      prefetcher_.reset(new RowGroupPrefetcher(parquet_reader_.get(), file_,
+                                               pruned_row_group_indices, column_indices,
+                                               prefetch_row_groups_, coalescing_));
+      return Status::OK();
+    }
     RETURN_NOT_OK(record_batch_reader_->ReadNext(&next_batch_));
-    schema_ = next_batch_->schema();
+    // no batch if every row group was pruned
+    schema_ = next_batch_ != nullptr ? next_batch_->schema()
+                                     : record_batch_reader_->schema();
     return Status::OK();
   }
 
@@ -79,6 +204,16 @@ class ParquetFileReader::Impl {
   }
 
   Status ReadNext(std::shared_ptr<RecordBatch>* out) {
+    if (stopped_) {
+      *out = nullptr;
+      return Status::OK();
+    }
+    if (late_materialized_reader_ != nullptr) {
+      return late_materialized_reader_->Next(out);
+    }
+    if (prefetcher_ != nullptr) {
+      return prefetcher_->Next(out);
+    }
     *out = next_batch_;
     auto status = record_batch_reader_->ReadNext(&next_batch_);
     if (!status.ok()) {
@@ -87,17 +222,89 @@ class ParquetFileReader::Impl {
     return Status::OK();
   }
 
+  void Stop() {
+    stopped_ = true;
+    prefetcher_ = nullptr;
+    late_materialized_reader_ = nullptr;
+    record_batch_reader_ = nullptr;
+    next_batch_ = nullptr;
+  }
+
  private:
-  std::shared_ptr<RandomAccessFile> file_;
+  MemoryPool* pool_;
+  int64_t batch_size_;
+  ::parquet::ArrowReaderProperties properties_;
+  std::shared_ptr<PrefetchedFile> file_;
   std::unique_ptr<::parquet::arrow::FileReader> parquet_reader_;
   std::shared_ptr<RecordBatchReader> record_batch_reader_;
   std::shared_ptr<RecordBatch> next_batch_;
   std::shared_ptr<Schema> schema_;
   std::vector<uint64_t> row_group_bytes_;
+  int filter_column_ = -1;
+  std::shared_ptr<sparkcolumnarplugin::codegen::RuntimeFilter> runtime_filter_;
+  std::shared_ptr<StatisticsFilter> statistics_filter_;
+  std::shared_ptr<gandiva::Condition> row_filter_;
+  std::unique_ptr<LateMaterializedReader> late_materialized_reader_;
+  int prefetch_row_groups_ = 0;
+  // the prefetcher always coalesces its reads, the batch readers only if set
+  bool coalesced_reads_ = false;
+  ReadCoalescing coalescing_;
+  // reads the batches in prefetch mode, stopped before parquet_reader_ is destroyed
+  std::unique_ptr<RowGroupPrefetcher> prefetcher_;
+  bool stopped_ = false;
+
+  // Drop the row groups whose filter column range doesn't overlap the runtime filter,
+  // or whose statistics don't satisfy the filter condition
+  std::vector<int> PruneRowGroups(const std::vector<int>& row_group_indices) {
+    if (runtime_filter_ == nullptr && statistics_filter_ == nullptr) {
+      return row_group_indices;
+    }
+    auto metadata = parquet_reader_->parquet_reader()->metadata();
+    std::vector<int> pruned;
+    for (auto i : row_group_indices) {
+      auto row_group = metadata->RowGroup(i);
+      if (runtime_filter_ != nullptr &&
+          !MightMatch(*row_group->ColumnChunk(filter_column_))) {
+        continue;
+      }
+      if (statistics_filter_ != nullptr && !statistics_filter_->MightMatch(*row_group)) {
+        continue;
+      }
+      pruned.push_back(i);
+    }
+    return pruned;
+  }
+
+  bool MightMatch(const ::parquet::ColumnChunkMetaData& column_chunk) {
+    auto stats = column_chunk.statistics();
+    if (stats == nullptr || !stats->HasMinMax()) {
+      return true;
+    }
+    switch (stats->physical_type()) {
+      case ::parquet::Type::INT32: {
+        auto typed = std::static_pointer_cast<::parquet::Int32Statistics>(stats);
+        return runtime_filter_->MightOverlap(typed->min(), typed->max());
+      }
+      case ::parquet::Type::INT64: {
+        auto typed = std::static_pointer_cast<::parquet::Int64Statistics>(stats);
+        return runtime_filter_->MightOverlap(typed->min(), typed->max());
+      }
+      default:
+        return true;
+    }
+  }
 
   Status GetRecordBatchReader(const std::vector<int>& row_group_indices,
                               const std::vector<int>& column_indices,
                               std::shared_ptr<RecordBatchReader>* rb_reader) {
+    // the batch reader of parquet-cpp decodes the columns serially whatever the threads
+    if (properties_.use_threads()) {
+      std::shared_ptr<ParallelRowGroupReader> reader;
+      RETURN_NOT_OK(ParallelRowGroupReader::Make(parquet_reader_.get(), row_group_indices,
+                                                 column_indices, batch_size_, &reader));
+      *rb_reader = std::move(reader);
+      return Status::OK();
+    }
     if (column_indices.empty()) {
       return parquet_reader_->GetRecordBatchReader(row_group_indices, rb_reader);
     } else {
@@ -153,6 +360,37 @@ Status ParquetFileReader::Open(std::shared_ptr<RandomAccessFile>& file, MemoryPo
   return Open(file, pool, properties, reader);
 }
 
+Status ParquetFileReader::SetRuntimeFilter(
+    int column_index,
+    std::shared_ptr<sparkcolumnarplugin::codegen::RuntimeFilter> filter) {
+  return impl_->SetRuntimeFilter(column_index, std::move(filter));
+}
+
+Status ParquetFileReader::SetFilter(std::shared_ptr<gandiva::Condition> condition) {
+  return impl_->SetFilter(std::move(condition));
+}
+
+Status ParquetFileReader::SetRowFilter(std::shared_ptr<gandiva::Condition> condition) {
+  return impl_->SetRowFilter(std::move(condition));
+}
+
+Status ParquetFileReader::SetReadDictionary(const std::vector<int>& column_indices) {
+  return impl_->SetReadDictionary(column_indices);
+}
+
+Status ParquetFileReader::SetPrefetch(int row_groups) {
+  return impl_->SetPrefetch(row_groups);
+}
+
+Status ParquetFileReader::SetCoalescedReads(int64_t hole_size_limit,
+                                            int64_t range_size_limit, int io_threads) {
+  return impl_->SetCoalescedReads(hole_size_limit, range_size_limit, io_threads);
+}
+
+Status ParquetFileReader::SetChunkCache(const std::string& file_key) {
+  return impl_->SetChunkCache(file_key);
+}
+
 Status ParquetFileReader::InitRecordBatchReader(
     const std::vector<int>& column_indices, const std::vector<int>& row_group_indices) {
   return impl_->InitRecordBatchReader(column_indices, row_group_indices);
@@ -171,6 +409,8 @@ Status ParquetFileReader::ReadNext(std::shared_ptr<RecordBatch>* out) {
   return impl_->ReadNext(out);
 }
 
+void ParquetFileReader::Stop() { impl_->Stop(); }
+
 class ParquetFileWriter::Impl {
  public:
   Impl() = default;
@@ -179,28 +419,54 @@ class ParquetFileWriter::Impl {
   Status Open(std::shared_ptr<OutputStream>& output_stream, MemoryPool* pool,
               std::shared_ptr<Schema> schema,
               std::shared_ptr<::parquet::ArrowWriterProperties> properties) {
+    pool_ = pool;
     output_stream_ = output_stream;
     schema_ = schema;
-    std::shared_ptr<::parquet::schema::GroupNode> parquet_schema;
-    RETURN_NOT_OK(GetParquetSchema(schema, &parquet_schema));
-    RETURN_NOT_OK(::parquet::arrow::FileWriter::Make(
-        pool, ::parquet::ParquetFileWriter::Open(output_stream, parquet_schema), schema,
-        properties, &parquet_writer_));
+    properties_ = properties;
+    RETURN_NOT_OK(GetParquetSchema(schema, &parquet_schema_));
+    // the column chunks of nested fields are written along their levels by WriteTable
+    for (const auto& field : schema->fields()) {
+      flat_schema_ &= field->type()->num_children() == 0;
+    }
+    return Status::OK();
+  }
+
+  Status SetParallelWrite(int num_threads, int64_t row_group_rows) {
+    if (num_threads <= 0) {
+      return Status::Invalid("Write threads must be positive, got ", num_threads);
+    }
+    if (row_group_rows < 0) {
+      return Status::Invalid("Row group rows must not be negative, got ",
+                             row_group_rows);
+    }
+    std::lock_guard<std::mutex> lck(thread_mtx_);
+    if (parquet_writer_ != nullptr || file_writer_ != nullptr) {
+      return Status::Invalid("Parallel write must be set before the first row group");
+    }
+    num_threads_ = num_threads;
+    row_group_rows_ = row_group_rows;
     return Status::OK();
   }
 
   Status WriteNext(std::shared_ptr<RecordBatch> in) {
     std::lock_guard<std::mutex> lck(thread_mtx_);
+    buffered_rows_ += in->num_rows();
     record_batch_buffer_list_.push_back(in);
+    if (row_group_rows_ > 0 && buffered_rows_ >= row_group_rows_) {
+      return WriteRowGroups(false);
+    }
     return Status::OK();
   }
 
   Status Flush() {
-    std::shared_ptr<Table> table;
-    RETURN_NOT_OK(Table::FromRecordBatches(record_batch_buffer_list_, &table));
-    auto stat = parquet_writer_->WriteTable(*table.get(), table->num_rows());
+    std::lock_guard<std::mutex> lck(thread_mtx_);
+    RETURN_NOT_OK(WriteRowGroups(true));
+    if (file_writer_ != nullptr) {
+      PARQUET_CATCH_NOT_OK(file_writer_->Close());
+    } else {
+      RETURN_NOT_OK(parquet_writer_->Close());
+    }
     RETURN_NOT_OK(output_stream_->Flush());
-    // RETURN_NOT_OK(stat);
     return Status::OK();
   }
 
@@ -212,10 +478,114 @@ class ParquetFileWriter::Impl {
  private:
   MemoryPool* pool_;
   std::shared_ptr<Schema> schema_;
+  std::shared_ptr<::parquet::schema::GroupNode> parquet_schema_;
+  std::shared_ptr<::parquet::ArrowWriterProperties> properties_;
+  bool flat_schema_ = true;
+  int num_threads_ = 1;
+  int64_t row_group_rows_ = 0;
   std::mutex thread_mtx_;
   std::shared_ptr<OutputStream> output_stream_;
+  // one of them is made on the first row group, file_writer_ if the column chunks are
+  // encoded in parallel
   std::unique_ptr<::parquet::arrow::FileWriter> parquet_writer_;
+  std::unique_ptr<::parquet::ParquetFileWriter> file_writer_;
   std::vector<std::shared_ptr<::arrow::RecordBatch>> record_batch_buffer_list_;
+  int64_t buffered_rows_ = 0;
+
+  Status StartFile() {
+    if (parquet_writer_ != nullptr || file_writer_ != nullptr) {
+      return Status::OK();
+    }
+    std::unique_ptr<::parquet::ParquetFileWriter> file_writer;
+    PARQUET_CATCH_NOT_OK(file_writer = ::parquet::ParquetFileWriter::Open(
+                             output_stream_, parquet_schema_));
+    if (num_threads_ > 1 && flat_schema_) {
+      file_writer_ = std::move(file_writer);
+      return Status::OK();
+    }
+    return ::parquet::arrow::FileWriter::Make(pool_, std::move(file_writer), schema_,
+                                              properties_, &parquet_writer_);
+  }
+
+  // Write the buffered rows as row groups of row_group_rows_, or of all of them if it
+  // is 0. The rows short of a row group are kept for the next batches unless flush.
+  Status WriteRowGroups(bool flush) {
+    RETURN_NOT_OK(StartFile());
+    std::shared_ptr<Table> table;
+    RETURN_NOT_OK(Table::FromRecordBatches(schema_, record_batch_buffer_list_, &table));
+    record_batch_buffer_list_.clear();
+    auto num_rows = table->num_rows();
+    auto chunk_rows = row_group_rows_ > 0 ? row_group_rows_ : num_rows;
+    int64_t offset = 0;
+    while (offset < num_rows && (flush || num_rows - offset >= chunk_rows)) {
+      auto length = std::min(chunk_rows, num_rows - offset);
+      RETURN_NOT_OK(WriteRowGroup(*table->Slice(offset, length)));
+      offset += length;
+    }
+    buffered_rows_ = num_rows - offset;
+    if (buffered_rows_ > 0) {
+      auto rest = table->Slice(offset);
+      arrow::TableBatchReader reader(*rest);
+      RETURN_NOT_OK(reader.ReadAll(&record_batch_buffer_list_));
+    }
+    return Status::OK();
+  }
+
+  // Encode and compress the column chunks of a row group on num_threads_ threads of the
+  // task scheduler into a buffered row group, whose chunks are then written in column
+  // order
+  Status WriteRowGroup(const Table& table) {
+    if (file_writer_ == nullptr) {
+      return parquet_writer_->WriteTable(table, table.num_rows());
+    }
+    ::parquet::RowGroupWriter* row_group;
+    PARQUET_CATCH_NOT_OK(row_group = file_writer_->AppendBufferedRowGroup());
+    auto num_columns = table.num_columns();
+    std::atomic<int> next_column{0};
+    std::vector<Status> statuses(num_columns);
+    auto encode = [&] {
+      // the context holds the scratch buffers of a thread
+      ::parquet::ArrowWriteContext ctx(pool_, properties_.get());
+      for (int i = next_column++; i < num_columns; i = next_column++) {
+        statuses[i] = WriteColumnChunk(*table.column(i), row_group->column(i), &ctx);
+      }
+    };
+    auto num_encoders = std::min(num_threads_, num_columns);
+    RETURN_NOT_OK(sparkcolumnarplugin::TaskScheduler::Global()->ParallelFor(
+        num_encoders, num_encoders, [&encode](int64_t) {
+          encode();
+          return Status::OK();
+        }));
+    for (const auto& status : statuses) {
+      RETURN_NOT_OK(status);
+    }
+    PARQUET_CATCH_NOT_OK(row_group->Close());
+    return Status::OK();
+  }
+
+  // Write a flat column, whose definition level is 1 for a valid value of a nullable
+  // column and its only level otherwise
+  static Status WriteColumnChunk(const arrow::ChunkedArray& column,
+                                 ::parquet::ColumnWriter* writer,
+                                 ::parquet::ArrowWriteContext* ctx) {
+    bool nullable = writer->descr()->max_definition_level() > 0;
+    std::vector<int16_t> def_levels;
+    for (const auto& chunk : column.chunks()) {
+      auto length = chunk->length();
+      if (nullable) {
+        def_levels.resize(length);
+        for (int64_t i = 0; i < length; ++i) {
+          def_levels[i] = chunk->IsValid(i) ? 1 : 0;
+        }
+      }
+      Status status;
+      PARQUET_CATCH_NOT_OK(status = writer->WriteArrow(
+                               nullable ? def_levels.data() : nullptr, nullptr, length,
+                               *chunk, ctx));
+      RETURN_NOT_OK(status);
+    }
+    return Status::OK();
+  }
 
   Status GetParquetSchema(std::shared_ptr<Schema> schema,
                           std::shared_ptr<::parquet::schema::GroupNode>* parquet_schema) {
@@ -259,6 +629,10 @@ Status ParquetFileWriter::Open(std::shared_ptr<OutputStream>& output_stream,
               writer);
 }
 
+Status ParquetFileWriter::SetParallelWrite(int num_threads, int64_t row_group_rows) {
+  return impl_->SetParallelWrite(num_threads, row_group_rows);
+}
+
 Status ParquetFileWriter::WriteNext(std::shared_ptr<RecordBatch> in) {
   return impl_->WriteNext(in);
 }
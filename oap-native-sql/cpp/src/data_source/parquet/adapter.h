@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "arrow/io/interfaces.h"
@@ -30,6 +31,16 @@
 #include "arrow/util/visibility.h"
 #include "parquet/properties.h"
 
+namespace gandiva {
+class Condition;
+}  // namespace gandiva
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+class RuntimeFilter;
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
+
 namespace jni {
 
 namespace parquet {
@@ -53,7 +64,8 @@ class ARROW_EXPORT ParquetFileReader {
   ///
   /// \param[in] file the data source
   /// \param[in] pool a MemoryPool to use for buffer allocations
-  /// \param[in] properties ArrowReaderProperties
+  /// \param[in] properties ArrowReaderProperties, use_threads decodes the columns of a
+  ///            row group in parallel on the arrow CPU thread pool
   /// \param[out] reader the returned reader object
   /// \return Status
   static Status Open(std::shared_ptr<RandomAccessFile>& file, MemoryPool* pool,
@@ -69,6 +81,66 @@ class ARROW_EXPORT ParquetFileReader {
   static Status Open(std::shared_ptr<RandomAccessFile>& file, MemoryPool* pool,
                      std::unique_ptr<ParquetFileReader>* reader);
 
+  /// \brief Skip the row groups whose statistics of a column don't overlap the range of
+  //          filter, must be called before InitRecordBatchReader.
+  ///
+  /// \param[in] column_index index of an integer column in the file
+  /// \param[in] filter filter of the join build side keys matched by the column
+  Status SetRuntimeFilter(
+      int column_index,
+      std::shared_ptr<sparkcolumnarplugin::codegen::RuntimeFilter> filter);
+
+  /// \brief Skip the row groups whose column chunk statistics show no row satisfies
+  //          condition, must be called before InitRecordBatchReader.
+  ///
+  /// \param[in] condition filter pushed down to the scan, its fields are the columns of
+  ///            the file by name
+  Status SetFilter(std::shared_ptr<gandiva::Condition> condition);
+
+  /// \brief Return only the rows satisfying condition, decoding its columns first and
+  //          the other columns only for the row groups with a matching row. Must be
+  //          called before InitRecordBatchReader, the row groups aren't prefetched then.
+  ///
+  /// \param[in] condition condition of the columns read by name, the rows are read as
+  ///            they are if it isn't a gandiva filter of them
+  Status SetRowFilter(std::shared_ptr<gandiva::Condition> condition);
+
+  /// \brief Read the dictionary-encoded pages of columns as arrow::DictionaryArray, so
+  //          that the kernels look their keys up once per dictionary. Must be called
+  //          before InitRecordBatchReader.
+  ///
+  /// \param[in] column_indices indices of the file columns, of a binary type
+  Status SetReadDictionary(const std::vector<int>& column_indices);
+
+  /// \brief Read ahead row groups in the background, must be called before
+  //          InitRecordBatchReader.
+  ///
+  /// \param[in] row_groups number of row groups fetched ahead of the one decoded, 0
+  ///            reads the batches synchronously
+  Status SetPrefetch(int row_groups);
+
+  /// \brief Fetch the column chunks of the columns read in a row group at once, the
+  //          chunks close in the file merged into one request and the requests issued
+  //          in parallel. Must be called before InitRecordBatchReader. With prefetch,
+  //          sets how the prefetcher fetches a row group, which it always coalesces.
+  //          Not used by a row filter, which fetches the columns it doesn't test only
+  //          for the row groups with a matching row.
+  ///
+  /// \param[in] hole_size_limit chunks at most this many bytes apart are merged
+  /// \param[in] range_size_limit a request fetches at most this many bytes, unless a
+  ///            chunk is larger
+  /// \param[in] io_threads requests of a row group in flight at once
+  Status SetCoalescedReads(int64_t hole_size_limit, int64_t range_size_limit,
+                           int io_threads);
+
+  /// \brief Fetch the column chunks through the column chunk cache of this process,
+  //          see LookupColumnChunk. Must be called before InitRecordBatchReader, does
+  //          nothing if NATIVESQL_PARQUET_CACHE_BYTES is not set.
+  ///
+  /// \param[in] file_key names this version of the file, e.g. its path, size and
+  ///            modification time
+  Status SetChunkCache(const std::string& file_key);
+
   /// \brief Get a record batch iterator with specified row group index and
   //          column indices.
   ///
@@ -96,6 +168,11 @@ class ARROW_EXPORT ParquetFileReader {
   /// \param[out] out the returned RecordBatch
   Status ReadNext(std::shared_ptr<RecordBatch>* out);
 
+  /// \brief Stop reading once the consumer is done, e.g. when a LIMIT above the scan
+  //          is satisfied: the threads of prefetch are stopped, the row groups read
+  //          ahead dropped, and ReadNext returns no more batch.
+  void Stop();
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
@@ -132,12 +209,23 @@ class ARROW_EXPORT ParquetFileWriter {
                      std::shared_ptr<::parquet::ArrowWriterProperties> properties,
                      std::unique_ptr<ParquetFileWriter>* writer);
 
+  /// \brief Encode and compress the column chunks of a row group in parallel, and write
+  //          a row group whenever row_group_rows are buffered. Must be called before
+  //          the first row group is written.
+  ///
+  /// \param[in] num_threads threads encoding the columns of a row group, 1 encodes
+  ///            them on the writing thread as does a schema with nested fields
+  /// \param[in] row_group_rows rows of a row group, 0 buffers all the batches up to
+  ///            Flush
+  Status SetParallelWrite(int num_threads, int64_t row_group_rows);
+
   /// \brief write a RecordBatch to buffer
   ///
   /// \param[in] in record batch data to be written
   Status WriteNext(std::shared_ptr<RecordBatch> in);
 
-  /// \brief flush all record batch in buffer to parquet output stream
+  /// \brief flush all record batch in buffer to parquet output stream, and finish the
+  //          file
   Status Flush();
 
   /// \brief Return the schema read from the PARQUET file
@@ -0,0 +1,140 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "data_source/parquet/chunk_cache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+namespace {
+
+int64_t GetParquetCacheBytes() {
+  const char* env_bytes = std::getenv("NATIVESQL_PARQUET_CACHE_BYTES");
+  if (env_bytes == nullptr) {
+    return 0;
+  }
+  int64_t bytes = std::atoll(env_bytes);
+  return bytes > 0 ? bytes : 0;
+}
+
+// the chunks by key, the most recently used first in lru
+struct Entry {
+  std::shared_ptr<arrow::Buffer> chunk;
+  std::list<std::string>::iterator lru_position;
+};
+
+std::mutex cache_mutex;
+std::list<std::string> lru;
+std::unordered_map<std::string, Entry> cache;
+arrow::MemoryPool* cache_pool = nullptr;
+ColumnChunkCacheMetrics metrics;
+
+std::string MakeKey(const std::string& file_key, int row_group, int column) {
+  return file_key + "|" + std::to_string(row_group) + "|" + std::to_string(column);
+}
+
+}  // namespace
+
+int64_t ColumnChunkCacheCapacity() {
+  static const int64_t capacity = GetParquetCacheBytes();
+  return capacity;
+}
+
+std::shared_ptr<arrow::Buffer> LookupColumnChunk(const std::string& file_key,
+                                                 int row_group, int column) {
+  auto key = MakeKey(file_key, row_group, column);
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    ++metrics.misses;
+    return nullptr;
+  }
+  ++metrics.hits;
+  lru.splice(lru.begin(), lru, it->second.lru_position);
+  return it->second.chunk;
+}
+
+std::shared_ptr<arrow::Buffer> InsertColumnChunk(const std::string& file_key,
+                                                 int row_group, int column,
+                                                 std::shared_ptr<arrow::Buffer> chunk) {
+  auto capacity = ColumnChunkCacheCapacity();
+  if (chunk->size() > capacity) {
+    return chunk;
+  }
+  auto key = MakeKey(file_key, row_group, column);
+  arrow::MemoryPool* pool;
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (cache.count(key) > 0) {
+      return cache[key].chunk;
+    }
+    pool = cache_pool != nullptr ? cache_pool : arrow::default_memory_pool();
+  }
+  // copied out of the lock, the chunk may be a slice of a larger prefetched range
+  auto copy = arrow::AllocateBuffer(chunk->size(), pool);
+  if (!copy.ok()) {
+    return chunk;
+  }
+  std::shared_ptr<arrow::Buffer> cached = *std::move(copy);
+  std::memcpy(cached->mutable_data(), chunk->data(), chunk->size());
+
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    return it->second.chunk;
+  }
+  while (!lru.empty() && metrics.bytes + cached->size() > capacity) {
+    auto evicted = cache.find(lru.back());
+    metrics.bytes -= evicted->second.chunk->size();
+    cache.erase(evicted);
+    lru.pop_back();
+    ++metrics.evictions;
+  }
+  lru.push_front(key);
+  cache.emplace(key, Entry{cached, lru.begin()});
+  metrics.bytes += cached->size();
+  return cached;
+}
+
+void SetColumnChunkCachePool(arrow::MemoryPool* pool) {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  cache_pool = pool;
+}
+
+ColumnChunkCacheMetrics GetColumnChunkCacheMetrics() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  return metrics;
+}
+
+void ClearColumnChunkCache() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  cache.clear();
+  lru.clear();
+  metrics.bytes = 0;
+}
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
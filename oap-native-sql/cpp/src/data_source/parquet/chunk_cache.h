@@ -0,0 +1,75 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <arrow/buffer.h>
+#include <arrow/memory_pool.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+/// \brief Column chunks of the parquet files read by this process
+///
+/// The compressed bytes of a column chunk are kept by file, row group and column, so
+/// that the tasks scanning the same hot files fetch each chunk from the file system
+/// once. The least recently used chunks are dropped once they hold more than
+/// NATIVESQL_PARQUET_CACHE_BYTES, 0, the default, disables the cache.
+///
+/// \param file_key names one version of a file, e.g. its path, size and modification
+///        time, so that a rewritten file misses
+std::shared_ptr<arrow::Buffer> LookupColumnChunk(const std::string& file_key,
+                                                 int row_group, int column);
+
+/// Copy chunk into the cache unless another task did meanwhile, return the one cached,
+/// or chunk itself if it doesn't fit in the cache
+std::shared_ptr<arrow::Buffer> InsertColumnChunk(const std::string& file_key,
+                                                 int row_group, int column,
+                                                 std::shared_ptr<arrow::Buffer> chunk);
+
+/// Bytes the cache holds at most, 0 if disabled
+int64_t ColumnChunkCacheCapacity();
+
+/// Allocate the chunks cached from now on in pool instead of the default memory pool,
+/// e.g. a pool of persistent memory to cache more than DRAM holds. pool must outlive
+/// the chunks cached.
+void SetColumnChunkCachePool(arrow::MemoryPool* pool);
+
+/// Lookups in the column chunk cache of this process
+struct ColumnChunkCacheMetrics {
+  int64_t hits = 0;
+  /// read from the file, as not in the cache
+  int64_t misses = 0;
+  /// dropped as least recently used
+  int64_t evictions = 0;
+  /// bytes of the chunks in the cache
+  int64_t bytes = 0;
+};
+
+ColumnChunkCacheMetrics GetColumnChunkCacheMetrics();
+
+/// Drop the chunks of the cache, the ones being decoded stay alive until decoded
+void ClearColumnChunkCache();
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
@@ -0,0 +1,220 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "data_source/parquet/late_materialized_reader.h"
+
+#include <arrow/builder.h>
+#include <arrow/compute/context.h>
+#include <arrow/compute/kernels/take.h>
+#include <gandiva/node.h>
+#include <gandiva/selection_vector.h>
+#include <parquet/schema.h>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "codegen/common/gandiva_cache.h"
+#include "utils/trace.h"
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+namespace {
+
+/// False if node has a kind of node whose fields aren't known
+bool CollectFieldNames(const gandiva::Node& node, std::set<std::string>* names) {
+  if (auto field = dynamic_cast<const gandiva::FieldNode*>(&node)) {
+    names->insert(field->field()->name());
+    return true;
+  }
+  if (dynamic_cast<const gandiva::LiteralNode*>(&node) != nullptr) {
+    return true;
+  }
+  gandiva::NodeVector children;
+  if (auto function = dynamic_cast<const gandiva::FunctionNode*>(&node)) {
+    children = function->children();
+  } else if (auto boolean = dynamic_cast<const gandiva::BooleanNode*>(&node)) {
+    children = boolean->children();
+  } else if (auto if_node = dynamic_cast<const gandiva::IfNode*>(&node)) {
+    children = {if_node->condition(), if_node->then_node(), if_node->else_node()};
+  } else {
+    return false;
+  }
+  for (const auto& child : children) {
+    if (!CollectFieldNames(*child, names)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+arrow::Status LateMaterializedReader::Make(
+    ::parquet::arrow::FileReader* reader, arrow::MemoryPool* pool,
+    std::vector<int> row_group_indices, std::vector<int> column_indices,
+    const std::shared_ptr<gandiva::Condition>& condition, int64_t batch_size,
+    std::unique_ptr<LateMaterializedReader>* out) {
+  std::set<std::string> names;
+  if (!CollectFieldNames(*condition->root(), &names)) {
+    return arrow::Status::NotImplemented("Row filter has nodes of unknown fields");
+  }
+  auto file_schema = reader->parquet_reader()->metadata()->schema();
+  if (column_indices.empty()) {
+    for (int i = 0; i < file_schema->num_columns(); i++) {
+      column_indices.push_back(i);
+    }
+  }
+  std::set<int> filter_columns;
+  for (const auto& name : names) {
+    int index = file_schema->ColumnIndex(name);
+    if (std::find(column_indices.begin(), column_indices.end(), index) ==
+        column_indices.end()) {
+      return arrow::Status::NotImplemented("Row filter column ", name, " isn't read");
+    }
+    filter_columns.insert(index);
+  }
+
+  std::unique_ptr<LateMaterializedReader> result(new LateMaterializedReader());
+  result->reader_ = reader;
+  result->pool_ = pool;
+  result->row_group_indices_ = std::move(row_group_indices);
+  result->filter_columns_.assign(filter_columns.begin(), filter_columns.end());
+  for (auto index : column_indices) {
+    if (filter_columns.count(index) == 0) {
+      result->other_columns_.push_back(index);
+    }
+  }
+  result->batch_size_ = batch_size;
+  RETURN_NOT_OK(reader->GetSchema(column_indices, &result->schema_));
+  std::shared_ptr<arrow::Schema> filter_schema;
+  RETURN_NOT_OK(reader->GetSchema(result->filter_columns_, &filter_schema));
+  auto status = sparkcolumnarplugin::codegen::MakeCachedFilter(
+      filter_schema, condition, gandiva::ConfigurationBuilder::DefaultConfiguration(),
+      &result->filter_);
+  if (!status.ok()) {
+    return arrow::Status::NotImplemented("Row filter can't be compiled, ",
+                                         status.message());
+  }
+  *out = std::move(result);
+  return arrow::Status::OK();
+}
+
+arrow::Status LateMaterializedReader::Next(std::shared_ptr<arrow::RecordBatch>* out) {
+  while (batches_.empty() && next_row_group_ < row_group_indices_.size()) {
+    RETURN_NOT_OK(ReadRowGroup(row_group_indices_[next_row_group_++]));
+  }
+  if (batches_.empty()) {
+    *out = nullptr;
+    return arrow::Status::OK();
+  }
+  *out = std::move(batches_.front());
+  batches_.pop_front();
+  return arrow::Status::OK();
+}
+
+arrow::Status LateMaterializedReader::Select(const arrow::Table& filter_table,
+                                             std::vector<int64_t>* selected) {
+  arrow::TableBatchReader batches(filter_table);
+  batches.set_chunksize(batch_size_);
+  int64_t offset = 0;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while (true) {
+    RETURN_NOT_OK(batches.ReadNext(&batch));
+    if (batch == nullptr) {
+      return arrow::Status::OK();
+    }
+    std::shared_ptr<gandiva::SelectionVector> selection;
+    RETURN_NOT_OK(
+        gandiva::SelectionVector::MakeInt32(batch->num_rows(), pool_, &selection));
+    RETURN_NOT_OK(filter_->Evaluate(*batch, selection));
+    for (int64_t i = 0; i < selection->GetNumSlots(); i++) {
+      selected->push_back(offset + selection->GetIndex(i));
+    }
+    offset += batch->num_rows();
+  }
+}
+
+arrow::Status LateMaterializedReader::ReadRowGroup(int row_group) {
+  TRACE_SPAN("parquet", "ReadRowGroup");
+  std::shared_ptr<arrow::Table> filter_table;
+  RETURN_NOT_OK(reader_->ReadRowGroup(row_group, filter_columns_, &filter_table));
+  std::vector<int64_t> selected;
+  RETURN_NOT_OK(Select(*filter_table, &selected));
+  if (selected.empty()) {
+    // the other columns of the row group are never decoded
+    return arrow::Status::OK();
+  }
+
+  std::shared_ptr<arrow::Table> other_table;
+  if (!other_columns_.empty()) {
+    RETURN_NOT_OK(reader_->ReadRowGroup(row_group, other_columns_, &other_table));
+  }
+  std::vector<std::shared_ptr<arrow::ChunkedArray>> columns;
+  for (const auto& field : schema_->fields()) {
+    auto column = filter_table->GetColumnByName(field->name());
+    columns.push_back(column != nullptr ? column
+                                        : other_table->GetColumnByName(field->name()));
+  }
+  auto table = arrow::Table::Make(schema_, columns, filter_table->num_rows());
+
+  arrow::compute::FunctionContext ctx(pool_);
+  arrow::TableBatchReader batches(*table);
+  batches.set_chunksize(batch_size_);
+  int64_t offset = 0;
+  size_t next = 0;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while (true) {
+    RETURN_NOT_OK(batches.ReadNext(&batch));
+    if (batch == nullptr) {
+      return arrow::Status::OK();
+    }
+    int64_t end = offset + batch->num_rows();
+    arrow::Int32Builder indices_builder(pool_);
+    for (; next < selected.size() && selected[next] < end; next++) {
+      auto index = static_cast<int32_t>(selected[next] - offset);
+      RETURN_NOT_OK(indices_builder.Append(index));
+    }
+    offset = end;
+    auto num_rows = indices_builder.length();
+    if (num_rows == batch->num_rows()) {
+      batches_.push_back(batch);
+      continue;
+    }
+    if (num_rows == 0) {
+      continue;
+    }
+    std::shared_ptr<arrow::Array> indices;
+    RETURN_NOT_OK(indices_builder.Finish(&indices));
+    arrow::ArrayVector taken_columns;
+    for (const auto& column : batch->columns()) {
+      std::shared_ptr<arrow::Array> taken;
+      RETURN_NOT_OK(arrow::compute::Take(&ctx, *column, *indices,
+                                         arrow::compute::TakeOptions(), &taken));
+      taken_columns.push_back(taken);
+    }
+    batches_.push_back(arrow::RecordBatch::Make(schema_, num_rows, taken_columns));
+  }
+}
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
@@ -0,0 +1,90 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/record_batch.h>
+#include <arrow/status.h>
+#include <arrow/table.h>
+#include <arrow/type.h>
+#include <gandiva/condition.h>
+#include <gandiva/filter.h>
+#include <parquet/arrow/reader.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+/// \brief Reads the rows of row groups satisfying a condition, decoding the columns of
+/// the condition before the others
+///
+/// The filter columns of a row group are decoded and evaluated first. The other columns
+/// are then decoded only if some row of the row group matches, and only the matching
+/// rows of every column are returned.
+class LateMaterializedReader {
+ public:
+  /// \brief NotImplemented if condition isn't a gandiva filter of the columns read,
+  /// then the rows should be read as they are
+  ///
+  /// \param[in] reader the file reader, must outlive the reader made
+  /// \param[in] column_indices indexes of the columns read, empty for all of them
+  /// \param[in] condition condition of the columns by name
+  /// \param[in] batch_size rows of the batches decoded, the batches returned have the
+  ///            matching rows of them
+  static arrow::Status Make(::parquet::arrow::FileReader* reader, arrow::MemoryPool* pool,
+                            std::vector<int> row_group_indices,
+                            std::vector<int> column_indices,
+                            const std::shared_ptr<gandiva::Condition>& condition,
+                            int64_t batch_size,
+                            std::unique_ptr<LateMaterializedReader>* out);
+
+  std::shared_ptr<arrow::Schema> schema() const { return schema_; }
+
+  /// \brief Next batch of matching rows, null after the last one
+  arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out);
+
+ private:
+  LateMaterializedReader() = default;
+
+  ::parquet::arrow::FileReader* reader_;
+  arrow::MemoryPool* pool_;
+  std::vector<int> row_group_indices_;
+  size_t next_row_group_ = 0;
+  // file columns of the condition, and the ones read only for the matching rows
+  std::vector<int> filter_columns_;
+  std::vector<int> other_columns_;
+  std::shared_ptr<arrow::Schema> schema_;
+  std::shared_ptr<gandiva::Filter> filter_;
+  int64_t batch_size_;
+  std::deque<std::shared_ptr<arrow::RecordBatch>> batches_;
+
+  /// Positions in the row group of the rows satisfying the condition
+  arrow::Status Select(const arrow::Table& filter_table, std::vector<int64_t>* selected);
+
+  arrow::Status ReadRowGroup(int row_group);
+};
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
@@ -0,0 +1,74 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "data_source/parquet/parallel_row_group_reader.h"
+
+#include <utility>
+
+#include "utils/trace.h"
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+arrow::Status ParallelRowGroupReader::Make(::parquet::arrow::FileReader* reader,
+                                           std::vector<int> row_group_indices,
+                                           std::vector<int> column_indices,
+                                           int64_t batch_size,
+                                           std::shared_ptr<ParallelRowGroupReader>* out) {
+  auto result = std::shared_ptr<ParallelRowGroupReader>(new ParallelRowGroupReader());
+  result->reader_ = reader;
+  result->row_group_indices_ = std::move(row_group_indices);
+  if (column_indices.empty()) {
+    auto num_columns = reader->parquet_reader()->metadata()->num_columns();
+    for (int i = 0; i < num_columns; i++) {
+      column_indices.push_back(i);
+    }
+  }
+  result->column_indices_ = std::move(column_indices);
+  result->batch_size_ = batch_size;
+  RETURN_NOT_OK(reader->GetSchema(result->column_indices_, &result->schema_));
+  *out = std::move(result);
+  return arrow::Status::OK();
+}
+
+arrow::Status ParallelRowGroupReader::ReadNext(std::shared_ptr<arrow::RecordBatch>* out) {
+  while (true) {
+    if (batches_ != nullptr) {
+      RETURN_NOT_OK(batches_->ReadNext(out));
+      if (*out != nullptr) {
+        return arrow::Status::OK();
+      }
+      batches_ = nullptr;
+      table_ = nullptr;
+    }
+    if (next_row_group_ == row_group_indices_.size()) {
+      *out = nullptr;
+      return arrow::Status::OK();
+    }
+    TRACE_SPAN("parquet", "ReadRowGroup");
+    RETURN_NOT_OK(reader_->ReadRowGroup(row_group_indices_[next_row_group_++],
+                                        column_indices_, &table_));
+    batches_.reset(new arrow::TableBatchReader(*table_));
+    batches_->set_chunksize(batch_size_);
+  }
+}
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
@@ -0,0 +1,73 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#pragma once
+
+#include <arrow/record_batch.h>
+#include <arrow/status.h>
+#include <arrow/table.h>
+#include <arrow/type.h>
+#include <parquet/arrow/reader.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+/// \brief Reads the batches of row groups decoding the columns of a row group in
+/// parallel
+///
+/// The record batch reader of parquet-cpp decodes the columns of a batch one after
+/// another. This one reads a whole row group with FileReader::ReadRowGroup, which
+/// decodes its columns on the arrow CPU thread pool, shared by the tasks of the
+/// executor, when the reader properties use threads. The row group is then sliced into
+/// batches.
+class ParallelRowGroupReader : public arrow::RecordBatchReader {
+ public:
+  /// \param[in] reader the file reader, must outlive the reader made
+  /// \param[in] column_indices indexes of the columns read, empty for all of them
+  /// \param[in] batch_size rows of the batches returned
+  static arrow::Status Make(::parquet::arrow::FileReader* reader,
+                            std::vector<int> row_group_indices,
+                            std::vector<int> column_indices, int64_t batch_size,
+                            std::shared_ptr<ParallelRowGroupReader>* out);
+
+  std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch>* out) override;
+
+ private:
+  ParallelRowGroupReader() = default;
+
+  ::parquet::arrow::FileReader* reader_;
+  std::vector<int> row_group_indices_;
+  size_t next_row_group_ = 0;
+  std::vector<int> column_indices_;
+  std::shared_ptr<arrow::Schema> schema_;
+  int64_t batch_size_;
+  // the row group decoded, and the reader of its batches
+  std::shared_ptr<arrow::Table> table_;
+  std::unique_ptr<arrow::TableBatchReader> batches_;
+};
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
@@ -0,0 +1,443 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "data_source/parquet/prefetcher.h"
+
+#include <arrow/record_batch.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "data_source/parquet/chunk_cache.h"
+#include "utils/trace.h"
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+///////////////  PrefetchedFile  ////////////////
+PrefetchedFile::PrefetchedFile(std::shared_ptr<arrow::io::RandomAccessFile> file)
+    : file_(std::move(file)) {}
+
+arrow::Status PrefetchedFile::Close() { return file_->Close(); }
+
+bool PrefetchedFile::closed() const { return file_->closed(); }
+
+arrow::Result<int64_t> PrefetchedFile::Tell() const { return file_->Tell(); }
+
+arrow::Status PrefetchedFile::Seek(int64_t position) { return file_->Seek(position); }
+
+arrow::Result<int64_t> PrefetchedFile::Read(int64_t nbytes, void* out) {
+  return file_->Read(nbytes, out);
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> PrefetchedFile::Read(int64_t nbytes) {
+  return file_->Read(nbytes);
+}
+
+arrow::Result<int64_t> PrefetchedFile::GetSize() { return file_->GetSize(); }
+
+arrow::Result<int64_t> PrefetchedFile::ReadAt(int64_t position, int64_t nbytes,
+                                              void* out) {
+  RETURN_NOT_OK(FetchOnDemand(position, nbytes));
+  auto cached = Find(position, nbytes);
+  if (cached == nullptr) {
+    ARROW_ASSIGN_OR_RAISE(cached, ReadChunk(position, nbytes));
+  }
+  if (cached == nullptr) {
+    TRACE_SPAN("parquet", "ReadAt");
+    return file_->ReadAt(position, nbytes, out);
+  }
+  std::memcpy(out, cached->data(), nbytes);
+  return nbytes;
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> PrefetchedFile::ReadAt(int64_t position,
+                                                                     int64_t nbytes) {
+  RETURN_NOT_OK(FetchOnDemand(position, nbytes));
+  auto cached = Find(position, nbytes);
+  if (cached == nullptr) {
+    ARROW_ASSIGN_OR_RAISE(cached, ReadChunk(position, nbytes));
+  }
+  if (cached == nullptr) {
+    TRACE_SPAN("parquet", "ReadAt");
+    return file_->ReadAt(position, nbytes);
+  }
+  return cached;
+}
+
+void PrefetchedFile::Cache(int row_group, int64_t offset,
+                           std::shared_ptr<arrow::Buffer> buffer) {
+  // the chunks prefetched whole go to the chunk cache as well
+  for (const auto& chunk : chunks_) {
+    if (chunk_cache_ && chunk.row_group == row_group && chunk.offset >= offset &&
+        chunk.offset + chunk.length <= offset + buffer->size()) {
+      InsertColumnChunk(file_key_, row_group, chunk.column,
+                        arrow::SliceBuffer(buffer, chunk.offset - offset, chunk.length));
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ranges_.push_back({row_group, offset, std::move(buffer)});
+}
+
+void PrefetchedFile::Drop(int row_group) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ranges_.erase(std::remove_if(ranges_.begin(), ranges_.end(),
+                               [row_group](const Range& range) {
+                                 return range.row_group == row_group;
+                               }),
+                ranges_.end());
+}
+
+void PrefetchedFile::SetChunkCache(std::string file_key,
+                                   const ::parquet::FileMetaData& metadata) {
+  file_key_ = std::move(file_key);
+  chunk_cache_ = true;
+  IndexChunks(metadata);
+}
+
+void PrefetchedFile::SetCoalescedReads(std::shared_ptr<::parquet::FileMetaData> metadata,
+                                       std::vector<int> columns,
+                                       ReadCoalescing options) {
+  IndexChunks(*metadata);
+  metadata_ = std::move(metadata);
+  if (columns.empty()) {
+    for (int i = 0; i < metadata_->num_columns(); i++) {
+      columns.push_back(i);
+    }
+  }
+  coalesced_columns_ = std::move(columns);
+  coalescing_ = options;
+}
+
+void PrefetchedFile::IndexChunks(const ::parquet::FileMetaData& metadata) {
+  if (!chunks_.empty()) {
+    return;
+  }
+  for (int i = 0; i < metadata.num_row_groups(); i++) {
+    auto row_group = metadata.RowGroup(i);
+    for (int j = 0; j < row_group->num_columns(); j++) {
+      auto column = row_group->ColumnChunk(j);
+      auto offset = column->has_dictionary_page() ? column->dictionary_page_offset()
+                                                  : column->data_page_offset();
+      chunks_.push_back({offset, column->total_compressed_size(), i, j});
+    }
+  }
+  std::sort(chunks_.begin(), chunks_.end(),
+            [](const Chunk& a, const Chunk& b) { return a.offset < b.offset; });
+}
+
+std::shared_ptr<arrow::Buffer> PrefetchedFile::CachedChunk(int row_group, int column) {
+  if (!chunk_cache_) {
+    return nullptr;
+  }
+  return LookupColumnChunk(file_key_, row_group, column);
+}
+
+const PrefetchedFile::Chunk* PrefetchedFile::FindChunk(int64_t position,
+                                                       int64_t nbytes) const {
+  // the last chunk starting at or before position
+  auto it = std::upper_bound(
+      chunks_.begin(), chunks_.end(), position,
+      [](int64_t position, const Chunk& chunk) { return position < chunk.offset; });
+  if (it == chunks_.begin()) {
+    return nullptr;
+  }
+  const auto& chunk = *(it - 1);
+  // a read past the chunk, as the padding of the chunks of old writers, isn't a chunk
+  // read
+  if (position + nbytes > chunk.offset + chunk.length) {
+    return nullptr;
+  }
+  return &chunk;
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> PrefetchedFile::ReadChunk(
+    int64_t position, int64_t nbytes) {
+  if (!chunk_cache_) {
+    return nullptr;
+  }
+  auto found = FindChunk(position, nbytes);
+  // a chunk larger than the cache would be read whole on each of its reads
+  if (found == nullptr || found->length > ColumnChunkCacheCapacity()) {
+    return nullptr;
+  }
+  const auto& chunk = *found;
+  auto cached = LookupColumnChunk(file_key_, chunk.row_group, chunk.column);
+  if (cached == nullptr) {
+    TRACE_SPAN("parquet", "ReadChunk");
+    ARROW_ASSIGN_OR_RAISE(auto buffer, file_->ReadAt(chunk.offset, chunk.length));
+    cached = InsertColumnChunk(file_key_, chunk.row_group, chunk.column,
+                               std::move(buffer));
+  }
+  return arrow::SliceBuffer(cached, position - chunk.offset, nbytes);
+}
+
+arrow::Status PrefetchedFile::FetchOnDemand(int64_t position, int64_t nbytes) {
+  if (metadata_ == nullptr) {
+    return arrow::Status::OK();
+  }
+  auto chunk = FindChunk(position, nbytes);
+  if (chunk == nullptr ||
+      std::find(coalesced_columns_.begin(), coalesced_columns_.end(), chunk->column) ==
+          coalesced_columns_.end()) {
+    return arrow::Status::OK();
+  }
+  // the threads decoding the columns of a row group in parallel wait for one fetch
+  std::lock_guard<std::mutex> lock(fetch_mutex_);
+  if (chunk->row_group == fetched_row_group_) {
+    return arrow::Status::OK();
+  }
+  // each chunk is read whole once, the chunks of the previous row group are held by
+  // their readers already
+  if (fetched_row_group_ != -1) {
+    Drop(fetched_row_group_);
+  }
+  fetched_row_group_ = chunk->row_group;
+  return FetchRowGroup(*metadata_->RowGroup(chunk->row_group), chunk->row_group,
+                       coalesced_columns_, coalescing_);
+}
+
+arrow::Status PrefetchedFile::FetchRowGroup(const ::parquet::RowGroupMetaData& metadata,
+                                            int row_group,
+                                            const std::vector<int>& columns,
+                                            const ReadCoalescing& options) {
+  TRACE_SPAN("parquet", "FetchRowGroup");
+  // (offset, length) of the column chunks in the file
+  std::vector<std::pair<int64_t, int64_t>> chunks;
+  for (auto i : columns) {
+    auto column = metadata.ColumnChunk(i);
+    auto offset = column->has_dictionary_page() ? column->dictionary_page_offset()
+                                                : column->data_page_offset();
+    // served from memory already, not fetched again
+    auto cached = CachedChunk(row_group, i);
+    if (cached != nullptr) {
+      Cache(row_group, offset, std::move(cached));
+      continue;
+    }
+    chunks.emplace_back(offset, column->total_compressed_size());
+  }
+  std::sort(chunks.begin(), chunks.end());
+  std::vector<std::pair<int64_t, int64_t>> ranges;
+  for (const auto& chunk : chunks) {
+    if (!ranges.empty()) {
+      auto& last = ranges.back();
+      auto last_end = last.first + last.second;
+      auto end = std::max(last_end, chunk.first + chunk.second);
+      if (chunk.first - last_end <= options.hole_size_limit &&
+          end - last.first <= options.range_size_limit) {
+        last.second = end - last.first;
+        continue;
+      }
+    }
+    ranges.push_back(chunk);
+  }
+  // a read past the ranges, as the padding of the chunks of old writers, goes to the file
+  std::vector<arrow::Status> statuses(ranges.size());
+  auto fetch = [&](size_t start, size_t step) {
+    for (auto i = start; i < ranges.size(); i += step) {
+      auto buffer = file_->ReadAt(ranges[i].first, ranges[i].second);
+      if (!buffer.ok()) {
+        statuses[i] = buffer.status();
+        return;
+      }
+      Cache(row_group, ranges[i].first, *std::move(buffer));
+    }
+  };
+  auto num_threads = std::min<size_t>(std::max(options.io_threads, 1), ranges.size());
+  if (num_threads <= 1) {
+    fetch(0, 1);
+  } else {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; t++) {
+      threads.emplace_back(fetch, t, num_threads);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  for (const auto& status : statuses) {
+    RETURN_NOT_OK(status);
+  }
+  return arrow::Status::OK();
+}
+
+std::shared_ptr<arrow::Buffer> PrefetchedFile::Find(int64_t position, int64_t nbytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& range : ranges_) {
+    if (position >= range.offset &&
+        position + nbytes <= range.offset + range.buffer->size()) {
+      return arrow::SliceBuffer(range.buffer, position - range.offset, nbytes);
+    }
+  }
+  return nullptr;
+}
+
+///////////////  RowGroupPrefetcher  ////////////////
+RowGroupPrefetcher::RowGroupPrefetcher(::parquet::arrow::FileReader* reader,
+                                       std::shared_ptr<PrefetchedFile> file,
+                                       std::vector<int> row_group_indices,
+                                       std::vector<int> column_indices, int row_groups,
+                                       ReadCoalescing coalescing)
+    : reader_(reader),
+      file_(std::move(file)),
+      row_group_indices_(std::move(row_group_indices)),
+      column_indices_(std::move(column_indices)),
+      row_groups_(row_groups),
+      coalescing_(coalescing) {
+  fetch_thread_ = std::thread([this] { FetchLoop(); });
+  decode_thread_ = std::thread([this] { DecodeLoop(); });
+}
+
+RowGroupPrefetcher::~RowGroupPrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  fetched_cv_.notify_all();
+  decoded_cv_.notify_all();
+  batch_cv_.notify_all();
+  fetch_thread_.join();
+  decode_thread_.join();
+  for (auto row_group : row_group_indices_) {
+    file_->Drop(row_group);
+  }
+}
+
+arrow::Status RowGroupPrefetcher::Next(std::shared_ptr<arrow::RecordBatch>* out) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  batch_cv_.wait(lock, [this] { return !batches_.empty() || decode_done_ || stop_; });
+  if (!batches_.empty()) {
+    *out = std::move(batches_.front());
+    batches_.pop_front();
+    batch_cv_.notify_all();
+    return arrow::Status::OK();
+  }
+  *out = nullptr;
+  return error_;
+}
+
+void RowGroupPrefetcher::FetchLoop() {
+  for (auto row_group : row_group_indices_) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      decoded_cv_.wait(lock, [this] {
+        return stop_ || num_fetched_ - num_decoded_ < row_groups_;
+      });
+      if (stop_) {
+        return;
+      }
+    }
+    auto status = Fetch(row_group);
+    if (!status.ok()) {
+      SetError(status);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      num_fetched_++;
+    }
+    fetched_cv_.notify_all();
+  }
+}
+
+void RowGroupPrefetcher::DecodeLoop() {
+  for (auto row_group : row_group_indices_) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      fetched_cv_.wait(lock, [this] { return stop_ || num_decoded_ < num_fetched_; });
+      if (stop_) {
+        return;
+      }
+    }
+    auto status = Decode(row_group);
+    file_->Drop(row_group);
+    if (!status.ok()) {
+      SetError(status);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      num_decoded_++;
+    }
+    decoded_cv_.notify_all();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decode_done_ = true;
+  }
+  batch_cv_.notify_all();
+}
+
+arrow::Status RowGroupPrefetcher::Fetch(int row_group) {
+  auto metadata = reader_->parquet_reader()->metadata()->RowGroup(row_group);
+  std::vector<int> columns = column_indices_;
+  if (columns.empty()) {
+    for (int i = 0; i < metadata->num_columns(); i++) {
+      columns.push_back(i);
+    }
+  }
+  return file_->FetchRowGroup(*metadata, row_group, columns, coalescing_);
+}
+
+arrow::Status RowGroupPrefetcher::Decode(int row_group) {
+  TRACE_SPAN("parquet", "DecodeRowGroup");
+  std::shared_ptr<arrow::RecordBatchReader> batch_reader;
+  if (column_indices_.empty()) {
+    RETURN_NOT_OK(reader_->GetRecordBatchReader({row_group}, &batch_reader));
+  } else {
+    RETURN_NOT_OK(
+        reader_->GetRecordBatchReader({row_group}, column_indices_, &batch_reader));
+  }
+  while (true) {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    RETURN_NOT_OK(batch_reader->ReadNext(&batch));
+    if (batch == nullptr) {
+      return arrow::Status::OK();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    batch_cv_.wait(lock,
+                   [this] { return stop_ || batches_.size() < kMaxQueuedBatches; });
+    if (stop_) {
+      return arrow::Status::OK();
+    }
+    batches_.push_back(std::move(batch));
+    batch_cv_.notify_all();
+  }
+}
+
+void RowGroupPrefetcher::SetError(const arrow::Status& status) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_.ok()) {
+      error_ = status;
+    }
+    stop_ = true;
+  }
+  fetched_cv_.notify_all();
+  decoded_cv_.notify_all();
+  batch_cv_.notify_all();
+}
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
@@ -0,0 +1,209 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <arrow/buffer.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/record_batch.h>
+#include <arrow/result.h>
+#include <arrow/status.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/metadata.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+/// \brief How the column chunks of a row group are fetched
+struct ReadCoalescing {
+  /// Chunks at most this far apart in the file are fetched by one request
+  int64_t hole_size_limit = 1 << 20;
+  /// A request fetches at most this many bytes, unless a chunk is larger
+  int64_t range_size_limit = 64 << 20;
+  /// Requests of a row group in flight at once, 1 issues them one after the other
+  int io_threads = 1;
+};
+
+/// \brief A file serving the reads within byte ranges prefetched for some row groups
+///
+/// With a chunk cache, the reads within a column chunk are served from the column chunk
+/// cache of this process, the chunk read whole from the file on a miss. With coalesced
+/// reads, the first read within a chunk of a row group fetches the chunks of all the
+/// columns read in that row group by FetchRowGroup, dropping those fetched for the
+/// previous one. The other reads go to the file. Reads are thread safe if those of the
+/// file are.
+class PrefetchedFile : public arrow::io::RandomAccessFile {
+ public:
+  explicit PrefetchedFile(std::shared_ptr<arrow::io::RandomAccessFile> file);
+
+  arrow::Status Close() override;
+  bool closed() const override;
+  arrow::Result<int64_t> Tell() const override;
+  arrow::Status Seek(int64_t position) override;
+  arrow::Result<int64_t> Read(int64_t nbytes, void* out) override;
+  arrow::Result<std::shared_ptr<arrow::Buffer>> Read(int64_t nbytes) override;
+  arrow::Result<int64_t> GetSize() override;
+  arrow::Result<int64_t> ReadAt(int64_t position, int64_t nbytes, void* out) override;
+  arrow::Result<std::shared_ptr<arrow::Buffer>> ReadAt(int64_t position,
+                                                       int64_t nbytes) override;
+
+  /// Keep the bytes of the file at offset, prefetched for a row group
+  void Cache(int row_group, int64_t offset, std::shared_ptr<arrow::Buffer> buffer);
+
+  /// Drop the bytes prefetched for a row group
+  void Drop(int row_group);
+
+  /// Cache the column chunks of metadata under file_key, see LookupColumnChunk. Must be
+  /// called before the first read.
+  void SetChunkCache(std::string file_key, const ::parquet::FileMetaData& metadata);
+
+  /// The bytes of the chunk of column in row_group if in the chunk cache, else null
+  std::shared_ptr<arrow::Buffer> CachedChunk(int row_group, int column);
+
+  /// Fetch the chunks of columns of metadata, all of them if empty, on the first read
+  /// within one of them. The row groups must be read one after the other, each chunk
+  /// read whole at once, as the readers of parquet-cpp do. Must be called before the
+  /// first read.
+  void SetCoalescedReads(std::shared_ptr<::parquet::FileMetaData> metadata,
+                         std::vector<int> columns, ReadCoalescing options);
+
+  /// Fetch the chunks of columns in row_group not in the chunk cache, coalesced into few
+  /// requests by options, and keep them for the row group
+  arrow::Status FetchRowGroup(const ::parquet::RowGroupMetaData& metadata, int row_group,
+                              const std::vector<int>& columns,
+                              const ReadCoalescing& options);
+
+ private:
+  struct Range {
+    int row_group;
+    int64_t offset;
+    std::shared_ptr<arrow::Buffer> buffer;
+  };
+
+  struct Chunk {
+    int64_t offset;
+    int64_t length;
+    int row_group;
+    int column;
+  };
+
+  // the cached bytes of [position, position + nbytes), null if they aren't cached
+  std::shared_ptr<arrow::Buffer> Find(int64_t position, int64_t nbytes);
+
+  // the chunk holding [position, position + nbytes), null if none
+  const Chunk* FindChunk(int64_t position, int64_t nbytes) const;
+
+  // the bytes of [position, position + nbytes) from the chunk cache, null if they
+  // aren't within a column chunk
+  arrow::Result<std::shared_ptr<arrow::Buffer>> ReadChunk(int64_t position,
+                                                          int64_t nbytes);
+
+  // coalesced reads: fetch the row group of the chunk [position, position + nbytes) is
+  // in, if it is a chunk read and its row group isn't fetched yet
+  arrow::Status FetchOnDemand(int64_t position, int64_t nbytes);
+
+  void IndexChunks(const ::parquet::FileMetaData& metadata);
+
+  std::shared_ptr<arrow::io::RandomAccessFile> file_;
+  std::mutex mutex_;
+  std::vector<Range> ranges_;
+  // the column chunks of the file sorted by offset, empty if neither the chunk cache nor
+  // coalesced reads are on
+  std::vector<Chunk> chunks_;
+  bool chunk_cache_ = false;
+  std::string file_key_;
+
+  // coalesced reads, metadata_ is null if off
+  std::shared_ptr<::parquet::FileMetaData> metadata_;
+  std::vector<int> coalesced_columns_;
+  ReadCoalescing coalescing_;
+  std::mutex fetch_mutex_;
+  int fetched_row_group_ = -1;
+};
+
+/// \brief Reads ahead the row groups of a parquet file in the background
+///
+/// An I/O thread fetches the column chunks of up to row_groups row groups ahead of the
+/// one decoded, each by a few coalesced range requests, see ReadCoalescing. A decode
+/// thread reads the batches of the fetched row groups into a bounded queue, which Next
+/// drains, so that I/O, decoding and the consumer of the batches overlap.
+class RowGroupPrefetcher {
+ public:
+  /// Decoded batches the queue holds at most
+  static constexpr size_t kMaxQueuedBatches = 8;
+
+  /// \param reader parquet reader opened on file
+  /// \param file the file of the reader
+  /// \param row_group_indices the row groups to read in order
+  /// \param column_indices the columns to read, all of them if empty
+  /// \param row_groups number of row groups fetched ahead, must be positive
+  /// \param coalescing how the chunks of a row group are fetched
+  RowGroupPrefetcher(::parquet::arrow::FileReader* reader,
+                     std::shared_ptr<PrefetchedFile> file,
+                     std::vector<int> row_group_indices, std::vector<int> column_indices,
+                     int row_groups, ReadCoalescing coalescing = ReadCoalescing());
+
+  /// Stop the threads, dropping the batches not read
+  ~RowGroupPrefetcher();
+
+  /// The next batch, null once the row groups are over
+  arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out);
+
+ private:
+  void FetchLoop();
+  void DecodeLoop();
+  arrow::Status Fetch(int row_group);
+  arrow::Status Decode(int row_group);
+  // Record the first error, which stops the threads
+  void SetError(const arrow::Status& status);
+
+  ::parquet::arrow::FileReader* reader_;
+  std::shared_ptr<PrefetchedFile> file_;
+  const std::vector<int> row_group_indices_;
+  const std::vector<int> column_indices_;
+  const size_t row_groups_;
+  const ReadCoalescing coalescing_;
+
+  std::mutex mutex_;
+  std::condition_variable fetched_cv_;
+  std::condition_variable decoded_cv_;
+  std::condition_variable batch_cv_;
+  // positions in row_group_indices_ of the next row group to fetch and to decode
+  size_t num_fetched_ = 0;
+  size_t num_decoded_ = 0;
+  std::deque<std::shared_ptr<arrow::RecordBatch>> batches_;
+  bool decode_done_ = false;
+  bool stop_ = false;
+  arrow::Status error_;
+
+  std::thread fetch_thread_;
+  std::thread decode_thread_;
+};
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
@@ -0,0 +1,293 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "data_source/parquet/statistics_filter.h"
+
+#include <arrow/util/checked_cast.h>
+#include <arrow/util/variant.h>
+#include <gandiva/node.h>
+#include <parquet/schema.h>
+#include <parquet/statistics.h>
+#include <parquet/types.h>
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+namespace {
+
+using arrow::internal::checked_cast;
+
+/// A literal or a statistic, compared exactly when both are integers
+struct Value {
+  bool is_integer;
+  int64_t integer;
+  double real;
+};
+
+Value IntegerValue(int64_t value) { return {true, value, 0}; }
+
+Value RealValue(double value) { return {false, 0, value}; }
+
+int Compare(const Value& a, const Value& b) {
+  if (a.is_integer && b.is_integer) {
+    return (a.integer > b.integer) - (a.integer < b.integer);
+  }
+  double x = a.is_integer ? static_cast<double>(a.integer) : a.real;
+  double y = b.is_integer ? static_cast<double>(b.integer) : b.real;
+  return (x > y) - (x < y);
+}
+
+enum class Comparison { kLess, kLessEqual, kGreater, kGreaterEqual, kEqual, kNotEqual };
+
+bool GetComparison(const std::string& name, Comparison* out) {
+  if (name == "less_than") {
+    *out = Comparison::kLess;
+  } else if (name == "less_than_or_equal_to") {
+    *out = Comparison::kLessEqual;
+  } else if (name == "greater_than") {
+    *out = Comparison::kGreater;
+  } else if (name == "greater_than_or_equal_to") {
+    *out = Comparison::kGreaterEqual;
+  } else if (name == "equal") {
+    *out = Comparison::kEqual;
+  } else if (name == "not_equal") {
+    *out = Comparison::kNotEqual;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/// The comparison of the operands swapped, literal < column is column > literal
+Comparison Swap(Comparison comparison) {
+  switch (comparison) {
+    case Comparison::kLess:
+      return Comparison::kGreater;
+    case Comparison::kLessEqual:
+      return Comparison::kGreaterEqual;
+    case Comparison::kGreater:
+      return Comparison::kLess;
+    case Comparison::kGreaterEqual:
+      return Comparison::kLessEqual;
+    default:
+      return comparison;
+  }
+}
+
+/// False if the literal is null, NaN or not a number
+bool GetLiteral(const gandiva::LiteralNode& literal, Value* out) {
+  if (literal.is_null()) {
+    return false;
+  }
+  const auto& holder = literal.holder();
+  switch (literal.return_type()->id()) {
+    case arrow::Type::INT8:
+      *out = IntegerValue(arrow::util::get<int8_t>(holder));
+      return true;
+    case arrow::Type::INT16:
+      *out = IntegerValue(arrow::util::get<int16_t>(holder));
+      return true;
+    case arrow::Type::INT32:
+      *out = IntegerValue(arrow::util::get<int32_t>(holder));
+      return true;
+    case arrow::Type::INT64:
+      *out = IntegerValue(arrow::util::get<int64_t>(holder));
+      return true;
+    case arrow::Type::FLOAT:
+      *out = RealValue(arrow::util::get<float>(holder));
+      return !std::isnan(out->real);
+    case arrow::Type::DOUBLE:
+      *out = RealValue(arrow::util::get<double>(holder));
+      return !std::isnan(out->real);
+    default:
+      return false;
+  }
+}
+
+bool IsComparable(const arrow::DataType& type) {
+  switch (type.id()) {
+    case arrow::Type::INT8:
+    case arrow::Type::INT16:
+    case arrow::Type::INT32:
+    case arrow::Type::INT64:
+    case arrow::Type::FLOAT:
+    case arrow::Type::DOUBLE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// False if the column isn't a plain signed number or its range is unknown
+bool GetMinMax(const ::parquet::ColumnDescriptor& column,
+               const ::parquet::Statistics& stats, Value* min, Value* max) {
+  const auto& logical_type = column.logical_type();
+  if (column.sort_order() != ::parquet::SortOrder::SIGNED ||
+      !(logical_type->is_none() || logical_type->is_int()) || !stats.HasMinMax()) {
+    return false;
+  }
+  switch (stats.physical_type()) {
+    case ::parquet::Type::INT32: {
+      const auto& typed = checked_cast<const ::parquet::Int32Statistics&>(stats);
+      *min = IntegerValue(typed.min());
+      *max = IntegerValue(typed.max());
+      return true;
+    }
+    case ::parquet::Type::INT64: {
+      const auto& typed = checked_cast<const ::parquet::Int64Statistics&>(stats);
+      *min = IntegerValue(typed.min());
+      *max = IntegerValue(typed.max());
+      return true;
+    }
+    case ::parquet::Type::FLOAT: {
+      const auto& typed = checked_cast<const ::parquet::FloatStatistics&>(stats);
+      *min = RealValue(typed.min());
+      *max = RealValue(typed.max());
+      break;
+    }
+    case ::parquet::Type::DOUBLE: {
+      const auto& typed = checked_cast<const ::parquet::DoubleStatistics&>(stats);
+      *min = RealValue(typed.min());
+      *max = RealValue(typed.max());
+      break;
+    }
+    default:
+      return false;
+  }
+  return !std::isnan(min->real) && !std::isnan(max->real);
+}
+
+bool MightCompare(Comparison comparison, const Value& min, const Value& max,
+                  const Value& literal) {
+  switch (comparison) {
+    case Comparison::kLess:
+      return Compare(min, literal) < 0;
+    case Comparison::kLessEqual:
+      return Compare(min, literal) <= 0;
+    case Comparison::kGreater:
+      return Compare(max, literal) > 0;
+    case Comparison::kGreaterEqual:
+      return Compare(max, literal) >= 0;
+    case Comparison::kEqual:
+      return Compare(min, literal) <= 0 && Compare(max, literal) >= 0;
+    case Comparison::kNotEqual:
+      return Compare(min, literal) != 0 || Compare(max, literal) != 0;
+  }
+  return true;
+}
+
+/// Index of the column of the field in the file, -1 if it isn't one
+int GetColumnIndex(const gandiva::FieldNode& field,
+                   const ::parquet::RowGroupMetaData& row_group) {
+  return row_group.schema()->ColumnIndex(field.field()->name());
+}
+
+bool MightMatchNullCheck(const std::string& name, const gandiva::FieldNode& field,
+                         const ::parquet::RowGroupMetaData& row_group) {
+  int index = GetColumnIndex(field, row_group);
+  if (index < 0) {
+    return true;
+  }
+  auto column_chunk = row_group.ColumnChunk(index);
+  auto stats = column_chunk->is_stats_set() ? column_chunk->statistics() : nullptr;
+  if (stats == nullptr || !stats->HasNullCount()) {
+    return true;
+  }
+  if (name == "isnull") {
+    return stats->null_count() > 0;
+  }
+  return stats->null_count() < column_chunk->num_values();
+}
+
+bool MightMatchComparison(Comparison comparison, const gandiva::FieldNode& field,
+                          const gandiva::LiteralNode& literal,
+                          const ::parquet::RowGroupMetaData& row_group) {
+  Value value;
+  if (!IsComparable(*field.return_type()) || !GetLiteral(literal, &value)) {
+    return true;
+  }
+  int index = GetColumnIndex(field, row_group);
+  if (index < 0) {
+    return true;
+  }
+  auto column_chunk = row_group.ColumnChunk(index);
+  auto stats = column_chunk->is_stats_set() ? column_chunk->statistics() : nullptr;
+  if (stats == nullptr) {
+    return true;
+  }
+  // a comparison to null is never true
+  if (stats->HasNullCount() && stats->null_count() == column_chunk->num_values()) {
+    return false;
+  }
+  Value min;
+  Value max;
+  if (!GetMinMax(*row_group.schema()->Column(index), *stats, &min, &max)) {
+    return true;
+  }
+  return MightCompare(comparison, min, max, value);
+}
+
+}  // namespace
+
+bool StatisticsFilter::MightMatch(const gandiva::Node& node,
+                                  const ::parquet::RowGroupMetaData& row_group) const {
+  if (auto boolean = dynamic_cast<const gandiva::BooleanNode*>(&node)) {
+    bool is_and = boolean->expr_type() == gandiva::BooleanNode::AND;
+    for (const auto& child : boolean->children()) {
+      if (MightMatch(*child, row_group) != is_and) {
+        return !is_and;
+      }
+    }
+    return is_and;
+  }
+  auto function = dynamic_cast<const gandiva::FunctionNode*>(&node);
+  if (function == nullptr) {
+    return true;
+  }
+  const auto& name = function->descriptor()->name();
+  const auto& children = function->children();
+  if ((name == "isnull" || name == "isnotnull") && children.size() == 1) {
+    auto field = dynamic_cast<const gandiva::FieldNode*>(children[0].get());
+    return field == nullptr || MightMatchNullCheck(name, *field, row_group);
+  }
+  Comparison comparison;
+  if (!GetComparison(name, &comparison) || children.size() != 2) {
+    return true;
+  }
+  auto field = dynamic_cast<const gandiva::FieldNode*>(children[0].get());
+  auto literal = dynamic_cast<const gandiva::LiteralNode*>(children[1].get());
+  if (field == nullptr) {
+    field = dynamic_cast<const gandiva::FieldNode*>(children[1].get());
+    literal = dynamic_cast<const gandiva::LiteralNode*>(children[0].get());
+    comparison = Swap(comparison);
+  }
+  if (field == nullptr || literal == nullptr) {
+    return true;
+  }
+  return MightMatchComparison(comparison, *field, *literal, row_group);
+}
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
@@ -0,0 +1,55 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#pragma once
+
+#include <gandiva/node.h>
+#include <parquet/metadata.h>
+
+#include <memory>
+#include <utility>
+
+namespace jni {
+namespace parquet {
+namespace adapters {
+
+/// \brief Whether the rows of a row group might satisfy a condition, decided from the
+/// statistics of its column chunks before any of its data is read
+///
+/// The condition is a tree of and, or, the comparisons of a column to a literal and
+/// isnull / isnotnull of a column, any other node might match every row group. Only
+/// the signed integer and floating point columns are compared.
+class StatisticsFilter {
+ public:
+  explicit StatisticsFilter(std::shared_ptr<gandiva::Node> condition)
+      : condition_(std::move(condition)) {}
+
+  bool MightMatch(const ::parquet::RowGroupMetaData& row_group) const {
+    return MightMatch(*condition_, row_group);
+  }
+
+ private:
+  std::shared_ptr<gandiva::Node> condition_;
+
+  bool MightMatch(const gandiva::Node& node,
+                  const ::parquet::RowGroupMetaData& row_group) const;
+};
+
+}  // namespace adapters
+}  // namespace parquet
+}  // namespace jni
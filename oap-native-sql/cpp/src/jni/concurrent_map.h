@@ -18,6 +18,9 @@
 #ifndef JNI_ID_TO_MODULE_MAP_H
 #define JNI_ID_TO_MODULE_MAP_H
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
@@ -30,6 +33,8 @@ namespace jni {
 
 /**
  * An utility class that map module id to module pointers.
+ * The ids are spread over shards locked each on their own, the lookups of the JNI
+ * calls of concurrent tasks then hardly ever wait on one another.
  * @tparam Holder class of the object to hold.
  */
 template <typename Holder>
@@ -38,20 +43,92 @@ class ConcurrentMap {
   ConcurrentMap() : module_id_(init_module_id_) {}
 
   jlong Insert(Holder holder) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    jlong result = module_id_++;
-    map_.insert(std::pair<jlong, Holder>(result, holder));
+    jlong result = module_id_.fetch_add(1);
+    auto& shard = GetShard(result);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.map.insert(std::pair<jlong, Holder>(result, holder));
     return result;
   }
 
   void Erase(jlong module_id) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    map_.erase(module_id);
+    auto& shard = GetShard(module_id);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.map.erase(module_id);
   }
 
   Holder Lookup(jlong module_id) {
+    auto& shard = GetShard(module_id);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.map.find(module_id);
+    if (it != shard.map.end()) {
+      return it->second;
+    }
+    return NULLPTR;
+  }
+
+  void Clear() {
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mtx);
+      shard.map.clear();
+    }
+  }
+
+  size_t Size() {
+    size_t size = 0;
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mtx);
+      size += shard.map.size();
+    }
+    return size;
+  }
+
+ private:
+  // Initialize the module id starting value to a number greater than zero
+  // to allow for easier debugging of uninitialized java variables.
+  static constexpr int init_module_id_ = 4;
+  // a power of two, consecutive ids are in distinct shards
+  static constexpr int num_shards_ = 64;
+
+  // on a cache line of its own not to be shared by the cores locking the next shards
+  struct alignas(64) Shard {
+    std::mutex mtx;
+    // map from module ids returned to Java and module pointers
+    std::unordered_map<jlong, Holder> map;
+  };
+
+  Shard& GetShard(jlong module_id) {
+    return shards_[static_cast<uint64_t>(module_id) & (num_shards_ - 1)];
+  }
+
+  std::atomic<int64_t> module_id_;
+  std::array<Shard, num_shards_> shards_;
+};
+
+/**
+ * A map of objects registered under ids chosen by their owners, e.g. a broadcast id,
+ * that every thread of the process looking up the same id shares. Objects held as
+ * shared pointers are counted by the map and by each party that looked them up, an
+ * erased object lives until the last of them releases it.
+ * @tparam Holder class of the object to hold.
+ */
+template <typename Holder>
+class SharedMap {
+ public:
+  /// Register holder under id unless another holder already is, return the holder
+  /// registered under id
+  Holder InsertIfAbsent(jlong id, Holder holder) {
     std::lock_guard<std::mutex> lock(mtx_);
-    auto it = map_.find(module_id);
+    return map_.insert(std::pair<jlong, Holder>(id, std::move(holder))).first->second;
+  }
+
+  void Erase(jlong id) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    map_.erase(id);
+  }
+
+  Holder Lookup(jlong id) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = map_.find(id);
     if (it != map_.end()) {
       return it->second;
     }
@@ -69,13 +146,7 @@ class ConcurrentMap {
   }
 
  private:
-  // Initialize the module id starting value to a number greater than zero
-  // to allow for easier debugging of uninitialized java variables.
-  static constexpr int init_module_id_ = 4;
-
-  int64_t module_id_;
   std::mutex mtx_;
-  // map from module ids returned to Java and module pointers
   std::unordered_map<jlong, Holder> map_;
 };
 
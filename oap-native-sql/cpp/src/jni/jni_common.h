@@ -23,6 +23,7 @@
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -148,46 +149,114 @@ std::string JStringToCString(JNIEnv* env, jstring string) {
   return std::string(buffer.data(), clen);
 }
 
+// Schemas and expressions parsed by this process, by their serialized bytes, so that
+// the tasks of a stage building the same plan parse it once. Both are immutable once
+// built and shared by the evaluators of the tasks. Cleared once it holds
+// kMaxParsedPlans, which is more than the distinct plans of the running stages.
+constexpr size_t kMaxParsedPlans = 1024;
+
+struct ParsedExprs {
+  gandiva::ExpressionVector expr_vector;
+  gandiva::FieldVector ret_types;
+};
+
+static std::mutex parsed_plans_mutex;
+static std::unordered_map<std::string, std::shared_ptr<arrow::Schema>> parsed_schemas;
+static std::unordered_map<std::string, ParsedExprs> parsed_exprs;
+
+std::string JByteArrayToString(JNIEnv* env, jbyteArray arr) {
+  std::string bytes(env->GetArrayLength(arr), '\0');
+  env->GetByteArrayRegion(arr, 0, bytes.size(), reinterpret_cast<jbyte*>(&bytes[0]));
+  return bytes;
+}
+
 arrow::Status MakeSchema(JNIEnv* env, jbyteArray schema_arr,
                          std::shared_ptr<arrow::Schema>* schema) {
-  jsize schema_len = env->GetArrayLength(schema_arr);
-  jbyte* schema_bytes = env->GetByteArrayElements(schema_arr, 0);
+  auto bytes = JByteArrayToString(env, schema_arr);
+  {
+    std::lock_guard<std::mutex> lock(parsed_plans_mutex);
+    auto it = parsed_schemas.find(bytes);
+    if (it != parsed_schemas.end()) {
+      *schema = it->second;
+      return arrow::Status::OK();
+    }
+  }
 
-  auto serialized_schema =
-      std::make_shared<arrow::Buffer>((uint8_t*)schema_bytes, schema_len);
+  auto serialized_schema = std::make_shared<arrow::Buffer>(
+      reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
   arrow::ipc::DictionaryMemo in_memo;
   arrow::io::BufferReader buf_reader(serialized_schema);
   *schema = arrow::ipc::ReadSchema(&buf_reader, &in_memo).ValueOrDie();
-  env->ReleaseByteArrayElements(schema_arr, schema_bytes, JNI_ABORT);
 
+  std::lock_guard<std::mutex> lock(parsed_plans_mutex);
+  if (parsed_schemas.size() >= kMaxParsedPlans) {
+    parsed_schemas.clear();
+  }
+  parsed_schemas.emplace(std::move(bytes), *schema);
   return arrow::Status::OK();
 }
 
 arrow::Status MakeExprVector(JNIEnv* env, jbyteArray exprs_arr,
                              gandiva::ExpressionVector* expr_vector,
                              gandiva::FieldVector* ret_types) {
-  exprs::ExpressionList exprs;
-  jsize exprs_len = env->GetArrayLength(exprs_arr);
-  jbyte* exprs_bytes = env->GetByteArrayElements(exprs_arr, 0);
+  auto bytes = JByteArrayToString(env, exprs_arr);
+  {
+    std::lock_guard<std::mutex> lock(parsed_plans_mutex);
+    auto it = parsed_exprs.find(bytes);
+    if (it != parsed_exprs.end()) {
+      auto& parsed = it->second;
+      expr_vector->insert(expr_vector->end(), parsed.expr_vector.begin(),
+                          parsed.expr_vector.end());
+      ret_types->insert(ret_types->end(), parsed.ret_types.begin(),
+                        parsed.ret_types.end());
+      return arrow::Status::OK();
+    }
+  }
 
-  if (!ParseProtobuf(reinterpret_cast<uint8_t*>(exprs_bytes), exprs_len, &exprs)) {
-    env->ReleaseByteArrayElements(exprs_arr, exprs_bytes, JNI_ABORT);
+  exprs::ExpressionList exprs;
+  if (!ParseProtobuf(reinterpret_cast<uint8_t*>(&bytes[0]), bytes.size(), &exprs)) {
     return arrow::Status::UnknownError("Unable to parse");
   }
 
   // create Expression out of the list of exprs
+  ParsedExprs parsed;
   for (int i = 0; i < exprs.exprs_size(); i++) {
     gandiva::ExpressionPtr root = ProtoTypeToExpression(exprs.exprs(i));
 
     if (root == nullptr) {
-      env->ReleaseByteArrayElements(exprs_arr, exprs_bytes, JNI_ABORT);
       return arrow::Status::UnknownError("Unable to construct expression object");
     }
 
-    expr_vector->push_back(root);
-    ret_types->push_back(root->result());
+    parsed.expr_vector.push_back(root);
+    parsed.ret_types.push_back(root->result());
+  }
+  expr_vector->insert(expr_vector->end(), parsed.expr_vector.begin(),
+                      parsed.expr_vector.end());
+  ret_types->insert(ret_types->end(), parsed.ret_types.begin(), parsed.ret_types.end());
+
+  std::lock_guard<std::mutex> lock(parsed_plans_mutex);
+  if (parsed_exprs.size() >= kMaxParsedPlans) {
+    parsed_exprs.clear();
   }
+  parsed_exprs.emplace(std::move(bytes), std::move(parsed));
+  return arrow::Status::OK();
+}
 
+arrow::Status MakeCondition(JNIEnv* env, jbyteArray condition_arr,
+                            gandiva::ConditionPtr* condition) {
+  exprs::Condition proto;
+  jsize condition_len = env->GetArrayLength(condition_arr);
+  jbyte* condition_bytes = env->GetByteArrayElements(condition_arr, 0);
+  bool parsed =
+      ParseProtobuf(reinterpret_cast<uint8_t*>(condition_bytes), condition_len, &proto);
+  env->ReleaseByteArrayElements(condition_arr, condition_bytes, JNI_ABORT);
+  if (!parsed) {
+    return arrow::Status::UnknownError("Unable to parse");
+  }
+  *condition = ProtoTypeToCondition(proto);
+  if (*condition == nullptr) {
+    return arrow::Status::UnknownError("Unable to construct condition object");
+  }
   return arrow::Status::OK();
 }
 
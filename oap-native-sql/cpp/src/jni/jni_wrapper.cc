@@ -24,23 +24,47 @@
 #include <arrow/pretty_print.h>
 #include <arrow/record_batch.h>
 #include <arrow/util/compression.h>
+#include <arrow/util/thread_pool.h>
 #include <jni.h>
+#include <algorithm>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "data_source/parquet/adapter.h"
+#include "data_source/parquet/chunk_cache.h"
 #include "proto/protobuf_utils.h"
 
+#include "codegen/arrow_compute/ext/codegen_common.h"
+#include "codegen/arrow_compute/ext/star_join.h"
 #include "codegen/code_generator_factory.h"
+#include "codegen/common/async_result_iterator.h"
 #include "codegen/common/result_iterator.h"
+#include "codegen/common/runtime_filter.h"
 #include "jni/concurrent_map.h"
 #include "jni/jni_common.h"
+#include "operators/row_converter.h"
+#include "shuffle/batch_serializer.h"
+#include "shuffle/decompressor.h"
+#include "shuffle/partitioner.h"
+#ifdef NATIVESQL_PMEMKV
+#include "shuffle/pmemkv_sink.h"
+#endif
+#include "shuffle/reader.h"
+#ifdef NATIVESQL_RPMP
+#include "shuffle/rpmp_sink.h"
+#endif
 #include "shuffle/splitter.h"
+#include "utils/large_page_memory_pool.h"
+#include "utils/task_memory_pool.h"
+#include "utils/trace.h"
 
 namespace types {
 class ExpressionList;
 }  // namespace types
 
 static jclass arrow_record_batch_builder_class;
+static jclass arrow_record_batch_builder_array_class;
 static jmethodID arrow_record_batch_builder_constructor;
 
 static jclass arrow_field_node_builder_class;
@@ -52,6 +76,9 @@ static jmethodID arrowbuf_builder_constructor;
 static jclass partition_file_info_class;
 static jmethodID partition_file_info_constructor;
 
+static jclass kernel_metrics_class;
+static jmethodID kernel_metrics_constructor;
+
 using arrow::jni::ConcurrentMap;
 static ConcurrentMap<std::shared_ptr<arrow::Buffer>> buffer_holder_;
 
@@ -62,10 +89,108 @@ static arrow::jni::ConcurrentMap<std::shared_ptr<CodeGenerator>> handler_holder_
 static arrow::jni::ConcurrentMap<std::shared_ptr<ResultIterator<arrow::RecordBatch>>>
     batch_iterator_holder_;
 
+// A built join whose hash table the tasks probing the same broadcast relation share,
+// each through result iterators of its own
+struct SharedBuild {
+  std::shared_ptr<CodeGenerator> handler;
+  // making result iterators isn't thread safe
+  std::mutex mutex;
+};
+// by broadcast id
+static arrow::jni::SharedMap<std::shared_ptr<SharedBuild>> shared_build_holder_;
+
 using sparkcolumnarplugin::shuffle::Splitter;
 static arrow::jni::ConcurrentMap<std::shared_ptr<Splitter>> shuffle_splitter_holder_;
-static arrow::jni::ConcurrentMap<std::shared_ptr<arrow::Schema>>
-    decompression_schema_holder_;
+using sparkcolumnarplugin::shuffle::Decompressor;
+using sparkcolumnarplugin::shuffle::ShuffleReader;
+static arrow::jni::ConcurrentMap<std::shared_ptr<Decompressor>> decompressor_holder_;
+using sparkcolumnarplugin::shuffle::RangeSampler;
+static arrow::jni::ConcurrentMap<std::shared_ptr<RangeSampler>> range_sampler_holder_;
+using sparkcolumnarplugin::operators::RowConverter;
+static arrow::jni::ConcurrentMap<std::shared_ptr<RowConverter>> row_converter_holder_;
+
+static JavaVM* java_vm;
+
+static jclass reservation_listener_class;
+static jmethodID reservation_listener_reserve;
+static jmethodID reservation_listener_unreserve;
+
+// Reserves the memory of a task memory pool from the ReservationListener of its Java
+// task, on whatever thread allocates
+class JavaReservationListener : public sparkcolumnarplugin::ReservationListener {
+ public:
+  JavaReservationListener(JNIEnv* env, jobject listener)
+      : listener_(env->NewGlobalRef(listener)) {}
+
+  ~JavaReservationListener() override {
+    JNIEnv* env;
+    if (java_vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION) == JNI_OK) {
+      env->DeleteGlobalRef(listener_);
+    }
+  }
+
+  arrow::Status Reserve(int64_t bytes) override {
+    JNIEnv* env;
+    RETURN_NOT_OK(AttachEnv(&env));
+    jboolean granted =
+        env->CallBooleanMethod(listener_, reservation_listener_reserve, (jlong)bytes);
+    if (env->ExceptionCheck()) {
+      env->ExceptionClear();
+      return arrow::Status::OutOfMemory("ReservationListener.reserve failed");
+    }
+    if (!granted) {
+      return arrow::Status::OutOfMemory("ReservationListener denied ", bytes, " bytes");
+    }
+    return arrow::Status::OK();
+  }
+
+  void Unreserve(int64_t bytes) override {
+    JNIEnv* env;
+    if (!AttachEnv(&env).ok()) {
+      return;
+    }
+    env->CallVoidMethod(listener_, reservation_listener_unreserve, (jlong)bytes);
+    if (env->ExceptionCheck()) {
+      env->ExceptionClear();
+    }
+  }
+
+ private:
+  // threads of native kernels are attached as daemons, which don't keep the JVM alive
+  static arrow::Status AttachEnv(JNIEnv** env) {
+    auto result = java_vm->GetEnv(reinterpret_cast<void**>(env), JNI_VERSION);
+    if (result == JNI_EDETACHED) {
+      result = java_vm->AttachCurrentThreadAsDaemon(reinterpret_cast<void**>(env),
+                                                    nullptr);
+    }
+    if (result != JNI_OK) {
+      return arrow::Status::Invalid("Failed to attach the thread to the JVM");
+    }
+    return arrow::Status::OK();
+  }
+
+  jobject listener_;
+};
+
+using sparkcolumnarplugin::TaskMemoryPool;
+static arrow::jni::ConcurrentMap<std::shared_ptr<TaskMemoryPool>> memory_pool_holder_;
+// released by Java while some of their memory is still allocated
+static std::mutex retired_memory_pools_mutex_;
+static std::vector<std::shared_ptr<TaskMemoryPool>> retired_memory_pools_;
+
+// The task memory pool of id, the default memory pool of the kernels if id is 0
+arrow::MemoryPool* GetMemoryPool(JNIEnv* env, jlong id) {
+  if (id == 0) {
+    return sparkcolumnarplugin::LargePageMemoryPool::Default();
+  }
+  auto pool = memory_pool_holder_.Lookup(id);
+  if (!pool) {
+    std::string error_message = "invalid memory pool id " + std::to_string(id);
+    env->ThrowNew(illegal_argument_exception_class, error_message.c_str());
+    return sparkcolumnarplugin::LargePageMemoryPool::Default();
+  }
+  return pool.get();
+}
 
 std::shared_ptr<CodeGenerator> GetCodeGenerator(JNIEnv* env, jlong id) {
   auto handler = handler_holder_.Lookup(id);
@@ -86,6 +211,17 @@ std::shared_ptr<ResultIterator<arrow::RecordBatch>> GetBatchIterator(JNIEnv* env
   return handler;
 }
 
+// Produce the batches of iter ahead of the JVM reading them, see GetIteratorPrefetch
+std::shared_ptr<ResultIterator<arrow::RecordBatch>> MaybePrefetch(
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> iter) {
+  auto prefetch = sparkcolumnarplugin::codegen::arrowcompute::extra::GetIteratorPrefetch();
+  if (prefetch == 0 || iter == nullptr) {
+    return iter;
+  }
+  return std::make_shared<AsyncResultIterator<arrow::RecordBatch>>(std::move(iter),
+                                                                   prefetch);
+}
+
 std::shared_ptr<Splitter> GetShuffleSplitter(JNIEnv* env, jlong id) {
   auto splitter = shuffle_splitter_holder_.Lookup(id);
   if (!splitter) {
@@ -96,6 +232,59 @@ std::shared_ptr<Splitter> GetShuffleSplitter(JNIEnv* env, jlong id) {
   return splitter;
 }
 
+// Evaluate the batches of a blob of SerializeBatches on handler, e.g. a broadcast build
+// side, the uncompressed buffers of the batches sliced from the copy of the blob
+arrow::Status EvaluateSerialized(JNIEnv* env,
+                                 const std::shared_ptr<CodeGenerator>& handler,
+                                 jbyteArray serialized) {
+  std::shared_ptr<arrow::Schema> schema;
+  RETURN_NOT_OK(handler->getSchema(&schema));
+  auto size = env->GetArrayLength(serialized);
+  ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> blob, arrow::AllocateBuffer(size));
+  env->GetByteArrayRegion(serialized, 0, size,
+                          reinterpret_cast<jbyte*>(blob->mutable_data()));
+  ARROW_ASSIGN_OR_RAISE(auto reader, ShuffleReader::Make({std::move(blob)}, schema));
+  while (reader->HasNext()) {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    RETURN_NOT_OK(reader->Next(&batch));
+    std::vector<std::shared_ptr<arrow::RecordBatch>> out;
+    RETURN_NOT_OK(handler->evaluate(batch, &out));
+  }
+  return arrow::Status::OK();
+}
+
+// Codec of a case insensitive name, e.g. "lz4", LZ4 as the LZ4_FRAME of the IPC format.
+// A null name is UNCOMPRESSED.
+arrow::Result<arrow::Compression::type> GetCompressionCodec(JNIEnv* env,
+                                                            jstring codec_jstr) {
+  auto compression_codec = arrow::Compression::UNCOMPRESSED;
+  if (codec_jstr == nullptr) {
+    return compression_codec;
+  }
+  auto codec_l = env->GetStringUTFChars(codec_jstr, JNI_FALSE);
+  if (codec_l != nullptr) {
+    std::string codec_u;
+    std::transform(codec_l, codec_l + std::strlen(codec_l), std::back_inserter(codec_u),
+                   ::toupper);
+    env->ReleaseStringUTFChars(codec_jstr, codec_l);
+    ARROW_ASSIGN_OR_RAISE(compression_codec,
+                          arrow::util::Codec::GetCompressionType(codec_u));
+    if (compression_codec == arrow::Compression::LZ4) {
+      compression_codec = arrow::Compression::LZ4_FRAME;
+    }
+  }
+  return compression_codec;
+}
+
+// Flags of a boolean array, e.g. the direction of each range partitioning key
+std::vector<bool> MakeFlags(JNIEnv* env, jbooleanArray flags_arr) {
+  auto num_flags = env->GetArrayLength(flags_arr);
+  jboolean* flags = env->GetBooleanArrayElements(flags_arr, JNI_FALSE);
+  std::vector<bool> result(flags, flags + num_flags);
+  env->ReleaseBooleanArrayElements(flags_arr, flags, JNI_ABORT);
+  return result;
+}
+
 jobject MakeRecordBatchBuilder(JNIEnv* env, std::shared_ptr<arrow::Schema> schema,
                                std::shared_ptr<arrow::RecordBatch> record_batch) {
   jobjectArray field_array =
@@ -141,6 +330,44 @@ jobject MakeRecordBatchBuilder(JNIEnv* env, std::shared_ptr<arrow::Schema> schem
   return arrow_record_batch_builder;
 }
 
+// The record batch as a single long array, with no Java object per column or buffer:
+// the number of rows and of fields, the length and null count of each field, then the
+// number of buffers and the holder id, address, size and capacity of each buffer. See
+// ArrowRecordBatchBuilderImpl.build(long[]).
+jlongArray MakeRecordBatchInfo(JNIEnv* env,
+                               std::shared_ptr<arrow::RecordBatch> record_batch) {
+  std::vector<jlong> info;
+  std::vector<std::shared_ptr<arrow::Buffer>> buffers;
+  info.push_back(record_batch->num_rows());
+  info.push_back(record_batch->num_columns());
+  for (int i = 0; i < record_batch->num_columns(); ++i) {
+    auto column = record_batch->column(i);
+    info.push_back(column->length());
+    info.push_back(column->null_count());
+    for (auto& buffer : column->data()->buffers) {
+      buffers.push_back(buffer);
+    }
+  }
+  info.push_back(buffers.size());
+  for (auto& buffer : buffers) {
+    jlong address = 0;
+    jlong size = 0;
+    jlong capacity = 0;
+    if (buffer != nullptr) {
+      address = reinterpret_cast<jlong>(buffer->data());
+      size = buffer->size();
+      capacity = buffer->capacity();
+    }
+    info.push_back(buffer_holder_.Insert(std::move(buffer)));
+    info.push_back(address);
+    info.push_back(size);
+    info.push_back(capacity);
+  }
+  jlongArray info_array = env->NewLongArray(info.size());
+  env->SetLongArrayRegion(info_array, 0, info.size(), info.data());
+  return info_array;
+}
+
 using FileSystem = arrow::fs::FileSystem;
 using ParquetFileReader = jni::parquet::adapters::ParquetFileReader;
 using ParquetFileWriter = jni::parquet::adapters::ParquetFileWriter;
@@ -166,6 +393,46 @@ std::shared_ptr<ParquetFileWriter> GetFileWriter(JNIEnv* env, jlong id) {
   return writer;
 }
 
+// The record batches of a multi-batch call, batch i of num_rows[i] rows over the buffers
+// at buf_addrs[i] of sizes buf_sizes[i]. The addresses are copied out of the arrays of
+// each batch, which are small, rather than pinned.
+arrow::Status MakeRecordBatches(JNIEnv* env, const std::shared_ptr<arrow::Schema>& schema,
+                                jintArray num_rows_arr, jobjectArray buf_addrs_arr,
+                                jobjectArray buf_sizes_arr,
+                                std::vector<std::shared_ptr<arrow::RecordBatch>>* out) {
+  auto num_batches = env->GetArrayLength(num_rows_arr);
+  if (num_batches != env->GetArrayLength(buf_addrs_arr) ||
+      num_batches != env->GetArrayLength(buf_sizes_arr)) {
+    return arrow::Status::Invalid("mismatch in arraylen of num_rows, buf_addrs and ",
+                                  "buf_sizes");
+  }
+  std::vector<jint> num_rows(num_batches);
+  env->GetIntArrayRegion(num_rows_arr, 0, num_batches, num_rows.data());
+  std::vector<jlong> addrs;
+  std::vector<jlong> sizes;
+  for (int i = 0; i < num_batches; ++i) {
+    auto addrs_arr = (jlongArray)env->GetObjectArrayElement(buf_addrs_arr, i);
+    auto sizes_arr = (jlongArray)env->GetObjectArrayElement(buf_sizes_arr, i);
+    auto bufs_len = env->GetArrayLength(addrs_arr);
+    auto sizes_len = env->GetArrayLength(sizes_arr);
+    addrs.resize(bufs_len);
+    sizes.resize(sizes_len);
+    env->GetLongArrayRegion(addrs_arr, 0, bufs_len, addrs.data());
+    env->GetLongArrayRegion(sizes_arr, 0, sizes_len, sizes.data());
+    env->DeleteLocalRef(addrs_arr);
+    env->DeleteLocalRef(sizes_arr);
+    if (bufs_len != sizes_len) {
+      return arrow::Status::Invalid("mismatch in arraylen of buf_addrs and buf_sizes of ",
+                                    "batch ", i);
+    }
+    std::shared_ptr<arrow::RecordBatch> batch;
+    RETURN_NOT_OK(MakeRecordBatch(schema, num_rows[i], (int64_t*)addrs.data(),
+                                  (int64_t*)sizes.data(), bufs_len, &batch));
+    out->push_back(std::move(batch));
+  }
+  return arrow::Status::OK();
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -189,6 +456,9 @@ jint JNI_OnLoad(JavaVM* vm, void* reserved) {
                   "(I[Lcom/intel/oap/vectorized/ArrowFieldNodeBuilder;"
                   "[Lcom/intel/oap/vectorized/ArrowBufBuilder;)V");
 
+  arrow_record_batch_builder_array_class = CreateGlobalClassReference(
+      env, "[Lcom/intel/oap/vectorized/ArrowRecordBatchBuilder;");
+
   arrow_field_node_builder_class = CreateGlobalClassReference(
       env, "Lcom/intel/oap/vectorized/ArrowFieldNodeBuilder;");
   arrow_field_node_builder_constructor =
@@ -204,6 +474,19 @@ jint JNI_OnLoad(JavaVM* vm, void* reserved) {
   partition_file_info_constructor =
       GetMethodID(env, partition_file_info_class, "<init>", "(ILjava/lang/String;)V");
 
+  kernel_metrics_class =
+      CreateGlobalClassReference(env, "Lcom/intel/oap/vectorized/KernelMetrics;");
+  kernel_metrics_constructor =
+      GetMethodID(env, kernel_metrics_class, "<init>", "(Ljava/lang/String;JJJJJJJ)V");
+
+  java_vm = vm;
+  reservation_listener_class = CreateGlobalClassReference(
+      env, "Lcom/intel/oap/vectorized/ReservationListener;");
+  reservation_listener_reserve =
+      GetMethodID(env, reservation_listener_class, "reserve", "(J)Z");
+  reservation_listener_unreserve =
+      GetMethodID(env, reservation_listener_class, "unreserve", "(J)V");
+
   return JNI_VERSION;
 }
 
@@ -219,13 +502,20 @@ void JNI_OnUnload(JavaVM* vm, void* reserved) {
   env->DeleteGlobalRef(arrow_field_node_builder_class);
   env->DeleteGlobalRef(arrowbuf_builder_class);
   env->DeleteGlobalRef(arrow_record_batch_builder_class);
+  env->DeleteGlobalRef(arrow_record_batch_builder_array_class);
   env->DeleteGlobalRef(partition_file_info_class);
+  env->DeleteGlobalRef(kernel_metrics_class);
+  env->DeleteGlobalRef(reservation_listener_class);
 
   buffer_holder_.Clear();
   handler_holder_.Clear();
   batch_iterator_holder_.Clear();
+  shared_build_holder_.Clear();
   shuffle_splitter_holder_.Clear();
-  decompression_schema_holder_.Clear();
+  decompressor_holder_.Clear();
+  range_sampler_holder_.Clear();
+  row_converter_holder_.Clear();
+  memory_pool_holder_.Clear();
 }
 
 JNIEXPORT void JNICALL
@@ -243,10 +533,83 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetBatchSize(
   setenv("NATIVESQL_BATCH_SIZE", std::to_string(batch_size).c_str(), 1);
 }
 
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetKernelStore(
+    JNIEnv* env, jobject obj, jstring uriObj) {
+  setenv("NATIVESQL_KERNEL_STORE", JStringToCString(env, uriObj).c_str(), 1);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetJoinMemoryBudget(
+    JNIEnv* env, jobject obj, jlong budget) {
+  setenv("NATIVESQL_JOIN_MEMORY_BUDGET", std::to_string(budget).c_str(), 1);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetJoinBuildThreads(
+    JNIEnv* env, jobject obj, jint num_threads) {
+  setenv("NATIVESQL_JOIN_BUILD_THREADS", std::to_string(num_threads).c_str(), 1);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetSortThreads(
+    JNIEnv* env, jobject obj, jint num_threads) {
+  setenv("NATIVESQL_SORT_THREADS", std::to_string(num_threads).c_str(), 1);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetAggregateThreads(
+    JNIEnv* env, jobject obj, jint num_threads) {
+  setenv("NATIVESQL_AGGREGATE_THREADS", std::to_string(num_threads).c_str(), 1);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetExecutorThreads(
+    JNIEnv* env, jobject obj, jint num_threads, jint task_parallelism) {
+  setenv("NATIVESQL_EXECUTOR_THREADS", std::to_string(num_threads).c_str(), 1);
+  setenv("NATIVESQL_TASK_PARALLELISM", std::to_string(task_parallelism).c_str(), 1);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetLargePages(
+    JNIEnv* env, jobject obj, jlong threshold, jboolean explicit_pages,
+    jboolean bind_numa) {
+  setenv("NATIVESQL_LARGE_PAGE_THRESHOLD", std::to_string(threshold).c_str(), 1);
+  setenv("NATIVESQL_LARGE_PAGE_EXPLICIT", explicit_pages ? "true" : "false", 1);
+  setenv("NATIVESQL_LARGE_PAGE_NUMA", bind_numa ? "true" : "false", 1);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetPrecompiledKernels(
+    JNIEnv* env, jobject obj, jboolean enabled) {
+  setenv("NATIVESQL_PRECOMPILED_KERNELS", enabled ? "true" : "false", 1);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeWarmUpKernels(
+    JNIEnv* env, jobject obj, jobjectArray signatures_arr) {
+  TRACE_SPAN("jni", __func__);
+  std::vector<std::string> signatures;
+  auto num_signatures = env->GetArrayLength(signatures_arr);
+  for (jsize i = 0; i < num_signatures; ++i) {
+    auto signature =
+        static_cast<jstring>(env->GetObjectArrayElement(signatures_arr, i));
+    signatures.push_back(JStringToCString(env, signature));
+    env->DeleteLocalRef(signature);
+  }
+  auto status =
+      sparkcolumnarplugin::codegen::arrowcompute::extra::WarmUpKernels(signatures);
+  if (!status.ok()) {
+    std::string error_message = "nativeWarmUpKernels: " + status.message();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+  }
+}
+
 JNIEXPORT jlong JNICALL
 Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeBuild(
     JNIEnv* env, jobject obj, jbyteArray schema_arr, jbyteArray exprs_arr,
-    jbyteArray res_schema_arr, jboolean return_when_finish = false) {
+    jbyteArray res_schema_arr, jboolean return_when_finish, jlong memory_pool_id) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
 
   std::shared_ptr<arrow::Schema> schema;
@@ -280,8 +643,9 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeBuild(
   }
 
   std::shared_ptr<CodeGenerator> handler;
-  msg = sparkcolumnarplugin::codegen::CreateCodeGenerator(schema, expr_vector, ret_types,
-                                                          &handler, return_when_finish);
+  msg = sparkcolumnarplugin::codegen::CreateCodeGenerator(
+      schema, expr_vector, ret_types, &handler, return_when_finish, {},
+      GetMemoryPool(env, memory_pool_id));
   if (!msg.ok()) {
     std::string error_message =
         "nativeBuild: failed to create CodeGenerator, err msg is " + msg.message();
@@ -304,7 +668,8 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeBuild(
 JNIEXPORT jlong JNICALL
 Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeBuildWithFinish(
     JNIEnv* env, jobject obj, jbyteArray schema_arr, jbyteArray exprs_arr,
-    jbyteArray finish_exprs_arr) {
+    jbyteArray finish_exprs_arr, jlong memory_pool_id) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
 
   std::shared_ptr<arrow::Schema> schema;
@@ -334,7 +699,8 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeBuildWithFinis
 
   std::shared_ptr<CodeGenerator> handler;
   msg = sparkcolumnarplugin::codegen::CreateCodeGenerator(
-      schema, expr_vector, ret_types, &handler, true, finish_expr_vector);
+      schema, expr_vector, ret_types, &handler, true, finish_expr_vector,
+      GetMemoryPool(env, memory_pool_id));
   if (!msg.ok()) {
     std::string error_message =
         "nativeBuild: failed to create CodeGenerator, err msg is " + msg.message();
@@ -343,6 +709,47 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeBuildWithFinis
   return handler_holder_.Insert(std::move(handler));
 }
 
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeCreateMemoryPool(
+    JNIEnv* env, jobject obj, jobject listener) {
+  auto pool = std::make_shared<TaskMemoryPool>(
+      sparkcolumnarplugin::LargePageMemoryPool::Default(),
+      std::make_shared<JavaReservationListener>(env, listener));
+  return memory_pool_holder_.Insert(std::move(pool));
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSpillMemoryPool(
+    JNIEnv* env, jobject obj, jlong id, jlong size) {
+  auto pool = memory_pool_holder_.Lookup(id);
+  if (!pool) {
+    std::string error_message = "invalid memory pool id " + std::to_string(id);
+    env->ThrowNew(illegal_argument_exception_class, error_message.c_str());
+    return 0;
+  }
+  return (jlong)pool->Spill((int64_t)size);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeReleaseMemoryPool(
+    JNIEnv* env, jobject obj, jlong id) {
+  auto pool = memory_pool_holder_.Lookup(id);
+  memory_pool_holder_.Erase(id);
+  if (!pool) {
+    return;
+  }
+  // buffers of the pool may still be held by Java or by kernels not closed yet, which
+  // free them through a raw pointer to the pool. The pool is kept until they have.
+  std::lock_guard<std::mutex> lock(retired_memory_pools_mutex_);
+  retired_memory_pools_.push_back(std::move(pool));
+  retired_memory_pools_.erase(
+      std::remove_if(retired_memory_pools_.begin(), retired_memory_pools_.end(),
+                     [](const std::shared_ptr<TaskMemoryPool>& retired) {
+                       return retired->bytes_allocated() == 0;
+                     }),
+      retired_memory_pools_.end());
+}
+
 JNIEXPORT void JNICALL
 Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetReturnFields(
     JNIEnv* env, jobject obj, jlong id, jbyteArray schema_arr) {
@@ -384,6 +791,7 @@ JNIEXPORT jobject JNICALL
 Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeEvaluate(
     JNIEnv* env, jobject obj, jlong id, jint num_rows, jlongArray buf_addrs,
     jlongArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
   std::shared_ptr<arrow::Schema> schema;
@@ -428,11 +836,61 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeEvaluate(
   return record_batch_builder_array;
 }
 
+JNIEXPORT jobjectArray JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeEvaluateBatches(
+    JNIEnv* env, jobject obj, jlong id, jintArray num_rows, jobjectArray buf_addrs,
+    jobjectArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
+  std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
+  std::shared_ptr<arrow::Schema> schema;
+  std::shared_ptr<arrow::Schema> res_schema;
+  auto status = handler->getSchema(&schema);
+  if (status.ok()) {
+    status = handler->getResSchema(&res_schema);
+  }
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> in;
+  if (status.ok()) {
+    status = MakeRecordBatches(env, schema, num_rows, buf_addrs, buf_sizes, &in);
+  }
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeEvaluateBatches: make record batches failed with error msg " +
+        status.ToString();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return nullptr;
+  }
+
+  jobjectArray result =
+      env->NewObjectArray(in.size(), arrow_record_batch_builder_array_class, nullptr);
+  for (size_t i = 0; i < in.size(); ++i) {
+    std::vector<std::shared_ptr<arrow::RecordBatch>> out;
+    status = handler->evaluate(in[i], &out);
+    if (!status.ok()) {
+      std::string error_message =
+          "nativeEvaluateBatches: evaluate failed with error msg " + status.ToString();
+      env->ThrowNew(io_exception_class, error_message.c_str());
+      return nullptr;
+    }
+    jobjectArray record_batch_builder_array =
+        env->NewObjectArray(out.size(), arrow_record_batch_builder_class, nullptr);
+    for (size_t j = 0; j < out.size(); ++j) {
+      jobject record_batch_builder = MakeRecordBatchBuilder(env, res_schema, out[j]);
+      env->SetObjectArrayElement(record_batch_builder_array, j, record_batch_builder);
+      env->DeleteLocalRef(record_batch_builder);
+    }
+    env->SetObjectArrayElement(result, i, record_batch_builder_array);
+    env->DeleteLocalRef(record_batch_builder_array);
+  }
+  return result;
+}
+
 JNIEXPORT jobject JNICALL
 Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeEvaluateWithSelection(
     JNIEnv* env, jobject obj, jlong id, jint num_rows, jlongArray buf_addrs,
     jlongArray buf_sizes, jint selection_vector_count, jlong selection_vector_buf_addr,
     jlong selection_vector_buf_size) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
   std::shared_ptr<arrow::Schema> schema;
@@ -485,10 +943,27 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeEvaluateWithSe
   return record_batch_builder_array;
 }
 
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeEvaluateSerialized(
+    JNIEnv* env, jobject obj, jlong id, jbyteArray serialized) {
+  TRACE_SPAN("jni", __func__);
+  std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
+  if (!handler) {
+    return;
+  }
+  auto status = EvaluateSerialized(env, handler, serialized);
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeEvaluateSerialized: evaluate failed with error msg " + status.ToString();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+  }
+}
+
 JNIEXPORT void JNICALL
 Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetMember(
     JNIEnv* env, jobject obj, jlong id, jint num_rows, jlongArray buf_addrs,
     jlongArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
   std::shared_ptr<arrow::Schema> schema;
@@ -523,6 +998,7 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetMember(
 JNIEXPORT jobject JNICALL
 Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeFinish(
     JNIEnv* env, jobject obj, jlong id) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
   std::vector<std::shared_ptr<arrow::RecordBatch>> out;
@@ -551,6 +1027,7 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeFinish(
 JNIEXPORT jlong JNICALL
 Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeFinishByIterator(
     JNIEnv* env, jobject obj, jlong id) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
   std::shared_ptr<ResultIterator<arrow::RecordBatch>> out;
@@ -561,12 +1038,159 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeFinishByIterat
     env->ThrowNew(io_exception_class, error_message.c_str());
   }
 
-  return batch_iterator_holder_.Insert(std::move(out));
+  return batch_iterator_holder_.Insert(MaybePrefetch(std::move(out)));
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeGetMetrics(
+    JNIEnv* env, jobject obj, jlong id) {
+  std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
+  if (!handler) {
+    return nullptr;
+  }
+  std::vector<sparkcolumnarplugin::codegen::KernelMetrics> metrics;
+  auto status = handler->GetMetrics(&metrics);
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeGetMetrics: failed with error msg " + status.ToString();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return nullptr;
+  }
+
+  jobjectArray metrics_array =
+      env->NewObjectArray(metrics.size(), kernel_metrics_class, nullptr);
+  for (size_t i = 0; i < metrics.size(); i++) {
+    const auto& m = metrics[i];
+    jobject metrics_obj = env->NewObject(
+        kernel_metrics_class, kernel_metrics_constructor,
+        env->NewStringUTF(m.name.c_str()), m.evaluate_nanos, m.num_input_rows,
+        m.num_output_rows, m.hash_table_size, m.probe_chain_length, m.spill_bytes,
+        m.codegen_nanos);
+    env->SetObjectArrayElement(metrics_array, i, metrics_obj);
+  }
+  return metrics_array;
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeDumpTrace(
+    JNIEnv* env, jobject obj, jstring file_name) {
+  auto status = sparkcolumnarplugin::DumpTrace(JStringToCString(env, file_name));
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeDumpTrace: failed with error msg " + status.ToString();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeShareBuild(
+    JNIEnv* env, jobject obj, jlong id, jlong broadcast_id) {
+  std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
+  if (!handler) {
+    return;
+  }
+  auto shared = std::make_shared<SharedBuild>();
+  shared->handler = std::move(handler);
+  // a task racing this one may have shared its own build first, keep it
+  shared_build_holder_.InsertIfAbsent(broadcast_id, std::move(shared));
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeAttachSharedBuild(
+    JNIEnv* env, jobject obj, jlong broadcast_id) {
+  TRACE_SPAN("jni", __func__);
+  auto shared = shared_build_holder_.Lookup(broadcast_id);
+  if (!shared) {
+    return 0;
+  }
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> out;
+  arrow::Status status;
+  {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    status = shared->handler->finish(&out);
+  }
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeAttachSharedBuild: finish failed with error msg " + status.ToString();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return 0;
+  }
+  return batch_iterator_holder_.Insert(MaybePrefetch(std::move(out)));
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeAttachStarJoin(
+    JNIEnv* env, jobject obj, jbyteArray fact_schema_arr, jlongArray broadcast_ids,
+    jintArray join_types, jobjectArray key_indices, jlong memory_pool_id) {
+  TRACE_SPAN("jni", __func__);
+  std::shared_ptr<arrow::Schema> fact_schema;
+  arrow::Status status = MakeSchema(env, fact_schema_arr, &fact_schema);
+  if (!status.ok()) {
+    std::string error_message = "failed to readSchema, err msg is " + status.message();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return 0;
+  }
+  auto num_dimensions = env->GetArrayLength(broadcast_ids);
+  if (env->GetArrayLength(join_types) != num_dimensions ||
+      env->GetArrayLength(key_indices) != num_dimensions) {
+    env->ThrowNew(illegal_argument_exception_class,
+                  "nativeAttachStarJoin: one join type and key list per dimension");
+    return 0;
+  }
+  jlong* ids = env->GetLongArrayElements(broadcast_ids, 0);
+  jint* types = env->GetIntArrayElements(join_types, 0);
+  std::vector<sparkcolumnarplugin::codegen::arrowcompute::extra::StarJoinDimension>
+      dimensions(num_dimensions);
+  bool all_shared = true;
+  for (jsize d = 0; d < num_dimensions && status.ok(); d++) {
+    auto shared = shared_build_holder_.Lookup(ids[d]);
+    if (!shared) {
+      all_shared = false;
+      break;
+    }
+    {
+      std::lock_guard<std::mutex> lock(shared->mutex);
+      status = shared->handler->finish(&dimensions[d].build);
+    }
+    dimensions[d].join_type = types[d];
+    auto keys = static_cast<jintArray>(env->GetObjectArrayElement(key_indices, d));
+    jint* key_elements = env->GetIntArrayElements(keys, 0);
+    dimensions[d].key_indices.assign(key_elements,
+                                     key_elements + env->GetArrayLength(keys));
+    env->ReleaseIntArrayElements(keys, key_elements, JNI_ABORT);
+    env->DeleteLocalRef(keys);
+  }
+  env->ReleaseLongArrayElements(broadcast_ids, ids, JNI_ABORT);
+  env->ReleaseIntArrayElements(join_types, types, JNI_ABORT);
+  if (status.ok() && (!all_shared || dimensions.empty())) {
+    // some build isn't shared (anymore), the caller falls back to a join per dimension
+    return 0;
+  }
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> out;
+  if (status.ok()) {
+    status = sparkcolumnarplugin::codegen::arrowcompute::extra::MakeStarJoinIterator(
+        GetMemoryPool(env, memory_pool_id), fact_schema, std::move(dimensions), &out);
+  }
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeAttachStarJoin: failed with error msg " + status.ToString();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return 0;
+  }
+  return batch_iterator_holder_.Insert(MaybePrefetch(std::move(out)));
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeReleaseSharedBuild(
+    JNIEnv* env, jobject obj, jlong broadcast_id) {
+  // the iterators attached so far keep the table until they are closed
+  shared_build_holder_.Erase(broadcast_id);
 }
 
 JNIEXPORT void JNICALL
 Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetDependency(
     JNIEnv* env, jobject obj, jlong id, jlong iter_id, int index) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<CodeGenerator> handler = GetCodeGenerator(env, id);
   auto iter = GetBatchIterator(env, iter_id);
@@ -578,28 +1202,28 @@ Java_com_intel_oap_vectorized_ExpressionEvaluatorJniWrapper_nativeSetDependency(
   }
 }
 
-JNIEXPORT jobject JNICALL
-Java_com_intel_oap_vectorized_BatchIterator_nativeNext(JNIEnv* env,
-                                                                       jobject obj,
-                                                                       jlong id) {
-  arrow::Status status;
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_oap_vectorized_BatchIterator_nativeNextBatch(JNIEnv* env, jobject obj,
+                                                            jlong id) {
+  TRACE_SPAN("jni", __func__);
   auto iter = GetBatchIterator(env, id);
   std::shared_ptr<arrow::RecordBatch> out;
   if (!iter->HasNext()) return nullptr;
-  status = iter->Next(&out);
+  auto status = iter->Next(&out);
   if (!status.ok()) {
     std::string error_message =
-        "nativeNext: get Next() failed with error msg " + status.ToString();
+        "nativeNextBatch: get Next() failed with error msg " + status.ToString();
     env->ThrowNew(io_exception_class, error_message.c_str());
+    return nullptr;
   }
-
-  return MakeRecordBatchBuilder(env, out->schema(), out);
+  return MakeRecordBatchInfo(env, out);
 }
 
 JNIEXPORT jobject JNICALL
 Java_com_intel_oap_vectorized_BatchIterator_nativeProcess(
     JNIEnv* env, jobject obj, jlong id, jbyteArray schema_arr, jint num_rows,
     jlongArray buf_addrs, jlongArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<arrow::Schema> schema;
   arrow::Status msg = MakeSchema(env, schema_arr, &schema);
@@ -643,11 +1267,70 @@ Java_com_intel_oap_vectorized_BatchIterator_nativeProcess(
   return MakeRecordBatchBuilder(env, out->schema(), out);
 }
 
+JNIEXPORT jobjectArray JNICALL
+Java_com_intel_oap_vectorized_BatchIterator_nativeProcessBatches(
+    JNIEnv* env, jobject obj, jlong id, jbyteArray schema_arr, jintArray num_rows,
+    jobjectArray buf_addrs, jobjectArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
+  std::shared_ptr<arrow::Schema> schema;
+  auto status = MakeSchema(env, schema_arr, &schema);
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  if (status.ok()) {
+    status = MakeRecordBatches(env, schema, num_rows, buf_addrs, buf_sizes, &batches);
+  }
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeProcessBatches: make record batches failed with error msg " +
+        status.ToString();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return nullptr;
+  }
+
+  auto iter = GetBatchIterator(env, id);
+  jobjectArray record_batch_builder_array =
+      env->NewObjectArray(batches.size(), arrow_record_batch_builder_class, nullptr);
+  for (size_t i = 0; i < batches.size(); ++i) {
+    std::shared_ptr<arrow::RecordBatch> out;
+    status = iter->Process(batches[i]->columns(), &out);
+    if (!status.ok()) {
+      std::string error_message =
+          "nativeProcessBatches: ResultIterator process next failed with error msg " +
+          status.ToString();
+      env->ThrowNew(io_exception_class, error_message.c_str());
+      return nullptr;
+    }
+    jobject record_batch_builder = MakeRecordBatchBuilder(env, out->schema(), out);
+    env->SetObjectArrayElement(record_batch_builder_array, i, record_batch_builder);
+    env->DeleteLocalRef(record_batch_builder);
+  }
+  return record_batch_builder_array;
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_intel_oap_vectorized_BatchIterator_nativeProcessRemaining(JNIEnv* env,
+                                                                   jobject obj,
+                                                                   jlong id) {
+  TRACE_SPAN("jni", __func__);
+  auto iter = GetBatchIterator(env, id);
+  std::shared_ptr<arrow::RecordBatch> out;
+  auto status = iter->ProcessRemaining(&out);
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeProcessRemaining: ResultIterator failed with error msg " +
+        status.ToString();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return nullptr;
+  }
+  if (out == nullptr) return nullptr;
+  return MakeRecordBatchBuilder(env, out->schema(), out);
+}
+
 JNIEXPORT jobject JNICALL
 Java_com_intel_oap_vectorized_BatchIterator_nativeProcessWithSelection(
     JNIEnv* env, jobject obj, jlong id, jbyteArray schema_arr, jint num_rows,
     jlongArray buf_addrs, jlongArray buf_sizes, jint selection_vector_count,
     jlong selection_vector_buf_addr, jlong selection_vector_buf_size) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<arrow::Schema> schema;
   arrow::Status msg = MakeSchema(env, schema_arr, &schema);
@@ -703,6 +1386,7 @@ JNIEXPORT void JNICALL
 Java_com_intel_oap_vectorized_BatchIterator_nativeProcessAndCacheOne(
     JNIEnv* env, jobject obj, jlong id, jbyteArray schema_arr, jint num_rows,
     jlongArray buf_addrs, jlongArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<arrow::Schema> schema;
   arrow::Status msg = MakeSchema(env, schema_arr, &schema);
@@ -748,6 +1432,7 @@ Java_com_intel_oap_vectorized_BatchIterator_nativeProcessAndCacheOneWithSelectio
     JNIEnv* env, jobject obj, jlong id, jbyteArray schema_arr, jint num_rows,
     jlongArray buf_addrs, jlongArray buf_sizes, jint selection_vector_count,
     jlong selection_vector_buf_addr, jlong selection_vector_buf_size) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   std::shared_ptr<arrow::Schema> schema;
   arrow::Status msg = MakeSchema(env, schema_arr, &schema);
@@ -795,6 +1480,38 @@ Java_com_intel_oap_vectorized_BatchIterator_nativeProcessAndCacheOneWithSelectio
   env->ReleaseLongArrayElements(buf_sizes, in_buf_sizes, JNI_ABORT);
 }
 
+JNIEXPORT jbyteArray JNICALL
+Java_com_intel_oap_vectorized_BatchIterator_nativeGetRuntimeFilter(JNIEnv* env,
+                                                                   jobject obj,
+                                                                   jlong id) {
+  auto iter = GetBatchIterator(env, id);
+  std::shared_ptr<sparkcolumnarplugin::codegen::RuntimeFilter> filter;
+  auto status = iter->GetRuntimeFilter(&filter);
+  if (status.IsNotImplemented()) {
+    // not a join build side, or its keys can't be filtered
+    return nullptr;
+  }
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeGetRuntimeFilter: failed with error msg " + status.ToString();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return nullptr;
+  }
+  auto bytes = filter->Serialize();
+  jbyteArray ret = env->NewByteArray(bytes.size());
+  env->SetByteArrayRegion(ret, 0, bytes.size(),
+                          reinterpret_cast<const jbyte*>(bytes.data()));
+  return ret;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_vectorized_BatchIterator_nativeSetLimit(
+    JNIEnv* env, jobject obj, jlong id, jlong limit) {
+  auto iter = GetBatchIterator(env, id);
+  if (iter) {
+    iter->SetLimit(limit);
+  }
+}
+
 JNIEXPORT void JNICALL
 Java_com_intel_oap_vectorized_BatchIterator_nativeClose(JNIEnv* env,
                                                                         jobject this_obj,
@@ -823,7 +1540,7 @@ Java_com_intel_oap_vectorized_AdaptorReferenceManager_nativeRelease(
 ///////////// Parquet Reader and Writer /////////////
 JNIEXPORT jlong JNICALL
 Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeOpenParquetReader(
-    JNIEnv* env, jobject obj, jstring path, jlong batch_size) {
+    JNIEnv* env, jobject obj, jstring path, jlong batch_size, jint decode_threads) {
   arrow::Status status;
   std::string cpath = JStringToCString(env, path);
 
@@ -834,7 +1551,16 @@ Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeOpenParquetR
   std::shared_ptr<arrow::io::RandomAccessFile> file;
   ARROW_ASSIGN_OR_THROW(file, fs->OpenInputFile(file_name));
 
-  parquet::ArrowReaderProperties properties(true);
+  // the columns are decoded on the CPU pool of arrow, bounding the threads of all the
+  // tasks of the executor
+  if (decode_threads > 0) {
+    status = arrow::SetCpuThreadPoolCapacity(decode_threads);
+    if (!status.ok()) {
+      std::string error_message = "nativeOpenParquetReader: " + status.message();
+      env->ThrowNew(io_exception_class, error_message.c_str());
+    }
+  }
+  parquet::ArrowReaderProperties properties(decode_threads > 0);
   properties.set_batch_size(batch_size);
 
   std::unique_ptr<ParquetFileReader> reader;
@@ -844,6 +1570,19 @@ Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeOpenParquetR
     std::string error_message = "nativeOpenParquetReader: " + status.message();
     env->ThrowNew(io_exception_class, error_message.c_str());
   }
+  // the tasks scanning the same version of a file share its column chunks
+  if (status.ok() && jni::parquet::adapters::ColumnChunkCacheCapacity() > 0) {
+    auto info = fs->GetFileInfo(file_name);
+    if (info.ok()) {
+      status = reader->SetChunkCache(
+          cpath + "|" + std::to_string(info->size()) + "|" +
+          std::to_string(info->mtime().time_since_epoch().count()));
+    }
+    if (!status.ok()) {
+      std::string error_message = "nativeOpenParquetReader: " + status.message();
+      env->ThrowNew(io_exception_class, error_message.c_str());
+    }
+  }
 #ifdef DEBUG
   auto handler_holder_size = handler_holder_.Size();
   auto batch_holder_size = batch_iterator_holder_.Size();
@@ -860,6 +1599,7 @@ JNIEXPORT void JNICALL
 Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeInitParquetReader(
     JNIEnv* env, jobject obj, jlong id, jintArray column_indices,
     jintArray row_group_indices) {
+  TRACE_SPAN("jni", __func__);
   // Prepare column_indices and row_group_indices from java array.
   bool column_indices_need_release = false;
   int column_indices_len = env->GetArrayLength(column_indices);
@@ -902,6 +1642,7 @@ JNIEXPORT void JNICALL
 Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeInitParquetReader2(
     JNIEnv* env, jobject obj, jlong id, jintArray column_indices, jlong start_pos,
     jlong end_pos) {
+  TRACE_SPAN("jni", __func__);
   // Prepare column_indices and row_group_indices from java array.
   bool column_indices_need_release = false;
   int column_indices_len = env->GetArrayLength(column_indices);
@@ -926,7 +1667,85 @@ Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeInitParquetR
 }
 
 JNIEXPORT void JNICALL
-Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeCloseParquetReader(
+Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeSetRuntimeFilter(
+    JNIEnv* env, jobject obj, jlong id, jint column_index, jbyteArray filter_arr) {
+  auto reader = GetFileReader(env, id);
+  int filter_len = env->GetArrayLength(filter_arr);
+  jbyte* filter_bytes = env->GetByteArrayElements(filter_arr, 0);
+  auto filter = sparkcolumnarplugin::codegen::RuntimeFilter::Deserialize(
+      reinterpret_cast<const uint8_t*>(filter_bytes), filter_len);
+  env->ReleaseByteArrayElements(filter_arr, filter_bytes, JNI_ABORT);
+  auto status = filter.status();
+  if (status.ok()) {
+    status = reader->SetRuntimeFilter(column_index, filter.ValueOrDie());
+  }
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeSetRuntimeFilter: failed to set filter, err is " + status.message();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeSetFilter(
+    JNIEnv* env, jobject obj, jlong id, jbyteArray condition_arr) {
+  auto reader = GetFileReader(env, id);
+  gandiva::ConditionPtr condition;
+  auto status = MakeCondition(env, condition_arr, &condition);
+  if (status.ok()) {
+    status = reader->SetFilter(condition);
+  }
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeSetFilter: failed to set filter, err is " + status.message();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeSetRowFilter(
+    JNIEnv* env, jobject obj, jlong id, jbyteArray condition_arr) {
+  auto reader = GetFileReader(env, id);
+  gandiva::ConditionPtr condition;
+  auto status = MakeCondition(env, condition_arr, &condition);
+  if (status.ok()) {
+    status = reader->SetRowFilter(condition);
+  }
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeSetRowFilter: failed to set row filter, err is " + status.message();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeSetPrefetch(
+    JNIEnv* env, jobject obj, jlong id, jint row_groups) {
+  auto reader = GetFileReader(env, id);
+  auto status = reader->SetPrefetch(row_groups);
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeSetPrefetch: failed to set prefetch, err is " + status.message();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeSetCoalescedReads(
+    JNIEnv* env, jobject obj, jlong id, jlong hole_size_limit, jlong range_size_limit,
+    jint io_threads) {
+  auto reader = GetFileReader(env, id);
+  auto status = reader->SetCoalescedReads(hole_size_limit, range_size_limit, io_threads);
+  if (!status.ok()) {
+    std::string error_message =
+        "nativeSetCoalescedReads: failed to set coalesced reads, err is " +
+        status.message();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeCloseParquetReader(
     JNIEnv* env, jobject obj, jlong id) {
   reader_holder_.Erase(id);
 #ifdef DEBUG
@@ -940,9 +1759,20 @@ Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeCloseParquet
 #endif
 }
 
+JNIEXPORT void JNICALL
+Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeStop(JNIEnv* env,
+                                                                         jobject obj,
+                                                                         jlong id) {
+  auto reader = GetFileReader(env, id);
+  if (reader) {
+    reader->Stop();
+  }
+}
+
 JNIEXPORT jobject JNICALL
 Java_com_intel_oap_datasource_parquet_ParquetReaderJniWrapper_nativeReadNext(
     JNIEnv* env, jobject obj, jlong id) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   auto reader = GetFileReader(env, id);
 
@@ -1025,9 +1855,21 @@ Java_com_intel_oap_datasource_parquet_ParquetWriterJniWrapper_nativeOpenParquetW
   return writer_holder_.Insert(std::shared_ptr<ParquetFileWriter>(writer.release()));
 }
 
+JNIEXPORT void JNICALL
+Java_com_intel_oap_datasource_parquet_ParquetWriterJniWrapper_nativeSetParallelWrite(
+    JNIEnv* env, jobject obj, jlong id, jint num_threads, jlong row_group_rows) {
+  auto writer = GetFileWriter(env, id);
+  auto status = writer->SetParallelWrite(num_threads, row_group_rows);
+  if (!status.ok()) {
+    std::string error_message = "nativeSetParallelWrite: " + status.message();
+    env->ThrowNew(io_exception_class, error_message.c_str());
+  }
+}
+
 JNIEXPORT void JNICALL
 Java_com_intel_oap_datasource_parquet_ParquetWriterJniWrapper_nativeCloseParquetWriter(
     JNIEnv* env, jobject obj, jlong id) {
+  TRACE_SPAN("jni", __func__);
   arrow::Status status;
   auto writer = GetFileWriter(env, id);
   status = writer->Flush();
@@ -1043,6 +1885,7 @@ JNIEXPORT void JNICALL
 Java_com_intel_oap_datasource_parquet_ParquetWriterJniWrapper_nativeWriteNext(
     JNIEnv* env, jobject obj, jlong id, jint num_rows, jlongArray bufAddrs,
     jlongArray bufSizes) {
+  TRACE_SPAN("jni", __func__);
   // convert input data to record batch
   int in_bufs_len = env->GetArrayLength(bufAddrs);
   if (in_bufs_len != env->GetArrayLength(bufSizes)) {
@@ -1087,7 +1930,8 @@ Java_com_intel_oap_datasource_parquet_ParquetWriterJniWrapper_nativeWriteNext(
 
 JNIEXPORT jlong JNICALL
 Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_make(
-    JNIEnv* env, jobject, jbyteArray schema_arr, jlong buffer_size, jstring pathObj) {
+    JNIEnv* env, jobject, jbyteArray schema_arr, jint num_partitions, jlong buffer_size,
+    jstring pathObj) {
   std::shared_ptr<arrow::Schema> schema;
   arrow::Status status;
 
@@ -1103,7 +1947,7 @@ Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_make(
         std::string("failed to readSchema, err msg is " + status.message()).c_str());
   }
 
-  auto result = Splitter::Make(schema);
+  auto result = Splitter::Make(schema, num_partitions);
   if (!result.ok()) {
     env->ThrowNew(io_exception_class,
                   std::string("Failed create native shuffle splitter").c_str());
@@ -1114,10 +1958,330 @@ Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_make(
   return shuffle_splitter_holder_.Insert(std::shared_ptr<Splitter>(*result));
 }
 
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_makeWithPartitioning(
+    JNIEnv* env, jobject, jbyteArray schema_arr, jint num_partitions,
+    jstring partitioning_jstr, jintArray key_indices_arr, jint start_partition,
+    jint num_bound_rows, jlongArray bound_buf_addrs, jlongArray bound_buf_sizes,
+    jbooleanArray key_ascending_arr, jbooleanArray key_nulls_first_arr, jlong buffer_size,
+    jstring pathObj) {
+  std::shared_ptr<arrow::Schema> schema;
+  arrow::Status status;
+
+  auto joined_path = env->GetStringUTFChars(pathObj, JNI_FALSE);
+  setenv("NATIVESQL_SPARK_LOCAL_DIRS", joined_path, 1);
+
+  env->ReleaseStringUTFChars(pathObj, joined_path);
+
+  status = MakeSchema(env, schema_arr, &schema);
+  if (!status.ok()) {
+    env->ThrowNew(
+        io_exception_class,
+        std::string("failed to readSchema, err msg is " + status.message()).c_str());
+    return -1;
+  }
+
+  sparkcolumnarplugin::shuffle::PartitioningOptions options;
+  auto partitioning = JStringToCString(env, partitioning_jstr);
+  if (partitioning == "hash") {
+    options.partitioning = sparkcolumnarplugin::shuffle::Partitioning::HASH;
+  } else if (partitioning == "range") {
+    options.partitioning = sparkcolumnarplugin::shuffle::Partitioning::RANGE;
+  } else if (partitioning == "round_robin") {
+    options.partitioning = sparkcolumnarplugin::shuffle::Partitioning::ROUND_ROBIN;
+  } else if (partitioning == "single") {
+    options.partitioning = sparkcolumnarplugin::shuffle::Partitioning::SINGLE;
+  } else {
+    env->ThrowNew(illegal_argument_exception_class,
+                  ("Unsupported partitioning " + partitioning).c_str());
+    return -1;
+  }
+
+  auto num_keys = env->GetArrayLength(key_indices_arr);
+  jint* key_indices = env->GetIntArrayElements(key_indices_arr, JNI_FALSE);
+  options.key_indices.assign(key_indices, key_indices + num_keys);
+  env->ReleaseIntArrayElements(key_indices_arr, key_indices, JNI_ABORT);
+  options.start_partition = start_partition;
+  options.key_ascending = MakeFlags(env, key_ascending_arr);
+  options.key_nulls_first = MakeFlags(env, key_nulls_first_arr);
+
+  if (options.partitioning == sparkcolumnarplugin::shuffle::Partitioning::RANGE) {
+    std::vector<std::shared_ptr<arrow::Field>> key_fields;
+    for (auto key : options.key_indices) {
+      if (key < 0 || key >= schema->num_fields()) {
+        env->ThrowNew(illegal_argument_exception_class,
+                      ("Partitioning key column out of range " + std::to_string(key))
+                          .c_str());
+        return -1;
+      }
+      key_fields.push_back(schema->field(key));
+    }
+
+    int bound_bufs_len = env->GetArrayLength(bound_buf_addrs);
+    if (bound_bufs_len != env->GetArrayLength(bound_buf_sizes)) {
+      env->ThrowNew(io_exception_class,
+                    "native split: mismatch in arraylen of bound_buf_addrs and "
+                    "bound_buf_sizes");
+      return -1;
+    }
+    jlong* in_buf_addrs = env->GetLongArrayElements(bound_buf_addrs, JNI_FALSE);
+    jlong* in_buf_sizes = env->GetLongArrayElements(bound_buf_sizes, JNI_FALSE);
+    status = MakeRecordBatch(arrow::schema(key_fields), num_bound_rows,
+                             (int64_t*)in_buf_addrs, (int64_t*)in_buf_sizes,
+                             bound_bufs_len, &options.range_bounds);
+    env->ReleaseLongArrayElements(bound_buf_addrs, in_buf_addrs, JNI_ABORT);
+    env->ReleaseLongArrayElements(bound_buf_sizes, in_buf_sizes, JNI_ABORT);
+    if (!status.ok()) {
+      env->ThrowNew(io_exception_class,
+                    ("native split: make range bounds failed, err msg is " +
+                     status.message())
+                        .c_str());
+      return -1;
+    }
+  }
+
+  auto result = Splitter::Make(schema, num_partitions, std::move(options));
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  ("Failed create native shuffle splitter, err msg is " +
+                   result.status().message())
+                      .c_str());
+    return -1;
+  }
+
+  (*result)->set_buffer_size(buffer_size);
+
+  return shuffle_splitter_holder_.Insert(std::shared_ptr<Splitter>(*result));
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_oap_vectorized_RangeSamplerJniWrapper_make(
+    JNIEnv* env, jobject, jbyteArray schema_arr, jintArray key_indices_arr,
+    jbooleanArray key_ascending_arr, jbooleanArray key_nulls_first_arr, jint sample_size,
+    jlong seed) {
+  std::shared_ptr<arrow::Schema> schema;
+  auto status = MakeSchema(env, schema_arr, &schema);
+  if (!status.ok()) {
+    env->ThrowNew(
+        io_exception_class,
+        std::string("failed to readSchema, err msg is " + status.message()).c_str());
+    return -1;
+  }
+
+  sparkcolumnarplugin::shuffle::PartitioningOptions options;
+  options.partitioning = sparkcolumnarplugin::shuffle::Partitioning::RANGE;
+  auto num_keys = env->GetArrayLength(key_indices_arr);
+  jint* key_indices = env->GetIntArrayElements(key_indices_arr, JNI_FALSE);
+  options.key_indices.assign(key_indices, key_indices + num_keys);
+  env->ReleaseIntArrayElements(key_indices_arr, key_indices, JNI_ABORT);
+  options.key_ascending = MakeFlags(env, key_ascending_arr);
+  options.key_nulls_first = MakeFlags(env, key_nulls_first_arr);
+
+  auto result = RangeSampler::Make(schema, options, sample_size, seed);
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  ("Failed create native range sampler, err msg is " +
+                   result.status().message())
+                      .c_str());
+    return -1;
+  }
+  return range_sampler_holder_.Insert(std::move(result).ValueOrDie());
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_vectorized_RangeSamplerJniWrapper_sample(
+    JNIEnv* env, jobject, jlong sampler_id, jint num_rows, jlongArray buf_addrs,
+    jlongArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
+  auto sampler = range_sampler_holder_.Lookup(sampler_id);
+  if (!sampler) {
+    std::string error_message = "invalid sampler id " + std::to_string(sampler_id);
+    env->ThrowNew(illegal_argument_exception_class, error_message.c_str());
+    return;
+  }
+
+  int in_bufs_len = env->GetArrayLength(buf_addrs);
+  if (in_bufs_len != env->GetArrayLength(buf_sizes)) {
+    env->ThrowNew(io_exception_class,
+                  "native sample: mismatch in arraylen of buf_addrs and buf_sizes");
+    return;
+  }
+  jlong* in_buf_addrs = env->GetLongArrayElements(buf_addrs, JNI_FALSE);
+  jlong* in_buf_sizes = env->GetLongArrayElements(buf_sizes, JNI_FALSE);
+  std::shared_ptr<arrow::RecordBatch> in;
+  auto status = MakeRecordBatch(sampler->schema(), num_rows, (int64_t*)in_buf_addrs,
+                                (int64_t*)in_buf_sizes, in_bufs_len, &in);
+  env->ReleaseLongArrayElements(buf_addrs, in_buf_addrs, JNI_ABORT);
+  env->ReleaseLongArrayElements(buf_sizes, in_buf_sizes, JNI_ABORT);
+  if (status.ok()) {
+    status = sampler->Sample(*in);
+  }
+  if (!status.ok()) {
+    env->ThrowNew(io_exception_class,
+                  ("native sample failed, err msg is " + status.message()).c_str());
+  }
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_oap_vectorized_RangeSamplerJniWrapper_getNumRows(
+    JNIEnv* env, jobject, jlong sampler_id) {
+  auto sampler = range_sampler_holder_.Lookup(sampler_id);
+  if (!sampler) {
+    std::string error_message = "invalid sampler id " + std::to_string(sampler_id);
+    env->ThrowNew(illegal_argument_exception_class, error_message.c_str());
+    return -1;
+  }
+  return sampler->num_rows();
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_intel_oap_vectorized_RangeSamplerJniWrapper_computeBounds(JNIEnv* env, jobject,
+                                                                   jlong sampler_id,
+                                                                   jint num_partitions) {
+  auto sampler = range_sampler_holder_.Lookup(sampler_id);
+  if (!sampler) {
+    std::string error_message = "invalid sampler id " + std::to_string(sampler_id);
+    env->ThrowNew(illegal_argument_exception_class, error_message.c_str());
+    return nullptr;
+  }
+  auto result = sampler->ComputeBounds(num_partitions);
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  ("native compute range bounds failed, err msg is " +
+                   result.status().message())
+                      .c_str());
+    return nullptr;
+  }
+  auto bounds = std::move(result).ValueOrDie();
+  return MakeRecordBatchBuilder(env, bounds->schema(), bounds);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_vectorized_RangeSamplerJniWrapper_close(
+    JNIEnv* env, jobject, jlong sampler_id) {
+  range_sampler_holder_.Erase(sampler_id);
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_oap_vectorized_RowConverterJniWrapper_make(
+    JNIEnv* env, jobject, jbyteArray schema_arr, jlong memory_pool_id) {
+  std::shared_ptr<arrow::Schema> schema;
+  auto status = MakeSchema(env, schema_arr, &schema);
+  if (!status.ok()) {
+    env->ThrowNew(
+        io_exception_class,
+        std::string("failed to readSchema, err msg is " + status.message()).c_str());
+    return -1;
+  }
+  auto result = RowConverter::Make(schema, GetMemoryPool(env, memory_pool_id));
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  ("Failed create native row converter, err msg is " +
+                   result.status().message())
+                      .c_str());
+    return -1;
+  }
+  return row_converter_holder_.Insert(std::move(result).ValueOrDie());
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_intel_oap_vectorized_RowConverterJniWrapper_rowToColumnar(
+    JNIEnv* env, jobject, jlong converter_id, jlongArray row_addrs,
+    jintArray row_sizes) {
+  TRACE_SPAN("jni", __func__);
+  auto converter = row_converter_holder_.Lookup(converter_id);
+  if (!converter) {
+    std::string error_message = "invalid converter id " + std::to_string(converter_id);
+    env->ThrowNew(illegal_argument_exception_class, error_message.c_str());
+    return nullptr;
+  }
+
+  int num_rows = env->GetArrayLength(row_addrs);
+  if (num_rows != env->GetArrayLength(row_sizes)) {
+    env->ThrowNew(io_exception_class,
+                  "native row to columnar: mismatch in arraylen of row_addrs and "
+                  "row_sizes");
+    return nullptr;
+  }
+  jlong* in_row_addrs = env->GetLongArrayElements(row_addrs, JNI_FALSE);
+  jint* in_row_sizes = env->GetIntArrayElements(row_sizes, JNI_FALSE);
+  auto result = converter->ToColumnar(num_rows, (int64_t*)in_row_addrs,
+                                      (int32_t*)in_row_sizes);
+  env->ReleaseLongArrayElements(row_addrs, in_row_addrs, JNI_ABORT);
+  env->ReleaseIntArrayElements(row_sizes, in_row_sizes, JNI_ABORT);
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  ("native rowToColumnar failed, err msg is " + result.status().message())
+                      .c_str());
+    return nullptr;
+  }
+  return MakeRecordBatchBuilder(env, converter->schema(), std::move(result).ValueOrDie());
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_oap_vectorized_RowConverterJniWrapper_columnarToRow(
+    JNIEnv* env, jobject, jlong converter_id, jint num_rows, jlongArray buf_addrs,
+    jlongArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
+  auto converter = row_converter_holder_.Lookup(converter_id);
+  if (!converter) {
+    std::string error_message = "invalid converter id " + std::to_string(converter_id);
+    env->ThrowNew(illegal_argument_exception_class, error_message.c_str());
+    return nullptr;
+  }
+
+  int in_bufs_len = env->GetArrayLength(buf_addrs);
+  if (in_bufs_len != env->GetArrayLength(buf_sizes)) {
+    env->ThrowNew(io_exception_class,
+                  "native columnar to row: mismatch in arraylen of buf_addrs and "
+                  "buf_sizes");
+    return nullptr;
+  }
+  jlong* in_buf_addrs = env->GetLongArrayElements(buf_addrs, JNI_FALSE);
+  jlong* in_buf_sizes = env->GetLongArrayElements(buf_sizes, JNI_FALSE);
+  std::shared_ptr<arrow::RecordBatch> in;
+  auto status = MakeRecordBatch(converter->schema(), num_rows, (int64_t*)in_buf_addrs,
+                                (int64_t*)in_buf_sizes, in_bufs_len, &in);
+  env->ReleaseLongArrayElements(buf_addrs, in_buf_addrs, JNI_ABORT);
+  env->ReleaseLongArrayElements(buf_sizes, in_buf_sizes, JNI_ABORT);
+  if (!status.ok()) {
+    env->ThrowNew(
+        io_exception_class,
+        ("native columnarToRow failed, err msg is " + status.message()).c_str());
+    return nullptr;
+  }
+  auto result = converter->ToRows(*in);
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  ("native columnarToRow failed, err msg is " + result.status().message())
+                      .c_str());
+    return nullptr;
+  }
+
+  // the holder id and the address of the rows buffer, then the offset of each row in
+  // it and the end of the last one
+  auto rows = std::move(result).ValueOrDie();
+  std::vector<jlong> info;
+  info.reserve(rows.offsets.size() + 2);
+  info.push_back(0);
+  info.push_back(reinterpret_cast<jlong>(rows.buffer->data()));
+  info.insert(info.end(), rows.offsets.begin(), rows.offsets.end());
+  info[0] = buffer_holder_.Insert(std::move(rows.buffer));
+  jlongArray info_array = env->NewLongArray(info.size());
+  env->SetLongArrayRegion(info_array, 0, info.size(), info.data());
+  return info_array;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_vectorized_RowConverterJniWrapper_releaseRows(
+    JNIEnv* env, jobject, jlong rows_id) {
+  buffer_holder_.Erase(rows_id);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_oap_vectorized_RowConverterJniWrapper_close(
+    JNIEnv* env, jobject, jlong converter_id) {
+  row_converter_holder_.Erase(converter_id);
+}
+
 JNIEXPORT void JNICALL
 Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_split(
     JNIEnv* env, jobject, jlong splitter_id, jint num_rows, jlongArray buf_addrs,
     jlongArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
   auto splitter = GetShuffleSplitter(env, splitter_id);
 
   int in_bufs_len = env->GetArrayLength(buf_addrs);
@@ -1149,9 +2313,39 @@ Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_split(
   }
 }
 
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_splitBatches(
+    JNIEnv* env, jobject, jlong splitter_id, jintArray num_rows, jobjectArray buf_addrs,
+    jobjectArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> in;
+  auto status =
+      MakeRecordBatches(env, splitter->schema(), num_rows, buf_addrs, buf_sizes, &in);
+  if (!status.ok()) {
+    env->ThrowNew(
+        io_exception_class,
+        std::string("native split: make record batches failed, error message is " +
+                    status.message())
+            .c_str());
+    return;
+  }
+
+  for (const auto& batch : in) {
+    status = splitter->Split(*batch);
+    if (!status.ok()) {
+      env->ThrowNew(io_exception_class,
+                    std::string("native split: splitter split failed").c_str());
+      return;
+    }
+  }
+}
+
 JNIEXPORT void JNICALL
 Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_stop(
     JNIEnv* env, jobject, jlong splitter_id) {
+  TRACE_SPAN("jni", __func__);
   auto splitter = GetShuffleSplitter(env, splitter_id);
   auto status = splitter->Stop();
 
@@ -1176,28 +2370,115 @@ Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_setCompressionCodec(
     JNIEnv* env, jobject, jlong splitter_id, jstring codec_jstr) {
   auto splitter = GetShuffleSplitter(env, splitter_id);
 
-  auto compression_codec = arrow::Compression::UNCOMPRESSED;
-  auto codec_l = env->GetStringUTFChars(codec_jstr, JNI_FALSE);
-  if (codec_l != nullptr) {
-    std::string codec_u;
-    std::transform(codec_l, codec_l + std::strlen(codec_l), std::back_inserter(codec_u),
-                   ::toupper);
-    auto result = arrow::util::Codec::GetCompressionType(codec_u);
-    if (result.ok()) {
-      compression_codec = *result;
-    } else {
-      env->ThrowNew(io_exception_class,
-                    std::string("failed to get compression codec, error message is " +
-                                result.status().message())
-                        .c_str());
-    }
-    if (compression_codec == arrow::Compression::LZ4) {
-      compression_codec = arrow::Compression::LZ4_FRAME;
-    }
+  auto result = GetCompressionCodec(env, codec_jstr);
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  std::string("failed to get compression codec, error message is " +
+                              result.status().message())
+                      .c_str());
+    return;
   }
-  env->ReleaseStringUTFChars(codec_jstr, codec_l);
+  splitter->set_compression_codec(*result);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_setMemoryLimit(
+    JNIEnv* env, jobject, jlong splitter_id, jlong memory_limit) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
 
-  splitter->set_compression_codec(compression_codec);
+  splitter->set_memory_limit((int64_t)memory_limit);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_setWriterThreads(
+    JNIEnv* env, jobject, jlong splitter_id, jint num_threads, jlong max_inflight_bytes) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+
+  splitter->set_writer_threads((int32_t)num_threads, (int64_t)max_inflight_bytes);
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_spill(
+    JNIEnv* env, jobject, jlong splitter_id, jlong size) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+  auto result = splitter->Spill((int64_t)size);
+
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  std::string("native split: splitter spill failed, error message is " +
+                              result.status().message())
+                      .c_str());
+    return 0;
+  }
+  return (jlong)*result;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getBufferedBytes(
+    JNIEnv* env, jobject, jlong splitter_id) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+
+  return (jlong)splitter->BufferedBytes();
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_setDataFile(
+    JNIEnv* env, jobject, jlong splitter_id, jstring data_file_jstr) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+
+  auto data_file = JStringToCString(env, data_file_jstr);
+  splitter->set_output_mode(sparkcolumnarplugin::shuffle::OutputMode::CONSOLIDATED);
+  splitter->set_data_file(std::move(data_file));
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_setRpmpOutput(
+    JNIEnv* env, jobject, jlong splitter_id, jstring address_jstr, jstring port_jstr,
+    jstring app_jstr, jlong shuffle_id, jint num_connections) {
+#ifdef NATIVESQL_RPMP
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+
+  auto result = sparkcolumnarplugin::shuffle::RpmpPartitionSink::Make(
+      JStringToCString(env, address_jstr), JStringToCString(env, port_jstr),
+      JStringToCString(env, app_jstr), (int64_t)shuffle_id, (int32_t)num_connections);
+  if (!result.ok()) {
+    env->ThrowNew(
+        io_exception_class,
+        std::string("native split: failed to connect to RPMP, error message is " +
+                    result.status().message())
+            .c_str());
+    return;
+  }
+  splitter->set_output_mode(sparkcolumnarplugin::shuffle::OutputMode::PUSHED);
+  splitter->set_partition_sink(*std::move(result));
+#else
+  env->ThrowNew(illegal_argument_exception_class,
+                "native split: the native library was built without RPMP");
+#endif
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_setPmemkvOutput(
+    JNIEnv* env, jobject, jlong splitter_id, jstring device_path_jstr, jlong shuffle_id,
+    jlong map_id) {
+#ifdef NATIVESQL_PMEMKV
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+
+  auto result = sparkcolumnarplugin::shuffle::PmemkvPartitionSink::Make(
+      JStringToCString(env, device_path_jstr), (int64_t)shuffle_id, (int64_t)map_id);
+  if (!result.ok()) {
+    env->ThrowNew(
+        io_exception_class,
+        std::string("native split: failed to open pmemkv, error message is " +
+                    result.status().message())
+            .c_str());
+    return;
+  }
+  splitter->set_output_mode(sparkcolumnarplugin::shuffle::OutputMode::PUSHED);
+  splitter->set_partition_sink(*std::move(result));
+#else
+  env->ThrowNew(illegal_argument_exception_class,
+                "native split: the native library was built without PMEMKV");
+#endif
 }
 
 JNIEXPORT jobjectArray JNICALL
@@ -1221,6 +2502,18 @@ Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getPartitionFileInfo(
   return partition_file_info_array;
 }
 
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getPartitionLengths(
+    JNIEnv* env, jobject, jlong splitter_id) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+
+  const auto& partition_lengths = splitter->GetPartitionLengths();
+  auto partition_length_arr = env->NewLongArray(partition_lengths.size());
+  env->SetLongArrayRegion(partition_length_arr, 0, partition_lengths.size(),
+                          reinterpret_cast<const jlong*>(partition_lengths.data()));
+  return partition_length_arr;
+}
+
 JNIEXPORT jlong JNICALL
 Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getTotalBytesWritten(
     JNIEnv* env, jobject, jlong splitter_id) {
@@ -1235,6 +2528,63 @@ Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getTotalBytesWritten(
   return (jlong)*result;
 }
 
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getTotalSplitTime(
+    JNIEnv* env, jobject, jlong splitter_id) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+  return splitter->TotalSplitTime();
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getTotalCompressTime(
+    JNIEnv* env, jobject, jlong splitter_id) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+  return splitter->TotalCompressTime();
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getTotalWriteTime(
+    JNIEnv* env, jobject, jlong splitter_id) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+  return splitter->TotalWriteTime();
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getTotalSpills(
+    JNIEnv* env, jobject, jlong splitter_id) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+  return splitter->TotalSpills();
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getPartitionBytesWritten(
+    JNIEnv* env, jobject, jlong splitter_id) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+  auto result = splitter->PartitionBytesWritten();
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class, "native split: get partition bytes written failed");
+    return nullptr;
+  }
+
+  const auto& partition_bytes = *result;
+  auto partition_bytes_arr = env->NewLongArray(partition_bytes.size());
+  env->SetLongArrayRegion(partition_bytes_arr, 0, partition_bytes.size(),
+                          reinterpret_cast<const jlong*>(partition_bytes.data()));
+  return partition_bytes_arr;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_getPartitionRowsWritten(
+    JNIEnv* env, jobject, jlong splitter_id) {
+  auto splitter = GetShuffleSplitter(env, splitter_id);
+
+  auto partition_rows = splitter->PartitionRowsWritten();
+  auto partition_rows_arr = env->NewLongArray(partition_rows.size());
+  env->SetLongArrayRegion(partition_rows_arr, 0, partition_rows.size(),
+                          reinterpret_cast<const jlong*>(partition_rows.data()));
+  return partition_rows_arr;
+}
+
 JNIEXPORT void JNICALL
 Java_com_intel_oap_vectorized_ShuffleSplitterJniWrapper_close(
     JNIEnv* env, jobject, jlong splitter_id) {
@@ -1252,30 +2602,61 @@ Java_com_intel_oap_vectorized_ShuffleDecompressionJniWrapper_make(
     env->ThrowNew(
         io_exception_class,
         std::string("failed to readSchema, err msg is " + status.message()).c_str());
+    return -1;
   }
 
-  return decompression_schema_holder_.Insert(schema);
+  auto result = Decompressor::Make(schema);
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  std::string("failed to make decompressor, err msg is " +
+                              result.status().message())
+                      .c_str());
+    return -1;
+  }
+  return decompressor_holder_.Insert(std::move(result).ValueOrDie());
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ShuffleDecompressionJniWrapper_setNumThreads(
+    JNIEnv* env, jobject, jlong schema_holder_id, jint num_threads) {
+  auto decompressor = decompressor_holder_.Lookup(schema_holder_id);
+  if (!decompressor) {
+    std::string error_message =
+        "native decompress: invalid decompressor id " + std::to_string(schema_holder_id);
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return;
+  }
+
+  auto status = decompressor->SetNumThreads((int32_t)num_threads);
+  if (!status.ok()) {
+    env->ThrowNew(io_exception_class,
+                  std::string("failed to set decompression threads, error message is " +
+                              status.message())
+                      .c_str());
+  }
 }
 
 JNIEXPORT jobject JNICALL
 Java_com_intel_oap_vectorized_ShuffleDecompressionJniWrapper_decompress(
     JNIEnv* env, jobject obj, jlong schema_holder_id, jstring codec_jstr, jint num_rows,
     jlongArray buf_addrs, jlongArray buf_sizes, jlongArray buf_mask) {
-  auto schema = decompression_schema_holder_.Lookup(schema_holder_id);
+  TRACE_SPAN("jni", __func__);
+  auto decompressor = decompressor_holder_.Lookup(schema_holder_id);
+  if (!decompressor) {
+    std::string error_message =
+        "native decompress: invalid decompressor id " + std::to_string(schema_holder_id);
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return nullptr;
+  }
 
   int in_bufs_len = env->GetArrayLength(buf_addrs);
   if (in_bufs_len != env->GetArrayLength(buf_sizes)) {
     std::string error_message =
         "native decompress: mismatch in arraylen of buf_addrs and buf_sizes";
     env->ThrowNew(io_exception_class, error_message.c_str());
+    return nullptr;
   }
 
-  auto in_buf_addrs = env->GetLongArrayElements(buf_addrs, JNI_FALSE);
-  auto in_buf_sizes = env->GetLongArrayElements(buf_sizes, JNI_FALSE);
-  auto in_buf_mask = env->GetLongArrayElements(buf_mask, JNI_FALSE);
-  int buf_idx = 0;
-  int field_idx = 0;
-
   // get decompression compression_codec
   auto compression_codec = arrow::Compression::UNCOMPRESSED;
   auto codec_l = env->GetStringUTFChars(codec_jstr, JNI_FALSE);
@@ -1298,73 +2679,155 @@ Java_com_intel_oap_vectorized_ShuffleDecompressionJniWrapper_decompress(
   }
   env->ReleaseStringUTFChars(codec_jstr, codec_l);
 
-  std::vector<std::shared_ptr<arrow::ArrayData>> arrays;
-  while (field_idx < schema->num_fields()) {
-    auto field = schema->field(field_idx);
-    std::vector<std::shared_ptr<arrow::Buffer>> buffers;
-
-    // decompress validity buffer
-    auto result = arrow::BitUtil::GetBit((uint8_t*)in_buf_mask, buf_idx)
-                      ? DecompressBuffer(in_buf_addrs[buf_idx], in_buf_sizes[buf_idx],
-                                         arrow::Compression::UNCOMPRESSED)
-                      : DecompressBuffer(in_buf_addrs[buf_idx], in_buf_sizes[buf_idx],
-                                         compression_codec);
-    if (result.ok()) {
-      buffers.push_back(std::move(result).ValueOrDie());
-    } else {
+  // the bit mask from the JVM is trimmed after its highest set bit
+  std::vector<uint8_t> mask(arrow::BitUtil::BytesForBits(in_bufs_len), 0);
+  auto mask_len = std::min(static_cast<int64_t>(env->GetArrayLength(buf_mask)) * 8,
+                           static_cast<int64_t>(mask.size()));
+  auto in_buf_mask = env->GetLongArrayElements(buf_mask, JNI_FALSE);
+  std::memcpy(mask.data(), in_buf_mask, mask_len);
+  env->ReleaseLongArrayElements(buf_mask, in_buf_mask, JNI_ABORT);
+
+  auto in_buf_addrs = env->GetLongArrayElements(buf_addrs, JNI_FALSE);
+  auto in_buf_sizes = env->GetLongArrayElements(buf_sizes, JNI_FALSE);
+  auto result = decompressor->Decompress(compression_codec, num_rows, in_buf_addrs,
+                                         in_buf_sizes, in_bufs_len, mask.data());
+  env->ReleaseLongArrayElements(buf_addrs, in_buf_addrs, JNI_ABORT);
+  env->ReleaseLongArrayElements(buf_sizes, in_buf_sizes, JNI_ABORT);
+
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  std::string("failed to decompress buffers, error message is " +
+                              result.status().message())
+                      .c_str());
+    return nullptr;
+  }
+  auto record_batch = std::move(result).ValueOrDie();
+  return MakeRecordBatchBuilder(env, record_batch->schema(), record_batch);
+}
+
+JNIEXPORT void JNICALL
+Java_com_intel_oap_vectorized_ShuffleDecompressionJniWrapper_close(
+    JNIEnv* env, jobject, jlong schema_holder_id) {
+  decompressor_holder_.Erase(schema_holder_id);
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_oap_vectorized_ShuffleReaderJniWrapper_make(
+    JNIEnv* env, jobject, jbyteArray schema_arr, jlongArray block_addrs,
+    jlongArray block_sizes) {
+  std::shared_ptr<arrow::Schema> schema;
+  if (schema_arr != nullptr) {
+    auto status = MakeSchema(env, schema_arr, &schema);
+    if (!status.ok()) {
       env->ThrowNew(
           io_exception_class,
-          std::string("failed to decompress validity buffer, error message is " +
-                      result.status().message())
-              .c_str());
+          std::string("failed to readSchema, err msg is " + status.message()).c_str());
+      return -1;
     }
+  }
 
-    // decompress value buffer
-    result = DecompressBuffer(in_buf_addrs[buf_idx + 1], in_buf_sizes[buf_idx + 1],
-                              compression_codec);
-    if (result.ok()) {
-      buffers.push_back(std::move(result).ValueOrDie());
-    } else {
-      env->ThrowNew(io_exception_class,
-                    std::string("failed to decompress value buffer, error message is " +
-                                result.status().message())
-                        .c_str());
-    }
+  int num_blocks = env->GetArrayLength(block_addrs);
+  if (num_blocks != env->GetArrayLength(block_sizes)) {
+    std::string error_message =
+        "native shuffle reader: mismatch in arraylen of block_addrs and block_sizes";
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return -1;
+  }
 
-    if (arrow::is_binary_like(field->type()->id())) {
-      // decompress offset buffer
-      result = DecompressBuffer(in_buf_addrs[buf_idx + 2], in_buf_sizes[buf_idx + 2],
-                                compression_codec);
-      if (result.ok()) {
-        buffers.push_back(std::move(result).ValueOrDie());
-      } else {
-        env->ThrowNew(
-            io_exception_class,
-            std::string("failed to decompress offset buffer, error message is " +
-                        result.status().message())
-                .c_str());
-      }
-      buf_idx += 3;
-    } else {
-      buf_idx += 2;
-    }
-    arrays.push_back(arrow::ArrayData::Make(field->type(), num_rows, std::move(buffers)));
+  auto in_block_addrs = env->GetLongArrayElements(block_addrs, JNI_FALSE);
+  auto in_block_sizes = env->GetLongArrayElements(block_sizes, JNI_FALSE);
+  std::vector<std::shared_ptr<arrow::Buffer>> blocks;
+  blocks.reserve(num_blocks);
+  for (int i = 0; i < num_blocks; ++i) {
+    blocks.push_back(std::make_shared<arrow::Buffer>(
+        reinterpret_cast<const uint8_t*>(in_block_addrs[i]), in_block_sizes[i]));
+  }
+  env->ReleaseLongArrayElements(block_addrs, in_block_addrs, JNI_ABORT);
+  env->ReleaseLongArrayElements(block_sizes, in_block_sizes, JNI_ABORT);
 
-    ++field_idx;
+  auto result = ShuffleReader::Make(std::move(blocks), std::move(schema));
+  if (!result.ok()) {
+    env->ThrowNew(io_exception_class,
+                  std::string("failed to make shuffle reader, err msg is " +
+                              result.status().message())
+                      .c_str());
+    return -1;
   }
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> iter =
+      std::move(result).ValueOrDie();
+  return batch_iterator_holder_.Insert(std::move(iter));
+}
 
+JNIEXPORT jbyteArray JNICALL
+Java_com_intel_oap_vectorized_BatchSerializerJniWrapper_serialize(
+    JNIEnv* env, jobject, jbyteArray schema_arr, jstring codec_jstr, jintArray num_rows,
+    jlongArray buf_addrs, jlongArray buf_sizes) {
+  TRACE_SPAN("jni", __func__);
+  std::shared_ptr<arrow::Schema> schema;
+  auto status = MakeSchema(env, schema_arr, &schema);
+  if (!status.ok()) {
+    env->ThrowNew(
+        io_exception_class,
+        std::string("failed to readSchema, err msg is " + status.message()).c_str());
+    return nullptr;
+  }
+  auto codec = GetCompressionCodec(env, codec_jstr);
+  if (!codec.ok()) {
+    env->ThrowNew(io_exception_class,
+                  std::string("failed to get compression codec, error message is " +
+                              codec.status().message())
+                      .c_str());
+    return nullptr;
+  }
+
+  // the buffers of each batch, validity, offsets of binary columns, then values
+  int bufs_per_batch = 0;
+  for (const auto& field : schema->fields()) {
+    bufs_per_batch += arrow::is_binary_like(field->type()->id()) ? 3 : 2;
+  }
+  int num_batches = env->GetArrayLength(num_rows);
+  int in_bufs_len = env->GetArrayLength(buf_addrs);
+  if (in_bufs_len != env->GetArrayLength(buf_sizes) ||
+      in_bufs_len != num_batches * bufs_per_batch) {
+    std::string error_message =
+        "native batch serializer: mismatch in arraylen of num_rows, buf_addrs and "
+        "buf_sizes";
+    env->ThrowNew(io_exception_class, error_message.c_str());
+    return nullptr;
+  }
+
+  auto in_num_rows = env->GetIntArrayElements(num_rows, JNI_FALSE);
+  auto in_buf_addrs = env->GetLongArrayElements(buf_addrs, JNI_FALSE);
+  auto in_buf_sizes = env->GetLongArrayElements(buf_sizes, JNI_FALSE);
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  for (int i = 0; i < num_batches && status.ok(); ++i) {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    status = MakeRecordBatch(schema, in_num_rows[i], in_buf_addrs + i * bufs_per_batch,
+                             in_buf_sizes + i * bufs_per_batch, bufs_per_batch, &batch);
+    batches.push_back(std::move(batch));
+  }
+  std::shared_ptr<arrow::Buffer> blob;
+  if (status.ok()) {
+    auto result = sparkcolumnarplugin::shuffle::SerializeBatches(schema, batches, *codec);
+    status = result.status();
+    if (status.ok()) {
+      blob = std::move(result).ValueOrDie();
+    }
+  }
+  env->ReleaseIntArrayElements(num_rows, in_num_rows, JNI_ABORT);
   env->ReleaseLongArrayElements(buf_addrs, in_buf_addrs, JNI_ABORT);
   env->ReleaseLongArrayElements(buf_sizes, in_buf_sizes, JNI_ABORT);
-  env->ReleaseLongArrayElements(buf_mask, in_buf_mask, JNI_ABORT);
-
-  return MakeRecordBatchBuilder(
-      env, schema, arrow::RecordBatch::Make(schema, num_rows, std::move(arrays)));
-}
+  if (!status.ok()) {
+    env->ThrowNew(io_exception_class,
+                  std::string("failed to serialize batches, err msg is " +
+                              status.message())
+                      .c_str());
+    return nullptr;
+  }
 
-JNIEXPORT void JNICALL
-Java_com_intel_oap_vectorized_ShuffleDecompressionJniWrapper_close(
-    JNIEnv* env, jobject, jlong schema_holder_id) {
-  decompression_schema_holder_.Erase(schema_holder_id);
+  jbyteArray ret = env->NewByteArray(blob->size());
+  env->SetByteArrayRegion(ret, 0, blob->size(),
+                          reinterpret_cast<const jbyte*>(blob->data()));
+  return ret;
 }
 
 #ifdef __cplusplus
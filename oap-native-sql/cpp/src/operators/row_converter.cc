@@ -0,0 +1,396 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "operators/row_converter.h"
+
+#include <arrow/array.h>
+#include <arrow/util/bit_util.h>
+#include <arrow/util/decimal.h>
+
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace sparkcolumnarplugin {
+namespace operators {
+
+namespace {
+
+constexpr int64_t kSlotSize = 8;
+
+int64_t RoundUp8(int64_t size) { return (size + 7) & ~static_cast<int64_t>(7); }
+
+bool IsSupported(const arrow::DataType& type) {
+  switch (type.id()) {
+    case arrow::Type::BOOL:
+    case arrow::Type::INT8:
+    case arrow::Type::INT16:
+    case arrow::Type::INT32:
+    case arrow::Type::DATE32:
+    case arrow::Type::INT64:
+    case arrow::Type::TIMESTAMP:
+    case arrow::Type::FLOAT:
+    case arrow::Type::DOUBLE:
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+      return true;
+    case arrow::Type::DECIMAL:
+      return static_cast<const arrow::Decimal128Type&>(type).precision() <= 18;
+    default:
+      return false;
+  }
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> Allocate(int64_t size,
+                                                       arrow::MemoryPool* pool) {
+  std::shared_ptr<arrow::Buffer> buffer;
+  ARROW_ASSIGN_OR_RAISE(buffer, arrow::AllocateBuffer(size, pool))
+  return buffer;
+}
+
+// Columnar to row, the slots of a column. Null slots are left zeroed, as Spark writes
+// them, for the rows to compare and hash the same.
+
+template <typename T>
+void WriteSlots(const arrow::Array& array, const T* values, const int64_t* offsets,
+                int64_t slot_offset, uint8_t* data) {
+  auto num_rows = array.length();
+  if (array.null_count() == 0) {
+    for (int64_t i = 0; i < num_rows; ++i) {
+      memcpy(data + offsets[i] + slot_offset, values + i, sizeof(T));
+    }
+    return;
+  }
+  for (int64_t i = 0; i < num_rows; ++i) {
+    if (array.IsValid(i)) {
+      memcpy(data + offsets[i] + slot_offset, values + i, sizeof(T));
+    }
+  }
+}
+
+void WriteBooleanSlots(const arrow::BooleanArray& array, const int64_t* offsets,
+                       int64_t slot_offset, uint8_t* data) {
+  for (int64_t i = 0; i < array.length(); ++i) {
+    if (array.IsValid(i)) {
+      data[offsets[i] + slot_offset] = array.Value(i);
+    }
+  }
+}
+
+// the unscaled value of a decimal of up to 18 digits is its low 64 bits
+void WriteDecimalSlots(const arrow::Decimal128Array& array, const int64_t* offsets,
+                       int64_t slot_offset, uint8_t* data) {
+  for (int64_t i = 0; i < array.length(); ++i) {
+    if (array.IsValid(i)) {
+      arrow::Decimal128 value(array.GetValue(i));
+      auto low = static_cast<int64_t>(value.low_bits());
+      memcpy(data + offsets[i] + slot_offset, &low, kSlotSize);
+    }
+  }
+}
+
+// cursors is the offset in its row of where the variable length data of each row goes
+void WriteBinarySlots(const arrow::BinaryArray& array, const int64_t* offsets,
+                      int64_t slot_offset, int64_t* cursors, uint8_t* data) {
+  auto values = array.raw_data();
+  for (int64_t i = 0; i < array.length(); ++i) {
+    if (array.IsNull(i)) {
+      continue;
+    }
+    auto row = data + offsets[i];
+    auto value_offset = array.value_offset(i);
+    int64_t size = array.value_length(i);
+    auto slot = static_cast<int64_t>(static_cast<uint64_t>(cursors[i]) << 32 | size);
+    memcpy(row + slot_offset, &slot, kSlotSize);
+    memcpy(row + cursors[i], values + value_offset, size);
+    cursors[i] += RoundUp8(size);
+  }
+}
+
+// Row to columnar, the values of a column. The validity bitmap is set by the caller.
+
+template <typename T>
+arrow::Result<std::shared_ptr<arrow::Buffer>> ReadSlots(int64_t num_rows,
+                                                        const int64_t* rows,
+                                                        int64_t slot_offset,
+                                                        arrow::MemoryPool* pool) {
+  ARROW_ASSIGN_OR_RAISE(auto buffer, Allocate(num_rows * sizeof(T), pool));
+  auto values = reinterpret_cast<T*>(buffer->mutable_data());
+  for (int64_t i = 0; i < num_rows; ++i) {
+    memcpy(values + i, reinterpret_cast<const uint8_t*>(rows[i]) + slot_offset,
+           sizeof(T));
+  }
+  return buffer;
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> ReadBooleanSlots(int64_t num_rows,
+                                                               const int64_t* rows,
+                                                               int64_t slot_offset,
+                                                               arrow::MemoryPool* pool) {
+  auto size = arrow::BitUtil::BytesForBits(num_rows);
+  ARROW_ASSIGN_OR_RAISE(auto buffer, Allocate(size, pool));
+  auto bits = buffer->mutable_data();
+  memset(bits, 0, size);
+  for (int64_t i = 0; i < num_rows; ++i) {
+    if (reinterpret_cast<const uint8_t*>(rows[i])[slot_offset] != 0) {
+      arrow::BitUtil::SetBit(bits, i);
+    }
+  }
+  return buffer;
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> ReadDecimalSlots(int64_t num_rows,
+                                                               const int64_t* rows,
+                                                               int64_t slot_offset,
+                                                               arrow::MemoryPool* pool) {
+  ARROW_ASSIGN_OR_RAISE(auto buffer,
+                        Allocate(num_rows * arrow::Decimal128Type::kByteWidth, pool));
+  auto values = buffer->mutable_data();
+  for (int64_t i = 0; i < num_rows; ++i) {
+    int64_t unscaled;
+    memcpy(&unscaled, reinterpret_cast<const uint8_t*>(rows[i]) + slot_offset,
+           kSlotSize);
+    arrow::Decimal128(unscaled).ToBytes(values + i * arrow::Decimal128Type::kByteWidth);
+  }
+  return buffer;
+}
+
+// the offsets and the data buffers of a string or binary column
+arrow::Status ReadBinarySlots(int64_t num_rows, const int64_t* rows,
+                              const int32_t* row_sizes, int64_t slot_offset,
+                              const uint8_t* validity, arrow::MemoryPool* pool,
+                              std::shared_ptr<arrow::Buffer>* offsets_out,
+                              std::shared_ptr<arrow::Buffer>* data_out) {
+  ARROW_ASSIGN_OR_RAISE(auto offsets_buffer,
+                        Allocate((num_rows + 1) * sizeof(int32_t), pool));
+  auto offsets = reinterpret_cast<int32_t*>(offsets_buffer->mutable_data());
+  int64_t total = 0;
+  offsets[0] = 0;
+  for (int64_t i = 0; i < num_rows; ++i) {
+    if (arrow::BitUtil::GetBit(validity, i)) {
+      uint64_t slot;
+      memcpy(&slot, reinterpret_cast<const uint8_t*>(rows[i]) + slot_offset, kSlotSize);
+      auto offset = static_cast<int64_t>(slot >> 32);
+      auto size = static_cast<int64_t>(slot & 0xFFFFFFFF);
+      if (offset + size > row_sizes[i]) {
+        return arrow::Status::Invalid("variable length data of row ", i,
+                                      " is past its end");
+      }
+      total += size;
+      if (total > std::numeric_limits<int32_t>::max()) {
+        return arrow::Status::CapacityError("binary data of ", num_rows,
+                                            " rows is over 2GB");
+      }
+    }
+    offsets[i + 1] = static_cast<int32_t>(total);
+  }
+  ARROW_ASSIGN_OR_RAISE(auto data_buffer, Allocate(total, pool));
+  auto data = data_buffer->mutable_data();
+  for (int64_t i = 0; i < num_rows; ++i) {
+    auto size = offsets[i + 1] - offsets[i];
+    if (size > 0) {
+      uint64_t slot;
+      auto row = reinterpret_cast<const uint8_t*>(rows[i]);
+      memcpy(&slot, row + slot_offset, kSlotSize);
+      memcpy(data + offsets[i], row + (slot >> 32), size);
+    }
+  }
+  *offsets_out = std::move(offsets_buffer);
+  *data_out = std::move(data_buffer);
+  return arrow::Status::OK();
+}
+
+}  // namespace
+
+RowConverter::RowConverter(std::shared_ptr<arrow::Schema> schema, arrow::MemoryPool* pool)
+    : schema_(std::move(schema)), pool_(pool) {
+  auto num_fields = schema_->num_fields();
+  bitset_size_ = ((num_fields + 63) / 64) * kSlotSize;
+  fixed_size_ = bitset_size_ + num_fields * kSlotSize;
+}
+
+arrow::Result<std::shared_ptr<RowConverter>> RowConverter::Make(
+    std::shared_ptr<arrow::Schema> schema, arrow::MemoryPool* pool) {
+  for (const auto& field : schema->fields()) {
+    if (!IsSupported(*field->type())) {
+      return arrow::Status::NotImplemented("UnsafeRow conversion of field ",
+                                           field->ToString());
+    }
+  }
+  return std::shared_ptr<RowConverter>(new RowConverter(std::move(schema), pool));
+}
+
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> RowConverter::ToColumnar(
+    int64_t num_rows, const int64_t* rows, const int32_t* row_sizes) {
+  for (int64_t i = 0; i < num_rows; ++i) {
+    if (row_sizes[i] < fixed_size_) {
+      return arrow::Status::Invalid("row ", i, " of ", row_sizes[i],
+                                    " bytes is shorter than its slots");
+    }
+  }
+  auto num_fields = schema_->num_fields();
+  auto bitmap_size = arrow::BitUtil::BytesForBits(num_rows);
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  columns.reserve(num_fields);
+  for (int field = 0; field < num_fields; ++field) {
+    // the null bits of UnsafeRow are little endian words, i.e. bit field of the row
+    ARROW_ASSIGN_OR_RAISE(auto validity, Allocate(bitmap_size, pool_));
+    auto validity_bits = validity->mutable_data();
+    memset(validity_bits, 0, bitmap_size);
+    int64_t null_count = 0;
+    for (int64_t i = 0; i < num_rows; ++i) {
+      if (arrow::BitUtil::GetBit(reinterpret_cast<const uint8_t*>(rows[i]), field)) {
+        ++null_count;
+      } else {
+        arrow::BitUtil::SetBit(validity_bits, i);
+      }
+    }
+
+    auto type = schema_->field(field)->type();
+    auto slot_offset = bitset_size_ + field * kSlotSize;
+    std::vector<std::shared_ptr<arrow::Buffer>> buffers = {validity};
+    std::shared_ptr<arrow::Buffer> values;
+    switch (type->id()) {
+#define PROCESS(TYPE_ID, CTYPE)                                                  \
+  case arrow::Type::TYPE_ID:                                                     \
+    ARROW_ASSIGN_OR_RAISE(values,                                                \
+                          ReadSlots<CTYPE>(num_rows, rows, slot_offset, pool_)); \
+    break;
+      PROCESS(INT8, int8_t)
+      PROCESS(INT16, int16_t)
+      PROCESS(INT32, int32_t)
+      PROCESS(DATE32, int32_t)
+      PROCESS(INT64, int64_t)
+      PROCESS(TIMESTAMP, int64_t)
+      PROCESS(FLOAT, float)
+      PROCESS(DOUBLE, double)
+#undef PROCESS
+      case arrow::Type::BOOL:
+        ARROW_ASSIGN_OR_RAISE(values,
+                              ReadBooleanSlots(num_rows, rows, slot_offset, pool_));
+        break;
+      case arrow::Type::DECIMAL:
+        ARROW_ASSIGN_OR_RAISE(values,
+                              ReadDecimalSlots(num_rows, rows, slot_offset, pool_));
+        break;
+      case arrow::Type::STRING:
+      case arrow::Type::BINARY: {
+        std::shared_ptr<arrow::Buffer> offsets;
+        RETURN_NOT_OK(ReadBinarySlots(num_rows, rows, row_sizes, slot_offset,
+                                      validity_bits, pool_, &offsets, &values));
+        buffers.push_back(std::move(offsets));
+        break;
+      }
+      default:
+        return arrow::Status::NotImplemented("UnsafeRow conversion of type ",
+                                             type->ToString());
+    }
+    buffers.push_back(std::move(values));
+    columns.push_back(arrow::MakeArray(
+        arrow::ArrayData::Make(type, num_rows, std::move(buffers), null_count)));
+  }
+  return arrow::RecordBatch::Make(schema_, num_rows, std::move(columns));
+}
+
+arrow::Result<UnsafeRows> RowConverter::ToRows(const arrow::RecordBatch& batch) {
+  auto num_rows = batch.num_rows();
+  auto num_fields = batch.num_columns();
+  if (num_fields != schema_->num_fields()) {
+    return arrow::Status::Invalid("batch of ", num_fields, " columns for a schema of ",
+                                  schema_->num_fields());
+  }
+
+  // the size of each row, then their offsets
+  UnsafeRows out;
+  out.offsets.assign(num_rows + 1, fixed_size_);
+  auto& offsets = out.offsets;
+  for (int field = 0; field < num_fields; ++field) {
+    if (!arrow::is_binary_like(batch.column(field)->type_id())) {
+      continue;
+    }
+    const auto& array = static_cast<const arrow::BinaryArray&>(*batch.column(field));
+    for (int64_t i = 0; i < num_rows; ++i) {
+      if (array.IsValid(i)) {
+        offsets[i] += RoundUp8(array.value_length(i));
+      }
+    }
+  }
+  int64_t total = 0;
+  for (int64_t i = 0; i < num_rows; ++i) {
+    auto size = offsets[i];
+    offsets[i] = total;
+    total += size;
+  }
+  offsets[num_rows] = total;
+  ARROW_ASSIGN_OR_RAISE(out.buffer, Allocate(total, pool_));
+  auto data = out.buffer->mutable_data();
+  memset(data, 0, total);
+
+  std::vector<int64_t> cursors;
+  for (int field = 0; field < num_fields; ++field) {
+    const auto& array = *batch.column(field);
+    if (array.null_count() > 0) {
+      for (int64_t i = 0; i < num_rows; ++i) {
+        if (array.IsNull(i)) {
+          arrow::BitUtil::SetBit(data + offsets[i], field);
+        }
+      }
+    }
+
+    auto slot_offset = bitset_size_ + field * kSlotSize;
+    switch (array.type_id()) {
+#define PROCESS(TYPE_ID, ARRAY_TYPE)                                          \
+  case arrow::Type::TYPE_ID: {                                                \
+    const auto& typed = static_cast<const ARRAY_TYPE&>(array);                \
+    WriteSlots(typed, typed.raw_values(), offsets.data(), slot_offset, data); \
+    break;                                                                    \
+  }
+      PROCESS(INT8, arrow::Int8Array)
+      PROCESS(INT16, arrow::Int16Array)
+      PROCESS(INT32, arrow::Int32Array)
+      PROCESS(DATE32, arrow::Date32Array)
+      PROCESS(INT64, arrow::Int64Array)
+      PROCESS(TIMESTAMP, arrow::TimestampArray)
+      PROCESS(FLOAT, arrow::FloatArray)
+      PROCESS(DOUBLE, arrow::DoubleArray)
+#undef PROCESS
+      case arrow::Type::BOOL:
+        WriteBooleanSlots(static_cast<const arrow::BooleanArray&>(array),
+                          offsets.data(), slot_offset, data);
+        break;
+      case arrow::Type::DECIMAL:
+        WriteDecimalSlots(static_cast<const arrow::Decimal128Array&>(array),
+                          offsets.data(), slot_offset, data);
+        break;
+      case arrow::Type::STRING:
+      case arrow::Type::BINARY:
+        if (cursors.empty()) {
+          cursors.assign(num_rows, fixed_size_);
+        }
+        WriteBinarySlots(static_cast<const arrow::BinaryArray&>(array), offsets.data(),
+                         slot_offset, cursors.data(), data);
+        break;
+      default:
+        return arrow::Status::NotImplemented("UnsafeRow conversion of type ",
+                                             array.type()->ToString());
+    }
+  }
+  return std::move(out);
+}
+
+}  // namespace operators
+}  // namespace sparkcolumnarplugin
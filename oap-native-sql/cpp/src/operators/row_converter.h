@@ -0,0 +1,78 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/buffer.h>
+#include <arrow/memory_pool.h>
+#include <arrow/record_batch.h>
+#include <arrow/result.h>
+#include <arrow/type.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace operators {
+
+/// Rows in the Spark UnsafeRow format, written one after the other into a buffer
+struct UnsafeRows {
+  std::shared_ptr<arrow::Buffer> buffer;
+  /// row i is the offsets[i + 1] - offsets[i] bytes at buffer->data() + offsets[i]
+  std::vector<int64_t> offsets;
+};
+
+/// \brief Converts record batches of a schema from and to Spark UnsafeRows
+///
+/// An UnsafeRow is a null bitset of a bit per field rounded up to 8 bytes, then an 8
+/// byte slot per field, then the variable length data. A fixed width value is in the
+/// low bytes of its slot, the rest zeroed, and a string or binary one is the offset
+/// from the row start of its data shifted 32 bits left or'ed with its size, its data
+/// zero padded to 8 bytes. Decimals of up to 18 digits are their unscaled value in a
+/// slot, larger ones aren't supported, nor are nested types.
+///
+/// Both directions go a column at a time, a loop for each type over all the rows, and
+/// allocate from the memory pool the converter is made with.
+class RowConverter {
+ public:
+  static arrow::Result<std::shared_ptr<RowConverter>> Make(
+      std::shared_ptr<arrow::Schema> schema, arrow::MemoryPool* pool);
+
+  /// Batch of the num_rows UnsafeRows at the addresses in rows, of the sizes in
+  /// row_sizes. The rows are left untouched and may be released once it returns.
+  arrow::Result<std::shared_ptr<arrow::RecordBatch>> ToColumnar(int64_t num_rows,
+                                                                const int64_t* rows,
+                                                                const int32_t* row_sizes);
+
+  /// UnsafeRows of the rows of batch, which has the schema of the converter
+  arrow::Result<UnsafeRows> ToRows(const arrow::RecordBatch& batch);
+
+  const std::shared_ptr<arrow::Schema>& schema() const { return schema_; }
+
+ private:
+  RowConverter(std::shared_ptr<arrow::Schema> schema, arrow::MemoryPool* pool);
+
+  std::shared_ptr<arrow::Schema> schema_;
+  arrow::MemoryPool* pool_;
+  // bytes of the null bitset, then of the bitset and the slots of a row
+  int64_t bitset_size_;
+  int64_t fixed_size_;
+};
+
+}  // namespace operators
+}  // namespace sparkcolumnarplugin
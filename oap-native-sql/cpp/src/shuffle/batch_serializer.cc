@@ -0,0 +1,66 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shuffle/batch_serializer.h"
+
+#include <arrow/io/memory.h>
+#include <arrow/ipc/writer.h>
+
+#include <algorithm>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> SerializeBatches(
+    const std::shared_ptr<arrow::Schema>& schema,
+    const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches,
+    arrow::Compression::type codec, arrow::MemoryPool* pool) {
+  int64_t capacity = 0;
+  for (const auto& batch : batches) {
+    for (const auto& column : batch->columns()) {
+      for (const auto& buffer : column->data()->buffers) {
+        capacity += buffer != nullptr ? buffer->size() : 0;
+      }
+    }
+  }
+  // the uncompressed size, an upper bound of the compressed stream but for its metadata
+  ARROW_ASSIGN_OR_RAISE(auto sink, arrow::io::BufferOutputStream::Create(
+                                       std::max<int64_t>(capacity, 1024), pool));
+
+  auto options = arrow::ipc::IpcWriteOptions::Defaults();
+  options.allow_64bit = true;
+  options.compression = codec;
+  options.memory_pool = pool;
+  options.use_threads = false;
+  ARROW_ASSIGN_OR_RAISE(auto writer,
+                        arrow::ipc::NewStreamWriter(sink.get(), schema, options));
+  for (const auto& batch : batches) {
+    if (batch->num_rows() == 0) {
+      continue;
+    }
+    if (!batch->schema()->Equals(*schema)) {
+      return arrow::Status::Invalid("Batch schema ", batch->schema()->ToString(),
+                                    " does not match ", schema->ToString());
+    }
+    RETURN_NOT_OK(writer->WriteRecordBatch(*batch));
+  }
+  RETURN_NOT_OK(writer->Close());
+  return sink->Finish();
+}
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,46 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/buffer.h>
+#include <arrow/memory_pool.h>
+#include <arrow/record_batch.h>
+#include <arrow/result.h>
+#include <arrow/type.h>
+#include <arrow/util/compression.h>
+#include <memory>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// \brief Serialize batches as one IPC stream, their bodies compressed by codec
+///
+/// For the build side of a broadcast join, collected and broadcast in this form rather
+/// than as rows. The blobs of several tasks may be concatenated, ShuffleReader reads them
+/// back as they are, without a copy of the uncompressed buffers. Batches without rows
+/// are left out.
+/// \param codec UNCOMPRESSED, or a codec of the IPC format, LZ4_FRAME or ZSTD
+arrow::Result<std::shared_ptr<arrow::Buffer>> SerializeBatches(
+    const std::shared_ptr<arrow::Schema>& schema,
+    const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches,
+    arrow::Compression::type codec,
+    arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,76 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shuffle/buffer_pool.h"
+
+#include <cstring>
+#include <utility>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> BufferPool::Allocate(int64_t size,
+                                                                  bool zeroed) {
+  std::shared_ptr<arrow::Buffer> buffer;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = buffers_.find(size);
+    if (it != buffers_.end() && !it->second.empty()) {
+      buffer = std::move(it->second.back());
+      it->second.pop_back();
+      bytes_ -= size;
+    }
+  }
+  if (buffer == nullptr) {
+    ARROW_ASSIGN_OR_RAISE(buffer, arrow::AllocateBuffer(size));
+  }
+  if (zeroed) {
+    std::memset(buffer->mutable_data(), 0, size);
+  }
+  return buffer;
+}
+
+void BufferPool::Release(std::shared_ptr<arrow::Buffer> buffer) {
+  // still read by an array otherwise
+  if (buffer == nullptr || buffer.use_count() != 1 || !buffer->is_mutable()) {
+    return;
+  }
+  auto size = buffer->size();
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffers_[size].push_back(std::move(buffer));
+  bytes_ += size;
+}
+
+int64_t BufferPool::Clear() {
+  std::unordered_map<int64_t, std::vector<std::shared_ptr<arrow::Buffer>>> buffers;
+  int64_t bytes;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers.swap(buffers_);
+    bytes = bytes_;
+    bytes_ = 0;
+  }
+  return bytes;
+}
+
+int64_t BufferPool::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,61 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/buffer.h>
+#include <arrow/result.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// \brief Fixed-width buffers of partition writers, recycled across spills and
+/// partitions of a splitter
+///
+/// The buffers of a record batch written in background come back to the pool once
+/// written, and any writer of the splitter allocating buffers of the same size takes
+/// them instead of new ones. Thread safe, buffers are returned from the writer threads.
+class BufferPool {
+ public:
+  /// A buffer of size bytes, a recycled one if any. Zeroed if zeroed, e.g. for bitmaps
+  /// whose bits are set one by one, uninitialized otherwise.
+  arrow::Result<std::shared_ptr<arrow::Buffer>> Allocate(int64_t size, bool zeroed);
+
+  /// Recycle buffer if it is its only reference, otherwise it is freed with the others
+  void Release(std::shared_ptr<arrow::Buffer> buffer);
+
+  /// Free the recycled buffers, return their bytes
+  int64_t Clear();
+
+  /// Bytes of the recycled buffers
+  int64_t bytes() const;
+
+ private:
+  mutable std::mutex mutex_;
+  // recycled buffers by size
+  std::unordered_map<int64_t, std::vector<std::shared_ptr<arrow::Buffer>>> buffers_;
+  int64_t bytes_ = 0;
+};
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,225 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shuffle/decompressor.h"
+
+#include <arrow/array.h>
+#include <arrow/util/bit_util.h>
+#include <arrow/util/ubsan.h>
+#include <algorithm>
+#include <utility>
+
+#include "utils/trace.h"
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+namespace {
+
+inline int NumBuffers(const arrow::DataType& type) {
+  return arrow::is_binary_like(type.id()) ? 3 : 2;
+}
+
+}  // namespace
+
+arrow::Result<std::shared_ptr<Decompressor>> Decompressor::Make(
+    std::shared_ptr<arrow::Schema> schema) {
+  if (schema == nullptr) {
+    return arrow::Status::Invalid("Decompressor needs a schema");
+  }
+  return std::make_shared<Decompressor>(std::move(schema));
+}
+
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> Decompressor::Decompress(
+    arrow::Compression::type compression_codec, int64_t num_rows,
+    const int64_t* buf_addrs, const int64_t* buf_sizes, int64_t num_buffers,
+    const uint8_t* buf_mask) {
+  TRACE_SPAN("shuffle", "Decompress");
+  int64_t expected_buffers = 0;
+  for (const auto& field : schema_->fields()) {
+    expected_buffers += NumBuffers(*field->type());
+  }
+  if (num_buffers != expected_buffers) {
+    return arrow::Status::Invalid("Expected ", expected_buffers, " buffers, got ",
+                                  num_buffers);
+  }
+
+  // first pass: read the uncompressed size from the header of each compressed buffer to
+  // size the arena of the batch
+  uncompressed_sizes_.assign(num_buffers, -1);
+  int64_t arena_size = 0;
+  for (int64_t i = 0; i < num_buffers; ++i) {
+    if (compression_codec == arrow::Compression::UNCOMPRESSED ||
+        arrow::BitUtil::GetBit(buf_mask, i) || buf_sizes[i] == 0) {
+      continue;
+    }
+    if (buf_sizes[i] < static_cast<int64_t>(sizeof(int64_t))) {
+      return arrow::Status::Invalid(
+          "Likely corrupted message, compressed buffers "
+          "are larger than 8 bytes by construction");
+    }
+    uncompressed_sizes_[i] =
+        arrow::util::SafeLoadAs<int64_t>(reinterpret_cast<const uint8_t*>(buf_addrs[i]));
+    arena_size += arrow::BitUtil::RoundUpToMultipleOf64(uncompressed_sizes_[i]);
+  }
+
+  std::shared_ptr<arrow::Buffer> arena;
+  arrow::util::Codec* codec = nullptr;
+  if (arena_size > 0) {
+    ARROW_ASSIGN_OR_RAISE(arena, AcquireArena(arena_size));
+    ARROW_ASSIGN_OR_RAISE(codec, GetCodec(compression_codec));
+  }
+
+  // second pass: lay out the compressed buffers in consecutive slices of the arena, wrap
+  // the others
+  tasks_.clear();
+  std::vector<std::shared_ptr<arrow::ArrayData>> arrays;
+  arrays.reserve(schema_->num_fields());
+  int64_t buf_idx = 0;
+  int64_t arena_offset = 0;
+  for (const auto& field : schema_->fields()) {
+    auto field_buffers = NumBuffers(*field->type());
+    std::vector<std::shared_ptr<arrow::Buffer>> buffers;
+    buffers.reserve(field_buffers);
+    for (int j = 0; j < field_buffers; ++j, ++buf_idx) {
+      auto data = reinterpret_cast<const uint8_t*>(buf_addrs[buf_idx]);
+      auto uncompressed_size = uncompressed_sizes_[buf_idx];
+      if (uncompressed_size < 0) {
+        if (compression_codec != arrow::Compression::UNCOMPRESSED &&
+            !arrow::BitUtil::GetBit(buf_mask, buf_idx) && buf_sizes[buf_idx] == 0) {
+          buffers.push_back(nullptr);
+        } else {
+          buffers.push_back(std::make_shared<arrow::Buffer>(data, buf_sizes[buf_idx]));
+        }
+        continue;
+      }
+
+      auto out = arrow::SliceMutableBuffer(arena, arena_offset, uncompressed_size);
+      arena_offset += arrow::BitUtil::RoundUpToMultipleOf64(uncompressed_size);
+      tasks_.push_back({data + sizeof(int64_t),
+                        buf_sizes[buf_idx] - static_cast<int64_t>(sizeof(int64_t)),
+                        uncompressed_size, out->mutable_data()});
+      buffers.push_back(std::move(out));
+    }
+    arrays.push_back(arrow::ArrayData::Make(field->type(), num_rows, std::move(buffers)));
+  }
+  RETURN_NOT_OK(RunTasks(codec));
+  return arrow::RecordBatch::Make(schema_, num_rows, std::move(arrays));
+}
+
+arrow::Status Decompressor::SetNumThreads(int32_t num_threads) {
+  if (num_threads <= 0) {
+    return arrow::Status::Invalid(
+        "Number of decompression threads should be positive, got ", num_threads);
+  }
+  if (num_threads != num_threads_) {
+    pool_.reset();
+    if (num_threads > 1) {
+      ARROW_ASSIGN_OR_RAISE(pool_, WriterPool::Make(num_threads - 1, 0));
+    }
+    num_threads_ = num_threads;
+  }
+  return arrow::Status::OK();
+}
+
+arrow::Status Decompressor::RunTasks(arrow::util::Codec* codec) {
+  auto run = [this, codec](size_t begin, size_t end) -> arrow::Status {
+    for (auto i = begin; i < end; ++i) {
+      const auto& task = tasks_[i];
+      ARROW_ASSIGN_OR_RAISE(auto actual_decompressed,
+                            codec->Decompress(task.src_length, task.src, task.dst_length,
+                                              task.dst));
+      if (actual_decompressed != task.dst_length) {
+        return arrow::Status::Invalid("Failed to fully decompress buffer, expected ",
+                                      task.dst_length, " bytes but decompressed ",
+                                      actual_decompressed);
+      }
+    }
+    return arrow::Status::OK();
+  };
+
+  if (pool_ == nullptr || tasks_.size() < 2) {
+    return run(0, tasks_.size());
+  }
+
+  // split the tasks in contiguous groups of about the same compressed bytes, one per
+  // thread, the last group runs on the calling thread
+  int64_t total_length = 0;
+  for (const auto& task : tasks_) {
+    total_length += task.src_length;
+  }
+  auto num_groups = std::min(static_cast<size_t>(num_threads_), tasks_.size());
+  size_t begin = 0;
+  int64_t cumulative_length = 0;
+  for (size_t group = 0; group + 1 < num_groups; ++group) {
+    auto group_end_length = total_length * static_cast<int64_t>(group + 1) /
+                            static_cast<int64_t>(num_groups);
+    auto end = begin;
+    while (end < tasks_.size() && cumulative_length < group_end_length) {
+      cumulative_length += tasks_[end++].src_length;
+    }
+    if (end > begin) {
+      RETURN_NOT_OK(pool_->Submit(static_cast<int32_t>(group), 0,
+                                  [run, begin, end]() { return run(begin, end); }));
+    }
+    begin = end;
+  }
+  auto status = run(begin, tasks_.size());
+  // the background tasks write into the arena, always wait for them
+  auto pool_status = pool_->Wait();
+  RETURN_NOT_OK(status);
+  return pool_status;
+}
+
+arrow::Result<arrow::util::Codec*> Decompressor::GetCodec(
+    arrow::Compression::type compression_codec) {
+  if (codec_ == nullptr || codec_type_ != compression_codec) {
+    ARROW_ASSIGN_OR_RAISE(codec_, arrow::util::Codec::Create(compression_codec));
+    codec_type_ = compression_codec;
+  }
+  return codec_.get();
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> Decompressor::AcquireArena(int64_t size) {
+  // an arena only referenced by the pool holds no live slice anymore, the count can't
+  // grow back behind our back
+  for (const auto& arena : arenas_) {
+    if (arena.use_count() == 1 && arena->size() >= size) {
+      return arena;
+    }
+  }
+
+  max_arena_size_ = std::max(max_arena_size_, size);
+  ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> arena,
+                        arrow::AllocateBuffer(max_arena_size_));
+  if (arenas_.size() < kMaxPooledArenas) {
+    arenas_.push_back(arena);
+  } else {
+    // replace a free arena, which is too small
+    auto it = std::find_if(arenas_.begin(), arenas_.end(),
+                           [](const std::shared_ptr<arrow::Buffer>& pooled) {
+                             return pooled.use_count() == 1;
+                           });
+    if (it != arenas_.end()) {
+      *it = arena;
+    }
+  }
+  return arena;
+}
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
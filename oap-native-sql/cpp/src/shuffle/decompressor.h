@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/buffer.h>
+#include <arrow/record_batch.h>
+#include <arrow/result.h>
+#include <arrow/type.h>
+#include <arrow/util/compression.h>
+#include <memory>
+#include <vector>
+
+#include "shuffle/writer_pool.h"
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// \brief Assembles the record batches read on the reduce side from their compressed
+/// buffers
+///
+/// All compressed buffers of a batch are decompressed into slices of one arena buffer.
+/// The arenas are pooled and reused once every slice of the batch they hold is
+/// released, so steady state decompression allocates nothing. Uncompressed buffers are
+/// wrapped without copy, they must outlive the returned record batch. The buffers of
+/// one batch can be decompressed in parallel, see SetNumThreads.
+class Decompressor {
+ public:
+  /// Number of arenas kept in the pool, more may be in use
+  static constexpr size_t kMaxPooledArenas = 4;
+
+  static arrow::Result<std::shared_ptr<Decompressor>> Make(
+      std::shared_ptr<arrow::Schema> schema);
+
+  explicit Decompressor(std::shared_ptr<arrow::Schema> schema)
+      : schema_(std::move(schema)) {}
+
+  /// Decompress the buffers of each batch on num_threads threads, the calling thread
+  /// included. 1, the default, decompresses on the calling thread only.
+  arrow::Status SetNumThreads(int32_t num_threads);
+
+  /// \param compression_codec codec of the compressed buffers
+  /// \param buf_addrs addresses of the buffers of all columns in schema order, two per
+  /// column, three per binary-like column
+  /// \param buf_sizes sizes of the buffers
+  /// \param buf_mask bit i set if buffer i is not compressed
+  arrow::Result<std::shared_ptr<arrow::RecordBatch>> Decompress(
+      arrow::Compression::type compression_codec, int64_t num_rows,
+      const int64_t* buf_addrs, const int64_t* buf_sizes, int64_t num_buffers,
+      const uint8_t* buf_mask);
+
+ private:
+  struct DecompressTask {
+    const uint8_t* src;
+    int64_t src_length;
+    int64_t dst_length;
+    uint8_t* dst;
+  };
+
+  // Run the tasks in tasks_ and return the first error
+  arrow::Status RunTasks(arrow::util::Codec* codec);
+
+  arrow::Result<arrow::util::Codec*> GetCodec(arrow::Compression::type compression_codec);
+
+  // Return a free arena of at least size bytes
+  arrow::Result<std::shared_ptr<arrow::Buffer>> AcquireArena(int64_t size);
+
+  const std::shared_ptr<arrow::Schema> schema_;
+
+  arrow::Compression::type codec_type_ = arrow::Compression::UNCOMPRESSED;
+  std::unique_ptr<arrow::util::Codec> codec_;
+
+  std::vector<std::shared_ptr<arrow::Buffer>> arenas_;
+  // arena size of the largest batch so far, new arenas are allocated at least this large
+  int64_t max_arena_size_ = 0;
+
+  int32_t num_threads_ = 1;
+  // num_threads_ - 1 background threads, null if decompressing on the calling thread
+  std::shared_ptr<WriterPool> pool_;
+
+  // reused across batches: uncompressed size of each buffer, -1 if not compressed
+  std::vector<int64_t> uncompressed_sizes_;
+  std::vector<DecompressTask> tasks_;
+};
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,47 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <arrow/buffer.h>
+#include <arrow/status.h>
+#include <memory>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// \brief Destination of the partitions of Splitter in pushed output mode
+///
+/// Each spill of a partition is pushed as a complete IPC stream, schema message to end
+/// of stream marker, so the streams pushed for one partition by any number of map tasks
+/// can be concatenated in any order and read back by ShuffleReader. What the sink does
+/// with them, e.g. merge them per partition on a remote store, is up to it.
+class PartitionSink {
+ public:
+  virtual ~PartitionSink() = default;
+
+  /// Push one IPC stream of partition pid. May be called concurrently for different
+  /// partitions by the threads of a writer pool, and the stream is not reused after the
+  /// call, so the sink may keep it.
+  virtual arrow::Status Push(int32_t pid, std::shared_ptr<arrow::Buffer> stream) = 0;
+
+  /// Called once by Splitter::Stop after the last push, return once all pushed streams
+  /// are durable
+  virtual arrow::Status Finish() = 0;
+};
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -19,19 +19,68 @@
 
 #include <arrow/array.h>
 #include <arrow/io/file.h>
+#include <arrow/io/memory.h>
 #include <arrow/ipc/options.h>
 #include <arrow/ipc/writer.h>
 #include <arrow/record_batch.h>
+#include <arrow/util/checked_cast.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <memory>
+#include <mutex>
+#include "utils/macros.h"
+#include "utils/trace.h"
 
 namespace sparkcolumnarplugin {
 namespace shuffle {
 
+namespace {
+
+// bytes of each buffer compressed to sample the compression ratio of a stream
+constexpr int64_t kCompressionSampleBytes = 64 << 10;
+
+// Forwards to an output stream and adds the nanoseconds spent in writes to a counter
+class TimedOutputStream : public arrow::io::OutputStream {
+ public:
+  TimedOutputStream(arrow::io::OutputStream* out, std::atomic<int64_t>* write_time)
+      : out_(out), write_time_(write_time) {}
+
+  arrow::Status Close() override { return out_->Close(); }
+
+  bool closed() const override { return out_->closed(); }
+
+  arrow::Result<int64_t> Tell() const override { return out_->Tell(); }
+
+  arrow::Status Write(const void* data, int64_t nbytes) override {
+    TIME_NANO_OR_RAISE(*write_time_, out_->Write(data, nbytes));
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Write(const std::shared_ptr<arrow::Buffer>& data) override {
+    TIME_NANO_OR_RAISE(*write_time_, out_->Write(data));
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Flush() override {
+    TIME_NANO_OR_RAISE(*write_time_, out_->Flush());
+    return arrow::Status::OK();
+  }
+
+ private:
+  arrow::io::OutputStream* out_;
+  std::atomic<int64_t>* write_time_;
+};
+
+}  // namespace
+
 arrow::Result<std::shared_ptr<PartitionWriter>> PartitionWriter::Create(
     int32_t pid, int64_t capacity, Type::typeId last_type,
     const std::vector<Type::typeId>& column_type_id,
     const std::shared_ptr<arrow::Schema>& schema, const std::string& temp_file_path,
-    arrow::Compression::type compression_codec) {
+    arrow::Compression::type compression_codec,
+    std::shared_ptr<arrow::io::FileOutputStream> spill_file,
+    std::shared_ptr<PartitionSink> sink, BufferPool* buffer_pool) {
   auto buffers = TypeBufferMessages(Type::NUM_TYPES);
   auto binary_bulders = BinaryBuilders();
   auto large_binary_bulders = LargeBinaryBuilders();
@@ -48,44 +97,72 @@ arrow::Result<std::shared_ptr<PartitionWriter>> PartitionWriter::Create(
         builder.reset(new arrow::LargeBinaryBuilder(arrow::default_memory_pool()));
         large_binary_bulders.push_back(std::move(builder));
       } break;
-      case Type::SHUFFLE_NULL: {
-        buffers[type_id].push_back(std::unique_ptr<BufferMessage>(
-            new BufferMessage{.validity_buffer = nullptr, .value_buffer = nullptr}));
-      } break;
       default: {
-        std::shared_ptr<arrow::Buffer> validity_buffer;
-        std::shared_ptr<arrow::Buffer> value_buffer;
-        uint8_t* validity_addr;
-        uint8_t* value_addr;
-
-        ARROW_ASSIGN_OR_RAISE(validity_buffer, arrow::AllocateEmptyBitmap(capacity))
-        if (type_id == Type::SHUFFLE_BIT) {
-          ARROW_ASSIGN_OR_RAISE(value_buffer, arrow::AllocateEmptyBitmap(capacity))
-        } else {
-          ARROW_ASSIGN_OR_RAISE(value_buffer,
-                                arrow::AllocateBuffer(capacity * (1 << type_id)))
-        }
-        validity_addr = validity_buffer->mutable_data();
-        value_addr = value_buffer->mutable_data();
-        buffers[type_id].push_back(std::unique_ptr<BufferMessage>(
-            new BufferMessage{.validity_buffer = std::move(validity_buffer),
-                              .value_buffer = std::move(value_buffer),
-                              .validity_addr = validity_addr,
-                              .value_addr = value_addr}));
+        ARROW_ASSIGN_OR_RAISE(auto buf_msg,
+                              MakeBufferMessage(type_id, capacity, buffer_pool))
+        buffers[type_id].push_back(std::move(buf_msg));
       } break;
     }
   }
 
-  ARROW_ASSIGN_OR_RAISE(auto file,
-                        arrow::io::FileOutputStream::Open(temp_file_path, true));
+  std::shared_ptr<arrow::io::OutputStream> file;
+  if (spill_file == nullptr && sink == nullptr) {
+    ARROW_ASSIGN_OR_RAISE(file, arrow::io::FileOutputStream::Open(temp_file_path, true));
+  } else {
+    ARROW_ASSIGN_OR_RAISE(file, arrow::io::BufferOutputStream::Create());
+  }
 
   return std::make_shared<PartitionWriter>(
       pid, capacity, last_type, column_type_id, schema, temp_file_path, std::move(file),
       std::move(buffers), std::move(binary_bulders), std::move(large_binary_bulders),
-      compression_codec);
+      compression_codec, std::move(spill_file), std::move(sink), buffer_pool);
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> PartitionWriter::AllocateBuffer(
+    int64_t size, bool zeroed, BufferPool* buffer_pool) {
+  if (buffer_pool != nullptr) {
+    return buffer_pool->Allocate(size, zeroed);
+  }
+  std::shared_ptr<arrow::Buffer> buffer;
+  ARROW_ASSIGN_OR_RAISE(buffer, arrow::AllocateBuffer(size))
+  if (zeroed) {
+    std::memset(buffer->mutable_data(), 0, size);
+  }
+  return buffer;
+}
+
+arrow::Result<std::unique_ptr<BufferMessage>> PartitionWriter::MakeBufferMessage(
+    Type::typeId type_id, int64_t capacity, BufferPool* buffer_pool) {
+  if (type_id == Type::SHUFFLE_NULL) {
+    return std::unique_ptr<BufferMessage>(
+        new BufferMessage{.validity_buffer = nullptr, .value_buffer = nullptr});
+  }
+
+  std::shared_ptr<arrow::Buffer> validity_buffer;
+  std::shared_ptr<arrow::Buffer> value_buffer;
+  uint8_t* validity_addr;
+  uint8_t* value_addr;
+
+  // bitmaps are zeroed, the row-wise split mode sets their bits with or
+  auto bitmap_size = arrow::BitUtil::BytesForBits(capacity);
+  ARROW_ASSIGN_OR_RAISE(validity_buffer, AllocateBuffer(bitmap_size, true, buffer_pool))
+  if (type_id == Type::SHUFFLE_BIT) {
+    ARROW_ASSIGN_OR_RAISE(value_buffer, AllocateBuffer(bitmap_size, true, buffer_pool))
+  } else {
+    ARROW_ASSIGN_OR_RAISE(value_buffer,
+                          AllocateBuffer(capacity * (1 << type_id), false, buffer_pool))
+  }
+  validity_addr = validity_buffer->mutable_data();
+  value_addr = value_buffer->mutable_data();
+  return std::unique_ptr<BufferMessage>(
+      new BufferMessage{.validity_buffer = std::move(validity_buffer),
+                        .value_buffer = std::move(value_buffer),
+                        .validity_addr = validity_addr,
+                        .value_addr = value_addr});
 }
 
 arrow::Status PartitionWriter::Stop() {
+  // the last record batch stays in memory in consolidated output mode
   if (write_offset_[last_type_] != 0) {
     RETURN_NOT_OK(WriteArrowRecordBatch());
     std::fill(std::begin(write_offset_), std::end(write_offset_), 0);
@@ -96,12 +173,208 @@ arrow::Status PartitionWriter::Stop() {
   }
   if (!file_->closed()) {
     ARROW_ASSIGN_OR_RAISE(file_footer_, file_->Tell());
+    file_footer_ += bytes_spilled_;
+    if (spill_file_ != nullptr) {
+      auto stream_buffer = std::static_pointer_cast<arrow::io::BufferOutputStream>(file_);
+      ARROW_ASSIGN_OR_RAISE(stream_tail_, stream_buffer->Finish());
+      return arrow::Status::OK();
+    }
+    if (sink_ != nullptr) {
+      auto stream_buffer = std::static_pointer_cast<arrow::io::BufferOutputStream>(file_);
+      ARROW_ASSIGN_OR_RAISE(auto tail, stream_buffer->Finish());
+      // empty if the stream ended with the last spill
+      if (tail->size() > 0) {
+        TIME_NANO_OR_RAISE(write_time_, sink_->Push(pid_, std::move(tail)));
+      }
+      return arrow::Status::OK();
+    }
     return file_->Close();
   }
   return arrow::Status::OK();
 }
 
+arrow::Status PartitionWriter::Spill() {
+  TRACE_SPAN("shuffle", "Spill");
+  ++num_spills_;
+  if (writer_pool_ != nullptr) {
+    return SpillAsync();
+  }
+  RETURN_NOT_OK(WriteArrowRecordBatch());
+  std::fill(std::begin(write_offset_), std::end(write_offset_), 0);
+  return FlushStream();
+}
+
+arrow::Status PartitionWriter::AppendRecordBatch(const arrow::RecordBatch& record_batch) {
+  if (writer_pool_ != nullptr) {
+    // the spills queued before must reach the stream first
+    RETURN_NOT_OK(writer_pool_->Wait());
+  }
+  if (write_offset_[last_type_] != 0) {
+    RETURN_NOT_OK(WriteArrowRecordBatch());
+    std::fill(std::begin(write_offset_), std::end(write_offset_), 0);
+  }
+  RETURN_NOT_OK(WriteRecordBatch(record_batch));
+  return FlushStream();
+}
+
+arrow::Status PartitionWriter::SpillAsync() {
+  ARROW_ASSIGN_OR_RAISE(auto record_batch, MakeRecordBatch());
+  // the record batch owns the fixed-width buffers until written, continue with new ones
+  // and recycle these once written
+  auto spilled_buffers = std::make_shared<TypeBufferMessages>(std::move(buffers_));
+  RETURN_NOT_OK(ReallocateBuffers());
+  std::fill(std::begin(write_offset_), std::end(write_offset_), 0);
+
+  int64_t bytes = 0;
+  for (const auto& column : record_batch->column_data()) {
+    for (const auto& buffer : column->buffers) {
+      if (buffer != nullptr) {
+        bytes += buffer->size();
+      }
+    }
+  }
+  auto write = [this, record_batch, spilled_buffers]() mutable {
+    TRACE_SPAN("shuffle", "WriteSpill");
+    RETURN_NOT_OK(WriteRecordBatch(*record_batch));
+    RETURN_NOT_OK(FlushStream());
+    if (buffer_pool_ != nullptr) {
+      // the buffers are only referenced by spilled_buffers from now on
+      record_batch.reset();
+      ReleaseBuffers(spilled_buffers.get());
+    }
+    return arrow::Status::OK();
+  };
+  return writer_pool_->Submit(pid_, bytes, std::move(write));
+}
+
+int64_t PartitionWriter::BufferedBytes() const {
+  int64_t bytes = 0;
+  for (const auto& buf_msgs : buffers_) {
+    for (const auto& buf_msg : buf_msgs) {
+      if (buf_msg->validity_buffer != nullptr) {
+        bytes += buf_msg->validity_buffer->capacity();
+      }
+      if (buf_msg->value_buffer != nullptr) {
+        bytes += buf_msg->value_buffer->capacity();
+      }
+    }
+  }
+  for (const auto& builder : binary_builders_) {
+    bytes += builder->capacity() * sizeof(arrow::BinaryType::offset_type) +
+             builder->value_data_capacity();
+  }
+  for (const auto& builder : large_binary_builders_) {
+    bytes += builder->capacity() * sizeof(arrow::LargeBinaryType::offset_type) +
+             builder->value_data_capacity();
+  }
+  // written by the writer pool if set, whose inflight bytes cover it
+  if ((spill_file_ != nullptr || sink_ != nullptr) && writer_pool_ == nullptr &&
+      !file_->closed()) {
+    bytes += std::static_pointer_cast<arrow::io::BufferOutputStream>(file_)->capacity();
+  }
+  return bytes;
+}
+
+arrow::Status PartitionWriter::Evict() {
+  if (write_offset_[last_type_] != 0) {
+    RETURN_NOT_OK(Spill());
+  }
+  // builders release their memory once finished, only the fixed-width buffers are left
+  for (auto& buf_msgs : buffers_) {
+    for (auto& buf_msg : buf_msgs) {
+      buf_msg->validity_buffer.reset();
+      buf_msg->value_buffer.reset();
+      buf_msg->validity_addr = nullptr;
+      buf_msg->value_addr = nullptr;
+    }
+  }
+  buffers_released_ = true;
+  return arrow::Status::OK();
+}
+
+arrow::Status PartitionWriter::ReallocateBuffers() {
+  auto buffers = TypeBufferMessages(Type::NUM_TYPES);
+  for (auto type_id : column_type_id_) {
+    if (type_id != Type::SHUFFLE_BINARY && type_id != Type::SHUFFLE_LARGE_BINARY) {
+      ARROW_ASSIGN_OR_RAISE(auto buf_msg,
+                            MakeBufferMessage(type_id, capacity_, buffer_pool_))
+      buffers[type_id].push_back(std::move(buf_msg));
+    }
+  }
+  buffers_ = std::move(buffers);
+  buffers_released_ = false;
+  return arrow::Status::OK();
+}
+
+void PartitionWriter::ReleaseBuffers(TypeBufferMessages* buffers) {
+  for (auto& buf_msgs : *buffers) {
+    for (auto& buf_msg : buf_msgs) {
+      buffer_pool_->Release(std::move(buf_msg->validity_buffer));
+      buffer_pool_->Release(std::move(buf_msg->value_buffer));
+    }
+  }
+  buffers->clear();
+}
+
+arrow::Status PartitionWriter::FlushToSpillFile() {
+  auto stream_buffer = std::static_pointer_cast<arrow::io::BufferOutputStream>(file_);
+  ARROW_ASSIGN_OR_RAISE(auto buffer, stream_buffer->Finish());
+  int64_t offset;
+  {
+    // the spill file is shared with the writers of other partitions
+    std::unique_lock<std::mutex> lock;
+    if (writer_pool_ != nullptr) {
+      lock = std::unique_lock<std::mutex>(writer_pool_->io_mutex());
+    }
+    ARROW_ASSIGN_OR_RAISE(offset, spill_file_->Tell());
+    TIME_NANO_OR_RAISE(write_time_, spill_file_->Write(buffer));
+  }
+  spilled_segments_.emplace_back(offset, buffer->size());
+  bytes_spilled_ += buffer->size();
+  // the stream writer keeps writing to the same BufferOutputStream after reset
+  return stream_buffer->Reset();
+}
+
+arrow::Status PartitionWriter::PushToSink() {
+  // end the stream, the next record batch starts a new one with its schema
+  RETURN_NOT_OK(file_writer_->Close());
+  file_writer_opened_ = false;
+  auto stream_buffer = std::static_pointer_cast<arrow::io::BufferOutputStream>(file_);
+  ARROW_ASSIGN_OR_RAISE(auto buffer, stream_buffer->Finish());
+  bytes_spilled_ += buffer->size();
+  TIME_NANO_OR_RAISE(write_time_, sink_->Push(pid_, std::move(buffer)));
+  return stream_buffer->Reset();
+}
+
+arrow::Status PartitionWriter::FlushStream() {
+  if (spill_file_ != nullptr) {
+    return FlushToSpillFile();
+  }
+  if (sink_ != nullptr) {
+    return PushToSink();
+  }
+  return arrow::Status::OK();
+}
+
+arrow::Result<int64_t> PartitionWriter::CopyTo(arrow::io::RandomAccessFile* spilled,
+                                               arrow::io::OutputStream* out) {
+  for (const auto& segment : spilled_segments_) {
+    ARROW_ASSIGN_OR_RAISE(auto buffer, spilled->ReadAt(segment.first, segment.second));
+    RETURN_NOT_OK(out->Write(buffer));
+  }
+  if (stream_tail_ != nullptr) {
+    RETURN_NOT_OK(out->Write(stream_tail_));
+    stream_tail_.reset();
+  }
+  return file_footer_;
+}
+
 arrow::Status PartitionWriter::WriteArrowRecordBatch() {
+  ARROW_ASSIGN_OR_RAISE(auto record_batch, MakeRecordBatch());
+  return WriteRecordBatch(*record_batch);
+}
+
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> PartitionWriter::MakeRecordBatch() {
   std::vector<std::shared_ptr<arrow::Array>> arrays(schema_->num_fields());
   for (int i = 0; i < schema_->num_fields(); ++i) {
     auto type_id = column_type_id_[i];
@@ -118,32 +391,86 @@ arrow::Status PartitionWriter::WriteArrowRecordBatch() {
     } else {
       auto buf_msg_ptr = std::move(buffers_[type_id].front());
       buffers_[type_id].pop_front();
-      auto arr = arrow::ArrayData::Make(
-          schema_->field(i)->type(), write_offset_[last_type_],
-          std::vector<std::shared_ptr<arrow::Buffer>>{buf_msg_ptr->validity_buffer,
-                                                      buf_msg_ptr->value_buffer});
-      arrays[i] = arrow::MakeArray(arr);
+      const auto& type = schema_->field(i)->type();
+      if (type->id() == arrow::DictionaryType::type_id) {
+        const auto& dict_type =
+            arrow::internal::checked_cast<const arrow::DictionaryType&>(*type);
+        auto indices = arrow::MakeArray(arrow::ArrayData::Make(
+            dict_type.index_type(), write_offset_[last_type_],
+            std::vector<std::shared_ptr<arrow::Buffer>>{buf_msg_ptr->validity_buffer,
+                                                        buf_msg_ptr->value_buffer}));
+        arrays[i] =
+            std::make_shared<arrow::DictionaryArray>(type, indices, (*dictionaries_)[i]);
+      } else {
+        auto arr = arrow::ArrayData::Make(
+            type, write_offset_[last_type_],
+            std::vector<std::shared_ptr<arrow::Buffer>>{buf_msg_ptr->validity_buffer,
+                                                        buf_msg_ptr->value_buffer});
+        arrays[i] = arrow::MakeArray(arr);
+      }
       buffers_[type_id].push_back(std::move(buf_msg_ptr));
     }
   }
-  auto record_batch =
-      arrow::RecordBatch::Make(schema_, write_offset_[last_type_], std::move(arrays));
+  return arrow::RecordBatch::Make(schema_, write_offset_[last_type_], std::move(arrays));
+}
 
+arrow::Status PartitionWriter::WriteRecordBatch(const arrow::RecordBatch& record_batch) {
   if (!file_writer_opened_) {
+    if (compression_threshold_ > 0 && !compression_sampled_ &&
+        compression_codec_ != arrow::Compression::UNCOMPRESSED) {
+      compression_sampled_ = true;
+      ARROW_ASSIGN_OR_RAISE(auto compress, ShouldCompress(record_batch));
+      if (!compress) {
+        compression_codec_ = arrow::Compression::UNCOMPRESSED;
+      }
+    }
+
     auto options = arrow::ipc::IpcWriteOptions::Defaults();
     options.allow_64bit = true;
     options.compression = compression_codec_;
     options.use_threads = false;
 
-    auto res = arrow::ipc::NewStreamWriter(file_.get(), schema_, options);
+    timed_file_ = std::make_shared<TimedOutputStream>(file_.get(), &write_time_);
+    auto res = arrow::ipc::NewStreamWriter(timed_file_.get(), schema_, options);
     RETURN_NOT_OK(res.status());
     file_writer_ = *res;
     file_writer_opened_ = true;
   }
-  RETURN_NOT_OK(file_writer_->WriteRecordBatch(*record_batch));
+  // the stream writer compresses the buffers then writes them to timed_file_, the time
+  // not spent in writes is the compression
+  int64_t write_time = write_time_;
+  int64_t elapsed = 0;
+  TIME_NANO_OR_RAISE(elapsed, file_writer_->WriteRecordBatch(record_batch));
+  compress_time_ += elapsed - (write_time_ - write_time);
+  rows_written_ += record_batch.num_rows();
 
   return arrow::Status::OK();
 }
 
+arrow::Result<bool> PartitionWriter::ShouldCompress(
+    const arrow::RecordBatch& record_batch) {
+  ARROW_ASSIGN_OR_RAISE(auto codec, arrow::util::Codec::Create(compression_codec_));
+  int64_t sampled_bytes = 0;
+  int64_t compressed_bytes = 0;
+  ARROW_ASSIGN_OR_RAISE(auto scratch, arrow::AllocateResizableBuffer(0));
+  for (const auto& column : record_batch.columns()) {
+    for (const auto& buffer : column->data()->buffers) {
+      if (buffer == nullptr || buffer->size() == 0) {
+        continue;
+      }
+      auto length = std::min(buffer->size(), kCompressionSampleBytes);
+      auto max_length = codec->MaxCompressedLen(length, buffer->data());
+      RETURN_NOT_OK(scratch->Resize(max_length, false));
+      ARROW_ASSIGN_OR_RAISE(auto actual_length,
+                            codec->Compress(length, buffer->data(), max_length,
+                                            scratch->mutable_data()));
+      sampled_bytes += length;
+      // the IPC writer prefixes each compressed buffer with its uncompressed length
+      compressed_bytes += actual_length + static_cast<int64_t>(sizeof(int64_t));
+    }
+  }
+  return compressed_bytes <= sampled_bytes * (1 - compression_threshold_);
+}
+
 }  // namespace shuffle
 }  // namespace sparkcolumnarplugin
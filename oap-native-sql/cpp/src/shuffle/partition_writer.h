@@ -20,11 +20,20 @@
 #include <arrow/array/builder_binary.h>
 #include <arrow/buffer.h>
 #include <arrow/io/file.h>
+#include <arrow/io/memory.h>
 #include <arrow/ipc/writer.h>
+#include <arrow/record_batch.h>
 #include <arrow/status.h>
+#include <arrow/util/bit_util.h>
 #include <arrow/util/compression.h>
+#include <atomic>
+#include <utility>
 #include <vector>
+#include "shuffle/buffer_pool.h"
+#include "shuffle/partition_sink.h"
+#include "shuffle/scatter_kernels.h"
 #include "shuffle/type.h"
+#include "shuffle/writer_pool.h"
 
 namespace sparkcolumnarplugin {
 namespace shuffle {
@@ -93,6 +102,67 @@ arrow::enable_if_binary_like<T, arrow::Status> inline WriteNullableBinary(
   return arrow::Status::OK();
 }
 
+/// Columnar split mode kernel. Gathers the source rows listed in row_ids and appends
+/// them to the destination buffers starting at dst_offset, through the kernels chosen
+/// by CPU dispatch. A null source bitmap means the source column contains no null value.
+void inline ScatterFixedWidth(Type::typeId type_id, const BufferAddr& src,
+                              int64_t src_length, const int32_t* row_ids,
+                              int64_t num_rows, const BufferMessage& dst,
+                              int64_t dst_offset) {
+  const auto& kernels = GetScatterKernels();
+  if (type_id == Type::SHUFFLE_BIT) {
+    kernels.scatter_bits(src.value_addr, src_length, row_ids, num_rows, dst.value_addr,
+                         dst_offset);
+  } else {
+    kernels.scatter_values[type_id](src.value_addr, src_length, row_ids, num_rows,
+                                    dst.value_addr + (dst_offset << type_id));
+  }
+  if (src.validity_addr == nullptr) {
+    arrow::BitUtil::SetBitsTo(dst.validity_addr, dst_offset, num_rows, true);
+  } else {
+    kernels.scatter_bits(src.validity_addr, src_length, row_ids, num_rows,
+                         dst.validity_addr, dst_offset);
+  }
+}
+
+/// Columnar split mode kernel for binary columns. The offsets and data of the builder
+/// are reserved once for all the rows listed in row_ids, so appending never grows them.
+template <typename T, typename ArrayType = typename arrow::TypeTraits<T>::ArrayType,
+          typename BuilderType = typename arrow::TypeTraits<T>::BuilderType>
+arrow::enable_if_binary_like<T, arrow::Status> inline ScatterBinary(
+    const ArrayType& src, const int32_t* row_ids, int64_t num_rows,
+    BuilderType* builder) {
+  using offset_type = typename T::offset_type;
+
+  const auto* offsets = src.raw_value_offsets();
+  const auto* data = src.raw_data();
+  int64_t value_length = 0;
+  for (int64_t j = 0; j < num_rows; ++j) {
+    value_length += offsets[row_ids[j] + 1] - offsets[row_ids[j]];
+  }
+  RETURN_NOT_OK(builder->Reserve(num_rows));
+  RETURN_NOT_OK(builder->ReserveData(value_length));
+
+  if (src.null_count() == 0) {
+    for (int64_t j = 0; j < num_rows; ++j) {
+      auto offset = offsets[row_ids[j]];
+      builder->UnsafeAppend(data + offset,
+                            static_cast<offset_type>(offsets[row_ids[j] + 1] - offset));
+    }
+  } else {
+    for (int64_t j = 0; j < num_rows; ++j) {
+      if (src.IsValid(row_ids[j])) {
+        auto offset = offsets[row_ids[j]];
+        builder->UnsafeAppend(data + offset,
+                              static_cast<offset_type>(offsets[row_ids[j] + 1] - offset));
+      } else {
+        builder->UnsafeAppendNull();
+      }
+    }
+  }
+  return arrow::Status::OK();
+}
+
 }  // namespace detail
 class PartitionWriter {
  public:
@@ -100,10 +170,12 @@ class PartitionWriter {
                            const std::vector<Type::typeId>& column_type_id,
                            const std::shared_ptr<arrow::Schema>& schema,
                            std::string file_path,
-                           std::shared_ptr<arrow::io::FileOutputStream> file,
+                           std::shared_ptr<arrow::io::OutputStream> file,
                            TypeBufferMessages buffers, BinaryBuilders binary_builders,
                            LargeBinaryBuilders large_binary_builders,
-                           arrow::Compression::type compression_codec)
+                           arrow::Compression::type compression_codec,
+                           std::shared_ptr<arrow::io::FileOutputStream> spill_file,
+                           std::shared_ptr<PartitionSink> sink, BufferPool* buffer_pool)
       : pid_(pid),
         capacity_(capacity),
         last_type_(last_type),
@@ -115,16 +187,31 @@ class PartitionWriter {
         binary_builders_(std::move(binary_builders)),
         large_binary_builders_(std::move(large_binary_builders)),
         compression_codec_(compression_codec),
+        spill_file_(std::move(spill_file)),
+        sink_(std::move(sink)),
+        buffer_pool_(buffer_pool),
         write_offset_(Type::typeId::NUM_TYPES),
         file_footer_(0),
         file_writer_opened_(false),
         file_writer_(nullptr) {}
 
+  /// Create a writer for partition pid.
+  /// \param temp_file_path file the partition is written to. Ignored if spill_file is
+  /// set, in which case it names the consolidated data file
+  /// \param spill_file consolidated output mode. The IPC stream is buffered in memory
+  /// and each spill appends it to spill_file shared by all writers, see CopyTo
+  /// \param sink pushed output mode. The IPC stream is buffered in memory and each spill
+  /// ends it and pushes it to sink, nothing is written locally
+  /// \param buffer_pool where the fixed-width buffers are taken from and returned to
+  /// once written in background, shared with the other writers of the splitter. Not
+  /// owned, may be null to always allocate new buffers.
   static arrow::Result<std::shared_ptr<PartitionWriter>> Create(
       int32_t pid, int64_t capacity, Type::typeId last_type,
       const std::vector<Type::typeId>& column_type_id,
       const std::shared_ptr<arrow::Schema>& schema, const std::string& temp_file_path,
-      arrow::Compression::type compression_codec);
+      arrow::Compression::type compression_codec,
+      std::shared_ptr<arrow::io::FileOutputStream> spill_file = nullptr,
+      std::shared_ptr<PartitionSink> sink = nullptr, BufferPool* buffer_pool = nullptr);
 
   arrow::Status Stop();
 
@@ -142,9 +229,75 @@ class PartitionWriter {
 
   arrow::Status WriteArrowRecordBatch();
 
+  /// Hand the record batches to the pool on spill, which compresses and writes them in
+  /// background. The pool must be drained before Stop, BytesWritten and CopyTo.
+  void set_writer_pool(WriterPool* writer_pool) { writer_pool_ = writer_pool; }
+
+  /// Dictionaries of the dictionary encoded columns, whose buffers hold the indices.
+  /// Indexed by column, owned by the splitter.
+  void set_dictionaries(const std::vector<std::shared_ptr<arrow::Array>>* dictionaries) {
+    dictionaries_ = dictionaries;
+  }
+
+  /// Sample the first record batch of the stream and write the whole stream
+  /// uncompressed if compressing saves less than threshold of its bytes. 0, the
+  /// default, always compresses. The stream codec is then chosen per partition, so the
+  /// reduce side must take it from the IPC messages, as ShuffleReader does.
+  void set_compression_threshold(double threshold) { compression_threshold_ = threshold; }
+
+  /// Codec of the stream, known once the first record batch is written
+  arrow::Compression::type compression_codec() const { return compression_codec_; }
+
+  /// Write the buffered rows to output stream as RecordBatch and reset write offsets
+  arrow::Status Spill();
+
+  /// Write record_batch to the output stream as is, after the rows buffered so far. The
+  /// buffers of record_batch may not outlive the call, so the write is synchronous even
+  /// with a writer pool.
+  arrow::Status AppendRecordBatch(const arrow::RecordBatch& record_batch);
+
+  /// Bytes of memory held by the buffers, the binary builders and, in consolidated and
+  /// pushed output modes, the in-memory IPC stream
+  int64_t BufferedBytes() const;
+
+  /// Spill the buffered rows and release the fixed-width buffers, which must be
+  /// reallocated by ReallocateBuffers before the next write
+  arrow::Status Evict();
+
+  arrow::Status ReallocateBuffers();
+
+  bool buffers_released() const { return buffers_released_; }
+
+  /// Number of rows the writer can still buffer before it has to spill
+  int64_t remaining_capacity() { return capacity_ - write_offset_[last_type_]; }
+
+  /// Consolidated output mode. Copy the whole IPC stream of the partition to out,
+  /// segments appended to the spill file first, then the part buffered in memory. Must
+  /// be called after Stop.
+  /// \param spilled the spill file opened for read, may be null if nothing was spilled
+  /// \param out consolidated data file
+  /// \return number of bytes copied
+  arrow::Result<int64_t> CopyTo(arrow::io::RandomAccessFile* spilled,
+                                arrow::io::OutputStream* out);
+
+  /// Nanoseconds spent serializing and compressing record batches, summed over the
+  /// threads writing them. Complete once the writer pool is drained.
+  int64_t compress_time() const { return compress_time_; }
+
+  /// Nanoseconds spent writing to the output stream and the spill file, summed over the
+  /// threads writing them. Complete once the writer pool is drained.
+  int64_t write_time() const { return write_time_; }
+
+  /// Number of spills, which happen when the buffers are full or the writer is evicted
+  int64_t num_spills() const { return num_spills_; }
+
+  /// Rows written to the output stream. Complete once the writer pool is drained.
+  int64_t rows_written() const { return rows_written_; }
+
   arrow::Result<int64_t> BytesWritten() {
     if (!file_->closed()) {
       ARROW_ASSIGN_OR_RAISE(file_footer_, file_->Tell());
+      file_footer_ += bytes_spilled_;
     }
     return file_footer_;
   }
@@ -152,8 +305,7 @@ class PartitionWriter {
   arrow::Result<bool> inline CheckTypeWriteEnds(const Type::typeId& type_id) {
     if (write_offset_[type_id] == capacity_) {
       if (type_id == last_type_) {
-        RETURN_NOT_OK(WriteArrowRecordBatch());
-        std::fill(std::begin(write_offset_), std::end(write_offset_), 0);
+        RETURN_NOT_OK(Spill());
       }
       return true;
     }
@@ -255,6 +407,46 @@ class PartitionWriter {
     return true;
   }
 
+  /// Columnar split mode. Copy the rows listed in row_ids from a fixed-width source
+  /// column into the idx-th buffer of type_id. The caller must guarantee num_rows does
+  /// not exceed remaining_capacity(), and call AdvanceWriteOffset once all columns are
+  /// written.
+  /// \param type_id shuffle type id of the source column
+  /// \param idx index of the column among the columns of type_id
+  /// \param src source buffers
+  /// \param src_length number of rows in source buffers
+  /// \param row_ids ascending indices of the rows to copy in source buffers
+  /// \param num_rows number of rows to copy
+  void inline WriteColumn(Type::typeId type_id, int32_t idx, const BufferAddr& src,
+                          int64_t src_length, const int32_t* row_ids, int64_t num_rows) {
+    detail::ScatterFixedWidth(type_id, src, src_length, row_ids, num_rows,
+                              *buffers_[type_id][idx], write_offset_[type_id]);
+  }
+
+  /// Columnar split mode. Copy the rows listed in row_ids from a binary source column
+  /// into the idx-th binary builder
+  arrow::Status inline WriteBinaryColumn(int32_t idx, const arrow::BinaryArray& src,
+                                         const int32_t* row_ids, int64_t num_rows) {
+    return detail::ScatterBinary<arrow::BinaryType>(src, row_ids, num_rows,
+                                                    binary_builders_[idx].get());
+  }
+
+  /// Columnar split mode. Copy the rows listed in row_ids from a large binary source
+  /// column into the idx-th large binary builder
+  arrow::Status inline WriteLargeBinaryColumn(int32_t idx,
+                                              const arrow::LargeBinaryArray& src,
+                                              const int32_t* row_ids, int64_t num_rows) {
+    return detail::ScatterBinary<arrow::LargeBinaryType>(
+        src, row_ids, num_rows, large_binary_builders_[idx].get());
+  }
+
+  /// Columnar split mode. Commit num_rows rows written by WriteColumn for all types
+  void inline AdvanceWriteOffset(int64_t num_rows) {
+    for (auto& offset : write_offset_) {
+      offset += num_rows;
+    }
+  }
+
  private:
   const int32_t pid_;
   const int64_t capacity_;
@@ -263,12 +455,73 @@ class PartitionWriter {
   const std::shared_ptr<arrow::Schema>& schema_;
   const std::string file_path_;
 
-  std::shared_ptr<arrow::io::FileOutputStream> file_;
+  std::shared_ptr<arrow::io::OutputStream> file_;
+  // forwards to file_, timing the writes of file_writer_
+  std::shared_ptr<arrow::io::OutputStream> timed_file_;
   TypeBufferMessages buffers_;
   BinaryBuilders binary_builders_;
   LargeBinaryBuilders large_binary_builders_;
   arrow::Compression::type compression_codec_;
 
+  // consolidated output mode: file_ is an in-memory BufferOutputStream, flushed to
+  // spill_file_ on each spill. (offset, length) of the flushed segments
+  std::shared_ptr<arrow::io::FileOutputStream> spill_file_;
+  std::vector<std::pair<int64_t, int64_t>> spilled_segments_;
+  int64_t bytes_spilled_ = 0;
+  std::shared_ptr<arrow::Buffer> stream_tail_;
+
+  // pushed output mode: file_ is an in-memory BufferOutputStream, ended and pushed to
+  // sink_ on each spill, bytes_spilled_ counts the bytes pushed
+  std::shared_ptr<PartitionSink> sink_;
+  // the stream is sampled once, not on each of its restarts
+  bool compression_sampled_ = false;
+
+  arrow::Status FlushToSpillFile();
+
+  arrow::Status PushToSink();
+
+  // Flush the in-memory IPC stream after a spill, if the output mode buffers it
+  arrow::Status FlushStream();
+
+  arrow::Result<std::shared_ptr<arrow::RecordBatch>> MakeRecordBatch();
+
+  arrow::Status WriteRecordBatch(const arrow::RecordBatch& record_batch);
+
+  // Compress a prefix of each buffer of record_batch, true if that saves at least
+  // compression_threshold_ of the sampled bytes
+  arrow::Result<bool> ShouldCompress(const arrow::RecordBatch& record_batch);
+
+  arrow::Status SpillAsync();
+
+  // Return the fixed-width buffers of a record batch written in background to
+  // buffer_pool_, which must be set
+  void ReleaseBuffers(TypeBufferMessages* buffers);
+
+  // not owned, null if spills are written synchronously
+  WriterPool* writer_pool_ = nullptr;
+  double compression_threshold_ = 0;
+  // not owned, null if no column is dictionary encoded
+  const std::vector<std::shared_ptr<arrow::Array>>* dictionaries_ = nullptr;
+
+  // not owned, null if the buffers are not recycled
+  BufferPool* buffer_pool_;
+
+  static arrow::Result<std::unique_ptr<BufferMessage>> MakeBufferMessage(
+      Type::typeId type_id, int64_t capacity, BufferPool* buffer_pool);
+
+  // Allocate a fixed-width buffer, from buffer_pool if not null
+  static arrow::Result<std::shared_ptr<arrow::Buffer>> AllocateBuffer(
+      int64_t size, bool zeroed, BufferPool* buffer_pool);
+
+  // set by Evict until ReallocateBuffers
+  bool buffers_released_ = false;
+
+  // updated by the writer threads if a writer pool is set
+  std::atomic<int64_t> compress_time_{0};
+  std::atomic<int64_t> write_time_{0};
+  std::atomic<int64_t> rows_written_{0};
+  int64_t num_spills_ = 0;
+
   std::vector<int64_t> write_offset_;
   int64_t file_footer_;
   bool file_writer_opened_;
@@ -0,0 +1,447 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shuffle/partitioner.h"
+
+#include <arrow/array.h>
+#include <arrow/array/concatenate.h>
+#include <arrow/builder.h>
+#include <arrow/compute/context.h>
+#include <arrow/compute/kernels/take.h>
+#include <arrow/util/checked_cast.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+namespace {
+
+arrow::Status ValidateKeys(const std::shared_ptr<arrow::Schema>& schema,
+                           const std::vector<int32_t>& key_indices) {
+  if (key_indices.empty()) {
+    return arrow::Status::Invalid("Partitioning key columns should not be empty");
+  }
+  for (auto key : key_indices) {
+    if (key < 0 || key >= schema->num_fields()) {
+      return arrow::Status::Invalid("Partitioning key column ", key, " out of range [0, ",
+                                    schema->num_fields(), ")");
+    }
+  }
+  return arrow::Status::OK();
+}
+
+arrow::Status CheckHashable(const arrow::DataType& type) {
+  switch (type.id()) {
+    case arrow::Type::BOOL:
+    case arrow::Type::INT8:
+    case arrow::Type::INT16:
+    case arrow::Type::INT32:
+    case arrow::Type::DATE32:
+    case arrow::Type::INT64:
+    case arrow::Type::TIMESTAMP:
+    case arrow::Type::FLOAT:
+    case arrow::Type::DOUBLE:
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:
+      return arrow::Status::OK();
+    default:
+      return arrow::Status::NotImplemented("Hash partitioning on key type ",
+                                           type.ToString());
+  }
+}
+
+class HashPartitioner : public Partitioner {
+ public:
+  HashPartitioner(int32_t num_partitions, std::vector<int32_t> key_indices)
+      : num_partitions_(num_partitions), key_indices_(std::move(key_indices)) {}
+
+  arrow::Status Compute(const arrow::RecordBatch& record_batch, int32_t* pids) override {
+    auto num_rows = record_batch.num_rows();
+    hashes_.assign(num_rows, kSparkHashSeed);
+    // column at a time, each key is mixed into the hash of the previous ones
+    for (auto key : key_indices_) {
+      RETURN_NOT_OK(murmur3::HashColumn(*record_batch.column(key), hashes_.data()));
+    }
+
+    for (int64_t i = 0; i < num_rows; ++i) {
+      auto pid = hashes_[i] % num_partitions_;
+      pids[i] = pid < 0 ? pid + num_partitions_ : pid;
+    }
+    return arrow::Status::OK();
+  }
+
+ private:
+  const int32_t num_partitions_;
+  const std::vector<int32_t> key_indices_;
+  std::vector<int32_t> hashes_;
+};
+
+// Spark orders NaN after all other values and -0.0 equal to 0.0
+template <typename T>
+inline int CompareValues(const T& left, const T& right) {
+  return left < right ? -1 : (right < left ? 1 : 0);
+}
+
+template <typename T>
+inline int CompareFloatingPoint(T left, T right) {
+  auto left_nan = std::isnan(left);
+  auto right_nan = std::isnan(right);
+  if (left_nan || right_nan) {
+    return left_nan - right_nan;
+  }
+  return left < right ? -1 : (right < left ? 1 : 0);
+}
+
+template <>
+inline int CompareValues<float>(const float& left, const float& right) {
+  return CompareFloatingPoint(left, right);
+}
+
+template <>
+inline int CompareValues<double>(const double& left, const double& right) {
+  return CompareFloatingPoint(left, right);
+}
+
+// Compares the key column of the input rows with the same column of the bounds
+class KeyComparator {
+ public:
+  virtual ~KeyComparator() = default;
+
+  virtual void Reset(const arrow::Array& input) = 0;
+
+  virtual int Compare(int64_t row, int64_t bound) const = 0;
+};
+
+template <typename ArrayType>
+class TypedKeyComparator : public KeyComparator {
+ public:
+  TypedKeyComparator(const arrow::Array& bounds, bool ascending, bool nulls_first)
+      : bounds_(arrow::internal::checked_cast<const ArrayType&>(bounds)),
+        ascending_(ascending),
+        nulls_first_(nulls_first) {}
+
+  void Reset(const arrow::Array& input) override {
+    input_ = &arrow::internal::checked_cast<const ArrayType&>(input);
+  }
+
+  // the null ordering does not depend on the direction, as in Spark SortOrder
+  int Compare(int64_t row, int64_t bound) const override {
+    auto row_null = input_->IsNull(row);
+    auto bound_null = bounds_.IsNull(bound);
+    if (row_null || bound_null) {
+      auto result = bound_null - row_null;
+      return nulls_first_ ? result : -result;
+    }
+    auto result = CompareValues(input_->GetView(row), bounds_.GetView(bound));
+    return ascending_ ? result : -result;
+  }
+
+ private:
+  const ArrayType& bounds_;
+  const ArrayType* input_ = nullptr;
+  const bool ascending_;
+  const bool nulls_first_;
+};
+
+arrow::Result<std::unique_ptr<KeyComparator>> MakeKeyComparator(
+    const arrow::Array& bounds, bool ascending, bool nulls_first) {
+  std::unique_ptr<KeyComparator> comparator;
+  switch (bounds.type_id()) {
+#define KEY_COMPARATOR_CASE(TYPE_ID, ArrayType)                                         \
+  case TYPE_ID:                                                                         \
+    comparator.reset(new TypedKeyComparator<ArrayType>(bounds, ascending, nulls_first)); \
+    break;
+
+    KEY_COMPARATOR_CASE(arrow::Type::BOOL, arrow::BooleanArray)
+    KEY_COMPARATOR_CASE(arrow::Type::INT8, arrow::Int8Array)
+    KEY_COMPARATOR_CASE(arrow::Type::INT16, arrow::Int16Array)
+    KEY_COMPARATOR_CASE(arrow::Type::INT32, arrow::Int32Array)
+    KEY_COMPARATOR_CASE(arrow::Type::INT64, arrow::Int64Array)
+    KEY_COMPARATOR_CASE(arrow::Type::DATE32, arrow::Date32Array)
+    KEY_COMPARATOR_CASE(arrow::Type::TIMESTAMP, arrow::TimestampArray)
+    KEY_COMPARATOR_CASE(arrow::Type::FLOAT, arrow::FloatArray)
+    KEY_COMPARATOR_CASE(arrow::Type::DOUBLE, arrow::DoubleArray)
+    KEY_COMPARATOR_CASE(arrow::Type::STRING, arrow::BinaryArray)
+    KEY_COMPARATOR_CASE(arrow::Type::BINARY, arrow::BinaryArray)
+    KEY_COMPARATOR_CASE(arrow::Type::LARGE_STRING, arrow::LargeBinaryArray)
+    KEY_COMPARATOR_CASE(arrow::Type::LARGE_BINARY, arrow::LargeBinaryArray)
+#undef KEY_COMPARATOR_CASE
+    default:
+      return arrow::Status::NotImplemented("Range partitioning on key type ",
+                                           bounds.type()->ToString());
+  }
+  return comparator;
+}
+
+arrow::Status ValidateKeyOrder(const PartitioningOptions& options) {
+  auto num_keys = options.key_indices.size();
+  if ((!options.key_ascending.empty() && options.key_ascending.size() != num_keys) ||
+      (!options.key_nulls_first.empty() && options.key_nulls_first.size() != num_keys)) {
+    return arrow::Status::Invalid("Range key order should have one entry per key");
+  }
+  return arrow::Status::OK();
+}
+
+// Comparators of the key columns against the same columns of bounds, in the key order
+arrow::Result<std::vector<std::unique_ptr<KeyComparator>>> MakeKeyComparators(
+    const arrow::RecordBatch& bounds, const PartitioningOptions& options) {
+  std::vector<std::unique_ptr<KeyComparator>> comparators;
+  for (int k = 0; k < bounds.num_columns(); ++k) {
+    auto ascending = options.key_ascending.empty() || options.key_ascending[k];
+    auto nulls_first = options.key_nulls_first.empty() || options.key_nulls_first[k];
+    ARROW_ASSIGN_OR_RAISE(auto comparator,
+                          MakeKeyComparator(*bounds.column(k), ascending, nulls_first));
+    comparators.push_back(std::move(comparator));
+  }
+  return comparators;
+}
+
+int CompareKeys(const std::vector<std::unique_ptr<KeyComparator>>& comparators,
+                int64_t row, int64_t bound) {
+  for (const auto& comparator : comparators) {
+    auto result = comparator->Compare(row, bound);
+    if (result != 0) {
+      return result;
+    }
+  }
+  return 0;
+}
+
+class RangePartitioner : public Partitioner {
+ public:
+  RangePartitioner(std::vector<int32_t> key_indices,
+                   std::shared_ptr<arrow::RecordBatch> range_bounds,
+                   std::vector<std::unique_ptr<KeyComparator>> comparators)
+      : key_indices_(std::move(key_indices)),
+        range_bounds_(std::move(range_bounds)),
+        comparators_(std::move(comparators)) {}
+
+  arrow::Status Compute(const arrow::RecordBatch& record_batch, int32_t* pids) override {
+    for (size_t k = 0; k < key_indices_.size(); ++k) {
+      comparators_[k]->Reset(*record_batch.column(key_indices_[k]));
+    }
+
+    auto num_bounds = range_bounds_->num_rows();
+    auto num_rows = record_batch.num_rows();
+    for (int64_t i = 0; i < num_rows; ++i) {
+      // first bound not less than the key
+      int64_t low = 0;
+      int64_t high = num_bounds;
+      while (low < high) {
+        auto mid = low + (high - low) / 2;
+        if (CompareKeys(comparators_, i, mid) > 0) {
+          low = mid + 1;
+        } else {
+          high = mid;
+        }
+      }
+      pids[i] = static_cast<int32_t>(low);
+    }
+    return arrow::Status::OK();
+  }
+
+ private:
+  const std::vector<int32_t> key_indices_;
+  const std::shared_ptr<arrow::RecordBatch> range_bounds_;
+  std::vector<std::unique_ptr<KeyComparator>> comparators_;
+};
+
+}  // namespace
+
+arrow::Result<std::shared_ptr<Partitioner>> Partitioner::Make(
+    const std::shared_ptr<arrow::Schema>& schema, int32_t num_partitions,
+    const PartitioningOptions& options) {
+  switch (options.partitioning) {
+    case Partitioning::HASH: {
+      RETURN_NOT_OK(ValidateKeys(schema, options.key_indices));
+      if (num_partitions <= 0) {
+        return arrow::Status::Invalid(
+            "Number of partitions should be positive for hash partitioning");
+      }
+      for (auto key : options.key_indices) {
+        RETURN_NOT_OK(CheckHashable(*schema->field(key)->type()));
+      }
+      return std::make_shared<HashPartitioner>(num_partitions, options.key_indices);
+    }
+    case Partitioning::RANGE: {
+      RETURN_NOT_OK(ValidateKeys(schema, options.key_indices));
+      RETURN_NOT_OK(ValidateKeyOrder(options));
+      const auto& bounds = options.range_bounds;
+      if (bounds == nullptr ||
+          bounds->num_columns() != static_cast<int>(options.key_indices.size())) {
+        return arrow::Status::Invalid("Range bounds should have one column per key");
+      }
+      if (num_partitions > 0 && bounds->num_rows() >= num_partitions) {
+        return arrow::Status::Invalid("Too many range bounds ", bounds->num_rows(),
+                                      " for ", num_partitions, " partitions");
+      }
+      for (size_t k = 0; k < options.key_indices.size(); ++k) {
+        const auto& key_type = schema->field(options.key_indices[k])->type();
+        if (!bounds->column(k)->type()->Equals(key_type)) {
+          return arrow::Status::Invalid("Range bound type ",
+                                        bounds->column(k)->type()->ToString(),
+                                        " mismatch key type ", key_type->ToString());
+        }
+      }
+      ARROW_ASSIGN_OR_RAISE(auto comparators, MakeKeyComparators(*bounds, options));
+      return std::make_shared<RangePartitioner>(options.key_indices, bounds,
+                                                std::move(comparators));
+    }
+    default:
+      return arrow::Status::Invalid("Partitioner needs key columns");
+  }
+}
+
+arrow::Result<std::shared_ptr<RangeSampler>> RangeSampler::Make(
+    const std::shared_ptr<arrow::Schema>& schema, const PartitioningOptions& options,
+    int64_t sample_size, uint64_t seed, arrow::MemoryPool* pool) {
+  RETURN_NOT_OK(ValidateKeys(schema, options.key_indices));
+  RETURN_NOT_OK(ValidateKeyOrder(options));
+  if (sample_size <= 0 || sample_size > std::numeric_limits<int32_t>::max()) {
+    return arrow::Status::Invalid("Sample size ", sample_size, " out of range");
+  }
+  std::vector<std::shared_ptr<arrow::Field>> key_fields;
+  arrow::ArrayVector columns;
+  for (auto key : options.key_indices) {
+    key_fields.push_back(schema->field(key));
+    std::unique_ptr<arrow::ArrayBuilder> builder;
+    RETURN_NOT_OK(arrow::MakeBuilder(pool, schema->field(key)->type(), &builder));
+    std::shared_ptr<arrow::Array> column;
+    RETURN_NOT_OK(builder->Finish(&column));
+    columns.push_back(std::move(column));
+  }
+  auto key_schema = arrow::schema(std::move(key_fields));
+  auto sample = arrow::RecordBatch::Make(key_schema, 0, std::move(columns));
+  // fail early on the key types the range partitioner cannot compare
+  RETURN_NOT_OK(MakeKeyComparators(*sample, options).status());
+  return std::make_shared<RangeSampler>(schema, options, std::move(sample), sample_size,
+                                        seed, pool);
+}
+
+RangeSampler::RangeSampler(std::shared_ptr<arrow::Schema> schema,
+                           PartitioningOptions options,
+                           std::shared_ptr<arrow::RecordBatch> sample,
+                           int64_t sample_size, uint64_t seed, arrow::MemoryPool* pool)
+    : schema_(std::move(schema)),
+      options_(std::move(options)),
+      sample_size_(sample_size),
+      pool_(pool),
+      random_(seed),
+      sample_(std::move(sample)) {}
+
+arrow::Status RangeSampler::Sample(const arrow::RecordBatch& record_batch) {
+  if (record_batch.num_columns() != schema_->num_fields()) {
+    return arrow::Status::Invalid("Sampled batch has ", record_batch.num_columns(),
+                                  " columns, expected ", schema_->num_fields());
+  }
+  // Algorithm R over the sample followed by the input rows: slot j of the new sample
+  // holds row indices[j] of both
+  auto num_sampled = sample_->num_rows();
+  std::vector<int32_t> indices(num_sampled);
+  std::iota(indices.begin(), indices.end(), 0);
+  bool replaced = false;
+  for (int64_t i = 0; i < record_batch.num_rows(); ++i, ++num_rows_) {
+    auto index = static_cast<int32_t>(num_sampled + i);
+    if (num_rows_ < sample_size_) {
+      indices.push_back(index);
+      replaced = true;
+      continue;
+    }
+    auto slot = std::uniform_int_distribution<int64_t>(0, num_rows_)(random_);
+    if (slot < sample_size_) {
+      indices[slot] = index;
+      replaced = true;
+    }
+  }
+  if (!replaced) {
+    return arrow::Status::OK();
+  }
+
+  arrow::Int32Builder indices_builder(pool_);
+  RETURN_NOT_OK(indices_builder.AppendValues(indices));
+  std::shared_ptr<arrow::Array> indices_array;
+  RETURN_NOT_OK(indices_builder.Finish(&indices_array));
+  arrow::compute::FunctionContext ctx(pool_);
+  arrow::ArrayVector columns;
+  for (size_t k = 0; k < options_.key_indices.size(); ++k) {
+    std::shared_ptr<arrow::Array> concatenated;
+    RETURN_NOT_OK(arrow::Concatenate(
+        {sample_->column(k), record_batch.column(options_.key_indices[k])}, pool_,
+        &concatenated));
+    std::shared_ptr<arrow::Array> taken;
+    RETURN_NOT_OK(arrow::compute::Take(&ctx, *concatenated, *indices_array,
+                                       arrow::compute::TakeOptions(), &taken));
+    columns.push_back(std::move(taken));
+  }
+  sample_ =
+      arrow::RecordBatch::Make(sample_->schema(), indices.size(), std::move(columns));
+  return arrow::Status::OK();
+}
+
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> RangeSampler::ComputeBounds(
+    int32_t num_partitions) const {
+  if (num_partitions <= 0) {
+    return arrow::Status::Invalid("Number of partitions should be positive");
+  }
+  ARROW_ASSIGN_OR_RAISE(auto comparators, MakeKeyComparators(*sample_, options_));
+  for (int k = 0; k < sample_->num_columns(); ++k) {
+    comparators[k]->Reset(*sample_->column(k));
+  }
+  std::vector<int32_t> order(sample_->num_rows());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&comparators](int32_t left, int32_t right) {
+    return CompareKeys(comparators, left, right) < 0;
+  });
+
+  // as Spark RangePartitioner.determineBounds with equal weights: the first row past
+  // each step, skipping the rows equal to the previous bound
+  arrow::Int32Builder bounds_builder(pool_);
+  auto step = static_cast<double>(order.size()) / num_partitions;
+  double target = step;
+  int32_t previous = -1;
+  for (size_t i = 0; i < order.size() && bounds_builder.length() < num_partitions - 1;
+       ++i) {
+    if (i + 1 >= target &&
+        (previous < 0 || CompareKeys(comparators, order[i], previous) > 0)) {
+      RETURN_NOT_OK(bounds_builder.Append(order[i]));
+      previous = order[i];
+      target += step;
+    }
+  }
+  std::shared_ptr<arrow::Array> bound_indices;
+  RETURN_NOT_OK(bounds_builder.Finish(&bound_indices));
+  arrow::compute::FunctionContext ctx(pool_);
+  arrow::ArrayVector columns;
+  for (const auto& column : sample_->columns()) {
+    std::shared_ptr<arrow::Array> taken;
+    RETURN_NOT_OK(arrow::compute::Take(&ctx, *column, *bound_indices,
+                                       arrow::compute::TakeOptions(), &taken));
+    columns.push_back(std::move(taken));
+  }
+  return arrow::RecordBatch::Make(sample_->schema(), bound_indices->length(),
+                                  std::move(columns));
+}
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
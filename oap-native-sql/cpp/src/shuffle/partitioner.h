@@ -0,0 +1,111 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/record_batch.h>
+#include <arrow/result.h>
+#include <arrow/status.h>
+#include <arrow/type.h>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "shuffle/type.h"
+#include "utils/column_hash.h"
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+struct PartitioningOptions {
+  Partitioning partitioning = Partitioning::PARTITION_ID_COLUMN;
+  /// HASH and RANGE only. Indices of the key columns in the input schema
+  std::vector<int32_t> key_indices;
+  /// RANGE only. Upper bounds of all partitions but the last in the key order, one
+  /// column per key column with the same type
+  std::shared_ptr<arrow::RecordBatch> range_bounds;
+  /// RANGE only. Sort direction of each key column, all ascending if empty
+  std::vector<bool> key_ascending;
+  /// RANGE only. Null ordering of each key column, all nulls first if empty
+  std::vector<bool> key_nulls_first;
+  /// ROUND_ROBIN only. Partition the first slice of the first batch goes to
+  int32_t start_partition = 0;
+};
+
+/// \brief Computes the partition id of each row from the key columns
+class Partitioner {
+ public:
+  /// \param schema schema of the input record batches, without partition id column
+  /// \param num_partitions number of partitions, must be positive for HASH
+  static arrow::Result<std::shared_ptr<Partitioner>> Make(
+      const std::shared_ptr<arrow::Schema>& schema, int32_t num_partitions,
+      const PartitioningOptions& options);
+
+  virtual ~Partitioner() = default;
+
+  /// Write the partition id of each row of record_batch into pids
+  virtual arrow::Status Compute(const arrow::RecordBatch& record_batch,
+                                int32_t* pids) = 0;
+};
+
+/// \brief Uniform sample of the key rows of record batches, by reservoir sampling, to
+/// compute the bounds of range partitioning the way Spark RangePartitioner does
+class RangeSampler {
+ public:
+  /// \param schema schema of the input record batches
+  /// \param options key columns and their order, as for RANGE partitioning
+  /// \param sample_size maximum number of rows kept
+  static arrow::Result<std::shared_ptr<RangeSampler>> Make(
+      const std::shared_ptr<arrow::Schema>& schema, const PartitioningOptions& options,
+      int64_t sample_size, uint64_t seed,
+      arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+  /// \param sample empty batch of the key columns
+  RangeSampler(std::shared_ptr<arrow::Schema> schema, PartitioningOptions options,
+               std::shared_ptr<arrow::RecordBatch> sample, int64_t sample_size,
+               uint64_t seed, arrow::MemoryPool* pool);
+
+  /// Offer the rows of record_batch to the sample
+  arrow::Status Sample(const arrow::RecordBatch& record_batch);
+
+  /// Upper bounds of all partitions but the last: the distinct rows evenly spaced in
+  /// the sorted sample, at most num_partitions - 1
+  arrow::Result<std::shared_ptr<arrow::RecordBatch>> ComputeBounds(
+      int32_t num_partitions) const;
+
+  /// Schema of the input record batches
+  const std::shared_ptr<arrow::Schema>& schema() const { return schema_; }
+
+  /// Number of rows offered so far
+  int64_t num_rows() const { return num_rows_; }
+
+  /// Key columns of the sampled rows, in no particular order
+  const std::shared_ptr<arrow::RecordBatch>& sample() const { return sample_; }
+
+ private:
+  const std::shared_ptr<arrow::Schema> schema_;
+  const PartitioningOptions options_;
+  const int64_t sample_size_;
+  arrow::MemoryPool* pool_;
+  std::mt19937_64 random_;
+  int64_t num_rows_ = 0;
+  std::shared_ptr<arrow::RecordBatch> sample_;
+};
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
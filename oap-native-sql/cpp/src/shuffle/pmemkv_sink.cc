@@ -0,0 +1,74 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "shuffle/pmemkv_sink.h"
+
+// pmemkv.h uses memcpy without including it
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <pmemkv.h>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+namespace {
+arrow::Result<std::shared_ptr<pmemkv>> OpenStore(const std::string& device_path) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::weak_ptr<pmemkv>> stores;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto store = stores[device_path].lock();
+  if (store == nullptr) {
+    store = std::make_shared<pmemkv>(device_path.c_str());
+    // the pool is null if neither created nor opened
+    if (store->get_root() == 0) {
+      return arrow::Status::IOError("Failed to open pmemkv pool ", device_path);
+    }
+    stores[device_path] = store;
+  }
+  return store;
+}
+}  // namespace
+
+arrow::Result<std::shared_ptr<PmemkvPartitionSink>> PmemkvPartitionSink::Make(
+    const std::string& device_path, int64_t shuffle_id, int64_t map_id) {
+  ARROW_ASSIGN_OR_RAISE(auto store, OpenStore(device_path));
+  return std::make_shared<PmemkvPartitionSink>(std::move(store), shuffle_id, map_id);
+}
+
+PmemkvPartitionSink::PmemkvPartitionSink(std::shared_ptr<pmemkv> store,
+                                         int64_t shuffle_id, int64_t map_id)
+    : store_(std::move(store)),
+      prefix_("shuffle_" + std::to_string(shuffle_id) + "_" + std::to_string(map_id) +
+              "_") {}
+
+arrow::Status PmemkvPartitionSink::Push(int32_t pid,
+                                        std::shared_ptr<arrow::Buffer> stream) {
+  auto key = prefix_ + std::to_string(pid);
+  // written with non-temporal stores and published by a transaction of its lane
+  if (store_->put_nt(key, reinterpret_cast<const char*>(stream->data()),
+                     static_cast<uint64_t>(stream->size())) != 0) {
+    return arrow::Status::IOError("Failed to put ", key, " into pmemkv");
+  }
+  return arrow::Status::OK();
+}
+
+arrow::Status PmemkvPartitionSink::Finish() { return arrow::Status::OK(); }
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
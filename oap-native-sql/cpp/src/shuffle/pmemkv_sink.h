@@ -0,0 +1,57 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <arrow/result.h>
+#include <arrow/status.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "shuffle/partition_sink.h"
+
+class pmemkv;
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// \brief Partition sink appending the streams of each partition to a local pmemkv
+/// store, the one of RPMem-shuffle
+///
+/// The streams of partition pid are put under the name of its Spark ShuffleBlockId,
+/// shuffle_<shuffle id>_<map id>_<pid>, where pmemkv appends the blocks of a key in put
+/// order, so the partition is read back as one stream by its block id without going
+/// through the file system. Pushes are synchronous, each one durable once returned.
+class PmemkvPartitionSink : public PartitionSink {
+ public:
+  /// Open the pmemkv pool at device_path, created if it doesn't exist. The pools are
+  /// opened once per process and shared by the sinks, as pmemobj locks an open pool.
+  static arrow::Result<std::shared_ptr<PmemkvPartitionSink>> Make(
+      const std::string& device_path, int64_t shuffle_id, int64_t map_id);
+
+  PmemkvPartitionSink(std::shared_ptr<pmemkv> store, int64_t shuffle_id, int64_t map_id);
+
+  arrow::Status Push(int32_t pid, std::shared_ptr<arrow::Buffer> stream) override;
+
+  arrow::Status Finish() override;
+
+ private:
+  std::shared_ptr<pmemkv> store_;
+  const std::string prefix_;
+};
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,113 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shuffle/reader.h"
+
+#include <utility>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+arrow::Result<std::shared_ptr<ShuffleReader>> ShuffleReader::Make(
+    std::vector<std::shared_ptr<arrow::Buffer>> blocks,
+    std::shared_ptr<arrow::Schema> schema) {
+  for (const auto& block : blocks) {
+    if (block == nullptr) {
+      return arrow::Status::Invalid("Shuffle block is null");
+    }
+  }
+  return std::make_shared<ShuffleReader>(std::move(blocks), std::move(schema));
+}
+
+bool ShuffleReader::HasNext() {
+  if (next_ == nullptr && status_.ok()) {
+    status_ = ReadNext();
+  }
+  return next_ != nullptr || !status_.ok();
+}
+
+arrow::Status ShuffleReader::Next(std::shared_ptr<arrow::RecordBatch>* out) {
+  if (!HasNext()) {
+    return arrow::Status::Invalid("No more record batches in shuffle blocks");
+  }
+  RETURN_NOT_OK(status_);
+  *out = std::move(next_);
+  next_ = nullptr;
+  return arrow::Status::OK();
+}
+
+void ShuffleReader::SetLimit(int64_t limit) {
+  if (limit > 0) {
+    return;
+  }
+  reader_ = nullptr;
+  input_ = nullptr;
+  next_ = nullptr;
+  blocks_.clear();
+  next_block_ = 0;
+}
+
+arrow::Status ShuffleReader::ReadNext() {
+  while (true) {
+    if (reader_ != nullptr) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      RETURN_NOT_OK(reader_->ReadNext(&batch));
+      if (batch == nullptr) {
+        reader_ = nullptr;
+      } else if (batch->num_rows() > 0) {
+        next_ = std::move(batch);
+        return arrow::Status::OK();
+      }
+      continue;
+    }
+    ARROW_ASSIGN_OR_RAISE(auto opened, OpenNextStream());
+    if (!opened) {
+      return arrow::Status::OK();
+    }
+  }
+}
+
+arrow::Result<bool> ShuffleReader::OpenNextStream() {
+  // a block may hold several streams, e.g. consecutive blocks fetched in one request
+  while (true) {
+    if (input_ != nullptr) {
+      ARROW_ASSIGN_OR_RAISE(auto position, input_->Tell());
+      ARROW_ASSIGN_OR_RAISE(auto size, input_->GetSize());
+      if (position < size) {
+        break;
+      }
+    }
+    if (next_block_ == blocks_.size()) {
+      input_ = nullptr;
+      return false;
+    }
+    input_ = std::make_shared<arrow::io::BufferReader>(blocks_[next_block_++]);
+  }
+
+  ARROW_ASSIGN_OR_RAISE(reader_, arrow::ipc::RecordBatchStreamReader::Open(input_.get()));
+  if (schema_ == nullptr) {
+    schema_ = reader_->schema();
+  } else if (!reader_->schema()->Equals(*schema_)) {
+    return arrow::Status::Invalid("Shuffle stream schema ",
+                                  reader_->schema()->ToString(), " does not match ",
+                                  schema_->ToString());
+  }
+  return true;
+}
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,84 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/buffer.h>
+#include <arrow/io/memory.h>
+#include <arrow/ipc/reader.h>
+#include <arrow/record_batch.h>
+#include <arrow/result.h>
+#include <arrow/type.h>
+#include <memory>
+#include <vector>
+
+#include "codegen/common/result_iterator.h"
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// \brief Iterates the record batches of fetched shuffle blocks
+///
+/// Each block holds one or more concatenated IPC streams as written by PartitionWriter,
+/// whose compressed bodies are decompressed by the IPC reader. Uncompressed buffers are
+/// sliced from the blocks without copy, the blocks must outlive the returned batches.
+class ShuffleReader : public ResultIterator<arrow::RecordBatch> {
+ public:
+  /// \param blocks fetched blocks in reading order
+  /// \param schema expected schema of the streams, or null to take the schema of the
+  /// first stream
+  static arrow::Result<std::shared_ptr<ShuffleReader>> Make(
+      std::vector<std::shared_ptr<arrow::Buffer>> blocks,
+      std::shared_ptr<arrow::Schema> schema = nullptr);
+
+  ShuffleReader(std::vector<std::shared_ptr<arrow::Buffer>> blocks,
+                std::shared_ptr<arrow::Schema> schema)
+      : blocks_(std::move(blocks)), schema_(std::move(schema)) {}
+
+  /// Read ahead one batch, true if there is one or if reading it failed, in which case
+  /// Next returns the error
+  bool HasNext() override;
+
+  arrow::Status Next(std::shared_ptr<arrow::RecordBatch>* out) override;
+
+  /// Releases the blocks once the consumer is done, i.e. limit is 0
+  void SetLimit(int64_t limit) override;
+
+  /// Null until the first stream is opened if no schema was given
+  std::shared_ptr<arrow::Schema> schema() const { return schema_; }
+
+ private:
+  // Read the next non-empty batch into next_, leave it null at the end of the blocks
+  arrow::Status ReadNext();
+
+  // Open the next stream, in the current block or the following ones. Return false at
+  // the end of the blocks.
+  arrow::Result<bool> OpenNextStream();
+
+  std::vector<std::shared_ptr<arrow::Buffer>> blocks_;
+  std::shared_ptr<arrow::Schema> schema_;
+
+  size_t next_block_ = 0;
+  std::shared_ptr<arrow::io::BufferReader> input_;
+  std::shared_ptr<arrow::RecordBatchReader> reader_;
+
+  std::shared_ptr<arrow::RecordBatch> next_;
+  arrow::Status status_;
+};
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
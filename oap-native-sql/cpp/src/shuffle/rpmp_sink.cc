@@ -0,0 +1,84 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "shuffle/rpmp_sink.h"
+
+#include <pmpool/client/PmPoolClient.h>
+#include <utility>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+arrow::Result<std::shared_ptr<RpmpPartitionSink>> RpmpPartitionSink::Make(
+    const std::string& address, const std::string& port, const std::string& app,
+    int64_t shuffle_id, int32_t num_connections) {
+  auto client = std::make_shared<PmPoolClient>(address, port, num_connections);
+  if (client->init() != 0) {
+    return arrow::Status::IOError("Failed to connect to RPMP server ", address, ":",
+                                  port);
+  }
+  return std::make_shared<RpmpPartitionSink>(
+      std::move(client), PmPoolClient::shuffle_prefix(app, shuffle_id));
+}
+
+RpmpPartitionSink::RpmpPartitionSink(std::shared_ptr<PmPoolClient> client,
+                                     std::string prefix)
+    : client_(std::move(client)), prefix_(std::move(prefix)) {}
+
+RpmpPartitionSink::~RpmpPartitionSink() {
+  // the callbacks of the pushes in flight refer to this sink
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return inflight_ == 0; });
+  lock.unlock();
+  client_->shutdown();
+  client_->wait();
+}
+
+arrow::Status RpmpPartitionSink::Push(int32_t pid,
+                                      std::shared_ptr<arrow::Buffer> stream) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_) {
+      return arrow::Status::IOError("Failed to merge a partition into RPMP");
+    }
+    ++inflight_;
+  }
+  auto data = reinterpret_cast<const char*>(stream->data());
+  auto size = static_cast<uint64_t>(stream->size());
+  // the stream stays alive until the server acknowledged it
+  client_->merge(prefix_, {PmPoolClient::merge_key(pid)}, {data}, {size},
+                 [this, stream](std::vector<uint64_t> addresses) {
+                   std::lock_guard<std::mutex> lock(mutex_);
+                   failed_ |= addresses.empty();
+                   if (--inflight_ == 0) {
+                     done_cv_.notify_all();
+                   }
+                 });
+  return arrow::Status::OK();
+}
+
+arrow::Status RpmpPartitionSink::Finish() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return inflight_ == 0; });
+  if (failed_) {
+    return arrow::Status::IOError("Failed to merge a partition into RPMP");
+  }
+  return arrow::Status::OK();
+}
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
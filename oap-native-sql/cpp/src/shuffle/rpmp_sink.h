@@ -0,0 +1,66 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <arrow/result.h>
+#include <arrow/status.h>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "shuffle/partition_sink.h"
+
+class PmPoolClient;
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// \brief Partition sink merging the streams of each partition on an RPMP server
+///
+/// The streams of partition pid are merged under PmPoolClient::merge_key(pid) in the
+/// shuffle_prefix of the shuffle, appended by the server after those merged before by
+/// any map task, so a reducer fetches its whole partition in few large reads and
+/// del_prefix drops the shuffle. Pushes are asynchronous, Finish waits for all of them.
+class RpmpPartitionSink : public PartitionSink {
+ public:
+  /// Connect to the RPMP server at address:port
+  /// \param app application the shuffle belongs to, e.g. the Spark application id
+  static arrow::Result<std::shared_ptr<RpmpPartitionSink>> Make(
+      const std::string& address, const std::string& port, const std::string& app,
+      int64_t shuffle_id, int32_t num_connections = 1);
+
+  RpmpPartitionSink(std::shared_ptr<PmPoolClient> client, std::string prefix);
+
+  ~RpmpPartitionSink() override;
+
+  arrow::Status Push(int32_t pid, std::shared_ptr<arrow::Buffer> stream) override;
+
+  arrow::Status Finish() override;
+
+ private:
+  std::shared_ptr<PmPoolClient> client_;
+  const std::string prefix_;
+
+  std::mutex mutex_;
+  std::condition_variable done_cv_;
+  int64_t inflight_ = 0;
+  bool failed_ = false;
+};
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
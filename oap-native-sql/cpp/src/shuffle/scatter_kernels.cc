@@ -0,0 +1,294 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shuffle/scatter_kernels.h"
+
+#include <arrow/util/bit_util.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+namespace {
+
+template <typename T>
+void ScatterValuesScalar(const uint8_t* src, int64_t src_length, const int32_t* row_ids,
+                         int64_t num_rows, uint8_t* dst) {
+  auto src_values = reinterpret_cast<const T*>(src);
+  auto dst_values = reinterpret_cast<T*>(dst);
+  for (int64_t j = 0; j < num_rows; ++j) {
+    dst_values[j] = src_values[row_ids[j]];
+  }
+}
+
+void ScatterBitsScalar(const uint8_t* src, int64_t src_length, const int32_t* row_ids,
+                       int64_t num_rows, uint8_t* dst, int64_t dst_offset) {
+  for (int64_t j = 0; j < num_rows; ++j) {
+    arrow::BitUtil::SetBitTo(dst, dst_offset + j,
+                             arrow::BitUtil::GetBit(src, row_ids[j]));
+  }
+}
+
+// Store 8 bits to dst starting from an arbitrary bit offset, other bits are kept
+inline void StoreBits8(uint8_t* dst, int64_t dst_offset, uint8_t bits) {
+  auto byte = dst + (dst_offset >> 3);
+  auto shift = dst_offset & 7;
+  if (shift == 0) {
+    byte[0] = bits;
+  } else {
+    uint8_t low_mask = (1 << shift) - 1;
+    byte[0] = (byte[0] & low_mask) | static_cast<uint8_t>(bits << shift);
+    byte[1] = (byte[1] & ~low_mask) | static_cast<uint8_t>(bits >> (8 - shift));
+  }
+}
+
+const ScatterKernels kScalarKernels = {
+    SimdLevel::NONE,
+    {ScatterValuesScalar<uint8_t>, ScatterValuesScalar<uint16_t>,
+     ScatterValuesScalar<uint32_t>, ScatterValuesScalar<uint64_t>},
+    ScatterBitsScalar};
+
+#if defined(__x86_64__)
+
+// There is no byte or word gather, so 1-byte and 2-byte values are gathered as 32-bit
+// words and narrowed. A word read may cross the end of src by up to 3 bytes, such
+// blocks fall back to scalar code. As row_ids are ascending, the last row id of a block
+// bounds the whole block.
+
+__attribute__((target("avx2"))) void ScatterValues1Avx2(const uint8_t* src,
+                                                        int64_t src_length,
+                                                        const int32_t* row_ids,
+                                                        int64_t num_rows, uint8_t* dst) {
+  const auto shuffle = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                        -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1, -1, -1,
+                                        -1, -1, -1, -1, -1, -1);
+  const auto permute = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+  int64_t j = 0;
+  for (; j + 8 <= num_rows && row_ids[j + 7] + 4 <= src_length; j += 8) {
+    auto idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_ids + j));
+    auto words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(src), idx, 1);
+    auto packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(words, shuffle), permute);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + j), _mm256_castsi256_si128(packed));
+  }
+  ScatterValuesScalar<uint8_t>(src, src_length, row_ids + j, num_rows - j, dst + j);
+}
+
+__attribute__((target("avx2"))) void ScatterValues2Avx2(const uint8_t* src,
+                                                        int64_t src_length,
+                                                        const int32_t* row_ids,
+                                                        int64_t num_rows, uint8_t* dst) {
+  const auto shuffle = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1,
+                                        -1, -1, 0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1,
+                                        -1, -1, -1, -1);
+  const auto permute = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+  int64_t j = 0;
+  for (; j + 8 <= num_rows && row_ids[j + 7] + 2 <= src_length; j += 8) {
+    auto idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_ids + j));
+    auto words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(src), idx, 2);
+    auto packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(words, shuffle), permute);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j * 2),
+                     _mm256_castsi256_si128(packed));
+  }
+  ScatterValuesScalar<uint16_t>(src, src_length, row_ids + j, num_rows - j, dst + j * 2);
+}
+
+__attribute__((target("avx2"))) void ScatterValues4Avx2(const uint8_t* src,
+                                                        int64_t src_length,
+                                                        const int32_t* row_ids,
+                                                        int64_t num_rows, uint8_t* dst) {
+  int64_t j = 0;
+  for (; j + 8 <= num_rows; j += 8) {
+    auto idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_ids + j));
+    auto values = _mm256_i32gather_epi32(reinterpret_cast<const int*>(src), idx, 4);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + j * 4), values);
+  }
+  ScatterValuesScalar<uint32_t>(src, src_length, row_ids + j, num_rows - j, dst + j * 4);
+}
+
+__attribute__((target("avx2"))) void ScatterValues8Avx2(const uint8_t* src,
+                                                        int64_t src_length,
+                                                        const int32_t* row_ids,
+                                                        int64_t num_rows, uint8_t* dst) {
+  int64_t j = 0;
+  for (; j + 4 <= num_rows; j += 4) {
+    auto idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_ids + j));
+    auto values =
+        _mm256_i32gather_epi64(reinterpret_cast<const long long*>(src), idx, 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + j * 8), values);
+  }
+  ScatterValuesScalar<uint64_t>(src, src_length, row_ids + j, num_rows - j, dst + j * 8);
+}
+
+// Gather the 32-bit word holding each source bit, shift the bit to the lowest position
+// and collect the lowest bits of all lanes in one mask.
+__attribute__((target("avx2"))) void ScatterBitsAvx2(const uint8_t* src,
+                                                     int64_t src_length,
+                                                     const int32_t* row_ids,
+                                                     int64_t num_rows, uint8_t* dst,
+                                                     int64_t dst_offset) {
+  auto src_bytes = arrow::BitUtil::BytesForBits(src_length);
+  const auto seven = _mm256_set1_epi32(7);
+  int64_t j = 0;
+  for (; j + 8 <= num_rows && (row_ids[j + 7] >> 3) + 4 <= src_bytes; j += 8) {
+    auto idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_ids + j));
+    auto words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(src),
+                                        _mm256_srli_epi32(idx, 3), 1);
+    auto bits = _mm256_srlv_epi32(words, _mm256_and_si256(idx, seven));
+    auto mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(bits, 31)));
+    StoreBits8(dst, dst_offset + j, static_cast<uint8_t>(mask));
+  }
+  ScatterBitsScalar(src, src_length, row_ids + j, num_rows - j, dst, dst_offset + j);
+}
+
+__attribute__((target("avx512f"))) void ScatterValues1Avx512(const uint8_t* src,
+                                                             int64_t src_length,
+                                                             const int32_t* row_ids,
+                                                             int64_t num_rows,
+                                                             uint8_t* dst) {
+  int64_t j = 0;
+  for (; j + 16 <= num_rows && row_ids[j + 15] + 4 <= src_length; j += 16) {
+    auto idx = _mm512_loadu_si512(row_ids + j);
+    auto words = _mm512_i32gather_epi32(idx, src, 1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j), _mm512_cvtepi32_epi8(words));
+  }
+  ScatterValuesScalar<uint8_t>(src, src_length, row_ids + j, num_rows - j, dst + j);
+}
+
+__attribute__((target("avx512f"))) void ScatterValues2Avx512(const uint8_t* src,
+                                                             int64_t src_length,
+                                                             const int32_t* row_ids,
+                                                             int64_t num_rows,
+                                                             uint8_t* dst) {
+  int64_t j = 0;
+  for (; j + 16 <= num_rows && row_ids[j + 15] + 2 <= src_length; j += 16) {
+    auto idx = _mm512_loadu_si512(row_ids + j);
+    auto words = _mm512_i32gather_epi32(idx, src, 2);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + j * 2),
+                        _mm512_cvtepi32_epi16(words));
+  }
+  ScatterValuesScalar<uint16_t>(src, src_length, row_ids + j, num_rows - j, dst + j * 2);
+}
+
+__attribute__((target("avx512f"))) void ScatterValues4Avx512(const uint8_t* src,
+                                                             int64_t src_length,
+                                                             const int32_t* row_ids,
+                                                             int64_t num_rows,
+                                                             uint8_t* dst) {
+  int64_t j = 0;
+  for (; j + 16 <= num_rows; j += 16) {
+    auto idx = _mm512_loadu_si512(row_ids + j);
+    _mm512_storeu_si512(dst + j * 4, _mm512_i32gather_epi32(idx, src, 4));
+  }
+  ScatterValuesScalar<uint32_t>(src, src_length, row_ids + j, num_rows - j, dst + j * 4);
+}
+
+__attribute__((target("avx512f"))) void ScatterValues8Avx512(const uint8_t* src,
+                                                             int64_t src_length,
+                                                             const int32_t* row_ids,
+                                                             int64_t num_rows,
+                                                             uint8_t* dst) {
+  int64_t j = 0;
+  for (; j + 8 <= num_rows; j += 8) {
+    auto idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_ids + j));
+    _mm512_storeu_si512(dst + j * 8, _mm512_i32gather_epi64(idx, src, 8));
+  }
+  ScatterValuesScalar<uint64_t>(src, src_length, row_ids + j, num_rows - j, dst + j * 8);
+}
+
+__attribute__((target("avx512f"))) void ScatterBitsAvx512(const uint8_t* src,
+                                                          int64_t src_length,
+                                                          const int32_t* row_ids,
+                                                          int64_t num_rows, uint8_t* dst,
+                                                          int64_t dst_offset) {
+  auto src_bytes = arrow::BitUtil::BytesForBits(src_length);
+  const auto seven = _mm512_set1_epi32(7);
+  const auto one = _mm512_set1_epi32(1);
+  int64_t j = 0;
+  for (; j + 16 <= num_rows && (row_ids[j + 15] >> 3) + 4 <= src_bytes; j += 16) {
+    auto idx = _mm512_loadu_si512(row_ids + j);
+    auto words = _mm512_i32gather_epi32(_mm512_srli_epi32(idx, 3), src, 1);
+    auto bits = _mm512_srlv_epi32(words, _mm512_and_si512(idx, seven));
+    auto mask = _mm512_test_epi32_mask(bits, one);
+    StoreBits8(dst, dst_offset + j, static_cast<uint8_t>(mask));
+    StoreBits8(dst, dst_offset + j + 8, static_cast<uint8_t>(mask >> 8));
+  }
+  ScatterBitsScalar(src, src_length, row_ids + j, num_rows - j, dst, dst_offset + j);
+}
+
+const ScatterKernels kAvx2Kernels = {
+    SimdLevel::AVX2,
+    {ScatterValues1Avx2, ScatterValues2Avx2, ScatterValues4Avx2, ScatterValues8Avx2},
+    ScatterBitsAvx2};
+
+const ScatterKernels kAvx512Kernels = {
+    SimdLevel::AVX512,
+    {ScatterValues1Avx512, ScatterValues2Avx512, ScatterValues4Avx512,
+     ScatterValues8Avx512},
+    ScatterBitsAvx512};
+
+#endif
+
+SimdLevel DetectSimdLevel() {
+  if (IsSimdLevelSupported(SimdLevel::AVX512)) {
+    return SimdLevel::AVX512;
+  }
+  if (IsSimdLevelSupported(SimdLevel::AVX2)) {
+    return SimdLevel::AVX2;
+  }
+  return SimdLevel::NONE;
+}
+
+}  // namespace
+
+bool IsSimdLevelSupported(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::NONE:
+      return true;
+#if defined(__x86_64__)
+    case SimdLevel::AVX2:
+      return __builtin_cpu_supports("avx2");
+    case SimdLevel::AVX512:
+      return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+      return false;
+  }
+}
+
+const ScatterKernels& GetScatterKernels(SimdLevel level) {
+  switch (level) {
+#if defined(__x86_64__)
+    case SimdLevel::AVX2:
+      return kAvx2Kernels;
+    case SimdLevel::AVX512:
+      return kAvx512Kernels;
+#endif
+    default:
+      return kScalarKernels;
+  }
+}
+
+const ScatterKernels& GetScatterKernels() {
+  static const ScatterKernels& kernels = GetScatterKernels(DetectSimdLevel());
+  return kernels;
+}
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
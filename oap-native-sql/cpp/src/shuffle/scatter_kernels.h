@@ -0,0 +1,57 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// \brief Instruction set used by the columnar split kernels
+enum class SimdLevel { NONE, AVX2, AVX512 };
+
+/// Copy the fixed-width values of src at row_ids into consecutive slots of dst.
+/// src_length is the number of values in src, row_ids must be ascending.
+using ScatterValuesFunc = void (*)(const uint8_t* src, int64_t src_length,
+                                   const int32_t* row_ids, int64_t num_rows,
+                                   uint8_t* dst);
+
+/// Copy the bits of src bitmap at row_ids into dst bitmap starting from dst_offset.
+/// src_length is the number of bits in src, row_ids must be ascending.
+using ScatterBitsFunc = void (*)(const uint8_t* src, int64_t src_length,
+                                 const int32_t* row_ids, int64_t num_rows, uint8_t* dst,
+                                 int64_t dst_offset);
+
+struct ScatterKernels {
+  SimdLevel level;
+  /// indexed by Type::SHUFFLE_1BYTE to Type::SHUFFLE_8BYTE
+  ScatterValuesFunc scatter_values[4];
+  ScatterBitsFunc scatter_bits;
+};
+
+/// Check if both current CPU and OS support the instruction set
+bool IsSimdLevelSupported(SimdLevel level);
+
+/// Get the kernels implemented with the instruction set, which must be supported
+const ScatterKernels& GetScatterKernels(SimdLevel level);
+
+/// Get the kernels of the widest instruction set supported, detected at first call
+const ScatterKernels& GetScatterKernels();
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -20,13 +20,21 @@
 #include <arrow/filesystem/filesystem.h>
 #include <arrow/filesystem/localfs.h>
 #include <arrow/filesystem/path_util.h>
+#include <arrow/io/file.h>
 #include <arrow/type.h>
+#include <arrow/util/checked_cast.h>
 #include <arrow/util/io_util.h>
+#include "shuffle/buffer_pool.h"
 #include "shuffle/partition_writer.h"
+#include "shuffle/writer_pool.h"
+#include "utils/macros.h"
 
 #include <algorithm>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <chrono>
+#include <functional>
+#include <numeric>
 #include <utility>
 
 namespace sparkcolumnarplugin {
@@ -39,11 +47,39 @@ std::string GenerateUUID() {
 
 class Splitter::Impl {
  public:
-  explicit Impl(const std::shared_ptr<arrow::Schema>& schema) : schema_(schema) {}
+  Impl(const std::shared_ptr<arrow::Schema>& schema, int32_t num_partitions,
+       PartitioningOptions options)
+      : schema_(schema), num_partitions_(num_partitions), options_(std::move(options)) {}
 
   arrow::Status Init() {
-    // remove partition id field since we don't need it while splitting
-    ARROW_ASSIGN_OR_RAISE(writer_schema_, schema_->RemoveField(0))
+    if (options_.partitioning == Partitioning::PARTITION_ID_COLUMN) {
+      // remove partition id field since we don't need it while splitting
+      ARROW_ASSIGN_OR_RAISE(writer_schema_, schema_->RemoveField(0))
+    } else {
+      writer_schema_ = schema_;
+    }
+    switch (options_.partitioning) {
+      case Partitioning::HASH:
+      case Partitioning::RANGE:
+        ARROW_ASSIGN_OR_RAISE(partitioner_,
+                              Partitioner::Make(schema_, num_partitions_, options_))
+        break;
+      case Partitioning::ROUND_ROBIN:
+        if (num_partitions_ <= 0) {
+          return arrow::Status::Invalid(
+              "Number of partitions should be positive for round robin partitioning");
+        }
+        next_round_robin_pid_ = options_.start_partition % num_partitions_;
+        break;
+      case Partitioning::SINGLE:
+        if (num_partitions_ > 1) {
+          return arrow::Status::Invalid("Single partitioning with ", num_partitions_,
+                                        " partitions");
+        }
+        break;
+      default:
+        break;
+    }
 
     const auto& fields = writer_schema_->fields();
     std::vector<Type::typeId> result;
@@ -52,6 +88,14 @@ class Splitter::Impl {
     std::transform(std::cbegin(fields), std::cend(fields), std::back_inserter(result),
                    [](const std::shared_ptr<arrow::Field>& field) -> Type::typeId {
                      auto arrow_type_id = field->type()->id();
+                     // dictionary encoded columns are split as their indices
+                     if (arrow_type_id == arrow::DictionaryType::type_id) {
+                       arrow_type_id =
+                           arrow::internal::checked_cast<const arrow::DictionaryType&>(
+                               *field->type())
+                               .index_type()
+                               ->id();
+                     }
                      switch (arrow_type_id) {
                        case arrow::BooleanType::type_id:
                          return Type::SHUFFLE_BIT;
@@ -97,6 +141,25 @@ class Splitter::Impl {
     }
     column_type_id_ = std::move(result);
 
+    dictionaries_.resize(fields.size());
+    for (size_t i = 0; i < fields.size(); ++i) {
+      if (fields[i]->type()->id() == arrow::DictionaryType::type_id) {
+        dictionary_columns_.push_back(static_cast<int32_t>(i));
+      }
+    }
+
+    if (num_partitions_ < 0) {
+      return arrow::Status::Invalid("Number of partitions should not be negative");
+    }
+    pid_to_new_id_.assign(num_partitions_, -1);
+
+    // index of each column among the columns sharing its type id, which is also the
+    // index of its buffer or builder in PartitionWriter
+    std::vector<int32_t> type_count(Type::NUM_TYPES, 0);
+    for (auto type_id : column_type_id_) {
+      column_type_idx_.push_back(type_count[type_id]++);
+    }
+
     decltype(column_type_id_) remove_null_id(column_type_id_.size());
     std::copy_if(std::cbegin(column_type_id_), std::cend(column_type_id_),
                  std::begin(remove_null_id),
@@ -115,6 +178,60 @@ class Splitter::Impl {
   }
 
   arrow::Status Split(const arrow::RecordBatch& record_batch) {
+    RETURN_NOT_OK(CheckDictionaries(record_batch));
+    TIME_NANO_OR_RAISE(split_time_, DispatchSplit(record_batch));
+    return arrow::Status::OK();
+  }
+
+  arrow::Status DispatchSplit(const arrow::RecordBatch& record_batch) {
+    switch (options_.partitioning) {
+      case Partitioning::ROUND_ROBIN:
+        return SplitRoundRobin(record_batch);
+      case Partitioning::SINGLE:
+        return SplitSingle(record_batch);
+      case Partitioning::PARTITION_ID_COLUMN:
+        return DoSplit(record_batch);
+      default:
+        break;
+    }
+    // compute the partition ids and prepend them, so the split below sees the same
+    // layout as in PARTITION_ID_COLUMN mode
+    auto num_rows = record_batch.num_rows();
+    ARROW_ASSIGN_OR_RAISE(auto pid_buffer,
+                          arrow::AllocateBuffer(num_rows * sizeof(int32_t)))
+    RETURN_NOT_OK(partitioner_->Compute(
+        record_batch, reinterpret_cast<int32_t*>(pid_buffer->mutable_data())));
+    auto pid_arr = std::make_shared<arrow::Int32Array>(num_rows, std::move(pid_buffer));
+    ARROW_ASSIGN_OR_RAISE(
+        auto batch_with_pid,
+        record_batch.AddColumn(0, arrow::field("pid", arrow::int32()), pid_arr))
+    return DoSplit(*batch_with_pid);
+  }
+
+  // The IPC stream writes the dictionaries before its first batch only, so all the
+  // batches of a dictionary encoded column must share the dictionary of the first one
+  arrow::Status CheckDictionaries(const arrow::RecordBatch& record_batch) {
+    // skip the partition id column if any
+    auto offset = record_batch.num_columns() - writer_schema_->num_fields();
+    for (auto i : dictionary_columns_) {
+      auto column = record_batch.column(i + offset);
+      const auto& dictionary =
+          arrow::internal::checked_cast<const arrow::DictionaryArray&>(*column)
+              .dictionary();
+      if (dictionaries_[i] == nullptr) {
+        dictionaries_[i] = dictionary;
+      } else if (dictionary != dictionaries_[i] &&
+                 !dictionary->Equals(*dictionaries_[i])) {
+        return arrow::Status::Invalid("Dictionary of column ",
+                                      writer_schema_->field(i)->name(),
+                                      " differs from the one of the first batch");
+      }
+    }
+    return arrow::Status::OK();
+  }
+
+  // record_batch starts with the partition id column
+  arrow::Status DoSplit(const arrow::RecordBatch& record_batch) {
     const auto& pid_arr = record_batch.column_data(0);
     if (pid_arr->GetNullCount() != 0) {
       return arrow::Status::Invalid("Column partition id should not contain NULL value");
@@ -125,6 +242,228 @@ class Splitter::Impl {
                                     record_batch.column(0)->type()->name());
     }
 
+    auto num_rows = record_batch.num_rows();
+
+    // map discrete partition id (pid) to continuous integer (new_id)
+    // create a new writer every time a new_id occurs
+    new_id_.clear();
+    new_id_.reserve(num_rows);
+    auto pid_cast_p = reinterpret_cast<const int32_t*>(pid_arr->buffers[1]->data());
+    for (int64_t i = 0; i < num_rows; ++i) {
+      auto pid = pid_cast_p[i];
+      if (static_cast<uint32_t>(pid) >= pid_to_new_id_.size()) {
+        RETURN_NOT_OK(GrowPartitionIdTable(pid));
+      }
+      auto new_id = pid_to_new_id_[pid];
+      if (new_id == -1 || writer_released_[new_id]) {
+        ARROW_ASSIGN_OR_RAISE(new_id, PrepareWriter(pid));
+      }
+      new_id_.push_back(new_id);
+    }
+
+    switch (split_mode_) {
+      case SplitMode::ROW_WISE:
+        RETURN_NOT_OK(SplitRowWise(record_batch));
+        break;
+      case SplitMode::COLUMNAR:
+        RETURN_NOT_OK(SplitColumnar(record_batch));
+        break;
+    }
+    return CheckMemoryLimit();
+  }
+
+  // Round robin partitioning: the batch is cut into contiguous slices of about equal
+  // size, one per partition starting from the one after the last slice of the previous
+  // batch. No partition id is computed or mapped per row.
+  arrow::Status SplitRoundRobin(const arrow::RecordBatch& record_batch) {
+    auto num_rows = record_batch.num_rows();
+    auto num_slices = std::min<int64_t>(num_partitions_, num_rows);
+    if (num_slices == 0) {
+      return arrow::Status::OK();
+    }
+
+    slice_new_id_.resize(num_slices);
+    for (int64_t k = 0; k < num_slices; ++k) {
+      auto pid = static_cast<int32_t>((next_round_robin_pid_ + k) % num_partitions_);
+      auto new_id = pid_to_new_id_[pid];
+      if (new_id == -1 || writer_released_[new_id]) {
+        ARROW_ASSIGN_OR_RAISE(new_id, PrepareWriter(pid));
+      }
+      slice_new_id_[k] = new_id;
+    }
+    next_round_robin_pid_ = (next_round_robin_pid_ + num_slices) % num_partitions_;
+
+    // each writer takes at most one slice, so the grouped row indices are the slices
+    // laid out in new_id order
+    partition_row_offset_.assign(num_writers_ + 1, 0);
+    for (int64_t k = 0; k < num_slices; ++k) {
+      partition_row_offset_[slice_new_id_[k] + 1] =
+          (k + 1) * num_rows / num_slices - k * num_rows / num_slices;
+    }
+    std::partial_sum(partition_row_offset_.begin(), partition_row_offset_.end(),
+                     partition_row_offset_.begin());
+    row_ids_.resize(num_rows);
+    for (int64_t k = 0; k < num_slices; ++k) {
+      auto new_id = slice_new_id_[k];
+      std::iota(row_ids_.begin() + partition_row_offset_[new_id],
+                row_ids_.begin() + partition_row_offset_[new_id + 1],
+                static_cast<int32_t>(k * num_rows / num_slices));
+    }
+
+    RETURN_NOT_OK(ScatterRows(record_batch, 0));
+    return CheckMemoryLimit();
+  }
+
+  // Single partitioning: the batch goes to the only partition as is, with no copy
+  arrow::Status SplitSingle(const arrow::RecordBatch& record_batch) {
+    if (record_batch.num_rows() == 0) {
+      return arrow::Status::OK();
+    }
+    if (num_writers_ == 0) {
+      if (pid_to_new_id_.empty()) {
+        RETURN_NOT_OK(GrowPartitionIdTable(0));
+      }
+      RETURN_NOT_OK(PrepareWriter(0).status());
+    }
+    return pid_writer_[0]->AppendRecordBatch(record_batch);
+  }
+
+  // Create the writer of pid or reallocate its buffers if it was evicted, return its
+  // new_id
+  arrow::Result<int32_t> PrepareWriter(int32_t pid) {
+    auto new_id = pid_to_new_id_[pid];
+    if (new_id == -1) {
+      RETURN_NOT_OK(CreatePartitionWriter(pid));
+      new_id = pid_to_new_id_[pid] = num_writers_++;
+      writer_released_.push_back(false);
+    } else if (writer_released_[new_id]) {
+      RETURN_NOT_OK(pid_writer_[new_id]->ReallocateBuffers());
+      writer_released_[new_id] = false;
+    }
+    return new_id;
+  }
+
+  arrow::Status CheckMemoryLimit() {
+    if (memory_limit_ > 0) {
+      auto buffered_bytes = BufferedBytes();
+      if (buffered_bytes > memory_limit_) {
+        RETURN_NOT_OK(Spill(buffered_bytes - memory_limit_).status());
+      }
+    }
+    return arrow::Status::OK();
+  }
+
+  int64_t BufferedBytes() const {
+    int64_t bytes = buffer_pool_.bytes();
+    for (const auto& writer : pid_writer_) {
+      bytes += writer->BufferedBytes();
+    }
+    return bytes;
+  }
+
+  // Free the recycled buffers, then evict the writers holding the most memory first
+  // until at least size bytes are released or nothing is left
+  arrow::Result<int64_t> Spill(int64_t size) {
+    // the recycled buffers hold no rows
+    auto released = buffer_pool_.Clear();
+    if (released >= size) {
+      return released;
+    }
+    std::vector<std::pair<int64_t, int32_t>> writer_bytes;
+    for (int32_t p = 0; p < num_writers_; ++p) {
+      auto bytes = pid_writer_[p]->BufferedBytes();
+      if (bytes > 0) {
+        writer_bytes.emplace_back(bytes, p);
+      }
+    }
+    std::sort(writer_bytes.begin(), writer_bytes.end(),
+              std::greater<std::pair<int64_t, int32_t>>());
+
+    for (const auto& item : writer_bytes) {
+      if (released >= size) {
+        break;
+      }
+      const auto& writer = pid_writer_[item.second];
+      RETURN_NOT_OK(writer->Evict());
+      writer_released_[item.second] = true;
+      released += item.first - writer->BufferedBytes();
+    }
+    return released;
+  }
+
+  // Only called for a pid out of the table, which is an error if the number of
+  // partitions was given to Make
+  arrow::Status GrowPartitionIdTable(int32_t pid) {
+    if (pid < 0 || num_partitions_ > 0) {
+      return arrow::Status::Invalid("Partition id ", pid, " out of range [0, ",
+                                    num_partitions_, ")");
+    }
+    pid_to_new_id_.resize(std::max<size_t>(pid + 1, pid_to_new_id_.size() * 2), -1);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status CreatePartitionWriter(int32_t pid) {
+    if (num_writer_threads_ > 0 && writer_pool_ == nullptr) {
+      ARROW_ASSIGN_OR_RAISE(writer_pool_,
+                            WriterPool::Make(num_writer_threads_, max_inflight_bytes_));
+    }
+
+    if (output_mode_ == OutputMode::CONSOLIDATED) {
+      if (spill_file_ == nullptr) {
+        RETURN_NOT_OK(OpenSpillFile());
+      }
+      ARROW_ASSIGN_OR_RAISE(
+          auto writer,
+          PartitionWriter::Create(pid, buffer_size_, last_type_, column_type_id_,
+                                  writer_schema_, data_file_, compression_codec_,
+                                  spill_file_, nullptr, &buffer_pool_));
+      writer->set_writer_pool(writer_pool_.get());
+      writer->set_dictionaries(&dictionaries_);
+      writer->set_compression_threshold(compression_threshold_);
+      pid_writer_.push_back(std::move(writer));
+      return arrow::Status::OK();
+    }
+
+    if (output_mode_ == OutputMode::PUSHED) {
+      if (partition_sink_ == nullptr) {
+        return arrow::Status::Invalid("Pushed output mode needs a partition sink");
+      }
+      ARROW_ASSIGN_OR_RAISE(
+          auto writer,
+          PartitionWriter::Create(pid, buffer_size_, last_type_, column_type_id_,
+                                  writer_schema_, "", compression_codec_, nullptr,
+                                  partition_sink_, &buffer_pool_));
+      writer->set_writer_pool(writer_pool_.get());
+      writer->set_dictionaries(&dictionaries_);
+      writer->set_compression_threshold(compression_threshold_);
+      pid_writer_.push_back(std::move(writer));
+      return arrow::Status::OK();
+    }
+
+    auto temp_dir = GenerateUUID();
+    const auto& fs = local_dirs_fs_[num_writers_ % local_dirs_fs_.size()];
+    while ((*fs->GetFileInfo(temp_dir)).type() != arrow::fs::FileType::NotFound) {
+      temp_dir = GenerateUUID();
+    }
+    RETURN_NOT_OK(fs->CreateDir(temp_dir));
+    auto temp_file_path = arrow::fs::internal::ConcatAbstractPath(
+                              fs->base_path(), (*fs->GetFileInfo(temp_dir)).path()) +
+                          "/data";
+    temp_files.push_back({pid, temp_file_path});
+
+    ARROW_ASSIGN_OR_RAISE(
+        auto writer,
+        PartitionWriter::Create(pid, buffer_size_, last_type_, column_type_id_,
+                                writer_schema_, temp_file_path, compression_codec_,
+                                nullptr, nullptr, &buffer_pool_));
+    writer->set_writer_pool(writer_pool_.get());
+    writer->set_dictionaries(&dictionaries_);
+    writer->set_compression_threshold(compression_threshold_);
+    pid_writer_.push_back(std::move(writer));
+    return arrow::Status::OK();
+  }
+
+  arrow::Status SplitRowWise(const arrow::RecordBatch& record_batch) {
     auto num_rows = record_batch.num_rows();
     auto num_cols = record_batch.num_columns();
     auto src_addr = std::vector<SrcBuffers>(Type::NUM_TYPES);
@@ -177,58 +516,27 @@ class Splitter::Impl {
       }
     }
 
-    // map discrete partition id (pid) to continuous integer (new_id)
-    // create a new writer every time a new_id occurs
-    std::vector<int> new_id;
-    new_id.reserve(num_rows);
-    auto pid_cast_p = reinterpret_cast<const int32_t*>(pid_arr->buffers[1]->data());
-    for (int64_t i = 0; i < num_rows; ++i) {
-      auto pid = pid_cast_p[i];
-      if (pid_to_new_id_.find(pid) == pid_to_new_id_.end()) {
-        auto temp_dir = GenerateUUID();
-        const auto& fs = local_dirs_fs_[num_partitiions_ % local_dirs_fs_.size()];
-        while ((*fs->GetFileInfo(temp_dir)).type() != arrow::fs::FileType::NotFound) {
-          temp_dir = GenerateUUID();
-        }
-        RETURN_NOT_OK(fs->CreateDir(temp_dir));
-        auto temp_file_path = arrow::fs::internal::ConcatAbstractPath(
-                                  fs->base_path(), (*fs->GetFileInfo(temp_dir)).path()) +
-                              "/data";
-        temp_files.push_back({pid, temp_file_path});
-
-        ARROW_ASSIGN_OR_RAISE(
-            auto writer,
-            PartitionWriter::Create(pid, buffer_size_, last_type_, column_type_id_,
-                                    writer_schema_, temp_file_path, compression_codec_));
-        pid_writer_.push_back(std::move(writer));
-        new_id.push_back(num_partitiions_);
-        pid_to_new_id_[pid] = num_partitiions_++;
-      } else {
-        new_id.push_back(pid_to_new_id_[pid]);
-      }
-    }
-
     auto read_offset = 0;
 
-#define WRITE_FIXEDWIDTH(TYPE_ID, T)                                                    \
-  if (!src_addr[TYPE_ID].empty()) {                                                     \
-    for (i = read_offset; i < num_rows; ++i) {                                          \
-      ARROW_ASSIGN_OR_RAISE(                                                            \
-          auto result, pid_writer_[new_id[i]]->Write<T>(TYPE_ID, src_addr[TYPE_ID], i)) \
-      if (!result) {                                                                    \
-        break;                                                                          \
-      }                                                                                 \
-    }                                                                                   \
+#define WRITE_FIXEDWIDTH(TYPE_ID, T)                                                     \
+  if (!src_addr[TYPE_ID].empty()) {                                                      \
+    for (i = read_offset; i < num_rows; ++i) {                                           \
+      ARROW_ASSIGN_OR_RAISE(                                                             \
+          auto result, pid_writer_[new_id_[i]]->Write<T>(TYPE_ID, src_addr[TYPE_ID], i)) \
+      if (!result) {                                                                     \
+        break;                                                                           \
+      }                                                                                  \
+    }                                                                                    \
   }
 
-#define WRITE_BINARY(func, T, src_arr)                                             \
-  if (!src_arr.empty()) {                                                          \
-    for (i = read_offset; i < num_rows; ++i) {                                     \
-      ARROW_ASSIGN_OR_RAISE(auto result, pid_writer_[new_id[i]]->func(src_arr, i)) \
-      if (!result) {                                                               \
-        break;                                                                     \
-      }                                                                            \
-    }                                                                              \
+#define WRITE_BINARY(func, T, src_arr)                                              \
+  if (!src_arr.empty()) {                                                           \
+    for (i = read_offset; i < num_rows; ++i) {                                      \
+      ARROW_ASSIGN_OR_RAISE(auto result, pid_writer_[new_id_[i]]->func(src_arr, i)) \
+      if (!result) {                                                                \
+        break;                                                                      \
+      }                                                                             \
+    }                                                                               \
   }
 
     while (read_offset < num_rows) {
@@ -246,20 +554,218 @@ class Splitter::Impl {
       read_offset = i;
     }
 #undef WRITE_FIXEDWIDTH
+#undef WRITE_BINARY
+
+    return arrow::Status::OK();
+  }
+
+  arrow::Status SplitColumnar(const arrow::RecordBatch& record_batch) {
+    auto num_rows = record_batch.num_rows();
+
+    // first pass: count the rows of each partition, then group row indices by
+    // partition while keeping the original row order inside each partition
+    partition_row_offset_.assign(num_writers_ + 1, 0);
+    for (int64_t i = 0; i < num_rows; ++i) {
+      ++partition_row_offset_[new_id_[i] + 1];
+    }
+    std::partial_sum(partition_row_offset_.begin(), partition_row_offset_.end(),
+                     partition_row_offset_.begin());
+    partition_cursor_.assign(partition_row_offset_.begin(),
+                             partition_row_offset_.end() - 1);
+    row_ids_.resize(num_rows);
+    for (int64_t i = 0; i < num_rows; ++i) {
+      row_ids_[partition_cursor_[new_id_[i]]++] = i;
+    }
+
+    // second pass: scatter column by column, skipping the partition id column
+    return ScatterRows(record_batch, 1);
+  }
+
+  // Scatter the rows grouped in row_ids_ by partition_row_offset_ to their writers.
+  // first_column is the index of the first column to write in record_batch.
+  arrow::Status ScatterRows(const arrow::RecordBatch& record_batch, int first_column) {
+    auto num_cols = record_batch.num_columns();
+    partition_cursor_.assign(partition_row_offset_.begin(),
+                             partition_row_offset_.end() - 1);
+
+    // In one round each partition takes at most the rows fitting in its buffers, full
+    // writers spill before the next round.
+    partition_round_rows_.assign(num_writers_, 0);
+    bool rows_left = true;
+    while (rows_left) {
+      for (int32_t p = 0; p < num_writers_; ++p) {
+        auto num_left = partition_row_offset_[p + 1] - partition_cursor_[p];
+        if (num_left == 0) {
+          partition_round_rows_[p] = 0;
+          continue;
+        }
+        if (pid_writer_[p]->remaining_capacity() == 0) {
+          RETURN_NOT_OK(pid_writer_[p]->Spill());
+        }
+        partition_round_rows_[p] =
+            std::min<int64_t>(num_left, pid_writer_[p]->remaining_capacity());
+      }
+
+      for (auto i = 0; i < num_cols - first_column; ++i) {
+        RETURN_NOT_OK(ScatterColumn(i, record_batch.column(i + first_column)));
+      }
+
+      rows_left = false;
+      for (int32_t p = 0; p < num_writers_; ++p) {
+        if (partition_round_rows_[p] == 0) {
+          continue;
+        }
+        pid_writer_[p]->AdvanceWriteOffset(partition_round_rows_[p]);
+        partition_cursor_[p] += partition_round_rows_[p];
+        rows_left |= partition_cursor_[p] < partition_row_offset_[p + 1];
+      }
+    }
+
+    return arrow::Status::OK();
+  }
+
+  // Scatter the rows of column, the i-th column of the writers, selected in current
+  // round to their partition writers
+  arrow::Status ScatterColumn(int i, const std::shared_ptr<arrow::Array>& column) {
+    const auto& column_data = column->data();
+    auto num_rows = column->length();
+    auto type_idx = column_type_idx_[i];
+
+    BufferAddr src = {nullptr, nullptr};
+    if (column_data->buffers.size() > 1) {
+      src.validity_addr = column_data->GetNullCount() == 0
+                              ? nullptr
+                              : const_cast<uint8_t*>(column_data->buffers[0]->data());
+      src.value_addr = const_cast<uint8_t*>(column_data->buffers[1]->data());
+    }
+
+#define SCATTER_FIXEDWIDTH(TYPE_ID)                                         \
+  case TYPE_ID:                                                             \
+    for (int32_t p = 0; p < num_writers_; ++p) {                            \
+      if (partition_round_rows_[p] > 0) {                                   \
+        pid_writer_[p]->WriteColumn(TYPE_ID, type_idx, src, num_rows,       \
+                                    row_ids_.data() + partition_cursor_[p], \
+                                    partition_round_rows_[p]);              \
+      }                                                                     \
+    }                                                                       \
+    break;
+
+#define SCATTER_BINARY(TYPE_ID, func, ArrayType)                                    \
+  case TYPE_ID: {                                                                   \
+    auto src_arr = std::static_pointer_cast<ArrayType>(column);                     \
+    for (int32_t p = 0; p < num_writers_; ++p) {                                    \
+      if (partition_round_rows_[p] > 0) {                                           \
+        RETURN_NOT_OK(pid_writer_[p]->func(type_idx, *src_arr,                      \
+                                           row_ids_.data() + partition_cursor_[p],  \
+                                           partition_round_rows_[p]));              \
+      }                                                                             \
+    }                                                                               \
+  } break;
+
+    switch (column_type_id_[i]) {
+      SCATTER_FIXEDWIDTH(Type::SHUFFLE_1BYTE)
+      SCATTER_FIXEDWIDTH(Type::SHUFFLE_2BYTE)
+      SCATTER_FIXEDWIDTH(Type::SHUFFLE_4BYTE)
+      SCATTER_FIXEDWIDTH(Type::SHUFFLE_8BYTE)
+      SCATTER_FIXEDWIDTH(Type::SHUFFLE_BIT)
+      SCATTER_BINARY(Type::SHUFFLE_BINARY, WriteBinaryColumn, arrow::BinaryArray)
+      SCATTER_BINARY(Type::SHUFFLE_LARGE_BINARY, WriteLargeBinaryColumn,
+                     arrow::LargeBinaryArray)
+      default:
+        break;
+    }
+#undef SCATTER_FIXEDWIDTH
+#undef SCATTER_BINARY
 
     return arrow::Status::OK();
   }
 
   arrow::Status Stop() {
+    if (writer_pool_ != nullptr) {
+      RETURN_NOT_OK(writer_pool_->Wait());
+    }
     // write final record batch
     for (const auto& writer : pid_writer_) {
       RETURN_NOT_OK(writer->Stop());
     }
+    if (output_mode_ == OutputMode::CONSOLIDATED) {
+      TIME_NANO_OR_RAISE(data_file_write_time_, WriteDataFile());
+      return arrow::Status::OK();
+    }
+    if (output_mode_ == OutputMode::PUSHED) {
+      return FinishPartitionSink();
+    }
     std::sort(std::begin(temp_files), std::end(temp_files));
     return arrow::Status::OK();
   }
 
+  // Pushed output mode. Record the bytes pushed for each partition, then wait for the
+  // sink to make them durable
+  arrow::Status FinishPartitionSink() {
+    if (partition_sink_ == nullptr) {
+      return arrow::Status::OK();
+    }
+    partition_lengths_.assign(pid_to_new_id_.size(), 0);
+    for (size_t pid = 0; pid < pid_to_new_id_.size(); ++pid) {
+      if (pid_to_new_id_[pid] != -1) {
+        partition_lengths_[pid] = pid_writer_[pid_to_new_id_[pid]]->file_footer();
+      }
+    }
+    TIME_NANO_OR_RAISE(data_file_write_time_, partition_sink_->Finish());
+    // the sink is finished once even if Stop is called again
+    partition_sink_.reset();
+    return arrow::Status::OK();
+  }
+
+  arrow::Status OpenSpillFile() {
+    if (data_file_.empty()) {
+      data_file_ = arrow::fs::internal::ConcatAbstractPath(local_dirs_fs_[0]->base_path(),
+                                                           GenerateUUID() + ".data");
+    }
+    spill_file_path_ = data_file_ + ".spill";
+    ARROW_ASSIGN_OR_RAISE(spill_file_,
+                          arrow::io::FileOutputStream::Open(spill_file_path_, false));
+    return arrow::Status::OK();
+  }
+
+  // Consolidated output mode. Copy the partitions to the data file in partition id
+  // order and record their lengths, then remove the spill file
+  arrow::Status WriteDataFile() {
+    if (data_file_written_) {
+      return arrow::Status::OK();
+    }
+    if (spill_file_ == nullptr) {
+      RETURN_NOT_OK(OpenSpillFile());
+    }
+    RETURN_NOT_OK(spill_file_->Close());
+    ARROW_ASSIGN_OR_RAISE(auto spilled, arrow::io::ReadableFile::Open(spill_file_path_));
+    ARROW_ASSIGN_OR_RAISE(auto data_file,
+                          arrow::io::FileOutputStream::Open(data_file_, false));
+
+    partition_lengths_.assign(pid_to_new_id_.size(), 0);
+    for (size_t pid = 0; pid < pid_to_new_id_.size(); ++pid) {
+      if (pid_to_new_id_[pid] == -1) {
+        continue;
+      }
+      ARROW_ASSIGN_OR_RAISE(partition_lengths_[pid],
+                            pid_writer_[pid_to_new_id_[pid]]->CopyTo(spilled.get(),
+                                                                     data_file.get()));
+      temp_files.push_back({static_cast<int32_t>(pid), data_file_});
+    }
+    RETURN_NOT_OK(data_file->Close());
+    RETURN_NOT_OK(spilled->Close());
+    data_file_written_ = true;
+
+    ARROW_ASSIGN_OR_RAISE(
+        auto spill_file_name,
+        arrow::internal::PlatformFilename::FromString(spill_file_path_));
+    return arrow::internal::DeleteFile(spill_file_name).status();
+  }
+
   arrow::Result<int64_t> TotalBytesWritten() {
+    if (writer_pool_ != nullptr) {
+      RETURN_NOT_OK(writer_pool_->Wait());
+    }
     int64_t res = 0;
     for (const auto& writer : pid_writer_) {
       ARROW_ASSIGN_OR_RAISE(auto bytes, writer->BytesWritten());
@@ -268,6 +774,56 @@ class Splitter::Impl {
     return res;
   }
 
+  int64_t TotalSplitTime() const { return split_time_; }
+
+  int64_t TotalCompressTime() const {
+    int64_t time = 0;
+    for (const auto& writer : pid_writer_) {
+      time += writer->compress_time();
+    }
+    return time;
+  }
+
+  int64_t TotalWriteTime() const {
+    int64_t time = data_file_write_time_;
+    for (const auto& writer : pid_writer_) {
+      time += writer->write_time();
+    }
+    return time;
+  }
+
+  int64_t TotalSpills() const {
+    int64_t spills = 0;
+    for (const auto& writer : pid_writer_) {
+      spills += writer->num_spills();
+    }
+    return spills;
+  }
+
+  arrow::Result<std::vector<int64_t>> PartitionBytesWritten() {
+    if (writer_pool_ != nullptr) {
+      RETURN_NOT_OK(writer_pool_->Wait());
+    }
+    std::vector<int64_t> bytes(pid_to_new_id_.size(), 0);
+    for (size_t pid = 0; pid < pid_to_new_id_.size(); ++pid) {
+      if (pid_to_new_id_[pid] != -1) {
+        const auto& writer = pid_writer_[pid_to_new_id_[pid]];
+        ARROW_ASSIGN_OR_RAISE(bytes[pid], writer->BytesWritten());
+      }
+    }
+    return bytes;
+  }
+
+  std::vector<int64_t> PartitionRowsWritten() const {
+    std::vector<int64_t> rows(pid_to_new_id_.size(), 0);
+    for (size_t pid = 0; pid < pid_to_new_id_.size(); ++pid) {
+      if (pid_to_new_id_[pid] != -1) {
+        rows[pid] = pid_writer_[pid_to_new_id_[pid]]->rows_written();
+      }
+    }
+    return rows;
+  }
+
   static arrow::Result<std::string> CreateAttemptSubDir(const std::string& root_dir) {
     auto attempt_sub_dir = arrow::fs::internal::ConcatAbstractPath(root_dir, "columnar-shuffle-" + GenerateUUID());
     ARROW_ASSIGN_OR_RAISE(auto created, arrow::internal::CreateDirTree(
@@ -315,10 +871,34 @@ class Splitter::Impl {
     compression_codec_ = compression_codec;
   }
 
+  void set_compression_threshold(double threshold) {
+    compression_threshold_ = threshold;
+  }
+
+  void set_split_mode(SplitMode split_mode) { split_mode_ = split_mode; }
+
+  void set_output_mode(OutputMode output_mode) { output_mode_ = output_mode; }
+
+  void set_data_file(std::string data_file) { data_file_ = std::move(data_file); }
+
+  void set_partition_sink(std::shared_ptr<PartitionSink> sink) {
+    partition_sink_ = std::move(sink);
+  }
+
+  void set_memory_limit(int64_t memory_limit) { memory_limit_ = memory_limit; }
+
+  void set_writer_threads(int32_t num_threads, int64_t max_inflight_bytes) {
+    num_writer_threads_ = num_threads;
+    max_inflight_bytes_ = max_inflight_bytes;
+  }
+
+  const std::vector<int64_t>& partition_lengths() const { return partition_lengths_; }
+
   std::shared_ptr<arrow::Schema> schema() const { return schema_; }
 
   std::shared_ptr<PartitionWriter> writer(int32_t pid) {
-    if (pid_to_new_id_.find(pid) == pid_to_new_id_.end()) {
+    if (static_cast<uint32_t>(pid) >= pid_to_new_id_.size() ||
+        pid_to_new_id_[pid] == -1) {
       return nullptr;
     }
     return pid_writer_[pid_to_new_id_[pid]];
@@ -329,30 +909,91 @@ class Splitter::Impl {
  private:
   std::shared_ptr<arrow::Schema> schema_;
 
-  // writer_schema_ removes the first field of schema_ which indicates the partition id
+  // writer_schema_ removes the first field of schema_ which indicates the partition id,
+  // or is schema_ if the partition ids are computed by partitioner_
   std::shared_ptr<arrow::Schema> writer_schema_;
 
-  int32_t num_partitiions_ = 0;
+  // number of partitions given to Make, 0 if unknown
+  const int32_t num_partitions_;
+  const PartitioningOptions options_;
+  // HASH and RANGE modes only
+  std::shared_ptr<Partitioner> partitioner_;
+  // ROUND_ROBIN mode: partition of the first slice of next batch and the new_id of each
+  // slice of current batch
+  int64_t next_round_robin_pid_ = 0;
+  std::vector<int32_t> slice_new_id_;
+  int32_t num_writers_ = 0;
   Type::typeId last_type_;
   std::vector<Type::typeId> column_type_id_;
-  std::unordered_map<int32_t, int32_t> pid_to_new_id_;
+  std::vector<int32_t> column_type_idx_;
+  // indices of the dictionary encoded columns and the dictionary of each column, set
+  // from the first batch
+  std::vector<int32_t> dictionary_columns_;
+  std::vector<std::shared_ptr<arrow::Array>> dictionaries_;
+  // dense table indexed by pid, -1 if no writer was created for the pid yet. If the
+  // number of partitions is unknown, it grows on demand up to the largest pid seen.
+  std::vector<int32_t> pid_to_new_id_;
   std::vector<std::shared_ptr<PartitionWriter>> pid_writer_;
+  // indexed by new_id, true if the writer was evicted and has no buffer allocated
+  std::vector<bool> writer_released_;
+
+  // new_id of each row in current record batch
+  std::vector<int32_t> new_id_;
+
+  // columnar split mode: row indices grouped by new_id, the start offset of each
+  // new_id in row_ids_, the next row to write and the rows to write in current round
+  std::vector<int32_t> row_ids_;
+  std::vector<int64_t> partition_row_offset_;
+  std::vector<int64_t> partition_cursor_;
+  std::vector<int64_t> partition_round_rows_;
 
   int64_t buffer_size_ = kDefaultSplitterBufferSize;
   arrow::Compression::type compression_codec_ = arrow::Compression::UNCOMPRESSED;
+  double compression_threshold_ = 0;
+  SplitMode split_mode_ = SplitMode::COLUMNAR;
+  OutputMode output_mode_ = OutputMode::FILE_PER_PARTITION;
+  // bytes the writers may buffer before the largest are evicted, 0 if unlimited
+  int64_t memory_limit_ = 0;
+  // spills are written synchronously if no writer thread
+  int32_t num_writer_threads_ = 0;
+  int64_t max_inflight_bytes_ = kDefaultMaxInflightBytes;
+
+  // consolidated output mode
+  std::string data_file_;
+  std::string spill_file_path_;
+  std::shared_ptr<arrow::io::FileOutputStream> spill_file_;
+  std::vector<int64_t> partition_lengths_;
+  bool data_file_written_ = false;
+
+  // pushed output mode, null once finished
+  std::shared_ptr<PartitionSink> partition_sink_;
+
+  // nanoseconds spent in Split and copying the partitions to the data file, or waiting
+  // for the partition sink to finish
+  int64_t split_time_ = 0;
+  int64_t data_file_write_time_ = 0;
 
   std::vector<std::unique_ptr<arrow::fs::SubTreeFileSystem>> local_dirs_fs_;
+
+  // fixed-width buffers of the record batches written by the writer threads, taken by
+  // any writer allocating buffers. Outlives the threads, which return buffers to it.
+  BufferPool buffer_pool_;
+
+  // declared last to stop the threads before any writer they may be writing is gone
+  std::shared_ptr<WriterPool> writer_pool_;
 };
 
 arrow::Result<std::shared_ptr<Splitter>> Splitter::Make(
-    const std::shared_ptr<arrow::Schema>& schema) {
-  std::shared_ptr<Splitter> ptr(new Splitter(schema));
+    const std::shared_ptr<arrow::Schema>& schema, int32_t num_partitions,
+    PartitioningOptions options) {
+  std::shared_ptr<Splitter> ptr(new Splitter(schema, num_partitions, std::move(options)));
   RETURN_NOT_OK(ptr->impl_->Init());
   return ptr;
 }
 
-Splitter::Splitter(const std::shared_ptr<arrow::Schema>& schema) {
-  impl_.reset(new Impl(schema));
+Splitter::Splitter(const std::shared_ptr<arrow::Schema>& schema, int32_t num_partitions,
+                   PartitioningOptions options) {
+  impl_.reset(new Impl(schema, num_partitions, std::move(options)));
 }
 
 std::shared_ptr<arrow::Schema> Splitter::schema() const { return impl_->schema(); }
@@ -380,10 +1021,62 @@ void Splitter::set_compression_codec(arrow::Compression::type compression_codec)
   impl_->set_compression_codec(compression_codec);
 }
 
+void Splitter::set_compression_threshold(double threshold) {
+  impl_->set_compression_threshold(threshold);
+}
+
+void Splitter::set_split_mode(SplitMode split_mode) {
+  impl_->set_split_mode(split_mode);
+}
+
+void Splitter::set_output_mode(OutputMode output_mode) {
+  impl_->set_output_mode(output_mode);
+}
+
+void Splitter::set_data_file(std::string data_file) {
+  impl_->set_data_file(std::move(data_file));
+}
+
+void Splitter::set_partition_sink(std::shared_ptr<PartitionSink> sink) {
+  impl_->set_partition_sink(std::move(sink));
+}
+
+const std::vector<int64_t>& Splitter::GetPartitionLengths() const {
+  return impl_->partition_lengths();
+}
+
+void Splitter::set_memory_limit(int64_t memory_limit) {
+  impl_->set_memory_limit(memory_limit);
+}
+
+void Splitter::set_writer_threads(int32_t num_threads, int64_t max_inflight_bytes) {
+  impl_->set_writer_threads(num_threads, max_inflight_bytes);
+}
+
+int64_t Splitter::BufferedBytes() const { return impl_->BufferedBytes(); }
+
+arrow::Result<int64_t> Splitter::Spill(int64_t size) { return impl_->Spill(size); }
+
 arrow::Result<int64_t> Splitter::TotalBytesWritten() {
   return impl_->TotalBytesWritten();
 }
 
+int64_t Splitter::TotalSplitTime() const { return impl_->TotalSplitTime(); }
+
+int64_t Splitter::TotalCompressTime() const { return impl_->TotalCompressTime(); }
+
+int64_t Splitter::TotalWriteTime() const { return impl_->TotalWriteTime(); }
+
+int64_t Splitter::TotalSpills() const { return impl_->TotalSpills(); }
+
+arrow::Result<std::vector<int64_t>> Splitter::PartitionBytesWritten() {
+  return impl_->PartitionBytesWritten();
+}
+
+std::vector<int64_t> Splitter::PartitionRowsWritten() const {
+  return impl_->PartitionRowsWritten();
+}
+
 Splitter::~Splitter() = default;
 
 }  // namespace shuffle
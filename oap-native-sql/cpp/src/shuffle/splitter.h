@@ -22,10 +22,11 @@
 #include <arrow/type.h>
 #include <arrow/util/compression.h>
 #include <iostream>
-#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "shuffle/partition_sink.h"
 #include "shuffle/partition_writer.h"
+#include "shuffle/partitioner.h"
 #include "shuffle/type.h"
 
 namespace sparkcolumnarplugin {
@@ -35,8 +36,16 @@ class Splitter {
  public:
   ~Splitter();
 
+  /// Create a splitter for record batches whose first column is the partition id, or
+  /// whose partition ids are computed from key columns if options asks for HASH or
+  /// RANGE partitioning. ROUND_ROBIN and SINGLE partitioning need no partition id.
+  /// \param schema schema of the input record batches
+  /// \param num_partitions number of output partitions, partition ids must be in
+  /// [0, num_partitions). If 0, the number is unknown and any non-negative id is valid.
+  /// Must be positive for HASH and ROUND_ROBIN partitioning, at most 1 for SINGLE.
   static arrow::Result<std::shared_ptr<Splitter>> Make(
-      const std::shared_ptr<arrow::Schema>& schema);
+      const std::shared_ptr<arrow::Schema>& schema, int32_t num_partitions = 0,
+      PartitioningOptions options = PartitioningOptions());
 
   std::shared_ptr<arrow::Schema> schema() const;
 
@@ -46,8 +55,59 @@ class Splitter {
 
   void set_compression_codec(arrow::Compression::type compression_codec);
 
+  /// Write a partition stream uncompressed if compressing a sample of its first batch
+  /// saves less than threshold of the bytes, see
+  /// PartitionWriter::set_compression_threshold. 0, the default, always compresses.
+  /// Must be called before the first Split.
+  void set_compression_threshold(double threshold);
+
+  /// Choose how rows are copied into partition writers, COLUMNAR by default. Must be
+  /// called before the first Split. ROUND_ROBIN and SINGLE partitioning always use
+  /// their own fast paths.
+  void set_split_mode(SplitMode split_mode);
+
+  /// Choose how partitions are written, FILE_PER_PARTITION by default. In CONSOLIDATED
+  /// mode, all partitions are written to one data file in partition id order on Stop.
+  /// In PUSHED mode, the partitions are pushed to the partition sink as they spill.
+  /// Must be called before the first Split.
+  void set_output_mode(OutputMode output_mode);
+
+  /// PUSHED mode only. Where the partitions are pushed, finished by Stop. Must be
+  /// called before the first Split.
+  void set_partition_sink(std::shared_ptr<PartitionSink> sink);
+
+  /// CONSOLIDATED mode only. Path of the data file, a file under the first configured
+  /// local dir is used if not set. Must be called before the first Split.
+  void set_data_file(std::string data_file);
+
+  /// Limit the memory buffered by all partition writers. Once a Split leaves more than
+  /// memory_limit bytes buffered, the largest writers are evicted until it fits. 0,
+  /// the default, means unlimited.
+  void set_memory_limit(int64_t memory_limit);
+
+  /// Compress and write spilled record batches on num_threads background threads while
+  /// splitting continues. Split blocks once the batches queued or being written hold
+  /// more than max_inflight_bytes. 0 thread, the default, writes synchronously. Must be
+  /// called before the first Split.
+  void set_writer_threads(int32_t num_threads,
+                          int64_t max_inflight_bytes = kDefaultMaxInflightBytes);
+
+  /// Dictionary encoded columns are split as their indices and written with the
+  /// dictionary of the first batch, which all batches must share.
   arrow::Status Split(const arrow::RecordBatch&);
 
+  /// Bytes of memory currently buffered by all partition writers and recycled for them,
+  /// not including the record batches handed to the writer threads
+  int64_t BufferedBytes() const;
+
+  /// Free the buffers recycled for the partition writers, then evict the writers holding
+  /// the most memory first, writing out their buffered rows and releasing their
+  /// buffers, until at least size bytes are released.
+  /// Called by the memory manager on memory pressure.
+  /// 
+eturn bytes of memory released
+  arrow::Result<int64_t> Spill(int64_t size);
+
   /***
    * Stop all writers created by this splitter. If the data buffer managed by the writer
    * is not empty, write to output stream as RecordBatch. Then sort the temporary files by
@@ -56,15 +116,45 @@ class Splitter {
    */
   arrow::Status Stop();
 
+  /// In FILE_PER_PARTITION mode, the temporary file of each partition. In CONSOLIDATED
+  /// mode, the data file for each non-empty partition, available after Stop. Empty in
+  /// PUSHED mode.
   const std::vector<std::pair<int32_t, std::string>>& GetPartitionFileInfo() const;
 
+  /// CONSOLIDATED mode, bytes of each partition in the data file indexed by partition
+  /// id, available after Stop. Suitable for
+  /// IndexShuffleBlockResolver.writeIndexFileAndCommit. PUSHED mode, bytes pushed for
+  /// each partition.
+  const std::vector<int64_t>& GetPartitionLengths() const;
+
   arrow::Result<int64_t> TotalBytesWritten();
 
+  /// Nanoseconds spent in Split, including the spills written synchronously
+  int64_t TotalSplitTime() const;
+
+  /// Nanoseconds spent serializing and compressing record batches, summed over the
+  /// writer threads if any. Complete after Stop.
+  int64_t TotalCompressTime() const;
+
+  /// Nanoseconds spent writing to disk, summed over the writer threads if any. Complete
+  /// after Stop.
+  int64_t TotalWriteTime() const;
+
+  /// Number of partition writer spills
+  int64_t TotalSpills() const;
+
+  /// Bytes written for each partition indexed by partition id
+  arrow::Result<std::vector<int64_t>> PartitionBytesWritten();
+
+  /// Rows written for each partition indexed by partition id. Complete after Stop.
+  std::vector<int64_t> PartitionRowsWritten() const;
+
   // writer must be called after Split.
   std::shared_ptr<PartitionWriter> writer(int32_t pid);
 
  private:
-  explicit Splitter(const std::shared_ptr<arrow::Schema>& schema);
+  Splitter(const std::shared_ptr<arrow::Schema>& schema, int32_t num_partitions,
+           PartitioningOptions options);
   class Impl;
   std::unique_ptr<Impl> impl_;
 };
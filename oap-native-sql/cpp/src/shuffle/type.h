@@ -26,6 +26,7 @@ namespace sparkcolumnarplugin {
 namespace shuffle {
 
 static constexpr int64_t kDefaultSplitterBufferSize = 4096;
+static constexpr int64_t kDefaultMaxInflightBytes = 64 << 20;
 
 struct BufferMessage {
   std::shared_ptr<arrow::Buffer> validity_buffer;
@@ -103,6 +104,41 @@ static const typeId all[] = {
 
 }  // namespace Type
 
+/// \brief Strategy used by Splitter to copy rows into the partition writers
+enum class SplitMode {
+  /// walk every row once per type class and dispatch it to its PartitionWriter
+  ROW_WISE,
+  /// compute a per-partition row histogram first, then scatter column by column
+  COLUMNAR
+};
+
+/// \brief Layout of the files written by Splitter
+enum class OutputMode {
+  /// one temporary file per partition, concatenated by the JVM side
+  FILE_PER_PARTITION,
+  /// one data file holding all partitions in partition id order
+  CONSOLIDATED,
+  /// nothing written locally, each spill of a partition is pushed to the partition
+  /// sink as a complete IPC stream
+  PUSHED
+};
+
+/// \brief How Splitter assigns the rows of its input to partitions
+enum class Partitioning {
+  /// the first column of the input holds the partition id of each row
+  PARTITION_ID_COLUMN,
+  /// pmod(Murmur3 hash of the key columns, number of partitions), as Spark
+  /// HashPartitioning does
+  HASH,
+  /// index of the first range bound not less than the key columns, as Spark
+  /// RangePartitioner does in ascending order with nulls first
+  RANGE,
+  /// contiguous slices of each input batch go to consecutive partitions
+  ROUND_ROBIN,
+  /// the input batches are written to partition 0 as they are
+  SINGLE
+};
+
 using BufferMessages = std::deque<std::unique_ptr<BufferMessage>>;
 using TypeBufferMessages = std::vector<BufferMessages>;
 using BinaryBuilders = std::deque<std::unique_ptr<arrow::BinaryBuilder>>;
@@ -0,0 +1,108 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shuffle/writer_pool.h"
+
+#include <utility>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+arrow::Result<std::shared_ptr<WriterPool>> WriterPool::Make(int32_t num_threads,
+                                                            int64_t max_inflight_bytes) {
+  if (num_threads <= 0) {
+    return arrow::Status::Invalid("Number of writer threads should be positive, got ",
+                                  num_threads);
+  }
+  return std::make_shared<WriterPool>(num_threads, max_inflight_bytes);
+}
+
+WriterPool::WriterPool(int32_t num_threads, int64_t max_inflight_bytes)
+    : max_inflight_bytes_(max_inflight_bytes), queues_(num_threads) {
+  for (int32_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(&WriterPool::WorkerLoop, this, i);
+  }
+}
+
+WriterPool::~WriterPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+arrow::Status WriterPool::Submit(int32_t key, int64_t bytes, Task task) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // always admit a task if nothing is in flight, however large it is
+  done_cv_.wait(lock, [this, bytes] {
+    return !status_.ok() || max_inflight_bytes_ <= 0 || num_inflight_ == 0 ||
+           inflight_bytes_ + bytes <= max_inflight_bytes_;
+  });
+  RETURN_NOT_OK(status_);
+
+  queues_[key % queues_.size()].push_back({bytes, std::move(task)});
+  inflight_bytes_ += bytes;
+  ++num_inflight_;
+  lock.unlock();
+  work_cv_.notify_all();
+  return arrow::Status::OK();
+}
+
+arrow::Status WriterPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return num_inflight_ == 0; });
+  return status_;
+}
+
+int64_t WriterPool::inflight_bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return inflight_bytes_;
+}
+
+void WriterPool::WorkerLoop(int32_t thread_id) {
+  auto& queue = queues_[thread_id];
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this, &queue] { return shutdown_ || !queue.empty(); });
+    if (queue.empty()) {
+      // shutdown with nothing left to write
+      return;
+    }
+    auto item = std::move(queue.front());
+    queue.pop_front();
+
+    // skip the tasks queued after a failure, the output is discarded anyway
+    auto failed = !status_.ok();
+    lock.unlock();
+    auto status = failed ? arrow::Status::OK() : item.task();
+    lock.lock();
+
+    if (!status.ok() && status_.ok()) {
+      status_ = std::move(status);
+    }
+    inflight_bytes_ -= item.bytes;
+    --num_inflight_;
+    done_cv_.notify_all();
+  }
+}
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
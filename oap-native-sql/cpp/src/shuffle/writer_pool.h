@@ -0,0 +1,90 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/result.h>
+#include <arrow/status.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+namespace shuffle {
+
+/// \brief Background threads compressing and writing the record batches spilled by
+/// partition writers
+///
+/// Each task is bound to the thread chosen by its key, so tasks of the same partition
+/// run in submission order while different partitions are written in parallel.
+class WriterPool {
+ public:
+  using Task = std::function<arrow::Status()>;
+
+  /// \param num_threads number of background threads, must be positive
+  /// \param max_inflight_bytes Submit blocks while the queued and running tasks hold
+  /// more bytes than this, 0 means unbounded
+  static arrow::Result<std::shared_ptr<WriterPool>> Make(int32_t num_threads,
+                                                         int64_t max_inflight_bytes);
+
+  WriterPool(int32_t num_threads, int64_t max_inflight_bytes);
+
+  /// Run the remaining tasks, then join the threads
+  ~WriterPool();
+
+  /// Queue a task holding bytes of memory until it finishes. Return the error of a
+  /// failed task if any, in which case the task is not queued.
+  arrow::Status Submit(int32_t key, int64_t bytes, Task task);
+
+  /// Wait for all queued tasks to finish, return the first error of the tasks
+  arrow::Status Wait();
+
+  /// Bytes held by queued and running tasks
+  int64_t inflight_bytes();
+
+  /// Serialize writes of tasks sharing one output stream
+  std::mutex& io_mutex() { return io_mutex_; }
+
+ private:
+  struct Item {
+    int64_t bytes;
+    Task task;
+  };
+
+  void WorkerLoop(int32_t thread_id);
+
+  const int64_t max_inflight_bytes_;
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::vector<std::deque<Item>> queues_;
+  std::vector<std::thread> threads_;
+  int64_t inflight_bytes_ = 0;
+  int64_t num_inflight_ = 0;
+  arrow::Status status_;
+  bool shutdown_ = false;
+
+  std::mutex io_mutex_;
+};
+
+}  // namespace shuffle
+}  // namespace sparkcolumnarplugin
@@ -81,6 +81,49 @@ TEST(TestArrowCompute, AggregatewithMultipleBatchTest) {
   ASSERT_NOT_OK(Equals(*expected_result.get(), *(result_batch[0]).get()));
 }
 
+TEST(TestArrowCompute, AggregateLanesWithNullsTest) {
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", int32());
+  auto f_sum = field("sum", int64());
+  auto f_count = field("count", int64());
+  auto f_min = field("min", int32());
+  auto f_max = field("max", int32());
+  auto f_res = field("res", uint32());
+  auto arg_0 = TreeExprBuilder::MakeField(f0);
+  auto n_sum = TreeExprBuilder::MakeFunction("sum", {arg_0}, uint64());
+  auto n_count = TreeExprBuilder::MakeFunction("count", {arg_0}, uint64());
+  auto n_min = TreeExprBuilder::MakeFunction("min", {arg_0}, uint64());
+  auto n_max = TreeExprBuilder::MakeFunction("max", {arg_0}, uint64());
+
+  std::vector<std::shared_ptr<::gandiva::Expression>> expr_vector = {
+      TreeExprBuilder::MakeExpression(n_sum, f_res),
+      TreeExprBuilder::MakeExpression(n_count, f_res),
+      TreeExprBuilder::MakeExpression(n_min, f_res),
+      TreeExprBuilder::MakeExpression(n_max, f_res)};
+  auto sch = arrow::schema({f0});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_sum, f_count, f_min, f_max};
+  ///////////////////// Calculation //////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, expr_vector, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> result_batch;
+  // more rows than lanes, with the extrema on nulls and in the tail
+  std::vector<std::string> input_data_string = {
+      "[3, null, -7, 12, 5, 0, 8, -2, 9, 1, 4, 6, -1, 2, 10, 11, 7, -9, null, 30]"};
+  MakeInputBatch(input_data_string, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &result_batch));
+  input_data_string = {"[null, null]"};
+  MakeInputBatch(input_data_string, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &result_batch));
+  ASSERT_NOT_OK(expr->finish(&result_batch));
+
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  std::vector<std::string> expected_result_string = {"[89]", "[18]", "[-9]", "[30]"};
+  auto res_sch = arrow::schema({f_sum, f_count, f_min, f_max});
+  MakeInputBatch(expected_result_string, res_sch, &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *(result_batch[0]).get()));
+}
+
 TEST(TestArrowCompute, GroupByAggregateWithMultipleBatchTest) {
   ////////////////////// prepare expr_vector ///////////////////////
   auto f0 = field("f0", uint32());
@@ -502,5 +545,169 @@ TEST(TestArrowCompute, GroupByAggregateWithMultipleBatchOutputWoKeyTest) {
   ASSERT_NOT_OK(Equals(*expected_result.get(), *(result_batch[0]).get()));
 }
 
+TEST(TestArrowCompute, GroupByApproxAggregateTest) {
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", uint32());
+  auto f1 = field("f1", int32());
+  auto f_unique = field("unique", uint32());
+  auto f_word_0 = field("word_0", int64());
+  auto f_word_1 = field("word_1", int64());
+  auto f_digest = field("digest", binary());
+  auto f_count = field("count", int64());
+  auto f_percentile = field("percentile", float64());
+  auto f_res = field("res", uint32());
+
+  auto arg_pre = TreeExprBuilder::MakeField(f0);
+  auto n_pre = TreeExprBuilder::MakeFunction("encodeArray", {arg_pre}, uint32());
+  auto arg0 = TreeExprBuilder::MakeField(f0);
+  auto arg1 = TreeExprBuilder::MakeField(f1);
+  auto n_split = TreeExprBuilder::MakeFunction("splitArrayListWithAction",
+                                               {n_pre, arg0, arg1, arg1}, uint32());
+  auto n_unique =
+      TreeExprBuilder::MakeFunction("action_unique", {n_split, arg0}, uint32());
+  auto n_distinct = TreeExprBuilder::MakeFunction("action_approxCountDistinct_4",
+                                                  {n_split, arg1}, uint32());
+  auto n_percentile = TreeExprBuilder::MakeFunction("action_approxPercentile_0.5_100",
+                                                    {n_split, arg1}, uint32());
+
+  std::vector<std::shared_ptr<::gandiva::Expression>> expr_vector = {
+      TreeExprBuilder::MakeExpression(n_unique, f_res),
+      TreeExprBuilder::MakeExpression(n_distinct, f_res),
+      TreeExprBuilder::MakeExpression(n_percentile, f_res)};
+  auto sch = arrow::schema({f0, f1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique, f_word_0, f_word_1,
+                                                   f_digest};
+
+  /////////////////////// Create Expression Evaluator ////////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, expr_vector, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  ////////////////////// calculation /////////////////////
+  std::vector<std::string> input_data = {"[1, 1, 2, 2, 3]", "[5, 5, 7, 8, 9]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  std::vector<std::string> input_data_2 = {"[1, 2, 3, 3]", "[6, 9, 9, null]"};
+  MakeInputBatch(input_data_2, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  ////////////////////// Finish //////////////////////////
+  std::vector<std::shared_ptr<arrow::RecordBatch>> partial_batch;
+  ASSERT_NOT_OK(expr->finish(&partial_batch));
+
+  // the registers are the aggregation buffer of Spark's HyperLogLogPlusPlus
+  std::shared_ptr<arrow::RecordBatch> expected_partial;
+  std::vector<std::string> expected_partial_string = {
+      "[1, 2, 3]", "[2, 281474976718848, 0]", "[1073741824, 262144, 262144]"};
+  MakeInputBatch(expected_partial_string,
+                 arrow::schema({f_unique, f_word_0, f_word_1}), &expected_partial);
+  for (int i = 0; i < expected_partial->num_columns(); i++) {
+    ASSERT_TRUE(expected_partial->column(i)->Equals(partial_batch[0]->column(i)));
+  }
+
+  ////////////////////// merge the partial states //////////////////////////
+  auto arg_word_0 = TreeExprBuilder::MakeField(f_word_0);
+  auto arg_word_1 = TreeExprBuilder::MakeField(f_word_1);
+  auto arg_digest = TreeExprBuilder::MakeField(f_digest);
+  auto n_final_split = TreeExprBuilder::MakeFunction(
+      "splitArrayListWithAction", {n_pre, arg0, arg_word_0, arg_word_1, arg_digest},
+      uint32());
+  auto n_final_unique =
+      TreeExprBuilder::MakeFunction("action_unique", {n_final_split, arg0}, uint32());
+  auto n_final_distinct = TreeExprBuilder::MakeFunction(
+      "action_approxCountDistinctFinal_4", {n_final_split, arg_word_0, arg_word_1},
+      uint32());
+  auto n_final_percentile = TreeExprBuilder::MakeFunction(
+      "action_approxPercentileFinal_0.5_100", {n_final_split, arg_digest}, uint32());
+
+  std::vector<std::shared_ptr<::gandiva::Expression>> final_expr_vector = {
+      TreeExprBuilder::MakeExpression(n_final_unique, f_res),
+      TreeExprBuilder::MakeExpression(n_final_distinct, f_res),
+      TreeExprBuilder::MakeExpression(n_final_percentile, f_res)};
+  auto final_sch = arrow::schema({f0, f_word_0, f_word_1, f_digest});
+  std::vector<std::shared_ptr<Field>> final_ret_types = {f_unique, f_count, f_percentile};
+
+  std::shared_ptr<CodeGenerator> final_expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(final_sch, final_expr_vector, final_ret_types,
+                                    &final_expr, true));
+  auto final_input = arrow::RecordBatch::Make(
+      final_sch, partial_batch[0]->num_rows(), partial_batch[0]->columns());
+  ASSERT_NOT_OK(final_expr->evaluate(final_input, &output_batch_list));
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> result_batch;
+  ASSERT_NOT_OK(final_expr->finish(&result_batch));
+
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  std::vector<std::string> expected_result_string = {"[1, 2, 3]", "[2, 3, 1]",
+                                                     "[5, 8, 9]"};
+  auto res_sch = arrow::schema({f_unique, f_count, f_percentile});
+  MakeInputBatch(expected_result_string, res_sch, &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *(result_batch[0]).get()));
+}
+
+TEST(TestArrowCompute, GroupByDecimalAggregateTest) {
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", uint32());
+  auto f1 = field("f1", decimal(5, 2));
+  auto f_unique = field("unique", uint32());
+  auto f_sum = field("sum", decimal(15, 2));
+  auto f_avg = field("avg", decimal(9, 6));
+  auto f_narrow_sum = field("narrow_sum", decimal(5, 2));
+  auto f_res = field("res", uint32());
+
+  auto arg_pre = TreeExprBuilder::MakeField(f0);
+  auto n_pre = TreeExprBuilder::MakeFunction("encodeArray", {arg_pre}, uint32());
+  auto arg0 = TreeExprBuilder::MakeField(f0);
+  auto arg1 = TreeExprBuilder::MakeField(f1);
+  auto n_split = TreeExprBuilder::MakeFunction("splitArrayListWithAction",
+                                               {n_pre, arg0, arg1, arg1, arg1}, uint32());
+  auto n_unique =
+      TreeExprBuilder::MakeFunction("action_unique", {n_split, arg0}, uint32());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {n_split, arg1}, uint32());
+  auto n_avg =
+      TreeExprBuilder::MakeFunction("action_avg", {n_split, arg1}, decimal(9, 6));
+  // a sum out of the precision of its result type is null
+  auto n_narrow_sum =
+      TreeExprBuilder::MakeFunction("action_sum", {n_split, arg1}, decimal(5, 2));
+
+  std::vector<std::shared_ptr<::gandiva::Expression>> expr_vector = {
+      TreeExprBuilder::MakeExpression(n_unique, f_res),
+      TreeExprBuilder::MakeExpression(n_sum, f_res),
+      TreeExprBuilder::MakeExpression(n_avg, f_res),
+      TreeExprBuilder::MakeExpression(n_narrow_sum, f_res)};
+  auto sch = arrow::schema({f0, f1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique, f_sum, f_avg, f_narrow_sum};
+
+  /////////////////////// Create Expression Evaluator ////////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, expr_vector, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  ////////////////////// calculation /////////////////////
+  std::vector<std::string> input_data = {
+      "[1, 1, 2, 2, 3]", R"(["600.00", "500.00", "1.25", "1.26", "-3.33"])"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  std::vector<std::string> input_data_2 = {"[2, 3]", R"([null, "1.00"])"};
+  MakeInputBatch(input_data_2, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  ////////////////////// Finish //////////////////////////
+  std::vector<std::shared_ptr<arrow::RecordBatch>> result_batch;
+  ASSERT_NOT_OK(expr->finish(&result_batch));
+
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  std::vector<std::string> expected_result_string = {
+      "[1, 2, 3]", R"(["1100.00", "2.51", "-2.33"])",
+      R"(["550.000000", "1.255000", "-1.165000"])", R"([null, "2.51", "-2.33"])"};
+  auto res_sch = arrow::schema({f_unique, f_sum, f_avg, f_narrow_sum});
+  MakeInputBatch(expected_result_string, res_sch, &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *(result_batch[0]).get()));
+}
+
 }  // namespace codegen
 }  // namespace sparkcolumnarplugin
@@ -18,7 +18,12 @@
 #include <arrow/array.h>
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+#include <map>
 #include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
 
 #include "codegen/code_generator.h"
 #include "codegen/code_generator_factory.h"
@@ -264,6 +269,247 @@ TEST(TestArrowCompute, GroupByHashAggregateWithProjectionTest) {
   }
 }
 
+TEST(TestArrowCompute, GroupByHashAggregateWithSharedProjectionTest) {
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f_0 = field("f0", int32());
+  auto f_1 = field("f1", int64());
+  auto f_unique = field("unique", int32());
+  auto f_sum = field("sum", int64());
+  auto f_max = field("max", int64());
+  auto f_min = field("min", int64());
+  auto f_half_sum = field("half_sum", int64());
+  auto f_half_max = field("half_max", int64());
+  auto f_res = field("dummy_res", uint32());
+
+  auto arg_0 = TreeExprBuilder::MakeField(f_0);
+  auto arg_1 = TreeExprBuilder::MakeField(f_1);
+  auto n_groupby = TreeExprBuilder::MakeFunction("action_groupby", {arg_0}, uint32());
+  // f1 * f1 is computed once for the three actions in the aggregation loop
+  auto n_square = TreeExprBuilder::MakeFunction("multiply", {arg_1, arg_1}, int64());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {n_square}, uint32());
+  auto n_max = TreeExprBuilder::MakeFunction("action_max", {n_square}, uint32());
+  auto n_min = TreeExprBuilder::MakeFunction(
+      "action_min",
+      {TreeExprBuilder::MakeFunction("subtract", {n_square, arg_1}, int64())},
+      uint32());
+  // a division isn't fused, it is projected once by gandiva for the two actions
+  auto n_half = TreeExprBuilder::MakeFunction(
+      "divide", {arg_1, TreeExprBuilder::MakeLiteral(static_cast<int64_t>(2))}, int64());
+  auto n_half_sum = TreeExprBuilder::MakeFunction("action_sum", {n_half}, uint32());
+  auto n_half_max = TreeExprBuilder::MakeFunction("action_max", {n_half}, uint32());
+  auto n_schema =
+      TreeExprBuilder::MakeFunction("codegen_schema", {arg_0, arg_1}, uint32());
+  auto n_aggr = TreeExprBuilder::MakeFunction(
+      "hashAggregateArrays", {n_groupby, n_sum, n_max, n_min, n_half_sum, n_half_max},
+      uint32());
+  auto n_codegen_aggr =
+      TreeExprBuilder::MakeFunction("codegen_withOneInput", {n_aggr, n_schema}, uint32());
+
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+
+  std::vector<std::shared_ptr<::gandiva::Expression>> expr_vector = {aggr_expr};
+
+  auto sch = arrow::schema({f_0, f_1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique,   f_sum,     f_max, f_min,
+                                                   f_half_sum, f_half_max};
+
+  /////////////////////// Create Expression Evaluator ////////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, expr_vector, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  ////////////////////// calculation /////////////////////
+  std::vector<std::string> input_data = {"[1, 2, 1, 2, 3]", "[1, 2, 3, null, 4]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  std::vector<std::string> input_data_2 = {"[3, 1, 2]", "[5, null, 6]"};
+  MakeInputBatch(input_data_2, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  ////////////////////// Finish //////////////////////////
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+  ASSERT_NOT_OK(expr->finish(&aggr_result_iterator));
+
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  std::vector<std::string> expected_result_string = {
+      "[1, 2, 3]", "[10, 40, 41]", "[9, 36, 25]", "[0, 2, 12]",
+      "[1, 4, 4]", "[1, 3, 2]"};
+  auto res_sch = arrow::schema(ret_types);
+  MakeInputBatch(expected_result_string, res_sch, &expected_result);
+  ASSERT_TRUE(aggr_result_iterator->HasNext());
+  ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+}
+
+TEST(TestArrowCompute, GroupByHashAggregateWithFilterTest) {
+  auto f_0 = field("f0", int32());
+  auto f_1 = field("f1", int64());
+  auto f_unique = field("unique", int32());
+  auto f_sum = field("sum", int64());
+  auto f_res = field("dummy_res", uint32());
+
+  auto arg_0 = TreeExprBuilder::MakeField(f_0);
+  auto arg_1 = TreeExprBuilder::MakeField(f_1);
+  auto literal_0 = TreeExprBuilder::MakeLiteral(static_cast<int64_t>(0));
+  auto literal_1 = TreeExprBuilder::MakeLiteral(static_cast<int64_t>(1));
+  auto literal_2 = TreeExprBuilder::MakeLiteral(static_cast<int64_t>(2));
+  // f1 > 1 and f0 != 3 is fused into the aggregation loop
+  auto n_greater = TreeExprBuilder::MakeFunction("greater_than", {arg_1, literal_1},
+                                                 arrow::boolean());
+  auto n_equal = TreeExprBuilder::MakeFunction(
+      "equal", {arg_0, TreeExprBuilder::MakeLiteral(3)}, arrow::boolean());
+  auto n_fused_condition = TreeExprBuilder::MakeAnd(
+      {n_greater, TreeExprBuilder::MakeFunction("not", {n_equal}, arrow::boolean())});
+  // f1 / 2 > 0 is filtered by gandiva first
+  auto n_condition = TreeExprBuilder::MakeFunction(
+      "greater_than",
+      {TreeExprBuilder::MakeFunction("divide", {arg_1, literal_2}, int64()), literal_0},
+      arrow::boolean());
+  std::vector<std::pair<std::shared_ptr<gandiva::Node>, std::vector<std::string>>>
+      conditions = {{n_fused_condition, {"[2, 1]", "[2, 3]"}},
+                    {n_condition, {"[2, 1, 3]", "[2, 3, 9]"}}};
+
+  auto sch = arrow::schema({f_0, f_1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique, f_sum};
+  for (const auto& condition : conditions) {
+    auto n_groupby = TreeExprBuilder::MakeFunction("action_groupby", {arg_0}, uint32());
+    auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {arg_1}, uint32());
+    auto n_filter =
+        TreeExprBuilder::MakeFunction("codegen_filter", {condition.first}, uint32());
+    auto n_schema =
+        TreeExprBuilder::MakeFunction("codegen_schema", {arg_0, arg_1}, uint32());
+    auto n_aggr = TreeExprBuilder::MakeFunction("hashAggregateArrays",
+                                                {n_groupby, n_sum, n_filter}, uint32());
+    auto n_codegen_aggr = TreeExprBuilder::MakeFunction("codegen_withOneInput",
+                                                        {n_aggr, n_schema}, uint32());
+    auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+    std::vector<std::shared_ptr<::gandiva::Expression>> expr_vector = {aggr_expr};
+
+    std::shared_ptr<CodeGenerator> expr;
+    ASSERT_NOT_OK(CreateCodeGenerator(sch, expr_vector, ret_types, &expr, true));
+    std::shared_ptr<arrow::RecordBatch> input_batch;
+    std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+    std::vector<std::string> input_data = {"[1, 2, 1, 2, 3, 3]",
+                                           "[1, 2, 3, null, 4, 5]"};
+    MakeInputBatch(input_data, sch, &input_batch);
+    ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+    ASSERT_NOT_OK(expr->finish(&aggr_result_iterator));
+    std::shared_ptr<arrow::RecordBatch> expected_result;
+    MakeInputBatch(condition.second, arrow::schema(ret_types), &expected_result);
+    ASSERT_TRUE(aggr_result_iterator->HasNext());
+    ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+    ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+  }
+}
+
+TEST(TestArrowCompute, GroupByHashAggregateWithStringFilterTest) {
+  auto f_0 = field("f0", int32());
+  auto f_1 = field("f1", int64());
+  auto f_2 = field("f2", utf8());
+  auto f_unique = field("unique", int32());
+  auto f_sum = field("sum", int64());
+  auto f_res = field("dummy_res", uint32());
+
+  auto arg_0 = TreeExprBuilder::MakeField(f_0);
+  auto arg_1 = TreeExprBuilder::MakeField(f_1);
+  auto arg_2 = TreeExprBuilder::MakeField(f_2);
+  // f2 like '%a_c%' or starts_with(f2, 'x') is fused and matched a batch at a time
+  auto n_like = TreeExprBuilder::MakeFunction(
+      "like", {arg_2, TreeExprBuilder::MakeStringLiteral("%a_c%")}, arrow::boolean());
+  auto n_starts_with = TreeExprBuilder::MakeFunction(
+      "starts_with", {arg_2, TreeExprBuilder::MakeStringLiteral("x")}, arrow::boolean());
+  auto n_condition = TreeExprBuilder::MakeOr({n_like, n_starts_with});
+  auto n_groupby = TreeExprBuilder::MakeFunction("action_groupby", {arg_0}, uint32());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {arg_1}, uint32());
+  auto n_filter =
+      TreeExprBuilder::MakeFunction("codegen_filter", {n_condition}, uint32());
+  auto n_schema =
+      TreeExprBuilder::MakeFunction("codegen_schema", {arg_0, arg_1, arg_2}, uint32());
+  auto n_aggr = TreeExprBuilder::MakeFunction("hashAggregateArrays",
+                                              {n_groupby, n_sum, n_filter}, uint32());
+  auto n_codegen_aggr =
+      TreeExprBuilder::MakeFunction("codegen_withOneInput", {n_aggr, n_schema}, uint32());
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+  std::vector<std::shared_ptr<::gandiva::Expression>> expr_vector = {aggr_expr};
+
+  auto sch = arrow::schema({f_0, f_1, f_2});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique, f_sum};
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, expr_vector, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+  std::vector<std::string> input_data = {
+      "[1, 2, 1, 2, 3, 3]", "[1, 2, 3, 4, 5, 6]",
+      R"(["abc", "xyz", "ac", null, "zzabcd", "yx"])"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+  ASSERT_NOT_OK(expr->finish(&aggr_result_iterator));
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  MakeInputBatch({"[1, 2, 3]", "[1, 2, 5]"}, arrow::schema(ret_types), &expected_result);
+  ASSERT_TRUE(aggr_result_iterator->HasNext());
+  ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+}
+
+TEST(TestArrowCompute, GroupByHashAggregateWithSelectionTest) {
+  auto f_0 = field("f0", int32());
+  auto f_1 = field("f1", int64());
+  auto f_unique = field("unique", int32());
+  auto f_sum = field("sum", int64());
+  auto f_res = field("dummy_res", uint32());
+
+  auto arg_0 = TreeExprBuilder::MakeField(f_0);
+  auto arg_1 = TreeExprBuilder::MakeField(f_1);
+  auto n_groupby = TreeExprBuilder::MakeFunction("action_groupby", {arg_0}, uint32());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {arg_1}, uint32());
+  auto n_schema =
+      TreeExprBuilder::MakeFunction("codegen_schema", {arg_0, arg_1}, uint32());
+  auto n_aggr =
+      TreeExprBuilder::MakeFunction("hashAggregateArrays", {n_groupby, n_sum}, uint32());
+  auto n_codegen_aggr =
+      TreeExprBuilder::MakeFunction("codegen_withOneInput", {n_aggr, n_schema}, uint32());
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+  std::vector<std::shared_ptr<::gandiva::Expression>> expr_vector = {aggr_expr};
+
+  auto sch = arrow::schema({f_0, f_1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique, f_sum};
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, expr_vector, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  // only the rows 1, 2 and 4 of the first batch are aggregated, as after a filter
+  std::vector<std::string> input_data = {"[1, 2, 1, 2, 3]", "[1, 2, 3, 4, 5]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  std::shared_ptr<arrow::Array> selection;
+  ASSERT_NOT_OK(
+      arrow::ipc::internal::json::ArrayFromJSON(uint16(), "[1, 2, 4]", &selection));
+  ASSERT_NOT_OK(expr->evaluate(selection, input_batch, &output_batch_list));
+
+  std::vector<std::string> input_data_2 = {"[1, 3]", "[10, 20]"};
+  MakeInputBatch(input_data_2, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+  ASSERT_NOT_OK(expr->finish(&aggr_result_iterator));
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  std::vector<std::string> expected_result_string = {"[2, 1, 3]", "[2, 13, 25]"};
+  MakeInputBatch(expected_result_string, arrow::schema(ret_types), &expected_result);
+  ASSERT_TRUE(aggr_result_iterator->HasNext());
+  ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+}
+
 TEST(TestArrowCompute, GroupByHashAggregateWithCaseWhenTest) {
   ////////////////////// prepare expr_vector ///////////////////////
   auto f_0 = field("f0", utf8());
@@ -498,5 +744,432 @@ TEST(TestArrowCompute, GroupByHashAggregateWithTwoStringTest) {
   }
 }
 
+TEST(TestArrowCompute, GroupByHashAggregateSpillTest) {
+  // spill from the first batch on
+  setenv("NATIVESQL_AGGREGATE_MEMORY_BUDGET", "1", 1);
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", int32());
+  auto f1 = field("f1", int32());
+  auto f_unique = field("unique", int32());
+  auto f_sum = field("sum", int64());
+  auto f_count = field("count", int64());
+  auto f_res = field("res", uint32());
+
+  auto arg0 = TreeExprBuilder::MakeField(f0);
+  auto arg1 = TreeExprBuilder::MakeField(f1);
+  auto n_groupby = TreeExprBuilder::MakeFunction("action_groupby", {arg0}, uint32());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {arg1}, uint32());
+  auto n_count = TreeExprBuilder::MakeFunction("action_count", {arg1}, uint32());
+  auto n_schema = TreeExprBuilder::MakeFunction("codegen_schema", {arg0, arg1}, uint32());
+  auto n_aggr = TreeExprBuilder::MakeFunction("hashAggregateArrays",
+                                              {n_groupby, n_sum, n_count}, uint32());
+  auto n_codegen_aggr =
+      TreeExprBuilder::MakeFunction("codegen_withOneInput", {n_aggr, n_schema}, uint32());
+
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+
+  auto sch = arrow::schema({f0, f1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique, f_sum, f_count};
+
+  /////////////////////// Create Expression Evaluator ////////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, {aggr_expr}, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  ////////////////////// calculation /////////////////////
+  std::vector<std::string> input_data = {"[1, 2, 3, 1, 2, 3, 4]",
+                                         "[1, 2, 3, 4, 5, 6, 7]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+  input_data = {"[4, 5, 1, 5]", "[10, 20, 30, 40]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  ////////////////////// Finish //////////////////////////
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+  ASSERT_NOT_OK(expr->finish(&aggr_result_iterator));
+
+  // the partitions are aggregated in partition order
+  std::map<int32_t, std::pair<int64_t, int64_t>> groups;
+  while (aggr_result_iterator->HasNext()) {
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+    auto keys = std::static_pointer_cast<arrow::Int32Array>(result_batch->column(0));
+    auto sums = std::static_pointer_cast<arrow::Int64Array>(result_batch->column(1));
+    auto counts = std::static_pointer_cast<arrow::Int64Array>(result_batch->column(2));
+    for (int64_t i = 0; i < result_batch->num_rows(); i++) {
+      ASSERT_EQ(groups.count(keys->Value(i)), 0);
+      groups[keys->Value(i)] = {sums->Value(i), counts->Value(i)};
+    }
+  }
+  unsetenv("NATIVESQL_AGGREGATE_MEMORY_BUDGET");
+  std::map<int32_t, std::pair<int64_t, int64_t>> expected_groups = {
+      {1, {35, 3}}, {2, {7, 2}}, {3, {9, 2}}, {4, {17, 2}}, {5, {60, 2}}};
+  ASSERT_EQ(groups, expected_groups);
+}
+
+TEST(TestArrowCompute, GroupByHashAggregateParallelTest) {
+  // rows aggregated by hash partition of their keys
+  setenv("NATIVESQL_AGGREGATE_THREADS", "3", 1);
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", int32());
+  auto f1 = field("f1", int32());
+  auto f_unique = field("unique", int32());
+  auto f_sum = field("sum", int64());
+  auto f_count = field("count", int64());
+  auto f_res = field("res", uint32());
+
+  auto arg0 = TreeExprBuilder::MakeField(f0);
+  auto arg1 = TreeExprBuilder::MakeField(f1);
+  auto n_groupby = TreeExprBuilder::MakeFunction("action_groupby", {arg0}, uint32());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {arg1}, uint32());
+  auto n_count = TreeExprBuilder::MakeFunction("action_count", {arg1}, uint32());
+  auto n_schema = TreeExprBuilder::MakeFunction("codegen_schema", {arg0, arg1}, uint32());
+  auto n_aggr = TreeExprBuilder::MakeFunction("hashAggregateArrays",
+                                              {n_groupby, n_sum, n_count}, uint32());
+  auto n_codegen_aggr =
+      TreeExprBuilder::MakeFunction("codegen_withOneInput", {n_aggr, n_schema}, uint32());
+
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+
+  auto sch = arrow::schema({f0, f1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique, f_sum, f_count};
+
+  /////////////////////// Create Expression Evaluator ////////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, {aggr_expr}, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  ////////////////////// calculation /////////////////////
+  std::vector<std::string> input_data = {"[1, 2, 3, 1, 2, 3, 4]",
+                                         "[1, 2, 3, 4, 5, 6, 7]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+  input_data = {"[4, 5, 1, 5]", "[10, 20, 30, 40]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  ////////////////////// Finish //////////////////////////
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+  ASSERT_NOT_OK(expr->finish(&aggr_result_iterator));
+
+  // the groups of a partition follow those of the previous one
+  std::map<int32_t, std::pair<int64_t, int64_t>> groups;
+  while (aggr_result_iterator->HasNext()) {
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+    auto keys = std::static_pointer_cast<arrow::Int32Array>(result_batch->column(0));
+    auto sums = std::static_pointer_cast<arrow::Int64Array>(result_batch->column(1));
+    auto counts = std::static_pointer_cast<arrow::Int64Array>(result_batch->column(2));
+    for (int64_t i = 0; i < result_batch->num_rows(); i++) {
+      ASSERT_EQ(groups.count(keys->Value(i)), 0);
+      groups[keys->Value(i)] = {sums->Value(i), counts->Value(i)};
+    }
+  }
+  unsetenv("NATIVESQL_AGGREGATE_THREADS");
+  std::map<int32_t, std::pair<int64_t, int64_t>> expected_groups = {
+      {1, {35, 3}}, {2, {7, 2}}, {3, {9, 2}}, {4, {17, 2}}, {5, {60, 2}}};
+  ASSERT_EQ(groups, expected_groups);
+}
+
+TEST(TestArrowCompute, GroupByHashAggregateDirectTest) {
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", int32());
+  auto f1 = field("f1", int32());
+  auto f_unique = field("unique", int32());
+  auto f_sum = field("sum", int64());
+  auto f_count = field("count", int64());
+  auto f_res = field("res", uint32());
+
+  auto arg0 = TreeExprBuilder::MakeField(f0);
+  auto arg1 = TreeExprBuilder::MakeField(f1);
+  auto n_groupby = TreeExprBuilder::MakeFunction("action_groupby", {arg0}, uint32());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {arg1}, uint32());
+  auto n_count = TreeExprBuilder::MakeFunction("action_count", {arg1}, uint32());
+  auto n_schema = TreeExprBuilder::MakeFunction("codegen_schema", {arg0, arg1}, uint32());
+  auto n_aggr = TreeExprBuilder::MakeFunction("hashAggregateArrays",
+                                              {n_groupby, n_sum, n_count}, uint32());
+  auto n_codegen_aggr =
+      TreeExprBuilder::MakeFunction("codegen_withOneInput", {n_aggr, n_schema}, uint32());
+
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+
+  auto sch = arrow::schema({f0, f1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique, f_sum, f_count};
+
+  /////////////////////// Create Expression Evaluator ////////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, {aggr_expr}, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  ////////////////////// calculation /////////////////////
+  // the keys of the first batch index their groups, until one is out of their range
+  std::vector<std::string> input_data = {"[1, 2, 3, 1, null, 3, 4]",
+                                         "[1, 2, 3, 4, 5, 6, 7]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+  input_data = {"[4, -5, 1000000, 1, -5]", "[10, 20, 30, 40, 50]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+  input_data = {"[2, 1000000, 6]", "[1, 2, 3]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  ////////////////////// Finish //////////////////////////
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+  ASSERT_NOT_OK(expr->finish(&aggr_result_iterator));
+
+  std::map<int32_t, std::pair<int64_t, int64_t>> groups;
+  while (aggr_result_iterator->HasNext()) {
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+    auto keys = std::static_pointer_cast<arrow::Int32Array>(result_batch->column(0));
+    auto sums = std::static_pointer_cast<arrow::Int64Array>(result_batch->column(1));
+    auto counts = std::static_pointer_cast<arrow::Int64Array>(result_batch->column(2));
+    for (int64_t i = 0; i < result_batch->num_rows(); i++) {
+      ASSERT_EQ(groups.count(keys->Value(i)), 0);
+      groups[keys->Value(i)] = {sums->Value(i), counts->Value(i)};
+    }
+  }
+  std::map<int32_t, std::pair<int64_t, int64_t>> expected_groups = {
+      {-5, {70, 2}}, {1, {45, 3}}, {2, {3, 2}}, {3, {9, 2}}, {4, {17, 2}}, {6, {3, 1}},
+      {1000000, {32, 2}}};
+  ASSERT_EQ(groups, expected_groups);
+}
+
+TEST(TestArrowCompute, GroupByHashAggregatePartialBypassTest) {
+  // the first 4 rows are sampled
+  setenv("NATIVESQL_BATCH_SIZE", "4", 1);
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", int32());
+  auto f1 = field("f1", int32());
+  auto f_unique = field("unique", int32());
+  auto f_sum = field("sum", int64());
+  auto f_count = field("count", int64());
+  auto f_res = field("res", uint32());
+
+  auto arg0 = TreeExprBuilder::MakeField(f0);
+  auto arg1 = TreeExprBuilder::MakeField(f1);
+  auto n_groupby = TreeExprBuilder::MakeFunction("action_groupby", {arg0}, uint32());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {arg1}, uint32());
+  auto n_count = TreeExprBuilder::MakeFunction("action_count", {arg1}, uint32());
+  auto n_schema = TreeExprBuilder::MakeFunction("codegen_schema", {arg0, arg1}, uint32());
+  auto n_aggr = TreeExprBuilder::MakeFunction("hashAggregateArraysPartial",
+                                              {n_groupby, n_sum, n_count}, uint32());
+  auto n_codegen_aggr =
+      TreeExprBuilder::MakeFunction("codegen_withOneInput", {n_aggr, n_schema}, uint32());
+
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+
+  auto sch = arrow::schema({f0, f1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f_unique, f_sum, f_count};
+
+  /////////////////////// Create Expression Evaluator ////////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, {aggr_expr}, ret_types, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  ////////////////////// calculation /////////////////////
+  // all distinct in the sample, the rows after it are groups of their own
+  std::vector<std::string> input_data = {"[1, 2, 3, 4]", "[1, 2, 3, 4]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+  input_data = {"[1, 1, 2, null]", "[10, 20, 30, 40]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  ////////////////////// Finish //////////////////////////
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+  ASSERT_NOT_OK(expr->finish(&aggr_result_iterator));
+
+  std::vector<std::tuple<int32_t, int64_t, int64_t>> groups;
+  while (aggr_result_iterator->HasNext()) {
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+    auto keys = std::static_pointer_cast<arrow::Int32Array>(result_batch->column(0));
+    auto sums = std::static_pointer_cast<arrow::Int64Array>(result_batch->column(1));
+    auto counts = std::static_pointer_cast<arrow::Int64Array>(result_batch->column(2));
+    for (int64_t i = 0; i < result_batch->num_rows(); i++) {
+      groups.emplace_back(keys->Value(i), sums->Value(i), counts->Value(i));
+    }
+  }
+  unsetenv("NATIVESQL_BATCH_SIZE");
+  std::vector<std::tuple<int32_t, int64_t, int64_t>> expected_groups = {
+      {1, 1, 1}, {2, 2, 1}, {3, 3, 1}, {4, 4, 1}, {1, 10, 1}, {1, 20, 1}, {2, 30, 1}};
+  ASSERT_EQ(groups, expected_groups);
+}
+
+TEST(TestArrowCompute, SortedAggregateTest) {
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", uint32());
+  auto f1 = field("f1", uint32());
+  auto f_unique = field("unique", uint32());
+  auto f_sum = field("sum", uint64());
+  auto f_count = field("count", uint64());
+  auto f_max = field("max", uint32());
+  auto f_res = field("res", uint32());
+
+  auto arg0 = TreeExprBuilder::MakeField(f0);
+  auto arg1 = TreeExprBuilder::MakeField(f1);
+  auto n_groupby = TreeExprBuilder::MakeFunction("action_groupby", {arg0}, uint32());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {arg1}, uint32());
+  auto n_count = TreeExprBuilder::MakeFunction("action_count", {arg1}, uint32());
+  auto n_max = TreeExprBuilder::MakeFunction("action_max", {arg1}, uint32());
+  auto n_schema = TreeExprBuilder::MakeFunction(
+      "codegen_schema", {TreeExprBuilder::MakeField(f0), TreeExprBuilder::MakeField(f1)},
+      uint32());
+  auto n_aggr = TreeExprBuilder::MakeFunction(
+      "sortedAggregateArrays", {n_groupby, n_sum, n_count, n_max}, uint32());
+  auto n_codegen_aggr =
+      TreeExprBuilder::MakeFunction("codegen_withOneInput", {n_aggr, n_schema}, uint32());
+
+  auto aggr_expr = TreeExprBuilder::MakeExpression(n_codegen_aggr, f_res);
+
+  auto sch = arrow::schema({f0, f1});
+  auto res_sch = arrow::schema({f_unique, f_sum, f_count, f_max});
+
+  /////////////////////// Create Expression Evaluator ////////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, {aggr_expr}, res_sch->fields(), &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  ////////////////////// calculation /////////////////////
+  // the keys are sorted with nulls last, the group of 2 goes on in the next batch
+  std::vector<std::string> input_data = {"[1, 1, 2, 2, 2]", "[10, 11, 20, 21, null]"};
+  MakeInputBatch(input_data, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> aggr_result_iterator;
+  ASSERT_NOT_OK(expr->finish(&aggr_result_iterator));
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  ASSERT_TRUE(aggr_result_iterator->HasNext());
+  ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+  MakeInputBatch({"[1]", "[21]", "[2]", "[11]"}, res_sch, &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+
+  // the next batches stream through the iterator
+  MakeInputBatch({"[2, 3, 3, null, null]", "[22, 30, 31, 40, null]"}, sch,
+                 &input_batch);
+  ASSERT_NOT_OK(aggr_result_iterator->Process(input_batch->columns(), &result_batch));
+  MakeInputBatch({"[2, 3]", "[63, 61]", "[3, 2]", "[22, 31]"}, res_sch,
+                 &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+
+  MakeInputBatch({"[null]", "[41]"}, sch, &input_batch);
+  ASSERT_NOT_OK(aggr_result_iterator->Process(input_batch->columns(), &result_batch));
+  ASSERT_EQ(result_batch, nullptr);
+
+  // the open group is output once the input is over
+  ASSERT_TRUE(aggr_result_iterator->HasNext());
+  ASSERT_NOT_OK(aggr_result_iterator->Next(&result_batch));
+  MakeInputBatch({"[null]", "[81]", "[2]", "[41]"}, res_sch, &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+  ASSERT_FALSE(aggr_result_iterator->HasNext());
+}
+
+TEST(TestArrowCompute, HashSetDistinctSpillTest) {
+  // spill from the first batch on
+  setenv("NATIVESQL_AGGREGATE_MEMORY_BUDGET", "1", 1);
+  auto f0 = field("f0", int32());
+  auto f1 = field("f1", utf8());
+  auto f_res = field("res", uint32());
+
+  auto n_schema = TreeExprBuilder::MakeFunction(
+      "codegen_schema",
+      {TreeExprBuilder::MakeField(f0), TreeExprBuilder::MakeField(f1)}, uint32());
+  auto n_distinct = TreeExprBuilder::MakeFunction("hashSetDistinct", {}, uint32());
+  auto n_codegen = TreeExprBuilder::MakeFunction("codegen_withOneInput",
+                                                 {n_distinct, n_schema}, uint32());
+  auto expr_distinct = TreeExprBuilder::MakeExpression(n_codegen, f_res);
+
+  auto sch = arrow::schema({f0, f1});
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, {expr_distinct}, {f0, f1}, &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+  MakeInputBatch({"[1, 2, 1, null, 2, null]", R"(["a", "b", "a", "c", "c", "c"])"},
+                 sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+  MakeInputBatch({"[2, 3, 1]", R"(["b", "d", null])"}, sch, &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> result_iterator;
+  ASSERT_NOT_OK(expr->finish(&result_iterator));
+  // the partitions are made distinct one at a time
+  std::map<std::string, int> rows;
+  while (result_iterator->HasNext()) {
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_NOT_OK(result_iterator->Next(&result_batch));
+    auto f0s = std::static_pointer_cast<arrow::Int32Array>(result_batch->column(0));
+    auto f1s = std::static_pointer_cast<arrow::StringArray>(result_batch->column(1));
+    for (int64_t i = 0; i < result_batch->num_rows(); i++) {
+      auto f0_value = f0s->IsNull(i) ? "null" : std::to_string(f0s->Value(i));
+      auto f1_value = f1s->IsNull(i) ? "null" : f1s->GetString(i);
+      rows[f0_value + "," + f1_value]++;
+    }
+  }
+  unsetenv("NATIVESQL_AGGREGATE_MEMORY_BUDGET");
+  std::map<std::string, int> expected_rows = {{"1,a", 1},    {"2,b", 1},
+                                              {"null,c", 1}, {"2,c", 1},
+                                              {"3,d", 1},    {"1,null", 1}};
+  ASSERT_EQ(rows, expected_rows);
+}
+
+TEST(TestArrowCompute, HashSetIntersectExceptTest) {
+  auto table0_f0 = field("table0_f0", int32());
+  auto table1_f0 = field("table1_f0", int32());
+  auto f_res = field("res", uint32());
+
+  auto n_left = TreeExprBuilder::MakeFunction(
+      "codegen_left_schema", {TreeExprBuilder::MakeField(table0_f0)}, uint32());
+  auto n_right = TreeExprBuilder::MakeFunction(
+      "codegen_right_schema", {TreeExprBuilder::MakeField(table1_f0)}, uint32());
+  auto schema_table_0 = arrow::schema({table0_f0});
+  auto schema_table_1 = arrow::schema({table1_f0});
+
+  std::shared_ptr<arrow::RecordBatch> build_batch;
+  MakeInputBatch({"[1, 2, null, 2, 5]"}, schema_table_0, &build_batch);
+  std::vector<std::shared_ptr<arrow::RecordBatch>> probe_batches;
+  std::shared_ptr<arrow::RecordBatch> probe_batch;
+  MakeInputBatch({"[2, 3, null, 3, 1]"}, schema_table_1, &probe_batch);
+  probe_batches.push_back(probe_batch);
+  MakeInputBatch({"[4, 1, 3, 5]"}, schema_table_1, &probe_batch);
+  probe_batches.push_back(probe_batch);
+
+  auto probe = [&](const std::string& func_name,
+                   const std::vector<std::string>& expected_result_string) {
+    auto n_set = TreeExprBuilder::MakeFunction(func_name, {}, uint32());
+    auto n_codegen = TreeExprBuilder::MakeFunction("codegen_withTwoInputs",
+                                                   {n_set, n_left, n_right}, uint32());
+    auto expr_set = TreeExprBuilder::MakeExpression(n_codegen, f_res);
+    std::shared_ptr<CodeGenerator> expr;
+    ASSERT_NOT_OK(
+        CreateCodeGenerator(schema_table_0, {expr_set}, {table1_f0}, &expr, true));
+    std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+    ASSERT_NOT_OK(expr->evaluate(build_batch, &dummy_result_batches));
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> result_iterator;
+    ASSERT_NOT_OK(expr->finish(&result_iterator));
+    for (size_t i = 0; i < probe_batches.size(); i++) {
+      std::shared_ptr<arrow::RecordBatch> result_batch;
+      ASSERT_NOT_OK(
+          result_iterator->Process(probe_batches[i]->columns(), &result_batch));
+      std::shared_ptr<arrow::RecordBatch> expected_result;
+      MakeInputBatch({expected_result_string[i]}, schema_table_1, &expected_result);
+      ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+    }
+    ASSERT_FALSE(result_iterator->HasNext());
+  };
+
+  // each distinct row once, nulls equal
+  probe("hashSetIntersect", {"[2, null, 1]", "[5]"});
+  probe("hashSetExcept", {"[3]", "[4]"});
+}
+
 }  // namespace codegen
 }  // namespace sparkcolumnarplugin
@@ -19,9 +19,16 @@
 #include <arrow/ipc/json_simple.h>
 #include <arrow/record_batch.h>
 #include <gtest/gtest.h>
+#include <cstdlib>
 #include <memory>
 #include "codegen/code_generator.h"
+#include "codegen/arrow_compute/ext/array_item_index.h"
+#include "codegen/arrow_compute/ext/gather.h"
+#include "codegen/arrow_compute/ext/join_hash_table.h"
+#include "codegen/arrow_compute/ext/kernels_ext.h"
+#include "codegen/arrow_compute/ext/star_join.h"
 #include "codegen/code_generator_factory.h"
+#include "codegen/common/runtime_filter.h"
 #include "tests/test_utils.h"
 
 namespace sparkcolumnarplugin {
@@ -550,6 +557,88 @@ TEST(TestArrowComputeJoin, JoinTestUsingInnerJoinWithCondition) {
   }
 }
 
+TEST(TestArrowComputeJoin, JoinTestUsingInnerJoinWithVectorizedCondition) {
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto table0_f0 = field("table0_f0", uint32());
+  auto table0_f1 = field("table0_f1", uint32());
+  auto table0_f2 = field("table0_f2", uint32());
+  auto table1_f0 = field("table1_f0", uint32());
+  auto table1_f1 = field("table1_f1", uint32());
+
+  // numeric, so evaluated over all the candidate matches at once
+  auto greater_than_function = TreeExprBuilder::MakeFunction(
+      "greater_than",
+      {TreeExprBuilder::MakeField(table0_f1), TreeExprBuilder::MakeField(table1_f1)},
+      arrow::boolean());
+  auto positive_function = TreeExprBuilder::MakeFunction(
+      "greater_than",
+      {TreeExprBuilder::MakeField(table0_f2), TreeExprBuilder::MakeLiteral((uint32_t)1)},
+      arrow::boolean());
+  auto condition = TreeExprBuilder::MakeAnd({greater_than_function, positive_function});
+  auto n_left = TreeExprBuilder::MakeFunction(
+      "codegen_left_schema",
+      {TreeExprBuilder::MakeField(table0_f0), TreeExprBuilder::MakeField(table0_f1),
+       TreeExprBuilder::MakeField(table0_f2)},
+      uint32());
+  auto n_right = TreeExprBuilder::MakeFunction(
+      "codegen_right_schema",
+      {TreeExprBuilder::MakeField(table1_f0), TreeExprBuilder::MakeField(table1_f1)},
+      uint32());
+  auto f_res = field("res", uint32());
+
+  auto n_left_key = TreeExprBuilder::MakeFunction(
+      "codegen_left_schema", {TreeExprBuilder::MakeField(table0_f0)}, uint32());
+  auto n_right_key = TreeExprBuilder::MakeFunction(
+      "codegen_right_schema", {TreeExprBuilder::MakeField(table1_f0)}, uint32());
+  auto n_probeArrays = TreeExprBuilder::MakeFunction(
+      "conditionedProbeArraysInner", {n_left_key, n_right_key, condition}, uint32());
+  auto n_codegen_probe = TreeExprBuilder::MakeFunction(
+      "codegen_withTwoInputs", {n_probeArrays, n_left, n_right}, uint32());
+  auto probeArrays_expr = TreeExprBuilder::MakeExpression(n_codegen_probe, f_res);
+
+  auto schema_table_0 = arrow::schema({table0_f0, table0_f1, table0_f2});
+  auto schema_table_1 = arrow::schema({table1_f0, table1_f1});
+  ///////////////////// Calculation //////////////////
+  std::shared_ptr<CodeGenerator> expr_probe;
+  ASSERT_NOT_OK(CreateCodeGenerator(
+      schema_table_0, {probeArrays_expr},
+      {table0_f0, table0_f1, table0_f2, table1_f0, table1_f1}, &expr_probe, true));
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> probe_result_iterator;
+
+  // the nulls on both sides fail the condition
+  std::vector<std::string> input_data_string = {
+      "[1, 2, 3, 4, 5, 1]", "[10, null, 30, 40, 50, 20]", "[2, 2, 2, 2, 1, 3]"};
+  MakeInputBatch(input_data_string, schema_table_0, &input_batch);
+  ASSERT_NOT_OK(expr_probe->evaluate(input_batch, &dummy_result_batches));
+  ASSERT_NOT_OK(expr_probe->finish(&probe_result_iterator));
+
+  std::vector<std::string> input_data_2_string = {"[1, 2, 3, 4, 5]",
+                                                  "[15, 5, null, 50, 5]"};
+  MakeInputBatch(input_data_2_string, schema_table_1, &input_batch);
+
+  //////////////////////// data prepared /////////////////////////
+
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  std::vector<std::string> expected_result_string = {"[1]", "[20]", "[3]", "[1]",
+                                                     "[15]"};
+  auto res_sch = arrow::schema({f_res, f_res, f_res, f_res, f_res});
+  MakeInputBatch(expected_result_string, res_sch, &expected_result);
+
+  ////////////////////// evaluate //////////////////////
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+  std::vector<std::shared_ptr<arrow::Array>> input;
+  for (int i = 0; i < input_batch->num_columns(); i++) {
+    input.push_back(input_batch->column(i));
+  }
+
+  ASSERT_NOT_OK(probe_result_iterator->Process(input, &result_batch));
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+}
+
 TEST(TestArrowComputeJoin, JoinTestUsingAntiJoinWithCondition) {
   ////////////////////// prepare expr_vector ///////////////////////
   auto table0_f0 = field("table0_f0", uint32());
@@ -759,5 +848,716 @@ TEST(TestArrowComputeJoin, JoinTestUsingExistenceJoin) {
   }
 }
 
+TEST(TestArrowComputeJoin, JoinTestUsingNullAwareAntiJoin) {
+  auto table0_f0 = field("table0_f0", uint32());
+  auto table0_f1 = field("table0_f1", uint32());
+  auto table1_f0 = field("table1_f0", uint32());
+  auto table1_f1 = field("table1_f1", uint32());
+
+  auto n_left = TreeExprBuilder::MakeFunction(
+      "codegen_left_schema",
+      {TreeExprBuilder::MakeField(table0_f0), TreeExprBuilder::MakeField(table0_f1)},
+      uint32());
+  auto n_right = TreeExprBuilder::MakeFunction(
+      "codegen_right_schema",
+      {TreeExprBuilder::MakeField(table1_f0), TreeExprBuilder::MakeField(table1_f1)},
+      uint32());
+  auto f_res = field("res", uint32());
+
+  auto n_left_key = TreeExprBuilder::MakeFunction(
+      "codegen_left_key_schema", {TreeExprBuilder::MakeField(table0_f0)}, uint32());
+  auto n_right_key = TreeExprBuilder::MakeFunction(
+      "codegen_right_key_schema", {TreeExprBuilder::MakeField(table1_f0)}, uint32());
+  auto n_probeArrays = TreeExprBuilder::MakeFunction(
+      "conditionedProbeArraysNullAwareAnti", {n_left_key, n_right_key}, uint32());
+  auto n_codegen_probe = TreeExprBuilder::MakeFunction(
+      "codegen_withTwoInputs", {n_probeArrays, n_left, n_right}, uint32());
+  auto probeArrays_expr = TreeExprBuilder::MakeExpression(n_codegen_probe, f_res);
+
+  auto schema_table_0 = arrow::schema({table0_f0, table0_f1});
+  auto schema_table_1 = arrow::schema({table1_f0, table1_f1});
+  auto res_sch = arrow::schema({f_res, f_res});
+
+  std::shared_ptr<arrow::RecordBatch> probe_batch;
+  MakeInputBatch({"[1, null, 4, 7]", "[1, 2, 3, 4]"}, schema_table_1, &probe_batch);
+
+  auto probe = [&](const std::vector<std::string>& build_data_string,
+                   const std::vector<std::string>& expected_result_string) {
+    std::shared_ptr<CodeGenerator> expr_probe;
+    ASSERT_NOT_OK(CreateCodeGenerator(schema_table_0, {probeArrays_expr},
+                                      {table1_f0, table1_f1}, &expr_probe, true));
+    std::shared_ptr<arrow::RecordBatch> build_batch;
+    MakeInputBatch(build_data_string, schema_table_0, &build_batch);
+    std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+    ASSERT_NOT_OK(expr_probe->evaluate(build_batch, &dummy_result_batches));
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> probe_result_iterator;
+    ASSERT_NOT_OK(expr_probe->finish(&probe_result_iterator));
+
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_NOT_OK(probe_result_iterator->Process(probe_batch->columns(), &result_batch));
+    std::shared_ptr<arrow::RecordBatch> expected_result;
+    MakeInputBatch(expected_result_string, res_sch, &expected_result);
+    ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+  };
+
+  // a null probe key is not kept
+  probe({"[1, 2, 3, 5]", "[1, 2, 3, 5]"}, {"[4, 7]", "[3, 4]"});
+  // nor any probe row once the build side has a null key
+  probe({"[1, null, 3, 5]", "[1, 2, 3, 5]"}, {"[]", "[]"});
+}
+
+TEST(TestArrowComputeJoin, JoinHashTableDuplicateKeys) {
+  using arrowcompute::extra::ArrayItemIndex;
+  using HashTable = arrowcompute::extra::JoinHashTable<int64_t, ArrayItemIndex>;
+  HashTable table;
+  // enough keys to resize the table, key 0 included
+  for (uint16_t i = 0; i < 5000; i++) {
+    table.Insert(i % 2500, ArrayItemIndex(i / 2500, i));
+  }
+  table.InsertNull(ArrayItemIndex(2, 0));
+  ASSERT_EQ(table.num_keys(), 2501);
+  ASSERT_EQ(table.num_items(), 5001);
+
+  for (int64_t key : {0, 1, 2499}) {
+    auto key_id = table.Get(key);
+    ASSERT_NE(key_id, HashTable::kNotFound);
+    std::vector<ArrayItemIndex> items;
+    for (const auto& item : table.Items(key_id)) {
+      items.push_back(item);
+    }
+    // items of a key come in insertion order
+    ASSERT_EQ(items.size(), 2u);
+    ASSERT_EQ(table.NumItems(key_id), 2);
+    ASSERT_EQ(items[0].array_id, 0);
+    ASSERT_EQ(items[0].id, key);
+    ASSERT_EQ(items[1].array_id, 1);
+    ASSERT_EQ(items[1].id, key + 2500);
+  }
+  ASSERT_EQ(table.Get(2500), HashTable::kNotFound);
+  ASSERT_EQ(table.Get(-1), HashTable::kNotFound);
+
+  auto null_id = table.GetNull();
+  ASSERT_NE(null_id, HashTable::kNotFound);
+  int num_null_items = 0;
+  for (const auto& item : table.Items(null_id)) {
+    ASSERT_EQ(item.array_id, 2);
+    num_null_items++;
+  }
+  ASSERT_EQ(num_null_items, 1);
+}
+
+TEST(TestArrowComputeJoin, JoinHashTableGetBatch) {
+  using arrowcompute::extra::ArrayItemIndex;
+  using HashTable = arrowcompute::extra::JoinHashTable<int64_t, ArrayItemIndex>;
+  HashTable table;
+  table.Insert(0, ArrayItemIndex(0, 0));
+  table.Insert(3, ArrayItemIndex(0, 1));
+  table.InsertNull(ArrayItemIndex(0, 2));
+
+  std::shared_ptr<arrow::Array> probe;
+  ASSERT_NOT_OK(arrow::ipc::internal::json::ArrayFromJSON(
+      arrow::int64(), "[3, null, 1, 0, 3]", &probe));
+  auto typed_probe = std::dynamic_pointer_cast<arrow::Int64Array>(probe);
+  int32_t key_ids[HashTable::kProbeBatchSize];
+  table.GetBatch(*typed_probe, 1, 4, key_ids);
+  ASSERT_EQ(key_ids[0], table.GetNull());
+  ASSERT_EQ(key_ids[1], HashTable::kNotFound);
+  ASSERT_EQ(key_ids[2], table.Get(0));
+  ASSERT_EQ(key_ids[3], table.Get(3));
+}
+
+TEST(TestArrowComputeJoin, JoinHashTableRadixPartitioned) {
+  using arrowcompute::extra::WideArrayItemIndex;
+  using HashTable = arrowcompute::extra::JoinHashTable<int64_t, WideArrayItemIndex>;
+  // partition as soon as the partitions are full sized
+  HashTable table(nullptr, 0);
+  arrow::Int64Builder builder;
+  for (int64_t i = 0; i < 200000; i++) {
+    if (i % 1000 == 0) {
+      ASSERT_NOT_OK(builder.AppendNull());
+    } else {
+      ASSERT_NOT_OK(builder.Append((i * 7919) % 100000));
+    }
+  }
+  std::shared_ptr<arrow::Array> build;
+  ASSERT_NOT_OK(builder.Finish(&build));
+  auto typed_build = std::dynamic_pointer_cast<arrow::Int64Array>(build);
+  table.InsertBatch(*typed_build,
+                    [](int64_t id) { return WideArrayItemIndex(0, id); });
+  ASSERT_GT(table.radix_bits(), 0);
+
+  for (int64_t key = 1; key < 100000; key += 997) {
+    auto key_id = table.Get(key);
+    ASSERT_NE(key_id, HashTable::kNotFound);
+    uint32_t last_id = 0;
+    for (const auto& item : table.Items(key_id)) {
+      // rows of a key stay in build order
+      ASSERT_GE(item.id, last_id);
+      ASSERT_EQ(typed_build->Value(item.id), key);
+      last_id = item.id;
+    }
+  }
+
+  std::vector<int32_t> key_ids(typed_build->length());
+  table.GetBatch(*typed_build, 0, typed_build->length(), key_ids.data());
+  for (int64_t i = 0; i < typed_build->length(); i++) {
+    if (typed_build->IsNull(i)) {
+      ASSERT_EQ(key_ids[i], table.GetNull());
+    } else {
+      ASSERT_EQ(key_ids[i], table.Get(typed_build->Value(i)));
+    }
+  }
+}
+
+TEST(TestArrowComputeJoin, JoinHashTableParallelBuild) {
+  using arrowcompute::extra::ArrayItemIndex;
+  using HashTable = arrowcompute::extra::JoinHashTable<int64_t, ArrayItemIndex>;
+  std::vector<std::shared_ptr<arrow::Int64Array>> build_arrays;
+  for (int64_t a = 0; a < 8; a++) {
+    arrow::Int64Builder builder;
+    for (int64_t i = 0; i < 20000; i++) {
+      if (i % 1000 == 0) {
+        ASSERT_NOT_OK(builder.AppendNull());
+      } else {
+        ASSERT_NOT_OK(builder.Append((a * 20000 + i) * 7919 % 50000));
+      }
+    }
+    std::shared_ptr<arrow::Array> build;
+    ASSERT_NOT_OK(builder.Finish(&build));
+    build_arrays.push_back(std::dynamic_pointer_cast<arrow::Int64Array>(build));
+  }
+  auto make_item = [](size_t array_id, int64_t id) {
+    return ArrayItemIndex(array_id, id);
+  };
+  // partition as soon as the partitions are full sized
+  HashTable parallel_table(nullptr, 0);
+  parallel_table.InsertBatches(build_arrays, make_item, 4);
+  ASSERT_GT(parallel_table.radix_bits(), 0);
+  HashTable serial_table(nullptr, 0);
+  serial_table.InsertBatches(build_arrays, make_item, 1);
+  ASSERT_EQ(parallel_table.num_keys(), serial_table.num_keys());
+  ASSERT_EQ(parallel_table.num_items(), serial_table.num_items());
+
+  for (int64_t key = 0; key < 50000; key += 97) {
+    auto key_id = parallel_table.Get(key);
+    ASSERT_EQ(key_id == HashTable::kNotFound,
+              serial_table.Get(key) == HashTable::kNotFound);
+    if (key_id == HashTable::kNotFound) {
+      continue;
+    }
+    std::vector<std::pair<int, int>> parallel_items;
+    for (const auto& item : parallel_table.Items(key_id)) {
+      parallel_items.emplace_back(item.array_id, item.id);
+    }
+    std::vector<std::pair<int, int>> serial_items;
+    for (const auto& item : serial_table.Items(serial_table.Get(key))) {
+      serial_items.emplace_back(item.array_id, item.id);
+    }
+    // rows of a key stay in build order
+    ASSERT_EQ(parallel_items, serial_items);
+  }
+  int num_null_items = 0;
+  for (const auto& item : parallel_table.Items(parallel_table.GetNull())) {
+    ASSERT_EQ(item.id % 1000, 0);
+    num_null_items++;
+  }
+  ASSERT_EQ(num_null_items, 8 * 20);
+}
+
+TEST(TestArrowComputeJoin, JoinHashTableStringKeys) {
+  using arrowcompute::extra::ArrayItemIndex;
+  using HashTable = arrowcompute::extra::JoinHashTable<std::string, ArrayItemIndex>;
+  // keys shorter and longer than the inline prefix, the long ones sharing it
+  auto make_key = [](int64_t i) {
+    return i % 2 == 0 ? std::to_string(i) : "shared_prefix_" + std::to_string(i);
+  };
+  std::vector<std::shared_ptr<arrow::StringArray>> build_arrays;
+  for (int64_t a = 0; a < 4; a++) {
+    arrow::StringBuilder builder;
+    for (int64_t i = 0; i < 20000; i++) {
+      if (i % 1000 == 0) {
+        ASSERT_NOT_OK(builder.AppendNull());
+      } else {
+        ASSERT_NOT_OK(builder.Append(make_key((a * 20000 + i) * 7919 % 30000)));
+      }
+    }
+    std::shared_ptr<arrow::Array> build;
+    ASSERT_NOT_OK(builder.Finish(&build));
+    build_arrays.push_back(std::dynamic_pointer_cast<arrow::StringArray>(build));
+  }
+  auto make_item = [](size_t array_id, int64_t id) {
+    return ArrayItemIndex(array_id, id);
+  };
+  HashTable parallel_table(nullptr, 0);
+  parallel_table.InsertBatches(build_arrays, make_item, 4);
+  ASSERT_GT(parallel_table.radix_bits(), 0);
+  HashTable serial_table;
+  serial_table.InsertBatches(build_arrays, make_item, 1);
+  ASSERT_EQ(parallel_table.num_keys(), serial_table.num_keys());
+
+  for (int64_t key = 0; key < 30000; key += 7) {
+    ASSERT_EQ(parallel_table.Get(make_key(key)) == HashTable::kNotFound,
+              serial_table.Get(make_key(key)) == HashTable::kNotFound);
+  }
+  for (const auto* table : {&parallel_table, &serial_table}) {
+    for (int64_t key = 0; key < 30000; key += 7) {
+      auto key_id = table->Get(make_key(key));
+      if (key_id == HashTable::kNotFound) {
+        continue;
+      }
+      for (const auto& item : table->Items(key_id)) {
+        ASSERT_EQ(build_arrays[item.array_id]->GetString(item.id), make_key(key));
+      }
+    }
+    ASSERT_EQ(table->Get("shared_prefix_"), HashTable::kNotFound);
+    ASSERT_EQ(table->Get("shared_prefix_30001"), HashTable::kNotFound);
+    int32_t num_keys = 0;
+    table->ForEachKey([&](arrow::util::string_view key) {
+      ASSERT_NE(table->Get(key), HashTable::kNotFound);
+      num_keys++;
+    });
+    ASSERT_EQ(num_keys, table->num_keys());
+  }
+
+  std::vector<int32_t> key_ids(build_arrays[0]->length());
+  parallel_table.GetBatch(*build_arrays[0], 0, build_arrays[0]->length(),
+                          key_ids.data());
+  for (int64_t i = 0; i < build_arrays[0]->length(); i++) {
+    if (build_arrays[0]->IsNull(i)) {
+      ASSERT_EQ(key_ids[i], parallel_table.GetNull());
+    } else {
+      ASSERT_EQ(key_ids[i], parallel_table.Get(build_arrays[0]->GetView(i)));
+    }
+  }
+}
+
+TEST(TestArrowComputeJoin, JoinRuntimeFilter) {
+  RuntimeFilter filter(1000);
+  for (int64_t key = 0; key < 1000; key++) {
+    filter.Insert(key * 4);
+  }
+  auto serialized = filter.Serialize();
+  auto result = RuntimeFilter::Deserialize(
+      reinterpret_cast<const uint8_t*>(serialized.data()), serialized.size());
+  ASSERT_TRUE(result.ok());
+  auto deserialized = result.ValueOrDie();
+  int false_positives = 0;
+  for (int64_t key = 0; key < 4000; key++) {
+    if (key % 4 == 0) {
+      ASSERT_TRUE(deserialized->MightContain(key));
+    } else if (deserialized->MightContain(key)) {
+      false_positives++;
+    }
+  }
+  ASSERT_LT(false_positives, 30);
+  ASSERT_FALSE(deserialized->MightContain(-4));
+  ASSERT_TRUE(deserialized->MightOverlap(3996, 5000));
+  ASSERT_FALSE(deserialized->MightOverlap(3997, 5000));
+  ASSERT_FALSE(RuntimeFilter::Deserialize(
+                   reinterpret_cast<const uint8_t*>(serialized.data()), 8)
+                   .ok());
+}
+
+TEST(TestArrowComputeJoin, JoinNormalizeKeys) {
+  using arrowcompute::extra::KernalBase;
+  using arrowcompute::extra::NormalizeKeysKernel;
+  arrow::compute::FunctionContext ctx;
+  auto from_json = [](std::shared_ptr<arrow::DataType> type, const std::string& json) {
+    std::shared_ptr<arrow::Array> array;
+    EXPECT_TRUE(arrow::ipc::internal::json::ArrayFromJSON(type, json, &array).ok());
+    return array;
+  };
+
+  // fixed width keys fitting a word
+  auto ints = from_json(arrow::int32(), "[1, 1, null, 2, 1, null]");
+  auto shorts = from_json(arrow::int16(), "[5, 5, 5, 5, 6, 5]");
+  ASSERT_TRUE(
+      NormalizeKeysKernel::NormalizedType({arrow::int32(), arrow::int16()})->Equals(
+          arrow::int64()));
+  std::shared_ptr<KernalBase> word_kernel;
+  ASSERT_NOT_OK(
+      NormalizeKeysKernel::Make(&ctx, {arrow::int32(), arrow::int16()}, &word_kernel));
+  std::shared_ptr<arrow::Array> words;
+  ASSERT_NOT_OK(word_kernel->Evaluate({ints, shorts}, &words));
+  auto typed_words = std::dynamic_pointer_cast<arrow::Int64Array>(words);
+  ASSERT_NE(typed_words, nullptr);
+  ASSERT_EQ(typed_words->null_count(), 0);
+  ASSERT_EQ(typed_words->Value(0), typed_words->Value(1));
+  ASSERT_EQ(typed_words->Value(2), typed_words->Value(5));
+  ASSERT_NE(typed_words->Value(0), typed_words->Value(3));
+  ASSERT_NE(typed_words->Value(0), typed_words->Value(4));
+  ASSERT_NE(typed_words->Value(0), typed_words->Value(2));
+
+  // a null string differs from an empty one, "ab" + "c" from "a" + "bc"
+  auto strs = from_json(arrow::utf8(), R"(["ab", "a", null, "", "ab", "ab"])");
+  auto more_strs = from_json(arrow::utf8(), R"(["c", "bc", "c", "c", "c", "c"])");
+  auto longs = from_json(arrow::int64(), "[7, 7, 7, 7, 7, 8]");
+  std::vector<std::shared_ptr<arrow::DataType>> type_list = {arrow::utf8(), arrow::utf8(),
+                                                             arrow::int64()};
+  ASSERT_TRUE(NormalizeKeysKernel::NormalizedType(type_list)->Equals(arrow::binary()));
+  std::shared_ptr<KernalBase> binary_kernel;
+  ASSERT_NOT_OK(NormalizeKeysKernel::Make(&ctx, type_list, &binary_kernel));
+  std::shared_ptr<arrow::Array> binaries;
+  ASSERT_NOT_OK(binary_kernel->Evaluate({strs, more_strs, longs}, &binaries));
+  auto typed_binaries = std::dynamic_pointer_cast<arrow::BinaryArray>(binaries);
+  ASSERT_NE(typed_binaries, nullptr);
+  ASSERT_EQ(typed_binaries->GetString(0), typed_binaries->GetString(4));
+  ASSERT_NE(typed_binaries->GetString(0), typed_binaries->GetString(1));
+  ASSERT_NE(typed_binaries->GetString(2), typed_binaries->GetString(3));
+  ASSERT_NE(typed_binaries->GetString(0), typed_binaries->GetString(5));
+}
+
+TEST(TestArrowComputeJoin, JoinGatherColumns) {
+  using arrowcompute::extra::ArrayItemIndex;
+  using arrowcompute::extra::GatherItems;
+  using arrowcompute::extra::GatherRows;
+  std::vector<std::shared_ptr<arrow::StringArray>> build_arrays;
+  for (const auto& json : {R"(["a", null, "c"])", R"(["d", "e"])"}) {
+    std::shared_ptr<arrow::Array> array;
+    ASSERT_NOT_OK(arrow::ipc::internal::json::ArrayFromJSON(arrow::utf8(), json, &array));
+    build_arrays.push_back(std::dynamic_pointer_cast<arrow::StringArray>(array));
+  }
+  std::vector<ArrayItemIndex> items = {{1, 1}, {0, 1}, {0, 0}, {0, 2}};
+  std::vector<uint8_t> valid = {1, 1, 0, 1};
+  arrow::StringBuilder build_builder;
+  ASSERT_NOT_OK(GatherItems(build_arrays, items.data(), valid.data(), items.size(),
+                            &build_builder));
+  std::shared_ptr<arrow::Array> build_out;
+  ASSERT_NOT_OK(build_builder.Finish(&build_out));
+  std::shared_ptr<arrow::Array> expected_build;
+  ASSERT_NOT_OK(arrow::ipc::internal::json::ArrayFromJSON(
+      arrow::utf8(), R"(["e", null, null, "c"])", &expected_build));
+  ASSERT_TRUE(build_out->Equals(expected_build));
+
+  std::shared_ptr<arrow::Array> probe;
+  ASSERT_NOT_OK(
+      arrow::ipc::internal::json::ArrayFromJSON(arrow::int32(), "[4, null, 6]", &probe));
+  std::vector<int32_t> rows = {0, 0, 1, 2};
+  arrow::Int32Builder probe_builder;
+  ASSERT_NOT_OK(GatherRows(*std::dynamic_pointer_cast<arrow::Int32Array>(probe),
+                           rows.data(), rows.size(), &probe_builder));
+  std::shared_ptr<arrow::Array> probe_out;
+  ASSERT_NOT_OK(probe_builder.Finish(&probe_out));
+  std::shared_ptr<arrow::Array> expected_probe;
+  ASSERT_NOT_OK(arrow::ipc::internal::json::ArrayFromJSON(arrow::int32(),
+                                                          "[4, 4, null, 6]",
+                                                          &expected_probe));
+  ASSERT_TRUE(probe_out->Equals(expected_probe));
+}
+
+TEST(TestArrowComputeJoin, JoinTestUsingStarJoin) {
+  auto fact_f0 = field("fact_f0", uint32());
+  auto fact_f1 = field("fact_f1", uint32());
+  auto fact_schema = arrow::schema({fact_f0, fact_f1});
+  auto f_res = field("res", uint32());
+
+  // the built join of a dimension of key dim_k, on the fact column fact_key
+  auto build = [&](const std::string& name, const std::string& join,
+                   const std::shared_ptr<arrow::Field>& fact_key,
+                   const std::vector<std::string>& build_data_string,
+                   std::shared_ptr<ResultIterator<arrow::RecordBatch>>* out) {
+    auto dim_k = field(name + "_k", uint32());
+    auto dim_v = field(name + "_v", uint32());
+    auto n_left = TreeExprBuilder::MakeFunction(
+        "codegen_left_schema",
+        {TreeExprBuilder::MakeField(dim_k), TreeExprBuilder::MakeField(dim_v)},
+        uint32());
+    auto n_right = TreeExprBuilder::MakeFunction(
+        "codegen_right_schema",
+        {TreeExprBuilder::MakeField(fact_f0), TreeExprBuilder::MakeField(fact_f1)},
+        uint32());
+    auto n_left_key = TreeExprBuilder::MakeFunction(
+        "codegen_left_key_schema", {TreeExprBuilder::MakeField(dim_k)}, uint32());
+    auto n_right_key = TreeExprBuilder::MakeFunction(
+        "codegen_right_key_schema", {TreeExprBuilder::MakeField(fact_key)}, uint32());
+    auto n_probeArrays =
+        TreeExprBuilder::MakeFunction(join, {n_left_key, n_right_key}, uint32());
+    auto n_codegen_probe = TreeExprBuilder::MakeFunction(
+        "codegen_withTwoInputs", {n_probeArrays, n_left, n_right}, uint32());
+    auto probeArrays_expr = TreeExprBuilder::MakeExpression(n_codegen_probe, f_res);
+    auto schema_dim = arrow::schema({dim_k, dim_v});
+
+    std::shared_ptr<CodeGenerator> expr_probe;
+    ASSERT_NOT_OK(CreateCodeGenerator(schema_dim, {probeArrays_expr},
+                                      {fact_f0, fact_f1, dim_v}, &expr_probe, true));
+    std::shared_ptr<arrow::RecordBatch> build_batch;
+    MakeInputBatch(build_data_string, schema_dim, &build_batch);
+    std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+    ASSERT_NOT_OK(expr_probe->evaluate(build_batch, &dummy_result_batches));
+    ASSERT_NOT_OK(expr_probe->finish(out));
+  };
+
+  // a duplicate key 4 in the inner dimension, 3 missing from it
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> inner_build;
+  build("a", "conditionedProbeArraysInner", fact_f0,
+        {"[1, 2, 4, 4]", "[100, 200, 400, 401]"}, &inner_build);
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> outer_build;
+  build("b", "conditionedProbeArraysOuter", fact_f1, {"[10, 40]", "[1000, 4000]"},
+        &outer_build);
+
+  // the outer dimension first, probed after the inner one
+  std::vector<arrowcompute::extra::StarJoinDimension> dimensions(2);
+  dimensions[0].build = outer_build;
+  dimensions[0].join_type = 1;
+  dimensions[0].key_indices = {1};
+  dimensions[1].build = inner_build;
+  dimensions[1].join_type = 0;
+  dimensions[1].key_indices = {0};
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> star_join;
+  ASSERT_NOT_OK(arrowcompute::extra::MakeStarJoinIterator(
+      arrow::default_memory_pool(), fact_schema, dimensions, &star_join));
+
+  std::shared_ptr<arrow::RecordBatch> fact_batch;
+  MakeInputBatch({"[1, 2, 3, 4, null]", "[10, 20, 30, 40, 10]"}, fact_schema,
+                 &fact_batch);
+  auto res_sch = arrow::schema({f_res, f_res, f_res, f_res});
+
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+  ASSERT_NOT_OK(star_join->Process(fact_batch->columns(), &result_batch));
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  MakeInputBatch({"[1, 2, 4, 4]", "[10, 20, 40, 40]", "[1000, null, 4000, 4000]",
+                  "[100, 200, 400, 401]"},
+                 res_sch, &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+
+  // only the selected rows
+  std::shared_ptr<arrow::Array> selection;
+  ASSERT_NOT_OK(arrow::ipc::internal::json::ArrayFromJSON(arrow::uint16(), "[0, 2]",
+                                                           &selection));
+  ASSERT_NOT_OK(star_join->Process(fact_batch->columns(), &result_batch, selection));
+  MakeInputBatch({"[1]", "[10]", "[1000]", "[100]"}, res_sch, &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+}
+
+TEST(TestArrowComputeJoin, JoinTestUsingSortMergeJoin) {
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto table0_f0 = field("table0_f0", int32());
+  auto table0_f1 = field("table0_f1", int32());
+  auto table1_f0 = field("table1_f0", int32());
+  auto table1_f1 = field("table1_f1", int32());
+  auto schema_table_0 = arrow::schema({table0_f0, table0_f1});
+  auto schema_table_1 = arrow::schema({table1_f0, table1_f1});
+  auto f_res = field("res", int32());
+  auto res_sch = arrow::schema({f_res, f_res, f_res, f_res});
+
+  // both sides sorted by key, with a run of equal keys across the left batches
+  std::vector<std::shared_ptr<arrow::RecordBatch>> table_0;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> table_1;
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch({"[null, 1, 2, 2]", "[100, 10, 20, 21]"}, schema_table_0, &input_batch);
+  table_0.push_back(input_batch);
+  MakeInputBatch({"[2, 4, 6]", "[22, 40, 60]"}, schema_table_0, &input_batch);
+  table_0.push_back(input_batch);
+  MakeInputBatch({"[null, 1, 2, 3]", "[0, 1, 2, 3]"}, schema_table_1, &input_batch);
+  table_1.push_back(input_batch);
+  MakeInputBatch({"[4, 4, 5, 7]", "[4, 41, 5, 7]"}, schema_table_1, &input_batch);
+  table_1.push_back(input_batch);
+
+  auto merge = [&](const std::string& func_name,
+                   std::vector<std::vector<std::string>> expected_result_strings) {
+    auto n_left = TreeExprBuilder::MakeFunction(
+        "codegen_left_schema",
+        {TreeExprBuilder::MakeField(table0_f0), TreeExprBuilder::MakeField(table0_f1)},
+        int32());
+    auto n_right = TreeExprBuilder::MakeFunction(
+        "codegen_right_schema",
+        {TreeExprBuilder::MakeField(table1_f0), TreeExprBuilder::MakeField(table1_f1)},
+        int32());
+    auto n_left_key = TreeExprBuilder::MakeFunction(
+        "codegen_left_key_schema", {TreeExprBuilder::MakeField(table0_f0)}, int32());
+    auto n_right_key = TreeExprBuilder::MakeFunction(
+        "codegen_right_key_schema", {TreeExprBuilder::MakeField(table1_f0)}, int32());
+    auto n_merge =
+        TreeExprBuilder::MakeFunction(func_name, {n_left_key, n_right_key}, int32());
+    auto n_codegen_merge = TreeExprBuilder::MakeFunction(
+        "codegen_withTwoInputs", {n_merge, n_left, n_right}, int32());
+    auto merge_expr = TreeExprBuilder::MakeExpression(n_codegen_merge, f_res);
+
+    std::shared_ptr<CodeGenerator> expr_merge;
+    ASSERT_NOT_OK(CreateCodeGenerator(schema_table_0, {merge_expr},
+                                      {table0_f0, table0_f1, table1_f0, table1_f1},
+                                      &expr_merge, true));
+    std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+    for (auto batch : table_0) {
+      ASSERT_NOT_OK(expr_merge->evaluate(batch, &dummy_result_batches));
+    }
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> merge_result_iterator;
+    ASSERT_NOT_OK(expr_merge->finish(&merge_result_iterator));
+    for (int i = 0; i < 2; i++) {
+      std::shared_ptr<arrow::RecordBatch> expected_result;
+      MakeInputBatch(expected_result_strings[i], res_sch, &expected_result);
+      std::shared_ptr<arrow::RecordBatch> result_batch;
+      ASSERT_NOT_OK(
+          merge_result_iterator->Process(table_1[i]->columns(), &result_batch));
+      ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+    }
+  };
+
+  merge("sortMergeJoinInner",
+        {{"[1, 2, 2, 2]", "[10, 20, 21, 22]", "[1, 2, 2, 2]", "[1, 2, 2, 2]"},
+         {"[4, 4]", "[40, 40]", "[4, 4]", "[4, 41]"}});
+  merge("sortMergeJoinOuter",
+        {{"[null, 1, 2, 2, 2, null]", "[null, 10, 20, 21, 22, null]",
+          "[null, 1, 2, 2, 2, 3]", "[0, 1, 2, 2, 2, 3]"},
+         {"[4, 4, null, null]", "[40, 40, null, null]", "[4, 4, 5, 7]",
+          "[4, 41, 5, 7]"}});
+}
+
+TEST(TestArrowComputeJoin, JoinTestUsingInnerJoinWithHotKey) {
+  // keys with more than 2 build rows are hot
+  setenv("NATIVESQL_BATCH_SIZE", "2", 1);
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto table0_f0 = field("table0_f0", int32());
+  auto table0_f1 = field("table0_f1", int32());
+  auto table1_f0 = field("table1_f0", int32());
+  auto table1_f1 = field("table1_f1", int32());
+
+  auto n_left = TreeExprBuilder::MakeFunction(
+      "codegen_left_schema",
+      {TreeExprBuilder::MakeField(table0_f0), TreeExprBuilder::MakeField(table0_f1)},
+      int32());
+  auto n_right = TreeExprBuilder::MakeFunction(
+      "codegen_right_schema",
+      {TreeExprBuilder::MakeField(table1_f0), TreeExprBuilder::MakeField(table1_f1)},
+      int32());
+  auto f_res = field("res", int32());
+
+  auto n_left_key = TreeExprBuilder::MakeFunction(
+      "codegen_left_key_schema", {TreeExprBuilder::MakeField(table0_f0)}, int32());
+  auto n_right_key = TreeExprBuilder::MakeFunction(
+      "codegen_right_key_schema", {TreeExprBuilder::MakeField(table1_f0)}, int32());
+  auto n_probeArrays = TreeExprBuilder::MakeFunction("conditionedProbeArraysInner",
+                                                     {n_left_key, n_right_key}, int32());
+  auto n_codegen_probe = TreeExprBuilder::MakeFunction(
+      "codegen_withTwoInputs", {n_probeArrays, n_left, n_right}, int32());
+  auto probeArrays_expr = TreeExprBuilder::MakeExpression(n_codegen_probe, f_res);
+
+  auto schema_table_0 = arrow::schema({table0_f0, table0_f1});
+  auto schema_table_1 = arrow::schema({table1_f0, table1_f1});
+  ///////////////////// Calculation //////////////////
+  std::shared_ptr<CodeGenerator> expr_probe;
+  ASSERT_NOT_OK(CreateCodeGenerator(schema_table_0, {probeArrays_expr},
+                                    {table0_f0, table0_f1, table1_f0, table1_f1},
+                                    &expr_probe, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> probe_result_iterator;
+
+  std::vector<std::string> input_data_string = {"[1, 1, 1, 1, 1, 2]",
+                                                "[0, 1, 2, 3, 4, 5]"};
+  MakeInputBatch(input_data_string, schema_table_0, &input_batch);
+  ASSERT_NOT_OK(expr_probe->evaluate(input_batch, &dummy_result_batches));
+  ASSERT_NOT_OK(expr_probe->finish(&probe_result_iterator));
+
+  std::vector<std::string> probe_data_string = {"[1, 2, 3, 1]", "[10, 20, 30, 40]"};
+  MakeInputBatch(probe_data_string, schema_table_1, &input_batch);
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+  ASSERT_NOT_OK(probe_result_iterator->Process(input_batch->columns(), &result_batch));
+  // only the match of the cold key 2
+  ASSERT_EQ(result_batch->num_rows(), 1);
+  auto probe_f1 = std::static_pointer_cast<arrow::Int32Array>(result_batch->column(3));
+  ASSERT_EQ(probe_f1->Value(0), 20);
+
+  // the 5 matches of each probe row of key 1, in chunks of a batch
+  int64_t num_rows = 0;
+  std::vector<int64_t> sums(4, 0);
+  while (true) {
+    ASSERT_NOT_OK(probe_result_iterator->ProcessRemaining(&result_batch));
+    if (result_batch == nullptr) {
+      break;
+    }
+    ASSERT_LE(result_batch->num_rows(), 2);
+    num_rows += result_batch->num_rows();
+    for (int i = 0; i < result_batch->num_columns(); i++) {
+      auto column = std::static_pointer_cast<arrow::Int32Array>(result_batch->column(i));
+      for (int64_t j = 0; j < column->length(); j++) {
+        sums[i] += column->Value(j);
+      }
+    }
+  }
+  unsetenv("NATIVESQL_BATCH_SIZE");
+  ASSERT_EQ(num_rows, 10);
+  ASSERT_EQ(sums, std::vector<int64_t>({10, 20, 10, 250}));
+}
+
+TEST(TestArrowComputeJoin, JoinTestUsingGraceInnerJoin) {
+  // spill from the first build batch on
+  setenv("NATIVESQL_JOIN_MEMORY_BUDGET", "1", 1);
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto table0_f0 = field("table0_f0", int32());
+  auto table0_f1 = field("table0_f1", int32());
+  auto table1_f0 = field("table1_f0", int32());
+  auto table1_f1 = field("table1_f1", int32());
+
+  auto n_left = TreeExprBuilder::MakeFunction(
+      "codegen_left_schema",
+      {TreeExprBuilder::MakeField(table0_f0), TreeExprBuilder::MakeField(table0_f1)},
+      int32());
+  auto n_right = TreeExprBuilder::MakeFunction(
+      "codegen_right_schema",
+      {TreeExprBuilder::MakeField(table1_f0), TreeExprBuilder::MakeField(table1_f1)},
+      int32());
+  auto f_res = field("res", int32());
+
+  auto n_left_key = TreeExprBuilder::MakeFunction(
+      "codegen_left_key_schema", {TreeExprBuilder::MakeField(table0_f0)}, int32());
+  auto n_right_key = TreeExprBuilder::MakeFunction(
+      "codegen_right_key_schema", {TreeExprBuilder::MakeField(table1_f0)}, int32());
+  auto n_probeArrays = TreeExprBuilder::MakeFunction("conditionedProbeArraysInner",
+                                                     {n_left_key, n_right_key}, int32());
+  auto n_codegen_probe = TreeExprBuilder::MakeFunction(
+      "codegen_withTwoInputs", {n_probeArrays, n_left, n_right}, int32());
+  auto probeArrays_expr = TreeExprBuilder::MakeExpression(n_codegen_probe, f_res);
+
+  auto schema_table_0 = arrow::schema({table0_f0, table0_f1});
+  auto schema_table_1 = arrow::schema({table1_f0, table1_f1});
+  ///////////////////// Calculation //////////////////
+  std::shared_ptr<CodeGenerator> expr_probe;
+  ASSERT_NOT_OK(CreateCodeGenerator(schema_table_0, {probeArrays_expr},
+                                    {table0_f0, table0_f1, table1_f0, table1_f1},
+                                    &expr_probe, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> probe_result_iterator;
+
+  std::vector<std::string> input_data_string = {"[10, 3, 1, 2, 3, 1]",
+                                                "[10, 3, 1, 2, 13, 11]"};
+  MakeInputBatch(input_data_string, schema_table_0, &input_batch);
+  ASSERT_NOT_OK(expr_probe->evaluate(input_batch, &dummy_result_batches));
+  input_data_string = {"[6, 12, 5, 8, 6, 10]", "[6, 12, 5, 8, 16, 110]"};
+  MakeInputBatch(input_data_string, schema_table_0, &input_batch);
+  ASSERT_NOT_OK(expr_probe->evaluate(input_batch, &dummy_result_batches));
+  ASSERT_NOT_OK(expr_probe->finish(&probe_result_iterator));
+
+  std::vector<std::vector<std::string>> probe_data_string = {
+      {"[1, 2, 3, 4, 5, 6]", "[1, 2, 3, 4, 5, 6]"},
+      {"[7, 8, 9, 10, 11, 12]", "[7, 8, 9, 10, 11, 12]"}};
+  for (const auto& data : probe_data_string) {
+    MakeInputBatch(data, schema_table_1, &input_batch);
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_NOT_OK(probe_result_iterator->Process(input_batch->columns(), &result_batch));
+    // joined once the probe side is over
+    ASSERT_EQ(result_batch->num_rows(), 0);
+  }
+
+  // the partitions are joined in partition order, compare the sums of the columns
+  int64_t num_rows = 0;
+  std::vector<int64_t> sums(4, 0);
+  while (probe_result_iterator->HasNext()) {
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_NOT_OK(probe_result_iterator->Next(&result_batch));
+    num_rows += result_batch->num_rows();
+    for (int i = 0; i < result_batch->num_columns(); i++) {
+      auto column = std::static_pointer_cast<arrow::Int32Array>(result_batch->column(i));
+      for (int64_t j = 0; j < column->length(); j++) {
+        sums[i] += column->Value(j);
+      }
+    }
+  }
+  unsetenv("NATIVESQL_JOIN_MEMORY_BUDGET");
+  ASSERT_EQ(num_rows, 12);
+  ASSERT_EQ(sums, std::vector<int64_t>({67, 197, 67, 67}));
+}
+
 }  // namespace codegen
 }  // namespace sparkcolumnarplugin
@@ -20,9 +20,17 @@
 #include <arrow/record_batch.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
 
 #include "codegen/code_generator.h"
+#include "codegen/arrow_compute/ext/key_prefix.h"
+#include "codegen/arrow_compute/ext/loser_tree.h"
+#include "codegen/arrow_compute/ext/parallel_sort.h"
 #include "codegen/code_generator_factory.h"
 #include "tests/test_utils.h"
 
@@ -409,5 +417,447 @@ TEST(TestArrowComputeSort, SortTestNullsFirstAscMultipleKeys) {
   }
 }
 
+TEST(TestArrowComputeSort, SortTestExternalNullsFirstAsc) {
+  // spill every batch as a sorted run
+  setenv("NATIVESQL_SORT_MEMORY_BUDGET", "1", 1);
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", uint32());
+  auto f1 = field("f1", uint32());
+  auto arg_0 = TreeExprBuilder::MakeField(f0);
+  auto arg_1 = TreeExprBuilder::MakeField(f1);
+  auto f_res = field("res", uint32());
+  auto indices_type = std::make_shared<FixedSizeBinaryType>(16);
+  auto f_indices = field("indices", indices_type);
+
+  auto n_sort_to_indices = TreeExprBuilder::MakeFunction(
+      "sortArraysToIndicesNullsFirstAsc", {arg_0}, uint32());
+  auto sortArrays_expr = TreeExprBuilder::MakeExpression(n_sort_to_indices, f_res);
+
+  auto sch = arrow::schema({f0, f1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f0, f1};
+  ///////////////////// Calculation //////////////////
+  std::shared_ptr<CodeGenerator> sort_expr;
+  ASSERT_NOT_OK(
+      CreateCodeGenerator(sch, {sortArrays_expr}, {f_indices}, &sort_expr, true));
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> input_batch_list;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> sort_result_iterator;
+
+  std::vector<std::string> input_data_string = {"[10, 12, 4, 50, 52, 32, 11]",
+                                                "[11, 13, 5, 51, null, 33, 12]"};
+  MakeInputBatch(input_data_string, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  std::vector<std::string> input_data_string_2 = {"[1, 14, 43, 42, 6, null, 2]",
+                                                  "[2, null, 44, 43, 7, 34, 3]"};
+  MakeInputBatch(input_data_string_2, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  std::vector<std::string> input_data_string_3 = {"[3, 64, 15, 7, 9, 19, 33]",
+                                                  "[4, 65, 16, 8, 10, 20, 34]"};
+  MakeInputBatch(input_data_string_3, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  std::vector<std::string> input_data_string_4 = {"[23, 17, 41, 18, 20, 35, 30]",
+                                                  "[24, 18, 42, 19, 21, 36, 31]"};
+  MakeInputBatch(input_data_string_4, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  std::vector<std::string> input_data_string_5 = {"[37, null, 22, 13, 8, 59, 21]",
+                                                  "[38, 67, 23, 14, 9, 60, 22]"};
+  MakeInputBatch(input_data_string_5, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  ////////////////////////////////// calculation ///////////////////////////////////
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  std::vector<std::string> expected_result_string = {
+      "[null, null, 1, 2, 3, 4, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 17, 18, 19, 20, 21, "
+      "22, 23, 30, "
+      "32, 33, 35, 37, 41, 42, 43, 50, 52, 59, 64]",
+      "[34, 67, 2, 3, 4, 5, 7, 8, 9, 10, 11, 12, 13, 14, null, 16, 18, 19, 20, 21, 22, "
+      "23, 24, "
+      "31, 33, 34, 36, 38, 42, 43, 44, 51, null, 60, 65]"};
+  MakeInputBatch(expected_result_string, sch, &expected_result);
+
+  for (auto batch : input_batch_list) {
+    ASSERT_NOT_OK(sort_expr->evaluate(batch, &dummy_result_batches));
+  }
+  ASSERT_NOT_OK(sort_expr->finish(&sort_result_iterator));
+
+  std::shared_ptr<arrow::RecordBatch> dummy_result_batch;
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+
+  unsetenv("NATIVESQL_SORT_MEMORY_BUDGET");
+
+  // the runs are merged in one batch
+  ASSERT_TRUE(sort_result_iterator->HasNext());
+  ASSERT_NOT_OK(sort_result_iterator->Next(&result_batch));
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+  ASSERT_FALSE(sort_result_iterator->HasNext());
+}
+
+TEST(TestArrowComputeSort, SortTestCompactCache) {
+  // the payload columns are cached as offsets of 1 and 2 bytes, or as they are
+  setenv("NATIVESQL_CACHE_FORMAT", "compact", 1);
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", uint32());
+  auto f1 = field("f1", int64());
+  auto f2 = field("f2", int32());
+  auto arg_0 = TreeExprBuilder::MakeField(f0);
+  auto f_res = field("res", uint32());
+  auto indices_type = std::make_shared<FixedSizeBinaryType>(16);
+  auto f_indices = field("indices", indices_type);
+
+  auto n_sort_to_indices = TreeExprBuilder::MakeFunction(
+      "sortArraysToIndicesNullsFirstAsc", {arg_0}, uint32());
+  auto sortArrays_expr = TreeExprBuilder::MakeExpression(n_sort_to_indices, f_res);
+
+  auto sch = arrow::schema({f0, f1, f2});
+  ///////////////////// Calculation //////////////////
+  std::shared_ptr<CodeGenerator> sort_expr;
+  ASSERT_NOT_OK(
+      CreateCodeGenerator(sch, {sortArrays_expr}, {f_indices}, &sort_expr, true));
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> input_batch_list;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> sort_result_iterator;
+
+  std::vector<std::string> input_data_string = {
+      "[3, 1, 2]", "[5000000000, null, 5000000200]", "[-30000, 7, 20000]"};
+  MakeInputBatch(input_data_string, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  std::vector<std::string> input_data_string_2 = {
+      "[null, 5, 4]", "[-9000000000000, 9000000000000, 1]", "[0, null, -1]"};
+  MakeInputBatch(input_data_string_2, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  ////////////////////////////////// calculation ///////////////////////////////////
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  std::vector<std::string> expected_result_string = {
+      "[null, 1, 2, 3, 4, 5]",
+      "[-9000000000000, null, 5000000200, 5000000000, 1, 9000000000000]",
+      "[0, 7, 20000, -30000, -1, null]"};
+  MakeInputBatch(expected_result_string, sch, &expected_result);
+
+  for (auto batch : input_batch_list) {
+    ASSERT_NOT_OK(sort_expr->evaluate(batch, &dummy_result_batches));
+  }
+  ASSERT_NOT_OK(sort_expr->finish(&sort_result_iterator));
+  unsetenv("NATIVESQL_CACHE_FORMAT");
+
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+  ASSERT_TRUE(sort_result_iterator->HasNext());
+  ASSERT_NOT_OK(sort_result_iterator->Next(&result_batch));
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+}
+
+TEST(TestArrowComputeSort, SortTestPrecompiledNullsLastDescMultipleKeys) {
+  // keys of int32 and int64 take the precompiled sorter, sorting in memory then as
+  // merged runs
+  for (bool spill : {false, true}) {
+    if (spill) {
+      setenv("NATIVESQL_SORT_MEMORY_BUDGET", "1", 1);
+    }
+    auto f0 = field("f0", int32());
+    auto f1 = field("f1", int64());
+    auto f2 = field("f2", utf8());
+    auto arg_0 = TreeExprBuilder::MakeField(f0);
+    auto arg_1 = TreeExprBuilder::MakeField(f1);
+    auto f_res = field("res", uint32());
+    auto indices_type = std::make_shared<FixedSizeBinaryType>(16);
+    auto f_indices = field("indices", indices_type);
+
+    auto n_sort_to_indices = TreeExprBuilder::MakeFunction(
+        "sortArraysToIndicesNullsLastDesc", {arg_0, arg_1}, uint32());
+    auto sortArrays_expr = TreeExprBuilder::MakeExpression(n_sort_to_indices, f_res);
+
+    auto sch = arrow::schema({f0, f1, f2});
+    std::shared_ptr<CodeGenerator> sort_expr;
+    ASSERT_NOT_OK(
+        CreateCodeGenerator(sch, {sortArrays_expr}, {f_indices}, &sort_expr, true));
+
+    std::vector<std::vector<std::string>> input_data_strings = {
+        {"[3, null, 1, 3]", "[10, 5, 7, 20]", R"(["c10", "n5", "a7", "c20"])"},
+        {"[2, 3, null, 1]", "[4, 15, 6, 8]", R"(["b4", "c15", "n6", "a8"])"}};
+    std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+    for (const auto& input_data_string : input_data_strings) {
+      std::shared_ptr<arrow::RecordBatch> input_batch;
+      MakeInputBatch(input_data_string, sch, &input_batch);
+      ASSERT_NOT_OK(sort_expr->evaluate(input_batch, &dummy_result_batches));
+    }
+    std::shared_ptr<ResultIterator<arrow::RecordBatch>> sort_result_iterator;
+    ASSERT_NOT_OK(sort_expr->finish(&sort_result_iterator));
+    unsetenv("NATIVESQL_SORT_MEMORY_BUDGET");
+
+    std::shared_ptr<arrow::RecordBatch> expected_result;
+    std::vector<std::string> expected_result_string = {
+        "[3, 3, 3, 2, 1, 1, null, null]", "[20, 15, 10, 4, 8, 7, 5, 6]",
+        R"(["c20", "c15", "c10", "b4", "a8", "a7", "n5", "n6"])"};
+    MakeInputBatch(expected_result_string, sch, &expected_result);
+
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_TRUE(sort_result_iterator->HasNext());
+    ASSERT_NOT_OK(sort_result_iterator->Next(&result_batch));
+    ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+    ASSERT_FALSE(sort_result_iterator->HasNext());
+  }
+}
+
+TEST(TestArrowComputeSort, SortTestTopKNullsFirstAsc) {
+  // small batches, so that the top rows are kept from the second batch on
+  setenv("NATIVESQL_BATCH_SIZE", "4", 1);
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", uint32());
+  auto f1 = field("f1", uint32());
+  auto arg_0 = TreeExprBuilder::MakeField(f0);
+  auto arg_1 = TreeExprBuilder::MakeField(f1);
+  auto f_res = field("res", uint32());
+  auto indices_type = std::make_shared<FixedSizeBinaryType>(16);
+  auto f_indices = field("indices", indices_type);
+
+  auto n_sort_to_indices = TreeExprBuilder::MakeFunction(
+      "sortArraysToIndicesTopKNullsFirstAsc_5", {arg_0}, uint32());
+  auto sortArrays_expr = TreeExprBuilder::MakeExpression(n_sort_to_indices, f_res);
+
+  auto sch = arrow::schema({f0, f1});
+  std::vector<std::shared_ptr<Field>> ret_types = {f0, f1};
+  ///////////////////// Calculation //////////////////
+  std::shared_ptr<CodeGenerator> sort_expr;
+  ASSERT_NOT_OK(
+      CreateCodeGenerator(sch, {sortArrays_expr}, {f_indices}, &sort_expr, true));
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> input_batch_list;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> dummy_result_batches;
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> sort_result_iterator;
+
+  std::vector<std::string> input_data_string = {"[10, 12, 4, 50, 52, 32, 11]",
+                                                "[11, 13, 5, 51, null, 33, 12]"};
+  MakeInputBatch(input_data_string, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  std::vector<std::string> input_data_string_2 = {"[1, 14, 43, 42, 6, null, 2]",
+                                                  "[2, null, 44, 43, 7, 34, 3]"};
+  MakeInputBatch(input_data_string_2, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  std::vector<std::string> input_data_string_3 = {"[3, 64, 15, 7, 9, 19, 33]",
+                                                  "[4, 65, 16, 8, 10, 20, 34]"};
+  MakeInputBatch(input_data_string_3, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  std::vector<std::string> input_data_string_4 = {"[23, 17, 41, 18, 20, 35, 30]",
+                                                  "[24, 18, 42, 19, 21, 36, 31]"};
+  MakeInputBatch(input_data_string_4, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  std::vector<std::string> input_data_string_5 = {"[37, null, 22, 13, 8, 59, 21]",
+                                                  "[38, 67, 23, 14, 9, 60, 22]"};
+  MakeInputBatch(input_data_string_5, sch, &input_batch);
+  input_batch_list.push_back(input_batch);
+
+  for (auto batch : input_batch_list) {
+    ASSERT_NOT_OK(sort_expr->evaluate(batch, &dummy_result_batches));
+  }
+  ASSERT_NOT_OK(sort_expr->finish(&sort_result_iterator));
+
+  unsetenv("NATIVESQL_BATCH_SIZE");
+
+  std::vector<std::string> values;
+  while (sort_result_iterator->HasNext()) {
+    std::shared_ptr<arrow::RecordBatch> result_batch;
+    ASSERT_NOT_OK(sort_result_iterator->Next(&result_batch));
+    auto f0_array = std::static_pointer_cast<arrow::UInt32Array>(result_batch->column(0));
+    auto f1_array = std::static_pointer_cast<arrow::UInt32Array>(result_batch->column(1));
+    for (int64_t i = 0; i < result_batch->num_rows(); i++) {
+      values.push_back(
+          (f0_array->IsNull(i) ? "null" : std::to_string(f0_array->Value(i))) + ":" +
+          std::to_string(f1_array->Value(i)));
+    }
+  }
+  ASSERT_EQ(values,
+            std::vector<std::string>({"null:34", "null:67", "1:2", "2:3", "3:4"}));
+}
+
+TEST(TestArrowComputeSort, SortLoserTree) {
+  std::vector<std::vector<int>> runs = {{1, 4, 9}, {}, {2, 3, 10, 11}, {4, 5}, {0}};
+  std::vector<size_t> pos(runs.size(), 0);
+  // exhausted runs last, ties in run order
+  auto less = [&](int32_t a, int32_t b) {
+    bool a_done = pos[a] == runs[a].size();
+    bool b_done = pos[b] == runs[b].size();
+    if (a_done || b_done) {
+      return a_done == b_done ? a < b : b_done;
+    }
+    if (runs[a][pos[a]] != runs[b][pos[b]]) {
+      return runs[a][pos[a]] < runs[b][pos[b]];
+    }
+    return a < b;
+  };
+  arrowcompute::extra::LoserTree<decltype(less)> tree(runs.size(), less);
+  tree.Build();
+  std::vector<int> merged;
+  std::vector<int32_t> merged_runs;
+  while (pos[tree.Winner()] < runs[tree.Winner()].size()) {
+    auto winner = tree.Winner();
+    merged.push_back(runs[winner][pos[winner]++]);
+    merged_runs.push_back(winner);
+    tree.Replay(winner);
+  }
+  ASSERT_EQ(merged, std::vector<int>({0, 1, 2, 3, 4, 4, 5, 9, 10, 11}));
+  ASSERT_EQ(merged_runs[4], 0);
+  ASSERT_EQ(merged_runs[5], 3);
+}
+
+TEST(TestArrowComputeSort, SortByKeyPrefix) {
+  using arrowcompute::extra::NormalizeKeyPrefix;
+  ASSERT_LT(NormalizeKeyPrefix(int32_t{-3}), NormalizeKeyPrefix(int32_t{2}));
+  ASSERT_LT(NormalizeKeyPrefix(-1.5), NormalizeKeyPrefix(-0.5));
+  ASSERT_LT(NormalizeKeyPrefix(-0.5f), NormalizeKeyPrefix(0.25));
+  ASSERT_LT(NormalizeKeyPrefix(arrow::util::string_view("ab")),
+            NormalizeKeyPrefix(arrow::util::string_view("b")));
+  // only the first 8 bytes make the prefix
+  ASSERT_EQ(NormalizeKeyPrefix(arrow::util::string_view("abcdefgh1")),
+            NormalizeKeyPrefix(arrow::util::string_view("abcdefgh2")));
+
+  std::vector<std::string> first = {"abcdefgh2", "b", "abcdefgh1", "", "abcdefgh1", "a"};
+  std::vector<int64_t> second = {0, 1, 5, 3, 4, 5};
+  std::vector<int> indices = {0, 1, 2, 3, 4, 5};
+  // descending on both keys
+  auto comp = [&](int x, int y) {
+    if (first[x] == first[y]) {
+      return second[x] > second[y];
+    }
+    return first[x] > first[y];
+  };
+  arrowcompute::extra::SortByKeyPrefix(
+      indices.data(), indices.data() + indices.size(),
+      [&](int x) { return ~NormalizeKeyPrefix(arrow::util::string_view(first[x])); },
+      comp);
+  ASSERT_EQ(indices, std::vector<int>({1, 0, 2, 4, 5, 3}));
+}
+
+TEST(TestArrowComputeSort, SortByStringPrefix) {
+  using arrowcompute::extra::NormalizeKeyPrefix;
+  ASSERT_EQ(NormalizeKeyPrefix(arrow::util::string_view("abcdefgh1"), 8),
+            NormalizeKeyPrefix(arrow::util::string_view("1")));
+  ASSERT_EQ(NormalizeKeyPrefix(arrow::util::string_view("abc"), 8), uint64_t{0});
+
+  // enough rows sharing their first 16 bytes to refine the prefixes twice
+  std::vector<std::string> urls;
+  for (int i = 0; i < 100; ++i) {
+    urls.push_back("https://host.com/" + std::to_string((i * 37) % 100));
+  }
+  std::vector<int> indices(urls.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  auto comp = [&](int x, int y) { return urls[x] < urls[y]; };
+  arrowcompute::extra::SortByStringPrefix(
+      indices.data(), indices.data() + indices.size(),
+      [&](int x, size_t offset) {
+        return NormalizeKeyPrefix(arrow::util::string_view(urls[x]), offset);
+      },
+      comp);
+  ASSERT_TRUE(std::is_sorted(indices.begin(), indices.end(), comp));
+  ASSERT_EQ(urls[indices.front()], "https://host.com/0");
+  ASSERT_EQ(urls[indices.back()], "https://host.com/99");
+}
+
+TEST(TestArrowComputeSort, SortParallel) {
+  // enough rows for 3 chunks, whose merges don't pair up evenly
+  std::vector<int64_t> values(3 * (1 << 15) + 7);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<int64_t>((i * 7919) % 1000);
+  }
+  auto comp = [](int64_t x, int64_t y) { return x > y; };
+  arrowcompute::extra::ParallelSort(
+      values.data(), values.data() + values.size(), 3,
+      [&comp](int64_t* begin, int64_t* end) { std::sort(begin, end, comp); }, comp);
+  ASSERT_TRUE(std::is_sorted(values.begin(), values.end(), comp));
+  ASSERT_EQ(values.front(), 999);
+  ASSERT_EQ(values.back(), 0);
+}
+
+TEST(TestArrowComputeSort, WindowTestRankAndRunningSum) {
+  ////////////////////// prepare expr_vector ///////////////////////
+  auto f0 = field("f0", int32());
+  auto f1 = field("f1", int32());
+  auto f2 = field("f2", int32());
+  auto f_row_number = field("row_number", int32());
+  auto f_rank = field("rank", int32());
+  auto f_dense_rank = field("dense_rank", int32());
+  auto f_sum = field("sum", int64());
+  auto f_res = field("res", uint32());
+
+  auto arg0 = TreeExprBuilder::MakeField(f0);
+  auto arg1 = TreeExprBuilder::MakeField(f1);
+  auto arg2 = TreeExprBuilder::MakeField(f2);
+  auto n_partitionby =
+      TreeExprBuilder::MakeFunction("action_partitionby", {arg0}, int32());
+  auto n_orderby = TreeExprBuilder::MakeFunction("action_orderby", {arg1}, int32());
+  auto n_row_number = TreeExprBuilder::MakeFunction("window_row_number", {}, int32());
+  auto n_rank = TreeExprBuilder::MakeFunction("window_rank", {}, int32());
+  auto n_dense_rank = TreeExprBuilder::MakeFunction("window_dense_rank", {}, int32());
+  auto n_sum = TreeExprBuilder::MakeFunction("action_sum", {arg2}, int64());
+  auto n_schema = TreeExprBuilder::MakeFunction(
+      "codegen_schema",
+      {TreeExprBuilder::MakeField(f0), TreeExprBuilder::MakeField(f1),
+       TreeExprBuilder::MakeField(f2)},
+      uint32());
+  auto n_window = TreeExprBuilder::MakeFunction(
+      "windowArrays",
+      {n_partitionby, n_orderby, n_row_number, n_rank, n_dense_rank, n_sum}, uint32());
+  auto n_codegen_window = TreeExprBuilder::MakeFunction(
+      "codegen_withOneInput", {n_window, n_schema}, uint32());
+
+  auto window_expr = TreeExprBuilder::MakeExpression(n_codegen_window, f_res);
+
+  auto sch = arrow::schema({f0, f1, f2});
+  auto res_sch = arrow::schema({f0, f1, f2, f_row_number, f_rank, f_dense_rank, f_sum});
+
+  /////////////////////// Create Expression Evaluator ////////////////////
+  std::shared_ptr<CodeGenerator> expr;
+  ASSERT_NOT_OK(CreateCodeGenerator(sch, {window_expr}, res_sch->fields(), &expr, true));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> output_batch_list;
+
+  ////////////////////// calculation /////////////////////
+  // sorted by partition then order keys, the rows of 2, 5 wait for the next batch as
+  // it may have more of them
+  MakeInputBatch({"[1, 1, 1, 2, 2]", "[10, 10, 20, 5, 5]", "[1, 2, 3, 4, 5]"}, sch,
+                 &input_batch);
+  ASSERT_NOT_OK(expr->evaluate(input_batch, &output_batch_list));
+
+  std::shared_ptr<ResultIterator<arrow::RecordBatch>> window_result_iterator;
+  ASSERT_NOT_OK(expr->finish(&window_result_iterator));
+  std::shared_ptr<arrow::RecordBatch> result_batch;
+  std::shared_ptr<arrow::RecordBatch> expected_result;
+  ASSERT_TRUE(window_result_iterator->HasNext());
+  ASSERT_NOT_OK(window_result_iterator->Next(&result_batch));
+  MakeInputBatch({"[1, 1, 1]", "[10, 10, 20]", "[1, 2, 3]", "[1, 2, 3]", "[1, 1, 3]",
+                  "[1, 1, 2]", "[3, 3, 6]"},
+                 res_sch, &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+
+  // the next batches stream through the iterator
+  MakeInputBatch({"[2, 2, 3]", "[5, 7, 1]", "[6, 7, 8]"}, sch, &input_batch);
+  ASSERT_NOT_OK(window_result_iterator->Process(input_batch->columns(), &result_batch));
+  MakeInputBatch({"[2, 2, 2, 2]", "[5, 5, 5, 7]", "[4, 5, 6, 7]", "[1, 2, 3, 4]",
+                  "[1, 1, 1, 4]", "[1, 1, 1, 2]", "[15, 15, 15, 22]"},
+                 res_sch, &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+
+  // the rows left are output once the input is over
+  ASSERT_TRUE(window_result_iterator->HasNext());
+  ASSERT_NOT_OK(window_result_iterator->Next(&result_batch));
+  MakeInputBatch({"[3]", "[1]", "[8]", "[1]", "[1]", "[1]", "[8]"}, res_sch,
+                 &expected_result);
+  ASSERT_NOT_OK(Equals(*expected_result.get(), *result_batch.get()));
+  ASSERT_FALSE(window_result_iterator->HasNext());
+}
+
 }  // namespace codegen
 }  // namespace sparkcolumnarplugin
@@ -0,0 +1,197 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/memory_pool.h>
+#include <arrow/status.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "tests/test_utils.h"
+#include "utils/arena_memory_pool.h"
+#include "utils/large_page_memory_pool.h"
+#ifdef NATIVESQL_PMEM_SPILL
+#include "utils/pmem_memory_pool.h"
+#endif
+#include "utils/task_memory_pool.h"
+
+namespace sparkcolumnarplugin {
+
+class TestListener : public ReservationListener {
+ public:
+  explicit TestListener(int64_t limit) : limit_(limit) {}
+
+  arrow::Status Reserve(int64_t bytes) override {
+    if (reserved_ + bytes > limit_) {
+      return arrow::Status::OutOfMemory("over the limit");
+    }
+    reserved_ += bytes;
+    calls_++;
+    return arrow::Status::OK();
+  }
+
+  void Unreserve(int64_t bytes) override { reserved_ -= bytes; }
+
+  int64_t limit_;
+  int64_t reserved_ = 0;
+  int calls_ = 0;
+};
+
+TEST(TestTaskMemoryPool, ReserveByChunks) {
+  auto listener = std::make_shared<TestListener>(1 << 20);
+  uint8_t* first;
+  uint8_t* second;
+  {
+    TaskMemoryPool pool(arrow::default_memory_pool(), listener, 1024);
+    ASSERT_NOT_OK(pool.Allocate(100, &first));
+    ASSERT_NOT_OK(pool.Allocate(900, &second));
+    ASSERT_EQ(listener->calls_, 1);
+    ASSERT_EQ(listener->reserved_, 1024);
+    ASSERT_EQ(pool.bytes_allocated(), 1000);
+
+    ASSERT_NOT_OK(pool.Reallocate(900, 3000, &second));
+    ASSERT_EQ(listener->reserved_, 4096);
+    pool.Free(second, 3000);
+    // a chunk more than used is kept
+    ASSERT_EQ(listener->reserved_, 2048);
+    pool.Free(first, 100);
+    ASSERT_EQ(pool.bytes_allocated(), 0);
+    ASSERT_EQ(pool.max_memory(), 3100);
+  }
+  ASSERT_EQ(listener->reserved_, 0);
+}
+
+TEST(TestTaskMemoryPool, SpillWhenDenied) {
+  auto listener = std::make_shared<TestListener>(2048);
+  TaskMemoryPool pool(arrow::default_memory_pool(), listener, 1024);
+  uint8_t* held;
+  ASSERT_NOT_OK(pool.Allocate(2000, &held));
+
+  int spills = 0;
+  auto id = pool.AddSpiller([&](int64_t bytes) {
+    spills++;
+    if (held == nullptr) {
+      return int64_t(0);
+    }
+    pool.Free(held, 2000);
+    held = nullptr;
+    return int64_t(2000);
+  });
+  uint8_t* out;
+  ASSERT_NOT_OK(pool.Allocate(1500, &out));
+  ASSERT_EQ(spills, 1);
+  ASSERT_EQ(pool.bytes_allocated(), 1500);
+
+  // nothing left to spill
+  auto status = pool.Allocate(1500, &held);
+  ASSERT_TRUE(status.IsOutOfMemory());
+  ASSERT_EQ(spills, 2);
+  ASSERT_EQ(pool.bytes_allocated(), 1500);
+
+  pool.RemoveSpiller(id);
+  pool.Free(out, 1500);
+}
+
+TEST(TestArenaMemoryPool, ReuseBlocksAfterReset) {
+  arrow::ProxyMemoryPool parent(arrow::default_memory_pool());
+  ArenaMemoryPool arena(&parent, 4096);
+  uint8_t* first;
+  uint8_t* second;
+  ASSERT_NOT_OK(arena.Allocate(100, &first));
+  ASSERT_NOT_OK(arena.Allocate(100, &second));
+  ASSERT_EQ(second - first, 128);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(second) % 64, 0);
+  // the last allocation grows in place
+  ASSERT_NOT_OK(arena.Reallocate(100, 1000, &second));
+  ASSERT_EQ(second - first, 128);
+  ASSERT_FALSE(arena.Reset());
+
+  uint8_t* large;
+  ASSERT_NOT_OK(arena.Allocate(10000, &large));
+  ASSERT_EQ(parent.bytes_allocated(), 4096 + 10048);
+  arena.Free(first, 100);
+  arena.Free(second, 1000);
+  arena.Free(large, 10000);
+  ASSERT_EQ(arena.bytes_allocated(), 0);
+  ASSERT_TRUE(arena.Reset());
+  // merged into one block
+  ASSERT_EQ(parent.bytes_allocated(), 4096 + 10048);
+
+  uint8_t* again;
+  ASSERT_NOT_OK(arena.Allocate(12000, &again));
+  ASSERT_EQ(parent.bytes_allocated(), 4096 + 10048);
+  arena.Free(again, 12000);
+}
+
+TEST(TestLargePageMemoryPool, MapLargeAllocations) {
+  arrow::MemoryPool* parent = arrow::default_memory_pool();
+  auto parent_bytes = parent->bytes_allocated();
+  LargePageMemoryPool pool(parent, 1 << 20, false, true);
+
+  uint8_t* small;
+  ASSERT_NOT_OK(pool.Allocate(1000, &small));
+  ASSERT_EQ(pool.large_bytes_allocated(), 0);
+  ASSERT_EQ(parent->bytes_allocated(), parent_bytes + 1000);
+  memset(small, 1, 1000);
+
+  // growing past the threshold moves it to large pages, aligned to them
+  ASSERT_NOT_OK(pool.Reallocate(1000, 3 << 20, &small));
+  ASSERT_EQ(small[999], 1);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(small) % LargePageMemoryPool::kLargePageSize, 0);
+  ASSERT_EQ(pool.large_bytes_allocated(), 3 << 20);
+  ASSERT_EQ(parent->bytes_allocated(), parent_bytes);
+  memset(small, 2, 3 << 20);
+
+  ASSERT_NOT_OK(pool.Reallocate(3 << 20, 5 << 20, &small));
+  ASSERT_EQ(small[(3 << 20) - 1], 2);
+  ASSERT_EQ(pool.bytes_allocated(), parent_bytes + (5 << 20));
+
+  ASSERT_NOT_OK(pool.Reallocate(5 << 20, 100, &small));
+  ASSERT_EQ(small[99], 2);
+  ASSERT_EQ(pool.large_bytes_allocated(), 0);
+  pool.Free(small, 100);
+  ASSERT_EQ(pool.bytes_allocated(), parent_bytes);
+}
+
+#ifdef NATIVESQL_PMEM_SPILL
+TEST(TestPmemMemoryPool, AllocateUpToCapacity) {
+  // a kind in a temporary file of any file system works, if not on PMem
+  auto made = PmemMemoryPool::Make("/tmp", 1 << 20);
+  ASSERT_NOT_OK(made.status());
+  auto pool = std::move(made).ValueOrDie();
+
+  uint8_t* first;
+  ASSERT_NOT_OK(pool->Allocate(600 << 10, &first));
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(first) % 64, 0);
+  memset(first, 1, 600 << 10);
+  uint8_t* second;
+  ASSERT_TRUE(pool->Allocate(600 << 10, &second).IsOutOfMemory());
+  ASSERT_EQ(pool->bytes_allocated(), 600 << 10);
+
+  ASSERT_NOT_OK(pool->Reallocate(600 << 10, 100, &first));
+  ASSERT_EQ(first[99], 1);
+  ASSERT_NOT_OK(pool->Allocate(600 << 10, &second));
+  pool->Free(first, 100);
+  pool->Free(second, 600 << 10);
+  ASSERT_EQ(pool->bytes_allocated(), 0);
+  ASSERT_EQ(pool->max_memory(), (600 << 10) + 100);
+}
+#endif
+
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,147 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/array.h>
+#include <arrow/memory_pool.h>
+#include <arrow/record_batch.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "operators/row_converter.h"
+#include "tests/test_utils.h"
+
+namespace sparkcolumnarplugin {
+namespace operators {
+
+// addresses and sizes of the rows, as passed through JNI
+void GetRows(const UnsafeRows& rows, std::vector<int64_t>* addresses,
+             std::vector<int32_t>* sizes) {
+  for (size_t i = 0; i + 1 < rows.offsets.size(); ++i) {
+    addresses->push_back(
+        reinterpret_cast<int64_t>(rows.buffer->data() + rows.offsets[i]));
+    sizes->push_back(static_cast<int32_t>(rows.offsets[i + 1] - rows.offsets[i]));
+  }
+}
+
+TEST(TestRowConverter, Layout) {
+  auto schema = arrow::schema(
+      {arrow::field("a", arrow::int32()), arrow::field("s", arrow::utf8())});
+  std::shared_ptr<arrow::RecordBatch> batch;
+  MakeInputBatch({"[7, null]", R"(["spark", "x"])"}, schema, &batch);
+  std::shared_ptr<RowConverter> converter;
+  ARROW_ASSIGN_OR_THROW(converter,
+                        RowConverter::Make(schema, arrow::default_memory_pool()));
+  UnsafeRows rows;
+  ARROW_ASSIGN_OR_THROW(rows, converter->ToRows(*batch));
+
+  // a bitset word and two slots, then the string padded to 8 bytes
+  ASSERT_EQ(rows.offsets, std::vector<int64_t>({0, 32, 64}));
+  auto data = rows.buffer->data();
+  int64_t word;
+  memcpy(&word, data, 8);
+  ASSERT_EQ(word, 0);
+  memcpy(&word, data + 8, 8);
+  ASSERT_EQ(word, 7);
+  memcpy(&word, data + 16, 8);
+  ASSERT_EQ(word, (int64_t{24} << 32) | 5);
+  ASSERT_EQ(std::string(reinterpret_cast<const char*>(data + 24), 8),
+            std::string("spark\0\0\0", 8));
+
+  // a is null in the second row, its slot zeroed
+  memcpy(&word, data + 32, 8);
+  ASSERT_EQ(word, 1);
+  memcpy(&word, data + 40, 8);
+  ASSERT_EQ(word, 0);
+  memcpy(&word, data + 48, 8);
+  ASSERT_EQ(word, (int64_t{24} << 32) | 1);
+}
+
+TEST(TestRowConverter, RoundTrip) {
+  auto schema = arrow::schema({arrow::field("b", arrow::boolean()),
+                               arrow::field("i", arrow::int32()),
+                               arrow::field("l", arrow::int64()),
+                               arrow::field("d", arrow::float64()),
+                               arrow::field("date", arrow::date32()),
+                               arrow::field("s", arrow::utf8()),
+                               arrow::field("dec", arrow::decimal(10, 2))});
+  std::shared_ptr<arrow::RecordBatch> batch;
+  MakeInputBatch({"[true, false, null, true]", "[1, -2, 3, null]",
+                  "[10000000000, null, -3, 4]", "[1.5, null, -0.25, 4.0]",
+                  "[18000, 18001, null, 0]",
+                  R"(["", "a string longer than eight bytes", null, "12345678"])",
+                  R"(["1.25", "-3.50", null, "99999999.99"])"},
+                 schema, &batch);
+  std::shared_ptr<RowConverter> converter;
+  ARROW_ASSIGN_OR_THROW(converter,
+                        RowConverter::Make(schema, arrow::default_memory_pool()));
+  UnsafeRows rows;
+  ARROW_ASSIGN_OR_THROW(rows, converter->ToRows(*batch));
+
+  std::vector<int64_t> addresses;
+  std::vector<int32_t> sizes;
+  GetRows(rows, &addresses, &sizes);
+  std::shared_ptr<arrow::RecordBatch> result;
+  ARROW_ASSIGN_OR_THROW(result, converter->ToColumnar(batch->num_rows(), addresses.data(),
+                                                      sizes.data()));
+  ASSERT_NOT_OK(Equals(*batch, *result));
+
+  // a slice converts as the rows it has
+  auto slice = batch->Slice(1, 2);
+  UnsafeRows slice_rows;
+  ARROW_ASSIGN_OR_THROW(slice_rows, converter->ToRows(*slice));
+  addresses.clear();
+  sizes.clear();
+  GetRows(slice_rows, &addresses, &sizes);
+  ARROW_ASSIGN_OR_THROW(result, converter->ToColumnar(slice->num_rows(),
+                                                      addresses.data(), sizes.data()));
+  ASSERT_NOT_OK(Equals(*slice, *result));
+}
+
+TEST(TestRowConverter, Unsupported) {
+  auto schema = arrow::schema({arrow::field("l", arrow::list(arrow::int32()))});
+  ASSERT_TRUE(RowConverter::Make(schema, arrow::default_memory_pool())
+                  .status()
+                  .IsNotImplemented());
+  schema = arrow::schema({arrow::field("dec", arrow::decimal(38, 2))});
+  ASSERT_TRUE(RowConverter::Make(schema, arrow::default_memory_pool())
+                  .status()
+                  .IsNotImplemented());
+}
+
+TEST(TestRowConverter, TruncatedRow) {
+  auto schema = arrow::schema({arrow::field("s", arrow::utf8())});
+  std::shared_ptr<arrow::RecordBatch> batch;
+  MakeInputBatch({R"(["a string longer than eight bytes"])"}, schema, &batch);
+  std::shared_ptr<RowConverter> converter;
+  ARROW_ASSIGN_OR_THROW(converter,
+                        RowConverter::Make(schema, arrow::default_memory_pool()));
+  UnsafeRows rows;
+  ARROW_ASSIGN_OR_THROW(rows, converter->ToRows(*batch));
+  std::vector<int64_t> addresses;
+  std::vector<int32_t> sizes;
+  GetRows(rows, &addresses, &sizes);
+  sizes[0] = 24;
+  ASSERT_TRUE(
+      converter->ToColumnar(1, addresses.data(), sizes.data()).status().IsInvalid());
+}
+
+}  // namespace operators
+}  // namespace sparkcolumnarplugin
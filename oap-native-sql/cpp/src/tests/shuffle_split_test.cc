@@ -15,21 +15,58 @@
  * limitations under the License.
  */
 
+#include <arrow/builder.h>
 #include <arrow/io/api.h>
 #include <arrow/ipc/message.h>
 #include <arrow/ipc/reader.h>
 #include <arrow/ipc/util.h>
+#include <arrow/ipc/writer.h>
 #include <arrow/record_batch.h>
 #include <arrow/util/io_util.h>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include "shuffle/batch_serializer.h"
+#include "shuffle/buffer_pool.h"
+#include "shuffle/decompressor.h"
+#include "shuffle/partition_sink.h"
+#include "shuffle/partitioner.h"
+#include "shuffle/reader.h"
+#include "shuffle/scatter_kernels.h"
 #include "shuffle/splitter.h"
 #include "shuffle/type.h"
+#include "shuffle/writer_pool.h"
 #include "tests/test_utils.h"
 
 namespace sparkcolumnarplugin {
 namespace shuffle {
 
+// Keeps the streams pushed for each partition in memory
+class MemoryPartitionSink : public PartitionSink {
+ public:
+  arrow::Status Push(int32_t pid, std::shared_ptr<arrow::Buffer> stream) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_[pid].push_back(std::move(stream));
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Finish() override {
+    ++num_finished_;
+    return arrow::Status::OK();
+  }
+
+  std::map<int32_t, std::vector<std::shared_ptr<arrow::Buffer>>> streams_;
+  int32_t num_finished_ = 0;
+
+ private:
+  std::mutex mutex_;
+};
+
 class ShuffleTest : public ::testing::Test {
  protected:
   void SetUp() {
@@ -106,6 +143,28 @@ TEST_F(ShuffleTest, TestWriterAfterSplit) {
   ASSERT_EQ(splitter_->writer(10)->write_offset(), 1);
 }
 
+TEST_F(ShuffleTest, TestPartitionIdOutOfRange) {
+  std::shared_ptr<Splitter> splitter;
+  ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(schema_, 4));
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch(input_data_, schema_, &input_batch);
+
+  // partition id 10 is out of [0, 4)
+  ASSERT_FALSE(splitter->Split(*input_batch).ok());
+
+  ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(schema_, 4));
+  MakeInputBatch({"[3, 0, 3]", "[null, null, null]", "[1, 2, 3]", "[1, -1, null]",
+                  "[null, null, null]", "[null, 1, 0]", R"(["alice", "bob", null])"},
+                 schema_, &input_batch);
+  ASSERT_NOT_OK(splitter->Split(*input_batch));
+  ASSERT_EQ(splitter->writer(0)->write_offset(), 1);
+  ASSERT_EQ(splitter->writer(3)->write_offset(), 2);
+  ASSERT_EQ(splitter->writer(1), nullptr);
+  ASSERT_EQ(splitter->writer(4), nullptr);
+  ASSERT_NOT_OK(splitter->Stop());
+}
+
 TEST_F(ShuffleTest, TestLastType) {
   std::shared_ptr<arrow::RecordBatch> input_batch;
   MakeInputBatch(input_data_, schema_, &input_batch);
@@ -223,6 +282,45 @@ TEST_F(ShuffleTest, TestWriterMakeArrowRecordBatch) {
   ASSERT_NOT_OK(file_in->Close())
 }
 
+TEST_F(ShuffleTest, TestRowWiseSplitMode) {
+  int64_t buffer_size = 2;
+  splitter_->set_buffer_size(buffer_size);
+  splitter_->set_split_mode(SplitMode::ROW_WISE);
+
+  std::vector<std::string> output_data = {"[null, null]", "[1, 3]",
+                                          "[1, null]",    "[null, null]",
+                                          "[null, 0]",    R"(["alice", null])"};
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::shared_ptr<arrow::RecordBatch> output_batch;
+  MakeInputBatch(input_data_, schema_, &input_batch);
+  MakeInputBatch(output_data, writer_schema_, &output_batch);
+
+  ASSERT_NOT_OK(splitter_->Split(*input_batch));
+  ASSERT_NOT_OK(splitter_->Split(*input_batch));
+  ASSERT_EQ(splitter_->writer(1)->write_offset(), 2);
+  ASSERT_EQ(splitter_->writer(2)->write_offset(), 2);
+  ASSERT_EQ(splitter_->writer(10)->write_offset(), 2);
+
+  ASSERT_NOT_OK(splitter_->Stop());
+
+  std::shared_ptr<arrow::io::ReadableFile> file_in;
+  std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+  ARROW_ASSIGN_OR_THROW(file_in,
+                        arrow::io::ReadableFile::Open(splitter_->writer(1)->file_path()))
+
+  ARROW_ASSIGN_OR_THROW(file_reader, arrow::ipc::RecordBatchStreamReader::Open(file_in))
+  ASSERT_EQ(*file_reader->schema(), *writer_schema_);
+
+  int num_rb = 2;
+  for (int i = 0; i < num_rb; ++i) {
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    ASSERT_NOT_OK(Equals(*output_batch, *rb));
+  }
+  ASSERT_NOT_OK(file_in->Close())
+}
+
 TEST_F(ShuffleTest, TestCustomCompressionCodec) {
   auto compression_codec = arrow::Compression::LZ4_FRAME;
   splitter_->set_compression_codec(compression_codec);
@@ -254,5 +352,981 @@ TEST_F(ShuffleTest, TestCustomCompressionCodec) {
   ASSERT_NOT_OK(file_in->Close())
 }
 
+TEST_F(ShuffleTest, TestConsolidatedOutput) {
+  int64_t buffer_size = 2;
+  std::shared_ptr<arrow::internal::TemporaryDir> tmp_dir;
+  ARROW_ASSIGN_OR_THROW(tmp_dir, arrow::internal::TemporaryDir::Make(tmp_dir_prefix))
+  auto data_file = tmp_dir->path().ToString() + "data";
+  splitter_->set_buffer_size(buffer_size);
+  splitter_->set_output_mode(OutputMode::CONSOLIDATED);
+  splitter_->set_data_file(data_file);
+
+  std::vector<std::string> output_data = {"[null, null]", "[1, 3]",
+                                          "[1, null]",    "[null, null]",
+                                          "[null, 0]",    R"(["alice", null])"};
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::shared_ptr<arrow::RecordBatch> output_batch;
+  MakeInputBatch(input_data_, schema_, &input_batch);
+  MakeInputBatch(output_data, writer_schema_, &output_batch);
+
+  // the first batch of partition 1 is spilled while splitting the second input
+  ASSERT_NOT_OK(splitter_->Split(*input_batch));
+  ASSERT_NOT_OK(splitter_->Split(*input_batch));
+  ASSERT_NOT_OK(splitter_->Stop());
+
+  const auto& lengths = splitter_->GetPartitionLengths();
+  ASSERT_EQ(lengths.size(), 11);
+  ASSERT_EQ(lengths[0], 0);
+  ASSERT_GT(lengths[1], 0);
+  ASSERT_GT(lengths[2], 0);
+  ASSERT_GT(lengths[10], 0);
+
+  std::shared_ptr<arrow::io::ReadableFile> file_in;
+  ARROW_ASSIGN_OR_THROW(file_in, arrow::io::ReadableFile::Open(data_file))
+  int64_t file_size;
+  ARROW_ASSIGN_OR_THROW(file_size, file_in->GetSize())
+  ASSERT_EQ(file_size, std::accumulate(lengths.begin(), lengths.end(), 0L));
+
+  // partition 1 is a complete IPC stream starting right after partition 0
+  std::shared_ptr<arrow::Buffer> partition_buffer;
+  ARROW_ASSIGN_OR_THROW(partition_buffer, file_in->ReadAt(lengths[0], lengths[1]))
+  auto partition_in = std::make_shared<arrow::io::BufferReader>(partition_buffer);
+  std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+  ARROW_ASSIGN_OR_THROW(file_reader,
+                        arrow::ipc::RecordBatchStreamReader::Open(partition_in))
+  ASSERT_EQ(*file_reader->schema(), *writer_schema_);
+
+  int num_rb = 2;
+  std::shared_ptr<arrow::RecordBatch> rb;
+  for (int i = 0; i < num_rb; ++i) {
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    ASSERT_NOT_OK(Equals(*output_batch, *rb));
+  }
+  ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+  ASSERT_EQ(rb, nullptr);
+  ASSERT_NOT_OK(file_in->Close())
+}
+
+TEST_F(ShuffleTest, TestPushedOutput) {
+  auto sink = std::make_shared<MemoryPartitionSink>();
+  splitter_->set_output_mode(OutputMode::PUSHED);
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch(input_data_, schema_, &input_batch);
+  ASSERT_TRUE(splitter_->Split(*input_batch).IsInvalid());
+
+  std::vector<std::string> output_data = {"[null, null]", "[1, 3]",
+                                          "[1, null]",    "[null, null]",
+                                          "[null, 0]",    R"(["alice", null])"};
+  std::shared_ptr<arrow::RecordBatch> output_batch;
+  MakeInputBatch(output_data, writer_schema_, &output_batch);
+
+  // two map tasks pushing to the same sink, each spilling partition 1 once
+  for (int map = 0; map < 2; ++map) {
+    std::shared_ptr<Splitter> splitter;
+    ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(schema_));
+    splitter->set_buffer_size(2);
+    splitter->set_output_mode(OutputMode::PUSHED);
+    splitter->set_partition_sink(sink);
+    ASSERT_NOT_OK(splitter->Split(*input_batch));
+    ASSERT_NOT_OK(splitter->Split(*input_batch));
+    ASSERT_NOT_OK(splitter->Stop());
+    ASSERT_TRUE(splitter->GetPartitionFileInfo().empty());
+
+    const auto& lengths = splitter->GetPartitionLengths();
+    ASSERT_EQ(lengths.size(), 11);
+    ASSERT_EQ(lengths[0], 0);
+    ASSERT_GT(lengths[1], 0);
+    ASSERT_GT(lengths[10], 0);
+  }
+  ASSERT_EQ(sink->num_finished_, 2);
+  ASSERT_EQ(sink->streams_.size(), 3);
+  ASSERT_EQ(sink->streams_[1].size(), 4);
+
+  // the streams of partition 1 merged in one block read back as one partition
+  std::shared_ptr<arrow::io::BufferOutputStream> merged;
+  ARROW_ASSIGN_OR_THROW(merged, arrow::io::BufferOutputStream::Create());
+  for (const auto& stream : sink->streams_[1]) {
+    ASSERT_NOT_OK(merged->Write(stream));
+  }
+  std::shared_ptr<arrow::Buffer> block;
+  ARROW_ASSIGN_OR_THROW(block, merged->Finish());
+  std::shared_ptr<ShuffleReader> reader;
+  ARROW_ASSIGN_OR_THROW(reader, ShuffleReader::Make({block}));
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(reader->HasNext());
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(reader->Next(&rb));
+    ASSERT_NOT_OK(Equals(*output_batch, *rb));
+  }
+  ASSERT_FALSE(reader->HasNext());
+}
+
+TEST_F(ShuffleTest, TestMemoryLimit) {
+  // any buffered partition exceeds the limit
+  splitter_->set_memory_limit(1);
+
+  std::vector<std::string> output_data = {"[null, null]", "[1, 3]",
+                                          "[1, null]",    "[null, null]",
+                                          "[null, 0]",    R"(["alice", null])"};
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::shared_ptr<arrow::RecordBatch> output_batch;
+  MakeInputBatch(input_data_, schema_, &input_batch);
+  MakeInputBatch(output_data, writer_schema_, &output_batch);
+
+  ASSERT_NOT_OK(splitter_->Split(*input_batch));
+  ASSERT_EQ(splitter_->BufferedBytes(), 0);
+  ASSERT_TRUE(splitter_->writer(1)->buffers_released());
+  ASSERT_EQ(splitter_->writer(1)->write_offset(), 0);
+
+  // evicted writers are reallocated on demand
+  ASSERT_NOT_OK(splitter_->Split(*input_batch));
+  ASSERT_FALSE(splitter_->writer(1)->buffers_released());
+  ASSERT_NOT_OK(splitter_->Stop());
+
+  std::shared_ptr<arrow::io::ReadableFile> file_in;
+  std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+  ARROW_ASSIGN_OR_THROW(file_in,
+                        arrow::io::ReadableFile::Open(splitter_->writer(1)->file_path()))
+  ARROW_ASSIGN_OR_THROW(file_reader, arrow::ipc::RecordBatchStreamReader::Open(file_in))
+
+  int num_rb = 2;
+  for (int i = 0; i < num_rb; ++i) {
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    ASSERT_NOT_OK(Equals(*output_batch, *rb));
+  }
+  ASSERT_NOT_OK(file_in->Close())
+}
+
+TEST_F(ShuffleTest, TestSpillLargestFirst) {
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch(input_data_, schema_, &input_batch);
+  ASSERT_NOT_OK(splitter_->Split(*input_batch));
+
+  std::vector<int32_t> pids = {1, 2, 10};
+  int64_t largest = 0;
+  for (auto pid : pids) {
+    largest = std::max(largest, splitter_->writer(pid)->BufferedBytes());
+  }
+  ASSERT_GT(largest, 0);
+
+  // one writer is enough to release 1 byte
+  int64_t released;
+  ARROW_ASSIGN_OR_THROW(released, splitter_->Spill(1))
+  ASSERT_EQ(released, largest);
+  int num_released = 0;
+  for (auto pid : pids) {
+    if (splitter_->writer(pid)->buffers_released()) {
+      ++num_released;
+      ASSERT_EQ(splitter_->writer(pid)->BufferedBytes(), 0);
+    }
+  }
+  ASSERT_EQ(num_released, 1);
+}
+
+TEST_F(ShuffleTest, TestBinarySplit) {
+  auto schema = arrow::schema({field("f_pid", arrow::int32()),
+                               field("f_string", arrow::utf8()),
+                               field("f_large_string", arrow::large_utf8())});
+  std::shared_ptr<Splitter> splitter;
+  ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(schema, 3));
+
+  int num_rows = 1000;
+  int num_partitions = 3;
+  arrow::Int32Builder pid_builder;
+  arrow::StringBuilder string_builder;
+  arrow::LargeStringBuilder large_string_builder;
+  std::vector<arrow::StringBuilder> expected_string(num_partitions);
+  std::vector<arrow::LargeStringBuilder> expected_large_string(num_partitions);
+  for (int i = 0; i < num_rows; ++i) {
+    auto pid = i % num_partitions;
+    ASSERT_NOT_OK(pid_builder.Append(pid));
+    if (i % 7 == 0) {
+      ASSERT_NOT_OK(string_builder.AppendNull());
+      ASSERT_NOT_OK(expected_string[pid].AppendNull());
+    } else {
+      auto value = std::string(i % 17, 'a' + i % 26);
+      ASSERT_NOT_OK(string_builder.Append(value));
+      ASSERT_NOT_OK(expected_string[pid].Append(value));
+    }
+    auto value = std::to_string(i);
+    ASSERT_NOT_OK(large_string_builder.Append(value));
+    ASSERT_NOT_OK(expected_large_string[pid].Append(value));
+  }
+  std::shared_ptr<arrow::Array> pid_arr;
+  std::shared_ptr<arrow::Array> string_arr;
+  std::shared_ptr<arrow::Array> large_string_arr;
+  ASSERT_NOT_OK(pid_builder.Finish(&pid_arr));
+  ASSERT_NOT_OK(string_builder.Finish(&string_arr));
+  ASSERT_NOT_OK(large_string_builder.Finish(&large_string_arr));
+  auto input_batch =
+      arrow::RecordBatch::Make(schema, num_rows, {pid_arr, string_arr, large_string_arr});
+
+  ASSERT_NOT_OK(splitter->Split(*input_batch));
+  ASSERT_NOT_OK(splitter->Stop());
+
+  for (int pid = 0; pid < num_partitions; ++pid) {
+    std::shared_ptr<arrow::Array> expected_string_arr;
+    std::shared_ptr<arrow::Array> expected_large_string_arr;
+    ASSERT_NOT_OK(expected_string[pid].Finish(&expected_string_arr));
+    ASSERT_NOT_OK(expected_large_string[pid].Finish(&expected_large_string_arr));
+
+    std::shared_ptr<arrow::io::ReadableFile> file_in;
+    std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+    const auto& file_path = splitter->writer(pid)->file_path();
+    ARROW_ASSIGN_OR_THROW(file_in, arrow::io::ReadableFile::Open(file_path))
+    ARROW_ASSIGN_OR_THROW(file_reader, arrow::ipc::RecordBatchStreamReader::Open(file_in))
+
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    ASSERT_NOT_OK(Equals(*expected_string_arr, *rb->column(0)));
+    ASSERT_NOT_OK(Equals(*expected_large_string_arr, *rb->column(1)));
+    ASSERT_NOT_OK(file_in->Close())
+  }
+}
+
+TEST_F(ShuffleTest, TestWriterThreads) {
+  int64_t buffer_size = 2;
+  splitter_->set_buffer_size(buffer_size);
+  // admit one batch at a time
+  splitter_->set_writer_threads(2, 1);
+
+  std::vector<std::string> output_data = {"[null, null]", "[1, 3]",
+                                          "[1, null]",    "[null, null]",
+                                          "[null, 0]",    R"(["alice", null])"};
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  std::shared_ptr<arrow::RecordBatch> output_batch;
+  MakeInputBatch(input_data_, schema_, &input_batch);
+  MakeInputBatch(output_data, writer_schema_, &output_batch);
+
+  int num_rb = 4;
+  for (int i = 0; i < num_rb; ++i) {
+    ASSERT_NOT_OK(splitter_->Split(*input_batch));
+  }
+  ASSERT_NOT_OK(splitter_->Stop());
+
+  std::shared_ptr<arrow::io::ReadableFile> file_in;
+  std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+  ARROW_ASSIGN_OR_THROW(file_in,
+                        arrow::io::ReadableFile::Open(splitter_->writer(1)->file_path()))
+  ARROW_ASSIGN_OR_THROW(file_reader, arrow::ipc::RecordBatchStreamReader::Open(file_in))
+
+  for (int i = 0; i < num_rb; ++i) {
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    ASSERT_NOT_OK(Equals(*output_batch, *rb));
+  }
+  ASSERT_NOT_OK(file_in->Close())
+}
+
+TEST_F(ShuffleTest, TestSplitterMetrics) {
+  splitter_->set_buffer_size(2);
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch(input_data_, schema_, &input_batch);
+
+  int num_rb = 4;
+  for (int i = 0; i < num_rb; ++i) {
+    ASSERT_NOT_OK(splitter_->Split(*input_batch));
+  }
+  ASSERT_NOT_OK(splitter_->Stop());
+
+  // partition 1 spills before each batch but the first, 2 and 10 once their two rows of
+  // buffer are full
+  ASSERT_EQ(splitter_->TotalSpills(), 5);
+  ASSERT_GT(splitter_->TotalSplitTime(), 0);
+  ASSERT_GT(splitter_->TotalWriteTime(), 0);
+  ASSERT_GE(splitter_->TotalCompressTime(), 0);
+
+  auto rows = splitter_->PartitionRowsWritten();
+  ASSERT_GE(rows.size(), 11);
+  ASSERT_EQ(rows[1], 8);
+  ASSERT_EQ(rows[2], 4);
+  ASSERT_EQ(rows[10], 4);
+  ASSERT_EQ(std::accumulate(rows.begin(), rows.end(), 0L), 16);
+
+  std::vector<int64_t> bytes;
+  int64_t total_bytes;
+  ARROW_ASSIGN_OR_THROW(bytes, splitter_->PartitionBytesWritten());
+  ARROW_ASSIGN_OR_THROW(total_bytes, splitter_->TotalBytesWritten());
+  ASSERT_EQ(bytes.size(), rows.size());
+  ASSERT_EQ(bytes[0], 0);
+  ASSERT_GT(bytes[1], bytes[2]);
+  ASSERT_EQ(std::accumulate(bytes.begin(), bytes.end(), 0L), total_bytes);
+}
+
+TEST_F(ShuffleTest, TestHashPartitioning) {
+  auto schema =
+      arrow::schema({field("f_int32", arrow::int32()), field("f_string", arrow::utf8())});
+  PartitioningOptions options;
+  options.partitioning = Partitioning::HASH;
+  options.key_indices = {0};
+  std::shared_ptr<Splitter> splitter;
+  ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(schema, 4, options));
+  ASSERT_EQ(*schema, *splitter->schema());
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch({"[1, 2, 3, null]", R"(["alice", "bob", null, "dave"])"}, schema,
+                 &input_batch);
+  ASSERT_NOT_OK(splitter->Split(*input_batch));
+  ASSERT_NOT_OK(splitter->Stop());
+
+  // pmod(hash(f_int32), 4) in Spark, a null key keeps the seed 42
+  std::vector<std::pair<int32_t, std::vector<std::string>>> expected = {
+      {2, {"[2, null]", R"(["bob", "dave"])"}}, {3, {"[1, 3]", R"(["alice", null])"}}};
+  ASSERT_EQ(splitter->writer(0), nullptr);
+  ASSERT_EQ(splitter->writer(1), nullptr);
+  for (const auto& item : expected) {
+    std::shared_ptr<arrow::RecordBatch> output_batch;
+    MakeInputBatch(item.second, schema, &output_batch);
+
+    std::shared_ptr<arrow::io::ReadableFile> file_in;
+    std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+    ARROW_ASSIGN_OR_THROW(
+        file_in, arrow::io::ReadableFile::Open(splitter->writer(item.first)->file_path()))
+    ARROW_ASSIGN_OR_THROW(file_reader, arrow::ipc::RecordBatchStreamReader::Open(file_in))
+
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    ASSERT_NOT_OK(Equals(*output_batch, *rb));
+    ASSERT_NOT_OK(file_in->Close())
+  }
+}
+
+TEST_F(ShuffleTest, TestDictionaryColumn) {
+  auto dict_type = arrow::dictionary(arrow::int8(), arrow::utf8());
+  auto schema =
+      arrow::schema({field("f_pid", arrow::int32()), field("f_dict", dict_type)});
+  std::shared_ptr<Splitter> splitter;
+  ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(schema));
+  ASSERT_EQ(splitter->column_type_id(0), Type::SHUFFLE_1BYTE);
+
+  auto make_batch = [&](const std::string& pids, const std::string& indices,
+                        const std::string& dictionary) {
+    std::shared_ptr<arrow::Array> pid_arr;
+    std::shared_ptr<arrow::Array> indices_arr;
+    std::shared_ptr<arrow::Array> dictionary_arr;
+    ASSERT_NOT_OK(
+        arrow::ipc::internal::json::ArrayFromJSON(arrow::int32(), pids, &pid_arr));
+    ASSERT_NOT_OK(
+        arrow::ipc::internal::json::ArrayFromJSON(arrow::int8(), indices, &indices_arr));
+    ASSERT_NOT_OK(arrow::ipc::internal::json::ArrayFromJSON(arrow::utf8(), dictionary,
+                                                            &dictionary_arr));
+    auto dict_arr =
+        std::make_shared<arrow::DictionaryArray>(dict_type, indices_arr, dictionary_arr);
+    return arrow::RecordBatch::Make(schema, pid_arr->length(), {pid_arr, dict_arr});
+  };
+
+  auto dictionary = R"(["us", "cn", "de"])";
+  ASSERT_NOT_OK(
+      splitter->Split(*make_batch("[0, 1, 0, 1]", "[0, 1, null, 2]", dictionary)));
+  ASSERT_NOT_OK(splitter->Split(*make_batch("[1, 0]", "[0, 2]", dictionary)));
+  // the stream holds the dictionary of the first batch only
+  ASSERT_TRUE(splitter->Split(*make_batch("[0]", "[0]", R"(["fr"])")).IsInvalid());
+  ASSERT_NOT_OK(splitter->Stop());
+
+  std::vector<std::pair<int32_t, std::string>> expected = {{0, "[0, null, 2]"},
+                                                           {1, "[1, 2, 0]"}};
+  for (const auto& item : expected) {
+    std::shared_ptr<arrow::io::ReadableFile> file_in;
+    std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+    ARROW_ASSIGN_OR_THROW(
+        file_in, arrow::io::ReadableFile::Open(splitter->writer(item.first)->file_path()))
+    ARROW_ASSIGN_OR_THROW(file_reader, arrow::ipc::RecordBatchStreamReader::Open(file_in))
+
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    auto output_batch = make_batch("[0, 0, 0]", item.second, dictionary);
+    ASSERT_NOT_OK(Equals(*output_batch->column(1), *rb->column(0)));
+    ASSERT_NOT_OK(file_in->Close())
+  }
+}
+
+TEST_F(ShuffleTest, TestAdaptiveCompression) {
+  auto schema =
+      arrow::schema({field("f_pid", arrow::int32()), field("f_int64", arrow::int64())});
+  std::shared_ptr<Splitter> splitter;
+  ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(schema));
+  splitter->set_compression_codec(arrow::Compression::LZ4_FRAME);
+  splitter->set_compression_threshold(0.1);
+
+  // partition 0 gets zeros, partition 1 random values which don't compress
+  std::mt19937_64 rng(42);
+  arrow::Int32Builder pid_builder;
+  arrow::Int64Builder value_builder;
+  for (int i = 0; i < 2048; ++i) {
+    ASSERT_NOT_OK(pid_builder.Append(i % 2));
+    ASSERT_NOT_OK(value_builder.Append(i % 2 == 0 ? 0 : static_cast<int64_t>(rng())));
+  }
+  std::shared_ptr<arrow::Array> pid_arr;
+  std::shared_ptr<arrow::Array> value_arr;
+  ASSERT_NOT_OK(pid_builder.Finish(&pid_arr));
+  ASSERT_NOT_OK(value_builder.Finish(&value_arr));
+  auto input_batch = arrow::RecordBatch::Make(schema, 2048, {pid_arr, value_arr});
+
+  ASSERT_NOT_OK(splitter->Split(*input_batch));
+  ASSERT_NOT_OK(splitter->Stop());
+  ASSERT_EQ(splitter->writer(0)->compression_codec(), arrow::Compression::LZ4_FRAME);
+  ASSERT_EQ(splitter->writer(1)->compression_codec(), arrow::Compression::UNCOMPRESSED);
+
+  for (int32_t pid = 0; pid < 2; ++pid) {
+    std::shared_ptr<arrow::io::ReadableFile> file_in;
+    std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+    ARROW_ASSIGN_OR_THROW(
+        file_in, arrow::io::ReadableFile::Open(splitter->writer(pid)->file_path()))
+    ARROW_ASSIGN_OR_THROW(file_reader, arrow::ipc::RecordBatchStreamReader::Open(file_in))
+
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    ASSERT_EQ(rb->num_rows(), 1024);
+    auto values = std::static_pointer_cast<arrow::Int64Array>(rb->column(0));
+    for (int64_t i = 0; i < rb->num_rows(); ++i) {
+      ASSERT_EQ(values->Value(i), value_arr->data()->GetValues<int64_t>(1)[2 * i + pid]);
+    }
+    ASSERT_NOT_OK(file_in->Close())
+  }
+}
+
+TEST_F(ShuffleTest, TestRoundRobinPartitioning) {
+  auto schema =
+      arrow::schema({field("f_int32", arrow::int32()), field("f_string", arrow::utf8())});
+  PartitioningOptions options;
+  options.partitioning = Partitioning::ROUND_ROBIN;
+  options.start_partition = 1;
+  std::shared_ptr<Splitter> splitter;
+  ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(schema, 3, options));
+
+  std::shared_ptr<arrow::RecordBatch> input_batch_1;
+  std::shared_ptr<arrow::RecordBatch> input_batch_2;
+  MakeInputBatch({"[0, 1, 2, 3, 4, 5, 6]", R"(["a", "b", "c", "d", "e", "f", "g"])"},
+                 schema, &input_batch_1);
+  MakeInputBatch({"[7, 8]", R"(["h", "i"])"}, schema, &input_batch_2);
+  ASSERT_NOT_OK(splitter->Split(*input_batch_1));
+  ASSERT_NOT_OK(splitter->Split(*input_batch_2));
+  ASSERT_NOT_OK(splitter->Stop());
+
+  // slices [0, 2), [2, 4), [4, 7) go to partitions 1, 2, 0, then [0, 1), [1, 2) of the
+  // second batch continue with 1, 2
+  std::vector<std::vector<std::string>> expected = {
+      {"[4, 5, 6]", R"(["e", "f", "g"])"},
+      {"[0, 1, 7]", R"(["a", "b", "h"])"},
+      {"[2, 3, 8]", R"(["c", "d", "i"])"}};
+  for (int32_t pid = 0; pid < 3; ++pid) {
+    std::shared_ptr<arrow::RecordBatch> output_batch;
+    MakeInputBatch(expected[pid], schema, &output_batch);
+
+    std::shared_ptr<arrow::io::ReadableFile> file_in;
+    std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+    const auto& file_path = splitter->writer(pid)->file_path();
+    ARROW_ASSIGN_OR_THROW(file_in, arrow::io::ReadableFile::Open(file_path))
+    ARROW_ASSIGN_OR_THROW(file_reader, arrow::ipc::RecordBatchStreamReader::Open(file_in))
+
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    ASSERT_NOT_OK(Equals(*output_batch, *rb));
+    ASSERT_NOT_OK(file_in->Close())
+  }
+}
+
+TEST_F(ShuffleTest, TestSinglePartitioning) {
+  PartitioningOptions options;
+  options.partitioning = Partitioning::SINGLE;
+  std::shared_ptr<Splitter> splitter;
+  ARROW_ASSIGN_OR_THROW(splitter, Splitter::Make(writer_schema_, 1, options));
+
+  std::vector<std::string> input_data(input_data_.begin() + 1, input_data_.end());
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch(input_data, writer_schema_, &input_batch);
+
+  int num_rb = 3;
+  for (int i = 0; i < num_rb; ++i) {
+    ASSERT_NOT_OK(splitter->Split(*input_batch));
+  }
+  ASSERT_NOT_OK(splitter->Stop());
+  ASSERT_EQ(splitter->GetPartitionFileInfo().size(), 1);
+
+  // each input batch is written as is
+  std::shared_ptr<arrow::io::ReadableFile> file_in;
+  std::shared_ptr<arrow::ipc::RecordBatchReader> file_reader;
+  ARROW_ASSIGN_OR_THROW(file_in,
+                        arrow::io::ReadableFile::Open(splitter->writer(0)->file_path()))
+  ARROW_ASSIGN_OR_THROW(file_reader, arrow::ipc::RecordBatchStreamReader::Open(file_in))
+  for (int i = 0; i < num_rb; ++i) {
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(file_reader->ReadNext(&rb));
+    ASSERT_NOT_OK(Equals(*input_batch, *rb));
+  }
+  ASSERT_NOT_OK(file_in->Close())
+}
+
+TEST(PartitionerTest, TestSparkMurmur3) {
+  // expected values are computed by Spark, e.g. SELECT hash('Spark', array(123), 2)
+  ASSERT_EQ(murmur3::HashInt(1, kSparkHashSeed), -559580957);
+  ASSERT_EQ(murmur3::HashLong(1, kSparkHashSeed), -1712319331);
+  auto abc = reinterpret_cast<const uint8_t*>("abc");
+  ASSERT_EQ(murmur3::HashBytes(abc, 3, kSparkHashSeed), 1322437556);
+  auto spark = reinterpret_cast<const uint8_t*>("Spark");
+  auto hash = murmur3::HashBytes(spark, 5, kSparkHashSeed);
+  hash = murmur3::HashInt(123, hash);
+  ASSERT_EQ(murmur3::HashInt(2, hash), -1321691492);
+}
+
+TEST(PartitionerTest, TestHashColumns) {
+  auto schema =
+      arrow::schema({field("f_int64", arrow::int64()), field("f_string", arrow::utf8())});
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch({"[1, null, 3, 4, 5, 6, 7, 8, 9, null, 11]",
+                  R"(["a", "b", null, "d", "e", "f", "g", "h", "i", "j", "k"])"},
+                 schema, &input_batch);
+  // a slice not starting at a byte of the validity bitmaps
+  auto batch = input_batch->Slice(1);
+  auto ints = std::static_pointer_cast<arrow::Int64Array>(batch->column(0));
+  auto strings = std::static_pointer_cast<arrow::StringArray>(batch->column(1));
+  auto num_rows = batch->num_rows();
+
+  std::vector<int32_t> spark_hashes(num_rows, kSparkHashSeed);
+  ASSERT_NOT_OK(murmur3::HashColumn(*ints, spark_hashes.data()));
+  ASSERT_NOT_OK(murmur3::HashColumn(*strings, spark_hashes.data()));
+  std::vector<uint64_t> fast_hashes(num_rows);
+  ASSERT_NOT_OK(fasthash::HashColumn(*ints, false, fast_hashes.data()));
+  ASSERT_NOT_OK(fasthash::HashColumn(*strings, true, fast_hashes.data()));
+
+  for (int64_t i = 0; i < num_rows; ++i) {
+    // Spark skips the null keys
+    auto spark_hash = kSparkHashSeed;
+    auto fast_hash = fasthash::kNullHash;
+    if (ints->IsValid(i)) {
+      spark_hash = murmur3::HashLong(ints->Value(i), spark_hash);
+      fast_hash = fasthash::HashValue(ints->Value(i));
+    }
+    auto value = strings->GetView(i);
+    if (strings->IsValid(i)) {
+      spark_hash = murmur3::HashBytes(reinterpret_cast<const uint8_t*>(value.data()),
+                                      value.size(), spark_hash);
+      fast_hash = fasthash::Combine(
+          fast_hash, fasthash::HashBytes(value.data(), value.size()));
+    } else {
+      fast_hash = fasthash::Combine(fast_hash, fasthash::kNullHash);
+    }
+    ASSERT_EQ(spark_hashes[i], spark_hash);
+    ASSERT_EQ(fast_hashes[i], fast_hash);
+  }
+}
+
+TEST(PartitionerTest, TestRangePartitioning) {
+  auto schema =
+      arrow::schema({field("f_string", arrow::utf8()), field("f_int32", arrow::int32())});
+  PartitioningOptions options;
+  options.partitioning = Partitioning::RANGE;
+  options.key_indices = {1};
+  MakeInputBatch({"[10, 20]"}, arrow::schema({schema->field(1)}), &options.range_bounds);
+
+  std::shared_ptr<Partitioner> partitioner;
+  ARROW_ASSIGN_OR_THROW(partitioner, Partitioner::Make(schema, 3, options));
+
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch({R"(["a", "b", "c", "d", "e"])", "[5, 10, 15, 25, null]"}, schema,
+                 &input_batch);
+  std::vector<int32_t> pids(input_batch->num_rows());
+  ASSERT_NOT_OK(partitioner->Compute(*input_batch, pids.data()));
+  ASSERT_EQ(pids, std::vector<int32_t>({0, 0, 1, 2, 0}));
+
+  // one bound per partition but the last
+  ASSERT_TRUE(Partitioner::Make(schema, 2, options).status().IsInvalid());
+}
+
+TEST(PartitionerTest, TestRangeSampler) {
+  auto schema =
+      arrow::schema({field("f_string", arrow::utf8()), field("f_int32", arrow::int32())});
+  std::shared_ptr<arrow::RecordBatch> batch_0;
+  std::shared_ptr<arrow::RecordBatch> batch_1;
+  MakeInputBatch({R"(["a", "b", "c"])", "[3, 1, null]"}, schema, &batch_0);
+  MakeInputBatch({R"(["d", "e", "f", "g"])", "[2, 2, 4, 5]"}, schema, &batch_1);
+
+  PartitioningOptions options;
+  options.partitioning = Partitioning::RANGE;
+  options.key_indices = {1};
+  std::shared_ptr<RangeSampler> sampler;
+  ARROW_ASSIGN_OR_THROW(sampler, RangeSampler::Make(schema, options, 100, 42));
+  ASSERT_NOT_OK(sampler->Sample(*batch_0));
+  ASSERT_NOT_OK(sampler->Sample(*batch_1));
+  ASSERT_EQ(sampler->num_rows(), 7);
+  ASSERT_EQ(sampler->sample()->num_rows(), 7);
+
+  // distinct bounds evenly spaced in null, 1, 2, 2, 3, 4, 5
+  std::shared_ptr<arrow::RecordBatch> bounds;
+  ARROW_ASSIGN_OR_THROW(bounds, sampler->ComputeBounds(3));
+  std::shared_ptr<arrow::RecordBatch> expected;
+  MakeInputBatch({"[2, 3]"}, bounds->schema(), &expected);
+  ASSERT_NOT_OK(Equals(*expected, *bounds));
+
+  // descending nulls last, the order of the bounds and of the partitions
+  options.key_ascending = {false};
+  options.key_nulls_first = {false};
+  ARROW_ASSIGN_OR_THROW(sampler, RangeSampler::Make(schema, options, 100, 42));
+  ASSERT_NOT_OK(sampler->Sample(*batch_0));
+  ASSERT_NOT_OK(sampler->Sample(*batch_1));
+  ARROW_ASSIGN_OR_THROW(bounds, sampler->ComputeBounds(3));
+  MakeInputBatch({"[3, 2]"}, bounds->schema(), &expected);
+  ASSERT_NOT_OK(Equals(*expected, *bounds));
+
+  options.range_bounds = bounds;
+  std::shared_ptr<Partitioner> partitioner;
+  ARROW_ASSIGN_OR_THROW(partitioner, Partitioner::Make(schema, 3, options));
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch({R"(["a", "b", "c", "d"])", "[5, 3, 2, null]"}, schema, &input_batch);
+  std::vector<int32_t> pids(input_batch->num_rows());
+  ASSERT_NOT_OK(partitioner->Compute(*input_batch, pids.data()));
+  ASSERT_EQ(pids, std::vector<int32_t>({0, 0, 1, 2}));
+
+  // the reservoir keeps at most sample_size rows
+  ARROW_ASSIGN_OR_THROW(sampler, RangeSampler::Make(schema, options, 2, 42));
+  ASSERT_NOT_OK(sampler->Sample(*batch_0));
+  ASSERT_NOT_OK(sampler->Sample(*batch_1));
+  ASSERT_EQ(sampler->num_rows(), 7);
+  ASSERT_EQ(sampler->sample()->num_rows(), 2);
+
+  options.key_ascending = {true, false};
+  ASSERT_TRUE(RangeSampler::Make(schema, options, 2, 42).status().IsInvalid());
+}
+
+// Compress the buffers of batch the way the ipc writer does, except the validity buffer
+// of the first column, which is kept uncompressed
+void CompressBuffers(const arrow::RecordBatch& batch, arrow::util::Codec* codec,
+                     std::vector<std::shared_ptr<arrow::Buffer>>* compressed,
+                     std::vector<int64_t>* buf_addrs, std::vector<int64_t>* buf_sizes,
+                     uint8_t* buf_mask) {
+  for (const auto& column : batch.columns()) {
+    for (const auto& buffer : column->data()->buffers) {
+      if (buf_addrs->empty()) {
+        arrow::BitUtil::SetBit(buf_mask, 0);
+        buf_addrs->push_back(reinterpret_cast<int64_t>(buffer->data()));
+        buf_sizes->push_back(buffer->size());
+        continue;
+      }
+      auto max_length = codec->MaxCompressedLen(buffer->size(), buffer->data());
+      std::shared_ptr<arrow::ResizableBuffer> out;
+      ARROW_ASSIGN_OR_THROW(out, arrow::AllocateResizableBuffer(max_length + 8));
+      *reinterpret_cast<int64_t*>(out->mutable_data()) = buffer->size();
+      int64_t length;
+      ARROW_ASSIGN_OR_THROW(length, codec->Compress(buffer->size(), buffer->data(),
+                                                    max_length, out->mutable_data() + 8));
+      ASSERT_NOT_OK(out->Resize(length + 8));
+      buf_addrs->push_back(reinterpret_cast<int64_t>(out->data()));
+      buf_sizes->push_back(out->size());
+      compressed->push_back(std::move(out));
+    }
+  }
+}
+
+TEST(DecompressorTest, TestDecompressPooled) {
+  auto schema =
+      arrow::schema({field("f_int32", arrow::int32()), field("f_string", arrow::utf8())});
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch({"[1, null, 3, 4]", R"(["alice", "bob", null, "david"])"}, schema,
+                 &input_batch);
+
+  auto compression_codec = arrow::Compression::LZ4_FRAME;
+  std::unique_ptr<arrow::util::Codec> codec;
+  ARROW_ASSIGN_OR_THROW(codec, arrow::util::Codec::Create(compression_codec));
+  std::vector<std::shared_ptr<arrow::Buffer>> compressed;
+  std::vector<int64_t> buf_addrs;
+  std::vector<int64_t> buf_sizes;
+  uint8_t buf_mask = 0;
+  CompressBuffers(*input_batch, codec.get(), &compressed, &buf_addrs, &buf_sizes,
+                  &buf_mask);
+
+  std::shared_ptr<Decompressor> decompressor;
+  ARROW_ASSIGN_OR_THROW(decompressor, Decompressor::Make(schema));
+  std::shared_ptr<arrow::RecordBatch> rb;
+  ARROW_ASSIGN_OR_THROW(rb, decompressor->Decompress(
+                                compression_codec, input_batch->num_rows(),
+                                buf_addrs.data(), buf_sizes.data(), 5, &buf_mask));
+  ASSERT_NOT_OK(Equals(*rb, *input_batch));
+  // the uncompressed buffer is not copied
+  ASSERT_EQ(rb->column_data(0)->buffers[0]->data(),
+            input_batch->column_data(0)->buffers[0]->data());
+
+  // the arena is reused once the previous batch is released
+  auto first_data = rb->column_data(0)->buffers[1]->data();
+  rb.reset();
+  ARROW_ASSIGN_OR_THROW(rb, decompressor->Decompress(
+                                compression_codec, input_batch->num_rows(),
+                                buf_addrs.data(), buf_sizes.data(), 5, &buf_mask));
+  ASSERT_NOT_OK(Equals(*rb, *input_batch));
+  ASSERT_EQ(rb->column_data(0)->buffers[1]->data(), first_data);
+
+  // but not while the batch is alive
+  std::shared_ptr<arrow::RecordBatch> next_rb;
+  ARROW_ASSIGN_OR_THROW(next_rb, decompressor->Decompress(
+                                     compression_codec, input_batch->num_rows(),
+                                     buf_addrs.data(), buf_sizes.data(), 5, &buf_mask));
+  ASSERT_NOT_OK(Equals(*next_rb, *input_batch));
+  ASSERT_NE(next_rb->column_data(0)->buffers[1]->data(), first_data);
+
+  ASSERT_TRUE(decompressor
+                  ->Decompress(compression_codec, input_batch->num_rows(),
+                               buf_addrs.data(), buf_sizes.data(), 4, &buf_mask)
+                  .status()
+                  .IsInvalid());
+}
+
+TEST(DecompressorTest, TestDecompressParallel) {
+  std::vector<std::shared_ptr<arrow::Field>> fields;
+  std::vector<std::string> input_data;
+  for (int i = 0; i < 16; ++i) {
+    fields.push_back(field("f_int64_" + std::to_string(i), arrow::int64()));
+    input_data.push_back("[" + std::to_string(i) + ", null, 3, " + std::to_string(i * i) +
+                         "]");
+  }
+  auto schema = arrow::schema(fields);
+  std::shared_ptr<arrow::RecordBatch> input_batch;
+  MakeInputBatch(input_data, schema, &input_batch);
+
+  auto compression_codec = arrow::Compression::ZSTD;
+  std::unique_ptr<arrow::util::Codec> codec;
+  ARROW_ASSIGN_OR_THROW(codec, arrow::util::Codec::Create(compression_codec));
+  std::vector<std::shared_ptr<arrow::Buffer>> compressed;
+  std::vector<int64_t> buf_addrs;
+  std::vector<int64_t> buf_sizes;
+  std::vector<uint8_t> buf_mask(4, 0);
+  CompressBuffers(*input_batch, codec.get(), &compressed, &buf_addrs, &buf_sizes,
+                  buf_mask.data());
+
+  std::shared_ptr<Decompressor> decompressor;
+  ARROW_ASSIGN_OR_THROW(decompressor, Decompressor::Make(schema));
+  ASSERT_TRUE(decompressor->SetNumThreads(0).IsInvalid());
+  for (auto num_threads : {4, 1, 64}) {
+    ASSERT_NOT_OK(decompressor->SetNumThreads(num_threads));
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ARROW_ASSIGN_OR_THROW(
+        rb, decompressor->Decompress(compression_codec, input_batch->num_rows(),
+                                     buf_addrs.data(), buf_sizes.data(), buf_addrs.size(),
+                                     buf_mask.data()));
+    ASSERT_NOT_OK(Equals(*rb, *input_batch));
+  }
+}
+
+// Write batches as one compressed IPC stream, the way PartitionWriter does
+std::shared_ptr<arrow::Buffer> WriteStream(
+    const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches) {
+  std::shared_ptr<arrow::io::BufferOutputStream> sink;
+  ARROW_ASSIGN_OR_THROW(sink, arrow::io::BufferOutputStream::Create());
+  auto options = arrow::ipc::IpcWriteOptions::Defaults();
+  options.compression = arrow::Compression::LZ4_FRAME;
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+  ARROW_ASSIGN_OR_THROW(writer, arrow::ipc::NewStreamWriter(
+                                    sink.get(), batches[0]->schema(), options));
+  for (const auto& batch : batches) {
+    ASSERT_NOT_OK(writer->WriteRecordBatch(*batch));
+  }
+  ASSERT_NOT_OK(writer->Close());
+  std::shared_ptr<arrow::Buffer> stream;
+  ARROW_ASSIGN_OR_THROW(stream, sink->Finish());
+  return stream;
+}
+
+TEST(ShuffleReaderTest, TestReadBlocks) {
+  auto schema =
+      arrow::schema({field("f_int32", arrow::int32()), field("f_string", arrow::utf8())});
+  std::shared_ptr<arrow::RecordBatch> batch0;
+  std::shared_ptr<arrow::RecordBatch> batch1;
+  MakeInputBatch({"[1, null, 3]", R"(["alice", "bob", null])"}, schema, &batch0);
+  MakeInputBatch({"[4]", R"(["david"])"}, schema, &batch1);
+
+  // two streams concatenated in the first block, an empty block, then a third stream
+  auto stream0 = WriteStream({batch0, batch1});
+  auto stream1 = WriteStream({batch1});
+  std::shared_ptr<arrow::io::BufferOutputStream> sink;
+  ARROW_ASSIGN_OR_THROW(sink, arrow::io::BufferOutputStream::Create());
+  ASSERT_NOT_OK(sink->Write(stream0));
+  ASSERT_NOT_OK(sink->Write(stream1));
+  std::shared_ptr<arrow::Buffer> block0;
+  ARROW_ASSIGN_OR_THROW(block0, sink->Finish());
+  auto block1 = std::make_shared<arrow::Buffer>(nullptr, 0);
+  auto block2 = WriteStream({batch0});
+
+  std::shared_ptr<ShuffleReader> reader;
+  ARROW_ASSIGN_OR_THROW(reader, ShuffleReader::Make({block0, block1, block2}));
+  std::vector<std::shared_ptr<arrow::RecordBatch>> expected = {batch0, batch1, batch1,
+                                                               batch0};
+  for (const auto& expected_batch : expected) {
+    ASSERT_TRUE(reader->HasNext());
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(reader->Next(&rb));
+    ASSERT_NOT_OK(Equals(*rb, *expected_batch));
+  }
+  ASSERT_FALSE(reader->HasNext());
+  ASSERT_EQ(*reader->schema(), *schema);
+
+  ARROW_ASSIGN_OR_THROW(
+      reader, ShuffleReader::Make({block2}, arrow::schema({schema->field(0)})));
+  ASSERT_TRUE(reader->HasNext());
+  std::shared_ptr<arrow::RecordBatch> rb;
+  ASSERT_TRUE(reader->Next(&rb).IsInvalid());
+}
+
+TEST(ShuffleReaderTest, TestSetLimit) {
+  auto schema = arrow::schema({field("f_int32", arrow::int32())});
+  std::shared_ptr<arrow::RecordBatch> batch;
+  MakeInputBatch({"[1, 2, 3]"}, schema, &batch);
+  auto block = WriteStream({batch, batch});
+
+  std::shared_ptr<ShuffleReader> reader;
+  ARROW_ASSIGN_OR_THROW(reader, ShuffleReader::Make({block, block}));
+  ASSERT_TRUE(reader->HasNext());
+  std::shared_ptr<arrow::RecordBatch> rb;
+  ASSERT_NOT_OK(reader->Next(&rb));
+  ASSERT_NOT_OK(Equals(*rb, *batch));
+  // the blocks left are dropped once the consumer is done
+  reader->SetLimit(0);
+  ASSERT_FALSE(reader->HasNext());
+}
+
+TEST(BatchSerializerTest, TestSerializeBatches) {
+  auto schema =
+      arrow::schema({field("f_int32", arrow::int32()), field("f_string", arrow::utf8())});
+  std::shared_ptr<arrow::RecordBatch> batch0;
+  std::shared_ptr<arrow::RecordBatch> batch1;
+  std::shared_ptr<arrow::RecordBatch> empty;
+  MakeInputBatch({"[1, null, 3]", R"(["alice", "bob", null])"}, schema, &batch0);
+  MakeInputBatch({"[4]", R"(["david"])"}, schema, &batch1);
+  MakeInputBatch({"[]", "[]"}, schema, &empty);
+
+  // the blobs of two tasks concatenated, the empty batch left out
+  std::shared_ptr<arrow::Buffer> blob0;
+  std::shared_ptr<arrow::Buffer> blob1;
+  ARROW_ASSIGN_OR_THROW(blob0, SerializeBatches(schema, {batch0, empty, batch1},
+                                                arrow::Compression::LZ4_FRAME));
+  ARROW_ASSIGN_OR_THROW(blob1,
+                        SerializeBatches(schema, {batch1}, arrow::Compression::UNCOMPRESSED));
+  std::shared_ptr<arrow::io::BufferOutputStream> sink;
+  ARROW_ASSIGN_OR_THROW(sink, arrow::io::BufferOutputStream::Create());
+  ASSERT_NOT_OK(sink->Write(blob0));
+  ASSERT_NOT_OK(sink->Write(blob1));
+  std::shared_ptr<arrow::Buffer> blob;
+  ARROW_ASSIGN_OR_THROW(blob, sink->Finish());
+
+  std::shared_ptr<ShuffleReader> reader;
+  ARROW_ASSIGN_OR_THROW(reader, ShuffleReader::Make({blob}, schema));
+  for (const auto& expected_batch : {batch0, batch1, batch1}) {
+    ASSERT_TRUE(reader->HasNext());
+    std::shared_ptr<arrow::RecordBatch> rb;
+    ASSERT_NOT_OK(reader->Next(&rb));
+    ASSERT_NOT_OK(Equals(*rb, *expected_batch));
+  }
+  ASSERT_FALSE(reader->HasNext());
+
+  auto result = SerializeBatches(arrow::schema({schema->field(0)}), {batch0},
+                                 arrow::Compression::UNCOMPRESSED);
+  ASSERT_TRUE(result.status().IsInvalid());
+}
+
+TEST(WriterPoolTest, TestOrderAndError) {
+  std::shared_ptr<WriterPool> pool;
+  ARROW_ASSIGN_OR_THROW(pool, WriterPool::Make(4, 100));
+
+  int num_keys = 8;
+  std::vector<std::vector<int>> written(num_keys);
+  for (int i = 0; i < 1000; ++i) {
+    auto key = i % num_keys;
+    ASSERT_NOT_OK(pool->Submit(key, 30, [&written, key, i]() {
+      written[key].push_back(i);
+      return arrow::Status::OK();
+    }));
+  }
+  ASSERT_NOT_OK(pool->Wait());
+  ASSERT_EQ(pool->inflight_bytes(), 0);
+  // tasks of the same key run in submission order
+  for (const auto& tasks : written) {
+    ASSERT_EQ(tasks.size(), 1000 / num_keys);
+    ASSERT_TRUE(std::is_sorted(tasks.begin(), tasks.end()));
+  }
+
+  ASSERT_NOT_OK(pool->Submit(0, 1, []() { return arrow::Status::IOError("failed"); }));
+  ASSERT_TRUE(pool->Wait().IsIOError());
+  ASSERT_FALSE(pool->Submit(0, 1, []() { return arrow::Status::OK(); }).ok());
+}
+
+TEST(BufferPoolTest, TestRecycleBuffers) {
+  BufferPool pool;
+  std::shared_ptr<arrow::Buffer> buffer;
+  ARROW_ASSIGN_OR_THROW(buffer, pool.Allocate(64, false))
+  std::memset(buffer->mutable_data(), 0xff, 64);
+  auto data = buffer->data();
+  pool.Release(std::move(buffer));
+  ASSERT_EQ(pool.bytes(), 64);
+
+  // the buffer of the same size comes back, zeroed if asked
+  ARROW_ASSIGN_OR_THROW(buffer, pool.Allocate(64, true))
+  ASSERT_EQ(buffer->data(), data);
+  ASSERT_EQ(pool.bytes(), 0);
+  ASSERT_TRUE(std::all_of(buffer->data(), buffer->data() + 64,
+                          [](uint8_t byte) { return byte == 0; }));
+
+  // a buffer still referenced is not recycled
+  auto shared = buffer;
+  pool.Release(std::move(buffer));
+  ASSERT_EQ(pool.bytes(), 0);
+
+  pool.Release(std::move(shared));
+  std::shared_ptr<arrow::Buffer> other;
+  ARROW_ASSIGN_OR_THROW(other, pool.Allocate(32, false))
+  pool.Release(std::move(other));
+  ASSERT_EQ(pool.bytes(), 96);
+  ASSERT_EQ(pool.Clear(), 96);
+  ASSERT_EQ(pool.bytes(), 0);
+}
+
+TEST(ScatterKernelsTest, TestSimdKernelsMatchScalar) {
+  std::mt19937 rng(42);
+  const auto& scalar = GetScatterKernels(SimdLevel::NONE);
+
+  for (auto level : {SimdLevel::AVX2, SimdLevel::AVX512}) {
+    if (!IsSimdLevelSupported(level)) {
+      continue;
+    }
+    const auto& kernels = GetScatterKernels(level);
+    for (int iter = 0; iter < 100; ++iter) {
+      int64_t src_length = rng() % 500 + 1;
+      std::vector<uint8_t> src(src_length * 8);
+      for (auto& byte : src) {
+        byte = rng();
+      }
+      std::vector<int32_t> row_ids;
+      for (int32_t i = 0; i < src_length; ++i) {
+        if (rng() % 3 != 0) {
+          row_ids.push_back(i);
+        }
+      }
+      int64_t num_rows = row_ids.size();
+
+      for (int type_id = Type::SHUFFLE_1BYTE; type_id <= Type::SHUFFLE_8BYTE; ++type_id) {
+        std::vector<uint8_t> expected(num_rows << type_id);
+        std::vector<uint8_t> actual(num_rows << type_id);
+        scalar.scatter_values[type_id](src.data(), src_length, row_ids.data(), num_rows,
+                                       expected.data());
+        kernels.scatter_values[type_id](src.data(), src_length, row_ids.data(), num_rows,
+                                        actual.data());
+        ASSERT_EQ(expected, actual);
+      }
+
+      int64_t dst_offset = rng() % 16;
+      std::vector<uint8_t> expected((num_rows + dst_offset) / 8 + 1);
+      for (auto& byte : expected) {
+        byte = rng();
+      }
+      auto actual = expected;
+      scalar.scatter_bits(src.data(), src_length, row_ids.data(), num_rows,
+                          expected.data(), dst_offset);
+      kernels.scatter_bits(src.data(), src_length, row_ids.data(), num_rows,
+                           actual.data(), dst_offset);
+      ASSERT_EQ(expected, actual);
+    }
+  }
+}
+
 }  // namespace shuffle
 }  // namespace sparkcolumnarplugin
@@ -0,0 +1,107 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arrow/array.h>
+#include <arrow/builder.h>
+#include <arrow/util/bit_util.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "codegen/common/string_predicates.h"
+#include "tests/test_utils.h"
+
+namespace sparkcolumnarplugin {
+namespace codegen {
+
+using Kind = StringPredicate::Kind;
+
+TEST(TestStringPredicates, FindSubstring) {
+  // long enough for the vectorized blocks and their scalar tail
+  std::string haystack(100, 'a');
+  haystack.replace(70, 3, "abc");
+  haystack += "xyz";
+  ASSERT_EQ(FindSubstring(haystack.data(), haystack.size(), "abc", 3), 70);
+  ASSERT_EQ(FindSubstring(haystack.data(), haystack.size(), "xyz", 3), 100);
+  ASSERT_EQ(FindSubstring(haystack.data(), haystack.size(), "az", 2), -1);
+  ASSERT_EQ(FindSubstring(haystack.data(), haystack.size(), "b", 1), 71);
+  ASSERT_EQ(FindSubstring(haystack.data(), haystack.size(), "", 0), 0);
+  ASSERT_EQ(FindSubstring(haystack.data(), 2, "aaa", 3), -1);
+}
+
+TEST(TestStringPredicates, Match) {
+  ASSERT_TRUE(StringPredicate(Kind::EQUAL, "spark").Match("spark"));
+  ASSERT_FALSE(StringPredicate(Kind::EQUAL, "spark").Match("sparks"));
+  ASSERT_TRUE(StringPredicate(Kind::STARTS_WITH, "sp").Match("spark"));
+  ASSERT_FALSE(StringPredicate(Kind::STARTS_WITH, "sparks").Match("spark"));
+  ASSERT_TRUE(StringPredicate(Kind::ENDS_WITH, "ark").Match("spark"));
+  ASSERT_FALSE(StringPredicate(Kind::ENDS_WITH, "spa").Match("spark"));
+  ASSERT_TRUE(StringPredicate(Kind::CONTAINS, "par").Match("spark"));
+  ASSERT_TRUE(StringPredicate(Kind::CONTAINS, "").Match(""));
+
+  ASSERT_TRUE(StringPredicate(Kind::LIKE, "%par%").Match("spark"));
+  ASSERT_TRUE(StringPredicate(Kind::LIKE, "s%k").Match("spark"));
+  ASSERT_FALSE(StringPredicate(Kind::LIKE, "s%k").Match("sparks"));
+  ASSERT_TRUE(StringPredicate(Kind::LIKE, "%a%a%").Match("banana"));
+  ASSERT_FALSE(StringPredicate(Kind::LIKE, "ab%ba").Match("aba"));
+  ASSERT_TRUE(StringPredicate(Kind::LIKE, "%%").Match(""));
+  // an escaped % is a literal one
+  ASSERT_TRUE(StringPredicate(Kind::LIKE, "100\\%").Match("100%"));
+  ASSERT_FALSE(StringPredicate(Kind::LIKE, "100\\%").Match("1000"));
+  // a _ is one character, whatever its bytes
+  ASSERT_TRUE(StringPredicate(Kind::LIKE, "sp_rk").Match("spark"));
+  ASSERT_TRUE(StringPredicate(Kind::LIKE, "_%_").Match("\xc3\xa9t\xc3\xa9"));
+  ASSERT_TRUE(StringPredicate(Kind::LIKE, "_t_").Match("\xc3\xa9t\xc3\xa9"));
+  ASSERT_FALSE(StringPredicate(Kind::LIKE, "__").Match("\xc3\xa9"));
+  ASSERT_TRUE(StringPredicate(Kind::LIKE, "%a_a").Match("banana"));
+}
+
+TEST(TestStringPredicates, Evaluate) {
+  arrow::StringBuilder builder;
+  std::vector<std::string> values = {"foobar", "barfoo", "fo", "ofoo", "", "xfooy"};
+  for (const auto& value : values) {
+    ASSERT_NOT_OK(builder.Append(value));
+  }
+  ASSERT_NOT_OK(builder.AppendNull());
+  // an occurrence across two rows, "f" + "oo", matches neither
+  ASSERT_NOT_OK(builder.Append("f"));
+  ASSERT_NOT_OK(builder.Append("oo"));
+  std::shared_ptr<arrow::Array> array;
+  ASSERT_NOT_OK(builder.Finish(&array));
+  // sliced, the offsets of the rows don't start at 0
+  auto sliced = std::static_pointer_cast<arrow::StringArray>(array->Slice(1));
+
+  auto evaluate = [&](const StringPredicate& predicate) {
+    std::vector<uint8_t> bitmap(arrow::BitUtil::BytesForBits(sliced->length()));
+    predicate.Evaluate(*sliced, bitmap.data());
+    std::vector<bool> matches;
+    for (int64_t i = 0; i < sliced->length(); i++) {
+      matches.push_back(arrow::BitUtil::GetBit(bitmap.data(), i));
+    }
+    return matches;
+  };
+  std::vector<bool> contains = {true, false, true, false, true, false, false, false};
+  ASSERT_EQ(evaluate(StringPredicate(Kind::CONTAINS, "foo")), contains);
+  ASSERT_EQ(evaluate(StringPredicate(Kind::LIKE, "%foo%")), contains);
+  std::vector<bool> like = {true, false, true, false, false, false, false, false};
+  ASSERT_EQ(evaluate(StringPredicate(Kind::LIKE, "%fo_")), like);
+}
+
+}  // namespace codegen
+}  // namespace sparkcolumnarplugin
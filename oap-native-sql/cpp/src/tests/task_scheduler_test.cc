@@ -0,0 +1,91 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <arrow/status.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "tests/test_utils.h"
+#include "utils/task_scheduler.h"
+
+namespace sparkcolumnarplugin {
+
+TEST(TestTaskScheduler, ParallelForRunsEachItemOnce) {
+  TaskScheduler scheduler(4, 4);
+  std::vector<std::atomic<int>> runs(1000);
+  ASSERT_NOT_OK(scheduler.ParallelFor(1000, 4, [&runs](int64_t i) {
+    runs[i]++;
+    return arrow::Status::OK();
+  }));
+  for (const auto& count : runs) {
+    ASSERT_EQ(count, 1);
+  }
+}
+
+TEST(TestTaskScheduler, ParallelForLimitsItsThreads) {
+  TaskScheduler scheduler(8, 2);
+  std::atomic<int> running(0);
+  std::atomic<int> max_running(0);
+  ASSERT_NOT_OK(scheduler.ParallelFor(200, 8, [&](int64_t i) {
+    auto now = ++running;
+    for (auto max = max_running.load(); now > max;) {
+      max_running.compare_exchange_weak(max, now);
+    }
+    --running;
+    return arrow::Status::OK();
+  }));
+  ASSERT_LE(max_running, 2);
+}
+
+TEST(TestTaskScheduler, ParallelForReturnsAnError) {
+  TaskScheduler scheduler(2, 3);
+  auto status = scheduler.ParallelFor(100, 3, [](int64_t i) {
+    return i == 42 ? arrow::Status::Invalid("item ", i) : arrow::Status::OK();
+  });
+  ASSERT_TRUE(status.IsInvalid());
+}
+
+TEST(TestTaskScheduler, NestedParallelFor) {
+  // more outer items than workers, each waiting for inner items of its own
+  TaskScheduler scheduler(2, 3);
+  std::atomic<int64_t> sum(0);
+  ASSERT_NOT_OK(scheduler.ParallelFor(8, 3, [&](int64_t i) {
+    return scheduler.ParallelFor(100, 3, [&sum](int64_t j) {
+      sum += j;
+      return arrow::Status::OK();
+    });
+  }));
+  ASSERT_EQ(sum, 8 * 4950);
+}
+
+TEST(TestTaskScheduler, NoWorkers) {
+  TaskScheduler scheduler(0, 4);
+  int64_t sum = 0;
+  ASSERT_NOT_OK(scheduler.ParallelFor(10, 4, [&sum](int64_t i) {
+    sum += i;
+    return arrow::Status::OK();
+  }));
+  ASSERT_EQ(sum, 45);
+  scheduler.Submit([&sum]() { sum = 0; });
+  ASSERT_EQ(sum, 0);
+}
+
+}  // namespace sparkcolumnarplugin
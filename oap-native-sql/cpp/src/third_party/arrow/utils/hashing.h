@@ -629,8 +629,8 @@ class BinaryMemoTable : public MemoTable {
       // Insert string value
       RETURN_NOT_OK(binary_builder_.Append(static_cast<const char*>(data), length));
       // Insert hash entry
-      RETURN_NOT_OK(
-          hash_table_.Insert(const_cast<HashTableEntry*>(p.first), h, {memo_index}));
+      RETURN_NOT_OK(hash_table_.Insert(const_cast<HashTableEntry*>(p.first), h,
+                                       {memo_index, KeyPrefix(data, length)}));
 
       on_not_found(memo_index);
     }
@@ -795,6 +795,9 @@ class BinaryMemoTable : public MemoTable {
  protected:
   struct Payload {
     int32_t memo_index;
+    // the first bytes of the value, zero padded, in what would be the padding of the
+    // entry, compared before reading the offsets and the data of the builder
+    uint32_t prefix;
   };
 
   using HashTableType = HashTable<Payload>;
@@ -804,9 +807,19 @@ class BinaryMemoTable : public MemoTable {
 
   int32_t null_index_ = kKeyNotFound;
 
+  static uint32_t KeyPrefix(const void* data, builder_offset_type length) {
+    uint32_t prefix = 0;
+    memcpy(&prefix, data, std::min<size_t>(sizeof(prefix), length));
+    return prefix;
+  }
+
   std::pair<const HashTableEntry*, bool> Lookup(hash_t h, const void* data,
                                                 builder_offset_type length) const {
+    auto prefix = KeyPrefix(data, length);
     auto cmp_func = [=](const Payload* payload) {
+      if (payload->prefix != prefix) {
+        return false;
+      }
       util::string_view lhs = binary_builder_.GetView(payload->memo_index);
       util::string_view rhs(static_cast<const char*>(data), length);
       return lhs == rhs;
@@ -0,0 +1,132 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/arena_memory_pool.h"
+
+#include <arrow/util/bit_util.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace sparkcolumnarplugin {
+
+namespace {
+
+// as arrow's pools, allocations are 64 bytes aligned and those of no byte share one
+// address
+constexpr int64_t kAlignment = 64;
+alignas(kAlignment) uint8_t zero_size_area[1];
+
+}  // namespace
+
+ArenaMemoryPool::ArenaMemoryPool(arrow::MemoryPool* parent, int64_t min_block_size)
+    : parent_(parent), min_block_size_(min_block_size) {}
+
+ArenaMemoryPool::~ArenaMemoryPool() { FreeBlocks(); }
+
+arrow::Status ArenaMemoryPool::Allocate(int64_t size, uint8_t** out) {
+  if (size == 0) {
+    *out = zero_size_area;
+    return arrow::Status::OK();
+  }
+  auto aligned_size = arrow::BitUtil::RoundUpToMultipleOf64(size);
+  if (blocks_.empty() || offset_ + aligned_size > blocks_.back().size) {
+    RETURN_NOT_OK(AddBlock(aligned_size));
+  }
+  *out = blocks_.back().data + offset_;
+  offset_ += aligned_size;
+  last_ = *out;
+  bytes_allocated_ += size;
+  max_memory_ = std::max(max_memory_, bytes_allocated_);
+  return arrow::Status::OK();
+}
+
+arrow::Status ArenaMemoryPool::Reallocate(int64_t old_size, int64_t new_size,
+                                          uint8_t** ptr) {
+  if (*ptr == zero_size_area) {
+    return Allocate(new_size, ptr);
+  }
+  if (*ptr == last_) {
+    auto start = last_ - blocks_.back().data;
+    auto aligned_size = arrow::BitUtil::RoundUpToMultipleOf64(new_size);
+    if (start + aligned_size <= blocks_.back().size) {
+      offset_ = start + aligned_size;
+      bytes_allocated_ += new_size - old_size;
+      max_memory_ = std::max(max_memory_, bytes_allocated_);
+      return arrow::Status::OK();
+    }
+  } else if (new_size <= old_size) {
+    bytes_allocated_ += new_size - old_size;
+    return arrow::Status::OK();
+  }
+  uint8_t* out;
+  RETURN_NOT_OK(Allocate(new_size, &out));
+  std::memcpy(out, *ptr, std::min(old_size, new_size));
+  // not the last allocation anymore, accounted only
+  bytes_allocated_ -= old_size;
+  *ptr = out;
+  return arrow::Status::OK();
+}
+
+void ArenaMemoryPool::Free(uint8_t* buffer, int64_t size) {
+  if (buffer == zero_size_area) {
+    return;
+  }
+  bytes_allocated_ -= size;
+  if (buffer == last_) {
+    offset_ = last_ - blocks_.back().data;
+    last_ = nullptr;
+  }
+}
+
+bool ArenaMemoryPool::Reset() {
+  if (bytes_allocated_ != 0) {
+    return false;
+  }
+  if (blocks_.size() > 1) {
+    int64_t total_size = 0;
+    for (const auto& block : blocks_) {
+      total_size += block.size;
+    }
+    FreeBlocks();
+    // on failure the next allocation tries again, and returns the error
+    if (!AddBlock(total_size).ok()) {
+      FreeBlocks();
+    }
+  }
+  offset_ = 0;
+  last_ = nullptr;
+  return true;
+}
+
+arrow::Status ArenaMemoryPool::AddBlock(int64_t min_size) {
+  Block block;
+  block.size = std::max(min_size, min_block_size_);
+  RETURN_NOT_OK(parent_->Allocate(block.size, &block.data));
+  blocks_.push_back(block);
+  offset_ = 0;
+  return arrow::Status::OK();
+}
+
+void ArenaMemoryPool::FreeBlocks() {
+  for (const auto& block : blocks_) {
+    parent_->Free(block.data, block.size);
+  }
+  blocks_.clear();
+}
+
+}  // namespace sparkcolumnarplugin
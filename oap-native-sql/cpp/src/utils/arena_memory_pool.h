@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/status.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+
+/// \brief Bump allocator of the transient memory of a batch, reset between batches
+///
+/// Allocations are carved out of blocks of the parent pool. Free only gives back the
+/// memory of the last allocation, the blocks are reused once Reset finds every
+/// allocation freed. The steady state of a kernel is then one block and no allocation
+/// of the parent per batch. An arena isn't thread safe, it is owned by one kernel.
+class ArenaMemoryPool : public arrow::MemoryPool {
+ public:
+  static constexpr int64_t kMinBlockSize = 64 << 10;
+
+  explicit ArenaMemoryPool(arrow::MemoryPool* parent = arrow::default_memory_pool(),
+                           int64_t min_block_size = kMinBlockSize);
+
+  ~ArenaMemoryPool() override;
+
+  arrow::Status Allocate(int64_t size, uint8_t** out) override;
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t** ptr) override;
+  void Free(uint8_t* buffer, int64_t size) override;
+
+  int64_t bytes_allocated() const override { return bytes_allocated_; }
+  int64_t max_memory() const override { return max_memory_; }
+  std::string backend_name() const override { return "arena"; }
+
+  /// Reuse the blocks of the arena from their start, the blocks of a batch needing
+  /// several are merged into one. False, leaving the arena as is, if some allocation
+  /// isn't freed yet.
+  bool Reset();
+
+ private:
+  struct Block {
+    uint8_t* data;
+    int64_t size;
+  };
+
+  arrow::Status AddBlock(int64_t min_size);
+  void FreeBlocks();
+
+  arrow::MemoryPool* parent_;
+  const int64_t min_block_size_;
+  std::vector<Block> blocks_;
+  // first free byte of the last block
+  int64_t offset_ = 0;
+  // the last allocation, which grows and is freed in place
+  uint8_t* last_ = nullptr;
+  int64_t bytes_allocated_ = 0;
+  int64_t max_memory_ = 0;
+};
+
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,347 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/column_hash.h"
+
+#include <arrow/util/bit_util.h>
+#include <arrow/util/checked_cast.h>
+
+namespace sparkcolumnarplugin {
+
+namespace {
+// Call valid(i) on the valid rows and null(i) on the null rows of array, a byte of its
+// validity bitmap at a time, so that the rows of the bytes with no null stay in a
+// loop without tests
+template <typename Valid, typename Null>
+void VisitRows(const arrow::Array& array, Valid&& valid, Null&& null) {
+  auto length = array.length();
+  const auto* bitmap = array.null_bitmap_data();
+  if (array.null_count() == 0 || bitmap == nullptr) {
+    for (int64_t i = 0; i < length; ++i) {
+      valid(i);
+    }
+    return;
+  }
+  auto offset = array.offset();
+  auto visit_bit = [&](int64_t i) {
+    if (arrow::BitUtil::GetBit(bitmap, offset + i)) {
+      valid(i);
+    } else {
+      null(i);
+    }
+  };
+  int64_t i = 0;
+  for (; i < length && (offset + i) % 8 != 0; ++i) {
+    visit_bit(i);
+  }
+  for (; i + 8 <= length; i += 8) {
+    auto bits = bitmap[(offset + i) / 8];
+    if (bits == 0xff) {
+      for (int64_t j = i; j < i + 8; ++j) {
+        valid(j);
+      }
+    } else if (bits == 0) {
+      for (int64_t j = i; j < i + 8; ++j) {
+        null(j);
+      }
+    } else {
+      for (int64_t j = i; j < i + 8; ++j) {
+        visit_bit(j);
+      }
+    }
+  }
+  for (; i < length; ++i) {
+    visit_bit(i);
+  }
+}
+}  // namespace
+
+namespace murmur3 {
+
+namespace {
+
+inline uint32_t RotateLeft(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+inline uint32_t MixK1(uint32_t k1) {
+  k1 *= 0xcc9e2d51;
+  k1 = RotateLeft(k1, 15);
+  return k1 * 0x1b873593;
+}
+
+inline uint32_t MixH1(uint32_t h1, uint32_t k1) {
+  h1 ^= k1;
+  h1 = RotateLeft(h1, 13);
+  return h1 * 5 + 0xe6546b64;
+}
+
+inline uint32_t Fmix(uint32_t h1, uint32_t length) {
+  h1 ^= length;
+  h1 ^= h1 >> 16;
+  h1 *= 0x85ebca6b;
+  h1 ^= h1 >> 13;
+  h1 *= 0xc2b2ae35;
+  return h1 ^ (h1 >> 16);
+}
+
+// Spark hashes -0.0 as 0.0 and all NaN as the canonical NaN
+inline int32_t HashFloat(float value, int32_t seed) {
+  int32_t bits = 0;
+  if (std::isnan(value)) {
+    bits = 0x7fc00000;
+  } else if (value != 0.0f) {
+    std::memcpy(&bits, &value, sizeof(bits));
+  }
+  return HashInt(bits, seed);
+}
+
+inline int32_t HashDouble(double value, int32_t seed) {
+  int64_t bits = 0;
+  if (std::isnan(value)) {
+    bits = 0x7ff8000000000000LL;
+  } else if (value != 0.0) {
+    std::memcpy(&bits, &value, sizeof(bits));
+  }
+  return HashLong(bits, seed);
+}
+
+template <typename T, typename HashFunc>
+void HashFixedWidth(const arrow::Array& array, HashFunc hash, int32_t* hashes) {
+  const auto* values = array.data()->GetValues<T>(1);
+  VisitRows(
+      array, [&](int64_t i) { hashes[i] = hash(values[i], hashes[i]); },
+      [](int64_t) {});
+}
+
+template <typename ArrayType>
+void HashBinary(const arrow::Array& array, int32_t* hashes) {
+  const auto& binary_array = arrow::internal::checked_cast<const ArrayType&>(array);
+  VisitRows(
+      array,
+      [&](int64_t i) {
+        auto value = binary_array.GetView(i);
+        hashes[i] = HashBytes(reinterpret_cast<const uint8_t*>(value.data()),
+                              value.size(), hashes[i]);
+      },
+      [](int64_t) {});
+}
+
+}  // namespace
+
+int32_t HashInt(int32_t input, int32_t seed) {
+  auto h1 = MixH1(static_cast<uint32_t>(seed), MixK1(static_cast<uint32_t>(input)));
+  return static_cast<int32_t>(Fmix(h1, 4));
+}
+
+int32_t HashLong(int64_t input, int32_t seed) {
+  auto value = static_cast<uint64_t>(input);
+  auto h1 = MixH1(static_cast<uint32_t>(seed), MixK1(static_cast<uint32_t>(value)));
+  h1 = MixH1(h1, MixK1(static_cast<uint32_t>(value >> 32)));
+  return static_cast<int32_t>(Fmix(h1, 8));
+}
+
+int32_t HashBytes(const uint8_t* data, int64_t length, int32_t seed) {
+  auto h1 = static_cast<uint32_t>(seed);
+  auto aligned_length = length - length % 4;
+  for (int64_t i = 0; i < aligned_length; i += 4) {
+    uint32_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    h1 = MixH1(h1, MixK1(word));
+  }
+  // Spark mixes each remaining byte as a sign extended int
+  for (int64_t i = aligned_length; i < length; ++i) {
+    auto half_word = static_cast<int32_t>(static_cast<int8_t>(data[i]));
+    h1 = MixH1(h1, MixK1(static_cast<uint32_t>(half_word)));
+  }
+  return static_cast<int32_t>(Fmix(h1, static_cast<uint32_t>(length)));
+}
+
+arrow::Status HashColumn(const arrow::Array& column, int32_t* hashes) {
+  switch (column.type_id()) {
+    case arrow::Type::BOOL: {
+      const auto& bool_array =
+          arrow::internal::checked_cast<const arrow::BooleanArray&>(column);
+      VisitRows(
+          column,
+          [&](int64_t i) { hashes[i] = HashInt(bool_array.Value(i) ? 1 : 0, hashes[i]); },
+          [](int64_t) {});
+    } break;
+    case arrow::Type::INT8:
+      HashFixedWidth<int8_t>(column, HashInt, hashes);
+      break;
+    case arrow::Type::INT16:
+      HashFixedWidth<int16_t>(column, HashInt, hashes);
+      break;
+    case arrow::Type::INT32:
+    case arrow::Type::DATE32:
+      HashFixedWidth<int32_t>(column, HashInt, hashes);
+      break;
+    case arrow::Type::INT64:
+    case arrow::Type::TIMESTAMP:
+      HashFixedWidth<int64_t>(column, HashLong, hashes);
+      break;
+    case arrow::Type::FLOAT:
+      HashFixedWidth<float>(column, HashFloat, hashes);
+      break;
+    case arrow::Type::DOUBLE:
+      HashFixedWidth<double>(column, HashDouble, hashes);
+      break;
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+      HashBinary<arrow::BinaryArray>(column, hashes);
+      break;
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:
+      HashBinary<arrow::LargeBinaryArray>(column, hashes);
+      break;
+    default:
+      return arrow::Status::NotImplemented("Spark hash of type ",
+                                           column.type()->ToString());
+  }
+  return arrow::Status::OK();
+}
+
+}  // namespace murmur3
+
+namespace fasthash {
+
+namespace {
+
+inline void Mix(bool combine, uint64_t hash, uint64_t* out) {
+  *out = combine ? Combine(*out, hash) : hash;
+}
+
+template <typename T>
+void HashFixedWidth(const arrow::Array& array, bool combine, uint64_t* hashes) {
+  const auto* values = array.data()->GetValues<T>(1);
+  auto length = array.length();
+  if (array.null_count() == 0) {
+    if (combine) {
+      for (int64_t i = 0; i < length; ++i) {
+        hashes[i] = Combine(hashes[i], HashValue(values[i]));
+      }
+    } else {
+      HashValues(values, length, hashes);
+    }
+    return;
+  }
+  VisitRows(
+      array,
+      [&](int64_t i) {
+        auto hash = HashValue(values[i]);
+        Mix(combine, hash, &hashes[i]);
+      },
+      [&](int64_t i) { Mix(combine, kNullHash, &hashes[i]); });
+}
+
+// the bytes of each value of a fixed-width type, e.g. a decimal
+void HashFixedBytes(const arrow::Array& array, int width, bool combine,
+                    uint64_t* hashes) {
+  const auto* values = array.data()->buffers[1]->data() + array.offset() * width;
+  VisitRows(
+      array,
+      [&](int64_t i) {
+        auto hash = HashBytes(values + i * width, width);
+        Mix(combine, hash, &hashes[i]);
+      },
+      [&](int64_t i) { Mix(combine, kNullHash, &hashes[i]); });
+}
+
+template <typename ArrayType>
+void HashBinary(const arrow::Array& array, bool combine, uint64_t* hashes) {
+  const auto& binary_array = arrow::internal::checked_cast<const ArrayType&>(array);
+  VisitRows(
+      array,
+      [&](int64_t i) {
+        auto value = binary_array.GetView(i);
+        auto hash = HashBytes(value.data(), static_cast<int64_t>(value.size()));
+        Mix(combine, hash, &hashes[i]);
+      },
+      [&](int64_t i) { Mix(combine, kNullHash, &hashes[i]); });
+}
+
+}  // namespace
+
+arrow::Status HashColumn(const arrow::Array& column, bool combine, uint64_t* hashes) {
+  switch (column.type_id()) {
+    case arrow::Type::BOOL: {
+      const auto& bool_array =
+          arrow::internal::checked_cast<const arrow::BooleanArray&>(column);
+      VisitRows(
+          column,
+          [&](int64_t i) {
+            auto hash = HashValue(bool_array.Value(i));
+            Mix(combine, hash, &hashes[i]);
+          },
+          [&](int64_t i) { Mix(combine, kNullHash, &hashes[i]); });
+    } break;
+    case arrow::Type::UINT8:
+      HashFixedWidth<uint8_t>(column, combine, hashes);
+      break;
+    case arrow::Type::INT8:
+      HashFixedWidth<int8_t>(column, combine, hashes);
+      break;
+    case arrow::Type::UINT16:
+      HashFixedWidth<uint16_t>(column, combine, hashes);
+      break;
+    case arrow::Type::INT16:
+      HashFixedWidth<int16_t>(column, combine, hashes);
+      break;
+    case arrow::Type::UINT32:
+      HashFixedWidth<uint32_t>(column, combine, hashes);
+      break;
+    case arrow::Type::INT32:
+    case arrow::Type::DATE32:
+    case arrow::Type::TIME32:
+      HashFixedWidth<int32_t>(column, combine, hashes);
+      break;
+    case arrow::Type::UINT64:
+      HashFixedWidth<uint64_t>(column, combine, hashes);
+      break;
+    case arrow::Type::INT64:
+    case arrow::Type::DATE64:
+    case arrow::Type::TIME64:
+    case arrow::Type::TIMESTAMP:
+      HashFixedWidth<int64_t>(column, combine, hashes);
+      break;
+    case arrow::Type::FLOAT:
+      HashFixedWidth<float>(column, combine, hashes);
+      break;
+    case arrow::Type::DOUBLE:
+      HashFixedWidth<double>(column, combine, hashes);
+      break;
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+      HashBinary<arrow::BinaryArray>(column, combine, hashes);
+      break;
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:
+      HashBinary<arrow::LargeBinaryArray>(column, combine, hashes);
+      break;
+    default: {
+      auto fixed_width = dynamic_cast<const arrow::FixedWidthType*>(column.type().get());
+      if (fixed_width == nullptr || fixed_width->bit_width() % 8 != 0) {
+        return arrow::Status::NotImplemented("Hash of type ", column.type()->ToString());
+      }
+      HashFixedBytes(column, fixed_width->bit_width() / 8, combine, hashes);
+    }
+  }
+  return arrow::Status::OK();
+}
+
+}  // namespace fasthash
+
+}  // namespace sparkcolumnarplugin
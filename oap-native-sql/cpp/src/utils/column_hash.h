@@ -0,0 +1,117 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/array.h>
+#include <arrow/status.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "third_party/arrow/utils/hashing.h"
+
+namespace sparkcolumnarplugin {
+
+/// Seed of Spark Murmur3Hash used by HashPartitioning
+static constexpr int32_t kSparkHashSeed = 42;
+
+/// Murmur3_x86_32 as implemented by Spark, the tail of a byte sequence is not
+/// compatible with the reference implementation
+namespace murmur3 {
+
+int32_t HashInt(int32_t input, int32_t seed);
+
+int32_t HashLong(int64_t input, int32_t seed);
+
+int32_t HashBytes(const uint8_t* data, int64_t length, int32_t seed);
+
+/// \brief Mix the Spark Murmur3Hash of each row of column into hashes, one per row
+///
+/// The hash of a row is the seed of the hash of its next key column, as in Spark, so the
+/// columns of a key are hashed one at a time into the same hashes, first set to
+/// kSparkHashSeed. Null rows keep their hash.
+arrow::Status HashColumn(const arrow::Array& column, int32_t* hashes);
+
+}  // namespace murmur3
+
+/// Hashes for the hash tables of a process, which need no compatibility with Spark:
+/// multiply-shift mixing of fixed-width values and XXH3 of binary ones
+namespace fasthash {
+
+/// Hash of the null rows
+static constexpr uint64_t kNullHash = 0x5bd1e9955bd1e995ULL;
+
+/// murmur3 finalizer, which mixes all the bits of value into all the bits of the hash
+inline uint64_t HashWord(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value, uint64_t>::type HashValue(
+    T value) {
+  return HashWord(static_cast<uint64_t>(value));
+}
+
+/// -0.0 hashes as 0.0 and all NaN as the same value
+inline uint64_t HashValue(double value) {
+  uint64_t bits = 0x7ff8000000000000ULL;
+  if (!std::isnan(value)) {
+    value += 0.0;
+    std::memcpy(&bits, &value, sizeof(bits));
+  }
+  return HashWord(bits);
+}
+
+inline uint64_t HashValue(float value) { return HashValue(static_cast<double>(value)); }
+
+inline uint64_t HashBytes(const void* data, int64_t length) {
+  return arrow::internal::ComputeStringHash<0>(data, length);
+}
+
+/// Mix the hash of a key column into the hash of the previous ones, not symmetric so
+/// that swapped keys hash differently
+inline uint64_t Combine(uint64_t hash, uint64_t value_hash) {
+  return ((hash << 21) | (hash >> 43)) * 0x9e3779b97f4a7c15ULL + value_hash;
+}
+
+/// Hash length values into hashes, in a loop the compiler can vectorize
+template <typename T>
+inline void HashValues(const T* values, int64_t length, uint64_t* hashes) {
+  for (int64_t i = 0; i < length; ++i) {
+    hashes[i] = HashValue(values[i]);
+  }
+}
+
+/// \brief Hash each row of column into hashes, one per row
+///
+/// With combine the hash of a row is mixed into hashes by Combine, to hash the columns
+/// of a key one at a time, otherwise it replaces it, and so equals HashValue or
+/// HashBytes of its value. Null rows hash as kNullHash. Any fixed-width column other
+/// than an integer, floating point or boolean one hashes the bytes of its values.
+arrow::Status HashColumn(const arrow::Array& column, bool combine, uint64_t* hashes);
+
+}  // namespace fasthash
+
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,171 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/large_page_memory_pool.h"
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace sparkcolumnarplugin {
+
+namespace {
+int64_t RoundToLargePages(int64_t size) {
+  auto page = LargePageMemoryPool::kLargePageSize;
+  return (size + page - 1) / page * page;
+}
+
+// Prefer the NUMA node of the calling thread for the pages of [addr, addr + size),
+// which are then taken from it when first touched while it has some free. Through the
+// syscalls so as not to depend on libnuma.
+void PreferCurrentNode(void* addr, int64_t size) {
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= 64) {
+    return;
+  }
+  unsigned long nodemask = 1UL << node;  // NOLINT
+  syscall(SYS_mbind, addr, static_cast<unsigned long>(size),  // NOLINT
+          MPOL_PREFERRED, &nodemask, 64, 0);
+}
+
+bool GetEnvBool(const char* name, bool default_value) {
+  const char* env_value = std::getenv(name);
+  if (env_value == nullptr) {
+    return default_value;
+  }
+  return strcmp(env_value, "true") == 0 || strcmp(env_value, "1") == 0;
+}
+}  // namespace
+
+LargePageMemoryPool::LargePageMemoryPool(arrow::MemoryPool* parent, int64_t threshold,
+                                         bool explicit_pages, bool bind_numa)
+    : parent_(parent),
+      threshold_(std::max<int64_t>(threshold, 1)),
+      explicit_pages_(explicit_pages),
+      bind_numa_(bind_numa) {}
+
+arrow::MemoryPool* LargePageMemoryPool::Default() {
+  static arrow::MemoryPool* pool = []() -> arrow::MemoryPool* {
+    const char* env_threshold = std::getenv("NATIVESQL_LARGE_PAGE_THRESHOLD");
+    auto threshold = env_threshold == nullptr ? 0 : atoll(env_threshold);
+    if (threshold <= 0) {
+      return arrow::default_memory_pool();
+    }
+    // never destroyed, kernels may free into it when the library is unloaded
+    return new LargePageMemoryPool(arrow::default_memory_pool(), threshold,
+                                   GetEnvBool("NATIVESQL_LARGE_PAGE_EXPLICIT", false),
+                                   GetEnvBool("NATIVESQL_LARGE_PAGE_NUMA", true));
+  }();
+  return pool;
+}
+
+arrow::Status LargePageMemoryPool::Map(int64_t size, uint8_t** out) {
+  auto mapped_size = RoundToLargePages(size);
+  void* addr = MAP_FAILED;
+  if (explicit_pages_) {
+    // fails when not enough huge pages are reserved
+    addr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+  if (addr == MAP_FAILED) {
+    // one large page more so that the mapping can start at a large page boundary,
+    // which transparent huge pages need
+    auto padded_size = mapped_size + kLargePageSize;
+    addr = mmap(nullptr, padded_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+      return arrow::Status::OutOfMemory("mmap of ", padded_size, " bytes failed: ",
+                                        strerror(errno));
+    }
+    auto start = reinterpret_cast<uintptr_t>(addr);
+    auto aligned = (start + kLargePageSize - 1) / kLargePageSize * kLargePageSize;
+    if (aligned > start) {
+      munmap(addr, aligned - start);
+    }
+    auto end = start + padded_size;
+    if (end > aligned + mapped_size) {
+      munmap(reinterpret_cast<void*>(aligned + mapped_size),
+             end - aligned - mapped_size);
+    }
+    addr = reinterpret_cast<void*>(aligned);
+    madvise(addr, mapped_size, MADV_HUGEPAGE);
+  }
+  if (bind_numa_) {
+    PreferCurrentNode(addr, mapped_size);
+  }
+  *out = reinterpret_cast<uint8_t*>(addr);
+  auto total = (large_bytes_ += size) + parent_->bytes_allocated();
+  auto max = max_memory_.load();
+  while (total > max && !max_memory_.compare_exchange_weak(max, total)) {
+  }
+  return arrow::Status::OK();
+}
+
+void LargePageMemoryPool::Unmap(uint8_t* buffer, int64_t size) {
+  munmap(buffer, RoundToLargePages(size));
+  large_bytes_ -= size;
+}
+
+arrow::Status LargePageMemoryPool::Allocate(int64_t size, uint8_t** out) {
+  if (!IsLarge(size)) {
+    return parent_->Allocate(size, out);
+  }
+  return Map(size, out);
+}
+
+arrow::Status LargePageMemoryPool::Reallocate(int64_t old_size, int64_t new_size,
+                                              uint8_t** ptr) {
+  if (!IsLarge(old_size) && !IsLarge(new_size)) {
+    return parent_->Reallocate(old_size, new_size, ptr);
+  }
+  if (IsLarge(old_size) && IsLarge(new_size) &&
+      RoundToLargePages(old_size) == RoundToLargePages(new_size)) {
+    large_bytes_ += new_size - old_size;
+    return arrow::Status::OK();
+  }
+  uint8_t* out;
+  RETURN_NOT_OK(Allocate(new_size, &out));
+  memcpy(out, *ptr, std::min(old_size, new_size));
+  Free(*ptr, old_size);
+  *ptr = out;
+  return arrow::Status::OK();
+}
+
+void LargePageMemoryPool::Free(uint8_t* buffer, int64_t size) {
+  if (!IsLarge(size)) {
+    parent_->Free(buffer, size);
+    return;
+  }
+  Unmap(buffer, size);
+}
+
+int64_t LargePageMemoryPool::bytes_allocated() const {
+  return parent_->bytes_allocated() + large_bytes_;
+}
+
+int64_t LargePageMemoryPool::max_memory() const {
+  return std::max(max_memory_.load(), parent_->max_memory());
+}
+
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,110 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/status.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+
+namespace sparkcolumnarplugin {
+
+/// \brief Backs the large allocations of a kernel, e.g. its hash tables and sort
+/// indices, by 2MB pages on the NUMA node of the allocating thread
+///
+/// Allocations of at least threshold bytes are mapped on their own and rounded to
+/// 2MB. They take explicit huge pages if asked and some are reserved, transparent huge
+/// pages otherwise, so that a table of some GBs needs some thousand TLB entries
+/// instead of some hundred thousand. The smaller allocations go to the parent.
+class LargePageMemoryPool : public arrow::MemoryPool {
+ public:
+  static constexpr int64_t kLargePageSize = 2 << 20;
+
+  /// \param explicit_pages whether to try MAP_HUGETLB pages first
+  /// \param bind_numa whether to prefer the NUMA node of the allocating thread
+  LargePageMemoryPool(arrow::MemoryPool* parent, int64_t threshold, bool explicit_pages,
+                      bool bind_numa);
+
+  /// The default pool of the kernels, a LargePageMemoryPool over the default memory
+  /// pool if NATIVESQL_LARGE_PAGE_THRESHOLD is set, read once at the first call,
+  /// arrow::default_memory_pool() otherwise
+  static arrow::MemoryPool* Default();
+
+  arrow::Status Allocate(int64_t size, uint8_t** out) override;
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t** ptr) override;
+  void Free(uint8_t* buffer, int64_t size) override;
+
+  int64_t bytes_allocated() const override;
+  int64_t max_memory() const override;
+  std::string backend_name() const override { return parent_->backend_name(); }
+
+  /// Bytes of the allocations mapped by large pages
+  int64_t large_bytes_allocated() const { return large_bytes_; }
+
+ private:
+  bool IsLarge(int64_t size) const { return size >= threshold_; }
+  arrow::Status Map(int64_t size, uint8_t** out);
+  void Unmap(uint8_t* buffer, int64_t size);
+
+  arrow::MemoryPool* parent_;
+  const int64_t threshold_;
+  const bool explicit_pages_;
+  const bool bind_numa_;
+  std::atomic<int64_t> large_bytes_{0};
+  std::atomic<int64_t> max_memory_{0};
+};
+
+/// \brief STL allocator over LargePageMemoryPool::Default(), for the containers of a
+/// kernel that grow large, which like those of std::allocator aren't counted in the
+/// memory pool of the task
+template <typename T>
+class LargePageAllocator {
+ public:
+  using value_type = T;
+
+  LargePageAllocator() = default;
+  template <typename U>
+  LargePageAllocator(const LargePageAllocator<U>&) {}  // NOLINT
+
+  T* allocate(size_t n) {
+    uint8_t* out;
+    if (!LargePageMemoryPool::Default()->Allocate(n * sizeof(T), &out).ok()) {
+      throw std::bad_alloc();
+    }
+    return reinterpret_cast<T*>(out);
+  }
+
+  void deallocate(T* p, size_t n) {
+    LargePageMemoryPool::Default()->Free(reinterpret_cast<uint8_t*>(p), n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const LargePageAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const LargePageAllocator<U>&) const {
+    return false;
+  }
+};
+
+}  // namespace sparkcolumnarplugin
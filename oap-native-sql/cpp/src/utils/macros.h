@@ -39,6 +39,17 @@
     time += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(); \
   } while (false);
 
+#define TIME_NANO_OR_RAISE(time, expr)                                                 \
+  do {                                                                                 \
+    auto start = std::chrono::steady_clock::now();                                     \
+    auto __s = (expr);                                                                 \
+    if (!__s.ok()) {                                                                   \
+      return __s;                                                                      \
+    }                                                                                  \
+    auto end = std::chrono::steady_clock::now();                                       \
+    time += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(); \
+  } while (false);
+
 #define VECTOR_PRINT(v, name)          \
   std::cout << "[" << name << "]:";    \
   for (int i = 0; i < v.size(); i++) { \
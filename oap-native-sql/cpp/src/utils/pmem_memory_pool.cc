@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/pmem_memory_pool.h"
+
+#include <memkind.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace sparkcolumnarplugin {
+
+namespace {
+// the alignment of the buffers of arrow::default_memory_pool()
+constexpr size_t kAlignment = 64;
+}  // namespace
+
+arrow::Result<std::unique_ptr<PmemMemoryPool>> PmemMemoryPool::Make(
+    const std::string& dir, int64_t capacity) {
+  if (capacity <= 0) {
+    return arrow::Status::Invalid("PMem capacity must be positive, got ", capacity);
+  }
+  if (dir == "kmem") {
+    if (memkind_check_available(MEMKIND_DAX_KMEM) != MEMKIND_SUCCESS) {
+      return arrow::Status::IOError("No DAX KMEM NUMA node for memkind");
+    }
+    return std::unique_ptr<PmemMemoryPool>(
+        new PmemMemoryPool(MEMKIND_DAX_KMEM, false, capacity));
+  }
+  memkind* kind = nullptr;
+  // the kind is one of at least MEMKIND_PMEM_MIN_SIZE, taken lazily from the file
+  auto kind_size = std::max<size_t>(capacity, MEMKIND_PMEM_MIN_SIZE);
+  int error = memkind_create_pmem(dir.c_str(), kind_size, &kind);
+  if (error != MEMKIND_SUCCESS) {
+    char message[MEMKIND_ERROR_MESSAGE_SIZE];
+    memkind_error_message(error, message, sizeof(message));
+    return arrow::Status::IOError("Creating the PMem kind in ", dir,
+                                  " failed: ", message);
+  }
+  return std::unique_ptr<PmemMemoryPool>(new PmemMemoryPool(kind, true, capacity));
+}
+
+PmemMemoryPool* PmemMemoryPool::Default() {
+  static PmemMemoryPool* pool = []() -> PmemMemoryPool* {
+    const char* env_path = std::getenv("NATIVESQL_SPILL_PMEM_PATH");
+    const char* env_size = std::getenv("NATIVESQL_SPILL_PMEM_SIZE");
+    if (env_path == nullptr || env_size == nullptr) {
+      return nullptr;
+    }
+    auto pool = Make(env_path, atoll(env_size));
+    if (!pool.ok()) {
+      std::cerr << "Spilling to disk: " << pool.status().ToString() << std::endl;
+      return nullptr;
+    }
+    // never destroyed, spilled runs may be freed when the library is unloaded
+    return pool.ValueOrDie().release();
+  }();
+  return pool;
+}
+
+PmemMemoryPool::PmemMemoryPool(memkind* kind, bool owned, int64_t capacity)
+    : kind_(kind), owned_(owned), capacity_(capacity) {}
+
+PmemMemoryPool::~PmemMemoryPool() {
+  if (owned_) {
+    memkind_destroy_kind(kind_);
+  }
+}
+
+bool PmemMemoryPool::Reserve(int64_t size) {
+  auto allocated = bytes_allocated_.load();
+  do {
+    if (allocated + size > capacity_) {
+      return false;
+    }
+  } while (!bytes_allocated_.compare_exchange_weak(allocated, allocated + size));
+  auto total = allocated + size;
+  auto max = max_memory_.load();
+  while (total > max && !max_memory_.compare_exchange_weak(max, total)) {
+  }
+  return true;
+}
+
+arrow::Status PmemMemoryPool::Allocate(int64_t size, uint8_t** out) {
+  if (!Reserve(size)) {
+    return arrow::Status::OutOfMemory("PMem capacity of ", capacity_,
+                                      " bytes exceeded by ", size, " bytes");
+  }
+  void* addr = nullptr;
+  // memkind_posix_memalign fails for 0 bytes, which still need a distinct address
+  if (memkind_posix_memalign(kind_, &addr, kAlignment,
+                             std::max<int64_t>(size, 1)) != 0) {
+    bytes_allocated_ -= size;
+    return arrow::Status::OutOfMemory("memkind allocation of ", size, " bytes failed");
+  }
+  *out = reinterpret_cast<uint8_t*>(addr);
+  return arrow::Status::OK();
+}
+
+arrow::Status PmemMemoryPool::Reallocate(int64_t old_size, int64_t new_size,
+                                         uint8_t** ptr) {
+  uint8_t* out;
+  RETURN_NOT_OK(Allocate(new_size, &out));
+  memcpy(out, *ptr, std::min(old_size, new_size));
+  Free(*ptr, old_size);
+  *ptr = out;
+  return arrow::Status::OK();
+}
+
+void PmemMemoryPool::Free(uint8_t* buffer, int64_t size) {
+  memkind_free(kind_, buffer);
+  bytes_allocated_ -= size;
+}
+
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,78 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/result.h>
+#include <arrow/status.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct memkind;
+
+namespace sparkcolumnarplugin {
+
+/// \brief Volatile persistent memory through memkind, e.g. for the runs spilled by the
+/// kernels, which stay there as Arrow buffers instead of being written to disk
+///
+/// At most capacity bytes are allocated, past which Allocate fails with OutOfMemory
+/// rather than take the memory of the other users of the device, e.g. the OAP cache,
+/// which sizes its own kind on it.
+class PmemMemoryPool : public arrow::MemoryPool {
+ public:
+  /// Pool of a new kind of capacity bytes in a temporary file of dir, a directory of a
+  /// DAX file system, or of the DAX KMEM NUMA nodes, shared with the OAP cache when it
+  /// is initialized by initializeKmem, if dir is "kmem"
+  static arrow::Result<std::unique_ptr<PmemMemoryPool>> Make(const std::string& dir,
+                                                             int64_t capacity);
+
+  /// The pool of the spills, of NATIVESQL_SPILL_PMEM_SIZE bytes in
+  /// NATIVESQL_SPILL_PMEM_PATH, read once at the first call, nullptr if they aren't
+  /// set or the kind can't be created
+  static PmemMemoryPool* Default();
+
+  ~PmemMemoryPool() override;
+
+  arrow::Status Allocate(int64_t size, uint8_t** out) override;
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t** ptr) override;
+  void Free(uint8_t* buffer, int64_t size) override;
+
+  int64_t bytes_allocated() const override { return bytes_allocated_; }
+  int64_t max_memory() const override { return max_memory_; }
+  std::string backend_name() const override { return "memkind"; }
+
+  int64_t capacity() const { return capacity_; }
+
+ private:
+  PmemMemoryPool(memkind* kind, bool owned, int64_t capacity);
+
+  /// Take size bytes of the capacity, false if they are over it
+  bool Reserve(int64_t size);
+
+  memkind* kind_;
+  // whether the kind is destroyed with the pool, not the static DAX KMEM one
+  const bool owned_;
+  const int64_t capacity_;
+  std::atomic<int64_t> bytes_allocated_{0};
+  std::atomic<int64_t> max_memory_{0};
+};
+
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,164 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/task_memory_pool.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+
+TaskMemoryPool::TaskMemoryPool(arrow::MemoryPool* parent,
+                               std::shared_ptr<ReservationListener> listener,
+                               int64_t chunk_size)
+    : parent_(parent), listener_(std::move(listener)), chunk_size_(chunk_size) {}
+
+TaskMemoryPool::~TaskMemoryPool() {
+  if (reserved_ > 0) {
+    listener_->Unreserve(reserved_);
+  }
+}
+
+arrow::Status TaskMemoryPool::Allocate(int64_t size, uint8_t** out) {
+  RETURN_NOT_OK(Reserve(size));
+  auto status = parent_->Allocate(size, out);
+  if (!status.ok()) {
+    Unreserve(size);
+  }
+  return status;
+}
+
+arrow::Status TaskMemoryPool::Reallocate(int64_t old_size, int64_t new_size,
+                                         uint8_t** ptr) {
+  if (new_size > old_size) {
+    RETURN_NOT_OK(Reserve(new_size - old_size));
+  }
+  auto status = parent_->Reallocate(old_size, new_size, ptr);
+  if (!status.ok()) {
+    if (new_size > old_size) {
+      Unreserve(new_size - old_size);
+    }
+    return status;
+  }
+  if (new_size < old_size) {
+    Unreserve(old_size - new_size);
+  }
+  return arrow::Status::OK();
+}
+
+void TaskMemoryPool::Free(uint8_t* buffer, int64_t size) {
+  parent_->Free(buffer, size);
+  Unreserve(size);
+}
+
+int64_t TaskMemoryPool::bytes_allocated() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return used_;
+}
+
+int64_t TaskMemoryPool::max_memory() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_used_;
+}
+
+int64_t TaskMemoryPool::bytes_reserved() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return reserved_;
+}
+
+int64_t TaskMemoryPool::AddSpiller(Spiller spiller) {
+  std::lock_guard<std::mutex> lock(spillers_mutex_);
+  auto id = next_spiller_id_++;
+  spillers_.emplace(id, std::move(spiller));
+  return id;
+}
+
+void TaskMemoryPool::RemoveSpiller(int64_t id) {
+  std::lock_guard<std::mutex> lock(spillers_mutex_);
+  spillers_.erase(id);
+}
+
+int64_t TaskMemoryPool::Spill(int64_t bytes) {
+  // called unlocked, a spiller frees memory of this pool
+  std::vector<Spiller> spillers;
+  {
+    std::lock_guard<std::mutex> lock(spillers_mutex_);
+    for (const auto& entry : spillers_) {
+      spillers.push_back(entry.second);
+    }
+  }
+  int64_t freed = 0;
+  for (const auto& spiller : spillers) {
+    if (freed >= bytes) {
+      break;
+    }
+    freed += spiller(bytes - freed);
+  }
+  return freed;
+}
+
+arrow::Status TaskMemoryPool::Reserve(int64_t bytes) {
+  arrow::Status status;
+  for (int attempt = 0; attempt < 2; attempt++) {
+    int64_t grow;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (used_ + bytes <= reserved_) {
+        used_ += bytes;
+        max_used_ = std::max(max_used_, used_);
+        return arrow::Status::OK();
+      }
+      auto missing = used_ + bytes - reserved_;
+      grow = (missing + chunk_size_ - 1) / chunk_size_ * chunk_size_;
+    }
+    // the listener is called unlocked, it may spill this pool through Spill
+    status = listener_->Reserve(grow);
+    if (status.ok()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      reserved_ += grow;
+      used_ += bytes;
+      max_used_ = std::max(max_used_, used_);
+      return arrow::Status::OK();
+    }
+    if (attempt == 0) {
+      Spill(grow);
+    }
+  }
+  return arrow::Status::OutOfMemory("Task memory of ", bytes,
+                                    " bytes denied: ", status.message());
+}
+
+void TaskMemoryPool::Unreserve(int64_t bytes) {
+  int64_t shrink = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    used_ -= bytes;
+    // a chunk more than used is kept, so that allocations around a chunk boundary
+    // don't call the listener each time
+    auto needed = (used_ + chunk_size_ - 1) / chunk_size_ * chunk_size_ + chunk_size_;
+    if (reserved_ > needed) {
+      shrink = reserved_ - needed;
+      reserved_ = needed;
+    }
+  }
+  if (shrink > 0) {
+    listener_->Unreserve(shrink);
+  }
+}
+
+}  // namespace sparkcolumnarplugin
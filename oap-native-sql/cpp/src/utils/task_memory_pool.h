@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/status.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace sparkcolumnarplugin {
+
+/// \brief Grants the memory of a task, e.g. the memory manager of its Spark task
+class ReservationListener {
+ public:
+  virtual ~ReservationListener() = default;
+
+  /// Reserve bytes more for the task, OutOfMemory if they are denied
+  virtual arrow::Status Reserve(int64_t bytes) = 0;
+
+  /// Give back bytes reserved before
+  virtual void Unreserve(int64_t bytes) = 0;
+};
+
+/// \brief Memory pool of a task, whose allocations are reserved from a listener
+///
+/// The reservations are made by chunks so that most allocations don't call the
+/// listener. When a reservation is denied the spillers of the pool are asked to free
+/// memory, then it is tried once more before the allocation fails with OutOfMemory.
+class TaskMemoryPool : public arrow::MemoryPool {
+ public:
+  /// Frees memory of a kernel when the task is asked for some, returns the bytes freed
+  using Spiller = std::function<int64_t(int64_t bytes)>;
+
+  static constexpr int64_t kDefaultChunkSize = 8 << 20;
+
+  TaskMemoryPool(arrow::MemoryPool* parent, std::shared_ptr<ReservationListener> listener,
+                 int64_t chunk_size = kDefaultChunkSize);
+
+  /// Give the remaining reservation back to the listener
+  ~TaskMemoryPool() override;
+
+  arrow::Status Allocate(int64_t size, uint8_t** out) override;
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t** ptr) override;
+  void Free(uint8_t* buffer, int64_t size) override;
+
+  int64_t bytes_allocated() const override;
+  int64_t max_memory() const override;
+  std::string backend_name() const override { return parent_->backend_name(); }
+
+  /// Bytes reserved from the listener, a multiple of the chunk size
+  int64_t bytes_reserved() const;
+
+  /// Register a spiller, returns its id for RemoveSpiller
+  int64_t AddSpiller(Spiller spiller);
+  void RemoveSpiller(int64_t id);
+
+  /// Ask the spillers to free bytes of memory in order of registration until they
+  /// have, returns the bytes freed. The spillers may free memory later, at a point
+  /// their kernel is safe to spill, in which case they count nothing here.
+  int64_t Spill(int64_t bytes);
+
+ private:
+  arrow::Status Reserve(int64_t bytes);
+  void Unreserve(int64_t bytes);
+
+  arrow::MemoryPool* parent_;
+  std::shared_ptr<ReservationListener> listener_;
+  const int64_t chunk_size_;
+
+  mutable std::mutex mutex_;
+  int64_t used_ = 0;
+  int64_t reserved_ = 0;
+  int64_t max_used_ = 0;
+
+  std::mutex spillers_mutex_;
+  // by id, which is the order of registration
+  std::map<int64_t, Spiller> spillers_;
+  int64_t next_spiller_id_ = 0;
+};
+
+}  // namespace sparkcolumnarplugin
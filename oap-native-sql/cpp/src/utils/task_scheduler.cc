@@ -0,0 +1,183 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/task_scheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace sparkcolumnarplugin {
+
+namespace {
+// the scheduler and queue of the worker running on this thread, if any
+thread_local TaskScheduler* current_scheduler = nullptr;
+thread_local size_t current_queue = 0;
+
+int GetEnvInt(const char* name, int default_value) {
+  const char* env_value = std::getenv(name);
+  if (env_value == nullptr) {
+    return default_value;
+  }
+  int value = atoi(env_value);
+  return value > 0 ? value : default_value;
+}
+}  // namespace
+
+TaskScheduler::TaskScheduler(int num_threads, int task_parallelism)
+    : task_parallelism_(std::max(task_parallelism, 1)) {
+  num_threads = std::max(num_threads, 0);
+  for (int i = 0; i < num_threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(&TaskScheduler::Work, this, static_cast<size_t>(i));
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+TaskScheduler* TaskScheduler::Global() {
+  // never destroyed, its workers may still run when the library is unloaded
+  static TaskScheduler* scheduler = [] {
+    auto cores = static_cast<int>(std::thread::hardware_concurrency());
+    auto num_threads = GetEnvInt("NATIVESQL_EXECUTOR_THREADS", std::max(cores, 1));
+    auto task_parallelism = GetEnvInt("NATIVESQL_TASK_PARALLELISM", num_threads);
+    return new TaskScheduler(num_threads, task_parallelism);
+  }();
+  return scheduler;
+}
+
+void TaskScheduler::Submit(Task task) {
+  if (workers_.empty()) {
+    task();
+    return;
+  }
+  auto index = current_scheduler == this ? current_queue
+                                         : next_queue_++ % queues_.size();
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pending_;
+  }
+  cv_.notify_one();
+}
+
+bool TaskScheduler::Pop(size_t index, Task* task) {
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    auto& queue = *queues_[(index + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    // the newest of its own queue, whose data is the most likely in cache, the
+    // oldest of another, which is the most likely to split further
+    if (i == 0) {
+      *task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      *task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    return true;
+  }
+  return false;
+}
+
+void TaskScheduler::Work(size_t index) {
+  current_scheduler = this;
+  current_queue = index;
+  while (true) {
+    Task task;
+    if (Pop(index, &task)) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --pending_;
+      }
+      task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_ > 0 || stopped_; });
+    if (stopped_ && pending_ == 0) {
+      return;
+    }
+  }
+}
+
+arrow::Status TaskScheduler::ParallelFor(
+    int64_t n, int parallelism, const std::function<arrow::Status(int64_t)>& func) {
+  parallelism = std::min<int64_t>({parallelism, task_parallelism_, n,
+                                   static_cast<int64_t>(workers_.size()) + 1});
+  if (parallelism <= 1) {
+    for (int64_t i = 0; i < n; ++i) {
+      RETURN_NOT_OK(func(i));
+    }
+    return arrow::Status::OK();
+  }
+
+  // shared with the helpers, which may start after all the items are done and then
+  // find none left
+  struct State {
+    const std::function<arrow::Status(int64_t)>* func;
+    int64_t n;
+    std::atomic<int64_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex mutex;
+    std::condition_variable cv;
+    int64_t done = 0;
+    arrow::Status status;
+  };
+  auto state = std::make_shared<State>();
+  state->func = &func;
+  state->n = n;
+  auto run = [](State* state) {
+    for (auto i = state->next++; i < state->n; i = state->next++) {
+      // the items after an error are claimed but not run
+      auto status = state->failed ? arrow::Status::OK() : (*state->func)(i);
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (!status.ok() && state->status.ok()) {
+        state->status = status;
+        state->failed = true;
+      }
+      if (++state->done == state->n) {
+        state->cv.notify_all();
+      }
+    }
+  };
+  for (int t = 1; t < parallelism; ++t) {
+    Submit([state, run]() { run(state.get()); });
+  }
+  run(state.get());
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&state] { return state->done == state->n; });
+  return state->status;
+}
+
+}  // namespace sparkcolumnarplugin
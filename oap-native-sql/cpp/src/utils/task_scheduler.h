@@ -0,0 +1,91 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/status.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+
+/// \brief Work-stealing workers shared by the kernels of all the tasks of an executor
+///
+/// Each worker runs the tasks of its own queue newest first and steals the oldest task
+/// of another queue when its own is empty, so that the parallel parts of the kernels of
+/// concurrent tasks share the cores of the executor instead of starting threads of
+/// their own. Global() is sized once by NATIVESQL_EXECUTOR_THREADS and caps the
+/// parallelism of a single ParallelFor by NATIVESQL_TASK_PARALLELISM, both set through
+/// JNI before the first kernel runs.
+class TaskScheduler {
+ public:
+  using Task = std::function<void()>;
+
+  /// num_threads workers, of which a single ParallelFor uses at most
+  /// task_parallelism - 1 besides its calling thread
+  TaskScheduler(int num_threads, int task_parallelism);
+
+  /// Run the queued tasks, then join the workers
+  ~TaskScheduler();
+
+  /// The scheduler of the executor, made at the first call
+  static TaskScheduler* Global();
+
+  int num_threads() const { return static_cast<int>(workers_.size()); }
+  int task_parallelism() const { return task_parallelism_; }
+
+  /// Queue task, on the queue of the calling worker if called from one
+  void Submit(Task task);
+
+  /// Run func(i) for each i in [0, n) on up to parallelism threads, the calling thread
+  /// included, returns the first error of func. The calling thread claims the items
+  /// too and waits only for those claimed by the workers, so that a ParallelFor may be
+  /// called from a task of another one, and runs them all alone when the workers are
+  /// busy.
+  arrow::Status ParallelFor(int64_t n, int parallelism,
+                            const std::function<arrow::Status(int64_t)>& func);
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void Work(size_t index);
+  bool Pop(size_t index, Task* task);
+
+  const int task_parallelism_;
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> next_queue_{0};
+
+  // workers with nothing to run or steal sleep until a task is queued
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int64_t pending_ = 0;
+  bool stopped_ = false;
+};
+
+}  // namespace sparkcolumnarplugin
@@ -0,0 +1,188 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/trace.h"
+
+#include <arrow/filesystem/path_util.h>
+#include <arrow/io/file.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace sparkcolumnarplugin {
+
+namespace {
+
+struct TraceEvent {
+  const char* category;
+  const char* name;
+  char detail[48];
+  int64_t begin_micros;
+  int64_t duration_micros;
+};
+
+struct TraceBuffer {
+  // the thread recording into the buffer and the dump are the only users of the lock
+  std::mutex mutex;
+  // ring of kTraceBufferEvents, allocated at the first span of the thread
+  std::vector<TraceEvent> events;
+  // spans recorded since the last dump, of which the last kTraceBufferEvents are kept
+  int64_t num_recorded = 0;
+  int64_t tid = 0;
+  // set once the thread is over, the buffer is dropped at the next dump
+  bool exited = false;
+};
+
+std::mutex buffers_mutex;
+std::vector<std::shared_ptr<TraceBuffer>> buffers;
+std::atomic<int64_t> next_tid{1};
+
+// the buffer of the calling thread, registered at its first span
+struct ThreadTraceBuffer {
+  std::shared_ptr<TraceBuffer> buffer;
+
+  ~ThreadTraceBuffer() {
+    if (buffer != nullptr) {
+      std::lock_guard<std::mutex> lock(buffer->mutex);
+      buffer->exited = true;
+    }
+  }
+
+  TraceBuffer* Get() {
+    if (buffer == nullptr) {
+      buffer = std::make_shared<TraceBuffer>();
+      buffer->events.resize(kTraceBufferEvents);
+      buffer->tid = next_tid++;
+      std::lock_guard<std::mutex> lock(buffers_mutex);
+      buffers.push_back(buffer);
+    }
+    return buffer.get();
+  }
+};
+
+thread_local ThreadTraceBuffer thread_buffer;
+
+const std::string& TraceDir() {
+  static const std::string dir = [] {
+    const char* env_dir = std::getenv("NATIVESQL_TRACE_DIR");
+    return std::string(env_dir == nullptr ? "" : env_dir);
+  }();
+  return dir;
+}
+
+void AppendJsonString(std::ostringstream* out, const char* s) {
+  *out << '"';
+  for (; *s != '\0'; ++s) {
+    if (*s == '"' || *s == '\\') {
+      *out << '\\' << *s;
+    } else if (static_cast<unsigned char>(*s) >= 0x20) {
+      *out << *s;
+    }
+  }
+  *out << '"';
+}
+
+}  // namespace
+
+bool TraceEnabled() {
+  static const bool enabled = !TraceDir().empty();
+  return enabled;
+}
+
+int64_t TraceNowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void RecordTraceSpan(const char* category, const char* name, const std::string& detail,
+                     int64_t begin_micros, int64_t end_micros) {
+  auto buffer = thread_buffer.Get();
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  auto& event = buffer->events[buffer->num_recorded++ % kTraceBufferEvents];
+  event.category = category;
+  event.name = name;
+  auto length = std::min(detail.size(), sizeof(event.detail) - 1);
+  std::memcpy(event.detail, detail.data(), length);
+  event.detail[length] = '\0';
+  event.begin_micros = begin_micros;
+  event.duration_micros = end_micros - begin_micros;
+}
+
+arrow::Status DumpTrace(const std::string& file_name) {
+  if (!TraceEnabled()) {
+    return arrow::Status::OK();
+  }
+  std::vector<std::shared_ptr<TraceBuffer>> to_dump;
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    to_dump = buffers;
+  }
+
+  std::ostringstream out;
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  auto pid = getpid();
+  bool first = true;
+  for (const auto& buffer : to_dump) {
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    auto num_kept = std::min(buffer->num_recorded, kTraceBufferEvents);
+    for (int64_t i = buffer->num_recorded - num_kept; i < buffer->num_recorded; ++i) {
+      const auto& event = buffer->events[i % kTraceBufferEvents];
+      out << (first ? "" : ",") << "\n{\"ph\":\"X\",\"pid\":" << pid
+          << ",\"tid\":" << buffer->tid << ",\"ts\":" << event.begin_micros
+          << ",\"dur\":" << event.duration_micros << ",\"cat\":";
+      AppendJsonString(&out, event.category);
+      out << ",\"name\":";
+      AppendJsonString(&out, event.name);
+      if (event.detail[0] != '\0') {
+        out << ",\"args\":{\"detail\":";
+        AppendJsonString(&out, event.detail);
+        out << "}";
+      }
+      out << "}";
+      first = false;
+    }
+    buffer->num_recorded = 0;
+  }
+  out << "\n]}\n";
+
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                 [](const std::shared_ptr<TraceBuffer>& buffer) {
+                                   std::lock_guard<std::mutex> lock(buffer->mutex);
+                                   return buffer->exited;
+                                 }),
+                  buffers.end());
+  }
+
+  auto path = arrow::fs::internal::ConcatAbstractPath(TraceDir(), file_name);
+  ARROW_ASSIGN_OR_RAISE(auto file, arrow::io::FileOutputStream::Open(path));
+  auto json = out.str();
+  RETURN_NOT_OK(file->Write(json.data(), json.size()));
+  return file->Close();
+}
+
+}  // namespace sparkcolumnarplugin
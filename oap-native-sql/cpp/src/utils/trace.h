@@ -0,0 +1,84 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arrow/status.h>
+
+#include <cstdint>
+#include <string>
+
+namespace sparkcolumnarplugin {
+
+/// \brief Spans of native execution, dumped as Chrome trace JSON for chrome://tracing
+/// or Perfetto
+///
+/// Tracing is on when NATIVESQL_TRACE_DIR is set, the directory of the dumps. Each
+/// thread records its spans into a ring buffer of its own, keeping the last
+/// kTraceBufferEvents, so that a span costs two clock reads and an uncontended lock.
+/// When tracing is off a span costs a branch.
+bool TraceEnabled();
+
+/// Spans kept by a thread until they are dumped
+constexpr int64_t kTraceBufferEvents = 1 << 16;
+
+int64_t TraceNowMicros();
+
+/// Record a span of the calling thread. category and name must outlive the dump, e.g.
+/// string literals, detail is copied and cut to a few dozen characters.
+void RecordTraceSpan(const char* category, const char* name, const std::string& detail,
+                     int64_t begin_micros, int64_t end_micros);
+
+/// Write the spans of all the threads recorded since the last dump to file_name in
+/// the trace directory and drop them, a no-op when tracing is off. The spans of the
+/// tasks running at the same time are written by the first of them to be dumped.
+arrow::Status DumpTrace(const std::string& file_name);
+
+/// \brief Records the span of its scope when tracing is on
+class TraceSpan {
+ public:
+  TraceSpan(const char* category, const char* name)
+      : category_(category),
+        name_(name),
+        begin_(TraceEnabled() ? TraceNowMicros() : -1) {}
+  /// detail is copied only when tracing is on
+  TraceSpan(const char* category, const char* name, const std::string& detail)
+      : TraceSpan(category, name) {
+    if (begin_ >= 0) {
+      detail_ = detail;
+    }
+  }
+  ~TraceSpan() {
+    if (begin_ >= 0) {
+      RecordTraceSpan(category_, name_, detail_, begin_, TraceNowMicros());
+    }
+  }
+
+ private:
+  const char* category_;
+  const char* name_;
+  std::string detail_;
+  int64_t begin_;
+};
+
+}  // namespace sparkcolumnarplugin
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+/// Trace the rest of the enclosing scope as a span named name of category
+#define TRACE_SPAN(category, name) \
+  ::sparkcolumnarplugin::TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(category, name)
@@ -9,6 +9,7 @@ public class PersistentMemoryPool {
     private static native void nativeSetBlock(long deviceHandler, String key, ByteBuffer byteBuffer, int size, boolean clean);
     private static native long[] nativeGetBlockIndex(long deviceHandler, String key);
     private static native long nativeGetBlockSize(long deviceHandler, String key);
+    private static native ByteBuffer[] nativeGetBlockBuffers(long deviceHandler, String key);
     private static native void nativeDeleteBlock(long deviceHandler, String key);
     private static native long nativeGetRoot(long deviceHandler);
     private static native int nativeCloseDevice(long deviceHandler);
@@ -37,6 +38,14 @@ public class PersistentMemoryPool {
       return nativeGetBlockSize(this.deviceHandler, key);
     }
 
+    /**
+     * Direct ByteBuffers over the persistent memory of the blocks of key, in write order.
+     * They are valid until the partition is deleted or the pool is closed.
+     */
+    public ByteBuffer[] getPartitionBuffers(String key) {
+      return nativeGetBlockBuffers(this.deviceHandler, key);
+    }
+
     public void deletePartition(String key) {
       nativeDeleteBlock(this.deviceHandler, key);
     }
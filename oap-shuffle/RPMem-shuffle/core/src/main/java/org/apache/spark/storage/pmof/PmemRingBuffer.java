@@ -0,0 +1,42 @@
+package org.apache.spark.storage.pmof;
+
+/**
+ * Fixed-capacity native ring buffer, taken from and given back to a native pool,
+ * so shuffle readers reuse the same aligned buffers across partitions.
+ */
+public class PmemRingBuffer {
+    static {
+        System.load("/usr/local/lib/libjnipmdk.so");
+    }
+    private static native long nativeAcquireRingBuffer();
+    private static native int nativeLoadRingBuffer(long ringBuffer, long addr, int len);
+    private static native int nativeReadBytesFromRingBuffer(long ringBuffer, byte[] bytes, int off, int len);
+    private static native int nativeGetRingBufferRemaining(long ringBuffer);
+    private static native void nativeReleaseRingBuffer(long ringBuffer);
+
+    private boolean closed = false;
+    long ringBuffer;
+    PmemRingBuffer() {
+      ringBuffer = nativeAcquireRingBuffer();
+    }
+
+    /** Load as much of len bytes at addr as fits, return the length loaded. */
+    int load(long addr, int len) {
+      return nativeLoadRingBuffer(ringBuffer, addr, len);
+    }
+
+    int get(byte[] bytes, int off, int len) {
+      return nativeReadBytesFromRingBuffer(ringBuffer, bytes, off, len);
+    }
+
+    int size() {
+      return nativeGetRingBufferRemaining(ringBuffer);
+    }
+
+    synchronized void close() {
+      if (!closed) {
+        nativeReleaseRingBuffer(ringBuffer);
+        closed = true;
+      }
+    }
+}
@@ -63,6 +63,11 @@ private[spark] class PersistentMemoryHandler(
     }
   }
 
+  // read-only zero-copy views over the blocks of the partition, in write order
+  def getPartitionBuffers(blockId: String): Array[ByteBuffer] = {
+    pmpool.getPartitionBuffers(blockId).map(_.asReadOnlyBuffer())
+  }
+
   def getPartitionSize(blockId: String): Long = {
     pmpool.getPartitionSize(blockId)
   }
@@ -10,7 +10,7 @@ class PmemBlockInputStream[K, C](pmemBlockOutputStream: PmemBlockOutputStream, s
   val serializerManager: SerializerManager = SparkEnv.get.serializerManager
   val serInstance: SerializerInstance = serializer.newInstance()
   val persistentMemoryWriter: PersistentMemoryHandler = PersistentMemoryHandler.getPersistentMemoryHandler
-  var pmemInputStream: PmemInputStream = new PmemInputStream(persistentMemoryWriter, blockId.name)
+  var pmemInputStream: PmemDirectInputStream = new PmemDirectInputStream(persistentMemoryWriter, blockId.name)
   val wrappedStream = serializerManager.wrapStream(blockId, pmemInputStream)
   var inObjStream: DeserializationStream = serInstance.deserializeStream(wrappedStream)
 
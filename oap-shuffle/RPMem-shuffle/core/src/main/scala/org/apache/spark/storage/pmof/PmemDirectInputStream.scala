@@ -0,0 +1,73 @@
+package org.apache.spark.storage.pmof
+
+import java.io.InputStream
+import java.nio.ByteBuffer
+import org.apache.spark.internal.Logging
+
+/**
+ * Gather stream over the blocks of a partition, read in place from persistent memory
+ * through direct ByteBuffers, without loading them into an intermediate buffer.
+ */
+class PmemDirectInputStream(
+  persistentMemoryHandler: PersistentMemoryHandler,
+  blockId: String) extends InputStream with Logging {
+  val buffers: Array[ByteBuffer] = persistentMemoryHandler.getPartitionBuffers(blockId)
+  var index: Int = 0
+  var available_bytes: Int = buffers.map(_.remaining()).sum
+  logDebug(s"${blockId} size ${available_bytes} in ${buffers.length} blocks")
+
+  // the block to read next, null at the end of the partition
+  def currentBuffer(): ByteBuffer = {
+    while (index < buffers.length && !buffers(index).hasRemaining) {
+      index += 1
+    }
+    if (index < buffers.length) buffers(index) else null
+  }
+
+  override def read(): Int = {
+    val buffer = currentBuffer()
+    if (buffer == null) {
+      return -1
+    }
+    available_bytes -= 1
+    buffer.get() & 0xFF
+  }
+
+  override def read(bytes: Array[Byte], off: Int, len: Int): Int = {
+    if (len == 0) {
+      return 0
+    }
+    var read_len = 0
+    var buffer = currentBuffer()
+    while (read_len < len && buffer != null) {
+      val real_len = Math.min(len - read_len, buffer.remaining())
+      buffer.get(bytes, off + read_len, real_len)
+      read_len += real_len
+      buffer = currentBuffer()
+    }
+    available_bytes -= read_len
+    if (read_len == 0) -1 else read_len
+  }
+
+  override def skip(n: Long): Long = {
+    var skipped = 0L
+    var buffer = currentBuffer()
+    while (skipped < n && buffer != null) {
+      val real_len = Math.min(n - skipped, buffer.remaining().toLong).toInt
+      buffer.position(buffer.position() + real_len)
+      skipped += real_len
+      buffer = currentBuffer()
+    }
+    available_bytes -= skipped.toInt
+    skipped
+  }
+
+  override def available(): Int = {
+    available_bytes
+  }
+
+  override def close(): Unit = {
+    index = buffers.length
+    available_bytes = 0
+  }
+}
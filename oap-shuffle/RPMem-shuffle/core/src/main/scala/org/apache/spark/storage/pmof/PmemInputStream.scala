@@ -2,67 +2,56 @@ package org.apache.spark.storage.pmof
 
 import java.io.InputStream
 import org.apache.spark.internal.Logging
-import scala.util.control.Breaks._
 
 class PmemInputStream(
   persistentMemoryHandler: PersistentMemoryHandler,
   blockId: String) extends InputStream with Logging {
   var index: Int = 0
+  // bytes of the block at index already loaded
+  var loaded: Int = 0
   var remaining: Int = 0
   val blockInfo: Array[(Long, Int)] = persistentMemoryHandler.getPartitionBlockInfo(blockId)
   var available_bytes: Int = persistentMemoryHandler.getPartitionSize(blockId).toInt
-  val buf = new PmemBuffer(available_bytes)
+  val buf = new PmemRingBuffer()
+  val single = new Array[Byte](1)
   logDebug(s"${blockId} size ${available_bytes}")
 
-  load(available_bytes)
-
+  // load the next blocks into the ring buffer until it's full
   def loadNextStream(): Int = {
-    if (index >= blockInfo.length)
-      return 0
-    val data_length = blockInfo(index)._2
-    val data_addr = blockInfo(index)._1
-    buf.load(data_addr, data_length)
-
-    index += 1
-    remaining += data_length
-    data_length
+    var load_len = 0
+    var full = false
+    while (index < blockInfo.length && !full) {
+      val data_addr = blockInfo(index)._1 + loaded
+      val data_length = blockInfo(index)._2 - loaded
+      val real_len = buf.load(data_addr, data_length)
+      load_len += real_len
+      loaded += real_len
+      if (real_len < data_length) {
+        full = true
+      } else {
+        index += 1
+        loaded = 0
+      }
+    }
+    remaining += load_len
+    load_len
   }
 
   override def read(): Int = {
-    if (remaining == 0) {
-      if (loadNextStream() == 0) {
-        return -1
-      }
-    }
-    remaining -= 1
-    available_bytes -= 1
-    buf.get()
+    if (read(single, 0, 1) == -1) -1 else single(0) & 0xFF
   }
 
   override def read(bytes: Array[Byte], off: Int, len: Int): Int = {
-    if (remaining == 0) {
+    if (remaining == 0 && loadNextStream() == 0) {
       return -1
     }
 
-    val real_len = Math.min(len, remaining)
-    buf.get(bytes, off, real_len)
+    val real_len = buf.get(bytes, off, Math.min(len, remaining))
     remaining -= real_len
     available_bytes -= real_len
     real_len
   }
 
-  def load(len: Int): Unit = {
-    breakable { while ((remaining > 0 && remaining < len) || remaining == 0) {
-      if (loadNextStream() == 0) {
-        break
-      }
-    } }
-  }
-
-  def getByteBufferDirectAddr: Long = {
-    buf.getDirectAddr
-  }
-
   override def available(): Int = {
     available_bytes
   }
@@ -43,7 +43,7 @@ class PmemManagedBuffer(pmHandler: PersistentMemoryHandler, blockId: String) ext
 
   override def createInputStream(): InputStream = {
     if (inputStream == null) {
-      inputStream = new PmemInputStream(pmHandler, blockId)
+      inputStream = new PmemDirectInputStream(pmHandler, blockId)
     }
     inputStream
   }
@@ -72,8 +72,6 @@ class PmemManagedBuffer(pmHandler: PersistentMemoryHandler, blockId: String) ext
   }
 
   override def convertToNetty(): Object = {
-    val in = createInputStream()
-    val data_length = size().toInt
-    Unpooled.wrappedBuffer(in.asInstanceOf[PmemInputStream].getByteBufferDirectAddr, data_length, false)
+    Unpooled.wrappedBuffer(pmHandler.getPartitionBuffers(blockId): _*)
   }
 }
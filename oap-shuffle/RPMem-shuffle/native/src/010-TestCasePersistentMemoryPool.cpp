@@ -66,6 +66,40 @@ TEST_CASE( "PmemBuffer operations", "[PmemBuffer]" ) {
   }
 }
 
+TEST_CASE( "PmemRingBuffer operations", "[PmemRingBuffer]" ) {
+  PmemRingBuffer* buf = PmemBufferPool::getInstance().acquire();
+  REQUIRE(buf != nullptr);
+
+  SECTION( "load more than the capacity of PmemRingBuffer" ) {
+    char* data = (char*)malloc(RING_BUFSIZE + LENGTH);
+    memset(data, 'a', RING_BUFSIZE + LENGTH);
+    REQUIRE(buf->load(data, RING_BUFSIZE + LENGTH) == RING_BUFSIZE);
+    REQUIRE(buf->getRemaining() == RING_BUFSIZE);
+    free(data);
+  }
+
+  SECTION( "read data wrapping around PmemRingBuffer" ) {
+    char* data = (char*)malloc(RING_BUFSIZE);
+    memset(data, 'a', RING_BUFSIZE);
+    buf->load(data, RING_BUFSIZE);
+    REQUIRE(buf->read(data, RING_BUFSIZE - 10) == RING_BUFSIZE - 10);
+    REQUIRE(buf->load((char*)expect_string, 20) == 20);
+    char ret_data[30] = {};
+    REQUIRE(buf->read(ret_data, 30) == 30);
+    REQUIRE(strncmp(ret_data + 10, expect_string, 20) == 0);
+    free(data);
+  }
+
+  SECTION( "released PmemRingBuffer is reused" ) {
+    buf->load((char*)expect_string, 20);
+    PmemBufferPool::getInstance().release(buf);
+    buf = PmemBufferPool::getInstance().acquire();
+    REQUIRE(buf->getRemaining() == 0);
+  }
+
+  PmemBufferPool::getInstance().release(buf);
+}
+
 TEST_CASE("pmemkv operations", "[pmemkv]") {
   SECTION("test open and close") {
     std::string key = "1";
@@ -87,6 +121,46 @@ TEST_CASE("pmemkv operations", "[pmemkv]") {
     delete kv;
   }
 
+  SECTION("test non-transactional put") {
+    std::string key = "1";
+    pmemkv* kv = new pmemkv("/dev/dax0.0");
+    kv->put_nt(key, "hello", 5);
+    kv->put(key, " world", 6);
+    delete kv;
+
+    kv = new pmemkv("/dev/dax0.0");
+    char data[11];
+    struct memory_block mb = {data, 11};
+    kv->get(key, &mb);
+    REQUIRE(strncmp("hello world", data, 11) == 0);
+    kv->free_all();
+    delete kv;
+  }
+
+  SECTION("test reopen with index spanning several chunks") {
+    std::string key_1 = "1";
+    std::string key_2 = "2";
+    pmemkv* kv = new pmemkv("/dev/dax0.0");
+    for (uint64_t i = 0; i < INDEX_CHUNK_RECORDS*3; i++) {
+      kv->put(i%2 == 0 ? key_1 : key_2, (const char*)&i, sizeof(i));
+    }
+    delete kv;
+
+    kv = new pmemkv("/dev/dax0.0");
+    uint64_t length = 0;
+    kv->get_meta_size(key_1, &length);
+    REQUIRE(length == INDEX_CHUNK_RECORDS*3/2);
+    uint64_t* data = (uint64_t*)std::malloc(length*sizeof(uint64_t));
+    struct memory_block mb = {(char*)data, length*sizeof(uint64_t)};
+    kv->get(key_1, &mb);
+    for (uint64_t i = 0; i < length; i++) {
+      REQUIRE(data[i] == i*2);
+    }
+    std::free(data);
+    kv->free_all();
+    delete kv;
+  }
+
   SECTION("test pmemkv metadata related operation") {
     std::string key = "1";
     pmemkv* kv = new pmemkv("/dev/dax0.0");
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <mutex>
 #include <cstring>
+#include <vector>
 using namespace std;
 
 #define DEFAULT_BUFSIZE 2049 * 1024
@@ -174,3 +175,119 @@ private:
 
   PmemBuffer(const PmemBuffer& src){ /* do not create copies */ }
 };
+
+#define RING_BUFSIZE 2048 * 1024
+#define RING_BUFALIGN 4096
+
+// fixed-capacity ring buffer, loading never grows or moves its data
+class PmemRingBuffer {
+public:
+  PmemRingBuffer(char* data, int capacity) : buf_data(data), buf_data_capacity(capacity) {
+    pos = 0;
+    remaining = 0;
+  }
+
+  // load as much of len as fits, return the length loaded
+  int load(char* pmem_data_addr, int pmem_data_len) {
+    if (pmem_data_addr == nullptr || pmem_data_len == 0)
+      return 0;
+    std::lock_guard<std::mutex> lock(buffer_mtx);
+    int load_len = min(pmem_data_len, buf_data_capacity - remaining);
+    int tail = (pos + remaining) % buf_data_capacity;
+    int first_len = min(load_len, buf_data_capacity - tail);
+    memcpy(buf_data + tail, pmem_data_addr, first_len);
+    memcpy(buf_data, pmem_data_addr + first_len, load_len - first_len);
+    remaining += load_len;
+    return load_len;
+  }
+
+  int read(char* ret_data, int len) {
+    std::lock_guard<std::mutex> lock(buffer_mtx);
+    int read_len = min(len, remaining);
+    int first_len = min(read_len, buf_data_capacity - pos);
+    if (ret_data != nullptr) {
+      memcpy(ret_data, buf_data + pos, first_len);
+      memcpy(ret_data + first_len, buf_data, read_len - first_len);
+    }
+    pos = (pos + read_len) % buf_data_capacity;
+    remaining -= read_len;
+    return read_len;
+  }
+
+  int getRemaining() {
+    std::lock_guard<std::mutex> lock(buffer_mtx);
+    return remaining;
+  }
+
+  int getFree() {
+    std::lock_guard<std::mutex> lock(buffer_mtx);
+    return buf_data_capacity - remaining;
+  }
+
+  void clean() {
+    std::lock_guard<std::mutex> lock(buffer_mtx);
+    pos = 0;
+    remaining = 0;
+  }
+
+  char* getDataAddr() {
+    return buf_data;
+  }
+
+private:
+  mutex buffer_mtx;
+  char* buf_data;
+  int buf_data_capacity;
+  int pos;
+  int remaining;
+
+  int min(int x, int y) {
+    return x > y ? y : x;
+  }
+
+  PmemRingBuffer(const PmemRingBuffer&) = delete;
+  PmemRingBuffer& operator=(const PmemRingBuffer&) = delete;
+};
+
+// free-list of aligned ring buffers, reused by shuffle readers across partitions
+class PmemBufferPool {
+public:
+  static PmemBufferPool& getInstance() {
+    static PmemBufferPool pool;
+    return pool;
+  }
+
+  PmemRingBuffer* acquire() {
+    {
+      std::lock_guard<std::mutex> lock(pool_mtx);
+      if (!free_list.empty()) {
+        PmemRingBuffer* buf = free_list.back();
+        free_list.pop_back();
+        return buf;
+      }
+    }
+    void* data = nullptr;
+    if (posix_memalign(&data, RING_BUFALIGN, RING_BUFSIZE) != 0) {
+      return nullptr;
+    }
+    return new PmemRingBuffer((char*)data, RING_BUFSIZE);
+  }
+
+  void release(PmemRingBuffer* buf) {
+    buf->clean();
+    std::lock_guard<std::mutex> lock(pool_mtx);
+    free_list.push_back(buf);
+  }
+
+  ~PmemBufferPool() {
+    for (auto buf : free_list) {
+      free(buf->getDataAddr());
+      delete buf;
+    }
+  }
+
+private:
+  PmemBufferPool() = default;
+  mutex pool_mtx;
+  vector<PmemRingBuffer*> free_list;
+};
@@ -19,7 +19,7 @@ JNIEXPORT void JNICALL Java_org_apache_spark_storage_pmof_PersistentMemoryPool_n
   const char* CStr = env->GetStringUTFChars(key, 0);
   string key_str(CStr);
   pmemkv *pmkv = static_cast<pmemkv*>((void*)kv);
-  pmkv->put(key_str, (char*)buf, dataSize);
+  pmkv->put_nt(key_str, (char*)buf, dataSize);
 }
 
 JNIEXPORT jlongArray JNICALL Java_org_apache_spark_storage_pmof_PersistentMemoryPool_nativeGetBlockIndex
@@ -39,6 +39,36 @@ JNIEXPORT jlongArray JNICALL Java_org_apache_spark_storage_pmof_PersistentMemory
   return data;
 }
 
+// direct ByteBuffers over the pmem regions of the blocks of key, in put order,
+// valid until the blocks are freed or the pool is closed
+JNIEXPORT jobjectArray JNICALL Java_org_apache_spark_storage_pmof_PersistentMemoryPool_nativeGetBlockBuffers
+  (JNIEnv *env, jclass obj, jlong kv, jstring key) {
+  const char *CStr = env->GetStringUTFChars(key, 0);
+  string key_str(CStr);
+  env->ReleaseStringUTFChars(key, CStr);
+  pmemkv *pmkv = static_cast<pmemkv*>((void*)kv);
+  uint64_t size = 0;
+  pmkv->get_meta_size(key_str, &size);
+  struct memory_meta* mm = (struct memory_meta*)std::malloc(sizeof(struct memory_meta));
+  mm->meta = (uint64_t*)std::malloc(size*2*sizeof(uint64_t));
+  mm->length = 0;
+  pmkv->get_meta(key_str, mm);
+  jclass byteBufferClass = env->FindClass("java/nio/ByteBuffer");
+  jobjectArray buffers = env->NewObjectArray(mm->length/2, byteBufferClass, nullptr);
+  for (uint64_t i = 0; buffers != nullptr && i < mm->length/2; i++) {
+    jobject buffer = env->NewDirectByteBuffer((void*)mm->meta[i*2], mm->meta[i*2+1]);
+    if (buffer == nullptr) {
+      buffers = nullptr;
+      break;
+    }
+    env->SetObjectArrayElement(buffers, i, buffer);
+    env->DeleteLocalRef(buffer);
+  }
+  std::free(mm->meta);
+  std::free(mm);
+  return buffers;
+}
+
 JNIEXPORT jlong JNICALL Java_org_apache_spark_storage_pmof_PersistentMemoryPool_nativeGetBlockSize
   (JNIEnv *env, jclass obj, jlong kv, jstring key) {
   const char *CStr = env->GetStringUTFChars(key, 0);
@@ -119,3 +149,32 @@ JNIEXPORT jint JNICALL Java_org_apache_spark_storage_pmof_PmemBuffer_nativeDelet
   delete (PmemBuffer*)pmBuffer;
   return 0;
 }
+
+JNIEXPORT jlong JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeAcquireRingBuffer
+  (JNIEnv *env, jclass obj) {
+  return (long)PmemBufferPool::getInstance().acquire();
+}
+
+JNIEXPORT jint JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeLoadRingBuffer
+  (JNIEnv *env, jclass obj, jlong ringBuffer, jlong addr, jint len) {
+  return ((PmemRingBuffer*)ringBuffer)->load((char*)addr, len);
+}
+
+JNIEXPORT jint JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeReadBytesFromRingBuffer
+  (JNIEnv *env, jclass obj, jlong ringBuffer, jbyteArray data, jint off, jint len) {
+  jboolean isCopy = JNI_FALSE;
+  jbyte* ret_data = env->GetByteArrayElements(data, &isCopy);
+  int read_len = ((PmemRingBuffer*)ringBuffer)->read((char*)ret_data + off, len);
+  env->ReleaseByteArrayElements(data, ret_data, 0);
+  return read_len;
+}
+
+JNIEXPORT jint JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeGetRingBufferRemaining
+  (JNIEnv *env, jclass obj, jlong ringBuffer) {
+  return ((PmemRingBuffer*)ringBuffer)->getRemaining();
+}
+
+JNIEXPORT void JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeReleaseRingBuffer
+  (JNIEnv *env, jclass obj, jlong ringBuffer) {
+  PmemBufferPool::getInstance().release((PmemRingBuffer*)ringBuffer);
+}
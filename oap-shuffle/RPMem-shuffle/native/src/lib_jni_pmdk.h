@@ -47,6 +47,14 @@ JNIEXPORT jlongArray JNICALL Java_org_apache_spark_storage_pmof_PersistentMemory
 JNIEXPORT jlong JNICALL Java_org_apache_spark_storage_pmof_PersistentMemoryPool_nativeGetBlockSize
   (JNIEnv *, jclass, jlong, jstring);
 
+/*
+ * Class:     lib_jni_pmdk
+ * Method:    nativeGetBlockBuffers
+ * Signature: (JLjava/lang/String;)[Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobjectArray JNICALL Java_org_apache_spark_storage_pmof_PersistentMemoryPool_nativeGetBlockBuffers
+  (JNIEnv *, jclass, jlong, jstring);
+
 /*
  * Class:     lib_jni_pmdk
  * Method:    nativeGetRoot
@@ -122,6 +130,46 @@ JNIEXPORT jint JNICALL Java_org_apache_spark_storage_pmof_PmemBuffer_nativeClean
 JNIEXPORT jint JNICALL Java_org_apache_spark_storage_pmof_PmemBuffer_nativeDeletePmemBuffer
   (JNIEnv *, jobject, jlong);
 
+/*
+ * Class:     lib_jni_pmdk
+ * Method:    nativeAcquireRingBuffer
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeAcquireRingBuffer
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     lib_jni_pmdk
+ * Method:    nativeLoadRingBuffer
+ * Signature: (JJI)I
+ */
+JNIEXPORT jint JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeLoadRingBuffer
+  (JNIEnv *, jclass, jlong, jlong, jint);
+
+/*
+ * Class:     lib_jni_pmdk
+ * Method:    nativeReadBytesFromRingBuffer
+ * Signature: (J[BII)I
+ */
+JNIEXPORT jint JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeReadBytesFromRingBuffer
+  (JNIEnv *, jclass, jlong, jbyteArray, jint, jint);
+
+/*
+ * Class:     lib_jni_pmdk
+ * Method:    nativeGetRingBufferRemaining
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeGetRingBufferRemaining
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     lib_jni_pmdk
+ * Method:    nativeReleaseRingBuffer
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_org_apache_spark_storage_pmof_PmemRingBuffer_nativeReleaseRingBuffer
+  (JNIEnv *, jclass, jlong);
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,9 +8,14 @@
 #include <fcntl.h>
 
 #include <string>
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 #include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unordered_map>
 
 #include <libpmemobj.h>
 #include <libcuckoo/cuckoohash_map.hh>
@@ -18,6 +23,8 @@
 #include "xxhash.hpp"
 
 #define PMEMKV_LAYOUT_NAME "pmemkv_layout"
+#define INDEX_CHUNK_RECORDS 4096
+#define PMEMKV_LANES 16
 
 // block header stored in pmem
 struct block_hdr {
@@ -32,12 +39,33 @@ struct block_entry {
   PMEMoid data;
 };
 
-// pmem root entry
-struct base {
+// pmem append lane, lane 0 has the layout of the root entry of older pools
+struct lane {
 	PMEMoid head;
 	PMEMoid tail;
 	PMEMrwlock rwlock;
 	uint64_t bytes_written;
+  PMEMoid index_head;
+  PMEMoid index_tail;
+};
+
+// pmem root entry
+struct base {
+  struct lane lanes[PMEMKV_LANES];
+};
+
+// block index record stored in pmem
+struct index_record {
+  uint64_t key;
+  PMEMoid data;
+  uint64_t size;
+};
+
+// chunk of block index records stored in pmem, records appended in put order
+struct index_chunk {
+  PMEMoid next;
+  uint64_t count;
+  struct index_record records[INDEX_CHUNK_RECORDS];
 };
 
 // block metadata stored in memory
@@ -70,13 +98,16 @@ struct memory_meta {
 enum types {
   BLOCK_ENTRY_TYPE,
   DATA_TYPE,
+  INDEX_CHUNK_TYPE,
   MAX_TYPE
 };
 
 /*
-pmemkv data and index were stored in persistent memory.
-data and index structure:
-base[head,                                                       tail]
+pmemkv data and index were stored in persistent memory, in PMEMKV_LANES
+independent append lanes, each with its own list, lock and allocation arena.
+the blocks of a key are all appended to the lane of its hash.
+data and index structure of a lane:
+lane[head,                                                       tail]
      |                                                            |
      block_entry_1[block_hdr[next, key, size], data]              |
                           |                                       |
@@ -84,7 +115,15 @@ base[head,                                                       tail]
                                          |                        |
                                          block_entry_3[...[next...]]
 
-index map was stored in memory, rebuild index map when opening pmemkv
+each put also appends the record of its block to the chunks of the index,
+in the same transaction:
+lane[index_head,                                             index_tail]
+     |                                                            |
+     index_chunk_1[next, count, records[key, data, size]...] --> index_chunk_2
+
+index map was stored in memory, rebuild index map from the index chunks when
+opening pmemkv, loaded in parallel across lanes. pmem pools written before
+the index chunks are rebuilt from the block entries once
 index structure:
 key_1 --> block_meta_list_1[block_meta, block_meta, block_meta]
 key_2 --> block_meta_list_2[block_meta, block_meta, block_meta]
@@ -110,6 +149,8 @@ class pmemkv {
 
     int put(std::string &key, const char* buf, const uint64_t count) {
       xxh::hash64_t key_i = xxh::xxhash<64>(key);
+      struct lane* lp = lane_of(key_i);
+      uint64_t flags = lane_flags[key_i % PMEMKV_LANES];
       // set the return point
       jmp_buf env;
       if (setjmp(env)) {
@@ -118,24 +159,24 @@ class pmemkv {
         return -1;
       }
 
-      // begin a transaction, also acquiring the write lock for the data
-      if (pmemobj_tx_begin(pmem_pool, env, TX_PARAM_RWLOCK, &bp->rwlock,
+      // begin a transaction, also acquiring the write lock of the lane
+      if (pmemobj_tx_begin(pmem_pool, env, TX_PARAM_RWLOCK, &lp->rwlock,
           TX_PARAM_NONE)) {
         perror("pmemobj_tx_begin failed in pmemkv put");
         return -1;
       }
       // allocate the new node to be inserted
-      PMEMoid beo = pmemobj_tx_alloc(sizeof(struct block_entry), BLOCK_ENTRY_TYPE);
+      PMEMoid beo = pmemobj_tx_xalloc(sizeof(struct block_entry), BLOCK_ENTRY_TYPE, flags);
       if (beo.off == 0) {
         (void) pmemobj_tx_end();
-        perror("pmemobj_tx_alloc failed in pmemkv put");
+        perror("pmemobj_tx_xalloc failed in pmemkv put");
         return -1;
       }
       struct block_entry* bep = (struct block_entry*)pmemobj_direct(beo);
-      bep->data = pmemobj_tx_zalloc(count, DATA_TYPE);
+      bep->data = pmemobj_tx_xalloc(count, DATA_TYPE, flags | POBJ_XALLOC_ZERO);
       if (bep->data.off == 0) {
         (void) pmemobj_tx_end();
-        perror("pmemobj_tx_zalloc failed in pmemkv put");
+        perror("pmemobj_tx_xalloc failed in pmemkv put");
         return -1;
       }
       char* pmem_data = (char*)pmemobj_direct(bep->data);
@@ -143,20 +184,58 @@ class pmemkv {
       bep->hdr.next = OID_NULL;
       bep->hdr.key = key_i;
       bep->hdr.size = count;
+      append_block_entry(lp, flags, beo);
+      pmemobj_tx_commit();
+      (void) pmemobj_tx_end();
 
-      // add the modified root object to the undo data
-      pmemobj_tx_add_range(bo, 0, sizeof(struct base));
-      if (bp->tail.off == 0) {
-        // update head
-        bp->head = beo;
-      } else {
-        // add the modified tail entry to the undo data
-        pmemobj_tx_add_range(bp->tail, 0, sizeof(struct block_entry));
-        ((struct block_entry*)pmemobj_direct(bp->tail))->hdr.next = beo;
+      // update in-memory index
+      if (update_meta(bep)) {
+        return -1;
+      }
+      return 0;
+    }
+
+    // write path of shuffle blocks, the data is reserved without zeroing and
+    // written once with non-temporal stores, drained once, then published by
+    // the transaction linking its block entry, so it's never undo logged
+    int put_nt(std::string &key, const char* buf, const uint64_t count) {
+      xxh::hash64_t key_i = xxh::xxhash<64>(key);
+      struct lane* lp = lane_of(key_i);
+      uint64_t flags = lane_flags[key_i % PMEMKV_LANES];
+      struct pobj_action act;
+      PMEMoid data = pmemobj_xreserve(pmem_pool, &act, count, DATA_TYPE, flags);
+      if (data.off == 0) {
+        perror("pmemobj_xreserve failed in pmemkv put_nt");
+        return -1;
+      }
+      pmemobj_memcpy(pmem_pool, pmemobj_direct(data), buf, count,
+          PMEMOBJ_F_MEM_NONTEMPORAL | PMEMOBJ_F_MEM_NODRAIN);
+      pmemobj_drain(pmem_pool);
+
+      // set the return point, an aborted transaction cancels the reservation
+      jmp_buf env;
+      if (setjmp(env)) {
+        // end the transaction
+        (void) pmemobj_tx_end();
+        return -1;
       }
 
-      bp->tail = beo; // update tail
-      bp->bytes_written += count;
+      // begin a transaction, also acquiring the write lock of the lane
+      if (pmemobj_tx_begin(pmem_pool, env, TX_PARAM_RWLOCK, &lp->rwlock,
+          TX_PARAM_NONE)) {
+        pmemobj_cancel(pmem_pool, &act, 1);
+        perror("pmemobj_tx_begin failed in pmemkv put_nt");
+        return -1;
+      }
+      pmemobj_tx_publish(&act, 1);
+      // allocate the new node to be inserted
+      PMEMoid beo = pmemobj_tx_xalloc(sizeof(struct block_entry), BLOCK_ENTRY_TYPE, flags);
+      struct block_entry* bep = (struct block_entry*)pmemobj_direct(beo);
+      bep->data = data;
+      bep->hdr.next = OID_NULL;
+      bep->hdr.key = key_i;
+      bep->hdr.size = count;
+      append_block_entry(lp, flags, beo);
       pmemobj_tx_commit();
       (void) pmemobj_tx_end();
 
@@ -173,7 +252,8 @@ class pmemkv {
         perror("no such key in index_map");
         return -1;
       }
-      if (pmemobj_rwlock_rdlock(pmem_pool, &bp->rwlock) != 0) {
+      struct lane* lp = lane_of(key_i);
+      if (pmemobj_rwlock_rdlock(pmem_pool, &lp->rwlock) != 0) {
 		    return -1;
       }
       struct block_meta_list* bml = nullptr;
@@ -187,7 +267,7 @@ class pmemkv {
         assert(read_offset <= mb->size);
         bm = bm->next;
       }
-      pmemobj_rwlock_unlock(pmem_pool, &bp->rwlock);
+      pmemobj_rwlock_unlock(pmem_pool, &lp->rwlock);
       return 0;
     }
 
@@ -238,10 +318,19 @@ class pmemkv {
     }
 
     int dump_all() {
-      if (pmemobj_rwlock_rdlock(pmem_pool, &bp->rwlock) != 0) {
+      for (int i = 0; i < PMEMKV_LANES; i++) {
+        if (dump_lane(&bp->lanes[i])) {
+          return -1;
+        }
+      }
+      return 0;
+    }
+
+    int dump_lane(struct lane* lp) {
+      if (pmemobj_rwlock_rdlock(pmem_pool, &lp->rwlock) != 0) {
 		    return -1;
       }
-      struct block_entry* next_bep = (struct block_entry*)pmemobj_direct(bp->head);
+      struct block_entry* next_bep = (struct block_entry*)pmemobj_direct(lp->head);
       uint64_t read_offset = 0;
       while (next_bep != nullptr) {
         char* pmem_data = (char*)pmemobj_direct(next_bep->data);
@@ -252,12 +341,16 @@ class pmemkv {
         std::free(tmp);
         next_bep = (struct block_entry*)pmemobj_direct(next_bep->hdr.next);
       }
-      pmemobj_rwlock_unlock(pmem_pool, &bp->rwlock);
+      pmemobj_rwlock_unlock(pmem_pool, &lp->rwlock);
       return 0; 
     }
 
     int dump_meta() {
-      std::cout << "pmemkv total bytes written " << bp->bytes_written << std::endl;
+      uint64_t bytes_written = 0;
+      for (int i = 0; i < PMEMKV_LANES; i++) {
+        bytes_written += bp->lanes[i].bytes_written;
+      }
+      std::cout << "pmemkv total bytes written " << bytes_written << std::endl;
       std::lock_guard<std::mutex> l(mtx);
       auto locked_index_map = index_map.lock_table();
       for (const auto &it : locked_index_map) {
@@ -270,8 +363,21 @@ class pmemkv {
     }
 
     int free_all() {
-      // don't implement transaction here, if any issue happens, we need to rebuild the pmem pool.
-      PMEMoid next_beo = bp->head;
+      for (int i = 0; i < PMEMKV_LANES; i++) {
+        free_lane(&bp->lanes[i]);
+      }
+
+      // free metadata
+      if (free_meta()) {
+        return -1;
+      }
+
+      return 0;
+    }
+
+    // don't implement transaction here, if any issue happens, we need to rebuild the pmem pool.
+    void free_lane(struct lane* lp) {
+      PMEMoid next_beo = lp->head;
       struct block_entry* next_bep = (struct block_entry*)pmemobj_direct(next_beo);
       while (next_bep != nullptr) {
         // add block entry to undo log
@@ -281,19 +387,22 @@ class pmemkv {
         pmemobj_free(&pre_bep->data);
         next_beo = next_bep->hdr.next;
         next_bep = (struct block_entry*)pmemobj_direct(next_beo);
-        bp->bytes_written -= pre_bep->hdr.size;
+        lp->bytes_written -= pre_bep->hdr.size;
       }
       // add root block to undo log
-      bp->head = OID_NULL;
-      bp->tail = OID_NULL;
-      assert(bp->bytes_written == 0);
-
-      // free metadata
-      if (free_meta()) {
-        return -1;
+      lp->head = OID_NULL;
+      lp->tail = OID_NULL;
+      assert(lp->bytes_written == 0);
+
+      // free index chunks
+      PMEMoid next_ico = lp->index_head;
+      while (!OID_IS_NULL(next_ico)) {
+        PMEMoid pre_ico = next_ico;
+        next_ico = ((struct index_chunk*)pmemobj_direct(pre_ico))->next;
+        pmemobj_free(&pre_ico);
       }
-
-      return 0;
+      lp->index_head = OID_NULL;
+      lp->index_tail = OID_NULL;
     }
 
     uint64_t get_root() {
@@ -311,9 +420,14 @@ class pmemkv {
       }
       bo = pmemobj_root(pmem_pool, sizeof(struct base));
       bp = (struct base*)pmemobj_direct(bo);
-      bp->head = OID_NULL;
-      bp->tail = OID_NULL;
-      bp->bytes_written = 0;
+      for (int i = 0; i < PMEMKV_LANES; i++) {
+        bp->lanes[i].head = OID_NULL;
+        bp->lanes[i].tail = OID_NULL;
+        bp->lanes[i].bytes_written = 0;
+        bp->lanes[i].index_head = OID_NULL;
+        bp->lanes[i].index_tail = OID_NULL;
+      }
+      create_arenas();
 
       return 0;
     }
@@ -326,20 +440,162 @@ class pmemkv {
       if (pmem_pool == nullptr) {
         return -1;
       }
-      // rebuild in-memory index
-      // walk through all the block entry in pmem, don't need lock here
+      // rebuild in-memory index, don't need lock here
+      // the root of pools written before the index chunks grows zero-filled
       bo = pmemobj_root(pmem_pool, sizeof(struct base));
       bp = (struct base*)pmemobj_direct(bo);
-      struct block_entry *next = (struct block_entry*)pmemobj_direct(bp->head);
+      create_arenas();
+      for (int i = 0; i < PMEMKV_LANES; i++) {
+        struct lane* lp = &bp->lanes[i];
+        if (OID_IS_NULL(lp->index_head) && !OID_IS_NULL(lp->head)) {
+          if (recover_index(lp, lane_flags[i])) {
+            return -1;
+          }
+        }
+      }
+      return load_index();
+    }
+
+    struct lane* lane_of(uint64_t key) {
+      return &bp->lanes[key % PMEMKV_LANES];
+    }
+
+    // one allocation arena per lane, arenas aren't persistent so they are
+    // created again on each open, lanes fall back to the arena of the thread
+    void create_arenas() {
+      for (int i = 0; i < PMEMKV_LANES; i++) {
+        lane_flags[i] = 0;
+#ifdef POBJ_ARENA_ID
+        unsigned arena_id = 0;
+        if (pmemobj_ctl_exec(pmem_pool, "heap.arena.create", &arena_id) == 0) {
+          lane_flags[i] = POBJ_ARENA_ID(arena_id);
+        }
+#endif
+      }
+    }
+
+    // link a new block entry at the tail of its lane and index it, inside the
+    // transaction of its put
+    void append_block_entry(struct lane* lp, uint64_t flags, PMEMoid beo) {
+      struct block_entry* bep = (struct block_entry*)pmemobj_direct(beo);
+      // add the modified lane to the undo data
+      pmemobj_tx_add_range_direct(lp, sizeof(struct lane));
+      if (lp->tail.off == 0) {
+        // update head
+        lp->head = beo;
+      } else {
+        // add the modified tail entry to the undo data
+        pmemobj_tx_add_range(lp->tail, 0, sizeof(struct block_entry));
+        ((struct block_entry*)pmemobj_direct(lp->tail))->hdr.next = beo;
+      }
+
+      lp->tail = beo; // update tail
+      lp->bytes_written += bep->hdr.size;
+      append_index_record(lp, flags, bep->hdr.key, bep->data, bep->hdr.size);
+    }
+
+    // append the record of a block to the index chunks of its lane, inside the
+    // transaction of its put, after the lane was added to the undo data
+    void append_index_record(struct lane* lp, uint64_t flags, uint64_t key,
+        PMEMoid data, uint64_t size) {
+      struct index_chunk* icp = (struct index_chunk*)pmemobj_direct(lp->index_tail);
+      if (icp == nullptr || icp->count == INDEX_CHUNK_RECORDS) {
+        PMEMoid ico = pmemobj_tx_xalloc(sizeof(struct index_chunk), INDEX_CHUNK_TYPE,
+            flags | POBJ_XALLOC_ZERO);
+        if (icp == nullptr) {
+          lp->index_head = ico;
+        } else {
+          pmemobj_tx_add_range_direct(&icp->next, sizeof(PMEMoid));
+          icp->next = ico;
+        }
+        lp->index_tail = ico;
+        icp = (struct index_chunk*)pmemobj_direct(ico);
+      }
+      struct index_record* irp = &icp->records[icp->count];
+      pmemobj_tx_add_range_direct(irp, sizeof(struct index_record));
+      pmemobj_tx_add_range_direct(&icp->count, sizeof(uint64_t));
+      irp->key = key;
+      irp->data = data;
+      irp->size = size;
+      icp->count += 1;
+    }
+
+    // load in-memory index from the index chunks of all the lanes, each thread
+    // loads a range of chunks then the ranges are merged in order, keeping
+    // blocks in put order in their lane
+    int load_index() {
+      std::vector<struct index_chunk*> chunks;
+      for (int i = 0; i < PMEMKV_LANES; i++) {
+        struct index_chunk* icp =
+          (struct index_chunk*)pmemobj_direct(bp->lanes[i].index_head);
+        while (icp != nullptr) {
+          chunks.push_back(icp);
+          icp = (struct index_chunk*)pmemobj_direct(icp->next);
+        }
+      }
+      if (chunks.empty()) {
+        return 0;
+      }
+      uint64_t thread_num = std::min<uint64_t>(chunks.size(),
+          std::max(1u, std::thread::hardware_concurrency()));
+      std::vector<std::unordered_map<uint64_t, block_meta_list>> ranges(thread_num);
+      std::vector<std::thread> threads;
+      std::atomic<bool> failed{false};
+      for (uint64_t t = 0; t < thread_num; t++) {
+        threads.emplace_back([&, t] {
+          uint64_t begin = chunks.size() * t / thread_num;
+          uint64_t end = chunks.size() * (t + 1) / thread_num;
+          for (uint64_t c = begin; c < end && !failed; c++) {
+            for (uint64_t r = 0; r < chunks[c]->count; r++) {
+              if (load_meta(&ranges[t], &chunks[c]->records[r])) {
+                failed = true;
+                break;
+              }
+            }
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      for (auto& range : ranges) {
+        for (auto& it : range) {
+          if (merge_meta(it.first, it.second)) {
+            failed = true;
+          }
+        }
+      }
+      return failed ? -1 : 0;
+    }
+
+    // rebuild in-memory index and index chunks of a lane from its block entries
+    // walk through all the block entry in pmem, in one transaction so that a
+    // crash never leaves a partial index, index chunks allocated in it are not
+    // added to the undo data
+    int recover_index(struct lane* lp, uint64_t flags) {
+      jmp_buf env;
+      if (setjmp(env)) {
+        (void) pmemobj_tx_end();
+        return -1;
+      }
+      if (pmemobj_tx_begin(pmem_pool, env, TX_PARAM_NONE)) {
+        perror("pmemobj_tx_begin failed in pmemkv recover_index");
+        return -1;
+      }
+      pmemobj_tx_add_range_direct(lp, sizeof(struct lane));
+      struct block_entry *next = (struct block_entry*)pmemobj_direct(lp->head);
       while (next != nullptr) {
+        append_index_record(lp, flags, next->hdr.key, next->data, next->hdr.size);
         if (update_meta(next)) {
-          return -1;
+          pmemobj_tx_abort(ENOMEM);
         }
         next = (struct block_entry*)pmemobj_direct(next->hdr.next);
       }
+      pmemobj_tx_commit();
+      (void) pmemobj_tx_end();
       return 0;
     }
-    
+
     void close() {
       pmemobj_close(pmem_pool);
       free_meta();
@@ -368,6 +624,54 @@ class pmemkv {
       return 0;
     }
 
+    // append the block of an index record to the in-memory index of a range
+    int load_meta(std::unordered_map<uint64_t, block_meta_list>* range,
+        struct index_record* irp) {
+      struct block_meta* bm = (struct block_meta*)std::malloc(sizeof(block_meta));
+      if (!bm) {
+        perror("malloc error in pmemkv load_meta");
+        return -1;
+      }
+      bytes_allocated += sizeof(block_meta);
+      bm->off = (uint64_t)pmemobj_direct(irp->data);
+      bm->size = irp->size;
+      bm->next = nullptr;
+      // value-initialized to an empty list
+      struct block_meta_list& bml = (*range)[irp->key];
+      if (bml.tail == nullptr) {
+        bml.head = bm;
+      } else {
+        bml.tail->next = bm;
+      }
+      bml.tail = bm;
+      bml.total_size += bm->size;
+      bml.length += 1;
+      return 0;
+    }
+
+    // append the blocks of a key loaded from a range to the in-memory index
+    int merge_meta(uint64_t key, const struct block_meta_list& range_bml) {
+      std::lock_guard<std::mutex> l(mtx);
+      if (!index_map.contains(key)) {
+        struct block_meta_list* bml = (struct block_meta_list*)std::malloc(sizeof(block_meta_list));
+        if (!bml) {
+          perror("malloc error in pmemkv merge_meta");
+          return -1;
+        }
+        bytes_allocated += sizeof(block_meta_list);
+        *bml = range_bml;
+        index_map.insert(key, bml);
+      } else {
+        struct block_meta_list* bml = nullptr;
+        index_map.find(key, bml);
+        bml->tail->next = range_bml.head;
+        bml->tail = range_bml.tail;
+        bml->total_size += range_bml.total_size;
+        bml->length += range_bml.length;
+      }
+      return 0;
+    }
+
     int update_meta(struct block_entry* bep) {
       std::lock_guard<std::mutex> l(mtx);
       if (!index_map.contains(bep->hdr.key)) {  // allocate new block_meta_list
@@ -418,6 +722,7 @@ class pmemkv {
     const char* dev_path;
     struct base* bp;
     PMEMoid bo;
+    uint64_t lane_flags[PMEMKV_LANES] = {};
     libcuckoo::cuckoohash_map<uint64_t, block_meta_list*> index_map;
     std::mutex mtx;
     std::atomic<uint64_t> bytes_allocated{0};
@@ -0,0 +1,205 @@
+/*
+ * Concurrent put/get/open benchmark of pmemkv.
+ *
+ * Each case puts total_size bytes in blocks of block_size from a number of
+ * threads, spread over key_count keys, then reopens the pool, timing the load
+ * of the index, then reads every key back from the same number of threads.
+ * The latency of every put and get is kept to report its percentiles.
+ *
+ * usage: pmemkv_benchmark [-d dev_path] [-t threads,...] [-b block_size,...]
+ *                         [-k key_count,...] [-s total_size]
+ */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pmemkv.h"
+
+struct bench_case {
+  uint64_t threads;
+  uint64_t block_size;
+  uint64_t key_count;
+  uint64_t total_size;
+};
+
+struct bench_result {
+  double seconds;
+  uint64_t ops;
+  uint64_t bytes;
+  // latency of each operation, in ns
+  std::vector<uint64_t> latency_ns;
+};
+
+uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<uint64_t> parse_list(const char* arg) {
+  std::vector<uint64_t> values;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    values.push_back(std::stoull(item));
+  }
+  return values;
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t i = fraction * (sorted.size() - 1);
+  return sorted[i];
+}
+
+void report(const char* op, const bench_case& c, bench_result& r) {
+  std::sort(r.latency_ns.begin(), r.latency_ns.end());
+  std::cout << std::fixed << std::setprecision(2)
+            << op << " threads " << c.threads << " block " << c.block_size
+            << " keys " << c.key_count << ": " << r.seconds << "s, "
+            << r.ops / r.seconds << " ops/s, "
+            << r.bytes / 1024.0 / 1024.0 / r.seconds << " MB/s";
+  if (!r.latency_ns.empty()) {
+    std::cout << ", latency us p50 " << percentile(r.latency_ns, 0.5) / 1000.0
+              << " p99 " << percentile(r.latency_ns, 0.99) / 1000.0
+              << " p99.9 " << percentile(r.latency_ns, 0.999) / 1000.0
+              << " max " << r.latency_ns.back() / 1000.0;
+  }
+  std::cout << std::endl;
+}
+
+// run fn(thread_id, latencies) on c.threads threads, merging their latencies
+template <typename F>
+bench_result run_threads(const bench_case& c, F fn) {
+  std::vector<std::vector<uint64_t>> latencies(c.threads);
+  std::vector<std::thread> threads;
+  uint64_t start = now_ns();
+  for (uint64_t t = 0; t < c.threads; t++) {
+    threads.emplace_back(fn, t, &latencies[t]);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  bench_result r;
+  r.seconds = (now_ns() - start) / 1e9;
+  for (auto& l : latencies) {
+    r.latency_ns.insert(r.latency_ns.end(), l.begin(), l.end());
+  }
+  r.ops = r.latency_ns.size();
+  r.bytes = 0;
+  return r;
+}
+
+int run_case(const char* dev_path, const bench_case& c) {
+  pmemkv* kv = new pmemkv(dev_path);
+  uint64_t blocks = c.total_size / c.block_size;
+
+  // thread t puts blocks t, t + threads, ..., block i to key i % key_count
+  bench_result put = run_threads(c, [&](uint64_t t, std::vector<uint64_t>* l) {
+    std::vector<char> buf(c.block_size, 'a' + t % 26);
+    for (uint64_t i = t; i < blocks; i += c.threads) {
+      std::string key = std::to_string(i % c.key_count);
+      uint64_t start = now_ns();
+      kv->put(key, buf.data(), c.block_size);
+      l->push_back(now_ns() - start);
+    }
+  });
+  put.bytes = put.ops * c.block_size;
+  report("put", c, put);
+  delete kv;
+
+  // open loads the index of every block written above
+  bench_result open;
+  uint64_t start = now_ns();
+  kv = new pmemkv(dev_path);
+  open.seconds = (now_ns() - start) / 1e9;
+  open.ops = blocks;
+  open.bytes = 0;
+  std::cout << "open threads " << c.threads << " block " << c.block_size
+            << " keys " << c.key_count << ": " << open.seconds << "s, "
+            << open.ops / open.seconds << " blocks indexed/s" << std::endl;
+
+  // thread t gets keys t, t + threads, ... whole
+  std::vector<uint64_t> key_bytes(c.threads, 0);
+  bench_result get = run_threads(c, [&](uint64_t t, std::vector<uint64_t>* l) {
+    std::vector<char> buf;
+    for (uint64_t k = t; k < c.key_count && k < blocks; k += c.threads) {
+      std::string key = std::to_string(k);
+      uint64_t size = 0;
+      kv->get_value_size(key, &size);
+      buf.resize(size);
+      struct memory_block mb = {buf.data(), size};
+      uint64_t start = now_ns();
+      if (kv->get(key, &mb)) {
+        std::cerr << "failed to get key " << key << std::endl;
+        continue;
+      }
+      l->push_back(now_ns() - start);
+      key_bytes[t] += size;
+    }
+  });
+  for (auto bytes : key_bytes) {
+    get.bytes += bytes;
+  }
+  report("get", c, get);
+
+  kv->free_all();
+  delete kv;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  const char* dev_path = "/dev/dax0.0";
+  std::vector<uint64_t> threads = {1, 2, 4, 8, 16};
+  std::vector<uint64_t> block_sizes = {4*1024, 64*1024, 1024*1024};
+  std::vector<uint64_t> key_counts = {16, 1024};
+  uint64_t total_size = 1024*1024*1024;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "d:t:b:k:s:")) != -1) {
+    switch (opt) {
+      case 'd':
+        dev_path = optarg;
+        break;
+      case 't':
+        threads = parse_list(optarg);
+        break;
+      case 'b':
+        block_sizes = parse_list(optarg);
+        break;
+      case 'k':
+        key_counts = parse_list(optarg);
+        break;
+      case 's':
+        total_size = std::stoull(optarg);
+        break;
+      default:
+        std::cerr << "usage: " << argv[0] << " [-d dev_path] [-t threads,...]"
+                  << " [-b block_size,...] [-k key_count,...] [-s total_size]"
+                  << std::endl;
+        return -1;
+    }
+  }
+
+  for (auto block_size : block_sizes) {
+    for (auto key_count : key_counts) {
+      for (auto thread_num : threads) {
+        bench_case c = {thread_num, block_size, key_count, total_size};
+        if (run_case(dev_path, c)) {
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/benchmark/local_append.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/benchmark
+ * Created Date: Wednesday, October 14th 2020, 10:12:20 am
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <string.h>
+
+#include <iostream>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "../pmpool/AllocatorProxy.h"
+#include "../pmpool/Config.h"
+#include "../pmpool/Log.h"
+
+uint64_t timestamp_now() {
+  return std::chrono::high_resolution_clock::now().time_since_epoch() /
+         std::chrono::milliseconds(1);
+}
+
+std::mutex mtx;
+uint64_t count = 0;
+char str[1048576];
+const uint64_t shuffle = 1;
+
+// same blocks as local_allocate, appended to the extents of one shuffle
+void func(AllocatorProxy *proxy, int index) {
+  std::vector<uint64_t> sizes = {1048576};
+  std::vector<const char *> contents = {str};
+  while (true) {
+    std::unique_lock<std::mutex> lk(mtx);
+    uint64_t count_ = count++;
+    lk.unlock();
+    if (count_ < 20480) {
+      std::vector<uint64_t> addresses;
+      proxy->append_batch(shuffle, sizes, contents, &addresses, index);
+    } else {
+      break;
+    }
+  }
+}
+
+int main() {
+  std::shared_ptr<Config> config = std::make_shared<Config>();
+  config->init(0, nullptr);
+  std::shared_ptr<Log> log = std::make_shared<Log>(config.get());
+  auto allocatorProxy = new AllocatorProxy(config.get(), log.get(), nullptr);
+  allocatorProxy->init();
+  std::vector<std::thread *> threads;
+  memset(str, '0', 1048576);
+
+  uint64_t start = timestamp_now();
+  int num = 0;
+  for (int i = 0; i < 4; i++) {
+    num++;
+    auto t = new std::thread(func, allocatorProxy, i);
+    threads.push_back(t);
+  }
+  for (int i = 0; i < num; i++) {
+    threads[i]->join();
+    delete threads[i];
+  }
+  uint64_t end = timestamp_now();
+  std::cout << "pmem append test: 1048576 "
+            << " bytes test, consumes " << (end - start) / 1000.0
+            << "s, throughput is " << 20480 / ((end - start) / 1000.0) << "MB/s"
+            << std::endl;
+  start = timestamp_now();
+  allocatorProxy->release_shuffle(shuffle);
+  end = timestamp_now();
+  std::cout << "release shuffle consumes " << (end - start) / 1000.0 << "s"
+            << std::endl;
+  allocatorProxy->release_all();
+}
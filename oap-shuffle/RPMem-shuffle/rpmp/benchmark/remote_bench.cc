@@ -0,0 +1,379 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/benchmark/remote_bench.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/benchmark
+ * Created Date: Thursday, October 15th 2020, 9:21:45 am
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "pmpool/client/PmPoolClient.h"
+
+using boost::program_options::options_description;
+using boost::program_options::value;
+using boost::program_options::variables_map;
+
+uint64_t timestamp_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief Log-linear histogram of latencies in nanoseconds.
+ *
+ * Each power of two is split into 16 buckets, so a percentile is off by at
+ * most 1/16 of its value. Recorded concurrently by the network threads of the
+ * pipelined mode.
+ */
+class LatencyHistogram {
+ public:
+  static const int SUB_BUCKETS = 16;
+  static const int BUCKETS = 61 * SUB_BUCKETS;
+
+  LatencyHistogram() {
+    for (auto &bucket : buckets_) {
+      bucket = 0;
+    }
+  }
+
+  void record(uint64_t ns) {
+    buckets_[index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (ns > max && !max_.compare_exchange_weak(max, ns)) {
+    }
+  }
+
+  uint64_t count() const { return count_; }
+  uint64_t max() const { return max_; }
+  double mean() const { return count_ ? 1.0 * sum_ / count_ : 0; }
+
+  /// Lower bound of the bucket of the p-th percentile, p in [0, 1]
+  uint64_t percentile(double p) const {
+    uint64_t rank = static_cast<uint64_t>(p * count_);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+      seen += buckets_[i];
+      if (seen > rank) {
+        return lower_bound_of(i);
+      }
+    }
+    return max();
+  }
+
+ private:
+  static int index_of(uint64_t ns) {
+    if (ns < SUB_BUCKETS) {
+      return ns;
+    }
+    int msb = 63 - __builtin_clzll(ns);
+    return (msb - 3) * SUB_BUCKETS + ((ns >> (msb - 4)) & (SUB_BUCKETS - 1));
+  }
+
+  static uint64_t lower_bound_of(int index) {
+    if (index < SUB_BUCKETS) {
+      return index;
+    }
+    int msb = index / SUB_BUCKETS + 3;
+    return (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << (msb - 4);
+  }
+
+  std::atomic<uint64_t> buckets_[BUCKETS];
+  std::atomic<uint64_t> count_ = {0};
+  std::atomic<uint64_t> sum_ = {0};
+  std::atomic<uint64_t> max_ = {0};
+};
+
+struct BenchOptions {
+  string address;
+  string port;
+  uint64_t block_size;
+  uint64_t ops;
+  int clients;
+  int connections;
+  int threads;
+  uint64_t max_outstanding;
+  int read_percent;
+  string mode;
+  string write_op;
+  uint64_t batch;
+  bool one_sided;
+  uint64_t working_set;
+};
+
+/// Shared state of the ops of a run
+struct BenchState {
+  std::vector<std::shared_ptr<PmPoolClient>> clients;
+  std::vector<uint64_t> addresses;
+  std::vector<const char *> batch_data;
+  std::vector<uint64_t> batch_sizes;
+  std::vector<char> data;
+  /// by thread, the buffers its reads go to, kept until all ops are done
+  std::vector<std::vector<char>> read_buffers;
+  std::atomic<uint64_t> next_op = {0};
+  std::atomic<uint64_t> finished = {0};
+  std::atomic<uint64_t> failed = {0};
+  std::mutex mtx;
+  std::condition_variable cv;
+  LatencyHistogram read_latency;
+  LatencyHistogram write_latency;
+};
+
+const uint64_t shuffle = 1;
+
+void finish_op(BenchState *state, const BenchOptions &options) {
+  if (++state->finished == options.ops) {
+    std::lock_guard<std::mutex> lk(state->mtx);
+    state->cv.notify_all();
+  }
+}
+
+/// Issue ops until options.ops are issued over all threads. In sync mode each
+/// op is waited for, in pipelined mode up to max_outstanding per connection
+/// stay in flight.
+void run_thread(BenchState *state, const BenchOptions &options, int t) {
+  auto client = state->clients[t % state->clients.size()];
+  bool pipelined = options.mode == "pipelined";
+  auto &read_buffer = state->read_buffers[t];
+  uint64_t slots = read_buffer.size() / options.block_size;
+  std::mt19937_64 rng(t);
+  std::uniform_int_distribution<int> percent(0, 99);
+  while (true) {
+    uint64_t op = state->next_op++;
+    if (op >= options.ops) {
+      break;
+    }
+    bool is_read = percent(rng) < options.read_percent;
+    uint64_t start = timestamp_ns();
+    if (is_read) {
+      uint64_t address = state->addresses[op % state->addresses.size()];
+      char *dest = &read_buffer[(op % slots) * options.block_size];
+      auto done = [state, &options, start](int res) {
+        state->read_latency.record(timestamp_ns() - start);
+        if (res != 0) {
+          state->failed++;
+        }
+        finish_op(state, options);
+      };
+      if (pipelined) {
+        client->read(address, dest, options.block_size, done);
+      } else {
+        done(client->read(address, dest, options.block_size));
+      }
+    } else if (options.write_op == "write") {
+      auto done = [state, &options, start](uint64_t address) {
+        state->write_latency.record(timestamp_ns() - start);
+        if (address == static_cast<uint64_t>(-1)) {
+          state->failed++;
+        }
+        finish_op(state, options);
+      };
+      if (pipelined) {
+        client->write(state->data.data(), options.block_size, done);
+      } else {
+        done(client->write(state->data.data(), options.block_size));
+      }
+    } else {
+      // a batch of blocks in one request, its latency counted once
+      auto done = [state, &options, start](std::vector<uint64_t> addresses) {
+        state->write_latency.record(timestamp_ns() - start);
+        if (addresses.empty()) {
+          state->failed++;
+        }
+        finish_op(state, options);
+      };
+      if (options.write_op == "append") {
+        if (pipelined) {
+          client->append(shuffle, state->batch_data, state->batch_sizes, done);
+        } else {
+          done(client->append(shuffle, state->batch_data, state->batch_sizes));
+        }
+      } else {
+        if (pipelined) {
+          client->write(state->batch_data, state->batch_sizes, done);
+        } else {
+          done(client->write(state->batch_data, state->batch_sizes));
+        }
+      }
+    }
+  }
+}
+
+void report(const string &name, const LatencyHistogram &latency) {
+  if (latency.count() == 0) {
+    return;
+  }
+  std::cout << std::fixed << std::setprecision(1) << name
+            << ": ops=" << latency.count()
+            << " mean=" << latency.mean() / 1000.0
+            << "us p50=" << latency.percentile(0.5) / 1000.0
+            << "us p99=" << latency.percentile(0.99) / 1000.0
+            << "us p999=" << latency.percentile(0.999) / 1000.0
+            << "us max=" << latency.max() / 1000.0 << "us" << std::endl;
+}
+
+int parse_options(int argc, char **argv, BenchOptions *options) {
+  options_description desc{"Options"};
+  desc.add_options()("help,h", "Help screen")(
+      "address,a", value<string>()->default_value("172.168.0.40"),
+      "set the rdma server address")(
+      "port,p", value<string>()->default_value("12346"),
+      "set the rdma server port")(
+      "block_size,bs", value<uint64_t>()->default_value(65536),
+      "set the bytes of a block")(
+      "ops,o", value<uint64_t>()->default_value(1000000),
+      "set the ops of all the threads")(
+      "clients,c", value<int>()->default_value(1),
+      "set the number of clients, each with its own connections")(
+      "connections,cn", value<int>()->default_value(1),
+      "set the connections of a client")(
+      "threads,t", value<int>()->default_value(1),
+      "set the threads issuing ops, round robin over the clients")(
+      "max_outstanding,mo", value<uint64_t>()->default_value(32),
+      "set the requests in flight per connection")(
+      "read_percent,r", value<int>()->default_value(0),
+      "set the percent of reads, the others are writes")(
+      "mode,m", value<string>()->default_value("sync"),
+      "sync waits for each op, pipelined keeps ops in flight")(
+      "write_op,w", value<string>()->default_value("write"),
+      "write, batch or append the blocks of a write")(
+      "batch,b", value<uint64_t>()->default_value(16),
+      "set the blocks of a batch or append write")(
+      "one_sided,os", value<bool>()->default_value(false),
+      "read with one-sided rdma reads")(
+      "working_set,ws", value<uint64_t>()->default_value(1024),
+      "set the blocks written before the run for the reads");
+
+  variables_map vm;
+  try {
+    store(parse_command_line(argc, argv, desc), vm);
+    notify(vm);
+  } catch (const boost::program_options::error &ex) {
+    std::cerr << ex.what() << '\n';
+    return -1;
+  }
+  if (vm.count("help")) {
+    std::cout << desc << '\n';
+    return -1;
+  }
+  options->address = vm["address"].as<string>();
+  options->port = vm["port"].as<string>();
+  options->block_size = vm["block_size"].as<uint64_t>();
+  options->ops = vm["ops"].as<uint64_t>();
+  options->clients = std::max(vm["clients"].as<int>(), 1);
+  options->connections = std::max(vm["connections"].as<int>(), 1);
+  options->threads = std::max(vm["threads"].as<int>(), 1);
+  options->max_outstanding = vm["max_outstanding"].as<uint64_t>();
+  options->read_percent = vm["read_percent"].as<int>();
+  options->mode = vm["mode"].as<string>();
+  options->write_op = vm["write_op"].as<string>();
+  options->batch = std::max<uint64_t>(vm["batch"].as<uint64_t>(), 1);
+  options->one_sided = vm["one_sided"].as<bool>();
+  options->working_set =
+      std::max<uint64_t>(vm["working_set"].as<uint64_t>(), 1);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options;
+  if (parse_options(argc, argv, &options) != 0) {
+    return -1;
+  }
+  BenchState state;
+  state.data.assign(options.block_size * options.batch, '0');
+  for (uint64_t i = 0; i < options.batch; i++) {
+    state.batch_data.push_back(&state.data[i * options.block_size]);
+    state.batch_sizes.push_back(options.block_size);
+  }
+  for (int i = 0; i < options.clients; i++) {
+    auto client = std::make_shared<PmPoolClient>(
+        options.address, options.port, options.connections,
+        options.max_outstanding);
+    if (client->init() != 0) {
+      std::cerr << "failed to connect to " << options.address << ":"
+                << options.port << std::endl;
+      return -1;
+    }
+    if (options.one_sided && client->enable_one_sided_read() != 0) {
+      std::cerr << "failed to enable one-sided reads" << std::endl;
+      return -1;
+    }
+    state.clients.push_back(client);
+  }
+  if (options.read_percent > 0) {
+    for (uint64_t i = 0; i < options.working_set; i++) {
+      state.addresses.push_back(
+          state.clients[0]->write(state.data.data(), options.block_size));
+    }
+  }
+
+  // one slot per op a thread may have in flight, read into round robin
+  uint64_t slots = options.mode == "pipelined"
+                       ? options.connections * options.max_outstanding
+                       : 1;
+  for (int t = 0; t < options.threads; t++) {
+    state.read_buffers.emplace_back(std::max<uint64_t>(slots, 1) *
+                                    options.block_size);
+  }
+
+  std::vector<std::thread> threads;
+  uint64_t start = timestamp_ns();
+  for (int t = 0; t < options.threads; t++) {
+    threads.emplace_back(run_thread, &state, std::cref(options), t);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  {
+    std::unique_lock<std::mutex> lk(state.mtx);
+    state.cv.wait(lk, [&] { return state.finished == options.ops; });
+  }
+  double seconds = (timestamp_ns() - start) / 1e9;
+
+  uint64_t read_bytes = state.read_latency.count() * options.block_size;
+  uint64_t write_blocks = options.write_op == "write" ? 1 : options.batch;
+  uint64_t write_bytes =
+      state.write_latency.count() * write_blocks * options.block_size;
+  std::cout << options.mode << " " << options.write_op
+            << (options.one_sided ? " one-sided" : "") << ": "
+            << options.block_size << " bytes, " << options.clients
+            << " clients, " << options.connections << " connections, "
+            << options.threads << " threads, " << options.read_percent
+            << "% reads" << std::endl;
+  std::cout << std::fixed << std::setprecision(1) << "consumes " << seconds
+            << "s, " << options.ops / seconds << " ops/s, "
+            << (read_bytes + write_bytes) / 1024.0 / 1024.0 / seconds
+            << "MB/s, " << state.failed << " failed" << std::endl;
+  report("read", state.read_latency);
+  report("write", state.write_latency);
+
+  if (options.write_op == "append") {
+    state.clients[0]->release_shuffle(shuffle);
+  }
+  for (auto address : state.addresses) {
+    state.clients[0]->free(address);
+  }
+  for (auto &client : state.clients) {
+    client->shutdown();
+    client->wait();
+  }
+  return 0;
+}
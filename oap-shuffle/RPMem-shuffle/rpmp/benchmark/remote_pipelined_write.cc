@@ -0,0 +1,59 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/benchmark/remote_pipelined_write.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/benchmark
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <string.h>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <iostream>
+#include <mutex>  // NOLINT
+#include "pmpool/client/PmPoolClient.h"
+
+char str[1048576];
+uint64_t buffer_size = 1024 * 64;
+uint64_t buffer_num = 1000000;
+int connection_num = 4;
+uint64_t max_outstanding = 32;
+
+std::atomic<uint64_t> finished = {0};
+std::mutex mtx;
+std::condition_variable cv;
+
+uint64_t timestamp_now() {
+  return std::chrono::high_resolution_clock::now().time_since_epoch() /
+         std::chrono::milliseconds(1);
+}
+
+int main() {
+  memset(str, '0', buffer_size);
+  PmPoolClient client("172.168.0.40", "12346", connection_num,
+                      max_outstanding);
+  client.init();
+  uint64_t start = timestamp_now();
+  // one thread keeps connection_num * max_outstanding writes in flight
+  for (uint64_t i = 0; i < buffer_num; i++) {
+    client.write(str, buffer_size, [](uint64_t address) {
+      if (++finished == buffer_num) {
+        std::lock_guard<std::mutex> lk(mtx);
+        cv.notify_one();
+      }
+    });
+  }
+  std::unique_lock<std::mutex> lk(mtx);
+  while (finished < buffer_num) {
+    cv.wait(lk);
+  }
+  uint64_t end = timestamp_now();
+  std::cout << "pipelined write test: " << buffer_size << " bytes, "
+            << connection_num << " connections, consumes "
+            << (end - start) / 1000.0 << "s, throughput is "
+            << buffer_num * buffer_size / 1024.0 / 1024.0 /
+                   ((end - start) / 1000.0)
+            << "MB/s" << std::endl;
+  client.shutdown();
+  client.wait();
+  return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/AdaptiveBackoff.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool
+ * Created Date: Thursday, October 15th 2020, 11:02:36 am
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_ADAPTIVEBACKOFF_H_
+#define PMPOOL_ADAPTIVEBACKOFF_H_
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <thread>  // NOLINT
+
+/**
+ * @brief Backoff of a worker busy-polling its queue.
+ *
+ * The worker spins on its queue while requests keep coming, yields its cpu
+ * between polls once nothing came for SPIN_POLLS polls, and goes back to the
+ * blocking wait of its queue once idle for spin_us, until the next request.
+ * With spin_us 0 the worker always blocks.
+ */
+class AdaptiveBackoff {
+ public:
+  static const uint64_t SPIN_POLLS = 1024;
+
+  explicit AdaptiveBackoff(uint64_t spin_us) : spin_ns_(spin_us * 1000) {}
+
+  /// A request came, poll again
+  void reset() {
+    polls_ = 0;
+    blocking_ = false;
+  }
+
+  /// Nothing came, return true to poll again, false to block
+  bool keep_polling() {
+    if (spin_ns_ == 0 || blocking_) {
+      return false;
+    }
+    if (polls_++ == 0) {
+      idle_since_ = now();
+      return true;
+    }
+    if (polls_ < SPIN_POLLS) {
+      return true;
+    }
+    if (now() - idle_since_ >= spin_ns_) {
+      blocking_ = true;
+      return false;
+    }
+    std::this_thread::yield();
+    return true;
+  }
+
+ private:
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  const uint64_t spin_ns_;
+  uint64_t polls_ = 0;
+  uint64_t idle_since_ = 0;
+  bool blocking_ = false;
+};
+
+#endif  // PMPOOL_ADAPTIVEBACKOFF_H_
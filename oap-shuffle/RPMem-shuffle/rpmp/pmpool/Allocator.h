@@ -13,10 +13,15 @@
 #include <stdint.h>
 
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "Base.h"
 
 class Chunk;
 
 using std::string;
+using std::vector;
 
 typedef uint64_t ptr_t;
 
@@ -41,6 +46,31 @@ class Allocator {
   virtual int init() = 0;
   virtual uint64_t allocate_and_write(uint64_t buffer_size,
                                       const char* content = nullptr) = 0;
+  /// Allocate blocks of sizes and write contents[i], if not nullptr, into
+  /// block i, in one transaction. Return 0 and the addresses of the blocks in
+  /// addresses if succeed.
+  virtual int allocate_and_write_batch(const vector<uint64_t>& sizes,
+                                       const vector<const char*>& contents,
+                                       vector<uint64_t>* addresses) = 0;
+  /// Bump allocate blocks of sizes from the extents of shuffle, without
+  /// zeroing, and write contents[i] into block i. Return 0 and the addresses
+  /// of the blocks in addresses if succeed. The blocks are freed only all at
+  /// once by release_shuffle.
+  virtual int append_batch(uint64_t shuffle, const vector<uint64_t>& sizes,
+                           const vector<const char*>& contents,
+                           vector<uint64_t>* addresses) = 0;
+  /// Free the extents of shuffle, return 0 if succeed.
+  virtual int release_shuffle(uint64_t shuffle) = 0;
+  /// True if blocks were appended to the extents of shuffle in this pool
+  virtual bool has_extents(uint64_t shuffle) = 0;
+  /// persistent index of the keys of the key-value interface, each key with
+  /// the blocks of its values in this pool
+  /// Record block bm as a value of key, seq orders the values of a key.
+  virtual int put_key(uint64_t key, const block_meta& bm, uint64_t seq) = 0;
+  /// Append the values of key in this pool, with their seq, to values.
+  virtual int get_key(uint64_t key,
+                      vector<std::pair<uint64_t, block_meta>>* values) = 0;
+  virtual int del_key(uint64_t key) = 0;
   virtual int write(uint64_t address, const char* content, uint64_t size) = 0;
   virtual int release(uint64_t address) = 0;
   virtual int release_all() = 0;
@@ -10,9 +10,13 @@
 #ifndef PMPOOL_ALLOCATORPROXY_H_
 #define PMPOOL_ALLOCATORPROXY_H_
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>  // NOLINT
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
@@ -29,24 +33,38 @@ using std::unordered_map;
 using std::string;
 using std::vector;
 
+/// Shards of the key-value index, each with its mutex
+#define KV_SHARD_NUM 64
+
 /**
  * @brief Allocator proxy schedule faily to guarantee event to be assigned to
  * different allocators.
  *
+ * The blocks of the keys of the key-value interface are indexed in shards,
+ * backed by the persistent key index of the pools of the blocks. A key not in
+ * its shard, e.g. after a restart, is loaded from the pools on first use.
+ * The keys put under a prefix, e.g. of a shuffle, are also kept by prefix in
+ * memory, so that they are deleted at once.
  */
 class AllocatorProxy {
  public:
   AllocatorProxy() = delete;
   AllocatorProxy(Config *config, Log *log, NetworkServer *networkServer)
-      : config_(config), log_(log) {
+      : config_(config),
+        log_(log),
+        // above the seq of the values put before a restart
+        kv_seq_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count()) {
     vector<string> paths = config_->get_pool_paths();
     vector<uint64_t> sizes = config_->get_pool_sizes();
     assert(paths.size() == sizes.size());
     for (int i = 0; i < paths.size(); i++) {
       DiskInfo *diskInfo = new DiskInfo(paths[i], sizes[i]);
       diskInfos_.push_back(diskInfo);
-      allocators_.push_back(
-          new PmemObjAllocator(log_, diskInfo, networkServer, i));
+      allocators_.push_back(new PmemObjAllocator(
+          log_, diskInfo, networkServer, i,
+          persist_mode_of(config_->get_persist_mode(i))));
     }
   }
 
@@ -76,6 +94,49 @@ class AllocatorProxy {
       addr = allocators_[index % diskInfos_.size()]->allocate_and_write(
           size, content);
     }
+    return addr;
+  }
+
+  int allocate_and_write_batch(const vector<uint64_t> &sizes,
+                               const vector<const char *> &contents,
+                               vector<uint64_t> *addresses, int index = -1) {
+    if (index < 0) {
+      index = buffer_id_++;
+    }
+    return allocators_[index % diskInfos_.size()]->allocate_and_write_batch(
+        sizes, contents, addresses);
+  }
+
+  int append_batch(uint64_t shuffle, const vector<uint64_t> &sizes,
+                   const vector<const char *> &contents,
+                   vector<uint64_t> *addresses, int index = -1) {
+    if (index < 0) {
+      index = buffer_id_++;
+    }
+    return allocators_[index % diskInfos_.size()]->append_batch(
+        shuffle, sizes, contents, addresses);
+  }
+
+  /// The extents of shuffle are on any pool its blocks were appended to
+  int release_shuffle(uint64_t shuffle) {
+    int res = 0;
+    for (int i = 0; i < diskInfos_.size(); i++) {
+      if (allocators_[i]->release_shuffle(shuffle)) {
+        res = -1;
+      }
+    }
+    return res;
+  }
+
+  /// True if blocks were appended to the extents of shuffle, e.g. merged
+  /// under key shuffle
+  bool has_extents(uint64_t shuffle) {
+    for (int i = 0; i < diskInfos_.size(); i++) {
+      if (allocators_[i]->has_extents(shuffle)) {
+        return true;
+      }
+    }
+    return false;
   }
 
   int write(uint64_t address, const char *content, uint64_t size) {
@@ -118,35 +179,111 @@ class AllocatorProxy {
   }
 
   void cache_chunk(uint64_t key, block_meta bm) {
-    if (kv_meta_map.count(key)) {
-      kv_meta_map[key].push_back(bm);
-    } else {
-      vector<block_meta> bml;
-      bml.push_back(bm);
-      kv_meta_map[key] = bml;
-    }
+    auto &shard = kv_shard(key);
+    std::lock_guard<std::mutex> l(shard.mtx);
+    auto &bml = load_key(&shard, key);
+    allocators_[GET_WID(bm.address)]->put_key(key, bm, kv_seq_++);
+    bml.push_back(bm);
   }
 
   vector<block_meta> get_cached_chunk(uint64_t key) {
-    if (kv_meta_map.count(key)) {
-      return kv_meta_map[key];
+    auto &shard = kv_shard(key);
+    std::lock_guard<std::mutex> l(shard.mtx);
+    auto bml = load_key(&shard, key);
+    if (bml.empty()) {
+      shard.kv_meta_map.erase(key);
     }
-    return vector<block_meta>();
+    return bml;
   }
 
   void del_chunk(uint64_t key) {
-    if (kv_meta_map.count(key))  {
-      kv_meta_map.erase(key);
+    auto &shard = kv_shard(key);
+    std::lock_guard<std::mutex> l(shard.mtx);
+    shard.kv_meta_map.erase(key);
+    for (auto allocator : allocators_) {
+      allocator->del_key(key);
+    }
+  }
+
+  /// Free the blocks of key and delete it, return 0 if all are freed
+  int release_key(uint64_t key) {
+    if (has_extents(key)) {
+      // the blocks merged under key are in its own extents
+      int res = release_shuffle(key);
+      del_chunk(key);
+      return res;
+    }
+    int res = 0;
+    for (auto &bm : get_cached_chunk(key)) {
+      res = release(bm.address);
+      if (res) {
+        break;
+      }
     }
+    del_chunk(key);
+    return res;
+  }
+
+  /// Remember that keys were put under prefix, for take_prefix_keys
+  void add_prefix_keys(uint64_t prefix, const vector<uint64_t> &keys) {
+    std::lock_guard<std::mutex> l(prefix_mtx_);
+    auto &prefix_keys = prefix_keys_[prefix];
+    prefix_keys.insert(prefix_keys.end(), keys.begin(), keys.end());
+  }
+
+  /// Forget and return the keys put under prefix since it was last taken
+  vector<uint64_t> take_prefix_keys(uint64_t prefix) {
+    std::lock_guard<std::mutex> l(prefix_mtx_);
+    vector<uint64_t> keys;
+    auto it = prefix_keys_.find(prefix);
+    if (it != prefix_keys_.end()) {
+      keys = std::move(it->second);
+      prefix_keys_.erase(it);
+    }
+    return keys;
   }
 
  private:
+  struct KvShard {
+    std::mutex mtx;
+    unordered_map<uint64_t, vector<block_meta>> kv_meta_map;
+  };
+
+  KvShard &kv_shard(uint64_t key) { return kv_shards_[key % KV_SHARD_NUM]; }
+
+  // Blocks of key in shard, loaded from the pools in put order if not there
+  vector<block_meta> &load_key(KvShard *shard, uint64_t key) {
+    auto it = shard->kv_meta_map.find(key);
+    if (it != shard->kv_meta_map.end()) {
+      return it->second;
+    }
+    vector<std::pair<uint64_t, block_meta>> values;
+    for (auto allocator : allocators_) {
+      allocator->get_key(key, &values);
+    }
+    std::sort(values.begin(), values.end(),
+              [](const std::pair<uint64_t, block_meta> &a,
+                 const std::pair<uint64_t, block_meta> &b) {
+                return a.first < b.first;
+              });
+    auto &bml = shard->kv_meta_map[key];
+    for (auto &value : values) {
+      bml.push_back(value.second);
+    }
+    return bml;
+  }
+
   Config *config_;
   Log *log_;
   vector<Allocator *> allocators_;
   vector<DiskInfo *> diskInfos_;
   atomic<uint64_t> buffer_id_{0};
-  unordered_map<uint64_t, vector<block_meta>> kv_meta_map;
+  // seq of the next value put
+  atomic<uint64_t> kv_seq_;
+  KvShard kv_shards_[KV_SHARD_NUM];
+  std::mutex prefix_mtx_;
+  // by prefix hash, the keys put under it
+  unordered_map<uint64_t, vector<uint64_t>> prefix_keys_;
 };
 
 #endif  // PMPOOL_ALLOCATORPROXY_H_
@@ -0,0 +1,187 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/AsyncLog.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_ASYNCLOG_H_
+#define PMPOOL_ASYNCLOG_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "ThreadWrapper.h"
+
+/// A log message not formatted yet: a format of {} placeholders, a string
+/// literal, and the integer arguments to put in them
+struct LogRecord {
+  static const int MAX_ARGS = 6;
+  const char *fmt;
+  uint64_t args[MAX_ARGS];
+  uint8_t num_args;
+  int level;
+};
+
+/**
+ * @brief Records logged by one thread, for the flusher to take, without
+ * locks: a ring of CAPACITY records with one producer and one consumer. A
+ * record logged while the ring is full, or past rate records in the second,
+ * is dropped and counted rather than waited for.
+ */
+class LogRing {
+ public:
+  static const uint64_t CAPACITY = 4096;
+
+  explicit LogRing(uint64_t rate) : rate_(rate) {}
+
+  /// By the thread of the ring
+  bool push(const LogRecord &record) {
+    if (rate_ != 0 && !admit()) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == CAPACITY) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    records_[tail & (CAPACITY - 1)] = record;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// By the flusher
+  bool pop(LogRecord *record) {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *record = records_[head & (CAPACITY - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Records dropped since the last call
+  uint64_t take_dropped() {
+    return dropped_.exchange(0, std::memory_order_relaxed);
+  }
+
+ private:
+  bool admit() {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+                   .count();
+    if (static_cast<uint64_t>(now) != second_) {
+      second_ = now;
+      logged_ = 0;
+    }
+    return logged_++ < rate_;
+  }
+
+  const uint64_t rate_;
+  uint64_t second_ = 0;
+  uint64_t logged_ = 0;
+  LogRecord records_[CAPACITY];
+  std::atomic<uint64_t> head_ = {0};
+  std::atomic<uint64_t> tail_ = {0};
+  std::atomic<uint64_t> dropped_ = {0};
+};
+
+/**
+ * @brief Logging off the threads logging: each thread pushes its records to
+ * its own LogRing, and a background flusher formats them and hands them to
+ * the sink, in the order of each thread. The cost left to the threads is the
+ * copy of a few words, formatting and I/O go to the flusher, which polls the
+ * rings every flush_ms while they are empty.
+ */
+class AsyncLog : public ThreadWrapper {
+ public:
+  /// Called by the flusher with the level and the formatted message
+  typedef std::function<void(int, const std::string &)> Sink;
+
+  AsyncLog(Sink sink, uint64_t rate, uint64_t flush_ms = 1)
+      : sink_(sink), rate_(rate), flush_ms_(flush_ms) {}
+  ~AsyncLog() override = default;
+
+  void log(const LogRecord &record) { ring()->push(record); }
+
+  /// fmt with its {} replaced by the args of record in order
+  static std::string format(const LogRecord &record) {
+    std::string message;
+    int arg = 0;
+    for (const char *c = record.fmt; *c != '\0'; c++) {
+      if (c[0] == '{' && c[1] == '}' && arg < record.num_args) {
+        message += std::to_string(record.args[arg++]);
+        c++;
+      } else {
+        message += *c;
+      }
+    }
+    return message;
+  }
+
+  /// Format and sink the records logged so far
+  void flush() {
+    std::lock_guard<std::mutex> lk(flush_mtx_);
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+      std::lock_guard<std::mutex> rings_lk(rings_mtx_);
+      rings = rings_;
+    }
+    for (auto &ring : rings) {
+      LogRecord record;
+      while (ring->pop(&record)) {
+        sink_(record.level, format(record));
+      }
+      auto dropped = ring->take_dropped();
+      if (dropped != 0) {
+        sink_(WARN_LEVEL, "dropped " + std::to_string(dropped) +
+                              " log messages of a thread");
+      }
+    }
+  }
+
+  int entry() override {
+    flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(flush_ms_));
+    return 0;
+  }
+
+  void abort() override {}
+
+  /// level of the message of the dropped records
+  static const int WARN_LEVEL = 3;
+
+ private:
+  /// Ring of the calling thread, registered on its first record
+  LogRing *ring() {
+    thread_local AsyncLog *owner = nullptr;
+    thread_local LogRing *ring = nullptr;
+    if (owner != this) {
+      auto new_ring = std::make_shared<LogRing>(rate_);
+      std::lock_guard<std::mutex> lk(rings_mtx_);
+      rings_.push_back(new_ring);
+      owner = this;
+      ring = new_ring.get();
+    }
+    return ring;
+  }
+
+  Sink sink_;
+  const uint64_t rate_;
+  const uint64_t flush_ms_;
+  std::mutex flush_mtx_;
+  std::mutex rings_mtx_;
+  /// rings of all the threads that logged, kept once they exit
+  std::vector<std::shared_ptr<LogRing>> rings_;
+};
+
+#endif  // PMPOOL_ASYNCLOG_H_
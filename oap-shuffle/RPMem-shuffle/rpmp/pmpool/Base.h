@@ -24,6 +24,12 @@
     }                                                               \
   }
 
+/// Most blocks of a batch request, so that the request and its reply fit one
+/// network buffer
+#define MAX_BATCH_NUM 1024
+
+/// Followed by the block_meta of the blocks of a batch request, and by their
+/// keys for PUT_BATCH
 struct RequestMsg {
   uint32_t type;
   uint64_t rid;
@@ -10,6 +10,7 @@
 #ifndef PMPOOL_CONFIG_H_
 #define PMPOOL_CONFIG_H_
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -17,6 +18,8 @@
 
 #include <boost/program_options.hpp>
 
+#include "Numa.h"
+
 using boost::program_options::error;
 using boost::program_options::options_description;
 using boost::program_options::value;
@@ -46,6 +49,35 @@ class Config {
                                        "set network wroker number")(
           "paths,ps", value<vector<string>>(), "set memory pool path")(
           "sizes,ss", value<vector<int>>(), "set memory pool size")(
+          "buffer_prefault,bp", value<bool>()->default_value(false),
+          "touch the pages of the rdma buffers at startup")(
+          "buffer_numa_node,bnn", value<int>()->default_value(-1),
+          "bind the rdma buffers to numa node, -1 for the node of the nic")(
+          "numa_steering,nst", value<bool>()->default_value(true),
+          "allocate new blocks from the pools on the node of the nic")(
+          "busy_poll_us,bpu", value<int>()->default_value(0),
+          "busy-poll the worker queues, blocking once idle for that long")(
+          "inline_requests,ir", value<bool>()->default_value(false),
+          "handle requests on the network threads, without worker queues")(
+          "fair_scheduling,fs", value<bool>()->default_value(false),
+          "serve the requests of the connections in turn by bytes, not in "
+          "arrival order")(
+          "fair_quantum_kb,fq", value<int>()->default_value(64),
+          "set the bytes in KB a connection gets per turn of fair scheduling")(
+          "tenant_bandwidth_mb,tbw", value<int>()->default_value(0),
+          "limit the data of the requests of a connection to that many MB/s, "
+          "0 for no limit")(
+          "tenant_max_inflight,tmi", value<int>()->default_value(0),
+          "refuse the requests of a connection beyond that many in flight, "
+          "for it to send them again later, 0 for no limit")(
+          "persist_modes,pm", value<vector<string>>(),
+          "set the persistence of the data of each pool, tx, batched or "
+          "none, the last one for the pools after it")(
+          "log_async,la", value<bool>()->default_value(false),
+          "format and write the log on a background thread, off the workers")(
+          "log_rate,lr", value<int>()->default_value(0),
+          "drop the async log messages of a thread past that many per "
+          "second, 0 for no limit")(
           "log,l", value<string>()->default_value("/tmp/rpmp.log"),
           "set rpmp log file path")("log_level,ll",
                                     value<string>()->default_value("warn"),
@@ -64,6 +96,8 @@ class Config {
       set_network_buffer_size(vm["network_buffer_size"].as<int>());
       set_network_buffer_num(vm["network_buffer_num"].as<int>());
       set_network_worker_num(vm["network_worker"].as<int>());
+      set_buffer_prefault(vm["buffer_prefault"].as<bool>());
+      set_buffer_numa_node(vm["buffer_numa_node"].as<int>());
       pool_paths_.push_back("/dev/dax0.0");
       pool_paths_.push_back("/dev/dax0.1");
       pool_paths_.push_back("/dev/dax1.0");
@@ -76,6 +110,22 @@ class Config {
       affinities_.push_back(41);
       affinities_.push_back(22);
       affinities_.push_back(60);
+      for (auto &path : pool_paths_) {
+        pool_numa_nodes_.push_back(numa_node_of_path(path));
+      }
+      nic_numa_node_ = numa_node_of_address(ip_);
+      set_numa_steering(vm["numa_steering"].as<bool>());
+      set_busy_poll_us(vm["busy_poll_us"].as<int>());
+      set_inline_requests(vm["inline_requests"].as<bool>());
+      set_fair_scheduling(vm["fair_scheduling"].as<bool>());
+      set_fair_quantum_kb(vm["fair_quantum_kb"].as<int>());
+      set_tenant_bandwidth_mb(vm["tenant_bandwidth_mb"].as<int>());
+      set_tenant_max_inflight(vm["tenant_max_inflight"].as<int>());
+      if (vm.count("persist_modes")) {
+        set_persist_modes(vm["persist_modes"].as<vector<string>>());
+      }
+      set_log_async(vm["log_async"].as<bool>());
+      set_log_rate(vm["log_rate"].as<int>());
       set_log_path(vm["log"].as<string>());
       set_log_level(vm["log_level"].as<string>());
     } catch (const error &ex) {
@@ -105,6 +155,16 @@ class Config {
     network_worker_num_ = network_worker_num;
   }
 
+  bool get_buffer_prefault() { return buffer_prefault_; }
+  void set_buffer_prefault(bool buffer_prefault) {
+    buffer_prefault_ = buffer_prefault;
+  }
+
+  int get_buffer_numa_node() { return buffer_numa_node_; }
+  void set_buffer_numa_node(int buffer_numa_node) {
+    buffer_numa_node_ = buffer_numa_node;
+  }
+
   vector<string> &get_pool_paths() { return pool_paths_; }
   void set_pool_paths(const vector<string> &pool_paths) {
     pool_paths_ = pool_paths;
@@ -117,9 +177,66 @@ class Config {
 
   std::vector<uint64_t> get_affinities_() { return affinities_; }
 
+  /// NUMA node of each pool, -1 if unknown
+  vector<int> &get_pool_numa_nodes() { return pool_numa_nodes_; }
+
+  /// NUMA node of the NIC of the server address, -1 if unknown
+  int get_nic_numa_node() { return nic_numa_node_; }
+
+  bool get_numa_steering() { return numa_steering_; }
+  void set_numa_steering(bool numa_steering) { numa_steering_ = numa_steering; }
+
+  int get_busy_poll_us() { return busy_poll_us_; }
+  void set_busy_poll_us(int busy_poll_us) { busy_poll_us_ = busy_poll_us; }
+
+  /// Persistence mode of the data of pool, tx by default
+  string get_persist_mode(int pool) {
+    if (persist_modes_.empty()) {
+      return "tx";
+    }
+    return persist_modes_[std::min<size_t>(pool, persist_modes_.size() - 1)];
+  }
+  void set_persist_modes(const vector<string> &persist_modes) {
+    persist_modes_ = persist_modes;
+  }
+
+  bool get_inline_requests() { return inline_requests_; }
+  void set_inline_requests(bool inline_requests) {
+    inline_requests_ = inline_requests;
+  }
+
+  bool get_fair_scheduling() { return fair_scheduling_; }
+  void set_fair_scheduling(bool fair_scheduling) {
+    fair_scheduling_ = fair_scheduling;
+  }
+
+  int get_fair_quantum_kb() { return fair_quantum_kb_; }
+  void set_fair_quantum_kb(int fair_quantum_kb) {
+    fair_quantum_kb_ = fair_quantum_kb;
+  }
+
+  /// MB/s of data of the requests of a connection, 0 for no limit
+  int get_tenant_bandwidth_mb() { return tenant_bandwidth_mb_; }
+  void set_tenant_bandwidth_mb(int tenant_bandwidth_mb) {
+    tenant_bandwidth_mb_ = tenant_bandwidth_mb;
+  }
+
+  /// Requests of a connection in flight, beyond which they are refused
+  /// busy, 0 for no limit
+  int get_tenant_max_inflight() { return tenant_max_inflight_; }
+  void set_tenant_max_inflight(int tenant_max_inflight) {
+    tenant_max_inflight_ = tenant_max_inflight;
+  }
+
   string get_log_path() { return log_path_; }
   void set_log_path(string log_path) { log_path_ = log_path; }
 
+  bool get_log_async() { return log_async_; }
+  void set_log_async(bool log_async) { log_async_ = log_async; }
+
+  int get_log_rate() { return log_rate_; }
+  void set_log_rate(int log_rate) { log_rate_ = log_rate; }
+
   string get_log_level() { return log_level_; }
   void set_log_level(string log_level) { log_level_ = log_level; }
 
@@ -129,9 +246,23 @@ class Config {
   int network_buffer_size_;
   int network_buffer_num_;
   int network_worker_num_;
+  bool buffer_prefault_ = false;
+  int buffer_numa_node_ = -1;
   vector<string> pool_paths_;
   vector<uint64_t> sizes_;
   vector<uint64_t> affinities_;
+  vector<int> pool_numa_nodes_;
+  int nic_numa_node_ = -1;
+  bool numa_steering_ = true;
+  int busy_poll_us_ = 0;
+  bool inline_requests_ = false;
+  bool fair_scheduling_ = false;
+  int fair_quantum_kb_ = 64;
+  int tenant_bandwidth_mb_ = 0;
+  int tenant_max_inflight_ = 0;
+  vector<string> persist_modes_;
+  bool log_async_ = false;
+  int log_rate_ = 0;
   string log_path_;
   string log_level_;
 };
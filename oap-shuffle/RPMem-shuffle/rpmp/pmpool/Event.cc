@@ -11,27 +11,47 @@
 
 #include "pmpool/buffer/CircularBuffer.h"
 
+Request::Request() : data_(nullptr), size_(0), requestContext_() {}
+
 Request::Request(RequestContext requestContext)
     : data_(nullptr), size_(0), requestContext_(requestContext) {}
 
-Request::Request(char *data, uint64_t size, Connection *con) : size_(size) {
-  data_ = static_cast<char *>(std::malloc(size));
-  memcpy(data_, data, size_);
-  requestContext_.con = con;
+Request::Request(char *data, uint64_t size, Connection *con)
+    : requestContext_() {
+  reset(data, size, con);
 }
 
-Request::~Request() {
-  if (data_ != nullptr) {
-    std::free(data_);
-    data_ = nullptr;
-  }
+RequestContext &Request::get_rc() { return requestContext_; }
+
+void Request::reset() {
+  // the lists keep their capacity
+  auto bml = std::move(requestContext_.bml);
+  auto keys = std::move(requestContext_.keys);
+  requestContext_ = {};
+  bml.clear();
+  keys.clear();
+  requestContext_.bml = std::move(bml);
+  requestContext_.keys = std::move(keys);
+  data_ = nullptr;
+  size_ = 0;
 }
 
-RequestContext &Request::get_rc() { return requestContext_; }
+void Request::reset(const RequestContext &requestContext) {
+  requestContext_ = requestContext;
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void Request::reset(char *data, uint64_t size, Connection *con) {
+  reset();
+  data_ = data;
+  size_ = size;
+  requestContext_.con = con;
+}
 
 void Request::encode() {
   OpType rt = requestContext_.type;
-  assert(rt == ALLOC || rt == FREE || rt == WRITE || rt == READ);
+  assert(rt < REPLY);
   requestMsg_.type = requestContext_.type;
   requestMsg_.rid = requestContext_.rid;
   requestMsg_.address = requestContext_.address;
@@ -40,14 +60,24 @@ void Request::encode() {
   requestMsg_.size = requestContext_.size;
   requestMsg_.key = requestContext_.key;
 
-  size_ = sizeof(requestMsg_);
-  data_ = static_cast<char *>(std::malloc(size_));
-  memcpy(data_, &requestMsg_, size_);
+  auto msg_size = sizeof(requestMsg_);
+  auto bml_size = sizeof(block_meta) * requestContext_.bml.size();
+  auto keys_size = sizeof(uint64_t) * requestContext_.keys.size();
+  size_ = msg_size + bml_size + keys_size;
+  buffer_.resize(size_);
+  data_ = buffer_.data();
+  memcpy(data_, &requestMsg_, msg_size);
+  if (bml_size != 0) {
+    memcpy(data_ + msg_size, &requestContext_.bml[0], bml_size);
+  }
+  if (keys_size != 0) {
+    memcpy(data_ + msg_size + bml_size, &requestContext_.keys[0], keys_size);
+  }
 }
 
 void Request::decode() {
-  assert(size_ == sizeof(requestMsg_));
-  memcpy(&requestMsg_, data_, size_);
+  assert(size_ >= sizeof(requestMsg_));
+  memcpy(&requestMsg_, data_, sizeof(requestMsg_));
   requestContext_.type = (OpType)requestMsg_.type;
   requestContext_.rid = requestMsg_.rid;
   requestContext_.address = requestMsg_.address;
@@ -55,26 +85,67 @@ void Request::decode() {
   requestContext_.src_rkey = requestMsg_.src_rkey;
   requestContext_.size = requestMsg_.size;
   requestContext_.key = requestMsg_.key;
+
+  /// copy block metadata list and keys of a batch request
+  auto extra_size = size_ - sizeof(requestMsg_);
+  if (extra_size == 0) {
+    return;
+  }
+  auto entry_size = sizeof(block_meta);
+  bool keyed = requestContext_.type == PUT_BATCH ||
+               requestContext_.type == MERGE_BATCH;
+  if (keyed) {
+    entry_size += sizeof(uint64_t);
+  }
+  auto num = extra_size / entry_size;
+  auto data = data_ + sizeof(requestMsg_);
+  requestContext_.bml.resize(num);
+  memcpy(&requestContext_.bml[0], data, num * sizeof(block_meta));
+  if (keyed) {
+    requestContext_.keys.resize(num);
+    memcpy(&requestContext_.keys[0], data + num * sizeof(block_meta),
+           num * sizeof(uint64_t));
+  }
 }
 
+RequestReply::RequestReply()
+    : data_(nullptr), size_(0), requestReplyContext_() {}
+
 RequestReply::RequestReply(RequestReplyContext requestReplyContext)
     : data_(nullptr), size_(0), requestReplyContext_(requestReplyContext) {}
 
 RequestReply::RequestReply(char *data, uint64_t size, Connection *con)
-    : size_(size) {
-  data_ = static_cast<char *>(std::malloc(size_));
-  memcpy(data_, data, size_);
-  requestReplyContext_.con = con;
+    : requestReplyContext_() {
+  reset(data, size, con);
 }
 
-RequestReply::~RequestReply() {
-  if (data_ != nullptr) {
-    std::free(data_);
-    data_ = nullptr;
-  }
+RequestReplyContext &RequestReply::get_rrc() { return requestReplyContext_; }
+
+void RequestReply::reset() {
+  // the lists keep their capacity
+  auto bml = std::move(requestReplyContext_.bml);
+  auto keys = std::move(requestReplyContext_.keys);
+  requestReplyContext_ = {};
+  bml.clear();
+  keys.clear();
+  requestReplyContext_.bml = std::move(bml);
+  requestReplyContext_.keys = std::move(keys);
+  data_ = nullptr;
+  size_ = 0;
 }
 
-RequestReplyContext &RequestReply::get_rrc() { return requestReplyContext_; }
+void RequestReply::reset(const RequestReplyContext &requestReplyContext) {
+  requestReplyContext_ = requestReplyContext;
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void RequestReply::reset(char *data, uint64_t size, Connection *con) {
+  reset();
+  data_ = data;
+  size_ = size;
+  requestReplyContext_.con = con;
+}
 
 void RequestReply::encode() {
   requestReplyMsg_.type = (OpType)requestReplyContext_.type;
@@ -92,7 +163,8 @@ void RequestReply::encode() {
     bml_size = sizeof(block_meta) * requestReplyContext_.bml.size();
     size_ += bml_size;
   }
-  data_ = static_cast<char *>(std::malloc(size_));
+  buffer_.resize(size_);
+  data_ = buffer_.data();
   memcpy(data_, &requestReplyMsg_, msg_size);
   if (bml_size != 0) {
     memcpy(data_ + msg_size, &requestReplyContext_.bml[0], bml_size);
@@ -100,7 +172,7 @@ void RequestReply::encode() {
 }
 
 void RequestReply::decode() {
-  memcpy(&requestReplyMsg_, data_, size_);
+  memcpy(&requestReplyMsg_, data_, sizeof(requestReplyMsg_));
   requestReplyContext_.type = (OpType)requestReplyMsg_.type;
   requestReplyContext_.success = requestReplyMsg_.success;
   requestReplyContext_.rid = requestReplyMsg_.rid;
@@ -37,6 +37,16 @@ enum OpType : uint32_t {
   GET,
   GET_META,
   DELETE,
+  ALLOC_BATCH,
+  FREE_BATCH,
+  WRITE_BATCH,
+  PUT_BATCH,
+  APPEND_BATCH,
+  RELEASE_SHUFFLE,
+  GET_RMA_INFO,
+  DEL_PREFIX,
+  MERGE_BATCH,
+  GET_STATS,
   REPLY = 1 << 16,
   ALLOC_REPLY,
   FREE_REPLY,
@@ -46,15 +56,58 @@ enum OpType : uint32_t {
   PUT_REPLY,
   GET_REPLY,
   GET_META_REPLY,
-  DELETE_REPLY
+  DELETE_REPLY,
+  ALLOC_BATCH_REPLY,
+  FREE_BATCH_REPLY,
+  WRITE_BATCH_REPLY,
+  PUT_BATCH_REPLY,
+  APPEND_BATCH_REPLY,
+  RELEASE_SHUFFLE_REPLY,
+  GET_RMA_INFO_REPLY,
+  DEL_PREFIX_REPLY,
+  MERGE_BATCH_REPLY,
+  GET_STATS_REPLY
 };
 
+/// success of the reply of a request refused by an overloaded server, for the
+/// client to send it again later
+const uint32_t REPLY_BUSY = 0xFFFFFFFE;
+
 /**
  * @brief Define two types of event in this file: Request, RequestReply
  * Request: a event that client creates and sends to server.
  * RequestReply: a event that server creates and sends to client.
  * RequestContext and RequestReplyContext include the context information of the
  * previous two events.
+ *
+ * A batch request carries many blocks in bml and gets one reply: ALLOC_BATCH
+ * allocates blocks of the sizes of bml, FREE_BATCH frees those at its
+ * addresses. WRITE_BATCH allocates and writes blocks of the sizes of bml from
+ * the data at src_address, the blocks one after the other. PUT_BATCH does the
+ * same and caches each block under its key, and with a key also records its
+ * keys under that prefix hash. The reply lists the blocks in the same order
+ * with their addresses. DEL_PREFIX deletes all the keys put under the prefix
+ * hash at key and frees their blocks in background, after its reply.
+ *
+ * APPEND_BATCH writes blocks like WRITE_BATCH, but bump allocates them from
+ * the extents of the shuffle at key instead. RELEASE_SHUFFLE frees all the
+ * extents of the shuffle at key at once.
+ *
+ * MERGE_BATCH puts blocks like PUT_BATCH, but appends each block to the
+ * extents of its own key, on the pool of the key, so that the blocks put
+ * under a key by many clients, e.g. of one reduce partition by all the map
+ * tasks, end up next to each other. Deleting the key frees its extents.
+ *
+ * GET_RMA_INFO replies, in bml, the registered region of each pool in pool
+ * order: the virtual address of the region in address and its rkey in size,
+ * for clients to read blocks with one-sided RDMA reads.
+ *
+ * GET_STATS replies the load of the server, a StatsSnapshot encoded in bml.
+ *
+ * A received message is decoded in place, from the buffer it came in, which
+ * only has to stay valid until decode returns. An event keeps its encode
+ * buffer and the capacity of its lists once reset, so that events taken again
+ * from an ObjectPool decode and encode without allocating.
  */
 struct RequestReplyContext {
   OpType type;
@@ -69,6 +122,10 @@ struct RequestReplyContext {
   Connection* con;
   Chunk* ck;
   vector <block_meta> bml;
+  /// keys of the blocks of a PUT_BATCH or MERGE_BATCH, not sent back
+  vector<uint64_t> keys;
+  /// when the request was received, in steady clock us, not sent back
+  uint64_t received_us;
 };
 
 template <class T>
@@ -87,18 +144,26 @@ inline void decode_(T* t, char* data, uint64_t size) {
 
 class RequestReply {
  public:
-  RequestReply() = delete;
+  /// Empty reply, e.g. of an ObjectPool
+  RequestReply();
   explicit RequestReply(RequestReplyContext requestReplyContext);
+  /// Reply received in data, decoded without copying it
   RequestReply(char* data, uint64_t size, Connection* con);
-  ~RequestReply();
+  ~RequestReply() = default;
   RequestReplyContext& get_rrc();
+  /// Clear the context, for the reply to be filled in again
+  void reset();
+  void reset(const RequestReplyContext& requestReplyContext);
+  void reset(char* data, uint64_t size, Connection* con);
   void decode();
   void encode();
 
  private:
   friend Protocol;
+  /// the message received, or encoded into buffer_
   char* data_;
   uint64_t size_;
+  vector<char> buffer_;
   RequestReplyMsg requestReplyMsg_;
   RequestReplyContext requestReplyContext_;
 };
@@ -115,23 +180,37 @@ struct RequestContext {
   uint64_t size;
   uint64_t key;
   Connection* con;
+  /// blocks of a batch request
+  vector<block_meta> bml;
+  /// keys of the blocks of a PUT_BATCH
+  vector<uint64_t> keys;
+  /// when the request was received by the server, in steady clock us
+  uint64_t received_us;
 };
 
 class Request {
  public:
-  Request() = delete;
+  /// Empty request, e.g. of an ObjectPool
+  Request();
   explicit Request(RequestContext requestContext);
+  /// Request received in data, decoded without copying it
   Request(char* data, uint64_t size, Connection* con);
-  ~Request();
+  ~Request() = default;
   RequestContext& get_rc();
+  /// Clear the context, for the request to be filled in again
+  void reset();
+  void reset(const RequestContext& requestContext);
+  void reset(char* data, uint64_t size, Connection* con);
   void encode();
   void decode();
 
  private:
   friend RequestHandler;
   friend ClientRecvCallback;
+  /// the message received, or encoded into buffer_
   char* data_;
   uint64_t size_;
+  vector<char> buffer_;
   RequestMsg requestMsg_;
   RequestContext requestContext_;
 };
@@ -0,0 +1,180 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/FairQueue.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_FAIRQUEUE_H_
+#define PMPOOL_FAIRQUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @brief A client of the server, e.g. one connection, with its requests in
+ * flight and its bandwidth budget, shared by the queues of all the workers.
+ */
+class Tenant {
+ public:
+  /// Requests received and not replied yet
+  std::atomic<uint64_t> in_flight = {0};
+
+  /// Take cost bytes out of the bucket refilled at rate bytes per second, up
+  /// to a second of it. Return 0 if taken, else the ns until the bucket is
+  /// out of debt. A request larger than the bucket goes once it isn't in debt,
+  /// the debt holding back the next ones.
+  uint64_t take(uint64_t cost, uint64_t rate, uint64_t now_ns) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (last_ns_ == 0) {
+      tokens_ = rate;
+    } else if (now_ns > last_ns_) {
+      tokens_ = std::min<double>(
+          tokens_ + (now_ns - last_ns_) * 1e-9 * rate, rate);
+    }
+    last_ns_ = std::max(last_ns_, now_ns);
+    if (tokens_ < 0) {
+      return static_cast<uint64_t>(-tokens_ * 1e9 / rate) + 1;
+    }
+    tokens_ -= cost;
+    return 0;
+  }
+
+ private:
+  std::mutex mtx_;
+  double tokens_ = 0;
+  uint64_t last_ns_ = 0;
+};
+
+/**
+ * @brief Queue of a worker serving the requests of its tenants in turn by
+ * bytes rather than in arrival order (deficit round robin): a tenant whose
+ * next request is larger than its deficit gets quantum more bytes and waits
+ * for its next turn, so that one with large writes doesn't hold back those
+ * with small reads. With a bandwidth, a tenant over budget is skipped until
+ * its bucket refills. Safe for any number of producers and consumers.
+ */
+template <class T>
+class FairQueue {
+ public:
+  /// bandwidth in bytes per second of each tenant, 0 for no limit
+  FairQueue(uint64_t quantum, uint64_t bandwidth)
+      : quantum_(std::max<uint64_t>(quantum, 1)), bandwidth_(bandwidth) {}
+
+  void enqueue(Tenant *tenant, T item, uint64_t cost) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    auto &flow = flows_[tenant];
+    if (flow.items.empty()) {
+      flow.deficit = 0;
+      active_.push_back(tenant);
+    }
+    flow.items.emplace_back(std::move(item), cost);
+    lk.unlock();
+    cv_.notify_one();
+  }
+
+  bool try_dequeue(T &item) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    uint64_t wait_ns;
+    return dequeue(item, &wait_ns);
+  }
+
+  bool wait_dequeue_timed(T &item, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+      uint64_t wait_ns = 0;
+      if (dequeue(item, &wait_ns)) {
+        return true;
+      }
+      auto now = std::chrono::steady_clock::now();
+      if (now >= deadline) {
+        return false;
+      }
+      // the tenants over budget are served again once their buckets refill
+      auto until = deadline;
+      if (wait_ns != 0) {
+        until = std::min(until, now + std::chrono::nanoseconds(wait_ns));
+      }
+      cv_.wait_until(lk, until);
+    }
+  }
+
+  /// Items queued
+  size_t size() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    size_t size = 0;
+    for (auto tenant : active_) {
+      size += flows_[tenant].items.size();
+    }
+    return size;
+  }
+
+ private:
+  struct Flow {
+    std::deque<std::pair<T, uint64_t>> items;
+    uint64_t deficit = 0;
+  };
+
+  static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /// Dequeue the next item with mtx_ held, else set wait_ns to the ns until
+  /// a tenant over budget may go, 0 if none
+  bool dequeue(T &item, uint64_t *wait_ns) {
+    *wait_ns = 0;
+    size_t throttled = 0;
+    while (!active_.empty() && throttled < active_.size()) {
+      auto tenant = active_.front();
+      auto &flow = flows_[tenant];
+      auto &head = flow.items.front();
+      if (flow.deficit < head.second) {
+        // a tenant earning deficit goes later, count those over budget anew
+        throttled = 0;
+        flow.deficit += quantum_;
+        active_.push_back(tenant);
+        active_.pop_front();
+        continue;
+      }
+      if (bandwidth_ != 0) {
+        auto wait = tenant->take(head.second, bandwidth_, now_ns());
+        if (wait != 0) {
+          *wait_ns = *wait_ns == 0 ? wait : std::min(*wait_ns, wait);
+          throttled++;
+          active_.push_back(tenant);
+          active_.pop_front();
+          continue;
+        }
+      }
+      item = std::move(head.first);
+      flow.deficit -= head.second;
+      flow.items.pop_front();
+      if (flow.items.empty()) {
+        active_.pop_front();
+      }
+      return true;
+    }
+    return false;
+  }
+
+  const uint64_t quantum_;
+  const uint64_t bandwidth_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  /// queued requests of each tenant, kept once empty
+  std::unordered_map<Tenant *, Flow> flows_;
+  /// tenants with queued requests, in turn
+  std::deque<Tenant *> active_;
+};
+
+#endif  // PMPOOL_FAIRQUEUE_H_
@@ -10,13 +10,21 @@
 #ifndef PMPOOL_LOG_H_
 #define PMPOOL_LOG_H_
 
+#include <algorithm>
 #include <memory>
+#include <string>
 
+#include "AsyncLog.h"
 #include "Config.h"
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/basic_file_sink.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 
+/**
+ * @brief The file and console logs of the server. With log_async, the messages
+ * of log are formatted and written by a background AsyncLog rather than by
+ * the threads logging, e.g. the workers handling the requests.
+ */
 class Log {
  public:
   explicit Log(Config *config) : config_(config) {
@@ -37,6 +45,44 @@ class Log {
     }
     console_log_ = spdlog::stdout_color_mt("console");
     console_log_->flush_on(spdlog::level::info);
+    if (config_->get_log_async()) {
+      auto file_log = file_log_;
+      asyncLog_ = std::make_shared<AsyncLog>(
+          [file_log](int level, const std::string &message) {
+            file_log->log(static_cast<spdlog::level::level_enum>(level),
+                          message);
+          },
+          std::max(config_->get_log_rate(), 0));
+      asyncLog_->start();
+    }
+  }
+
+  ~Log() {
+    if (asyncLog_) {
+      asyncLog_->stop();
+      asyncLog_->join();
+      asyncLog_->flush();
+    }
+  }
+
+  /// Log fmt at level to the file log, its {} replaced by the integer args in
+  /// order. Async, fmt must be a string literal, formatted once flushed.
+  template <typename... Args>
+  void log(spdlog::level::level_enum level, const char *fmt, Args... args) {
+    static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS,
+                  "too many log arguments");
+    if (!file_log_->should_log(level)) {
+      return;
+    }
+    LogRecord record = {fmt,
+                        {static_cast<uint64_t>(args)...},
+                        static_cast<uint8_t>(sizeof...(Args)),
+                        level};
+    if (asyncLog_) {
+      asyncLog_->log(record);
+    } else {
+      file_log_->log(level, AsyncLog::format(record));
+    }
   }
 
   std::shared_ptr<spdlog::logger> get_file_log() { return file_log_; }
@@ -46,6 +92,7 @@ class Log {
   Config *config_;
   std::shared_ptr<spdlog::logger> file_log_;
   std::shared_ptr<spdlog::logger> console_log_;
+  std::shared_ptr<AsyncLog> asyncLog_;
 };
 
 #endif  //  PMPOOL_LOG_H_
@@ -13,7 +13,7 @@
 #include "Config.h"
 #include "Event.h"
 #include "Log.h"
-#include "buffer/CircularBuffer.h"
+#include "buffer/LockFreeCircularBuffer.h"
 
 NetworkServer::NetworkServer(Config *config, Log *log)
     : config_(config), log_(log) {
@@ -44,8 +44,11 @@ int NetworkServer::start() {
   CHK_ERR("hpnl server listen", server_->listen(config_->get_ip().c_str(),
                                                 config_->get_port().c_str()));
 
-  circularBuffer_ =
-      std::make_shared<CircularBuffer>(1024 * 1024, 4096, true, this);
+  int numa_node = config_->get_buffer_numa_node() >= 0
+                      ? config_->get_buffer_numa_node()
+                      : config_->get_nic_numa_node();
+  circularBuffer_ = std::make_shared<LockFreeCircularBuffer>(
+      1024 * 1024, 4096, config_->get_buffer_prefault(), this, numa_node);
   return 0;
 }
 
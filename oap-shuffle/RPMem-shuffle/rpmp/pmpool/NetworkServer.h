@@ -19,7 +19,7 @@
 
 #include "RmaBufferRegister.h"
 
-class CircularBuffer;
+class LockFreeCircularBuffer;
 class Config;
 class RequestReply;
 class RequestReplyContext;
@@ -77,7 +77,7 @@ class NetworkServer : public RmaBufferRegister {
   Log* log_;
   std::shared_ptr<Server> server_;
   std::shared_ptr<ChunkMgr> chunkMgr_;
-  std::shared_ptr<CircularBuffer> circularBuffer_;
+  std::shared_ptr<LockFreeCircularBuffer> circularBuffer_;
   std::atomic<uint64_t> buffer_id_{0};
   uint64_t time;
 };
@@ -0,0 +1,117 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/Numa.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool
+ * Created Date: Wednesday, October 14th 2020, 4:31:08 pm
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_NUMA_H_
+#define PMPOOL_NUMA_H_
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief NUMA topology of the devices of RPMP as the kernel reports it in
+ * sysfs. Every lookup returns -1, or nothing, if the node is unknown, e.g. on
+ * single socket machines.
+ */
+
+/// NUMA node in the numa_node file of the sysfs device at dir
+inline int numa_node_of_sysfs(const std::string &dir) {
+  std::ifstream in(dir + "/numa_node");
+  int node = -1;
+  if (!(in >> node)) {
+    return -1;
+  }
+  return node;
+}
+
+/// NUMA node of a pool path: a devdax character device, a pmem block device,
+/// or a file on a filesystem mounted from one
+inline int numa_node_of_path(const std::string &path) {
+  struct stat st;
+  if (stat(path.c_str(), &st)) {
+    return -1;
+  }
+  std::string dev;
+  if (S_ISCHR(st.st_mode)) {
+    dev = "/sys/dev/char/" + std::to_string(major(st.st_rdev)) + ":" +
+          std::to_string(minor(st.st_rdev));
+  } else {
+    dev_t rdev = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+    dev = "/sys/dev/block/" + std::to_string(major(rdev)) + ":" +
+          std::to_string(minor(rdev));
+  }
+  int node = numa_node_of_sysfs(dev + "/device");
+  if (node < 0) {
+    // a partition, of the device above it
+    node = numa_node_of_sysfs(dev + "/../device");
+  }
+  return node;
+}
+
+/// NUMA node of the NIC with the IPv4 address
+inline int numa_node_of_address(const std::string &address) {
+  struct in_addr addr;
+  if (inet_pton(AF_INET, address.c_str(), &addr) != 1) {
+    return -1;
+  }
+  struct ifaddrs *ifas = nullptr;
+  if (getifaddrs(&ifas)) {
+    return -1;
+  }
+  int node = -1;
+  for (struct ifaddrs *ifa = ifas; ifa != nullptr; ifa = ifa->ifa_next) {
+    if (ifa->ifa_addr == nullptr || ifa->ifa_addr->sa_family != AF_INET) {
+      continue;
+    }
+    auto sin = reinterpret_cast<struct sockaddr_in *>(ifa->ifa_addr);
+    if (sin->sin_addr.s_addr == addr.s_addr) {
+      node = numa_node_of_sysfs(std::string("/sys/class/net/") +
+                                ifa->ifa_name + "/device");
+      break;
+    }
+  }
+  freeifaddrs(ifas);
+  return node;
+}
+
+/// CPUs of NUMA node, from its cpulist, e.g. "0-19,40-59"
+inline std::vector<int> numa_node_cpus(int node) {
+  std::vector<int> cpus;
+  if (node < 0) {
+    return cpus;
+  }
+  std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) +
+                   "/cpulist");
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    int first = 0;
+    int last = 0;
+    char dash;
+    std::istringstream ss(range);
+    if (!(ss >> first)) {
+      continue;
+    }
+    if (!(ss >> dash >> last)) {
+      last = first;
+    }
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+#endif  // PMPOOL_NUMA_H_
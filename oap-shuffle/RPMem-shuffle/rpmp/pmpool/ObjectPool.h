@@ -0,0 +1,54 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/ObjectPool.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_OBJECTPOOL_H_
+#define PMPOOL_OBJECTPOOL_H_
+
+#include <cstdint>
+
+#include "queue/concurrentqueue.h"
+
+/**
+ * @brief Preallocated objects taken and put back by any thread without locks,
+ * so that the messages of the requests aren't allocated per request. An
+ * object keeps the memory it grew to, e.g. its buffers, for its next use.
+ * Objects are allocated only while more than capacity are taken at once, the
+ * pool then keeps them too.
+ */
+template <class T>
+class ObjectPool {
+ public:
+  explicit ObjectPool(uint64_t capacity) {
+    for (uint64_t i = 0; i < capacity; i++) {
+      free_.enqueue(new T());
+    }
+  }
+  ~ObjectPool() {
+    T *t;
+    while (free_.try_dequeue(t)) {
+      delete t;
+    }
+  }
+  ObjectPool(const ObjectPool &) = delete;
+  ObjectPool &operator=(const ObjectPool &) = delete;
+
+  /// Object to reset before use
+  T *get() {
+    T *t;
+    if (free_.try_dequeue(t)) {
+      return t;
+    }
+    return new T();
+  }
+
+  void put(T *t) { free_.enqueue(t); }
+
+ private:
+  moodycamel::ConcurrentQueue<T *> free_;
+};
+
+#endif  // PMPOOL_OBJECTPOOL_H_
@@ -12,10 +12,13 @@
 
 #include <libpmemobj.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>  // NOLINT
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -27,9 +30,24 @@
 
 using std::shared_ptr;
 using std::unordered_map;
+using std::vector;
 
 #define PMEMOBJ_ALLOCATOR_LAYOUT_NAME "pmemobj_allocator_layout"
 
+/// Lists of the blocks of a pool, each with its own lock, so that threads
+/// appending to different lists don't wait for each other
+#define PMEM_BLOCK_LIST_NUM 64
+/// Shards of the in-memory index of the blocks of a pool, each with its mutex
+#define PMEM_INDEX_SHARD_NUM 64
+/// Bytes of the extents the appended blocks of a shuffle are bump allocated
+/// from, larger blocks get an extent of their own
+#define PMEM_EXTENT_SIZE (64 << 20)
+/// Alignment of appended blocks, so that blocks don't share cache lines
+#define PMEM_EXTENT_ALIGN 64
+/// Buckets of the persistent key index of a pool, and locks shared by them
+#define PMEM_KV_BUCKET_NUM 65536
+#define PMEM_KV_LOCK_NUM 64
+
 // block header stored in pmem
 struct block_hdr {
   PMEMoid next;
@@ -44,33 +62,115 @@ struct block_entry {
   PMEMoid data;
 };
 
-// pmem root entry
-struct Base {
+// extent header stored in pmem, followed by the data of the appended blocks
+struct extent_hdr {
+  PMEMoid next;
+  PMEMoid pre;
+  uint64_t shuffle;
+  uint64_t size;
+};
+
+// key-value record stored in pmem, chained in the bucket of its key
+struct kv_record {
+  PMEMoid next;
+  uint64_t key;
+  uint64_t seq;
+  uint64_t address;
+  uint64_t size;
+};
+
+// pmem hash index of the keys of the blocks of a pool
+struct KvIndex {
+  PMEMrwlock locks[PMEM_KV_LOCK_NUM];
+  PMEMoid buckets[PMEM_KV_BUCKET_NUM];
+};
+
+// pmem list of blocks
+struct BlockList {
   PMEMoid head;
   PMEMoid tail;
   PMEMrwlock rwlock;
   uint64_t bytes_written;
 };
 
+// pmem root entry. The root of pools made before the blocks were split into
+// lists is laid out as lists[0], the other lists are zeroed as it grows.
+struct Base {
+  struct BlockList lists[PMEM_BLOCK_LIST_NUM];
+  // extents of all shuffles
+  PMEMoid extents;
+  PMEMrwlock extent_rwlock;
+  // KvIndex of the pool
+  PMEMoid kv_index;
+};
+
 struct PmemContext {
   PMEMobjpool *pop;
   PMEMoid poid;
   Base *base;
 };
 
+/// Persistence of the data of the blocks of a pool, their metadata is always
+/// persisted by transactions
+enum PersistMode {
+  /// persisted before the reply, flushed by the transaction of the block
+  PERSIST_TX,
+  /// written with non-temporal stores, drained once per batch of blocks
+  PERSIST_BATCHED,
+  /// written with non-temporal stores, never drained, for recomputable data
+  PERSIST_NONE
+};
+
+inline PersistMode persist_mode_of(const string &name) {
+  if (name == "batched") {
+    return PERSIST_BATCHED;
+  }
+  if (name == "none") {
+    return PERSIST_NONE;
+  }
+  return PERSIST_TX;
+}
+
 // pmem data allocation types
-enum types { BLOCK_ENTRY_TYPE, DATA_TYPE, MAX_TYPE };
+enum types {
+  BLOCK_ENTRY_TYPE,
+  DATA_TYPE,
+  EXTENT_TYPE,
+  KV_INDEX_TYPE,
+  KV_RECORD_TYPE,
+  MAX_TYPE
+};
 
 /**
  * @brief libpmemobj based implementation of Allocator interface.
  *
+ * Each thread allocates from its own libpmemobj arena and appends its blocks
+ * to its own block list, both assigned round robin on its first allocation,
+ * so that the workers of a pool allocate concurrently. The data of the blocks
+ * is written before the list is locked. A batch of blocks is allocated in one
+ * transaction. The blocks are indexed by address in shards.
+ *
+ * Write-once blocks of a shuffle can be appended instead: they are bump
+ * allocated from large extents reserved for the shuffle, with no entry, index
+ * or transaction of their own, and freed with their extents at once.
+ *
+ * The keys of the key-value interface are kept with their blocks in a
+ * persistent hash index, so that they are served again after a restart.
+ *
+ * With PERSIST_BATCHED or PERSIST_NONE the data of the blocks bypasses the
+ * cache and is not flushed by the transactions, see PersistMode.
  */
 class PmemObjAllocator : public Allocator {
  public:
   PmemObjAllocator() = delete;
   explicit PmemObjAllocator(Log *log, DiskInfo *diskInfos,
-                            NetworkServer *server, int wid)
-      : log_(log), diskInfo_(diskInfos), server_(server), wid_(wid) {}
+                            NetworkServer *server, int wid,
+                            PersistMode persist_mode = PERSIST_TX)
+      : log_(log),
+        diskInfo_(diskInfos),
+        server_(server),
+        wid_(wid),
+        persist_mode_(persist_mode) {}
   ~PmemObjAllocator() { close(); }
 
   int init() override {
@@ -88,6 +188,24 @@ class PmemObjAllocator : public Allocator {
 
   uint64_t allocate_and_write(uint64_t size,
                               const char *content = nullptr) override {
+    vector<uint64_t> addresses;
+    if (allocate_and_write_batch({size}, {content}, &addresses)) {
+      return -1;
+    }
+    return addresses[0];
+  }
+
+  int allocate_and_write_batch(const vector<uint64_t> &sizes,
+                               const vector<const char *> &contents,
+                               vector<uint64_t> *addresses) override {
+    if (sizes.empty()) {
+      return 0;
+    }
+    auto list_index = thread_list();
+    struct BlockList *list = &pmemContext_.base->lists[list_index];
+    vector<PMEMoid> beos(sizes.size(), OID_NULL);
+    uint64_t bytes = 0;
+
     jmp_buf env;
     if (setjmp(env)) {
       // end the transaction
@@ -95,147 +213,309 @@ class PmemObjAllocator : public Allocator {
       return -1;
     }
 
-    // begin a transaction, also acquiring the write lock for the data
-    if (pmemobj_tx_begin(pmemContext_.pop, env, TX_PARAM_RWLOCK,
-                         &pmemContext_.base->rwlock, TX_PARAM_NONE)) {
+    if (pmemobj_tx_begin(pmemContext_.pop, env, TX_PARAM_NONE)) {
       perror("pmemobj_tx_begin failed in pmemkv put");
       return -1;
     }
 
-    // allocate the new node to be inserted
-    PMEMoid beo =
-        pmemobj_tx_alloc(sizeof(struct block_entry), BLOCK_ENTRY_TYPE);
-    if (beo.off == 0 && beo.pool_uuid_lo == 0) {
+    // allocate and write the new nodes, chained in order, before taking the
+    // lock of the list
+    for (size_t i = 0; i < sizes.size(); i++) {
+      PMEMoid beo =
+          pmemobj_tx_alloc(sizeof(struct block_entry), BLOCK_ENTRY_TYPE);
+      struct block_entry *bep = (struct block_entry *)pmemobj_direct(beo);
+      // blocks written at once need no zeroing
+      bep->data = contents[i] != nullptr
+                      ? pmemobj_tx_xalloc(sizes[i], DATA_TYPE, data_flags())
+                      : pmemobj_tx_zalloc(sizes[i], DATA_TYPE);
+      bep->hdr.addr = TO_GLOB((uint64_t)pmemobj_direct(bep->data),
+                              (uint64_t)pmemContext_.pop, wid_);
+      bep->hdr.size = sizes[i];
+      bep->hdr.next = OID_NULL;
+      bep->hdr.pre = i == 0 ? OID_NULL : beos[i - 1];
+      if (i > 0) {
+        ((struct block_entry *)pmemobj_direct(beos[i - 1]))->hdr.next = beo;
+      }
+      if (contents[i] != nullptr) {
+        copy_data(pmemobj_direct(bep->data), contents[i], sizes[i]);
+      }
+      beos[i] = beo;
+      bytes += sizes[i];
+    }
+    // the data before the metadata pointing to it
+    drain_data();
+
+    // append them to the list, holding its write lock until the end of the
+    // transaction
+    pmemobj_tx_lock(TX_PARAM_RWLOCK, &list->rwlock);
+    pmemobj_tx_add_range_direct(&list->head, 2 * sizeof(PMEMoid));
+    pmemobj_tx_add_range_direct(&list->bytes_written, sizeof(uint64_t));
+    if (OID_IS_NULL(list->tail)) {
+      list->head = beos.front();
+    } else {
+      pmemobj_tx_add_range(list->tail, 0, sizeof(struct block_hdr));
+      ((struct block_entry *)pmemobj_direct(list->tail))->hdr.next =
+          beos.front();
+      ((struct block_entry *)pmemobj_direct(beos.front()))->hdr.pre =
+          list->tail;
+    }
+    list->tail = beos.back();
+    list->bytes_written += bytes;
+    pmemobj_tx_commit();
+    (void)pmemobj_tx_end();
+
+    // update in-memory index
+    for (auto &beo : beos) {
+      if (update_meta(beo, list_index)) {
+        return -1;
+      }
+      addresses->push_back(
+          ((struct block_entry *)pmemobj_direct(beo))->hdr.addr);
+    }
+    return 0;
+  }
+
+  int append_batch(uint64_t shuffle, const vector<uint64_t> &sizes,
+                   const vector<const char *> &contents,
+                   vector<uint64_t> *addresses) override {
+    vector<char *> dests;
+    {
+      std::lock_guard<std::mutex> l(extent_mtx);
+      auto &extents = shuffle_extents[shuffle];
+      for (auto size : sizes) {
+        uint64_t aligned_size =
+            (size + PMEM_EXTENT_ALIGN - 1) / PMEM_EXTENT_ALIGN *
+            PMEM_EXTENT_ALIGN;
+        if (extents.cur == nullptr ||
+            (uint64_t)(extents.end - extents.cur) < aligned_size) {
+          if (reserve_extent(shuffle, aligned_size, &extents)) {
+            return -1;
+          }
+        }
+        dests.push_back(extents.cur);
+        extents.cur += aligned_size;
+      }
+    }
+    // the reserved blocks are written concurrently
+    for (size_t i = 0; i < sizes.size(); i++) {
+      if (contents[i] != nullptr) {
+        if (persist_mode_ == PERSIST_TX) {
+          pmemobj_memcpy_persist(pmemContext_.pop, dests[i], contents[i],
+                                 sizes[i]);
+        } else {
+          copy_data(dests[i], contents[i], sizes[i]);
+        }
+      }
+      addresses->push_back(
+          TO_GLOB((uint64_t)dests[i], (uint64_t)pmemContext_.pop, wid_));
+    }
+    drain_data();
+    return 0;
+  }
+
+  bool has_extents(uint64_t shuffle) override {
+    std::lock_guard<std::mutex> l(extent_mtx);
+    return shuffle_extents.count(shuffle) != 0;
+  }
+
+  int release_shuffle(uint64_t shuffle) override {
+    std::lock_guard<std::mutex> l(extent_mtx);
+    auto it = shuffle_extents.find(shuffle);
+    if (it == shuffle_extents.end()) {
+      // nothing appended to this pool
+      return 0;
+    }
+
+    jmp_buf env;
+    if (setjmp(env)) {
+      // end the transaction
       (void)pmemobj_tx_end();
-      perror("pmemobj_tx_alloc failed in pmemkv put");
       return -1;
     }
-    struct block_entry *bep = (struct block_entry *)pmemobj_direct(beo);
-    bep->data = pmemobj_tx_zalloc(size, DATA_TYPE);
-    bep->hdr.next = OID_NULL;
-    bep->hdr.addr = TO_GLOB((uint64_t)pmemobj_direct(bep->data),
-                            (uint64_t)pmemContext_.pop, wid_);
-    bep->hdr.size = size;
-
-    uint64_t start =
-        std::chrono::high_resolution_clock::now().time_since_epoch() /
-        std::chrono::milliseconds(1);
-    char *pmem_data = static_cast<char *>(pmemobj_direct(bep->data));
-    if (content != nullptr) {
-      memcpy(pmem_data, content, size);
-    }
-    uint64_t end =
-        std::chrono::high_resolution_clock::now().time_since_epoch() /
-        std::chrono::milliseconds(1);
-    total += (end - start);
-    // std::cout << "index " << wid_ << ", total is " << total / 1000.0
-    //           << std::endl;
-
-    // add the modified root object to the undo data
-    pmemobj_tx_add_range(pmemContext_.poid, 0, sizeof(struct Base));
-    if (pmemContext_.base->tail.off == 0) {
-      // update head
-      pmemContext_.base->head = beo;
-      bep->hdr.pre = OID_NULL;
-    } else {
-      // add the modified tail entry to the undo data
-      bep->hdr.pre = pmemContext_.base->tail;
-      pmemobj_tx_add_range(pmemContext_.base->tail, 0,
-                           sizeof(struct block_entry));
-      ((struct block_entry *)pmemobj_direct(pmemContext_.base->tail))
-          ->hdr.next = beo;
+
+    // begin a transaction, also acquiring the write lock of the extents
+    if (pmemobj_tx_begin(pmemContext_.pop, env, TX_PARAM_RWLOCK,
+                         &pmemContext_.base->extent_rwlock, TX_PARAM_NONE)) {
+      perror("pmemobj_tx_begin failed in release_shuffle");
+      return -1;
     }
+    pmemobj_tx_add_range_direct(&pmemContext_.base->extents, sizeof(PMEMoid));
+    for (auto &oid : it->second.oids) {
+      struct extent_hdr *ehp = (struct extent_hdr *)pmemobj_direct(oid);
+      if (OID_IS_NULL(ehp->pre)) {
+        pmemContext_.base->extents = ehp->next;
+      } else {
+        pmemobj_tx_add_range(ehp->pre, 0, sizeof(struct extent_hdr));
+        ((struct extent_hdr *)pmemobj_direct(ehp->pre))->next = ehp->next;
+      }
+      if (!OID_IS_NULL(ehp->next)) {
+        pmemobj_tx_add_range(ehp->next, 0, sizeof(struct extent_hdr));
+        ((struct extent_hdr *)pmemobj_direct(ehp->next))->pre = ehp->pre;
+      }
+      pmemobj_tx_free(oid);
+    }
+    pmemobj_tx_commit();
+    (void)pmemobj_tx_end();
 
-    pmemContext_.base->tail = beo;  // update tail
-    pmemContext_.base->bytes_written += size;
+    for (auto &oid : it->second.oids) {
+      extent_ranges.erase(extent_begin(oid));
+    }
+    shuffle_extents.erase(it);
+    return 0;
+  }
+
+  int put_key(uint64_t key, const block_meta &bm, uint64_t seq) override {
+    struct KvIndex *kv = kv_index();
+    uint64_t bucket = key % PMEM_KV_BUCKET_NUM;
+
+    jmp_buf env;
+    if (setjmp(env)) {
+      // end the transaction
+      (void)pmemobj_tx_end();
+      return -1;
+    }
+
+    // begin a transaction, also acquiring the write lock of the bucket
+    if (pmemobj_tx_begin(pmemContext_.pop, env, TX_PARAM_RWLOCK,
+                         &kv->locks[bucket % PMEM_KV_LOCK_NUM],
+                         TX_PARAM_NONE)) {
+      perror("pmemobj_tx_begin failed in put_key");
+      return -1;
+    }
+    PMEMoid oid = pmemobj_tx_alloc(sizeof(struct kv_record), KV_RECORD_TYPE);
+    struct kv_record *rec = (struct kv_record *)pmemobj_direct(oid);
+    rec->next = kv->buckets[bucket];
+    rec->key = key;
+    rec->seq = seq;
+    rec->address = bm.address;
+    rec->size = bm.size;
+    pmemobj_tx_add_range_direct(&kv->buckets[bucket], sizeof(PMEMoid));
+    kv->buckets[bucket] = oid;
     pmemobj_tx_commit();
     (void)pmemobj_tx_end();
+    return 0;
+  }
 
-    // update in-memory index
-    if (update_meta(beo)) {
+  int get_key(uint64_t key,
+              vector<std::pair<uint64_t, block_meta>> *values) override {
+    struct KvIndex *kv = kv_index();
+    uint64_t bucket = key % PMEM_KV_BUCKET_NUM;
+    PMEMrwlock *lock = &kv->locks[bucket % PMEM_KV_LOCK_NUM];
+    if (pmemobj_rwlock_rdlock(pmemContext_.pop, lock) != 0) {
+      return -1;
+    }
+    struct kv_record *rec =
+        (struct kv_record *)pmemobj_direct(kv->buckets[bucket]);
+    while (rec != nullptr) {
+      if (rec->key == key) {
+        values->push_back({rec->seq, block_meta(rec->address, rec->size)});
+      }
+      rec = (struct kv_record *)pmemobj_direct(rec->next);
+    }
+    pmemobj_rwlock_unlock(pmemContext_.pop, lock);
+    return 0;
+  }
+
+  int del_key(uint64_t key) override {
+    struct KvIndex *kv = kv_index();
+    uint64_t bucket = key % PMEM_KV_BUCKET_NUM;
+
+    jmp_buf env;
+    if (setjmp(env)) {
+      // end the transaction
+      (void)pmemobj_tx_end();
       return -1;
     }
 
-    return bep->hdr.addr;
+    // begin a transaction, also acquiring the write lock of the bucket
+    if (pmemobj_tx_begin(pmemContext_.pop, env, TX_PARAM_RWLOCK,
+                         &kv->locks[bucket % PMEM_KV_LOCK_NUM],
+                         TX_PARAM_NONE)) {
+      perror("pmemobj_tx_begin failed in del_key");
+      return -1;
+    }
+    PMEMoid *link = &kv->buckets[bucket];
+    while (!OID_IS_NULL(*link)) {
+      PMEMoid oid = *link;
+      struct kv_record *rec = (struct kv_record *)pmemobj_direct(oid);
+      if (rec->key == key) {
+        pmemobj_tx_add_range_direct(link, sizeof(PMEMoid));
+        *link = rec->next;
+        pmemobj_tx_free(oid);
+      } else {
+        link = &rec->next;
+      }
+    }
+    pmemobj_tx_commit();
+    (void)pmemobj_tx_end();
+    return 0;
   }
 
   int write(uint64_t address, const char *content, uint64_t size) override {
-    std::unique_lock<std::mutex> l(mtx);
-    if (!index_map.count(address)) {
+    char *pmem_data = block_data(address);
+    if (pmem_data == nullptr) {
       return -1;
     }
-    PMEMoid data = index_map[address];
-    struct block_entry *bep = (struct block_entry *)pmemobj_direct(data);
-    char *pmem_data = static_cast<char *>(pmemobj_direct(bep->data));
-    // pmemobj_memcpy_persist(pmemContext_.pop, pmem_data, content, size);
-    uint64_t start =
-        std::chrono::high_resolution_clock::now().time_since_epoch() /
-        std::chrono::milliseconds(1);
-    memcpy(pmem_data, content, size);
-    uint64_t end =
-        std::chrono::high_resolution_clock::now().time_since_epoch() /
-        std::chrono::milliseconds(1);
-    total += (end - start);
-    l.unlock();
+    if (persist_mode_ == PERSIST_TX) {
+      pmemobj_memcpy_persist(pmemContext_.pop, pmem_data, content, size);
+    } else {
+      copy_data(pmem_data, content, size);
+      drain_data();
+    }
     return 0;
   }
 
   uint64_t get_virtual_address(uint64_t address) {
-    std::unique_lock<std::mutex> l(mtx);
-    if (!index_map.count(address)) {
+    char *pmem_data = block_data(address);
+    if (pmem_data == nullptr) {
       return -1;
     }
-    PMEMoid data = index_map[address];
-    struct block_entry *bep = (struct block_entry *)pmemobj_direct(data);
-    char *pmem_data = static_cast<char *>(pmemobj_direct(bep->data));
-    l.unlock();
     return (uint64_t)pmem_data;
   }
 
   int release(uint64_t address) override {
+    BlockIndex block;
+    if (remove_meta(address, &block)) {
+      perror("address not found");
+      return -1;
+    }
+    struct BlockList *list = &pmemContext_.base->lists[block.list];
+
     jmp_buf env;
     if (setjmp(env)) {
-      // end the transaction
+      // end the transaction, the block is still there
       (void)pmemobj_tx_end();
+      update_meta(block.oid, block.list);
       return -1;
     }
 
-    // begin a transaction, also acquiring the write lock for the data
-    if (pmemobj_tx_begin(pmemContext_.pop, env, TX_PARAM_RWLOCK,
-                         &pmemContext_.base->rwlock, TX_PARAM_NONE)) {
+    // begin a transaction, also acquiring the write lock of the list
+    if (pmemobj_tx_begin(pmemContext_.pop, env, TX_PARAM_RWLOCK, &list->rwlock,
+                         TX_PARAM_NONE)) {
       perror("pmemobj_tx_begin failed in pmemkv put");
+      update_meta(block.oid, block.list);
       return -1;
     }
-    if (!index_map.count(address)) {
-      (void)pmemobj_tx_end();
-      perror("address not found");
-      return -1;
+    struct block_entry *bep = (struct block_entry *)pmemobj_direct(block.oid);
+    pmemobj_tx_add_range_direct(&list->head, 2 * sizeof(PMEMoid));
+    pmemobj_tx_add_range_direct(&list->bytes_written, sizeof(uint64_t));
+    if (OID_IS_NULL(bep->hdr.pre)) {
+      list->head = bep->hdr.next;
+    } else {
+      pmemobj_tx_add_range(bep->hdr.pre, 0, sizeof(struct block_hdr));
+      ((struct block_entry *)pmemobj_direct(bep->hdr.pre))->hdr.next =
+          bep->hdr.next;
     }
-    PMEMoid data = index_map[address];
-    struct block_entry *bep = (struct block_entry *)pmemobj_direct(data);
-    struct block_entry *prev_bep =
-        (struct block_entry *)pmemobj_direct(bep->hdr.pre);
-    struct block_entry *next_bep =
-        (struct block_entry *)pmemobj_direct(bep->hdr.next);
-    pmemobj_tx_add_range(pmemContext_.poid, 0, sizeof(struct Base));
-    if (prev_bep == nullptr) {
-      if (next_bep == nullptr) {
-        pmemContext_.base->head = OID_NULL;
-        pmemContext_.base->tail = OID_NULL;
-      } else {
-        pmemContext_.base->head = bep->hdr.next;
-        next_bep->hdr.pre = OID_NULL;
-      }
+    if (OID_IS_NULL(bep->hdr.next)) {
+      list->tail = bep->hdr.pre;
     } else {
-      pmemobj_tx_add_range(bep->hdr.pre, 0, sizeof(struct Base));
-      prev_bep->hdr.next = bep->hdr.next;
+      pmemobj_tx_add_range(bep->hdr.next, 0, sizeof(struct block_hdr));
+      ((struct block_entry *)pmemobj_direct(bep->hdr.next))->hdr.pre =
+          bep->hdr.pre;
     }
-    pmemContext_.base->bytes_written -= bep->hdr.size;
-    pmemobj_tx_add_range(data, 0, sizeof(struct Base));
-    bep->hdr.pre = OID_NULL;
-    bep->hdr.next = OID_NULL;
-    pmemobj_free(&data);
-    pmemobj_free(&bep->data);
+    list->bytes_written -= bep->hdr.size;
+    pmemobj_tx_free(bep->data);
+    pmemobj_tx_free(block.oid);
 
     pmemobj_tx_commit();
     (void)pmemobj_tx_end();
@@ -244,20 +524,44 @@ class PmemObjAllocator : public Allocator {
   }
 
   int release_all() override {
-    PMEMoid cur_oid = pmemContext_.base->head;
-    while (cur_oid.off != 0 && cur_oid.pool_uuid_lo != 0) {
-      struct block_entry *cur_bep =
-          (struct block_entry *)pmemobj_direct(cur_oid);
-      PMEMoid next_oid = cur_bep->hdr.next;
-      struct block_entry *next_bep =
-          (struct block_entry *)pmemobj_direct(next_oid);
+    for (auto &list : pmemContext_.base->lists) {
+      PMEMoid cur_oid = list.head;
+      while (!OID_IS_NULL(cur_oid)) {
+        struct block_entry *cur_bep =
+            (struct block_entry *)pmemobj_direct(cur_oid);
+        PMEMoid next_oid = cur_bep->hdr.next;
+        pmemobj_free(&cur_bep->data);
+        pmemobj_free(&cur_oid);
+        cur_oid = next_oid;
+      }
+      list.head = OID_NULL;
+      list.tail = OID_NULL;
+      list.bytes_written = 0;
+    }
+    free_meta();
+
+    std::lock_guard<std::mutex> l(extent_mtx);
+    PMEMoid cur_oid = pmemContext_.base->extents;
+    while (!OID_IS_NULL(cur_oid)) {
+      PMEMoid next_oid = ((struct extent_hdr *)pmemobj_direct(cur_oid))->next;
       pmemobj_free(&cur_oid);
-      pmemobj_free(&cur_bep->data);
       cur_oid = next_oid;
     }
-    pmemContext_.base->head = OID_NULL;
-    pmemContext_.base->tail = OID_NULL;
-    pmemContext_.base->bytes_written = 0;
+    pmemContext_.base->extents = OID_NULL;
+    shuffle_extents.clear();
+    extent_ranges.clear();
+
+    struct KvIndex *kv = kv_index();
+    for (auto &bucket : kv->buckets) {
+      PMEMoid cur_oid = bucket;
+      while (!OID_IS_NULL(cur_oid)) {
+        PMEMoid next_oid = ((struct kv_record *)pmemobj_direct(cur_oid))->next;
+        pmemobj_free(&cur_oid);
+        cur_oid = next_oid;
+      }
+    }
+    pmemobj_memset_persist(pmemContext_.pop, kv->buckets, 0,
+                           sizeof(kv->buckets));
 
     return 0;
   }
@@ -265,25 +569,21 @@ class PmemObjAllocator : public Allocator {
   int dump_all() override {
     std::cout << "******************worker " << wid_
               << " start dump*********************" << std::endl;
-    if (pmemobj_rwlock_rdlock(pmemContext_.pop, &pmemContext_.base->rwlock) !=
-        0) {
-      return -1;
+    uint64_t bytes_written = 0;
+    for (auto &list : pmemContext_.base->lists) {
+      if (pmemobj_rwlock_rdlock(pmemContext_.pop, &list.rwlock) != 0) {
+        return -1;
+      }
+      struct block_entry *next_bep =
+          (struct block_entry *)pmemobj_direct(list.head);
+      while (next_bep != nullptr) {
+        std::cout << "dump address " << next_bep->hdr.addr << std::endl;
+        next_bep = (struct block_entry *)pmemobj_direct(next_bep->hdr.next);
+      }
+      bytes_written += list.bytes_written;
+      pmemobj_rwlock_unlock(pmemContext_.pop, &list.rwlock);
     }
-    struct block_entry *next_bep =
-        (struct block_entry *)pmemobj_direct(pmemContext_.base->head);
-    uint64_t read_offset = 0;
-    while (next_bep != nullptr) {
-      char *pmem_data =
-          reinterpret_cast<char *>(pmemobj_direct(next_bep->data));
-      char *tmp = reinterpret_cast<char *>(std::malloc(next_bep->hdr.size));
-      memcpy(tmp, pmem_data, next_bep->hdr.size);
-      std::cout << "dump address " << next_bep->hdr.addr << std::endl;
-      read_offset += next_bep->hdr.size;
-      std::free(tmp);
-      next_bep = (struct block_entry *)pmemobj_direct(next_bep->hdr.next);
-    }
-    pmemobj_rwlock_unlock(pmemContext_.pop, &pmemContext_.base->rwlock);
-    std::cout << "total size " << pmemContext_.base->bytes_written << std::endl;
+    std::cout << "total size " << bytes_written << std::endl;
     std::cout << "******************worker " << wid_
               << " end dump*********************" << std::endl;
     return 0;
@@ -292,6 +592,52 @@ class PmemObjAllocator : public Allocator {
   Chunk *get_rma_chunk() { return base_ck; }
 
  private:
+  /// Flags of the allocations of the data of blocks written at once, which
+  /// are flushed by their own stores but by PERSIST_TX
+  uint64_t data_flags() {
+#ifdef POBJ_XALLOC_NO_FLUSH
+    return persist_mode_ == PERSIST_TX ? 0 : POBJ_XALLOC_NO_FLUSH;
+#else
+    return 0;
+#endif
+  }
+
+  /// Copy the data of a block, flushed by the transaction in PERSIST_TX,
+  /// else with non-temporal stores left to drain_data
+  void copy_data(void *dest, const char *content, uint64_t size) {
+    if (persist_mode_ == PERSIST_TX) {
+      memcpy(dest, content, size);
+    } else {
+      pmemobj_memcpy(pmemContext_.pop, dest, content, size,
+                     PMEMOBJ_F_MEM_NONTEMPORAL | PMEMOBJ_F_MEM_NODRAIN);
+    }
+  }
+
+  /// Wait for the non-temporal stores of a batch in PERSIST_BATCHED
+  void drain_data() {
+    if (persist_mode_ == PERSIST_BATCHED) {
+      pmemobj_drain(pmemContext_.pop);
+    }
+  }
+
+  // in-memory index entry of a block
+  struct BlockIndex {
+    PMEMoid oid;
+    uint32_t list;
+  };
+
+  struct IndexShard {
+    std::mutex mtx;
+    unordered_map<uint64_t, BlockIndex> index_map;
+  };
+
+  // in-memory extents of a shuffle, blocks are appended to the last one at cur
+  struct ShuffleExtents {
+    vector<PMEMoid> oids;
+    char *cur = nullptr;
+    char *end = nullptr;
+  };
+
   int create() {
     // debug setting
     int sds_write_value = 0;
@@ -305,11 +651,12 @@ class PmemObjAllocator : public Allocator {
                                  err_msg);
       return -1;
     }
+    // the root is zeroed, all lists empty
     pmemContext_.poid = pmemobj_root(pmemContext_.pop, sizeof(struct Base));
     pmemContext_.base = (struct Base *)pmemobj_direct(pmemContext_.poid);
-    pmemContext_.base->head = OID_NULL;
-    pmemContext_.base->tail = OID_NULL;
-    pmemContext_.base->bytes_written = 0;
+    if (create_kv_index()) {
+      return -1;
+    }
 
     if (server_) {
       base_ck = server_->register_rma_buffer(
@@ -344,13 +691,26 @@ class PmemObjAllocator : public Allocator {
 
     pmemContext_.poid = pmemobj_root(pmemContext_.pop, sizeof(struct Base));
     pmemContext_.base = (struct Base *)pmemobj_direct(pmemContext_.poid);
-    PMEMoid next = pmemContext_.base->head;
-    while (next.off != 0 && next.pool_uuid_lo != 0) {
-      if (update_meta(next)) {
-        return -1;
+    if (create_kv_index()) {
+      return -1;
+    }
+    for (uint32_t i = 0; i < PMEM_BLOCK_LIST_NUM; i++) {
+      PMEMoid next = pmemContext_.base->lists[i].head;
+      while (!OID_IS_NULL(next)) {
+        if (update_meta(next, i)) {
+          return -1;
+        }
+        struct block_entry *bep = (struct block_entry *)pmemobj_direct(next);
+        next = bep->hdr.next;
       }
-      struct block_entry *bep = (struct block_entry *)pmemobj_direct(next);
-      next = bep->hdr.next;
+    }
+    // the bytes used of the extents are not kept, appends go to new extents
+    PMEMoid next = pmemContext_.base->extents;
+    while (!OID_IS_NULL(next)) {
+      struct extent_hdr *ehp = (struct extent_hdr *)pmemobj_direct(next);
+      shuffle_extents[ehp->shuffle].oids.push_back(next);
+      extent_ranges[extent_begin(next)] = extent_begin(next) + ehp->size;
+      next = ehp->next;
     }
     return 0;
   }
@@ -360,20 +720,161 @@ class PmemObjAllocator : public Allocator {
     free_meta();
   }
 
-  int update_meta(const PMEMoid &oid) {
-    std::lock_guard<std::mutex> l(mtx);
+  // Block list, and arena, of the calling thread
+  uint32_t thread_list() {
+    static thread_local unordered_map<const PmemObjAllocator *, uint32_t>
+        lists;
+    auto it = lists.find(this);
+    if (it != lists.end()) {
+      return it->second;
+    }
+    uint32_t list = next_list_++ % PMEM_BLOCK_LIST_NUM;
+    lists[this] = list;
+    set_thread_arena(list);
+    return list;
+  }
+
+  // Allocate the blocks of the calling thread from the arena of list, made on
+  // first use. With a libpmemobj without arena control the thread keeps the
+  // arena libpmemobj picked.
+  void set_thread_arena(uint32_t list) {
+    std::lock_guard<std::mutex> l(arena_mtx);
+    auto it = arena_ids.find(list);
+    if (it == arena_ids.end()) {
+      unsigned arena_id;
+      if (pmemobj_ctl_exec(pmemContext_.pop, "heap.arena.create", &arena_id)) {
+        return;
+      }
+      it = arena_ids.emplace(list, arena_id).first;
+    }
+    unsigned arena_id = it->second;
+    pmemobj_ctl_set(pmemContext_.pop, "heap.thread.arena_id", &arena_id);
+  }
+
+  // Allocate the key index, also of pools made before it was kept
+  int create_kv_index() {
+    if (!OID_IS_NULL(pmemContext_.base->kv_index)) {
+      return 0;
+    }
+    return pmemobj_zalloc(pmemContext_.pop, &pmemContext_.base->kv_index,
+                          sizeof(struct KvIndex), KV_INDEX_TYPE);
+  }
+
+  struct KvIndex *kv_index() {
+    return (struct KvIndex *)pmemobj_direct(pmemContext_.base->kv_index);
+  }
+
+  // global address of the data of extent
+  uint64_t extent_begin(const PMEMoid &oid) {
+    return TO_GLOB((uint64_t)pmemobj_direct(oid) + sizeof(struct extent_hdr),
+                   (uint64_t)pmemContext_.pop, wid_);
+  }
+
+  // Reserve an extent of at least size bytes for shuffle, the last of extents
+  int reserve_extent(uint64_t shuffle, uint64_t size,
+                     ShuffleExtents *extents) {
+    size = std::max<uint64_t>(size, PMEM_EXTENT_SIZE);
+    PMEMoid oid = OID_NULL;
+
+    jmp_buf env;
+    if (setjmp(env)) {
+      // end the transaction
+      (void)pmemobj_tx_end();
+      return -1;
+    }
+
+    if (pmemobj_tx_begin(pmemContext_.pop, env, TX_PARAM_RWLOCK,
+                         &pmemContext_.base->extent_rwlock, TX_PARAM_NONE)) {
+      perror("pmemobj_tx_begin failed in reserve_extent");
+      return -1;
+    }
+    // the data is written by the appends, not zeroed
+    oid = pmemobj_tx_alloc(sizeof(struct extent_hdr) + size, EXTENT_TYPE);
+    struct extent_hdr *ehp = (struct extent_hdr *)pmemobj_direct(oid);
+    ehp->shuffle = shuffle;
+    ehp->size = size;
+    ehp->pre = OID_NULL;
+    ehp->next = pmemContext_.base->extents;
+    if (!OID_IS_NULL(ehp->next)) {
+      pmemobj_tx_add_range(ehp->next, 0, sizeof(struct extent_hdr));
+      ((struct extent_hdr *)pmemobj_direct(ehp->next))->pre = oid;
+    }
+    pmemobj_tx_add_range_direct(&pmemContext_.base->extents, sizeof(PMEMoid));
+    pmemContext_.base->extents = oid;
+    pmemobj_tx_commit();
+    (void)pmemobj_tx_end();
+
+    extents->oids.push_back(oid);
+    extents->cur = reinterpret_cast<char *>(ehp + 1);
+    extents->end = extents->cur + size;
+    extent_ranges[extent_begin(oid)] = extent_begin(oid) + size;
+    return 0;
+  }
+
+  // Data of the block at address, allocated or appended, nullptr if none
+  char *block_data(uint64_t address) {
+    BlockIndex block;
+    if (!find_meta(address, &block)) {
+      struct block_entry *bep =
+          (struct block_entry *)pmemobj_direct(block.oid);
+      return static_cast<char *>(pmemobj_direct(bep->data));
+    }
+    std::lock_guard<std::mutex> l(extent_mtx);
+    auto it = extent_ranges.upper_bound(address);
+    if (it == extent_ranges.begin() || address >= (--it)->second) {
+      return nullptr;
+    }
+    return reinterpret_cast<char *>(pmemContext_.pop) +
+           (address - TO_GLOB(0, 0, wid_));
+  }
+
+  IndexShard &index_shard(uint64_t address) {
+    // addresses of blocks of the same size are evenly spaced, mix them
+    auto hash = (address * 0x9e3779b97f4a7c15ULL) >> 32;
+    return index_shards[hash % PMEM_INDEX_SHARD_NUM];
+  }
+
+  int update_meta(const PMEMoid &oid, uint32_t list) {
     struct block_entry *bep = (struct block_entry *)pmemobj_direct(oid);
-    if (!index_map.count(bep->hdr.addr)) {
-      index_map[bep->hdr.addr] = oid;
+    auto &shard = index_shard(bep->hdr.addr);
+    std::lock_guard<std::mutex> l(shard.mtx);
+    if (!shard.index_map.count(bep->hdr.addr)) {
+      shard.index_map[bep->hdr.addr] = {oid, list};
     } else {
       assert("invalide operation.");
     }
     return 0;
   }
 
+  int find_meta(uint64_t address, BlockIndex *block) {
+    auto &shard = index_shard(address);
+    std::lock_guard<std::mutex> l(shard.mtx);
+    auto it = shard.index_map.find(address);
+    if (it == shard.index_map.end()) {
+      return -1;
+    }
+    *block = it->second;
+    return 0;
+  }
+
+  int remove_meta(uint64_t address, BlockIndex *block) {
+    auto &shard = index_shard(address);
+    std::lock_guard<std::mutex> l(shard.mtx);
+    auto it = shard.index_map.find(address);
+    if (it == shard.index_map.end()) {
+      return -1;
+    }
+    *block = it->second;
+    shard.index_map.erase(it);
+    return 0;
+  }
+
   int free_meta() {
-    std::lock_guard<std::mutex> l(mtx);
-    index_map.clear();
+    for (auto &shard : index_shards) {
+      std::lock_guard<std::mutex> l(shard.mtx);
+      shard.index_map.clear();
+    }
+    return 0;
   }
 
  private:
@@ -381,10 +882,17 @@ class PmemObjAllocator : public Allocator {
   DiskInfo *diskInfo_;
   NetworkServer *server_;
   int wid_;
+  PersistMode persist_mode_;
   PmemContext pmemContext_;
-  std::mutex mtx;
-  unordered_map<uint64_t, PMEMoid> index_map;
-  uint64_t total = 0;
+  IndexShard index_shards[PMEM_INDEX_SHARD_NUM];
+  std::atomic<uint32_t> next_list_{0};
+  std::mutex arena_mtx;
+  // by block list
+  unordered_map<uint32_t, unsigned> arena_ids;
+  std::mutex extent_mtx;
+  unordered_map<uint64_t, ShuffleExtents> shuffle_extents;
+  // global addresses of the data of the extents, begin to end
+  std::map<uint64_t, uint64_t> extent_ranges;
   char str[1048576];
   Chunk *base_ck;
 };
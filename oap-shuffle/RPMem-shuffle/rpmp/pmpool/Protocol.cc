@@ -11,12 +11,57 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
 #include "AllocatorProxy.h"
 #include "Config.h"
 #include "Digest.h"
 #include "Event.h"
 #include "Log.h"
 #include "NetworkServer.h"
+#include "Numa.h"
+
+/// bytes a request without data counts for in the fair queues
+static const uint64_t MIN_REQUEST_COST = 4096;
+
+static uint64_t request_cost(const RequestContext &rc) {
+  return std::max(rc.size, MIN_REQUEST_COST);
+}
+
+/// Kind of the request of a reply of type, false if not counted
+static bool stat_op_of(OpType type, StatOp *op) {
+  switch (type) {
+    case ALLOC_REPLY:
+    case ALLOC_BATCH_REPLY:
+      *op = STAT_ALLOC;
+      return true;
+    case WRITE_REPLY:
+    case WRITE_BATCH_REPLY:
+    case APPEND_BATCH_REPLY:
+      *op = STAT_WRITE;
+      return true;
+    case READ_REPLY:
+      *op = STAT_READ;
+      return true;
+    case PUT_REPLY:
+    case PUT_BATCH_REPLY:
+    case MERGE_BATCH_REPLY:
+      *op = STAT_PUT;
+      return true;
+    case GET_META_REPLY:
+      *op = STAT_GET;
+      return true;
+    case FREE_REPLY:
+    case FREE_BATCH_REPLY:
+    case DELETE_REPLY:
+    case DEL_PREFIX_REPLY:
+    case RELEASE_SHUFFLE_REPLY:
+      *op = STAT_DEL;
+      return true;
+    default:
+      return false;
+  }
+}
 
 RecvCallback::RecvCallback(Protocol *protocol, ChunkMgr *chunkMgr)
     : protocol_(protocol), chunkMgr_(chunkMgr) {}
@@ -25,9 +70,11 @@ void RecvCallback::operator()(void *buffer_id, void *buffer_size) {
   auto buffer_id_ = *static_cast<int *>(buffer_id);
   Chunk *ck = chunkMgr_->get(buffer_id_);
   assert(*static_cast<uint64_t *>(buffer_size) == ck->size);
-  Request *request = new Request(reinterpret_cast<char *>(ck->buffer), ck->size,
-                                 reinterpret_cast<Connection *>(ck->con));
+  Request *request = protocol_->requestPool_.get();
+  request->reset(reinterpret_cast<char *>(ck->buffer), ck->size,
+                 reinterpret_cast<Connection *>(ck->con));
   request->decode();
+  request->get_rc().received_us = ServerStats::now_us();
   protocol_->enqueue_recv_msg(request);
   chunkMgr_->reclaim(ck, static_cast<Connection *>(ck->con));
 }
@@ -44,11 +91,6 @@ SendCallback::SendCallback(ChunkMgr *chunkMgr) : chunkMgr_(chunkMgr) {}
 void SendCallback::operator()(void *buffer_id, void *buffer_size) {
   auto buffer_id_ = *static_cast<int *>(buffer_id);
   auto ck = chunkMgr_->get(buffer_id_);
-
-  /// free the memory of class RequestReply
-  auto reqeustReply = static_cast<RequestReply *>(ck->ptr);
-  delete reqeustReply;
-
   chunkMgr_->reclaim(ck, static_cast<Connection *>(ck->con));
 }
 
@@ -59,20 +101,32 @@ void WriteCallback::operator()(void *buffer_id, void *buffer_size) {
   protocol_->enqueue_rma_msg(buffer_id_);
 }
 
-RecvWorker::RecvWorker(Protocol *protocol, int index)
-    : protocol_(protocol), index_(index) {
+RecvWorker::RecvWorker(Protocol *protocol, const std::vector<int> &cpus,
+                       uint64_t busy_poll_us,
+                       std::shared_ptr<FairQueue<Request *>> fairQueue)
+    : protocol_(protocol),
+      cpus_(cpus),
+      backoff_(busy_poll_us),
+      fairQueue_(fairQueue) {
   init = false;
 }
 
 int RecvWorker::entry() {
   if (!init) {
-    set_affinity(index_);
+    set_affinity(cpus_);
     init = true;
   }
   Request *request;
-  bool res = pendingRecvRequestQueue_.wait_dequeue_timed(
-      request, std::chrono::milliseconds(1000));
+  bool res = fairQueue_ ? fairQueue_->try_dequeue(request)
+                        : pendingRecvRequestQueue_.try_dequeue(request);
+  if (!res && !backoff_.keep_polling()) {
+    res = fairQueue_ ? fairQueue_->wait_dequeue_timed(
+                           request, std::chrono::milliseconds(1000))
+                     : pendingRecvRequestQueue_.wait_dequeue_timed(
+                           request, std::chrono::milliseconds(1000));
+  }
   if (res) {
+    backoff_.reset();
     protocol_->handle_recv_msg(request);
   }
   return 0;
@@ -80,24 +134,38 @@ int RecvWorker::entry() {
 
 void RecvWorker::abort() {}
 
-void RecvWorker::addTask(Request *request) {
+void RecvWorker::addTask(Request *request, Tenant *tenant, uint64_t cost) {
+  if (fairQueue_) {
+    fairQueue_->enqueue(tenant, request, cost);
+    return;
+  }
   pendingRecvRequestQueue_.enqueue(request);
 }
 
-ReadWorker::ReadWorker(Protocol *protocol, int index)
-    : protocol_(protocol), index_(index) {
+size_t RecvWorker::depth() {
+  return fairQueue_ ? fairQueue_->size()
+                    : pendingRecvRequestQueue_.size_approx();
+}
+
+ReadWorker::ReadWorker(Protocol *protocol, const std::vector<int> &cpus,
+                       uint64_t busy_poll_us)
+    : protocol_(protocol), cpus_(cpus), backoff_(busy_poll_us) {
   init = false;
 }
 
 int ReadWorker::entry() {
   if (!init) {
-    set_affinity(index_);
+    set_affinity(cpus_);
     init = true;
   }
   RequestReply *requestReply;
-  bool res = pendingReadRequestQueue_.wait_dequeue_timed(
-      requestReply, std::chrono::milliseconds(1000));
+  bool res = pendingReadRequestQueue_.try_dequeue(requestReply);
+  if (!res && !backoff_.keep_polling()) {
+    res = pendingReadRequestQueue_.wait_dequeue_timed(
+        requestReply, std::chrono::milliseconds(1000));
+  }
   if (res) {
+    backoff_.reset();
     protocol_->handle_rma_msg(requestReply);
   }
   return 0;
@@ -109,13 +177,20 @@ void ReadWorker::addTask(RequestReply *rr) {
   pendingReadRequestQueue_.enqueue(rr);
 }
 
-FinalizeWorker::FinalizeWorker(Protocol *protocol) : protocol_(protocol) {}
+size_t ReadWorker::depth() { return pendingReadRequestQueue_.size_approx(); }
+
+FinalizeWorker::FinalizeWorker(Protocol *protocol, uint64_t busy_poll_us)
+    : protocol_(protocol), backoff_(busy_poll_us) {}
 
 int FinalizeWorker::entry() {
   RequestReply *requestReply;
-  bool res = pendingRequestReplyQueue_.wait_dequeue_timed(
-      requestReply, std::chrono::milliseconds(1000));
+  bool res = pendingRequestReplyQueue_.try_dequeue(requestReply);
+  if (!res && !backoff_.keep_polling()) {
+    res = pendingRequestReplyQueue_.wait_dequeue_timed(
+        requestReply, std::chrono::milliseconds(1000));
+  }
   if (res) {
+    backoff_.reset();
     protocol_->handle_finalize_msg(requestReply);
   }
   return 0;
@@ -127,12 +202,38 @@ void FinalizeWorker::addTask(RequestReply *requestReply) {
   pendingRequestReplyQueue_.enqueue(requestReply);
 }
 
+size_t FinalizeWorker::depth() {
+  return pendingRequestReplyQueue_.size_approx();
+}
+
+ReleaseWorker::ReleaseWorker(Protocol *protocol) : protocol_(protocol) {}
+
+int ReleaseWorker::entry() {
+  uint64_t prefix;
+  bool res = pendingPrefixQueue_.wait_dequeue_timed(
+      prefix, std::chrono::milliseconds(1000));
+  if (res) {
+    protocol_->handle_release_msg(prefix);
+  }
+  return 0;
+}
+
+void ReleaseWorker::abort() {}
+
+void ReleaseWorker::addTask(uint64_t prefix) {
+  pendingPrefixQueue_.enqueue(prefix);
+}
+
 Protocol::Protocol(Config *config, Log *log, NetworkServer *server,
                    AllocatorProxy *allocatorProxy)
     : config_(config),
       log_(log),
       networkServer_(server),
-      allocatorProxy_(allocatorProxy) {
+      allocatorProxy_(allocatorProxy),
+      requestPool_(config->get_network_buffer_num()),
+      requestReplyPool_(config->get_network_buffer_num()),
+      rrcMap_(config->get_network_buffer_num()) {
+  stats_.reset(new ServerStats(config->get_pool_size()));
   time = 0;
 }
 
@@ -147,6 +248,8 @@ Protocol::~Protocol() {
   }
   finalizeWorker_->stop();
   finalizeWorker_->join();
+  releaseWorker_->stop();
+  releaseWorker_->join();
 }
 
 int Protocol::init() {
@@ -157,17 +260,70 @@ int Protocol::init() {
   readCallback_ = std::make_shared<ReadCallback>(this);
   writeCallback_ = std::make_shared<WriteCallback>(this);
 
+  inlineRequests_ = config_->get_inline_requests();
+  // inline requests leave the queues empty, their workers blocked
+  uint64_t busy_poll_us =
+      inlineRequests_ ? 0 : std::max(config_->get_busy_poll_us(), 0);
+  maxInflight_ = std::max(config_->get_tenant_max_inflight(), 0);
+  uint64_t bandwidth =
+      static_cast<uint64_t>(std::max(config_->get_tenant_bandwidth_mb(), 0))
+      << 20;
+  scheduled_ = !inlineRequests_ &&
+               (config_->get_fair_scheduling() || bandwidth != 0);
+  auto &pool_numa_nodes = config_->get_pool_numa_nodes();
+  auto nic_numa_node = config_->get_nic_numa_node();
   for (int i = 0; i < config_->get_pool_size(); i++) {
-    auto recvWorker = new RecvWorker(this, config_->get_affinities_()[i] - 1);
+    // the workers of a pool on unknown node keep their own cpu
+    auto cpus = numa_node_cpus(pool_numa_nodes[i]);
+    std::shared_ptr<FairQueue<Request *>> fairQueue;
+    if (scheduled_) {
+      fairQueue = std::make_shared<FairQueue<Request *>>(
+          static_cast<uint64_t>(std::max(config_->get_fair_quantum_kb(), 1))
+              << 10,
+          bandwidth);
+    }
+    auto recvWorker = new RecvWorker(
+        this,
+        cpus.empty() ? std::vector<int>{static_cast<int>(
+                           config_->get_affinities_()[i] - 1)}
+                     : cpus,
+        busy_poll_us, fairQueue);
     recvWorker->start();
     recvWorkers_.push_back(std::shared_ptr<RecvWorker>(recvWorker));
+    if (config_->get_numa_steering() && nic_numa_node >= 0 &&
+        pool_numa_nodes[i] == nic_numa_node) {
+      steeredPools_.push_back(i);
+    }
+  }
+  if (steeredPools_.empty()) {
+    for (int i = 0; i < config_->get_pool_size(); i++) {
+      steeredPools_.push_back(i);
+    }
+  } else {
+    log_->get_console_log()->info(
+        "allocate new blocks from the " + std::to_string(steeredPools_.size()) +
+        " pools on numa node " + std::to_string(nic_numa_node) + " of the nic");
   }
 
-  finalizeWorker_ = make_shared<FinalizeWorker>(this);
+  finalizeWorker_ = make_shared<FinalizeWorker>(this, busy_poll_us);
   finalizeWorker_->start();
+  // replies are sent from the node of the nic
+  auto nic_cpus = numa_node_cpus(nic_numa_node);
+  if (!nic_cpus.empty()) {
+    finalizeWorker_->set_affinity(nic_cpus);
+  }
+
+  releaseWorker_ = make_shared<ReleaseWorker>(this);
+  releaseWorker_->start();
 
   for (int i = 0; i < config_->get_pool_size(); i++) {
-    auto readWorker = new ReadWorker(this, config_->get_affinities_()[i]);
+    auto cpus = numa_node_cpus(pool_numa_nodes[i]);
+    auto readWorker = new ReadWorker(
+        this,
+        cpus.empty()
+            ? std::vector<int>{static_cast<int>(config_->get_affinities_()[i])}
+            : cpus,
+        busy_poll_us);
     readWorker->start();
     readWorkers_.push_back(std::shared_ptr<ReadWorker>(readWorker));
   }
@@ -180,32 +336,110 @@ int Protocol::init() {
 }
 
 void Protocol::enqueue_recv_msg(Request *request) {
-  RequestContext rc = request->get_rc();
+  RequestContext &rc = request->get_rc();
+  Tenant *tenant = nullptr;
+  if (scheduled_ || maxInflight_ != 0) {
+    tenant = tenant_of(rc.con);
+  }
+  // a refused request counts until its reply too
+  if (maxInflight_ != 0 && tenant->in_flight++ >= maxInflight_) {
+    log_->log(spdlog::level::info, "refused busy request type {} rid {}",
+              rc.type, rc.rid);
+    reply_busy(request);
+    return;
+  }
+  if (inlineRequests_) {
+    handle_recv_msg(request);
+    return;
+  }
   if (rc.address != 0) {
     auto wid = GET_WID(rc.address);
-    recvWorkers_[wid]->addTask(request);
+    recvWorkers_[wid]->addTask(request, tenant, request_cost(rc));
   } else {
-    recvWorkers_[rc.rid % config_->get_pool_size()]->addTask(request);
+    recvWorkers_[pool_of(rc.rid)]->addTask(request, tenant,
+                                           request_cost(rc));
   }
 }
 
+void Protocol::reply_busy(Request *request) {
+  RequestContext &rc = request->get_rc();
+  RequestReply *requestReply = requestReplyPool_.get();
+  requestReply->reset();
+  RequestReplyContext &rrc = requestReply->get_rrc();
+  rrc.type = static_cast<OpType>(rc.type | REPLY);
+  rrc.success = REPLY_BUSY;
+  rrc.rid = rc.rid;
+  rrc.key = rc.key;
+  rrc.con = rc.con;
+  requestPool_.put(request);
+  stats_->refused();
+  enqueue_finalize_msg(requestReply);
+}
+
+Tenant *Protocol::tenant_of(Connection *con) {
+  std::lock_guard<std::mutex> lk(tenantMtx_);
+  auto &tenant = tenants_[con];
+  if (!tenant) {
+    tenant.reset(new Tenant());
+  }
+  return tenant.get();
+}
+
+void Protocol::replied(Connection *con) {
+  if (maxInflight_ != 0) {
+    tenant_of(con)->in_flight--;
+  }
+}
+
+void Protocol::count_reply(const RequestReplyContext &rrc) {
+  StatOp op;
+  if (rrc.success == REPLY_BUSY || !stat_op_of(rrc.type, &op)) {
+    return;
+  }
+  uint64_t bytes = rrc.size;
+  if (!rrc.bml.empty()) {
+    bytes = 0;
+    for (auto &bm : rrc.bml) {
+      bytes += bm.size;
+    }
+  }
+  stats_->replied(op, bytes, rrc.received_us);
+}
+
+void Protocol::get_stats(StatsSnapshot *stats) {
+  stats_->snapshot(stats);
+  stats->recv_queue_depth = 0;
+  for (auto &worker : recvWorkers_) {
+    stats->recv_queue_depth += worker->depth();
+  }
+  stats->read_queue_depth = 0;
+  for (auto &worker : readWorkers_) {
+    stats->read_queue_depth += worker->depth();
+  }
+  stats->finalize_queue_depth = finalizeWorker_->depth();
+}
+
 void Protocol::handle_recv_msg(Request *request) {
-  RequestContext rc = request->get_rc();
-  RequestReplyContext rrc;
+  RequestContext &rc = request->get_rc();
+  // filled in place, the lists of a pooled reply don't allocate
+  RequestReply *requestReply = requestReplyPool_.get();
+  requestReply->reset();
+  RequestReplyContext &rrc = requestReply->get_rrc();
+  rrc.received_us = rc.received_us;
+  log_->log(spdlog::level::debug, "request type {} rid {} address {} size {}",
+            rc.type, rc.rid, rc.address, rc.size);
   switch (rc.type) {
     case ALLOC: {
       uint64_t addr = allocatorProxy_->allocate_and_write(
-          rc.size, nullptr, rc.rid % config_->get_pool_size());
+          rc.size, nullptr, pool_of(rc.rid));
       auto wid = GET_WID(addr);
-      assert(wid == rc.rid % config_->get_pool_size());
+      assert(wid == pool_of(rc.rid));
       rrc.type = ALLOC_REPLY;
       rrc.success = 0;
       rrc.rid = rc.rid;
       rrc.address = addr;
       rrc.size = rc.size;
       rrc.con = rc.con;
-      RequestReply *requestReply = new RequestReply(rrc);
-      rrc.ck->ptr = requestReply;
       enqueue_finalize_msg(requestReply);
       break;
     }
@@ -216,8 +450,6 @@ void Protocol::handle_recv_msg(Request *request) {
       rrc.address = rc.address;
       rrc.size = rc.size;
       rrc.con = rc.con;
-      RequestReply *requestReply = new RequestReply(rrc);
-      rrc.ck->ptr = requestReply;
       enqueue_finalize_msg(requestReply);
       break;
     }
@@ -231,11 +463,10 @@ void Protocol::handle_recv_msg(Request *request) {
       rrc.size = rc.size;
       rrc.con = rc.con;
       networkServer_->get_dram_buffer(&rrc);
-      RequestReply *requestReply = new RequestReply(rrc);
       rrc.ck->ptr = requestReply;
 
       std::unique_lock<std::mutex> lk(rrcMtx_);
-      rrcMap_[rrc.ck->buffer_id] = requestReply;
+      rrcMap_.insert(rrc.ck->buffer_id, requestReply);
       lk.unlock();
       networkServer_->read(requestReply);
       break;
@@ -253,11 +484,10 @@ void Protocol::handle_recv_msg(Request *request) {
       rrc.ck = nullptr;
       Chunk *base_ck = allocatorProxy_->get_rma_chunk(rrc.address);
       networkServer_->get_pmem_buffer(&rrc, base_ck);
-      RequestReply *requestReply = new RequestReply(rrc);
       rrc.ck->ptr = requestReply;
 
       std::unique_lock<std::mutex> lk(rrcMtx_);
-      rrcMap_[rrc.ck->buffer_id] = requestReply;
+      rrcMap_.insert(rrc.ck->buffer_id, requestReply);
       lk.unlock();
       networkServer_->write(requestReply);
       break;
@@ -273,11 +503,10 @@ void Protocol::handle_recv_msg(Request *request) {
       rrc.key = rc.key;
       rrc.con = rc.con;
       networkServer_->get_dram_buffer(&rrc);
-      RequestReply *requestReply = new RequestReply(rrc);
       rrc.ck->ptr = requestReply;
 
       std::unique_lock<std::mutex> lk(rrcMtx_);
-      rrcMap_[rrc.ck->buffer_id] = requestReply;
+      rrcMap_.insert(rrc.ck->buffer_id, requestReply);
       lk.unlock();
       networkServer_->read(requestReply);
       break;
@@ -289,9 +518,8 @@ void Protocol::handle_recv_msg(Request *request) {
       rrc.size = rc.size;
       rrc.key = rc.key;
       rrc.con = rc.con;
-      RequestReply *requestReply = new RequestReply(rrc);
-      rrc.ck->ptr = requestReply;
       enqueue_finalize_msg(requestReply);
+      break;
     }
     case DELETE: {
       rrc.type = DELETE_REPLY;
@@ -299,50 +527,216 @@ void Protocol::handle_recv_msg(Request *request) {
       rrc.con = rc.con;
       rrc.rid = rc.rid;
       rrc.success = 0;
+      enqueue_finalize_msg(requestReply);
+      break;
+    }
+    case ALLOC_BATCH: {
+      rrc.type = ALLOC_BATCH_REPLY;
+      rrc.success = 0;
+      rrc.rid = rc.rid;
+      rrc.address = 0;
+      rrc.size = 0;
+      rrc.con = rc.con;
+      vector<uint64_t> sizes;
+      for (auto &bm : rc.bml) {
+        sizes.push_back(bm.size);
+      }
+      vector<uint64_t> addresses;
+      if (allocatorProxy_->allocate_and_write_batch(
+              sizes, vector<const char *>(sizes.size(), nullptr), &addresses,
+              pool_of(rc.rid))) {
+        rrc.success = -1;
+      }
+      for (size_t i = 0; i < addresses.size(); i++) {
+        rrc.bml.push_back(block_meta(addresses[i], sizes[i]));
+      }
+      enqueue_finalize_msg(requestReply);
+      break;
+    }
+    case FREE_BATCH: {
+      rrc.type = FREE_BATCH_REPLY;
+      rrc.success = 0;
+      rrc.rid = rc.rid;
+      rrc.address = 0;
+      rrc.size = 0;
+      rrc.con = rc.con;
+      for (auto &bm : rc.bml) {
+        auto res = allocatorProxy_->release(bm.address);
+        if (res && !rrc.success) {
+          rrc.success = res;
+        }
+      }
+      enqueue_finalize_msg(requestReply);
+      break;
+    }
+    case WRITE_BATCH:
+    case PUT_BATCH:
+    case APPEND_BATCH:
+    case MERGE_BATCH: {
+      rrc.type = rc.type == PUT_BATCH
+                     ? PUT_BATCH_REPLY
+                     : rc.type == APPEND_BATCH
+                           ? APPEND_BATCH_REPLY
+                           : rc.type == MERGE_BATCH ? MERGE_BATCH_REPLY
+                                                    : WRITE_BATCH_REPLY;
+      rrc.success = 0;
+      rrc.rid = rc.rid;
+      rrc.address = 0;
+      rrc.src_address = rc.src_address;
+      rrc.src_rkey = rc.src_rkey;
+      rrc.size = rc.size;
+      rrc.con = rc.con;
+      rrc.key = rc.key;
+      rrc.bml = rc.bml;
+      rrc.keys = rc.keys;
+      // one RMA read of all the blocks
+      networkServer_->get_dram_buffer(&rrc);
+      rrc.ck->ptr = requestReply;
+
+      std::unique_lock<std::mutex> lk(rrcMtx_);
+      rrcMap_.insert(rrc.ck->buffer_id, requestReply);
+      lk.unlock();
+      networkServer_->read(requestReply);
+      break;
+    }
+    case GET_RMA_INFO: {
+      rrc.type = GET_RMA_INFO_REPLY;
+      rrc.success = 0;
+      rrc.rid = rc.rid;
+      rrc.address = 0;
+      rrc.size = 0;
+      rrc.con = rc.con;
+      for (int i = 0; i < config_->get_pool_size(); i++) {
+        Chunk *base_ck =
+            allocatorProxy_->get_rma_chunk(TO_GLOB(0, 0, (uint64_t)i));
+        rrc.bml.push_back(block_meta(
+            reinterpret_cast<uint64_t>(base_ck->buffer), base_ck->mr->key));
+      }
+      enqueue_finalize_msg(requestReply);
+      break;
+    }
+    case DEL_PREFIX: {
+      rrc.type = DEL_PREFIX_REPLY;
+      rrc.success = 0;
+      rrc.rid = rc.rid;
+      rrc.address = 0;
+      rrc.size = 0;
+      rrc.key = rc.key;
+      rrc.con = rc.con;
+      enqueue_finalize_msg(requestReply);
+      break;
+    }
+    case RELEASE_SHUFFLE: {
+      rrc.type = RELEASE_SHUFFLE_REPLY;
+      rrc.success = allocatorProxy_->release_shuffle(rc.key);
+      rrc.rid = rc.rid;
+      rrc.address = 0;
+      rrc.size = 0;
+      rrc.key = rc.key;
+      rrc.con = rc.con;
+      enqueue_finalize_msg(requestReply);
+      break;
+    }
+    case GET_STATS: {
+      rrc.type = GET_STATS_REPLY;
+      rrc.success = 0;
+      rrc.rid = rc.rid;
+      rrc.address = 0;
+      rrc.size = 0;
+      rrc.con = rc.con;
+      StatsSnapshot stats;
+      get_stats(&stats);
+      stats.encode(&rrc.bml);
+      enqueue_finalize_msg(requestReply);
+      break;
+    }
+    default: {
+      requestReplyPool_.put(requestReply);
+      replied(rc.con);
+      break;
     }
-    default: { break; }
   }
 
-  delete request;
+  requestPool_.put(request);
 }
 
 void Protocol::enqueue_finalize_msg(RequestReply *requestReply) {
+  if (inlineRequests_) {
+    handle_finalize_msg(requestReply);
+    return;
+  }
   finalizeWorker_->addTask(requestReply);
 }
 
 void Protocol::handle_finalize_msg(RequestReply *requestReply) {
-  RequestReplyContext rrc = requestReply->get_rrc();
-  if (rrc.type == PUT_REPLY) {
+  RequestReplyContext &rrc = requestReply->get_rrc();
+  if (rrc.success == REPLY_BUSY) {
+    // refused, nothing done
+  } else if (rrc.type == PUT_REPLY) {
     allocatorProxy_->cache_chunk(rrc.key, rrc.address, rrc.size);
   } else if (rrc.type == GET_META_REPLY) {
     auto bml = allocatorProxy_->get_cached_chunk(rrc.key);
     requestReply->requestReplyContext_.bml = bml;
-  } else if (rrc.type == DELETE_REPLY) {
-    auto bml = allocatorProxy_->get_cached_chunk(rrc.key);
-    for (auto bm : bml) {
-      rrc.success = allocatorProxy_->release(bm.address);
-      if (rrc.success) {
-        break;
-      }
+  } else if (rrc.type == PUT_BATCH_REPLY) {
+    for (size_t i = 0; i < rrc.bml.size(); i++) {
+      allocatorProxy_->cache_chunk(rrc.keys[i], rrc.bml[i]);
+    }
+    if (rrc.key != 0) {
+      allocatorProxy_->add_prefix_keys(rrc.key, rrc.keys);
+    }
+  } else if (rrc.type == MERGE_BATCH_REPLY) {
+    // the blocks merged before a failed one are kept
+    for (size_t i = 0; i < rrc.bml.size() && rrc.bml[i].address != 0; i++) {
+      allocatorProxy_->cache_chunk(rrc.keys[i], rrc.bml[i]);
     }
-    allocatorProxy_->del_chunk(rrc.key);
+    if (rrc.key != 0) {
+      allocatorProxy_->add_prefix_keys(rrc.key, rrc.keys);
+    }
+  } else if (rrc.type == DELETE_REPLY) {
+    requestReply->requestReplyContext_.success =
+        allocatorProxy_->release_key(rrc.key);
+  } else if (rrc.type == DEL_PREFIX_REPLY) {
+    releaseWorker_->addTask(rrc.key);
   } else {
   }
   requestReply->encode();
   networkServer_->send(reinterpret_cast<char *>(requestReply->data_),
                        requestReply->size_, rrc.con);
+  log_->log(spdlog::level::debug, "reply type {} rid {} success {} size {}",
+            rrc.type, rrc.rid, rrc.success, rrc.size);
+  count_reply(rrc);
+  replied(rrc.con);
+  // sent from a copy
+  requestReplyPool_.put(requestReply);
+}
+
+void Protocol::handle_release_msg(uint64_t prefix) {
+  auto keys = allocatorProxy_->take_prefix_keys(prefix);
+  for (auto key : keys) {
+    allocatorProxy_->release_key(key);
+  }
+  log_->log(spdlog::level::info, "deleted {} keys of prefix {}", keys.size(),
+            prefix);
 }
 
 void Protocol::enqueue_rma_msg(uint64_t buffer_id) {
+  RequestReply *requestReply = nullptr;
   std::unique_lock<std::mutex> lk(rrcMtx_);
-  RequestReply *requestReply = rrcMap_[buffer_id];
+  bool found = rrcMap_.take(buffer_id, &requestReply);
   lk.unlock();
-  RequestReplyContext rrc = requestReply->get_rrc();
+  if (!found) {
+    return;
+  }
+  if (inlineRequests_) {
+    handle_rma_msg(requestReply);
+    return;
+  }
+  RequestReplyContext &rrc = requestReply->get_rrc();
   if (rrc.address != 0) {
     auto wid = GET_WID(rrc.address);
     readWorkers_[wid]->addTask(requestReply);
   } else {
-    readWorkers_[rrc.rid % config_->get_pool_size()]->addTask(requestReply);
+    readWorkers_[pool_of(rrc.rid)]->addTask(requestReply);
   }
 }
 
@@ -353,10 +747,11 @@ void Protocol::handle_rma_msg(RequestReply *requestReply) {
       char *buffer = static_cast<char *>(rrc.ck->buffer);
       if (rrc.address == 0) {
         rrc.address = allocatorProxy_->allocate_and_write(
-            rrc.size, buffer, rrc.rid % config_->get_pool_size());
+            rrc.size, buffer, pool_of(rrc.rid));
       } else {
         allocatorProxy_->write(rrc.address, buffer, rrc.size);
       }
+      stats_->persisted(GET_WID(rrc.address), rrc.size);
       networkServer_->reclaim_dram_buffer(&rrc);
       break;
     }
@@ -368,7 +763,57 @@ void Protocol::handle_rma_msg(RequestReply *requestReply) {
       char *buffer = static_cast<char *>(rrc.ck->buffer);
       assert(rrc.address == 0);
       rrc.address = allocatorProxy_->allocate_and_write(
-          rrc.size, buffer, rrc.rid % config_->get_pool_size());
+          rrc.size, buffer, pool_of(rrc.rid));
+      stats_->persisted(GET_WID(rrc.address), rrc.size);
+      networkServer_->reclaim_dram_buffer(&rrc);
+      break;
+    }
+    case MERGE_BATCH_REPLY: {
+      // each block goes to the extents of its key, for its blocks to be
+      // contiguous whoever merged them
+      const char *buffer = static_cast<char *>(rrc.ck->buffer);
+      for (size_t i = 0; i < rrc.bml.size(); i++) {
+        vector<uint64_t> addresses;
+        if (allocatorProxy_->append_batch(rrc.keys[i], {rrc.bml[i].size},
+                                          {buffer}, &addresses,
+                                          pool_of_key(rrc.keys[i]))) {
+          rrc.success = -1;
+          break;
+        }
+        rrc.bml[i].address = addresses[0];
+        stats_->persisted(GET_WID(addresses[0]), rrc.bml[i].size);
+        buffer += rrc.bml[i].size;
+      }
+      networkServer_->reclaim_dram_buffer(&rrc);
+      break;
+    }
+    case WRITE_BATCH_REPLY:
+    case PUT_BATCH_REPLY:
+    case APPEND_BATCH_REPLY: {
+      // the blocks are one after the other in the buffer
+      const char *buffer = static_cast<char *>(rrc.ck->buffer);
+      vector<uint64_t> sizes;
+      vector<const char *> contents;
+      for (auto &bm : rrc.bml) {
+        sizes.push_back(bm.size);
+        contents.push_back(buffer);
+        buffer += bm.size;
+      }
+      vector<uint64_t> addresses;
+      int res = rrc.type == APPEND_BATCH_REPLY
+                    ? allocatorProxy_->append_batch(
+                          rrc.key, sizes, contents, &addresses,
+                          pool_of(rrc.rid))
+                    : allocatorProxy_->allocate_and_write_batch(
+                          sizes, contents, &addresses,
+                          pool_of(rrc.rid));
+      if (res) {
+        rrc.success = -1;
+      }
+      for (size_t i = 0; i < addresses.size(); i++) {
+        rrc.bml[i].address = addresses[i];
+        stats_->persisted(GET_WID(addresses[i]), rrc.bml[i].size);
+      }
       networkServer_->reclaim_dram_buffer(&rrc);
       break;
     }
@@ -22,7 +22,12 @@
 #include <unordered_map>
 #include <vector>
 
+#include "AdaptiveBackoff.h"
 #include "Event.h"
+#include "FairQueue.h"
+#include "ObjectPool.h"
+#include "SlotTable.h"
+#include "Stats.h"
 #include "ThreadWrapper.h"
 #include "queue/blockingconcurrentqueue.h"
 #include "queue/concurrentqueue.h"
@@ -95,46 +100,77 @@ class WriteCallback : public Callback {
 class RecvWorker : public ThreadWrapper {
  public:
   RecvWorker() = delete;
-  RecvWorker(Protocol *protocol, int index);
+  /// With a fairQueue, the requests go through it rather than in arrival
+  /// order
+  RecvWorker(Protocol *protocol, const std::vector<int> &cpus,
+             uint64_t busy_poll_us = 0,
+             std::shared_ptr<FairQueue<Request *>> fairQueue = nullptr);
   ~RecvWorker() override = default;
   int entry() override;
   void abort() override;
-  void addTask(Request *request);
+  /// Queue request of tenant, of cost bytes for the fair queue
+  void addTask(Request *request, Tenant *tenant, uint64_t cost);
+  /// Requests queued, approximately
+  size_t depth();
 
  private:
   Protocol *protocol_;
-  int index_;
+  std::vector<int> cpus_;
   bool init;
+  AdaptiveBackoff backoff_;
   BlockingConcurrentQueue<Request *> pendingRecvRequestQueue_;
+  std::shared_ptr<FairQueue<Request *>> fairQueue_;
 };
 
 class ReadWorker : public ThreadWrapper {
  public:
   ReadWorker() = delete;
-  ReadWorker(Protocol *protocol, int index);
+  ReadWorker(Protocol *protocol, const std::vector<int> &cpus,
+             uint64_t busy_poll_us = 0);
   ~ReadWorker() override = default;
   int entry() override;
   void abort() override;
   void addTask(RequestReply *requestReply);
+  /// Transfers queued, approximately
+  size_t depth();
 
  private:
   Protocol *protocol_;
-  int index_;
+  std::vector<int> cpus_;
   bool init;
+  AdaptiveBackoff backoff_;
   BlockingConcurrentQueue<RequestReply *> pendingReadRequestQueue_;
 };
 
+/// Frees the blocks of the keys of the prefixes deleted, in background
+class ReleaseWorker : public ThreadWrapper {
+ public:
+  ReleaseWorker() = delete;
+  explicit ReleaseWorker(Protocol *protocol);
+  ~ReleaseWorker() override = default;
+  int entry() override;
+  void abort() override;
+  void addTask(uint64_t prefix);
+
+ private:
+  Protocol *protocol_;
+  BlockingConcurrentQueue<uint64_t> pendingPrefixQueue_;
+};
+
 class FinalizeWorker : public ThreadWrapper {
  public:
   FinalizeWorker() = delete;
-  explicit FinalizeWorker(Protocol *protocol);
+  explicit FinalizeWorker(Protocol *protocol, uint64_t busy_poll_us = 0);
   ~FinalizeWorker() override = default;
   int entry() override;
   void abort() override;
   void addTask(RequestReply *requestReply);
+  /// Replies queued, approximately
+  size_t depth();
 
  private:
   Protocol *protocol_;
+  AdaptiveBackoff backoff_;
   BlockingConcurrentQueue<RequestReply *> pendingRequestReplyQueue_;
 };
 
@@ -145,6 +181,23 @@ class FinalizeWorker : public ThreadWrapper {
  * recv queue-> to handle receive event.
  * finalize queue-> to handle finalization event.
  * rma queue-> to handle remote memory access event.
+ * The recv and rma workers of a pool run on the NUMA node of the pool, and
+ * new blocks are allocated from the pools on the node of the NIC, so that
+ * they are written without crossing sockets.
+ * With busy_poll_us, the workers busy-poll their queues rather than wait for
+ * a wakeup per request. With inline_requests, the requests are handled on the
+ * network threads completing them, without going through the queues.
+ *
+ * Each connection is a tenant. With fair_scheduling or a tenant_bandwidth_mb,
+ * the recv workers serve the tenants in turn by bytes, those over their
+ * bandwidth waiting in their queues. Past tenant_max_inflight requests of a
+ * tenant received and not replied yet, its requests are refused with a
+ * REPLY_BUSY reply, for its client to back off and send them again, rather
+ * than queued without bound.
+ *
+ * The requests replied are counted in stats_ by StatOp, with their bytes and
+ * their latency from receipt to reply, for GET_STATS to return them with the
+ * depths of the queues.
  */
 class Protocol {
  public:
@@ -166,6 +219,25 @@ class Protocol {
   void enqueue_rma_msg(uint64_t buffer_id);
   void handle_rma_msg(RequestReply *requestReply);
 
+  /// Delete the keys put under prefix and free their blocks
+  void handle_release_msg(uint64_t prefix);
+
+  /// Reply REPLY_BUSY to request, without handling it
+  void reply_busy(Request *request);
+
+  /// Counters so far and the current depths of the queues
+  void get_stats(StatsSnapshot *stats);
+
+  /// Pool the blocks of the request rid are allocated from
+  uint64_t pool_of(uint64_t rid) {
+    return steeredPools_[rid % steeredPools_.size()];
+  }
+
+  /// Pool the blocks merged under key are appended to
+  uint64_t pool_of_key(uint64_t key) {
+    return steeredPools_[key % steeredPools_.size()];
+  }
+
  public:
   Config *config_;
   Log *log_;
@@ -184,10 +256,33 @@ class Protocol {
 
   std::vector<std::shared_ptr<RecvWorker>> recvWorkers_;
   std::shared_ptr<FinalizeWorker> finalizeWorker_;
+  std::shared_ptr<ReleaseWorker> releaseWorker_;
   std::vector<std::shared_ptr<ReadWorker>> readWorkers_;
+  /// pools new blocks are allocated from
+  std::vector<uint64_t> steeredPools_;
+  bool inlineRequests_ = false;
+
+  /// Tenant of the requests of con
+  Tenant *tenant_of(Connection *con);
+  /// A request of con is replied
+  void replied(Connection *con);
+  /// Count the reply rrc in stats_
+  void count_reply(const RequestReplyContext &rrc);
+
+  std::unique_ptr<ServerStats> stats_;
+
+  bool scheduled_ = false;
+  uint64_t maxInflight_ = 0;
+  std::mutex tenantMtx_;
+  std::unordered_map<Connection *, std::unique_ptr<Tenant>> tenants_;
+
+  /// requests received and replies sent, reused across requests
+  ObjectPool<Request> requestPool_;
+  ObjectPool<RequestReply> requestReplyPool_;
 
   std::mutex rrcMtx_;
-  std::unordered_map<uint64_t, RequestReply *> rrcMap_;
+  /// replies of the RMA transfers in flight, by buffer id
+  SlotTable<RequestReply *> rrcMap_;
   uint64_t time;
 };
 
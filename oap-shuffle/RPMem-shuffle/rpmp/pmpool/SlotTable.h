@@ -0,0 +1,123 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/SlotTable.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_SLOTTABLE_H_
+#define PMPOOL_SLOTTABLE_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Values of the requests in flight by id, e.g. their reply callbacks
+ * by rid, in preallocated slots rather than in nodes allocated per request.
+ * Open addressing with linear probing, kept at most half full: the table
+ * doubles only once more than capacity ids are in at once. Not thread-safe.
+ */
+template <class V>
+class SlotTable {
+ public:
+  explicit SlotTable(uint64_t capacity) : size_(0) {
+    uint64_t slots = 2;
+    while (slots < 2 * capacity) {
+      slots <<= 1;
+    }
+    slots_.resize(slots);
+    mask_ = slots - 1;
+  }
+
+  uint64_t size() const { return size_; }
+
+  /// Insert value of id, which isn't in the table
+  void insert(uint64_t id, V value) {
+    if (2 * (size_ + 1) > slots_.size()) {
+      grow();
+    }
+    auto i = home(id);
+    while (slots_[i].used) {
+      i = (i + 1) & mask_;
+    }
+    slots_[i].id = id;
+    slots_[i].used = true;
+    slots_[i].value = std::move(value);
+    size_++;
+  }
+
+  /// Value of id, nullptr if it isn't in, valid until the table changes
+  V *find(uint64_t id) {
+    auto i = index(id);
+    return slots_[i].used ? &slots_[i].value : nullptr;
+  }
+
+  /// Move the value of id out of the table, false if it isn't in
+  bool take(uint64_t id, V *value) {
+    auto i = index(id);
+    if (!slots_[i].used) {
+      return false;
+    }
+    *value = std::move(slots_[i].value);
+    slots_[i].value = V();
+    slots_[i].used = false;
+    size_--;
+    // shift back the ids probed past the emptied slot
+    auto j = i;
+    while (true) {
+      j = (j + 1) & mask_;
+      if (!slots_[j].used) {
+        break;
+      }
+      auto k = home(slots_[j].id);
+      bool stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+      if (!stays) {
+        slots_[i] = std::move(slots_[j]);
+        slots_[j].value = V();
+        slots_[j].used = false;
+        i = j;
+      }
+    }
+    return true;
+  }
+
+ private:
+  struct Slot {
+    uint64_t id = 0;
+    bool used = false;
+    V value{};
+  };
+
+  /// ids of one connection are strided, spread them over the slots
+  uint64_t home(uint64_t id) const {
+    return ((id * 0x9E3779B97F4A7C15ULL) >> 32) & mask_;
+  }
+
+  /// Slot of id, else the empty slot ending its probes
+  uint64_t index(uint64_t id) const {
+    auto i = home(id);
+    while (slots_[i].used && slots_[i].id != id) {
+      i = (i + 1) & mask_;
+    }
+    return i;
+  }
+
+  void grow() {
+    std::vector<Slot> slots(slots_.size() * 2);
+    slots.swap(slots_);
+    mask_ = slots_.size() - 1;
+    size_ = 0;
+    for (auto &slot : slots) {
+      if (slot.used) {
+        insert(slot.id, std::move(slot.value));
+      }
+    }
+  }
+
+  std::vector<Slot> slots_;
+  uint64_t mask_;
+  uint64_t size_;
+};
+
+#endif  // PMPOOL_SLOTTABLE_H_
@@ -0,0 +1,187 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/Stats.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_STATS_H_
+#define PMPOOL_STATS_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <vector>
+
+#include "Base.h"
+
+/// Kinds of requests counted by ServerStats
+enum StatOp : uint32_t {
+  STAT_ALLOC = 0,
+  STAT_WRITE,
+  STAT_READ,
+  STAT_PUT,
+  STAT_GET,
+  STAT_DEL,
+  STAT_OP_NUM
+};
+
+/// Latency bucket i counts the requests replied in less than 2^i us, the last
+/// one those slower
+#define STAT_LATENCY_BUCKETS 32
+
+/// Counters of one kind of requests
+struct OpStats {
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+  uint64_t latency_us[STAT_LATENCY_BUCKETS] = {};
+
+  /// Latency under which fraction of the requests were replied, in us, the
+  /// upper bound of its bucket
+  uint64_t percentile_us(double fraction) const {
+    uint64_t seen = 0;
+    for (int i = 0; i < STAT_LATENCY_BUCKETS; i++) {
+      seen += latency_us[i];
+      if (count != 0 && seen >= fraction * count) {
+        return 1ULL << i;
+      }
+    }
+    return 0;
+  }
+};
+
+/**
+ * @brief Load of the server, as a GET_STATS request returns it: the requests
+ * of each StatOp replied since start, the requests and RMA transfers queued
+ * for the workers, and the bytes written to each pool.
+ */
+struct StatsSnapshot {
+  OpStats ops[STAT_OP_NUM];
+  /// requests refused with REPLY_BUSY
+  uint64_t refused = 0;
+  uint64_t recv_queue_depth = 0;
+  uint64_t read_queue_depth = 0;
+  uint64_t finalize_queue_depth = 0;
+  /// bytes written to each pool, in pool order
+  std::vector<uint64_t> persisted_bytes;
+
+  /// Values one after the other, two per block_meta to fit a reply
+  void encode(std::vector<block_meta> *bml) const {
+    std::vector<uint64_t> values = {STAT_OP_NUM, STAT_LATENCY_BUCKETS,
+                                    persisted_bytes.size()};
+    for (auto &op : ops) {
+      values.push_back(op.count);
+      values.push_back(op.bytes);
+      values.insert(values.end(), op.latency_us,
+                    op.latency_us + STAT_LATENCY_BUCKETS);
+    }
+    values.insert(values.end(), {refused, recv_queue_depth, read_queue_depth,
+                                 finalize_queue_depth});
+    values.insert(values.end(), persisted_bytes.begin(), persisted_bytes.end());
+    values.resize(values.size() + values.size() % 2);
+    bml->clear();
+    for (size_t i = 0; i < values.size(); i += 2) {
+      bml->push_back(block_meta(values[i], values[i + 1]));
+    }
+  }
+
+  /// Return 0 if bml is a snapshot encoded with the same op and bucket
+  /// numbers
+  int decode(const std::vector<block_meta> &bml) {
+    std::vector<uint64_t> values;
+    for (auto &bm : bml) {
+      values.push_back(bm.address);
+      values.push_back(bm.size);
+    }
+    if (values.size() < 3 || values[0] != STAT_OP_NUM ||
+        values[1] != STAT_LATENCY_BUCKETS) {
+      return -1;
+    }
+    auto pools = values[2];
+    if (values.size() <
+        3 + STAT_OP_NUM * (2 + STAT_LATENCY_BUCKETS) + 4 + pools) {
+      return -1;
+    }
+    auto value = values.begin() + 3;
+    for (auto &op : ops) {
+      op.count = *value++;
+      op.bytes = *value++;
+      for (auto &bucket : op.latency_us) {
+        bucket = *value++;
+      }
+    }
+    refused = *value++;
+    recv_queue_depth = *value++;
+    read_queue_depth = *value++;
+    finalize_queue_depth = *value++;
+    persisted_bytes.assign(value, value + pools);
+    return 0;
+  }
+};
+
+/**
+ * @brief Counters of the requests handled by the server, updated by the
+ * workers with relaxed atomics, without locks.
+ */
+class ServerStats {
+ public:
+  explicit ServerStats(int pool_num) : persisted_(pool_num) {}
+
+  static uint64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /// A request of op on bytes, received at received_us, is replied
+  void replied(StatOp op, uint64_t bytes, uint64_t received_us) {
+    auto &counters = ops_[op];
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    auto now = now_us();
+    auto latency = now > received_us ? now - received_us : 0;
+    int bucket = 0;
+    while (bucket < STAT_LATENCY_BUCKETS - 1 && latency >= (1ULL << bucket)) {
+      bucket++;
+    }
+    counters.latency_us[bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void refused() { refused_.fetch_add(1, std::memory_order_relaxed); }
+
+  void persisted(uint64_t pool, uint64_t bytes) {
+    if (pool < persisted_.size()) {
+      persisted_[pool].fetch_add(bytes, std::memory_order_relaxed);
+    }
+  }
+
+  /// Counters so far, the queue depths left to the caller
+  void snapshot(StatsSnapshot *stats) const {
+    for (uint32_t i = 0; i < STAT_OP_NUM; i++) {
+      stats->ops[i].count = ops_[i].count.load(std::memory_order_relaxed);
+      stats->ops[i].bytes = ops_[i].bytes.load(std::memory_order_relaxed);
+      for (int j = 0; j < STAT_LATENCY_BUCKETS; j++) {
+        stats->ops[i].latency_us[j] =
+            ops_[i].latency_us[j].load(std::memory_order_relaxed);
+      }
+    }
+    stats->refused = refused_.load(std::memory_order_relaxed);
+    stats->persisted_bytes.clear();
+    for (auto &bytes : persisted_) {
+      stats->persisted_bytes.push_back(bytes.load(std::memory_order_relaxed));
+    }
+  }
+
+ private:
+  struct Counters {
+    std::atomic<uint64_t> count = {0};
+    std::atomic<uint64_t> bytes = {0};
+    std::atomic<uint64_t> latency_us[STAT_LATENCY_BUCKETS] = {};
+  };
+
+  Counters ops_[STAT_OP_NUM];
+  std::atomic<uint64_t> refused_ = {0};
+  std::vector<std::atomic<uint64_t>> persisted_;
+};
+
+#endif  // PMPOOL_STATS_H_
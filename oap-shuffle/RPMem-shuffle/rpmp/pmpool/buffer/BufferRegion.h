@@ -0,0 +1,55 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/buffer/BufferRegion.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool/buffer
+ * Created Date: Wednesday, October 14th 2020, 2:20:41 pm
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_BUFFER_BUFFERREGION_H_
+#define PMPOOL_BUFFER_BUFFERREGION_H_
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <vector>
+
+// memory policy of mbind(2), numaif.h isn't required for it
+#define RPMP_MPOL_BIND 2
+
+/**
+ * @brief Map an anonymous region of size bytes for network buffers.
+ * With numa_node >= 0 its pages are bound to that node, so that the buffers
+ * are local to the NIC or the workers using them. With prefault all its pages
+ * are touched before it is returned, so that no page fault is taken on the
+ * RDMA path, for the consideration of high performance.
+ * Return nullptr if fail. A failed binding leaves the default policy.
+ */
+inline char *map_buffer_region(uint64_t size, bool prefault = false,
+                               int numa_node = -1) {
+  void *region = mmap(0, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    return nullptr;
+  }
+  if (numa_node >= 0) {
+    const uint64_t bits = 8 * sizeof(unsigned long);  // NOLINT
+    std::vector<unsigned long> nodemask(numa_node / bits + 1, 0);  // NOLINT
+    nodemask[numa_node / bits] = 1UL << (numa_node % bits);
+    syscall(SYS_mbind, region, size, RPMP_MPOL_BIND, nodemask.data(),
+            nodemask.size() * bits + 1, 0);
+  }
+  if (prefault) {
+    char *buffer = static_cast<char *>(region);
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    for (uint64_t i = 0; i < size; i += page_size) {
+      buffer[i] = 0;
+    }
+  }
+  return static_cast<char *>(region);
+}
+
+#endif  // PMPOOL_BUFFER_BUFFERREGION_H_
@@ -0,0 +1,195 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/buffer/LockFreeCircularBuffer.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool/buffer
+ * Created Date: Wednesday, October 14th 2020, 2:20:41 pm
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_BUFFER_LOCKFREECIRCULARBUFFER_H_
+#define PMPOOL_BUFFER_LOCKFREECIRCULARBUFFER_H_
+
+#include <assert.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "../RmaBufferRegister.h"
+#include "BufferRegion.h"
+
+#ifndef p2align
+#define p2align(x, a) (((x) + (a)-1) & ~((a)-1))
+#endif
+
+/**
+ * @brief Multi-producer variant of CircularBuffer taking no lock.
+ * Buffers are reserved by a compare-and-swap of the write position and put
+ * back in any order by setting their bits in a bitmap of released buffers.
+ * The read position is advanced over the released buffers by one putter at a
+ * time, the others leave their buffers to it, clearing the bits a word at a
+ * time. Like CircularBuffer, the buffers of one get are contiguous, get waits
+ * while there are not enough free buffers.
+ * Positions grow without wrapping, the buffer at position p is the one at
+ * p % buffer_num.
+ */
+class LockFreeCircularBuffer {
+ public:
+  LockFreeCircularBuffer() = delete;
+  LockFreeCircularBuffer(const LockFreeCircularBuffer &) = delete;
+  /// prefault and numa_node are applied to the mmap'ed region, see
+  /// map_buffer_region
+  LockFreeCircularBuffer(uint64_t buffer_size, uint32_t buffer_num,
+                         bool prefault = false,
+                         RmaBufferRegister *rbr = nullptr, int numa_node = -1)
+      : buffer_size_(buffer_size),
+        buffer_num_(buffer_num),
+        rbr_(rbr),
+        ck_(nullptr),
+        bits_((buffer_num + 63) / 64),
+        read_(0),
+        write_(0),
+        advancing_(false) {
+    buffer_ = map_buffer_region(buffer_num_ * buffer_size_, prefault,
+                                numa_node);
+    assert(buffer_ != nullptr);
+    if (rbr_) {
+      ck_ = rbr_->register_rma_buffer(buffer_, buffer_num_ * buffer_size_);
+    }
+    for (auto &word : bits_) {
+      word.store(0);
+    }
+  }
+  ~LockFreeCircularBuffer() {
+    munmap(buffer_, buffer_num_ * buffer_size_);
+    buffer_ = nullptr;
+  }
+  char *get(uint64_t bytes) {
+    uint64_t offset = 0;
+    bool res = get(bytes, &offset);
+    if (res == false) {
+      return nullptr;
+    }
+    return buffer_ + offset * buffer_size_;
+  }
+  void put(const char *data, uint64_t bytes) {
+    assert((data - buffer_) % buffer_size_ == 0);
+    uint64_t offset = (data - buffer_) / buffer_size_;
+    put(offset, bytes);
+  }
+
+  void dump() {
+    std::cout << "********************************************" << std::endl;
+    std::cout << "read_ " << get_read_() << " write_ " << get_write_()
+              << std::endl;
+    for (uint64_t i = 0; i < buffer_num_; i++) {
+      std::cout << ((bits_[i / 64].load() >> (i % 64)) & 1) << " ";
+    }
+    std::cout << std::endl;
+    std::cout << "********************************************" << std::endl;
+  }
+  uint64_t get_read_() { return read_.load() % buffer_num_; }
+  uint64_t get_write_() { return write_.load() % buffer_num_; }
+
+  bool get(uint64_t bytes, uint64_t *offset) {
+    uint64_t alloc_num = p2align(bytes, buffer_size_) / buffer_size_;
+    if (alloc_num > buffer_num_) {
+      return false;
+    }
+    uint64_t write = write_.load();
+    while (true) {
+      uint64_t index = write % buffer_num_;
+      // the buffers of a get don't wrap, those left at the end are skipped
+      uint64_t skip = index + alloc_num > buffer_num_ ? buffer_num_ - index : 0;
+      uint64_t next = write + skip + alloc_num;
+      // an empty buffer fits any get, the buffers it skips being released
+      // first. A stale write below read_ looks full, and is reloaded.
+      uint64_t read = read_.load();
+      if (next - read > buffer_num_ && read != write) {
+        // wait
+        std::this_thread::yield();
+        write = write_.load();
+        continue;
+      }
+      if (write_.compare_exchange_weak(write, next)) {
+        if (skip) {
+          release(index, skip);
+          advance();
+        }
+        *offset = skip ? 0 : index;
+        return true;
+      }
+    }
+  }
+  void put(uint64_t offset, uint64_t bytes) {
+    uint64_t alloc_num = p2align(bytes, buffer_size_) / buffer_size_;
+    assert(offset + alloc_num <= buffer_num_);
+    release(offset, alloc_num);
+    advance();
+  }
+  Chunk *get_rma_chunk() { return ck_; }
+  uint64_t get_offset(uint64_t data) { return (data - (uint64_t)buffer_); }
+
+ private:
+  // Set the bits of the num buffers from index, a word at a time
+  void release(uint64_t index, uint64_t num) {
+    while (num > 0) {
+      uint64_t bit = index % 64;
+      uint64_t len = std::min<uint64_t>(num, 64 - bit);
+      bits_[index / 64].fetch_or(mask(bit, len));
+      index += len;
+      num -= len;
+    }
+  }
+
+  // Move read_ over the released buffers at it, clearing their bits
+  void advance() {
+    while (!advancing_.exchange(true)) {
+      uint64_t read = read_.load();
+      uint64_t write = write_.load();
+      while (read < write) {
+        uint64_t index = read % buffer_num_;
+        uint64_t bit = index % 64;
+        uint64_t released = bits_[index / 64].load() >> bit;
+        uint64_t len = ~released == 0 ? 64 : __builtin_ctzll(~released);
+        len = std::min<uint64_t>(len, write - read);
+        if (len == 0) {
+          break;
+        }
+        bits_[index / 64].fetch_and(~mask(bit, len));
+        read += len;
+        read_.store(read);
+      }
+      advancing_.store(false);
+      // buffers released after the last check are left to this thread
+      read = read_.load();
+      uint64_t index = read % buffer_num_;
+      if (read == write_.load() ||
+          !((bits_[index / 64].load() >> (index % 64)) & 1)) {
+        break;
+      }
+    }
+  }
+
+  static uint64_t mask(uint64_t bit, uint64_t len) {
+    return (len == 64 ? ~0ULL : ((1ULL << len) - 1)) << bit;
+  }
+
+  char *buffer_;
+  uint64_t buffer_size_;
+  uint64_t buffer_num_;
+  RmaBufferRegister *rbr_;
+  Chunk *ck_;
+  // released buffers between read_ and write_
+  std::vector<std::atomic<uint64_t>> bits_;
+  alignas(64) std::atomic<uint64_t> read_;
+  alignas(64) std::atomic<uint64_t> write_;
+  std::atomic<bool> advancing_;
+};
+
+#endif  // PMPOOL_BUFFER_LOCKFREECIRCULARBUFFER_H_
@@ -0,0 +1,88 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/client/BlockReader.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool/client
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include "pmpool/client/BlockReader.h"
+
+#include <algorithm>
+
+#include "pmpool/client/PmPoolClient.h"
+
+const int BlockReader::PENDING;
+
+BlockReader::BlockReader(PmPoolClient *client, const vector<block_meta> &bml,
+                         uint64_t window)
+    : client_(client),
+      bml_(bml),
+      window_(std::max<uint64_t>(std::min<uint64_t>(window, bml.size()), 1)) {
+  for (auto &bm : bml_) {
+    slot_size_ = std::max(slot_size_, bm.size);
+  }
+  ring_.reset(new char[std::max<uint64_t>(window_ * slot_size_, 1)]);
+  // reads still go through the network buffers if it can't be registered
+  if (slot_size_ != 0) {
+    registered_ =
+        client_->register_buffer(ring_.get(), window_ * slot_size_) == 0;
+  }
+  results_.assign(window_, PENDING);
+  while (issued_ < bml_.size() && issued_ < window_) {
+    issue(issued_++);
+  }
+}
+
+BlockReader::~BlockReader() {
+  std::unique_lock<std::mutex> lk(mtx_);
+  while (in_flight_ != 0) {
+    cv_.wait(lk);
+  }
+  lk.unlock();
+  if (registered_) {
+    client_->unregister_buffer(ring_.get());
+  }
+}
+
+bool BlockReader::next(const char **data, uint64_t *size) {
+  if (next_ != 0 && issued_ < bml_.size() && status() == 0) {
+    // the slot of the block handed out last is free again
+    issue(issued_++);
+  }
+  std::unique_lock<std::mutex> lk(mtx_);
+  if (next_ == bml_.size() || status_ != 0) {
+    return false;
+  }
+  auto &result = results_[next_ % window_];
+  while (result == PENDING) {
+    cv_.wait(lk);
+  }
+  if (result != 0) {
+    status_ = result;
+    return false;
+  }
+  result = PENDING;
+  *data = slot(next_);
+  *size = bml_[next_].size;
+  next_++;
+  return true;
+}
+
+int BlockReader::status() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return status_;
+}
+
+void BlockReader::issue(uint64_t i) {
+  std::unique_lock<std::mutex> lk(mtx_);
+  in_flight_++;
+  lk.unlock();
+  // without mtx_ held, read may wait for the replies of other requests
+  auto &bm = bml_[i];
+  client_->read(bm.address, slot(i), bm.size, [this, i](int res) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    results_[i % window_] = res;
+    in_flight_--;
+    cv_.notify_all();
+  });
+}
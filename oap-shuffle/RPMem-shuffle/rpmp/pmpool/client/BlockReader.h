@@ -0,0 +1,71 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/client/BlockReader.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool/client
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_CLIENT_BLOCKREADER_H_
+#define PMPOOL_CLIENT_BLOCKREADER_H_
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "../Base.h"
+
+class PmPoolClient;
+
+using std::vector;
+
+/**
+ * @brief Reads the blocks of a block list in order, e.g. as get returns them
+ * for the key of a reduce partition, keeping up to window reads in flight.
+ *
+ * The blocks are read into a ring of window slots, each as large as the
+ * largest block, registered with the client so that the reads go straight
+ * into it. A block is handed out by next once its read and the reads of those
+ * before it are done, and stays valid until the following call of next, which
+ * reuses its slot for the read of the block window places ahead.
+ */
+class BlockReader {
+ public:
+  BlockReader() = delete;
+  BlockReader(PmPoolClient *client, const vector<block_meta> &bml,
+              uint64_t window);
+  /// Waits for the reads in flight
+  ~BlockReader();
+  BlockReader(const BlockReader &) = delete;
+  BlockReader &operator=(const BlockReader &) = delete;
+
+  /// Next block, false once all are read or a read failed
+  bool next(const char **data, uint64_t *size);
+  /// 0 unless a read failed
+  int status();
+
+ private:
+  /// Read block i into its slot, without mtx_ held
+  void issue(uint64_t i);
+  char *slot(uint64_t i) { return ring_.get() + (i % window_) * slot_size_; }
+
+  PmPoolClient *client_;
+  vector<block_meta> bml_;
+  uint64_t window_;
+  uint64_t slot_size_ = 0;
+  std::unique_ptr<char[]> ring_;
+  bool registered_ = false;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  /// result of the read of each slot, PENDING until done
+  static const int PENDING = 1 << 30;
+  vector<int> results_;
+  /// next block handed out and next block read, by the thread of next
+  uint64_t next_ = 0;
+  uint64_t issued_ = 0;
+  uint64_t in_flight_ = 0;
+  int status_ = 0;
+};
+
+#endif  // PMPOOL_CLIENT_BLOCKREADER_H_
@@ -0,0 +1,89 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/client/ConsistentHashRing.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool/client
+ * Created Date: Wednesday, October 14th 2020, 9:12:27 pm
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_CLIENT_CONSISTENTHASHRING_H_
+#define PMPOOL_CLIENT_CONSISTENTHASHRING_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pmpool/Digest.h"
+
+/**
+ * @brief Consistent-hash ring of the servers of a cluster.
+ *
+ * Each server is hashed onto the ring at vnodes points, so that the keys
+ * spread evenly over the servers and adding or removing a server moves only
+ * the keys next to its points.
+ */
+class ConsistentHashRing {
+ public:
+  explicit ConsistentHashRing(uint32_t vnodes = 128) : vnodes_(vnodes) {}
+
+  /// Add the server of index under name, e.g. its address:port
+  void add_server(const string &name, uint32_t index) {
+    if (!servers_.emplace(name, index).second) {
+      return;
+    }
+    for (uint32_t v = 0; v < vnodes_; v++) {
+      uint64_t point;
+      Digest::computeKeyHash(name + "#" + std::to_string(v), &point);
+      ring_.emplace(point, index);
+    }
+  }
+
+  void remove_server(const string &name) {
+    auto it = servers_.find(name);
+    if (it == servers_.end()) {
+      return;
+    }
+    for (uint32_t v = 0; v < vnodes_; v++) {
+      uint64_t point;
+      Digest::computeKeyHash(name + "#" + std::to_string(v), &point);
+      auto p = ring_.find(point);
+      if (p != ring_.end() && p->second == it->second) {
+        ring_.erase(p);
+      }
+    }
+    servers_.erase(it);
+  }
+
+  uint32_t server_num() const { return servers_.size(); }
+
+  /// Up to n distinct servers met clockwise from hash, the primary first
+  std::vector<uint32_t> servers(uint64_t hash, uint32_t n) const {
+    std::vector<uint32_t> res;
+    n = std::min(n, server_num());
+    if (n == 0) {
+      return res;
+    }
+    auto it = ring_.lower_bound(hash);
+    for (size_t i = 0; i < ring_.size() && res.size() < n; i++, it++) {
+      if (it == ring_.end()) {
+        it = ring_.begin();
+      }
+      if (std::find(res.begin(), res.end(), it->second) == res.end()) {
+        res.push_back(it->second);
+      }
+    }
+    return res;
+  }
+
+ private:
+  uint32_t vnodes_;
+  // by point, the index of its server
+  std::map<uint64_t, uint32_t> ring_;
+  // by name, the index of each server
+  std::map<string, uint32_t> servers_;
+};
+
+#endif  // PMPOOL_CLIENT_CONSISTENTHASHRING_H_
@@ -13,88 +13,114 @@
 #include <HPNL/ChunkMgr.h>
 #include <HPNL/Connection.h>
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+
 #include "../Event.h"
-#include "../buffer/CircularBuffer.h"
+#include "../buffer/LockFreeCircularBuffer.h"
 
 uint64_t timestamp_now() {
   return std::chrono::high_resolution_clock::now().time_since_epoch() /
          std::chrono::milliseconds(1);
 }
 
-RequestHandler::RequestHandler(NetworkClient *networkClient)
-    : networkClient_(networkClient) {}
+static uint64_t steady_now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
 
-void RequestHandler::addTask(Request *request) { handleRequest(request); }
+int RetryWorker::entry() {
+  unique_lock<mutex> lk(mtx_);
+  if (pending_.empty()) {
+    cv_.wait_for(lk, std::chrono::milliseconds(1000));
+    return 0;
+  }
+  auto now = steady_now_ns();
+  auto it = pending_.begin();
+  if (it->first > now) {
+    cv_.wait_for(lk, std::chrono::nanoseconds(it->first - now));
+    return 0;
+  }
+  auto request = it->second;
+  pending_.erase(it);
+  lk.unlock();
+  requestHandler_->handleRequest(request);
+  return 0;
+}
 
-void RequestHandler::addTask(Request *request, std::function<void()> func) {
-  callback_map[request->get_rc().rid] = func;
-  handleRequest(request);
+void RetryWorker::addTask(Request *request, uint64_t backoff_us) {
+  unique_lock<mutex> lk(mtx_);
+  pending_.emplace(steady_now_ns() + backoff_us * 1000, request);
+  lk.unlock();
+  cv_.notify_one();
 }
 
-void RequestHandler::wait() {
+const uint64_t RequestHandler::RETRY_MIN_US;
+const uint64_t RequestHandler::RETRY_MAX_US;
+
+RequestHandler::RequestHandler(NetworkClient *networkClient,
+                               uint64_t max_outstanding)
+    : networkClient_(networkClient),
+      max_outstanding_(max_outstanding),
+      requestPool_(max_outstanding),
+      callbacks_(max_outstanding) {
+  retryWorker_ = make_shared<RetryWorker>(this);
+  retryWorker_->start();
+}
+
+RequestHandler::~RequestHandler() {
+  retryWorker_->stop();
+  retryWorker_->join();
+}
+
+void RequestHandler::addTask(RequestContext *rc, ReplyCallback func) {
+  Request *request = requestPool_.get();
+  request->reset(*rc);
+  request->encode();
   unique_lock<mutex> lk(h_mtx);
-  while (!op_finished) {
+  while (callbacks_.size() >= max_outstanding_) {
     cv.wait(lk);
   }
+  // registered before sending, the reply may come before send returns
+  InFlight inFlight;
+  inFlight.func = std::move(func);
+  inFlight.request = request;
+  callbacks_.insert(rc->rid, std::move(inFlight));
+  lk.unlock();
+  handleRequest(request);
 }
 
 void RequestHandler::notify(RequestReply *requestReply) {
+  RequestReplyContext &rrc = requestReply->get_rrc();
   unique_lock<mutex> lk(h_mtx);
-  requestReplyContext = requestReply->get_rrc();
-  op_finished = true;
-  if (callback_map.count(requestReplyContext.rid) != 0) {
-    callback_map[requestReplyContext.rid]();
-    callback_map.erase(requestReplyContext.rid);
-  } else {
-    cv.notify_one();
+  InFlight *found = callbacks_.find(rrc.rid);
+  if (found == nullptr) {
+    return;
+  }
+  if (rrc.success == REPLY_BUSY) {
+    found->backoff_us = found->backoff_us == 0
+                            ? RETRY_MIN_US
+                            : std::min(2 * found->backoff_us, RETRY_MAX_US);
+    auto request = found->request;
+    auto backoff_us = found->backoff_us;
     lk.unlock();
+    retryWorker_->addTask(request, backoff_us);
+    return;
   }
+  InFlight inFlight;
+  callbacks_.take(rrc.rid, &inFlight);
+  lk.unlock();
+  cv.notify_one();
+  inFlight.func(rrc);
+  requestPool_.put(inFlight.request);
 }
 
 void RequestHandler::handleRequest(Request *request) {
-  op_finished = false;
-  OpType rt = request->get_rc().type;
-  switch (rt) {
-    case ALLOC: {
-      request->encode();
-      networkClient_->send(reinterpret_cast<char *>(request->data_),
-                           request->size_);
-      break;
-    }
-    case FREE: {
-      request->encode();
-      networkClient_->send(reinterpret_cast<char *>(request->data_),
-                           request->size_);
-      break;
-    }
-    case WRITE: {
-      request->encode();
-      networkClient_->send(reinterpret_cast<char *>(request->data_),
-                           request->size_);
-      break;
-    }
-    case READ: {
-      request->encode();
-      networkClient_->send(reinterpret_cast<char *>(request->data_),
-                           request->size_);
-      break;
-    }
-    case PUT: {
-      request->encode();
-      networkClient_->send(reinterpret_cast<char *>(request->data_),
-                           request->size_);
-    }
-    case GET_META: {
-      request->encode();
-      networkClient_->send(reinterpret_cast<char *>(request->data_),
-                           request->size_);
-    }
-    default: {}
-  }
+  networkClient_->send(reinterpret_cast<char *>(request->data_),
+                       request->size_);
 }
 
-RequestReplyContext &RequestHandler::get() { return requestReplyContext; }
-
 ClientConnectedCallback::ClientConnectedCallback(NetworkClient *networkClient) {
   networkClient_ = networkClient;
 }
@@ -105,8 +131,11 @@ void ClientConnectedCallback::operator()(void *param_1, void *param_2) {
 }
 
 ClientRecvCallback::ClientRecvCallback(ChunkMgr *chunkMgr,
-                                       RequestHandler *requestHandler)
-    : chunkMgr_(chunkMgr), requestHandler_(requestHandler) {}
+                                       RequestHandler *requestHandler,
+                                       int worker_num)
+    : chunkMgr_(chunkMgr),
+      requestHandler_(requestHandler),
+      replyPool_(worker_num) {}
 
 void ClientRecvCallback::operator()(void *param_1, void *param_2) {
   int mid = *static_cast<int *>(param_1);
@@ -136,32 +165,22 @@ void ClientRecvCallback::operator()(void *param_1, void *param_2) {
   // con->send(new_ck);
   // test end
 
-  RequestReply requestReply(reinterpret_cast<char *>(ck->buffer), ck->size,
-                            reinterpret_cast<Connection *>(ck->con));
-  requestReply.decode();
-  RequestReplyContext rrc = requestReply.get_rrc();
-  switch (rrc.type) {
-    case ALLOC_REPLY: {
-      requestHandler_->notify(&requestReply);
-      break;
-    }
-    case FREE_REPLY: {
-      requestHandler_->notify(&requestReply);
-      break;
-    }
-    case WRITE_REPLY: {
-      requestHandler_->notify(&requestReply);
-      break;
-    }
-    case READ_REPLY: {
-      requestHandler_->notify(&requestReply);
-      break;
-    }
-    default: {}
+  RequestReply *requestReply = replyPool_.get();
+  requestReply->reset(reinterpret_cast<char *>(ck->buffer), ck->size,
+                      reinterpret_cast<Connection *>(ck->con));
+  requestReply->decode();
+  if (requestReply->get_rrc().type & REPLY) {
+    requestHandler_->notify(requestReply);
   }
+  replyPool_.put(requestReply);
   chunkMgr_->reclaim(ck, static_cast<Connection *>(ck->con));
 }
 
+void ClientReadCallback::operator()(void *param_1, void *param_2) {
+  int buffer_id = *static_cast<int *>(param_1);
+  networkClient_->rma_read_done(buffer_id);
+}
+
 NetworkClient::NetworkClient(const string &remote_address,
                              const string &remote_port)
     : NetworkClient(remote_address, remote_port, 1, 32, 65536, 64) {}
@@ -183,6 +202,7 @@ NetworkClient::~NetworkClient() {
   delete connectedCallback;
   delete sendCallback;
   delete recvCallback;
+  delete readCallback;
 }
 
 int NetworkClient::init(RequestHandler *requestHandler) {
@@ -196,13 +216,16 @@ int NetworkClient::init(RequestHandler *requestHandler) {
 
   shutdownCallback = new ClientShutdownCallback();
   connectedCallback = new ClientConnectedCallback(this);
-  recvCallback = new ClientRecvCallback(chunkMgr_, requestHandler);
+  recvCallback =
+      new ClientRecvCallback(chunkMgr_, requestHandler, worker_num_);
   sendCallback = new ClientSendCallback(chunkMgr_);
+  readCallback = new ClientReadCallback(this);
 
   client_->set_shutdown_callback(shutdownCallback);
   client_->set_connected_callback(connectedCallback);
   client_->set_recv_callback(recvCallback);
   client_->set_send_callback(sendCallback);
+  client_->set_read_callback(readCallback);
 
   client_->start();
   int res = client_->connect(remote_address_.c_str(), remote_port_.c_str());
@@ -211,7 +234,9 @@ int NetworkClient::init(RequestHandler *requestHandler) {
     con_v.wait(lk);
   }
 
-  circularBuffer_ = make_shared<CircularBuffer>(1024 * 1024, 512, false, this);
+  circularBuffer_ =
+      make_shared<LockFreeCircularBuffer>(1024 * 1024, 512, false, this);
+  return 0;
 }
 
 void NetworkClient::shutdown() { client_->shutdown(); }
@@ -242,6 +267,97 @@ uint64_t NetworkClient::get_rkey() {
   return circularBuffer_->get_rma_chunk()->mr->key;
 }
 
+int NetworkClient::register_user_buffer(char *data, uint64_t size) {
+  std::lock_guard<mutex> lk(user_mtx);
+  auto it = user_buffers_.find(reinterpret_cast<uint64_t>(data));
+  if (it != user_buffers_.end()) {
+    if (it->second.first >= size) {
+      return 0;
+    }
+    unregister_rma_buffer(it->second.second->buffer_id);
+    user_buffers_.erase(it);
+  }
+  Chunk *ck = register_rma_buffer(data, size);
+  if (ck == nullptr) {
+    return -1;
+  }
+  user_buffers_[reinterpret_cast<uint64_t>(data)] = std::make_pair(size, ck);
+  return 0;
+}
+
+void NetworkClient::unregister_user_buffer(char *data) {
+  std::lock_guard<mutex> lk(user_mtx);
+  auto it = user_buffers_.find(reinterpret_cast<uint64_t>(data));
+  if (it != user_buffers_.end()) {
+    unregister_rma_buffer(it->second.second->buffer_id);
+    user_buffers_.erase(it);
+  }
+}
+
+Chunk *NetworkClient::find_user_buffer(uint64_t address, uint64_t size) {
+  std::lock_guard<mutex> lk(user_mtx);
+  auto it = user_buffers_.upper_bound(address);
+  if (it == user_buffers_.begin()) {
+    return nullptr;
+  }
+  --it;
+  if (address + size > it->first + it->second.first) {
+    return nullptr;
+  }
+  return it->second.second;
+}
+
+uint64_t NetworkClient::get_buffer(const char *data, uint64_t size, bool copy,
+                                   uint64_t *rkey) {
+  Chunk *ck = find_user_buffer(reinterpret_cast<uint64_t>(data), size);
+  if (ck != nullptr) {
+    *rkey = ck->mr->key;
+    return reinterpret_cast<uint64_t>(data);
+  }
+  *rkey = get_rkey();
+  return get_dram_buffer(copy ? data : nullptr, size);
+}
+
+void NetworkClient::reclaim_buffer(uint64_t address, const char *data,
+                                   uint64_t size) {
+  if (address != reinterpret_cast<uint64_t>(data)) {
+    reclaim_dram_buffer(address, size);
+  }
+}
+
+void NetworkClient::rma_read(uint64_t dest, uint64_t size,
+                             uint64_t remote_address, uint64_t rkey,
+                             std::function<void()> func) {
+  Chunk *base_ck = find_user_buffer(dest, size);
+  if (base_ck == nullptr) {
+    base_ck = circularBuffer_->get_rma_chunk();
+  }
+  // encapsulate new chunk
+  Chunk *ck = new Chunk();
+  ck->buffer = reinterpret_cast<char *>(dest);
+  ck->capacity = base_ck->capacity;
+  ck->buffer_id = buffer_id_++;
+  ck->mr = base_ck->mr;
+  ck->size = size;
+  unique_lock<mutex> lk(rma_mtx);
+  rma_reads_[ck->buffer_id] = std::make_pair(ck, std::move(func));
+  lk.unlock();
+  con_->read(ck, 0, size, remote_address, rkey);
+}
+
+void NetworkClient::rma_read_done(int buffer_id) {
+  unique_lock<mutex> lk(rma_mtx);
+  auto it = rma_reads_.find(buffer_id);
+  if (it == rma_reads_.end()) {
+    return;
+  }
+  auto rma_read = std::move(it->second);
+  rma_reads_.erase(it);
+  lk.unlock();
+  delete rma_read.first;
+  rma_read.second();
+}
+
 void NetworkClient::connected(Connection *con) {
   std::unique_lock<std::mutex> lk(con_mtx);
   con_ = con;
@@ -16,14 +16,19 @@
 #include <atomic>
 #include <condition_variable>  // NOLINT
 #include <cstring>
+#include <functional>
 #include <future>  // NOLINT
+#include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
 #include <utility>
 
 #include "../Event.h"
+#include "../ObjectPool.h"
 #include "../RmaBufferRegister.h"
+#include "../SlotTable.h"
 #include "../ThreadWrapper.h"
 #include "../queue/blockingconcurrentqueue.h"
 #include "../queue/concurrentqueue.h"
@@ -41,38 +46,78 @@ using std::unique_lock;
 using std::unordered_map;
 
 class NetworkClient;
-class CircularBuffer;
+class LockFreeCircularBuffer;
 class Connection;
 class ChunkMgr;
 
 typedef promise<RequestReplyContext> Promise;
 typedef future<RequestReplyContext> Future;
 
+/// Called with the reply of a request, on the network thread receiving it
+typedef std::function<void(const RequestReplyContext &)> ReplyCallback;
+
+/// Sends again the requests refused busy by the server, once backed off
+class RetryWorker : public ThreadWrapper {
+ public:
+  explicit RetryWorker(RequestHandler *requestHandler)
+      : requestHandler_(requestHandler) {}
+  ~RetryWorker() override = default;
+  int entry() override;
+  void abort() override {}
+  /// Send request again in backoff_us
+  void addTask(Request *request, uint64_t backoff_us);
+
+ private:
+  RequestHandler *requestHandler_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  /// requests by the steady clock time to send them at, in ns
+  std::multimap<uint64_t, Request *> pending_;
+};
+
+/**
+ * @brief Sends the requests of one connection and hands each reply to the
+ * callback of its request, by rid. Requests don't wait for each other: up to
+ * max_outstanding of them are in flight at once, their replies come in any
+ * order. Callbacks must not block, nor issue requests waiting for replies.
+ *
+ * A request refused busy by an overloaded server stays in flight and is sent
+ * again after a backoff doubling from RETRY_MIN_US up to RETRY_MAX_US, so
+ * that the overload holds back the requests of the connection.
+ */
 class RequestHandler {
  public:
-  explicit RequestHandler(NetworkClient *networkClient);
-  ~RequestHandler() = default;
-  void addTask(Request *request);
-  void addTask(Request *request, std::function<void()> func);
+  static const uint64_t RETRY_MIN_US = 100;
+  static const uint64_t RETRY_MAX_US = 100 * 1000;
+
+  explicit RequestHandler(NetworkClient *networkClient,
+                          uint64_t max_outstanding = 32);
+  ~RequestHandler();
+  /// Send the request of rc, waiting only while max_outstanding requests are
+  /// in flight.
+  void addTask(RequestContext *rc, ReplyCallback func);
   void notify(RequestReply *requestReply);
-  void wait();
-  RequestReplyContext &get();
 
  private:
+  friend RetryWorker;
+  /// A request in flight, kept encoded until its reply to send it again
+  struct InFlight {
+    ReplyCallback func;
+    Request *request = nullptr;
+    uint64_t backoff_us = 0;
+  };
   void handleRequest(Request *request);
 
  private:
   NetworkClient *networkClient_;
-  BlockingConcurrentQueue<Request *> pendingRequestQueue_;
+  const uint64_t max_outstanding_;
+  /// requests in flight, reused across requests
+  ObjectPool<Request> requestPool_;
   std::mutex h_mtx;
-  unordered_map<uint64_t, std::function<void()>> callback_map;
-  uint64_t total_num = 0;
-  uint64_t begin = 0;
-  uint64_t end = 0;
-  uint64_t time = 0;
-  bool op_finished = false;
+  // by rid, the requests in flight, in max_outstanding slots
+  SlotTable<InFlight> callbacks_;
   std::condition_variable cv;
-  RequestReplyContext requestReplyContext;
+  std::shared_ptr<RetryWorker> retryWorker_;
 };
 
 class ClientShutdownCallback : public Callback {
@@ -94,13 +139,16 @@ class ClientConnectedCallback : public Callback {
 
 class ClientRecvCallback : public Callback {
  public:
-  ClientRecvCallback(ChunkMgr *chunkMgr, RequestHandler *requestHandler);
+  ClientRecvCallback(ChunkMgr *chunkMgr, RequestHandler *requestHandler,
+                     int worker_num);
   ~ClientRecvCallback() = default;
   void operator()(void *param_1, void *param_2);
 
  private:
   ChunkMgr *chunkMgr_;
   RequestHandler *requestHandler_;
+  /// replies decoded, one per network thread at a time
+  ObjectPool<RequestReply> replyPool_;
   uint64_t count_ = 0;
   uint64_t time = 0;
   uint64_t start = 0;
@@ -108,6 +156,18 @@ class ClientRecvCallback : public Callback {
   std::mutex mtx;
 };
 
+/// Completion of a one-sided RDMA read of the client
+class ClientReadCallback : public Callback {
+ public:
+  explicit ClientReadCallback(NetworkClient *networkClient)
+      : networkClient_(networkClient) {}
+  ~ClientReadCallback() = default;
+  void operator()(void *param_1, void *param_2);
+
+ private:
+  NetworkClient *networkClient_;
+};
+
 class ClientSendCallback : public Callback {
  public:
   explicit ClientSendCallback(ChunkMgr *chunkMgr) : chunkMgr_(chunkMgr) {}
@@ -139,9 +199,28 @@ class NetworkClient : public RmaBufferRegister {
   uint64_t get_dram_buffer(const char *data, uint64_t size);
   void reclaim_dram_buffer(uint64_t src_address, uint64_t size);
   uint64_t get_rkey();
+  /// Register the user buffer data of size for RDMA, e.g. a direct ByteBuffer.
+  /// Registering a buffer again is a no-op. Return 0 if succeed.
+  int register_user_buffer(char *data, uint64_t size);
+  void unregister_user_buffer(char *data);
+  /// Registered user buffer holding [address, address + size), nullptr if
+  /// none
+  Chunk *find_user_buffer(uint64_t address, uint64_t size);
+  /// Address and rkey to transfer size bytes of data from or to with RDMA:
+  /// data itself if it lies in a registered user buffer, else a DRAM buffer,
+  /// filled with data if copy
+  uint64_t get_buffer(const char *data, uint64_t size, bool copy,
+                      uint64_t *rkey);
+  /// Reclaim address returned by get_buffer for data
+  void reclaim_buffer(uint64_t address, const char *data, uint64_t size);
   void connected(Connection *con);
   void send(char *data, uint64_t size);
   void read(Request *request);
+  /// Read size bytes at remote_address of the remote region of rkey into the
+  /// DRAM buffer at dest with a one-sided RDMA read, calling func once done
+  void rma_read(uint64_t dest, uint64_t size, uint64_t remote_address,
+                uint64_t rkey, std::function<void()> func);
+  void rma_read_done(int buffer_id);
 
  private:
   string remote_address_;
@@ -157,11 +236,19 @@ class NetworkClient : public RmaBufferRegister {
   ClientConnectedCallback *connectedCallback;
   ClientRecvCallback *recvCallback;
   ClientSendCallback *sendCallback;
+  ClientReadCallback *readCallback;
   mutex con_mtx;
   bool connected_;
   condition_variable con_v;
-  shared_ptr<CircularBuffer> circularBuffer_;
+  shared_ptr<LockFreeCircularBuffer> circularBuffer_;
   atomic<uint64_t> buffer_id_{0};
+  mutex rma_mtx;
+  /// chunks and callbacks of the RDMA reads in flight, by buffer id
+  unordered_map<int, std::pair<Chunk *, std::function<void()>>> rma_reads_;
+  mutex user_mtx;
+  /// registration cache of the user buffers, their sizes and chunks by start
+  /// address
+  std::map<uint64_t, std::pair<uint64_t, Chunk *>> user_buffers_;
 };
 
 #endif  // PMPOOL_CLIENT_NETWORKCLIENT_H_
@@ -13,18 +13,36 @@
 #include "pmpool/Digest.h"
 #include "pmpool/Event.h"
 #include "pmpool/Protocol.h"
+#include "pmpool/Stats.h"
 
 PmPoolClient::PmPoolClient(const string &remote_address,
-                           const string &remote_port) {
+                           const string &remote_port)
+    : PmPoolClient(remote_address, remote_port, 1) {}
+
+PmPoolClient::PmPoolClient(const string &remote_address,
+                           const string &remote_port, int connection_num,
+                           uint64_t max_outstanding) {
   tx_finished = true;
   op_finished = false;
-  networkClient_ = make_shared<NetworkClient>(remote_address, remote_port);
-  requestHandler_ = make_shared<RequestHandler>(networkClient_.get());
+  for (int i = 0; i < connection_num; i++) {
+    auto networkClient =
+        make_shared<NetworkClient>(remote_address, remote_port);
+    requestHandlers_.push_back(
+        make_shared<RequestHandler>(networkClient.get(), max_outstanding));
+    networkClients_.push_back(networkClient);
+  }
 }
 
 PmPoolClient::~PmPoolClient() {}
 
-int PmPoolClient::init() { networkClient_->init(requestHandler_.get()); }
+int PmPoolClient::init() {
+  for (size_t i = 0; i < networkClients_.size(); i++) {
+    if (networkClients_[i]->init(requestHandlers_[i].get()) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
 
 void PmPoolClient::begin_tx() {
   std::unique_lock<std::mutex> lk(tx_mtx);
@@ -34,108 +52,420 @@ void PmPoolClient::begin_tx() {
   tx_finished;
 }
 
+uint64_t PmPoolClient::next_connection() {
+  return next_connection_++ % networkClients_.size();
+}
+
+void PmPoolClient::send(uint64_t c, RequestContext *rc,
+                        std::function<void(const RequestReplyContext &)> func) {
+  requestHandlers_[c]->addTask(rc, std::move(func));
+}
+
 uint64_t PmPoolClient::alloc(uint64_t size) {
+  return wait_for<uint64_t>(
+      [&](std::function<void(uint64_t)> func) { alloc(size, func); });
+}
+
+void PmPoolClient::alloc(uint64_t size, std::function<void(uint64_t)> func) {
   RequestContext rc = {};
   rc.type = ALLOC;
   rc.rid = rid_++;
   rc.size = size;
-  Request request(rc);
-  requestHandler_->addTask(&request);
-  requestHandler_->wait();
-  return requestHandler_->get().address;
+  send(next_connection(), &rc,
+       [func](const RequestReplyContext &rrc) { func(rrc.address); });
 }
 
 int PmPoolClient::free(uint64_t address) {
+  return wait_for<int>(
+      [&](std::function<void(int)> func) { free(address, func); });
+}
+
+void PmPoolClient::free(uint64_t address, std::function<void(int)> func) {
   RequestContext rc = {};
   rc.type = FREE;
   rc.rid = rid_++;
   rc.address = address;
-  Request request(rc);
-  requestHandler_->addTask(&request);
-  requestHandler_->wait();
-  return requestHandler_->get().success;
+  send(next_connection(), &rc,
+       [func](const RequestReplyContext &rrc) { func(rrc.success); });
 }
 
-void PmPoolClient::shutdown() { networkClient_->shutdown(); }
+void PmPoolClient::shutdown() {
+  for (auto &networkClient : networkClients_) {
+    networkClient->shutdown();
+  }
+}
 
-void PmPoolClient::wait() { networkClient_->wait(); }
+void PmPoolClient::wait() {
+  for (auto &networkClient : networkClients_) {
+    networkClient->wait();
+  }
+}
 
 int PmPoolClient::write(uint64_t address, const char *data, uint64_t size) {
+  return wait_for<int>([&](std::function<void(int)> func) {
+    write(address, data, size, func);
+  });
+}
+
+void PmPoolClient::write(uint64_t address, const char *data, uint64_t size,
+                         std::function<void(int)> func) {
+  auto c = next_connection();
+  auto networkClient = networkClients_[c];
   RequestContext rc = {};
   rc.type = WRITE;
   rc.rid = rid_++;
   rc.size = size;
   rc.address = address;
   // allocate memory for RMA read from client.
-  rc.src_address = networkClient_->get_dram_buffer(data, rc.size);
-  rc.src_rkey = networkClient_->get_rkey();
-  Request request(rc);
-  requestHandler_->addTask(&request);
-  requestHandler_->wait();
-  auto res = requestHandler_->get().success;
-  networkClient_->reclaim_dram_buffer(rc.src_address, rc.size);
-  return res;
+  rc.src_address =
+      networkClient->get_buffer(data, rc.size, true, &rc.src_rkey);
+  auto src_address = rc.src_address;
+  send(c, &rc, [networkClient, src_address, data, size,
+                func](const RequestReplyContext &rrc) {
+    networkClient->reclaim_buffer(src_address, data, size);
+    func(rrc.success);
+  });
 }
 
 uint64_t PmPoolClient::write(const char *data, uint64_t size) {
+  return wait_for<uint64_t>(
+      [&](std::function<void(uint64_t)> func) { write(data, size, func); });
+}
+
+void PmPoolClient::write(const char *data, uint64_t size,
+                         std::function<void(uint64_t)> func) {
+  auto c = next_connection();
+  auto networkClient = networkClients_[c];
   RequestContext rc = {};
   rc.type = WRITE;
   rc.rid = rid_++;
   rc.size = size;
   rc.address = 0;
   // allocate memory for RMA read from client.
-  rc.src_address = networkClient_->get_dram_buffer(data, rc.size);
-  rc.src_rkey = networkClient_->get_rkey();
-  Request request(rc);
-  requestHandler_->addTask(&request);
-  requestHandler_->wait();
-  auto res = requestHandler_->get().address;
-  networkClient_->reclaim_dram_buffer(rc.src_address, rc.size);
-  return res;
+  rc.src_address =
+      networkClient->get_buffer(data, rc.size, true, &rc.src_rkey);
+  auto src_address = rc.src_address;
+  send(c, &rc, [networkClient, src_address, data, size,
+                func](const RequestReplyContext &rrc) {
+    networkClient->reclaim_buffer(src_address, data, size);
+    func(rrc.address);
+  });
 }
 
 int PmPoolClient::read(uint64_t address, char *data, uint64_t size) {
-  RequestContext rc = {};
-  rc.type = READ;
-  rc.rid = rid_++;
-  rc.size = size;
-  rc.address = address;
-  // allocate memory for RMA read from client.
-  rc.src_address = networkClient_->get_dram_buffer(nullptr, rc.size);
-  rc.src_rkey = networkClient_->get_rkey();
-  Request request(rc);
-  requestHandler_->addTask(&request);
-  requestHandler_->wait();
-  auto res = requestHandler_->get().success;
-  if (!res) {
-    memcpy(data, reinterpret_cast<char *>(rc.src_address), size);
-  }
-  networkClient_->reclaim_dram_buffer(rc.src_address, rc.size);
-  return res;
+  return wait_for<int>([&](std::function<void(int)> func) {
+    read(address, data, size, func);
+  });
 }
 
 int PmPoolClient::read(uint64_t address, char *data, uint64_t size,
                        std::function<void(int)> func) {
+  auto c = next_connection();
+  auto networkClient = networkClients_[c];
+  uint64_t wid = GET_WID(address);
+  if (one_sided_ && wid < rma_regions_.size() && size != 0) {
+    // read the block straight from the registered region of its pool
+    uint64_t rkey;
+    auto src_address = networkClient->get_buffer(data, size, false, &rkey);
+    uint64_t remote_address =
+        rma_regions_[wid].address + (address & ((1ULL << 48) - 1));
+    networkClient->rma_read(
+        src_address, size, remote_address, rma_regions_[wid].size,
+        [networkClient, src_address, data, size, func]() {
+          if (src_address != reinterpret_cast<uint64_t>(data)) {
+            memcpy(data, reinterpret_cast<char *>(src_address), size);
+          }
+          networkClient->reclaim_buffer(src_address, data, size);
+          func(0);
+        });
+    return 0;
+  }
   RequestContext rc = {};
   rc.type = READ;
   rc.rid = rid_++;
   rc.size = size;
   rc.address = address;
   // allocate memory for RMA read from client.
-  rc.src_address = networkClient_->get_dram_buffer(nullptr, rc.size);
-  rc.src_rkey = networkClient_->get_rkey();
-  Request request(rc);
-  requestHandler_->addTask(&request, [&] {
-    auto res = requestHandler_->get().success;
-    if (res) {
-      memcpy(data, reinterpret_cast<char *>(rc.src_address), size);
+  rc.src_address =
+      networkClient->get_buffer(data, rc.size, false, &rc.src_rkey);
+  auto src_address = rc.src_address;
+  send(c, &rc, [networkClient, src_address, data, size,
+                func](const RequestReplyContext &rrc) {
+    auto res = rrc.success;
+    if (!res && src_address != reinterpret_cast<uint64_t>(data)) {
+      memcpy(data, reinterpret_cast<char *>(src_address), size);
     }
-    networkClient_->reclaim_dram_buffer(rc.src_address, rc.size);
+    networkClient->reclaim_buffer(src_address, data, size);
     func(res);
   });
   return 0;
 }
 
+int PmPoolClient::read(const vector<block_meta> &bml, char *data) {
+  return wait_for<int>(
+      [&](std::function<void(int)> func) { read(bml, data, func); });
+}
+
+void PmPoolClient::read(const vector<block_meta> &bml, char *data,
+                        std::function<void(int)> func) {
+  // blocks next to each other in a pool but for the alignment of the appended
+  // blocks, read at once
+  struct Run {
+    uint64_t address;
+    uint64_t size;
+    char *data;
+    /// offset in the run and size of each block
+    vector<std::pair<uint64_t, uint64_t>> blocks;
+  };
+  auto runs = make_shared<vector<Run>>();
+  for (auto &bm : bml) {
+    if (!runs->empty()) {
+      auto &run = runs->back();
+      uint64_t end = run.address + run.size;
+      uint64_t aligned_end = (end + PMEM_EXTENT_ALIGN - 1) / PMEM_EXTENT_ALIGN *
+                             PMEM_EXTENT_ALIGN;
+      if (bm.address >= end && bm.address <= aligned_end &&
+          GET_WID(bm.address) == GET_WID(run.address)) {
+        run.blocks.emplace_back(bm.address - run.address, bm.size);
+        run.size = bm.address + bm.size - run.address;
+        data += bm.size;
+        continue;
+      }
+    }
+    runs->push_back({bm.address, bm.size, data, {{0, bm.size}}});
+    data += bm.size;
+  }
+  if (runs->empty()) {
+    func(0);
+    return;
+  }
+
+  struct State {
+    atomic<uint64_t> remaining;
+    atomic<int> res = {0};
+  };
+  auto state = make_shared<State>();
+  state->remaining = runs->size();
+  for (auto &run : *runs) {
+    uint64_t size = 0;
+    for (auto &block : run.blocks) {
+      size += block.second;
+    }
+    // a run with gaps is read into scratch, then its blocks copied to data
+    shared_ptr<vector<char>> scratch;
+    if (size != run.size) {
+      scratch = make_shared<vector<char>>(run.size);
+    }
+    auto *r = &run;
+    read(run.address, scratch ? scratch->data() : run.data, run.size,
+         [runs, r, scratch, state, func](int res) {
+           if (res) {
+             state->res = res;
+           } else if (scratch) {
+             auto dest = r->data;
+             for (auto &block : r->blocks) {
+               memcpy(dest, scratch->data() + block.first, block.second);
+               dest += block.second;
+             }
+           }
+           if (--state->remaining == 0) {
+             func(state->res);
+           }
+         });
+  }
+}
+
+std::unique_ptr<BlockReader> PmPoolClient::read_ahead(
+    const vector<block_meta> &bml, uint64_t window) {
+  return std::unique_ptr<BlockReader>(new BlockReader(this, bml, window));
+}
+
+vector<uint64_t> PmPoolClient::alloc(const vector<uint64_t> &sizes) {
+  return wait_for<vector<uint64_t>>(
+      [&](std::function<void(vector<uint64_t>)> func) { alloc(sizes, func); });
+}
+
+void PmPoolClient::alloc(const vector<uint64_t> &sizes,
+                         std::function<void(vector<uint64_t>)> func) {
+  if (sizes.empty() || sizes.size() > MAX_BATCH_NUM) {
+    func({});
+    return;
+  }
+  RequestContext rc = {};
+  rc.type = ALLOC_BATCH;
+  rc.rid = rid_++;
+  for (auto size : sizes) {
+    rc.bml.push_back(block_meta(0, size));
+  }
+  send(next_connection(), &rc, [func](const RequestReplyContext &rrc) {
+    vector<uint64_t> addresses;
+    for (auto &bm : rrc.bml) {
+      addresses.push_back(bm.address);
+    }
+    func(addresses);
+  });
+}
+
+int PmPoolClient::free(const vector<uint64_t> &addresses) {
+  return wait_for<int>(
+      [&](std::function<void(int)> func) { free(addresses, func); });
+}
+
+void PmPoolClient::free(const vector<uint64_t> &addresses,
+                        std::function<void(int)> func) {
+  if (addresses.empty() || addresses.size() > MAX_BATCH_NUM) {
+    func(-1);
+    return;
+  }
+  RequestContext rc = {};
+  rc.type = FREE_BATCH;
+  rc.rid = rid_++;
+  for (auto address : addresses) {
+    rc.bml.push_back(block_meta(address, 0));
+  }
+  send(next_connection(), &rc,
+       [func](const RequestReplyContext &rrc) { func(rrc.success); });
+}
+
+vector<uint64_t> PmPoolClient::write(const vector<const char *> &data,
+                                     const vector<uint64_t> &sizes) {
+  return wait_for<vector<uint64_t>>(
+      [&](std::function<void(vector<uint64_t>)> func) {
+        write(data, sizes, func);
+      });
+}
+
+void PmPoolClient::write(const vector<const char *> &data,
+                         const vector<uint64_t> &sizes,
+                         std::function<void(vector<uint64_t>)> func) {
+  RequestContext rc = {};
+  rc.type = WRITE_BATCH;
+  for (auto size : sizes) {
+    rc.bml.push_back(block_meta(0, size));
+  }
+  write_batch(&rc, data, func);
+}
+
+void PmPoolClient::write_batch(RequestContext *rc,
+                               const vector<const char *> &data,
+                               std::function<void(vector<uint64_t>)> func) {
+  if (rc->bml.empty() || rc->bml.size() > MAX_BATCH_NUM ||
+      rc->bml.size() != data.size()) {
+    func({});
+    return;
+  }
+  rc->rid = rid_++;
+  rc->address = 0;
+  rc->size = 0;
+  for (auto &bm : rc->bml) {
+    rc->size += bm.size;
+  }
+  auto c = next_connection();
+  auto networkClient = networkClients_[c];
+  // allocate memory for RMA read from client, the blocks one after the other.
+  rc->src_address = networkClient->get_dram_buffer(nullptr, rc->size);
+  rc->src_rkey = networkClient->get_rkey();
+  auto dest = reinterpret_cast<char *>(rc->src_address);
+  for (size_t i = 0; i < data.size(); i++) {
+    memcpy(dest, data[i], rc->bml[i].size);
+    dest += rc->bml[i].size;
+  }
+  auto src_address = rc->src_address;
+  auto size = rc->size;
+  send(c, rc, [networkClient, src_address, size,
+               func](const RequestReplyContext &rrc) {
+    networkClient->reclaim_dram_buffer(src_address, size);
+    vector<uint64_t> addresses;
+    for (auto &bm : rrc.bml) {
+      addresses.push_back(bm.address);
+    }
+    func(addresses);
+  });
+}
+
+vector<uint64_t> PmPoolClient::append(uint64_t shuffle,
+                                      const vector<const char *> &data,
+                                      const vector<uint64_t> &sizes) {
+  return wait_for<vector<uint64_t>>(
+      [&](std::function<void(vector<uint64_t>)> func) {
+        append(shuffle, data, sizes, func);
+      });
+}
+
+void PmPoolClient::append(uint64_t shuffle, const vector<const char *> &data,
+                          const vector<uint64_t> &sizes,
+                          std::function<void(vector<uint64_t>)> func) {
+  RequestContext rc = {};
+  rc.type = APPEND_BATCH;
+  rc.key = shuffle;
+  for (auto size : sizes) {
+    rc.bml.push_back(block_meta(0, size));
+  }
+  write_batch(&rc, data, func);
+}
+
+int PmPoolClient::release_shuffle(uint64_t shuffle) {
+  return wait_for<int>([&](std::function<void(int)> func) {
+    release_shuffle(shuffle, func);
+  });
+}
+
+void PmPoolClient::release_shuffle(uint64_t shuffle,
+                                   std::function<void(int)> func) {
+  RequestContext rc = {};
+  rc.type = RELEASE_SHUFFLE;
+  rc.rid = rid_++;
+  rc.key = shuffle;
+  send(next_connection(), &rc,
+       [func](const RequestReplyContext &rrc) { func(rrc.success); });
+}
+
+int PmPoolClient::register_buffer(char *data, uint64_t size) {
+  for (auto &networkClient : networkClients_) {
+    if (networkClient->register_user_buffer(data, size) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void PmPoolClient::unregister_buffer(char *data) {
+  for (auto &networkClient : networkClients_) {
+    networkClient->unregister_user_buffer(data);
+  }
+}
+
+int PmPoolClient::enable_one_sided_read() {
+  RequestContext rc = {};
+  rc.type = GET_RMA_INFO;
+  rc.rid = rid_++;
+  auto regions = wait_for<vector<block_meta>>(
+      [&](std::function<void(vector<block_meta>)> func) {
+        send(next_connection(), &rc,
+             [func](const RequestReplyContext &rrc) { func(rrc.bml); });
+      });
+  if (regions.empty()) {
+    return -1;
+  }
+  if (!one_sided_) {
+    rma_regions_ = std::move(regions);
+    one_sided_ = true;
+  }
+  return 0;
+}
+
+int PmPoolClient::get_stats(StatsSnapshot *stats) {
+  RequestContext rc = {};
+  rc.type = GET_STATS;
+  rc.rid = rid_++;
+  auto bml = wait_for<vector<block_meta>>(
+      [&](std::function<void(vector<block_meta>)> func) {
+        send(next_connection(), &rc,
+             [func](const RequestReplyContext &rrc) { func(rrc.bml); });
+      });
+  return stats->decode(bml);
+}
+
 void PmPoolClient::end_tx() {
   std::lock_guard<std::mutex> lk(tx_mtx);
   tx_finished = true;
@@ -144,50 +474,191 @@ void PmPoolClient::end_tx() {
 
 uint64_t PmPoolClient::put(const string &key, const char *value,
                            uint64_t size) {
+  return wait_for<uint64_t>([&](std::function<void(uint64_t)> func) {
+    put(key, value, size, func);
+  });
+}
+
+void PmPoolClient::put(const string &key, const char *value, uint64_t size,
+                       std::function<void(uint64_t)> func) {
   uint64_t key_uint;
   Digest::computeKeyHash(key, &key_uint);
+  if (one_sided_) {
+    std::lock_guard<std::mutex> lk(meta_mtx_);
+    meta_cache_.erase(key_uint);
+  }
+  auto c = next_connection();
+  auto networkClient = networkClients_[c];
   RequestContext rc = {};
   rc.type = PUT;
   rc.rid = rid_++;
   rc.size = size;
   rc.address = 0;
   // allocate memory for RMA read from client.
-  rc.src_address = networkClient_->get_dram_buffer(value, rc.size);
-  rc.src_rkey = networkClient_->get_rkey();
+  rc.src_address =
+      networkClient->get_buffer(value, rc.size, true, &rc.src_rkey);
   rc.key = key_uint;
-  Request request(rc);
-  requestHandler_->addTask(&request);
-  requestHandler_->wait();
-  auto address = requestHandler_->get().address;
-  networkClient_->reclaim_dram_buffer(rc.src_address, rc.size);
-  return address;
+  auto src_address = rc.src_address;
+  send(c, &rc, [networkClient, src_address, value, size,
+                func](const RequestReplyContext &rrc) {
+    networkClient->reclaim_buffer(src_address, value, size);
+    func(rrc.address);
+  });
 }
 
 vector<block_meta> PmPoolClient::get(const string &key) {
+  return wait_for<vector<block_meta>>(
+      [&](std::function<void(vector<block_meta>)> func) { get(key, func); });
+}
+
+void PmPoolClient::get(const string &key,
+                       std::function<void(vector<block_meta>)> func) {
   uint64_t key_uint;
   Digest::computeKeyHash(key, &key_uint);
   RequestContext rc = {};
+  if (one_sided_) {
+    std::unique_lock<std::mutex> lk(meta_mtx_);
+    auto it = meta_cache_.find(key_uint);
+    if (it != meta_cache_.end()) {
+      auto bml = it->second;
+      lk.unlock();
+      func(bml);
+      return;
+    }
+  }
   rc.type = GET_META;
   rc.rid = rid_++;
   rc.address = 0;
   rc.key = key_uint;
-  Request request(rc);
-  requestHandler_->addTask(&request);
-  requestHandler_->wait();
-  auto bml = requestHandler_->get().bml;
-  return bml;
+  send(next_connection(), &rc,
+       [this, key_uint, func](const RequestReplyContext &rrc) {
+         if (one_sided_ && !rrc.bml.empty()) {
+           std::lock_guard<std::mutex> lk(meta_mtx_);
+           meta_cache_[key_uint] = rrc.bml;
+         }
+         func(rrc.bml);
+       });
 }
 
 int PmPoolClient::del(const string &key) {
+  return wait_for<int>([&](std::function<void(int)> func) { del(key, func); });
+}
+
+void PmPoolClient::del(const string &key, std::function<void(int)> func) {
   uint64_t key_uint;
   Digest::computeKeyHash(key, &key_uint);
+  if (one_sided_) {
+    std::lock_guard<std::mutex> lk(meta_mtx_);
+    meta_cache_.erase(key_uint);
+  }
   RequestContext rc = {};
   rc.type = DELETE;
   rc.rid = rid_++;
   rc.key = key_uint;
-  Request request(rc);
-  requestHandler_->addTask(&request);
-  requestHandler_->wait();
-  auto res = requestHandler_->get().success;
-  return res;
+  send(next_connection(), &rc,
+       [func](const RequestReplyContext &rrc) { func(rrc.success); });
+}
+
+vector<uint64_t> PmPoolClient::put(const vector<string> &keys,
+                                   const vector<const char *> &values,
+                                   const vector<uint64_t> &sizes) {
+  return wait_for<vector<uint64_t>>(
+      [&](std::function<void(vector<uint64_t>)> func) {
+        put(keys, values, sizes, func);
+      });
+}
+
+void PmPoolClient::put(const vector<string> &keys,
+                       const vector<const char *> &values,
+                       const vector<uint64_t> &sizes,
+                       std::function<void(vector<uint64_t>)> func) {
+  put("", keys, values, sizes, func);
+}
+
+vector<uint64_t> PmPoolClient::put(const string &prefix,
+                                   const vector<string> &keys,
+                                   const vector<const char *> &values,
+                                   const vector<uint64_t> &sizes) {
+  return wait_for<vector<uint64_t>>(
+      [&](std::function<void(vector<uint64_t>)> func) {
+        put(prefix, keys, values, sizes, func);
+      });
+}
+
+void PmPoolClient::put(const string &prefix, const vector<string> &keys,
+                       const vector<const char *> &values,
+                       const vector<uint64_t> &sizes,
+                       std::function<void(vector<uint64_t>)> func) {
+  if (keys.size() != sizes.size()) {
+    func({});
+    return;
+  }
+  RequestContext rc = {};
+  rc.type = PUT_BATCH;
+  put_keys(&rc, prefix, keys, sizes);
+  write_batch(&rc, values, func);
+}
+
+vector<uint64_t> PmPoolClient::merge(const string &prefix,
+                                     const vector<string> &keys,
+                                     const vector<const char *> &values,
+                                     const vector<uint64_t> &sizes) {
+  return wait_for<vector<uint64_t>>(
+      [&](std::function<void(vector<uint64_t>)> func) {
+        merge(prefix, keys, values, sizes, func);
+      });
+}
+
+void PmPoolClient::merge(const string &prefix, const vector<string> &keys,
+                         const vector<const char *> &values,
+                         const vector<uint64_t> &sizes,
+                         std::function<void(vector<uint64_t>)> func) {
+  if (keys.size() != sizes.size()) {
+    func({});
+    return;
+  }
+  RequestContext rc = {};
+  rc.type = MERGE_BATCH;
+  put_keys(&rc, prefix, keys, sizes);
+  write_batch(&rc, values, func);
+}
+
+void PmPoolClient::put_keys(RequestContext *rc, const string &prefix,
+                            const vector<string> &keys,
+                            const vector<uint64_t> &sizes) {
+  if (!prefix.empty()) {
+    Digest::computeKeyHash(prefix, &rc->key);
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    uint64_t key_uint;
+    Digest::computeKeyHash(prefix + keys[i], &key_uint);
+    rc->keys.push_back(key_uint);
+    rc->bml.push_back(block_meta(0, sizes[i]));
+  }
+  if (one_sided_) {
+    std::lock_guard<std::mutex> lk(meta_mtx_);
+    for (auto key_uint : rc->keys) {
+      meta_cache_.erase(key_uint);
+    }
+  }
+}
+
+int PmPoolClient::del_prefix(const string &prefix) {
+  return wait_for<int>(
+      [&](std::function<void(int)> func) { del_prefix(prefix, func); });
+}
+
+void PmPoolClient::del_prefix(const string &prefix,
+                              std::function<void(int)> func) {
+  RequestContext rc = {};
+  rc.type = DEL_PREFIX;
+  rc.rid = rid_++;
+  Digest::computeKeyHash(prefix, &rc.key);
+  if (one_sided_) {
+    // the keys of prefix are not known here
+    std::lock_guard<std::mutex> lk(meta_mtx_);
+    meta_cache_.clear();
+  }
+  send(next_connection(), &rc,
+       [func](const RequestReplyContext &rrc) { func(rrc.success); });
 }
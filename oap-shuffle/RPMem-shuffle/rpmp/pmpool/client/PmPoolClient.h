@@ -32,10 +32,14 @@
 #include "../Base.h"
 #include "../Common.h"
 #include "../ThreadWrapper.h"
+#include "BlockReader.h"
 
 class NetworkClient;
 class RequestHandler;
 class Function;
+struct RequestContext;
+struct RequestReplyContext;
+struct StatsSnapshot;
 
 using std::atomic;
 using std::make_shared;
@@ -43,10 +47,27 @@ using std::shared_ptr;
 using std::string;
 using std::vector;
 
+/**
+ * @brief Client of a remote memory pool.
+ *
+ * Every operation comes in two forms. The synchronous one returns the result.
+ * The asynchronous one returns once the request is sent and calls func with the
+ * result on a network thread, so that a thread can keep many requests in
+ * flight. The data of a write is copied before it returns, the data of a read
+ * must stay valid until func is called. func must not block nor call the
+ * synchronous operations. Blocks inside a buffer registered by
+ * register_buffer are transferred straight from and to it instead, so the
+ * data of a write must stay valid until func is called too.
+ *
+ * The requests spread round robin over connection_num connections, each keeping
+ * up to max_outstanding requests in flight.
+ */
 class PmPoolClient {
  public:
   PmPoolClient() = delete;
   PmPoolClient(const string &remote_address, const string &remote_port);
+  PmPoolClient(const string &remote_address, const string &remote_port,
+               int connection_num, uint64_t max_outstanding = 32);
   ~PmPoolClient();
   int init();
 
@@ -55,19 +76,25 @@ class PmPoolClient {
   /// Allocate the given size of memory from remote memory pool.
   /// Return the global address of memory pool.
   uint64_t alloc(uint64_t size);
+  void alloc(uint64_t size, std::function<void(uint64_t)> func);
 
   /// Free memory with the global address.
   /// Address is the global address that returned by alloc.
   /// Return 0 if succeed, return others value if fail.
   int free(uint64_t address);
+  void free(uint64_t address, std::function<void(int)> func);
 
   /// Write data to the address of remote memory pool.
   /// The size is number of bytes
   /// Return 0 if succeed, return others value if fail.
   int write(uint64_t address, const char *data, uint64_t size);
+  void write(uint64_t address, const char *data, uint64_t size,
+             std::function<void(int)> func);
 
   /// Return global address if succeed, return -1 if fail.
   uint64_t write(const char *data, uint64_t size);
+  void write(const char *data, uint64_t size,
+             std::function<void(uint64_t)> func);
 
   /// Read from the global address of remote memory pool and copy to data
   /// pointer.
@@ -76,25 +103,161 @@ class PmPoolClient {
 
   int read(uint64_t address, char *data, uint64_t size,
            std::function<void(int)> func);
+  /// Read the blocks of bml, e.g. as get returns them, into data one after the
+  /// other. The blocks next to each other in a pool, like those merged under a
+  /// key, are read at once. Return 0 if succeed.
+  int read(const vector<block_meta> &bml, char *data);
+  void read(const vector<block_meta> &bml, char *data,
+            std::function<void(int)> func);
+  /// Reader handing out the blocks of bml one by one in order, while the
+  /// reads of the window blocks after it are in flight, e.g. for a reduce task
+  /// to go through the blocks of its partition without waiting on each.
+  std::unique_ptr<BlockReader> read_ahead(const vector<block_meta> &bml,
+                                          uint64_t window = 8);
   void end_tx();
 
+  /// batch interface, one request and one reply for up to MAX_BATCH_NUM blocks
+  /// Allocate blocks of sizes, return their addresses, empty if fail.
+  vector<uint64_t> alloc(const vector<uint64_t> &sizes);
+  void alloc(const vector<uint64_t> &sizes,
+             std::function<void(vector<uint64_t>)> func);
+
+  /// Free the blocks at addresses, return 0 if all succeed.
+  int free(const vector<uint64_t> &addresses);
+  void free(const vector<uint64_t> &addresses, std::function<void(int)> func);
+
+  /// Allocate and write blocks of data and sizes, return their addresses,
+  /// empty if fail.
+  vector<uint64_t> write(const vector<const char *> &data,
+                         const vector<uint64_t> &sizes);
+  void write(const vector<const char *> &data, const vector<uint64_t> &sizes,
+             std::function<void(vector<uint64_t>)> func);
+
   /// key-value storage interface
   uint64_t put(const string &key, const char *value, uint64_t size);
+  void put(const string &key, const char *value, uint64_t size,
+           std::function<void(uint64_t)> func);
   vector<block_meta> get(const string &key);
+  void get(const string &key, std::function<void(vector<block_meta>)> func);
   int del(const string &key);
+  void del(const string &key, std::function<void(int)> func);
+  /// Put each value under its key, return the addresses of the values, empty
+  /// if fail.
+  vector<uint64_t> put(const vector<string> &keys,
+                       const vector<const char *> &values,
+                       const vector<uint64_t> &sizes);
+  void put(const vector<string> &keys, const vector<const char *> &values,
+           const vector<uint64_t> &sizes,
+           std::function<void(vector<uint64_t>)> func);
+  /// Put each value under prefix + its key, e.g. under the shuffle_prefix of
+  /// a shuffle the block_key of each block, so that del_prefix deletes them
+  /// all at once. Return the addresses of the values, empty if fail.
+  vector<uint64_t> put(const string &prefix, const vector<string> &keys,
+                       const vector<const char *> &values,
+                       const vector<uint64_t> &sizes);
+  void put(const string &prefix, const vector<string> &keys,
+           const vector<const char *> &values, const vector<uint64_t> &sizes,
+           std::function<void(vector<uint64_t>)> func);
+  /// Delete all the keys put under prefix, return 0 if succeed. Their blocks
+  /// are freed by the server in background.
+  int del_prefix(const string &prefix);
+  void del_prefix(const string &prefix, std::function<void(int)> func);
+  /// Put each value under prefix + its key like put, but append it after the
+  /// values merged under the same key before, whoever merged them, e.g. the
+  /// blocks of a reduce partition from all the map tasks under its merge_key,
+  /// so that they are read back in few large reads. Deleting the key or the
+  /// prefix frees them. Return the addresses of the values, empty if fail.
+  vector<uint64_t> merge(const string &prefix, const vector<string> &keys,
+                         const vector<const char *> &values,
+                         const vector<uint64_t> &sizes);
+  void merge(const string &prefix, const vector<string> &keys,
+             const vector<const char *> &values, const vector<uint64_t> &sizes,
+             std::function<void(vector<uint64_t>)> func);
+  static string shuffle_prefix(const string &app, uint64_t shuffle) {
+    return app + "/" + std::to_string(shuffle) + "/";
+  }
+  static string block_key(uint64_t map, uint64_t reduce) {
+    return std::to_string(map) + "/" + std::to_string(reduce);
+  }
+  static string merge_key(uint64_t reduce) {
+    return "merged/" + std::to_string(reduce);
+  }
+
+  /// log-structured interface for write-once data of a shuffle
+  /// Append blocks of data and sizes to the extents of shuffle, return their
+  /// addresses, empty if fail. The blocks are not zeroed, and are freed only
+  /// all at once by release_shuffle.
+  vector<uint64_t> append(uint64_t shuffle, const vector<const char *> &data,
+                          const vector<uint64_t> &sizes);
+  void append(uint64_t shuffle, const vector<const char *> &data,
+              const vector<uint64_t> &sizes,
+              std::function<void(vector<uint64_t>)> func);
+  /// Free the blocks appended to shuffle, return 0 if succeed.
+  int release_shuffle(uint64_t shuffle);
+  void release_shuffle(uint64_t shuffle, std::function<void(int)> func);
+
+  /// zero-copy interface
+  /// Register data of size, e.g. a direct ByteBuffer, on every connection, so
+  /// that write, read and put of blocks inside it go without copies through
+  /// the network buffers. Registering a buffer again is a no-op, a buffer
+  /// must be unregistered before it is freed. Return 0 if succeed.
+  int register_buffer(char *data, uint64_t size);
+  void unregister_buffer(char *data);
+
+  /// one-sided read interface
+  /// Fetch the registered regions of the remote pools, after which read reads
+  /// the blocks with one-sided RDMA reads, without the server CPU, and get
+  /// keeps the blocks of the keys it returns, until they are put or deleted
+  /// by this client. Return 0 if succeed.
+  int enable_one_sided_read();
+
+  /// monitoring interface
+  /// Fetch the load of the server into stats: the requests replied of each
+  /// kind, with their bytes and latency histogram, the depths of its queues
+  /// and the bytes written to each pool. Return 0 if succeed.
+  int get_stats(StatsSnapshot *stats);
 
   void shutdown();
   void wait();
 
  private:
-  shared_ptr<RequestHandler> requestHandler_;
-  shared_ptr<NetworkClient> networkClient_;
+  /// Index of the connection of the next request
+  uint64_t next_connection();
+  /// Send rc on connection c, calling func with its reply
+  void send(uint64_t c, RequestContext *rc,
+            std::function<void(const RequestReplyContext &)> func);
+  /// Allocate and write the blocks of a WRITE_BATCH, PUT_BATCH, APPEND_BATCH
+  /// or MERGE_BATCH rc with one DRAM buffer of their total size
+  void write_batch(RequestContext *rc, const vector<const char *> &data,
+                   std::function<void(vector<uint64_t>)> func);
+  /// Keys of a PUT_BATCH or MERGE_BATCH rc, under prefix
+  void put_keys(RequestContext *rc, const string &prefix,
+                const vector<string> &keys, const vector<uint64_t> &sizes);
+  /// Result of the asynchronous form of an operation, waited for
+  template <typename T, typename AsyncOp>
+  T wait_for(AsyncOp &&op) {
+    std::promise<T> promise;
+    auto result = promise.get_future();
+    op([&promise](T value) { promise.set_value(std::move(value)); });
+    return result.get();
+  }
+
+  vector<shared_ptr<NetworkClient>> networkClients_;
+  vector<shared_ptr<RequestHandler>> requestHandlers_;
+  atomic<uint64_t> next_connection_ = {0};
   atomic<uint64_t> rid_ = {0};
   std::mutex tx_mtx;
   std::condition_variable tx_con;
   bool tx_finished;
   std::mutex op_mtx;
   bool op_finished;
+  /// read and get go one-sided once rma_regions_ is set
+  atomic<bool> one_sided_ = {false};
+  /// region of each pool, its virtual address in address and rkey in size
+  vector<block_meta> rma_regions_;
+  std::mutex meta_mtx_;
+  /// blocks of the keys got by this client, by key hash
+  std::unordered_map<uint64_t, vector<block_meta>> meta_cache_;
 };
 
 #endif  // PMPOOL_CLIENT_PMPOOLCLIENT_H_
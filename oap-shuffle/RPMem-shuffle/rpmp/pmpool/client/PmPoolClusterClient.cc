@@ -0,0 +1,274 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/client/PmPoolClusterClient.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool/client
+ * Created Date: Wednesday, October 14th 2020, 9:40:02 pm
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include "pmpool/client/PmPoolClusterClient.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstring>
+#include <mutex>  // NOLINT
+
+#include "pmpool/Digest.h"
+
+namespace {
+/// Count of the asynchronous requests in flight of a cluster operation
+class Latch {
+ public:
+  explicit Latch(uint64_t count) : count_(count) {}
+  void count_down() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (--count_ == 0) {
+      cv_.notify_all();
+    }
+  }
+  void wait() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    cv_.wait(lk, [this] { return count_ == 0; });
+  }
+
+ private:
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  uint64_t count_;
+};
+
+void xor_into(char *dest, const char *src, uint64_t size) {
+  for (uint64_t i = 0; i < size; i++) {
+    dest[i] ^= src[i];
+  }
+}
+}  // namespace
+
+PmPoolClusterClient::PmPoolClusterClient(
+    const vector<std::pair<string, string>> &servers, int connection_num,
+    uint64_t stripe_size, uint32_t replicas, bool parity)
+    : stripe_size_(std::max<uint64_t>(stripe_size, 1)),
+      replicas_(std::max<uint32_t>(replicas, 1)),
+      parity_(parity) {
+  for (auto &server : servers) {
+    ring_.add_server(server.first + ":" + server.second, clients_.size());
+    clients_.push_back(make_shared<PmPoolClient>(server.first, server.second,
+                                                 connection_num));
+  }
+}
+
+int PmPoolClusterClient::init() {
+  for (auto &client : clients_) {
+    if (client->init() != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+vector<uint32_t> PmPoolClusterClient::placement(const string &key) {
+  uint64_t hash;
+  Digest::computeKeyHash(key, &hash);
+  return ring_.servers(hash, ring_.server_num());
+}
+
+uint64_t PmPoolClusterClient::stripe_num(uint64_t size) {
+  return (size + stripe_size_ - 1) / stripe_size_;
+}
+
+uint64_t PmPoolClusterClient::stripe_size(uint64_t size, uint64_t i) {
+  return std::min(stripe_size_, size - i * stripe_size_);
+}
+
+string PmPoolClusterClient::stripe_key(const string &key, uint64_t i) {
+  return key + "#" + std::to_string(i);
+}
+
+int PmPoolClusterClient::put(const string &key, const char *value,
+                             uint64_t size) {
+  auto servers = placement(key);
+  uint64_t m = servers.size();
+  if (m == 0) {
+    return -1;
+  }
+  uint64_t n = stripe_num(size);
+  uint32_t replicas = std::min<uint64_t>(replicas_, m);
+  vector<char> parity;
+  if (parity_ && n > 0) {
+    parity.assign(std::min(stripe_size_, size), 0);
+    for (uint64_t i = 0; i < n; i++) {
+      xor_into(parity.data(), value + i * stripe_size_, stripe_size(size, i));
+    }
+  }
+  Latch latch((n + 1) * replicas + (parity.empty() ? 0 : 1));
+  std::atomic<bool> failed = {false};
+  auto done = [&latch, &failed](uint64_t address) {
+    if (address == static_cast<uint64_t>(-1)) {
+      failed = true;
+    }
+    latch.count_down();
+  };
+  for (uint32_t r = 0; r < replicas; r++) {
+    clients_[servers[r]]->put(key, reinterpret_cast<const char *>(&size),
+                              sizeof(size), done);
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    for (uint32_t r = 0; r < replicas; r++) {
+      clients_[servers[(i + r) % m]]->put(stripe_key(key, i),
+                                          value + i * stripe_size_,
+                                          stripe_size(size, i), done);
+    }
+  }
+  if (!parity.empty()) {
+    clients_[servers[n % m]]->put(key + "#p", parity.data(), parity.size(),
+                                  done);
+  }
+  latch.wait();
+  return failed ? -1 : 0;
+}
+
+vector<int> PmPoolClusterClient::read_stripes(const vector<Stripe> &stripes) {
+  // the blocks of all the stripes first, then their data, so that both take
+  // one round trip whatever the stripes
+  vector<vector<block_meta>> bmls(stripes.size());
+  Latch meta_latch(stripes.size());
+  for (size_t j = 0; j < stripes.size(); j++) {
+    clients_[stripes[j].server]->get(
+        stripes[j].key, [&bmls, &meta_latch, j](vector<block_meta> bml) {
+          bmls[j] = std::move(bml);
+          meta_latch.count_down();
+        });
+  }
+  meta_latch.wait();
+  vector<int> res(stripes.size(), -1);
+  Latch read_latch(stripes.size());
+  for (size_t j = 0; j < stripes.size(); j++) {
+    // the latest value put under the key
+    if (bmls[j].empty() || bmls[j].back().size != stripes[j].size) {
+      read_latch.count_down();
+      continue;
+    }
+    clients_[stripes[j].server]->read(
+        bmls[j].back().address, stripes[j].data, stripes[j].size,
+        [&res, &read_latch, j](int success) {
+          res[j] = success;
+          read_latch.count_down();
+        });
+  }
+  read_latch.wait();
+  return res;
+}
+
+int PmPoolClusterClient::get(const string &key, char *data, uint64_t size) {
+  auto servers = placement(key);
+  uint64_t m = servers.size();
+  if (m == 0) {
+    return -1;
+  }
+  uint64_t n = stripe_num(size);
+  uint32_t replicas = std::min<uint64_t>(replicas_, m);
+  vector<uint64_t> missing;
+  for (uint64_t i = 0; i < n; i++) {
+    missing.push_back(i);
+  }
+  // each round reads the stripes still missing from their next replica
+  for (uint32_t r = 0; r < replicas && !missing.empty(); r++) {
+    vector<Stripe> stripes;
+    for (auto i : missing) {
+      stripes.push_back({servers[(i + r) % m], stripe_key(key, i),
+                         data + i * stripe_size_, stripe_size(size, i)});
+    }
+    auto res = read_stripes(stripes);
+    vector<uint64_t> still_missing;
+    for (size_t j = 0; j < res.size(); j++) {
+      if (res[j] != 0) {
+        still_missing.push_back(missing[j]);
+      }
+    }
+    missing = std::move(still_missing);
+  }
+  if (missing.size() == 1 && parity_) {
+    return rebuild_stripe(key, servers, missing[0], data, size);
+  }
+  return missing.empty() ? 0 : -1;
+}
+
+int PmPoolClusterClient::rebuild_stripe(const string &key,
+                                        const vector<uint32_t> &servers,
+                                        uint64_t lost, char *data,
+                                        uint64_t size) {
+  uint64_t n = stripe_num(size);
+  vector<char> parity(std::min(stripe_size_, size));
+  auto res = read_stripes({{servers[n % servers.size()], key + "#p",
+                            parity.data(), parity.size()}});
+  if (res[0] != 0) {
+    return -1;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    if (i != lost) {
+      xor_into(parity.data(), data + i * stripe_size_, stripe_size(size, i));
+    }
+  }
+  memcpy(data + lost * stripe_size_, parity.data(), stripe_size(size, lost));
+  return 0;
+}
+
+int PmPoolClusterClient::get_size(const string &key, uint64_t *size) {
+  auto servers = placement(key);
+  uint32_t replicas = std::min<uint64_t>(replicas_, servers.size());
+  for (uint32_t r = 0; r < replicas; r++) {
+    auto res = read_stripes(
+        {{servers[r], key, reinterpret_cast<char *>(size), sizeof(*size)}});
+    if (res[0] == 0) {
+      return 0;
+    }
+  }
+  return -1;
+}
+
+int PmPoolClusterClient::del(const string &key) {
+  uint64_t size;
+  if (get_size(key, &size) != 0) {
+    return -1;
+  }
+  auto servers = placement(key);
+  uint64_t m = servers.size();
+  uint64_t n = stripe_num(size);
+  uint32_t replicas = std::min<uint64_t>(replicas_, m);
+  bool parity = parity_ && n > 0;
+  Latch latch((n + 1) * replicas + (parity ? 1 : 0));
+  std::atomic<bool> failed = {false};
+  auto done = [&latch, &failed](int success) {
+    if (success != 0) {
+      failed = true;
+    }
+    latch.count_down();
+  };
+  for (uint64_t i = 0; i < n; i++) {
+    for (uint32_t r = 0; r < replicas; r++) {
+      clients_[servers[(i + r) % m]]->del(stripe_key(key, i), done);
+    }
+  }
+  if (parity) {
+    clients_[servers[n % m]]->del(key + "#p", done);
+  }
+  for (uint32_t r = 0; r < replicas; r++) {
+    clients_[servers[r]]->del(key, done);
+  }
+  latch.wait();
+  return failed ? -1 : 0;
+}
+
+void PmPoolClusterClient::shutdown() {
+  for (auto &client : clients_) {
+    client->shutdown();
+  }
+}
+
+void PmPoolClusterClient::wait() {
+  for (auto &client : clients_) {
+    client->wait();
+  }
+}
@@ -0,0 +1,86 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/pmpool/client/PmPoolClusterClient.h
+ * Path: /mnt/spark-pmof/tool/rpmp/pmpool/client
+ * Created Date: Wednesday, October 14th 2020, 9:40:02 pm
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#ifndef PMPOOL_CLIENT_PMPOOLCLUSTERCLIENT_H_
+#define PMPOOL_CLIENT_PMPOOLCLUSTERCLIENT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pmpool/client/ConsistentHashRing.h"
+#include "pmpool/client/PmPoolClient.h"
+
+/**
+ * @brief Key-value client of a cluster of RPMP servers.
+ *
+ * The keys are placed on a consistent-hash ring of the servers. A value is cut
+ * in stripes of stripe_size, stripe i put under key#i on the i-th server met
+ * clockwise from its key, so that the stripes of a large value are written and
+ * read in parallel on several servers. Each stripe is put on replicas
+ * successive servers. With parity, the XOR of the stripes is put under key#p
+ * on the server after the last stripe, from which one stripe lost on all its
+ * replicas is rebuilt. The size of the value is put under key itself, on the
+ * replicas first servers.
+ *
+ * A server holds the stripes of a value only once while they are not more
+ * than the servers, so a lost server loses at most one stripe of it.
+ */
+class PmPoolClusterClient {
+ public:
+  PmPoolClusterClient() = delete;
+  /// servers as remote address and port
+  PmPoolClusterClient(const vector<std::pair<string, string>> &servers,
+                      int connection_num = 1, uint64_t stripe_size = 1 << 20,
+                      uint32_t replicas = 1, bool parity = false);
+  ~PmPoolClusterClient() = default;
+  int init();
+
+  /// Put value of size under key, return 0 if all its stripes are put.
+  int put(const string &key, const char *value, uint64_t size);
+  /// Read the value of size under key into data, return 0 if succeed.
+  int get(const string &key, char *data, uint64_t size);
+  /// Size of the value under key, return 0 if succeed.
+  int get_size(const string &key, uint64_t *size);
+  /// Delete the value under key from all its servers, return 0 if succeed.
+  int del(const string &key);
+
+  void shutdown();
+  void wait();
+
+ private:
+  /// A block of a value on one server
+  struct Stripe {
+    uint32_t server;
+    string key;
+    char *data;
+    uint64_t size;
+  };
+  /// Servers of key, its primary first
+  vector<uint32_t> placement(const string &key);
+  uint64_t stripe_num(uint64_t size);
+  uint64_t stripe_size(uint64_t size, uint64_t i);
+  string stripe_key(const string &key, uint64_t i);
+  /// Read stripes in parallel, return their results, 0 if succeed
+  vector<int> read_stripes(const vector<Stripe> &stripes);
+  /// Rebuild the stripe lost of the value of size under key from its parity
+  /// and its other stripes, already in data
+  int rebuild_stripe(const string &key, const vector<uint32_t> &servers,
+                     uint64_t lost, char *data, uint64_t size);
+
+  vector<shared_ptr<PmPoolClient>> clients_;
+  ConsistentHashRing ring_;
+  const uint64_t stripe_size_;
+  const uint32_t replicas_;
+  const bool parity_;
+};
+
+#endif  // PMPOOL_CLIENT_PMPOOLCLUSTERCLIENT_H_
@@ -53,6 +53,19 @@ public class PmPoolClient {
         return del(key, objectId);
     }
 
+    /**
+     * Register a direct ByteBuffer so that write, read and put of its data go
+     * without copies through the network buffers of the client. It must be
+     * unregistered before it is freed.
+     */
+    public int registerBuffer(ByteBuffer data, long size) {
+        return registerBuffer_(data, size, objectId);
+    }
+
+    public void unregisterBuffer(ByteBuffer data) {
+        unregisterBuffer_(data, objectId);
+    }
+
     public void shutdown() {
         shutdown_(objectId);
     }
@@ -109,6 +122,10 @@ public class PmPoolClient {
 
     private native int read_(long address, long size, ByteBuffer byteBuffer, long objectId);
 
+    private native int registerBuffer_(ByteBuffer data, long size, long objectId);
+
+    private native void unregisterBuffer_(ByteBuffer data, long objectId);
+
     private native void shutdown_(long objectId);
 
     private native void waitToStop_(long objectId);
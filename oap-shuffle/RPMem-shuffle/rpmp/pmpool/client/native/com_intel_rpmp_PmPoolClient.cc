@@ -149,6 +149,20 @@ JNIEXPORT jint JNICALL Java_com_intel_rpmp_PmPoolClient_read_1(
   return success;
 }
 
+JNIEXPORT jint JNICALL Java_com_intel_rpmp_PmPoolClient_registerBuffer_1(
+    JNIEnv *env, jobject obj, jobject data, jlong size, jlong objectId) {
+  char *raw_data = static_cast<char *>((*env).GetDirectBufferAddress(data));
+  PmPoolClient *client = reinterpret_cast<PmPoolClient *>(objectId);
+  return client->register_buffer(raw_data, size);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_rpmp_PmPoolClient_unregisterBuffer_1(
+    JNIEnv *env, jobject obj, jobject data, jlong objectId) {
+  char *raw_data = static_cast<char *>((*env).GetDirectBufferAddress(data));
+  PmPoolClient *client = reinterpret_cast<PmPoolClient *>(objectId);
+  client->unregister_buffer(raw_data);
+}
+
 JNIEXPORT void JNICALL Java_com_intel_rpmp_PmPoolClient_shutdown_1(
     JNIEnv *env, jobject obj, jlong objectId) {
   PmPoolClient *client = reinterpret_cast<PmPoolClient *>(objectId);
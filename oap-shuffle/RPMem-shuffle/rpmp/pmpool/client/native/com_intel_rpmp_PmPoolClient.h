@@ -107,6 +107,22 @@ JNIEXPORT jint JNICALL Java_com_intel_rpmp_PmPoolClient_read_1(JNIEnv *,
                                                                jlong, jobject,
                                                                jlong);
 
+/*
+ * Class:     com_intel_rpmp_PmPoolClient
+ * Method:    registerBuffer_
+ * Signature: (Ljava/nio/ByteBuffer;JJ)I
+ */
+JNIEXPORT jint JNICALL Java_com_intel_rpmp_PmPoolClient_registerBuffer_1(
+    JNIEnv *, jobject, jobject, jlong, jlong);
+
+/*
+ * Class:     com_intel_rpmp_PmPoolClient
+ * Method:    unregisterBuffer_
+ * Signature: (Ljava/nio/ByteBuffer;J)V
+ */
+JNIEXPORT void JNICALL Java_com_intel_rpmp_PmPoolClient_unregisterBuffer_1(
+    JNIEnv *, jobject, jobject, jlong);
+
 /*
  * Class:     com_intel_rpmp_PmPoolClient
  * Method:    shutdown_
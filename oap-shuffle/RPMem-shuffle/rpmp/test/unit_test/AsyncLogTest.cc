@@ -0,0 +1,76 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/test/AsyncLogTest.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/test
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pmpool/AsyncLog.h"
+
+TEST(asynclog, format) {
+  LogRecord record = {"write rid {} size {}, {} left", {7, 4096}, 2, 1};
+  ASSERT_EQ(AsyncLog::format(record), "write rid 7 size 4096, {} left");
+}
+
+TEST(asynclog, threads_in_order) {
+  std::vector<std::string> messages;
+  AsyncLog log(
+      [&messages](int level, const std::string &message) {
+        messages.push_back(message);
+      },
+      0);
+  std::vector<std::thread> threads;
+  for (uint64_t t = 0; t < 4; t++) {
+    threads.emplace_back([&log, t]() {
+      for (uint64_t i = 0; i < 1000; i++) {
+        log.log({"{} {}", {t, i}, 2, 1});
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log.flush();
+  ASSERT_EQ(messages.size(), 4000);
+  // each thread's messages come out in the order it logged them
+  std::vector<uint64_t> next(4, 0);
+  for (auto &message : messages) {
+    auto t = std::stoull(message.substr(0, message.find(' ')));
+    auto i = std::stoull(message.substr(message.find(' ') + 1));
+    ASSERT_EQ(i, next[t]++);
+  }
+}
+
+TEST(asynclog, rate_and_overflow) {
+  std::vector<std::string> messages;
+  AsyncLog log(
+      [&messages](int level, const std::string &message) {
+        messages.push_back(message);
+      },
+      10);
+  for (uint64_t i = 0; i < 100; i++) {
+    log.log({"{}", {i}, 1, 1});
+  }
+  log.flush();
+  // cut at 10 in the second, unless the second changed in between
+  ASSERT_LE(messages.size(), 21);
+  ASSERT_EQ(messages.back().find("dropped"), 0);
+
+  messages.clear();
+  AsyncLog counted(
+      [&messages](int level, const std::string &message) {
+        messages.push_back(message);
+      },
+      0);
+  for (uint64_t i = 0; i < LogRing::CAPACITY + 10; i++) {
+    counted.log({"{}", {i}, 1, 1});
+  }
+  counted.flush();
+  ASSERT_EQ(messages.size(), LogRing::CAPACITY + 1);
+  ASSERT_EQ(messages.back(), "dropped 10 log messages of a thread");
+}
@@ -0,0 +1,68 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/test/ConsistentHashRingTest.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/test
+ * Created Date: Wednesday, October 14th 2020, 10:05:51 pm
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "pmpool/client/ConsistentHashRing.h"
+#include "gtest/gtest.h"
+
+TEST(consistenthashring, distinct_servers) {
+  ConsistentHashRing ring;
+  for (uint32_t i = 0; i < 4; i++) {
+    ring.add_server("server" + std::to_string(i) + ":12346", i);
+  }
+  for (uint64_t hash = 0; hash < 1000; hash++) {
+    auto servers = ring.servers(hash * 0x9E3779B97F4A7C15ULL, 8);
+    ASSERT_EQ(servers.size(), 4);
+    ASSERT_EQ(std::set<uint32_t>(servers.begin(), servers.end()).size(), 4);
+  }
+}
+
+TEST(consistenthashring, balance) {
+  ConsistentHashRing ring;
+  for (uint32_t i = 0; i < 4; i++) {
+    ring.add_server("server" + std::to_string(i) + ":12346", i);
+  }
+  std::vector<int> keys(4, 0);
+  for (int k = 0; k < 40000; k++) {
+    uint64_t hash;
+    Digest::computeKeyHash("key" + std::to_string(k), &hash);
+    keys[ring.servers(hash, 1)[0]]++;
+  }
+  for (auto n : keys) {
+    ASSERT_GT(n, 5000);
+    ASSERT_LT(n, 15000);
+  }
+}
+
+TEST(consistenthashring, remove_moves_only_its_keys) {
+  ConsistentHashRing ring;
+  for (uint32_t i = 0; i < 4; i++) {
+    ring.add_server("server" + std::to_string(i) + ":12346", i);
+  }
+  std::vector<uint32_t> before;
+  for (int k = 0; k < 10000; k++) {
+    uint64_t hash;
+    Digest::computeKeyHash("key" + std::to_string(k), &hash);
+    before.push_back(ring.servers(hash, 1)[0]);
+  }
+  ring.remove_server("server2:12346");
+  ASSERT_EQ(ring.server_num(), 3);
+  for (int k = 0; k < 10000; k++) {
+    uint64_t hash;
+    Digest::computeKeyHash("key" + std::to_string(k), &hash);
+    auto server = ring.servers(hash, 1)[0];
+    ASSERT_NE(server, 2);
+    if (before[k] != 2) {
+      ASSERT_EQ(server, before[k]);
+    }
+  }
+}
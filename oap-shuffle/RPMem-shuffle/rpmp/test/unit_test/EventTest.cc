@@ -0,0 +1,119 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/test/EventTest.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/test
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <future>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "pmpool/Event.h"
+#undef private
+
+TEST(event, batch_request) {
+  RequestContext rc = {};
+  rc.type = PUT_BATCH;
+  rc.rid = 7;
+  rc.size = 30;
+  for (uint64_t i = 0; i < 3; i++) {
+    rc.bml.push_back(block_meta(0, 10));
+    rc.keys.push_back(100 + i);
+  }
+  Request request(rc);
+  request.encode();
+
+  Request received(request.data_, request.size_, nullptr);
+  received.decode();
+  auto& decoded = received.get_rc();
+  ASSERT_EQ(decoded.type, PUT_BATCH);
+  ASSERT_EQ(decoded.rid, 7);
+  ASSERT_EQ(decoded.size, 30);
+  ASSERT_EQ(decoded.bml.size(), 3);
+  ASSERT_EQ(decoded.keys.size(), 3);
+  for (uint64_t i = 0; i < 3; i++) {
+    ASSERT_EQ(decoded.bml[i].size, 10);
+    ASSERT_EQ(decoded.keys[i], 100 + i);
+  }
+}
+
+TEST(event, merge_request) {
+  RequestContext rc = {};
+  rc.type = MERGE_BATCH;
+  rc.rid = 8;
+  rc.key = 42;
+  for (uint64_t i = 0; i < 2; i++) {
+    rc.bml.push_back(block_meta(0, 64 + i));
+    rc.keys.push_back(200 + i);
+  }
+  Request request(rc);
+  request.encode();
+
+  Request received(request.data_, request.size_, nullptr);
+  received.decode();
+  auto& decoded = received.get_rc();
+  ASSERT_EQ(decoded.type, MERGE_BATCH);
+  ASSERT_EQ(decoded.key, 42);
+  ASSERT_EQ(decoded.bml.size(), 2);
+  ASSERT_EQ(decoded.keys.size(), 2);
+  for (uint64_t i = 0; i < 2; i++) {
+    ASSERT_EQ(decoded.bml[i].size, 64 + i);
+    ASSERT_EQ(decoded.keys[i], 200 + i);
+  }
+}
+
+TEST(event, batch_reply) {
+  RequestReplyContext rrc = {};
+  rrc.type = ALLOC_BATCH_REPLY;
+  rrc.rid = 7;
+  rrc.bml.push_back(block_meta(1024, 10));
+  rrc.bml.push_back(block_meta(2048, 20));
+  RequestReply reply(rrc);
+  reply.encode();
+
+  RequestReply received(reply.data_, reply.size_, nullptr);
+  received.decode();
+  auto& decoded = received.get_rrc();
+  ASSERT_EQ(decoded.type, ALLOC_BATCH_REPLY);
+  ASSERT_EQ(decoded.bml.size(), 2);
+  ASSERT_EQ(decoded.bml[1].address, 2048);
+  ASSERT_EQ(decoded.bml[1].size, 20);
+}
+
+TEST(event, pooled_reuse) {
+  RequestContext rc = {};
+  rc.type = PUT_BATCH;
+  rc.rid = 9;
+  for (uint64_t i = 0; i < 4; i++) {
+    rc.bml.push_back(block_meta(0, 8));
+    rc.keys.push_back(300 + i);
+  }
+  Request request(rc);
+  request.encode();
+
+  Request received;
+  received.reset(request.data_, request.size_, nullptr);
+  received.decode();
+  ASSERT_EQ(received.get_rc().bml.size(), 4);
+
+  // reset for a request without blocks, the lists keep their capacity
+  rc = {};
+  rc.type = DELETE;
+  rc.rid = 10;
+  rc.key = 42;
+  request.reset(rc);
+  request.encode();
+  auto capacity = received.get_rc().bml.capacity();
+  received.reset(request.data_, request.size_, nullptr);
+  received.decode();
+  auto& decoded = received.get_rc();
+  ASSERT_EQ(decoded.type, DELETE);
+  ASSERT_EQ(decoded.rid, 10);
+  ASSERT_EQ(decoded.key, 42);
+  ASSERT_TRUE(decoded.bml.empty());
+  ASSERT_TRUE(decoded.keys.empty());
+  ASSERT_EQ(decoded.bml.capacity(), capacity);
+}
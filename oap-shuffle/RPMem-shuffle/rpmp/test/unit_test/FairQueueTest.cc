@@ -0,0 +1,74 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/test/FairQueueTest.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/test
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pmpool/FairQueue.h"
+
+TEST(fairqueue, round_robin_by_bytes) {
+  FairQueue<int> queue(1024, 0);
+  Tenant large, small;
+  // a tenant of 64KB writes queued before one of 1KB reads
+  for (int i = 0; i < 8; i++) {
+    queue.enqueue(&large, 100 + i, 65536);
+  }
+  for (int i = 0; i < 64; i++) {
+    queue.enqueue(&small, i, 1024);
+  }
+  int item;
+  int small_served = 0;
+  for (int i = 0; i < 64 && queue.try_dequeue(item); i++) {
+    if (item >= 100) {
+      break;
+    }
+    small_served++;
+  }
+  // the small reads go while the first write earns its deficit
+  ASSERT_EQ(small_served, 63);
+  int left = 0;
+  while (queue.try_dequeue(item)) {
+    left++;
+  }
+  ASSERT_EQ(left, 8);
+}
+
+TEST(fairqueue, bandwidth) {
+  // 1MB/s, the bucket starts with a second of it
+  FairQueue<int> queue(1 << 20, 1 << 20);
+  Tenant tenant;
+  queue.enqueue(&tenant, 0, 1 << 20);
+  queue.enqueue(&tenant, 1, 1 << 18);
+  int item;
+  ASSERT_TRUE(queue.try_dequeue(item));
+  ASSERT_EQ(item, 0);
+  ASSERT_TRUE(queue.try_dequeue(item));
+  ASSERT_EQ(item, 1);
+  // in debt of 256KB, for a quarter of a second
+  queue.enqueue(&tenant, 2, 1);
+  ASSERT_FALSE(queue.try_dequeue(item));
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(queue.wait_dequeue_timed(item, std::chrono::milliseconds(1000)));
+  ASSERT_EQ(item, 2);
+  ASSERT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(200));
+}
+
+TEST(fairqueue, throttled_tenant_doesnt_block_others) {
+  FairQueue<int> queue(1024, 1 << 20);
+  Tenant heavy, light;
+  queue.enqueue(&heavy, 0, 2 << 20);
+  int item;
+  ASSERT_TRUE(queue.try_dequeue(item));
+  queue.enqueue(&heavy, 1, 1024);
+  queue.enqueue(&light, 2, 4096);
+  ASSERT_TRUE(queue.try_dequeue(item));
+  ASSERT_EQ(item, 2);
+  ASSERT_FALSE(queue.try_dequeue(item));
+}
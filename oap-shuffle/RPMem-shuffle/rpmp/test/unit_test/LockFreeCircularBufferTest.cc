@@ -0,0 +1,149 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/test/LockFreeCircularBufferTest.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/test
+ * Created Date: Wednesday, October 14th 2020, 3:02:15 pm
+ * Author: root
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "../pmpool/buffer/LockFreeCircularBuffer.h"
+#include "gtest/gtest.h"
+
+TEST(lockfreecircularbuffer, 1B) {
+  LockFreeCircularBuffer buffer(1, 10);
+  uint64_t addr = 0;
+  buffer.get(2, &addr);
+  ASSERT_EQ(addr, 0);
+  ASSERT_EQ(buffer.get_write_(), 2);
+  buffer.get(2, &addr);
+  ASSERT_EQ(addr, 2);
+  buffer.get(2, &addr);
+  ASSERT_EQ(addr, 4);
+  buffer.get(2, &addr);
+  ASSERT_EQ(addr, 6);
+  buffer.get(2, &addr);
+  ASSERT_EQ(addr, 8);
+  ASSERT_EQ(buffer.get_write_(), 0);
+  // out of order puts leave read_ until the first buffers are put
+  buffer.put(8, 2);
+  ASSERT_EQ(buffer.get_read_(), 0);
+  buffer.put(2, 4);
+  ASSERT_EQ(buffer.get_read_(), 0);
+  addr = 0;
+  buffer.put(addr, 2);
+  ASSERT_EQ(buffer.get_read_(), 6);
+  // the buffers of a get don't wrap, the ones at the end are skipped
+  buffer.get(3, &addr);
+  ASSERT_EQ(addr, 0);
+  ASSERT_EQ(buffer.get_write_(), 3);
+  buffer.put(6, 2);
+  ASSERT_EQ(buffer.get_read_(), 0);
+  buffer.get(7, &addr);
+  ASSERT_EQ(addr, 3);
+  ASSERT_EQ(buffer.get_write_(), 0);
+  buffer.put(3, 7);
+  ASSERT_EQ(buffer.get_read_(), 0);
+  addr = 0;
+  buffer.put(addr, 3);
+  ASSERT_EQ(buffer.get_read_(), 0);
+  ASSERT_FALSE(buffer.get(11, &addr));
+}
+
+TEST(lockfreecircularbuffer, 4K) {
+  LockFreeCircularBuffer buffer(4096, 4);
+  uint64_t addr = 0;
+  buffer.get(10, &addr);
+  ASSERT_EQ(addr, 0);
+  ASSERT_EQ(buffer.get_write_(), 1);
+  buffer.get(10, &addr);
+  ASSERT_EQ(addr, 1);
+  ASSERT_EQ(buffer.get_write_(), 2);
+  buffer.get(4097, &addr);
+  ASSERT_EQ(addr, 2);
+  ASSERT_EQ(buffer.get_write_(), 0);
+  buffer.put(2, 4097);
+  ASSERT_EQ(buffer.get_read_(), 0);
+  addr = 0;
+  buffer.put(addr, 10);
+  ASSERT_EQ(buffer.get_read_(), 1);
+  buffer.put(1, 10);
+  ASSERT_EQ(buffer.get_read_(), 0);
+}
+
+TEST(lockfreecircularbuffer, bitmap_words) {
+  // runs of released buffers across bitmap words
+  LockFreeCircularBuffer buffer(1, 200);
+  uint64_t addr = 0;
+  buffer.get(100, &addr);
+  ASSERT_EQ(addr, 0);
+  buffer.get(90, &addr);
+  ASSERT_EQ(addr, 100);
+  buffer.put(100, 90);
+  ASSERT_EQ(buffer.get_read_(), 0);
+  addr = 0;
+  buffer.put(addr, 100);
+  ASSERT_EQ(buffer.get_read_(), 190);
+  buffer.get(20, &addr);
+  ASSERT_EQ(addr, 0);
+  ASSERT_EQ(buffer.get_read_(), 0);
+}
+
+TEST(lockfreecircularbuffer, wait) {
+  LockFreeCircularBuffer buffer(1, 8);
+  uint64_t addr = 0;
+  buffer.get(6, &addr);
+  ASSERT_EQ(addr, 0);
+  std::thread t([&buffer] {
+    uint64_t first = 0;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    buffer.put(first, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    buffer.put(4, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    buffer.put(2, 2);
+  });
+  buffer.get(8, &addr);
+  ASSERT_EQ(addr, 0);
+  t.join();
+}
+
+TEST(lockfreecircularbuffer, multithread) {
+  const uint64_t buffer_num = 64;
+  LockFreeCircularBuffer buffer(1, buffer_num);
+  std::vector<std::atomic<int>> owners(buffer_num);
+  for (auto &owner : owners) {
+    owner.store(0);
+  }
+  std::atomic<bool> overlapped(false);
+  std::vector<std::thread> threads;
+  for (int i = 1; i <= 8; i++) {
+    threads.emplace_back([&, i] {
+      for (int n = 0; n < 20000; n++) {
+        uint64_t num = 1 + (n + i) % 7;
+        uint64_t addr = 0;
+        ASSERT_TRUE(buffer.get(num, &addr));
+        for (uint64_t j = addr; j < addr + num; j++) {
+          int expected = 0;
+          if (!owners[j].compare_exchange_strong(expected, i)) {
+            overlapped = true;
+          }
+        }
+        for (uint64_t j = addr; j < addr + num; j++) {
+          owners[j].store(0);
+        }
+        buffer.put(addr, num);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_FALSE(overlapped);
+  ASSERT_EQ(buffer.get_read_(), buffer.get_write_());
+}
@@ -0,0 +1,67 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/test/SlotTableTest.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/test
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pmpool/SlotTable.h"
+
+TEST(slottable, insert_take) {
+  SlotTable<uint64_t> table(4);
+  for (uint64_t rid = 0; rid < 4; rid++) {
+    table.insert(rid * 4, rid + 100);
+  }
+  ASSERT_EQ(table.size(), 4);
+  uint64_t value;
+  ASSERT_FALSE(table.take(1, &value));
+  ASSERT_TRUE(table.take(8, &value));
+  ASSERT_EQ(value, 102);
+  ASSERT_FALSE(table.take(8, &value));
+  for (uint64_t rid : {0, 1, 3}) {
+    ASSERT_TRUE(table.take(rid * 4, &value));
+    ASSERT_EQ(value, rid + 100);
+  }
+  ASSERT_EQ(table.size(), 0);
+}
+
+TEST(slottable, sliding_window) {
+  // rids in flight over a window, taken out of order
+  SlotTable<uint64_t> table(32);
+  std::vector<uint64_t> in_flight;
+  uint64_t value;
+  for (uint64_t rid = 0; rid < 100000; rid++) {
+    table.insert(rid, rid);
+    in_flight.push_back(rid);
+    if (in_flight.size() == 32) {
+      auto i = (rid * 7919) % in_flight.size();
+      ASSERT_TRUE(table.take(in_flight[i], &value));
+      ASSERT_EQ(value, in_flight[i]);
+      in_flight[i] = in_flight.back();
+      in_flight.pop_back();
+    }
+  }
+  ASSERT_EQ(table.size(), 31);
+  for (auto rid : in_flight) {
+    ASSERT_TRUE(table.take(rid, &value));
+  }
+  ASSERT_EQ(table.size(), 0);
+}
+
+TEST(slottable, grow) {
+  SlotTable<uint64_t> table(2);
+  for (uint64_t id = 0; id < 1000; id++) {
+    table.insert(id, id * 2);
+  }
+  ASSERT_EQ(table.size(), 1000);
+  uint64_t value;
+  for (uint64_t id = 0; id < 1000; id++) {
+    ASSERT_TRUE(table.take(id, &value));
+    ASSERT_EQ(value, id * 2);
+  }
+  ASSERT_EQ(table.size(), 0);
+}
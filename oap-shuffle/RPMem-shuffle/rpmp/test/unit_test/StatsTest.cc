@@ -0,0 +1,63 @@
+/*
+ * Filename: /mnt/spark-pmof/tool/rpmp/test/StatsTest.cc
+ * Path: /mnt/spark-pmof/tool/rpmp/test
+ *
+ * Copyright (c) 2020 Intel
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pmpool/Stats.h"
+
+TEST(stats, replied_and_persisted) {
+  ServerStats stats(2);
+  auto now = ServerStats::now_us();
+  stats.replied(STAT_WRITE, 4096, now);
+  stats.replied(STAT_WRITE, 1024, now - 1000);
+  stats.replied(STAT_GET, 0, now);
+  stats.refused();
+  stats.persisted(1, 5120);
+  stats.persisted(2, 1);
+  StatsSnapshot snapshot;
+  stats.snapshot(&snapshot);
+  ASSERT_EQ(snapshot.ops[STAT_WRITE].count, 2);
+  ASSERT_EQ(snapshot.ops[STAT_WRITE].bytes, 5120);
+  ASSERT_EQ(snapshot.ops[STAT_GET].count, 1);
+  ASSERT_EQ(snapshot.ops[STAT_READ].count, 0);
+  ASSERT_EQ(snapshot.refused, 1);
+  ASSERT_EQ(snapshot.persisted_bytes, std::vector<uint64_t>({0, 5120}));
+  // 1000 us and more go to the bucket under 1024 us at least
+  ASSERT_GE(snapshot.ops[STAT_WRITE].percentile_us(1.0), 1024);
+  ASSERT_EQ(snapshot.ops[STAT_READ].percentile_us(0.5), 0);
+}
+
+TEST(stats, encode_decode) {
+  StatsSnapshot snapshot;
+  snapshot.ops[STAT_PUT].count = 3;
+  snapshot.ops[STAT_PUT].bytes = 300;
+  snapshot.ops[STAT_PUT].latency_us[4] = 3;
+  snapshot.refused = 2;
+  snapshot.recv_queue_depth = 5;
+  snapshot.finalize_queue_depth = 7;
+  snapshot.persisted_bytes = {10, 20, 30};
+  std::vector<block_meta> bml;
+  snapshot.encode(&bml);
+
+  StatsSnapshot decoded;
+  ASSERT_EQ(decoded.decode(bml), 0);
+  ASSERT_EQ(decoded.ops[STAT_PUT].count, 3);
+  ASSERT_EQ(decoded.ops[STAT_PUT].bytes, 300);
+  ASSERT_EQ(decoded.ops[STAT_PUT].percentile_us(0.5), 16);
+  ASSERT_EQ(decoded.refused, 2);
+  ASSERT_EQ(decoded.recv_queue_depth, 5);
+  ASSERT_EQ(decoded.read_queue_depth, 0);
+  ASSERT_EQ(decoded.finalize_queue_depth, 7);
+  ASSERT_EQ(decoded.persisted_bytes, snapshot.persisted_bytes);
+
+  bml.pop_back();
+  bml.pop_back();
+  ASSERT_NE(decoded.decode(bml), 0);
+  ASSERT_NE(decoded.decode({}), 0);
+}